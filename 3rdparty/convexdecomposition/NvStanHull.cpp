@@ -1200,14 +1200,14 @@ Quaternion YawPitchRoll( NxF32 yaw, NxF32 pitch, NxF32 roll )
 
 NxF32 Yaw( const Quaternion& q )
 {
-	static float3 v;
+	static thread_local float3 v;
 	v=q.ydir();
 	return (v.y==0.0&&v.x==0.0) ? 0.0f: atan2f(-v.x,v.y)*RAD2DEG;
 }
 
 NxF32 Pitch( const Quaternion& q )
 {
-	static float3 v;
+	static thread_local float3 v;
 	v=q.ydir();
 	return atan2f(v.z,sqrtf(sqr(v.x)+sqr(v.y)))*RAD2DEG;
 }
@@ -1236,8 +1236,8 @@ NxF32 Pitch( const float3& v )
 void Plane::Transform(const float3 &position, const Quaternion &orientation) {
 	//   Transforms the plane to the space defined by the 
 	//   given position/orientation.
-	static float3 newnormal;
-	static float3 origin;
+	static thread_local float3 newnormal;
+	static thread_local float3 origin;
 
 	newnormal = Inverse(orientation)*normal;
 	origin = Inverse(orientation)*(-normal*dist - position);
@@ -1256,7 +1256,7 @@ void Plane::Transform(const float3 &position, const Quaternion &orientation) {
 // returns quaternion q where q*v0==v1.
 // Routine taken from game programming gems.
 Quaternion RotationArc(float3 v0,float3 v1){
-	static Quaternion q;
+	static thread_local Quaternion q;
 	v0 = normalize(v0);  // Comment these two lines out if you know its not needed.
 	v1 = normalize(v1);  // If vector is already unit length then why do it again?
 	float3  c = cross(v0,v1);
@@ -1308,7 +1308,7 @@ float4x4 MatrixFromQuatVec(const Quaternion &q, const float3 &v)
 float3 PlaneLineIntersection(const Plane &plane, const float3 &p0, const float3 &p1)
 {
 	// returns the point where the line p0-p1 intersects the plane n&d
-				static float3 dif;
+				static thread_local float3 dif;
 		dif = p1-p0;
 				NxF32 dn= dot(plane.normal,dif);
 				NxF32 t = -(plane.dist+dot(plane.normal,p0) )/dn;
@@ -1456,7 +1456,7 @@ NxI32 BoxIntersect(const float3 &v0, const float3 &v1, const float3 &bmin, const
 
 NxF32 DistanceBetweenLines(const float3 &ustart, const float3 &udir, const float3 &vstart, const float3 &vdir, float3 *upoint, float3 *vpoint)
 {
-	static float3 cp;
+	static thread_local float3 cp;
 	cp = normalize(cross(udir,vdir));
 
 	NxF32 distu = -dot(cp,ustart);
@@ -1525,7 +1525,7 @@ Quaternion VirtualTrackBall(const float3 &cop, const float3 &cor, const float3 &
 }
 
 
-NxI32 countpolyhit=0;
+thread_local NxI32 countpolyhit=0;
 NxI32 PolyHit(const float3 *vert, const NxI32 n, const float3 &v0, const float3 &v1, float3 *impact, float3 *normal)
 {
 	countpolyhit++;
@@ -1551,7 +1551,7 @@ NxI32 PolyHit(const float3 *vert, const NxI32 n, const float3 &v0, const float3
 				return 0;
 		}
 
-	static float3 the_point; 
+	static thread_local float3 the_point; 
 	// By using the cached plane distances d0 and d1
 	// we can optimize the following:
 	//     the_point = planelineintersection(nrml,dist,v0,v1);
@@ -1618,7 +1618,7 @@ void ReleaseHull(PHullResult &result);
 #define PAPERWIDTH (0.001f)
 #define VOLUME_EPSILON (1e-20f)
 
-NxF32 planetestepsilon = PAPERWIDTH;
+thread_local NxF32 planetestepsilon = PAPERWIDTH;
 
 class ConvexH : public Memalloc
 {
@@ -1751,9 +1751,9 @@ ConvexH *ConvexHCrop(ConvexH &convex,const Plane &slice)
 	NxI32 i;
 	NxI32 vertcountunder=0;
 	NxI32 vertcountover =0;
-	static Array<NxI32> vertscoplanar;  // existing vertex members of convex that are coplanar
+	static thread_local Array<NxI32> vertscoplanar;  // existing vertex members of convex that are coplanar
 	vertscoplanar.count=0;
-	static Array<NxI32> edgesplit;  // existing edges that members of convex that cross the splitplane
+	static thread_local Array<NxI32> edgesplit;  // existing edges that members of convex that cross the splitplane
 	edgesplit.count=0;
 
 	assert(convex.edges.count<480);
@@ -2236,7 +2236,9 @@ NxI32 shareedge(const int3 &a,const int3 &b)
 
 class Tri;
 
-static Array<Tri*> tris; // djs: For heaven's sake!!!!
+// the destructor of a thread local template is not always instantiated implicitly
+template class Array<Tri*>;
+static thread_local Array<Tri*> tris; // djs: For heaven's sake!!!!
 
 class Tri : public int3
 {
@@ -2263,7 +2265,7 @@ public:
 
 NxI32 &Tri::neib(NxI32 a,NxI32 b)
 {
-	static NxI32 er=-1;
+	static thread_local NxI32 er=-1;
 	NxI32 i;
 	for(i=0;i<3;i++) 
 	{
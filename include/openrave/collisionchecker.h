@@ -70,15 +70,37 @@ public:
 
     CollisionReport() {
         nKeepPrevious = 0;
+        bFixedCapacity = false;
         Reset();
     }
 
     /// \brief resets the report structure for the next collision call
     ///
-    /// depending on nKeepPrevious will keep previous data.
+    /// depending on nKeepPrevious will keep previous data. The memory of contacts and vLinkColliding is kept for the next call.
     virtual void Reset(int coloptions = 0);
     virtual std::string __str__() const;
 
+    /// \brief preallocates the buffers of contacts and vLinkColliding so that contact rich queries reusing the report do not allocate.
+    ///
+    /// \param bfixedcapacity if true, AddContact and AddLinkColliding drop the entries that do not fit anymore and set bTruncated instead of growing the buffers.
+    virtual void Reserve(size_t numcontacts, size_t numlinkpairs, bool bfixedcapacity=true);
+
+    /// \brief adds a contact to contacts
+    ///
+    /// \return false if the contact was dropped because the capacity is fixed and full
+    virtual bool AddContact(const CONTACT& contact);
+
+    /// \brief adds a pair to vLinkColliding if it is not already there, vLinkColliding is kept sorted.
+    ///
+    /// \return false if the pair was dropped because the capacity is fixed and full
+    virtual bool AddLinkColliding(KinBody::LinkConstPtr plinka, KinBody::LinkConstPtr plinkb);
+
+    /// \brief gets all the colliding link pairs of the last query
+    ///
+    /// If the checker only filled the first colliding pair (CO_AllLinkCollisions is not set), returns plink1 and plink2.
+    /// \return the number of pairs
+    virtual size_t GetCollidingLinkPairs(std::vector<std::pair<KinBody::LinkConstPtr, KinBody::LinkConstPtr> >& vlinkpairs) const;
+
     KinBody::LinkConstPtr plink1, plink2; ///< the colliding links if a collision involves a bodies. Collisions do not always occur with 2 bodies like ray collisions, so these fields can be empty.
 
     std::vector<std::pair<KinBody::LinkConstPtr, KinBody::LinkConstPtr> > vLinkColliding; ///< all link collision pairs. Set when CO_AllCollisions is enabled.
@@ -91,6 +113,8 @@ public:
     int numWithinTol; ///< number of objects within tolerance of this object, filled if CO_UseTolerance option is set
 
     uint8_t nKeepPrevious; ///< if 1, will keep all previous data when resetting the collision checker. otherwise will reset
+    bool bFixedCapacity; ///< if true, contacts and vLinkColliding are not grown past their reserved capacities, see \ref Reserve
+    bool bTruncated; ///< true if some contacts or link pairs were dropped because bFixedCapacity is set
 
     //KinBody::Link::GeomConstPtr pgeom1, pgeom2; ///< the specified geometries hit for the given links
 };
@@ -241,6 +265,42 @@ public:
     /// \param[out] report [optional] collision report to be filled with data about the collision.
     virtual bool CheckStandaloneSelfCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report = CollisionReportPtr()) = 0;
 
+    /// \brief Checks a batch of configurations of a body for collisions with the environment and optionally with itself.
+    ///
+    /// Each configuration is set with KinBody::SetDOFValues(values, KinBody::CLA_Nothing, vdofindices) and checked like \ref CheckCollision(KinBodyConstPtr, CollisionReportPtr). Attached bodies are respected.
+    /// The link transformations of the body are restored before returning. The default implementation loops over the configurations, checkers can override it to reuse their internal structures between samples.
+    /// \param pbody the body to check
+    /// \param vdofindices the dof indices the configurations are defined for. If empty, all the dofs of the body are used.
+    /// \param vconfigurations N configurations stored contiguously, each of size vdofindices.size() (or pbody->GetDOF() if vdofindices is empty)
+    /// \param[out] vcollisions resized to N, vcollisions[i] is 1 if configuration i is in collision, 0 otherwise
+    /// \param bCheckSelfCollision if true, configurations not colliding with the environment are also checked with \ref KinBody::CheckSelfCollision using this checker, so the grabbed bodies are checked too
+    /// \return the number of configurations in collision
+    virtual int CheckCollisionConfigurations(KinBodyPtr pbody, const std::vector<int>& vdofindices, const std::vector<dReal>& vconfigurations, std::vector<uint8_t>& vcollisions, bool bCheckSelfCollision=true);
+
+    /// \brief Checks the motion of a body between two configurations for collisions with the environment.
+    ///
+    /// Unlike sampling configurations, the whole volume swept by the links is checked, so thin obstacles between the samples are not missed.
+    /// Every link of the body and its attached bodies moves linearly (interpolated translation and rotation) from its transform at vstartvalues to its transform at vendvalues, which is only close to the real joint motion when the configurations are close.
+    /// Self-collisions are not checked. The link transformations of the body are restored before returning. Checkers that do not support continuous queries throw ORE_NotImplemented.
+    /// \param pbody the body to check
+    /// \param vdofindices the dof indices the values are defined for. If empty, all the dofs of the body are used.
+    /// \param vstartvalues the values at the start of the motion
+    /// \param vendvalues the values at the end of the motion
+    /// \param[out] report [optional] filled with the colliding links
+    /// \return true if the body collides anywhere along the motion
+    virtual bool CheckContinuousCollision(KinBodyPtr pbody, const std::vector<int>& vdofindices, const std::vector<dReal>& vstartvalues, const std::vector<dReal>& vendvalues, CollisionReportPtr report = CollisionReportPtr()) OPENRAVE_DUMMY_IMPLEMENTATION;
+
+    /// \brief Checks a batch of rays like \ref CheckCollision(const RAY&, CollisionReportPtr), or like \ref CheckCollision(const RAY&, KinBodyConstPtr, CollisionReportPtr) if pbody is set.
+    ///
+    /// The hit distances are always computed, whether CO_Distance is set or not. The default implementation loops over the rays, checkers can override it to prepare their internal structures once for all the rays.
+    /// \param vrays the rays to check, the length of each ray direction is the maximum distance checked along it
+    /// \param pbody if not empty, only checks the rays against this body
+    /// \param[out] vhitdistances resized to N, the distance along ray i to its closest hit, or -1 if ray i does not hit anything
+    /// \param[out] vhitnormals resized to N, the contact normal of the hit of ray i, zero if ray i does not hit anything
+    /// \param[out] vhitbodyids resized to N, the environment id of the body hit by ray i, 0 if ray i does not hit a body
+    /// \return the number of rays that hit something
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, KinBodyConstPtr pbody, std::vector<dReal>& vhitdistances, std::vector<Vector>& vhitnormals, std::vector<int>& vhitbodyids);
+
     /// \deprecated (13/04/09)
     virtual bool CheckSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) RAVE_DEPRECATED
     {
@@ -24,7 +24,82 @@
 
 namespace OpenRAVE {
 
-typedef boost::recursive_try_mutex EnvironmentMutex;
+/// \brief statistics of the acquisitions of an \ref EnvironmentMutex from one call site, see \ref EnvironmentMutex::GetStatistics
+///
+/// Times are in ns. Bucket 0 of the histograms counts the durations below 1us, bucket i>0 the durations in [2^(i-1), 2^i) us,
+/// and the last bucket all the longer ones.
+class OPENRAVE_API EnvironmentMutexStatistics
+{
+public:
+    enum { NumHistogramBuckets = 24 };
+
+    EnvironmentMutexStatistics();
+
+    std::string callsite; ///< the function and the module that locked the mutex, or its address if it cannot be resolved
+    uint64_t numAcquisitions; ///< number of times the mutex was locked from callsite by a thread not already holding it
+    uint64_t totalWaitTime, maxWaitTime; ///< time spent waiting for the mutex
+    uint64_t totalHoldTime, maxHoldTime; ///< time the mutex was held until the outermost unlock
+    std::vector<uint64_t> vWaitHistogram, vHoldHistogram;
+};
+
+/// \brief the mutex of an environment, a recursive mutex that can record how long threads wait for it and hold it.
+///
+/// When the instrumentation is enabled with \ref SetInstrumentationEnabled, every outermost acquisition records the time the
+/// thread waited and the time it held the mutex under the call site that locked it. The call site is the return address
+/// of lock(), which is resolved to a function and module name when the statistics are retrieved. When disabled, locking
+/// only costs a flag check on top of the recursive mutex.
+class OPENRAVE_API EnvironmentMutex : public boost::recursive_try_mutex
+{
+public:
+    typedef boost::unique_lock<EnvironmentMutex> scoped_lock;
+    typedef boost::detail::try_lock_wrapper<EnvironmentMutex> scoped_try_lock;
+
+    EnvironmentMutex();
+    ~EnvironmentMutex();
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    /// \brief starts or stops recording the acquisitions. The recorded statistics are kept until \ref ResetStatistics is called.
+    void SetInstrumentationEnabled(bool bEnable);
+
+    inline bool IsInstrumentationEnabled() const {
+        return _bInstrumentationEnabled.load(std::memory_order_relaxed);
+    }
+
+    /// \brief returns the statistics of every call site that locked the mutex while the instrumentation was enabled
+    void GetStatistics(std::vector<EnvironmentMutexStatistics>& vstatistics) const;
+
+    /// \brief removes all the recorded statistics
+    void ResetStatistics();
+
+    /// \brief describes the thread currently holding the mutex
+    ///
+    /// \param threadid filled with the id of the holding thread
+    /// \param callsite filled with the call site that locked the mutex
+    /// \param heldtime filled with the ns since the mutex was locked
+    /// \return false if no thread holds the mutex, or the holder locked it while the instrumentation was disabled
+    bool GetHolder(std::string& threadid, std::string& callsite, uint64_t& heldtime) const;
+
+private:
+    struct CallSiteData;
+
+    void _LockInstrumented(void* callsite);
+    bool _TryLockInstrumented(void* callsite);
+    void _OnAcquired(void* callsite, uint64_t starttime, uint64_t acquiretime);
+    void _OnReleased();
+
+    std::atomic<bool> _bInstrumentationEnabled;
+    int _nDepth; ///< recursion depth of the holding thread, only accessed while holding the mutex
+    bool _bRecordingHold; ///< true if the outermost acquisition of the holding thread is being recorded, only accessed while holding the mutex
+
+    mutable boost::mutex _mutexStatistics; ///< protects the data below
+    std::map<void*, boost::shared_ptr<CallSiteData> > _mapCallSites;
+    void* _holdercallsite; ///< call site of the current holder if _bRecordingHold
+    boost::thread::id _holderthreadid;
+    uint64_t _holdstarttime;
+};
 
 /** \brief Maintains a world state, which serves as the gateway to all functions offered through %OpenRAVE. See \ref arch_environment.
  */
@@ -79,6 +154,16 @@ public:
     /// \param[in] cloningoptions The parts of the environment to clone. Parts not specified are left as is.
     virtual void Clone(EnvironmentBaseConstPtr preference, int cloningoptions) = 0;
 
+    /// \brief Brings the bodies of an environment previously cloned from preference up to date with it.
+    ///
+    /// Only the bodies whose update stamp changed since the last call are touched. Their link transforms, DOF values,
+    /// enable states, active DOFs and grabbed bodies are copied from the reference body. This makes it cheap enough to keep
+    /// worker clones current at high rates. When bodies were added to or removed from preference, or a body changed its
+    /// kinematics or geometry, this falls back to Clone(preference, Clone_Bodies).
+    /// The environment mutex of preference is locked first, then the mutex of this environment.
+    /// \param preference the environment this environment was cloned from.
+    virtual void SynchronizeBodies(EnvironmentBaseConstPtr preference) = 0;
+
     /// \brief Each function takes an optional pointer to a CollisionReport structure and returns true if collision occurs. <b>[multi-thread safe]</b>
     ///
     /// \name Collision specific functions.
@@ -185,6 +270,37 @@ public:
     ///
     /// See \ref arch_simulation for more about the simulation thread.
     virtual uint64_t GetSimulationTime() = 0;
+
+    /// \brief Sets the number of threads StepSimulation uses to step the concurrent sensors. <b>[multi-thread safe]</b>
+    ///
+    /// \param numthreads if > 1, the sensors marked concurrent with \ref SetSensorSimulationParameters are stepped by a pool of this many threads after all the other sensors were stepped. Otherwise all sensors are stepped one after the other by the thread calling StepSimulation.
+    virtual void SetSensorSimulationThreads(int numthreads) = 0;
+
+    /// \brief \see SetSensorSimulationThreads
+    virtual int GetSensorSimulationThreads() const = 0;
+
+    /// \brief Sets the number of threads StepSimulation uses to step the bodies and their controllers. <b>[multi-thread safe]</b>
+    ///
+    /// \param numthreads if > 1, the bodies are stepped by a pool of threads after the physics engine, while bodies attached to each other, like a robot and its grabbed bodies, are stepped one after the other by the same thread.
+    /// The modules and sensors are only stepped once all the bodies finished, so they see the moved bodies. Otherwise all bodies are stepped one after the other by the thread calling StepSimulation.
+    /// The environment mutex is held by the thread calling StepSimulation, so the controllers of the bodies must only change their own body and must never lock the environment mutex.
+    /// Controllers can check collisions, like IdealController with SetCheckCollisions: every thread of the pool has its own collision checker, and the CheckCollision functions of the environment
+    /// do not lock the environment mutex when called by the pool. Bodies stepped by other threads may be in the middle of their step when checked against.
+    /// The pool is shared with the concurrent sensors and has max(numthreads, \ref GetSensorSimulationThreads) threads.
+    virtual void SetBodySimulationThreads(int numthreads) = 0;
+
+    /// \brief \see SetBodySimulationThreads
+    virtual int GetBodySimulationThreads() const = 0;
+
+    /// \brief Configures how StepSimulation steps a sensor of the environment or attached to a robot. <b>[multi-thread safe]</b>
+    ///
+    /// \param psensor the sensor
+    /// \param fPeriod if > 0, the sensor is only stepped once at least fPeriod of simulation time passed since its previous step, and is given all the time that passed. If 0, the sensor is stepped every StepSimulation call.
+    /// \param bConcurrent if true, the sensor is stepped concurrently with the other concurrent sensors when \ref GetSensorSimulationThreads is > 1.
+    /// The bodies do not change while the concurrent sensors are stepped, but the environment mutex is held by the thread calling StepSimulation.
+    /// So a concurrent sensor must only read the scene and must never lock the environment mutex. Every thread of the pool has its own collision checker of the same type as the environment checker,
+    /// which \ref GetCollisionChecker returns to the sensors it steps.
+    virtual void SetSensorSimulationParameters(SensorBaseConstPtr psensor, dReal fPeriod, bool bConcurrent) = 0;
     //@}
 
     /// \name File Loading and Parsing
@@ -392,6 +508,16 @@ public:
      */
     virtual void Add(InterfaceBasePtr pinterface, bool bAnonymous=false, const std::string& cmdargs="") = 0;
 
+    /** \brief Adds several bodies and robots to the environment at once
+
+        Behaves like calling \ref Add for every body, except that the environment is modified once and the body callbacks are called after all the bodies are initialized.
+        Nothing is added if one of the bodies is invalid.
+        \param[in] vbodies bodies and robots that are not in the environment yet
+        \param[in] bAnonymous if true and there exists a body/robot with the same name, will make body's name unique
+        \throw openrave_exception Throw if a body is invalid, already added, or its name is not unique while bAnonymous is false
+     */
+    virtual void AddBodies(const std::vector<KinBodyPtr>& vbodies, bool bAnonymous=false) = 0;
+
     /// \deprecated (12/04/18)
     virtual void AddKinBody(KinBodyPtr body, bool bAnonymous=false) RAVE_DEPRECATED {
         RAVELOG_WARN("EnvironmentBase::AddKinBody deprecated, please use EnvironmentBase::Add\n");
@@ -433,6 +559,13 @@ public:
     /// \return true if the interface was successfully removed from the environment.
     virtual bool Remove(InterfaceBasePtr obj) = 0;
 
+    /// \brief Removes several bodies and robots from the environment at once. <b>[multi-thread safe]</b>
+    ///
+    /// Equivalent to calling \ref Remove for every body, but the bodies vector is compacted once.
+    /// \param[in] vbodies bodies to remove, the ones not in the environment are ignored
+    /// \return the number of removed bodies
+    virtual int RemoveBodies(const std::vector<KinBodyPtr>& vbodies) = 0;
+
     /// \brief Removes all kinbodies that match the name
     ///
     /// \param[in] name of the kinbody to remove
@@ -466,39 +599,91 @@ public:
     /// \throw openrave_exception with ORE_Timeout error code
     virtual void GetRobots(std::vector<RobotBasePtr>& robots, uint64_t timeout=0) const = 0;
 
+    /// \brief Computes the world aabb of every body in the environment (including robots). The environment should be locked.
+    ///
+    /// The link aabbs are cached, so the bodies that did not move since the last call are cheap.
+    /// \param[out] bodies filled with all the bodies like \ref GetBodies
+    /// \param[out] vaabbs filled with the aabb of every body of bodies, see \ref KinBody::ComputeAABB
+    /// \param bEnabledOnlyLinks if true, only the enabled links of the bodies are used
+    virtual void ComputeBodyAABBs(std::vector<KinBodyPtr>& bodies, std::vector<AABB>& vaabbs, bool bEnabledOnlyLinks=false) const {
+        GetBodies(bodies);
+        vaabbs.resize(bodies.size());
+        for(size_t ibody = 0; ibody < bodies.size(); ++ibody) {
+            vaabbs[ibody] = bodies[ibody]->ComputeAABB(bEnabledOnlyLinks);
+        }
+    }
+
+    /** \brief Gets the bodies whose enabled links overlap a world box. The environment should be locked.
+
+        The environment keeps the bodies in a uniform grid of cells, so only the bodies around the box are visited. A body is moved to its new cells by the next query after it moves or its geometry or enabled state changes, bodies that did not change are not touched.
+        Disabled bodies are never returned.
+        \param ab the box in world coordinates
+        \param[out] bodies filled with the bodies whose aabb of enabled links overlaps ab, sorted by environment id
+     */
+    virtual void GetBodiesInAABB(const AABB& ab, std::vector<KinBodyPtr>& bodies) = 0;
+
+    /// \brief Sets the size of the cells of the grid used by \ref GetBodiesInAABB, should be about the size of the common bodies of the scene. The default is 1m.
+    ///
+    /// Changing the size rebuilds the grid on the next query.
+    virtual void SetSpatialGridCellSize(dReal fCellSize) = 0;
+
+    /// \brief \see SetSpatialGridCellSize
+    virtual dReal GetSpatialGridCellSize() const = 0;
+
+    /// \brief Immutable copy of the published bodies of the environment, see \ref GetPublishedSnapshot
+    class EnvironmentSnapshot
+    {
+public:
+        EnvironmentSnapshot() : bodiesmodifiedstamp(0), simulationtime(0) {
+        }
+        virtual ~EnvironmentSnapshot() {
+        }
+
+        std::vector<KinBody::BodyStateConstPtr> vbodies; ///< \see GetPublishedBodies. states of bodies that did not change are shared with the previous snapshots
+        int bodiesmodifiedstamp; ///< incremented every time a body is added to or removed from the environment
+        uint64_t simulationtime; ///< \see GetSimulationTime
+    };
+    typedef boost::shared_ptr<EnvironmentSnapshot const> EnvironmentSnapshotConstPtr;
+
+    /// \brief Returns the state of all bodies as of the last call to \ref UpdatePublishedBodies. <b>[multi-thread safe]</b>
+    ///
+    /// Neither the environment mutex nor the **interface mutex** is locked, so readers like viewers and telemetry
+    /// never wait on planners or the simulation thread. The returned snapshot is never modified, a new one is created
+    /// on every update, so it can be held and read from any thread for as long as needed. Every update only copies
+    /// the bodies whose \ref KinBody::GetUpdateStamp changed.
+    /// The BodyState::pbody pointers should only be dereferenced while the environment is locked.
+    /// \return the snapshot, never null.
+    virtual EnvironmentSnapshotConstPtr GetPublishedSnapshot() const = 0;
+
     /// \brief Retrieve published bodies, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Copies the bodies of \ref GetPublishedSnapshot.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBodies returns.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, the published bodies are never locked for longer than copying a pointer.
     virtual void GetPublishedBodies(std::vector<KinBody::BodyState>& vbodies, uint64_t timeout=0) = 0;
 
     /// \brief Retrieve published body of specified name, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Reads from \ref GetPublishedSnapshot.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBody returns.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, the published bodies are never locked for longer than copying a pointer.
     /// \return true if name matches to a published body
     virtual bool GetPublishedBody(const std::string& name, KinBody::BodyState& bodystate, uint64_t timeout=0) = 0;
 
     /// \brief Retrieve joint values of published body of specified name, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Reads from \ref GetPublishedSnapshot.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBodyJointValues returns.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, the published bodies are never locked for longer than copying a pointer.
     /// \return true if name matches to a published body
     virtual bool GetPublishedBodyJointValues(const std::string& name, std::vector<dReal> &jointValues, uint64_t timeout=0) = 0;
 
     /// \brief Retrieve body transform of all published bodies whose name matches prefix, completes even if environment is locked. <b>[multi-thread safe]</b>
     ///
-    /// A separate **interface mutex** is locked for reading the modules.
+    /// Reads from \ref GetPublishedSnapshot.
     /// Note that the pbody pointer might become invalid as soon as GetPublishedBody returns.
     /// \param prefix the prefix to match to the target names.
-    /// \param timeout microseconds to wait before throwing an exception, if 0, will block indefinitely.
-    /// \throw openrave_exception with ORE_Timeout error code
+    /// \param timeout unused, the published bodies are never locked for longer than copying a pointer.
     virtual void GetPublishedBodyTransformsMatchingPrefix(const std::string& prefix, std::vector<std::pair<std::string, Transform> >& nameTransfPairs, uint64_t timeout = 0) = 0;
 
     /// \brief Updates the published bodies that viewers and other programs listening in on the environment see.
@@ -29,6 +29,22 @@
 #include <utility> // for std::pair
 #include <cstdlib>
 
+// the float and double specializations of the quaternion and point transformation functions use the SIMD instructions the compiler enables, define OPENRAVE_MATH_NO_SIMD to use the scalar templates only
+#ifndef OPENRAVE_MATH_NO_SIMD
+#if defined(__SSE2__) || defined(__AVX__)
+#define OPENRAVE_MATH_SSE2
+#if defined(__AVX__)
+#define OPENRAVE_MATH_AVX
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define OPENRAVE_MATH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 #ifndef RAVE_DEPRECATED
 #define RAVE_DEPRECATED
 #endif
@@ -369,6 +385,86 @@ inline RaveVector<T> operator* (double f, const RaveVector<T>&left)
     return v;
 }
 
+/// \brief Computes q = quat0*quat1 of quaternions (s,vx,vy,vz), q can be one of the inputs
+///
+/// \ingroup affine_math
+/// The product is quat0.x*(x,y,z,w) + quat0.y*(-y,x,-w,z) + quat0.z*(-z,w,x,-y) + quat0.w*(-w,-z,y,x) of the components of quat1, the float and double overloads compute it with SIMD instructions.
+template <typename T>
+inline void _QuatMultiply(const RaveVector<T>& quat0, const RaveVector<T>& quat1, RaveVector<T>& q)
+{
+    T x = quat0.x*quat1.x - quat0.y*quat1.y - quat0.z*quat1.z - quat0.w*quat1.w;
+    T y = quat0.x*quat1.y + quat0.y*quat1.x + quat0.z*quat1.w - quat0.w*quat1.z;
+    T z = quat0.x*quat1.z + quat0.z*quat1.x + quat0.w*quat1.y - quat0.y*quat1.w;
+    T w = quat0.x*quat1.w + quat0.w*quat1.x + quat0.y*quat1.z - quat0.z*quat1.y;
+    q.x = x; q.y = y; q.z = z; q.w = w;
+}
+
+#if defined(OPENRAVE_MATH_SSE2)
+inline void _QuatMultiply(const RaveVector<float>& quat0, const RaveVector<float>& quat1, RaveVector<float>& q)
+{
+    const __m128 q1 = _mm_loadu_ps(&quat1.x);
+    // xor with -0 flips the sign exactly, _mm_set_ps takes the components from w to x
+    const __m128 b = _mm_xor_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(2,3,0,1)), _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f));
+    const __m128 c = _mm_xor_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(1,0,3,2)), _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+    const __m128 d = _mm_xor_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(0,1,2,3)), _mm_set_ps(0.0f, 0.0f, -0.0f, -0.0f));
+    __m128 r = _mm_mul_ps(_mm_set1_ps(quat0.x), q1);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(quat0.y), b));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(quat0.z), c));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(quat0.w), d));
+    _mm_storeu_ps(&q.x, r);
+}
+
+inline void _QuatMultiply(const RaveVector<double>& quat0, const RaveVector<double>& quat1, RaveVector<double>& q)
+{
+    // (x,y) and (z,w) halves, _mm_set_pd takes the high component first
+    const __m128d q1xy = _mm_loadu_pd(&quat1.x), q1zw = _mm_loadu_pd(&quat1.z);
+    const __m128d q1yx = _mm_shuffle_pd(q1xy, q1xy, 1), q1wz = _mm_shuffle_pd(q1zw, q1zw, 1);
+    const __m128d signlow = _mm_set_pd(0.0, -0.0), signhigh = _mm_set_pd(-0.0, 0.0), signboth = _mm_set_pd(-0.0, -0.0);
+    const __m128d s0 = _mm_set1_pd(quat0.x), s1 = _mm_set1_pd(quat0.y), s2 = _mm_set1_pd(quat0.z), s3 = _mm_set1_pd(quat0.w);
+    __m128d rxy = _mm_mul_pd(s0, q1xy), rzw = _mm_mul_pd(s0, q1zw);
+    rxy = _mm_add_pd(rxy, _mm_mul_pd(s1, _mm_xor_pd(q1yx, signlow)));
+    rzw = _mm_add_pd(rzw, _mm_mul_pd(s1, _mm_xor_pd(q1wz, signlow)));
+    rxy = _mm_add_pd(rxy, _mm_mul_pd(s2, _mm_xor_pd(q1zw, signlow)));
+    rzw = _mm_add_pd(rzw, _mm_mul_pd(s2, _mm_xor_pd(q1xy, signhigh)));
+    rxy = _mm_add_pd(rxy, _mm_mul_pd(s3, _mm_xor_pd(q1wz, signboth)));
+    rzw = _mm_add_pd(rzw, _mm_mul_pd(s3, q1yx));
+    _mm_storeu_pd(&q.x, rxy);
+    _mm_storeu_pd(&q.z, rzw);
+}
+#elif defined(OPENRAVE_MATH_NEON)
+inline void _QuatMultiply(const RaveVector<float>& quat0, const RaveVector<float>& quat1, RaveVector<float>& q)
+{
+    static const float s_signs[12] = {-1, 1, -1, 1, -1, 1, 1, -1, -1, -1, 1, 1};
+    const float32x4_t q1 = vld1q_f32(&quat1.x);
+    const float32x4_t q1yxwz = vrev64q_f32(q1), q1zwxy = vextq_f32(q1, q1, 2);
+    const float32x4_t b = vmulq_f32(q1yxwz, vld1q_f32(s_signs));
+    const float32x4_t c = vmulq_f32(q1zwxy, vld1q_f32(s_signs+4));
+    const float32x4_t d = vmulq_f32(vextq_f32(q1yxwz, q1yxwz, 2), vld1q_f32(s_signs+8));
+    float32x4_t r = vmulq_n_f32(q1, quat0.x);
+    r = vaddq_f32(r, vmulq_n_f32(b, quat0.y));
+    r = vaddq_f32(r, vmulq_n_f32(c, quat0.z));
+    r = vaddq_f32(r, vmulq_n_f32(d, quat0.w));
+    vst1q_f32(&q.x, r);
+}
+
+inline void _QuatMultiply(const RaveVector<double>& quat0, const RaveVector<double>& quat1, RaveVector<double>& q)
+{
+    static const double s_signlow[2] = {-1, 1}, s_signhigh[2] = {1, -1};
+    const float64x2_t q1xy = vld1q_f64(&quat1.x), q1zw = vld1q_f64(&quat1.z);
+    const float64x2_t q1yx = vextq_f64(q1xy, q1xy, 1), q1wz = vextq_f64(q1zw, q1zw, 1);
+    const float64x2_t signlow = vld1q_f64(s_signlow), signhigh = vld1q_f64(s_signhigh);
+    float64x2_t rxy = vmulq_n_f64(q1xy, quat0.x), rzw = vmulq_n_f64(q1zw, quat0.x);
+    rxy = vaddq_f64(rxy, vmulq_n_f64(vmulq_f64(q1yx, signlow), quat0.y));
+    rzw = vaddq_f64(rzw, vmulq_n_f64(vmulq_f64(q1wz, signlow), quat0.y));
+    rxy = vaddq_f64(rxy, vmulq_n_f64(vmulq_f64(q1zw, signlow), quat0.z));
+    rzw = vaddq_f64(rzw, vmulq_n_f64(vmulq_f64(q1xy, signhigh), quat0.z));
+    rxy = vaddq_f64(rxy, vmulq_n_f64(vnegq_f64(q1wz), quat0.w));
+    rzw = vaddq_f64(rzw, vmulq_n_f64(q1yx, quat0.w));
+    vst1q_f64(&q.x, rxy);
+    vst1q_f64(&q.z, rzw);
+}
+#endif
+
 /** \brief Affine transformation parameterized with quaterions.
 
     \ingroup affine_math
@@ -423,10 +519,7 @@ public:
     inline RaveTransform<T> rotate(const RaveTransform<T>& r) const {
         RaveTransform<T> t;
         t.trans = rotate(r.trans);
-        t.rot.x = rot.x*r.rot.x - rot.y*r.rot.y - rot.z*r.rot.z - rot.w*r.rot.w;
-        t.rot.y = rot.x*r.rot.y + rot.y*r.rot.x + rot.z*r.rot.w - rot.w*r.rot.z;
-        t.rot.z = rot.x*r.rot.z + rot.z*r.rot.x + rot.w*r.rot.y - rot.y*r.rot.w;
-        t.rot.w = rot.x*r.rot.w + rot.w*r.rot.x + rot.y*r.rot.z - rot.z*r.rot.y;
+        _QuatMultiply(rot, r.rot, t.rot);
         // normalize the transformation
         MATH_ASSERT( t.rot.lengthsqr4() > 0.99f && t.rot.lengthsqr4() < 1.01f );
         t.rot.normalize4();
@@ -437,10 +530,7 @@ public:
     inline RaveTransform<T> operator* (const RaveTransform<T>&r) const {
         RaveTransform<T> t;
         t.trans = operator*(r.trans);
-        t.rot.x = rot.x*r.rot.x - rot.y*r.rot.y - rot.z*r.rot.z - rot.w*r.rot.w;
-        t.rot.y = rot.x*r.rot.y + rot.y*r.rot.x + rot.z*r.rot.w - rot.w*r.rot.z;
-        t.rot.z = rot.x*r.rot.z + rot.z*r.rot.x + rot.w*r.rot.y - rot.y*r.rot.w;
-        t.rot.w = rot.x*r.rot.w + rot.w*r.rot.x + rot.y*r.rot.z - rot.z*r.rot.y;
+        _QuatMultiply(rot, r.rot, t.rot);
         // normalize the transformation
         MATH_ASSERT( t.rot.lengthsqr4() > 0.99f && t.rot.lengthsqr4() < 1.01f );
         t.rot.normalize4();
@@ -617,6 +707,95 @@ public:
     RaveVector<T> trans;     ///< translation component
 };
 
+/// \brief Transforms an array of points, pout[i] = t*pin[i].
+///
+/// \ingroup affine_math
+/// The rotation is read once and there are no dependencies between the points, so the compiler can vectorize the loop. pin and pout can be the same array.
+template <typename T>
+inline void TransformPoints(const RaveTransformMatrix<T>& t, const RaveVector<T>* pin, size_t numpoints, RaveVector<T>* pout)
+{
+    const T m00 = t.m[0], m01 = t.m[1], m02 = t.m[2], m10 = t.m[4], m11 = t.m[5], m12 = t.m[6], m20 = t.m[8], m21 = t.m[9], m22 = t.m[10];
+    const T tx = t.trans.x, ty = t.trans.y, tz = t.trans.z;
+    for(size_t i = 0; i < numpoints; ++i) {
+        const T x = pin[i].x, y = pin[i].y, z = pin[i].z;
+        pout[i].x = m00*x + m01*y + m02*z + tx;
+        pout[i].y = m10*x + m11*y + m12*z + ty;
+        pout[i].z = m20*x + m21*y + m22*z + tz;
+        pout[i].w = 0;
+    }
+}
+
+#if defined(OPENRAVE_MATH_SSE2) || defined(OPENRAVE_MATH_NEON)
+inline void TransformPoints(const RaveTransformMatrix<float>& t, const RaveVector<float>* pin, size_t numpoints, RaveVector<float>* pout)
+{
+    // columns of the rotation, the w components are 0 so that pout[i].w is 0
+#if defined(OPENRAVE_MATH_SSE2)
+    const __m128 c0 = _mm_set_ps(0, t.m[8], t.m[4], t.m[0]), c1 = _mm_set_ps(0, t.m[9], t.m[5], t.m[1]), c2 = _mm_set_ps(0, t.m[10], t.m[6], t.m[2]), vtrans = _mm_set_ps(0, t.trans.z, t.trans.y, t.trans.x);
+    for(size_t i = 0; i < numpoints; ++i) {
+        __m128 v = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(pin[i].x)), _mm_mul_ps(c1, _mm_set1_ps(pin[i].y)));
+        v = _mm_add_ps(_mm_add_ps(v, _mm_mul_ps(c2, _mm_set1_ps(pin[i].z))), vtrans);
+        _mm_storeu_ps(&pout[i].x, v);
+    }
+#else
+    const float fc0[4] = {t.m[0], t.m[4], t.m[8], 0}, fc1[4] = {t.m[1], t.m[5], t.m[9], 0}, fc2[4] = {t.m[2], t.m[6], t.m[10], 0}, ftrans[4] = {t.trans.x, t.trans.y, t.trans.z, 0};
+    const float32x4_t c0 = vld1q_f32(fc0), c1 = vld1q_f32(fc1), c2 = vld1q_f32(fc2), vtrans = vld1q_f32(ftrans);
+    for(size_t i = 0; i < numpoints; ++i) {
+        float32x4_t v = vaddq_f32(vmulq_n_f32(c0, pin[i].x), vmulq_n_f32(c1, pin[i].y));
+        v = vaddq_f32(vaddq_f32(v, vmulq_n_f32(c2, pin[i].z)), vtrans);
+        vst1q_f32(&pout[i].x, v);
+    }
+#endif
+}
+
+inline void TransformPoints(const RaveTransformMatrix<double>& t, const RaveVector<double>* pin, size_t numpoints, RaveVector<double>* pout)
+{
+#if defined(OPENRAVE_MATH_AVX)
+    const __m256d c0 = _mm256_set_pd(0, t.m[8], t.m[4], t.m[0]), c1 = _mm256_set_pd(0, t.m[9], t.m[5], t.m[1]), c2 = _mm256_set_pd(0, t.m[10], t.m[6], t.m[2]), vtrans = _mm256_set_pd(0, t.trans.z, t.trans.y, t.trans.x);
+    for(size_t i = 0; i < numpoints; ++i) {
+        __m256d v = _mm256_add_pd(_mm256_mul_pd(c0, _mm256_set1_pd(pin[i].x)), _mm256_mul_pd(c1, _mm256_set1_pd(pin[i].y)));
+        v = _mm256_add_pd(_mm256_add_pd(v, _mm256_mul_pd(c2, _mm256_set1_pd(pin[i].z))), vtrans);
+        _mm256_storeu_pd(&pout[i].x, v);
+    }
+#elif defined(OPENRAVE_MATH_SSE2)
+    // (x,y) and (z,w) halves of the columns
+    const __m128d c0xy = _mm_set_pd(t.m[4], t.m[0]), c1xy = _mm_set_pd(t.m[5], t.m[1]), c2xy = _mm_set_pd(t.m[6], t.m[2]), transxy = _mm_set_pd(t.trans.y, t.trans.x);
+    const __m128d c0zw = _mm_set_pd(0, t.m[8]), c1zw = _mm_set_pd(0, t.m[9]), c2zw = _mm_set_pd(0, t.m[10]), transzw = _mm_set_pd(0, t.trans.z);
+    for(size_t i = 0; i < numpoints; ++i) {
+        const __m128d x = _mm_set1_pd(pin[i].x), y = _mm_set1_pd(pin[i].y), z = _mm_set1_pd(pin[i].z);
+        __m128d vxy = _mm_add_pd(_mm_mul_pd(c0xy, x), _mm_mul_pd(c1xy, y));
+        __m128d vzw = _mm_add_pd(_mm_mul_pd(c0zw, x), _mm_mul_pd(c1zw, y));
+        vxy = _mm_add_pd(_mm_add_pd(vxy, _mm_mul_pd(c2xy, z)), transxy);
+        vzw = _mm_add_pd(_mm_add_pd(vzw, _mm_mul_pd(c2zw, z)), transzw);
+        _mm_storeu_pd(&pout[i].x, vxy);
+        _mm_storeu_pd(&pout[i].z, vzw);
+    }
+#else
+    const double fc0[4] = {t.m[0], t.m[4], t.m[8], 0}, fc1[4] = {t.m[1], t.m[5], t.m[9], 0}, fc2[4] = {t.m[2], t.m[6], t.m[10], 0}, ftrans[4] = {t.trans.x, t.trans.y, t.trans.z, 0};
+    const float64x2_t c0xy = vld1q_f64(fc0), c1xy = vld1q_f64(fc1), c2xy = vld1q_f64(fc2), transxy = vld1q_f64(ftrans);
+    const float64x2_t c0zw = vld1q_f64(fc0+2), c1zw = vld1q_f64(fc1+2), c2zw = vld1q_f64(fc2+2), transzw = vld1q_f64(ftrans+2);
+    for(size_t i = 0; i < numpoints; ++i) {
+        const double x = pin[i].x, y = pin[i].y, z = pin[i].z;
+        float64x2_t vxy = vaddq_f64(vmulq_n_f64(c0xy, x), vmulq_n_f64(c1xy, y));
+        float64x2_t vzw = vaddq_f64(vmulq_n_f64(c0zw, x), vmulq_n_f64(c1zw, y));
+        vxy = vaddq_f64(vaddq_f64(vxy, vmulq_n_f64(c2xy, z)), transxy);
+        vzw = vaddq_f64(vaddq_f64(vzw, vmulq_n_f64(c2zw, z)), transzw);
+        vst1q_f64(&pout[i].x, vxy);
+        vst1q_f64(&pout[i].z, vzw);
+    }
+#endif
+}
+#endif
+
+/// \brief Transforms an array of points, pout[i] = t*pin[i].
+///
+/// \ingroup affine_math
+/// Converts the quaternion to a rotation matrix once instead of for every point. pin and pout can be the same array.
+template <typename T>
+inline void TransformPoints(const RaveTransform<T>& t, const RaveVector<T>* pin, size_t numpoints, RaveVector<T>* pout)
+{
+    TransformPoints(RaveTransformMatrix<T>(t), pin, numpoints, pout);
+}
+
 /// \brief A ray defined by an origin and a direction.
 /// \ingroup geometric_primitives
 template <typename T>
@@ -955,10 +1134,8 @@ template <typename T> inline RaveTransformMatrix<T> matrixFromAxisAngle(const Ra
 template <typename T>
 inline RaveVector<T> quatMultiply(const RaveVector<T>& quat0, const RaveVector<T>& quat1)
 {
-    RaveVector<T> q(quat0.x*quat1.x - quat0.y*quat1.y - quat0.z*quat1.z - quat0.w*quat1.w,
-                    quat0.x*quat1.y + quat0.y*quat1.x + quat0.z*quat1.w - quat0.w*quat1.z,
-                    quat0.x*quat1.z + quat0.z*quat1.x + quat0.w*quat1.y - quat0.y*quat1.w,
-                    quat0.x*quat1.w + quat0.w*quat1.x + quat0.y*quat1.z - quat0.z*quat1.y);
+    RaveVector<T> q;
+    _QuatMultiply(quat0, quat1, q);
     // do not normalize since some quaternion math (like derivatives) do not correspond to unit quaternions
     return q;
 }
@@ -282,6 +282,18 @@ public:
      */
     virtual bool SolveAll(const IkParameterization& param, const std::vector<dReal>& vFreeParameters, int filteroptions, std::vector<IkReturnPtr>& ikreturns);
 
+    /** \brief Return all joint configurations for each end effector pose of a batch.
+
+        Gives the same results as calling \ref SolveAll on every pose, but lets the solver share its setup (state savers,
+        filter preparation) across all the poses. The default implementation calls \ref SolveAll in a loop.
+        Solvers that can tell when a filter returns IKRA_Quit stop the batch there, the poses from that one on have no solutions and false is returned.
+        \param[in] params the poses the end effector has to achieve in the manipulator base's coordinate system.
+        \param[in] filteroptions A bitmask of \ref IkFilterOptions values controlling what is checked for each ik solution.
+        \param[out] ikreturns ikreturns[i] holds the ik output data for params[i]
+        \return true if at least one solution is found for any of the poses
+     */
+    virtual bool SolveAllBatch(const std::vector<IkParameterization>& params, int filteroptions, std::vector< std::vector<IkReturnPtr> >& ikreturns);
+
     /// \brief returns true if the solver supports a particular ik parameterization as input.
     virtual bool Supports(IkParameterizationType iktype) const OPENRAVE_DUMMY_IMPLEMENTATION;
 
@@ -40,6 +40,43 @@ enum SerializationOptions
     SO_JointLimits = 0x100 ///< information of joint limits including velocity, acceleration, jerk, torque and inertia limits
 };
 
+/// \brief a performance counter of an interface that can be queried at runtime, see \ref InterfaceBase::GetPerfCounters. <b>[multi-thread safe]</b>
+///
+/// Every sample increments the count and adds its value to the total. When the values are durations in nanoseconds, the
+/// average duration of a sample is the total divided by the count.
+class PerfCounter
+{
+public:
+    PerfCounter() : _count(0), _total(0) {
+    }
+
+    /// \brief adds one sample
+    inline void Add(uint64_t value=0) {
+        _count.fetch_add(1, std::memory_order_relaxed);
+        if( value != 0 ) {
+            _total.fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    inline uint64_t GetCount() const {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    inline uint64_t GetTotal() const {
+        return _total.load(std::memory_order_relaxed);
+    }
+
+    inline void Reset() {
+        _count.store(0, std::memory_order_relaxed);
+        _total.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _count, _total;
+};
+
+typedef boost::shared_ptr<PerfCounter> PerfCounterPtr;
+
 /** \brief <b>[interface]</b> Base class for all interfaces that OpenRAVE provides. See \ref interface_concepts.
     \ingroup interfaces
  */
@@ -198,6 +235,16 @@ public:
      */
     virtual void Serialize(BaseXMLWriterPtr writer, int options=0) const;
 
+    /** \brief returns the performance counters of the interface by name. <b>[multi-thread safe]</b>
+
+        The counters are also returned by the '\b GetPerfCounters' command as one line of "name count total" per counter,
+        and by the '\b GetPerfCounters' JSON command. The '\b ResetPerfCounters' command resets them.
+     */
+    virtual void GetPerfCounters(std::map<std::string, PerfCounterPtr>& mapcounters) const;
+
+    /// \brief sets the count and total of all the performance counters to 0. <b>[multi-thread safe]</b>
+    virtual void ResetPerfCounters();
+
 protected:
     /// \brief The function to be executed for every command.
     ///
@@ -255,6 +302,11 @@ public:
     /// \brief Unregisters the command. <b>[multi-thread safe]</b>
     virtual void UnregisterJSONCommand(const std::string& cmdname);
 
+    /// \brief returns the performance counter of the name, it is created if it does not exist yet. <b>[multi-thread safe]</b>
+    ///
+    /// The interface should keep the returned pointer so that adding samples does not need a lookup.
+    virtual PerfCounterPtr RegisterPerfCounter(const std::string& name);
+
     virtual const char* GetHash() const = 0;
     std::string __description;     /// \see GetDescription()
     std::string __struri; ///< \see GetURI
@@ -270,6 +322,10 @@ private:
     /// Write the help commands to an output stream
     virtual void _GetJSONCommandHelp(const rapidjson::Value& input, rapidjson::Value& output, rapidjson::Document::AllocatorType& allocator) const;
 
+    bool _GetPerfCountersCommand(std::ostream& sout, std::istream& sinput) const;
+    void _GetPerfCountersJSONCommand(const rapidjson::Value& input, rapidjson::Value& output, rapidjson::Document::AllocatorType& allocator) const;
+    bool _ResetPerfCountersCommand(std::ostream& sout, std::istream& sinput);
+
     inline InterfaceBase& operator=(const InterfaceBase&r) {
         throw openrave_exception("InterfaceBase copying not allowed");
     }
@@ -288,6 +344,8 @@ private:
 
     typedef std::map<std::string, boost::shared_ptr<InterfaceJSONCommand>, CaseInsensitiveCompare> JSONCMDMAP;
     JSONCMDMAP __mapJSONCommands; ///< all registered commands
+
+    std::map<std::string, PerfCounterPtr> __mapPerfCounters; ///< \see RegisterPerfCounter
     
 #ifdef RAVE_PRIVATE
 #ifdef _MSC_VER
@@ -36,6 +36,7 @@ enum GeometryType {
     GT_TriMesh = 4,
     GT_Container=5, ///< a container shaped geometry that has inner and outer extents. container opens on +Z. The origin is at the bottom of the base.
     GT_Cage=6, ///< a container shaped geometry with removable side walls. The side walls can be on any of the four sides. The origin is at the bottom of the base. The inner volume of the cage is measured from the base to the highest wall.
+    GT_Voxels=7, ///< an occupancy grid of cubes whose edge length is the first value of _vGeomData. Voxel (i,j,k) spans [i,i+1)*resolution along x, and similarly for y and z.
 };
 
 /// \brief holds parameters for an electric motor
@@ -154,6 +155,24 @@ public:
         inline const Vector& GetBoxExtents() const {
             return _vGeomData;
         }
+        inline dReal GetVoxelResolution() const {
+            return _vGeomData.x;
+        }
+
+        /// \brief fills the centers of the occupied voxels of a GT_Voxels geometry in the geometry coordinate system
+        void GetVoxelCenters(std::vector<Vector>& vcenters) const;
+
+        /// \brief marks the voxels containing the points as occupied. Does not update the collision mesh.
+        ///
+        /// \param vpoints points in the geometry coordinate system
+        /// \return the number of voxels that were not occupied before
+        int InsertVoxelPoints(const std::vector<Vector>& vpoints);
+
+        /// \brief marks the voxels containing the points as free. Does not update the collision mesh.
+        ///
+        /// \param vpoints points in the geometry coordinate system
+        /// \return the number of voxels that were occupied before
+        int ClearVoxelPoints(const std::vector<Vector>& vpoints);
 
         /// \brief compute the inner empty volume in the geometry coordinate system
         ///
@@ -202,6 +221,9 @@ public:
         };
         std::vector<SideWall> _vSideWalls; ///< used by GT_Cage
 
+        /// \brief for GT_Voxels, the occupied voxels. Each key packs the (i,j,k) voxel indices offset by 2^20 into 21 bits each, starting from the lowest bits with i.
+        std::set<uint64_t> _setVoxels;
+
         ///< for sphere it is radius
         ///< for cylinder, first 2 values are radius and height
         ///< for trimesh, none
@@ -402,6 +424,29 @@ public:
             virtual bool ComputeInnerEmptyVolume(Transform& tInnerEmptyVolume, Vector& abInnerEmptyExtents) const;
             //@}
 
+            /// voxels
+            //@{
+            inline dReal GetVoxelResolution() const {
+                return _info._vGeomData.x;
+            }
+
+            /// \brief marks the voxels containing the points as occupied. If any changed, updates the collision mesh and notifies every registered callback about it.
+            ///
+            /// Sensed points can be added every frame, only the voxels that change cost anything.
+            /// \param vpoints points in the link coordinate system
+            /// \return the number of voxels that became occupied
+            virtual int InsertVoxelPoints(const std::vector<Vector>& vpoints);
+
+            /// \brief marks the voxels containing the points as free. If any changed, updates the collision mesh and notifies every registered callback about it.
+            ///
+            /// \param vpoints points in the link coordinate system
+            /// \return the number of voxels that became free
+            virtual int ClearVoxelPoints(const std::vector<Vector>& vpoints);
+
+            /// \brief marks all voxels as free
+            virtual void ClearVoxels();
+            //@}
+
             virtual bool InitCollisionMesh(float fTessellation=1);
 
             /// \brief returns an axis aligned bounding box given that the geometry is transformed by trans
@@ -513,9 +558,13 @@ protected:
         }
 
         /// \brief Compute the aabb of all the geometries of the link in the link coordinate system
+        ///
+        /// The result is cached until the geometries change.
         virtual AABB ComputeLocalAABB() const;
 
         /// \brief Compute the aabb of all the geometries of the link in the world coordinate system
+        ///
+        /// The result is cached until the geometries change or the link moves, so querying a static link again is cheap.
         virtual AABB ComputeAABB() const;
 
         /// \brief returns an axis-aligned bounding box when link has transform tLink.
@@ -524,6 +573,14 @@ protected:
         /// \brief tLink the world transform to put this link in when computing the AABB
         virtual AABB ComputeAABBFromTransform(const Transform& tLink) const;
 
+        /// \brief computes spheres in the link coordinate system that together contain all the geometries of the link
+        ///
+        /// Boxes and cylinders are cut into pieces along their longest axis and the triangles of the meshes are clustered by position, one sphere bounds each cluster.
+        /// \param vspheres filled with the center and radius of every sphere
+        /// \param nMaxSpheres the maximum number of spheres to return
+        /// \param groupname if not empty and the link has the geometry group, uses its geometries instead of the current ones
+        virtual void ComputeBoundingSpheres(std::vector< std::pair<Vector, dReal> >& vspheres, int nMaxSpheres=8, const std::string& groupname=std::string()) const;
+
         /// \brief Return the current transformation of the link in the world coordinate system.
         inline Transform GetTransform() const {
             return _info._t;
@@ -652,12 +709,15 @@ protected:
 
         /// \brief initializes the link with geometries from the extra geomeries in LinkInfo
         ///
+        /// Trimesh geometries of the group that only reference a file are loaded first, see GetGeometriesFromGroup.
         /// \param name The name of the geometry group. If name is empty, will initialize the default geometries.
         /// \throw If name does not exist in GetInfo()._mapExtraGeometries, then throw an exception.
         virtual void SetGeometriesFromGroup(const std::string& name);
 
         /// \brief returns a const reference to the vector of geometries for a particular group
         ///
+        /// Geometry groups read from files can be lazy: their trimesh geometries only store the file name and are loaded
+        /// the first time the group is requested, so bodies that never use the group do not pay for its meshes.
         /// \param name The name of the geometry group.
         /// \throw openrave_exception If the group does not exist, throws an exception.
         virtual const std::vector<KinBody::GeometryInfoPtr>& GetGeometriesFromGroup(const std::string& name) const;
@@ -748,6 +808,9 @@ protected:
         /// \param parameterschanged if true, will
         virtual void _Update(bool parameterschanged=true, uint32_t extraParametersChanged=0);
 
+        /// \brief loads the meshes of trimesh geometries that only reference a file, the infos of the group are updated so it happens once
+        void _LoadGroupGeometryMeshes(const std::vector<KinBody::GeometryInfoPtr>& vgeometryinfos) const;
+
         std::vector<GeometryPtr> _vGeometries;         ///< \see GetGeometries
 
         LinkInfo _info; ///< parameter information of the link
@@ -763,6 +826,16 @@ private:
         TriMesh _collision; ///< triangles for collision checking, triangles are always the triangulation
                             ///< of the body when it is at the identity transformation
         //@}
+
+        /// \brief invalidates the cached aabbs, has to be called whenever the geometries change
+        inline void _InvalidateAABBCache() {
+            _nAABBCacheFlags = 0;
+        }
+
+        mutable AABB _abLocalCache; ///< cached ComputeLocalAABB, valid if _nAABBCacheFlags&1
+        mutable AABB _abWorldCache; ///< cached ComputeAABB when the link transform was _tWorldAABBCache, valid if _nAABBCacheFlags&2
+        mutable Transform _tWorldAABBCache;
+        mutable uint8_t _nAABBCacheFlags;
 #ifdef RAVE_PRIVATE
 #ifdef _MSC_VER
         friend class OpenRAVEXMLParser::LinkXMLReader;
@@ -855,12 +928,46 @@ public:
             }
         };
 
+        /// \brief an equation reduced to an affine function of the values or to a polynomial of a single value, so it can be evaluated without the function parser
+        ///
+        /// Set by SetMimicEquations only when the equation uses nothing but arithmetic and the coefficients reproduce the function parser at test values.
+        struct SpecializedEquation
+        {
+            SpecializedEquation() : variableindex(-1) {
+            }
+
+            inline bool IsValid() const {
+                return coeffs.size() > 0;
+            }
+
+            /// \brief evaluates the equation, only call when IsValid
+            inline dReal Eval(const dReal* pvalues) const {
+                if( variableindex < 0 ) {
+                    dReal f = coeffs[0];
+                    for(size_t i = 1; i < coeffs.size(); ++i) {
+                        f += coeffs[i]*pvalues[i-1];
+                    }
+                    return f;
+                }
+                dReal x = pvalues[variableindex], f = 0;
+                for(size_t i = coeffs.size(); i > 0; --i) {
+                    f = f*x + coeffs[i-1];
+                }
+                return f;
+            }
+
+            std::vector<dReal> coeffs; ///< for an affine equation the constant followed by the coefficient of every value, for a polynomial the coefficients of increasing powers
+            int variableindex; ///< -1 for an affine equation, otherwise the index of the value the polynomial is of
+        };
+
         /// @name automatically set
         //@{
         std::vector< DOFFormat > _vdofformat;         ///< the format of the values the equation takes order is important.
         std::vector<DOFHierarchy> _vmimicdofs;         ///< all dof indices that the equations depends on. DOFHierarchy::dofindex can repeat
         OpenRAVEFunctionParserRealPtr _posfn;
         std::vector<OpenRAVEFunctionParserRealPtr > _velfns, _accelfns;         ///< the velocity and acceleration partial derivatives with respect to each of the values in _vdofformat
+        SpecializedEquation _posspecialized; ///< used instead of _posfn when valid
+        std::vector<SpecializedEquation> _velspecialized, _accelspecialized; ///< used instead of _velfns and _accelfns when valid, same size as them
         //@}
     };
     typedef boost::shared_ptr<Mimic> MimicPtr;
@@ -1648,6 +1755,10 @@ protected:
         std::vector<dReal> _vdoflastsetvalues;
         std::vector<dReal> _vMaxVelocities, _vMaxAccelerations, _vMaxJerks, _vDOFWeights, _vDOFLimits[2];
         std::vector<UserDataPtr> _vGrabbedBodies;
+        std::vector<dReal> _vSavedDOFValues; ///< if _bSavedDOFValues, the link transformations are restored by setting these dof values and _tSavedBase
+        Transform _tSavedBase;
+        int _nSavedUpdateStamp; ///< update stamp of the body when saved, if the body still has it the link transformations do not have to be restored
+        bool _bSavedDOFValues; ///< true if the link transformations were computed by the last SetDOFValues, so only the dof values are saved
         bool _bRestoreOnDestructor;
 private:
         virtual void _RestoreKinBody(boost::shared_ptr<KinBody> body);
@@ -1694,6 +1805,10 @@ protected:
         std::vector<dReal> _vdoflastsetvalues;
         std::vector<dReal> _vMaxVelocities, _vMaxAccelerations, _vMaxJerks, _vDOFWeights, _vDOFLimits[2];
         std::vector<UserDataPtr> _vGrabbedBodies;
+        std::vector<dReal> _vSavedDOFValues; ///< if _bSavedDOFValues, the link transformations are restored by setting these dof values and _tSavedBase
+        Transform _tSavedBase;
+        int _nSavedUpdateStamp; ///< update stamp of the body when saved, if the body still has it the link transformations do not have to be restored
+        bool _bSavedDOFValues; ///< true if the link transformations were computed by the last SetDOFValues, so only the dof values are saved
         bool _bRestoreOnDestructor;
         bool _bReleased; ///< if true, then body should not be restored
 private:
@@ -1702,6 +1817,23 @@ private:
 
     typedef boost::shared_ptr<KinBodyStateSaverRef> KinBodyStateSaverRefPtr;
 
+    /// \brief Helper class that delays the change callbacks of a body until it goes out of scope.
+    ///
+    /// Loops that set the dof values or transforms of a body many times would otherwise notify the listeners of every change. While the
+    /// batch exists, the changed properties are accumulated and every registered callback is called once for them on destruction.
+    /// Batches can be nested, the callbacks are called when the outermost one is destroyed. Listeners are not notified
+    /// inside the batch, so it should not contain queries that depend on them, like the configuration cache. Prop_BodyRemoved is never delayed.
+    class OPENRAVE_API ChangeCallbackBatch
+    {
+public:
+        ChangeCallbackBatch(KinBodyPtr pbody);
+        virtual ~ChangeCallbackBatch();
+protected:
+        KinBodyPtr _pbody;
+    };
+
+    typedef boost::shared_ptr<ChangeCallbackBatch> ChangeCallbackBatchPtr;
+
     virtual ~KinBody();
 
     /// return the static interface type this class points to (used for safe casting)
@@ -1770,6 +1902,12 @@ private:
     /// This method is faster than Link::SetGeometriesFromGroup since it makes only one change callback.
     virtual void SetLinkGroupGeometries(const std::string& name, const std::vector< std::vector<KinBody::GeometryInfoPtr> >& linkgeometries);
 
+    /// \brief stores a geometry group of GT_Sphere geometries that contain the current geometries of every link, see \ref Link::ComputeBoundingSpheres
+    ///
+    /// The group gives a conservative coarse model for collision checking, for example with \ref CollisionCheckerBase::SetGeometryGroup.
+    /// \param name The name of the extra geometries group to be stored in each link.
+    virtual void InitBoundingSphereGeometryGroup(const std::string& name, int nMaxSpheres=8);
+
     /// \brief Unique name of the body.
     virtual const std::string& GetName() const {
         return _name;
@@ -1792,6 +1930,17 @@ private:
     /// \param dofindices the dof indices to return the values for. If empty, will compute for all the dofs
     virtual void GetDOFValues(std::vector<dReal>& v, const std::vector<int>& dofindices = std::vector<int>()) const;
 
+    /// \brief Returns the joint values into an array without allocating memory.
+    ///
+    /// \param[out] pvalues has to hold dofindices.size() values, or GetDOF() values if dofindices is empty
+    /// \param dofindices the dof indices to return the values for. If empty, will compute for all the dofs
+    virtual void GetDOFValues(dReal* pvalues, const std::vector<int>& dofindices = std::vector<int>()) const;
+
+    /// \brief Returns all the joint values from an internal array, which is only filled again when \ref GetUpdateStamp changed.
+    ///
+    /// \return pointer to GetDOF() values valid until the links move or are changed
+    virtual const dReal* GetDOFValuesArray() const;
+
     /// \brief Returns all the joint velocities as organized by the DOF indices.
     ///
     /// \param dofindices the dof indices to return the values for. If empty, will compute for all the dofs
@@ -2001,11 +2150,21 @@ private:
     /// \brief get the transformations of all the links at once
     virtual void GetLinkTransformations(std::vector<Transform>& transforms) const;
 
+    /// \brief get the transformations of all the links at once into an array of GetLinks().size() transforms
+    virtual void GetLinkTransformations(Transform* ptransforms) const;
+
     /// \brief get the transformations of all the links and the dof branches at once.
     ///
     /// Knowing the dof branches allows the robot to recover the full state of the joints with SetLinkTransformations
     virtual void GetLinkTransformations(std::vector<Transform>& transforms, std::vector<dReal>& doflastsetvalues) const;
 
+    /// \brief get the transformations of all the links as a structure of arrays.
+    ///
+    /// The array holds 7 consecutive arrays of GetLinks().size() values each: rot.x, rot.y, rot.z, rot.w of the quaternions (so w first) followed by trans.x, trans.y, trans.z.
+    /// It is only filled again when \ref GetUpdateStamp changed, so many readers of the same state touch the links only once.
+    /// \return pointer valid until the links move or are changed
+    virtual const dReal* GetLinkTransformationsArrays() const;
+
     /// \brief gets the enable states of all links
     virtual void GetLinkEnableStates(std::vector<uint8_t>& enablestates) const;
 
@@ -2117,6 +2276,15 @@ private:
     /// \param dofindices the dof indices to return the values for. If empty, will compute for all the dofs
     virtual void SetDOFValues(const std::vector<dReal>& values, uint32_t checklimits = CLA_CheckLimits, const std::vector<int>& dofindices = std::vector<int>());
 
+    /// \brief Sets the joint values of the robot from an array.
+    ///
+    /// Once the internal buffers are allocated by the first call, no memory is allocated for bodies without mimic joints.
+    /// \param pvalues the values to set the joint angles (ordered by the dof indices)
+    /// \param dof the number of values in pvalues
+    /// \param[in] checklimits one of \ref CheckLimitsAction and will excplicitly check the joint limits before setting the values and clamp them.
+    /// \param dofindices the dof indices to set the values for. If empty, will set all the dofs
+    virtual void SetDOFValues(const dReal* pvalues, size_t dof, uint32_t checklimits = CLA_CheckLimits, const std::vector<int>& dofindices = std::vector<int>());
+
     virtual void SetJointValues(const std::vector<dReal>& values, bool checklimits = true) {
         SetDOFValues(values,static_cast<uint32_t>(checklimits));
     }
@@ -2128,11 +2296,45 @@ private:
     /// \param[in] checklimits one of \ref CheckLimitsAction and will excplicitly check the joint limits before setting the values and clamp them.
     virtual void SetDOFValues(const std::vector<dReal>& values, const Transform& transform, uint32_t checklimits = CLA_CheckLimits);
 
+    /// \brief Sets the joint values and transformation of the body from an array.
+    ///
+    /// \param pvalues the values to set the joint angles (ordered by the dof indices)
+    /// \param dof the number of values in pvalues, has to be at least \ref GetDOF
+    /// \param transform represents the transformation of the first body.
+    /// \param[in] checklimits one of \ref CheckLimitsAction and will excplicitly check the joint limits before setting the values and clamp them.
+    virtual void SetDOFValues(const dReal* pvalues, size_t dof, const Transform& transform, uint32_t checklimits = CLA_CheckLimits);
+
     virtual void SetJointValues(const std::vector<dReal>& values, const Transform& transform, bool checklimits = true)
     {
         SetDOFValues(values,transform,static_cast<uint32_t>(checklimits));
     }
 
+    /// \brief forward kinematics code generated for one kinematics structure, see python/fkfast.py and the AddFkLibrary command of the ikfast module.
+    struct ForwardKinematicsFunctions
+    {
+        typedef void (*ComputeLinkPosesFn)(const dReal* pdofvalues, dReal* plinkposes);
+
+        ForwardKinematicsFunctions() : numdofs(0), numlinks(0), computelinkposes(NULL) {
+        }
+
+        std::string kinematicshash; ///< \ref GetKinematicsGeometryHash of the body the code was generated for
+        int numdofs, numlinks;
+        ComputeLinkPosesFn computelinkposes; ///< computes the poses of all the links relative to the base link from all the dof values, 7 values per link: quaternion (w,x,y,z) followed by the translation
+        boost::shared_ptr<void> plibrary; ///< keeps the shared object holding the code loaded
+    };
+    typedef boost::shared_ptr<ForwardKinematicsFunctions const> ForwardKinematicsFunctionsConstPtr;
+
+    /// \brief Makes \ref SetDOFValues compute the link transformations with generated code.
+    ///
+    /// The functions are only used for bodies without mimic joints and whose passive joints are static. They are cleared when the kinematics of the body changes.
+    /// \param pfunctions the functions, if empty uses the generic forward kinematics again
+    /// \return false if the functions were not generated for the current kinematics of the body
+    virtual bool SetForwardKinematicsFunctions(ForwardKinematicsFunctionsConstPtr pfunctions);
+
+    virtual ForwardKinematicsFunctionsConstPtr GetForwardKinematicsFunctions() const {
+        return _pForwardKinematicsFunctions;
+    }
+
     /// \brief sets the transformations of all the links at once
     virtual void SetLinkTransformations(const std::vector<Transform>& transforms);
 
@@ -2157,6 +2359,11 @@ private:
     /// \param dofindices the dof indices to compute the jacobian for. If empty, will compute for all the dofs
     virtual void ComputeJacobianTranslation(int linkindex, const Vector& position, std::vector<dReal>& jacobian, const std::vector<int>& dofindices=std::vector<int>()) const;
 
+    /// \brief Computes the translation jacobian into an array without allocating memory for bodies without mimic joints.
+    ///
+    /// \param[out] pjacobian 3xN matrix, where N is dofindices.size() or GetDOF() if dofindices is empty
+    virtual void ComputeJacobianTranslation(int linkindex, const Vector& position, dReal* pjacobian, const std::vector<int>& dofindices=std::vector<int>()) const;
+
     /// \brief calls std::vector version of ComputeJacobian internally
     virtual void CalculateJacobian(int linkindex, const Vector& position, std::vector<dReal>& jacobian) const {
         ComputeJacobianTranslation(linkindex,position,jacobian);
@@ -2181,6 +2388,15 @@ private:
     /// \param vjacobian 3xDOF matrix
     virtual void ComputeJacobianAxisAngle(int linkindex, std::vector<dReal>& jacobian, const std::vector<int>& dofindices=std::vector<int>()) const;
 
+    /// \brief Computes the translation and angular velocity jacobians of several positions attached to links in one pass over the joints.
+    ///
+    /// Gives the same values as calling \ref ComputeJacobianTranslation and \ref ComputeJacobianAxisAngle for every position, but the axis and anchor of every joint are computed only once.
+    /// Does not allocate memory for bodies without mimic joints once the internal buffers have grown.
+    /// \param linkpositions pairs of the index of the link and the world position attached to it
+    /// \param[out] ptranslationjacobians if not NULL, linkpositions.size() 3xDOF translation jacobians stored one after the other
+    /// \param[out] paxisanglejacobians if not NULL, linkpositions.size() 3xDOF angular velocity jacobians stored one after the other
+    virtual void ComputeJacobians(const std::vector< std::pair<int, Vector> >& linkpositions, dReal* ptranslationjacobians, dReal* paxisanglejacobians) const;
+
     /// \brief Computes the angular velocity jacobian of a specified link about the axes of world coordinates.
     virtual void CalculateAngularVelocityJacobian(int linkindex, std::vector<dReal>& jacobian) const {
         ComputeJacobianAxisAngle(linkindex,jacobian);
@@ -2236,6 +2452,21 @@ private:
      */
     virtual void ComputeHessianAxisAngle(int linkindex, std::vector<dReal>& hessian, const std::vector<int>& dofindices=std::vector<int>()) const;
 
+    /** \brief Computes the jacobians and hessians of several positions attached to links in one pass over the joints.
+
+        Gives the jacobians of \ref ComputeJacobians and the hessians of \ref ComputeHessianTranslation and \ref ComputeHessianAxisAngle over all the dofs, but the axis and anchor of every joint are computed once for all the positions.
+        The hessian of position ipos is H[ipos,i,j,k] = phessians[k+DOF*(j+3*(i+DOF*ipos))].
+
+        \param linkpositions pairs of the index of the link and the world position attached to it
+        \param[out] ptranslationjacobians if not NULL, linkpositions.size() 3xDOF translation jacobians stored one after the other
+        \param[out] paxisanglejacobians if not NULL, linkpositions.size() 3xDOF angular velocity jacobians stored one after the other
+        \param[out] ptranslationhessians if not NULL, linkpositions.size() DOFx3xDOF translation hessians stored one after the other
+        \param[out] paxisanglehessians if not NULL, linkpositions.size() DOFx3xDOF axis-angle hessians stored one after the other
+        \param[out] pvdofsinchain if not NULL, filled with linkpositions.size() rows of DOF values that are 1 for the dofs moving the position.
+        In that case only the jacobian columns and hessian blocks of these dofs are written, the others are zero but left untouched in the buffers.
+     */
+    virtual void ComputeJacobiansAndHessians(const std::vector< std::pair<int, Vector> >& linkpositions, dReal* ptranslationjacobians, dReal* paxisanglejacobians, dReal* ptranslationhessians, dReal* paxisanglehessians, std::vector<uint8_t>* pvdofsinchain=NULL) const;
+
     /// \brief link index and the linear forces and torques. Value.first is linear force acting on the link's COM and Value.second is torque
     typedef std::map<int, std::pair<Vector,Vector> > ForceTorqueMap;
 
@@ -2269,6 +2500,18 @@ private:
      */
     virtual void ComputeInverseDynamics(boost::array< std::vector<dReal>, 3>& doftorquecomponents, const std::vector<dReal>& dofaccelerations, const ForceTorqueMap& externalforcetorque=ForceTorqueMap()) const;
 
+    /** \brief Computes the inverse dynamics (torques) of a sequence of states, for example all the samples of a trajectory.
+
+        For every sample, sets the dof values and velocities of the body and computes the torques like \ref ComputeInverseDynamics, reusing the same buffers for all the samples.
+        The body is left in the state of the last sample, so callers that need the current state should save it with a KinBodyStateSaver using Save_LinkTransformation|Save_LinkVelocities.
+        \param[out] doftorques numsamples*GetDOF() torques, the torques of every sample are contiguous
+        \param[in] dofvalues numsamples*GetDOF() dof values
+        \param[in] dofvelocities numsamples*GetDOF() dof velocities
+        \param[in] dofaccelerations numsamples*GetDOF() dof accelerations. If the size is 0, assumes all accelerations are 0
+        \param[in] externalforcetorque [optional] Specifies the external forces/torques acting on the links at their center of mass for all the samples.
+     */
+    virtual void ComputeInverseDynamicsSamples(std::vector<dReal>& doftorques, const std::vector<dReal>& dofvalues, const std::vector<dReal>& dofvelocities, const std::vector<dReal>& dofaccelerations, const ForceTorqueMap& externalforcetorque=ForceTorqueMap());
+
     /// \brief sets a self-collision checker to be used whenever \ref CheckSelfCollision is called
     ///
     /// This function allows self-collisions to use a different, un-padded geometry for self-collisions
@@ -2386,6 +2629,17 @@ private:
     /// \brief adds the pair of links to the adjacency list. This is
     virtual void SetAdjacentLinks(int linkindex0, int linkindex1);
 
+    /// \brief Sets the pairs of links that cannot collide in any configuration within the joint limits.
+    ///
+    /// The pairs are usually sampled offline, see the linkstatistics database. They are removed from \ref GetNonAdjacentLinks, so the collision checkers never test them for self-collision.
+    /// \param linkpairs pairs of link indices in the format of \ref GetNonAdjacentLinks, index0|(index1<<16)
+    virtual void SetUnreachableLinkPairs(const std::vector<int>& linkpairs);
+
+    /// \brief return the pairs of links set by \ref SetUnreachableLinkPairs, index0|(index1<<16) with index0 < index1
+    virtual const std::set<int>& GetUnreachableLinkPairs() const {
+        return _setUnreachableLinkPairs;
+    }
+
     virtual ManageDataPtr GetManageData() const {
         return _pManageData;
     }
@@ -2410,6 +2664,11 @@ private:
     /// \param properties a mask of the \ref KinBodyProperty values that the callback should be called for when they change
     virtual UserDataPtr RegisterChangeCallback(uint32_t properties, const boost::function<void()>& callback) const;
 
+    /// \brief returns true if a \ref ChangeCallbackBatch currently delays the change callbacks of the body
+    inline bool IsBatchingChangeCallbacks() const {
+        return _nChangeCallbackBatchDepth > 0;
+    }
+
     void Serialize(BaseXMLWriterPtr writer, int options=0) const;
 
     /// \brief A md5 hash unique to the particular kinematic and geometric structure of a KinBody.
@@ -2577,9 +2836,15 @@ protected:
      */
     virtual void _ComputeInternalInformation();
 
+    /// \brief computes the topologically sorted joints, the parent and rigidly attached links, the closed loops and the adjacent links. Called by \ref _ComputeInternalInformation unless the body was cloned from an initialized body.
+    void _ComputeInternalHierarchy();
+
     /// \brief de-initializes any internal information computed
     virtual void _DeinitializeInternalInformation();
 
+    /// \brief fills vjointsinchain with linkpositions.size() rows of _vecjoints.size()+_vPassiveJoints.size() values, 1 for the joints on the path from the root to the link
+    virtual void _ComputeJointsInChains(const std::vector< std::pair<int, Vector> >& linkpositions, std::vector<uint8_t>& vjointsinchain) const;
+
     /// \brief returns the dof velocities and link velocities
     ///
     /// \param[in] usebaselinkvelocity if true, will compute all velocities using the base link velocity. otherwise will assume it is 0
@@ -2599,6 +2864,9 @@ protected:
     /// recomputes the hashes if geometry changed.
     virtual void _PostprocessChangedParameters(uint32_t parameters);
 
+    /// \brief calls the registered callbacks of the parameters, unless a \ref ChangeCallbackBatch delays them
+    void _NotifyChangeCallbacks(uint32_t parameters);
+
     /// \brief Return true if two bodies should be considered as one during collision (ie one is grabbing the other)
     virtual bool _IsAttached(const KinBody &body, std::set<KinBodyConstPtr>& setChecked) const;
 
@@ -2612,6 +2880,18 @@ protected:
 
     virtual void _UpdateGrabbedBodies();
 
+    /// \brief updates only the grabbed bodies whose grabbing link has vlinksupdated[linkindex] != 0. If vlinksupdated is empty, all grabbed bodies are updated.
+    virtual void _UpdateGrabbedBodies(const std::vector<uint8_t>& vlinksupdated);
+
+    /// \brief returns true if the link transformations are the ones computed by the last SetDOFValues, so they can be restored by setting _vLastSetDOFValues again
+    bool _IsLinkTransformationFromDOFValues() const;
+
+    /// \brief gets a buffer of a destroyed KinBodyStateSaver so that saving the state does not allocate
+    void _PopStateSaverBuffer(std::vector<dReal>& buffer);
+
+    /// \brief gives back the buffer of a KinBodyStateSaver, buffer is left empty
+    void _PushStateSaverBuffer(std::vector<dReal>& buffer);
+
     /// \brief resets cached information dependent on the collision checker (usually called when the collision checker is switched or some big mode is set.
     virtual void _ResetInternalCollisionCache();
 
@@ -2634,6 +2914,8 @@ protected:
     std::vector<int> _vTopologicallySortedJointIndicesAll; ///< the joint indices of the joints in _vTopologicallySortedJointsAll. Passive joint indices have _vecjoints.size() added to them.
     std::vector<JointPtr> _vDOFOrderedJoints; ///< all joints of the body ordered on how they are arranged within the degrees of freedom
     std::vector<LinkPtr> _veclinks; ///< \see GetLinks
+    std::map<std::string, int> _mapLinkNameIndex; ///< link name to index into _veclinks, built in _ComputeInternalInformation and validated on every GetLink
+    std::map<std::string, int> _mapJointNameIndex; ///< joint name to index into _vecjoints, passive joint indices have _vecjoints.size() added to them. validated on every GetJoint
     std::vector<int> _vDOFIndices; ///< cached start joint indices, indexed by dof indices
     std::vector<std::pair<int16_t,int16_t> > _vAllPairsShortestPaths; ///< all-pairs shortest paths through the link hierarchy. The first value describes the parent link index, and the second value is an index into _vecjoints or _vPassiveJoints. If the second value is greater or equal to  _vecjoints.size() then it indexes into _vPassiveJoints.
     std::vector<int8_t> _vJointsAffectingLinks; ///< joint x link: (jointindex*_veclinks.size()+linkindex). entry is non-zero if the joint affects the link in the forward kinematics. If negative, the partial derivative of ds/dtheta should be negated.
@@ -2651,6 +2933,7 @@ protected:
 
     mutable boost::array<std::vector<int>, 4> _vNonAdjacentLinks; ///< contains cached versions of the non-adjacent links depending on values in AdjacentOptions. Declared as mutable since data is cached.
     mutable boost::array<std::set<int>, 4> _cacheSetNonAdjacentLinks; ///< used for caching return value of GetNonAdjacentLinks.
+    std::set<int> _setUnreachableLinkPairs; ///< \see SetUnreachableLinkPairs
     mutable int _nNonAdjacentLinkCache; ///< specifies what information is currently valid in the AdjacentOptions.  Declared as mutable since data is cached. If 0x80000000 (ie < 0), then everything needs to be recomputed including _setNonAdjacentLinks[0].
     std::vector<Transform> _vInitialLinkTransformations; ///< the initial transformations of each link specifying at least one pose where the robot is collision free
 
@@ -2660,6 +2943,8 @@ protected:
     int _environmentid; ///< \see GetEnvironmentId
     mutable int _nUpdateStampId; ///< \see GetUpdateStamp
     uint32_t _nParametersChanged; ///< set of parameters that changed and need callbacks
+    int _nChangeCallbackBatchDepth; ///< number of alive \ref ChangeCallbackBatch of the body
+    uint32_t _nBatchedParametersChanged; ///< parameters that changed while _nChangeCallbackBatchDepth > 0, their callbacks are called when the last batch is destroyed
     ManageDataPtr _pManageData;
     uint32_t _nHierarchyComputed; ///< 2 if the joint heirarchy and other cached information is computed. 1 if the hierarchy information is computing
     bool _bMakeJoinedLinksAdjacent; ///< if true, then automatically add adjacent links to the adjacency list so that their self-collisions are ignored.
@@ -2667,6 +2952,43 @@ protected:
 private:
     mutable std::string __hashkinematics;
     mutable std::vector<dReal> _vTempJoints;
+    std::vector<dReal> _vLastSetDOFValues; ///< the dof values set by the last SetDOFValues after the limits were applied. Used to only compute the links of the joints that changed.
+    int _nCloneUpdateStamp; ///< _nUpdateStampId at the end of Clone if the reference was initialized, otherwise -1. While it matches, _ComputeInternalInformation keeps the copied hierarchy and non-adjacent links.
+    int _nLastSetDOFValuesStamp; ///< _nUpdateStampId at the end of the last SetDOFValues. If _nUpdateStampId is different, the links could have been moved by something else so _vLastSetDOFValues cannot be used.
+    std::vector<uint8_t> _vLinksUpdatedCache; ///< cache for SetDOFValues, 1 for every link whose transform was computed
+    std::vector<uint8_t> _vLinksComputedCache; ///< cache for SetDOFValues
+    std::vector< std::vector<dReal> > _vPassiveJointValuesCache; ///< cache for SetDOFValues
+    std::vector<dReal> _vMimicTempValues, _vMimicEvalValues, _vMimicEvalValuesCopy; ///< cache for SetDOFValues
+    mutable std::vector<dReal> _vTempJointValues; ///< cache for GetDOFValues
+    mutable std::vector<std::pair<int,dReal> > _vPartialsCache; ///< cache for ComputeJacobianTranslation
+    mutable std::vector<uint8_t> _vJointsInChainCache; ///< cache for ComputeJacobians, 1 for the joints on the path from the root to every link
+    ForwardKinematicsFunctionsConstPtr _pForwardKinematicsFunctions; ///< if set, used by SetDOFValues to compute the link transformations
+    std::vector<dReal> _vForwardKinematicsPosesCache; ///< cache for SetDOFValues, the link poses computed by _pForwardKinematicsFunctions
+    mutable std::vector<dReal> _vLinkTransformationsArraysCache; ///< \see GetLinkTransformationsArrays
+    mutable int _nLinkTransformationsArraysStamp; ///< _nUpdateStampId when _vLinkTransformationsArraysCache was filled
+    mutable std::vector<dReal> _vDOFValuesArrayCache; ///< \see GetDOFValuesArray
+    mutable int _nDOFValuesArrayStamp; ///< _nUpdateStampId when _vDOFValuesArrayCache was filled
+    std::vector< std::vector<dReal> > _vStateSaverBuffersPool; ///< buffers of destroyed KinBodyStateSaver, see _PopStateSaverBuffer
+
+    /// \brief buffers of ComputeJacobiansAndHessians
+    struct JacobianHessianCache
+    {
+        /// \brief a dof of a joint on the path to one of the positions
+        struct ChainAxis
+        {
+            Vector vaxis, vanchor;
+            int jointindex;
+            bool brevolute;
+            size_t partialsbegin, partialsend; ///< range in vpartials of the dofs moving the axis
+        };
+        std::vector<ChainAxis> vaxes; ///< topologically sorted
+        std::vector<std::pair<int,dReal> > vpartials;
+        std::vector<int> vchainaxes; ///< indices into vaxes on the path to the current position
+        std::vector<Vector> vchainjacobians; ///< translation jacobian of every axis of vchainaxes
+        std::vector<int> vchaindofs; ///< dofs moving the current position
+    };
+    mutable JacobianHessianCache _jacobianHessianCache;
+    UserDataPtr _pGrabbedCollisionCache; ///< GrabbedCollisionCache of the links of this body, filled when grabbing bodies
     virtual const char* GetHash() const {
         return OPENRAVE_KINBODY_HASH;
     }
@@ -142,12 +142,24 @@ inline const char* RaveGetSourceFilename(const char* pfilename)
     return p+1;
 }
 
+/// \brief the most verbose \ref DebugLevel that is compiled in, defaults to Level_Verbose.
+///
+/// Logging calls of a more verbose level and the IS_DEBUGLEVEL blocks testing for it are removed at compile time along with the
+/// evaluation of their arguments, regardless of \ref RaveSetDebugLevel. For example, compiling with -DOPENRAVE_LOG_COMPILE_LEVEL=3
+/// keeps the info, warning, error and fatal messages and drops all the debug and verbose ones.
+#ifndef OPENRAVE_LOG_COMPILE_LEVEL
+#define OPENRAVE_LOG_COMPILE_LEVEL 5
+#endif
+
+/// \brief true if messages of the level are compiled in and enabled by \ref RaveGetDebugLevel
+#define RAVELOG_ISENABLED(level) (int(level) <= OPENRAVE_LOG_COMPILE_LEVEL && int(OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=int(level))
+
 #define RAVEPRINTHEADER(LEVEL) OpenRAVE::RavePrintfA ## LEVEL("[%s:%d %s] ", OpenRAVE::RaveGetSourceFilename(__FILE__), __LINE__,  __FUNCTION__)
 
 // different logging levels. The higher the suffix number, the less important the information is.
 // 0 log level logs all the time. OpenRAVE starts up with a log level of 0.
-#define RAVELOG_LEVELW(LEVEL,level,...) do { if (int(OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=int(level)) { RAVEPRINTHEADER(LEVEL); OpenRAVE::RavePrintfW ## LEVEL(__VA_ARGS__); } } while (0)
-#define RAVELOG_LEVELA(LEVEL,level,...) do { if (int(OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=int(level)) { RAVEPRINTHEADER(LEVEL); OpenRAVE::RavePrintfA ## LEVEL(__VA_ARGS__); } } while (0)
+#define RAVELOG_LEVELW(LEVEL,level,...) do { if( RAVELOG_ISENABLED(level) ) { RAVEPRINTHEADER(LEVEL); OpenRAVE::RavePrintfW ## LEVEL(__VA_ARGS__); } } while (0)
+#define RAVELOG_LEVELA(LEVEL,level,...) do { if( RAVELOG_ISENABLED(level) ) { RAVEPRINTHEADER(LEVEL); OpenRAVE::RavePrintfA ## LEVEL(__VA_ARGS__); } } while (0)
 
 
 #if OPENRAVE_LOG4CXX
@@ -309,9 +321,9 @@ inline int RavePrintfA(const std::string& s, uint32_t level)
     return 0;
 }
 
-#define RAVELOG_LOGGER_LEVELW(logger, LEVEL, level, ...) do { if (int(OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=int(level)) { OpenRAVE::RavePrintfW ## LEVEL(logger, LOG4CXX_LOCATION, __VA_ARGS__); } } while (0)
+#define RAVELOG_LOGGER_LEVELW(logger, LEVEL, level, ...) do { if( RAVELOG_ISENABLED(level) ) { OpenRAVE::RavePrintfW ## LEVEL(logger, LOG4CXX_LOCATION, __VA_ARGS__); } } while (0)
 
-#define RAVELOG_LOGGER_LEVELA(logger, LEVEL, level, ...) do { if (int(OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=int(level)) { OpenRAVE::RavePrintfA ## LEVEL(logger, LOG4CXX_LOCATION, __VA_ARGS__); } } while (0)
+#define RAVELOG_LOGGER_LEVELA(logger, LEVEL, level, ...) do { if( RAVELOG_ISENABLED(level) ) { OpenRAVE::RavePrintfA ## LEVEL(logger, LOG4CXX_LOCATION, __VA_ARGS__); } } while (0)
 
 #undef RAVELOG_LEVELW
 #define RAVELOG_LEVELW(LEVEL, level, ...) RAVELOG_LOGGER_LEVELW(OpenRAVE::RaveGetLogger(), LEVEL, level, __VA_ARGS__)
@@ -506,6 +518,7 @@ DefineRavePrintfA(_VERBOSELEVEL)
 #define RAVELOG_VERBOSEA(...) RAVELOG_LEVELA(_VERBOSELEVEL,OpenRAVE::Level_Verbose,__VA_ARGS__)
 #define RAVELOG_VERBOSE RAVELOG_VERBOSEA
 
+// the parameters of the _FORMAT and _STREAM versions are only evaluated if the level is enabled, so they can be used in hot paths
 #define RAVELOG_FATAL_FORMAT(x, params) RAVELOG_FATAL(boost::str(boost::format(x)%params))
 #define RAVELOG_ERROR_FORMAT(x, params) RAVELOG_ERROR(boost::str(boost::format(x)%params))
 #define RAVELOG_WARN_FORMAT(x, params) RAVELOG_WARN(boost::str(boost::format(x)%params))
@@ -513,7 +526,18 @@ DefineRavePrintfA(_VERBOSELEVEL)
 #define RAVELOG_DEBUG_FORMAT(x, params) RAVELOG_DEBUG(boost::str(boost::format(x)%params))
 #define RAVELOG_VERBOSE_FORMAT(x, params) RAVELOG_VERBOSE(boost::str(boost::format(x)%params))
 
-#define IS_DEBUGLEVEL(level) ((OpenRAVE::RaveGetDebugLevel()&OpenRAVE::Level_OutputMask)>=(level))
+/// \brief logs everything streamed into x, for example RAVELOG_DEBUG_STREAM("values=" << v[0] << ", " << v[1]);
+#define RAVELOG_LEVEL_STREAM(LOGMACRO, level, x) do { if( RAVELOG_ISENABLED(level) ) { std::stringstream _ravelogss; _ravelogss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1) << x; LOGMACRO(_ravelogss.str()); } } while (0)
+
+#define RAVELOG_FATAL_STREAM(x) RAVELOG_LEVEL_STREAM(RAVELOG_FATAL, OpenRAVE::Level_Fatal, x)
+#define RAVELOG_ERROR_STREAM(x) RAVELOG_LEVEL_STREAM(RAVELOG_ERROR, OpenRAVE::Level_Error, x)
+#define RAVELOG_WARN_STREAM(x) RAVELOG_LEVEL_STREAM(RAVELOG_WARN, OpenRAVE::Level_Warn, x)
+#define RAVELOG_INFO_STREAM(x) RAVELOG_LEVEL_STREAM(RAVELOG_INFO, OpenRAVE::Level_Info, x)
+#define RAVELOG_DEBUG_STREAM(x) RAVELOG_LEVEL_STREAM(RAVELOG_DEBUG, OpenRAVE::Level_Debug, x)
+#define RAVELOG_VERBOSE_STREAM(x) RAVELOG_LEVEL_STREAM(RAVELOG_VERBOSE, OpenRAVE::Level_Verbose, x)
+
+/// \brief true if messages of the level are logged, use it to guard building expensive log messages. Always false for levels above OPENRAVE_LOG_COMPILE_LEVEL.
+#define IS_DEBUGLEVEL(level) RAVELOG_ISENABLED(level)
 
 }
 
@@ -51,10 +51,12 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <deque>
 #include <map>
 #include <set>
 #include <string>
 #include <exception>
+#include <typeinfo>
 
 #include <iomanip>
 #include <fstream>
@@ -100,6 +102,7 @@ namespace OpenRAVE {
 #include <rapidjson/document.h>
 
 #include <openrave/logging.h>
+#include <openrave/profiling.h>
 
 namespace OpenRAVE {
 
@@ -688,6 +691,65 @@ protected:
         BaseXMLReaderPtr _preader;
     };
 
+    /** \brief A conversion of data from one configuration specification to another that is computed once and applied many times.
+
+        Resolving and matching the groups of the specifications is done when the converter is initialized, converting
+        only copies the values, so it is much faster than \ref ConvertData when the same specifications are converted many times.
+        The default values of the target data that is not in the source are taken from the environment when the converter
+        is initialized. If \ref HasEnvironmentDefaults is true, the converter has to be initialized again when the environment changes.
+     */
+    class OPENRAVE_API Converter
+    {
+public:
+        Converter();
+        /// \brief see \ref Init
+        Converter(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, EnvironmentBaseConstPtr penv, bool filluninitialized = true);
+
+        /// \brief computes the conversion from sourcespec to targetspec. Same parameters as \ref ConvertData
+        /// \throw openrave_exception throw if groups are incompatible
+        void Init(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, EnvironmentBaseConstPtr penv, bool filluninitialized = true);
+
+        /// \brief converts numpoints points of the source specification to the target specification
+        void Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints) const;
+
+        /// \brief true if the converter was initialized
+        inline bool IsInitialized() const {
+            return _bInit;
+        }
+
+        /// \brief true if some default values were read from the environment, so they might not be up to date anymore
+        inline bool HasEnvironmentDefaults() const {
+            return _bEnvironmentDefaults;
+        }
+
+protected:
+        /// \brief values that are copied contiguously from the source, or from _vfillvalues for the default values
+        struct CopyRun
+        {
+            int targetoffset, sourceoffset, dof;
+        };
+
+        /// \brief a rotation that needs to be converted to a different representation
+        struct RotationConversion
+        {
+            int targetoffset, sourceoffset;
+            boost::function< void(std::vector<dReal>::iterator, std::vector<dReal>::const_iterator) > converterfn;
+        };
+
+        void _Reset(size_t targetstride, size_t sourcestride);
+        void _AddGroup(int targetoffset, const Group& gtarget, int sourceoffset, const Group& gsource, EnvironmentBaseConstPtr penv, bool filluninitialized);
+        void _AddCopy(int targetindex, int sourceindex);
+        void _AddFill(int targetindex, dReal value);
+
+        std::vector<CopyRun> _vcopyruns, _vfillruns;
+        std::vector<dReal> _vfillvalues;
+        std::vector<RotationConversion> _vrotationconversions;
+        size_t _targetstride, _sourcestride;
+        bool _bInit, _bEnvironmentDefaults;
+
+        friend class ConfigurationSpecification;
+    };
+
     ConfigurationSpecification();
     ConfigurationSpecification(const Group& g);
     ConfigurationSpecification(const ConfigurationSpecification& c);
@@ -979,6 +1041,7 @@ protected:
         \param numpoints the number of points to convert. The target and source strides are gtarget.dof and gsource.dof
         \param penv [optional] The environment which might be needed to fill in unknown data. Assumes environment is locked.
         \param filluninitialized If there exists target groups that cannot be initialized, then will set default values using the current environment. For example, the current joint values of the body will be used.
+        When the same specifications are converted many times, use a \ref Converter instead.
      */
     static void ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification& targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification& sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized = true);
 
@@ -2308,6 +2371,67 @@ public:
 OPENRAVE_API std::ostream& operator<<(std::ostream& O, const TriMesh& trimesh);
 OPENRAVE_API std::istream& operator>>(std::istream& I, TriMesh& trimesh);
 
+/** \brief Read-only triangle mesh stored with float xyz vertices and 16 or 32-bit indices.
+
+    A \ref TriMesh keeps 4 dReals per vertex and 32-bit indices, which for large environment meshes is several times
+    the memory actually needed. CompactTriMesh packs the vertices as 3 floats and uses 16-bit indices whenever the
+    mesh has fewer than 65536 vertices. The buffers are immutable and reference counted, so copying a CompactTriMesh
+    shares the data instead of duplicating it.
+ */
+class OPENRAVE_API CompactTriMesh
+{
+public:
+    CompactTriMesh();
+    CompactTriMesh(const TriMesh& mesh);
+
+    /// \brief converts back to a regular \ref TriMesh, overwriting mesh
+    void GetTriMesh(TriMesh& mesh) const;
+
+    inline size_t GetNumVertices() const {
+        return !!_pvertices ? _pvertices->size()/3 : 0;
+    }
+    inline size_t GetNumIndices() const {
+        return !!_pindices16 ? _pindices16->size() : (!!_pindices32 ? _pindices32->size() : 0);
+    }
+    inline size_t GetNumTriangles() const {
+        return GetNumIndices()/3;
+    }
+
+    /// \brief returns the packed xyz vertex array of size 3*GetNumVertices(), or NULL if empty
+    inline const float* GetVertices() const {
+        return GetNumVertices() > 0 ? &(*_pvertices)[0] : NULL;
+    }
+
+    /// \brief returns the 16-bit index array if the mesh uses 16-bit indices, otherwise NULL
+    inline const uint16_t* GetIndices16() const {
+        return (!!_pindices16 && _pindices16->size() > 0) ? &(*_pindices16)[0] : NULL;
+    }
+
+    /// \brief returns the 32-bit index array if the mesh uses 32-bit indices, otherwise NULL
+    inline const uint32_t* GetIndices32() const {
+        return (!!_pindices32 && _pindices32->size() > 0) ? &(*_pindices32)[0] : NULL;
+    }
+
+    inline Vector GetVertex(size_t ivertex) const {
+        const float* p = &(*_pvertices)[3*ivertex];
+        return Vector(p[0], p[1], p[2]);
+    }
+
+    inline uint32_t GetIndex(size_t i) const {
+        return !!_pindices16 ? (uint32_t)(*_pindices16)[i] : (*_pindices32)[i];
+    }
+
+    AABB ComputeAABB() const;
+
+    /// \brief returns the number of bytes used by the vertex and index buffers
+    size_t GetMemoryUsage() const;
+
+private:
+    boost::shared_ptr<const std::vector<float> > _pvertices;
+    boost::shared_ptr<const std::vector<uint16_t> > _pindices16;
+    boost::shared_ptr<const std::vector<uint32_t> > _pindices32;
+};
+
 /// \brief Selects which DOFs of the affine transformation to include in the active configuration.
 enum DOFAffine
 {
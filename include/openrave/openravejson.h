@@ -917,6 +917,317 @@ inline void UpdateJson(rapidjson::Document& a, const rapidjson::Value& b) {
     }
 }
 
+/** merges a diff computed by GetJsonDiff into an object: members of objects are merged recursively, all other values are replaced
+ */
+inline void ApplyJsonDiff(rapidjson::Value& value, const rapidjson::Value& diff, rapidjson::Document::AllocatorType& alloc) {
+    if (!value.IsObject() || !diff.IsObject()) {
+        value.CopyFrom(diff, alloc);
+        return;
+    }
+    for (rapidjson::Value::ConstMemberIterator it = diff.MemberBegin(); it != diff.MemberEnd(); ++it) {
+        rapidjson::Value::MemberIterator itvalue = value.FindMember(it->name);
+        if (itvalue != value.MemberEnd()) {
+            ApplyJsonDiff(itvalue->value, it->value, alloc);
+        }
+        else {
+            rapidjson::Value name, member;
+            name.CopyFrom(it->name, alloc);
+            member.CopyFrom(it->value, alloc);
+            value.AddMember(name, member, alloc);
+        }
+    }
+}
+
+/** computes the members of newvalue that were added or changed since oldvalue, so that ApplyJsonDiff(oldvalue, diff) gives newvalue. Objects are compared recursively, arrays and other values are emitted whole when they differ. Removed members are not part of the diff.
+
+    \return true if newvalue differs from oldvalue
+ */
+inline bool GetJsonDiff(rapidjson::Value& diff, const rapidjson::Value& newvalue, const rapidjson::Value& oldvalue, rapidjson::Document::AllocatorType& alloc) {
+    if (!newvalue.IsObject() || !oldvalue.IsObject()) {
+        if (newvalue == oldvalue) {
+            diff.SetNull();
+            return false;
+        }
+        diff.CopyFrom(newvalue, alloc);
+        return true;
+    }
+    diff.SetObject();
+    for (rapidjson::Value::ConstMemberIterator it = newvalue.MemberBegin(); it != newvalue.MemberEnd(); ++it) {
+        rapidjson::Value::ConstMemberIterator itold = oldvalue.FindMember(it->name);
+        rapidjson::Value member;
+        if (itold == oldvalue.MemberEnd()) {
+            member.CopyFrom(it->value, alloc);
+        }
+        else if (!GetJsonDiff(member, it->value, itold->value, alloc)) {
+            continue;
+        }
+        rapidjson::Value name;
+        name.CopyFrom(it->name, alloc);
+        diff.AddMember(name, member, alloc);
+    }
+    return diff.MemberCount() > 0;
+}
+
+/// \brief identifies streams written by DumpBinaryJson
+static const uint32_t BINARY_JSON_MAGIC_NUMBER = 0x4a42524f; // "ORBJ"
+static const uint16_t BINARY_JSON_VERSION_NUMBER = 0x0001;
+
+/// \brief the tokens of the binary json format. Integers and lengths are varints, signed integers are zigzag encoded.
+enum BinaryJsonToken
+{
+    BJT_Null = 0,
+    BJT_False = 1,
+    BJT_True = 2,
+    BJT_Int = 3, ///< zigzag varint
+    BJT_Uint = 4, ///< varint
+    BJT_Double = 5, ///< 8 bytes
+    BJT_String = 6, ///< length and bytes
+    BJT_StartObject = 7,
+    BJT_EndObject = 8,
+    BJT_StartArray = 9,
+    BJT_EndArray = 10,
+    BJT_NewKey = 11, ///< length and bytes of an object key that was not written before, gets the next key index
+    BJT_KeyIndex = 12, ///< index of an object key that was written before
+};
+
+/** \brief rapidjson handler that streams the events to a compact binary format instead of text
+
+    Object keys are written once and referenced by index afterwards, so the repeated keys of arrays of infos only cost a few bytes.
+ */
+class BinaryJsonWriter
+{
+public:
+    BinaryJsonWriter(std::ostream& os) : _os(os) {
+    }
+
+    bool Null() {
+        _os.put((char)BJT_Null);
+        return !!_os;
+    }
+    bool Bool(bool b) {
+        _os.put((char)(b ? BJT_True : BJT_False));
+        return !!_os;
+    }
+    bool Int(int i) {
+        return Int64(i);
+    }
+    bool Uint(unsigned u) {
+        return Uint64(u);
+    }
+    bool Int64(int64_t i) {
+        _os.put((char)BJT_Int);
+        _WriteVarUInt(((uint64_t)i << 1) ^ (uint64_t)(i >> 63));
+        return !!_os;
+    }
+    bool Uint64(uint64_t u) {
+        _os.put((char)BJT_Uint);
+        _WriteVarUInt(u);
+        return !!_os;
+    }
+    bool Double(double d) {
+        _os.put((char)BJT_Double);
+        _os.write((const char*)&d, sizeof(d));
+        return !!_os;
+    }
+    bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+        return Double(boost::lexical_cast<double>(std::string(str, length)));
+    }
+    bool String(const char* str, rapidjson::SizeType length, bool copy) {
+        _os.put((char)BJT_String);
+        _WriteVarUInt(length);
+        _os.write(str, length);
+        return !!_os;
+    }
+    bool StartObject() {
+        _os.put((char)BJT_StartObject);
+        return !!_os;
+    }
+    bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+        std::string key(str, length);
+        std::map<std::string, uint64_t>::iterator it = _mapKeyIndices.find(key);
+        if (it != _mapKeyIndices.end()) {
+            _os.put((char)BJT_KeyIndex);
+            _WriteVarUInt(it->second);
+        }
+        else {
+            uint64_t index = _mapKeyIndices.size();
+            _mapKeyIndices[key] = index;
+            _os.put((char)BJT_NewKey);
+            _WriteVarUInt(length);
+            _os.write(str, length);
+        }
+        return !!_os;
+    }
+    bool EndObject(rapidjson::SizeType memberCount) {
+        _os.put((char)BJT_EndObject);
+        return !!_os;
+    }
+    bool StartArray() {
+        _os.put((char)BJT_StartArray);
+        return !!_os;
+    }
+    bool EndArray(rapidjson::SizeType elementCount) {
+        _os.put((char)BJT_EndArray);
+        return !!_os;
+    }
+
+private:
+    void _WriteVarUInt(uint64_t value) {
+        while (value >= 0x80) {
+            _os.put((char)((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        _os.put((char)value);
+    }
+
+    std::ostream& _os;
+    std::map<std::string, uint64_t> _mapKeyIndices; ///< key -> index of the keys written so far
+};
+
+/** \brief reads the binary format of BinaryJsonWriter and generates the rapidjson events for a handler, for example for rapidjson::Document::Populate
+ */
+class BinaryJsonReader
+{
+public:
+    BinaryJsonReader(std::istream& is) : _is(is) {
+    }
+
+    template <typename Handler>
+    bool operator()(Handler& handler) {
+        int depth = 0;
+        do {
+            int token = _is.get();
+            bool bsuccess = false;
+            switch (token) {
+            case BJT_Null: bsuccess = handler.Null(); break;
+            case BJT_False: bsuccess = handler.Bool(false); break;
+            case BJT_True: bsuccess = handler.Bool(true); break;
+            case BJT_Int: {
+                uint64_t zigzag = _ReadVarUInt();
+                bsuccess = handler.Int64((int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+                break;
+            }
+            case BJT_Uint: bsuccess = handler.Uint64(_ReadVarUInt()); break;
+            case BJT_Double: {
+                double d = 0;
+                _is.read((char*)&d, sizeof(d));
+                bsuccess = handler.Double(d);
+                break;
+            }
+            case BJT_String:
+                _ReadString(_buffer);
+                bsuccess = handler.String(_buffer.c_str(), (rapidjson::SizeType)_buffer.size(), true);
+                break;
+            case BJT_StartObject: ++depth; _vMemberCounts.push_back(0); bsuccess = handler.StartObject(); break;
+            case BJT_EndObject:
+                if (depth == 0 || _vMemberCounts.empty()) {
+                    _ThrowInvalid("unexpected end of object");
+                }
+                --depth;
+                bsuccess = handler.EndObject(_vMemberCounts.back());
+                _vMemberCounts.pop_back();
+                break;
+            case BJT_StartArray: ++depth; _vMemberCounts.push_back(0); bsuccess = handler.StartArray(); break;
+            case BJT_EndArray:
+                if (depth == 0 || _vMemberCounts.empty()) {
+                    _ThrowInvalid("unexpected end of array");
+                }
+                --depth;
+                bsuccess = handler.EndArray(_vMemberCounts.back());
+                _vMemberCounts.pop_back();
+                break;
+            case BJT_NewKey:
+                _ReadString(_buffer);
+                _vKeys.push_back(_buffer);
+                bsuccess = handler.Key(_buffer.c_str(), (rapidjson::SizeType)_buffer.size(), true);
+                break;
+            case BJT_KeyIndex: {
+                uint64_t index = _ReadVarUInt();
+                if (index >= _vKeys.size()) {
+                    _ThrowInvalid("key index out of range");
+                }
+                bsuccess = handler.Key(_vKeys[index].c_str(), (rapidjson::SizeType)_vKeys[index].size(), true);
+                break;
+            }
+            default:
+                _ThrowInvalid("unknown token");
+            }
+            if (!bsuccess || !_is) {
+                _ThrowInvalid("failed to read value");
+            }
+            // every complete value counts once for the object or array containing it, keys do not count
+            bool bvaluecomplete = token != BJT_NewKey && token != BJT_KeyIndex && token != BJT_StartObject && token != BJT_StartArray;
+            if (bvaluecomplete && _vMemberCounts.size() > 0) {
+                ++_vMemberCounts.back();
+            }
+        } while (depth > 0);
+        return true;
+    }
+
+private:
+    uint64_t _ReadVarUInt() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = _is.get();
+            if (c == std::char_traits<char>::eof()) {
+                break;
+            }
+            value |= (uint64_t)(c & 0x7f) << shift;
+            if (!(c & 0x80)) {
+                return value;
+            }
+        }
+        _ThrowInvalid("invalid varint");
+        return 0;
+    }
+
+    void _ReadString(std::string& s) {
+        uint64_t length = _ReadVarUInt();
+        s.resize(length);
+        if (length > 0) {
+            _is.read(&s[0], length);
+        }
+    }
+
+    void _ThrowInvalid(const char* reason) {
+        throw openravejson::OpenRAVEJSONException((boost::format("Binary json stream is invalid (offset %d): %s")%(int64_t)_is.tellg()%reason).str(), openravejson::ORJE_InvalidArguments);
+    }
+
+    std::istream& _is;
+    std::vector<std::string> _vKeys; ///< the keys in the order they were first read
+    std::vector<rapidjson::SizeType> _vMemberCounts; ///< number of values of every open object or array
+    std::string _buffer;
+};
+
+/** \brief writes a value in the compact binary format of BinaryJsonWriter, preceded by a magic number and version
+ */
+inline void DumpBinaryJson(const rapidjson::Value& value, std::ostream& os) {
+    os.write((const char*)&BINARY_JSON_MAGIC_NUMBER, sizeof(BINARY_JSON_MAGIC_NUMBER));
+    os.write((const char*)&BINARY_JSON_VERSION_NUMBER, sizeof(BINARY_JSON_VERSION_NUMBER));
+    BinaryJsonWriter writer(os);
+    value.Accept(writer);
+}
+
+/** \brief reads a value written by DumpBinaryJson, building the document directly from the stream
+ */
+inline void ParseBinaryJson(rapidjson::Document& d, std::istream& is) {
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    is.read((char*)&magic, sizeof(magic));
+    is.read((char*)&version, sizeof(version));
+    if (!is || magic != BINARY_JSON_MAGIC_NUMBER) {
+        throw openravejson::OpenRAVEJSONException("Binary json stream does not start with the magic number", openravejson::ORJE_InvalidArguments);
+    }
+    if (version > BINARY_JSON_VERSION_NUMBER) {
+        throw openravejson::OpenRAVEJSONException((boost::format("Binary json stream has unsupported version %d")%version).str(), openravejson::ORJE_InvalidArguments);
+    }
+    BinaryJsonReader reader(is);
+    // see note in: void ParseJson(rapidjson::Document& d, const std::string& str)
+    rapidjson::Document tempDoc;
+    tempDoc.Populate(reader);
+    d.Swap(tempDoc);
+}
+
 } // namespace openravejson
 
 #endif // OPENRAVE_JSON_H
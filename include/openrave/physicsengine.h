@@ -28,6 +28,7 @@ namespace OpenRAVE {
 enum PhysicsEngineOptions
 {
     PEO_SelfCollisions = 1, ///< if set, physics engine will use contact forces from self-collisions
+    PEO_AutoDisable = 2, ///< if set, bodies that stay at rest are put to sleep until something touches them. The transforms of sleeping bodies are not set in the environment
 };
 
 /** \brief <b>[interface]</b> The physics engine interfaces supporting simulations and dynamics. See \ref arch_physicsengine.
@@ -122,6 +123,38 @@ public:
     /// add torques to the joints of the body. Torques disappear after one timestep of simulation
     virtual void SimulateStep(dReal fTimeElapsed)=0;
 
+    /// \brief the state of a body at the end of a rollout, see \ref SimulateRollouts
+    class OPENRAVE_API RolloutBodyState
+    {
+public:
+        RolloutBodyState() : environmentid(0) {
+        }
+        int environmentid; ///< the id of the body in the environment of this physics engine
+        std::vector<Transform> vlinktransforms;
+        std::vector<std::pair<Vector,Vector> > vlinkvelocities; ///< the linear and angular velocities of every link
+        std::vector<dReal> vdofvalues;
+    };
+
+    /// \brief applies the actions of step istep of rollout irollout, like forces or torques, to the bodies of penv.
+    ///
+    /// penv is the world of the rollout and its mutex is locked. The function is called from several threads at once.
+    typedef boost::function<void (EnvironmentBasePtr penv, int irollout, int istep)> RolloutActionFn;
+
+    /** \brief simulates several independent futures of the current state of the environment in parallel.
+
+        The link transforms, DOF values and link velocities of all bodies are saved when called. Every thread owns a
+        world cloned from the environment with its own copy of this physics engine, which is kept and only synchronized
+        on the next call. Each rollout starts from the saved state, then calls actionfn and SimulateStep(fTimeElapsed)
+        numsteps times. Controllers, sensors and the simulation time of the environment are not stepped.
+        The environment mutex has to be locked.
+        \param numrollouts the number of futures to simulate
+        \param numsteps the number of steps of every rollout
+        \param actionfn called before every step of every rollout, can be empty
+        \param[out] vrolloutstates for every rollout, the final states of all the bodies of the environment
+        \param numthreads the maximum number of threads to use, 0 uses the number of cores
+     */
+    virtual void SimulateRollouts(int numrollouts, int numsteps, dReal fTimeElapsed, const RolloutActionFn& actionfn, std::vector< std::vector<RolloutBodyState> >& vrolloutstates, int numthreads=0);
+
     /// \deprecated (10/11/18)
     virtual bool GetBodyVelocity(KinBodyConstPtr body, std::vector<Vector>& vLinearVelocities, std::vector<Vector>& vAngularVelocities) RAVE_DEPRECATED {
         std::vector<std::pair<Vector,Vector> > velocities;
@@ -157,6 +190,8 @@ private:
     virtual const char* GetHash() const {
         return OPENRAVE_PHYSICSENGINE_HASH;
     }
+
+    std::vector<EnvironmentBasePtr> _vrolloutenvs; ///< the worlds of the SimulateRollouts threads
 };
 
 } // end namespace OpenRAVE
@@ -42,6 +42,13 @@ enum ConstraintFilterOptions
     CFO_RecommendedOptions = 0x0000ffff, ///< recommended options that all plugins should use by default
 };
 
+/// \brief Order in which the discretized configurations of a segment are validated by the path constraints
+enum SegmentCheckOrder
+{
+    SCO_Sequential=0, ///< from the start of the segment to its end
+    SCO_Bisection=1, ///< midpoints first (van der Corput order), which usually finds a collision with fewer checks
+};
+
 /// \brief the status of the PlanPath method. Used when PlanPath can be called multiple times to resume planning.
 enum PlannerStatusCode
 {
@@ -159,7 +166,8 @@ private:
 
     /** \brief Attemps to copy data from one set of parameters to another in the safest manner.
 
-        First serializes the data of the right hand into a string, then initializes the current parameters via >>
+        The parameters both sides know are copied directly (see \ref _CopyParameters), the parameters only the right hand knows
+        are serialized into a string and parsed back via >>. If the right hand has no such parameters and no extra parameters, nothing is parsed.
         pointers to functions are copied directly
      */
     virtual PlannerParameters& operator=(const PlannerParameters& r);
@@ -401,6 +409,24 @@ private:
     /// The same seed should produce the smae results!
     uint32_t _nRandomGeneratorSeed;
 
+    /// \brief if true, planners that plan with several parallel workers return the same trajectory for the same seed and number of workers.
+    ///
+    /// The seed of worker i is always \ref GetParallelWorkerRandomGeneratorSeed(_nRandomGeneratorSeed, i) and every worker plans on its own
+    /// clone of the environment. When this is false the trajectory of the first worker that succeeds is used. When it is true, the trajectory
+    /// of the successful worker with the lowest index is used, so planning waits for all the workers before it. This holds
+    /// as long as the workers do not stop on _nMaxPlanningTime, since how far a worker gets in a given time depends on the machine.
+    bool _bDeterministicParallel;
+
+    /// \brief returns the random generator seed for parallel worker workerindex of a planner with random generator seed seed.
+    ///
+    /// The seeds are hashed (splitmix64) from both values, so the workers of consecutive seeds do not share sequences.
+    static uint32_t GetParallelWorkerRandomGeneratorSeed(uint32_t seed, int workerindex);
+
+    /// \brief order in which the path constraints check the discretized configurations of a segment, one of \ref SegmentCheckOrder.
+    ///
+    /// The same configurations are checked in both orders, only the first violation that is found can differ.
+    int _nSegmentCheckOrder;
+
     /// \brief Return the degrees of freedom of the planning configuration space
     virtual int GetDOF() const {
         return _configurationspecification.GetDOF();
@@ -451,10 +477,17 @@ protected:
 
     /// \brief output the planner parameters in a string (in XML format)
     ///
-    /// \param options if 1 will skip writing the extra parameters
+    /// \param options if 1 will skip writing the extra parameters, if 2 will skip writing the parameters of PlannerParameters itself
     /// don't use PlannerParameters as a tag!
     virtual bool serialize(std::ostream& O, int options=0) const;
 
+    /// \brief copies the parameters of r that this class knows without going through xml, called by operator=
+    ///
+    /// Derived classes copy their own parameters if r derives from them too, and call the parent class first.
+    /// \return true if all the parameters of r except _sExtraParameters are copied, otherwise the parameters of the classes of r that do not
+    /// override this are transferred by serializing and parsing.
+    virtual bool _CopyParameters(const PlannerParameters& r);
+
     //@{ XML parsing functions, parses the default parameters
     virtual ProcessElement startElement(const std::string& name, const AttributesList& atts);
     virtual bool endElement(const std::string& name);
@@ -482,6 +515,38 @@ typedef boost::shared_ptr<PlannerParameters const> PlannerParametersConstPtr;
 typedef boost::weak_ptr<PlannerParameters> PlannerParametersWeakPtr;
 typedef boost::weak_ptr<PlannerParameters const> PlannerParametersWeakConstPtr;
 
+/// \brief Breakdown of the work done by PlanPath, filled by the planners that support it. Fields a planner does not track stay 0.
+///
+/// Times are in ns.
+class OPENRAVE_API PlannerStatistics
+{
+public:
+    PlannerStatistics();
+
+    /// \brief sets all the fields to 0
+    void Reset();
+
+    /// \brief true if no planner filled any of the fields
+    bool IsEmpty() const;
+
+    /// \brief adds all the fields of r, used by planners to include the work of the planners they call
+    PlannerStatistics& operator+=(const PlannerStatistics& r);
+
+    void SaveToJson(rapidjson::Value& rPlannerStatistics, rapidjson::Document::AllocatorType& alloc) const;
+
+    uint32_t numIterations; ///< iterations of the main loop of the planner, for smoothers the shortcut iterations
+    uint32_t numNodes; ///< number of nodes in the search trees or graphs at the end
+    uint32_t numSamples; ///< number of configurations sampled
+    uint64_t samplingTime;
+    uint32_t numNearestNeighborQueries;
+    uint64_t nearestNeighborTime;
+    uint32_t numConstraintChecks; ///< number of calls to PlannerParameters::CheckPathAllConstraints or the equivalent checks of a smoother
+    uint64_t constraintCheckTime;
+    uint32_t numConstraintRejects; ///< number of constraint checks that failed
+    uint64_t numCollisionQueries; ///< number of queries the collision checker of the environment received, see the "collision.queries" performance counter
+    uint64_t totalTime; ///< time spent in PlanPath
+};
+
 /// \brief Planner error information
 class OPENRAVE_API PlannerStatus
 {
@@ -513,6 +578,7 @@ public:
     IkParameterization ikparam;      // Optional,  the ik parameter that failed to find a solution.
     std::vector<dReal> jointValues; // Optional,  the robot's joint values in rad or m
     CollisionReportPtr report;       ///< Optional,  collision report at the time of the error. Ideally should contents contacts information.
+    PlannerStatistics statistics;   ///< Optional, where PlanPath spent its time
 
     std::string errorOrigin;        // Auto, a string representing the code path of the error. Automatically filled on construction.
 };
@@ -543,6 +609,8 @@ public:
 public:
         PlannerProgress();
         int _iteration;
+        dReal _fCost; ///< cost of the current best solution if the planner keeps one, for smoothers the duration or length of the path. 0 if unknown
+        uint32_t _nElapsedTime; ///< ms since PlanPath started, 0 if the planner does not track it
     };
 
     PlannerBase(EnvironmentBasePtr penv);
@@ -452,7 +452,7 @@ typedef boost::shared_ptr<GraspParameters const> GraspParametersConstPtr;
 class OPENRAVE_API TrajectoryTimingParameters : public PlannerBase::PlannerParameters
 {
 public:
-    TrajectoryTimingParameters() : _interpolation(""), _pointtolerance(0.2), _hastimestamps(false), _hasvelocities(false), _outputaccelchanges(true), _multidofinterp(0), verifyinitialpath(1), _bProcessing(false) {
+    TrajectoryTimingParameters() : _interpolation(""), _pointtolerance(0.2), _hastimestamps(false), _hasvelocities(false), _outputaccelchanges(true), _multidofinterp(0), verifyinitialpath(1), _nMaxShortcutTime(0), _bProcessing(false) {
         _fStepLength = 0; // reset to 0 since it is being used
         _vXMLParameters.push_back("interpolation");
         _vXMLParameters.push_back("hastimestamps");
@@ -461,6 +461,7 @@ public:
         _vXMLParameters.push_back("outputaccelchanges");
         _vXMLParameters.push_back("multidofinterp");
         _vXMLParameters.push_back("verifyinitialpath");
+        _vXMLParameters.push_back("maxshortcuttime");
     }
 
     std::string _interpolation;
@@ -469,9 +470,28 @@ public:
     bool _outputaccelchanges; ///< if true, will output a waypoint every time a DOF changes its acceleration, this allows a trajectory be executed without knowing the max velocities/accelerations. If false, will just output the waypoints.
     int _multidofinterp; ///< if 1, will always force the max acceleration of the robot when retiming rather than using lesser acceleration whenever possible. if 0, will compute minimum acceleration. If 2, will match acceleration ramps of all dofs.
     int verifyinitialpath; ///< if 0 then does not verify whether the path given as input is in collision
+    uint32_t _nMaxShortcutTime; ///< if > 0, the shortcutting smoothers stop shortcutting this many ms after PlanPath started and keep the best path so far. They then also try the most promising of several sampled shortcuts.
 
 protected:
     bool _bProcessing;
+    virtual bool _CopyParameters(const PlannerParameters& r)
+    {
+        bool bcopiedall = PlannerParameters::_CopyParameters(r);
+        const TrajectoryTimingParameters* ptimingparameters = dynamic_cast<const TrajectoryTimingParameters*>(&r);
+        if( !ptimingparameters ) {
+            return bcopiedall;
+        }
+        _interpolation = ptimingparameters->_interpolation;
+        _pointtolerance = ptimingparameters->_pointtolerance;
+        _hastimestamps = ptimingparameters->_hastimestamps;
+        _hasvelocities = ptimingparameters->_hasvelocities;
+        _outputaccelchanges = ptimingparameters->_outputaccelchanges;
+        _multidofinterp = ptimingparameters->_multidofinterp;
+        verifyinitialpath = ptimingparameters->verifyinitialpath;
+        _nMaxShortcutTime = ptimingparameters->_nMaxShortcutTime;
+        return typeid(r) == typeid(TrajectoryTimingParameters);
+    }
+
     virtual bool serialize(std::ostream& O, int options=0) const
     {
         if( !PlannerParameters::serialize(O, options&~1) ) {
@@ -484,6 +504,7 @@ protected:
         O << "<outputaccelchanges>" << _outputaccelchanges << "</outputaccelchanges>" << std::endl;
         O << "<multidofinterp>" << _multidofinterp << "</multidofinterp>" << std::endl;
         O << "<verifyinitialpath>" << verifyinitialpath  << "</verifyinitialpath>" << std::endl;
+        O << "<maxshortcuttime>" << _nMaxShortcutTime << "</maxshortcuttime>" << std::endl;
         if( !(options & 1) ) {
             O << _sExtraParameters << std::endl;
         }
@@ -502,7 +523,7 @@ protected:
         case PE_Ignore: return PE_Ignore;
         }
 
-        _bProcessing = name=="interpolation" || name=="hastimestamps" || name=="hasvelocities" || name=="pointtolerance" || name=="outputaccelchanges" || name=="multidofinterp"||name=="verifyinitialpath";
+        _bProcessing = name=="interpolation" || name=="hastimestamps" || name=="hasvelocities" || name=="pointtolerance" || name=="outputaccelchanges" || name=="multidofinterp"||name=="verifyinitialpath"||name=="maxshortcuttime";
         return _bProcessing ? PE_Support : PE_Pass;
     }
 
@@ -530,6 +551,9 @@ protected:
             else if( name == "verifyinitialpath") {
                 _ss >> verifyinitialpath;
             }
+            else if( name == "maxshortcuttime" ) {
+                _ss >> _nMaxShortcutTime;
+            }
             else {
                 RAVELOG_WARN(str(boost::format("unknown tag %s\n")%name));
             }
@@ -548,7 +572,7 @@ typedef boost::shared_ptr<TrajectoryTimingParameters const> TrajectoryTimingPara
 class OPENRAVE_API ConstraintTrajectoryTimingParameters : public TrajectoryTimingParameters
 {
 public:
-    ConstraintTrajectoryTimingParameters() : TrajectoryTimingParameters(), maxlinkspeed(0), maxlinkaccel(0), maxmanipspeed(0), maxmanipaccel(0), vConstraintManipDir(0,0,1), vConstraintGlobalDir(0,0,1), fCosManipAngleThresh(-1), mingripperdistance(0), velocitydistancethresh(0), maxmergeiterations(1000), minswitchtime(0.2),nshortcutcycles(1), fSearchVelAccelMult(0.8), durationImprovementCutoffRatio(0.001), _bCProcessing(false) {
+    ConstraintTrajectoryTimingParameters() : TrajectoryTimingParameters(), maxlinkspeed(0), maxlinkaccel(0), maxmanipspeed(0), maxmanipaccel(0), vConstraintManipDir(0,0,1), vConstraintGlobalDir(0,0,1), fCosManipAngleThresh(-1), mingripperdistance(0), velocitydistancethresh(0), maxmergeiterations(1000), minswitchtime(0.2),nshortcutcycles(1), fSearchVelAccelMult(0.8), durationImprovementCutoffRatio(0.001), nshortcutthreads(1), nshortcutcandidates(0), nretimingthreads(1), _bCProcessing(false) {
         _vXMLParameters.push_back("maxlinkspeed");
         _vXMLParameters.push_back("maxlinkaccel");
         _vXMLParameters.push_back("manipname");
@@ -564,6 +588,9 @@ public:
         _vXMLParameters.push_back("nshortcutcycles");
         _vXMLParameters.push_back("searchvelaccelmult");
         _vXMLParameters.push_back("durationimprovementcutoffratio");
+        _vXMLParameters.push_back("nshortcutthreads");
+        _vXMLParameters.push_back("nshortcutcandidates");
+        _vXMLParameters.push_back("nretimingthreads");
     }
 
     dReal maxlinkspeed; ///< max speed in m/s that any point on any link goes. 0 means no speed limit
@@ -587,9 +614,40 @@ public:
 
     dReal fSearchVelAccelMult; ///< a number in [0.0001,0.99999] that is the multipler of the velocity/acceleration limits when time-based constraints are invalidated (manip speed and/or dynamics). The closer to 1 it is, the more optimal the trajectory will be, but it will take more time to compute. A value around 0.5-0.8 is best.
     dReal durationImprovementCutoffRatio; ///< Whenever shortcut is accepted, if change is less than diff/iterations, then do not do anymore shortcutting.
+    int nshortcutthreads; ///< if > 1, shortcut candidates are checked speculatively in this many threads, each with its own cloned environment.
+    int nshortcutcandidates; ///< the number of shortcut candidates sampled per parallel round. 0 means twice nshortcutthreads.
+    int nretimingthreads; ///< if > 1, retimers that support it compute the minimum times of the segments in this many threads before the sequential pass that writes the trajectory.
 
 protected:
     bool _bCProcessing;
+    virtual bool _CopyParameters(const PlannerParameters& r)
+    {
+        bool bcopiedall = TrajectoryTimingParameters::_CopyParameters(r);
+        const ConstraintTrajectoryTimingParameters* pconstraintparameters = dynamic_cast<const ConstraintTrajectoryTimingParameters*>(&r);
+        if( !pconstraintparameters ) {
+            return bcopiedall;
+        }
+        maxlinkspeed = pconstraintparameters->maxlinkspeed;
+        maxlinkaccel = pconstraintparameters->maxlinkaccel;
+        manipname = pconstraintparameters->manipname;
+        maxmanipspeed = pconstraintparameters->maxmanipspeed;
+        maxmanipaccel = pconstraintparameters->maxmanipaccel;
+        vConstraintManipDir = pconstraintparameters->vConstraintManipDir;
+        vConstraintGlobalDir = pconstraintparameters->vConstraintGlobalDir;
+        fCosManipAngleThresh = pconstraintparameters->fCosManipAngleThresh;
+        mingripperdistance = pconstraintparameters->mingripperdistance;
+        velocitydistancethresh = pconstraintparameters->velocitydistancethresh;
+        maxmergeiterations = pconstraintparameters->maxmergeiterations;
+        minswitchtime = pconstraintparameters->minswitchtime;
+        nshortcutcycles = pconstraintparameters->nshortcutcycles;
+        fSearchVelAccelMult = pconstraintparameters->fSearchVelAccelMult;
+        durationImprovementCutoffRatio = pconstraintparameters->durationImprovementCutoffRatio;
+        nshortcutthreads = pconstraintparameters->nshortcutthreads;
+        nshortcutcandidates = pconstraintparameters->nshortcutcandidates;
+        nretimingthreads = pconstraintparameters->nretimingthreads;
+        return typeid(r) == typeid(ConstraintTrajectoryTimingParameters);
+    }
+
     virtual bool serialize(std::ostream& O, int options=0) const
     {
         if( !TrajectoryTimingParameters::serialize(O, options&~1) ) {
@@ -610,6 +668,9 @@ protected:
         O << "<nshortcutcycles>" << nshortcutcycles << "</nshortcutcycles>" << std::endl;
         O << "<searchvelaccelmult>" << fSearchVelAccelMult << "</searchvelaccelmult>" << std::endl;
         O << "<durationimprovementcutoffratio>" << durationImprovementCutoffRatio << "</durationimprovementcutoffratio>" << std::endl;
+        O << "<nshortcutthreads>" << nshortcutthreads << "</nshortcutthreads>" << std::endl;
+        O << "<nshortcutcandidates>" << nshortcutcandidates << "</nshortcutcandidates>" << std::endl;
+        O << "<nretimingthreads>" << nretimingthreads << "</nretimingthreads>" << std::endl;
         if( !(options & 1) ) {
             O << _sExtraParameters << std::endl;
         }
@@ -627,7 +688,7 @@ protected:
         case PE_Support: return PE_Support;
         case PE_Ignore: return PE_Ignore;
         }
-        _bCProcessing = name=="maxlinkspeed" || name =="maxlinkaccel" || name=="manipname" || name=="maxmanipspeed" || name =="maxmanipaccel" || name=="mingripperdistance" || name=="velocitydistancethresh" || name=="maxmergeiterations" || name=="minswitchtime"|| name=="nshortcutcycles" || name=="constraintmanipdir" || name=="constraintglobaldir" || name=="cosmanipanglethresh" || name=="searchvelaccelmult" || name=="durationimprovementcutoffratio";
+        _bCProcessing = name=="maxlinkspeed" || name =="maxlinkaccel" || name=="manipname" || name=="maxmanipspeed" || name =="maxmanipaccel" || name=="mingripperdistance" || name=="velocitydistancethresh" || name=="maxmergeiterations" || name=="minswitchtime"|| name=="nshortcutcycles" || name=="constraintmanipdir" || name=="constraintglobaldir" || name=="cosmanipanglethresh" || name=="searchvelaccelmult" || name=="durationimprovementcutoffratio" || name=="nshortcutthreads" || name=="nshortcutcandidates" || name=="nretimingthreads";
         return _bCProcessing ? PE_Support : PE_Pass;
     }
 
@@ -670,6 +731,15 @@ protected:
             else if( name == "durationimprovementcutoffratio" ) {
                 _ss >> durationImprovementCutoffRatio;
             }
+            else if( name == "nshortcutthreads" ) {
+                _ss >> nshortcutthreads;
+            }
+            else if( name == "nshortcutcandidates" ) {
+                _ss >> nshortcutcandidates;
+            }
+            else if( name == "nretimingthreads" ) {
+                _ss >> nretimingthreads;
+            }
             else if( name == "constraintmanipdir" ) {
                 _ss >> vConstraintManipDir;
             }
@@ -728,11 +798,15 @@ typedef boost::shared_ptr<WorkspaceTrajectoryParameters const> WorkspaceTrajecto
 class OPENRAVE_API RRTParameters : public PlannerBase::PlannerParameters
 {
 public:
-    RRTParameters() : _minimumgoalpaths(1), _bProcessing(false) {
+    RRTParameters() : _minimumgoalpaths(1), _nNearestNeighborType(0), _nParallelWorkers(0), _bProcessing(false) {
         _vXMLParameters.push_back("minimumgoalpaths");
+        _vXMLParameters.push_back("nearestneighbortype");
+        _vXMLParameters.push_back("parallelworkers");
     }
 
     size_t _minimumgoalpaths; ///< minimum number of goals to connect to before exiting. the goal with the shortest path is returned.
+    int _nNearestNeighborType; ///< how the trees answer nearest neighbor queries. if 0, then use the cover tree. if 1, then linearly scan a contiguous array of the configurations, which is faster for high dof configuration spaces.
+    int _nParallelWorkers; ///< if > 1, the bi-directional RRT runs that many independent searches on cloned environments in separate threads and returns the first path found. Reduces the worst case planning time.
 
 protected:
     bool _bProcessing;
@@ -742,6 +816,8 @@ protected:
             return false;
         }
         O << "<minimumgoalpaths>" << _minimumgoalpaths << "</minimumgoalpaths>" << std::endl;
+        O << "<nearestneighbortype>" << _nNearestNeighborType << "</nearestneighbortype>" << std::endl;
+        O << "<parallelworkers>" << _nParallelWorkers << "</parallelworkers>" << std::endl;
         if( !(options & 1) ) {
             O << _sExtraParameters << std::endl;
         }
@@ -759,7 +835,7 @@ protected:
         case PE_Ignore: return PE_Ignore;
         }
 
-        _bProcessing = name=="minimumgoalpaths";
+        _bProcessing = name=="minimumgoalpaths" || name=="nearestneighbortype" || name=="parallelworkers";
         return _bProcessing ? PE_Support : PE_Pass;
     }
 
@@ -769,6 +845,12 @@ protected:
             if( name == "minimumgoalpaths") {
                 _ss >> _minimumgoalpaths;
             }
+            else if( name == "nearestneighbortype" ) {
+                _ss >> _nNearestNeighborType;
+            }
+            else if( name == "parallelworkers" ) {
+                _ss >> _nParallelWorkers;
+            }
             else {
                 RAVELOG_WARN(str(boost::format("unknown tag %s\n")%name));
             }
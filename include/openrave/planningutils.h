@@ -395,6 +395,153 @@ public:
  */
 OPENRAVE_API void GetDHParameters(std::vector<DHParameter>&vparameters, KinBodyConstPtr pbody);
 
+/** \brief a voxelized signed distance field of a set of bodies that do not move, for constant time distance lookups
+
+    The voxels touched by the collision meshes of the bodies are marked occupied, and the voxels that cannot be reached from the border of the grid are marked inside.
+    Every voxel stores the distance from its center to the nearest occupied center, or minus the distance to the nearest free center for inside voxels.
+    Lookups interpolate trilinearly between the voxel centers, so they can be off from the true distance by up to \ref GetErrorBound.
+    The field does not notice when the bodies move, it has to be computed again.
+ */
+class OPENRAVE_API SignedDistanceField
+{
+public:
+    SignedDistanceField();
+    virtual ~SignedDistanceField() {
+    }
+
+    /// \brief voxelizes the enabled links of the bodies and computes the distances
+    ///
+    /// \param vbodies the bodies to put in the field, they should be static
+    /// \param fResolution edge length of a voxel
+    /// \param fPadding the grid covers the bounding box of the bodies enlarged by this much on every side. Lookups outside the grid return the value of the closest border voxel.
+    virtual void Compute(const std::vector<KinBodyConstPtr>& vbodies, dReal fResolution, dReal fPadding);
+
+    /// \brief writes the field to a binary file
+    virtual void Save(const std::string& filename) const;
+
+    /// \brief reads a field written by \ref Save
+    ///
+    /// \return false if the file could not be read
+    virtual bool Load(const std::string& filename);
+
+    /// \brief returns true if the field holds any voxels
+    inline bool IsInitialized() const {
+        return _vdistances.size() > 0;
+    }
+
+    /// \brief returns the interpolated signed distance of a point to the bodies
+    ///
+    /// \param pgradient if not NULL, filled with the gradient of the interpolated distance
+    virtual dReal GetDistance(const Vector& position, Vector* pgradient=NULL) const;
+
+    /// \brief the maximum difference between \ref GetDistance and the true distance to the bodies
+    inline dReal GetErrorBound() const {
+        return _fErrorBound;
+    }
+
+    inline dReal GetResolution() const {
+        return _fResolution;
+    }
+
+    /// \brief the names of the bodies the field was computed from
+    inline const std::vector<std::string>& GetBodyNames() const {
+        return _vbodynames;
+    }
+
+protected:
+    inline size_t _GetIndex(int ix, int iy, int iz) const {
+        return ((size_t)iz*_dims[1] + iy)*_dims[0] + ix;
+    }
+
+    std::vector<std::string> _vbodynames;
+    Vector _vorigin; ///< the center of voxel (0,0,0)
+    dReal _fResolution;
+    dReal _fErrorBound;
+    boost::array<int, 3> _dims; ///< number of voxels along x, y and z
+    std::vector<float> _vdistances; ///< x changes fastest
+};
+
+typedef boost::shared_ptr<SignedDistanceField> SignedDistanceFieldPtr;
+typedef boost::shared_ptr<SignedDistanceField const> SignedDistanceFieldConstPtr;
+
+/** \brief finds the first time bodies executing different trajectories collide with each other
+
+    All trajectories are sampled with the same time step, so sample k of every trajectory is at time k*timestep. For every trajectory a hierarchy of
+    bounding boxes over time is built: the leaves are the AABBs of the body at the samples, and every parent bounds two consecutive children.
+    The queries descend the hierarchies of two trajectories in time order and only check the exact collision of the bodies at the samples where the boxes overlap,
+    so the result is the same as calling EnvironmentBase::CheckCollision(KinBodyConstPtr,KinBodyConstPtr) at every sample. Motion in between the samples is not checked.
+
+    The bodies are moved during \ref AddTrajectory and the queries and restored after. The environment has to be locked while using the checker.
+ */
+class OPENRAVE_API TrajectoryConflictChecker
+{
+public:
+    /// \param fTimeStep the time between two samples of the trajectories
+    TrajectoryConflictChecker(EnvironmentBasePtr penv, dReal fTimeStep=0.01);
+    virtual ~TrajectoryConflictChecker() {
+    }
+
+    /// \brief samples the trajectory of a body and builds its bounding hierarchy
+    ///
+    /// The bodies attached to the body, like grabbed bodies, are included in the bounds. The bounds use the links that are enabled when the trajectory is added.
+    /// \param ptraj the values of the body are extracted with KinBody::GetConfigurationSpecification, values that are not in the trajectory are taken from the current state of the body
+    /// \param fStartTime the time the body starts executing the trajectory. Before it and after the end of the trajectory, the body stays at the first and last point.
+    /// \return the index of the trajectory for the queries
+    virtual int AddTrajectory(KinBodyPtr pbody, TrajectoryBaseConstPtr ptraj, dReal fStartTime=0);
+
+    /// \brief removes a trajectory, the indices of the trajectories after it are decreased by one
+    virtual void RemoveTrajectory(int itrajectory);
+
+    /// \brief removes all the trajectories
+    virtual void Clear();
+
+    inline int GetNumTrajectories() const {
+        return (int)_vtrajectories.size();
+    }
+
+    /// \brief returns the first time the bodies of two trajectories collide, or -1 if they never collide
+    virtual dReal GetFirstConflictTime(int itrajectory0, int itrajectory1, CollisionReportPtr report=CollisionReportPtr());
+
+    /// \brief returns the first time the bodies of any two trajectories collide, or -1 if they never collide
+    ///
+    /// Pairs of trajectories of the same body are skipped.
+    /// \param[out] conflictpair the indices of the trajectories that collide first, -1 if there is no conflict
+    virtual dReal GetFirstConflictTime(std::pair<int, int>& conflictpair, CollisionReportPtr report=CollisionReportPtr());
+
+    /// \brief the number of exact collision checks done by the last query
+    inline int GetNumCollisionChecks() const {
+        return _nCollisionChecks;
+    }
+
+protected:
+    struct SampledTrajectory
+    {
+        KinBodyPtr _pbody;
+        std::vector<dReal> _vconfigs; ///< the configuration values of the body at every sample
+        int _nConfigDOF;
+        std::vector< std::vector<AABB> > _vlevels; ///< _vlevels[0] holds the AABBs of the samples, _vlevels[l][i] bounds the samples i*2^l to (i+1)*2^l-1
+    };
+
+    /// \brief returns the bounds of the samples index*2^level to (index+1)*2^level-1, the body stays at the last sample after the end of the trajectory
+    const AABB& _GetNodeAABB(const SampledTrajectory& traj, size_t level, size_t index) const;
+
+    /// \brief returns the first sample before nEndSample where the bodies collide, or -1
+    int _FindFirstConflict(const SampledTrajectory& traj0, const SampledTrajectory& traj1, int nEndSample, CollisionReportPtr report);
+
+    /// \brief returns the first sample of the node before nEndSample where the bodies collide, or -1
+    int _FindFirstConflictInNode(const SampledTrajectory& traj0, const SampledTrajectory& traj1, size_t level, size_t index, int nEndSample, CollisionReportPtr report);
+
+    /// \brief sets the bodies to the sample and checks their collision
+    bool _CheckSample(const SampledTrajectory& traj0, const SampledTrajectory& traj1, int isample, CollisionReportPtr report);
+
+    EnvironmentBasePtr _penv;
+    dReal _fTimeStep;
+    std::vector<SampledTrajectory> _vtrajectories;
+    int _nCollisionChecks;
+};
+
+typedef boost::shared_ptr<TrajectoryConflictChecker> TrajectoryConflictCheckerPtr;
+
 /** \brief dynamics and collision checking with linear interpolation
 
     For any joints with maxtorque > 0, uses KinBody::ComputeInverseDynamics to check if the necessary torque exceeds the max torque. Max torque is always called via GetMaxTorque
@@ -434,7 +581,39 @@ public:
     /// \param bCallAfterCheckCollision if set, function will be called after check collision functions.
     virtual void SetUserCheckFunction(const boost::function<bool() >& usercheckfn, bool bCallAfterCheckCollision=false);
 
+    /// \brief sets whether the motion between consecutive checked states is also swept against the environment.
+    ///
+    /// Uses CollisionCheckerBase::CheckContinuousCollision of the environment checker, which catches obstacles thinner than the DOF resolution.
+    /// Checkers that do not implement it are detected on the first call and only the discretized states are checked for them. By default it is disabled.
+    virtual void SetContinuousCollisionChecking(bool bcontinuous);
+
+    /// \brief sets whether environment collision checks close to an already checked state are skipped using distance bounds.
+    ///
+    /// When a state needs an environment check, the checker is queried with CO_Distance and CollisionReport::minDistance is kept together with that state.
+    /// Following states of the same segment are not checked against the environment as long as a bound on the workspace motion of the links since that state stays below the distance.
+    /// The bound sums |dq| times the distance of the affected links (and grabbed bodies) from the joint anchor for every revolute DOF and |dq| for every prismatic DOF.
+    /// Only used when checking a single body without mimic joints whose base does not move, otherwise every state is checked. By default it is disabled.
+    virtual void SetDistanceBoundStepping(bool bdistancestepping);
+
+    /// \brief sets a distance field of the static bodies for distance bound stepping
+    ///
+    /// When set, the distance bound is computed by looking up the bounding spheres of the links and grabbed bodies in the field instead of querying the checker with CO_Distance against the whole environment.
+    /// Only the bodies that are not in the field are queried with CO_Distance, one pair at a time. The field has to be recomputed by the caller when its bodies move.
+    /// \param pfield the field, or empty to query the checker again
+    virtual void SetStaticDistanceField(SignedDistanceFieldConstPtr pfield);
+
+    /// \brief returns the number of environment collision checks done and skipped by distance bound stepping since the last \ref ResetDistanceBoundStatistics
+    ///
+    /// \param[out] numdistancequeries number of CO_Distance queries
+    /// \param[out] numchecks number of regular environment collision checks
+    /// \param[out] numskipped number of environment collision checks skipped because the state was within the distance bound
+    virtual void GetDistanceBoundStatistics(int& numdistancequeries, int& numchecks, int& numskipped) const;
+
+    virtual void ResetDistanceBoundStatistics();
+
     /// \brief checks line collision. Uses the constructor's self-collisions
+    ///
+    /// The discretized configurations are checked in the order given by PlannerParameters::_nSegmentCheckOrder. With SCO_Bisection they are first computed from start to end and then checked midpoints first. This order is not used when continuous collision checking is on, since it needs consecutive states.
     virtual int Check(const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options = 0xffff, ConstraintFilterReturnPtr filterreturn = ConstraintFilterReturnPtr());
 
     CollisionReportPtr GetReport() const {
@@ -453,6 +632,32 @@ protected:
     ///
     /// \param options should already be masked with _filtermask
     virtual int _SetAndCheckState(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& vdofvalues, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccels, int options, ConstraintFilterReturnPtr filterreturn);
+
+    /// \brief sweeps the bodies from the DOF values of the previously checked state to the currently set state, then stores the current DOF values as the previous state
+    ///
+    /// \return 0 if the motion is free or cannot be checked continuously, CFO_CheckEnvCollisions otherwise
+    virtual int _CheckContinuousState(int options, ConstraintFilterReturnPtr filterreturn);
+
+    /// \brief checks the states recorded while _bDeferChecks was set in bisection order
+    ///
+    /// \param options should already be masked with _filtermask
+    virtual int _CheckDeferredStates(PlannerBase::PlannerParametersConstPtr params, int options, ConstraintFilterReturnPtr filterreturn);
+
+    /// \brief checks the currently set state of pbody against the environment, skipping the check when the state is within the distance bound of the last distance query
+    ///
+    /// \return true if in collision, _report is filled in that case
+    virtual bool _CheckEnvCollision(KinBodyPtr pbody);
+
+    /// \brief computes _vDistanceAnchorRadii for the currently set state of pbody
+    ///
+    /// \return false if the motion of pbody cannot be bounded this way
+    virtual bool _ComputeDistanceAnchorRadii(KinBodyPtr pbody);
+
+    /// \brief computes a lower bound on the distance of the currently set state of pbody to the environment using _pStaticDistanceField
+    ///
+    /// \return the bound, or 0 if it could not be computed
+    virtual dReal _ComputeStaticFieldDistance(KinBodyPtr pbody, CollisionCheckerBasePtr pchecker);
+
     virtual void _PrintOnFailure(const std::string& prefix);
 
     PlannerBase::PlannerParametersWeakConstPtr _parameters;
@@ -464,6 +669,36 @@ protected:
     dReal _perturbation;
     boost::array< boost::function<bool() >, 2> _usercheckfns;
 
+    // for continuous collision checking
+    bool _bContinuousCollision; ///< if true, check the motion between consecutive states with CollisionCheckerBase::CheckContinuousCollision
+    bool _bHasContinuousPrevState; ///< true if _vContinuousPrevValues holds the DOF values of the previously checked state of the current segment
+    std::vector< std::vector<dReal> > _vContinuousPrevValues; ///< DOF values of each body of _listCheckBodies at the previously checked state
+    std::vector<dReal> _vContinuousValues; ///< cache
+    CollisionCheckerBaseWeakPtr _pContinuousUnsupportedChecker; ///< the last checker that threw ORE_NotImplemented for continuous checks
+
+    // for distance bound stepping
+    bool _bDistanceStepping; ///< if true, skip environment checks within the distance bound of the last distance query
+    bool _bHasDistanceAnchor; ///< true if _vDistanceAnchorValues holds the last state queried with CO_Distance in the current segment
+    dReal _fDistanceAnchor; ///< distance of the body to the environment at the anchor state
+    Transform _tDistanceAnchor; ///< transform of the body at the anchor state
+    std::vector<dReal> _vDistanceAnchorValues; ///< DOF values at the anchor state
+    std::vector<dReal> _vDistanceAnchorRadii; ///< for every DOF, the maximum workspace displacement of the body per unit of DOF motion
+    std::vector<dReal> _vDistanceValues; ///< cache
+    std::vector< std::pair<Vector, dReal> > _vDistanceSpheres; ///< cache of the bounding spheres of the links and grabbed bodies
+    std::vector<KinBodyPtr> _vDistanceGrabbed; ///< cache
+    SignedDistanceFieldConstPtr _pStaticDistanceField; ///< if set, used for the distance to its bodies
+    std::vector<KinBodyPtr> _vDistanceEnvBodies; ///< cache
+    int _nDistanceAnchorSkips; ///< number of checks skipped with the current anchor
+    int _nDistanceBackoff, _nDistanceBackoffCount; ///< after a distance query that did not skip anything, the next _nDistanceBackoff states are checked without distance
+    int _nDistanceQueries, _nDistanceChecks, _nDistanceSkipped; ///< statistics
+
+    // for bisection order
+    bool _bDeferChecks; ///< if true, _SetAndCheckState only sets and records the states, they are checked later by _CheckDeferredStates
+    std::vector<dReal> _vDeferredValues, _vDeferredVelocities, _vDeferredAccelerations; ///< the recorded states, stored contiguously
+    std::vector<dReal> _vDeferredAccelConfig; ///< cache
+    std::vector< std::pair<size_t, size_t> > _vDeferredFilterIndices; ///< for every recorded state, the sizes of ConstraintFilterReturn::_configurations and _configurationtimes when it was recorded
+    std::vector< std::pair<int, int> > _vBisectionIntervals; ///< cache
+
     // for dynamics
     ConfigurationSpecification _specvel;
     std::vector< std::pair<int, std::pair<dReal, dReal> > > _vtorquevalues; ///< cache for dof indices and the torque limits that the current torque should be in
@@ -535,6 +770,23 @@ protected:
     ConstraintFilterReturnPtr _filterreturn;
 } RAVE_DEPRECATED;
 
+/** \brief computes the squared weighted L2 distances from one configuration to a contiguous block of configurations
+
+    pdistances2[i] = sum_j pweights2[j]*(pconfigs[i*dof+j]-pquery[j])^2
+
+    This is the inner loop of linear nearest neighbor scans, so it uses the SIMD instructions enabled by the compiler (SSE2, AVX, NEON).
+    \param pquery dof values of the query configuration
+    \param pconfigs numconfigs*dof values, the configurations one after the other
+    \param numconfigs number of configurations in pconfigs
+    \param dof the number of values of each configuration
+    \param pweights2 dof squared weights
+    \param pdistances2 filled with the numconfigs squared distances
+ */
+OPENRAVE_API void ComputeWeightedDistances2(const dReal* pquery, const dReal* pconfigs, size_t numconfigs, int dof, const dReal* pweights2, dReal* pdistances2);
+
+/// \brief returns the squared weighted L2 distance between two configurations, see \ref ComputeWeightedDistances2
+OPENRAVE_API dReal ComputeWeightedDistance2(const dReal* pconfig0, const dReal* pconfig1, int dof, const dReal* pweights2);
+
 /// \brief simple distance metric based on joint weights
 class OPENRAVE_API SimpleDistanceMetric
 {
@@ -580,13 +832,26 @@ public:
     virtual IkReturnPtr Sample();
     virtual bool Sample(std::vector<dReal>& vgoal);
 
+    /// \brief called with every new sample of SampleAll and the index of its ik parameterization. Return false to stop sampling.
+    typedef boost::function<bool (IkReturnPtr, int)> SampleCallbackFn;
+
     /// \brief samples the rests of the samples until cannot be sampled anymore.
     ///
     /// \param vsamples vector is rest with samples
     /// \param maxsamples max successful samples to gather before returning. If 0, will gather all.
     /// \param maxchecksamples max samples to check before returning. If 0, will check all.
+    /// \param fncallback if set, is called from the calling thread as soon as each sample is found, so planners can start before sampling finishes.
     /// \return true if a sample was inserted into vsamples
-    bool SampleAll(std::list<IkReturnPtr>& samples, int maxsamples=0, int maxchecksamples=0);
+    bool SampleAll(std::list<IkReturnPtr>& samples, int maxsamples=0, int maxchecksamples=0, const SampleCallbackFn& fncallback=SampleCallbackFn());
+
+    /// \brief sets the number of threads SampleAll distributes the ik parameterizations to.
+    ///
+    /// Every thread solves on its own clone of the robot's environment with a clone of the manipulator's ik solver.
+    /// The clones are kept between calls and synchronized with the environment at the start of each SampleAll.
+    /// Custom ik filters registered on the original ik solver are not run by the threads.
+    /// A parallel SampleAll consumes all the remaining parameterizations even when it stops early.
+    /// \param numthreads if <= 1, SampleAll samples serially
+    virtual void SetNumThreads(int numthreads);
 
     //void SetCheckPathConstraintsFn(const PlannerBase::PlannerParameters::CheckPathConstraintFn& checkfn)
 
@@ -600,6 +865,14 @@ public:
     virtual void SetJitter(dReal maxdist);
 
 protected:
+    struct ParallelSampleState;
+
+    /// \brief SampleAll when _nNumThreads > 1
+    bool _SampleAllParallel(std::list<IkReturnPtr>& samples, int maxsamples, int maxchecksamples, const SampleCallbackFn& fncallback);
+
+    /// \brief samples all the parameterizations of pworker and sends the results to pstate. Runs in its own thread.
+    static void _SampleAllWorker(boost::shared_ptr<ManipulatorIKGoalSampler> pworker, const std::vector<int>& vorgindices, boost::shared_ptr<ParallelSampleState> pstate);
+
     struct SampleInfo
     {
         IkParameterization _ikparam;
@@ -624,10 +897,66 @@ protected:
     int _ikfilteroptions;
     bool _searchfreeparameters;
     std::vector<dReal> _vfreegoalvalues;
+    int _nNumThreads; ///< number of threads for SampleAll
+    std::vector<EnvironmentBasePtr> _vthreadenvs; ///< environment clones used by the threads of SampleAll
+    std::vector<IkSolverBasePtr> _vthreadiksolvers; ///< ik solvers set on the manipulators of _vthreadenvs
 };
 
 typedef boost::shared_ptr<ManipulatorIKGoalSampler> ManipulatorIKGoalSamplerPtr;
 
+/** \brief Runs PlannerBase::PlanPath of an initialized planner on a worker thread so the calling thread does not block. <b>[multi-thread safe]</b>
+
+    The environment of the planner is cloned in the constructor, the worker creates a planner of the same type in the clone and initializes it with a copy of the parameters of the original planner.
+    Only the xml data of the parameters is transferred, so custom constraint functions set on the original parameters are replaced by the defaults of the configuration specification.
+    The worker never touches the original environment, several handles can plan concurrently for different robots of the same environment.
+ */
+class OPENRAVE_API AsyncPlanPath
+{
+public:
+    /// \param planner planner whose InitPlan succeeded, its environment has to be locked by the caller
+    /// \param robot robot passed to InitPlan, it is looked up by name in the clone. Can be empty
+    /// \param planningoptions passed to PlanPath
+    AsyncPlanPath(PlannerBasePtr planner, RobotBasePtr robot, int planningoptions=0);
+
+    /// \brief cancels the plan and waits for the worker to return
+    virtual ~AsyncPlanPath();
+
+    /// \brief true if PlanPath of the worker returned
+    virtual bool IsDone() const;
+
+    /// \brief waits for the worker to return
+    ///
+    /// \param timeout in ms, if 0 waits until the plan is done
+    /// \return true if the plan is done
+    virtual bool Wait(uint32_t timeout=0);
+
+    /// \brief interrupts the plan at the next callback of the planner, the status becomes PS_Interrupted
+    virtual void Cancel();
+
+    /// \brief the progress the planner passed to its last callback
+    virtual PlannerBase::PlannerProgress GetProgress() const;
+
+    /// \brief waits for the plan and copies the planned trajectory into traj
+    ///
+    /// \param traj if not empty and the plan has a solution, is set to the trajectory of the worker
+    /// \return the status of the worker's PlanPath
+    virtual PlannerStatus GetResult(TrajectoryBasePtr traj=TrajectoryBasePtr());
+
+protected:
+    struct AsyncPlanState;
+
+    /// \brief initializes the planner of the clone and plans. Runs in its own thread.
+    static void _PlanWorker(boost::shared_ptr<AsyncPlanState> pstate);
+
+    boost::shared_ptr<AsyncPlanState> _pstate;
+    boost::shared_ptr<boost::thread> _pthread;
+};
+
+typedef boost::shared_ptr<AsyncPlanPath> AsyncPlanPathPtr;
+
+/// \brief starts planning with planner on a worker thread, see \ref AsyncPlanPath
+OPENRAVE_API AsyncPlanPathPtr PlanPathAsync(PlannerBasePtr planner, RobotBasePtr robot, int planningoptions=0);
+
 } // planningutils
 } // OpenRAVE
 
@@ -0,0 +1,98 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** \file profiling.h
+    \brief Lightweight tracing of scoped spans that can be exported as a Chrome trace. This file is automatically included by openrave.h.
+
+    Spans are only recorded when profiling is enabled with \ref RaveSetProfilingEnabled or by setting the OPENRAVE_PROFILE_FILE
+    environment variable to the file the trace should be written to when \ref RaveDestroy is called. When disabled, a span costs
+    one load and one branch. Defining OPENRAVE_DISABLE_PROFILING before including openrave removes the spans at compile time.
+
+    Every thread records into its own buffer, so spans from different threads do not contend. Spans of the same thread that are
+    inside each other are shown nested by the trace viewers (chrome://tracing or https://ui.perfetto.dev).
+ */
+#ifndef OPENRAVE_PROFILING_H
+#define OPENRAVE_PROFILING_H
+
+#include <atomic>
+
+namespace OpenRAVE {
+
+/// \brief true if spans are being recorded, use \ref RaveSetProfilingEnabled to change it
+OPENRAVE_API extern std::atomic<bool> g_bRaveProfilingEnabled;
+
+/// \brief starts or stops recording spans. Recorded spans are kept until \ref RaveClearProfilingSpans is called.
+OPENRAVE_API void RaveSetProfilingEnabled(bool bEnable);
+
+/// \brief returns true if spans are being recorded
+inline bool RaveIsProfilingEnabled() {
+    return g_bRaveProfilingEnabled.load(std::memory_order_relaxed);
+}
+
+/// \brief removes all the spans recorded so far by all threads
+OPENRAVE_API void RaveClearProfilingSpans();
+
+/// \brief writes all the recorded spans in the Chrome trace event JSON format
+OPENRAVE_API void RaveWriteProfilingChromeTrace(std::ostream& O);
+
+/// \brief writes all the recorded spans in the Chrome trace event JSON format to a file
+///
+/// \return true if the file could be written
+OPENRAVE_API bool RaveSaveProfilingChromeTrace(const std::string& filename);
+
+/// \brief records the time a scope took if profiling is enabled when the scope is entered.
+///
+/// The category and name are not copied, so they have to be string literals or outlive the recorded spans.
+class OPENRAVE_API ProfilingSpan
+{
+public:
+    ProfilingSpan(const char* category, const char* name) : _category(category), _name(name), _starttime(0), _brecording(false) {
+        if( RaveIsProfilingEnabled() ) {
+            _Start();
+        }
+    }
+    ~ProfilingSpan() {
+        if( _brecording ) {
+            _Stop();
+        }
+    }
+
+private:
+    ProfilingSpan(const ProfilingSpan&);
+    ProfilingSpan& operator=(const ProfilingSpan&);
+
+    void _Start();
+    void _Stop();
+
+    const char* _category;
+    const char* _name;
+    uint64_t _starttime; ///< ns from utils::GetNanoPerformanceTime
+    bool _brecording;
+};
+
+} // end namespace OpenRAVE
+
+#define OPENRAVE_PROFILING_CONCAT2(a, b) a ## b
+#define OPENRAVE_PROFILING_CONCAT(a, b) OPENRAVE_PROFILING_CONCAT2(a, b)
+
+#ifdef OPENRAVE_DISABLE_PROFILING
+#define OPENRAVE_PROFILE_SCOPE(category, name)
+#else
+/// \brief records the rest of the current scope as a span, for example OPENRAVE_PROFILE_SCOPE("kinbody", "SetDOFValues")
+#define OPENRAVE_PROFILE_SCOPE(category, name) OpenRAVE::ProfilingSpan OPENRAVE_PROFILING_CONCAT(_ravespan, __LINE__)(category, name)
+#endif
+
+#endif
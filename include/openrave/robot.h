@@ -328,6 +328,25 @@ public:
          */
         virtual bool CheckEndEffectorCollision(const IkParameterization& ikparam, CollisionReportPtr report = CollisionReportPtr(), int numredundantsamples=0) const;
 
+        /** \brief Checks environment collisions with only the gripper for many end-effector transforms at once. Ignores disabled links.
+
+            Equivalent to calling \ref CheckEndEffectorCollision for every transform, but the gripper links are computed once and are
+            moved in place for every pose instead of being saved and restored per link. The link transforms are restored at the end.
+            \param vtEE the end effector transforms
+            \param[out] vincollision filled with 1 for every transform of vtEE where the gripper is in collision, 0 otherwise
+            \return the number of transforms in collision
+         */
+        virtual int CheckEndEffectorCollisions(const std::vector<Transform>& vtEE, std::vector<uint8_t>& vincollision) const;
+
+        /** \brief Checks environment collisions with only the gripper for many ik parameterizations at once, see \ref CheckEndEffectorCollision
+
+            Transform6D parameterizations are checked together with \ref CheckEndEffectorCollisions.
+            \param[out] vincollision filled with 1 for every ik parameterization of vikparams where the gripper is in collision, 0 otherwise
+            \return the number of ik parameterizations in collision
+            \throw openrave_exception if the gripper location cannot be fully determined from one of the ik parameterizations.
+         */
+        virtual int CheckEndEffectorCollisions(const std::vector<IkParameterization>& vikparams, std::vector<uint8_t>& vincollision, int numredundantsamples=0) const;
+
         /** \brief Checks self-collisions with only the gripper given an IK parameterization of the gripper.
 
             Some IkParameterizations can fully determine the gripper 6DOF location. If the type is Transform6D or the manipulator arm DOF <= IkParameterization DOF, then this would be possible. In the latter case, an ik solver is required to support the ik parameterization.
@@ -413,6 +432,9 @@ protected:
 
         ManipulatorInfo _info; ///< user-set information
 private:
+        /// \brief fills the indices of the links that are checked by CheckEndEffectorCollision, the end effector and its rigidly attached links come first
+        void _GetEndEffectorCollisionLinkIndices(RobotBasePtr probot, std::vector<int>& vlinkindices) const;
+
         RobotBaseWeakPtr __probot;
         LinkPtr __pBase, __pEffector; ///< contains weak links to robot
         std::vector<int> __vgripperdofindices, __varmdofindices;
@@ -780,7 +802,9 @@ private:
     virtual void SetName(const std::string& name);
 
     virtual void SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t checklimits = 1, const std::vector<int>& dofindices = std::vector<int>());
+    virtual void SetDOFValues(const dReal* pJointValues, size_t dof, uint32_t checklimits = 1, const std::vector<int>& dofindices = std::vector<int>());
     virtual void SetDOFValues(const std::vector<dReal>& vJointValues, const Transform& transbase, uint32_t checklimits = 1);
+    virtual void SetDOFValues(const dReal* pJointValues, size_t dof, const Transform& transbase, uint32_t checklimits = 1);
 
     virtual void SetLinkTransformations(const std::vector<Transform>& transforms);
     virtual void SetLinkTransformations(const std::vector<Transform>& transforms, const std::vector<dReal>& doflastsetvalues);
@@ -921,7 +945,20 @@ private:
     }
 
     virtual void SetActiveDOFValues(const std::vector<dReal>& values, uint32_t checklimits=1);
+
+    /// \brief Sets the active dof values from an array.
+    ///
+    /// Once the internal buffers are allocated by the first call, no memory is allocated. If the active dofs are all the joints of the robot in order, the values are passed directly to \ref SetDOFValues.
+    /// \param pvalues the active dof values
+    /// \param dof the number of values in pvalues, has to be at least \ref GetActiveDOF
+    virtual void SetActiveDOFValues(const dReal* pvalues, size_t dof, uint32_t checklimits=1);
+
     virtual void GetActiveDOFValues(std::vector<dReal>& v) const;
+
+    /// \brief Returns the active dof values into an array without allocating memory.
+    ///
+    /// \param[out] pvalues has to hold \ref GetActiveDOF values
+    virtual void GetActiveDOFValues(dReal* pvalues) const;
     virtual void SetActiveDOFVelocities(const std::vector<dReal>& velocities, uint32_t checklimits=1);
     virtual void GetActiveDOFVelocities(std::vector<dReal>& velocities) const;
     virtual void GetActiveDOFLimits(std::vector<dReal>& lower, std::vector<dReal>& upper) const;
@@ -1157,6 +1194,7 @@ protected:
     Vector vActvAffineRotationAxis;
     int _nActiveDOF; ///< Active degrees of freedom; if -1, use robot dofs
     int _nAffineDOFs; ///< dofs describe what affine transformations are allowed
+    bool _bActiveDOFIndicesIdentity; ///< true if _vActiveDOFIndices[i] == i, so the joint values do not have to be remapped when all the joints are active. \see _UpdateActiveDOFMapping
 
     Vector _vTranslationLowerLimits, _vTranslationUpperLimits, _vTranslationMaxVels, _vTranslationResolutions, _vTranslationWeights;
     /// the xyz components are used if the rotation axis is solely about X,Y,or Z; otherwise the W component is used.
@@ -1174,7 +1212,12 @@ private:
         return OPENRAVE_KINBODY_HASH;
     }
     mutable std::string __hashrobotstructure;
+    /// \brief updates the precomputed information used to map the active dofs to the robot dofs, has to be called whenever _vActiveDOFIndices changes
+    void _UpdateActiveDOFMapping();
+
     mutable std::vector<dReal> _vTempRobotJoints;
+    mutable std::vector<dReal> _vTempActiveAffineValues; ///< affine part of the active dof values
+    mutable std::vector<dReal> _vTempActiveJacobian, _vTempActiveJacobianMatrix; ///< jacobians of the joints before they are copied into the active dof jacobians
 
 #ifdef RAVE_PRIVATE
 #ifdef _MSC_VER
@@ -50,6 +50,8 @@ public:
     class OPENRAVE_API SensorData
     {
 public:
+        SensorData() : __stamp(0), __sequence(0) {
+        }
         virtual ~SensorData() {
         }
         virtual SensorType GetType() = 0;
@@ -59,6 +61,7 @@ public:
 
         uint64_t __stamp;         ///< time stamp of the sensor data in microseconds. If 0, then the data is uninitialized! (floating-point precision is bad here). This can be either simulation or real time depending on the sensor.
         Transform __trans;             ///< the coordinate system the sensor was when the measurement was taken, this is taken directly from SensorBase::GetTransform
+        uint64_t __sequence;         ///< sequence number given by SensorDataRingBuffer::Publish, starts at 1 and increases by 1 with every published frame. 0 if the data was never published.
     };
     typedef boost::shared_ptr<SensorBase::SensorData> SensorDataPtr;
     typedef boost::shared_ptr<SensorBase::SensorData const> SensorDataConstPtr;
@@ -88,6 +91,7 @@ public:
             return ST_Camera;
         }
         std::vector<uint8_t> vimagedata;         ///< rgb image data, if camera only outputs in grayscale, fill each channel with the same value
+        std::vector<float> vdepthdata;         ///< depth along the optical axis of every pixel starting from the top row, 0 if nothing was hit. Empty if the camera does not measure depth
         virtual bool serialize(std::ostream& O) const;
     };
 
@@ -348,6 +352,49 @@ public:
         return PT_Sensor;
     }
 
+    /** \brief Ring buffer of the most recent published sensor data frames of one type, used by sensors to implement \ref GetLatestSensorData and \ref GetSensorDataFrames. <b>[multi-thread safe]</b>
+
+        A published frame is never modified again, so consumers can hold and read it from any thread without copying.
+        Frames that dropped out of the ring and are not held by any consumer anymore are handed out again by \ref AcquireFrame, so their memory is reused.
+     */
+    class OPENRAVE_API SensorDataRingBuffer
+    {
+public:
+        /// \param capacity the maximum number of published frames kept
+        SensorDataRingBuffer(size_t capacity=16);
+        virtual ~SensorDataRingBuffer() {
+        }
+
+        /// \brief returns a frame to be filled and then published. The frame can contain the data of an old frame.
+        ///
+        /// \param fncreate called to create a new frame if no released frame can be reused
+        SensorDataPtr AcquireFrame(const boost::function<SensorDataPtr()>& fncreate);
+
+        /// \brief gives the next sequence number to pframe and makes it the latest frame. pframe should not be modified afterwards.
+        void Publish(SensorDataPtr pframe);
+
+        /// \brief returns the latest frame, or empty if nothing was published
+        SensorDataConstPtr GetLatest() const;
+
+        /// \brief gets the buffered frames with a sequence number greater than sequence, oldest first
+        ///
+        /// \return the number of frames published after sequence that were already dropped from the ring
+        int GetFramesSince(uint64_t sequence, std::vector<SensorDataConstPtr>& vframes) const;
+
+        /// \brief drops all frames, sequence numbering continues
+        void Clear();
+
+        void SetCapacity(size_t capacity);
+        size_t GetCapacity() const;
+
+private:
+        mutable boost::mutex _mutex;
+        std::deque<SensorDataPtr> _dequeframes; ///< published frames, oldest first
+        std::vector<SensorDataPtr> _vpool; ///< frames dropped from the ring, reused once no consumer holds them
+        size_t _capacity;
+        uint64_t _nextsequence;
+    };
+
     /// \brief A set of commands used for run-time sensor configuration.
     enum ConfigureCommand
     {
@@ -396,6 +443,25 @@ public:
     /// psensordata->GetType() in order to return the correctly supported type.
     virtual bool GetSensorData(SensorDataPtr psensordata) = 0;
 
+    /// \brief Returns the most recent published data of the sensor without copying it. This method is thread safe.
+    ///
+    /// The sensor never modifies the data once published, so the caller can hold it and read it from any thread.
+    /// \param type the requested sensor type. If ST_Invalid, then returns the type most representative of this sensor.
+    /// \return the latest frame, or empty if the sensor does not publish frames of that type or has not published any yet
+    virtual SensorDataConstPtr GetLatestSensorData(SensorType type=ST_Invalid) {
+        return SensorDataConstPtr();
+    }
+
+    /// \brief Gets the frames published after a sequence number that the sensor still buffers, oldest first. This method is thread safe.
+    ///
+    /// Streaming consumers pass the \ref SensorData::__sequence of the last frame they received, or 0 for all buffered frames.
+    /// \param[out] vframes the frames with a sequence number greater than sequence
+    /// \return the number of frames published after sequence that are not buffered anymore, 0 if nothing was lost
+    virtual int GetSensorDataFrames(SensorType type, uint64_t sequence, std::vector<SensorDataConstPtr>& vframes) {
+        vframes.resize(0);
+        return 0;
+    }
+
     /// \brief returns true if sensor supports a particular sensor type
     virtual bool Supports(SensorType type) = 0;
 
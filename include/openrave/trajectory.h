@@ -78,6 +78,17 @@ public:
      */
     virtual void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, bool reintializeData=true) const;
 
+    /** \brief samples a data point like \ref Sample(std::vector<dReal>&, dReal, const ConfigurationSpecification&, bool) const starting the waypoint search from a hint.
+
+        Meant for callers sampling at increasing times, like controllers following the trajectory, which keep the hint between the calls.
+        Every call then only moves the hint a few waypoints forward instead of searching all the waypoints. The default implementation ignores the hint.
+        \param data[out] the sampled point
+        \param time[in] the time to sample
+        \param spec[in] the specification format to return the data in
+        \param waypointhint[inout] the waypoint index set by the previous call, should be 0 for the first call. It is only a hint, so any value is valid.
+     */
+    virtual void SampleWithHint(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, size_t& waypointhint) const;
+
     /** \brief bulk samples the trajectory given a vector of times using the trajectory's specification.
 
         \param data[out] the sampled points depending on the times
@@ -94,6 +105,26 @@ public:
      */
     virtual void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const;
 
+    /** \brief bulk samples the trajectory at uniformly spaced times using the trajectory's specification.
+
+        Same as SamplePoints with the times starttime, starttime+timestep, ..., starttime+(numpoints-1)*timestep.
+        \param data[out] the sampled points, numpoints*GetConfigurationSpecification().GetDOF() values
+        \param starttime[in] the time of the first sample
+        \param timestep[in] the time between two consecutive samples
+        \param numpoints[in] the number of samples
+     */
+    virtual void SampleRange(std::vector<dReal>& data, dReal starttime, dReal timestep, size_t numpoints) const;
+
+    /** \brief bulk samples the trajectory at uniformly spaced times and a specific configuration specification.
+
+        \param data[out] the sampled points, numpoints*spec.GetDOF() values
+        \param starttime[in] the time of the first sample
+        \param timestep[in] the time between two consecutive samples
+        \param numpoints[in] the number of samples
+        \param spec[in] the specification format to return the data in
+     */
+    virtual void SampleRange(std::vector<dReal>& data, dReal starttime, dReal timestep, size_t numpoints, const ConfigurationSpecification& spec) const;
+
     virtual const ConfigurationSpecification& GetConfigurationSpecification() const = 0;
 
     /// \brief return the number of waypoints
@@ -147,6 +178,14 @@ public:
         GetWaypoints(index,index+1,data,spec);
     }
 
+    /** \brief returns the waypoints stored contiguously in the configuration specification of the trajectory, or NULL if the trajectory does not store them this way.
+
+        GetNumWaypoints()*GetConfigurationSpecification().GetDOF() values can be read. The pointer is only valid until the trajectory is modified or destroyed.
+     */
+    virtual const dReal* GetWaypointsData() const {
+        return NULL;
+    }
+
     /// \brief returns the nearest waypoint index that is before the designated time.
     ///
     /// If time is before the first waypoint's time, then will return 0. If time >= GetDuration(), will return GetNumWaypoints()
@@ -145,6 +145,21 @@ inline static uint64_t GetNanoPerformanceTime()
 
 #endif
 
+/// \brief adds the nanoseconds from its construction to its destruction as one sample to a performance counter
+class PerfCounterTimer
+{
+public:
+    PerfCounterTimer(PerfCounter& counter) : _counter(counter), _starttime(GetNanoPerformanceTime()) {
+    }
+    ~PerfCounterTimer() {
+        _counter.Add(GetNanoPerformanceTime()-_starttime);
+    }
+
+private:
+    PerfCounter& _counter;
+    uint64_t _starttime;
+};
+
 struct null_deleter
 {
     void operator()(void const *) const {
@@ -41,6 +41,16 @@ public:
     virtual void SetTransform(const RaveTransform<float>& t) OPENRAVE_DUMMY_IMPLEMENTATION;
     /// \brief Shows or hides the plot without destroying its resources. <b>[multi-thread safe]</b>
     virtual void SetShow(bool bshow) OPENRAVE_DUMMY_IMPLEMENTATION;
+
+    /// \brief Replaces the points of a plot created with plot3, drawlinestrip, or drawlinelist, reusing its scene node and vertex buffers. <b>[multi-thread safe]</b>
+    ///
+    /// Point size, line width, and transform of the plot are kept. Use this to update large point clouds every frame instead of destroying and creating plots.
+    /// \param ppoints array of points, the layout is the same as for \ref EnvironmentBase::plot3
+    /// \param colors if not NULL, the 3 values (or 4 if bhasalpha) of the color of every point. If NULL, the current colors are kept, which requires that numPoints does not change when the plot has a color per point.
+    /// \return false if the plot cannot be updated in place, then it has to be drawn again
+    virtual bool SetPoints(const float* ppoints, int numPoints, int stride, const float* colors=NULL, bool bhasalpha=false) {
+        return false;
+    }
 };
 
 typedef boost::shared_ptr<GraphHandle> GraphHandlePtr;
@@ -57,6 +57,46 @@ public:
 
 typedef boost::shared_ptr<HierarchicalXMLReadable> HierarchicalXMLReadablePtr;
 
+/// \brief parses the whitespace separated numbers of xml character data into a vector while the data arrives
+///
+/// Only the unfinished number at the end of a chunk is kept between calls, so large arrays are never copied into a
+/// stringstream. Numbers are always parsed with '.' as the decimal point independent of the locale.
+class OPENRAVE_API NumberArrayParser
+{
+public:
+    NumberArrayParser();
+
+    /// \brief clears the unfinished number and the failed state, call when a new element starts
+    void Reset();
+
+    /// \brief parses the complete numbers of the chunk and appends them to vvalues
+    ///
+    /// Once a string that is not a number is found, the rest of the data is ignored like when reading from a stream.
+    void Parse(const char* pdata, size_t len, std::vector<dReal>& vvalues);
+
+    /// \brief parses the number at the end of the data, has to be called when the element ends
+    void Finish(std::vector<dReal>& vvalues);
+
+    /// \brief parses all the numbers of a complete array and appends them to vvalues, same as calling Reset, Parse and Finish
+    ///
+    /// Arrays of several megabytes are cut at whitespace into parts that are parsed on separate threads.
+    void ParseAll(const char* pdata, size_t len, std::vector<dReal>& vvalues);
+
+    /// \brief true if a string that is not a number was found
+    inline bool IsFailed() const {
+        return _bFailed;
+    }
+
+protected:
+    void _ParseNumber(const char* pstart, const char* pend, std::vector<dReal>& vvalues);
+
+    static void _ParsePart(const char* pstart, const char* pend, std::vector<dReal>& vvalues, uint8_t& bfailed);
+
+    std::string _unfinished; ///< the characters of the number that was cut off at the end of the last chunk
+    std::istringstream _ssfallback; ///< parses numbers that cannot be converted exactly by the fast path
+    bool _bFailed;
+};
+
 /// \brief create a xml parser for trajectories
 class OPENRAVE_API TrajectoryReader : public BaseXMLReader
 {
@@ -80,7 +120,10 @@ protected:
     BaseXMLReaderPtr _pcurreader;
     int _datacount;
     std::vector<dReal> _vdata;
+    NumberArrayParser _dataparser; ///< parses the <data> element into _vdata
+    std::string _sdata; ///< characters of the <data> element, parsed at once when the element ends so that large arrays can be parsed in parallel
     bool _bInReadable;
+    bool _bInData;
 };
 
 typedef boost::shared_ptr<TrajectoryReader> TrajectoryReaderPtr;
@@ -118,6 +161,9 @@ protected:
     KinBody::GeometryInfoPtr _pgeom;
     std::stringstream _ss;
     BaseXMLReaderPtr _pcurreader;
+    std::vector<dReal> _vvertexvalues;
+    NumberArrayParser _vertexparser; ///< parses the <vertices> element directly into _vvertexvalues
+    bool _bInVertices;
 
     bool _bOverwriteDiffuse, _bOverwriteAmbient, _bOverwriteTransparency;
     std::string _sGroupName;
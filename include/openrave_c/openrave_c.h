@@ -211,6 +211,52 @@ OPENRAVE_C_API void ORCBodyGetTransformMatrix(void* body, OpenRAVEReal* matrix);
 /// \param trimesh returned from ORCTriMeshCreate()
 OPENRAVE_C_API int ORCBodyInitFromTrimesh(void* body, void* trimesh, int visible);
 
+/// \brief Calls \ref KinBody::GetLinkTransformations
+///
+/// \param[out] poses 7 values of the quaternion (4) and translation (3) for every link, has to hold 7*number of links values
+OPENRAVE_C_API void ORCBodyGetLinkTransforms(void* body, OpenRAVEReal* poses);
+
+//@}
+
+/// \name Batched queries
+///
+/// The functions lock the environment once for the whole batch and work on buffers of the caller.
+/// The bodies are restored to their state before the call, unless the function sets the states.
+//@{
+
+/// \brief Sets the DOF values and transforms of several bodies
+///
+/// \param[in] bodies the bodies to set
+/// \param[in] poses if not NULL, 7 values of the quaternion (4) and translation (3) for every body
+/// \param[in] dofvalues if not NULL, the DOF values of all the bodies one after the other
+OPENRAVE_C_API void ORCBodiesSetStates(void** bodies, int numbodies, const OpenRAVEReal* poses, const OpenRAVEReal* dofvalues);
+
+/// \brief Computes the link transforms of a body for several DOF configurations
+///
+/// \param[in] dofvalues numconfigs*DOF values
+/// \param[out] poses numconfigs*number of links*7 values, the quaternion (4) and translation (3) of every link of every configuration
+OPENRAVE_C_API void ORCBodyComputeLinkTransformsBatch(void* body, const OpenRAVEReal* dofvalues, int numconfigs, OpenRAVEReal* poses);
+
+/// \brief Checks a body for collisions with the environment at several DOF configurations
+///
+/// Gives the same results as setting every configuration with KinBody::CLA_CheckLimits and calling EnvironmentBase::CheckCollision and KinBody::CheckSelfCollision.
+/// The configurations inside the DOF limits are checked with CollisionCheckerBase::CheckCollisionConfigurations.
+/// \param[in] dofvalues numconfigs*DOF values
+/// \param checkself if 1, also checks for self collisions
+/// \param[out] results numconfigs values, 1 if the configuration is in collision, 0 otherwise
+/// \return the number of configurations in collision
+OPENRAVE_C_API int ORCBodyCheckCollisionBatch(void* body, const OpenRAVEReal* dofvalues, int numconfigs, int checkself, int* results);
+
+/// \brief Calls \ref RobotBase::Manipulator::FindIKSolution with a Transform6D ik parameterization for several end effector poses
+///
+/// \param manipname the manipulator to use, if NULL or empty uses the active manipulator
+/// \param[in] poses numposes*7 values, the quaternion (4) and translation (3) of the end effector in the world
+/// \param filteroptions the \ref IkFilterOptions
+/// \param[out] solutions numposes*number of arm joints values, solutions that were not found are left untouched
+/// \param[out] results numposes values, 1 if a solution was found, 0 otherwise
+/// \return the number of solutions found, -1 if the manipulator cannot be used
+OPENRAVE_C_API int ORCRobotFindIKSolutionsBatch(void* robot, const char* manipname, const OpenRAVEReal* poses, int numposes, int filteroptions, OpenRAVEReal* solutions, int* results);
+
 //@}
 
 /// \name \ref KinBody::Link methods
@@ -28,7 +28,9 @@ If \ref ControllerBase::SetPath is called and the trajectory finishes, then the
 1. ControllerBase::SetPath is called.\n\n\
 2. ControllerBase::SetDesired is called.\n\n\
 3. ControllerBase::Reset is called resetting everything\n\n\
-If SetDesired is called, only joint values will be set at every timestep leaving the transformation alone.\n";
+If SetDesired is called, only joint values will be set at every timestep leaving the transformation alone.\n\n\
+Trajectories that support the 'IsFinished' command (like StreamingTrajectory) are followed directly instead of being copied, \
+so waypoints appended while executing are also executed. The controller waits at the end of such a trajectory until it is finished.\n";
         RegisterCommand("Pause",boost::bind(&IdealController::_Pause,this,_1,_2),
                         "pauses the controller from reacting to commands ");
         RegisterCommand("SetCheckCollisions",boost::bind(&IdealController::_SetCheckCollisions,this,_1,_2),
@@ -40,6 +42,9 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         _fCommandTime = 0;
         _fSpeed = 1;
         _nControlTransformation = 0;
+        _bStreamingTraj = false;
+        _nTrajWaypointHint = 0;
+        _nJointValuesOffset = _nTransformOffset = -1;
     }
     virtual ~IdealController() {
     }
@@ -181,6 +186,9 @@ If SetDesired is called, only joint values will be set at every timestep leaving
                 }
             }
             _samplespec.ResetGroupOffsets();
+            // joint values and transform are extracted at every step, so find their offsets once instead of parsing the group names
+            _nJointValuesOffset = _bTrajHasJoints ? _samplespec._vgroups.at(0).offset : -1;
+            _nTransformOffset = _bTrajHasTransform ? _samplespec._vgroups.at(_bTrajHasJoints ? 1 : 0).offset : -1;
             _vgrablinks.resize(0);
             _vgrabbodylinks.resize(0);
             int dof = _samplespec.GetDOF();
@@ -244,8 +252,17 @@ If SetDesired is called, only joint values will be set at every timestep leaving
                 ptraj->serialize(flog);
             }
 
-            _ptraj = RaveCreateTrajectory(GetEnv(),ptraj->GetXMLId());
-            _ptraj->Clone(ptraj,0);
+            TrajectoryBasePtr pstreamingtraj = boost::const_pointer_cast<TrajectoryBase>(ptraj);
+            _bStreamingTraj = pstreamingtraj->SupportsCommand("IsFinished");
+            if( _bStreamingTraj ) {
+                // waypoints are still being appended (like StreamingTrajectory), so follow the trajectory itself instead of a copy
+                _ptraj = pstreamingtraj;
+            }
+            else {
+                _ptraj = RaveCreateTrajectory(GetEnv(),ptraj->GetXMLId());
+                _ptraj->Clone(ptraj,0);
+            }
+            _nTrajWaypointHint = 0;
             _bIsDone = false;
         }
 
@@ -261,15 +278,16 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         TrajectoryBaseConstPtr ptraj = _ptraj; // because of multi-threading setting issues
         if( !!ptraj ) {
             RobotBasePtr probot = _probot.lock();
-            vector<dReal> sampledata;
-            ptraj->Sample(sampledata,_fCommandTime,_samplespec);
+            std::vector<dReal>& sampledata = _vsampledata;
+            ptraj->SampleWithHint(sampledata,_fCommandTime,_samplespec,_nTrajWaypointHint);
 
             // already sampled, so change the command times before before setting values
             // incase the below functions fail
             bool bIsDone = _bIsDone;
             if( _fCommandTime > ptraj->GetDuration() ) {
                 _fCommandTime = ptraj->GetDuration();
-                bIsDone = true;
+                // a streaming trajectory might still get more waypoints, so wait at its end until it is finished
+                bIsDone = !_bStreamingTraj || _IsStreamingTrajectoryFinished();
             }
             else {
                 _fCommandTime += _fSpeed * fTimeElapsed;
@@ -322,15 +340,16 @@ If SetDesired is called, only joint values will be set at every timestep leaving
                 }
             }
 
-            vector<dReal> vdofvalues;
+            // _samplespec has the joint values in the order of _dofindices, so they can be copied directly
+            std::vector<dReal>& vdofvalues = _vsampledofvalues;
+            vdofvalues.resize(0);
             if( _bTrajHasJoints && _dofindices.size() > 0 ) {
-                vdofvalues.resize(_dofindices.size());
-                _samplespec.ExtractJointValues(vdofvalues.begin(),sampledata.begin(), probot, _dofindices, 0);
+                vdofvalues.insert(vdofvalues.end(), sampledata.begin()+_nJointValuesOffset, sampledata.begin()+_nJointValuesOffset+_dofindices.size());
             }
 
             Transform t;
             if( _bTrajHasTransform && _nControlTransformation ) {
-                _samplespec.ExtractTransform(t,sampledata.begin(),probot);
+                RaveGetTransformFromAffineDOFValues(t,sampledata.begin()+_nTransformOffset,DOF_Transform);
                 if( vdofvalues.size() > 0 ) {
                     _SetDOFValues(vdofvalues,t, _fCommandTime > 0 ? fTimeElapsed : 0);
                 }
@@ -436,8 +455,7 @@ private:
     virtual void _SetDOFValues(const std::vector<dReal>&values, dReal timeelapsed)
     {
         RobotBasePtr probot = _probot.lock();
-        
-        vector<dReal> prevvalues, curvalues, curvel;
+        std::vector<dReal>& prevvalues = _vprevvalues, &curvalues = _vcurvalues, &curvel = _vcurvel;
         probot->GetDOFValues(prevvalues);
         curvalues = prevvalues;
         probot->GetDOFVelocities(curvel);
@@ -457,7 +475,7 @@ private:
     {
         RobotBasePtr probot = _probot.lock();
         BOOST_ASSERT(_nControlTransformation);
-        vector<dReal> prevvalues, curvalues, curvel;
+        std::vector<dReal>& prevvalues = _vprevvalues, &curvalues = _vcurvalues, &curvel = _vcurvel;
         probot->GetDOFValues(prevvalues);
         curvalues = prevvalues;
         probot->GetDOFVelocities(curvel);
@@ -485,7 +503,8 @@ private:
             }
         }
         if( timeelapsed > 0 ) {
-            vector<dReal> vdiff = curvalues;
+            std::vector<dReal>& vdiff = _vdiffvalues;
+            vdiff = curvalues;
             probot->SubtractDOFValues(vdiff,prevvalues);
             for(size_t i = 0; i < _vupper[1].size(); ++i) {
                 dReal maxallowed = timeelapsed * _vupper[1][i]+1e-6;
@@ -527,10 +546,22 @@ private:
         }
     }
 
+    /// \brief true if the streaming trajectory being followed will not get more waypoints
+    bool _IsStreamingTrajectoryFinished()
+    {
+        std::stringstream sout, sinput("IsFinished");
+        int finished = 1;
+        if( _ptraj->SendCommand(sout, sinput) ) {
+            sout >> finished;
+        }
+        return finished != 0;
+    }
+
     RobotBaseWeakPtr _probot;               ///< controlled body
     dReal _fSpeed;                    ///< how fast the robot should go
     TrajectoryBasePtr _ptraj;         ///< computed trajectory robot needs to follow in chunks of _pbody->GetDOF()
     bool _bTrajHasJoints, _bTrajHasTransform;
+    bool _bStreamingTraj; ///< if true, _ptraj is the trajectory passed to SetPath and waypoints might still be appended to it
     std::vector< pair<int, int> > _vgrablinks; /// (data offset, link index) pairs
     struct GrabBody
     {
@@ -545,6 +576,10 @@ private:
     };
     std::vector<GrabBody> _vgrabbodylinks;
     dReal _fCommandTime;
+    size_t _nTrajWaypointHint; ///< waypoint of the last sample of _ptraj, so sampling the next step does not search all the waypoints
+    int _nJointValuesOffset, _nTransformOffset; ///< offsets of the joint values and the transform in _samplespec, -1 if not sampled
+    std::vector<dReal> _vsampledata, _vsampledofvalues; ///< caches for SimulationStep
+    std::vector<dReal> _vprevvalues, _vcurvalues, _vcurvel, _vdiffvalues; ///< caches for _SetDOFValues
 
     std::vector<dReal> _vecdesired;         ///< desired values of the joints
     Transform _tdesired;
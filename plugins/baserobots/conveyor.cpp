@@ -16,6 +16,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "plugindefs.h"
 #include <openrave/xmlreaders.h>
+#include <openrave/utils.h>
+#include <boost/bind.hpp>
 
 class Conveyor : public RobotBase
 {
@@ -50,12 +52,42 @@ public:
             std::vector<dReal> vcurrentvalues(1); vcurrentvalues[0] = 0; // current values always 0
             Joint::_ComputeInternalInformation(plink0, plink1, Vector(), std::vector<Vector>(), vcurrentvalues);
         }
+
+        /// \brief evaluates the mimic equation of the joint without the time offset of the links, the result is normalized when circular
+        ///
+        /// \param pdofvalues the dof values of the robot
+        dReal ComputeBeltPosition(const dReal* pdofvalues)
+        {
+            const KinBody::Mimic& mimic = *_vmimic[0];
+            _vdependentvalues.resize(mimic._vdofformat.size());
+            for(size_t i = 0; i < mimic._vdofformat.size(); ++i) {
+                const KinBody::Mimic::DOFFormat& dofformat = mimic._vdofformat[i];
+                if( dofformat.dofindex >= 0 ) {
+                    _vdependentvalues[i] = pdofvalues[dofformat.dofindex];
+                }
+                else {
+                    _vdependentvalues[i] = dofformat.GetJoint(*GetParent())->GetValue(dofformat.axis);
+                }
+            }
+            if( _Eval(0, 0, _vdependentvalues, _veval) != 0 || _veval.size() == 0 ) {
+                RAVELOG_WARN_FORMAT("failed to evaluate belt position of %s", GetName());
+                return 0;
+            }
+            dReal fposition = _veval[0];
+            if( IsCircular(0) ) {
+                fposition = utils::NormalizeCircularAngle(fposition, dReal(0), _info._vupperlimit[0]);
+            }
+            return fposition;
+        }
+
+private:
+        std::vector<dReal> _vdependentvalues, _veval; ///< scratch buffers for ComputeBeltPosition
     };
 
     class ConveyorInfo : public XMLReadable
     {
 public:
-        ConveyorInfo() : XMLReadable("conveyorjoint"), _fLinkDensity(10), _bIsCircular(true), _bCreated(false) {
+        ConveyorInfo() : XMLReadable("conveyorjoint"), _fLinkDensity(10), _bIsCircular(true), _bAnalytic(false), _bCreated(false) {
         }
         boost::shared_ptr<KinBody::Mimic> _mimic; // always has to mimic
         KinBody::LinkPtr _linkParent; ///< base link attached
@@ -64,6 +96,7 @@ public:
         std::list<GeometryInfo> _listGeometries; ///< geometry to attach to each child link
         std::string _namebase; ///< base name of joint
         bool _bIsCircular;
+        bool _bAnalytic; ///< if true, the belt is one geometry of the parent link and carried items are moved from the belt position instead of creating links for each belt segment
 
         bool _bCreated;
     };
@@ -106,7 +139,7 @@ public:
                 return PE_Support;
             }
 
-            static boost::array<string, 6> tags = {{ "mimic_pos", "mimic_vel", "mimic_accel", "parentlink", "linkdensity", "circular" }};
+            static boost::array<string, 7> tags = {{ "mimic_pos", "mimic_vel", "mimic_accel", "parentlink", "linkdensity", "circular", "analytic" }};
             if( find(tags.begin(),tags.end(),name) == tags.end() ) {
                 return PE_Pass;
             }
@@ -156,6 +189,10 @@ public:
                 string s; _ss >> s;
                 _cmdata->_bIsCircular = !(s=="false" || s=="0");
             }
+            else if( name == "analytic" ) {
+                string s; _ss >> s;
+                _cmdata->_bAnalytic = !(s=="false" || s=="0");
+            }
             else if( name == "conveyorjoint" ) {
                 return true;
             }
@@ -190,7 +227,15 @@ protected:
     }
 
     Conveyor(EnvironmentBasePtr penv, std::istream& is) : RobotBase(penv) {
-        __description = ":Interface Author: Rosen Diankov\n\nParses conveyor joints as a trajectory and adds child links to form a full conveyor system. Use the <conveyorjoint> tag to specify the conveyor properties.";
+        __description = ":Interface Author: Rosen Diankov\n\nParses conveyor joints as a trajectory and adds child links to form a full conveyor system. Use the <conveyorjoint> tag to specify the conveyor properties.\n\nWhen <analytic>1</analytic> is set, the belt segments are merged into one geometry of the parent link and only one reference joint is created. Bodies placed on the belt with the AddItem command are then moved every simulation step from the belt position.";
+        RegisterCommand("AddItem",boost::bind(&Conveyor::_AddItemCommand,this,_1,_2),
+                        "format: bodyname [position]\n\nAttaches a body to the belt of an analytic conveyor so it moves with the belt. If the position along the trajectory is not specified, the closest one to the body is used. Bodies that reach the end of a non-circular conveyor are released.");
+        RegisterCommand("RemoveItem",boost::bind(&Conveyor::_RemoveItemCommand,this,_1,_2),
+                        "format: bodyname\n\nReleases a body from the belt, if no name is given releases all bodies.");
+        RegisterCommand("GetItems",boost::bind(&Conveyor::_GetItemsCommand,this,_1,_2),
+                        "Returns the names of the bodies on the belt and their position along the trajectory.");
+        RegisterCommand("GetBeltPosition",boost::bind(&Conveyor::_GetBeltPositionCommand,this,_1,_2),
+                        "Returns the current position of the belt along the trajectory.");
     }
     virtual ~Conveyor() {
     }
@@ -217,6 +262,9 @@ protected:
         if( !!_pController ) {
             _pController->SimulationStep(fElapsedTime);
         }
+        if( _vitems.size() > 0 ) {
+            _UpdateItems();
+        }
     }
 
     virtual void _ComputeInternalInformation()
@@ -233,6 +281,10 @@ protected:
             dReal curtime = 0;
             std::vector<dReal> vsampledata;
             Transform tparent = cmdata->_linkParent->GetTransform();
+            if( cmdata->_bAnalytic ) {
+                _CreateAnalyticBelt(cmdata, numchildlinks, timestep);
+                numchildlinks = 0;
+            }
             for(int ichild = 0; ichild < numchildlinks; ++ichild, curtime += timestep) {
                 boost::shared_ptr<ConveyorLink> pchildlink(new ConveyorLink(str(boost::format("__moving__%s%d")%cmdata->_namebase%ichild), tparent, shared_kinbody()));
                 pchildlink->InitGeometries(cmdata->_listGeometries);
@@ -261,9 +313,233 @@ protected:
     }
 
 protected:
+    /// \brief a body carried by the belt of an analytic conveyor
+    struct ConveyorItem
+    {
+        KinBodyWeakPtr _pbody;
+        dReal _fBeltOffset; ///< position of the body along the trajectory minus the belt position
+        Transform _trelative; ///< transform of the body in the belt frame at its position
+        size_t _waypointhint; ///< hint for sampling the trajectory at the position of the body
+    };
+
+    /// \brief merges the belt segments into one geometry of the parent link and creates the reference joint the belt position is computed from
+    void _CreateAnalyticBelt(ConveyorInfoPtr cmdata, int numsegments, dReal timestep)
+    {
+        _trajbelt = cmdata->_trajfollow;
+        _linkBeltParent = cmdata->_linkParent;
+        _fBeltDuration = _trajbelt->GetDuration();
+        _bBeltCircular = cmdata->_bIsCircular;
+        _nBeltAffineOffset = -1;
+        _nBeltAffineDOFs = 0;
+        _vBeltRotationAxis = Vector(0,0,1);
+        const ConfigurationSpecification& spec = _trajbelt->GetConfigurationSpecification();
+        FOREACHC(itgroup, spec._vgroups) {
+            if( itgroup->name.size() >= 16 && itgroup->name.substr(0,16) == "affine_transform" ) {
+                stringstream ss(itgroup->name.substr(16));
+                string bodyname;
+                ss >> bodyname >> _nBeltAffineDOFs;
+                if( !!ss ) {
+                    if( _nBeltAffineDOFs & DOF_RotationAxis ) {
+                        ss >> _vBeltRotationAxis.x >> _vBeltRotationAxis.y >> _vBeltRotationAxis.z;
+                    }
+                    _nBeltAffineOffset = itgroup->offset;
+                    break;
+                }
+            }
+        }
+        if( _nBeltAffineOffset < 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("conveyor %s trajectory does not have an affine_transform group", GetName(), ORE_InvalidArguments);
+        }
+
+        // the segment meshes in the local frame of the segment geometries
+        std::vector< std::pair<TriMesh, Transform> > vsegmentmeshes;
+        FOREACHC(itgeom, cmdata->_listGeometries) {
+            GeometryInfo ginfo = *itgeom;
+            ginfo.InitCollisionMesh();
+            vsegmentmeshes.push_back(std::make_pair(ginfo._meshcollision, ginfo._t));
+        }
+        if( vsegmentmeshes.size() > 0 ) {
+            KinBody::GeometryInfoPtr pbeltinfo(new KinBody::GeometryInfo(cmdata->_listGeometries.front()));
+            pbeltinfo->_type = GT_TriMesh;
+            pbeltinfo->_name = str(boost::format("__belt__%s")%cmdata->_namebase);
+            pbeltinfo->_t = Transform();
+            pbeltinfo->_filenamerender.clear();
+            pbeltinfo->_filenamecollision.clear();
+            pbeltinfo->_vRenderScale = Vector(1,1,1);
+            pbeltinfo->_vCollisionScale = Vector(1,1,1);
+            pbeltinfo->_meshcollision.vertices.clear();
+            pbeltinfo->_meshcollision.indices.clear();
+            dReal curtime = 0;
+            size_t waypointhint = 0;
+            for(int isegment = 0; isegment < numsegments; ++isegment, curtime += timestep) {
+                Transform tsegment = _SampleBelt(curtime, waypointhint);
+                FOREACHC(itmesh, vsegmentmeshes) {
+                    pbeltinfo->_meshcollision.Append(itmesh->first, tsegment*itmesh->second);
+                }
+            }
+            _linkBeltParent->AddGeometry(pbeltinfo, false);
+        }
+
+        // the reference joint has no geometry and follows the belt position without any offset
+        boost::shared_ptr<ConveyorLink> pbeltlink(new ConveyorLink(str(boost::format("__moving__%s")%cmdata->_namebase), _linkBeltParent->GetTransform(), shared_kinbody()));
+        _veclinks.push_back(pbeltlink);
+        boost::shared_ptr<KinBody::Mimic> mimic(new KinBody::Mimic());
+        *mimic = *cmdata->_mimic;
+        _pBeltJoint.reset(new ConveyorJoint(pbeltlink->GetName(), _trajbelt, mimic, _bBeltCircular, shared_kinbody()));
+        _vecjoints.push_back(_pBeltJoint);
+        _pBeltJoint->_ComputeInternalInformation(_linkBeltParent, pbeltlink, 0);
+    }
+
+    /// \brief returns the belt frame at a position of the trajectory in the parent link coordinate system
+    Transform _SampleBelt(dReal fposition, size_t& waypointhint)
+    {
+        _trajbelt->SampleWithHint(_vbeltsampledata, fposition, _trajbelt->GetConfigurationSpecification(), waypointhint);
+        Transform t;
+        RaveGetTransformFromAffineDOFValues(t, _vbeltsampledata.begin()+_nBeltAffineOffset, _nBeltAffineDOFs, _vBeltRotationAxis);
+        return t;
+    }
+
+    /// \brief moves all the carried bodies to their position on the belt, releases the ones that left a non-circular belt
+    void _UpdateItems()
+    {
+        if( !_pBeltJoint ) {
+            return;
+        }
+        dReal fbeltposition = _pBeltJoint->ComputeBeltPosition(GetDOFValuesArray());
+        Transform tparent = _linkBeltParent->GetTransform();
+        size_t inext = 0;
+        for(size_t iitem = 0; iitem < _vitems.size(); ++iitem) {
+            ConveyorItem& item = _vitems[iitem];
+            KinBodyPtr pbody = item._pbody.lock();
+            if( !pbody || pbody->GetEnvironmentId() == 0 ) {
+                continue;
+            }
+            dReal fposition = fbeltposition + item._fBeltOffset;
+            if( _bBeltCircular ) {
+                fposition = utils::NormalizeCircularAngle(fposition, dReal(0), _fBeltDuration);
+            }
+            else if( fposition < 0 || fposition > _fBeltDuration ) {
+                RAVELOG_VERBOSE_FORMAT("body %s left conveyor %s", pbody->GetName()%GetName());
+                continue;
+            }
+            pbody->SetTransform(tparent*_SampleBelt(fposition, item._waypointhint)*item._trelative);
+            if( inext != iitem ) {
+                _vitems[inext] = item;
+            }
+            ++inext;
+        }
+        _vitems.resize(inext);
+    }
+
+    bool _AddItemCommand(std::ostream& sout, std::istream& sinput)
+    {
+        if( !_pBeltJoint ) {
+            RAVELOG_WARN_FORMAT("conveyor %s is not analytic, cannot add items", GetName());
+            return false;
+        }
+        string bodyname;
+        sinput >> bodyname;
+        KinBodyPtr pbody = GetEnv()->GetKinBody(bodyname);
+        if( !pbody ) {
+            RAVELOG_WARN_FORMAT("failed to find body %s", bodyname);
+            return false;
+        }
+        Transform tparent = _linkBeltParent->GetTransform();
+        Transform tbody = pbody->GetTransform();
+        ConveyorItem item;
+        item._pbody = pbody;
+        item._waypointhint = 0;
+        dReal fposition = 0;
+        sinput >> fposition;
+        if( !sinput ) {
+            // search the closest position of the trajectory to the body
+            Vector vlocal = tparent.inverse()*tbody.trans;
+            dReal fbestdist = 1e30;
+            size_t waypointhint = 0;
+            int numsteps = max(1, static_cast<int>(_fBeltDuration*100));
+            for(int istep = 0; istep <= numsteps; ++istep) {
+                dReal fcurposition = _fBeltDuration*istep/numsteps;
+                dReal fdist = (_SampleBelt(fcurposition, waypointhint).trans - vlocal).lengthsqr3();
+                if( fdist < fbestdist ) {
+                    fbestdist = fdist;
+                    fposition = fcurposition;
+                }
+            }
+        }
+        item._trelative = (tparent*_SampleBelt(fposition, item._waypointhint)).inverse()*tbody;
+        item._fBeltOffset = fposition - _pBeltJoint->ComputeBeltPosition(GetDOFValuesArray());
+        for(size_t iitem = 0; iitem < _vitems.size(); ++iitem) {
+            if( _vitems[iitem]._pbody.lock() == pbody ) {
+                _vitems[iitem] = item;
+                return true;
+            }
+        }
+        _vitems.push_back(item);
+        return true;
+    }
+
+    bool _RemoveItemCommand(std::ostream& sout, std::istream& sinput)
+    {
+        string bodyname;
+        sinput >> bodyname;
+        if( bodyname.size() == 0 ) {
+            _vitems.clear();
+            return true;
+        }
+        for(size_t iitem = 0; iitem < _vitems.size(); ++iitem) {
+            KinBodyPtr pbody = _vitems[iitem]._pbody.lock();
+            if( !!pbody && pbody->GetName() == bodyname ) {
+                _vitems.erase(_vitems.begin()+iitem);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool _GetItemsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        if( !_pBeltJoint ) {
+            return false;
+        }
+        dReal fbeltposition = _pBeltJoint->ComputeBeltPosition(GetDOFValuesArray());
+        FOREACHC(ititem, _vitems) {
+            KinBodyPtr pbody = ititem->_pbody.lock();
+            if( !!pbody ) {
+                dReal fposition = fbeltposition + ititem->_fBeltOffset;
+                if( _bBeltCircular ) {
+                    fposition = utils::NormalizeCircularAngle(fposition, dReal(0), _fBeltDuration);
+                }
+                sout << pbody->GetName() << " " << fposition << " ";
+            }
+        }
+        return true;
+    }
+
+    bool _GetBeltPositionCommand(std::ostream& sout, std::istream& sinput)
+    {
+        if( !_pBeltJoint ) {
+            return false;
+        }
+        sout << _pBeltJoint->ComputeBeltPosition(GetDOFValuesArray());
+        return true;
+    }
+
     TrajectoryBaseConstPtr _trajcur;
     ControllerBasePtr _pController;
 
+    /// \name analytic belt, only set when the conveyor is analytic
+    //@{
+    boost::shared_ptr<ConveyorJoint> _pBeltJoint; ///< reference joint the belt position is computed from
+    TrajectoryBasePtr _trajbelt;
+    LinkPtr _linkBeltParent;
+    dReal _fBeltDuration;
+    bool _bBeltCircular;
+    int _nBeltAffineOffset, _nBeltAffineDOFs; ///< where the belt transform is in the trajectory data
+    Vector _vBeltRotationAxis;
+    std::vector<ConveyorItem> _vitems; ///< bodies carried by the belt
+    std::vector<dReal> _vbeltsampledata;
+    //@}
+
     static UserDataPtr s_registeredhandle;
 };
 
@@ -1673,3 +1673,100 @@ int HaltonSampler::s_len_trim ( char *s )
     return n;
 }
 //****************************************************************************80
+
+void HaltonSampler::_UpdateStreams()
+{
+    int dim_num = halton_dim_num_get();
+    int leap = 1;
+    if( _nNumStreams > 1 ) {
+        // the leap has to be a prime that is not one of the bases, otherwise the subsequences only cover part of the space
+        leap = max(_nNumStreams, halton_BASE[dim_num-1]+1);
+        for(;; ++leap) {
+            bool bprime = true;
+            for(int divisor = 2; divisor*divisor <= leap; ++divisor) {
+                if( leap % divisor == 0 ) {
+                    bprime = false;
+                    break;
+                }
+            }
+            if( bprime ) {
+                break;
+            }
+        }
+    }
+    vector<int> vseed(dim_num, _nNumStreams > 1 ? _nStreamIndex+1 : 0), vleap(dim_num, leap);
+    halton_seed_set(&vseed[0]);
+    halton_leap_set(&vleap[0]);
+
+    _vshift.resize(0);
+    if( _nScrambleSeed != 0 ) {
+        // splitmix64 of the seed, the shift of all streams is the same so they stay disjoint
+        uint64_t state = _nScrambleSeed;
+        _vshift.resize(dim_num);
+        for(int i = 0; i < dim_num; ++i) {
+            state += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            _vshift[i] = (dReal)(z >> 11) * (dReal)(1.0/9007199254740992.0);
+        }
+    }
+}
+
+void HaltonSampler::_HaltonSequenceBulk(size_t n, dReal r[])
+{
+    int dim_num = halton_dim_num_get();
+    for(int i = 0; i < dim_num; ++i) {
+        // the radical inverse is kept as an integer over base^numdigits so that adding the leap is exact
+        uint64_t base = halton_BASE[i];
+        int numdigits = 0;
+        uint64_t denominator = 1;
+        while( denominator <= std::numeric_limits<uint64_t>::max()/base ) {
+            denominator *= base;
+            ++numdigits;
+        }
+        _vdigits.assign(numdigits, 0);
+        _vleapdigits.assign(numdigits, 0);
+        _vweights.resize(numdigits);
+        uint64_t weight = denominator;
+        for(int k = 0; k < numdigits; ++k) {
+            weight /= base;
+            _vweights[k] = weight;
+        }
+
+        uint64_t index = (uint64_t)halton_SEED[i] + (uint64_t)halton_STEP*(uint64_t)halton_LEAP[i];
+        uint64_t numerator = 0;
+        for(int k = 0; k < numdigits && index > 0; ++k) {
+            _vdigits[k] = index % base;
+            numerator += _vdigits[k]*_vweights[k];
+            index /= base;
+        }
+        uint64_t leap = halton_LEAP[i];
+        int numleapdigits = 0;
+        for(; numleapdigits < numdigits && leap > 0; ++numleapdigits) {
+            _vleapdigits[numleapdigits] = leap % base;
+            leap /= base;
+        }
+
+        dReal finvdenominator = (dReal)(1.0/(double)denominator);
+        dReal fshift = _vshift.size() > 0 ? _vshift[i] : dReal(0);
+        dReal* pvalue = r+i;
+        for(size_t j = 0; j < n; ++j, pvalue += dim_num) {
+            dReal f = (dReal)numerator*finvdenominator + fshift;
+            *pvalue = f >= 1 ? f-1 : f;
+
+            uint64_t carry = 0;
+            for(int k = 0; k < numdigits && (k < numleapdigits || carry > 0); ++k) {
+                uint64_t digit = _vdigits[k] + _vleapdigits[k] + carry;
+                carry = digit >= base;
+                if( carry ) {
+                    digit -= base;
+                }
+                numerator = numerator - _vdigits[k]*_vweights[k] + digit*_vweights[k];
+                _vdigits[k] = digit;
+            }
+        }
+    }
+    halton_STEP += (int)n;
+}
@@ -15,6 +15,7 @@
 #define SAMPLER_HALTON
 
 #include <openrave/openrave.h>
+#include <boost/bind.hpp>
 using namespace OpenRAVE;
 using namespace std;
 
@@ -28,7 +29,11 @@ References:\n\n\
 1. John Halton, On the efficiency of certain quasi-random sequences of points in evaluating multi-dimensional integrals, Numerische Mathematik, Volume 2, 1960, pages 84-90.\n\n\
 2. John Halton, GB Smith, Algorithm 247: Radical-Inverse Quasi-Random Point Sequence, Communications of the ACM, Volume 7, 1964, pages 701-702.\n\n\
 3. Ladislav Kocis, William Whiten, Computational Investigations of Low-Discrepancy Sequences, ACM Transactions on Mathematical Software, Volume 23, Number 2, 1997, pages 266-294.\n\n\
+A non-zero seed scrambles the sequence by a random shift of every dimension. Threads that need their own sequence should each create a sampler and call SetStream, every stream is a disjoint leaped subsequence of the same sequence.\n\n\
 ";
+        _nScrambleSeed = 0;
+        _nStreamIndex = 0;
+        _nNumStreams = 1;
         halton_BASE = NULL;
         halton_LEAP = NULL;
         halton_DIM_NUM = -1;
@@ -37,16 +42,21 @@ References:\n\n\
         SetSpaceDOF(1);
         SetSeed(0);
         halton_step_set (1);
+        RegisterCommand("SetStream",boost::bind(&HaltonSampler::_SetStreamCommand,this,_1,_2),
+                        "format: streamindex numstreams\n\nRestarts the sampler on the leaped subsequence streamindex, 0 <= streamindex < numstreams. The subsequences of all the stream indices do not share any points. Use numstreams 1 for the full sequence.");
     }
 
     void SetSeed(uint32_t seed) {
-        vector<int> vseed(halton_dim_num_get(),0);
-        halton_seed_set ( &vseed[0] );
+        _nScrambleSeed = seed;
+        _UpdateStreams();
     }
 
     void SetSpaceDOF(int dof) {
         BOOST_ASSERT(dof > 0);
-        halton_dim_num_set ( dof );
+        if( halton_dim_num_get() != dof ) {
+            halton_dim_num_set ( dof );
+            _UpdateStreams();
+        }
     }
     int GetDOF() const {
         return halton_dim_num_get();
@@ -71,7 +81,9 @@ References:\n\n\
     int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
     {
         samples.resize(halton_dim_num_get()*num);
-        halton_sequence(num,&samples[0]);
+        if( num > 0 ) {
+            _HaltonSequenceBulk(num,&samples[0]);
+        }
         return (int)num;
     }
 
@@ -79,11 +91,31 @@ References:\n\n\
     {
         OPENRAVE_ASSERT_OP_FORMAT0(GetDOF(),==,1,"sample can only be 1 dof", ORE_InvalidState);
         dReal f=0;
-        halton_sequence(1,&f);
+        _HaltonSequenceBulk(1,&f);
         return f;
     }
 
 protected:
+    bool _SetStreamCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int streamindex = 0, numstreams = 1;
+        sinput >> streamindex >> numstreams;
+        if( !sinput || numstreams < 1 || streamindex < 0 || streamindex >= numstreams ) {
+            return false;
+        }
+        _nStreamIndex = streamindex;
+        _nNumStreams = numstreams;
+        _UpdateStreams();
+        halton_step_set(numstreams > 1 ? 0 : 1);
+        return true;
+    }
+
+    /// \brief sets the seed and leap of the halton subsequence from the stream, and the shift of every dimension from the scramble seed
+    void _UpdateStreams();
+
+    /// \brief computes the next n points like halton_sequence, but increments the digits of the indices instead of decomposing every index
+    void _HaltonSequenceBulk(size_t n, dReal r[]);
+
     dReal arc_cosine ( dReal c );
     dReal atan4 ( dReal y, dReal x );
     char digit_to_ch ( int i );
@@ -120,6 +152,11 @@ protected:
     int halton_DIM_NUM;
     int *halton_SEED;
     int halton_STEP;
+
+    uint32_t _nScrambleSeed;
+    int _nStreamIndex, _nNumStreams;
+    std::vector<dReal> _vshift; ///< shift of every dimension when scrambled, empty if not
+    std::vector<uint64_t> _vdigits, _vleapdigits, _vweights; ///< scratch buffers of _HaltonSequenceBulk
 };
 
 #endif
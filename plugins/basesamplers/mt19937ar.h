@@ -46,6 +46,7 @@
 #define SAMPLER_MT19937
 
 #include <openrave/openrave.h>
+#include <boost/bind.hpp>
 using namespace OpenRAVE;
 using namespace std;
 
@@ -56,8 +57,11 @@ public:
     MT19937Sampler(EnvironmentBasePtr penv,std::istream& sinput) : SpaceSamplerBase(penv), _dof(1)
     {
         __description = ":Interface Author: Takuji Nishimura and Makoto Matsumoto\n\n\
-Mersenne twister sampling algorithm that is based on matrix linear recurrence over finite binary field F2. It has a period of 2^19937-1 and passes many tests for statistical uniform randomness.";
+Mersenne twister sampling algorithm that is based on matrix linear recurrence over finite binary field F2. It has a period of 2^19937-1 and passes many tests for statistical uniform randomness.\n\n\
+Every sampler has its own state, so threads that need independent random numbers should each create a sampler and call SetStream with a different stream index.";
         mti=N+1;
+        RegisterCommand("SetStream",boost::bind(&MT19937Sampler::_SetStreamCommand,this,_1,_2),
+                        "format: seed streamindex\n\nInitializes the state from both the seed and the stream index so that samplers with the same seed and different stream indices produce independent sequences.");
     }
 
     void SetSeed(uint32_t seed) {
@@ -101,25 +105,31 @@ Mersenne twister sampling algorithm that is based on matrix linear recurrence ov
     int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
     {
         samples.resize(_dof*num);
+        if( samples.size() == 0 ) {
+            return (int)num;
+        }
+        // generate all the integers first so the conversion loops do not branch on the state
+        _vtempvalues.resize(samples.size());
+        genrand_int32_array(&_vtempvalues[0], _vtempvalues.size());
         switch(interval) {
         case IT_Open:
             for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (((dReal)genrand_int32()) + 0.5f)*(1.0f/4294967296.0f);
+                samples[i] = (((dReal)_vtempvalues[i]) + 0.5f)*(1.0f/4294967296.0f);
             }
             break;
         case IT_OpenStart:
             for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (((dReal)genrand_int32()) + 1.0f)*(1.0f/4294967296.0f);
+                samples[i] = (((dReal)_vtempvalues[i]) + 1.0f)*(1.0f/4294967296.0f);
             }
             break;
         case IT_OpenEnd:
             for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (dReal)genrand_int32()*(1.0f/4294967296.0f);
+                samples[i] = (dReal)_vtempvalues[i]*(1.0f/4294967296.0f);
             }
             break;
         case IT_Closed:
             for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (dReal)genrand_int32()*(1.0f/4294967295.0f);
+                samples[i] = (dReal)_vtempvalues[i]*(1.0f/4294967295.0f);
             }
             break;
         default:
@@ -149,8 +159,8 @@ Mersenne twister sampling algorithm that is based on matrix linear recurrence ov
     int SampleSequence(std::vector<uint32_t>& samples, size_t num)
     {
         samples.resize(_dof*num);
-        for(size_t i = 0; i < samples.size(); ++i) {
-            samples[i] = genrand_int32();
+        if( samples.size() > 0 ) {
+            genrand_int32_array(&samples[0], samples.size());
         }
         return (int)num;
     }
@@ -162,6 +172,16 @@ Mersenne twister sampling algorithm that is based on matrix linear recurrence ov
     }
 
 private:
+    bool _SetStreamCommand(std::ostream& sout, std::istream& sinput)
+    {
+        uint32_t initkey[2] = {0, 0};
+        sinput >> initkey[0] >> initkey[1];
+        if( !sinput ) {
+            return false;
+        }
+        init_by_array(initkey, 2);
+        return true;
+    }
 
     /* initializes mt[N] with a seed */
     void init_genrand(uint32_t s)
@@ -217,23 +237,7 @@ private:
         /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
         if (mti >= N) {     /* generate N words at one time */
-            int kk;
-
-            if (mti == N+1)                                                                                                                                                                                                                                                                                           /* if init_genrand() has not been called, */
-                init_genrand(5489UL);                                                                                                                                                                                                                                                                                                                                                                                                      /* a default initial seed is used */
-
-            for (kk=0; kk<N-M; kk++) {
-                y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-                mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
-            }
-            for (; kk<N-1; kk++) {
-                y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-                mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
-            }
-            y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
-            mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
-
-            mti = 0;
+            next_state();
         }
 
         y = mt[mti++];
@@ -247,6 +251,52 @@ private:
         return y;
     }
 
+    /* fills values with the next num outputs of genrand_int32, the words of the state are tempered in runs */
+    void genrand_int32_array(uint32_t* values, size_t num)
+    {
+        while (num > 0) {
+            if (mti >= N) {
+                next_state();
+            }
+            size_t count = std::min(num, (size_t)(N-mti));
+            const uint32_t* state = &mt[mti];
+            for (size_t i = 0; i < count; i++) {
+                uint32_t y = state[i];
+                y ^= (y >> 11);
+                y ^= (y << 7) & 0x9d2c5680UL;
+                y ^= (y << 15) & 0xefc60000UL;
+                y ^= (y >> 18);
+                values[i] = y;
+            }
+            mti += (int)count;
+            values += count;
+            num -= count;
+        }
+    }
+
+    /* generates the next N words of the state */
+    void next_state(void)
+    {
+        uint32_t y;
+        int kk;
+
+        if (mti == N+1)     /* if init_genrand() has not been called, */
+            init_genrand(5489UL);     /* a default initial seed is used */
+
+        for (kk=0; kk<N-M; kk++) {
+            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+            mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
+        }
+        for (; kk<N-1; kk++) {
+            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+            mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
+        }
+        y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
+        mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
+
+        mti = 0;
+    }
+
     /* generates a random number on [0,0x7fffffff]-interval */
     long genrand_int31(void)
     {
@@ -291,6 +341,8 @@ private:
     int mti;     /* mti==N+1 means mt[N] is not initialized */
     uint32_t mag01[2];
     int _dof;
+    std::vector<uint32_t> _vtempvalues; ///< scratch buffer of SampleSequence
+
 };
 
 #endif
@@ -0,0 +1,255 @@
+// -*- coding: utf-8 --*
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include <boost/bind.hpp>
+
+/// \brief samples the robot active configuration space, biased toward configurations that put the end effector of the
+/// active manipulator inside a workspace region
+class WorkspaceConfigurationSampler : public SpaceSamplerBase
+{
+public:
+    WorkspaceConfigurationSampler(EnvironmentBasePtr penv, std::istream& sinput) : SpaceSamplerBase(penv)
+    {
+        __description = ":Interface Author: agent\n\n\
+Samples the robot active configuration space like RobotConfiguration, but with probability 'bias' the sample is taken \
+so that the end effector of the active manipulator lies inside the workspace region set with 'SetRegion'. When creating pass the following parameters::\n\n\
+  WorkspaceConfiguration [robot name] [sampler name]\n\n\
+The sampler needs to return values in the range [0,1]. Default sampler is 'mt19937'.\n\
+Biased samples are perturbations of the seed configurations given with 'SetSeedConfigurations' whose end effectors are \
+inside the region, for example the configurations of the reachability model of the manipulator or of previous IK \
+solutions. If there are none, uniform samples are taken until one is inside the region.\n\
+";
+        RegisterCommand("SetRegion",boost::bind(&WorkspaceConfigurationSampler::SetRegionCommand,this,_1,_2),
+                        "\"minx miny minz maxx maxy maxz\", the box in world coordinates the end effector position should be in. Without arguments, the region is removed and all samples are uniform.");
+        RegisterCommand("SetBias",boost::bind(&WorkspaceConfigurationSampler::SetBiasCommand,this,_1,_2),
+                        "\"bias [maxtries]\", bias is the probability in [0,1] of a biased sample (default 0.5). maxtries is the number of uniform samples tried when there are no seed configurations in the region (default 20).");
+        RegisterCommand("SetSeedConfigurations",boost::bind(&WorkspaceConfigurationSampler::SetSeedConfigurationsCommand,this,_1,_2),
+                        "\"num [values]\", num configurations of the active dofs that the biased samples are taken around.");
+        RegisterCommand("SetPerturbation",boost::bind(&WorkspaceConfigurationSampler::SetPerturbationCommand,this,_1,_2),
+                        "the maximum perturbation of the seed configurations as a fraction of the range of each dof (default 0.05).");
+        RegisterCommand("GetStatistics",boost::bind(&WorkspaceConfigurationSampler::GetStatisticsCommand,this,_1,_2),
+                        "returns \"numuniform numseeded numrejection numrejectionfailed\", the number of samples taken with every method.");
+        string robotname;
+        sinput >> robotname;
+        _probot = GetEnv()->GetRobot(robotname);
+        string samplername;
+        sinput >> samplername;
+        if( samplername.size() == 0 ) {
+            samplername = "mt19937";
+        }
+        _psampler = RaveCreateSpaceSampler(penv,samplername);
+        if( !!_psampler ) {
+            _psampler->SetSpaceDOF(1);
+        }
+        if( !!_probot ) {
+            _pconfigsampler = RaveCreateSpaceSampler(penv,str(boost::format("robotconfiguration %s %s")%robotname%samplername));
+        }
+        _fBias = 0.5;
+        _nMaxRejectionTries = 20;
+        _fPerturbation = 0.05;
+        _bHasRegion = false;
+        _nNumUniform = _nNumSeeded = _nNumRejection = _nNumRejectionFailed = 0;
+    }
+
+    void SetSeed(uint32_t seed) {
+        _psampler->SetSeed(seed);
+        _pconfigsampler->SetSeed(seed+1);
+    }
+
+    void SetSpaceDOF(int dof) {
+        BOOST_ASSERT(dof==GetDOF());
+    }
+    int GetDOF() const {
+        return !!_pconfigsampler ? _pconfigsampler->GetDOF() : 0;
+    }
+    int GetNumberOfValues() const {
+        return GetDOF();
+    }
+    bool Supports(SampleDataType type) const {
+        return !!_probot && !!_psampler && !!_pconfigsampler && type==SDT_Real;
+    }
+
+    void GetLimits(std::vector<dReal>& vLowerLimit, std::vector<dReal>& vUpperLimit) const
+    {
+        _pconfigsampler->GetLimits(vLowerLimit, vUpperLimit);
+    }
+
+    int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
+    {
+        int dof = GetDOF();
+        samples.resize(num*dof);
+        if( !_bHasRegion || !_probot->GetActiveManipulator() ) {
+            _pconfigsampler->SampleSequence(samples,num,interval);
+            _nNumUniform += num;
+            return (int)num;
+        }
+
+        RobotBase::RobotStateSaver saver(_probot, KinBody::Save_LinkTransformation);
+        _vsample.resize(dof);
+        for(size_t inum = 0; inum < num; ++inum) {
+            _psampler->SampleSequence(_vrandom,1,IT_OpenEnd);
+            if( _vrandom.at(0) >= _fBias ) {
+                _pconfigsampler->SampleSequence(_vsample,1,interval);
+                ++_nNumUniform;
+            }
+            else if( _vseedsinregion.size() > 0 ) {
+                _SampleAroundSeed(_vsample);
+                ++_nNumSeeded;
+            }
+            else {
+                // no seeds in the region, so reject uniform samples until the end effector is inside it
+                bool bInside = false;
+                for(int itry = 0; itry < _nMaxRejectionTries; ++itry) {
+                    _pconfigsampler->SampleSequence(_vsample,1,interval);
+                    if( _IsInRegion(_vsample) ) {
+                        bInside = true;
+                        break;
+                    }
+                }
+                if( bInside ) {
+                    ++_nNumRejection;
+                }
+                else {
+                    ++_nNumRejectionFailed;
+                }
+            }
+            std::copy(_vsample.begin(), _vsample.end(), samples.begin()+inum*dof);
+        }
+        return (int)num;
+    }
+
+protected:
+    bool SetRegionCommand(ostream& sout, istream& sinput)
+    {
+        Vector vmin, vmax;
+        sinput >> vmin.x >> vmin.y >> vmin.z >> vmax.x >> vmax.y >> vmax.z;
+        _bHasRegion = !!sinput;
+        if( _bHasRegion ) {
+            _vregionmin = vmin;
+            _vregionmax = vmax;
+        }
+        _UpdateSeedsInRegion();
+        return true;
+    }
+
+    bool SetBiasCommand(ostream& sout, istream& sinput)
+    {
+        dReal fBias = 0;
+        sinput >> fBias;
+        if( !sinput || fBias < 0 || fBias > 1 ) {
+            return false;
+        }
+        _fBias = fBias;
+        int nMaxRejectionTries = 0;
+        if( !!(sinput >> nMaxRejectionTries) ) {
+            _nMaxRejectionTries = max(1, nMaxRejectionTries);
+        }
+        return true;
+    }
+
+    bool SetSeedConfigurationsCommand(ostream& sout, istream& sinput)
+    {
+        int num = 0;
+        sinput >> num;
+        if( !sinput || num < 0 ) {
+            return false;
+        }
+        std::vector<dReal> vseeds(num*GetDOF());
+        for(size_t i = 0; i < vseeds.size(); ++i) {
+            sinput >> vseeds[i];
+        }
+        if( !sinput ) {
+            return false;
+        }
+        _vseeds.swap(vseeds);
+        _UpdateSeedsInRegion();
+        return true;
+    }
+
+    bool SetPerturbationCommand(ostream& sout, istream& sinput)
+    {
+        dReal fPerturbation = 0;
+        sinput >> fPerturbation;
+        if( !sinput || fPerturbation < 0 ) {
+            return false;
+        }
+        _fPerturbation = fPerturbation;
+        return true;
+    }
+
+    bool GetStatisticsCommand(ostream& sout, istream& sinput)
+    {
+        sout << _nNumUniform << " " << _nNumSeeded << " " << _nNumRejection << " " << _nNumRejectionFailed;
+        return true;
+    }
+
+    /// \brief true if the end effector is inside the region for the active dof values vconfig. The robot state is changed.
+    bool _IsInRegion(const std::vector<dReal>& vconfig)
+    {
+        _probot->SetActiveDOFValues(vconfig, KinBody::CLA_Nothing);
+        Vector vpos = _probot->GetActiveManipulator()->GetTransform().trans;
+        return vpos.x >= _vregionmin.x && vpos.x <= _vregionmax.x && vpos.y >= _vregionmin.y && vpos.y <= _vregionmax.y && vpos.z >= _vregionmin.z && vpos.z <= _vregionmax.z;
+    }
+
+    /// \brief gathers the seeds whose end effector is inside the region, so sampling does not need forward kinematics
+    void _UpdateSeedsInRegion()
+    {
+        _vseedsinregion.resize(0);
+        int dof = GetDOF();
+        if( !_bHasRegion || !_probot || !_probot->GetActiveManipulator() || dof == 0 ) {
+            return;
+        }
+        RobotBase::RobotStateSaver saver(_probot, KinBody::Save_LinkTransformation);
+        std::vector<dReal> vconfig(dof);
+        for(size_t index = 0; index+dof <= _vseeds.size(); index += dof) {
+            std::copy(_vseeds.begin()+index, _vseeds.begin()+index+dof, vconfig.begin());
+            if( _IsInRegion(vconfig) ) {
+                _vseedsinregion.insert(_vseedsinregion.end(), vconfig.begin(), vconfig.end());
+            }
+        }
+        RAVELOG_VERBOSE_FORMAT("env=%d, %d/%d seed configurations are inside the region", GetEnv()->GetId()%(_vseedsinregion.size()/dof)%(_vseeds.size()/dof));
+    }
+
+    /// \brief perturbs a random seed of the region, clamped to the limits
+    void _SampleAroundSeed(std::vector<dReal>& vsample)
+    {
+        int dof = GetDOF();
+        int numseeds = (int)_vseedsinregion.size()/dof;
+        _psampler->SampleSequence(_vrandom,1,IT_OpenEnd);
+        int iseed = min(numseeds-1, (int)(_vrandom.at(0)*numseeds));
+        _pconfigsampler->GetLimits(_vlower, _vupper);
+        _psampler->SetSpaceDOF(dof);
+        _psampler->SampleSequence(_vrandom,1,IT_Closed);
+        _psampler->SetSpaceDOF(1);
+        for(int idof = 0; idof < dof; ++idof) {
+            dReal frange = _vupper[idof] - _vlower[idof];
+            dReal f = _vseedsinregion[iseed*dof+idof] + (2*_vrandom[idof]-1)*_fPerturbation*frange;
+            vsample[idof] = max(_vlower[idof], min(_vupper[idof], f));
+        }
+    }
+
+    SpaceSamplerBasePtr _psampler; ///< samples [0,1] for the decisions and perturbations
+    SpaceSamplerBasePtr _pconfigsampler; ///< uniform samples of the active configuration space
+    RobotBasePtr _probot;
+    Vector _vregionmin, _vregionmax;
+    bool _bHasRegion;
+    dReal _fBias, _fPerturbation;
+    int _nMaxRejectionTries;
+    std::vector<dReal> _vseeds; ///< all the seed configurations
+    std::vector<dReal> _vseedsinregion; ///< the seed configurations whose end effector is in the region
+    size_t _nNumUniform, _nNumSeeded, _nNumRejection, _nNumRejectionFailed;
+    std::vector<dReal> _vsample, _vrandom, _vlower, _vupper;
+};
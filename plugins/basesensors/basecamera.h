@@ -180,6 +180,8 @@ public:
                         "Set the dimensions of the image (width,height)");
         RegisterCommand("SaveImage",boost::bind(&BaseCameraSensor::_SaveImage,this,_1,_2),
                         "Saves the next camera image to the given filename");
+        RegisterCommand("SetRayCastDepth",boost::bind(&BaseCameraSensor::_SetRayCastDepth,this,_1,_2),
+                        "\"enable [maxrange [numthreads [tilesize]]]\", if enable is 1, fills the depth image by casting a ray through every pixel with the collision checker, so no viewer or GPU is needed. The image is split into tilesize x tilesize tiles (default 32) that are cast in numthreads threads (default 1) with their own cloned environments. Depths beyond maxrange (default 10) are 0.");
         _pgeom.reset(new CameraGeomData());
         _pdata.reset(new CameraSensorData());
         _bPower = false;
@@ -188,6 +190,10 @@ public:
         //_numchannels = 3;
         _bRenderGeometry = true;
         _bRenderData = false;
+        _bRayCastDepth = false;
+        _fRayCastMaxRange = 10;
+        _nRayCastThreads = 1;
+        _nRayCastTileSize = 32;
         _Reset();
     }
 
@@ -248,8 +254,11 @@ public:
     virtual void _Reset()
     {
         _pdata->vimagedata.resize(0);
+        _pdata->vdepthdata.resize(0);
         _pdata->__stamp = 0;
         _vimagedata.clear(); // do not resize vector here since it might never be used and it will take up lots of memory!
+        _vdepthdata.clear();
+        _vraycastworkers.clear();
         _fTimeToImage = 0;
         _graphgeometry.reset();
         _dataviewer.reset();
@@ -285,15 +294,25 @@ public:
             if( _fTimeToImage <= 0 ) {
                 _fTimeToImage = 1 / (float)framerate;
                 GetEnv()->UpdatePublishedBodies();
+                bool bimage = false, bdepth = false;
                 if( !!GetEnv()->GetViewer() ) {
                     _vimagedata.resize(3*_pgeom->width*_pgeom->height);
-                    if( GetEnv()->GetViewer()->GetCameraImage(_vimagedata, _pgeom->width, _pgeom->height, _trans, _pgeom->KK) ) {
-                        // copy the data
-                        boost::mutex::scoped_lock lock(_mutexdata);
+                    bimage = GetEnv()->GetViewer()->GetCameraImage(_vimagedata, _pgeom->width, _pgeom->height, _trans, _pgeom->KK);
+                }
+                if( _bRayCastDepth ) {
+                    bdepth = _RayCastDepth(_vdepthdata);
+                }
+                if( bimage || bdepth ) {
+                    // copy the data
+                    boost::mutex::scoped_lock lock(_mutexdata);
+                    if( bimage ) {
                         pdata->vimagedata = _vimagedata;
-                        pdata->__stamp = GetEnv()->GetSimulationTime();
-                        pdata->__trans = _trans;
                     }
+                    if( bdepth ) {
+                        pdata->vdepthdata = _vdepthdata;
+                    }
+                    pdata->__stamp = GetEnv()->GetSimulationTime();
+                    pdata->__trans = _trans;
                 }
             }
         }
@@ -328,7 +347,7 @@ public:
     {
         if( _bPower &&( psensordata->GetType() == ST_Camera) ) {
             boost::mutex::scoped_lock lock(_mutexdata);
-            if( _pdata->vimagedata.size() > 0 ) {
+            if( _pdata->vimagedata.size() > 0 || _pdata->vdepthdata.size() > 0 ) {
                 *boost::dynamic_pointer_cast<CameraSensorData>(psensordata) = *_pdata;
                 return true;
             }
@@ -347,6 +366,7 @@ public:
         if( !_bPower ) {
             // should reset!
             _pdata->vimagedata.resize(0);
+            _pdata->vdepthdata.resize(0);
             _pdata->__stamp = 0;
         }
         return !!sinput;
@@ -371,6 +391,34 @@ public:
         }
         return false;
     }
+    bool _SetRayCastDepth(ostream& sout, istream& sinput)
+    {
+        bool bRayCastDepth = false;
+        sinput >> bRayCastDepth;
+        if( !sinput ) {
+            return false;
+        }
+        dReal fMaxRange = 0;
+        if( !!(sinput >> fMaxRange) ) {
+            if( fMaxRange <= 0 ) {
+                return false;
+            }
+            _fRayCastMaxRange = fMaxRange;
+            int numthreads = 0;
+            if( !!(sinput >> numthreads) ) {
+                _nRayCastThreads = max(1, numthreads);
+                int tilesize = 0;
+                if( !!(sinput >> tilesize) ) {
+                    _nRayCastTileSize = max(1, tilesize);
+                }
+            }
+        }
+        _bRayCastDepth = bRayCastDepth;
+        if( !_bRayCastDepth ) {
+            _vraycastworkers.clear();
+        }
+        return true;
+    }
     bool _SaveImage(ostream& sout, istream& sinput)
     {
         RAVELOG_WARN("SaveImage not implemented yet\n");
@@ -399,6 +447,10 @@ public:
         _bRenderGeometry = r->_bRenderGeometry;
         _bRenderData = r->_bRenderData;
         _bPower = r->_bPower;
+        _bRayCastDepth = r->_bRayCastDepth;
+        _fRayCastMaxRange = r->_fRayCastMaxRange;
+        _nRayCastThreads = r->_nRayCastThreads;
+        _nRayCastTileSize = r->_nRayCastTileSize;
         _psensor_reference.reset();
         _Reset();
     }
@@ -450,6 +502,141 @@ public:
     }
 
 protected:
+    /// \brief the ray casting buffers of one thread
+    struct RayCastWorker
+    {
+        RayCastWorker() : _bfailed(false) {
+        }
+
+        EnvironmentBasePtr _penv; ///< the cloned environment to cast in, empty when casting in the sensor environment
+        std::vector<RAY> _vrays;
+        std::vector<dReal> _vinvlengths; ///< for every ray, the z component of its unit direction in the camera frame
+        std::vector<dReal> _vhitdistances;
+        std::vector<Vector> _vhitnormals;
+        std::vector<int> _vhitbodyids;
+        bool _bfailed;
+    };
+    typedef boost::shared_ptr<RayCastWorker> RayCastWorkerPtr;
+
+    /// \brief fills vdepth by casting a ray through the center of every pixel.
+    ///
+    /// The tiles are cast in parallel in cloned environments when _nRayCastThreads > 1. This needs the environment lock,
+    /// so sensors stepped concurrently without it cast all their tiles serially.
+    bool _RayCastDepth(std::vector<float>& vdepth)
+    {
+        if( _pgeom->KK.fx <= 0 || _pgeom->KK.fy <= 0 ) {
+            return false;
+        }
+        vdepth.resize(_pgeom->width*_pgeom->height);
+        size_t numtiles = _GetNumRayCastTilesX()*((_pgeom->height+_nRayCastTileSize-1)/_nRayCastTileSize);
+        size_t numthreads = min((size_t)_nRayCastThreads, numtiles);
+        if( numthreads > 1 ) {
+            EnvironmentMutex::scoped_try_lock lockenv(GetEnv()->GetMutex());
+            if( !!lockenv && _InitRayCastWorkers(numthreads) ) {
+                std::vector< boost::shared_ptr<boost::thread> > vthreads(numthreads);
+                for(size_t ithread = 0; ithread < numthreads; ++ithread) {
+                    vthreads[ithread].reset(new boost::thread(boost::bind(&BaseCameraSensor::_RayCastTilesWorker, this, _vraycastworkers[ithread], boost::ref(vdepth), ithread, numthreads)));
+                }
+                bool bsuccess = true;
+                for(size_t ithread = 0; ithread < numthreads; ++ithread) {
+                    vthreads[ithread]->join();
+                    bsuccess &= !_vraycastworkers[ithread]->_bfailed;
+                }
+                return bsuccess;
+            }
+            RAVELOG_VERBOSE_FORMAT("env=%d, camera %s casts its depth tiles serially", GetEnv()->GetId()%GetName());
+        }
+        if( !_praycastworker ) {
+            _praycastworker.reset(new RayCastWorker());
+        }
+        try {
+            for(size_t itile = 0; itile < numtiles; ++itile) {
+                _RayCastTile(GetEnv(), *_praycastworker, vdepth, itile);
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, camera %s failed to cast depth rays: %s", GetEnv()->GetId()%GetName()%ex.what());
+            return false;
+        }
+        return true;
+    }
+
+    /// \brief makes sure there are numthreads workers with environments synchronized with the sensor environment
+    bool _InitRayCastWorkers(size_t numthreads)
+    {
+        try {
+            if( _vraycastworkers.size() > numthreads ) {
+                _vraycastworkers.resize(numthreads);
+            }
+            while( _vraycastworkers.size() < numthreads ) {
+                RayCastWorkerPtr pworker(new RayCastWorker());
+                pworker->_penv = GetEnv()->CloneSelf(Clone_Bodies);
+                _vraycastworkers.push_back(pworker);
+            }
+            FOREACH(itworker, _vraycastworkers) {
+                (*itworker)->_penv->SynchronizeBodies(GetEnv());
+                (*itworker)->_bfailed = false;
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, cannot cast depth rays of camera %s in parallel, falling back to serial casts: %s", GetEnv()->GetId()%GetName()%ex.what());
+            _vraycastworkers.clear();
+            return false;
+        }
+        return true;
+    }
+
+    /// \brief runs in a ray casting thread, casts every numthreads-th tile starting at ithread
+    void _RayCastTilesWorker(RayCastWorkerPtr pworker, std::vector<float>& vdepth, size_t ithread, size_t numthreads)
+    {
+        EnvironmentMutex::scoped_lock lock(pworker->_penv->GetMutex());
+        size_t numtiles = _GetNumRayCastTilesX()*((_pgeom->height+_nRayCastTileSize-1)/_nRayCastTileSize);
+        try {
+            for(size_t itile = ithread; itile < numtiles; itile += numthreads) {
+                _RayCastTile(pworker->_penv, *pworker, vdepth, itile);
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, camera %s failed to cast depth rays: %s", GetEnv()->GetId()%GetName()%ex.what());
+            pworker->_bfailed = true;
+        }
+    }
+
+    inline size_t _GetNumRayCastTilesX() const {
+        return (_pgeom->width+_nRayCastTileSize-1)/_nRayCastTileSize;
+    }
+
+    /// \brief casts the rays of one tile in one batch with the collision checker of penv
+    void _RayCastTile(EnvironmentBasePtr penv, RayCastWorker& worker, std::vector<float>& vdepth, size_t itile) const
+    {
+        const int tilesize = _nRayCastTileSize;
+        const int startx = (itile%_GetNumRayCastTilesX())*tilesize, starty = (itile/_GetNumRayCastTilesX())*tilesize;
+        const int endx = min(startx+tilesize, _pgeom->width), endy = min(starty+tilesize, _pgeom->height);
+        const dReal ifx = 1/_pgeom->KK.fx, ify = 1/_pgeom->KK.fy;
+        TransformMatrix tcamera(_trans);
+        worker._vrays.resize(0);
+        worker._vinvlengths.resize(0);
+        RAY r;
+        r.pos = _trans.trans;
+        for(int y = starty; y < endy; ++y) {
+            for(int x = startx; x < endx; ++x) {
+                Vector vdir((x+0.5-_pgeom->KK.cx)*ifx, (y+0.5-_pgeom->KK.cy)*ify, 1);
+                dReal finvlength = 1/RaveSqrt(vdir.lengthsqr3());
+                r.dir = tcamera.rotate(vdir*(finvlength*_fRayCastMaxRange));
+                worker._vrays.push_back(r);
+                worker._vinvlengths.push_back(finvlength);
+            }
+        }
+        penv->GetCollisionChecker()->CheckCollisionRays(worker._vrays, KinBodyConstPtr(), worker._vhitdistances, worker._vhitnormals, worker._vhitbodyids);
+        size_t index = 0;
+        for(int y = starty; y < endy; ++y) {
+            for(int x = startx; x < endx; ++x, ++index) {
+                dReal fdistance = worker._vhitdistances[index];
+                vdepth[y*_pgeom->width+x] = fdistance >= 0 ? (float)(fdistance*worker._vinvlengths[index]) : 0;
+            }
+        }
+    }
+
     void _RenderGeometry()
     {
         if( !_bRenderGeometry ) {
@@ -498,6 +685,7 @@ protected:
 
     // more geom stuff
     vector<uint8_t> _vimagedata;
+    std::vector<float> _vdepthdata;
     RaveVector<float> _vColor;
     SensorBaseWeakPtr _psensor_reference; ///< weak pointer to the sensor reference. Used to keep track of name changes!
 
@@ -514,6 +702,12 @@ protected:
     bool _bRenderGeometry, _bRenderData;
     bool _bPower;     ///< if true, gather data, otherwise don't
 
+    bool _bRayCastDepth; ///< if true, fills the depth image with the collision checker
+    dReal _fRayCastMaxRange;
+    int _nRayCastThreads, _nRayCastTileSize;
+    std::vector<RayCastWorkerPtr> _vraycastworkers; ///< one per parallel ray casting thread
+    RayCastWorkerPtr _praycastworker; ///< the buffers when casting serially in the sensor environment
+
     friend class BaseCameraXMLReader;
 };
 
@@ -143,7 +143,6 @@ public:
 
         _pgeom.reset(new BaseFlashLidar3DGeom());
         _pdata.reset(new LaserSensorData());
-        _report.reset(new CollisionReport());
 
         _bRenderData = false;
         _bRenderGeometry = true;
@@ -206,20 +205,27 @@ public:
             _fTimeToScan = _pgeom->time_scan;
 
             RAY r;
-
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
             Transform t;
 
             {
                 // Lock the data mutex and fill with the range data (get all in one timestep)
                 boost::mutex::scoped_lock lock(_mutexdata);
+                // fill a new frame since consumers can still be reading the published _pdata
+                boost::shared_ptr<LaserSensorData> pframe = boost::static_pointer_cast<LaserSensorData>(_framebuffer.AcquireFrame([]() {
+                    return SensorDataPtr(new LaserSensorData());
+                }));
                 t = GetTransform();
-                _pdata->__trans = t;
-                _pdata->__stamp = GetEnv()->GetSimulationTime();
+                pframe->__trans = t;
+                pframe->__stamp = GetEnv()->GetSimulationTime();
 
                 r.pos = t.trans;
-                _pdata->positions.at(0) = t.trans;
+                pframe->positions.resize(1);
+                pframe->positions[0] = t.trans;
+                pframe->ranges.resize(_pgeom->width*_pgeom->height);
+                pframe->intensity.resize(_pgeom->width*_pgeom->height);
 
+                _vrays.resize(_pgeom->width*_pgeom->height);
+                _vraydirs.resize(_vrays.size());
                 for(int w = 0; w < _pgeom->width; ++w) {
                     for(int h = 0; h < _pgeom->height; ++h) {
                         Vector vdir;
@@ -230,29 +236,31 @@ public:
                         r.dir = _pgeom->max_range*vdir;
 
                         int index = w*_pgeom->height+h;
-
-                        if( GetEnv()->CheckCollision(r, _report)) {
-                            _pdata->ranges[index] = vdir*_report->minDistance;
-                            _pdata->intensity[index] = 1;
-                            // store the colliding bodies
-                            KinBody::LinkConstPtr plink = !!_report->plink1 ? _report->plink1 : _report->plink2;
-                            if( !!plink ) {
-                                _databodyids[index] = plink->GetParent()->GetEnvironmentId();
-                            }
-                        }
-                        else {
-                            _databodyids[index] = 0;
-                            _pdata->ranges[index] = vdir*_pgeom->max_range;
-                            _pdata->intensity[index] = 0;
-                        }
+                        _vrays[index] = r;
+                        _vraydirs[index] = vdir;
                     }
                 }
 
-                _report->Reset();
+                // check all the rays in one batch
+                GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, KinBodyConstPtr(), _vhitdistances, _vhitnormals, _vhitbodyids);
+                for(size_t index = 0; index < _vrays.size(); ++index) {
+                    const Vector& vdir = _vraydirs[index];
+                    if( _vhitdistances[index] >= 0 ) {
+                        pframe->ranges[index] = vdir*_vhitdistances[index];
+                        pframe->intensity[index] = 1;
+                        // store the colliding bodies
+                        _databodyids[index] = _vhitbodyids[index];
+                    }
+                    else {
+                        _databodyids[index] = 0;
+                        pframe->ranges[index] = vdir*_pgeom->max_range;
+                        pframe->intensity[index] = 0;
+                    }
+                }
+                _pdata = pframe;
+                _framebuffer.Publish(pframe);
             }
 
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
-
             if( _bRenderData ) {
                 // If can render, check if some time passed before last update
                 list<GraphHandlePtr> listhandles;
@@ -328,6 +336,23 @@ public:
         return false;
     }
 
+    virtual SensorDataConstPtr GetLatestSensorData(SensorType type)
+    {
+        if(( type == ST_Invalid) ||( type == ST_Laser) ) {
+            return _framebuffer.GetLatest();
+        }
+        return SensorDataConstPtr();
+    }
+
+    virtual int GetSensorDataFrames(SensorType type, uint64_t sequence, std::vector<SensorDataConstPtr>& vframes)
+    {
+        if(( type == ST_Invalid) ||( type == ST_Laser) ) {
+            return _framebuffer.GetFramesSince(sequence, vframes);
+        }
+        vframes.resize(0);
+        return 0;
+    }
+
     virtual bool Supports(SensorType type) {
         return type == ST_Laser;
     }
@@ -378,16 +403,12 @@ protected:
         _iKK[2] = -_pgeom->KK.cx / _pgeom->KK.fx;
         _iKK[3] = -_pgeom->KK.cy / _pgeom->KK.fy;
         _listGraphicsHandles.clear();
+        // _pdata could be published, so never modify it
+        _pdata.reset(new LaserSensorData());
         _pdata->positions.resize(1);
-        _pdata->ranges.resize(_pgeom->width*_pgeom->height);
-        _pdata->intensity.resize(_pgeom->width*_pgeom->height);
+        _pdata->ranges.resize(_pgeom->width*_pgeom->height, Vector(0,0,0));
+        _pdata->intensity.resize(_pgeom->width*_pgeom->height, 0);
         _databodyids.resize(_pgeom->width*_pgeom->height);
-        FOREACH(it, _pdata->ranges) {
-            *it = Vector(0,0,0);
-        }
-        FOREACH(it, _pdata->intensity) {
-            *it = 0;
-        }
     }
 
     void _RenderGeometry()
@@ -423,9 +444,14 @@ protected:
     }
 
     boost::shared_ptr<BaseFlashLidar3DGeom> _pgeom;
-    boost::shared_ptr<LaserSensorData> _pdata;
+    boost::shared_ptr<LaserSensorData> _pdata; ///< the latest data, never modified once published in _framebuffer
+    SensorDataRingBuffer _framebuffer; ///< the published frames
     vector<int> _databodyids;     ///< if non 0, for each point in _data, specifies the body that was hit
-    CollisionReportPtr _report;
+    std::vector<RAY> _vrays; ///< the rays of the current scan
+    std::vector<Vector> _vraydirs; ///< the unit directions of _vrays
+    std::vector<dReal> _vhitdistances;
+    std::vector<Vector> _vhitnormals;
+    std::vector<int> _vhitbodyids;
     // more geom stuff
     RaveVector<float> _vColor;
     dReal _iKK[4];     // inverse of KK
@@ -144,7 +144,6 @@ public:
         _pgeom->max_range = 100;
         _fTimeToScan = 0;
         _vColor = RaveVector<float>(0.5f,0.5f,1,1);
-        _report.reset(new CollisionReport());
         _bPower = false;
         _bRenderData = false;
         _bRenderGeometry = true;
@@ -197,47 +196,64 @@ public:
         _fTimeToScan -= fTimeElapsed;
         if( _bPower &&( _fTimeToScan <= 0) ) {
             _fTimeToScan = _pgeom->time_scan;
-            Vector rotaxis(0,0,1);
             RAY r;
-
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
             Transform t;
 
             {
                 // Lock the data mutex and fill with the range data (get all in one timestep)
                 boost::mutex::scoped_lock lock(_mutexdata);
-                _pdata->__trans = GetTransform();
-                _pdata->__stamp = GetEnv()->GetSimulationTime();
+                // fill a new frame since consumers can still be reading the published _pdata
+                boost::shared_ptr<LaserSensorData> pframe = boost::static_pointer_cast<LaserSensorData>(_framebuffer.AcquireFrame([]() {
+                    return SensorDataPtr(new LaserSensorData());
+                }));
+                pframe->__trans = GetTransform();
+                pframe->__stamp = GetEnv()->GetSimulationTime();
                 t = GetLaserPlaneTransform();
-                _pdata->positions.at(0) = t.trans;
+                TransformMatrix trot(t); // rotation matrix computed once for all the rays
+                pframe->positions.resize(1);
+                pframe->positions[0] = t.trans;
+                pframe->ranges.resize(_pdata->ranges.size());
+                pframe->intensity.resize(_pdata->intensity.size());
+                _vrays.resize(0);
+                _vraydirs.resize(0);
                 size_t index = 0;
                 for(dReal frotangle = _pgeom->min_angle[0]; frotangle <= _pgeom->max_angle[0]; frotangle += _pgeom->resolution[0], ++index) {
-                    if( index >= _pdata->ranges.size() ) {
+                    if( index >= pframe->ranges.size() ) {
                         break;
                     }
-                    Vector vdir(t.rotate(quatRotate(quatFromAxisAngle(rotaxis, (dReal)frotangle),Vector(1,0,0))));
+                    // x-axis rotated by frotangle around the z-axis
+                    Vector vdir(trot.rotate(Vector(RaveCos(frotangle), RaveSin(frotangle), 0)));
                     r.pos = t.trans+_pgeom->min_range*vdir;
                     r.dir = (_pgeom->max_range-_pgeom->min_range)*vdir;
+                    _vrays.push_back(r);
+                    _vraydirs.push_back(vdir);
+                }
 
-                    if( GetEnv()->CheckCollision(r, _report)) {
-                        _pdata->ranges[index] = vdir*(_report->minDistance+_pgeom->min_range);
-                        _pdata->intensity[index] = 1;
+                // check all the rays in one batch
+                GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, KinBodyConstPtr(), _vhitdistances, _vhitnormals, _vhitbodyids);
+                for(index = 0; index < _vrays.size(); ++index) {
+                    const Vector& vdir = _vraydirs[index];
+                    if( _vhitdistances[index] >= 0 ) {
+                        pframe->ranges[index] = vdir*(_vhitdistances[index]+_pgeom->min_range);
+                        pframe->intensity[index] = 1;
                         // store the colliding bodies
-                        KinBody::LinkConstPtr plink = !!_report->plink1 ? _report->plink1 : _report->plink2;
-                        if( !!plink ) {
-                            _databodyids[index] = plink->GetParent()->GetEnvironmentId();
-                        }
+                        _databodyids[index] = _vhitbodyids[index];
                     }
                     else {
                         _databodyids[index] = 0;
-                        _pdata->ranges[index] = vdir*_pgeom->max_range;
-                        _pdata->intensity[index] = 0;
+                        pframe->ranges[index] = vdir*_pgeom->max_range;
+                        pframe->intensity[index] = 0;
                     }
                 }
+                // the readings that were not scanned keep their previous values
+                for(; index < pframe->ranges.size(); ++index) {
+                    pframe->ranges[index] = _pdata->ranges[index];
+                    pframe->intensity[index] = _pdata->intensity[index];
+                }
+                _pdata = pframe;
+                _framebuffer.Publish(pframe);
             }
 
-            GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
-
             if( _bRenderData ) {
                 // If can render, check if some time passed before last update
                 list<GraphHandlePtr> listhandles;
@@ -279,8 +295,6 @@ public:
             else {
                 _listGraphicsHandles.clear();
             }
-
-            _report->Reset();
         }
 
         return true;
@@ -314,6 +328,23 @@ public:
         return false;
     }
 
+    virtual SensorDataConstPtr GetLatestSensorData(SensorType type)
+    {
+        if(( type == ST_Invalid) ||( type == ST_Laser) ) {
+            return _framebuffer.GetLatest();
+        }
+        return SensorDataConstPtr();
+    }
+
+    virtual int GetSensorDataFrames(SensorType type, uint64_t sequence, std::vector<SensorDataConstPtr>& vframes)
+    {
+        if(( type == ST_Invalid) ||( type == ST_Laser) ) {
+            return _framebuffer.GetFramesSince(sequence, vframes);
+        }
+        vframes.resize(0);
+        return 0;
+    }
+
     virtual bool Supports(SensorType type) {
         return type == ST_Laser;
     }
@@ -377,16 +408,12 @@ protected:
         else {
             N = 1;
         }
+        // _pdata could be published, so never modify it
+        _pdata.reset(new LaserSensorData());
         _pdata->positions.resize(1);
-        _pdata->ranges.resize(N);
-        _pdata->intensity.resize(N);
+        _pdata->ranges.resize(N, Vector(0,0,0));
+        _pdata->intensity.resize(N, 0);
         _databodyids.resize(N);
-        FOREACH(it, _pdata->ranges) {
-            *it = Vector(0,0,0);
-        }
-        FOREACH(it, _pdata->intensity) {
-            *it = 0;
-        }
         _fTimeToScan = 0;
         _listGraphicsHandles.clear();
         _graphgeometry.reset();
@@ -429,9 +456,14 @@ protected:
     }
 
     boost::shared_ptr<LaserGeomData> _pgeom;
-    boost::shared_ptr<LaserSensorData> _pdata;
+    boost::shared_ptr<LaserSensorData> _pdata; ///< the latest data, never modified once published in _framebuffer
+    SensorDataRingBuffer _framebuffer; ///< the published frames
     vector<int> _databodyids;     ///< if non 0, for each point in _data, specifies the body that was hit
-    CollisionReportPtr _report;
+    std::vector<RAY> _vrays; ///< the rays of the current scan
+    std::vector<Vector> _vraydirs; ///< the unit directions of _vrays
+    std::vector<dReal> _vhitdistances;
+    std::vector<Vector> _vhitnormals;
+    std::vector<int> _vhitbodyids;
 
     // more geom stuff
     RaveVector<float> _vColor;
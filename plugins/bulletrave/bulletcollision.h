@@ -292,100 +292,317 @@ public:
         KinBodyConstPtr _pbodyonly;
     };
 
+    /// \brief broadphase pairs found for one query, kept between queries like the body managers of fclrave
+    ///
+    /// Each pair owns its narrowphase algorithm so the contact manifolds are not reallocated on every check.
+    /// The pairs are gathered with the aabbs of the queried objects grown by twice _fPairCacheMargin, so they stay valid while the
+    /// queried objects do not leave their aabbs grown by _fPairCacheMargin and no other body moves.
+    struct BodyPairCache
+    {
+        BodyPairCache() : nSyncStamp(-1), nQuerySyncCount(0) {
+        }
+        int nSyncStamp; ///< BulletSpace::GetSyncStamp when the pairs were gathered, -1 if they were never gathered
+        int nQuerySyncCount; ///< sum of the KinBodyInfo::nSyncCount of vquerybodies when the pairs were gathered
+        std::vector<btCollisionObject*> vqueryobjs; ///< sorted objects the pairs were gathered for
+        std::vector<BulletSpace::KinBodyInfo*> vquerybodies; ///< bodies of vqueryobjs, the caches are cleared before any of them is destroyed
+        btAlignedObjectArray<btVector3> vaabbmin, vaabbmax; ///< aabbs of vqueryobjs grown by _fPairCacheMargin when the pairs were gathered
+        std::map< std::pair<btBroadphaseProxy*, btBroadphaseProxy*>, btBroadphasePair > mappairs;
+    };
+
+    /// \brief gathers the proxies overlapping one query object
+    class QueryAabbCallback : public btBroadphaseAabbCallback
+    {
+public:
+        QueryAabbCallback(btBroadphaseProxy* pqueryproxy, const std::vector<btCollisionObject*>& vqueryobjs, std::vector< std::pair<btBroadphaseProxy*, btBroadphaseProxy*> >& vpairs) : _pqueryproxy(pqueryproxy), _vqueryobjs(vqueryobjs), _vpairs(vpairs) {
+        }
+
+        virtual bool process(const btBroadphaseProxy* proxy)
+        {
+            btBroadphaseProxy* potherproxy = const_cast<btBroadphaseProxy*>(proxy);
+            if( potherproxy == _pqueryproxy ) {
+                return true;
+            }
+            if( std::binary_search(_vqueryobjs.begin(), _vqueryobjs.end(), static_cast<btCollisionObject*>(potherproxy->m_clientObject)) ) {
+                // both objects are queried, so only keep the pair once
+                if( potherproxy < _pqueryproxy ) {
+                    return true;
+                }
+            }
+            _vpairs.push_back(_pqueryproxy < potherproxy ? std::make_pair(_pqueryproxy, potherproxy) : std::make_pair(potherproxy, _pqueryproxy));
+            return true;
+        }
+
+private:
+        btBroadphaseProxy* _pqueryproxy;
+        const std::vector<btCollisionObject*>& _vqueryobjs;
+        std::vector< std::pair<btBroadphaseProxy*, btBroadphaseProxy*> >& _vpairs;
+    };
+
     static BulletSpace::KinBodyInfoPtr GetCollisionInfo(KinBodyConstPtr pbody) {
         return boost::dynamic_pointer_cast<BulletSpace::KinBodyInfo>(pbody->GetUserData("bulletcollision"));
     }
 
-    bool CheckCollisionP(btOverlapFilterCallback* poverlapfilt, CollisionReportPtr report)
+    /// \brief fills the report from a manifold with contacts and runs the environment callbacks on it
+    ///
+    /// \return true if the contacts count as a collision
+    bool _ProcessManifold(btPersistentManifold* contactManifold, CollisionReportPtr& report, bool bHasCallbacks, std::list<EnvironmentBase::CollisionCallbackFn>& listcallbacks)
     {
-        if( !!report ) {
-            report->Reset(_options);
-        }
-        bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
-        std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
+        int numContacts = contactManifold->getNumContacts();
 
-        SetFilterScope filter(_dispatcher, _world->getPairCache(), poverlapfilt);
-        _world->performDiscreteCollisionDetection();
+        const btCollisionObject* obA = static_cast<const btCollisionObject*>(contactManifold->getBody0());
+        const btCollisionObject* obB = static_cast<const btCollisionObject*>(contactManifold->getBody1());
 
-        // for some reason this is necessary, or else collisions will start disappearing
-        _broadphase->calculateOverlappingPairs(_world->getDispatcher());
+        KinBody::LinkPtr plink0 = GetLinkFromCollision(obA);
+        KinBody::LinkPtr plink1 = GetLinkFromCollision(obB);
 
-        int numManifolds = _world->getDispatcher()->getNumManifolds();
+        if( numContacts == 0 ) {
+            return false;
+        }
 
-        for (int i=0; i<numManifolds; i++) {
-            btPersistentManifold* contactManifold = _world->getDispatcher()->getManifoldByIndexInternal(i);
-            int numContacts = contactManifold->getNumContacts();
+        if( bHasCallbacks && !report ) {
+            report.reset(new CollisionReport());
+            report->Reset(_options);
+        }
 
-            const btCollisionObject* obA = static_cast<const btCollisionObject*>(contactManifold->getBody0());
-            const btCollisionObject* obB = static_cast<const btCollisionObject*>(contactManifold->getBody1());
+        if( !!report ) {
+            //report->numCols = numContacts;
+            report->minDistance = 0;
+            report->plink1 = plink0;
+            report->plink2 = plink1;
+
+            if( _options & OpenRAVE::CO_Contacts ) {
+                report->contacts.reserve(numContacts);
+                for (int j=0; j<numContacts; j++) {
+                    btManifoldPoint& pt = contactManifold->getContactPoint(j);
+                    btVector3 btp = pt.getPositionWorldOnB();
+                    btVector3 btn = pt.m_normalWorldOnB;
+                    Vector p(btp[0],btp[1],btp[2]), n(btn[0],btn[1],btn[2]);
+                    dReal distance = pt.m_distance1;
+                    if( !!plink1 && plink1->ValidateContactNormal(p,n) ) {
+                        distance = -distance;
+                    }
+                    report->contacts.push_back(CollisionReport::CONTACT(p, n, distance));
+                }
+            }
+        }
 
-            KinBody::LinkPtr plink0 = GetLinkFromCollision(obA);
-            KinBody::LinkPtr plink1 = GetLinkFromCollision(obB);
+        contactManifold->clearManifold();
 
-            if( numContacts == 0 ) {
-                continue;
+        if( bHasCallbacks ) {
+            if( listcallbacks.size() == 0 ) {
+                GetEnv()->GetRegisteredCollisionCallbacks(listcallbacks);
             }
+            FOREACHC(itfn, listcallbacks) {
+                OpenRAVE::CollisionAction action = (*itfn)(report,false);
+                if( action != OpenRAVE::CA_DefaultAction ) {
+                    report->Reset();
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
 
-            if( bHasCallbacks && !report ) {
-                report.reset(new CollisionReport());
-                report->Reset(_options);
+    /// \brief frees the narrowphase algorithms held by the pair caches
+    void _ClearPairCaches()
+    {
+        FOREACH(itcache, _mapPairCaches) {
+            FOREACH(itpair, itcache->second.mappairs) {
+                _FreePairAlgorithm(itpair->second);
             }
+        }
+        _mapPairCaches.clear();
+    }
 
-            if( !!report ) {
-                //report->numCols = numContacts;
-                report->minDistance = 0;
-                report->plink1 = plink0;
-                report->plink2 = plink1;
-
-                if( _options & OpenRAVE::CO_Contacts ) {
-                    report->contacts.reserve(numContacts);
-                    for (int j=0; j<numContacts; j++) {
-                        btManifoldPoint& pt = contactManifold->getContactPoint(j);
-                        btVector3 btp = pt.getPositionWorldOnB();
-                        btVector3 btn = pt.m_normalWorldOnB;
-                        Vector p(btp[0],btp[1],btp[2]), n(btn[0],btn[1],btn[2]);
-                        dReal distance = pt.m_distance1;
-                        if( !!plink1 && plink1->ValidateContactNormal(p,n) ) {
-                            distance = -distance;
-                        }
-                        report->contacts.push_back(CollisionReport::CONTACT(p, n, distance));
-                    }
+    void _FreePairAlgorithm(btBroadphasePair& pair)
+    {
+        if( !!pair.m_algorithm ) {
+            pair.m_algorithm->~btCollisionAlgorithm();
+            _dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+            pair.m_algorithm = NULL;
+        }
+    }
+
+    /// \brief returns the pair cache of a body with its attached bodies (linkindex -1), of the body alone (linkindex -2) or of one of its links
+    ///
+    /// All caches are dropped when the bullet objects of any body are recreated, since the cached pairs point to their proxies.
+    BodyPairCache& _GetPairCache(KinBodyConstPtr pbody, int linkindex)
+    {
+        if( _nPairCacheGeometryStamp != bulletspace->GetGeometryStamp() ) {
+            _ClearPairCaches();
+            _nPairCacheGeometryStamp = bulletspace->GetGeometryStamp();
+        }
+        return _mapPairCaches[std::make_pair(pbody->GetEnvironmentId(), linkindex)];
+    }
+
+    /// \brief collects the enabled objects of the body, and of all the bodies attached to it if battached is true
+    void _GetQueryObjects(KinBodyConstPtr pbody, bool battached, std::vector<btCollisionObject*>& vqueryobjs, std::vector<BulletSpace::KinBodyInfo*>& vquerybodies)
+    {
+        vqueryobjs.resize(0);
+        vquerybodies.resize(0);
+        std::set<KinBodyConstPtr> setattached;
+        if( battached ) {
+            pbody->GetAttached(setattached);
+        }
+        else {
+            setattached.insert(pbody);
+        }
+        FOREACHC(itbody, setattached) {
+            BulletSpace::KinBodyInfoPtr pinfo = GetCollisionInfo(*itbody);
+            if( !pinfo ) {
+                continue;
+            }
+            vquerybodies.push_back(pinfo.get());
+            FOREACHC(itlink, pinfo->vlinks) {
+                if( (*itlink)->plink->IsEnabled() ) {
+                    vqueryobjs.push_back((*itlink)->obj.get());
                 }
             }
+        }
+        std::sort(vqueryobjs.begin(), vqueryobjs.end());
+    }
 
-            contactManifold->clearManifold();
+    /// \brief sets the object of the link as the only query object
+    void _GetLinkQueryObjects(KinBody::LinkConstPtr plink, std::vector<btCollisionObject*>& vqueryobjs, std::vector<BulletSpace::KinBodyInfo*>& vquerybodies)
+    {
+        vqueryobjs.resize(0);
+        vqueryobjs.push_back(bulletspace->GetLinkBody(plink).get());
+        vquerybodies.resize(0);
+        vquerybodies.push_back(GetCollisionInfo(plink->GetParent()).get());
+    }
 
-            if( bHasCallbacks ) {
-                if( listcallbacks.size() == 0 ) {
-                    GetEnv()->GetRegisteredCollisionCallbacks(listcallbacks);
-                }
-                bool bDefaultAction = true;
-                FOREACHC(itfn, listcallbacks) {
-                    OpenRAVE::CollisionAction action = (*itfn)(report,false);
-                    if( action != OpenRAVE::CA_DefaultAction ) {
-                        report->Reset();
-                        bDefaultAction = false;
-                        break;
-                    }
+    /// \brief true if the pairs of the cache still contain all the pairs the query objects can overlap with
+    bool _IsPairCacheValid(const BodyPairCache& paircache, const std::vector<btCollisionObject*>& vqueryobjs, const std::vector<BulletSpace::KinBodyInfo*>& vquerybodies) const
+    {
+        if( paircache.nSyncStamp < 0 || paircache.vqueryobjs != vqueryobjs || paircache.vquerybodies != vquerybodies ) {
+            return false;
+        }
+        // every synchronization that is not of a queried body moved some other object, which could now overlap the queried ones
+        int nquerysynccount = 0;
+        FOREACHC(itinfo, vquerybodies) {
+            nquerysynccount += (*itinfo)->nSyncCount;
+        }
+        if( bulletspace->GetSyncStamp() - paircache.nSyncStamp != nquerysynccount - paircache.nQuerySyncCount ) {
+            return false;
+        }
+        for(size_t iobj = 0; iobj < vqueryobjs.size(); ++iobj) {
+            const btBroadphaseProxy* pproxy = vqueryobjs[iobj]->getBroadphaseHandle();
+            if( !pproxy ) {
+                continue;
+            }
+            for(int j = 0; j < 3; ++j) {
+                if( pproxy->m_aabbMin[j] < paircache.vaabbmin[iobj][j] || pproxy->m_aabbMax[j] > paircache.vaabbmax[iobj][j] ) {
+                    return false;
                 }
+            }
+        }
+        return true;
+    }
 
-                if( !bDefaultAction ) {
+    /// \brief checks the query objects against everything overlapping them in the broadphase
+    ///
+    /// Pairs between other objects in the world are never touched. The pairs are regathered only when another body moved or a queried
+    /// object left the margin around the aabb it was gathered with, see BodyPairCache.
+    /// \param vqueryobjs sorted objects, see _GetQueryObjects
+    /// \param vquerybodies the bodies of vqueryobjs
+    bool _CheckCollisionPairs(BodyPairCache& paircache, const std::vector<btCollisionObject*>& vqueryobjs, const std::vector<BulletSpace::KinBodyInfo*>& vquerybodies, OpenRAVEFilterCallback* pfilter, CollisionReportPtr report)
+    {
+        if( !!report ) {
+            report->Reset(_options);
+        }
+        if( !_IsPairCacheValid(paircache, vqueryobjs, vquerybodies) ) {
+            // two queried objects can both move by the margin towards each other, so the test uses twice the margin
+            const btVector3 vmargin(_fPairCacheMargin, _fPairCacheMargin, _fPairCacheMargin);
+            paircache.vaabbmin.resize(vqueryobjs.size());
+            paircache.vaabbmax.resize(vqueryobjs.size());
+            _vgatheredpairs.resize(0);
+            for(size_t iobj = 0; iobj < vqueryobjs.size(); ++iobj) {
+                btBroadphaseProxy* pproxy = vqueryobjs[iobj]->getBroadphaseHandle();
+                if( !pproxy ) {
                     continue;
                 }
+                paircache.vaabbmin[iobj] = pproxy->m_aabbMin - vmargin;
+                paircache.vaabbmax[iobj] = pproxy->m_aabbMax + vmargin;
+                QueryAabbCallback callback(pproxy, vqueryobjs, _vgatheredpairs);
+                _broadphase->aabbTest(paircache.vaabbmin[iobj] - vmargin, paircache.vaabbmax[iobj] + vmargin, callback);
             }
-
-            // collision, so clear the rest and return
-            for (int j=i+1; j<numManifolds; j++) {
-                _world->getDispatcher()->getManifoldByIndexInternal(j)->clearManifold();
+            std::sort(_vgatheredpairs.begin(), _vgatheredpairs.end());
+
+            // keep the algorithms of the pairs that are still overlapping
+            std::map< std::pair<btBroadphaseProxy*, btBroadphaseProxy*>, btBroadphasePair > mapnewpairs;
+            FOREACHC(itkey, _vgatheredpairs) {
+                std::map< std::pair<btBroadphaseProxy*, btBroadphaseProxy*>, btBroadphasePair >::iterator itold = paircache.mappairs.find(*itkey);
+                if( itold != paircache.mappairs.end() ) {
+                    mapnewpairs.insert(mapnewpairs.end(), *itold);
+                    paircache.mappairs.erase(itold);
+                }
+                else {
+                    mapnewpairs.insert(mapnewpairs.end(), std::make_pair(*itkey, btBroadphasePair(*itkey->first, *itkey->second)));
+                }
+            }
+            FOREACH(itpair, paircache.mappairs) {
+                _FreePairAlgorithm(itpair->second);
+            }
+            paircache.mappairs.swap(mapnewpairs);
+            paircache.vqueryobjs = vqueryobjs;
+            paircache.vquerybodies = vquerybodies;
+            paircache.nSyncStamp = bulletspace->GetSyncStamp();
+            paircache.nQuerySyncCount = 0;
+            FOREACHC(itinfo, vquerybodies) {
+                paircache.nQuerySyncCount += (*itinfo)->nSyncCount;
             }
-            return true;
         }
 
+        bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
+        std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
+        SetFilterScope filter(_dispatcher, _world->getPairCache(), pfilter);
+        btManifoldArray manifolds;
+        FOREACH(itpair, paircache.mappairs) {
+            btBroadphasePair& pair = itpair->second;
+            if( !pfilter->needBroadphaseCollision(pair.m_pProxy0, pair.m_pProxy1) ) {
+                continue;
+            }
+            if( !!pair.m_algorithm ) {
+                // contacts left from previous queries do not describe the current transforms
+                manifolds.resize(0);
+                pair.m_algorithm->getAllContactManifolds(manifolds);
+                for(int i = 0; i < manifolds.size(); ++i) {
+                    manifolds[i]->clearManifold();
+                }
+            }
+            (_dispatcher->getNearCallback())(pair, *_dispatcher, _world->getDispatchInfo());
+            if( !pair.m_algorithm ) {
+                continue;
+            }
+            manifolds.resize(0);
+            pair.m_algorithm->getAllContactManifolds(manifolds);
+            for(int i = 0; i < manifolds.size(); ++i) {
+                if( _ProcessManifold(manifolds[i], report, bHasCallbacks, listcallbacks) ) {
+                    return true;
+                }
+            }
+        }
         return false;
     }
 
+    /// \brief fills the hit of a ray callback into the outputs of CheckCollisionRays
+    static bool _GetRayHit(AllRayResultCallback& rayCallback, dReal& fhitdistance, Vector& vhitnormal, int& hitbodyid)
+    {
+        if( !rayCallback.hasHit() ) {
+            fhitdistance = -1;
+            vhitnormal = Vector();
+            hitbodyid = 0;
+            return false;
+        }
+        fhitdistance = (rayCallback.m_hitPointWorld-rayCallback.m_rayFromWorld).length();
+        vhitnormal = Vector(rayCallback.m_hitNormalWorld[0], rayCallback.m_hitNormalWorld[1], rayCallback.m_hitNormalWorld[2]);
+        vhitnormal.normalize3();
+        hitbodyid = GetLinkFromCollision(rayCallback.m_collisionObject)->GetParent()->GetEnvironmentId();
+        return true;
+    }
+
 public:
-    BulletCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput) : CollisionCheckerBase(penv), bulletspace(new BulletSpace(penv, GetCollisionInfo, false)), _options(0) {
+    BulletCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput) : CollisionCheckerBase(penv), bulletspace(new BulletSpace(penv, GetCollisionInfo, false)), _options(0), _nPairCacheGeometryStamp(0), _fPairCacheMargin(0.05) {
         __description = ":Interface Author: Rosen Diankov\n\nCollision checker from the `Bullet Physics Package <http://bulletphysics.org>`";
         _userdatakey = std::string("bulletcollision");
     }
@@ -414,6 +631,9 @@ public:
 
     virtual void DestroyEnvironment()
     {
+        if( !!_dispatcher ) {
+            _ClearPairCaches();
+        }
         // go through all the KinBodies and destory their collision pointers
         vector<KinBodyPtr> vbodies;
         GetEnv()->GetBodies(vbodies);
@@ -432,6 +652,13 @@ public:
 
     virtual bool InitKinBody(KinBodyPtr pbody)
     {
+        BulletSpace::KinBodyInfoPtr pexistinginfo = GetCollisionInfo(pbody);
+        // need the pbody check since kinbodies can be cloned and could have the wrong pointer
+        if( !!pexistinginfo && pexistinginfo->pbody == pbody ) {
+            // geometry changes are tracked by the space already, so grabbing the body again does not have to recreate its objects
+            return true;
+        }
+        _ClearPairCaches();
         UserDataPtr pinfo = bulletspace->InitKinBody(pbody);
         pbody->SetUserData("bulletcollision", pinfo);
         return !!pinfo;
@@ -440,6 +667,8 @@ public:
     virtual void RemoveKinBody(KinBodyPtr pbody)
     {
         if( !!pbody ) {
+            // the cached pairs can point to the proxies of the body
+            _ClearPairCaches();
             pbody->RemoveUserData("bulletcollision");
         }
     }
@@ -472,10 +701,8 @@ public:
         bulletspace->Synchronize();
 
         KinBodyFilterCallback kinbodycallback(shared_collisionchecker(),pbody);
-        if( CheckCollisionP(&kinbodycallback, report) ) {
-            return true;
-        }
-        return false;
+        _GetQueryObjects(pbody, true, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(pbody, -1), _vqueryobjs, _vquerybodies, &kinbodycallback, report);
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, CollisionReportPtr report)
@@ -495,7 +722,8 @@ public:
         bulletspace->Synchronize();
 
         KinBodyFilterCallback kinbodycallback(shared_collisionchecker(),pbody1,pbody2);
-        return CheckCollisionP(&kinbodycallback, report);
+        _GetQueryObjects(pbody1, true, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(pbody1, -1), _vqueryobjs, _vquerybodies, &kinbodycallback, report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report)
@@ -509,7 +737,8 @@ public:
 
         _linkcallback._pcollink0 = plink;
         _linkcallback._pcollink1.reset();
-        return CheckCollisionP(&_linkcallback, report);
+        _GetLinkQueryObjects(plink, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(plink->GetParent(), plink->GetIndex()), _vqueryobjs, _vquerybodies, &_linkcallback, report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report)
@@ -526,7 +755,8 @@ public:
         bulletspace->Synchronize();
         _linkcallback._pcollink0 = plink1;
         _linkcallback._pcollink1 = plink2;
-        return CheckCollisionP(&_linkcallback, report);
+        _GetLinkQueryObjects(plink1, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(plink1->GetParent(), plink1->GetIndex()), _vqueryobjs, _vquerybodies, &_linkcallback, report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report)
@@ -546,7 +776,8 @@ public:
         KinBodyLinkFilterCallback kinbodylinkcallback;
         kinbodylinkcallback._pcollink = plink;
         kinbodylinkcallback._pbody = pbody;
-        return CheckCollisionP(&kinbodylinkcallback, report);
+        _GetLinkQueryObjects(plink, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(plink->GetParent(), plink->GetIndex()), _vqueryobjs, _vquerybodies, &kinbodylinkcallback, report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
@@ -570,7 +801,8 @@ public:
         bulletspace->Synchronize();
 
         KinBodyFilterExCallback kinbodyexcallback(shared_collisionchecker(),pbody,vbodyexcluded);
-        return CheckCollisionP(&kinbodyexcallback, report);
+        _GetQueryObjects(pbody, true, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(pbody, -1), _vqueryobjs, _vquerybodies, &kinbodyexcallback, report);
     }
 
     virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report)
@@ -584,7 +816,6 @@ public:
             report->Reset();
 
         bulletspace->Synchronize();
-        _world->updateAabbs();
 
         if( fabsf(sqrtf(ray.dir.lengthsqr3())-1) < 1e-4 )
             RAVELOG_DEBUG("CheckCollision: ray direction length is 1.0, note that only collisions within a distance of 1.0 will be checked\n");
@@ -647,7 +878,6 @@ public:
         }
 
         bulletspace->Synchronize();
-        _world->updateAabbs();
 
         if( fabsf(sqrtf(ray.dir.lengthsqr3())-1) < 1e-4 )
             RAVELOG_DEBUG("CheckCollision: ray direction length is 1.0, note that only collisions within a distance of 1.0 will be checked\n");
@@ -710,7 +940,6 @@ public:
             report->Reset();
         }
         bulletspace->Synchronize();
-        _world->updateAabbs();
 
         if( fabsf(sqrtf(ray.dir.lengthsqr3())-1) < 1e-4 ) {
             RAVELOG_DEBUG("CheckCollision: ray direction length is 1.0, note that only collisions within a distance of 1.0 will be checked\n");
@@ -782,8 +1011,9 @@ public:
         }
         LinkAdjacentFilterCallback linkadjacent(pbody, pbody->GetNonAdjacentLinks(adjacentoptions));
         bulletspace->Synchronize(); // call after GetNonAdjacentLinks since it can modify the body, even though it is const!
-        bool bCollision = CheckCollisionP(&linkadjacent, report);
-        return bCollision;
+        // only the links of the body, the grabbed bodies are checked by KinBody::CheckSelfCollision like for the other checkers
+        _GetQueryObjects(pbody, false, _vqueryobjs, _vquerybodies);
+        return _CheckCollisionPairs(_GetPairCache(pbody, -2), _vqueryobjs, _vquerybodies, &linkadjacent, report);
     }
 
     virtual bool CheckStandaloneSelfCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report)
@@ -792,6 +1022,100 @@ public:
         return CheckStandaloneSelfCollision(plink->GetParent(), report);
     }
 
+    virtual int CheckCollisionConfigurations(KinBodyPtr pbody, const std::vector<int>& vdofindices, const std::vector<dReal>& vconfigurations, std::vector<uint8_t>& vcollisions, bool bCheckSelfCollision=true)
+    {
+        const size_t dof = vdofindices.size() > 0 ? vdofindices.size() : (size_t)pbody->GetDOF();
+        vcollisions.resize(0);
+        if( dof == 0 ) {
+            return 0;
+        }
+        OPENRAVE_ASSERT_OP(vconfigurations.size()%dof, ==, 0);
+        const size_t numconfigurations = vconfigurations.size()/dof;
+        vcollisions.resize(numconfigurations, 0);
+        if(( pbody->GetLinks().size() == 0) || !pbody->IsEnabled() ) {
+            return 0;
+        }
+
+        KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+        KinBodyFilterCallback kinbodycallback(shared_collisionchecker(),pbody);
+
+        // the rest of the environment does not move between the configurations, so only the queried bodies are synchronized inside the loop
+        bulletspace->Synchronize();
+        std::set<KinBodyConstPtr> setattached;
+        pbody->GetAttached(setattached);
+        std::vector<dReal> vvalues(dof);
+        int numcollisions = 0;
+        for(size_t iconfig = 0; iconfig < numconfigurations; ++iconfig) {
+            std::copy(vconfigurations.begin()+iconfig*dof, vconfigurations.begin()+(iconfig+1)*dof, vvalues.begin());
+            pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing, vdofindices);
+            FOREACHC(itbody, setattached) {
+                if( !!GetCollisionInfo(*itbody) ) {
+                    bulletspace->Synchronize(*itbody);
+                }
+            }
+            _GetQueryObjects(pbody, true, _vqueryobjs, _vquerybodies);
+            // KinBody::CheckSelfCollision also checks the grabbed bodies against the links of pbody
+            if( _CheckCollisionPairs(_GetPairCache(pbody, -1), _vqueryobjs, _vquerybodies, &kinbodycallback, CollisionReportPtr()) || (bCheckSelfCollision && pbody->CheckSelfCollision(CollisionReportPtr(), shared_collisionchecker())) ) {
+                vcollisions[iconfig] = 1;
+                ++numcollisions;
+            }
+        }
+        return numcollisions;
+    }
+
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, KinBodyConstPtr pbody, std::vector<dReal>& vhitdistances, std::vector<Vector>& vhitnormals, std::vector<int>& vhitbodyids)
+    {
+        vhitdistances.resize(0);
+        vhitdistances.resize(vrays.size(), -1);
+        vhitnormals.resize(0);
+        vhitnormals.resize(vrays.size(), Vector());
+        vhitbodyids.resize(0);
+        vhitbodyids.resize(vrays.size(), 0);
+        if( !!pbody && (( pbody->GetLinks().size() == 0) || !pbody->IsEnabled()) ) {
+            return 0;
+        }
+
+        // the aabbs are refreshed along with the transforms, so one synchronization serves the whole batch
+        bulletspace->Synchronize();
+
+        std::vector<BulletSpace::KinBodyInfo::LINK*> vlinks;
+        if( !!pbody ) {
+            CollisionFilterCallback filtercallback(shared_collisionchecker(),pbody);
+            BulletSpace::KinBodyInfoPtr pinfo = GetCollisionInfo(pbody);
+            BOOST_ASSERT(pinfo->pbody == pbody );
+            FOREACH(itlink,pinfo->vlinks) {
+                if( (*itlink)->plink->IsEnabled() && filtercallback.IsActiveLink(pbody,(*itlink)->plink->GetIndex()) ) {
+                    vlinks.push_back(itlink->get());
+                }
+            }
+        }
+
+        int numhits = 0;
+        btTransform rayFromTrans, rayToTrans;
+        rayFromTrans.setIdentity();
+        rayToTrans.setIdentity();
+        for(size_t iray = 0; iray < vrays.size(); ++iray) {
+            btVector3 from = BulletSpace::GetBtVector(vrays[iray].pos);
+            btVector3 to = BulletSpace::GetBtVector(vrays[iray].pos+vrays[iray].dir);
+            AllRayResultCallback rayCallback(from,to,pbody);
+            if( !!pbody ) {
+                rayFromTrans.setOrigin(from);
+                rayToTrans.setOrigin(to);
+                FOREACH(itlink, vlinks) {
+                    _world->rayTestSingle(rayFromTrans,rayToTrans,(*itlink)->obj.get(),(*itlink)->shape.get(),(*itlink)->obj->getWorldTransform(),rayCallback);
+                }
+            }
+            else {
+                // disabled links are rejected by the callback instead of being moved away like CheckCollision(RAY) does
+                _world->rayTest(from,to,rayCallback);
+            }
+            if( _GetRayHit(rayCallback, vhitdistances[iray], vhitnormals[iray], vhitbodyids[iray]) ) {
+                ++numhits;
+            }
+        }
+        return numhits;
+    }
+
     virtual void SetTolerance(dReal tolerance) {
         RAVELOG_WARN("not implemented\n");
     }
@@ -807,6 +1131,13 @@ private:
     boost::shared_ptr<btCollisionWorld> _world;
 
     LinkFilterCallback _linkcallback;
+
+    std::map< std::pair<int, int>, BodyPairCache > _mapPairCaches; ///< indexed by the body environment id and the link index, see _GetPairCache
+    int _nPairCacheGeometryStamp; ///< BulletSpace::GetGeometryStamp when _mapPairCaches was last valid
+    btScalar _fPairCacheMargin; ///< how far the queried objects can move before their cached pairs are gathered again
+    std::vector<btCollisionObject*> _vqueryobjs; ///< cache
+    std::vector<BulletSpace::KinBodyInfo*> _vquerybodies; ///< cache
+    std::vector< std::pair<btBroadphaseProxy*, btBroadphaseProxy*> > _vgatheredpairs; ///< cache
 };
 
 CollisionCheckerBasePtr CreateBulletCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput)
@@ -192,6 +192,7 @@ public:
 	stringstream ss;        
 	__description = ":Interface Authors: Max Argus, Nick Hillier, Katrina Monkley, Rosen Diankov\n\nInterface to `Bullet Physics Engine <http://bulletphysics.org/>`_\n";
         RegisterCommand("SetStaticBodyTransform",boost::bind(&BulletPhysicsEngine::SetStaticBodyTransform,this,_1,_2),"Sets the transformation of a static body manually, not allowed to use for dynamic bodies and it should be used with caution even for static bodies because it can cause instabilities in physics engine.");
+        _options = OpenRAVE::PEO_AutoDisable; // bullet puts resting bodies to sleep by default
         _solver_iterations = 5;
         _margin_depth = 0.001;
         _linear_damping = 0.1;
@@ -437,6 +438,7 @@ public:
                   }
              }
             }
+            _UpdateDeactivation(pbody, pinfo);
         }
         return !!pinfo;
     }
@@ -452,6 +454,14 @@ public:
     virtual bool SetPhysicsOptions(int physicsoptions)
     {
         _options = physicsoptions;
+        vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        FOREACHC(itbody, vbodies) {
+            BulletSpace::KinBodyInfoPtr pinfo = GetPhysicsInfo(*itbody);
+            if( !!pinfo ) {
+                _UpdateDeactivation(*itbody, pinfo);
+            }
+        }
         return true;
     }
 
@@ -471,6 +481,7 @@ public:
         if( !rigidbody ) {
             RAVELOG_DEBUG(str(boost::format("link %s does not have rigid body")%plink->GetName()));
         }
+        rigidbody->activate(true);
         rigidbody->setLinearVelocity(BulletSpace::GetBtVector(linearvel));
         rigidbody->setAngularVelocity(BulletSpace::GetBtVector(angularvel));
         return false;
@@ -481,6 +492,7 @@ public:
         FOREACH(itlink, pinfo->vlinks) {
             if( !!(*itlink)->_rigidbody ) {
                 int index = (*itlink)->plink->GetIndex();
+                (*itlink)->_rigidbody->activate(true);
                 (*itlink)->_rigidbody->setLinearVelocity(BulletSpace::GetBtVector(velocities.at(index).first));
                 (*itlink)->_rigidbody->setAngularVelocity(BulletSpace::GetBtVector(velocities.at(index).second));
             }
@@ -576,6 +588,8 @@ public:
         std::copy(pTorques.begin(),pTorques.end(),vtorques.begin());
         btRigidBody& bodyA = joint->getRigidBodyA();
         btRigidBody& bodyB = joint->getRigidBodyB();
+        bodyA.activate(true);
+        bodyB.activate(true);
         
        switch(joint->getConstraintType()) {
         
@@ -626,6 +640,7 @@ public:
         btVector3 _Force(force[0], force[1], force[2]);
         btVector3 _Position(position[0], position[1], position[2]);
         _space->Synchronize(KinBodyConstPtr(plink->GetParent()));
+        rigidbody->activate(true);
         if( !bAdd ) {
             rigidbody->clearForces();
         }
@@ -639,6 +654,7 @@ public:
         btVector3 _Torque(torque[0], torque[1], torque[2]);
         boost::shared_ptr<btRigidBody> rigidbody = boost::dynamic_pointer_cast<btRigidBody>(_space->GetLinkBody(plink));
         _space->Synchronize(KinBodyConstPtr(plink->GetParent()));
+        rigidbody->activate(true);
         if( !bAdd ) {
             rigidbody->clearForces();
         }
@@ -663,14 +679,26 @@ public:
     virtual void SimulateStep(dReal fTimeElapsed)
     {
         _space->Synchronize();
+
+        // bodies that sleep before and after the step did not move
+        vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        _vbodyawake.resize(vbodies.size());
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            _vbodyawake[ibody] = _IsAwake(GetPhysicsInfo(vbodies[ibody]));
+        }
+
         int maxSubSteps = 0;  // --> reduced sub steps
         //_dynamicsWorld->applyGravity();
         _dynamicsWorld->stepSimulation(0.005,maxSubSteps); //-> reduced elapse time
 
-        vector<KinBodyPtr> vbodies;
-        GetEnv()->GetBodies(vbodies);
-        FOREACHC(itbody, vbodies) {
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            std::vector<KinBodyPtr>::const_iterator itbody = vbodies.begin()+ibody;
             BulletSpace::KinBodyInfoPtr pinfo = GetPhysicsInfo(*itbody);
+            if( !_vbodyawake[ibody] && !_IsAwake(pinfo) ) {
+                pinfo->nLastStamp = (*itbody)->GetUpdateStamp();
+                continue;
+            }
             FOREACH(itlink, pinfo->vlinks) {
                 Transform t = BulletSpace::GetTransform((*itlink)->_rigidbody->getCenterOfMassTransform());
                 (*itlink)->plink->SetTransform(t*(*itlink)->tlocal.inverse());
@@ -698,11 +726,43 @@ private:
         return boost::dynamic_pointer_cast<BulletSpace::KinBodyInfo>(pbody->GetUserData("bulletphysics"));
     }
 
+    /// \brief true if any link of the body is simulated and not sleeping
+    static bool _IsAwake(BulletSpace::KinBodyInfoConstPtr pinfo)
+    {
+        if( !pinfo ) {
+            return false;
+        }
+        FOREACHC(itlink, pinfo->vlinks) {
+            if( !!(*itlink)->_rigidbody && (*itlink)->_rigidbody->isActive() ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief lets the dynamic links of the body sleep if PEO_AutoDisable is set. Robots are always kept awake so they can be commanded.
+    void _UpdateDeactivation(KinBodyConstPtr pbody, BulletSpace::KinBodyInfoPtr pinfo)
+    {
+        bool bAutoDisable = (_options & OpenRAVE::PEO_AutoDisable) && !pbody->IsRobot();
+        FOREACH(itlink, pinfo->vlinks) {
+            if( !(*itlink)->_rigidbody || (*itlink)->plink->IsStatic() ) {
+                continue;
+            }
+            if( !bAutoDisable ) {
+                (*itlink)->_rigidbody->forceActivationState(DISABLE_DEACTIVATION);
+            }
+            else if( (*itlink)->_rigidbody->getActivationState() == DISABLE_DEACTIVATION ) {
+                (*itlink)->_rigidbody->forceActivationState(ACTIVE_TAG);
+            }
+        }
+    }
+
     void _SyncCallback(BulletSpace::KinBodyInfoConstPtr pinfo)
     {
-        // reset dynamics
+        // reset dynamics and wake the body up in case it was sleeping
         FOREACH(itlink, pinfo->vlinks) {
             if( !!(*itlink)->_rigidbody ) {
+                (*itlink)->_rigidbody->activate(true);
                 (*itlink)->_rigidbody->setLinearVelocity(btVector3(0,0,0));
                 (*itlink)->_rigidbody->setAngularVelocity(btVector3(0,0,0));
             }
@@ -710,6 +770,7 @@ private:
     }
 
     int _options;
+    std::vector<uint8_t> _vbodyawake; ///< for every body of the current step, 1 if it was awake before stepping
     boost::shared_ptr<BulletSpace> _space;
     boost::shared_ptr<btDiscreteDynamicsWorld> _dynamicsWorld;
     boost::shared_ptr<btDefaultCollisionConfiguration> _collisionConfiguration;
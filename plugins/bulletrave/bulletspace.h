@@ -77,6 +77,7 @@ public:
 
         KinBodyInfo(boost::shared_ptr<btCollisionWorld> world, bool bPhysics) : _world(world), _bPhysics(bPhysics) {
             nLastStamp = 0;
+            nSyncCount = 0;
             _worlddynamics = boost::dynamic_pointer_cast<btDiscreteDynamicsWorld>(_world);
         }
         virtual ~KinBodyInfo() {
@@ -103,6 +104,7 @@ public:
 
         KinBodyPtr pbody;     ///< body associated with this structure
         int nLastStamp;
+        int nSyncCount; ///< number of times the transforms of the body were pushed to the bullet objects
 
         std::vector<boost::shared_ptr<LINK> > vlinks;     ///< if body is disabled, then geom is static (it can't be connected to a joint!)
         ///< the pointer to this Link is the userdata
@@ -122,7 +124,7 @@ private:
     typedef boost::function<KinBodyInfoPtr(KinBodyConstPtr)> GetInfoFn;
     typedef boost::function<void (KinBodyInfoPtr)> SynchronizeCallbackFn;
 
-    BulletSpace(EnvironmentBasePtr penv, const GetInfoFn& infofn, bool bPhysics) : _penv(penv), GetInfo(infofn), _bPhysics(bPhysics) {
+    BulletSpace(EnvironmentBasePtr penv, const GetInfoFn& infofn, bool bPhysics) : _penv(penv), GetInfo(infofn), _bPhysics(bPhysics), _nSyncStamp(0), _nGeometryStamp(0) {
     }
     virtual ~BulletSpace() {
     }
@@ -150,6 +152,7 @@ private:
             pinfo.reset(new KinBodyInfo(_world,_bPhysics));
         }
         pinfo->Reset();
+        ++_nGeometryStamp;
         pinfo->pbody = pbody;
         pinfo->_bulletspace = weak_space();
         pinfo->vlinks.reserve(pbody->GetLinks().size());
@@ -413,6 +416,16 @@ private:
         _synccallback = synccallback;
     }
 
+    /// \brief incremented every time the transforms of a body are pushed to the bullet objects
+    int GetSyncStamp() const {
+        return _nSyncStamp;
+    }
+
+    /// \brief incremented every time the bullet objects of a body are (re)created
+    int GetGeometryStamp() const {
+        return _nGeometryStamp;
+    }
+
     static inline Transform GetTransform(const btTransform &t)
     {
         return Transform(Vector(t.getRotation().getW(), t.getRotation().getX(), t.getRotation().getY(), t.getRotation().getZ()), Vector(t.getOrigin().getX(), t.getOrigin().getY(), t.getOrigin().getZ()));
@@ -446,7 +459,13 @@ private:
         BOOST_ASSERT( vtrans.size() == pinfo->vlinks.size() );
         for(size_t i = 0; i < vtrans.size(); ++i) {
             pinfo->vlinks[i]->obj->getWorldTransform() = GetBtTransform(vtrans[i]*pinfo->vlinks[i]->tlocal);
+            if( !!_world ) {
+                // only the moved objects need their broadphase proxies refreshed
+                _world->updateSingleAabb(pinfo->vlinks[i]->obj.get());
+            }
         }
+        ++pinfo->nSyncCount;
+        ++_nSyncStamp;
         if( !!_synccallback ) {
             _synccallback(pinfo);
         }
@@ -471,6 +490,8 @@ private:
     boost::shared_ptr<btDiscreteDynamicsWorld> _worlddynamics;
     SynchronizeCallbackFn _synccallback;
     bool _bPhysics;
+    int _nSyncStamp; ///< see GetSyncStamp
+    int _nGeometryStamp; ///< see GetGeometryStamp
 };
 
 static KinBody::LinkPtr GetLinkFromCollision(const btCollisionObject* co) {
@@ -50,12 +50,20 @@ public:
                         "save self collision cache");
         RegisterCommand("LoadCache",boost::bind(&CacheCollisionChecker::_LoadCacheCommand,this,_1,_2),
                         "load self collision cache");
+        RegisterCommand("SaveCacheSnapshot",boost::bind(&CacheCollisionChecker::_SaveCacheSnapshotCommand,this,_1,_2),
+                        "\"cachetype [filename]\", save the cache (cachetype is env or self) to a binary snapshot that can be memory mapped. The default filename of the self collision cache is the database file selfcache.[hash].snapshot");
+        RegisterCommand("LoadCacheSnapshot",boost::bind(&CacheCollisionChecker::_LoadCacheSnapshotCommand,this,_1,_2),
+                        "\"cachetype [filename]\", memory map a snapshot saved with SaveCacheSnapshot into the cache (cachetype is env or self). The snapshot is used read-only, new configurations are inserted next to it.");
         RegisterCommand("GetCacheTimes",boost::bind(&CacheCollisionChecker::_GetCacheTimesCommand,this,_1,_2),
                         "get the cache times: insert, query, collision checking, load");
+        RegisterCommand("SetSharedCache",boost::bind(&CacheCollisionChecker::_SetSharedCacheCommand,this,_1,_2),
+                        "\"shared [selfshared]\", if 1, share the collision cache (and the self collision cache) with the cache checkers of the other environments, e.g. clones used by different planning threads, whose robot and static scene are the same.");
         std::string collisionname="ode";
         sinput >> collisionname;
         _pintchecker = RaveCreateCollisionChecker(GetEnv(), collisionname);
         OPENRAVE_ASSERT_FORMAT(!!_pintchecker, "internal checker %s is not valid", collisionname, ORE_Assert);
+        _pcountercachehit = RegisterPerfCounter("cache.hit");
+        _pcountercachemiss = RegisterPerfCounter("cache.miss");
         _cachedcollisionchecks=0;
         _cachedcollisionhits=0;
         _cachedfreehits = 0;
@@ -77,6 +85,8 @@ public:
         _selfintime = 0;
         _selfquerytime = 0;
         _selfrawtime = 0;
+        _bSharedCache = false;
+        _bSharedSelfCache = false;
 
     }
 
@@ -120,6 +130,7 @@ public:
             }
         }
         _pintchecker->SetGeometryGroup(groupname);
+        _UpdateSharedCaches();
     }
 
     virtual const std::string& GetGeometryGroup() const
@@ -166,6 +177,8 @@ public:
         }
 
         _strRobotName = clone->_strRobotName;
+        _bSharedCache = clone->_bSharedCache;
+        _bSharedSelfCache = clone->_bSharedSelfCache;
         _probot.reset(); // have to rest to force creating a new cache
         _probot = GetRobot();
 
@@ -227,6 +240,12 @@ public:
         }
 
         // cache hit (collision)
+        if( ret == 0 || ret == 1 ) {
+            _pcountercachehit->Add();
+        }
+        else {
+            _pcountercachemiss->Add();
+        }
         if( ret == 1 ) {
             ++_cachedcollisionhits;
             // in collision, create collision report
@@ -303,6 +322,10 @@ public:
         return _pintchecker->CheckCollision(ray, report);
     }
 
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, KinBodyConstPtr pbody, std::vector<dReal>& vhitdistances, std::vector<Vector>& vhitnormals, std::vector<int>& vhitbodyids) {
+        return _pintchecker->CheckCollisionRays(vrays, pbody, vhitdistances, vhitnormals, vhitbodyids);
+    }
+
     virtual bool CheckCollision(const TriMesh& trimesh, KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) {
         return _pintchecker->CheckCollision(trimesh, pbody, report);
     }
@@ -351,6 +374,12 @@ public:
                 _size = _selfcache->GetNumKnownNodes();
             }
         }
+        if( ret == 0 || ret == 1 ) {
+            _pcountercachehit->Add();
+        }
+        else {
+            _pcountercachemiss->Add();
+        }
         if( ret == 1 ) {
             ++_selfcachedcollisionhits;
             // in collision
@@ -389,6 +418,22 @@ public:
     }
 
 protected:
+    virtual bool _SetSharedCacheCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int shared = 0, selfshared = 0;
+        sinput >> shared;
+        if( !sinput ) {
+            return false;
+        }
+        if( !(sinput >> selfshared) ) {
+            selfshared = shared;
+        }
+        _bSharedCache = shared != 0;
+        _bSharedSelfCache = selfshared != 0;
+        _UpdateSharedCaches();
+        return true;
+    }
+
     virtual bool _TrackRobotStateCommand(std::ostream& sout, std::istream& sinput)
     {
         string bodyname;
@@ -408,10 +453,21 @@ protected:
             _selfcache.reset(new ConfigurationCache(_probot, false)); //envupdates should be disabled for self collision cache
 
             _SetParams();
+            _UpdateSharedCaches();
         }
 
-        // check if a selfcache for this robot exists on this disk
+        // check if a selfcache for this robot exists on this disk, snapshots can be used without building the tree
+        std::string snapshotname = RaveFindDatabaseFile("selfcache."+GetCacheHash()+".snapshot");
         std::string fulldirname = RaveFindDatabaseFile(("selfcache."+GetCacheHash()));
+        if( snapshotname.size() > 0 && _selfcache->GetNumKnownNodes() == 0 ) {
+            _stime = utils::GetMilliTime();
+            if( _selfcache->LoadSnapshot(snapshotname) ) {
+                _loadtime = utils::GetMilliTime()-_stime;
+                _size = _selfcache->GetNumKnownNodes();
+                RAVELOG_VERBOSE_FORMAT("Mapped %d configurations in %d ms from %s", _size%_loadtime%snapshotname);
+                fulldirname.clear();
+            }
+        }
         if (fulldirname != "" && _selfcache->GetNumKnownNodes() == 0) {
             _stime = utils::GetMilliTime();
             _selfcache->LoadCache(GetCacheHash(), GetEnv());
@@ -589,6 +645,59 @@ protected:
         return true;
     }
 
+    /// \brief parses "cachetype [filename]" of the snapshot commands
+    ///
+    /// \param bwrite if true, the default filename is created if it does not exist
+    ConfigurationCachePtr _GetSnapshotCache(std::istream& sinput, std::string& filename, bool bwrite)
+    {
+        std::string cachetype;
+        sinput >> cachetype >> filename;
+        ConfigurationCachePtr cache;
+        if( cachetype == "env" ) {
+            cache = _cache;
+        }
+        else if( cachetype == "self" ) {
+            cache = _selfcache;
+            if( filename.size() == 0 && !!cache ) {
+                filename = RaveFindDatabaseFile("selfcache."+GetCacheHash()+".snapshot", !bwrite);
+            }
+        }
+        else {
+            RAVELOG_WARN_FORMAT("env=%d, unknown cache type '%s', expected env or self", GetEnv()->GetId()%cachetype);
+            return ConfigurationCachePtr();
+        }
+        if( filename.size() == 0 ) {
+            return ConfigurationCachePtr();
+        }
+        return cache;
+    }
+
+    virtual bool _SaveCacheSnapshotCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::string filename;
+        ConfigurationCachePtr cache = _GetSnapshotCache(sinput, filename, true);
+        if( !cache ) {
+            return false;
+        }
+        _stime = utils::GetMilliTime();
+        bool bsuccess = cache->SaveSnapshot(filename);
+        _savetime += utils::GetMilliTime()-_stime;
+        return bsuccess;
+    }
+
+    virtual bool _LoadCacheSnapshotCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::string filename;
+        ConfigurationCachePtr cache = _GetSnapshotCache(sinput, filename, false);
+        if( !cache ) {
+            return false;
+        }
+        _stime = utils::GetMilliTime();
+        bool bsuccess = cache->LoadSnapshot(filename);
+        _loadtime = utils::GetMilliTime()-_stime;
+        return bsuccess;
+    }
+
     RobotBasePtr GetRobot()
     {
         if( !_probot && _strRobotName.size() > 0 ) {
@@ -643,12 +752,25 @@ protected:
         _selfcache->SetBase(1.8);
     }
 
+    /// \brief shares the caches depending on _bSharedCache and _bSharedSelfCache. Trees are only shared between checkers with the same internal checker and geometry group.
+    void _UpdateSharedCaches()
+    {
+        std::string extrakey = _pintchecker->GetXMLId() + std::string(" ") + _pintchecker->GetGeometryGroup();
+        if( !!_cache ) {
+            _cache->SetShared(_bSharedCache, extrakey);
+        }
+        if( !!_selfcache ) {
+            _selfcache->SetShared(_bSharedSelfCache, extrakey);
+        }
+    }
+
     void _InitializeCache()
     {
         _cache.reset(new ConfigurationCache(_probot));
         _selfcache.reset(new ConfigurationCache(_probot, false)); //envupdates should be disabled for self collision cache
 
         _SetParams();
+        _UpdateSharedCaches();
 
         _cachedcollisionchecks=0;
         _cachedcollisionhits=0;
@@ -666,6 +788,7 @@ protected:
         {
             RAVELOG_VERBOSE_FORMAT("Updating robot dofs, %d/%d",_numdofs%_probot->GetActiveDOF());
             _cache.reset(new ConfigurationCache(_probot));
+            _UpdateSharedCaches();
 
             _numdofs = _probot->GetActiveDOF();
             _dofindices = _probot->GetActiveDOFIndices();
@@ -686,11 +809,13 @@ protected:
     int _numdofs;
     int _cachedcollisionchecks, _cachedcollisionhits, _cachedfreehits, _size;
     int _selfcachedcollisionchecks, _selfcachedcollisionhits, _selfcachedfreehits;
+    PerfCounterPtr _pcountercachehit, _pcountercachemiss; ///< cache and self cache lookups that were answered or had to run the internal checker
     uint64_t _stime, _ftime, _intime, _querytime, _loadtime, _savetime, _rawtime, _resettime, _selfintime, _selfquerytime, _selfrawtime;
     stringstream _ss;
     ostringstream _oss;
 
     UserDataPtr _handleRobotDOFChange;
+    bool _bSharedCache, _bSharedSelfCache; ///< if true, the cache trees are shared with the cache checkers of other environments, see SetSharedCache
 };
 
 CollisionCheckerBasePtr CreateCacheCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput)
@@ -28,6 +28,37 @@ inline dReal Sqr(dReal x) {
     return x*x;
 }
 
+static const uint32_t CACHETREE_SNAPSHOT_MAGIC = 0x7363726f; ///< "orcs"
+static const uint32_t CACHETREE_SNAPSHOT_VERSION = 1;
+
+/// \brief the header of a snapshot file. It is followed by the weights, the states, the nodes, the children and the colliding body names.
+struct CacheTreeSnapshotHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t realsize; ///< sizeof(dReal) of the writer
+    int32_t statedof;
+    int32_t numnodes;
+    int32_t numchildren;
+    int32_t numbodies;
+    int32_t maxlevel;
+    dReal base;
+    dReal maxdistance;
+};
+
+/// \brief a node of a snapshot file
+struct CacheTreeSnapshotNode
+{
+    int32_t childrenoffset; ///< index of the first child in the children array
+    int32_t numchildren;
+    int32_t robotlinkindex;
+    int32_t collidingbodyindex; ///< index in the colliding body names, -1 if none
+    int32_t collidinglinkindex;
+    int16_t level;
+    uint8_t conftype; ///< CNT_Unknown if the node is not used for nearest neighbor queries
+    uint8_t reserved;
+};
+
 CacheTreeNode::CacheTreeNode(const std::vector<dReal>& cs, Vector* plinkspheres)
 {
     std::copy(cs.begin(), cs.end(), _pcstate);
@@ -42,6 +73,7 @@ CacheTreeNode::CacheTreeNode(const std::vector<dReal>& cs, Vector* plinkspheres)
     _hasselfchild = 0;
     _usenn = 1;
     _hitcount = 0;
+    _index = -1;
 }
 
 CacheTreeNode::CacheTreeNode(const dReal* pstate, int dof, Vector* plinkspheres)
@@ -54,12 +86,12 @@ CacheTreeNode::CacheTreeNode(const dReal* pstate, int dof, Vector* plinkspheres)
     _hasselfchild = 0;
     _usenn = 1;
     _hitcount = 0;
+    _index = -1;
 }
 
 void CacheTreeNode::SetCollisionInfo(CollisionReportPtr report)
 {
     if( !!report ) {
-        _collidinglinktrans = report->plink1->GetTransform();
         _robotlinkindex = report->plink1->GetIndex();
         _collidinglink = report->plink2;
         _conftype = CNT_Collision;
@@ -106,11 +138,11 @@ void CacheTreeNode::SetCollisionInfo(int robotlinkindex, int type)
 
 CacheTree::CacheTree(int statedof)
 {
+    _numlinkspheres = 0;
     _poolNodes.reset(new boost::pool<>(sizeof(CacheTreeNode)+sizeof(dReal)*statedof));
     _vnodes.resize(0);
     _dummycs.resize(0);
     _fulldirname.resize(0);
-    _mapNodeIndices.clear();
     _collidingbodyname.resize(0);
 
     _statedof=statedof;
@@ -128,6 +160,7 @@ void CacheTree::Init(const std::vector<dReal>& weights, dReal maxdistance)
 {
     Reset();
     _weights = weights;
+    _UpdateWeights2();
     _statedof = (int)_weights.size();
     _numnodes = 0;
     _base = 2.0;
@@ -150,7 +183,6 @@ void CacheTree::Reset()
     _vnodes.resize(0);
     _dummycs.resize(0);
     _fulldirname.resize(0);
-    _mapNodeIndices.clear();
     _collidingbodyname.resize(0);
 
     // make sure all children are deleted
@@ -167,7 +199,8 @@ void CacheTree::Reset()
     }
     // purge_memory leaks!
     //_poolNodes.purge_memory();
-    _poolNodes.reset(new boost::pool<>(sizeof(CacheTreeNode)+sizeof(dReal)*_statedof));
+    _poolNodes.reset(new boost::pool<>(_GetNodeMemorySize()));
+    _vpoolChildren.clear(); // all children arrays belonged to the deleted nodes
     //_pNodesPool.reset(new boost::pool<>(sizeof(Node)+_dof*sizeof(dReal)));
     _numnodes = 0;
 }
@@ -176,7 +209,49 @@ void CacheTree::Reset()
 static int s_CacheTreeId = 0;
 #endif
 
-CacheTreeNodePtr CacheTree::_CreateCacheTreeNode(const std::vector<dReal>& cs, CollisionReportPtr report)
+void CacheTree::SetNumLinkSpheres(int numlinkspheres)
+{
+    _numlinkspheres = numlinkspheres;
+    Reset(); // reallocates the pool for the new node size
+}
+
+void CacheTree::_SetNodeLinkSpheres(CacheTreeNodePtr pnode, const Vector* plinkspheres)
+{
+    if( _numlinkspheres > 0 && !!plinkspheres ) {
+        pnode->_plinkspheres = (Vector*)((uint8_t*)pnode + sizeof(CacheTreeNode) + sizeof(dReal)*_statedof);
+        std::copy(plinkspheres, plinkspheres+_numlinkspheres, pnode->_plinkspheres);
+    }
+    else {
+        pnode->_plinkspheres = NULL;
+    }
+}
+
+bool CacheTree::_LinkSpheresIntersect(CacheTreeNodeConstPtr pnode, const AABB& ab) const
+{
+    if( !pnode->_plinkspheres ) {
+        return true;
+    }
+    for(int isphere = 0; isphere < _numlinkspheres; ++isphere) {
+        const Vector& sphere = pnode->_plinkspheres[isphere];
+        if( sphere.w < 0 ) {
+            continue;
+        }
+        // squared distance from the center to the box
+        dReal fdist2 = 0;
+        for(int j = 0; j < 3; ++j) {
+            dReal f = RaveFabs(sphere[j] - ab.pos[j]) - ab.extents[j];
+            if( f > 0 ) {
+                fdist2 += f*f;
+            }
+        }
+        if( fdist2 <= sphere.w ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CacheTreeNodePtr CacheTree::_CreateCacheTreeNode(const std::vector<dReal>& cs, CollisionReportPtr report, const Vector* plinkspheres)
 {
     // allocate memory for the structure and the internal state vectors
     void* pmemory;
@@ -184,11 +259,11 @@ CacheTreeNodePtr CacheTree::_CreateCacheTreeNode(const std::vector<dReal>& cs, C
         //boost::mutex::scoped_lock lock(_mutexpool);
         pmemory = _poolNodes->malloc();
     }
-    //Vector* plinkspheres = (Vector*)((uint8_t*)pmemory + sizeof(CacheTreeNode) + sizeof(dReal)*_statedof);
     CacheTreeNodePtr newnode = new (pmemory) CacheTreeNode(cs, NULL);
 #ifdef _DEBUG
     newnode->id = s_CacheTreeId++;
 #endif
+    _SetNodeLinkSpheres(newnode, plinkspheres);
     newnode->SetCollisionInfo(report);
     return newnode;
 }
@@ -201,16 +276,16 @@ CacheTreeNodePtr CacheTree::_CloneCacheTreeNode(CacheTreeNodeConstPtr refnode)
         //boost::mutex::scoped_lock lock(_mutexpool);
         pmemory = _poolNodes->malloc();
     }
-    //Vector* plinkspheres = (Vector*)((uint8_t*)pmemory + sizeof(CacheTreeNode) + sizeof(dReal)*_statedof);
-    CacheTreeNodePtr clonenode = new (pmemory) CacheTreeNode(refnode->GetConfigurationState(), _statedof, refnode->_plinkspheres);
+    CacheTreeNodePtr clonenode = new (pmemory) CacheTreeNode(refnode->GetConfigurationState(), _statedof, NULL);
 #ifdef _DEBUG
     clonenode->id = s_CacheTreeId++;
 #endif
+    // copy the spheres since refnode can be deleted before its clone
+    _SetNodeLinkSpheres(clonenode, refnode->_plinkspheres);
     clonenode->_conftype = refnode->_conftype;
-    clonenode->_hitcount = refnode->_hitcount;
+    clonenode->_hitcount = refnode->_hitcount.load();
     if( clonenode->IsInCollision() ) {
         clonenode->_collidinglink = refnode->_collidinglink;
-        clonenode->_collidinglinktrans = refnode->_collidinglinktrans;
         clonenode->_robotlinkindex = refnode->_robotlinkindex;
     }
 
@@ -219,10 +294,72 @@ CacheTreeNodePtr CacheTree::_CloneCacheTreeNode(CacheTreeNodeConstPtr refnode)
 
 void CacheTree::_DeleteCacheTreeNode(CacheTreeNodePtr pnode)
 {
+    _FreeChildren(pnode);
     pnode->~CacheTreeNode();
     _poolNodes->free(pnode);
 }
 
+void CacheTree::_AddChild(CacheTreeNodePtr pnode, CacheTreeNodePtr pchild)
+{
+    CacheTreeNodeChildren& children = pnode->_vchildren;
+    if( !children._pnodes || children._num >= (1u<<children._poolindex) ) {
+        _ResizeChildren(pnode, children._num+1);
+        children._pnodes[children._num-1] = pchild;
+    }
+    else {
+        children._pnodes[children._num++] = pchild;
+    }
+}
+
+CacheTreeNodeChildren::iterator CacheTree::_EraseChild(CacheTreeNodePtr pnode, CacheTreeNodeChildren::iterator itchild)
+{
+    CacheTreeNodeChildren& children = pnode->_vchildren;
+    std::copy(itchild+1, children.end(), itchild);
+    children._num--;
+    return itchild;
+}
+
+void CacheTree::_ResizeChildren(CacheTreeNodePtr pnode, size_t numchildren)
+{
+    CacheTreeNodeChildren& children = pnode->_vchildren;
+    if( numchildren == 0 ) {
+        _FreeChildren(pnode);
+        return;
+    }
+    if( !children._pnodes || numchildren > (size_t(1)<<children._poolindex) ) {
+        uint32_t poolindex = 0;
+        while( (size_t(1)<<poolindex) < numchildren ) {
+            ++poolindex;
+        }
+        if( poolindex >= _vpoolChildren.size() ) {
+            _vpoolChildren.resize(poolindex+1);
+        }
+        if( !_vpoolChildren[poolindex] ) {
+            _vpoolChildren[poolindex].reset(new boost::pool<>(sizeof(CacheTreeNodePtr)<<poolindex));
+        }
+        CacheTreeNodePtr* pnodes = (CacheTreeNodePtr*)_vpoolChildren[poolindex]->malloc();
+        std::copy(children.begin(), children.end(), pnodes);
+        _FreeChildren(pnode);
+        children._pnodes = pnodes;
+        children._poolindex = poolindex;
+    }
+    for(size_t i = children._num; i < numchildren; ++i) {
+        children._pnodes[i] = NULL;
+    }
+    children._num = numchildren;
+}
+
+void CacheTree::_FreeChildren(CacheTreeNodePtr pnode)
+{
+    CacheTreeNodeChildren& children = pnode->_vchildren;
+    if( !!children._pnodes ) {
+        _vpoolChildren.at(children._poolindex)->free(children._pnodes);
+        children._pnodes = NULL;
+    }
+    children._num = 0;
+    children._poolindex = 0;
+}
+
 dReal CacheTree::ComputeDistance(const std::vector<dReal>& cstatei, const std::vector<dReal>& cstatef) const
 {
     return RaveSqrt(_ComputeDistance2(&cstatei[0], &cstatef[0]));
@@ -230,18 +367,22 @@ dReal CacheTree::ComputeDistance(const std::vector<dReal>& cstatei, const std::v
 
 dReal CacheTree::_ComputeDistance2(const dReal* cstatei, const dReal* cstatef) const
 {
-    dReal distance = 0;
-    for (size_t i = 0; i < _weights.size(); ++i) {
-        dReal f = (cstatei[i] - cstatef[i]) * _weights[i];
-        distance += f*f;
+    return planningutils::ComputeWeightedDistance2(cstatei, cstatef, (int)_weights2.size(), _weights2.size() > 0 ? &_weights2[0] : NULL);
+}
+
+void CacheTree::_UpdateWeights2()
+{
+    _weights2.resize(_weights.size());
+    for(size_t i = 0; i < _weights.size(); ++i) {
+        _weights2[i] = _weights[i]*_weights[i];
     }
-    return distance;
 }
 
 void CacheTree::SetWeights(const std::vector<dReal>& weights)
 {
     Reset();
     _weights = weights;
+    _UpdateWeights2();
 }
 
 void CacheTree::SetMaxDistance(dReal maxdistance)
@@ -284,22 +425,24 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
     dReal bestdist2 = std::numeric_limits<dReal>::infinity();
     OPENRAVE_ASSERT_OP(vquerystate.size(),==,_weights.size());
     const dReal* pquerystate = &vquerystate[0];
+    // thread local so that several threads can query the same tree at the same time
+    static thread_local std::vector< std::pair<CacheTreeNodePtr, dReal> > vCurrentLevelNodes, vNextLevelNodes;
 
     dReal distancebound2 = Sqr(distancebound);
     int currentlevel = _maxlevel; // where the root node is
     // traverse all levels gathering up the children at each level
     dReal fLevelBound2 = Sqr(_fMaxLevelBound);
-    _vCurrentLevelNodes.resize(1);
-    _vCurrentLevelNodes[0].first = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
-    _vCurrentLevelNodes[0].second = _ComputeDistance2(pquerystate, _vCurrentLevelNodes[0].first->GetConfigurationState());
-    if( (conftype == CNT_Any || _vCurrentLevelNodes[0].first->GetType() == conftype) && _vCurrentLevelNodes[0].first->_usenn ) {
-        pbestnode = _vCurrentLevelNodes[0].first;
-        bestdist2 = _vCurrentLevelNodes[0].second;
-    }
-    while(_vCurrentLevelNodes.size() > 0 ) {
-        _vNextLevelNodes.resize(0);
+    vCurrentLevelNodes.resize(1);
+    vCurrentLevelNodes[0].first = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
+    vCurrentLevelNodes[0].second = _ComputeDistance2(pquerystate, vCurrentLevelNodes[0].first->GetConfigurationState());
+    if( (conftype == CNT_Any || vCurrentLevelNodes[0].first->GetType() == conftype) && vCurrentLevelNodes[0].first->_usenn ) {
+        pbestnode = vCurrentLevelNodes[0].first;
+        bestdist2 = vCurrentLevelNodes[0].second;
+    }
+    while(vCurrentLevelNodes.size() > 0 ) {
+        vNextLevelNodes.resize(0);
         dReal minchilddist2 = std::numeric_limits<dReal>::infinity();
-        FOREACH(itcurrentnode, _vCurrentLevelNodes) {
+        FOREACH(itcurrentnode, vCurrentLevelNodes) {
             // only take the children whose distances are within the bound
             FOREACHC(itchild, itcurrentnode->first->_vchildren) {
                 dReal curdist2 = _ComputeDistance2(pquerystate, (*itchild)->GetConfigurationState());
@@ -313,22 +456,22 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
                         }
                     }
                 }
-                _vNextLevelNodes.emplace_back(*itchild,  curdist2);
+                vNextLevelNodes.emplace_back(*itchild,  curdist2);
                 if( minchilddist2 > curdist2 ) {
                     minchilddist2 = curdist2;
                 }
             }
         }
 
-        _vCurrentLevelNodes.resize(0);
+        vCurrentLevelNodes.resize(0);
         // have to compute dist < RaveSqrt(minchilddist2) + fLevelBound
         // dist2 < m2 + 2mL + L2
 
         dReal ftestbound2 = 4*minchilddist2*fLevelBound2;
-        FOREACH(itnode, _vNextLevelNodes) {
+        FOREACH(itnode, vNextLevelNodes) {
             dReal f = itnode->second - minchilddist2 - fLevelBound2;
             if( f <= 0 || Sqr(f) <= ftestbound2 ) {
-                _vCurrentLevelNodes.push_back(*itnode);
+                vCurrentLevelNodes.push_back(*itnode);
             }
         }
         currentlevel -= 1;
@@ -353,6 +496,8 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
     OPENRAVE_ASSERT_OP(vquerystate.size(),==,_weights.size());
     // first localmax is distance from this node to the root
     const dReal* pquerystate = &vquerystate[0];
+    // thread local so that several threads can query the same tree at the same time
+    static thread_local std::vector< std::pair<CacheTreeNodePtr, dReal> > vCurrentLevelNodes, vNextLevelNodes;
 
     dReal collisionthresh2 = Sqr(collisionthresh), freespacethresh2 = Sqr(freespacethresh);
     // traverse all levels gathering up the children at each level
@@ -372,15 +517,15 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
                 bestnode = make_pair(proot,RaveSqrt(curdist2));
             }
         }
-        _vCurrentLevelNodes.resize(1);
-        _vCurrentLevelNodes[0].first = proot;
-        _vCurrentLevelNodes[0].second = curdist2;
+        vCurrentLevelNodes.resize(1);
+        vCurrentLevelNodes[0].first = proot;
+        vCurrentLevelNodes[0].second = curdist2;
     }
-    dReal pruneradius2 = Sqr(_maxdistance); // the radius to prune all _vCurrentLevelNodes when going through them. Equivalent to min(query,children) + levelbound from the previous iteration
-    while(_vCurrentLevelNodes.size() > 0 ) {
-        _vNextLevelNodes.resize(0);
+    dReal pruneradius2 = Sqr(_maxdistance); // the radius to prune all vCurrentLevelNodes when going through them. Equivalent to min(query,children) + levelbound from the previous iteration
+    while(vCurrentLevelNodes.size() > 0 ) {
+        vNextLevelNodes.resize(0);
         dReal minchilddist=_maxdistance;
-        FOREACH(itcurrentnode, _vCurrentLevelNodes) {
+        FOREACH(itcurrentnode, vCurrentLevelNodes) {
             if( itcurrentnode->second > pruneradius2 ) {
                 continue;
             }
@@ -402,7 +547,7 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
                     }
                 }
                 if( curdist2 < comparedist2 ) {
-                    _vNextLevelNodes.emplace_back(*itchild,  curdist2);
+                    vNextLevelNodes.emplace_back(*itchild,  curdist2);
                     if( Sqr(minchilddist) > curdist2 ) {
                         minchilddist = RaveSqrt(curdist2);
                         comparedist2 = Sqr(minchilddist + fLevelBound);
@@ -411,7 +556,7 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
             }
         }
 
-        _vCurrentLevelNodes.swap(_vNextLevelNodes);
+        vCurrentLevelNodes.swap(vNextLevelNodes);
         pruneradius2 = Sqr(minchilddist + fLevelBound);
         currentlevel -= 1;
         fLevelBound *= _fBaseInv;
@@ -424,11 +569,11 @@ std::pair<CacheTreeNodeConstPtr, dReal> CacheTree::FindNearestNode(const std::ve
     return bestnode;
 }
 
-int CacheTree::InsertNode(const std::vector<dReal>& cs, CollisionReportPtr report, dReal fMinSeparationDist)
+int CacheTree::InsertNode(const std::vector<dReal>& cs, CollisionReportPtr report, dReal fMinSeparationDist, const Vector* plinkspheres)
 {
 
     OPENRAVE_ASSERT_OP(cs.size(),==,_weights.size());
-    CacheTreeNodePtr nodein = _CreateCacheTreeNode(cs, report);
+    CacheTreeNodePtr nodein = _CreateCacheTreeNode(cs, report, plinkspheres);
     // if there is no root, make this the root, otherwise call the lowlevel  insert
     if( _numnodes == 0 ) {
         // no root
@@ -576,7 +721,7 @@ bool CacheTree::_InsertDirectly(CacheTreeNodePtr nodein, CacheTreeNodePtr parent
     while( parentnode->_level > insertlevel+1 ) {
         CacheTreeNodePtr clonenode = _CloneCacheTreeNode(parentnode);
         clonenode->_level = parentnode->_level-1;
-        parentnode->_vchildren.push_back(clonenode);
+        _AddChild(parentnode, clonenode);
         parentnode->_hasselfchild = 1;
         int encclonelevel = _EncodeLevel(clonenode->_level);
         if( encclonelevel >= (int)_vsetLevelNodes.size() ) {
@@ -596,7 +741,7 @@ bool CacheTree::_InsertDirectly(CacheTreeNodePtr nodein, CacheTreeNodePtr parent
         _vsetLevelNodes.resize(enclevel2+1);
     }
     _vsetLevelNodes.at(enclevel2).insert(nodein);
-    parentnode->_vchildren.push_back(nodein);
+    _AddChild(parentnode, nodein);
 
     if( _minlevel > nodein->_level ) {
         _minlevel = nodein->_level;
@@ -661,13 +806,13 @@ bool CacheTree::_Remove(CacheTreeNodePtr removenode, std::vector< std::vector<Ca
     FOREACH(itcurrentnode, vvCoverSetNodes.at(coverindex-1)) {
         // only take the children whose distances are within the bound
         if( setLevelRawChildren.find(*itcurrentnode) != setLevelRawChildren.end() ) {
-            std::vector<CacheTreeNodePtr>::iterator itchild = (*itcurrentnode)->_vchildren.begin();
+            CacheTreeNodeChildren::iterator itchild = (*itcurrentnode)->_vchildren.begin();
             while(itchild != (*itcurrentnode)->_vchildren.end() ) {
                 dReal curdist = _ComputeDistance2(removenode->GetConfigurationState(), (*itchild)->GetConfigurationState());
                 if( *itchild == removenode ) {
                     vNextLevelNodes.resize(0);
                     vNextLevelNodes.push_back(*itchild);
-                    itchild = (*itcurrentnode)->_vchildren.erase(itchild);
+                    itchild = _EraseChild(*itcurrentnode, itchild);
                     bfound = true;
                 }
                 else {
@@ -708,7 +853,7 @@ bool CacheTree::_Remove(CacheTreeNodePtr removenode, std::vector< std::vector<Ca
                     while( nodechild->_level < closestNode->_level-1 ) {
                         CacheTreeNodePtr clonenode = _CloneCacheTreeNode(nodechild);
                         clonenode->_level = nodechild->_level+1;
-                        clonenode->_vchildren.push_back(nodechild);
+                        _AddChild(clonenode, nodechild);
                         clonenode->_hasselfchild = 1;
                         int encclonelevel = _EncodeLevel(clonenode->_level);
                         if( encclonelevel >= (int)_vsetLevelNodes.size() ) {
@@ -725,7 +870,7 @@ bool CacheTree::_Remove(CacheTreeNodePtr removenode, std::vector< std::vector<Ca
                     }
 
                     //_vsetLevelNodes.at(enclevel2).insert(nodechild);
-                    closestNode->_vchildren.push_back(nodechild);
+                    _AddChild(closestNode, nodechild);
 
                     // closest node was found in parentlevel, so add to the children
                     break;
@@ -791,7 +936,6 @@ int CacheTree::RemoveCollisionConfigurations()
 int CacheTree::SaveCache(std::string filename)
 {
     //boost::mutex::scoped_lock lock(_mutexpool);
-    _mapNodeIndices.clear();
     int index=0;
     int knownnodes=0;
     FOREACH(itlevelnodes, _vsetLevelNodes) {
@@ -799,7 +943,7 @@ int CacheTree::SaveCache(std::string filename)
             if( (*itnode)->_conftype != CNT_Unknown) {
                 knownnodes++;
             }
-            _mapNodeIndices[*itnode] = index++;
+            (*itnode)->_index = index++;
         }
     }
 
@@ -849,7 +993,7 @@ int CacheTree::SaveCache(std::string filename)
                 fwrite(&numchildren, sizeof(numchildren), 1, pfile);
 
                 FOREACHC(itchild, (*itnode)->_vchildren) {
-                    int cindex = _mapNodeIndices[*itchild];
+                    int cindex = (*itchild)->_index;
                     fwrite(&cindex, sizeof(cindex), 1, pfile);
                 }
             }
@@ -879,6 +1023,7 @@ int CacheTree::LoadCache(std::string filename, EnvironmentBasePtr penv)
     _weights.resize(_statedof,1.0);
     _curconf.resize(_statedof,1.0);
     outs = fread(&_weights[0], sizeof(_weights[0])*_weights.size(), 1, pfile);
+    _UpdateWeights2();
 
     outs = fread(&_base, sizeof(_base), 1, pfile);
     outs = fread(&_fBaseInv, sizeof(_fBaseInv), 1, pfile);
@@ -928,7 +1073,7 @@ int CacheTree::LoadCache(std::string filename, EnvironmentBasePtr penv)
         outs = fread(&_newnode->_usenn, sizeof(_newnode->_usenn), 1, pfile);
         int numchildren;
         outs = fread(&numchildren, sizeof(numchildren), 1, pfile);
-        _newnode->_vchildren.resize(numchildren);
+        _ResizeChildren(_newnode, numchildren);
 
         // create the copies of the children and insert them
         for(int i = 0; i < numchildren; ++i) {
@@ -949,6 +1094,409 @@ int CacheTree::LoadCache(std::string filename, EnvironmentBasePtr penv)
     return 1;
 }
 
+int CacheTree::SaveSnapshot(const std::string& filename)
+{
+    // breadth first so that the children of a node are stored next to each other
+    std::vector<CacheTreeNodePtr> vnodes;
+    vnodes.reserve(_numnodes);
+    if( _numnodes > 0 ) {
+        vnodes.push_back(*_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin());
+        vnodes[0]->_index = 0;
+        for(size_t inode = 0; inode < vnodes.size(); ++inode) {
+            FOREACHC(itchild, vnodes[inode]->_vchildren) {
+                (*itchild)->_index = (int)vnodes.size();
+                vnodes.push_back(*itchild);
+            }
+        }
+    }
+
+    std::vector<CacheTreeSnapshotNode> vsnapshotnodes(vnodes.size());
+    std::vector<int32_t> vchildren;
+    vchildren.reserve(vnodes.size());
+    std::vector<std::string> vbodynames;
+    std::map<std::string, int> mapbodyindices;
+    for(size_t inode = 0; inode < vnodes.size(); ++inode) {
+        CacheTreeNodeConstPtr pnode = vnodes[inode];
+        CacheTreeSnapshotNode& snapshotnode = vsnapshotnodes[inode];
+        memset(&snapshotnode, 0, sizeof(snapshotnode));
+        snapshotnode.childrenoffset = (int32_t)vchildren.size();
+        snapshotnode.numchildren = (int32_t)pnode->_vchildren.size();
+        FOREACHC(itchild, pnode->_vchildren) {
+            vchildren.push_back((*itchild)->_index);
+        }
+        snapshotnode.level = pnode->_level;
+        snapshotnode.conftype = pnode->_usenn ? (uint8_t)pnode->_conftype : (uint8_t)CNT_Unknown;
+        snapshotnode.robotlinkindex = pnode->_robotlinkindex;
+        snapshotnode.collidingbodyindex = -1;
+        snapshotnode.collidinglinkindex = -1;
+        if( pnode->_conftype == CNT_Collision && !!pnode->_collidinglink ) {
+            KinBodyPtr pcollidingbody = pnode->_collidinglink->GetParent(true);
+            if( !!pcollidingbody ) {
+                std::map<std::string, int>::iterator itbody = mapbodyindices.find(pcollidingbody->GetName());
+                if( itbody == mapbodyindices.end() ) {
+                    itbody = mapbodyindices.insert(std::make_pair(pcollidingbody->GetName(), (int)vbodynames.size())).first;
+                    vbodynames.push_back(pcollidingbody->GetName());
+                }
+                snapshotnode.collidingbodyindex = itbody->second;
+                snapshotnode.collidinglinkindex = pnode->_collidinglink->GetIndex();
+            }
+        }
+    }
+
+    FILE* pfile = fopen(filename.c_str(),"wb");
+    if( !pfile ) {
+        RAVELOG_WARN_FORMAT("failed to open %s for writing the cache snapshot", filename);
+        return 0;
+    }
+
+    CacheTreeSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHETREE_SNAPSHOT_MAGIC;
+    header.version = CACHETREE_SNAPSHOT_VERSION;
+    header.realsize = sizeof(dReal);
+    header.statedof = _statedof;
+    header.numnodes = (int32_t)vnodes.size();
+    header.numchildren = (int32_t)vchildren.size();
+    header.numbodies = (int32_t)vbodynames.size();
+    header.maxlevel = _maxlevel;
+    header.base = _base;
+    header.maxdistance = _maxdistance;
+    fwrite(&header, sizeof(header), 1, pfile);
+    fwrite(&_weights[0], sizeof(dReal)*_statedof, 1, pfile);
+    FOREACHC(itnode, vnodes) {
+        fwrite((*itnode)->GetConfigurationState(), sizeof(dReal)*_statedof, 1, pfile);
+    }
+    if( vsnapshotnodes.size() > 0 ) {
+        fwrite(&vsnapshotnodes[0], sizeof(CacheTreeSnapshotNode)*vsnapshotnodes.size(), 1, pfile);
+    }
+    if( vchildren.size() > 0 ) {
+        fwrite(&vchildren[0], sizeof(int32_t)*vchildren.size(), 1, pfile);
+    }
+    FOREACHC(itname, vbodynames) {
+        int32_t namelength = (int32_t)itname->size();
+        fwrite(&namelength, sizeof(namelength), 1, pfile);
+        fwrite(itname->c_str(), itname->size(), 1, pfile);
+    }
+    bool bsuccess = !ferror(pfile);
+    fclose(pfile);
+    RAVELOG_DEBUG_FORMAT("wrote cache snapshot %s with %d nodes", filename%vnodes.size());
+    return bsuccess ? 1 : 0;
+}
+
+CacheTreeSnapshot::CacheTreeSnapshot()
+{
+    _pstates = NULL;
+    _pnodes = NULL;
+    _pchildren = NULL;
+    _statedof = 0;
+    _numnodes = 0;
+    _maxdistance = 0;
+    _fBaseInv = 0.5;
+    _fMaxLevelBound = 0;
+}
+
+CacheTreeSnapshot::~CacheTreeSnapshot()
+{
+}
+
+bool CacheTreeSnapshot::Load(const std::string& filename, EnvironmentBasePtr penv)
+{
+    try {
+        _pmapping.reset(new boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only));
+        _pregion.reset(new boost::interprocess::mapped_region(*_pmapping, boost::interprocess::read_only));
+    }
+    catch(const boost::interprocess::interprocess_exception& ex) {
+        RAVELOG_WARN_FORMAT("failed to map cache snapshot %s: %s", filename%ex.what());
+        _pregion.reset();
+        _pmapping.reset();
+        return false;
+    }
+
+    const uint8_t* pdata = static_cast<const uint8_t*>(_pregion->get_address());
+    size_t datasize = _pregion->get_size();
+    CacheTreeSnapshotHeader header;
+    if( datasize < sizeof(header) ) {
+        RAVELOG_WARN_FORMAT("cache snapshot %s is too small", filename);
+        return false;
+    }
+    memcpy(&header, pdata, sizeof(header));
+    if( header.magic != CACHETREE_SNAPSHOT_MAGIC || header.version != CACHETREE_SNAPSHOT_VERSION || header.realsize != (int)sizeof(dReal) || header.statedof <= 0 || header.numnodes < 0 || header.numchildren < 0 || header.numbodies < 0 ) {
+        RAVELOG_WARN_FORMAT("%s is not a valid cache snapshot", filename);
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    size_t weightsoffset = offset;
+    offset += sizeof(dReal)*header.statedof;
+    size_t statesoffset = offset;
+    offset += sizeof(dReal)*header.statedof*(size_t)header.numnodes;
+    size_t nodesoffset = offset;
+    offset += sizeof(CacheTreeSnapshotNode)*(size_t)header.numnodes;
+    size_t childrenoffset = offset;
+    offset += sizeof(int32_t)*(size_t)header.numchildren;
+    if( offset > datasize ) {
+        RAVELOG_WARN_FORMAT("cache snapshot %s is truncated", filename);
+        return false;
+    }
+
+    _statedof = header.statedof;
+    _numnodes = header.numnodes;
+    _maxdistance = header.maxdistance;
+    _fBaseInv = 1/header.base;
+    _fMaxLevelBound = RavePow(header.base, header.maxlevel);
+    _weights.resize(_statedof);
+    memcpy(&_weights[0], pdata+weightsoffset, sizeof(dReal)*_statedof);
+    _weights2.resize(_statedof);
+    for(int i = 0; i < _statedof; ++i) {
+        _weights2[i] = _weights[i]*_weights[i];
+    }
+    _pstates = reinterpret_cast<const dReal*>(pdata+statesoffset);
+    _pnodes = reinterpret_cast<const CacheTreeSnapshotNode*>(pdata+nodesoffset);
+    _pchildren = reinterpret_cast<const int32_t*>(pdata+childrenoffset);
+
+    _vcollidingbodies.resize(0);
+    std::string bodyname;
+    for(int ibody = 0; ibody < header.numbodies; ++ibody) {
+        int32_t namelength = 0;
+        if( offset+sizeof(namelength) > datasize ) {
+            break;
+        }
+        memcpy(&namelength, pdata+offset, sizeof(namelength));
+        offset += sizeof(namelength);
+        if( namelength < 0 || offset+namelength > datasize ) {
+            break;
+        }
+        bodyname.assign(reinterpret_cast<const char*>(pdata+offset), namelength);
+        offset += namelength;
+        KinBodyPtr pbody = penv->GetKinBody(bodyname);
+        if( !pbody ) {
+            RAVELOG_WARN_FORMAT("loading cache snapshot expected colliding body %s, but none found", bodyname);
+        }
+        _vcollidingbodies.push_back(pbody);
+    }
+
+    _vtypes.resize(_numnodes);
+    for(int inode = 0; inode < _numnodes; ++inode) {
+        const CacheTreeSnapshotNode& node = _pnodes[inode];
+        if( node.childrenoffset < 0 || node.numchildren < 0 || node.childrenoffset+node.numchildren > header.numchildren ) {
+            RAVELOG_WARN_FORMAT("cache snapshot %s has invalid children", filename);
+            _numnodes = 0;
+            _vtypes.resize(0);
+            return false;
+        }
+        _vtypes[inode] = node.conftype;
+        // collision nodes whose body is missing cannot be reported
+        if( node.conftype == CNT_Collision && (node.collidingbodyindex < 0 || node.collidingbodyindex >= (int)_vcollidingbodies.size() || !_vcollidingbodies[node.collidingbodyindex]) ) {
+            _vtypes[inode] = CNT_Unknown;
+        }
+    }
+    for(int ichild = 0; ichild < header.numchildren; ++ichild) {
+        if( _pchildren[ichild] <= 0 || _pchildren[ichild] >= _numnodes ) {
+            RAVELOG_WARN_FORMAT("cache snapshot %s has invalid children", filename);
+            _numnodes = 0;
+            _vtypes.resize(0);
+            return false;
+        }
+    }
+    RAVELOG_DEBUG_FORMAT("mapped cache snapshot %s with %d nodes", filename%_numnodes);
+    return true;
+}
+
+inline dReal CacheTreeSnapshot::_ComputeDistance2(const dReal* pquerystate, int inode) const
+{
+    return planningutils::ComputeWeightedDistance2(pquerystate, _pstates + inode*_statedof, _statedof, &_weights2[0]);
+}
+
+std::pair<int, dReal> CacheTreeSnapshot::FindNearestNode(const std::vector<dReal>& vquerystate, dReal distancebound, ConfigurationNodeType conftype) const
+{
+    if( _numnodes == 0 ) {
+        return make_pair(-1, dReal(0));
+    }
+    OPENRAVE_ASSERT_OP((int)vquerystate.size(),==,_statedof);
+    const dReal* pquerystate = &vquerystate[0];
+    // thread local so that several threads can query the same snapshot at the same time
+    static thread_local std::vector< std::pair<int, dReal> > vCurrentLevelNodes, vNextLevelNodes;
+
+    int bestnode = -1;
+    dReal bestdist2 = std::numeric_limits<dReal>::infinity();
+    dReal distancebound2 = Sqr(distancebound);
+    dReal fLevelBound2 = Sqr(_fMaxLevelBound);
+    vCurrentLevelNodes.resize(1);
+    vCurrentLevelNodes[0].first = 0;
+    vCurrentLevelNodes[0].second = _ComputeDistance2(pquerystate, 0);
+    if( GetType(0) != CNT_Unknown && (conftype == CNT_Any || GetType(0) == conftype) ) {
+        bestnode = 0;
+        bestdist2 = vCurrentLevelNodes[0].second;
+    }
+    while(vCurrentLevelNodes.size() > 0 ) {
+        vNextLevelNodes.resize(0);
+        dReal minchilddist2 = std::numeric_limits<dReal>::infinity();
+        FOREACH(itcurrentnode, vCurrentLevelNodes) {
+            const CacheTreeSnapshotNode& node = _pnodes[itcurrentnode->first];
+            for(int ichild = node.childrenoffset; ichild < node.childrenoffset+node.numchildren; ++ichild) {
+                int childindex = _pchildren[ichild];
+                dReal curdist2 = _ComputeDistance2(pquerystate, childindex);
+                if( curdist2 < bestdist2 ) {
+                    ConfigurationNodeType childtype = GetType(childindex);
+                    if( childtype != CNT_Unknown && (conftype == CNT_Any || childtype == conftype) ) {
+                        bestdist2 = curdist2;
+                        bestnode = childindex;
+                        if( distancebound > 0 && bestdist2 <= distancebound2 ) {
+                            return make_pair(bestnode, RaveSqrt(bestdist2));
+                        }
+                    }
+                }
+                vNextLevelNodes.emplace_back(childindex, curdist2);
+                if( minchilddist2 > curdist2 ) {
+                    minchilddist2 = curdist2;
+                }
+            }
+        }
+
+        vCurrentLevelNodes.resize(0);
+        dReal ftestbound2 = 4*minchilddist2*fLevelBound2;
+        FOREACH(itnode, vNextLevelNodes) {
+            dReal f = itnode->second - minchilddist2 - fLevelBound2;
+            if( f <= 0 || Sqr(f) <= ftestbound2 ) {
+                vCurrentLevelNodes.push_back(*itnode);
+            }
+        }
+        fLevelBound2 *= Sqr(_fBaseInv);
+    }
+    if( bestnode >= 0 && (distancebound2 <= 0 || bestdist2 <= distancebound2) ) {
+        return make_pair(bestnode, RaveSqrt(bestdist2));
+    }
+    return make_pair(-1, dReal(0));
+}
+
+std::pair<int, dReal> CacheTreeSnapshot::FindNearestNode(const std::vector<dReal>& vquerystate, dReal collisionthresh, dReal freespacethresh) const
+{
+    std::pair<int, dReal> bestnode(-1, std::numeric_limits<dReal>::infinity());
+    if( _numnodes == 0 ) {
+        return bestnode;
+    }
+    OPENRAVE_ASSERT_OP((int)vquerystate.size(),==,_statedof);
+    const dReal* pquerystate = &vquerystate[0];
+    static thread_local std::vector< std::pair<int, dReal> > vCurrentLevelNodes, vNextLevelNodes;
+
+    dReal collisionthresh2 = Sqr(collisionthresh), freespacethresh2 = Sqr(freespacethresh);
+    dReal fLevelBound = _fMaxLevelBound;
+    {
+        dReal curdist2 = _ComputeDistance2(pquerystate, 0);
+        ConfigurationNodeType cntype = GetType(0);
+        if( cntype == CNT_Collision && curdist2 <= collisionthresh2 ) {
+            return make_pair(0, RaveSqrt(curdist2));
+        }
+        else if( cntype == CNT_Free && curdist2 <= freespacethresh2 ) {
+            bestnode = make_pair(0, curdist2);
+        }
+        vCurrentLevelNodes.resize(1);
+        vCurrentLevelNodes[0].first = 0;
+        vCurrentLevelNodes[0].second = curdist2;
+    }
+    dReal pruneradius2 = Sqr(_maxdistance);
+    while(vCurrentLevelNodes.size() > 0 ) {
+        vNextLevelNodes.resize(0);
+        dReal minchilddist=_maxdistance;
+        FOREACH(itcurrentnode, vCurrentLevelNodes) {
+            if( itcurrentnode->second > pruneradius2 ) {
+                continue;
+            }
+            dReal comparedist2 = Sqr(minchilddist + fLevelBound);
+            const CacheTreeSnapshotNode& node = _pnodes[itcurrentnode->first];
+            for(int ichild = node.childrenoffset; ichild < node.childrenoffset+node.numchildren; ++ichild) {
+                int childindex = _pchildren[ichild];
+                dReal curdist2 = _ComputeDistance2(pquerystate, childindex);
+                ConfigurationNodeType cntype = GetType(childindex);
+                if( cntype == CNT_Collision && curdist2 <= collisionthresh2 ) {
+                    return make_pair(childindex, RaveSqrt(curdist2));
+                }
+                else if( cntype == CNT_Free && curdist2 <= freespacethresh2 ) {
+                    if( curdist2 < bestnode.second ) {
+                        bestnode = make_pair(childindex, curdist2);
+                    }
+                }
+                if( curdist2 < comparedist2 ) {
+                    vNextLevelNodes.emplace_back(childindex, curdist2);
+                    if( Sqr(minchilddist) > curdist2 ) {
+                        minchilddist = RaveSqrt(curdist2);
+                        comparedist2 = Sqr(minchilddist + fLevelBound);
+                    }
+                }
+            }
+        }
+
+        vCurrentLevelNodes.swap(vNextLevelNodes);
+        pruneradius2 = Sqr(minchilddist + fLevelBound);
+        fLevelBound *= _fBaseInv;
+    }
+    if( bestnode.first >= 0 ) {
+        bestnode.second = RaveSqrt(bestnode.second);
+    }
+    return bestnode;
+}
+
+int CacheTreeSnapshot::GetRobotLinkIndex(int inode) const
+{
+    return _pnodes[inode].robotlinkindex;
+}
+
+KinBody::LinkConstPtr CacheTreeSnapshot::GetCollidingLink(int inode) const
+{
+    const CacheTreeSnapshotNode& node = _pnodes[inode];
+    if( node.collidingbodyindex < 0 || node.collidingbodyindex >= (int)_vcollidingbodies.size() || !_vcollidingbodies[node.collidingbodyindex] ) {
+        return KinBody::LinkConstPtr();
+    }
+    const std::vector<KinBody::LinkPtr>& vlinks = _vcollidingbodies[node.collidingbodyindex]->GetLinks();
+    if( node.collidinglinkindex < 0 || node.collidinglinkindex >= (int)vlinks.size() ) {
+        return KinBody::LinkConstPtr();
+    }
+    return vlinks[node.collidinglinkindex];
+}
+
+void CacheTreeSnapshot::GetNodeValues(std::vector<dReal>& vals) const
+{
+    vals.insert(vals.end(), _pstates, _pstates+_numnodes*_statedof);
+}
+
+int CacheTreeSnapshot::GetNumKnownNodes() const
+{
+    int nknown = 0;
+    FOREACHC(ittype, _vtypes) {
+        if( *ittype != CNT_Unknown ) {
+            ++nknown;
+        }
+    }
+    return nknown;
+}
+
+int CacheTreeSnapshot::RemoveConfigurations(ConfigurationNodeType conftype)
+{
+    int nremoved = 0;
+    FOREACH(ittype, _vtypes) {
+        if( *ittype == conftype ) {
+            *ittype = CNT_Unknown;
+            ++nremoved;
+        }
+    }
+    return nremoved;
+}
+
+int CacheTreeSnapshot::UpdateCollisionConfigurations(KinBodyPtr pbody)
+{
+    int nremoved = 0;
+    for(int inode = 0; inode < _numnodes; ++inode) {
+        if( _vtypes[inode] == CNT_Collision ) {
+            int bodyindex = _pnodes[inode].collidingbodyindex;
+            if( bodyindex >= 0 && bodyindex < (int)_vcollidingbodies.size() && _vcollidingbodies[bodyindex] == pbody ) {
+                _vtypes[inode] = CNT_Unknown;
+                ++nremoved;
+            }
+        }
+    }
+    return nremoved;
+}
+
 int CacheTree::UpdateCollisionConfigurations(KinBodyPtr pbody)
 {
     int nremoved=0;
@@ -968,14 +1516,18 @@ int CacheTree::UpdateCollisionConfigurations(KinBodyPtr pbody)
     return nremoved;
 }
 
-int CacheTree::UpdateFreeConfigurations(KinBodyPtr pbody) //todo only remove those with overlaping linkspheres
+int CacheTree::UpdateFreeConfigurations(KinBodyPtr pbody)
 {
     int nremoved=0;
     if (_numnodes > 0) {
-
+        // all links, since links that are disabled now could still be enabled without the body's state changing
+        AABB ab;
+        if( !!pbody ) {
+            ab = pbody->ComputeAABB();
+        }
         FOREACH(itlevelnodes, _vsetLevelNodes) {
             FOREACH(itnode, *itlevelnodes) {
-                if (((*itnode)->GetType() == CNT_Free)) {
+                if (((*itnode)->GetType() == CNT_Free) && (!pbody || _LinkSpheresIntersect(*itnode, ab))) {
                     (*itnode)->SetType(CNT_Unknown);
                     nremoved += 1;
                 }
@@ -1124,13 +1676,20 @@ bool CacheTree::Validate()
     return true;
 }
 
-ConfigurationCache::ConfigurationCache(RobotBasePtr pstaterobot, bool envupdates) : _cachetree(pstaterobot->GetDOF())
+static boost::mutex s_mutexSharedTrees; ///< protects s_mapSharedTrees
+static std::map<std::string, SharedCacheTreeWeakPtr> s_mapSharedTrees; ///< the shared cache trees indexed by ConfigurationCache::_ComputeSharedKey
+
+ConfigurationCache::ConfigurationCache(RobotBasePtr pstaterobot, bool envupdates)
 {
     _userdatakey = std::string("configurationcache") + boost::lexical_cast<std::string>(this);
     _pstaterobot = pstaterobot;
     _penv = pstaterobot->GetEnv();
 
     _envupdates = envupdates;
+    _bshared = false;
+    _fbase = 2.0;
+    // the link spheres are only needed to invalidate the free configurations when bodies change
+    _numlinkspheres = _envupdates ? (int)pstaterobot->GetLinks().size()+1 : 0;
 
     _vgrabbedbodies.resize(0);
     _vnewenvbodies.resize(0);
@@ -1190,19 +1749,11 @@ ConfigurationCache::ConfigurationCache(RobotBasePtr pstaterobot, bool envupdates
     _handleJointLimitChange = pstaterobot->RegisterChangeCallback(KinBody::Prop_JointLimits, boost::bind(&ConfigurationCache::_UpdateRobotJointLimits, this));
     _handleGrabbedChange = pstaterobot->RegisterChangeCallback(KinBody::Prop_RobotGrabbed, boost::bind(&ConfigurationCache::_UpdateRobotGrabbed, this));
 
-    // distance has to be computed in the same way as CacheTreeNode.GetDistance()
-    // otherwise, distances larger than this value could be inserted into the tree
-    dReal maxdistance = 0;
-    for (size_t i = 0; i < _vweights.size(); ++i) {
-        dReal f = (_upperlimit[i] - _lowerlimit[i]) * _vweights[i];
-        maxdistance += f*f;
-    }
-
-    _cachetree.Init(_vweights, RaveSqrt(maxdistance));
+    _psharedtree = _CreateCacheTree();
 
     if (IS_DEBUGLEVEL(Level_Verbose)) {
         stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
-        ss << "Initializing cache,  maxdistance " << _cachetree.GetMaxDistance() << ", weights [";
+        ss << "Initializing cache,  maxdistance " << _psharedtree->_cachetree.GetMaxDistance() << ", weights [";
         for (size_t i = 0; i < _vweights.size(); ++i) {
             ss << _vweights[i] << " ";
         }
@@ -1225,7 +1776,10 @@ ConfigurationCache::ConfigurationCache(RobotBasePtr pstaterobot, bool envupdates
 
 ConfigurationCache::~ConfigurationCache()
 {
-    _cachetree.Reset();
+    if( !_bshared ) {
+        boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+        _psharedtree->_cachetree.Reset();
+    }
     // have to destroy all the change callbacks!
     FOREACH(it, _listCachedData) {
         KinBodyCachedDataPtr pdata = it->lock();
@@ -1238,7 +1792,123 @@ ConfigurationCache::~ConfigurationCache()
 
 void ConfigurationCache::SetWeights(const std::vector<dReal>& weights)
 {
-    _cachetree.SetWeights(weights);
+    _vweights = weights;
+    if( _bshared ) {
+        // weights are part of the key, so switch trees instead of resetting the shared one
+        _UpdateSharedTree();
+        return;
+    }
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.SetWeights(weights);
+    _psharedtree->_psnapshot.reset(); // distances of the snapshot do not match anymore
+}
+
+void ConfigurationCache::SetBase(dReal base)
+{
+    _fbase = base;
+    if( _bshared ) {
+        _UpdateSharedTree();
+        return;
+    }
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.SetBase(base);
+}
+
+dReal ConfigurationCache::GetBase() const
+{
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    return _psharedtree->_cachetree.GetBase();
+}
+
+int ConfigurationCache::GetNumNodes() const
+{
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    return _psharedtree->_cachetree.GetNumNodes() + (!!_psharedtree->_psnapshot ? _psharedtree->_psnapshot->GetNumNodes() : 0);
+}
+
+void ConfigurationCache::GetNodeValues(std::vector<dReal>& vals) const
+{
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.GetNodeValues(vals);
+    if( !!_psharedtree->_psnapshot ) {
+        _psharedtree->_psnapshot->GetNodeValues(vals);
+    }
+}
+
+dReal ConfigurationCache::ComputeDistance(const std::vector<dReal>& qi, const std::vector<dReal>& qf) const
+{
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    return _psharedtree->_cachetree.ComputeDistance(qi,qf);
+}
+
+void ConfigurationCache::UpdateCollisionNodes(KinBodyPtr pbody)
+{
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.UpdateCollisionNodes(pbody);
+}
+
+void ConfigurationCache::SaveCache(std::string filename)
+{
+    // saving uses temporary buffers of the tree
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.SaveCache(filename);
+}
+
+void ConfigurationCache::LoadCache(std::string filename, EnvironmentBasePtr penv)
+{
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_psnapshot.reset();
+    _psharedtree->_cachetree.LoadCache(filename, penv);
+}
+
+bool ConfigurationCache::SaveSnapshot(const std::string& filename)
+{
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    CacheTreeSnapshotPtr psnapshot = _psharedtree->_psnapshot;
+    if( !!psnapshot ) {
+        // the snapshot cannot be changed, so merge its known nodes into the tree
+        CollisionReportPtr report(new CollisionReport());
+        std::vector<dReal> vstate(psnapshot->GetWeights().size());
+        for(int inode = 0; inode < psnapshot->GetNumNodes(); ++inode) {
+            ConfigurationNodeType conftype = psnapshot->GetType(inode);
+            if( conftype == CNT_Unknown ) {
+                continue;
+            }
+            std::copy(psnapshot->GetConfigurationState(inode), psnapshot->GetConfigurationState(inode)+vstate.size(), vstate.begin());
+            CollisionReportPtr pnodereport;
+            if( conftype == CNT_Collision ) {
+                int robotlinkindex = psnapshot->GetRobotLinkIndex(inode);
+                report->plink1.reset();
+                if( robotlinkindex >= 0 && robotlinkindex < (int)_pstaterobot->GetLinks().size() ) {
+                    report->plink1 = _pstaterobot->GetLinks()[robotlinkindex];
+                }
+                report->plink2 = psnapshot->GetCollidingLink(inode);
+                if( !report->plink1 || !report->plink2 ) {
+                    continue;
+                }
+                pnodereport = report;
+            }
+            _psharedtree->_cachetree.InsertNode(vstate, pnodereport, conftype == CNT_Free ? _freespacethresh*_insertiondistancemult : _collisionthresh*_insertiondistancemult);
+        }
+        _psharedtree->_psnapshot.reset();
+    }
+    return _psharedtree->_cachetree.SaveSnapshot(filename) != 0;
+}
+
+bool ConfigurationCache::LoadSnapshot(const std::string& filename)
+{
+    CacheTreeSnapshotPtr psnapshot(new CacheTreeSnapshot());
+    if( !psnapshot->Load(filename, _penv) ) {
+        return false;
+    }
+    if( psnapshot->GetWeights() != _vweights ) {
+        RAVELOG_WARN_FORMAT("env=%d, weights of cache snapshot %s do not match the cache of robot %s", _penv->GetId()%filename%_pstaterobot->GetName());
+        return false;
+    }
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.Reset();
+    _psharedtree->_psnapshot = psnapshot;
+    return true;
 }
 
 bool ConfigurationCache::InsertConfiguration(const std::vector<dReal>& conf, CollisionReportPtr report, dReal distin)
@@ -1248,34 +1918,59 @@ bool ConfigurationCache::InsertConfiguration(const std::vector<dReal>& conf, Col
             std::swap(report->plink1, report->plink2);
         }
     }
-    int ret = _cachetree.InsertNode(conf, report, !report ? _freespacethresh*_insertiondistancemult : _collisionthresh*_insertiondistancemult);
+    // the robot is at conf, so can compute the spheres before locking the tree
+    _ComputeLinkSpheres();
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    int ret = _psharedtree->_cachetree.InsertNode(conf, report, !report ? _freespacethresh*_insertiondistancemult : _collisionthresh*_insertiondistancemult, _vlinkspheres.size() > 0 ? &_vlinkspheres[0] : NULL);
     BOOST_ASSERT(ret!=0);
     return ret==1;
 }
 
 int ConfigurationCache::GetNumKnownNodes()
 {
-    return _cachetree.GetNumKnownNodes();
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    return _psharedtree->_cachetree.GetNumKnownNodes() + (!!_psharedtree->_psnapshot ? _psharedtree->_psnapshot->GetNumKnownNodes() : 0);
 }
 
 int ConfigurationCache::RemoveCollisionConfigurations()
 {
-    return _cachetree.RemoveCollisionConfigurations();
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    int nremoved = _psharedtree->_cachetree.RemoveCollisionConfigurations();
+    if( !!_psharedtree->_psnapshot ) {
+        nremoved += _psharedtree->_psnapshot->RemoveConfigurations(CNT_Collision);
+    }
+    return nremoved;
 }
 
 int ConfigurationCache::UpdateCollisionConfigurations(KinBodyPtr pbody)
 {
-    return _cachetree.UpdateCollisionConfigurations(pbody);
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    int nremoved = _psharedtree->_cachetree.UpdateCollisionConfigurations(pbody);
+    if( !!_psharedtree->_psnapshot ) {
+        nremoved += _psharedtree->_psnapshot->UpdateCollisionConfigurations(pbody);
+    }
+    return nremoved;
 }
 
 int ConfigurationCache::UpdateFreeConfigurations(KinBodyPtr pbody)
 {
-    return _cachetree.UpdateFreeConfigurations(pbody);
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    int nremoved = _psharedtree->_cachetree.UpdateFreeConfigurations(pbody);
+    if( !!_psharedtree->_psnapshot ) {
+        // snapshots do not store link spheres
+        nremoved += _psharedtree->_psnapshot->RemoveConfigurations(CNT_Free);
+    }
+    return nremoved;
 }
 
 int ConfigurationCache::RemoveFreeConfigurations()
 {
-    return _cachetree.RemoveFreeConfigurations();
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    int nremoved = _psharedtree->_cachetree.RemoveFreeConfigurations();
+    if( !!_psharedtree->_psnapshot ) {
+        nremoved += _psharedtree->_psnapshot->RemoveConfigurations(CNT_Free);
+    }
+    return nremoved;
 }
 
 void ConfigurationCache::GetDOFValues(std::vector<dReal>& values)
@@ -1302,7 +1997,31 @@ void ConfigurationCache::GetDOFValues(std::vector<dReal>& values)
 
 int ConfigurationCache::CheckCollision(const std::vector<dReal>& conf, KinBody::LinkConstPtr& robotlink, KinBody::LinkConstPtr& collidinglink, dReal& closestdist)
 {
-    std::pair<CacheTreeNodeConstPtr, dReal> knn = _cachetree.FindNearestNode(conf, _collisionthresh, _freespacethresh);
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    std::pair<CacheTreeNodeConstPtr, dReal> knn = _psharedtree->_cachetree.FindNearestNode(conf, _collisionthresh, _freespacethresh);
+
+    if( !knn.first || !knn.first->IsInCollision() ) {
+        // the snapshot could still have a collision, which takes priority over free nodes
+        const CacheTreeSnapshotPtr& psnapshot = _psharedtree->_psnapshot;
+        if( !!psnapshot ) {
+            std::pair<int, dReal> snn = psnapshot->FindNearestNode(conf, _collisionthresh, _freespacethresh);
+            if( snn.first >= 0 && (!knn.first || psnapshot->GetType(snn.first) == CNT_Collision) ) {
+                closestdist = snn.second;
+                if( psnapshot->GetType(snn.first) == CNT_Collision ) {
+                    int robotlinkindex = psnapshot->GetRobotLinkIndex(snn.first);
+                    if( robotlinkindex < 0 || robotlinkindex >= (int)_pstaterobot->GetLinks().size() ) {
+                        robotlink = KinBody::LinkConstPtr();
+                    }
+                    else {
+                        robotlink = _pstaterobot->GetLinks()[robotlinkindex];
+                    }
+                    collidinglink = _GetLocalCollidingLink(psnapshot->GetCollidingLink(snn.first));
+                    return 1;
+                }
+                return 0;
+            }
+        }
+    }
 
     if( !!knn.first ) {
 
@@ -1315,7 +2034,7 @@ int ConfigurationCache::CheckCollision(const std::vector<dReal>& conf, KinBody::
             else{
                 robotlink = _pstaterobot->GetLinks().at(knn.first->GetRobotLinkIndex());
             }
-            collidinglink = knn.first->GetCollidingLink();
+            collidinglink = _GetLocalCollidingLink(knn.first->GetCollidingLink());
             return 1;
         }
         return 0;
@@ -1323,9 +2042,38 @@ int ConfigurationCache::CheckCollision(const std::vector<dReal>& conf, KinBody::
     return -1;
 }
 
+KinBody::LinkConstPtr ConfigurationCache::_GetLocalCollidingLink(KinBody::LinkConstPtr plink) const
+{
+    if( !plink ) {
+        return plink;
+    }
+    KinBodyPtr pcollidingbody = plink->GetParent(true);
+    if( !pcollidingbody ) {
+        return KinBody::LinkConstPtr();
+    }
+    if( pcollidingbody->GetEnv() == _penv ) {
+        return plink;
+    }
+    // node could have been inserted by a cache of another environment, so return the link of this environment
+    int linkindex = plink->GetIndex();
+    KinBodyPtr plocalbody = _penv->GetKinBody(pcollidingbody->GetName());
+    if( !!plocalbody && linkindex >= 0 && linkindex < (int)plocalbody->GetLinks().size() ) {
+        return plocalbody->GetLinks()[linkindex];
+    }
+    return KinBody::LinkConstPtr();
+}
+
 std::pair<std::vector<dReal>, dReal> ConfigurationCache::FindNearestNode(const std::vector<dReal>& conf, dReal dist)
 {
-    std::pair<CacheTreeNodeConstPtr, dReal> knn = _cachetree.FindNearestNode(conf, dist, CNT_Any);
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    std::pair<CacheTreeNodeConstPtr, dReal> knn = _psharedtree->_cachetree.FindNearestNode(conf, dist, CNT_Any);
+    if( !!_psharedtree->_psnapshot ) {
+        std::pair<int, dReal> snn = _psharedtree->_psnapshot->FindNearestNode(conf, dist, CNT_Any);
+        if( snn.first >= 0 && (!knn.first || snn.second < knn.second) ) {
+            const dReal* pstate = _psharedtree->_psnapshot->GetConfigurationState(snn.first);
+            return make_pair(std::vector<dReal>(pstate, pstate+_lowerlimit.size()), snn.second);
+        }
+    }
 
     if( !!knn.first ) {
         return make_pair(std::vector<dReal>(knn.first->GetConfigurationState(), knn.first->GetConfigurationState()+_lowerlimit.size()), knn.second);
@@ -1343,12 +2091,15 @@ int ConfigurationCache::CheckCollision(KinBody::LinkConstPtr& robotlink, KinBody
 void ConfigurationCache::Reset()
 {
     RAVELOG_DEBUG("Resetting cache\n");
-    _cachetree.Reset();
+    boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    _psharedtree->_cachetree.Reset();
+    _psharedtree->_psnapshot.reset();
 }
 
 bool ConfigurationCache::Validate()
 {
-    return _cachetree.Validate();
+    boost::shared_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
+    return _psharedtree->_cachetree.Validate();
 }
 
 void ConfigurationCache::_UpdateUntrackedBody(KinBodyPtr pbody)
@@ -1356,8 +2107,13 @@ void ConfigurationCache::_UpdateUntrackedBody(KinBodyPtr pbody)
     // body's state has changed, so remove collision space and invalidate free space.
     if(_envupdates) {
         RAVELOG_VERBOSE_FORMAT("%s %s","Updating untracked bodies"%pbody->GetName());
+        if( _bshared ) {
+            // the other caches sharing the tree are still in the old scene, so switch to the tree of the new scene
+            _UpdateSharedTree();
+            return;
+        }
         UpdateCollisionConfigurations(pbody);
-        RemoveFreeConfigurations();
+        UpdateFreeConfigurations(pbody);
     }
 }
 
@@ -1366,7 +2122,10 @@ void ConfigurationCache::_UpdateAddRemoveBodies(KinBodyPtr pbody, int action)
     if( action == 1 ) {
         if (_envupdates) {
             // invalidate the freespace of a cache given a new body in the scene
-            if (RemoveFreeConfigurations() > 0) {
+            if( _bshared ) {
+                _UpdateSharedTree();
+            }
+            else if (UpdateFreeConfigurations(pbody) > 0) {
                 RAVELOG_DEBUG_FORMAT("%s %s %d","Updating add/remove bodies"%pbody->GetName()%action);
             }
             KinBodyCachedDataPtr pinfo(new KinBodyCachedData());
@@ -1377,7 +2136,10 @@ void ConfigurationCache::_UpdateAddRemoveBodies(KinBodyPtr pbody, int action)
     }
     else if( action == 0 ) {
         if (_envupdates) {
-            if ( UpdateCollisionConfigurations(pbody) > 0) {
+            if( _bshared ) {
+                _UpdateSharedTree();
+            }
+            else if ( UpdateCollisionConfigurations(pbody) > 0) {
                 RAVELOG_DEBUG_FORMAT("%s %s %d","Updating add/remove bodies"%pbody->GetName()%action);
                 // remove all configurations that collide with this body
             }
@@ -1400,14 +2162,22 @@ void ConfigurationCache::_UpdateRobotJointLimits()
             // compute new max distance for cache
             // distance has to be computed in the same way as CacheTreeNode.GetDistance()
             // otherwise, distances larger than this value could be inserted into the tree
+            if( _bshared ) {
+                // limits are part of the key
+                _lowerlimit = _newlowerlimit;
+                _upperlimit = _newupperlimit;
+                _UpdateSharedTree();
+                return;
+            }
+            boost::unique_lock< boost::shared_mutex > lock(_psharedtree->_mutex);
             dReal maxdistance = 0;
             for (size_t i = 0; i < _lowerlimit.size(); ++i) {
-                dReal f = (_upperlimit[i] - _lowerlimit[i]) * _cachetree.GetWeights().at(i);
+                dReal f = (_upperlimit[i] - _lowerlimit[i]) * _psharedtree->_cachetree.GetWeights().at(i);
                 maxdistance += f*f;
             }
             maxdistance = RaveSqrt(maxdistance);
-            if( maxdistance > _cachetree.GetMaxDistance()+g_fEpsilonLinear ) {
-                _cachetree.SetMaxDistance(maxdistance);
+            if( maxdistance > _psharedtree->_cachetree.GetMaxDistance()+g_fEpsilonLinear ) {
+                _psharedtree->_cachetree.SetMaxDistance(maxdistance);
             }
 
             _lowerlimit = _newlowerlimit;
@@ -1418,6 +2188,11 @@ void ConfigurationCache::_UpdateRobotJointLimits()
 
 void ConfigurationCache::_UpdateRobotGrabbed()
 {
+    if( _bshared ) {
+        // grabbed bodies are part of the key
+        _UpdateSharedTree();
+        return;
+    }
     bool newGrab = false;
 
     _vnewgrabbedbodies.resize(0);
@@ -1441,4 +2216,167 @@ void ConfigurationCache::_UpdateRobotGrabbed()
     }
 }
 
+void ConfigurationCache::SetShared(bool bshared, const std::string& extrakey)
+{
+    _bshared = bshared;
+    _sharedextrakey = extrakey;
+    _UpdateSharedTree();
+}
+
+void ConfigurationCache::_ComputeLinkSpheres()
+{
+    _vlinkspheres.resize(_numlinkspheres);
+    if( _numlinkspheres == 0 ) {
+        return;
+    }
+    const std::vector<KinBody::LinkPtr>& vlinks = _pstaterobot->GetLinks();
+    for(int ilink = 0; ilink+1 < _numlinkspheres; ++ilink) {
+        Vector& sphere = _vlinkspheres[ilink];
+        if( ilink >= (int)vlinks.size() || !vlinks[ilink]->IsEnabled() || vlinks[ilink]->GetGeometries().size() == 0 ) {
+            sphere = Vector(0,0,0,-1);
+            continue;
+        }
+        AABB ab = vlinks[ilink]->ComputeAABB();
+        sphere = ab.pos;
+        sphere.w = ab.extents.lengthsqr3();
+    }
+
+    // one sphere for all the grabbed bodies
+    Vector& grabbedsphere = _vlinkspheres.back();
+    grabbedsphere = Vector(0,0,0,-1);
+    _vnewgrabbedbodies.resize(0);
+    _pstaterobot->GetGrabbed(_vnewgrabbedbodies);
+    bool bhasgrabbed = false;
+    Vector vmin, vmax;
+    FOREACHC(itbody, _vnewgrabbedbodies) {
+        AABB ab = (*itbody)->ComputeAABB();
+        if( !bhasgrabbed ) {
+            vmin = ab.pos - ab.extents;
+            vmax = ab.pos + ab.extents;
+            bhasgrabbed = true;
+        }
+        else {
+            for(int j = 0; j < 3; ++j) {
+                vmin[j] = min(vmin[j], ab.pos[j] - ab.extents[j]);
+                vmax[j] = max(vmax[j], ab.pos[j] + ab.extents[j]);
+            }
+        }
+    }
+    if( bhasgrabbed ) {
+        grabbedsphere = 0.5*(vmin+vmax);
+        grabbedsphere.w = (0.5*(vmax-vmin)).lengthsqr3();
+    }
+}
+
+SharedCacheTreePtr ConfigurationCache::_CreateCacheTree() const
+{
+    SharedCacheTreePtr ptree(new SharedCacheTree(_pstaterobot->GetDOF()));
+    // distance has to be computed in the same way as CacheTreeNode.GetDistance()
+    // otherwise, distances larger than this value could be inserted into the tree
+    dReal maxdistance = 0;
+    for (size_t i = 0; i < _vweights.size(); ++i) {
+        dReal f = (_upperlimit[i] - _lowerlimit[i]) * _vweights[i];
+        maxdistance += f*f;
+    }
+    ptree->_cachetree.Init(_vweights, RaveSqrt(maxdistance));
+    ptree->_cachetree.SetNumLinkSpheres(_numlinkspheres);
+    if( _fbase != ptree->_cachetree.GetBase() ) {
+        ptree->_cachetree.SetBase(_fbase);
+    }
+    return ptree;
+}
+
+std::string ConfigurationCache::_ComputeSharedKey() const
+{
+    std::stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+    ss << _sharedextrakey << " " << _envupdates << " " << _pstaterobot->GetName() << " " << _pstaterobot->GetKinematicsGeometryHash() << " " << _fbase << " " << _nRobotAffineDOF << " " << _vRobotRotationAxis;
+    FOREACHC(it, _vRobotActiveIndices) {
+        ss << " " << *it;
+    }
+    for(size_t i = 0; i < _vweights.size(); ++i) {
+        ss << " " << _vweights[i] << " " << _lowerlimit.at(i) << " " << _upperlimit.at(i);
+    }
+
+    // grabbed bodies move with the robot, so only their pose relative to the robot matters
+    Transform tinvrobot = _pstaterobot->GetTransform().inverse();
+    std::vector<KinBodyPtr> vgrabbed;
+    _pstaterobot->GetGrabbed(vgrabbed);
+    FOREACHC(itbody, vgrabbed) {
+        ss << " grabbed " << (*itbody)->GetName() << " " << (*itbody)->GetKinematicsGeometryHash() << " " << (tinvrobot*(*itbody)->GetTransform());
+    }
+
+    if( _envupdates ) {
+        // the dofs not tracked by the cache and the pose of the robot if it is not part of the state
+        std::vector<dReal> vdofvalues;
+        _pstaterobot->GetDOFValues(vdofvalues);
+        for(size_t idof = 0; idof < vdofvalues.size(); ++idof) {
+            if( std::find(_vRobotActiveIndices.begin(), _vRobotActiveIndices.end(), (int)idof) == _vRobotActiveIndices.end() ) {
+                ss << " " << vdofvalues[idof];
+            }
+        }
+        if( _nRobotAffineDOF == 0 ) {
+            ss << " " << _pstaterobot->GetTransform();
+        }
+
+        // bodies are sorted by name so that the key does not depend on the order they were added in
+        std::vector<KinBodyPtr> vbodies;
+        _penv->GetBodies(vbodies);
+        std::map<std::string, KinBodyPtr> mapbodies;
+        FOREACHC(itbody, vbodies) {
+            if( *itbody != _pstaterobot && !_pstaterobot->IsGrabbing(**itbody) ) {
+                mapbodies[(*itbody)->GetName()] = *itbody;
+            }
+        }
+        FOREACHC(itbody, mapbodies) {
+            KinBodyPtr pbody = itbody->second;
+            ss << " body " << itbody->first << " " << pbody->GetKinematicsGeometryHash() << " " << pbody->IsEnabled() << " " << pbody->GetTransform();
+            pbody->GetDOFValues(vdofvalues);
+            FOREACHC(itvalue, vdofvalues) {
+                ss << " " << *itvalue;
+            }
+            FOREACHC(itlink, pbody->GetLinks()) {
+                ss << " " << (*itlink)->IsEnabled();
+            }
+        }
+    }
+    return utils::GetMD5HashString(ss.str());
+}
+
+void ConfigurationCache::_UpdateSharedTree()
+{
+    if( !_bshared ) {
+        if( _sharedkey.size() > 0 ) {
+            // other caches could still be using the tree, so start a new one
+            _sharedkey.clear();
+            _psharedtree = _CreateCacheTree();
+        }
+        return;
+    }
+
+    std::string sharedkey = _ComputeSharedKey();
+    if( sharedkey == _sharedkey ) {
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(s_mutexSharedTrees);
+    SharedCacheTreePtr ptree = s_mapSharedTrees[sharedkey].lock();
+    if( !ptree ) {
+        ptree = _CreateCacheTree();
+        s_mapSharedTrees[sharedkey] = ptree;
+    }
+    // remove the trees that are not used anymore
+    std::map<std::string, SharedCacheTreeWeakPtr>::iterator it = s_mapSharedTrees.begin();
+    while(it != s_mapSharedTrees.end()) {
+        if( it->second.expired() ) {
+            s_mapSharedTrees.erase(it++);
+        }
+        else {
+            ++it;
+        }
+    }
+    _psharedtree = ptree;
+    _sharedkey = sharedkey;
+    RAVELOG_VERBOSE_FORMAT("env=%d, cache of robot %s uses shared tree %s", _penv->GetId()%_pstaterobot->GetName()%sharedkey);
+}
+
 }
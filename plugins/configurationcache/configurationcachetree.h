@@ -17,7 +17,12 @@
 
 #include "openraveplugindefs.h"
 #include <deque>
+#include <atomic>
 #include <boost/pool/pool.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 #define _(msgid) OpenRAVE::RaveGetLocalizedTextForDomain("openrave_plugins_configurationcache", msgid)
 
@@ -32,6 +37,41 @@ enum ConfigurationNodeType {
     CNT_Any = 3, /// used to target any node. not a node type
 };
 
+class CacheTreeNode;
+
+/// \brief contiguous array of the child nodes of a node. The memory is allocated in the children pools of CacheTree, so the array can only be changed through CacheTree.
+///
+/// Compared to std::vector, saves a pointer per node and never calls the global allocator.
+class CacheTreeNodeChildren
+{
+public:
+    typedef CacheTreeNode** iterator;
+    typedef CacheTreeNode* const* const_iterator;
+
+    CacheTreeNodeChildren() : _pnodes(NULL), _num(0), _poolindex(0) {
+    }
+
+    inline iterator begin() const {
+        return _pnodes;
+    }
+    inline iterator end() const {
+        return _pnodes+_num;
+    }
+    inline size_t size() const {
+        return _num;
+    }
+    inline CacheTreeNode*& operator[](size_t index) const {
+        return _pnodes[index];
+    }
+
+private:
+    CacheTreeNode** _pnodes; ///< allocated from CacheTree::_vpoolChildren[_poolindex], NULL if nothing is allocated
+    uint32_t _num; ///< number of children
+    uint32_t _poolindex; ///< the capacity of _pnodes is 1<<_poolindex
+
+    friend class CacheTree;
+};
+
 class CacheTreeNode
 {
 public:
@@ -117,10 +157,9 @@ public:
     //void UpdateApproximates(dReal distance, CacheTreeNodePtr v);
 
 protected:
-    std::vector<CacheTreeNode*> _vchildren; ///< direct children of this node (for the next level down)
+    CacheTreeNodeChildren _vchildren; ///< direct children of this node (for the next level down)
     ConfigurationNodeType _conftype; ///< configuration type for this node
     KinBody::LinkConstPtr _collidinglink; ///< collidinglink in the collision report for this node
-    Transform _collidinglinktrans; ///< the colliding link's transform. Valid if _conftype is CNT_Collision
     int _robotlinkindex; ///< the robot link index that is colliding with _collidinglink. Valid if _conftype is CNT_Collision
 
     // idea: keep k nearest neighbors and update k every now and then, k = (e + e/dim) * log(n+1) where n is the size of the tree?
@@ -131,13 +170,14 @@ protected:
     int16_t _level; ///< the level the node belongs to
     uint8_t _hasselfchild; ///< if 1, then _vchildren has contains a clone of this node in the level below it.
     uint8_t _usenn; ///< if 1, then use part of the nearest neighbor search, otherwise ignore
-    int _hitcount; /// number of cache hits
+    std::atomic<int> _hitcount; /// number of cache hits, atomic since queries of shared trees run concurrently
+    int _index; ///< index of the node in the saved file, only valid while saving
 
     // managed by pool
 #ifdef _DEBUG
     int id;
 #endif
-    Vector* _plinkspheres; ///< xyz is center, w is radius^2 of every link on the robot, pointer managed by outside pool so do not delete
+    Vector* _plinkspheres; ///< xyz is center, w is radius^2 of every link on the robot (negative if the link cannot collide), pointer managed by outside pool so do not delete. NULL if the tree does not store link spheres or they are not known for this node
     dReal _pcstate[0]; ///< the state values, pointer managed by outside pool so do not delete. The values always follow the allocation of the structure.
 
 private:
@@ -191,8 +231,9 @@ public:
     /// \brief inserts node in the tree. If node is too close to other nodes in the tree, then does not insert.
     ///
     /// \param[in] fMinSeparationDist the max distance a node should be separated from its closest neighbor. If node is collision, then only applies to collision neighbors, free neighbors are ignored.
+    /// \param[in] plinkspheres if not NULL, GetNumLinkSpheres() bounding spheres of the robot at cs that are stored with the node
     /// \return 1 if point is inserted and parent found. 0 if no parent found and point is not inserted. -1 if parent found but point not inserted since it is close to fMinSeparationDist
-    int InsertNode(const std::vector<dReal>& cs, CollisionReportPtr report, dReal fMinSeparationDist);
+    int InsertNode(const std::vector<dReal>& cs, CollisionReportPtr report, dReal fMinSeparationDist, const Vector* plinkspheres=NULL);
 
     /// \brief removes node from the tree
     ///
@@ -252,9 +293,17 @@ public:
     /// \brief sets all collision configurations with pbody in its report to CNT_Unknown
     int UpdateCollisionConfigurations(KinBodyPtr pbody);
 
-    /// \brief sets all free configurations to CNT_Unknown, TODO, only set those that overlap with the new body
+    /// \brief sets all free configurations whose link spheres overlap with the AABB of pbody to CNT_Unknown. Free configurations without link spheres are always set.
     int UpdateFreeConfigurations(KinBodyPtr pbody);
 
+    /// \brief sets the number of bounding spheres stored with every node, resets the tree
+    void SetNumLinkSpheres(int numlinkspheres);
+
+    /// \brief returns the number of bounding spheres stored with every node
+    int GetNumLinkSpheres() const {
+        return _numlinkspheres;
+    }
+
     /// \brief returns the number of configurations in the tree that are not CNT_Unknown
     int GetNumKnownNodes();
 
@@ -264,19 +313,53 @@ public:
     /// \brief load cache from disk
     int LoadCache(std::string filename, EnvironmentBasePtr penv);
 
+    /// \brief saves the structure of the tree to a binary snapshot that CacheTreeSnapshot can memory map
+    ///
+    /// \param filename the full path of the file
+    /// \return 1 if successful
+    int SaveSnapshot(const std::string& filename);
+
 private:
     /// \brief creates new node on the pool
-    CacheTreeNodePtr _CreateCacheTreeNode(const std::vector<dReal>& cs, CollisionReportPtr report);
+    CacheTreeNodePtr _CreateCacheTreeNode(const std::vector<dReal>& cs, CollisionReportPtr report, const Vector* plinkspheres=NULL);
     CacheTreeNodePtr _CloneCacheTreeNode(CacheTreeNodeConstPtr refnode);
 
     /// \brief deletes the node from the pool and calls its destructor.
     void _DeleteCacheTreeNode(CacheTreeNodePtr pnode);
 
+    /// \brief appends pchild to the children of pnode
+    void _AddChild(CacheTreeNodePtr pnode, CacheTreeNodePtr pchild);
+
+    /// \brief removes the child pointed to by itchild from the children of pnode, keeping the order of the other children
+    ///
+    /// \return the iterator following the removed child
+    CacheTreeNodeChildren::iterator _EraseChild(CacheTreeNodePtr pnode, CacheTreeNodeChildren::iterator itchild);
+
+    /// \brief resizes the children of pnode, new children are NULL
+    void _ResizeChildren(CacheTreeNodePtr pnode, size_t numchildren);
+
+    /// \brief returns the children array of pnode to its pool
+    void _FreeChildren(CacheTreeNodePtr pnode);
+
     /// \brief takes in the configurations of two nodes and returns the distance, currently returning square of L2 norm.
     ///
     /// note the distance metric has to satisfy triangle inequality
     dReal _ComputeDistance2(const dReal* cstatei, const dReal* cstatef) const;
 
+    /// \brief updates _weights2 from _weights, has to be called every time _weights changes
+    void _UpdateWeights2();
+
+    /// \brief returns the memory a node takes in the pool
+    inline size_t _GetNodeMemorySize() const {
+        return sizeof(CacheTreeNode)+sizeof(dReal)*_statedof+sizeof(Vector)*_numlinkspheres;
+    }
+
+    /// \brief copies the link spheres into the pool memory of the node following its state
+    void _SetNodeLinkSpheres(CacheTreeNodePtr pnode, const Vector* plinkspheres);
+
+    /// \brief returns true if any link sphere of the node intersects ab, or if the node does not have link spheres
+    bool _LinkSpheresIntersect(CacheTreeNodeConstPtr pnode, const AABB& ab) const;
+
     /// \brief inserts a configuration into the cache tree
     ///
     /// \param[in] node the input node to insert
@@ -315,6 +398,7 @@ private:
     }
 
     std::vector<dReal> _weights; ///< weights used by the distance function
+    std::vector<dReal> _weights2; ///< squares of _weights, passed to planningutils::ComputeWeightedDistance2
     std::vector<dReal> _curconf;
 
     std::string _fulldirname;
@@ -322,23 +406,24 @@ private:
     std::string _collidingbodyname;
     KinBodyPtr _pcollidingbody;
 
-    std::map<CacheTreeNodePtr, int> _mapNodeIndices;
     std::vector< std::set<CacheTreeNodePtr> > _vsetLevelNodes; ///< _vsetLevelNodes[enc(level)][node] holds the indices of the children of "node" of a given the level. enc(level) maps (-inf,inf) into [0,inf) so it can be indexed by the vector. Every node has an entry in a map here. If the node doesn't hold any children, then it is at the leaf of the tree. _vsetLevelNodes.at(_EncodeLevel(_maxlevel)) is the root.
 
     OPENRAVE_SHARED_PTR<boost::pool<> > _poolNodes; ///< the dynamically growing memory pool of nodes. Since each node's size is determined during run-time, the pool constructor has to be called with the correct node size
+    std::vector< OPENRAVE_SHARED_PTR<boost::pool<> > > _vpoolChildren; ///< _vpoolChildren[i] allocates the children arrays of 1<<i nodes, created on demand
 
     dReal _maxdistance; ///< maximum possible distance between two states. used to balance the tree.
     dReal _base, _fBaseInv, _fBaseInv2, _fBaseChildMult; ///< a constant used to control the max level of traversion. _fBaseInv = 1/_base, _fBaseInv2=Sqr(_fBaseInv), _fBaseChildMult=1/(_base-1)
 
     int _statedof; ///< the state space DOF tree is configured for
+    int _numlinkspheres; ///< the number of link spheres stored after the state of every node
     int _maxlevel; ///< the maximum allowed levels in the tree, this is where the root node starts (inclusive)
     int _minlevel; ///< the minimum allowed levels in the tree (inclusive)
     int _numnodes; ///< the number of nodes in the current tree starting at the root at _vsetLevelNodes.at(_EncodeLevel(_maxlevel))
     dReal _fMaxLevelBound; ///< pow(_base, _maxlevel)
 
-    // cache cache
-    mutable std::vector< std::pair<CacheTreeNodePtr, dReal> > _vCurrentLevelNodes, _vNextLevelNodes;
-    mutable std::vector< std::vector<CacheTreeNodePtr> > _vvCacheNodes;
+    // cache cache, only used when inserting and removing. FindNearestNode uses thread local buffers so that it can be called concurrently
+    std::vector< std::pair<CacheTreeNodePtr, dReal> > _vCurrentLevelNodes, _vNextLevelNodes;
+    std::vector< std::vector<CacheTreeNodePtr> > _vvCacheNodes;
 
     std::vector<CacheTreeNodePtr> _vnodes; ///< for loading
     std::vector<dReal> _dummycs; ///< for loading
@@ -346,6 +431,100 @@ private:
 
 typedef OPENRAVE_SHARED_PTR<CacheTree> CacheTreePtr;
 
+struct CacheTreeSnapshotNode;
+
+/** \brief read-only cover tree memory mapped from a file written by CacheTree::SaveSnapshot.
+
+    The nodes, states and children are used directly from the mapped file, so a large cache can be queried right after
+    loading. Only the node types are copied so that nodes can still be invalidated. New nodes have to go to a CacheTree
+    queried together with the snapshot.
+ */
+class CacheTreeSnapshot
+{
+public:
+    CacheTreeSnapshot();
+    virtual ~CacheTreeSnapshot();
+
+    /// \brief maps the snapshot file
+    ///
+    /// \param penv environment to get the colliding links from
+    /// \return true if successful
+    bool Load(const std::string& filename, EnvironmentBasePtr penv);
+
+    /// \brief same as CacheTree::FindNearestNode, but returns the node index or -1 if nothing is found
+    std::pair<int, dReal> FindNearestNode(const std::vector<dReal>& cs, dReal distancebound=-1, ConfigurationNodeType conftype = CNT_Any) const;
+
+    /// \brief same as CacheTree::FindNearestNode, but returns the node index or -1 if nothing is found
+    std::pair<int, dReal> FindNearestNode(const std::vector<dReal>& cs, dReal collisionthresh, dReal freespacethresh) const;
+
+    inline int GetNumNodes() const {
+        return _numnodes;
+    }
+
+    inline ConfigurationNodeType GetType(int inode) const {
+        return (ConfigurationNodeType)_vtypes[inode];
+    }
+
+    inline const dReal* GetConfigurationState(int inode) const {
+        return _pstates + inode*_statedof;
+    }
+
+    /// \brief returns the robot link index in the collision report of a node
+    int GetRobotLinkIndex(int inode) const;
+
+    /// \brief returns the colliding link of a collision node, empty if the body does not exist in the environment the snapshot was loaded in
+    KinBody::LinkConstPtr GetCollidingLink(int inode) const;
+
+    const std::vector<dReal>& GetWeights() const {
+        return _weights;
+    }
+
+    /// \brief appends the states of all nodes to vals
+    void GetNodeValues(std::vector<dReal>& vals) const;
+
+    /// \brief returns the number of nodes that are not CNT_Unknown
+    int GetNumKnownNodes() const;
+
+    /// \brief sets all nodes of type conftype to CNT_Unknown
+    int RemoveConfigurations(ConfigurationNodeType conftype);
+
+    /// \brief sets all collision nodes with pbody to CNT_Unknown
+    int UpdateCollisionConfigurations(KinBodyPtr pbody);
+
+private:
+    inline dReal _ComputeDistance2(const dReal* pquerystate, int inode) const;
+
+    OPENRAVE_SHARED_PTR<boost::interprocess::file_mapping> _pmapping;
+    OPENRAVE_SHARED_PTR<boost::interprocess::mapped_region> _pregion;
+    const dReal* _pstates; ///< _numnodes*_statedof states in the mapped file
+    const CacheTreeSnapshotNode* _pnodes; ///< _numnodes nodes in the mapped file, the root is 0
+    const int32_t* _pchildren; ///< the child indices in the mapped file
+    std::vector<uint8_t> _vtypes; ///< the current ConfigurationNodeType of every node
+    std::vector<KinBodyPtr> _vcollidingbodies; ///< the colliding bodies of the collision nodes, indexed by CacheTreeSnapshotNode::collidingbodyindex
+    std::vector<dReal> _weights, _weights2;
+    int _statedof, _numnodes;
+    dReal _maxdistance, _fBaseInv, _fMaxLevelBound;
+};
+
+typedef OPENRAVE_SHARED_PTR<CacheTreeSnapshot> CacheTreeSnapshotPtr;
+
+/// \brief cache tree that can be shared by several ConfigurationCache instances, for example the caches of cloned environments used by different planning threads.
+///
+/// Queries take a shared lock on _mutex, any modification of the tree takes a unique lock.
+class SharedCacheTree
+{
+public:
+    SharedCacheTree(int statedof) : _cachetree(statedof) {
+    }
+
+    CacheTree _cachetree; ///< gets all newly inserted nodes
+    CacheTreeSnapshotPtr _psnapshot; ///< if not empty, read-only nodes from a snapshot that are queried together with _cachetree
+    mutable boost::shared_mutex _mutex; ///< protects _cachetree and _psnapshot
+};
+
+typedef OPENRAVE_SHARED_PTR<SharedCacheTree> SharedCacheTreePtr;
+typedef OPENRAVE_WEAK_PTR<SharedCacheTree> SharedCacheTreeWeakPtr;
+
 /** Maintains an up-to-date cache tree synchronized to the openrave environment. Tracks bodies being added removed, states changing, etc.
    The state of cache consists of the active DOFs of the robot that is passed in at constructor time.
  */
@@ -375,7 +554,7 @@ public:
     /// \brief removes all free configurations
     int RemoveFreeConfigurations();
 
-    /// \brief removes all free configurations, to be updated to only remove those with linkspheres that overlap with the body
+    /// \brief removes all free configurations whose robot link spheres overlap with the body
     int UpdateFreeConfigurations(KinBodyPtr pbody);
 
     /// \brief determine if current configuration is whithin threshold of a collision in the cache (_collisionthresh), known to be in collision, or requires an explicit collision check
@@ -392,25 +571,19 @@ public:
     //int SynchronizeAll(KinBodyConstPtr pbody = KinBodyConstPtr());
 
     /// \brief number of nodes currently in the cover tree
-    int GetNumNodes() const {
-        return _cachetree.GetNumNodes();
-    }
+    int GetNumNodes() const;
 
     /// \brief number of nodes with known type, i.e., != CNT_Unknown
     int GetNumKnownNodes();
 
     /// \brief return configuration values for all nodes in the tree, calls cachetree's function
-    void GetNodeValues(std::vector<dReal>& vals) const {
-        _cachetree.GetNodeValues(vals);
-    }
+    void GetNodeValues(std::vector<dReal>& vals) const;
 
     /// \brief return nearest configuration and distance
     std::pair<std::vector<dReal>, dReal> FindNearestNode(const std::vector<dReal>& conf, dReal dist = 0.0);
 
     /// \brief return distance between two configurations as computed by the tree (for testing)
-    dReal ComputeDistance(const std::vector<dReal>& qi, const std::vector<dReal>& qf) const {
-        return _cachetree.ComputeDistance(qi,qf);
-    }
+    dReal ComputeDistance(const std::vector<dReal>& qi, const std::vector<dReal>& qf) const;
 
     /// \brief the cache will assume a new configuration is in collision if the nearest node in the tree is below this distance
     inline void SetCollisionThresh(dReal colthresh)
@@ -425,10 +598,7 @@ public:
     }
 
     /// \brief set the base parameter
-    inline void SetBase(dReal base)
-    {
-        _cachetree.SetBase(base);
-    }
+    void SetBase(dReal base);
 
     /// \brief disable environment updates
     inline void DisableEnvUpdates()
@@ -470,10 +640,7 @@ public:
     }
 
     /// \brief returns the base parameter
-    inline dReal GetBase() const
-    {
-        return _cachetree.GetBase();
-    }
+    dReal GetBase() const;
 
     /// \brief returns the robot
     inline RobotBasePtr GetRobot() const {
@@ -484,21 +651,34 @@ public:
     bool Validate();
 
     /// \brief remove all nodes in collision with pbody, for testing
-    inline void UpdateCollisionNodes(KinBodyPtr pbody)
-    {
-        _cachetree.UpdateCollisionNodes(pbody);
-    }
+    void UpdateCollisionNodes(KinBodyPtr pbody);
 
     /// \brief saves the cache to disk
-    inline void SaveCache(std::string filename)
-    {
-        _cachetree.SaveCache(filename);
-    }
+    void SaveCache(std::string filename);
 
     /// \brief loads cache from disk
-    inline void LoadCache(std::string filename, EnvironmentBasePtr penv)
-    {
-        _cachetree.LoadCache(filename, penv);
+    void LoadCache(std::string filename, EnvironmentBasePtr penv);
+
+    /// \brief saves all nodes of the cache to a binary snapshot file that can be memory mapped with LoadSnapshot
+    ///
+    /// If the cache uses a snapshot itself, its nodes are merged into the tree first.
+    /// \return true if successful
+    bool SaveSnapshot(const std::string& filename);
+
+    /// \brief replaces the cache with the nodes of a snapshot file. The snapshot is used read-only, new nodes are inserted into an empty tree queried together with it.
+    ///
+    /// \return true if successful
+    bool LoadSnapshot(const std::string& filename);
+
+    /// \brief shares the cache tree with the other shared caches of the process that track the same robot in the same static scene, e.g. the caches of cloned environments used by different planning threads.
+    ///
+    /// Whenever the scene changes, the cache switches to the tree of the new scene instead of invalidating the nodes of the shared tree.
+    /// \param extrakey additional string that has to match for caches to share a tree, e.g. the internal collision checker and geometry group
+    void SetShared(bool bshared, const std::string& extrakey=std::string());
+
+    /// \brief returns true if the cache tree is shared
+    inline bool IsShared() const {
+        return _bshared;
     }
 
 private:
@@ -514,7 +694,26 @@ private:
     /// \brief called when grabbeb bodies are updated
     void _UpdateRobotGrabbed();
 
-    CacheTree _cachetree; ///< cache tree datastructure with configurations and their collision information
+    /// \brief returns the link of this environment corresponding to the colliding link of a node, which can come from another environment if the tree is shared
+    KinBody::LinkConstPtr _GetLocalCollidingLink(KinBody::LinkConstPtr plink) const;
+
+    /// \brief creates an empty tree for the current weights, limits and base
+    SharedCacheTreePtr _CreateCacheTree() const;
+
+    /// \brief computes the bounding spheres of the robot links and grabbed bodies at the current state into _vlinkspheres
+    void _ComputeLinkSpheres();
+
+    /// \brief computes the key of the shared trees from the robot, the cache parameters and the static scene
+    std::string _ComputeSharedKey() const;
+
+    /// \brief if shared, switches to the shared tree of the current scene, otherwise makes sure the tree is not shared anymore
+    void _UpdateSharedTree();
+
+    SharedCacheTreePtr _psharedtree; ///< cache tree datastructure with configurations and their collision information. Only shared with other caches if _bshared is true
+    std::string _sharedkey; ///< the key of _psharedtree in the shared trees, empty if not shared
+    std::string _sharedextrakey; ///< see SetShared
+    bool _bshared; ///< if true, _psharedtree is shared with the other caches with the same key
+    dReal _fbase; ///< the base of the tree
 
     RobotBasePtr _pstaterobot;
     std::vector<int> _vRobotActiveIndices;
@@ -529,6 +728,8 @@ private:
     std::vector<dReal> _newupperlimit, _newlowerlimit;
     std::vector<CacheTreeNodePtr> _cachetreenodes;
     std::vector<dReal> _vweights;
+    std::vector<Vector> _vlinkspheres; ///< see _ComputeLinkSpheres
+    int _numlinkspheres; ///< number of link spheres stored with the nodes, one per robot link and one for all grabbed bodies. 0 if the cache does not track environment changes
 
     class KinBodyCachedData : public UserData
     {
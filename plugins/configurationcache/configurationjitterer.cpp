@@ -118,6 +118,8 @@ By default will sample the robot's active DOFs. Parameters part of the interface
                         "constrains the position of the manipulator around an obb: right, up, dir, pos, extents");
         RegisterCommand("SetResetIterationsOnSample",boost::bind(&ConfigurationJitterer::SetResetIterationsOnSampleCommand,this,_1,_2),
                         "" "sets the _bResetIterationsOnSample: whether or not to reset _nNumIterations every time Sample is called.");
+        RegisterCommand("SetParallel",boost::bind(&ConfigurationJitterer::SetParallelCommand,this,_1,_2),
+                        "\"numthreads [numcandidates]\", if numthreads > 1, the jitter candidates are sampled in rounds of numcandidates (default 2*numthreads) and checked for collisions and manip constraints by numthreads threads, each in its own clone of the environment. The valid candidate of a round closest to the current configuration is taken.");
         RegisterCommand("SetManipulatorBias",boost::bind(&ConfigurationJitterer::SetManipulatorBiasCommand,this,_1,_2),
                         "Sets a bias on the sampling so that the manipulator has a tendency to move along vbias direction::\n\n\
   [manipname] bias_dir_x bias_dir_y bias_dir_z [nullsampleprob] [nullbiassampleprob] [deltasampleprob]\n\
@@ -162,6 +164,8 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         _bSetResultOnRobot = true;
         _busebiasing = false;
         _bResetIterationsOnSample = true;
+        _nParallelThreads = 1;
+        _nParallelCandidates = 0;
 
         // for selecting sampling modes
         if( samplername.size() == 0 ) {
@@ -360,6 +364,24 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         return true;
     }
 
+    bool SetParallelCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int numthreads = 0, numcandidates = 0;
+        sinput >> numthreads;
+        if( !sinput || numthreads < 0 ) {
+            return false;
+        }
+        if( !!(sinput >> numcandidates) && numcandidates < 0 ) {
+            return false;
+        }
+        _nParallelThreads = numthreads;
+        _nParallelCandidates = numcandidates;
+        if( _nParallelThreads <= 1 ) {
+            _vjitterworkers.resize(0);
+        }
+        return true;
+    }
+
     bool SetResetIterationsOnSampleCommand(std::ostream& sout, std::istream& sinput)
     {
         sinput >> _bResetIterationsOnSample;
@@ -590,6 +612,21 @@ By default will sample the robot's active DOFs. Parameters part of the interface
             fBias = RaveSqrt(fBias);
         }
 
+        auto countfailure = [&](int result) {
+            switch(result) {
+            case JCR_ToolDirection: nConstraintToolDirFailure++; break;
+            case JCR_ToolPosition: nConstraintToolPositionFailure++; break;
+            case JCR_EnvCollision: nEnvCollisionFailure++; break;
+            case JCR_SelfCollision: nSelfCollisionFailure++; break;
+            default: break;
+            }
+        };
+
+        const bool bParallel = _nParallelThreads > 1 && _InitJitterWorkers();
+        const int nParallelCandidates = _nParallelCandidates > 0 ? _nParallelCandidates : 2*_nParallelThreads;
+        std::vector<int> vcandidateresults;
+        _vcandidatevalues.resize(0);
+
         uint64_t starttime = utils::GetNanoPerformanceTime();
         for(int iter = 0; iter < _maxiterations; ++iter) {
             if( (iter%10) == 0 ) { // not sure what a good rate is...
@@ -784,93 +821,24 @@ By default will sample the robot's active DOFs. Parameters part of the interface
             }
 
             // check perturbation
-            bCollision = false;
-            bConstraintFailed = false;
-            FOREACH(itperturbation,perturbations) {
-                // Perturbation is added to a config to make sure that the config is not too close to collision and tool
-                // direction/position constraint boundaries. So we do not use _neighstatefn to compute perturbed
-                // configurations.
-                _newdof2 = vnewdof;
-                for(size_t idof = 0; idof < _newdof2.size(); ++idof) {
-                    _newdof2[idof] += *itperturbation;
-                    if( _newdof2[idof] > _upper.at(idof) ) {
-                        _newdof2[idof] = _upper.at(idof);
-                    }
-                    else if( _newdof2[idof] < _lower.at(idof) ) {
-                        _newdof2[idof] = _lower.at(idof);
-                    }
-                }
-                _probot->SetActiveDOFValues(_newdof2);
-                if( !!_pConstraintToolDirection ) {
-                    if( !_pConstraintToolDirection->IsInConstraints(_pmanip->GetTransform()) ) {
-                        bConstraintFailed = true;
-                        nConstraintToolDirFailure++;
-                        if( IS_DEBUGLEVEL(Level_Verbose) ) {
-                            stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
-                            ss << "env=" << _probot->GetEnv()->GetId() << ", direction constraints failed, ";
-                            for(size_t i = 0; i < _newdof2.size(); ++i ) {
-                                if( i > 0 ) {
-                                    ss << "," << _newdof2[i];
-                                }
-                                else {
-                                    ss << "colvalues=[" << _newdof2[i];
-                                }
-                            }
-                            ss << "]; cosangle=" << _pConstraintToolDirection->ComputeCosAngle(_pmanip->GetTransform()) << "; quat=[" << _pmanip->GetTransform().rot.x << ", " << _pmanip->GetTransform().rot.y << ", " << _pmanip->GetTransform().rot.z << ", " << _pmanip->GetTransform().rot.w << "]";
-                            RAVELOG_VERBOSE(ss.str());
-                        }
-                        break;
-                    }
-                }
-                if( !!_pConstraintToolPosition ) {
-                    if( !_pConstraintToolPosition->IsInConstraints(_pmanip->GetTransform()) ) {
-                        bConstraintFailed = true;
-                        nConstraintToolPositionFailure++;
-                        if( IS_DEBUGLEVEL(Level_Verbose) ) {
-                            stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
-                            ss << "env=" << _probot->GetEnv()->GetId() << ", position constraints failed, ";
-                            for(size_t i = 0; i < _newdof2.size(); ++i ) {
-                                if( i > 0 ) {
-                                    ss << "," << _newdof2[i];
-                                }
-                                else {
-                                    ss << "colvalues=[" << _newdof2[i];
-                                }
-                            }
-                            ss << "]; trans=[" << _pmanip->GetTransform().trans.x << ", " << _pmanip->GetTransform().trans.y << ", " << _pmanip->GetTransform().trans.z << "]";
-                            RAVELOG_VERBOSE(ss.str());
-                        }
-                        break;
-                    }
-                }
-
-                if( GetEnv()->CheckCollision(_probot, _report) ) {
-                    bCollision = true;
-                    nEnvCollisionFailure++;
+            if( bParallel ) {
+                // gather a round of candidates and check them together, the valid one closest to _curdof is taken
+                _vcandidatevalues.insert(_vcandidatevalues.end(), vnewdof.begin(), vnewdof.end());
+                if( (int)_vcandidatevalues.size() < nParallelCandidates*(int)vnewdof.size() && iter+1 < _maxiterations ) {
+                    continue;
                 }
-                if( !bCollision && _probot->CheckSelfCollision(_report)) {
-                    bCollision = true;
-                    nSelfCollisionFailure++;
-                }
-
-                if( bCollision ) {
-                    if( IS_DEBUGLEVEL(Level_Verbose) ) {
-                        stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
-                        ss << "env=" << _probot->GetEnv()->GetId() << ", collision failed, ";
-                        for(size_t i = 0; i < _newdof2.size(); ++i ) {
-                            if( i > 0 ) {
-                                ss << "," << _newdof2[i];
-                            }
-                            else {
-                                ss << "colvalues=[" << _newdof2[i];
-                            }
-                        }
-                        ss << "], report=" << _report->__str__();
-                        RAVELOG_VERBOSE(ss.str());
-                    }
-                    break;
+                bCollision = !_CheckCandidatesParallel(perturbations, vnewdof, vcandidateresults);
+                bConstraintFailed = false;
+                FOREACHC(itresult, vcandidateresults) {
+                    countfailure(*itresult);
                 }
             }
+            else {
+                int result = _CheckPerturbations(_probot, _pmanip, _report, vnewdof, perturbations, _newdof2);
+                countfailure(result);
+                bCollision = result == JCR_EnvCollision || result == JCR_SelfCollision;
+                bConstraintFailed = result == JCR_ToolDirection || result == JCR_ToolPosition;
+            }
 
             if( !bCollision && !bConstraintFailed ) {
                 // the last perturbation is 0, so state is already set to the correct jittered value
@@ -904,6 +872,21 @@ By default will sample the robot's active DOFs. Parameters part of the interface
             }
         }
 
+        if( _vcandidatevalues.size() > 0 ) {
+            // the last round was not full since the last iterations were rejected before the perturbation checks
+            bool bSuccess = _CheckCandidatesParallel(perturbations, vnewdof, vcandidateresults);
+            FOREACHC(itresult, vcandidateresults) {
+                countfailure(*itresult);
+            }
+            if( bSuccess ) {
+                if( _bSetResultOnRobot ) {
+                    robotsaver.Release();
+                }
+                RAVELOG_DEBUG_FORMAT("succeed iterations=%d, computation=%fs, bConstraint=%d, neighstate=%d, constraintToolDir=%d, constraintToolPos=%d, envCollision=%d, selfCollision=%d",_maxiterations%(1e-9*(utils::GetNanoPerformanceTime() - starttime))%bConstraint%nNeighStateFailure%nConstraintToolDirFailure%nConstraintToolPositionFailure%nEnvCollisionFailure%nSelfCollisionFailure);
+                return 1;
+            }
+        }
+
         RAVELOG_INFO_FORMAT("failed iterations=%d (max=%d), computation=%fs, bConstraint=%d, neighstate=%d, constraintToolDir=%d, constraintToolPos=%d, envCollision=%d, selfCollision=%d, cachehit=%d, samesamples=%d, nLinkDistThreshRejections=%d",_nNumIterations%_maxiterations%(1e-9*(utils::GetNanoPerformanceTime() - starttime))%bConstraint%nNeighStateFailure%nConstraintToolDirFailure%nConstraintToolPositionFailure%nEnvCollisionFailure%nSelfCollisionFailure%nCacheHitSamples%nSampleSamples%nLinkDistThreshRejections);
         //RAVELOG_WARN_FORMAT("failed iterations=%d, cachehits=%d, cache size=%d, jitter time=%fs", _maxiterations%_cachehit%cache.GetNumNodes()%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
         return 0;
@@ -911,6 +894,228 @@ By default will sample the robot's active DOFs. Parameters part of the interface
 
 protected:
 
+    /// \brief the outcomes of checking a jittered configuration with _CheckPerturbations
+    enum JitterCheckResult
+    {
+        JCR_Success = 0,
+        JCR_ToolDirection = 1, ///< failed the tool direction constraints
+        JCR_ToolPosition = 2, ///< failed the tool position constraints
+        JCR_EnvCollision = 3, ///< in collision with the environment
+        JCR_SelfCollision = 4, ///< in self collision
+    };
+
+    /// \brief state of a thread checking jitter candidates in its own clone of the environment
+    struct JitterWorker
+    {
+        EnvironmentBasePtr _penv;
+        RobotBasePtr _probot;
+        RobotBase::ManipulatorConstPtr _pmanip; ///< the clone of _pmanip, if set
+        CollisionReportPtr _report;
+        std::vector<dReal> _vtempdof;
+    };
+    typedef boost::shared_ptr<JitterWorker> JitterWorkerPtr;
+
+    /// \brief checks the manip constraints and collisions of vnewdof and its perturbations on probot. The robot is left at the last perturbation, which is 0.
+    ///
+    /// Only reads the members of the jitterer, so can be called from the jitter workers.
+    /// \param vtempdof buffer for the perturbed values
+    /// \return one of JitterCheckResult
+    int _CheckPerturbations(RobotBasePtr probot, RobotBase::ManipulatorConstPtr pmanip, CollisionReportPtr report, const std::vector<dReal>& vnewdof, const std::vector<dReal>& perturbations, std::vector<dReal>& vtempdof) const
+    {
+        EnvironmentBasePtr penv = probot->GetEnv();
+        FOREACHC(itperturbation,perturbations) {
+            // Perturbation is added to a config to make sure that the config is not too close to collision and tool
+            // direction/position constraint boundaries. So we do not use _neighstatefn to compute perturbed
+            // configurations.
+            vtempdof = vnewdof;
+            for(size_t idof = 0; idof < vtempdof.size(); ++idof) {
+                vtempdof[idof] += *itperturbation;
+                if( vtempdof[idof] > _upper.at(idof) ) {
+                    vtempdof[idof] = _upper.at(idof);
+                }
+                else if( vtempdof[idof] < _lower.at(idof) ) {
+                    vtempdof[idof] = _lower.at(idof);
+                }
+            }
+            probot->SetActiveDOFValues(vtempdof);
+            if( !!_pConstraintToolDirection ) {
+                if( !_pConstraintToolDirection->IsInConstraints(pmanip->GetTransform()) ) {
+                    if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                        stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+                        ss << "env=" << penv->GetId() << ", direction constraints failed, ";
+                        for(size_t i = 0; i < vtempdof.size(); ++i ) {
+                            if( i > 0 ) {
+                                ss << "," << vtempdof[i];
+                            }
+                            else {
+                                ss << "colvalues=[" << vtempdof[i];
+                            }
+                        }
+                        ss << "]; cosangle=" << _pConstraintToolDirection->ComputeCosAngle(pmanip->GetTransform()) << "; quat=[" << pmanip->GetTransform().rot.x << ", " << pmanip->GetTransform().rot.y << ", " << pmanip->GetTransform().rot.z << ", " << pmanip->GetTransform().rot.w << "]";
+                        RAVELOG_VERBOSE(ss.str());
+                    }
+                    return JCR_ToolDirection;
+                }
+            }
+            if( !!_pConstraintToolPosition ) {
+                if( !_pConstraintToolPosition->IsInConstraints(pmanip->GetTransform()) ) {
+                    if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                        stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+                        ss << "env=" << penv->GetId() << ", position constraints failed, ";
+                        for(size_t i = 0; i < vtempdof.size(); ++i ) {
+                            if( i > 0 ) {
+                                ss << "," << vtempdof[i];
+                            }
+                            else {
+                                ss << "colvalues=[" << vtempdof[i];
+                            }
+                        }
+                        ss << "]; trans=[" << pmanip->GetTransform().trans.x << ", " << pmanip->GetTransform().trans.y << ", " << pmanip->GetTransform().trans.z << "]";
+                        RAVELOG_VERBOSE(ss.str());
+                    }
+                    return JCR_ToolPosition;
+                }
+            }
+
+            int result = JCR_Success;
+            if( penv->CheckCollision(probot, report) ) {
+                result = JCR_EnvCollision;
+            }
+            else if( probot->CheckSelfCollision(report) ) {
+                result = JCR_SelfCollision;
+            }
+
+            if( result != JCR_Success ) {
+                if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                    stringstream ss; ss << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+                    ss << "env=" << penv->GetId() << ", collision failed, ";
+                    for(size_t i = 0; i < vtempdof.size(); ++i ) {
+                        if( i > 0 ) {
+                            ss << "," << vtempdof[i];
+                        }
+                        else {
+                            ss << "colvalues=[" << vtempdof[i];
+                        }
+                    }
+                    ss << "], report=" << report->__str__();
+                    RAVELOG_VERBOSE(ss.str());
+                }
+                return result;
+            }
+        }
+        return JCR_Success;
+    }
+
+    /// \brief makes sure there are _nParallelThreads jitter workers and synchronizes their environments with the environment of the jitterer.
+    ///
+    /// \return false if the workers cannot be set up, in which case Sample checks the candidates serially
+    bool _InitJitterWorkers()
+    {
+        try {
+            if( (int)_vjitterworkers.size() > _nParallelThreads ) {
+                _vjitterworkers.resize(_nParallelThreads);
+            }
+            while( (int)_vjitterworkers.size() < _nParallelThreads ) {
+                JitterWorkerPtr pworker(new JitterWorker());
+                pworker->_penv = GetEnv()->CloneSelf(Clone_Bodies);
+                pworker->_report.reset(new CollisionReport());
+                _vjitterworkers.push_back(pworker);
+            }
+            FOREACH(itworker, _vjitterworkers) {
+                JitterWorker& worker = **itworker;
+                worker._penv->SynchronizeBodies(GetEnv());
+                EnvironmentMutex::scoped_lock lock(worker._penv->GetMutex());
+                worker._probot = worker._penv->GetRobot(_probot->GetName());
+                if( !worker._probot ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("env=%d, robot %s is not in the cloned environment", GetEnv()->GetId()%_probot->GetName(), ORE_Assert);
+                }
+                worker._probot->SetActiveDOFs(_vActiveIndices, _nActiveAffineDOFs, _vActiveAffineAxis);
+                worker._pmanip.reset();
+                if( !!_pmanip ) {
+                    worker._pmanip = worker._probot->GetManipulator(_pmanip->GetName());
+                    if( !worker._pmanip ) {
+                        throw OPENRAVE_EXCEPTION_FORMAT("env=%d, manipulator %s is not in the cloned robot", GetEnv()->GetId()%_pmanip->GetName(), ORE_Assert);
+                    }
+                }
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, cannot check jitter candidates in parallel, falling back to serial checks: %s", GetEnv()->GetId()%ex.what());
+            _vjitterworkers.resize(0);
+            return false;
+        }
+        return true;
+    }
+
+    /// \brief runs in a jitter thread, checks every numthreads-th candidate of _vcandidatevalues starting at ithread
+    void _CheckCandidatesWorker(JitterWorkerPtr pworker, const std::vector<dReal>& perturbations, std::vector<int>& vresults, size_t ithread, size_t numthreads) const
+    {
+        size_t dof = _curdof.size();
+        EnvironmentMutex::scoped_lock lock(pworker->_penv->GetMutex());
+        std::vector<dReal> vnewdof(dof);
+        for(size_t icandidate = ithread; icandidate < vresults.size(); icandidate += numthreads) {
+            std::copy(_vcandidatevalues.begin()+icandidate*dof, _vcandidatevalues.begin()+(icandidate+1)*dof, vnewdof.begin());
+            try {
+                vresults[icandidate] = _CheckPerturbations(pworker->_probot, pworker->_pmanip, pworker->_report, vnewdof, perturbations, pworker->_vtempdof);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_VERBOSE_FORMAT("env=%d, exception while checking jitter candidate: %s", pworker->_penv->GetId()%ex.what());
+                vresults[icandidate] = JCR_EnvCollision;
+            }
+        }
+    }
+
+    /// \brief checks the candidates gathered in _vcandidatevalues with the jitter workers and takes the valid one with the smallest jitter from _curdof.
+    ///
+    /// The taken candidate is checked again on _probot, which is left at its values. _vcandidatevalues is cleared.
+    /// \param[out] vnewdof the taken candidate
+    /// \param[out] vresults the JitterCheckResult of every candidate
+    /// \return true if a candidate was taken
+    bool _CheckCandidatesParallel(const std::vector<dReal>& perturbations, std::vector<dReal>& vnewdof, std::vector<int>& vresults)
+    {
+        size_t dof = _curdof.size();
+        size_t numcandidates = _vcandidatevalues.size()/dof;
+        vresults.resize(numcandidates);
+        size_t numthreads = min(_vjitterworkers.size(), numcandidates);
+        std::vector< boost::shared_ptr<boost::thread> > vthreads(numthreads);
+        for(size_t ithread = 0; ithread < numthreads; ++ithread) {
+            vthreads[ithread].reset(new boost::thread(boost::bind(&ConfigurationJitterer::_CheckCandidatesWorker, this, _vjitterworkers[ithread], boost::cref(perturbations), boost::ref(vresults), ithread, numthreads)));
+        }
+        FOREACH(itthread, vthreads) {
+            (*itthread)->join();
+        }
+
+        std::vector< std::pair<dReal, size_t> > vvalid; // (squared jitter, candidate index)
+        for(size_t icandidate = 0; icandidate < numcandidates; ++icandidate) {
+            if( vresults[icandidate] == JCR_Success ) {
+                dReal fdist2 = 0;
+                for(size_t idof = 0; idof < dof; ++idof) {
+                    dReal f = _vcandidatevalues[icandidate*dof+idof] - _curdof[idof];
+                    fdist2 += f*f;
+                }
+                vvalid.push_back(std::make_pair(fdist2, icandidate));
+            }
+        }
+        std::sort(vvalid.begin(), vvalid.end());
+
+        bool bSuccess = false;
+        vnewdof.resize(dof);
+        FOREACHC(itvalid, vvalid) {
+            std::copy(_vcandidatevalues.begin()+itvalid->second*dof, _vcandidatevalues.begin()+(itvalid->second+1)*dof, vnewdof.begin());
+            int result = _CheckPerturbations(_probot, _pmanip, _report, vnewdof, perturbations, _newdof2);
+            if( result == JCR_Success ) {
+                bSuccess = true;
+                break;
+            }
+            // the worker environment disagrees with this environment
+            RAVELOG_DEBUG_FORMAT("env=%d, jitter candidate %d passed in a worker but failed with %d", GetEnv()->GetId()%itvalid->second%result);
+            vresults[itvalid->second] = result;
+        }
+        RAVELOG_VERBOSE_FORMAT("env=%d, %d/%d jitter candidates are valid with %d threads", GetEnv()->GetId()%vvalid.size()%numcandidates%numthreads);
+        _vcandidatevalues.resize(0);
+        return bSuccess;
+    }
+
     /// \brief extracts all used bodies from the configurationspecification and computes AABBs, transforms, and limits for links
     void _InitRobotState()
     {
@@ -1103,6 +1308,12 @@ protected:
     bool _bSetResultOnRobot; ///< if true, will set the final result on the robot DOF values
     bool _busebiasing; ///< if true will bias the end effector along a certain direction using the jacobian and nullspace.
     bool _bResetIterationsOnSample; ///< if true, when Sample or SampleSequence is called, will reset the _nNumIterations to 0. O
+
+    // parallel checks
+    int _nParallelThreads; ///< if > 1, the jitter candidates are checked in rounds by this many threads, each with its own cloned environment
+    int _nParallelCandidates; ///< the number of candidates per round. 0 means twice _nParallelThreads.
+    std::vector<JitterWorkerPtr> _vjitterworkers;
+    std::vector<dReal> _vcandidatevalues; ///< the candidates of the current round stored contiguously
 };
 
 SpaceSamplerBasePtr CreateConfigurationJitterer(EnvironmentBasePtr penv, std::istream& sinput)
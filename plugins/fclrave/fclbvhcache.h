@@ -0,0 +1,342 @@
+// -*- coding: utf-8 -*-
+#ifndef OPENRAVE_FCL_BVHCACHE
+#define OPENRAVE_FCL_BVHCACHE
+
+#include "plugindefs.h"
+#include <openrave/utils.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#ifndef FCLRAVE_FCL_VERSION
+#define FCLRAVE_FCL_VERSION ""
+#endif
+
+namespace fclrave {
+
+#ifdef FCLRAVE_USE_BVH_DISK_CACHE
+
+/// \brief gives access to the private members of fcl::BVHModel holding a built tree
+///
+/// fcl has no API to restore a built tree. An explicit template instantiation is allowed to name private members, so it defines a friend function returning the member pointer.
+/// The tags declaring the friend functions are not templates, otherwise the friends would be non-template functions declared in a template (-Wnon-template-friend).
+/// CMake only defines FCLRAVE_USE_BVH_DISK_CACHE when these members exist in the installed fcl.
+template <typename Tag, typename Tag::type M>
+struct BVHModelPrivateMember
+{
+    friend typename Tag::type GetPrivateMember(Tag) {
+        return M;
+    }
+};
+
+/// \brief the tags of the private members of fcl::BVHModel<T>, specialized for every bounding volume type
+template <class T> struct BVHModelPrivateTags;
+
+#define FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(T, NAME) \
+    struct BVHModelBVs##NAME { typedef fcl::BVNode<T >* fcl::BVHModel<T >::* type; friend type GetPrivateMember(BVHModelBVs##NAME); }; \
+    struct BVHModelNumBVs##NAME { typedef int fcl::BVHModel<T >::* type; friend type GetPrivateMember(BVHModelNumBVs##NAME); }; \
+    struct BVHModelNumBVsAllocated##NAME { typedef int fcl::BVHModel<T >::* type; friend type GetPrivateMember(BVHModelNumBVsAllocated##NAME); }; \
+    struct BVHModelPrimitiveIndices##NAME { typedef unsigned int* fcl::BVHModel<T >::* type; friend type GetPrivateMember(BVHModelPrimitiveIndices##NAME); }; \
+    template <> struct BVHModelPrivateTags<T > { \
+        typedef BVHModelBVs##NAME BVs; \
+        typedef BVHModelNumBVs##NAME NumBVs; \
+        typedef BVHModelNumBVsAllocated##NAME NumBVsAllocated; \
+        typedef BVHModelPrimitiveIndices##NAME PrimitiveIndices; \
+    }; \
+    template struct BVHModelPrivateMember<BVHModelBVs##NAME, &fcl::BVHModel<T >::bvs>; \
+    template struct BVHModelPrivateMember<BVHModelNumBVs##NAME, &fcl::BVHModel<T >::num_bvs>; \
+    template struct BVHModelPrivateMember<BVHModelNumBVsAllocated##NAME, &fcl::BVHModel<T >::num_bvs_allocated>; \
+    template struct BVHModelPrivateMember<BVHModelPrimitiveIndices##NAME, &fcl::BVHModel<T >::primitive_indices>;
+
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::AABB, AABB)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::OBB, OBB)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::RSS, RSS)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::OBBRSS, OBBRSS)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::KDOP<16>, KDOP16)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::KDOP<18>, KDOP18)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::KDOP<24>, KDOP24)
+FCLRAVE_INSTANTIATE_BVHMODEL_PRIVATE_MEMBERS(fcl::kIOS, kIOS)
+
+#endif
+
+/// \brief on-disk cache of built fcl::BVHModel trees shared by all the processes, keyed on the BVH representation and the mesh data
+///
+/// A file holds the vertices, triangles, tree nodes and primitive indices of a model as flat arrays that are read back directly, so loading a mesh skips the tree construction.
+/// The file name is the md5 of the mesh data and the vertices and triangles of the file are compared with the mesh when loading, so a stale or colliding file only causes a rebuild.
+/// The files are only valid for the fcl build that wrote them, the header stores the fcl version and the sizes of the stored types.
+class BVHDiskCache
+{
+public:
+    /// \brief sets the directory of the cache files. The directory has to exist, empty disables the cache (the default)
+    ///
+    /// \param mintriangles meshes with fewer triangles are always built since building them is as fast as reading them
+    static bool SetDirectory(const std::string& directory, int mintriangles)
+    {
+#ifdef FCLRAVE_USE_BVH_DISK_CACHE
+        boost::mutex::scoped_lock lock(_GetMutex());
+        _GetDirectory() = directory;
+        _GetMinTriangles() = mintriangles;
+        return true;
+#else
+        if( directory.size() > 0 ) {
+            RAVELOG_WARN("the installed fcl does not support restoring BVH models, so the BVH cache is disabled\n");
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    static std::string GetDirectory()
+    {
+        boost::mutex::scoped_lock lock(_GetMutex());
+        return _GetDirectory();
+    }
+
+    /// \brief returns the cache file of a mesh, empty if the mesh should not be cached
+    static std::string GetFilename(const std::string& bvhrepresentation, const std::vector<fcl::Vec3f>& points, const std::vector<fcl::Triangle>& triangles)
+    {
+        std::string directory;
+        {
+            boost::mutex::scoped_lock lock(_GetMutex());
+            if( _GetDirectory().size() == 0 || (int)triangles.size() < _GetMinTriangles() ) {
+                return std::string();
+            }
+            directory = _GetDirectory();
+        }
+
+        // hash the values rather than the memory of fcl::Vec3f, which can have padding
+        std::string data;
+        data.reserve(points.size()*3*sizeof(fcl::FCL_REAL) + triangles.size()*3*sizeof(uint32_t));
+        FOREACHC(itpoint, points) {
+            for(int i = 0; i < 3; ++i) {
+                fcl::FCL_REAL f = (*itpoint)[i];
+                data.append(reinterpret_cast<const char*>(&f), sizeof(f));
+            }
+        }
+        FOREACHC(ittri, triangles) {
+            for(int i = 0; i < 3; ++i) {
+                uint32_t index = (*ittri)[i];
+                data.append(reinterpret_cast<const char*>(&index), sizeof(index));
+            }
+        }
+        return directory + "/" + bvhrepresentation + "_" + OpenRAVE::utils::GetMD5HashString(data) + ".fclbvh";
+    }
+
+    /// \brief loads the model of a mesh from its cache file, returns empty if the file does not exist or does not match
+    static std::shared_ptr<fcl::CollisionGeometry> Load(const std::string& filename, const std::string& bvhrepresentation, const std::vector<fcl::Vec3f>& points, const std::vector<fcl::Triangle>& triangles)
+    {
+#ifdef FCLRAVE_USE_BVH_DISK_CACHE
+        if( filename.size() > 0 ) {
+            if( bvhrepresentation == "AABB" ) {
+                return _Load<fcl::AABB>(filename, points, triangles);
+            } else if( bvhrepresentation == "OBB" ) {
+                return _Load<fcl::OBB>(filename, points, triangles);
+            } else if( bvhrepresentation == "RSS" ) {
+                return _Load<fcl::RSS>(filename, points, triangles);
+            } else if( bvhrepresentation == "OBBRSS" ) {
+                return _Load<fcl::OBBRSS>(filename, points, triangles);
+            } else if( bvhrepresentation == "kDOP16" ) {
+                return _Load< fcl::KDOP<16> >(filename, points, triangles);
+            } else if( bvhrepresentation == "kDOP18" ) {
+                return _Load< fcl::KDOP<18> >(filename, points, triangles);
+            } else if( bvhrepresentation == "kDOP24" ) {
+                return _Load< fcl::KDOP<24> >(filename, points, triangles);
+            } else if( bvhrepresentation == "kIOS" ) {
+                return _Load<fcl::kIOS>(filename, points, triangles);
+            }
+        }
+#endif
+        return std::shared_ptr<fcl::CollisionGeometry>();
+    }
+
+    /// \brief writes the model of a mesh to its cache file
+    static void Save(const std::string& filename, const std::string& bvhrepresentation, const fcl::CollisionGeometry& geom)
+    {
+#ifdef FCLRAVE_USE_BVH_DISK_CACHE
+        if( filename.size() > 0 ) {
+            if( bvhrepresentation == "AABB" ) {
+                _Save<fcl::AABB>(filename, geom);
+            } else if( bvhrepresentation == "OBB" ) {
+                _Save<fcl::OBB>(filename, geom);
+            } else if( bvhrepresentation == "RSS" ) {
+                _Save<fcl::RSS>(filename, geom);
+            } else if( bvhrepresentation == "OBBRSS" ) {
+                _Save<fcl::OBBRSS>(filename, geom);
+            } else if( bvhrepresentation == "kDOP16" ) {
+                _Save< fcl::KDOP<16> >(filename, geom);
+            } else if( bvhrepresentation == "kDOP18" ) {
+                _Save< fcl::KDOP<18> >(filename, geom);
+            } else if( bvhrepresentation == "kDOP24" ) {
+                _Save< fcl::KDOP<24> >(filename, geom);
+            } else if( bvhrepresentation == "kIOS" ) {
+                _Save<fcl::kIOS>(filename, geom);
+            }
+        }
+#endif
+    }
+
+private:
+    struct FileHeader
+    {
+        char magic[8];
+        char fclversion[16];
+        uint32_t bvnodesize, vec3fsize, trianglesize;
+        int32_t numvertices, numtris, numbvs;
+    };
+
+    static boost::mutex& _GetMutex()
+    {
+        static boost::mutex mutex;
+        return mutex;
+    }
+
+    static std::string& _GetDirectory()
+    {
+        static std::string directory;
+        return directory;
+    }
+
+    static int& _GetMinTriangles()
+    {
+        static int mintriangles = 0;
+        return mintriangles;
+    }
+
+#ifdef FCLRAVE_USE_BVH_DISK_CACHE
+    template <class T>
+    static void _InitHeader(FileHeader& header)
+    {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "FCLBVH01", 8);
+        std::strncpy(header.fclversion, FCLRAVE_FCL_VERSION, sizeof(header.fclversion)-1);
+        header.bvnodesize = sizeof(fcl::BVNode<T>);
+        header.vec3fsize = sizeof(fcl::Vec3f);
+        header.trianglesize = sizeof(fcl::Triangle);
+    }
+
+    template <class T>
+    static std::shared_ptr<fcl::CollisionGeometry> _Load(const std::string& filename, const std::vector<fcl::Vec3f>& points, const std::vector<fcl::Triangle>& triangles)
+    {
+        std::ifstream f(filename.c_str(), std::ios::in|std::ios::binary);
+        if( !f ) {
+            return std::shared_ptr<fcl::CollisionGeometry>();
+        }
+        FileHeader header, expectedheader;
+        _InitHeader<T>(expectedheader);
+        f.read(reinterpret_cast<char*>(&header), sizeof(header));
+        const int numvertices = points.size(), numtris = triangles.size(), numbvsallocated = 2*numtris-1;
+        if( !f || std::memcmp(header.magic, expectedheader.magic, sizeof(header.magic)) != 0 || std::memcmp(header.fclversion, expectedheader.fclversion, sizeof(header.fclversion)) != 0
+            || header.bvnodesize != expectedheader.bvnodesize || header.vec3fsize != expectedheader.vec3fsize || header.trianglesize != expectedheader.trianglesize
+            || header.numvertices != numvertices || header.numtris != numtris || header.numbvs <= 0 || header.numbvs > numbvsallocated ) {
+            RAVELOG_DEBUG_FORMAT("BVH cache file %s does not match, rebuilding", filename);
+            return std::shared_ptr<fcl::CollisionGeometry>();
+        }
+
+        std::shared_ptr< fcl::BVHModel<T> > model = std::make_shared< fcl::BVHModel<T> >();
+        model->beginModel(numtris, numvertices);
+        f.read(reinterpret_cast<char*>(model->vertices), sizeof(fcl::Vec3f)*numvertices);
+        f.read(reinterpret_cast<char*>(model->tri_indices), sizeof(fcl::Triangle)*numtris);
+        if( !f ) {
+            return std::shared_ptr<fcl::CollisionGeometry>();
+        }
+        for(int ipoint = 0; ipoint < numvertices; ++ipoint) {
+            if( model->vertices[ipoint][0] != points[ipoint][0] || model->vertices[ipoint][1] != points[ipoint][1] || model->vertices[ipoint][2] != points[ipoint][2] ) {
+                RAVELOG_DEBUG_FORMAT("BVH cache file %s is for a different mesh, rebuilding", filename);
+                return std::shared_ptr<fcl::CollisionGeometry>();
+            }
+        }
+        for(int itri = 0; itri < numtris; ++itri) {
+            if( model->tri_indices[itri][0] != triangles[itri][0] || model->tri_indices[itri][1] != triangles[itri][1] || model->tri_indices[itri][2] != triangles[itri][2] ) {
+                RAVELOG_DEBUG_FORMAT("BVH cache file %s is for a different mesh, rebuilding", filename);
+                return std::shared_ptr<fcl::CollisionGeometry>();
+            }
+        }
+
+        // allocate like fcl::BVHModel::endModel so that refitting and the destructor work as usual
+        fcl::BVNode<T>*& bvs = model.get()->*GetPrivateMember(typename BVHModelPrivateTags<T>::BVs());
+        unsigned int*& primitiveindices = model.get()->*GetPrivateMember(typename BVHModelPrivateTags<T>::PrimitiveIndices());
+        delete[] bvs;
+        delete[] primitiveindices;
+        bvs = new fcl::BVNode<T>[numbvsallocated];
+        primitiveindices = new unsigned int[numbvsallocated];
+        model.get()->*GetPrivateMember(typename BVHModelPrivateTags<T>::NumBVsAllocated()) = numbvsallocated;
+        f.read(reinterpret_cast<char*>(bvs), sizeof(fcl::BVNode<T>)*header.numbvs);
+        f.read(reinterpret_cast<char*>(primitiveindices), sizeof(unsigned int)*numtris);
+        if( !f ) {
+            return std::shared_ptr<fcl::CollisionGeometry>();
+        }
+        // a corrupted tree would make the queries read outside of the arrays, so check that the nodes and primitives are consistent
+        for(int ibv = 0; ibv < header.numbvs; ++ibv) {
+            const fcl::BVNode<T>& node = bvs[ibv];
+            bool bvalid;
+            if( node.first_child >= 0 ) {
+                // fcl allocates the two children of a node after it
+                bvalid = node.first_child > ibv && node.first_child+1 < header.numbvs;
+            }
+            else {
+                bvalid = node.first_primitive >= 0 && node.num_primitives > 0 && node.first_primitive+node.num_primitives <= numtris;
+            }
+            if( !bvalid ) {
+                RAVELOG_DEBUG_FORMAT("BVH cache file %s has an invalid node %d, rebuilding", filename%ibv);
+                return std::shared_ptr<fcl::CollisionGeometry>();
+            }
+        }
+        for(int itri = 0; itri < numtris; ++itri) {
+            if( primitiveindices[itri] >= (unsigned int)numtris ) {
+                RAVELOG_DEBUG_FORMAT("BVH cache file %s has an invalid primitive index, rebuilding", filename);
+                return std::shared_ptr<fcl::CollisionGeometry>();
+            }
+        }
+        model->num_vertices = numvertices;
+        model->num_tris = numtris;
+        model.get()->*GetPrivateMember(typename BVHModelPrivateTags<T>::NumBVs()) = header.numbvs;
+        model->build_state = fcl::BVH_BUILD_STATE_PROCESSED;
+        model->computeLocalAABB();
+        return model;
+    }
+
+    template <class T>
+    static void _Save(const std::string& filename, const fcl::CollisionGeometry& geom)
+    {
+        const fcl::BVHModel<T>* pmodel = dynamic_cast<const fcl::BVHModel<T>*>(&geom);
+        if( !pmodel || pmodel->build_state != fcl::BVH_BUILD_STATE_PROCESSED || pmodel->getNumBVs() <= 0 ) {
+            return;
+        }
+        FileHeader header;
+        _InitHeader<T>(header);
+        header.numvertices = pmodel->num_vertices;
+        header.numtris = pmodel->num_tris;
+        header.numbvs = pmodel->getNumBVs();
+        const unsigned int* primitiveindices = pmodel->*GetPrivateMember(typename BVHModelPrivateTags<T>::PrimitiveIndices());
+
+        // write to a temporary file first so that other processes never read a partial file
+        std::string tempfilename = filename + "." + boost::lexical_cast<std::string>(OpenRAVE::utils::GetNanoTime()) + ".tmp";
+        {
+            std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+            if( !f ) {
+                RAVELOG_DEBUG_FORMAT("failed to write BVH cache file %s", tempfilename);
+                return;
+            }
+            f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            f.write(reinterpret_cast<const char*>(pmodel->vertices), sizeof(fcl::Vec3f)*header.numvertices);
+            f.write(reinterpret_cast<const char*>(pmodel->tri_indices), sizeof(fcl::Triangle)*header.numtris);
+            f.write(reinterpret_cast<const char*>(&pmodel->getBV(0)), sizeof(fcl::BVNode<T>)*header.numbvs);
+            f.write(reinterpret_cast<const char*>(primitiveindices), sizeof(unsigned int)*header.numtris);
+            if( !f ) {
+                f.close();
+                std::remove(tempfilename.c_str());
+                return;
+            }
+        }
+        if( std::rename(tempfilename.c_str(), filename.c_str()) != 0 ) {
+            std::remove(tempfilename.c_str());
+        }
+    }
+#endif
+};
+
+} // fclrave
+
+#endif
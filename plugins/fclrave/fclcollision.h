@@ -2,15 +2,19 @@
 #ifndef OPENRAVE_FCL_COLLISION
 #define OPENRAVE_FCL_COLLISION
 
+#include <unordered_map>
+#include <atomic>
 #include <boost/unordered_set.hpp>
 #include <boost/lexical_cast.hpp>
 #include <openrave/utils.h>
+#include <openrave/planningutils.h>
 #include <boost/function_output_iterator.hpp>
 
 #include "fclspace.h"
 #include "fclmanagercache.h"
 
 #include "fclstatistics.h"
+#include "batchworkerpool.h"
 
 #define FCLRAVE_CHECKPARENTLESS
 
@@ -45,6 +49,17 @@ struct hash<fclrave::CollisionPair>
 namespace fclrave {
 
 typedef std::unordered_map<CollisionPair, fcl::Vec3f> NarrowCollisionCache;
+
+/// \brief the distance between a pair of primitive geometries when they were last found to be separated
+struct NarrowSeparation
+{
+    NarrowSeparation() : distance(0) {
+    }
+    std::weak_ptr<const fcl::CollisionGeometry> pgeom1, pgeom2; ///< the geometries of the pair, in the order of the CollisionPair
+    fcl::Transform3f t1, t2; ///< the transforms of the geometries when distance was computed
+    fcl::FCL_REAL distance; ///< lower bound of the distance between the geometries at t1 and t2
+};
+typedef std::unordered_map<CollisionPair, NarrowSeparation> NarrowSeparationCache;
 #endif // NARROW_COLLISION_CACHING
 
 typedef FCLSpace::KinBodyInfoConstPtr KinBodyInfoConstPtr;
@@ -63,6 +78,7 @@ public:
 public:
         CollisionCallbackData(boost::shared_ptr<FCLCollisionChecker> pchecker, CollisionReportPtr report, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<LinkConstPtr>& vlinkexcluded) : _pchecker(pchecker), _report(report), _vbodyexcluded(vbodyexcluded), _vlinkexcluded(vlinkexcluded), bselfCollision(false), _bStopChecking(false), _bCollision(false)
         {
+            _pchecker->_pcounterqueries->Add();
             _bHasCallbacks = _pchecker->GetEnv()->HasRegisteredCollisionCallbacks();
             if( _bHasCallbacks && !_report ) {
                 _report.reset(new CollisionReport());
@@ -123,13 +139,34 @@ public:
         // TODO : Should we put a more reasonable arbitrary value ?
         _numMaxContacts = std::numeric_limits<int>::max();
         _nGetEnvManagerCacheClearCount = 100000;
+        _nBatchThreads = 1;
+        _nSelfCollisionThreads = 1;
+        _nSelfCollisionMinLinks = 32;
+        _nContinuousMaxIterations = 10;
+        _nStaticDistanceFieldStamp = -1;
+        _bStaticDistanceFieldPendingStamp = false;
+        _trackedCollisionRequest.gjk_solver_type = fcl::GST_INDEP;
+        _trackedDistanceRequest.gjk_solver_type = fcl::GST_LIBCCD;
         __description = ":Interface Author: Kenji Maillard\n\nFlexible Collision Library collision checker";
 
         SETUP_STATISTICS(_statistics, _userdatakey, GetEnv()->GetId());
 
+        _pcounterqueries = RegisterPerfCounter("collision.queries");
+        _pcounternarrowphase = RegisterPerfCounter("collision.narrowphase");
+
         // TODO : Consider removing these which could be more harmful than anything else
-        RegisterCommand("SetBroadphaseAlgorithm", boost::bind(&FCLCollisionChecker::SetBroadphaseAlgorithmCommand, this, _1, _2), "sets the broadphase algorithm (Naive, SaP, SSaP, IntervalTree, DynamicAABBTree, DynamicAABBTree_Array)");
+        RegisterCommand("SetBroadphaseAlgorithm", boost::bind(&FCLCollisionChecker::SetBroadphaseAlgorithmCommand, this, _1, _2), "sets the broadphase algorithm (Naive, SaP, SSaP, IntervalTree, DynamicAABBTree, DynamicAABBTree_Array, or Auto to choose one per manager by timing the queries)");
         RegisterCommand("SetBVHRepresentation", boost::bind(&FCLCollisionChecker::_SetBVHRepresentation, this, _1, _2), "sets the Bouding Volume Hierarchy representation for meshes (AABB, OBB, OBBRSS, RSS, kIDS)");
+        RegisterCommand("SetNumBatchThreads", boost::bind(&FCLCollisionChecker::SetNumBatchThreadsCommand, this, _1, _2), "sets the number of threads used by CheckCollisionConfigurations (1 checks on the calling thread)");
+        RegisterCommand("SetParallelSelfCollision", boost::bind(&FCLCollisionChecker::SetParallelSelfCollisionCommand, this, _1, _2), "numthreads [minlinks]. Sets the number of threads CheckStandaloneSelfCollision splits the link pairs of a body across when the body has at least minlinks links (1 checks on the calling thread)");
+        RegisterCommand("SetBVHCacheDirectory", boost::bind(&FCLCollisionChecker::SetBVHCacheDirectoryCommand, this, _1, _2), "sets the directory where the BVHs of the meshes are stored on disk and shared with other processes, and optionally the minimum number of triangles of the cached meshes (empty disables the cache)");
+        RegisterCommand("SetContinuousMaxIterations", boost::bind(&FCLCollisionChecker::SetContinuousMaxIterationsCommand, this, _1, _2), "sets the maximum number of iterations of the continuous collision solvers used by CheckContinuousCollision");
+        RegisterCommand("SetStaticBodies", boost::bind(&FCLCollisionChecker::SetStaticBodiesCommand, this, _1, _2), "sets the names of the bodies that never move, like fixtures and walls. They are kept in a separate broadphase structure that is only rebuilt when one of them changes");
+        RegisterCommand("SetCoarseSpheres", boost::bind(&FCLCollisionChecker::SetCoarseSpheresCommand, this, _1, _2), "sets the maximum number of bounding spheres computed for every link (0 disables them). When enabled, the geometries of two links are only checked if some of their spheres overlap");
+        RegisterCommand("GetLinkPairDistances", boost::bind(&FCLCollisionChecker::GetLinkPairDistancesCommand, this, _1, _2), "margin. Returns one line of body1 link1 body2 link2 distance for every pair of links of the environment closer than margin, 0 returns the colliding pairs");
+        RegisterCommand("GetTrackedLinkPairDistances", boost::bind(&FCLCollisionChecker::GetTrackedLinkPairDistancesCommand, this, _1, _2), "body1 body2 [tolerance]. Returns one line of body1 link1 body2 link2 distance for every pair of enabled links of the two bodies. The distances of the geometries are kept between calls and only recomputed when the motion since their last computation can make them the closest pair, or can change the distance by more than tolerance");
+        RegisterCommand("ComputeStaticDistanceField", boost::bind(&FCLCollisionChecker::ComputeStaticDistanceFieldCommand, this, _1, _2), "resolution [padding [filename]]. Computes a signed distance field of the bodies set by SetStaticBodies. If filename is given, the field is read from it when it was computed from the same bodies with the same resolution, otherwise it is computed and written to it. While the static bodies do not change, CheckCollisionConfigurations only checks them exactly for configurations where a link sphere comes closer to them than the field error");
+        RegisterCommand("GetStaticDistances", boost::bind(&FCLCollisionChecker::GetStaticDistancesCommand, this, _1, _2), "x y z ... Looks up the points in the field of ComputeStaticDistanceField and returns one line of distance and gradient for every point");
 
         RAVELOG_VERBOSE_FORMAT("FCLCollisionChecker %s created in env %d", _userdatakey%penv->GetId());
 
@@ -179,6 +216,16 @@ public:
         // We don't want to clone _bIsSelfCollisionChecker since a self collision checker can be created by cloning a environment collision checker
         _options = r->_options;
         _numMaxContacts = r->_numMaxContacts;
+        _nBatchThreads = r->_nBatchThreads;
+        _nSelfCollisionThreads = r->_nSelfCollisionThreads;
+        _nSelfCollisionMinLinks = r->_nSelfCollisionMinLinks;
+        _nContinuousMaxIterations = r->_nContinuousMaxIterations;
+        _fclspace->SetStaticBodyNames(r->_fclspace->GetStaticBodyNames());
+        _fclspace->SetCoarseMaxSpheres(r->_fclspace->GetCoarseMaxSpheres());
+        _pstaticdistancefield = r->_pstaticdistancefield;
+        // the cloned static bodies are where the field was computed as long as they did not move in the reference, the stamp is taken at the first batch
+        _nStaticDistanceFieldStamp = -1;
+        _bStaticDistanceFieldPendingStamp = !!r->_pstaticdistancefield && r->_nStaticDistanceFieldStamp == r->_fclspace->GetStaticBodiesUpdateStamp();
         RAVELOG_VERBOSE(str(boost::format("FCL User data cloning env %d into env %d") % r->GetEnv()->GetId() % GetEnv()->GetId()));
     }
 
@@ -233,6 +280,7 @@ public:
 
     /// Sets the broadphase algorithm for collision checking
     /// The input algorithm can be one of : Naive, SaP, SSaP, IntervalTree, DynamicAABBTree{,1,2,3}, DynamicAABBTree_Array{,1,2,3}, SpatialHashing
+    /// Auto makes every manager time its queries with SaP, IntervalTree, DynamicAABBTree2 and DynamicAABBTree2_Array and keep the fastest, see FCLCollisionManagerInstance::StartBroadphaseTuning
     /// e.g. "SetBroadPhaseAlgorithm DynamicAABBTree"
     bool SetBroadphaseAlgorithmCommand(ostream& sout, istream& sinput)
     {
@@ -337,6 +385,7 @@ public:
     {
         RAVELOG_VERBOSE(str(boost::format("FCL User data destroying %s in env %d") % _userdatakey % GetEnv()->GetId()));
         _fclspace->DestroyEnvironment();
+        _mapTrackedLinkPairs.clear();
     }
 
     virtual bool InitKinBody(OpenRAVE::KinBodyPtr pbody)
@@ -358,6 +407,16 @@ public:
             itmanager->second->RemoveBody(*pbody);
         }
         _fclspace->RemoveUserData(pbody);
+        int envid = pbody->GetEnvironmentId();
+        std::map<std::pair<int, int>, std::vector<TrackedLinkPair> >::iterator ittracked = _mapTrackedLinkPairs.begin();
+        while( ittracked != _mapTrackedLinkPairs.end() ) {
+            if( ittracked->first.first == envid || ittracked->first.second == envid ) {
+                _mapTrackedLinkPairs.erase(ittracked++);
+            }
+            else {
+                ++ittracked;
+            }
+        }
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, CollisionReportPtr report = CollisionReportPtr())
@@ -407,7 +466,9 @@ public:
             body1Manager.GetManager()->distance(body2Manager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseDistance);
         }
         ADD_TIMING(_statistics);
+        uint64_t starttime = _StartBroadphaseTiming(body1Manager);
         body1Manager.GetManager()->collide(body2Manager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        _StopBroadphaseTiming(body1Manager, starttime);
         return query._bCollision;
     }
 
@@ -519,7 +580,9 @@ public:
 #ifdef FCLRAVE_CHECKPARENTLESS
         boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceBL, this, boost::ref(*pbody), boost::ref(bodyManager), boost::ref(*plink)));
 #endif
+        uint64_t starttime = _StartBroadphaseTiming(bodyManager);
         bodyManager.GetManager()->collide(pcollLink.get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        _StopBroadphaseTiming(bodyManager, starttime);
         return query._bCollision;
     }
 
@@ -550,12 +613,20 @@ public:
                 throw openrave_exception("FCLCollision - ERROR: YOU MUST PASS IN A CollisionReport STRUCT TO MEASURE DISTANCE!\n");
             }
             envManager.GetManager()->distance(pcollLink.get(), &query, &FCLCollisionChecker::CheckNarrowPhaseDistance);
+            if( !!envManager.GetStaticManager() ) {
+                envManager.GetStaticManager()->distance(pcollLink.get(), &query, &FCLCollisionChecker::CheckNarrowPhaseDistance);
+            }
         }
         ADD_TIMING(_statistics);
 #ifdef FCLRAVE_CHECKPARENTLESS
         boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceLE, this, boost::ref(*plink), boost::ref(envManager)));
 #endif
+        uint64_t starttime = _StartBroadphaseTiming(envManager);
         envManager.GetManager()->collide(pcollLink.get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        if( !query._bStopChecking && !!envManager.GetStaticManager() ) {
+            envManager.GetStaticManager()->collide(pcollLink.get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        }
+        _StopBroadphaseTiming(envManager, starttime);
         return query._bCollision;
     }
 
@@ -582,12 +653,20 @@ public:
                 throw openrave_exception("FCLCollision - ERROR: YOU MUST PASS IN A CollisionReport STRUCT TO MEASURE DISTANCE!\n");
             }
             envManager.GetManager()->distance(bodyManager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseDistance);
+            if( !!envManager.GetStaticManager() ) {
+                envManager.GetStaticManager()->distance(bodyManager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseDistance);
+            }
         }
         ADD_TIMING(_statistics);
 #ifdef FCLRAVE_CHECKPARENTLESS
         boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceBE, this, boost::ref(*pbody), boost::ref(bodyManager), boost::ref(envManager)));
 #endif
+        uint64_t starttime = _StartBroadphaseTiming(envManager);
         envManager.GetManager()->collide(bodyManager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        if( !query._bStopChecking && !!envManager.GetStaticManager() ) {
+            envManager.GetStaticManager()->collide(bodyManager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        }
+        _StopBroadphaseTiming(envManager, starttime);
 
         return query._bCollision;
     }
@@ -610,6 +689,19 @@ public:
         return false; //TODO
     }
 
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, KinBodyConstPtr pbody, std::vector<OpenRAVE::dReal>& vhitdistances, std::vector<Vector>& vhitnormals, std::vector<int>& vhitbodyids) override
+    {
+        // warn once instead of once per ray
+        RAVELOG_WARN("fcl doesn't support Ray collisions\n");
+        vhitdistances.resize(0);
+        vhitdistances.resize(vrays.size(), -1);
+        vhitnormals.resize(0);
+        vhitnormals.resize(vrays.size(), Vector());
+        vhitbodyids.resize(0);
+        vhitbodyids.resize(vrays.size(), 0);
+        return 0;
+    }
+
     virtual bool CheckCollision(const OpenRAVE::TriMesh& trimesh, KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) override
     {
         if( !!report ) {
@@ -698,6 +790,9 @@ public:
         //boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceB, this, boost::ref(*pbody), boost::ref(bodyManager)));
 #endif
         envManager.GetManager()->collide(&ctriobj, &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        if( !query._bStopChecking && !!envManager.GetStaticManager() ) {
+            envManager.GetStaticManager()->collide(&ctriobj, &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        }
         return query._bCollision;
     }
     
@@ -731,6 +826,9 @@ public:
         //boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceB, this, boost::ref(*pbody), boost::ref(envManager)));
 #endif
         envManager.GetManager()->collide(&cboxobj, &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        if( !query._bStopChecking && !!envManager.GetStaticManager() ) {
+            envManager.GetStaticManager()->collide(&cboxobj, &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        }
         return query._bCollision;
     }
 
@@ -769,6 +867,9 @@ public:
         //boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceB, this, boost::ref(*pbody), boost::ref(envManager)));
 #endif
         envManager.GetManager()->collide(&cboxobj, &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        if( !query._bStopChecking && !!envManager.GetStaticManager() ) {
+            envManager.GetStaticManager()->collide(&cboxobj, &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+        }
         return query._bCollision;
     }
     
@@ -802,6 +903,9 @@ public:
         boost::shared_ptr<void> onexit((void*) 0, boost::bind(&FCLCollisionChecker::_PrintCollisionManagerInstanceSelf, this, boost::ref(*pbody)));
 #endif            
         KinBodyInfoPtr pinfo = _fclspace->GetInfo(*pbody);
+        if( _nSelfCollisionThreads > 1 && pbody->GetLinks().size() >= _nSelfCollisionMinLinks && !(_options & (OpenRAVE::CO_Distance|OpenRAVE::CO_AllLinkCollisions)) && !GetEnv()->HasRegisteredCollisionCallbacks() ) {
+            return _CheckStandaloneSelfCollisionParallel(*pinfo, nonadjacent, query);
+        }
         FOREACH(itset, nonadjacent) {
             size_t index1 = *itset&0xffff, index2 = *itset>>16;
             // We don't need to check if the links are enabled since we got adjacency information with AO_Enabled
@@ -810,6 +914,9 @@ public:
             if( !pLINK1.linkBV.second->getAABB().overlap(pLINK2.linkBV.second->getAABB()) ) {
                 continue;
             }
+            if( !(_options & OpenRAVE::CO_Distance) && _AreCoarseSpheresSeparated(pLINK1, pLINK2) ) {
+                continue;
+            }
             FOREACH(itgeom1, pLINK1.vgeoms) {
                 FOREACH(itgeom2, pLINK2.vgeoms) {
                     if ( _options & OpenRAVE::CO_Distance ) {
@@ -868,6 +975,9 @@ public:
                 if( !pLINK1.linkBV.second->getAABB().overlap(pLINK2.linkBV.second->getAABB()) ) {
                     continue;
                 }
+                if( !(_options & OpenRAVE::CO_Distance) && _AreCoarseSpheresSeparated(pLINK1, pLINK2) ) {
+                    continue;
+                }
                 FOREACH(itgeom1, pLINK1.vgeoms) {
                     FOREACH(itgeom2, pLINK2.vgeoms) {
                         if ( _options & OpenRAVE::CO_Distance ) {
@@ -891,8 +1001,1013 @@ public:
         return query._bCollision;
     }
 
+    virtual int CheckCollisionConfigurations(KinBodyPtr pbody, const std::vector<int>& vdofindices, const std::vector<OpenRAVE::dReal>& vconfigurations, std::vector<uint8_t>& vcollisions, bool bCheckSelfCollision=true)
+    {
+        START_TIMING_OPT(_statistics, "BodyConfigurations",_options,pbody->IsRobot());
+        const size_t dof = vdofindices.size() > 0 ? vdofindices.size() : (size_t)pbody->GetDOF();
+        vcollisions.resize(0);
+        if( dof == 0 ) {
+            return 0;
+        }
+        OPENRAVE_ASSERT_OP(vconfigurations.size()%dof, ==, 0);
+        const size_t numconfigurations = vconfigurations.size()/dof;
+        vcollisions.resize(numconfigurations, 0);
+        if( (pbody->GetLinks().size() == 0) || !_IsEnabled(*pbody) ) {
+            return 0;
+        }
+        if( _options & OpenRAVE::CO_Distance ) {
+            // distance queries need a report per configuration
+            return CollisionCheckerBase::CheckCollisionConfigurations(pbody, vdofindices, vconfigurations, vcollisions, bCheckSelfCollision);
+        }
+
+        KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+
+        // only the links moved by the dofs need to be updated between the samples
+        _vCachedMovedLinkIndices.resize(0);
+        FOREACHC(itlink, pbody->GetLinks()) {
+            for(size_t idof = 0; idof < dof; ++idof) {
+                if( pbody->DoesDOFAffectLink(vdofindices.size() > 0 ? vdofindices[idof] : (int)idof, (*itlink)->GetIndex()) ) {
+                    _vCachedMovedLinkIndices.push_back((*itlink)->GetIndex());
+                    break;
+                }
+            }
+        }
+
+        _fclspace->Synchronize();
+        std::set<KinBodyConstPtr> attachedBodies;
+        pbody->GetAttached(attachedBodies);
+        std::vector<KinBodyConstPtr> vbodies;
+        vbodies.push_back(pbody);
+        FOREACHC(itbody, attachedBodies) {
+            if( itbody->get() != pbody.get() && (*itbody)->GetEnvironmentId() ) {
+                vbodies.push_back(*itbody);
+            }
+        }
+        // configurations whose spheres are all away from the static bodies do not need the exact check against them
+        std::vector<StaticFieldSphere> vfieldspheres;
+        const bool bUseStaticField = _InitStaticFieldSpheres(vbodies, vfieldspheres);
+        // the parallel workers only handle plain collision queries, anything needing the environment callbacks or the active dof subset stays on this thread
+        if( _nBatchThreads > 1 && numconfigurations >= 2*(size_t)_nBatchThreads && !(_options & OpenRAVE::CO_ActiveDOFs) && !GetEnv()->HasRegisteredCollisionCallbacks() ) {
+            return _CheckCollisionConfigurationsParallel(pbody, attachedBodies, vbodies, bUseStaticField ? &vfieldspheres : NULL, vdofindices, vconfigurations, dof, vcollisions, bCheckSelfCollision);
+        }
+        FCLCollisionManagerInstance& bodyManager = _GetBodyManager(pbody, !!(_options & OpenRAVE::CO_ActiveDOFs));
+        FCLCollisionManagerInstance& envManager = _GetEnvManager(attachedBodies);
+
+        const std::vector<KinBodyConstPtr> vbodyexcluded;
+        const std::vector<LinkConstPtr> vlinkexcluded;
+        std::vector<OpenRAVE::dReal> vvalues(dof);
+        std::vector<Transform> vlinktransforms, vtrans;
+        int numcollisions = 0;
+        ADD_TIMING(_statistics);
+        for(size_t iconfig = 0; iconfig < numconfigurations; ++iconfig) {
+            std::copy(vconfigurations.begin()+iconfig*dof, vconfigurations.begin()+(iconfig+1)*dof, vvalues.begin());
+            pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing, vdofindices);
+
+            _fclspace->SynchronizeLinks(*pbody, _vCachedMovedLinkIndices);
+            FOREACHC(itbody, attachedBodies) {
+                if( itbody->get() != pbody.get() && (*itbody)->GetEnvironmentId() ) {
+                    _fclspace->Synchronize(**itbody);
+                }
+            }
+            bodyManager.SynchronizeLinks(*pbody, _vCachedMovedLinkIndices);
+
+            CollisionCallbackData query(shared_checker(), CollisionReportPtr(), vbodyexcluded, vlinkexcluded);
+            envManager.GetManager()->collide(bodyManager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+            if( !query._bStopChecking && !!envManager.GetStaticManager() ) {
+                bool bStaticFree = false;
+                if( bUseStaticField ) {
+                    vlinktransforms.resize(0);
+                    FOREACHC(itbody, vbodies) {
+                        (*itbody)->GetLinkTransformations(vtrans);
+                        vlinktransforms.insert(vlinktransforms.end(), vtrans.begin(), vtrans.end());
+                    }
+                    bStaticFree = _IsFreeInStaticField(*_pstaticdistancefield, vfieldspheres, vlinktransforms.begin());
+                }
+                if( !bStaticFree ) {
+                    envManager.GetStaticManager()->collide(bodyManager.GetManager().get(), &query, &FCLCollisionChecker::CheckNarrowPhaseCollision);
+                }
+            }
+            bool bCollision = query._bCollision;
+            if( !bCollision && bCheckSelfCollision ) {
+                // KinBody::CheckSelfCollision also checks the grabbed bodies
+                bCollision = pbody->CheckSelfCollision(CollisionReportPtr(), shared_checker());
+            }
+            if( bCollision ) {
+                vcollisions[iconfig] = 1;
+                ++numcollisions;
+            }
+        }
+        return numcollisions;
+    }
+
+
+    /// Sets the number of threads CheckCollisionConfigurations splits a batch across, 1 or less keeps everything on the calling thread
+    /// e.g. "SetNumBatchThreads 4"
+    bool SetNumBatchThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int nthreads = 1;
+        sinput >> nthreads;
+        if( !sinput ) {
+            return false;
+        }
+        _nBatchThreads = nthreads;
+        return true;
+    }
+
+    int GetNumBatchThreads() const {
+        return _nBatchThreads;
+    }
+
+    /// Sets the threads of the self collision checks of bodies with many links, 1 or less keeps everything on the calling thread
+    /// e.g. "SetParallelSelfCollision 4 64"
+    bool SetParallelSelfCollisionCommand(ostream& sout, istream& sinput)
+    {
+        int nthreads = 1;
+        sinput >> nthreads;
+        if( !sinput ) {
+            return false;
+        }
+        size_t minlinks = _nSelfCollisionMinLinks;
+        sinput >> minlinks;
+        _nSelfCollisionThreads = nthreads;
+        _nSelfCollisionMinLinks = minlinks;
+        return true;
+    }
+
+    /// Sets the directory of the BVH disk cache of every FCL collision checker of the process, the directory has to exist
+    /// e.g. "SetBVHCacheDirectory /tmp/fclbvhcache 1000"
+    bool SetBVHCacheDirectoryCommand(ostream& sout, istream& sinput)
+    {
+        std::string directory;
+        int mintriangles = 1000;
+        sinput >> directory;
+        if( !!sinput ) {
+            sinput >> mintriangles;
+        }
+        return BVHDiskCache::SetDirectory(directory, mintriangles);
+    }
+
+    /// Sets the maximum number of iterations the fcl continuous collision solvers take per pair of geometries
+    /// e.g. "SetContinuousMaxIterations 20"
+    bool SetContinuousMaxIterationsCommand(ostream& sout, istream& sinput)
+    {
+        int niterations = 10;
+        sinput >> niterations;
+        if( !sinput || niterations <= 0 ) {
+            return false;
+        }
+        _nContinuousMaxIterations = niterations;
+        return true;
+    }
+
+    /// Sets the names of the bodies that never move, replacing the previous ones
+    /// e.g. "SetStaticBodies shelf wall1 wall2"
+    bool SetStaticBodiesCommand(ostream& sout, istream& sinput)
+    {
+        std::set<std::string> names;
+        std::string name;
+        while( sinput >> name ) {
+            names.insert(name);
+        }
+        _fclspace->SetStaticBodyNames(names);
+        return true;
+    }
+
+    bool SetCoarseSpheresCommand(ostream& sout, istream& sinput)
+    {
+        int nMaxSpheres = 0;
+        sinput >> nMaxSpheres;
+        if( !sinput ) {
+            return false;
+        }
+        _fclspace->SetCoarseMaxSpheres(nMaxSpheres);
+        return true;
+    }
+
+    bool GetLinkPairDistancesCommand(ostream& sout, istream& sinput)
+    {
+        OpenRAVE::dReal fmargin = 0;
+        sinput >> fmargin;
+        if( !sinput ) {
+            return false;
+        }
+        std::vector<LinkPairDistance> vlinkpairs;
+        GetLinkPairDistances(fmargin, vlinkpairs);
+        sout << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+        FOREACHC(itpair, vlinkpairs) {
+            sout << itpair->plink1->GetParent()->GetName() << " " << itpair->plink1->GetName() << " " << itpair->plink2->GetParent()->GetName() << " " << itpair->plink2->GetName() << " " << itpair->fDistance << endl;
+        }
+        return true;
+    }
+
+    bool GetTrackedLinkPairDistancesCommand(ostream& sout, istream& sinput)
+    {
+        std::string bodyname1, bodyname2;
+        OpenRAVE::dReal ftolerance = 0;
+        sinput >> bodyname1 >> bodyname2;
+        if( !sinput ) {
+            return false;
+        }
+        sinput >> ftolerance;
+        KinBodyPtr pbody1 = GetEnv()->GetKinBody(bodyname1), pbody2 = GetEnv()->GetKinBody(bodyname2);
+        if( !pbody1 || !pbody2 ) {
+            RAVELOG_WARN_FORMAT("env=%d, GetTrackedLinkPairDistances could not find bodies %s and %s", GetEnv()->GetId()%bodyname1%bodyname2);
+            return false;
+        }
+        std::vector<LinkPairDistance> vlinkpairs;
+        GetTrackedLinkPairDistances(pbody1, pbody2, ftolerance, vlinkpairs);
+        sout << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+        FOREACHC(itpair, vlinkpairs) {
+            sout << itpair->plink1->GetParent()->GetName() << " " << itpair->plink1->GetName() << " " << itpair->plink2->GetParent()->GetName() << " " << itpair->plink2->GetName() << " " << itpair->fDistance << endl;
+        }
+        return true;
+    }
+
+    bool ComputeStaticDistanceFieldCommand(ostream& sout, istream& sinput)
+    {
+        OpenRAVE::dReal fResolution = 0, fPadding = 0;
+        std::string filename;
+        sinput >> fResolution;
+        if( !sinput || fResolution <= 0 ) {
+            RAVELOG_WARN("ComputeStaticDistanceField needs a positive resolution\n");
+            return false;
+        }
+        sinput >> fPadding >> filename;
+
+        const std::set<std::string>& setnames = _fclspace->GetStaticBodyNames();
+        std::vector<KinBodyConstPtr> vbodies;
+        FOREACHC(itname, setnames) {
+            KinBodyPtr pbody = GetEnv()->GetKinBody(*itname);
+            if( !!pbody ) {
+                vbodies.push_back(pbody);
+            }
+        }
+
+        // the field is only used by CheckCollisionConfigurations while the static bodies stay as they are now
+        _fclspace->Synchronize();
+        _nStaticDistanceFieldStamp = _fclspace->GetStaticBodiesUpdateStamp();
+        _bStaticDistanceFieldPendingStamp = false;
+
+        OpenRAVE::planningutils::SignedDistanceFieldPtr pfield(new OpenRAVE::planningutils::SignedDistanceField());
+        if( filename.size() > 0 && pfield->Load(filename) ) {
+            std::set<std::string> setloadednames(pfield->GetBodyNames().begin(), pfield->GetBodyNames().end());
+            std::set<std::string> setbodynames;
+            FOREACHC(itbody, vbodies) {
+                setbodynames.insert((*itbody)->GetName());
+            }
+            if( setloadednames == setbodynames && RaveFabs(pfield->GetResolution()-fResolution) <= 1e-6*fResolution ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, loaded distance field from %s", GetEnv()->GetId()%filename);
+                _pstaticdistancefield = pfield;
+                return true;
+            }
+        }
+        pfield->Compute(vbodies, fResolution, fPadding);
+        if( filename.size() > 0 && pfield->IsInitialized() ) {
+            pfield->Save(filename);
+        }
+        _pstaticdistancefield = pfield;
+        return pfield->IsInitialized();
+    }
+
+    bool GetStaticDistancesCommand(ostream& sout, istream& sinput)
+    {
+        if( !_pstaticdistancefield || !_pstaticdistancefield->IsInitialized() ) {
+            RAVELOG_WARN("call ComputeStaticDistanceField first\n");
+            return false;
+        }
+        Vector vposition, vgradient;
+        sout << std::setprecision(std::numeric_limits<OpenRAVE::dReal>::digits10+1);
+        while( !!(sinput >> vposition.x >> vposition.y >> vposition.z) ) {
+            OpenRAVE::dReal fdistance = _pstaticdistancefield->GetDistance(vposition, &vgradient);
+            sout << fdistance << " " << vgradient.x << " " << vgradient.y << " " << vgradient.z << endl;
+        }
+        return true;
+    }
+
+    /// \brief returns the field computed by the ComputeStaticDistanceField command
+    OpenRAVE::planningutils::SignedDistanceFieldConstPtr GetStaticDistanceField() const {
+        return _pstaticdistancefield;
+    }
+
+    virtual bool CheckContinuousCollision(KinBodyPtr pbody, const std::vector<int>& vdofindices, const std::vector<OpenRAVE::dReal>& vstartvalues, const std::vector<OpenRAVE::dReal>& vendvalues, CollisionReportPtr report = CollisionReportPtr())
+    {
+        START_TIMING_OPT(_statistics, "BodyContinuous",_options,pbody->IsRobot());
+        if( !!report ) {
+            report->Reset(_options);
+        }
+        const size_t dof = vdofindices.size() > 0 ? vdofindices.size() : (size_t)pbody->GetDOF();
+        OPENRAVE_ASSERT_OP(vstartvalues.size(), ==, dof);
+        OPENRAVE_ASSERT_OP(vendvalues.size(), ==, dof);
+        if( (pbody->GetLinks().size() == 0) || !_IsEnabled(*pbody) ) {
+            return false;
+        }
+
+        KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+        std::set<KinBodyConstPtr> attachedBodies;
+        pbody->GetAttached(attachedBodies);
+
+        // link transforms of the body and its attached bodies at both ends of the motion, concatenated in the order of attachedBodies
+        _vCachedContinuousStartTransforms.resize(0);
+        pbody->SetDOFValues(vstartvalues, KinBody::CLA_Nothing, vdofindices);
+        FOREACHC(itbody, attachedBodies) {
+            (*itbody)->GetLinkTransformations(_vCachedLinkTransforms);
+            _vCachedContinuousStartTransforms.insert(_vCachedContinuousStartTransforms.end(), _vCachedLinkTransforms.begin(), _vCachedLinkTransforms.end());
+        }
+        _vCachedContinuousEndTransforms.resize(0);
+        pbody->SetDOFValues(vendvalues, KinBody::CLA_Nothing, vdofindices);
+        FOREACHC(itbody, attachedBodies) {
+            (*itbody)->GetLinkTransformations(_vCachedLinkTransforms);
+            _vCachedContinuousEndTransforms.insert(_vCachedContinuousEndTransforms.end(), _vCachedLinkTransforms.begin(), _vCachedLinkTransforms.end());
+        }
+
+        _fclspace->Synchronize();
+        FCLCollisionManagerInstance& envManager = _GetEnvManager(attachedBodies);
+        ADD_TIMING(_statistics);
+
+        size_t itransform = 0;
+        FOREACHC(itbody, attachedBodies) {
+            const KinBody& body = **itbody;
+            const size_t itransformoffset = itransform;
+            itransform += body.GetLinks().size();
+            KinBodyInfoPtr pinfo = _fclspace->GetInfo(body);
+            if( !pinfo || !body.IsEnabled() ) {
+                continue;
+            }
+            FOREACHC(itlink, body.GetLinks()) {
+                const KinBody::Link& link = **itlink;
+                const FCLSpace::KinBodyInfo::LinkInfo& linkinfo = *pinfo->vlinks.at(link.GetIndex());
+                if( !link.IsEnabled() || linkinfo.vgeoms.size() == 0 ) {
+                    continue;
+                }
+                const Transform& tstart = _vCachedContinuousStartTransforms.at(itransformoffset+link.GetIndex());
+                const Transform& tend = _vCachedContinuousEndTransforms.at(itransformoffset+link.GetIndex());
+                LinkConstPtr penvlink = _CheckContinuousLinkCollision(link, linkinfo, tstart, tend, envManager);
+                if( !!penvlink ) {
+                    if( !!report ) {
+                        report->plink1 = *itlink;
+                        report->plink2 = penvlink;
+                        report->vLinkColliding.push_back(std::make_pair(report->plink1, report->plink2));
+                    }
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// \brief a pair of links closer than the margin of GetLinkPairDistances
+    struct LinkPairDistance
+    {
+        LinkPairDistance() : fDistance(0) {
+        }
+        LinkConstPtr plink1, plink2;
+        OpenRAVE::dReal fDistance; ///< distance between the geometries of the links, 0 if they collide
+    };
+
+    /// \brief gets all the link pairs of the environment whose geometries are closer than fmargin with one broadphase pass
+    ///
+    /// Links of the same body are paired if they are non-adjacent (see KinBody::GetNonAdjacentLinks), links of bodies attached to each other are never paired.
+    /// \param fmargin the largest distance of the returned pairs, 0 returns only colliding pairs
+    /// \param vlinkpairs filled with the pairs, each pair is returned once
+    virtual void GetLinkPairDistances(OpenRAVE::dReal fmargin, std::vector<LinkPairDistance>& vlinkpairs)
+    {
+        vlinkpairs.resize(0);
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        LinkPairDistanceData data;
+        data.fmargin = fmargin;
+        data.pvlinkpairs = &vlinkpairs;
+        data.distancerequest.gjk_solver_type = fcl::GST_LIBCCD;
+        data.collisionrequest.gjk_solver_type = fcl::GST_INDEP;
+        FOREACHC(itbody, vbodies) {
+            // GetNonAdjacentLinks can move the body, so get the pairs before synchronizing
+            if( (*itbody)->GetLinks().size() > 1 && (*itbody)->IsEnabled() ) {
+                std::vector<int>& vnonadjacent = data.mapnonadjacent[itbody->get()];
+                vnonadjacent = (*itbody)->GetNonAdjacentLinks(KinBody::AO_Enabled);
+                std::sort(vnonadjacent.begin(), vnonadjacent.end());
+            }
+        }
+        _fclspace->Synchronize();
+
+        // inflate the link boxes by the margin so that the broadphase reports every pair that can be within the margin
+        BroadPhaseCollisionManagerPtr pmanager = _CreateManager();
+        std::vector<CollisionObjectPtr> vobjects;
+        FOREACHC(itbody, vbodies) {
+            KinBodyInfoPtr pinfo = _fclspace->GetInfo(**itbody);
+            if( !pinfo || !(*itbody)->IsEnabled() ) {
+                continue;
+            }
+            FOREACHC(itlink, (*itbody)->GetLinks()) {
+                const LinkInfoPtr& plinkinfo = pinfo->vlinks.at((*itlink)->GetIndex());
+                CollisionObjectPtr pcollBV = plinkinfo->linkBV.second;
+                if( !(*itlink)->IsEnabled() || !pcollBV ) {
+                    continue;
+                }
+                const fcl::Box& box = static_cast<const fcl::Box&>(*pcollBV->getCollisionGeometry());
+                CollisionGeometryPtr pgeommargin = std::make_shared<fcl::Box>(box.side + fcl::Vec3f(2*fmargin, 2*fmargin, 2*fmargin));
+                CollisionObjectPtr pcollmargin = boost::make_shared<fcl::CollisionObject>(pgeommargin, pcollBV->getTransform());
+                pcollmargin->setUserData(plinkinfo.get());
+                pcollmargin->computeAABB();
+                vobjects.push_back(pcollmargin);
+                pmanager->registerObject(pcollmargin.get());
+            }
+        }
+        pmanager->setup();
+        pmanager->collide(&data, &FCLCollisionChecker::CollectLinkPairDistance);
+    }
+
+    /// \brief gets the distances between every enabled link of pbody1 and every enabled link of pbody2, meant to be called at a high rate while the bodies move
+    ///
+    /// Every geometry pair keeps its transforms and distance from the last time it was computed. With the motion of the geometries since then,
+    /// this gives bounds of the current distance without calling fcl. Only the geometry pairs whose lower bound is below the smallest upper bound
+    /// of the link pair are computed again, starting with the smallest lower bound, so usually only the previous closest pair of a link pair is refined.
+    /// \param ftolerance if the bounds of a link pair are closer than ftolerance, the lower bound is returned without computing any geometry pair. 0 always returns the exact distance
+    /// \param vlinkpairs filled with one entry per pair of enabled links with geometries, plink1 is of pbody1. The distance is 0 if the links collide
+    virtual void GetTrackedLinkPairDistances(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, OpenRAVE::dReal ftolerance, std::vector<LinkPairDistance>& vlinkpairs)
+    {
+        vlinkpairs.resize(0);
+        if( pbody1 == pbody2 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, body %s cannot be tracked against itself", GetEnv()->GetId()%pbody1->GetName(), OpenRAVE::ORE_InvalidArguments);
+        }
+        KinBodyInfoPtr pinfo1 = _fclspace->GetInfo(*pbody1), pinfo2 = _fclspace->GetInfo(*pbody2);
+        if( !pinfo1 || pinfo1->GetBody() != pbody1 ) {
+            pinfo1 = _fclspace->InitKinBody(pbody1);
+        }
+        if( !pinfo2 || pinfo2->GetBody() != pbody2 ) {
+            pinfo2 = _fclspace->InitKinBody(pbody2);
+        }
+        _fclspace->Synchronize(*pbody1);
+        _fclspace->Synchronize(*pbody2);
+
+        const size_t numlinks1 = pbody1->GetLinks().size(), numlinks2 = pbody2->GetLinks().size();
+        std::vector<TrackedLinkPair>& vtracked = _mapTrackedLinkPairs[std::make_pair(pbody1->GetEnvironmentId(), pbody2->GetEnvironmentId())];
+        vtracked.resize(numlinks1*numlinks2);
+        for(size_t ilink1 = 0; ilink1 < numlinks1; ++ilink1) {
+            const LinkInfoPtr& plinkinfo1 = pinfo1->vlinks.at(ilink1);
+            if( !pbody1->GetLinks()[ilink1]->IsEnabled() || plinkinfo1->vgeoms.size() == 0 ) {
+                continue;
+            }
+            for(size_t ilink2 = 0; ilink2 < numlinks2; ++ilink2) {
+                const LinkInfoPtr& plinkinfo2 = pinfo2->vlinks.at(ilink2);
+                if( !pbody2->GetLinks()[ilink2]->IsEnabled() || plinkinfo2->vgeoms.size() == 0 ) {
+                    continue;
+                }
+                LinkPairDistance linkpair;
+                linkpair.plink1 = pbody1->GetLinks()[ilink1];
+                linkpair.plink2 = pbody2->GetLinks()[ilink2];
+                linkpair.fDistance = _GetTrackedDistance(*plinkinfo1, *plinkinfo2, ftolerance, vtracked[ilink1*numlinks2+ilink2]);
+                vlinkpairs.push_back(linkpair);
+            }
+        }
+    }
 
 private:
+    /// \brief a sphere bounding part of a link, looked up in the static distance field by CheckCollisionConfigurations
+    struct StaticFieldSphere
+    {
+        size_t itransform; ///< index of the link in the link transforms of the body followed by its attached bodies
+        Vector vcenter; ///< in the link frame
+        OpenRAVE::dReal fradius;
+    };
+
+    /// \brief private copies of the collision objects of a body and its attached bodies used by one batch worker thread
+    struct BatchWorkerData
+    {
+        BatchWorkerData() : pvfieldspheres(NULL), bCollision(false) {
+        }
+        std::vector<KinBodyInfoPtr> vinfos; ///< copies of the body followed by its attached bodies, in the same order as the stored link transforms
+        BroadPhaseCollisionManagerPtr pmanager; ///< holds the enabled link objects of vinfos
+        std::vector<CollisionObjectPtr> vobjects; ///< the objects registered in pmanager, kept so that the copies outlive the manager
+        const std::vector<StaticFieldSphere>* pvfieldspheres; ///< if not NULL, the static manager is skipped for configurations where these spheres are free in pfield
+        OpenRAVE::planningutils::SignedDistanceFieldConstPtr pfield;
+        fcl::CollisionRequest request;
+        fcl::CollisionResult result;
+        bool bCollision;
+    };
+
+    /// \brief checks the configurations with the link transforms computed by CheckCollisionConfigurations
+    ///
+    /// Forward kinematics modify the body so they are computed on the calling thread first. Then each worker moves its own copies of the link objects
+    /// and collides them against the shared environment manager, which is only read.
+    ///
+    /// \param vbodies the body followed by its attached bodies in the environment
+    /// \param pvfieldspheres if not NULL, the spheres of vbodies that are looked up in the static distance field before the static bodies are checked
+    int _CheckCollisionConfigurationsParallel(KinBodyPtr pbody, const std::set<KinBodyConstPtr>& attachedBodies, const std::vector<KinBodyConstPtr>& vbodies, const std::vector<StaticFieldSphere>* pvfieldspheres, const std::vector<int>& vdofindices, const std::vector<OpenRAVE::dReal>& vconfigurations, size_t dof, std::vector<uint8_t>& vcollisions, bool bCheckSelfCollision)
+    {
+        const size_t numconfigurations = vcollisions.size();
+
+        // the workers only check the links of the body with each other, the grabbed bodies are checked by KinBody::CheckSelfCollision after them
+        std::vector<KinBodyPtr> vgrabbed;
+        pbody->GetGrabbed(vgrabbed);
+        const bool bCheckGrabbedSelfCollision = bCheckSelfCollision && vgrabbed.size() > 0;
+
+        // GetNonAdjacentLinks can move the body, so get it before the link transforms are stored
+        const std::vector<int>* pvnonadjacent = NULL;
+        if( bCheckSelfCollision && !bCheckGrabbedSelfCollision && pbody->GetLinks().size() > 1 ) {
+            pvnonadjacent = &pbody->GetNonAdjacentLinks(KinBody::AO_Enabled);
+        }
+
+        size_t numlinktransforms = 0;
+        FOREACHC(itbody, vbodies) {
+            numlinktransforms += (*itbody)->GetLinks().size();
+        }
+        std::vector<Transform> vlinktransforms(numconfigurations*numlinktransforms), vtrans;
+        std::vector<OpenRAVE::dReal> vvalues(dof);
+        for(size_t iconfig = 0; iconfig < numconfigurations; ++iconfig) {
+            std::copy(vconfigurations.begin()+iconfig*dof, vconfigurations.begin()+(iconfig+1)*dof, vvalues.begin());
+            pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing, vdofindices);
+            std::vector<Transform>::iterator itstored = vlinktransforms.begin() + iconfig*numlinktransforms;
+            FOREACHC(itbody, vbodies) {
+                (*itbody)->GetLinkTransformations(vtrans);
+                itstored = std::copy(vtrans.begin(), vtrans.end(), itstored);
+            }
+        }
+
+        FCLCollisionManagerInstance& envManager = _GetEnvManager(attachedBodies);
+        BroadPhaseCollisionManagerPtr penvmanager = envManager.GetManager(), pstaticmanager = envManager.GetStaticManager();
+
+        std::vector<BatchWorkerData> vworkers(_nBatchThreads);
+        FOREACH(itworker, vworkers) {
+            itworker->request.gjk_solver_type = fcl::GST_INDEP;
+            itworker->request.enable_contact = false;
+            itworker->pvfieldspheres = pvfieldspheres;
+            itworker->pfield = _pstaticdistancefield;
+            itworker->pmanager = _CreateManager();
+            FOREACHC(itbody, vbodies) {
+                KinBodyInfoPtr pinfo = _fclspace->CopyKinBodyInfo(**itbody);
+                OPENRAVE_ASSERT_FORMAT(!!pinfo, "env=%d, body %s is not initialized in fcl space", GetEnv()->GetId()%(*itbody)->GetName(), OpenRAVE::ORE_InvalidState);
+                itworker->vinfos.push_back(pinfo);
+                FOREACHC(itlink, (*itbody)->GetLinks()) {
+                    CollisionObjectPtr pcoll = pinfo->vlinks.at((*itlink)->GetIndex())->linkBV.second;
+                    if( (*itlink)->IsEnabled() && !!pcoll ) {
+                        itworker->vobjects.push_back(pcoll);
+                        itworker->pmanager->registerObject(pcoll.get());
+                    }
+                }
+            }
+            itworker->pmanager->setup();
+        }
+
+        _batchworkerpool.Run(vworkers.size(), _GetNumPoolThreads(), boost::bind(&FCLCollisionChecker::_CheckCollisionConfigurationsWorker, boost::ref(vworkers), _1, numlinktransforms, boost::cref(vlinktransforms), penvmanager, pstaticmanager, pvnonadjacent, boost::ref(vcollisions)));
+
+        if( bCheckGrabbedSelfCollision ) {
+            for(size_t iconfig = 0; iconfig < numconfigurations; ++iconfig) {
+                if( !vcollisions[iconfig] ) {
+                    std::copy(vconfigurations.begin()+iconfig*dof, vconfigurations.begin()+(iconfig+1)*dof, vvalues.begin());
+                    pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing, vdofindices);
+                    if( pbody->CheckSelfCollision(CollisionReportPtr(), shared_checker()) ) {
+                        vcollisions[iconfig] = 1;
+                    }
+                }
+            }
+        }
+        return std::count(vcollisions.begin(), vcollisions.end(), 1);
+    }
+
+    /// \brief the number of threads of _batchworkerpool, shared by the batch and the self collision checks so that switching between them does not restart the threads
+    inline int _GetNumPoolThreads() const {
+        return std::max(_nBatchThreads, _nSelfCollisionThreads);
+    }
+
+    /// \brief checks the non-adjacent link pairs of a body with _nSelfCollisionThreads tasks of _batchworkerpool
+    ///
+    /// The pairs whose bounding boxes and coarse spheres overlap are gathered on the calling thread, then every task checks the geometries of
+    /// its share of them with its own fcl request. The link objects are not moved during the check so the threads only read them. The threads
+    /// stop at the first collision found before their current pair, and the first colliding pair is checked again through query so that the
+    /// report is filled as the serial check would fill it.
+    bool _CheckStandaloneSelfCollisionParallel(const FCLSpace::KinBodyInfo& info, const std::vector<int>& nonadjacent, CollisionCallbackData& query)
+    {
+        std::vector<std::pair<const FCLSpace::KinBodyInfo::LinkInfo*, const FCLSpace::KinBodyInfo::LinkInfo*> > vlinkpairs;
+        vlinkpairs.reserve(nonadjacent.size());
+        FOREACHC(itset, nonadjacent) {
+            const FCLSpace::KinBodyInfo::LinkInfo& linkinfo1 = *info.vlinks.at(*itset&0xffff);
+            const FCLSpace::KinBodyInfo::LinkInfo& linkinfo2 = *info.vlinks.at(*itset>>16);
+            if( !linkinfo1.linkBV.second->getAABB().overlap(linkinfo2.linkBV.second->getAABB()) || _AreCoarseSpheresSeparated(linkinfo1, linkinfo2) ) {
+                continue;
+            }
+            vlinkpairs.push_back(std::make_pair(&linkinfo1, &linkinfo2));
+        }
+
+        size_t nthreads = std::min((size_t)_nSelfCollisionThreads, vlinkpairs.size());
+        std::atomic<size_t> ifirstcollision(vlinkpairs.size());
+        if( nthreads > 1 ) {
+            _batchworkerpool.Run(nthreads, _GetNumPoolThreads(), boost::bind(&FCLCollisionChecker::_CheckSelfCollisionPairsWorker, boost::cref(vlinkpairs), _1, nthreads, boost::ref(ifirstcollision)));
+        }
+        else {
+            ifirstcollision = 0;
+        }
+
+        for(size_t ipair = ifirstcollision; ipair < vlinkpairs.size(); ++ipair) {
+            FOREACHC(itgeom1, vlinkpairs[ipair].first->vgeoms) {
+                FOREACHC(itgeom2, vlinkpairs[ipair].second->vgeoms) {
+                    if( !(*itgeom1).second->getAABB().overlap((*itgeom2).second->getAABB()) ) {
+                        continue;
+                    }
+                    CheckNarrowPhaseGeomCollision((*itgeom1).second.get(), (*itgeom2).second.get(), &query);
+                    if( query._bStopChecking ) {
+                        return query._bCollision;
+                    }
+                }
+            }
+        }
+        return query._bCollision;
+    }
+
+    /// \brief checks the link pairs istart, istart+istep, ... and lowers ifirstcollision to the index of the colliding ones
+    static void _CheckSelfCollisionPairsWorker(const std::vector<std::pair<const FCLSpace::KinBodyInfo::LinkInfo*, const FCLSpace::KinBodyInfo::LinkInfo*> >& vlinkpairs, size_t istart, size_t istep, std::atomic<size_t>& ifirstcollision)
+    {
+        BatchWorkerData worker;
+        worker.request.gjk_solver_type = fcl::GST_INDEP;
+        worker.request.enable_contact = false;
+        for(size_t ipair = istart; ipair < vlinkpairs.size(); ipair += istep) {
+            if( ipair >= ifirstcollision.load(std::memory_order_relaxed) ) {
+                return;
+            }
+            if( _CheckBatchLinkCollision(*vlinkpairs[ipair].first, *vlinkpairs[ipair].second, worker) ) {
+                size_t icurrent = ifirstcollision.load();
+                while( ipair < icurrent && !ifirstcollision.compare_exchange_weak(icurrent, ipair) ) {
+                }
+                return;
+            }
+        }
+    }
+
+    /// \brief checks the configurations iworker, iworker+vworkers.size(), ... of the stored link transforms, the collision objects of vworkers[iworker] belong to this task only
+    static void _CheckCollisionConfigurationsWorker(std::vector<BatchWorkerData>& vworkers, size_t iworker, size_t numlinktransforms, const std::vector<Transform>& vlinktransforms, BroadPhaseCollisionManagerPtr penvmanager, BroadPhaseCollisionManagerPtr pstaticmanager, const std::vector<int>* pvnonadjacent, std::vector<uint8_t>& vcollisions)
+    {
+        BatchWorkerData& worker = vworkers[iworker];
+        for(size_t iconfig = iworker; iconfig < vcollisions.size(); iconfig += vworkers.size()) {
+            std::vector<Transform>::const_iterator ittrans = vlinktransforms.begin() + iconfig*numlinktransforms;
+            FOREACH(itinfo, worker.vinfos) {
+                FOREACH(itlink, (*itinfo)->vlinks) {
+                    FCLSpace::SynchronizeLink(**itlink, *ittrans++);
+                }
+            }
+            worker.pmanager->update();
+
+            worker.bCollision = false;
+            penvmanager->collide(worker.pmanager.get(), &worker, &FCLCollisionChecker::CheckBatchNarrowPhaseCollision);
+            if( !worker.bCollision && !!pstaticmanager && (!worker.pvfieldspheres || !_IsFreeInStaticField(*worker.pfield, *worker.pvfieldspheres, vlinktransforms.begin() + iconfig*numlinktransforms)) ) {
+                pstaticmanager->collide(worker.pmanager.get(), &worker, &FCLCollisionChecker::CheckBatchNarrowPhaseCollision);
+            }
+            if( !worker.bCollision && !!pvnonadjacent ) {
+                const FCLSpace::KinBodyInfo& info = *worker.vinfos.at(0);
+                FOREACHC(itset, *pvnonadjacent) {
+                    const FCLSpace::KinBodyInfo::LinkInfo& linkinfo1 = *info.vlinks.at(*itset&0xffff);
+                    const FCLSpace::KinBodyInfo::LinkInfo& linkinfo2 = *info.vlinks.at(*itset>>16);
+                    if( _CheckBatchLinkCollision(linkinfo1, linkinfo2, worker) ) {
+                        break;
+                    }
+                }
+            }
+            if( worker.bCollision ) {
+                vcollisions[iconfig] = 1;
+            }
+        }
+    }
+
+    /// \brief fills the spheres of the enabled links of vbodies, the coarse spheres when they are computed, otherwise the sphere around the link bounding box
+    ///
+    /// \return false if the static distance field cannot be used, for example when the static bodies changed since it was computed
+    bool _InitStaticFieldSpheres(const std::vector<KinBodyConstPtr>& vbodies, std::vector<StaticFieldSphere>& vspheres)
+    {
+        vspheres.resize(0);
+        if( !_pstaticdistancefield || !_pstaticdistancefield->IsInitialized() ) {
+            return false;
+        }
+        if( _bStaticDistanceFieldPendingStamp ) {
+            _nStaticDistanceFieldStamp = _fclspace->GetStaticBodiesUpdateStamp();
+            _bStaticDistanceFieldPendingStamp = false;
+        }
+        if( _nStaticDistanceFieldStamp != _fclspace->GetStaticBodiesUpdateStamp() ) {
+            return false;
+        }
+        const std::set<std::string>& setstaticnames = _fclspace->GetStaticBodyNames();
+        size_t itransform = 0;
+        FOREACHC(itbody, vbodies) {
+            KinBodyInfoPtr pinfo = _fclspace->GetInfo(**itbody);
+            if( !pinfo || setstaticnames.find((*itbody)->GetName()) != setstaticnames.end() ) {
+                return false;
+            }
+            FOREACHC(itlink, (*itbody)->GetLinks()) {
+                const FCLSpace::KinBodyInfo::LinkInfo& linkinfo = *pinfo->vlinks.at((*itlink)->GetIndex());
+                if( (*itlink)->IsEnabled() && !!linkinfo.linkBV.second ) {
+                    StaticFieldSphere sphere;
+                    sphere.itransform = itransform;
+                    if( linkinfo.vcoarsespheres.size() > 0 ) {
+                        FOREACHC(itcoarse, linkinfo.vcoarsespheres) {
+                            sphere.vcenter = linkinfo.linkBV.first.trans + ConvertVectorFromFCL(itcoarse->first);
+                            sphere.fradius = itcoarse->second;
+                            vspheres.push_back(sphere);
+                        }
+                    }
+                    else {
+                        const fcl::Box& box = static_cast<const fcl::Box&>(*linkinfo.linkBV.second->getCollisionGeometry());
+                        sphere.vcenter = linkinfo.linkBV.first.trans;
+                        sphere.fradius = 0.5*box.side.length();
+                        vspheres.push_back(sphere);
+                    }
+                }
+                ++itransform;
+            }
+        }
+        return true;
+    }
+
+    /// \brief returns true if every sphere is farther from the static bodies than its radius plus the error of the field
+    ///
+    /// \param itlinktransforms the link transforms of the configuration, indexed by StaticFieldSphere::itransform
+    static bool _IsFreeInStaticField(const OpenRAVE::planningutils::SignedDistanceField& field, const std::vector<StaticFieldSphere>& vspheres, std::vector<Transform>::const_iterator itlinktransforms)
+    {
+        const OpenRAVE::dReal ferror = field.GetErrorBound();
+        FOREACHC(itsphere, vspheres) {
+            if( field.GetDistance(itlinktransforms[itsphere->itransform]*itsphere->vcenter) <= itsphere->fradius + ferror ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief broadphase callback of the batch workers. Both objects carry their LinkInfo as user data, the managers only contain enabled links of bodies that are not attached to each other
+    static bool CheckBatchNarrowPhaseCollision(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data)
+    {
+        BatchWorkerData& worker = *static_cast<BatchWorkerData*>(data);
+        if( worker.bCollision ) {
+            return true;
+        }
+        const FCLSpace::KinBodyInfo::LinkInfo* plinkinfo1 = static_cast<const FCLSpace::KinBodyInfo::LinkInfo*>(o1->getUserData());
+        const FCLSpace::KinBodyInfo::LinkInfo* plinkinfo2 = static_cast<const FCLSpace::KinBodyInfo::LinkInfo*>(o2->getUserData());
+        if( !plinkinfo1 || !plinkinfo2 ) {
+            return false;
+        }
+        return _CheckBatchLinkCollision(*plinkinfo1, *plinkinfo2, worker);
+    }
+
+    static bool _CheckBatchLinkCollision(const FCLSpace::KinBodyInfo::LinkInfo& linkinfo1, const FCLSpace::KinBodyInfo::LinkInfo& linkinfo2, BatchWorkerData& worker)
+    {
+        if( !linkinfo1.linkBV.second || !linkinfo2.linkBV.second || !linkinfo1.linkBV.second->getAABB().overlap(linkinfo2.linkBV.second->getAABB()) ) {
+            return false;
+        }
+        if( _AreCoarseSpheresSeparated(linkinfo1, linkinfo2) ) {
+            return false;
+        }
+        FOREACHC(itgeom1, linkinfo1.vgeoms) {
+            FOREACHC(itgeom2, linkinfo2.vgeoms) {
+                if( !itgeom1->second->getAABB().overlap(itgeom2->second->getAABB()) ) {
+                    continue;
+                }
+                worker.result.clear();
+                if( fcl::collide(itgeom1->second.get(), itgeom2->second.get(), worker.request, worker.result) > 0 ) {
+                    worker.bCollision = true;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// \brief the last distance computed by GetTrackedLinkPairDistances between two geometries
+    struct TrackedGeomPair
+    {
+        TrackedGeomPair() : distance(0), lower(0), upper(0) {
+        }
+        std::weak_ptr<const fcl::CollisionGeometry> pgeom1, pgeom2; ///< expired or different if the geometries were recreated since distance was computed
+        fcl::Transform3f t1, t2; ///< the transforms of the geometries when distance was computed
+        fcl::FCL_REAL distance; ///< 0 if the geometries collided
+        fcl::FCL_REAL lower, upper; ///< bounds of the current distance, only valid during _GetTrackedDistance
+    };
+
+    /// \brief the geometry pairs of two links tracked by GetTrackedLinkPairDistances, indexed by igeom1*vgeoms2.size()+igeom2
+    struct TrackedLinkPair
+    {
+        std::vector<TrackedGeomPair> vgeompairs;
+    };
+
+    static bool _CompareTrackedLowerBound(const TrackedGeomPair* pgeompair1, const TrackedGeomPair* pgeompair2)
+    {
+        return pgeompair1->lower < pgeompair2->lower;
+    }
+
+    /// \brief bounds the distance of every geometry pair of the links with its motion and computes the pairs that can be the closest, see GetTrackedLinkPairDistances
+    OpenRAVE::dReal _GetTrackedDistance(const FCLSpace::KinBodyInfo::LinkInfo& linkinfo1, const FCLSpace::KinBodyInfo::LinkInfo& linkinfo2, OpenRAVE::dReal ftolerance, TrackedLinkPair& tracked)
+    {
+        const size_t numgeoms2 = linkinfo2.vgeoms.size();
+        if( tracked.vgeompairs.size() != linkinfo1.vgeoms.size()*numgeoms2 ) {
+            tracked.vgeompairs.resize(0);
+            tracked.vgeompairs.resize(linkinfo1.vgeoms.size()*numgeoms2);
+        }
+        fcl::FCL_REAL fminupper = std::numeric_limits<fcl::FCL_REAL>::max();
+        for(size_t igeom1 = 0; igeom1 < linkinfo1.vgeoms.size(); ++igeom1) {
+            const fcl::CollisionObject& o1 = *linkinfo1.vgeoms[igeom1].second;
+            for(size_t igeom2 = 0; igeom2 < numgeoms2; ++igeom2) {
+                const fcl::CollisionObject& o2 = *linkinfo2.vgeoms[igeom2].second;
+                TrackedGeomPair& geompair = tracked.vgeompairs[igeom1*numgeoms2+igeom2];
+                if( geompair.pgeom1.lock() == o1.collisionGeometry() && geompair.pgeom2.lock() == o2.collisionGeometry() ) {
+                    fcl::FCL_REAL fmotion = _ComputeMaxMotion(&o1, geompair.t1) + _ComputeMaxMotion(&o2, geompair.t2);
+                    geompair.lower = geompair.distance - fmotion;
+                    geompair.upper = geompair.distance + fmotion;
+                }
+                else {
+                    geompair.lower = -std::numeric_limits<fcl::FCL_REAL>::max();
+                    geompair.upper = std::numeric_limits<fcl::FCL_REAL>::max();
+                }
+                fminupper = std::min(fminupper, geompair.upper);
+            }
+        }
+
+        // the pairs whose lower bound is above the upper bound of another pair cannot be the closest
+        _vTrackedCandidates.resize(0);
+        fcl::FCL_REAL fminlower = std::numeric_limits<fcl::FCL_REAL>::max();
+        FOREACH(itgeompair, tracked.vgeompairs) {
+            if( itgeompair->lower <= fminupper ) {
+                _vTrackedCandidates.push_back(&*itgeompair);
+                fminlower = std::min(fminlower, itgeompair->lower);
+            }
+        }
+        if( fminupper - fminlower <= ftolerance ) {
+            return std::max(fminlower, fcl::FCL_REAL(0));
+        }
+
+        std::sort(_vTrackedCandidates.begin(), _vTrackedCandidates.end(), _CompareTrackedLowerBound);
+        fcl::FCL_REAL fdistance = fminupper;
+        FOREACH(itpgeompair, _vTrackedCandidates) {
+            TrackedGeomPair& geompair = **itpgeompair;
+            if( geompair.lower >= fdistance ) {
+                break;
+            }
+            size_t index = &geompair - &tracked.vgeompairs[0];
+            fcl::CollisionObject* o1 = linkinfo1.vgeoms[index/numgeoms2].second.get();
+            fcl::CollisionObject* o2 = linkinfo2.vgeoms[index%numgeoms2].second.get();
+            geompair.distance = 0;
+            _trackedCollisionResult.clear();
+            if( !o1->getAABB().overlap(o2->getAABB()) || fcl::collide(o1, o2, _trackedCollisionRequest, _trackedCollisionResult) == 0 ) {
+                _trackedDistanceResult.clear();
+                geompair.distance = std::max(fcl::distance(o1, o2, _trackedDistanceRequest, _trackedDistanceResult), fcl::FCL_REAL(0));
+            }
+            geompair.pgeom1 = o1->collisionGeometry();
+            geompair.pgeom2 = o2->collisionGeometry();
+            geompair.t1 = o1->getTransform();
+            geompair.t2 = o2->getTransform();
+            geompair.lower = geompair.upper = geompair.distance;
+            fdistance = std::min(fdistance, geompair.distance);
+        }
+        return fdistance;
+    }
+
+    struct LinkPairDistanceData
+    {
+        LinkPairDistanceData() : fmargin(0), pvlinkpairs(NULL) {
+        }
+        OpenRAVE::dReal fmargin;
+        std::map<const KinBody*, std::vector<int> > mapnonadjacent; ///< sorted non-adjacent link pairs of every body with more than one link
+        std::vector<LinkPairDistance>* pvlinkpairs;
+        fcl::CollisionRequest collisionrequest;
+        fcl::CollisionResult collisionresult;
+        fcl::DistanceRequest distancerequest;
+        fcl::DistanceResult distanceresult;
+    };
+
+    /// \brief broadphase callback of GetLinkPairDistances, the objects carry the LinkInfo of their links as user data
+    static bool CollectLinkPairDistance(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data)
+    {
+        LinkPairDistanceData& pairdata = *static_cast<LinkPairDistanceData*>(data);
+        FCLSpace::KinBodyInfo::LinkInfo* plinkinfo1 = static_cast<FCLSpace::KinBodyInfo::LinkInfo*>(o1->getUserData());
+        FCLSpace::KinBodyInfo::LinkInfo* plinkinfo2 = static_cast<FCLSpace::KinBodyInfo::LinkInfo*>(o2->getUserData());
+        if( !plinkinfo1 || !plinkinfo2 ) {
+            return false;
+        }
+        LinkConstPtr plink1 = plinkinfo1->GetLink(), plink2 = plinkinfo2->GetLink();
+        if( !plink1 || !plink2 ) {
+            return false;
+        }
+        const KinBody& body1 = *plink1->GetParent(), &body2 = *plink2->GetParent();
+        if( &body1 == &body2 ) {
+            std::map<const KinBody*, std::vector<int> >::const_iterator itnonadjacent = pairdata.mapnonadjacent.find(&body1);
+            int index1 = plink1->GetIndex(), index2 = plink2->GetIndex();
+            if( index1 > index2 ) {
+                std::swap(index1, index2);
+            }
+            if( itnonadjacent == pairdata.mapnonadjacent.end() || !std::binary_search(itnonadjacent->second.begin(), itnonadjacent->second.end(), index1|(index2<<16)) ) {
+                return false;
+            }
+        }
+        else if( body1.IsAttached(body2) ) {
+            return false;
+        }
+
+        fcl::FCL_REAL fmindistance = std::numeric_limits<fcl::FCL_REAL>::max();
+        FOREACHC(itgeom1, plinkinfo1->vgeoms) {
+            FOREACHC(itgeom2, plinkinfo2->vgeoms) {
+                if( itgeom1->second->getAABB().overlap(itgeom2->second->getAABB()) ) {
+                    pairdata.collisionresult.clear();
+                    if( fcl::collide(itgeom1->second.get(), itgeom2->second.get(), pairdata.collisionrequest, pairdata.collisionresult) > 0 ) {
+                        fmindistance = 0;
+                        break;
+                    }
+                }
+                if( pairdata.fmargin > 0 ) {
+                    pairdata.distanceresult.clear();
+                    fcl::FCL_REAL fdistance = fcl::distance(itgeom1->second.get(), itgeom2->second.get(), pairdata.distancerequest, pairdata.distanceresult);
+                    if( fdistance >= 0 && fdistance < fmindistance ) {
+                        fmindistance = fdistance;
+                    }
+                }
+            }
+            if( fmindistance <= 0 ) {
+                break;
+            }
+        }
+        if( fmindistance <= pairdata.fmargin ) {
+            LinkPairDistance linkpair;
+            linkpair.plink1 = plink1;
+            linkpair.plink2 = plink2;
+            linkpair.fDistance = fmindistance;
+            pairdata.pvlinkpairs->push_back(linkpair);
+        }
+        return false;
+    }
+
+    /// \brief collects the environment links whose objects overlap the swept box of a moving link
+    struct ContinuousCandidatesData
+    {
+        FCLSpace::KinBodyInfo::LinkInfo boxuserdata; ///< marks the swept box so that it is not taken as a candidate
+        std::vector<FCLSpace::KinBodyInfo::LinkInfo*> vcandidates;
+    };
+
+    static bool CollectContinuousCandidates(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data)
+    {
+        ContinuousCandidatesData& candidates = *static_cast<ContinuousCandidatesData*>(data);
+        FCLSpace::KinBodyInfo::LinkInfo* plinkinfo = static_cast<FCLSpace::KinBodyInfo::LinkInfo*>(o1->getUserData());
+        if( plinkinfo == &candidates.boxuserdata ) {
+            plinkinfo = static_cast<FCLSpace::KinBodyInfo::LinkInfo*>(o2->getUserData());
+        }
+        if( !!plinkinfo && plinkinfo != &candidates.boxuserdata && std::find(candidates.vcandidates.begin(), candidates.vcandidates.end(), plinkinfo) == candidates.vcandidates.end() ) {
+            candidates.vcandidates.push_back(plinkinfo);
+        }
+        return false;
+    }
+
+    static inline fcl::Transform3f _ConvertTransformToFCL(const Transform& t)
+    {
+        return fcl::Transform3f(ConvertQuaternionToFCL(t.rot), ConvertVectorToFCL(t.trans));
+    }
+
+    /// \brief sweeps the geometries of a link moving linearly from tstart to tend against the environment objects of envManager
+    ///
+    /// The broadphase is queried with the box bounding the link at both ends of the motion, so the motion has to be small compared to the size of the link for rotations not to leave the box.
+    /// \return the environment link that is hit, empty if the motion is free
+    LinkConstPtr _CheckContinuousLinkCollision(const KinBody::Link& link, const FCLSpace::KinBodyInfo::LinkInfo& linkinfo, const Transform& tstart, const Transform& tend, FCLCollisionManagerInstance& envManager)
+    {
+        const OpenRAVE::AABB abstart = link.ComputeAABBFromTransform(tstart), abend = link.ComputeAABBFromTransform(tend);
+        Vector vmin, vmax;
+        for(int i = 0; i < 3; ++i) {
+            vmin[i] = std::min(abstart.pos[i]-abstart.extents[i], abend.pos[i]-abend.extents[i]);
+            vmax[i] = std::max(abstart.pos[i]+abstart.extents[i], abend.pos[i]+abend.extents[i]);
+        }
+
+        CollisionGeometryPtr cboxgeom = make_shared<fcl::Box>(vmax.x-vmin.x, vmax.y-vmin.y, vmax.z-vmin.z);
+        fcl::CollisionObject cboxobj(cboxgeom);
+        cboxobj.setTranslation(ConvertVectorToFCL(0.5*(vmin+vmax)));
+        cboxobj.computeAABB();
+        ContinuousCandidatesData candidates;
+        cboxobj.setUserData(&candidates.boxuserdata);
+        envManager.GetManager()->collide(&cboxobj, &candidates, &FCLCollisionChecker::CollectContinuousCandidates);
+        if( !!envManager.GetStaticManager() ) {
+            envManager.GetStaticManager()->collide(&cboxobj, &candidates, &FCLCollisionChecker::CollectContinuousCandidates);
+        }
+
+        // conservative advancement only supports some pairs of geometry types, the naive solver is used for the others
+        fcl::ContinuousCollisionRequest request(_nContinuousMaxIterations, 1e-4, fcl::CCDM_LINEAR, fcl::GST_LIBCCD, fcl::CCDC_CONSERVATIVE_ADVANCEMENT);
+        fcl::ContinuousCollisionRequest naiverequest(_nContinuousMaxIterations, 1e-4, fcl::CCDM_LINEAR, fcl::GST_LIBCCD, fcl::CCDC_NAIVE);
+        fcl::ContinuousCollisionResult result;
+        FOREACHC(itcandidate, candidates.vcandidates) {
+            LinkConstPtr penvlink = (*itcandidate)->GetLink();
+            if( !penvlink || !penvlink->IsEnabled() ) {
+                continue;
+            }
+            FOREACHC(itgeom1, linkinfo.vgeoms) {
+                const fcl::Transform3f tf1start = _ConvertTransformToFCL(tstart * itgeom1->first), tf1end = _ConvertTransformToFCL(tend * itgeom1->first);
+                FOREACHC(itgeom2, (*itcandidate)->vgeoms) {
+                    if( !itgeom2->second->getAABB().overlap(cboxobj.getAABB()) ) {
+                        continue;
+                    }
+                    const fcl::CollisionGeometry* pgeom1 = itgeom1->second->collisionGeometry().get();
+                    const fcl::CollisionGeometry* pgeom2 = itgeom2->second->collisionGeometry().get();
+                    const fcl::Transform3f& tf2 = itgeom2->second->getTransform();
+                    result.is_collide = false;
+                    if( fcl::continuousCollide(pgeom1, tf1start, tf1end, pgeom2, tf2, tf2, request, result) < 0 ) {
+                        result.is_collide = false;
+                        fcl::continuousCollide(pgeom1, tf1start, tf1end, pgeom2, tf2, tf2, naiverequest, result);
+                    }
+                    if( result.is_collide ) {
+                        return penvlink;
+                    }
+                }
+            }
+        }
+        return LinkConstPtr();
+    }
+
     inline boost::shared_ptr<FCLCollisionChecker> shared_checker() {
         return boost::static_pointer_cast<FCLCollisionChecker>(shared_from_this());
     }
@@ -962,6 +2077,9 @@ private:
             }
 
             LinkInfoPtr pLINK1 = _fclspace->GetLinkInfo(*plink1), pLINK2 = _fclspace->GetLinkInfo(*plink2);
+            if( _AreCoarseSpheresSeparated(*pLINK1, *pLINK2) ) {
+                return pcb->_bStopChecking;
+            }
 
             //RAVELOG_VERBOSE_FORMAT("env=%d, link %s:%s with %s:%s", GetEnv()->GetId()%plink1->GetParent()->GetName()%plink1->GetName()%plink2->GetParent()->GetName()%plink2->GetName());
             FOREACH(itgeompair1, pLINK1->vgeoms) {
@@ -1006,6 +2124,35 @@ private:
     }
 
 
+    /// \brief returns true if both links have coarse spheres and none of the spheres of one link overlaps a sphere of the other, so their geometries cannot collide
+    static bool _AreCoarseSpheresSeparated(const FCLSpace::KinBodyInfo::LinkInfo& linkinfo1, const FCLSpace::KinBodyInfo::LinkInfo& linkinfo2)
+    {
+        if( linkinfo1.vcoarsespheres.empty() || linkinfo2.vcoarsespheres.empty() || !linkinfo1.linkBV.second || !linkinfo2.linkBV.second ) {
+            return false;
+        }
+        const fcl::Transform3f& t1 = linkinfo1.linkBV.second->getTransform();
+        const fcl::Transform3f& t2 = linkinfo2.linkBV.second->getTransform();
+        // keep the world centers of the second link on the stack, the number of spheres is small
+        fcl::Vec3f vcenters2[64];
+        const size_t numspheres2 = std::min(linkinfo2.vcoarsespheres.size(), sizeof(vcenters2)/sizeof(vcenters2[0]));
+        if( numspheres2 < linkinfo2.vcoarsespheres.size() ) {
+            return false;
+        }
+        for(size_t isphere2 = 0; isphere2 < numspheres2; ++isphere2) {
+            vcenters2[isphere2] = t2.transform(linkinfo2.vcoarsespheres[isphere2].first);
+        }
+        FOREACHC(itsphere1, linkinfo1.vcoarsespheres) {
+            fcl::Vec3f vcenter1 = t1.transform(itsphere1->first);
+            for(size_t isphere2 = 0; isphere2 < numspheres2; ++isphere2) {
+                fcl::FCL_REAL fradius = itsphere1->second + linkinfo2.vcoarsespheres[isphere2].second;
+                if( (vcenter1 - vcenters2[isphere2]).sqrLength() <= fradius*fradius ) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
     static bool CheckNarrowPhaseGeomCollision(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data) {
         CollisionCallbackData* pcb = static_cast<CollisionCallbackData *>(data);
         return pcb->_pchecker->CheckNarrowPhaseGeomCollision(o1, o2, pcb);
@@ -1021,6 +2168,23 @@ private:
 
 #ifdef NARROW_COLLISION_CACHING
         CollisionPair collpair = MakeCollisionPair(o1, o2);
+        // primitives are convex, so if neither moved further than their last distance, they are still separated
+        bool bPrimitivePair = o1->getObjectType() == fcl::OT_GEOM && o2->getObjectType() == fcl::OT_GEOM;
+        if( bPrimitivePair ) {
+            NarrowSeparationCache::iterator itseparation = mCollisionCachedSeparations.find(collpair);
+            if( itseparation != mCollisionCachedSeparations.end() ) {
+                const NarrowSeparation& separation = itseparation->second;
+                if( separation.pgeom1.lock() == collpair.first->collisionGeometry() && separation.pgeom2.lock() == collpair.second->collisionGeometry() ) {
+                    if( _ComputeMaxMotion(collpair.first, separation.t1) + _ComputeMaxMotion(collpair.second, separation.t2) < separation.distance ) {
+                        return false;
+                    }
+                }
+                else {
+                    // the object was recreated at the same address
+                    mCollisionCachedSeparations.erase(itseparation);
+                }
+            }
+        }
         NarrowCollisionCache::iterator it = mCollisionCachedGuesses.find(collpair);
         if( it != mCollisionCachedGuesses.end() ) {
             pcb->_request.cached_gjk_guess = it->second;
@@ -1030,10 +2194,29 @@ private:
         }
 #endif
 
+        uint64_t narrowphasestarttime = OpenRAVE::utils::GetNanoPerformanceTime();
         size_t numContacts = fcl::collide(o1, o2, pcb->_request, pcb->_result);
+        _pcounternarrowphase->Add(OpenRAVE::utils::GetNanoPerformanceTime() - narrowphasestarttime);
 
 #ifdef NARROW_COLLISION_CACHING
         mCollisionCachedGuesses[collpair] = pcb->_result.cached_gjk_guess;
+        if( bPrimitivePair ) {
+            if( numContacts > 0 ) {
+                mCollisionCachedSeparations.erase(collpair);
+            }
+            else {
+                _separationDistanceResult.clear();
+                fcl::FCL_REAL distance = fcl::distance(collpair.first, collpair.second, _separationDistanceRequest, _separationDistanceResult);
+                if( distance > 0 ) {
+                    NarrowSeparation& separation = mCollisionCachedSeparations[collpair];
+                    separation.pgeom1 = collpair.first->collisionGeometry();
+                    separation.pgeom2 = collpair.second->collisionGeometry();
+                    separation.t1 = collpair.first->getTransform();
+                    separation.t2 = collpair.second->getTransform();
+                    separation.distance = distance;
+                }
+            }
+        }
 #endif
 
         if( numContacts > 0 ) {
@@ -1081,7 +2264,15 @@ private:
 
                 pcb->_report->plink1 = _reportcache.plink1;
                 pcb->_report->plink2 = _reportcache.plink2;
-                if( pcb->_report->contacts.size() == 0) {
+                if( pcb->_report->bFixedCapacity ) {
+                    // the report owns preallocated buffers, so do not swap them away
+                    FOREACHC(itcontact, _reportcache.contacts) {
+                        if( !pcb->_report->AddContact(*itcontact) ) {
+                            break;
+                        }
+                    }
+                }
+                else if( pcb->_report->contacts.size() == 0) {
                     pcb->_report->contacts.swap(_reportcache.contacts);
                 } else {
                     pcb->_report->contacts.reserve(pcb->_report->contacts.size() + numContacts);
@@ -1091,11 +2282,7 @@ private:
                 if( _options & OpenRAVE::CO_AllLinkCollisions ) {
                     // We maintain vLinkColliding ordered
                     LinkPair linkPair = MakeLinkPair(plink1, plink2);
-                    typedef std::vector< std::pair< LinkConstPtr, LinkConstPtr > >::iterator PairIterator;
-                    PairIterator end = pcb->_report->vLinkColliding.end(), first = std::lower_bound(pcb->_report->vLinkColliding.begin(), end, linkPair);
-                    if( first == end || *first != linkPair ) {
-                        pcb->_report->vLinkColliding.insert(first, linkPair);
-                    }
+                    pcb->_report->AddLinkColliding(linkPair.first, linkPair.second);
                 }
 
                 pcb->_bCollision = true;
@@ -1218,6 +2405,24 @@ private:
     }
 #endif
 
+    /// \brief upper bound of how far any point of the geometry of o moved since its transform was tprev
+    static fcl::FCL_REAL _ComputeMaxMotion(const fcl::CollisionObject* o, const fcl::Transform3f& tprev)
+    {
+        const fcl::Transform3f& t = o->getTransform();
+        fcl::FCL_REAL fmotion = (t.getTranslation() - tprev.getTranslation()).length();
+        const fcl::Quaternion3f& q = t.getQuatRotation();
+        const fcl::Quaternion3f& qprev = tprev.getQuatRotation();
+        // cosine of half the angle rotated
+        fcl::FCL_REAL fcos = std::abs(q.getW()*qprev.getW() + q.getX()*qprev.getX() + q.getY()*qprev.getY() + q.getZ()*qprev.getZ());
+        if( fcos < 1 ) {
+            // every point of the geometry is within its local bounding sphere, so it moves at most 2*r*sin(angle/2)
+            const fcl::CollisionGeometry* pgeom = o->getCollisionGeometry();
+            fcl::FCL_REAL fradius = pgeom->aabb_center.length() + pgeom->aabb_radius;
+            fmotion += 2*fradius*std::sqrt(1-fcos*fcos);
+        }
+        return fmotion;
+    }
+
     static LinkPair MakeLinkPair(LinkConstPtr plink1, LinkConstPtr plink2)
     {
         if( plink1.get() < plink2.get() ) {
@@ -1245,15 +2450,56 @@ private:
     }
 
     inline BroadPhaseCollisionManagerPtr _CreateManager() {
+        if( _broadPhaseCollisionManagerAlgorithm == "Auto" ) {
+            return _CreateManagerFromBroadphaseAlgorithm(_GetAutoBroadphaseCandidates().at(0));
+        }
         return _CreateManagerFromBroadphaseAlgorithm(_broadPhaseCollisionManagerAlgorithm);
     }
 
+    /// \brief the algorithms the Auto broadphase algorithm chooses from, the first one is used until the queries are timed
+    static const std::vector<std::string>& _GetAutoBroadphaseCandidates()
+    {
+        static const char* s_candidatenames[] = { "DynamicAABBTree2", "DynamicAABBTree2_Array", "SaP", "IntervalTree" };
+        static const std::vector<std::string> s_vcandidates(s_candidatenames, s_candidatenames+sizeof(s_candidatenames)/sizeof(s_candidatenames[0]));
+        return s_vcandidates;
+    }
+
+    /// \brief creates a manager instance, which tunes its broadphase algorithm when the algorithm is Auto
+    FCLCollisionManagerInstancePtr _CreateManagerInstance()
+    {
+        FCLCollisionManagerInstancePtr p(new FCLCollisionManagerInstance(*_fclspace, _CreateManager()));
+        if( _broadPhaseCollisionManagerAlgorithm == "Auto" ) {
+            p->StartBroadphaseTuning(_GetAutoBroadphaseCandidates(), boost::bind(&FCLCollisionChecker::_CreateManagerFromBroadphaseAlgorithm, this, _1));
+        }
+        return p;
+    }
+
+    /// \brief returns the start time of a query of the manager if the manager is timing its queries, 0 otherwise
+    inline uint64_t _StartBroadphaseTiming(FCLCollisionManagerInstance& manager)
+    {
+        return manager.StartBroadphaseQuery() ? OpenRAVE::utils::GetNanoPerformanceTime() : 0;
+    }
+
+    void _StopBroadphaseTiming(FCLCollisionManagerInstance& manager, uint64_t starttime)
+    {
+        if( starttime == 0 ) {
+            return;
+        }
+        if( manager.AddBroadphaseQueryTime(OpenRAVE::utils::GetNanoPerformanceTime()-starttime) ) {
+            KinBodyConstPtr ptrackingbody = manager.GetTrackingBody();
+            std::string label = !!ptrackingbody ? str(boost::format("body %s")%ptrackingbody->GetName()) : std::string("env");
+            std::string summary = manager.GetBroadphaseTuningSummary();
+            RAVELOG_DEBUG_FORMAT("env=%d, %s manager chose broadphase algorithm %s (%s)", GetEnv()->GetId()%label%manager.GetBroadphaseAlgorithm()%summary);
+            ADD_BROADPHASE_DECISION(_statistics, label, manager.GetBroadphaseAlgorithm(), summary);
+        }
+    }
+
     FCLCollisionManagerInstance& _GetBodyManager(KinBodyConstPtr pbody, bool bactiveDOFs)
     {
         _bParentlessCollisionObject = false;
         BODYMANAGERSMAP::iterator it = _bodymanagers.find(std::make_pair(pbody.get(), (int)bactiveDOFs));
         if( it == _bodymanagers.end() ) {
-            FCLCollisionManagerInstancePtr p(new FCLCollisionManagerInstance(*_fclspace, _CreateManager()));
+            FCLCollisionManagerInstancePtr p = _CreateManagerInstance();
             p->InitBodyManager(pbody, bactiveDOFs);
             it = _bodymanagers.insert(BODYMANAGERSMAP::value_type(std::make_pair(pbody.get(), (int)bactiveDOFs), p)).first;
         }
@@ -1290,8 +2536,8 @@ private:
 
         std::map<std::set<int>, FCLCollisionManagerInstancePtr>::iterator it = _envmanagers.find(setExcludeBodyIds);
         if( it == _envmanagers.end() ) {
-            FCLCollisionManagerInstancePtr p(new FCLCollisionManagerInstance(*_fclspace, _CreateManager()));
-            p->InitEnvironment(excludedbodies);
+            FCLCollisionManagerInstancePtr p = _CreateManagerInstance();
+            p->InitEnvironment(excludedbodies, _CreateManager());
             it = _envmanagers.insert(std::map<std::set<int>, FCLCollisionManagerInstancePtr>::value_type(setExcludeBodyIds, p)).first;
         }
         it->second->EnsureBodies(_fclspace->GetEnvBodies());
@@ -1376,6 +2622,20 @@ private:
     BODYMANAGERSMAP _bodymanagers; ///< managers for each of the individual bodies. each manager should be called with InitBodyManager. Cannot use KinBodyPtr here since that will maintain a reference to the body!
     std::map< std::set<int>, FCLCollisionManagerInstancePtr> _envmanagers;
     int _nGetEnvManagerCacheClearCount; ///< count down until cache can be cleared
+    int _nBatchThreads; ///< number of threads CheckCollisionConfigurations splits the configurations across
+    BatchWorkerPool _batchworkerpool; ///< threads of the parallel batch and self collision checks
+    int _nSelfCollisionThreads; ///< number of threads CheckStandaloneSelfCollision splits the link pairs of a body across
+    size_t _nSelfCollisionMinLinks; ///< minimum number of links of a body for its self collision to be checked by _nSelfCollisionThreads threads
+    int _nContinuousMaxIterations; ///< maximum number of iterations of the fcl continuous collision solvers used by CheckContinuousCollision
+    OpenRAVE::planningutils::SignedDistanceFieldPtr _pstaticdistancefield; ///< computed by ComputeStaticDistanceField, shared with clones since it is never modified
+    int _nStaticDistanceFieldStamp; ///< the static bodies update stamp of _fclspace when _pstaticdistancefield was computed, CheckCollisionConfigurations only uses the field while it is the same
+    bool _bStaticDistanceFieldPendingStamp; ///< true if the checker was cloned with a valid field and _nStaticDistanceFieldStamp is set at the next batch
+    std::map<std::pair<int, int>, std::vector<TrackedLinkPair> > _mapTrackedLinkPairs; ///< environment ids of the two bodies of GetTrackedLinkPairDistances to their link pairs, indexed by ilink1*numlinks2+ilink2
+    std::vector<TrackedGeomPair*> _vTrackedCandidates; ///< cache for _GetTrackedDistance
+    fcl::CollisionRequest _trackedCollisionRequest;
+    fcl::CollisionResult _trackedCollisionResult;
+    fcl::DistanceRequest _trackedDistanceRequest;
+    fcl::DistanceResult _trackedDistanceResult;
 
 #ifdef FCLRAVE_COLLISION_OBJECTS_STATISTICS
     std::map<fcl::CollisionObject*, int> _currentlyused;
@@ -1384,18 +2644,26 @@ private:
 
 #ifdef NARROW_COLLISION_CACHING
     NarrowCollisionCache mCollisionCachedGuesses;
+    NarrowSeparationCache mCollisionCachedSeparations; ///< pairs of primitives that can be skipped while they move less than their last distance
+    fcl::DistanceRequest _separationDistanceRequest;
+    fcl::DistanceResult _separationDistanceResult;
 #endif
 
 #ifdef FCLUSESTATISTICS
     FCLStatisticsPtr _statistics;
 #endif
 
+    OpenRAVE::PerfCounterPtr _pcounterqueries; ///< number of collision queries
+    OpenRAVE::PerfCounterPtr _pcounternarrowphase; ///< number and duration in ns of the fcl::collide calls between two geometries
+
     // In order to reduce allocations during collision checking
 
     CollisionReport _reportcache;
     std::vector<fcl::Vec3f> _fclPointsCache;
     std::vector<fcl::Triangle> _fclTrianglesCache;
     std::vector<KinBodyPtr> _vCachedGrabbedBodies;
+    std::vector<int> _vCachedMovedLinkIndices;
+    std::vector<Transform> _vCachedLinkTransforms, _vCachedContinuousStartTransforms, _vCachedContinuousEndTransforms;
 
     bool _bIsSelfCollisionChecker; // Currently not used
     bool _bParentlessCollisionObject; ///< if set to true, the last collision command ran into colliding with an unknown object
@@ -95,7 +95,7 @@ class FCLCollisionManagerInstance : public boost::enable_shared_from_this<FCLCol
     };
 
 public:
-    FCLCollisionManagerInstance(FCLSpace& fclspace, BroadPhaseCollisionManagerPtr pmanager) : _fclspace(fclspace), pmanager(pmanager) {
+    FCLCollisionManagerInstance(FCLSpace& fclspace, BroadPhaseCollisionManagerPtr pmanager) : _fclspace(fclspace), pmanager(pmanager), _nStaticBodiesUpdateStamp(0) {
         _lastSyncTimeStamp = OpenRAVE::utils::GetMilliTime();
     }
     ~FCLCollisionManagerInstance() {
@@ -110,6 +110,13 @@ public:
             it->second.vcolobjs.clear();
         }
         mapCachedBodies.clear();
+        if( !!pstaticmanager ) {
+            pstaticmanager->clear();
+        }
+        FOREACH(it, mapStaticBodies) {
+            it->second.vcolobjs.clear();
+        }
+        mapStaticBodies.clear();
     }
 
     /// \brief sets up manager for body checking
@@ -199,7 +206,9 @@ public:
     }
 
     /// \brief sets up manager for environment checking
-    void InitEnvironment(const std::set<KinBodyConstPtr>& excludedbodies)
+    ///
+    /// \param pstaticmanager if set, holds the bodies marked static in the fcl space so that \ref Synchronize does not have to go through them
+    void InitEnvironment(const std::set<KinBodyConstPtr>& excludedbodies, BroadPhaseCollisionManagerPtr pstaticmanager=BroadPhaseCollisionManagerPtr())
     {
         _ptrackingbody.reset();
         _setExcludeBodyIds.clear();
@@ -209,25 +218,46 @@ public:
             _setExcludeBodyIds.insert((*itbody)->GetEnvironmentId());
         }
         pmanager->setup();
+        this->pstaticmanager = pstaticmanager;
+        FOREACH(it, mapStaticBodies) {
+            it->second.vcolobjs.resize(0);
+        }
+        mapStaticBodies.clear();
+        _nStaticBodiesUpdateStamp = _fclspace.GetStaticBodiesUpdateStamp();
+        if( !!pstaticmanager ) {
+            pstaticmanager->clear();
+            pstaticmanager->setup();
+        }
     }
 
     /// \brief makes sure that all the bodies are currently in the scene (if they are not explicitly excluded)
     void EnsureBodies(const std::set<KinBodyConstPtr>& vbodies)
     {
+        if( !!pstaticmanager && _nStaticBodiesUpdateStamp != _fclspace.GetStaticBodiesUpdateStamp() ) {
+            _ResetStaticBodies();
+        }
         _tmpbuffer.resize(0);
+        _tmpstaticbuffer.resize(0);
         std::vector<CollisionObjectPtr> vcolobjs;
         FOREACH(itbody, vbodies) {
             int bodyid = (*itbody)->GetEnvironmentId();
             if( _setExcludeBodyIds.count(bodyid) == 0 ) {
                 std::map<int, KinBodyCache>::iterator it = mapCachedBodies.find(bodyid);
-                if( it == mapCachedBodies.end() ) {
+                if( it == mapCachedBodies.end() && mapStaticBodies.find(bodyid) == mapStaticBodies.end() ) {
                     FCLSpace::KinBodyInfoPtr pinfo = _fclspace.GetInfo(**itbody);
+                    bool bStatic = !!pstaticmanager && !!pinfo && pinfo->bStatic;
+                    size_t numprevobjs = _tmpbuffer.size();
                     _linkEnableStates.resize((*itbody)->GetLinks().size()); ///< links that are currently inside the manager
                     std::fill(_linkEnableStates.begin(), _linkEnableStates.end(), 0);
                     if( _AddBody(*itbody, pinfo, vcolobjs, _linkEnableStates, false) ) { // new collision objects are already added to _tmpbuffer
-                        mapCachedBodies[bodyid] = KinBodyCache(*itbody, pinfo);
-                        mapCachedBodies[bodyid].vcolobjs.swap(vcolobjs);
-                        mapCachedBodies[bodyid].linkEnableStates = _linkEnableStates;
+                        std::map<int, KinBodyCache>& mapbodies = bStatic ? mapStaticBodies : mapCachedBodies;
+                        mapbodies[bodyid] = KinBodyCache(*itbody, pinfo);
+                        mapbodies[bodyid].vcolobjs.swap(vcolobjs);
+                        mapbodies[bodyid].linkEnableStates = _linkEnableStates;
+                        if( bStatic ) {
+                            _tmpstaticbuffer.insert(_tmpstaticbuffer.end(), _tmpbuffer.begin()+numprevobjs, _tmpbuffer.end());
+                            _tmpbuffer.resize(numprevobjs);
+                        }
                     }
                 }
             }
@@ -238,6 +268,11 @@ public:
 #endif
             pmanager->registerObjects(_tmpbuffer); // bulk update
         }
+        if( _tmpstaticbuffer.size() > 0 ) {
+            pstaticmanager->registerObjects(_tmpstaticbuffer);
+            pstaticmanager->setup();
+            _tmpstaticbuffer.resize(0);
+        }
     }
 
     /// \brief ensures that pbody is being tracked inside the manager
@@ -280,6 +315,17 @@ public:
             mapCachedBodies.erase(it);
             return true;
         }
+        it = mapStaticBodies.find(body.GetEnvironmentId());
+        if( it != mapStaticBodies.end() ) {
+            FOREACH(itcol, it->second.vcolobjs) {
+                if( !!itcol->get() ) {
+                    pstaticmanager->unregisterObject(itcol->get());
+                }
+            }
+            it->second.vcolobjs.resize(0);
+            mapStaticBodies.erase(it);
+            return true;
+        }
 
         return false;
     }
@@ -422,13 +468,21 @@ public:
             if( pinfo != pnewinfo ) {
                 // everything changed!
                 RAVELOG_VERBOSE_FORMAT("%u body %s entire KinBodyInfo changed", _lastSyncTimeStamp%pbody->GetName());
-                FOREACH(itcolobj, itcache->second.vcolobjs) {
-                    if( !!itcolobj->get() ) {
-                        pmanager->unregisterObject(itcolobj->get());
+                if( itcache->second.vcolobjs.size() == pnewinfo->vlinks.size() ) {
+                    // usually the geometry group was switched to an info that is already built, so only swap the objects of the links
+                    if( _SwapBodyInfo(pbody, pnewinfo, itcache->second.vcolobjs, itcache->second.linkEnableStates, _bTrackActiveDOF&&pbody==ptrackingbody) ) {
+                        bcallsetup = true;
                     }
                 }
-                itcache->second.vcolobjs.resize(0);
-                _AddBody(pbody, pnewinfo, itcache->second.vcolobjs, itcache->second.linkEnableStates, _bTrackActiveDOF&&pbody==ptrackingbody);
+                else {
+                    FOREACH(itcolobj, itcache->second.vcolobjs) {
+                        if( !!itcolobj->get() ) {
+                            pmanager->unregisterObject(itcolobj->get());
+                        }
+                    }
+                    itcache->second.vcolobjs.resize(0);
+                    _AddBody(pbody, pnewinfo, itcache->second.vcolobjs, itcache->second.linkEnableStates, _bTrackActiveDOF&&pbody==ptrackingbody);
+                }
                 itcache->second.pwinfo = pnewinfo;
                 //itcache->second.ResetStamps();
                 // need to update the stamps here so that we do not try to unregisterObject below and get into an error
@@ -698,10 +752,145 @@ public:
         }
     }
 
+    /// \brief Synchronizes the manager when only the given links of body moved since the last synchronization
+    ///
+    /// The collision objects of the links are updated in place, any other change is handled by \ref Synchronize.
+    void SynchronizeLinks(const KinBody& body, const std::vector<int>& vlinkindices)
+    {
+        std::map<int, KinBodyCache>::iterator itcache = mapCachedBodies.find(body.GetEnvironmentId());
+        if( itcache != mapCachedBodies.end() ) {
+            KinBodyCache& cache = itcache->second;
+            FCLSpace::KinBodyInfoPtr pinfo = cache.pwinfo.lock();
+            if( !!pinfo && pinfo->nLastStamp != cache.nLastStamp && pinfo->nLinkUpdateStamp == cache.nLinkUpdateStamp && pinfo->nGeometryUpdateStamp == cache.nGeometryUpdateStamp && pinfo->nActiveDOFUpdateStamp == cache.nActiveDOFUpdateStamp ) {
+                bool bupdated = false;
+                FOREACHC(itlinkindex, vlinkindices) {
+                    if( !cache.linkEnableStates.at(*itlinkindex) ) {
+                        continue;
+                    }
+                    CollisionObjectPtr pcolobj = _fclspace.GetLinkBV(*pinfo, *itlinkindex);
+                    if( cache.vcolobjs.at(*itlinkindex) != pcolobj ) {
+                        // collision object was replaced, so have to go through the full synchronization
+                        Synchronize();
+                        return;
+                    }
+                    if( !!pcolobj ) {
+#ifdef FCLRAVE_USE_BULK_UPDATE
+                        pmanager->update(pcolobj.get(), false);
+#else
+                        pmanager->update(pcolobj.get());
+#endif
+                        bupdated = true;
+                    }
+                }
+                cache.nLastStamp = pinfo->nLastStamp;
+                if( bupdated ) {
+                    pmanager->setup();
+                }
+            }
+        }
+        Synchronize();
+    }
+
     inline BroadPhaseCollisionManagerPtr GetManager() const {
         return pmanager;
     }
 
+    /// \brief returns the manager of the static bodies, which has to be queried in addition to \ref GetManager. Empty if there are no static bodies.
+    inline BroadPhaseCollisionManagerPtr GetStaticManager() const {
+        return mapStaticBodies.size() > 0 ? pstaticmanager : BroadPhaseCollisionManagerPtr();
+    }
+
+    /// \brief starts sampling the query times of every candidate broadphase algorithm on the queries of this manager, after which the fastest one is kept
+    ///
+    /// The candidates are tried in turns of a few queries each so that they all see the same query mix. The tuning restarts when the number of objects in the manager changes a lot.
+    /// \param vcandidates the algorithms to choose from, the current manager has to use the first one
+    /// \param createmanager creates an empty manager of a candidate algorithm
+    void StartBroadphaseTuning(const std::vector<std::string>& vcandidates, const boost::function<BroadPhaseCollisionManagerPtr (const std::string&)>& createmanager)
+    {
+        OPENRAVE_ASSERT_OP(vcandidates.size(),>,0);
+        _broadphasealgorithm = vcandidates[0];
+        _ptuning.reset(new BroadphaseTuning());
+        _ptuning->vcandidates = vcandidates;
+        _ptuning->createmanager = createmanager;
+        _RestartBroadphaseTuning();
+    }
+
+    /// \brief returns true if the next query should be timed and given to AddBroadphaseQueryTime
+    inline bool StartBroadphaseQuery()
+    {
+        if( !_ptuning ) {
+            return false;
+        }
+        if( _ptuning->bTuning ) {
+            return true;
+        }
+        if( ++_ptuning->nQueriesSinceDecision >= BroadphaseTuning::s_nRetuneCheckQueries ) {
+            _ptuning->nQueriesSinceDecision = 0;
+            size_t numobjects = pmanager->size();
+            if( numobjects > 2*_ptuning->numDecisionObjects+8 || 2*numobjects+8 < _ptuning->numDecisionObjects ) {
+                _RestartBroadphaseTuning();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief adds the time of a query started with StartBroadphaseQuery to the current candidate
+    ///
+    /// \return true if the tuning just chose an algorithm
+    bool AddBroadphaseQueryTime(uint64_t querytime)
+    {
+        BroadphaseTuning& tuning = *_ptuning;
+        tuning.vquerytimes.at(tuning.icandidate) += querytime;
+        tuning.vnumqueries.at(tuning.icandidate) += 1;
+        if( ++tuning.nBlockQueries < BroadphaseTuning::s_nBlockQueries ) {
+            return false;
+        }
+        tuning.nBlockQueries = 0;
+        if( ++tuning.icandidate >= (int)tuning.vcandidates.size() ) {
+            tuning.icandidate = 0;
+            if( ++tuning.nRound >= BroadphaseTuning::s_nRounds ) {
+                int ibest = 0;
+                for(size_t i = 1; i < tuning.vcandidates.size(); ++i) {
+                    if( tuning.vquerytimes[i]*tuning.vnumqueries[ibest] < tuning.vquerytimes[ibest]*tuning.vnumqueries[i] ) {
+                        ibest = i;
+                    }
+                }
+                _SetBroadphaseAlgorithm(tuning.vcandidates[ibest]);
+                tuning.bTuning = false;
+                tuning.nQueriesSinceDecision = 0;
+                tuning.numDecisionObjects = pmanager->size();
+                return true;
+            }
+        }
+        _SetBroadphaseAlgorithm(tuning.vcandidates.at(tuning.icandidate));
+        return false;
+    }
+
+    /// \brief returns the mean query time of every candidate of the last tuning, e.g. "SaP=3.2us IntervalTree=4.1us"
+    std::string GetBroadphaseTuningSummary() const
+    {
+        std::stringstream ss;
+        if( !!_ptuning ) {
+            for(size_t i = 0; i < _ptuning->vcandidates.size(); ++i) {
+                if( i > 0 ) {
+                    ss << " ";
+                }
+                ss << _ptuning->vcandidates[i] << "=" << (_ptuning->vnumqueries[i] > 0 ? 1e-3*_ptuning->vquerytimes[i]/_ptuning->vnumqueries[i] : 0) << "us";
+            }
+        }
+        return ss.str();
+    }
+
+    /// \brief returns the broadphase algorithm currently used, empty if the manager was created directly with an algorithm
+    inline const std::string& GetBroadphaseAlgorithm() const {
+        return _broadphasealgorithm;
+    }
+
+    inline KinBodyConstPtr GetTrackingBody() const {
+        return _ptrackingbody.lock();
+    }
+
     inline uint32_t GetLastSyncTimeStamp() const {
         return _lastSyncTimeStamp;
     }
@@ -727,6 +916,86 @@ public:
     }
 
 private:
+    /// \brief state of the broadphase algorithm tuning, see StartBroadphaseTuning
+    struct BroadphaseTuning
+    {
+        static const int s_nBlockQueries = 32; ///< number of queries timed with a candidate before switching to the next one
+        static const int s_nRounds = 2; ///< number of times every candidate is tried
+        static const int s_nRetuneCheckQueries = 1024; ///< number of queries between checks of the number of objects once an algorithm is chosen
+
+        std::vector<std::string> vcandidates;
+        boost::function<BroadPhaseCollisionManagerPtr (const std::string&)> createmanager;
+        std::vector<uint64_t> vquerytimes; ///< sum of the query times of every candidate in nanoseconds
+        std::vector<int> vnumqueries; ///< number of timed queries of every candidate
+        int icandidate; ///< the candidate currently used
+        int nBlockQueries; ///< number of queries timed with the current candidate in this turn
+        int nRound;
+        bool bTuning; ///< true while timing the candidates, false once one is chosen
+        int nQueriesSinceDecision;
+        size_t numDecisionObjects; ///< number of objects in the manager when the algorithm was chosen
+    };
+
+    void _RestartBroadphaseTuning()
+    {
+        BroadphaseTuning& tuning = *_ptuning;
+        tuning.vquerytimes.assign(tuning.vcandidates.size(), 0);
+        tuning.vnumqueries.assign(tuning.vcandidates.size(), 0);
+        tuning.icandidate = 0;
+        tuning.nBlockQueries = 0;
+        tuning.nRound = 0;
+        tuning.bTuning = tuning.vcandidates.size() > 1;
+        tuning.nQueriesSinceDecision = 0;
+        tuning.numDecisionObjects = pmanager->size();
+        _SetBroadphaseAlgorithm(tuning.vcandidates[0]);
+    }
+
+    /// \brief moves all the objects to a new manager of the algorithm
+    void _SetBroadphaseAlgorithm(const std::string& algorithm)
+    {
+        if( _broadphasealgorithm == algorithm ) {
+            return;
+        }
+        BroadPhaseCollisionManagerPtr pnewmanager = _ptuning->createmanager(algorithm);
+        std::vector<fcl::CollisionObject*> vobjects;
+        pmanager->getObjects(vobjects);
+        if( vobjects.size() > 0 ) {
+            pnewmanager->registerObjects(vobjects);
+        }
+        pnewmanager->setup();
+        pmanager->clear();
+        pmanager = pnewmanager;
+        _broadphasealgorithm = algorithm;
+    }
+
+    /// \brief removes all the static bodies and the bodies that became static, so that EnsureBodies adds them to the right manager again
+    void _ResetStaticBodies()
+    {
+        RAVELOG_VERBOSE_FORMAT("%u static bodies changed, rebuilding the static manager of %d bodies", _lastSyncTimeStamp%mapStaticBodies.size());
+        pstaticmanager->clear();
+        FOREACH(it, mapStaticBodies) {
+            it->second.vcolobjs.resize(0);
+        }
+        mapStaticBodies.clear();
+        std::map<int, KinBodyCache>::iterator itcache = mapCachedBodies.begin();
+        while(itcache != mapCachedBodies.end()) {
+            KinBodyConstPtr pbody = itcache->second.pwbody.lock();
+            FCLSpace::KinBodyInfoPtr pinfo = !!pbody && pbody->GetEnvironmentId() != 0 ? _fclspace.GetInfo(*pbody) : FCLSpace::KinBodyInfoPtr();
+            if( !!pinfo && pinfo->bStatic ) {
+                FOREACH(itcolobj, itcache->second.vcolobjs) {
+                    if( !!itcolobj->get() ) {
+                        pmanager->unregisterObject(itcolobj->get());
+                    }
+                }
+                itcache->second.vcolobjs.resize(0);
+                mapCachedBodies.erase(itcache++);
+            }
+            else {
+                ++itcache;
+            }
+        }
+        _nStaticBodiesUpdateStamp = _fclspace.GetStaticBodiesUpdateStamp();
+    }
+
     /// \brief adds a body to the manager, returns true if something was added
     ///
     /// should not add anything to mapCachedBodies! append to _tmpbuffer
@@ -757,6 +1026,51 @@ private:
         return bsetUpdateStamp;
     }
 
+    /// \brief replaces the collision objects of the links of a body in the manager by the ones of pinfo without re-registering the other objects
+    ///
+    /// \param vcolobjs the objects of the links currently in the manager, same size as pinfo->vlinks
+    /// \return true if the manager changed
+    bool _SwapBodyInfo(KinBodyConstPtr pbody, FCLSpace::KinBodyInfoPtr pinfo, std::vector<CollisionObjectPtr>& vcolobjs, std::vector<uint8_t>& linkEnableStates, bool bTrackActiveDOF)
+    {
+        bool bchanged = false;
+        linkEnableStates.resize(pbody->GetLinks().size());
+        FOREACH(itlink, pbody->GetLinks()) {
+            int ilink = (*itlink)->GetIndex();
+            CollisionObjectPtr pcolobj;
+            if( (*itlink)->IsEnabled() && (!bTrackActiveDOF || _vTrackingActiveLinks.at(ilink)) ) {
+                pcolobj = _fclspace.GetLinkBV(*pinfo, ilink);
+            }
+            CollisionObjectPtr& poldcolobj = vcolobjs.at(ilink);
+            if( poldcolobj != pcolobj ) {
+                if( !!pcolobj ) {
+#ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
+                    SaveCollisionObjectDebugInfos(pcolobj.get());
+#endif
+#ifdef FCLRAVE_USE_REPLACEOBJECT
+                    if( !!poldcolobj ) {
+                        pmanager->replaceObject(poldcolobj.get(), pcolobj.get(), false);
+                    }
+                    else {
+                        pmanager->registerObject(pcolobj.get());
+                    }
+#else
+                    if( !!poldcolobj ) {
+                        pmanager->unregisterObject(poldcolobj.get());
+                    }
+                    pmanager->registerObject(pcolobj.get());
+#endif
+                }
+                else {
+                    pmanager->unregisterObject(poldcolobj.get());
+                }
+                poldcolobj = pcolobj;
+                bchanged = true;
+            }
+            linkEnableStates.at(ilink) = !!pcolobj;
+        }
+        return bchanged;
+    }
+
     void _UpdateActiveLinks(RobotBaseConstPtr probot)
     {
         _vTrackingActiveLinks.resize(probot->GetLinks().size());
@@ -802,10 +1116,14 @@ private:
     FCLSpace& _fclspace; ///< reference for speed
     BroadPhaseCollisionManagerPtr pmanager;
     std::map<int, KinBodyCache> mapCachedBodies; ///< pair of (body id, (weak body, updatestamp)) where the key is KinBody::GetEnvironmentId
+    BroadPhaseCollisionManagerPtr pstaticmanager; ///< if set, contains the static bodies of an environment manager, it is only rebuilt when one of them changes
+    std::map<int, KinBodyCache> mapStaticBodies; ///< the bodies inside pstaticmanager, they are not synchronized
+    int _nStaticBodiesUpdateStamp; ///< FCLSpace::GetStaticBodiesUpdateStamp when pstaticmanager was last rebuilt
     uint32_t _lastSyncTimeStamp; ///< timestamp when last synchronized
 
     std::set<int> _setExcludeBodyIds; ///< any bodies that should not be considered inside the manager, used with environment mode
     CollisionGroup _tmpbuffer; ///< cache
+    CollisionGroup _tmpstaticbuffer; ///< cache of the objects to add to pstaticmanager
 
     KinBodyConstWeakPtr _ptrackingbody; ///< if set, then only tracking the attached bodies if this body
     std::vector<int> _vTrackingActiveLinks; ///< indices of which links are active for tracking body
@@ -813,6 +1131,9 @@ private:
 
     bool _bTrackActiveDOF; ///< if true and _ptrackingbody is valid, then should be tracking the active dof of the _ptrackingbody
 
+    boost::shared_ptr<BroadphaseTuning> _ptuning; ///< set if the broadphase algorithm is chosen by timing the queries
+    std::string _broadphasealgorithm; ///< algorithm of pmanager when tuning
+
 #ifdef FCLRAVE_DEBUG_COLLISION_OBJECTS
     void SaveCollisionObjectDebugInfos() {
         FOREACH(itpcollobj, _tmpbuffer) {
@@ -3,9 +3,12 @@
 #define OPENRAVE_FCL_SPACE
 
 #include <boost/shared_ptr.hpp>
+#include <boost/functional/hash.hpp>
 #include <memory> // c++11
 #include <vector>
 
+#include "fclbvhcache.h"
+
 namespace fclrave {
 
 typedef KinBody::LinkConstPtr LinkConstPtr;
@@ -100,6 +103,7 @@ public:
                     (*itgeompair).second.reset();
                 }
                 vgeoms.resize(0);
+                vcoarsespheres.resize(0);
             }
 
             KinBody::LinkPtr GetLink() {
@@ -111,11 +115,12 @@ public:
             //int nLastStamp; ///< Tracks if the collision geometries are up to date wrt the body update stamp. This is for narrow phase collision
             TransformCollisionPair linkBV; ///< pair of the transformation and collision object corresponding to a bounding OBB for the link
             std::vector<TransformCollisionPair> vgeoms; ///< vector of transformations and collision object; one per geometries
+            std::vector< std::pair<fcl::Vec3f, fcl::FCL_REAL> > vcoarsespheres; ///< centers in the frame of linkBV and radii of spheres containing all of vgeoms, only computed when coarse checking is on
             std::string bodylinkname; // for debugging purposes
             bool bFromKinBodyLink; ///< if true, then from kinbodylink. Otherwise from standalone object that does not have any KinBody associations
         };
 
-        KinBodyInfo() : nLastStamp(0), nLinkUpdateStamp(0), nGeometryUpdateStamp(0), nAttachedBodiesUpdateStamp(0), nActiveDOFUpdateStamp(0)
+        KinBodyInfo() : nLastStamp(0), nLinkUpdateStamp(0), nGeometryUpdateStamp(0), nAttachedBodiesUpdateStamp(0), nActiveDOFUpdateStamp(0), bStatic(false)
         {
         }
 
@@ -145,6 +150,7 @@ public:
         int nGeometryUpdateStamp; ///< update stamp for geometry update state (increases every time geometry enables change)
         int nAttachedBodiesUpdateStamp; ///< update stamp for when attached bodies change of this body
         int nActiveDOFUpdateStamp; ///< update stamp for when active dofs change of this body
+        bool bStatic; ///< if true, the body was marked as never moving, see \ref FCLSpace::SetStaticBodyNames
 
         vector< boost::shared_ptr<LinkInfo> > vlinks; ///< info for every link of the kinbody
 
@@ -167,7 +173,7 @@ public:
     typedef boost::function<void (KinBodyInfoPtr)> SynchronizeCallbackFn;
 
     FCLSpace(EnvironmentBasePtr penv, const std::string& userdatakey)
-        : _penv(penv), _userdatakey(userdatakey), _bIsSelfCollisionChecker(true)
+        : _penv(penv), _userdatakey(userdatakey), _nCoarseMaxSpheres(0), _nStaticBodiesUpdateStamp(0), _bIsSelfCollisionChecker(true)
     {
 
         // After many test, OBB seems to be the only real option (followed by kIOS which is needed for distance checking)
@@ -205,6 +211,8 @@ public:
         pinfo->_pbody = boost::const_pointer_cast<KinBody>(pbody);
         // make sure that synchronization do occur !
         pinfo->nLastStamp = pbody->GetUpdateStamp() - 1;
+        pinfo->bStatic = _setStaticBodyNames.count(pbody->GetName()) > 0;
+        _NotifyStaticBodyChanged(*pinfo);
 
         pinfo->vlinks.reserve(pbody->GetLinks().size());
         FOREACHC(itlink, pbody->GetLinks()) {
@@ -224,7 +232,7 @@ public:
                         int igeominfo = itgeominfo - vgeometryinfos.begin();
                         throw OpenRAVE::OpenRAVEException(str(boost::format("Failed to access geometry info %d for link %s:%s with geometrygroup %s")%igeominfo%plink->GetParent()->GetName()%plink->GetName()%pinfo->_geometrygroup), OpenRAVE::ORE_InvalidState);
                     }
-                    const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(_meshFactory, *pgeominfo);
+                    const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(_meshFactory, _bvhRepresentation, *pgeominfo);
 
                     if( !pfclgeom ) {
                         continue;
@@ -248,7 +256,7 @@ public:
                 const std::vector<KinBody::Link::GeometryPtr> & vgeometries = plink->GetGeometries();
                 FOREACH(itgeom, vgeometries) {
                     const KinBody::GeometryInfo& geominfo = (*itgeom)->GetInfo();
-                    const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(_meshFactory, geominfo);
+                    const CollisionGeometryPtr pfclgeom = _CreateFCLGeomFromGeometryInfo(_meshFactory, _bvhRepresentation, geominfo);
 
                     if( !pfclgeom ) {
                         continue;
@@ -279,6 +287,13 @@ public:
                 Transform trans(Vector(1,0,0,0),ConvertVectorFromFCL(0.5 * (enclosingBV.min_ + enclosingBV.max_)));
                 pfclcollBV->setUserData(linkinfo.get());
                 linkinfo->linkBV = std::make_pair(trans, pfclcollBV);
+
+                if( _nCoarseMaxSpheres > 0 ) {
+                    plink->ComputeBoundingSpheres(_vCachedCoarseSpheres, _nCoarseMaxSpheres, pinfo->_geometrygroup);
+                    FOREACHC(itsphere, _vCachedCoarseSpheres) {
+                        linkinfo->vcoarsespheres.push_back(std::make_pair(ConvertVectorToFCL(itsphere->first - trans.trans), itsphere->second));
+                    }
+                }
             }
 
             //link->nLastStamp = pinfo->nLastStamp;
@@ -346,6 +361,10 @@ public:
 
         // Save the already existing KinBodyInfoPtr for the old geometry group
         KinBodyInfoPtr poldinfo = GetInfo(*pbody);
+        if( !poldinfo ) {
+            // body was never initialized in this space
+            return false;
+        }
         if( poldinfo->_geometrygroup == groupname ) {
             return true;
         }
@@ -366,6 +385,7 @@ public:
             RAVELOG_VERBOSE_FORMAT("env=%d, switching to geometry %s for kinbody %s (id = %d)", _penv->GetId()%groupname%pbody->GetName()%pbody->GetEnvironmentId());
             // Set the current info to use the KinBodyInfoPtr associated to groupname
             _currentpinfo[pbody->GetEnvironmentId()] = pinfo;
+            _NotifyStaticBodyChanged(*pinfo);
 
             // Revoke the information inside the cache so that a potentially outdated object does not survive
             _cachedpinfo[(pbody)->GetEnvironmentId()].erase(groupname);
@@ -434,6 +454,26 @@ public:
         return _bvhRepresentation;
     }
 
+    /// \brief sets the maximum number of bounding spheres computed for every link, 0 disables them. Reinitializes all the bodies if changed.
+    void SetCoarseMaxSpheres(int nMaxSpheres)
+    {
+        nMaxSpheres = std::max(0, nMaxSpheres);
+        if( nMaxSpheres == _nCoarseMaxSpheres ) {
+            return;
+        }
+        _nCoarseMaxSpheres = nMaxSpheres;
+        FOREACH(itbody, _setInitializedBodies) {
+            KinBodyInfoPtr pinfo = GetInfo(**itbody);
+            pinfo->nGeometryUpdateStamp++;
+            InitKinBody(*itbody, pinfo);
+        }
+        _cachedpinfo.clear();
+    }
+
+    inline int GetCoarseMaxSpheres() const {
+        return _nCoarseMaxSpheres;
+    }
+
 
     void Synchronize()
     {
@@ -467,6 +507,83 @@ public:
         }
     }
 
+    /// \brief synchronizes only the collision objects of the given links of body
+    ///
+    /// Assumes that the other links did not move since the last synchronization, which is the case when only a subset of the dofs changed.
+    void SynchronizeLinks(const KinBody &body, const std::vector<int>& vlinkindices)
+    {
+        KinBodyInfoPtr pinfo = GetInfo(body);
+        if( !pinfo ) {
+            return;
+        }
+        BOOST_ASSERT( pinfo->GetBody().get() == &body);
+        if( pinfo->nLastStamp != body.GetUpdateStamp() ) {
+            pinfo->nLastStamp = body.GetUpdateStamp();
+            _NotifyStaticBodyChanged(*pinfo);
+            FOREACHC(itlinkindex, vlinkindices) {
+                SynchronizeLink(*pinfo->vlinks.at(*itlinkindex), body.GetLinks().at(*itlinkindex)->GetTransform());
+            }
+        }
+    }
+
+    /// \brief updates the collision objects of a link given its world transformation
+    static void SynchronizeLink(KinBodyInfo::LinkInfo& linkinfo, const Transform& tlink)
+    {
+        CollisionObjectPtr pcoll = linkinfo.linkBV.second;
+        if( !pcoll ) {
+            return;
+        }
+        Transform pose = tlink * linkinfo.linkBV.first;
+        fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
+        fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
+
+        pcoll->setTranslation(newPosition);
+        pcoll->setQuatRotation(newOrientation);
+        // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
+        pcoll->computeAABB();
+
+        //linkinfo.nLastStamp = info.nLastStamp;
+        FOREACHC(itgeomcoll, linkinfo.vgeoms) {
+            CollisionObjectPtr pcoll = (*itgeomcoll).second;
+            Transform pose = tlink * (*itgeomcoll).first;
+            fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
+            fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
+
+            pcoll->setTranslation(newPosition);
+            pcoll->setQuatRotation(newOrientation);
+            // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
+            pcoll->computeAABB();
+        }
+    }
+
+    /// \brief makes a copy of the collision objects of a body that can be moved independently of the ones in this space
+    ///
+    /// The fcl geometries are shared with the space so the copy is cheap. It can be used from other threads as long as the geometries of the body do not change.
+    KinBodyInfoPtr CopyKinBodyInfo(const KinBody &body) const
+    {
+        KinBodyInfoPtr pinfo = GetInfo(body);
+        if( !pinfo ) {
+            return KinBodyInfoPtr();
+        }
+        KinBodyInfoPtr pcopy(new KinBodyInfo());
+        pcopy->_pbody = pinfo->_pbody;
+        pcopy->nLastStamp = pinfo->nLastStamp;
+        pcopy->_geometrygroup = pinfo->_geometrygroup;
+        pcopy->vlinks.reserve(pinfo->vlinks.size());
+        FOREACHC(itlink, pinfo->vlinks) {
+            boost::shared_ptr<KinBodyInfo::LinkInfo> linkinfo(new KinBodyInfo::LinkInfo((*itlink)->GetLink()));
+            linkinfo->bodylinkname = (*itlink)->bodylinkname;
+            if( !!(*itlink)->linkBV.second ) {
+                linkinfo->linkBV = std::make_pair((*itlink)->linkBV.first, _CopyCollisionObject(*(*itlink)->linkBV.second, linkinfo.get()));
+            }
+            FOREACHC(itgeom, (*itlink)->vgeoms) {
+                linkinfo->vgeoms.push_back(TransformCollisionPair(itgeom->first, _CopyCollisionObject(*itgeom->second, linkinfo.get())));
+            }
+            pcopy->vlinks.push_back(linkinfo);
+        }
+        return pcopy;
+    }
+
     KinBodyInfoPtr GetInfo(const KinBody &body) const
     {
         int envId = body.GetEnvironmentId();
@@ -489,6 +606,7 @@ public:
             _setInitializedBodies.erase(pbody);
             KinBodyInfoPtr pinfo = GetInfo(*pbody);
             if( !!pinfo ) {
+                _NotifyStaticBodyChanged(*pinfo);
                 pinfo->Reset();
             }
             BOOST_ASSERT(pbody->GetEnvironmentId() != 0);
@@ -503,6 +621,40 @@ public:
         return _setInitializedBodies;
     }
 
+    /// \brief marks the bodies with the given names as never moving.
+    ///
+    /// The environment managers keep static bodies in a separate broadphase structure that is not synchronized on every query.
+    /// If a static body moves or changes anyway, the static structures are rebuilt.
+    void SetStaticBodyNames(const std::set<std::string>& names)
+    {
+        _setStaticBodyNames = names;
+        FOREACH(itbody, _setInitializedBodies) {
+            bool bStatic = _setStaticBodyNames.count((*itbody)->GetName()) > 0;
+            KinBodyInfoPtr pinfo = GetInfo(**itbody);
+            if( !!pinfo ) {
+                pinfo->bStatic = bStatic;
+            }
+            std::map< int, std::map< std::string, KinBodyInfoPtr > >::iterator itcached = _cachedpinfo.find((*itbody)->GetEnvironmentId());
+            if( itcached != _cachedpinfo.end() ) {
+                FOREACH(itgroupinfo, itcached->second) {
+                    if( !!itgroupinfo->second ) {
+                        itgroupinfo->second->bStatic = bStatic;
+                    }
+                }
+            }
+        }
+        ++_nStaticBodiesUpdateStamp;
+    }
+
+    const std::set<std::string>& GetStaticBodyNames() const {
+        return _setStaticBodyNames;
+    }
+
+    /// \brief increases every time a static body is added, removed, moved, or changes its geometry or link enable states
+    inline int GetStaticBodiesUpdateStamp() const {
+        return _nStaticBodiesUpdateStamp;
+    }
+
     inline CollisionObjectPtr GetLinkBV(const KinBody::Link &link) {
         return GetLinkBV(*link.GetParent(), link.GetIndex());
     }
@@ -566,6 +718,13 @@ private:
         model.addSubModel(fcl_points, fcl_triangles);
     }
 
+    static CollisionObjectPtr _CopyCollisionObject(const fcl::CollisionObject& coll, KinBodyInfo::LinkInfo* plinkinfo)
+    {
+        CollisionObjectPtr pcopy = boost::make_shared<fcl::CollisionObject>(std::const_pointer_cast<fcl::CollisionGeometry>(coll.collisionGeometry()), coll.getTransform());
+        pcopy->setUserData(plinkinfo);
+        return pcopy;
+    }
+
     static TransformCollisionPair _CreateTransformCollisionPairFromOBB(fcl::OBB const &bv) {
         CollisionGeometryPtr pbvGeom = make_shared<fcl::Box>(bv.extent[0]*2.0f, bv.extent[1]*2.0f, bv.extent[2]*2.0f);
         CollisionObjectPtr pbvColl = boost::make_shared<fcl::CollisionObject>(pbvGeom);
@@ -577,8 +736,127 @@ private:
         return std::make_pair(Transform(bvRotation, bvTranslation), pbvColl);
     }
 
+    /// \brief BVH of a mesh shared between all the spaces of the process, see _GetSharedMesh
+    class SharedMesh
+    {
+public:
+        std::string bvhrepresentation;
+        std::vector<fcl::Vec3f> points;
+        std::vector<fcl::Triangle> triangles;
+        std::weak_ptr<fcl::CollisionGeometry> pgeom;
+    };
+
+    static boost::mutex& _GetSharedMeshesMutex()
+    {
+        static boost::mutex mutex;
+        return mutex;
+    }
+
+    /// \brief maps the hash of the mesh data to the meshes with that hash
+    static std::multimap<size_t, SharedMesh>& _GetSharedMeshes()
+    {
+        static std::multimap<size_t, SharedMesh> mapmeshes;
+        return mapmeshes;
+    }
+
+    static bool _IsSameMesh(const SharedMesh& sharedmesh, const std::string& bvhrepresentation, const std::vector<fcl::Vec3f>& points, const std::vector<fcl::Triangle>& triangles)
+    {
+        if( sharedmesh.bvhrepresentation != bvhrepresentation || sharedmesh.points.size() != points.size() || sharedmesh.triangles.size() != triangles.size() ) {
+            return false;
+        }
+        for(size_t ipoint = 0; ipoint < points.size(); ++ipoint) {
+            if( sharedmesh.points[ipoint][0] != points[ipoint][0] || sharedmesh.points[ipoint][1] != points[ipoint][1] || sharedmesh.points[ipoint][2] != points[ipoint][2] ) {
+                return false;
+            }
+        }
+        for(size_t itri = 0; itri < triangles.size(); ++itri) {
+            if( sharedmesh.triangles[itri][0] != triangles[itri][0] || sharedmesh.triangles[itri][1] != triangles[itri][1] || sharedmesh.triangles[itri][2] != triangles[itri][2] ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief returns a BVH of the mesh shared with every other space that uses the same mesh data and representation.
+    ///
+    /// Cloned environments give each of their collision checkers the same link geometries, so sharing the BVHs saves building and storing every mesh once per clone.
+    /// A BVH is never modified after it is built, so when a clone changes a geometry it just gets a new BVH and the old one stays valid for the other clones.
+    static CollisionGeometryPtr _GetSharedMesh(const MeshFactory &mesh_factory, const std::string& bvhrepresentation, const std::vector<fcl::Vec3f>& points, const std::vector<fcl::Triangle>& triangles)
+    {
+        size_t hash = boost::hash<std::string>()(bvhrepresentation);
+        boost::hash_combine(hash, points.size());
+        boost::hash_combine(hash, triangles.size());
+        FOREACHC(itpoint, points) {
+            boost::hash_combine(hash, (*itpoint)[0]);
+            boost::hash_combine(hash, (*itpoint)[1]);
+            boost::hash_combine(hash, (*itpoint)[2]);
+        }
+        FOREACHC(ittri, triangles) {
+            boost::hash_combine(hash, (*ittri)[0]);
+            boost::hash_combine(hash, (*ittri)[1]);
+            boost::hash_combine(hash, (*ittri)[2]);
+        }
+
+        typedef std::multimap<size_t, SharedMesh>::iterator SharedMeshIterator;
+        {
+            boost::mutex::scoped_lock lock(_GetSharedMeshesMutex());
+            std::pair<SharedMeshIterator, SharedMeshIterator> itrange = _GetSharedMeshes().equal_range(hash);
+            for(SharedMeshIterator it = itrange.first; it != itrange.second; ++it) {
+                CollisionGeometryPtr pgeom = it->second.pgeom.lock();
+                if( !!pgeom && _IsSameMesh(it->second, bvhrepresentation, points, triangles) ) {
+                    return pgeom;
+                }
+            }
+        }
+
+        // build outside of the lock since it is the expensive part, the disk cache lets processes skip building the meshes another process already built
+        std::string cachefilename = BVHDiskCache::GetFilename(bvhrepresentation, points, triangles);
+        CollisionGeometryPtr pnewgeom = BVHDiskCache::Load(cachefilename, bvhrepresentation, points, triangles);
+        if( !pnewgeom ) {
+            pnewgeom = mesh_factory(points, triangles);
+            BVHDiskCache::Save(cachefilename, bvhrepresentation, *pnewgeom);
+        }
+
+        boost::mutex::scoped_lock lock(_GetSharedMeshesMutex());
+        std::multimap<size_t, SharedMesh>& mapmeshes = _GetSharedMeshes();
+        std::pair<SharedMeshIterator, SharedMeshIterator> itrange = mapmeshes.equal_range(hash);
+        for(SharedMeshIterator it = itrange.first; it != itrange.second; ) {
+            CollisionGeometryPtr pgeom = it->second.pgeom.lock();
+            if( !pgeom ) {
+                mapmeshes.erase(it++);
+                continue;
+            }
+            if( _IsSameMesh(it->second, bvhrepresentation, points, triangles) ) {
+                // another thread built the same mesh in the meantime
+                return pgeom;
+            }
+            ++it;
+        }
+
+        // remove the meshes nobody uses anymore every time the cache doubles
+        static size_t s_nextsweepsize = 64;
+        if( mapmeshes.size() >= s_nextsweepsize ) {
+            for(SharedMeshIterator it = mapmeshes.begin(); it != mapmeshes.end(); ) {
+                if( it->second.pgeom.expired() ) {
+                    mapmeshes.erase(it++);
+                }
+                else {
+                    ++it;
+                }
+            }
+            s_nextsweepsize = std::max(size_t(64), 2*mapmeshes.size());
+        }
+
+        SharedMeshIterator itnew = mapmeshes.insert(std::make_pair(hash, SharedMesh()));
+        itnew->second.bvhrepresentation = bvhrepresentation;
+        itnew->second.points = points;
+        itnew->second.triangles = triangles;
+        itnew->second.pgeom = pnewgeom;
+        return pnewgeom;
+    }
+
     // what about the tests on non-zero size (eg. box extents) ?
-    static CollisionGeometryPtr _CreateFCLGeomFromGeometryInfo(const MeshFactory &mesh_factory, const KinBody::GeometryInfo &info)
+    static CollisionGeometryPtr _CreateFCLGeomFromGeometryInfo(const MeshFactory &mesh_factory, const std::string& bvhrepresentation, const KinBody::GeometryInfo &info)
     {
         switch(info._type) {
 
@@ -594,6 +872,11 @@ private:
         case OpenRAVE::GT_Cylinder:
             return make_shared<fcl::Cylinder>(info._vGeomData.x, info._vGeomData.y);
 
+        case OpenRAVE::GT_Voxels:
+#ifdef FCLRAVE_USE_OCTOMAP
+            return _CreateFCLOcTreeFromGeometryInfo(info);
+#endif
+        // without octomap, the voxels are checked through the mesh of their outer faces
         case OpenRAVE::GT_Container:
         case OpenRAVE::GT_TriMesh:
         case OpenRAVE::GT_Cage:
@@ -619,7 +902,7 @@ private:
                 fcl_triangles[itri] = fcl::Triangle(tri_indices[0], tri_indices[1], tri_indices[2]);
             }
 
-            return mesh_factory(fcl_points, fcl_triangles);
+            return _GetSharedMesh(mesh_factory, bvhrepresentation, fcl_points, fcl_triangles);
         }
 
         default:
@@ -628,6 +911,25 @@ private:
         }
     }
 
+#ifdef FCLRAVE_USE_OCTOMAP
+    /// \brief builds an octree from the occupied voxels. The voxel grid of GeometryInfo matches the grid of an octomap with the same resolution.
+    static CollisionGeometryPtr _CreateFCLOcTreeFromGeometryInfo(const KinBody::GeometryInfo &info)
+    {
+        if( info._setVoxels.empty() || info.GetVoxelResolution() <= 0 ) {
+            return CollisionGeometryPtr();
+        }
+        std::shared_ptr<octomap::OcTree> ptree = make_shared<octomap::OcTree>(info.GetVoxelResolution());
+        const float fOccupiedLogOdds = ptree->getClampingThresMaxLog();
+        std::vector<OpenRAVE::Vector> vcenters;
+        info.GetVoxelCenters(vcenters);
+        FOREACHC(itcenter, vcenters) {
+            ptree->setNodeValue(octomap::point3d(itcenter->x, itcenter->y, itcenter->z), fOccupiedLogOdds, true);
+        }
+        ptree->updateInnerOccupancy();
+        return make_shared<fcl::OcTree>(std::shared_ptr<const octomap::OcTree>(ptree));
+    }
+#endif
+
     /// \brief pass in info.GetBody() as a reference to avoid dereferencing the weak pointer in KinBodyInfo
     void _Synchronize(KinBodyInfo& info, const KinBody& body)
     {
@@ -636,34 +938,11 @@ private:
             vector<Transform> vtrans;
             body.GetLinkTransformations(vtrans);
             info.nLastStamp = body.GetUpdateStamp();
+            _NotifyStaticBodyChanged(info);
             BOOST_ASSERT( body.GetLinks().size() == info.vlinks.size() );
             BOOST_ASSERT( vtrans.size() == info.vlinks.size() );
             for(size_t i = 0; i < vtrans.size(); ++i) {
-                CollisionObjectPtr pcoll = info.vlinks[i]->linkBV.second;
-                if( !pcoll ) {
-                    continue;
-                }
-                Transform pose = vtrans[i] * info.vlinks[i]->linkBV.first;
-                fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
-                fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
-
-                pcoll->setTranslation(newPosition);
-                pcoll->setQuatRotation(newOrientation);
-                // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
-                pcoll->computeAABB();
-
-                //info.vlinks[i]->nLastStamp = info.nLastStamp;
-                FOREACHC(itgeomcoll, info.vlinks[i]->vgeoms) {
-                    CollisionObjectPtr pcoll = (*itgeomcoll).second;
-                    Transform pose = vtrans[i] * (*itgeomcoll).first;
-                    fcl::Vec3f newPosition = ConvertVectorToFCL(pose.trans);
-                    fcl::Quaternion3f newOrientation = ConvertQuaternionToFCL(pose.rot);
-
-                    pcoll->setTranslation(newPosition);
-                    pcoll->setQuatRotation(newOrientation);
-                    // Do not forget to recompute the AABB otherwise getAABB won't give an up to date AABB
-                    pcoll->computeAABB();
-                }
+                SynchronizeLink(*info.vlinks[i], vtrans[i]);
             }
 
             // Does this have any use ?
@@ -736,6 +1015,13 @@ private:
         KinBodyInfoPtr pinfo = _pinfo.lock();
         if( !!pinfo ) {
             pinfo->nLinkUpdateStamp++;
+            _NotifyStaticBodyChanged(*pinfo);
+        }
+    }
+
+    inline void _NotifyStaticBodyChanged(const KinBodyInfo& info) {
+        if( info.bStatic ) {
+            ++_nStaticBodiesUpdateStamp;
         }
     }
 
@@ -764,6 +1050,10 @@ private:
 
     std::set<KinBodyConstPtr> _setInitializedBodies; ///< Set of the kinbody initialized in this space
     std::map< int, std::map< std::string, KinBodyInfoPtr > > _cachedpinfo; ///< Associates to each body id and geometry group name the corresponding kinbody info if already initialized and not currently set as user data
+    std::set<std::string> _setStaticBodyNames; ///< names of the bodies marked as never moving
+    int _nCoarseMaxSpheres; ///< if > 0, every link gets up to this many bounding spheres in LinkInfo::vcoarsespheres
+    std::vector< std::pair<OpenRAVE::Vector, OpenRAVE::dReal> > _vCachedCoarseSpheres; ///< cache
+    int _nStaticBodiesUpdateStamp; ///< see \ref GetStaticBodiesUpdateStamp
     std::map< int, KinBodyInfoPtr> _currentpinfo; ///< maps kinbody environment id to the kinbodyinfo struct constaining fcl objects. The key being environment id makes it easier to compare objects without getting a handle to their pointers. Whenever a KinBodyInfoPtr goes into this map, it is removed from _cachedpinfo
 
     bool _bIsSelfCollisionChecker; // Currently not used
@@ -71,6 +71,20 @@ public:
             }
             f << ";" << maxTimingCount << std::endl;
         }
+        FOREACH(itdecisions, broadphaseDecisions) {
+            FOREACH(itdecision, itdecisions->second) {
+                f << itdecisions->first << ";broadphase;" << *itdecision << std::endl;
+            }
+        }
+    }
+
+    /// \brief records the broadphase algorithm an adaptive manager chose, written with the timings
+    void AddBroadphaseDecision(std::string const& label, std::string const& algorithm, std::string const& summary) {
+        std::string decision = str(boost::format("%s;%s")%algorithm%summary);
+        broadphaseDecisions[str(boost::format("%s;%s")%name%label)].push_back(decision);
+#ifdef FCL_STATISTICS_DISPLAY_CONTINUOUSLY
+        RAVELOG_WARN_FORMAT("FCL STATISTICS;%s;%s;broadphase;%s", name%label%decision);
+#endif
     }
 
     void StartManualTiming(std::string const& label) {
@@ -110,6 +124,7 @@ private:
     std::string currentTimingLabel;
     std::vector<time_point> currentTimings;
     std::map< std::string, std::vector< std::vector<time_point> > > timings;
+    std::map< std::string, std::vector<std::string> > broadphaseDecisions; ///< algorithms chosen by the adaptive broadphase managers, see AddBroadphaseDecision
 };
 
 typedef boost::shared_ptr<FCLStatistics> FCLStatisticsPtr;
@@ -124,6 +139,8 @@ typedef boost::shared_ptr<FCLStatistics> FCLStatisticsPtr;
 
 #define DISPLAY(statistics) statistics->DisplayAll()
 
+#define ADD_BROADPHASE_DECISION(statistics, label, algorithm, summary) statistics->AddBroadphaseDecision(label, algorithm, summary)
+
 } // fclrave
 
 #else // FCLUSESTATISTICS is not defined
@@ -137,6 +154,7 @@ class FCLStatistics {
 #define START_TIMING(statistics, label) do {} while(false)
 #define ADD_TIMING(statistics) do {} while(false)
 #define DISPLAY(statistics) do {} while(false)
+#define ADD_BROADPHASE_DECISION(statistics, label, algorithm, summary) do {} while(false)
 
 }
 #endif
@@ -101,8 +101,12 @@ using OpenRAVE::AttributesList;
 
 #include <fcl/collision.h>
 #include <fcl/distance.h>
+#include <fcl/continuous_collision.h>
 #include <fcl/BVH/BVH_model.h>
 #include <fcl/broadphase/broadphase.h>
 #include <fcl/shape/geometric_shapes.h>
+#ifdef FCLRAVE_USE_OCTOMAP
+#include <fcl/octree.h>
+#endif
 
 #endif
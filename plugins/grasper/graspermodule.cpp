@@ -78,6 +78,13 @@ class GrasperModule : public ModuleBase
         dReal volume;
     };
 
+    /// \brief the buffers of a force closure analysis, a batch of grasps reuses one instead of allocating them for every grasp
+    struct GraspAnalysisWorkspace
+    {
+        vector<CollisionReport::CONTACT> vreducedcontacts, vconecontacts;
+        vector<double> vpoints, vconvexplanes;
+    };
+
 public:
     GrasperModule(EnvironmentBasePtr penv, std::istream& sinput)  : ModuleBase(penv), outfile(NULL), errfile(NULL) {
         __description = ":Interface Author: Rosen Diankov\n\nUsed to simulate a hand grasping an object by closing its fingers until collision with all links. ";
@@ -91,6 +98,9 @@ public:
                         "Returns the stable contacts as defined by the closing direction");
         RegisterCommand("ConvexHull",boost::bind(&GrasperModule::_ConvexHullCommand,this,_1,_2),
                         "Given a point cloud, returns information about its convex hull like normal planes, vertex indices, and triangle indices. Computed planes point outside the mesh, face indices are not ordered, triangles point outside the mesh (counter-clockwise)");
+        RegisterCommand("ComputeForceClosures",boost::bind(&GrasperModule::_ComputeForceClosuresCommand,this,_1,_2),
+                        "Computes the force closure mindist and volume of a batch of contact sets. Contact sets whose approximate mindist is below 'threshold' skip the convex hull and return 0 0.");
+        _InitWrenchDirections();
     }
     virtual ~GrasperModule() {
         if( !!outfile )
@@ -403,7 +413,8 @@ public:
                 for(size_t i = 0; i < c.size(); ++i) {
                     c[i] = contacts[i].first;
                 }
-                analysis = _AnalyzeContacts3D(c,friction,8);
+                GraspAnalysisWorkspace workspace;
+                analysis = _AnalyzeContacts3D(c,friction,8,workspace);
             }
             catch(const std::exception& ex) {
                 RAVELOG_WARN("AnalyzeContacts3D: %s\n",ex.what());
@@ -652,6 +663,66 @@ public:
         return true;
     }
 
+    virtual bool _ComputeForceClosuresCommand(std::ostream& sout, std::istream& sinput)
+    {
+        string cmd;
+        dReal mu = 0, fthreshold = -1;
+        int Nconepoints = 8;
+        vector< vector<CollisionReport::CONTACT> > vcontactsets;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+
+            if( cmd == "friction" ) {
+                sinput >> mu;
+            }
+            else if( cmd == "conepoints" ) {
+                sinput >> Nconepoints;
+            }
+            else if( cmd == "threshold" ) {
+                sinput >> fthreshold;
+            }
+            else if( cmd == "contactsets" ) {
+                int numsets = 0;
+                sinput >> numsets;
+                vcontactsets.resize(max(0,numsets));
+                FOREACH(itcontacts, vcontactsets) {
+                    int numcontacts = 0;
+                    sinput >> numcontacts;
+                    itcontacts->resize(max(0,numcontacts));
+                    FOREACH(itcontact, *itcontacts) {
+                        sinput >> itcontact->pos.x >> itcontact->pos.y >> itcontact->pos.z >> itcontact->norm.x >> itcontact->norm.y >> itcontact->norm.z;
+                    }
+                }
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+
+        GraspAnalysisWorkspace workspace;
+        FOREACHC(itcontacts, vcontactsets) {
+            GRASPANALYSIS analysis;
+            try {
+                analysis = _AnalyzeContacts3D(*itcontacts, mu, Nconepoints, workspace, fthreshold);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN("AnalyzeContacts3D: %s\n",ex.what());
+            }
+            sout << analysis.mindist << " " << analysis.volume << " ";
+        }
+        return true;
+    }
+
     // initialization parameters
     struct WorkerParameters
     {
@@ -918,6 +989,7 @@ public:
             EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
             boost::shared_ptr<CollisionCheckerMngr> pcheckermngr(new CollisionCheckerMngr(pcloneenv, worker_params->collisionchecker));
             PlannerBasePtr planner = RaveCreatePlanner(pcloneenv,"Grasper");
+            GraspAnalysisWorkspace workspace;
             RobotBasePtr probot = pcloneenv->GetRobot(_robot->GetName());
             string strsavetraj;
 
@@ -1046,7 +1118,8 @@ public:
                         for(size_t i = 0; i < c.size(); ++i) {
                             c[i] = grasp_params->contacts[i].first;
                         }
-                        analysis = _AnalyzeContacts3D(c,worker_params->friction,8);
+                        // a positive threshold rejects most grasps with the approximate distance before the convex hull is computed
+                        analysis = _AnalyzeContacts3D(c,worker_params->friction,8,workspace,worker_params->forceclosurethreshold > 0 ? worker_params->forceclosurethreshold : dReal(-1));
                         if( analysis.mindist < worker_params->forceclosurethreshold ) {
                             RAVELOG_DEBUG(str(boost::format("grasp %d: force closure failed")%grasp_params->id));
                             continue;
@@ -1558,21 +1631,24 @@ protected:
         }
     }
 
-    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts, dReal mu, int Nconepoints)
+    /// \brief analyzes the force closure of contacts with friction cones of Nconepoints edges
+    ///
+    /// \param fapproxthreshold if >= 0, the approximate distance is computed first and if it is not bigger than 0 or is below fapproxthreshold, the convex hull is skipped and mindist and volume are 0
+    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts, dReal mu, int Nconepoints, GraspAnalysisWorkspace& workspace, dReal fapproxthreshold=-1)
     {
         if( mu == 0 ) {
-            return _AnalyzeContacts3D(contacts);
+            return _AnalyzeContacts3D(contacts, workspace, fapproxthreshold);
         }
 
         if( contacts.size() > 16 ) {
             // try reduce time by computing a subset of the points
-            vector<CollisionReport::CONTACT> reducedcontacts;
-            reducedcontacts.reserve(16);
-            for(size_t i = 0; i < reducedcontacts.capacity(); ++i) {
-                reducedcontacts.push_back( contacts.at((i*contacts.size())/reducedcontacts.capacity()) );
+            workspace.vreducedcontacts.resize(16);
+            for(size_t i = 0; i < workspace.vreducedcontacts.size(); ++i) {
+                workspace.vreducedcontacts[i] = contacts.at((i*contacts.size())/workspace.vreducedcontacts.size());
             }
-            GRASPANALYSIS analysis = _AnalyzeContacts3D(reducedcontacts, mu, Nconepoints);
-            if( analysis.mindist > 1e-9 ) {
+            // the subset cannot be farther from the boundary than the full set, so its approximation cannot reject
+            GRASPANALYSIS analysis = _AnalyzeContacts3D(workspace.vreducedcontacts, mu, Nconepoints, workspace);
+            if( analysis.mindist > 1e-9 && analysis.mindist >= fapproxthreshold ) {
                 return analysis;
             }
         }
@@ -1586,7 +1662,8 @@ protected:
             fang += fdeltaang;
         }
 
-        vector<CollisionReport::CONTACT> newcontacts;
+        vector<CollisionReport::CONTACT>& newcontacts = workspace.vconecontacts;
+        newcontacts.resize(0);
         newcontacts.reserve(contacts.size()*Nconepoints);
         FOREACHC(itcontact,contacts) {
             // find a coordinate system where z is the normal
@@ -1597,10 +1674,10 @@ protected:
                 newcontacts.push_back(CollisionReport::CONTACT(itcontact->pos, (itcontact->norm + mu*it->first*right + mu*it->second*up).normalize3(),0));
             }
         }
-        return _AnalyzeContacts3D(newcontacts);
+        return _AnalyzeContacts3D(newcontacts, workspace, fapproxthreshold);
     }
 
-    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts)
+    virtual GRASPANALYSIS _AnalyzeContacts3D(const vector<CollisionReport::CONTACT>& contacts, GraspAnalysisWorkspace& workspace, dReal fapproxthreshold=-1)
     {
         if( contacts.size() < 7 ) {
             RAVELOG_DEBUG("need at least 7 contact wrenches to have force closure in 3D\n");
@@ -1608,7 +1685,9 @@ protected:
         }
         RAVELOG_DEBUG(str(boost::format("analyzing %d contacts for force closure\n")%contacts.size()));
         GRASPANALYSIS analysis;
-        vector<double> vpoints(6*contacts.size()), vconvexplanes;
+        vector<double>& vpoints = workspace.vpoints;
+        vector<double>& vconvexplanes = workspace.vconvexplanes;
+        vpoints.resize(6*contacts.size());
         vector<double>::iterator itpoint = vpoints.begin();
         FOREACHC(itcontact, contacts) {
             *itpoint++ = itcontact->norm.x;
@@ -1620,6 +1699,14 @@ protected:
             *itpoint++ = v.z;
         }
 
+        if( fapproxthreshold >= 0 ) {
+            double approxdist = _ComputeApproximateWrenchDistance(vpoints);
+            if( approxdist <= 0 || approxdist < fapproxthreshold ) {
+                RAVELOG_VERBOSE_FORMAT("approximate force closure distance %e is below %e", approxdist%fapproxthreshold);
+                return analysis;
+            }
+        }
+
         analysis.volume = _ComputeConvexHull(vpoints,vconvexplanes,boost::shared_ptr< vector<int> >(),6);
         if( vconvexplanes.size() == 0 ) {
             return analysis;
@@ -1636,6 +1723,59 @@ protected:
         return analysis;
     }
 
+    /// \brief returns an upper bound of the distance from the origin to the boundary of the convex hull of the 6D wrenches
+    ///
+    /// The support of the wrenches is only evaluated along the fixed directions of _vWrenchDirections instead of computing the hull.
+    /// If it is not positive, the origin is outside of the hull and there is no force closure.
+    double _ComputeApproximateWrenchDistance(const vector<double>& vpoints) const
+    {
+        double approxdist = 1e30;
+        for(size_t idir = 0; idir < _vWrenchDirections.size(); idir += 6) {
+            const double* pdir = &_vWrenchDirections[idir];
+            double fsupport = -1e30;
+            for(size_t ipoint = 0; ipoint < vpoints.size(); ipoint += 6) {
+                const double* ppoint = &vpoints[ipoint];
+                double f = ppoint[0]*pdir[0] + ppoint[1]*pdir[1] + ppoint[2]*pdir[2] + ppoint[3]*pdir[3] + ppoint[4]*pdir[4] + ppoint[5]*pdir[5];
+                if( f > fsupport ) {
+                    fsupport = f;
+                }
+            }
+            if( fsupport < approxdist ) {
+                approxdist = fsupport;
+                if( approxdist <= 0 ) {
+                    break;
+                }
+            }
+        }
+        return approxdist;
+    }
+
+    /// \brief fills _vWrenchDirections with the unit 6D directions along the axes and between every two axes
+    void _InitWrenchDirections()
+    {
+        _vWrenchDirections.resize(0);
+        _vWrenchDirections.reserve(6*72);
+        for(int i = 0; i < 6; ++i) {
+            for(int isign = -1; isign <= 1; isign += 2) {
+                for(int j = 0; j < 6; ++j) {
+                    _vWrenchDirections.push_back(j == i ? isign : 0);
+                }
+            }
+        }
+        double fhalfsqrt2 = 1/RaveSqrt(2.0);
+        for(int i = 0; i < 6; ++i) {
+            for(int j = i+1; j < 6; ++j) {
+                for(int isigni = -1; isigni <= 1; isigni += 2) {
+                    for(int isignj = -1; isignj <= 1; isignj += 2) {
+                        for(int k = 0; k < 6; ++k) {
+                            _vWrenchDirections.push_back(k == i ? isigni*fhalfsqrt2 : (k == j ? isignj*fhalfsqrt2 : 0));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
     /// Computes the convex hull of a set of points
     /// \param vpoints a set of points each of dimension dim
     /// \param vconvexplaces the places of the convex hull, dimension is dim+1
@@ -1786,6 +1926,7 @@ protected:
     FILE *outfile;
     FILE *errfile;
     std::vector<dReal> _vjointmaxlengths;
+    std::vector<double> _vWrenchDirections; ///< the 6D unit directions of _ComputeApproximateWrenchDistance, 6 values each
 };
 
 ModuleBasePtr CreateGrasperModule(EnvironmentBasePtr penv, std::istream& sinput)
@@ -33,7 +33,7 @@ class GrasperPlanner :  public PlannerBase
     };
 
 public:
-    GrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _report(new CollisionReport()) {
+    GrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _report(new CollisionReport()), _reportDistance(new CollisionReport()) {
         __description = ":Interface Authors: Rosen Diankov, Dmitry Berenson\n\nSimple planner that performs a follow and squeeze operation of a robotic hand.";
     }
     bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
@@ -61,6 +61,15 @@ public:
             _vAvoidLinkGeometry.push_back(plink);
         }
 
+        // the grasps of one robot are usually planned by the same planner, so the link spheres are only computed once
+        if( _vLinkSpheres.size() != _robot->GetLinks().size() || _pLinkSpheresRobot.lock() != _robot ) {
+            _vLinkSpheres.resize(_robot->GetLinks().size());
+            FOREACHC(itlink, _robot->GetLinks()) {
+                AABB ab = (*itlink)->ComputeLocalAABB();
+                _vLinkSpheres[(*itlink)->GetIndex()] = std::make_pair(ab.pos, RaveSqrt(ab.extents.lengthsqr3()));
+            }
+            _pLinkSpheresRobot = _robot;
+        }
         return true;
     }
 
@@ -106,6 +115,8 @@ public:
         }
 
         CollisionCheckerMngr checkermngr(GetEnv(),"");
+        // if the checker can measure distances, the fingers jump close to their contacts instead of stepping there
+        bool bUseDistance = !_parameters->breturntrajectory && GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
         GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
 
         // do not disable any links of the robot here!
@@ -465,6 +476,17 @@ public:
                     break;
                 }
 
+                if( coarse_pass && bUseDistance ) {
+                    // skip the coarse steps that cannot collide, a collision after the jump is refined with the fine steps as usual
+                    dReal fFreeMotion = _ComputeFreeJointMotion(pjoint, nDOFIndex-pjoint->GetDOFIndex());
+                    dReal fToLimit = vchuckingdir[iindex] > 0 ? vupperlim[iindex]-dofvals[iindex] : dofvals[iindex]-vlowerlim[iindex];
+                    int numjumpsteps = (int)(min(fFreeMotion, fToLimit)/step_size) - 1;
+                    if( numjumpsteps > 0 && numjumpsteps < num_iters ) {
+                        dofvals[iindex] += vchuckingdir[iindex] * step_size * numjumpsteps;
+                        num_iters -= numjumpsteps;
+                    }
+                }
+
                 dofvals[iindex] += vchuckingdir[iindex] * step_size;
                 _robot->SetActiveDOFValues(dofvals,KinBody::CLA_CheckLimitsSilent);
                 _robot->GetActiveDOFValues(dofvals);
@@ -542,6 +564,43 @@ public:
         return ptraj->GetNumWaypoints() > 0 ? PlannerStatus(PS_HasSolution) : PlannerStatus(PS_Failed);     // only return true if there is at least one valid pose!
     }
 
+    /// \brief returns how far the joint axis can move before any link it moves can touch another body
+    ///
+    /// The motion of every link point is bounded with the cached link bounding spheres, the distances come from the collision checker.
+    /// 0 if a link is already in collision.
+    virtual dReal _ComputeFreeJointMotion(KinBody::JointConstPtr pjoint, int iaxis)
+    {
+        dReal fMaxPointMotion = 0; // how far a link point moves at most per unit of joint motion
+        dReal fMinDistance = 1e20;
+        bool bPrismatic = pjoint->IsPrismatic(iaxis);
+        Vector vanchor = pjoint->GetAnchor(), vaxis = pjoint->GetAxis(iaxis);
+        GetEnv()->GetCollisionChecker()->SetCollisionOptions(CO_Distance);
+        FOREACHC(itlink, _vlinks) {
+            if( !_robot->DoesAffect(pjoint->GetJointIndex(),(*itlink)->GetIndex()) || !(*itlink)->IsEnabled() ) {
+                continue;
+            }
+            if( bPrismatic ) {
+                fMaxPointMotion = 1;
+            }
+            else {
+                const std::pair<Vector, dReal>& sphere = _vLinkSpheres.at((*itlink)->GetIndex());
+                Vector vdelta = (*itlink)->GetTransform()*sphere.first - vanchor;
+                vdelta -= vaxis*vaxis.dot3(vdelta);
+                fMaxPointMotion = max(fMaxPointMotion, RaveSqrt(vdelta.lengthsqr3()) + sphere.second);
+            }
+            if( GetEnv()->CheckCollision(KinBody::LinkConstPtr(*itlink), _reportDistance) ) {
+                fMinDistance = 0;
+                break;
+            }
+            fMinDistance = min(fMinDistance, _reportDistance->minDistance);
+        }
+        GetEnv()->GetCollisionChecker()->SetCollisionOptions(0);
+        if( fMaxPointMotion <= 0 ) {
+            return 0;
+        }
+        return fMinDistance/fMaxPointMotion;
+    }
+
     virtual int _CheckCollision(KinBody::JointConstPtr pjoint, KinBodyPtr targetbody)
     {
         int ct = 0;
@@ -703,13 +762,15 @@ protected:
 
         return ct;
     }
-    CollisionReportPtr _report;
+    CollisionReportPtr _report, _reportDistance;
     boost::shared_ptr<GraspParameters> _parameters;
     RobotBasePtr _robot;
     vector<KinBody::LinkPtr> _vAvoidLinkGeometry;
     std::vector<KinBody::LinkPtr> _vlinks;
     Vector _vTargetCenter;
     dReal _fTargetRadius;
+    std::vector< std::pair<Vector, dReal> > _vLinkSpheres; ///< the bounding sphere of every robot link in the link frame
+    KinBodyWeakPtr _pLinkSpheresRobot; ///< the robot _vLinkSpheres was computed for
 };
 
 PlannerBasePtr CreateGrasperPlanner(EnvironmentBasePtr penv, std::istream& sinput)
@@ -58,7 +58,10 @@
 
 #include <dlfcn.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
 #define MYPOPEN popen
 #define MYPCLOSE pclose
 #endif
@@ -187,6 +190,7 @@ public:
         {
             LOAD_IKFUNCTION0(ComputeIk);
             LOAD_IKFUNCTION0(ComputeIk2);
+            LOAD_IKFUNCTION0(ComputeIkBatch);
             LOAD_IKFUNCTION(ComputeFk);
             LOAD_IKFUNCTION(GetNumFreeParameters);
             LOAD_IKFUNCTION0(GetFreeIndices);
@@ -268,8 +272,8 @@ public:
         boost::shared_ptr<MyFunctions<float> > _ikfloat;
 #endif
         boost::shared_ptr<MyFunctions<double> > _ikdouble;
-private:
-        void* SysLoadLibrary(const char* lib)
+
+        static void* SysLoadLibrary(const char* lib)
         {
 #ifdef _WIN32
             void* plib = LoadLibraryA(lib);
@@ -285,7 +289,7 @@ private:
             return plib;
         }
 
-        void* SysLoadSym(void* lib, const char* sym)
+        static void* SysLoadSym(void* lib, const char* sym)
         {
 #ifdef _WIN32
             return GetProcAddress((HINSTANCE)lib, sym);
@@ -294,7 +298,7 @@ private:
 #endif
         }
 
-        void SysCloseLibrary(void* lib)
+        static void SysCloseLibrary(void* lib)
         {
 #ifdef _WIN32
             FreeLibrary((HINSTANCE)lib);
@@ -303,11 +307,24 @@ private:
 #endif
         }
 
+private:
+
         void* plib;
         string _libraryname;
         vector<string> _viknames;
     };
 
+    /// \brief state shared with the threads of PreloadIKFastSolver, which do not use the module so that they can outlive it
+    struct PreloadState
+    {
+        PreloadState() : bCancel(false) {
+        }
+        boost::mutex mutex; ///< protects bCancel and setpids
+        bool bCancel; ///< if true, the module stopped the threads and they should return without loading anything
+        std::set<int> setpids; ///< process ids of the running ik generators
+    };
+    typedef boost::shared_ptr<PreloadState> PreloadStatePtr;
+
     inline boost::shared_ptr<IkFastModule> shared_problem() {
         return boost::static_pointer_cast<IkFastModule>(shared_from_this());
     }
@@ -323,6 +340,10 @@ public:
                         "Dynamically adds an ik solver to openrave by loading a shared object (based on ikfast code generation).\n"
                         "Usage::\n\n  AddIkLibrary iksolvername iklibrarypath\n\n"
                         "return the type of inverse kinematics solver (IkParamterization::Type)");
+        RegisterCommand("AddFkLibrary",boost::bind(&IkFastModule::AddFkLibrary,this,_1,_2),
+                        "Makes a body compute its link transformations with the forward kinematics code of a shared object (based on fkfast code generation).\n"
+                        "Usage::\n\n  AddFkLibrary bodyname fklibrarypath\n\n"
+                        "return the kinematics hash the library was generated for");
 #ifdef Boost_IOSTREAMS_FOUND
 
         RegisterJSONCommand("LoadIKFastFromXMLId",boost::bind(&IkFastModule::_LoadIKFastFromXMLIdCommand, this, _1, _2, _3), "Loads ikfast module from xmlid");
@@ -331,11 +352,25 @@ public:
                         "Dynamically calls the inversekinematics.py script to generate an ik solver for a robot, or to load an existing one\n"
                         "Usage::\n\n  LoadIKFastSolver robotname iktype_id [free increment]\n\n"
                         "return nothing, but does call the SetIKSolver for the robot");
+        RegisterCommand("PreloadIKFastSolver",boost::bind(&IkFastModule::PreloadIKFastSolver,this,_1,_2),
+                        "Starts finding, generating if needed, and loading the ik library in the background so a later LoadIKFastSolver with the same arguments does not block. "
+                        "Libraries are looked up in the ikfast cache directory before the database, and database libraries are copied into the cache.\n"
+                        "Usage::\n\n  PreloadIKFastSolver robotname iktype_id\n\n");
+        RegisterCommand("SetIkFastCacheDirectory",boost::bind(&IkFastModule::SetIkFastCacheDirectory,this,_1,_2),
+                        "Sets the directory compiled ik libraries are cached in, keyed by the ik structure hash and ik type. "
+                        "Defaults to OPENRAVE_IKFAST_CACHE or $OPENRAVE_HOME/ikfastcache, empty disables the cache.\n"
+                        "Usage::\n\n  SetIkFastCacheDirectory [directory]\n\n");
 #endif
         RegisterCommand("PerfTiming",boost::bind(&IkFastModule::PerfTiming,this,_1,_2),
                         "Times the ik call of a given library.\n"
                         "Usage::\n\n  PerfTiming [options] iklibrarypath\n\n"
                         "return the set of time measurements made in nano-seconds");
+        RegisterCommand("ComputeReachability",boost::bind(&IkFastModule::ComputeReachability,this,_1,_2),
+                        "Computes which end effector rotations are reachable at a set of translations, used for building the kinematic reachability database.\n"
+                        "Usage::\n\n  ComputeReachability robot name manip name [filteroptions int] [usefreespace 0|1] [numthreads int] rotations N qw qx qy qz ... translations M x y z ...\n\n"
+                        "The poses are in the world coordinate system. For every translation, returns one line with the number of valid solutions, "
+                        "the number of reachable rotations K, and then K pairs of rotation index and number of solutions. "
+                        "Without usefreespace a reachable rotation counts as one solution.");
         RegisterCommand("IKTest",boost::bind(&IkFastModule::IKtest,this,_1,_2),
                         "Tests for an IK solution if active manipulation has an IK solver attached");
         RegisterCommand("DebugIK",boost::bind(&IkFastModule::DebugIK,this,_1,_2),
@@ -348,6 +383,9 @@ public:
     }
 
     virtual ~IkFastModule() {
+#ifdef Boost_IOSTREAMS_FOUND
+        _CancelPreloadThreads();
+#endif
     }
 
     int main(const string& cmd)
@@ -372,6 +410,9 @@ public:
 
     virtual void Destroy()
     {
+#ifdef Boost_IOSTREAMS_FOUND
+        _CancelPreloadThreads();
+#endif
     }
 
     bool AddIkLibrary(ostream& sout, istream& sinput)
@@ -399,7 +440,61 @@ public:
         return true;
     }
 
-    boost::shared_ptr<IkLibrary> _AddIkLibrary(const string& ikname, const string& _libraryname)
+    bool AddFkLibrary(ostream& sout, istream& sinput)
+    {
+        string bodyname, libraryname;
+        sinput >> bodyname;
+        if (!getline(sinput, libraryname) ) {
+            return false;
+        }
+        boost::trim(libraryname);
+        if( libraryname.size() == 0 || bodyname.size() == 0 ) {
+            RAVELOG_DEBUG_FORMAT("bad input, bodyname=%s, libraryname=%s", bodyname%libraryname);
+            return false;
+        }
+
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        KinBodyPtr pbody = GetEnv()->GetKinBody(bodyname);
+        if( !pbody ) {
+            RAVELOG_WARN_FORMAT("failed to find body %s", bodyname);
+            return false;
+        }
+        void* plib = IkLibrary::SysLoadLibrary(libraryname.c_str());
+        if( !plib ) {
+            return false;
+        }
+        boost::shared_ptr<void> plibrary(plib, IkLibrary::SysCloseLibrary);
+
+        typedef int (*GetFkIntFn)();
+        typedef const char* (*GetFkKinematicsHashFn)();
+        GetFkIntFn GetFkRealSize = (GetFkIntFn)IkLibrary::SysLoadSym(plib, "GetFkRealSize");
+        GetFkIntFn GetFkNumDOFs = (GetFkIntFn)IkLibrary::SysLoadSym(plib, "GetFkNumDOFs");
+        GetFkIntFn GetFkNumLinks = (GetFkIntFn)IkLibrary::SysLoadSym(plib, "GetFkNumLinks");
+        GetFkKinematicsHashFn GetFkKinematicsHash = (GetFkKinematicsHashFn)IkLibrary::SysLoadSym(plib, "GetFkKinematicsHash");
+        KinBody::ForwardKinematicsFunctions::ComputeLinkPosesFn ComputeFkLinkPoses = (KinBody::ForwardKinematicsFunctions::ComputeLinkPosesFn)IkLibrary::SysLoadSym(plib, "ComputeFkLinkPoses");
+        if( !GetFkRealSize || !GetFkNumDOFs || !GetFkNumLinks || !GetFkKinematicsHash || !ComputeFkLinkPoses ) {
+            RAVELOG_WARN_FORMAT("%s is not a forward kinematics library generated by fkfast", libraryname);
+            return false;
+        }
+        if( GetFkRealSize() != (int)sizeof(dReal) ) {
+            RAVELOG_WARN_FORMAT("%s uses %d byte reals, but openrave uses %d", libraryname%GetFkRealSize()%sizeof(dReal));
+            return false;
+        }
+
+        boost::shared_ptr<KinBody::ForwardKinematicsFunctions> pfunctions(new KinBody::ForwardKinematicsFunctions());
+        pfunctions->kinematicshash = GetFkKinematicsHash();
+        pfunctions->numdofs = GetFkNumDOFs();
+        pfunctions->numlinks = GetFkNumLinks();
+        pfunctions->computelinkposes = ComputeFkLinkPoses;
+        pfunctions->plibrary = plibrary;
+        if( !pbody->SetForwardKinematicsFunctions(pfunctions) ) {
+            return false;
+        }
+        sout << pfunctions->kinematicshash;
+        return true;
+    }
+
+    static boost::shared_ptr<IkLibrary> _AddIkLibrary(const string& ikname, const string& _libraryname)
     {
 //#ifdef HAVE_BOOST_FILESYSTEM
 //        string libraryname = boost::filesystem::system_complete(boost::filesystem::path(_libraryname)).string();
@@ -433,6 +528,8 @@ public:
         boost::shared_ptr<IkFastModule const> r = RaveInterfaceConstCast<IkFastModule>(preference);
         _ikfastversion = r->_ikfastversion;
         _platform = r->_platform;
+        _ikfastcachedirectory = r->_ikfastcachedirectory;
+        _bIkFastCacheDirectorySet = r->_bIkFastCacheDirectorySet;
     }
 
 #ifdef Boost_IOSTREAMS_FOUND
@@ -536,95 +633,24 @@ public:
             return false;
         }
         RobotBase::ManipulatorPtr pmanip = probot->GetActiveManipulator();
-        IkParameterizationType iktype = IKP_None;
-        try {
-            iktype = static_cast<IkParameterizationType>(boost::lexical_cast<int>(striktype));
-            striktype = RaveGetIkParameterizationMap().find(iktype)->second;
-        }
-        catch(const boost::bad_lexical_cast&) {
-            // striktype is already correct, so check that it exists in RaveGetIkParameterizationMap
-            std::transform(striktype.begin(), striktype.end(), striktype.begin(), ::tolower);
-            FOREACHC(it,RaveGetIkParameterizationMap()) {
-                string mapiktype = it->second;
-                std::transform(mapiktype.begin(), mapiktype.end(), mapiktype.begin(), ::tolower);
-                if( mapiktype == striktype ) {
-                    iktype = it->first;
-                    striktype = it->second; // get the correct capitalizations
-                    break;
-                }
-            }
-            if(iktype == IKP_None) {
-                throw openrave_exception(str(boost::format(_("could not find iktype %s"))%striktype));
-            }
-        }
+        IkParameterizationType iktype = _GetIkParameterizationType(striktype);
 
         _EnsureIkFastVersion();
 
-        string ikfilename;
+        string ikfastname = str(boost::format("ikfast.%s.%s.%s")%pmanip->GetInverseKinematicsStructureHash(iktype)%striktype%pmanip->GetName());
+        _WaitForPreload(ikfastname);
+        std::vector<std::string> vikfilenames;
+        _GetIkLibraryFilenames(pmanip, iktype, striktype, vikfilenames);
+        const std::string ikcachedirectory = _GetIkFastCacheDirectory();
         for(int iter = 0; iter < 2; ++iter) {
-            string ikfilenamefound;
-            // check if exists and is loadable, if not, regenerate the IK.
-            std::string ikfilenameprefix = str(boost::format("kinematics.%s/ikfast%s.%s.%s.")%pmanip->GetInverseKinematicsStructureHash(iktype)%_ikfastversion%striktype%_platform);
-            int ikdof = IkParameterization::GetDOF(iktype);
-            if( ikdof > pmanip->GetArmDOF() ) {
-                RAVELOG_WARN(str(boost::format("not enough joints (%d) for ik %s")%pmanip->GetArmIndices().size()%striktype));
-            }
-            if( ikdof < pmanip->GetArmDOF() ) {
-                std::vector<int> vindices = pmanip->GetArmIndices();
-                std::vector<int> vsolveindices(ikdof), vfreeindices(vindices.size()-ikdof);
-                do {
-                    std::copy(vindices.begin(),vindices.begin()+ikdof,vsolveindices.begin());
-                    sort(vsolveindices.begin(),vsolveindices.end());
-                    std::copy(vindices.begin()+ikdof,vindices.end(),vfreeindices.begin());
-                    sort(vfreeindices.begin(),vfreeindices.end());
-                    ikfilename=ikfilenameprefix;
-                    for(size_t i = 0; i < vsolveindices.size(); ++i) {
-                        ikfilename += boost::lexical_cast<std::string>(vsolveindices[i]);
-                        ikfilename += '_';
-                    }
-                    ikfilename += "f";
-                    for(size_t i = 0; i < vfreeindices.size(); ++i) {
-                        if( i > 0 ) {
-                            ikfilename += '_';
-                        }
-                        ikfilename += boost::lexical_cast<std::string>(vfreeindices[i]);
-                    }
-                    ikfilename += PLUGIN_EXT;
-                    ikfilenamefound = RaveFindDatabaseFile(ikfilename);
-                    if (ikfilenamefound.size() > 0 ) {
-                        break;
-                    }
-                } while (next_combination(&vindices[0], &vindices[ikdof], &vindices[vindices.size()]));
-            }
-            else {
-                ikfilename=ikfilenameprefix;
-                for(size_t i = 0; i < pmanip->GetArmIndices().size(); ++i) {
-                    if( i > 0 ) {
-                        ikfilename += '_';
-                    }
-                    ikfilename += boost::lexical_cast<std::string>(pmanip->GetArmIndices().at(i));
-                }
-                ikfilename += PLUGIN_EXT;
-                ikfilenamefound = RaveFindDatabaseFile(ikfilename);
-            }
-
+            string ikfilenamefound = _FindIkLibraryFile(vikfilenames, ikcachedirectory);
             if( ikfilenamefound.size() == 0 ) {
                 if( iter > 0 ) {
-                    RAVELOG_WARN(str(boost::format("failed to find ikfile: %s")%ikfilename));
+                    RAVELOG_WARN(str(boost::format("failed to find ikfile: %s")%vikfilenames.back()));
                     return false;
                 }
-
-                // create a temporary file and store COLLADA kinematics representation
-                AttributesList atts;
-                atts.emplace_back("skipwrite", "visual readable sensors physics");
-                atts.emplace_back("target",  probot->GetName());
-                string tempfilename = RaveGetHomeDirectory() + str(boost::format("/testikfastrobot%d.dae")%(RaveRandomInt()%1000));
-                // file not found, so create
-                RAVELOG_INFO(str(boost::format("Generating inverse kinematics %s for manip %s:%s, hash=%s, saving intermediate data to %s, will take several minutes...\n")%striktype%probot->GetName()%pmanip->GetName()%pmanip->GetInverseKinematicsStructureHash(iktype)%tempfilename));
-                GetEnv()->Save(tempfilename,EnvironmentBase::SO_Body,atts);
-                string cmdgen = str(boost::format("openrave.py --database inversekinematics --usecached --robot=\"%s\" --manipname=%s --iktype=%s --filepermissions=%i")%tempfilename%pmanip->GetName()%striktype%0777);
                 // use raw system call, popen causes weird crash in the inversekinematics compiler
-                int generateexit = system(cmdgen.c_str());
+                int generateexit = system(_SaveIkGenerationInput(probot, pmanip, iktype, striktype).c_str());
                 //FILE* pipe = MYPOPEN(cmdgen.c_str(), "r");
                 //int generateexit = MYPCLOSE(pipe);
                 if( generateexit != 0 ) {
@@ -640,7 +666,6 @@ public:
                 return false;
             }
 
-            string ikfastname = str(boost::format("ikfast.%s.%s.%s")%pmanip->GetInverseKinematicsStructureHash(iktype)%striktype%pmanip->GetName());
             boost::shared_ptr<IkLibrary> lib = _AddIkLibrary(ikfastname,ikfilenamefound);
             bool bsuccess = true;
             if( !lib ) {
@@ -671,6 +696,310 @@ public:
         return false;
     }
 
+    bool PreloadIKFastSolver(ostream& sout, istream& sinput)
+    {
+        EnvironmentMutex::scoped_lock envlock(GetEnv()->GetMutex());
+        string robotname, striktype;
+        sinput >> robotname >> striktype;
+        if( !sinput ) {
+            return false;
+        }
+        RobotBasePtr probot = GetEnv()->GetRobot(robotname);
+        if( !probot || !probot->GetActiveManipulator() ) {
+            return false;
+        }
+        RobotBase::ManipulatorPtr pmanip = probot->GetActiveManipulator();
+        IkParameterizationType iktype = _GetIkParameterizationType(striktype);
+
+        _EnsureIkFastVersion();
+        string ikfastname = str(boost::format("ikfast.%s.%s.%s")%pmanip->GetInverseKinematicsStructureHash(iktype)%striktype%pmanip->GetName());
+        boost::mutex::scoped_lock lock(_mutexPreload);
+        if( _mapPreloadThreads.find(ikfastname) != _mapPreloadThreads.end() ) {
+            return true;
+        }
+        // everything that touches the environment is done here, the thread only works with files
+        std::vector<std::string> vikfilenames;
+        _GetIkLibraryFilenames(pmanip, iktype, striktype, vikfilenames);
+        const std::string ikcachedirectory = _GetIkFastCacheDirectory();
+        std::string cmdgen;
+        if( _FindIkLibraryFile(vikfilenames, ikcachedirectory).size() == 0 ) {
+            cmdgen = _SaveIkGenerationInput(probot, pmanip, iktype, striktype);
+        }
+        // the thread does not use the module, it can outlive it
+        _mapPreloadThreads[ikfastname].reset(new boost::thread(boost::bind(&IkFastModule::_PreloadThread, _preloadstate, ikfastname, vikfilenames, ikcachedirectory, cmdgen)));
+        return true;
+    }
+
+    /// \brief converts an ik type id or name to IkParameterizationType and sets striktype to its proper name
+    IkParameterizationType _GetIkParameterizationType(std::string& striktype)
+    {
+        IkParameterizationType iktype = IKP_None;
+        try {
+            iktype = static_cast<IkParameterizationType>(boost::lexical_cast<int>(striktype));
+            striktype = RaveGetIkParameterizationMap().find(iktype)->second;
+        }
+        catch(const boost::bad_lexical_cast&) {
+            // striktype is already correct, so check that it exists in RaveGetIkParameterizationMap
+            std::transform(striktype.begin(), striktype.end(), striktype.begin(), ::tolower);
+            FOREACHC(it,RaveGetIkParameterizationMap()) {
+                string mapiktype = it->second;
+                std::transform(mapiktype.begin(), mapiktype.end(), mapiktype.begin(), ::tolower);
+                if( mapiktype == striktype ) {
+                    iktype = it->first;
+                    striktype = it->second; // get the correct capitalizations
+                    break;
+                }
+            }
+            if(iktype == IKP_None) {
+                throw openrave_exception(str(boost::format(_("could not find iktype %s"))%striktype));
+            }
+        }
+        return iktype;
+    }
+
+    /// \brief generates the library if cmdgen is set, then loads it so LoadIKFastSolver only has to create the solver
+    static void _PreloadThread(PreloadStatePtr preloadstate, const std::string& ikfastname, const std::vector<std::string>& vikfilenames, const std::string& ikcachedirectory, const std::string& cmdgen)
+    {
+        try {
+            if( cmdgen.size() > 0 ) {
+                if( _RunIkGenerator(preloadstate, cmdgen) != 0 ) {
+                    RAVELOG_DEBUG_FORMAT("generating %s returned an error", ikfastname);
+                }
+            }
+            {
+                boost::mutex::scoped_lock lock(preloadstate->mutex);
+                if( preloadstate->bCancel ) {
+                    return;
+                }
+            }
+            std::string ikfilenamefound = _FindIkLibraryFile(vikfilenames, ikcachedirectory);
+            if( ikfilenamefound.size() == 0 ) {
+                RAVELOG_WARN_FORMAT("failed to preload %s", ikfastname);
+                return;
+            }
+            if( !_AddIkLibrary(ikfastname, ikfilenamefound) ) {
+                RAVELOG_WARN_FORMAT("failed to load %s from %s", ikfastname%ikfilenamefound);
+                return;
+            }
+            RAVELOG_DEBUG_FORMAT("preloaded %s from %s", ikfastname%ikfilenamefound);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("failed to preload %s: %s", ikfastname%ex.what());
+        }
+    }
+
+    /// \brief blocks until a PreloadIKFastSolver of ikfastname has finished
+    void _WaitForPreload(const std::string& ikfastname)
+    {
+        boost::shared_ptr<boost::thread> pthread;
+        {
+            boost::mutex::scoped_lock lock(_mutexPreload);
+            std::map<std::string, boost::shared_ptr<boost::thread> >::iterator it = _mapPreloadThreads.find(ikfastname);
+            if( it == _mapPreloadThreads.end() ) {
+                return;
+            }
+            pthread = it->second;
+            _mapPreloadThreads.erase(it);
+        }
+        pthread->join();
+    }
+
+    /// \brief runs cmdgen like system. On posix systems the generator gets its own process group so _CancelPreloadThreads can kill it.
+    static int _RunIkGenerator(PreloadStatePtr preloadstate, const std::string& cmdgen)
+    {
+#ifdef _WIN32
+        return system(cmdgen.c_str());
+#else
+        const char* pcmdgen = cmdgen.c_str();
+        // the pid is registered before the lock is released, so a cancel cannot miss the generator
+        boost::mutex::scoped_lock lock(preloadstate->mutex);
+        if( preloadstate->bCancel ) {
+            return -1;
+        }
+        pid_t pid = fork();
+        if( pid == 0 ) {
+            setpgid(0, 0);
+            execl("/bin/sh", "sh", "-c", pcmdgen, (char*)NULL);
+            _exit(127);
+        }
+        if( pid < 0 ) {
+            return -1;
+        }
+        setpgid(pid, pid);
+        preloadstate->setpids.insert(pid);
+        lock.unlock();
+        int status = 0;
+        while( waitpid(pid, &status, 0) < 0 && errno == EINTR ) {
+        }
+        lock.lock();
+        preloadstate->setpids.erase(pid);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+    }
+
+    /// \brief stops the preload threads without waiting for the generation of their libraries
+    ///
+    /// The generators are killed and the threads return without loading anything. On windows system cannot be interrupted,
+    /// so the threads are detached and finish the generation on their own.
+    void _CancelPreloadThreads()
+    {
+        std::map<std::string, boost::shared_ptr<boost::thread> > mapPreloadThreads;
+        PreloadStatePtr preloadstate;
+        {
+            boost::mutex::scoped_lock lock(_mutexPreload);
+            mapPreloadThreads.swap(_mapPreloadThreads);
+            preloadstate = _preloadstate;
+            _preloadstate.reset(new PreloadState());
+        }
+        {
+            boost::mutex::scoped_lock lock(preloadstate->mutex);
+            preloadstate->bCancel = true;
+#ifndef _WIN32
+            FOREACHC(itpid, preloadstate->setpids) {
+                kill(-*itpid, SIGTERM);
+            }
+#endif
+        }
+        FOREACH(itthread, mapPreloadThreads) {
+#ifdef _WIN32
+            itthread->second->detach();
+#else
+            itthread->second->join();
+#endif
+        }
+    }
+
+    /// \brief the database filenames of all the ik libraries that can solve iktype for pmanip, one per choice of free joints
+    void _GetIkLibraryFilenames(RobotBase::ManipulatorPtr pmanip, IkParameterizationType iktype, const std::string& striktype, std::vector<std::string>& vikfilenames)
+    {
+        vikfilenames.resize(0);
+        std::string ikfilenameprefix = str(boost::format("kinematics.%s/ikfast%s.%s.%s.")%pmanip->GetInverseKinematicsStructureHash(iktype)%_ikfastversion%striktype%_platform);
+        int ikdof = IkParameterization::GetDOF(iktype);
+        if( ikdof > pmanip->GetArmDOF() ) {
+            RAVELOG_WARN(str(boost::format("not enough joints (%d) for ik %s")%pmanip->GetArmIndices().size()%striktype));
+        }
+        if( ikdof < pmanip->GetArmDOF() ) {
+            std::vector<int> vindices = pmanip->GetArmIndices();
+            std::vector<int> vsolveindices(ikdof), vfreeindices(vindices.size()-ikdof);
+            do {
+                std::copy(vindices.begin(),vindices.begin()+ikdof,vsolveindices.begin());
+                sort(vsolveindices.begin(),vsolveindices.end());
+                std::copy(vindices.begin()+ikdof,vindices.end(),vfreeindices.begin());
+                sort(vfreeindices.begin(),vfreeindices.end());
+                string ikfilename=ikfilenameprefix;
+                for(size_t i = 0; i < vsolveindices.size(); ++i) {
+                    ikfilename += boost::lexical_cast<std::string>(vsolveindices[i]);
+                    ikfilename += '_';
+                }
+                ikfilename += "f";
+                for(size_t i = 0; i < vfreeindices.size(); ++i) {
+                    if( i > 0 ) {
+                        ikfilename += '_';
+                    }
+                    ikfilename += boost::lexical_cast<std::string>(vfreeindices[i]);
+                }
+                ikfilename += PLUGIN_EXT;
+                vikfilenames.push_back(ikfilename);
+            } while (next_combination(&vindices[0], &vindices[ikdof], &vindices[vindices.size()]));
+        }
+        else {
+            string ikfilename=ikfilenameprefix;
+            for(size_t i = 0; i < pmanip->GetArmIndices().size(); ++i) {
+                if( i > 0 ) {
+                    ikfilename += '_';
+                }
+                ikfilename += boost::lexical_cast<std::string>(pmanip->GetArmIndices().at(i));
+            }
+            ikfilename += PLUGIN_EXT;
+            vikfilenames.push_back(ikfilename);
+        }
+    }
+
+    /// \brief returns the first of vikfilenames found in the database, loaded from its copy in the ikfast cache. Only touches files.
+    ///
+    /// The cache filename contains the database filename, which has the ik hash, the ik type and the choice of free joints, and the
+    /// modification time of the database library, so regenerated libraries are copied again.
+    static std::string _FindIkLibraryFile(const std::vector<std::string>& vikfilenames, const std::string& ikcachedirectory)
+    {
+        FOREACHC(itikfilename, vikfilenames) {
+            std::string ikfilenamefound = RaveFindDatabaseFile(*itikfilename);
+            if( ikfilenamefound.size() == 0 ) {
+                continue;
+            }
+            if( ikcachedirectory.size() == 0 ) {
+                return ikfilenamefound;
+            }
+            try {
+                std::string ikcachename = itikfilename->substr(0, itikfilename->size()-strlen(PLUGIN_EXT));
+                std::replace(ikcachename.begin(), ikcachename.end(), '/', '.');
+                const std::string ikcachefilename = str(boost::format("%s/%s.%d%s")%ikcachedirectory%ikcachename%boost::filesystem::last_write_time(boost::filesystem::path(ikfilenamefound))%PLUGIN_EXT);
+                if( !!ifstream(ikcachefilename.c_str()) || _AddToIkFastCache(ikfilenamefound, ikcachefilename) ) {
+                    return ikcachefilename;
+                }
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_DEBUG_FORMAT("failed to look up %s in the ikfast cache: %s", ikfilenamefound%ex.what());
+            }
+            return ikfilenamefound;
+        }
+        return std::string();
+    }
+
+    /// \brief the ikfast cache is a directory of copies of the compiled ik libraries of the database.
+    ///
+    /// It defaults to $OPENRAVE_HOME/ikfastcache and can be changed with SetIkFastCacheDirectory or OPENRAVE_IKFAST_CACHE. Empty disables the cache.
+    std::string _GetIkFastCacheDirectory()
+    {
+        if( !_bIkFastCacheDirectorySet ) {
+            const char* pcachedir = getenv("OPENRAVE_IKFAST_CACHE");
+            _ikfastcachedirectory = pcachedir != NULL ? std::string(pcachedir) : RaveGetHomeDirectory() + "/ikfastcache";
+            _bIkFastCacheDirectorySet = true;
+        }
+        return _ikfastcachedirectory;
+    }
+
+    /// \return true if ikfilename was copied to ikcachefilename
+    static bool _AddToIkFastCache(const std::string& ikfilename, const std::string& ikcachefilename)
+    {
+        try {
+            boost::filesystem::path cachepath(ikcachefilename);
+            boost::filesystem::create_directories(cachepath.parent_path());
+            // copy to a unique name first so other processes never load a partially written library
+            boost::filesystem::path temppath(ikcachefilename + str(boost::format(".%d.tmp")%RaveRandomInt()));
+            boost::filesystem::copy_file(boost::filesystem::path(ikfilename), temppath);
+            boost::filesystem::rename(temppath, cachepath);
+            return true;
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_DEBUG_FORMAT("failed to add %s to the ikfast cache: %s", ikfilename%ex.what());
+            return false;
+        }
+    }
+
+    /// \brief saves the robot for the ik generator and returns the command that generates the library
+    std::string _SaveIkGenerationInput(RobotBasePtr probot, RobotBase::ManipulatorPtr pmanip, IkParameterizationType iktype, const std::string& striktype)
+    {
+        // create a temporary file and store COLLADA kinematics representation
+        AttributesList atts;
+        atts.emplace_back("skipwrite", "visual readable sensors physics");
+        atts.emplace_back("target",  probot->GetName());
+        string tempfilename = RaveGetHomeDirectory() + str(boost::format("/testikfastrobot%d.dae")%(RaveRandomInt()%1000));
+        // file not found, so create
+        RAVELOG_INFO(str(boost::format("Generating inverse kinematics %s for manip %s:%s, hash=%s, saving intermediate data to %s, will take several minutes...\n")%striktype%probot->GetName()%pmanip->GetName()%pmanip->GetInverseKinematicsStructureHash(iktype)%tempfilename));
+        GetEnv()->Save(tempfilename,EnvironmentBase::SO_Body,atts);
+        return str(boost::format("openrave.py --database inversekinematics --usecached --robot=\"%s\" --manipname=%s --iktype=%s --filepermissions=%i")%tempfilename%pmanip->GetName()%striktype%0777);
+    }
+
+    bool SetIkFastCacheDirectory(ostream& sout, istream& sinput)
+    {
+        std::string cachedirectory;
+        getline(sinput, cachedirectory);
+        boost::trim(cachedirectory);
+        _ikfastcachedirectory = cachedirectory;
+        _bIkFastCacheDirectorySet = true;
+        return true;
+    }
+
     /// \brief makes sure ikfast version is already retrieved
     void _EnsureIkFastVersion()
     {
@@ -890,6 +1219,125 @@ public:
         return true;
     }
 
+    bool ComputeReachability(ostream& sout, istream& sinput)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        RobotBasePtr probot;
+        RobotBase::ManipulatorPtr pmanip;
+        int filteroptions = 0, numthreads = 0;
+        bool bUseFreeSpace = false;
+        std::vector<Vector> vrotations, vtranslations;
+        string cmd;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "robot" ) {
+                string name;
+                sinput >> name;
+                probot = GetEnv()->GetRobot(name);
+            }
+            else if( cmd == "manip" ) {
+                string name;
+                sinput >> name;
+                if( !!probot ) {
+                    pmanip = probot->GetManipulator(name);
+                }
+            }
+            else if( cmd == "filteroptions" ) {
+                sinput >> filteroptions;
+            }
+            else if( cmd == "usefreespace" ) {
+                sinput >> bUseFreeSpace;
+            }
+            else if( cmd == "numthreads" ) {
+                sinput >> numthreads;
+            }
+            else if( cmd == "rotations" ) {
+                size_t num = 0;
+                sinput >> num;
+                vrotations.resize(num);
+                FOREACH(it, vrotations) {
+                    sinput >> it->x >> it->y >> it->z >> it->w;
+                }
+            }
+            else if( cmd == "translations" ) {
+                size_t num = 0;
+                sinput >> num;
+                vtranslations.resize(num);
+                FOREACH(it, vtranslations) {
+                    sinput >> it->x >> it->y >> it->z;
+                }
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+
+        if( !probot || !pmanip ) {
+            RAVELOG_WARN("ComputeReachability needs a robot and manip\n");
+            return false;
+        }
+        IkSolverBasePtr piksolver = pmanip->GetIkSolver();
+        if( !piksolver ) {
+            RAVELOG_WARN_FORMAT("manip %s does not have an ik solver", pmanip->GetName());
+            return false;
+        }
+        if( numthreads > 0 ) {
+            stringstream ssin, ssout;
+            ssin << "SetBatchNumThreads " << numthreads;
+            piksolver->SendCommand(ssout, ssin);
+        }
+
+        // solvers take the poses in the manipulator base frame
+        const Transform tbaseinv = pmanip->GetBase()->GetTransform().inverse();
+        // with free joints, a single solution is much faster to find than all of them
+        const bool bSolveAll = bUseFreeSpace || piksolver->GetNumFreeParameters() == 0;
+        std::vector<IkParameterization> vikparams(vrotations.size());
+        std::vector< std::vector<IkReturnPtr> > vvikreturns;
+        std::vector<dReal> vsolution;
+        sout << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        FOREACHC(ittrans, vtranslations) {
+            for(size_t irot = 0; irot < vrotations.size(); ++irot) {
+                vikparams[irot].SetTransform6D(tbaseinv*Transform(vrotations[irot], *ittrans));
+            }
+            int numvalid = 0;
+            std::vector< std::pair<int, int> > vreachable;
+            if( bSolveAll ) {
+                piksolver->SolveAllBatch(vikparams, filteroptions, vvikreturns);
+                for(size_t irot = 0; irot < vvikreturns.size(); ++irot) {
+                    if( vvikreturns[irot].size() > 0 ) {
+                        int numsolutions = bUseFreeSpace ? (int)vvikreturns[irot].size() : 1;
+                        vreachable.push_back(std::make_pair((int)irot, numsolutions));
+                        numvalid += numsolutions;
+                    }
+                }
+            }
+            else {
+                for(size_t irot = 0; irot < vikparams.size(); ++irot) {
+                    if( piksolver->Solve(vikparams[irot], std::vector<dReal>(), filteroptions, boost::shared_ptr< std::vector<dReal> >(&vsolution, utils::null_deleter())) ) {
+                        vreachable.push_back(std::make_pair((int)irot, 1));
+                        numvalid += 1;
+                    }
+                }
+            }
+            sout << numvalid << " " << vreachable.size();
+            FOREACHC(itreachable, vreachable) {
+                sout << " " << itreachable->first << " " << itreachable->second;
+            }
+            sout << endl;
+        }
+        return true;
+    }
+
     bool DebugIKFindSolution(RobotBase::ManipulatorPtr pmanip, const IkParameterization& twrist, std::vector<dReal>& viksolution, int filteroptions, std::vector<dReal>& parameters, int paramindex, dReal deltafree)
     {
         // ignore boundary cases since next to limits and can fail due to limit errosr
@@ -1559,6 +2007,11 @@ public:
 
     string _ikfastversion; ///< current ikfast version (assuming doesn't change during process lifetime)
     string _platform; ///<  current platform architecture. ie x86-64
+    string _ikfastcachedirectory; ///< directory of compiled ik libraries keyed by ik hash and type, empty disables it
+    bool _bIkFastCacheDirectorySet = false; ///< if false, _ikfastcachedirectory has not been initialized from OPENRAVE_IKFAST_CACHE yet
+    boost::mutex _mutexPreload; ///< protects _mapPreloadThreads and _preloadstate
+    std::map<std::string, boost::shared_ptr<boost::thread> > _mapPreloadThreads; ///< ikfastname -> thread started by PreloadIKFastSolver
+    PreloadStatePtr _preloadstate = PreloadStatePtr(new PreloadState()); ///< shared with the threads of _mapPreloadThreads, replaced when they are cancelled
 };
 
 ModuleBasePtr CreateIkFastModule(EnvironmentBasePtr penv, std::istream& sinput)
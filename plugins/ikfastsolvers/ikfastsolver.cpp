@@ -19,6 +19,8 @@
 #include <boost/tuple/tuple.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "batchworkerpool.h"
+
 #ifdef OPENRAVE_HAS_LAPACK
 #include "jacobianinverse.h"
 #endif
@@ -81,8 +83,26 @@ public:
         RegisterCommand("SetBackTraceSelfCollisionLinks",boost::bind(&IkFastSolver<IkReal>::_SetBackTraceSelfCollisionLinksCommand,this,_1,_2),
                         "format: int int\n\n\
 for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfCollisionWithFree, when pruning self collisions, the number of links to look at. If the tip of the manip self collides with the base, then can safely quit the IK.");
+        RegisterCommand("SetBatchNumThreads",boost::bind(&IkFastSolver<IkReal>::_SetBatchNumThreadsCommand,this,_1,_2),
+                        "sets the number of threads SolveAllBatch uses for computing the analytic ik solutions when there are no free joints. Default is 1.");
+        RegisterCommand("SetSolutionCache",boost::bind(&IkFastSolver<IkReal>::_SetSolutionCacheCommand,this,_1,_2),
+                        "format: int [float]\n\nsets the number of SolveAll results to cache and optionally the quantization of the ik values used as the cache key. Solutions are only reused for the same pose, filter options, collision checker and collision options, and robot and environment state; a different pose with the same quantized key is solved again and replaces the entry. 0 disables the cache, which is the default.");
+        RegisterCommand("GetFilterStatistics",boost::bind(&IkFastSolver<IkReal>::_GetFilterStatisticsCommand,this,_1,_2),
+                        "returns one line per validation stage (kinematics, jointlimits, customfilters, selfcollision, envcollision) with the number of calls, the number of rejections and the total time in microseconds.");
+        RegisterCommand("ResetFilterStatistics",boost::bind(&IkFastSolver<IkReal>::_ResetFilterStatisticsCommand,this,_1,_2),
+                        "resets the counters returned by GetFilterStatistics.");
+        RegisterCommand("SetFreeSweepNumThreads",boost::bind(&IkFastSolver<IkReal>::_SetFreeSweepNumThreadsCommand,this,_1,_2),
+                        "sets the number of threads used for computing the analytic ik solutions of the free joint samples in parallel. The filters are still called in order of the free joint distance to q0. Default is 1, which searches serially.");
         _numBacktraceLinksForSelfCollisionWithNonMoving = 2;
         _numBacktraceLinksForSelfCollisionWithFree = 0;
+        _nBatchNumThreads = 1;
+        _nFreeSweepNumThreads = 1;
+        _nSolutionCacheSize = 0;
+        _fSolutionCacheQuantization = 1e-5;
+        _pcountersolve = RegisterPerfCounter("ik.solve");
+        _pcountersuccess = RegisterPerfCounter("ik.success");
+        _pcountercachehit = RegisterPerfCounter("ik.solutioncache.hit");
+        _pcountercachemiss = RegisterPerfCounter("ik.solutioncache.miss");
     }
     virtual ~IkFastSolver() {
     }
@@ -99,6 +119,7 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
 
     bool _SetIkThresholdCommand(ostream& sout, istream& sinput)
     {
+        _ClearSolutionCache();
         sinput >> _ikthreshold;
         return !!sinput;
     }
@@ -119,6 +140,7 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
     void _SetJacobianRefine(dReal f, int nMaxIterations)
     {
 #ifdef OPENRAVE_HAS_LAPACK
+        _ClearSolutionCache();
         _fRefineWithJacobianInverseAllowedError = f;
         _jacobinvsolver.SetErrorThresh(_fRefineWithJacobianInverseAllowedError);
         if( nMaxIterations >= 0 ) {
@@ -138,6 +160,7 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
     {
         dReal fFreeIncRevolute=0.1, fFreeIncPrismaticNum=100;
         sinput >> fFreeIncRevolute >> fFreeIncPrismaticNum >> _fFreeIncRevolute >> _fFreeIncPrismaticNum;
+        _ClearSolutionCache();
         _vFreeInc.resize(_vfreeparams.size());
         for(size_t i = 0; i < _vFreeInc.size(); ++i) {
             if( _vfreerevolute.at(i) ) {
@@ -156,6 +179,7 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
         if( _vFreeInc.size() == 0 ) {
             return true;
         }
+        _ClearSolutionCache();
         FOREACHC(it, _vFreeInc) {
             sinput >> *it;
         }
@@ -209,6 +233,63 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
         return true;
     }
 
+    bool _SetBatchNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int nthreads = 1;
+        sinput >> nthreads;
+        if( !sinput ) {
+            return false;
+        }
+        _nBatchNumThreads = max(1, nthreads);
+        return true;
+    }
+
+    bool _SetSolutionCacheCommand(ostream& sout, istream& sinput)
+    {
+        int nsize = 0;
+        sinput >> nsize;
+        if( !sinput ) {
+            return false;
+        }
+        dReal fquantization = _fSolutionCacheQuantization;
+        sinput >> fquantization;
+        if( !!sinput && fquantization > 0 ) {
+            _fSolutionCacheQuantization = fquantization;
+        }
+        _nSolutionCacheSize = max(0, nsize);
+        _ClearSolutionCache();
+        return true;
+    }
+
+    bool _GetFilterStatisticsCommand(ostream& sout, istream& sinput)
+    {
+        static const char* s_stagenames[FS_NumStages] = {"kinematics", "jointlimits", "customfilters", "selfcollision", "envcollision"};
+        for(int istage = 0; istage < FS_NumStages; ++istage) {
+            const FilterStageStatistics& stats = _vFilterStageStatistics[istage];
+            sout << s_stagenames[istage] << " " << stats.numcalls << " " << stats.numrejected << " " << stats.totaltimeus << endl;
+        }
+        return true;
+    }
+
+    bool _ResetFilterStatisticsCommand(ostream& sout, istream& sinput)
+    {
+        for(int istage = 0; istage < FS_NumStages; ++istage) {
+            _vFilterStageStatistics[istage] = FilterStageStatistics();
+        }
+        return true;
+    }
+
+    bool _SetFreeSweepNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int nthreads = 1;
+        sinput >> nthreads;
+        if( !sinput ) {
+            return false;
+        }
+        _nFreeSweepNumThreads = max(1, nthreads);
+        return true;
+    }
+
     virtual IkReturnAction CallFilters(const IkParameterization& param, IkReturnPtr ikreturn, int minpriority, int maxpriority) {
         // have to convert to the manipulator's base coordinate system
         RobotBase::ManipulatorPtr pmanip(_pmanip);
@@ -231,6 +312,7 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
 
     virtual void SetJointLimits()
     {
+        _ClearSolutionCache();
         RobotBase::ManipulatorPtr pmanip(_pmanip);
         RobotBasePtr probot = pmanip->GetRobot();
         RobotBase::RobotStateSaver saver(probot);
@@ -289,6 +371,7 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
         if( !bfound ) {
             throw OPENRAVE_EXCEPTION_FORMAT(_("manipulator %s not found in robot"), pmanip->GetName(), ORE_InvalidArguments);
         }
+        _ClearSolutionCache();
 
         _cblimits = probot->RegisterChangeCallback(KinBody::Prop_JointLimits,boost::bind(&IkFastSolver<IkReal>::SetJointLimits,boost::bind(&utils::sptr_from<IkFastSolver<IkReal> >, weak_solver())));
 
@@ -413,6 +496,23 @@ for numBacktraceLinksForSelfCollisionWithNonMoving numBacktraceLinksForSelfColli
         return false;
     }
 
+    /// \brief the validation stages of an ik solution, timed separately
+    enum FilterStage
+    {
+        FS_Kinematics = 0, ///< analytic ik call
+        FS_JointLimits,
+        FS_CustomFilters, ///< filters with priority above 0, run before the collision checks
+        FS_SelfCollision,
+        FS_EnvCollision, ///< end effector and then the full robot against the environment
+        FS_NumStages,
+    };
+    struct FilterStageStatistics
+    {
+        FilterStageStatistics() : numcalls(0), numrejected(0), totaltimeus(0) {
+        }
+        uint64_t numcalls, numrejected, totaltimeus;
+    };
+
     /// \brief manages the enabling and disabling of the end effector links depending on the filter options
     class StateCheckEndEffector
     {
@@ -664,6 +764,7 @@ protected:
 
     virtual bool Solve(const IkParameterization& rawparam, const std::vector<dReal>& q0, int filteroptions, IkReturnPtr ikreturn)
     {
+        utils::PerfCounterTimer solvetimer(*_pcountersolve);
         IkParameterization ikparamdummy;
         const IkParameterization& param = _ConvertIkParameterization(rawparam, ikparamdummy);
         if( !!ikreturn ) {
@@ -676,15 +777,25 @@ protected:
         std::vector<IkReal> vfree(_vfreeparams.size());
         StateCheckEndEffector stateCheck(probot,_vchildlinks,_vindependentlinks,filteroptions);
         CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
-        IkReturnAction retaction = ComposeSolution(_vfreeparams, vfree, 0, q0, boost::bind(&IkFastSolver::_SolveSingle,shared_solver(), boost::ref(param),boost::ref(vfree),boost::ref(q0),filteroptions,ikreturn,boost::ref(stateCheck)), _vFreeInc);
+        IkReturnAction retaction;
+        if( _nFreeSweepNumThreads > 1 && _vfreeparams.size() > 0 ) {
+            retaction = _ComposeSolutionParallel(param, q0, boost::bind(&IkFastSolver::_ValidateSolutionsSingle,shared_solver(), boost::cref(param),_1,boost::cref(q0),filteroptions,ikreturn,boost::ref(stateCheck)), IKRA_RejectKinematics);
+        }
+        else {
+            retaction = ComposeSolution(_vfreeparams, vfree, 0, q0, boost::bind(&IkFastSolver::_SolveSingle,shared_solver(), boost::ref(param),boost::ref(vfree),boost::ref(q0),filteroptions,ikreturn,boost::ref(stateCheck)), _vFreeInc);
+        }
         if( !!ikreturn ) {
             ikreturn->_action = retaction;
         }
+        if( retaction == IKRA_Success ) {
+            _pcountersuccess->Add();
+        }
         return retaction == IKRA_Success;
     }
 
     virtual bool SolveAll(const IkParameterization& rawparam, int filteroptions, std::vector<IkReturnPtr>& vikreturns)
     {
+        utils::PerfCounterTimer solvetimer(*_pcountersolve);
         vikreturns.resize(0);
         IkParameterization ikparamdummy;
         const IkParameterization& param = _ConvertIkParameterization(rawparam, ikparamdummy);
@@ -692,19 +803,151 @@ protected:
         RobotBasePtr probot = pmanip->GetRobot();
         RobotBase::RobotStateSaver saver(probot);
         probot->SetActiveDOFs(pmanip->GetArmIndices());
+
+        // custom filters can depend on anything, so only cache when none of them are called
+        bool bUseCache = _nSolutionCacheSize > 0 && ((filteroptions & IKFO_IgnoreCustomFilters) || !_HasFilterInRange(IKSP_MinPriority, IKSP_MaxPriority));
+        std::vector<int64_t> vcachekey;
+        std::vector<dReal> vcachestate;
+        if( bUseCache ) {
+            _GetSolutionCacheKey(param, filteroptions, vcachekey, vcachestate);
+            if( _FindCachedSolutions(vcachekey, vcachestate, vikreturns) ) {
+                _pcountercachehit->Add();
+                if( vikreturns.size() > 0 ) {
+                    _pcountersuccess->Add();
+                }
+                return vikreturns.size()>0;
+            }
+            _pcountercachemiss->Add();
+        }
+
         std::vector<IkReal> vfree(_vfreeparams.size());
         StateCheckEndEffector stateCheck(probot,_vchildlinks,_vindependentlinks,filteroptions);
         CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
-        IkReturnAction retaction = ComposeSolution(_vfreeparams, vfree, 0, vector<dReal>(), boost::bind(&IkFastSolver::_SolveAll,shared_solver(), param,boost::ref(vfree),filteroptions,boost::ref(vikreturns), boost::ref(stateCheck)), _vFreeInc);
+        IkReturnAction retaction;
+        if( _nFreeSweepNumThreads > 1 && _vfreeparams.size() > 0 ) {
+            retaction = _ComposeSolutionParallel(param, vector<dReal>(), boost::bind(&IkFastSolver::_ValidateSolutionsAll,shared_solver(), boost::cref(param),_1,filteroptions,boost::ref(vikreturns), boost::ref(stateCheck)), IKRA_Reject);
+        }
+        else {
+            retaction = ComposeSolution(_vfreeparams, vfree, 0, vector<dReal>(), boost::bind(&IkFastSolver::_SolveAll,shared_solver(), param,boost::ref(vfree),filteroptions,boost::ref(vikreturns), boost::ref(stateCheck)), _vFreeInc);
+        }
         if( retaction & IKRA_Quit ) {
             return false;
         }
         _SortSolutions(probot, vikreturns);
+        if( bUseCache ) {
+            _AddCachedSolutions(vcachekey, vcachestate, vikreturns);
+        }
+        if( vikreturns.size() > 0 ) {
+            _pcountersuccess->Add();
+        }
         return vikreturns.size()>0;
     }
 
+    /// \brief computes the cache key of a SolveAll call and the state of everything else the filters look at.
+    ///
+    /// The key holds the ik type, the filter options, the collision checker and its options, and the quantized ik values. The state
+    /// holds the exact ik values, the robot base transform, the dof values outside of the arm, the link enable states and the grabbed
+    /// bodies, and when checking environment collisions the id, update stamp and enable state of all the other bodies.
+    void _GetSolutionCacheKey(const IkParameterization& param, int filteroptions, std::vector<int64_t>& vcachekey, std::vector<dReal>& vcachestate)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        CollisionCheckerBasePtr pchecker = GetEnv()->GetCollisionChecker();
+        std::vector<dReal> vvalues(param.GetNumberOfValues());
+        param.GetValues(vvalues.begin());
+        vcachekey.resize(4+vvalues.size());
+        vcachekey[0] = param.GetType();
+        vcachekey[1] = filteroptions;
+        vcachekey[2] = (int64_t)(uintptr_t)pchecker.get();
+        vcachekey[3] = !!pchecker ? pchecker->GetCollisionOptions() : 0;
+        for(size_t i = 0; i < vvalues.size(); ++i) {
+            vcachekey[4+i] = (int64_t)std::floor(vvalues[i]/_fSolutionCacheQuantization+0.5);
+        }
+
+        // the solutions of a pose are not the solutions of another pose with the same quantized values, so the exact values have to match
+        vcachestate = vvalues;
+        Transform tbase = probot->GetTransform();
+        vcachestate.push_back(tbase.rot.x); vcachestate.push_back(tbase.rot.y); vcachestate.push_back(tbase.rot.z); vcachestate.push_back(tbase.rot.w);
+        vcachestate.push_back(tbase.trans.x); vcachestate.push_back(tbase.trans.y); vcachestate.push_back(tbase.trans.z);
+        std::vector<dReal> vdofvalues;
+        probot->GetDOFValues(vdofvalues);
+        FOREACHC(itindex, pmanip->GetArmIndices()) {
+            vdofvalues.at(*itindex) = 0;
+        }
+        vcachestate.insert(vcachestate.end(), vdofvalues.begin(), vdofvalues.end());
+        std::vector<uint8_t> venablestates;
+        probot->GetLinkEnableStates(venablestates);
+        vcachestate.insert(vcachestate.end(), venablestates.begin(), venablestates.end());
+        std::vector<KinBodyPtr> vgrabbed;
+        probot->GetGrabbed(vgrabbed);
+        vcachestate.push_back(vgrabbed.size());
+        FOREACHC(itgrabbed, vgrabbed) {
+            vcachestate.push_back((*itgrabbed)->GetEnvironmentId());
+        }
+        if( filteroptions & IKFO_CheckEnvCollisions ) {
+            std::vector<KinBodyPtr> vbodies;
+            GetEnv()->GetBodies(vbodies);
+            FOREACHC(itbody, vbodies) {
+                if( *itbody == probot || find(vgrabbed.begin(), vgrabbed.end(), *itbody) != vgrabbed.end() ) {
+                    continue;
+                }
+                vcachestate.push_back((*itbody)->GetEnvironmentId());
+                vcachestate.push_back((*itbody)->GetUpdateStamp());
+                vcachestate.push_back((*itbody)->IsEnabled());
+            }
+        }
+    }
+
+    /// \brief looks up the cached solutions of a key, they are only returned if the exact pose and the state match
+    bool _FindCachedSolutions(const std::vector<int64_t>& vcachekey, const std::vector<dReal>& vcachestate, std::vector<IkReturnPtr>& vikreturns)
+    {
+        typename std::map<std::vector<int64_t>, typename SolutionCacheList::iterator>::iterator itcache = _mapSolutionCache.find(vcachekey);
+        if( itcache == _mapSolutionCache.end() ) {
+            return false;
+        }
+        typename SolutionCacheList::iterator itentry = itcache->second;
+        if( itentry->vstate != vcachestate ) {
+            return false;
+        }
+        vikreturns.resize(itentry->vikreturns.size());
+        for(size_t i = 0; i < vikreturns.size(); ++i) {
+            vikreturns[i].reset(new IkReturn(*itentry->vikreturns[i]));
+        }
+        _listSolutionCache.splice(_listSolutionCache.begin(), _listSolutionCache, itentry);
+        return true;
+    }
+
+    void _AddCachedSolutions(const std::vector<int64_t>& vcachekey, const std::vector<dReal>& vcachestate, const std::vector<IkReturnPtr>& vikreturns)
+    {
+        typename std::map<std::vector<int64_t>, typename SolutionCacheList::iterator>::iterator itcache = _mapSolutionCache.find(vcachekey);
+        if( itcache != _mapSolutionCache.end() ) {
+            _listSolutionCache.erase(itcache->second);
+            _mapSolutionCache.erase(itcache);
+        }
+        while( _listSolutionCache.size() >= _nSolutionCacheSize ) {
+            _mapSolutionCache.erase(_listSolutionCache.back().vkey);
+            _listSolutionCache.pop_back();
+        }
+        _listSolutionCache.push_front(SolutionCacheEntry());
+        SolutionCacheEntry& entry = _listSolutionCache.front();
+        entry.vkey = vcachekey;
+        entry.vstate = vcachestate;
+        entry.vikreturns.resize(vikreturns.size());
+        for(size_t i = 0; i < vikreturns.size(); ++i) {
+            entry.vikreturns[i].reset(new IkReturn(*vikreturns[i]));
+        }
+        _mapSolutionCache[vcachekey] = _listSolutionCache.begin();
+    }
+
+    void _ClearSolutionCache()
+    {
+        _listSolutionCache.clear();
+        _mapSolutionCache.clear();
+    }
+
     virtual bool Solve(const IkParameterization& rawparam, const std::vector<dReal>& q0, const std::vector<dReal>& vFreeParameters, int filteroptions, IkReturnPtr ikreturn)
     {
+        utils::PerfCounterTimer solvetimer(*_pcountersolve);
         IkParameterization ikparamdummy;
         const IkParameterization& param = _ConvertIkParameterization(rawparam, ikparamdummy);
         if( vFreeParameters.size() != _vfreeparams.size() ) {
@@ -727,11 +970,15 @@ protected:
         if( !!ikreturn ) {
             ikreturn->_action = retaction;
         }
+        if( retaction == IKRA_Success ) {
+            _pcountersuccess->Add();
+        }
         return retaction==IKRA_Success;
     }
 
     virtual bool SolveAll(const IkParameterization& rawparam, const std::vector<dReal>& vFreeParameters, int filteroptions, std::vector<IkReturnPtr>& vikreturns)
     {
+        utils::PerfCounterTimer solvetimer(*_pcountersolve);
         vikreturns.resize(0);
         IkParameterization ikparamdummy;
         const IkParameterization& param = _ConvertIkParameterization(rawparam, ikparamdummy);
@@ -753,9 +1000,77 @@ protected:
             return false;
         }
         _SortSolutions(probot, vikreturns);
+        if( vikreturns.size() > 0 ) {
+            _pcountersuccess->Add();
+        }
         return vikreturns.size()>0;
     }
 
+    virtual bool SolveAllBatch(const std::vector<IkParameterization>& vrawparams, int filteroptions, std::vector< std::vector<IkReturnPtr> >& vvikreturns)
+    {
+        vvikreturns.resize(vrawparams.size());
+        if( vrawparams.size() == 0 ) {
+            return false;
+        }
+        std::vector<IkParameterization> vparams(vrawparams.size());
+        for(size_t iparam = 0; iparam < vrawparams.size(); ++iparam) {
+            IkParameterization ikparamdummy;
+            vparams[iparam] = _ConvertIkParameterization(vrawparams[iparam], ikparamdummy);
+        }
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pmanip->GetArmIndices());
+
+        // without free joints every pose needs exactly one analytic ik call, and since that does not touch the environment, compute all of them up front
+        std::vector< ikfast::IkSolutionList<IkReal> > vsolutions;
+        std::vector<uint8_t> vsolved;
+        uint64_t batchtime = 0; // time of the up front ik calls, shared among the poses in the ik.solve counter
+        if( _vfreeparams.size() == 0 ) {
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            _ComputeIkBatch(vparams, pmanip->GetLocalToolTransform(), vsolutions, vsolved);
+            batchtime = (utils::GetNanoPerformanceTime()-starttime)/vparams.size();
+        }
+
+        std::vector<IkReal> vfree(_vfreeparams.size());
+        StateCheckEndEffector stateCheck(probot,_vchildlinks,_vindependentlinks,filteroptions);
+        CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
+        bool bsuccess = false;
+        for(size_t iparam = 0; iparam < vparams.size(); ++iparam) {
+            vvikreturns[iparam].resize(0);
+        }
+        for(size_t iparam = 0; iparam < vparams.size(); ++iparam) {
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            std::vector<IkReturnPtr>& vikreturns = vvikreturns[iparam];
+            stateCheck.numImpossibleSelfCollisions = 0;
+            IkReturnAction retaction = IKRA_Reject;
+            if( vsolutions.size() > 0 ) {
+                if( vsolved[iparam] ) {
+                    retaction = _ValidateSolutionsAll(vparams[iparam], vsolutions[iparam], filteroptions, vikreturns, stateCheck);
+                }
+            }
+            else if( _nFreeSweepNumThreads > 1 ) {
+                retaction = _ComposeSolutionParallel(vparams[iparam], vector<dReal>(), boost::bind(&IkFastSolver::_ValidateSolutionsAll,shared_solver(), boost::cref(vparams[iparam]),_1,filteroptions,boost::ref(vikreturns), boost::ref(stateCheck)), IKRA_Reject);
+            }
+            else {
+                retaction = ComposeSolution(_vfreeparams, vfree, 0, vector<dReal>(), boost::bind(&IkFastSolver::_SolveAll,shared_solver(), boost::cref(vparams[iparam]),boost::ref(vfree),filteroptions,boost::ref(vikreturns), boost::ref(stateCheck)), _vFreeInc);
+            }
+            if( retaction & IKRA_Quit ) {
+                // like SolveAll, a filter asking to quit stops the whole query and the poses after it are not solved
+                _pcountersolve->Add(utils::GetNanoPerformanceTime()-starttime+batchtime);
+                vikreturns.resize(0);
+                return false;
+            }
+            _SortSolutions(probot, vikreturns);
+            _pcountersolve->Add(utils::GetNanoPerformanceTime()-starttime+batchtime);
+            if( vikreturns.size() > 0 ) {
+                _pcountersuccess->Add();
+                bsuccess = true;
+            }
+        }
+        return bsuccess;
+    }
+
     virtual int GetNumFreeParameters() const
     {
         return (int)_vfreeparams.size();
@@ -833,6 +1148,11 @@ protected:
         _kinematicshash = r->_kinematicshash;
         _numBacktraceLinksForSelfCollisionWithNonMoving = r->_numBacktraceLinksForSelfCollisionWithNonMoving;
         _numBacktraceLinksForSelfCollisionWithFree = r->_numBacktraceLinksForSelfCollisionWithFree;
+        _nBatchNumThreads = r->_nBatchNumThreads;
+        _nFreeSweepNumThreads = r->_nFreeSweepNumThreads;
+        _nSolutionCacheSize = r->_nSolutionCacheSize;
+        _fSolutionCacheQuantization = r->_fSolutionCacheQuantization;
+        _ClearSolutionCache();
         _ikthreshold = r->_ikthreshold;
 #ifdef OPENRAVE_HAS_LAPACK
         _SetJacobianRefine(r->_fRefineWithJacobianInverseAllowedError, r->_jacobinvsolver._nMaxIterations);
@@ -1293,10 +1613,19 @@ protected:
     {
         RobotBase::ManipulatorPtr pmanip(_pmanip);
         ikfast::IkSolutionList<IkReal> solutions;
-        if( !_CallIk(param,vfree, pmanip->GetLocalToolTransform(), solutions) ) {
+        uint64_t starttime = utils::GetMicroTime();
+        bool bsuccess = _CallIk(param,vfree, pmanip->GetLocalToolTransform(), solutions);
+        _AddStageStatistics(FS_Kinematics, starttime, !bsuccess);
+        if( !bsuccess ) {
             return IKRA_RejectKinematics;
         }
+        return _ValidateSolutionsSingle(param, solutions, q0, filteroptions, ikreturn, stateCheck);
+    }
 
+    /// \brief finds the valid solution closest to q0 among the analytic solutions of one ik call
+    IkReturnAction _ValidateSolutionsSingle(const IkParameterization& param, const ikfast::IkSolutionList<IkReal>& solutions, const vector<dReal>& q0, int filteroptions, IkReturnPtr ikreturn, StateCheckEndEffector& stateCheck)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
         RobotBasePtr probot = pmanip->GetRobot();
         SolutionInfo bestsolution;
         std::vector<dReal> vravesol(pmanip->GetArmIndices().size());
@@ -1426,6 +1755,43 @@ protected:
 
     /// validate a solution
     /// \param paramnewglobal[out]
+    inline void _AddStageStatistics(FilterStage stage, uint64_t starttime, bool bRejected)
+    {
+        FilterStageStatistics& stats = _vFilterStageStatistics[stage];
+        stats.numcalls++;
+        stats.totaltimeus += utils::GetMicroTime()-starttime;
+        if( bRejected ) {
+            stats.numrejected++;
+        }
+    }
+
+    /// \brief runs the self and then the environment collision stage, returns the first rejection or IKRA_Success.
+    ///
+    /// The order is fixed: both stages set the robot state they check and the self collision stage can return an IKRA_Quit action
+    /// for impossible self collisions, so running the environment stage first would change which queries quit. The time and
+    /// rejections of every stage are measured for GetFilterStatistics.
+    template <typename SelfCollisionFn, typename EnvCollisionFn>
+    IkReturnAction _RunCollisionStages(int filteroptions, SelfCollisionFn& fnselfcollision, EnvCollisionFn& fnenvcollision)
+    {
+        if( !(filteroptions&IKFO_IgnoreSelfCollisions) ) {
+            uint64_t starttime = utils::GetMicroTime();
+            IkReturnAction retaction = fnselfcollision();
+            _AddStageStatistics(FS_SelfCollision, starttime, retaction != IKRA_Success);
+            if( retaction != IKRA_Success ) {
+                return retaction;
+            }
+        }
+        if( filteroptions&IKFO_CheckEnvCollisions ) {
+            uint64_t starttime = utils::GetMicroTime();
+            IkReturnAction retaction = fnenvcollision();
+            _AddStageStatistics(FS_EnvCollision, starttime, retaction != IKRA_Success);
+            if( retaction != IKRA_Success ) {
+                return retaction;
+            }
+        }
+        return IKRA_Success;
+    }
+
     IkReturnAction _ValidateSolutionSingle(const ikfast::IkSolution<IkReal>& iksol, boost::tuple<const vector<IkReal>&, const vector<dReal>&, int>& freeq0check, std::vector<IkReal>& sol, std::vector<dReal>& vravesol, SolutionInfo& bestsolution, const IkParameterization& param, StateCheckEndEffector& stateCheck, IkParameterization& paramnewglobal)
     {
         const vector<IkReal>& vfree = boost::get<0>(freeq0check);
@@ -1451,7 +1817,9 @@ protected:
 
         int filteroptions = boost::get<2>(freeq0check);
         if( !(filteroptions&IKFO_IgnoreJointLimits) ) {
+            uint64_t starttime = utils::GetMicroTime();
             _ComputeAllSimilarJointAngles(vravesols, vravesol);
+            _AddStageStatistics(FS_JointLimits, starttime, vravesols.size() == 0);
             if( boost::get<1>(freeq0check).size() == vravesol.size() ) {
                 std::vector< std::pair<std::vector<dReal>, int> > vravesols2;
                 // if all the solutions are worse than the best, then ignore everything
@@ -1511,7 +1879,9 @@ protected:
                     // have to make sure end effector collisions are set, regardless if stateCheck.ResetCheckEndEffectorEnvCollision has been called
                     stateCheck.RestoreCheckEndEffectorEnvCollision();
                 }
+                uint64_t starttime = utils::GetMicroTime();
                 IkReturnAction retaction = _CallFilters(itravesol->first, pmanip, paramnew,localret, 1, IKSP_MaxPriority);
+                _AddStageStatistics(FS_CustomFilters, starttime, retaction != IKRA_Success);
                 if( !(filteroptions & IKFO_IgnoreEndEffectorEnvCollisions) && !bNeedCheckEndEffectorEnvCollision ) {
                     stateCheck.ResetCheckEndEffectorEnvCollision();
                 }
@@ -1554,7 +1924,8 @@ protected:
         if( !(filteroptions&IKFO_IgnoreSelfCollisions) || IS_DEBUGLEVEL(Level_Verbose) || paramnewglobal.GetType() == IKP_TranslationDirection5D ) { // 5D is necessary for tracking end effector collisions
             ptempreport = boost::shared_ptr<CollisionReport>(&report,utils::null_deleter());
         }
-        if( !(filteroptions&IKFO_IgnoreSelfCollisions) ) {
+        // the collision stages are run by _RunCollisionStages
+        auto fnselfcollision = [&]() -> IkReturnAction {
             // check for self collisions
             stateCheck.SetSelfCollisionState();
             if( probot->CheckSelfCollision(ptempreport) ) {
@@ -1622,8 +1993,9 @@ protected:
                 }
                 return static_cast<IkReturnAction>(retactionall|IKRA_RejectSelfCollision);
             }
-        }
-        if( filteroptions&IKFO_CheckEnvCollisions ) {
+            return IKRA_Success;
+        };
+        auto fnenvcollision = [&]() -> IkReturnAction {
             stateCheck.SetEnvironmentCollisionState();
             if( stateCheck.NeedCheckEndEffectorEnvCollision() ) {
                 // only check if the end-effector position is fully determined from the ik
@@ -1706,8 +2078,14 @@ protected:
                 }
                 return static_cast<IkReturnAction>(retactionall|IKRA_RejectEnvCollision);
             }
+            return IKRA_Success;
+        };
+        IkReturnAction collisionaction = _RunCollisionStages(filteroptions, fnselfcollision, fnenvcollision);
+        if( collisionaction != IKRA_Success ) {
+            return collisionaction;
         }
 
+
         // check that end effector moved in the correct direction
         dReal ikworkspacedist = param.ComputeDistanceSqr(paramnew);
         if( ikworkspacedist > _ikthreshold ) {
@@ -1849,35 +2227,193 @@ protected:
     IkReturnAction _SolveAll(const IkParameterization& param, const vector<IkReal>& vfree, int filteroptions, std::vector<IkReturnPtr>& vikreturns, StateCheckEndEffector& stateCheck)
     {
         RobotBase::ManipulatorPtr pmanip(_pmanip);
-        RobotBasePtr probot = pmanip->GetRobot();
         ikfast::IkSolutionList<IkReal> solutions;
-        if( _CallIk(param,vfree, pmanip->GetLocalToolTransform(), solutions) ) {
-            vector<IkReal> vsolfree;
-            std::vector<IkReal> sol(pmanip->GetArmIndices().size());
-            for(size_t isolution = 0; isolution < solutions.GetNumSolutions(); ++isolution) {
-                const ikfast::IkSolution<IkReal>& iksol = dynamic_cast<const ikfast::IkSolution<IkReal>& >(solutions.GetSolution(isolution));
-                iksol.Validate();
-                //RAVELOG_VERBOSE_FORMAT("ikfast solution %d/%d (free=%d)", isolution%solutions.GetNumSolutions()%iksol.GetFree().size());
-                if( iksol.GetFree().size() > 0 ) {
-                    // have to search over all the free parameters of the solution!
-                    vsolfree.resize(iksol.GetFree().size());
-                    std::vector<dReal> vFreeInc(_GetFreeIncFromIndices(iksol.GetFree()));
-                    IkReturnAction retaction = ComposeSolution(iksol.GetFree(), vsolfree, 0, vector<dReal>(), boost::bind(&IkFastSolver::_ValidateSolutionAll,shared_solver(), boost::ref(param), boost::ref(iksol), boost::ref(vsolfree), filteroptions, boost::ref(sol), boost::ref(vikreturns), boost::ref(stateCheck)), vFreeInc);
-                    if( retaction & IKRA_Quit) {
-                        return retaction;
-                    }
+        uint64_t starttime = utils::GetMicroTime();
+        bool bsuccess = _CallIk(param,vfree, pmanip->GetLocalToolTransform(), solutions);
+        _AddStageStatistics(FS_Kinematics, starttime, !bsuccess);
+        if( bsuccess ) {
+            return _ValidateSolutionsAll(param, solutions, filteroptions, vikreturns, stateCheck);
+        }
+        return IKRA_Reject; // signals to continue
+    }
+
+    /// \brief validates all the analytic solutions of one ik call, searching over any free parameters of the solutions
+    IkReturnAction _ValidateSolutionsAll(const IkParameterization& param, const ikfast::IkSolutionList<IkReal>& solutions, int filteroptions, std::vector<IkReturnPtr>& vikreturns, StateCheckEndEffector& stateCheck)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        vector<IkReal> vsolfree;
+        std::vector<IkReal> sol(pmanip->GetArmIndices().size());
+        for(size_t isolution = 0; isolution < solutions.GetNumSolutions(); ++isolution) {
+            const ikfast::IkSolution<IkReal>& iksol = dynamic_cast<const ikfast::IkSolution<IkReal>& >(solutions.GetSolution(isolution));
+            iksol.Validate();
+            //RAVELOG_VERBOSE_FORMAT("ikfast solution %d/%d (free=%d)", isolution%solutions.GetNumSolutions()%iksol.GetFree().size());
+            if( iksol.GetFree().size() > 0 ) {
+                // have to search over all the free parameters of the solution!
+                vsolfree.resize(iksol.GetFree().size());
+                std::vector<dReal> vFreeInc(_GetFreeIncFromIndices(iksol.GetFree()));
+                IkReturnAction retaction = ComposeSolution(iksol.GetFree(), vsolfree, 0, vector<dReal>(), boost::bind(&IkFastSolver::_ValidateSolutionAll,shared_solver(), boost::ref(param), boost::ref(iksol), boost::ref(vsolfree), filteroptions, boost::ref(sol), boost::ref(vikreturns), boost::ref(stateCheck)), vFreeInc);
+                if( retaction & IKRA_Quit) {
+                    return retaction;
                 }
-                else {
-                    IkReturnAction retaction = _ValidateSolutionAll(param, iksol, vector<IkReal>(), filteroptions, sol, vikreturns, stateCheck);
-                    if( retaction & IKRA_Quit ) {
-                        return retaction;
-                    }
+            }
+            else {
+                IkReturnAction retaction = _ValidateSolutionAll(param, iksol, vector<IkReal>(), filteroptions, sol, vikreturns, stateCheck);
+                if( retaction & IKRA_Quit ) {
+                    return retaction;
                 }
             }
         }
         return IKRA_Reject; // signals to continue
     }
 
+    /// \brief calls the analytic ik on every pose without free parameters, splitting the poses over _nBatchNumThreads threads
+    void _ComputeIkBatch(const std::vector<IkParameterization>& vparams, const Transform& tLocalTool, std::vector< ikfast::IkSolutionList<IkReal> >& vsolutions, std::vector<uint8_t>& vsolved)
+    {
+        vsolutions.resize(vparams.size());
+        vsolved.resize(vparams.size());
+        _RunParallel(vparams.size(), _nBatchNumThreads, boost::bind(&IkFastSolver::_ComputeIkRange, this, boost::cref(vparams), boost::cref(tLocalTool), boost::ref(vsolutions), boost::ref(vsolved), _1, _2));
+    }
+
+    void _ComputeIkRange(const std::vector<IkParameterization>& vparams, const Transform& tLocalTool, std::vector< ikfast::IkSolutionList<IkReal> >& vsolutions, std::vector<uint8_t>& vsolved, size_t istart, size_t iend)
+    {
+        if( _ComputeIkBatchTransform6D(vparams, tLocalTool, vsolutions, vsolved, istart, iend) ) {
+            return;
+        }
+        std::vector<IkReal> vfree;
+        for(size_t iparam = istart; iparam < iend; ++iparam) {
+            vsolved[iparam] = 0;
+            try {
+                vsolved[iparam] = _CallIk(vparams[iparam], vfree, tLocalTool, vsolutions[iparam]);
+            }
+            catch(const std::exception& e) {
+                RAVELOG_WARN_FORMAT("ik call failed for ik %s: %s", GetXMLId()%e.what());
+            }
+        }
+    }
+
+    /// \brief if the library exports ComputeIkBatch and all the poses in [istart, iend) are Transform6D, solves them with one batched call. Returns false if the poses have to be solved one by one.
+    bool _ComputeIkBatchTransform6D(const std::vector<IkParameterization>& vparams, const Transform& tLocalTool, std::vector< ikfast::IkSolutionList<IkReal> >& vsolutions, std::vector<uint8_t>& vsolved, size_t istart, size_t iend)
+    {
+        if( !_ikfunctions->_ComputeIkBatch || iend <= istart ) {
+            return false;
+        }
+        for(size_t iparam = istart; iparam < iend; ++iparam) {
+            if( vparams[iparam].GetType() != IKP_Transform6D ) {
+                return false;
+            }
+        }
+        const size_t numposes = iend-istart;
+        std::vector<IkReal> veetrans(3*numposes), veerot(9*numposes);
+        std::vector<ikfast::IkSolutionListBase<IkReal>*> vpsolutions(numposes);
+        for(size_t ipose = 0; ipose < numposes; ++ipose) {
+            TransformMatrix t = vparams[istart+ipose].GetTransform6D();
+            if( _bEmptyTransform6D ) {
+                t = t * tLocalTool.inverse();
+            }
+            veetrans[0*numposes+ipose] = t.trans.x;
+            veetrans[1*numposes+ipose] = t.trans.y;
+            veetrans[2*numposes+ipose] = t.trans.z;
+            for(int j = 0; j < 3; ++j) {
+                veerot[(3*j+0)*numposes+ipose] = t.m[4*j+0];
+                veerot[(3*j+1)*numposes+ipose] = t.m[4*j+1];
+                veerot[(3*j+2)*numposes+ipose] = t.m[4*j+2];
+            }
+            vpsolutions[ipose] = &vsolutions[istart+ipose];
+        }
+        _ikfunctions->_ComputeIkBatch((int)numposes, &veetrans[0], &veerot[0], NULL, &vpsolutions[0], &vsolved[istart]);
+        if( _fRefineWithJacobianInverseAllowedError > 0 ) {
+            // the single pose call retries failed poses with a small jitter, so have to go through it for the failed ones
+            std::vector<IkReal> vfree;
+            for(size_t iparam = istart; iparam < iend; ++iparam) {
+                if( !vsolved[iparam] ) {
+                    try {
+                        vsolved[iparam] = _CallIk(vparams[iparam], vfree, tLocalTool, vsolutions[iparam]);
+                    }
+                    catch(const std::exception& e) {
+                        RAVELOG_WARN_FORMAT("ik call failed for ik %s: %s", GetXMLId()%e.what());
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /// \brief calls the analytic ik of param for the free samples [ioffset+istart, ioffset+iend) of vfreesamples
+    void _ComputeIkFreeRange(const IkParameterization& param, const std::vector< std::vector<IkReal> >& vfreesamples, size_t ioffset, const Transform& tLocalTool, std::vector< ikfast::IkSolutionList<IkReal> >& vsolutions, std::vector<uint8_t>& vsolved, size_t istart, size_t iend)
+    {
+        for(size_t i = istart; i < iend; ++i) {
+            vsolved[i] = 0;
+            try {
+                vsolved[i] = _CallIk(param, vfreesamples.at(ioffset+i), tLocalTool, vsolutions[i]);
+            }
+            catch(const std::exception& e) {
+                RAVELOG_WARN_FORMAT("ik call failed for ik %s: %s", GetXMLId()%e.what());
+            }
+        }
+    }
+
+    /// \brief calls fn(istart, iend) on numthreads contiguous ranges covering [0, num) with the threads of _batchworkerpool and the calling thread
+    void _RunParallel(size_t num, int numthreads, const boost::function<void(size_t, size_t)>& fn)
+    {
+        size_t numranges = min((size_t)max(1, numthreads), num);
+        if( numranges <= 1 ) {
+            fn(0, num);
+            return;
+        }
+        size_t numperrange = (num+numranges-1)/numranges;
+        numranges = (num+numperrange-1)/numperrange;
+        _batchworkerpool.Run(numranges, numthreads, boost::bind(&IkFastSolver::_RunRange, boost::cref(fn), num, numperrange, _1));
+    }
+
+    static void _RunRange(const boost::function<void(size_t, size_t)>& fn, size_t num, size_t numperrange, size_t irange)
+    {
+        fn(irange*numperrange, min((irange+1)*numperrange, num));
+    }
+
+    static IkReturnAction _AddFreeSample(const std::vector<IkReal>& vfree, std::vector< std::vector<IkReal> >& vfreesamples)
+    {
+        vfreesamples.push_back(vfree);
+        return IKRA_Reject;
+    }
+
+    /** \brief same search as ComposeSolution over _vfreeparams, except that the analytic ik of the free samples is computed in parallel chunks over _nFreeSweepNumThreads threads.
+
+        The samples are visited in the order ComposeSolution visits them, which is by increasing distance of the free joints
+        to q0. fnvalidate runs the filters on the calling thread, and the search stops at the first sample that is not rejected.
+        \param retkinematicsfailed the action to use for samples whose analytic ik has no solutions
+     */
+    IkReturnAction _ComposeSolutionParallel(const IkParameterization& param, const vector<dReal>& q0, const boost::function<IkReturnAction(const ikfast::IkSolutionList<IkReal>&)>& fnvalidate, IkReturnAction retkinematicsfailed)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        std::vector< std::vector<IkReal> > vfreesamples;
+        std::vector<IkReal> vfree(_vfreeparams.size());
+        ComposeSolution(_vfreeparams, vfree, 0, q0, boost::bind(&IkFastSolver::_AddFreeSample, boost::cref(vfree), boost::ref(vfreesamples)), _vFreeInc);
+
+        const Transform tLocalTool = pmanip->GetLocalToolTransform();
+        const size_t chunksize = 8*_nFreeSweepNumThreads; // keep chunks small so that a solution close to q0 stops the search early
+        std::vector< ikfast::IkSolutionList<IkReal> > vsolutions;
+        std::vector<uint8_t> vsolved;
+        int allres = IKRA_Reject;
+        for(size_t ioffset = 0; ioffset < vfreesamples.size(); ioffset += chunksize) {
+            size_t num = min(chunksize, vfreesamples.size()-ioffset);
+            vsolutions.resize(0);
+            vsolutions.resize(num);
+            vsolved.resize(num);
+            _RunParallel(num, _nFreeSweepNumThreads, boost::bind(&IkFastSolver::_ComputeIkFreeRange, this, boost::cref(param), boost::cref(vfreesamples), ioffset, boost::cref(tLocalTool), boost::ref(vsolutions), boost::ref(vsolved), _1, _2));
+            for(size_t i = 0; i < num; ++i) {
+                IkReturnAction res = vsolved[i] ? fnvalidate(vsolutions[i]) : retkinematicsfailed;
+                if( !(res & IKRA_Reject) ) {
+                    return res;
+                }
+                if( res & IKRA_Quit ) {
+                    return res;
+                }
+                allres |= res;
+            }
+        }
+        return static_cast<IkReturnAction>(allres);
+    }
+
     IkReturnAction _ValidateSolutionAll(const IkParameterization& param, const ikfast::IkSolution<IkReal>& iksol, const vector<IkReal>& vfree, int filteroptions, std::vector<IkReal>& sol, std::vector<IkReturnPtr>& vikreturns, StateCheckEndEffector& stateCheck)
     {
         iksol.GetSolution(sol,vfree);
@@ -1891,7 +2427,9 @@ protected:
 
         // find the first valid solutino that satisfies joint constraints and collisions
         if( !(filteroptions&IKFO_IgnoreJointLimits) ) {
+            uint64_t starttime = utils::GetMicroTime();
             _ComputeAllSimilarJointAngles(vravesols, vravesol);
+            _AddStageStatistics(FS_JointLimits, starttime, vravesols.size() == 0);
             if( vravesols.size() == 0 ) {
                 return IKRA_RejectJointLimits;
             }
@@ -1948,7 +2486,9 @@ protected:
                     // have to make sure end effector collisions are set, regardless if stateCheck.ResetCheckEndEffectorEnvCollision has been called
                     stateCheck.RestoreCheckEndEffectorEnvCollision();
                 }
+                uint64_t starttime = utils::GetMicroTime();
                 IkReturnAction retaction = _CallFilters(itravesol->first, pmanip, paramnew,localret, 1, IKSP_MaxPriority);
+                _AddStageStatistics(FS_CustomFilters, starttime, retaction != IKRA_Success);
                 if( !(filteroptions & IKFO_IgnoreEndEffectorEnvCollisions) && !bNeedCheckEndEffectorEnvCollision ) {
                     stateCheck.ResetCheckEndEffectorEnvCollision();
                 }
@@ -1991,7 +2531,8 @@ protected:
         if( IS_DEBUGLEVEL(Level_Verbose) ) {
             ptempreport = boost::shared_ptr<CollisionReport>(&report,utils::null_deleter());
         }
-        if( !(filteroptions&IKFO_IgnoreSelfCollisions) ) {
+        // the collision stages are run by _RunCollisionStages
+        auto fnselfcollision = [&]() -> IkReturnAction {
             stateCheck.SetSelfCollisionState();
             if( probot->CheckSelfCollision(ptempreport) ) {
                 if( !!ptempreport ) {
@@ -2057,8 +2598,9 @@ protected:
                 }
                 return static_cast<IkReturnAction>(retactionall|IKRA_RejectSelfCollision);
             }
-        }
-        if( (filteroptions&IKFO_CheckEnvCollisions) ) {
+            return IKRA_Success;
+        };
+        auto fnenvcollision = [&]() -> IkReturnAction {
             stateCheck.SetEnvironmentCollisionState();
             if( stateCheck.NeedCheckEndEffectorEnvCollision() ) {
                 // only check if the end-effector position is fully determined from the ik
@@ -2122,8 +2664,14 @@ protected:
                 }
                 return static_cast<IkReturnAction>(retactionall|IKRA_RejectEnvCollision);
             }
+            return IKRA_Success;
+        };
+        IkReturnAction collisionaction = _RunCollisionStages(filteroptions, fnselfcollision, fnenvcollision);
+        if( collisionaction != IKRA_Success ) {
+            return collisionaction;
         }
 
+
         if( !(filteroptions & IKFO_IgnoreCustomFilters) && _HasFilterInRange(IKSP_MinPriority, 0) ) {
             int nSameStateRepeatCount = 0;
             _nSameStateRepeatCount = 0;
@@ -2425,6 +2973,26 @@ protected:
     std::vector<size_t> _qbigrangemaxsols, _qbigrangemaxcumprod;
     IkParameterizationType _iktype;
     std::string _kinematicshash;
+    int _nBatchNumThreads; ///< number of threads SolveAllBatch splits the analytic ik computation over
+    int _nFreeSweepNumThreads; ///< if > 1, the analytic ik of the free joint samples is computed in parallel over this many threads
+    BatchWorkerPool _batchworkerpool; ///< threads of _RunParallel, kept between the queries
+
+    FilterStageStatistics _vFilterStageStatistics[FS_NumStages]; ///< measured cost and rejections of every stage, see GetFilterStatistics
+
+    struct SolutionCacheEntry
+    {
+        std::vector<int64_t> vkey; ///< ik type, filter options, collision checker and options, and quantized ik values
+        std::vector<dReal> vstate; ///< exact ik values and robot and environment state the solutions were computed in
+        std::vector<IkReturnPtr> vikreturns;
+    };
+    typedef std::list<SolutionCacheEntry> SolutionCacheList;
+    SolutionCacheList _listSolutionCache; ///< cached SolveAll results, most recently used first
+    std::map<std::vector<int64_t>, typename SolutionCacheList::iterator> _mapSolutionCache; ///< key into _listSolutionCache
+    size_t _nSolutionCacheSize; ///< maximum number of entries in _listSolutionCache, 0 disables the cache
+    dReal _fSolutionCacheQuantization; ///< step the ik values are quantized with for the cache key
+    PerfCounterPtr _pcountersolve; ///< number and duration in ns of the Solve and SolveAll calls
+    PerfCounterPtr _pcountersuccess; ///< number of Solve and SolveAll calls that returned a solution
+    PerfCounterPtr _pcountercachehit, _pcountercachemiss; ///< lookups of the SolveAll solution cache
     int _numBacktraceLinksForSelfCollisionWithNonMoving, _numBacktraceLinksForSelfCollisionWithFree; ///< when pruning self collisions, the number of links to look at. If the tip of the manip self collides with the base, then can safely quit the IK. this is used purely for optimization purposes and by default it is mostly disabled. For more complex robots with a lot of joints, can use these parameters to speed up searching for IK.
     dReal _ikthreshold; ///< workspace distance threshold sanity checking between desired workspace goal and the workspace position with the returned ik values.
     dReal _fRefineWithJacobianInverseAllowedError; ///< if > 0, then use jacobian inverse numerical method to refine the results until workspace error drops down this much. By default it is disabled (=-1)
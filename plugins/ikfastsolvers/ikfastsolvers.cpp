@@ -32,6 +32,7 @@ namespace ik_katana5d_trans { IkSolverBasePtr CreateIkSolver(EnvironmentBasePtr,
 
 IkSolverBasePtr CreateIkSolverFromName(const string& _name, const std::vector<dReal>& vfreeinc, dReal ikthreshold, EnvironmentBasePtr penv);
 ModuleBasePtr CreateIkFastModule(EnvironmentBasePtr penv, std::istream& sinput);
+IkSolverBasePtr CreateNumericalIkSolver(EnvironmentBasePtr penv, std::istream& sinput);
 void DestroyIkFastLibraries();
 
 InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string& interfacename, std::istream& sinput, EnvironmentBasePtr penv)
@@ -67,6 +68,9 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
                 }
             }
         }
+        else if( interfacename == "numericalik" ) {
+            return CreateNumericalIkSolver(penv, sinput);
+        }
         else {
             vector<dReal> vfreeinc((istream_iterator<dReal>(sinput)), istream_iterator<dReal>());
             if( interfacename == "wam7ikfast" ) {
@@ -124,6 +128,7 @@ void GetPluginAttributesValidated(PLUGININFO& info)
 {
     info.interfacenames[PT_Module].push_back("ikfast");
     info.interfacenames[PT_IkSolver].push_back("ikfast");
+    info.interfacenames[PT_IkSolver].push_back("numericalik");
     info.interfacenames[PT_IkSolver].push_back("wam7ikfast");
     info.interfacenames[PT_IkSolver].push_back("pa10ikfast");
     info.interfacenames[PT_IkSolver].push_back("pumaikfast");
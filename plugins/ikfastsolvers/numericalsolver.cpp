@@ -0,0 +1,612 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "plugindefs.h"
+
+namespace ikfastsolvers {
+
+/// \brief numerical ik solver for manipulators without a generated ikfast solver.
+///
+/// Uses damped least squares with Levenberg-Marquardt damping. All the jacobian and linear system buffers are allocated once in Init.
+class NumericalIkSolver : public IkSolverBase
+{
+public:
+    NumericalIkSolver(EnvironmentBasePtr penv, std::istream& sinput) : IkSolverBase(penv)
+    {
+        __description = ":Interface Author: agent\n\nNumerical inverse kinematics using damped least squares with Levenberg-Marquardt damping and joint limit clamping. Supports Transform6D, Translation3D and Rotation3D.\n\nThe iteration starts from q0 when it is given, otherwise from the current robot configuration. When that fails, it tries the last returned solution and then random configurations. SolveAllBatch starts every pose from the solution of the previous one, which makes it suitable for tracking workspace trajectories.";
+        _nMaxIterations = 100;
+        _fErrorThresh = 1e-6;
+        _fInitialDamping = 1e-3;
+        _nNumRestarts = 4;
+        _bWarmStart = true;
+        // optional arguments: maxiterations errorthresh
+        int nMaxIterations = 0;
+        dReal fErrorThresh = 0;
+        if( sinput >> nMaxIterations ) {
+            _nMaxIterations = nMaxIterations;
+            if( sinput >> fErrorThresh ) {
+                _fErrorThresh = fErrorThresh;
+            }
+        }
+        RegisterCommand("SetMaxIterations",boost::bind(&NumericalIkSolver::_SetMaxIterationsCommand,this,_1,_2),
+                        "sets the max number of iterations for one start configuration");
+        RegisterCommand("SetErrorThresh",boost::bind(&NumericalIkSolver::_SetErrorThreshCommand,this,_1,_2),
+                        "sets the workspace error (meters and radians) at which a solution is accepted");
+        RegisterCommand("SetDamping",boost::bind(&NumericalIkSolver::_SetDampingCommand,this,_1,_2),
+                        "sets the initial Levenberg-Marquardt damping");
+        RegisterCommand("SetNumRestarts",boost::bind(&NumericalIkSolver::_SetNumRestartsCommand,this,_1,_2),
+                        "sets the number of random start configurations to try after the first one fails. SolveAll returns the distinct solutions of all of them");
+        RegisterCommand("SetWarmStart",boost::bind(&NumericalIkSolver::_SetWarmStartCommand,this,_1,_2),
+                        "if 1, SolveAllBatch starts every pose from the previous solution, and Solve tries the last solution right after its first start configuration");
+        RegisterCommand("GetFreeIndices",boost::bind(&NumericalIkSolver::_GetFreeIndicesCommand,this,_1,_2),
+                        "returns nothing, the numerical solver has no free parameters");
+    }
+    virtual ~NumericalIkSolver() {
+    }
+
+    inline boost::shared_ptr<NumericalIkSolver> shared_solver() {
+        return boost::static_pointer_cast<NumericalIkSolver>(shared_from_this());
+    }
+
+    virtual bool Init(RobotBase::ManipulatorConstPtr pconstmanip)
+    {
+        RobotBase::ManipulatorPtr pmanip = boost::const_pointer_cast<RobotBase::Manipulator>(pconstmanip);
+        _pmanip = pmanip;
+        RobotBasePtr probot = pmanip->GetRobot();
+        const int armdof = pmanip->GetArmDOF();
+        probot->GetDOFLimits(_vlower, _vupper, pmanip->GetArmIndices());
+        _vcircular.resize(armdof);
+        for(int i = 0; i < armdof; ++i) {
+            int dofindex = pmanip->GetArmIndices().at(i);
+            KinBody::JointPtr pjoint = probot->GetJointFromDOFIndex(dofindex);
+            _vcircular[i] = pjoint->IsCircular(dofindex-pjoint->GetDOFIndex());
+        }
+        _vjacobiantrans.reserve(3*armdof);
+        _vjacobianrot.reserve(3*armdof);
+        _J.resize(6*armdof);
+        _A.resize(36);
+        _verror.resize(6);
+        _vnewerror.resize(6);
+        _vy.resize(6);
+        _vdq.resize(armdof);
+        _vlocked.resize(armdof);
+        _vq.resize(armdof);
+        _vqnew.resize(armdof);
+        _vlastsolution.resize(0);
+        _kinematicshash = pmanip->GetKinematicsStructureHash();
+        return true;
+    }
+
+    virtual RobotBase::ManipulatorPtr GetManipulator() const {
+        return _pmanip.lock();
+    }
+
+    virtual int GetNumFreeParameters() const {
+        return 0;
+    }
+
+    virtual bool GetFreeParameters(std::vector<dReal>& vFreeParameters) const {
+        vFreeParameters.resize(0);
+        return true;
+    }
+
+    virtual bool GetFreeIndices(std::vector<int>& vFreeIndices) const {
+        vFreeIndices.resize(0);
+        return true;
+    }
+
+    virtual bool Supports(IkParameterizationType iktype) const {
+        return iktype == IKP_Transform6D || iktype == IKP_Translation3D || iktype == IKP_Rotation3D;
+    }
+
+    virtual const std::string& GetKinematicsStructureHash() const {
+        return _kinematicshash;
+    }
+
+    virtual void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    {
+        IkSolverBase::Clone(preference, cloningoptions);
+        boost::shared_ptr<NumericalIkSolver const> r = boost::dynamic_pointer_cast<NumericalIkSolver const>(preference);
+        _nMaxIterations = r->_nMaxIterations;
+        _fErrorThresh = r->_fErrorThresh;
+        _fInitialDamping = r->_fInitialDamping;
+        _nNumRestarts = r->_nNumRestarts;
+        _bWarmStart = r->_bWarmStart;
+        RobotBase::ManipulatorPtr rmanip = r->_pmanip.lock();
+        if( !!rmanip ) {
+            RobotBasePtr probot = GetEnv()->GetRobot(rmanip->GetRobot()->GetName());
+            if( !!probot ) {
+                RobotBase::ManipulatorPtr pmanip = probot->GetManipulator(rmanip->GetName());
+                if( !!pmanip ) {
+                    Init(pmanip);
+                }
+            }
+        }
+    }
+
+    virtual IkReturnAction CallFilters(const IkParameterization& param, IkReturnPtr ikreturn=IkReturnPtr(), int32_t minpriority=IKSP_MinPriority, int32_t maxpriority=IKSP_MaxPriority)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        std::vector<dReal> vsolution;
+        pmanip->GetRobot()->GetDOFValues(vsolution, pmanip->GetArmIndices());
+        return _CallFilters(vsolution, pmanip, param, ikreturn, minpriority, maxpriority);
+    }
+
+    virtual bool Solve(const IkParameterization& param, const std::vector<dReal>& q0, int filteroptions, boost::shared_ptr< std::vector<dReal> > result)
+    {
+        IkReturnPtr ikreturn(new IkReturn(IKRA_Success));
+        if( !Solve(param, q0, filteroptions, ikreturn) ) {
+            return false;
+        }
+        if( !!result ) {
+            *result = ikreturn->_vsolution;
+        }
+        return true;
+    }
+
+    virtual bool Solve(const IkParameterization& param, const std::vector<dReal>& q0, int filteroptions, IkReturnPtr ikreturn)
+    {
+        if( !ikreturn ) {
+            ikreturn.reset(new IkReturn(IKRA_Success));
+        }
+        ikreturn->Clear();
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pmanip->GetArmIndices());
+        std::vector<dReal> vseed;
+        _GetSeed(q0, vseed);
+        std::vector<IkReturnPtr> vikreturnsdummy;
+        IkReturnAction retaction = _SolveFromSeeds(param, vseed, filteroptions, ikreturn, vikreturnsdummy);
+        ikreturn->_action = retaction;
+        return retaction == IKRA_Success;
+    }
+
+    virtual bool SolveAll(const IkParameterization& param, int filteroptions, std::vector< std::vector<dReal> >& qSolutions)
+    {
+        std::vector<IkReturnPtr> vikreturns;
+        SolveAll(param, filteroptions, vikreturns);
+        qSolutions.resize(vikreturns.size());
+        for(size_t i = 0; i < vikreturns.size(); ++i) {
+            qSolutions[i] = vikreturns[i]->_vsolution;
+        }
+        return qSolutions.size()>0;
+    }
+
+    virtual bool SolveAll(const IkParameterization& param, int filteroptions, std::vector<IkReturnPtr>& vikreturns)
+    {
+        vikreturns.resize(0);
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pmanip->GetArmIndices());
+        std::vector<dReal> vseed;
+        _GetSeed(std::vector<dReal>(), vseed);
+        _SolveFromSeeds(param, vseed, filteroptions, IkReturnPtr(), vikreturns);
+        return vikreturns.size()>0;
+    }
+
+    virtual bool Solve(const IkParameterization& param, const std::vector<dReal>& q0, const std::vector<dReal>& vFreeParameters, int filteroptions, boost::shared_ptr< std::vector<dReal> > result)
+    {
+        return Solve(param, q0, filteroptions, result);
+    }
+
+    virtual bool Solve(const IkParameterization& param, const std::vector<dReal>& q0, const std::vector<dReal>& vFreeParameters, int filteroptions, IkReturnPtr ikreturn)
+    {
+        return Solve(param, q0, filteroptions, ikreturn);
+    }
+
+    virtual bool SolveAll(const IkParameterization& param, const std::vector<dReal>& vFreeParameters, int filteroptions, std::vector< std::vector<dReal> >& qSolutions)
+    {
+        return SolveAll(param, filteroptions, qSolutions);
+    }
+
+    virtual bool SolveAll(const IkParameterization& param, const std::vector<dReal>& vFreeParameters, int filteroptions, std::vector<IkReturnPtr>& vikreturns)
+    {
+        return SolveAll(param, filteroptions, vikreturns);
+    }
+
+    /// \brief solves the poses in order, starting each one from the solution of the previous pose when warm starting is enabled
+    virtual bool SolveAllBatch(const std::vector<IkParameterization>& params, int filteroptions, std::vector< std::vector<IkReturnPtr> >& ikreturns)
+    {
+        ikreturns.resize(params.size());
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pmanip->GetArmIndices());
+        std::vector<dReal> vseed;
+        _GetSeed(std::vector<dReal>(), vseed);
+        std::vector<IkReturnPtr> vikreturnsdummy;
+        bool bsuccess = false;
+        for(size_t i = 0; i < params.size(); ++i) {
+            ikreturns[i].resize(0);
+            IkReturnPtr ikreturn(new IkReturn(IKRA_Success));
+            if( _SolveFromSeeds(params[i], vseed, filteroptions, ikreturn, vikreturnsdummy) == IKRA_Success ) {
+                ikreturns[i].push_back(ikreturn);
+                bsuccess = true;
+                if( _bWarmStart ) {
+                    vseed = ikreturn->_vsolution;
+                }
+            }
+        }
+        return bsuccess;
+    }
+
+protected:
+    /// \brief the first start configuration, robot active dofs have to be set to the arm
+    void _GetSeed(const std::vector<dReal>& q0, std::vector<dReal>& vseed)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        if( q0.size() == _vq.size() ) {
+            vseed = q0;
+            return;
+        }
+        pmanip->GetRobot()->GetActiveDOFValues(vseed);
+    }
+
+    /// \brief iterates from vseed, then from the last solution when warm starting, and then from _nNumRestarts random configurations.
+    ///
+    /// If ikreturn is set, stops at the first valid solution and writes it there. Otherwise appends all distinct valid solutions to vikreturns.
+    IkReturnAction _SolveFromSeeds(const IkParameterization& param, const std::vector<dReal>& vseed, int filteroptions, IkReturnPtr ikreturn, std::vector<IkReturnPtr>& vikreturns)
+    {
+        OPENRAVE_ASSERT_FORMAT(Supports(param.GetType()), "numerical iksolver does not support ik type %s", param.GetName(), ORE_InvalidArguments);
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        const IkParameterization paramworld = pmanip->GetBase()->GetTransform() * param;
+        IkReturnAction retaction = IKRA_RejectKinematics;
+        std::vector<dReal> vstart = vseed;
+        // the last solution is usually close when tracking, so it is tried before the random configurations
+        const int numwarmstarts = _bWarmStart && _vlastsolution.size() == vseed.size() && _vlastsolution != vseed ? 1 : 0;
+        for(int istart = 0; istart <= numwarmstarts+_nNumRestarts; ++istart) {
+            if( istart > 0 && istart <= numwarmstarts ) {
+                vstart = _vlastsolution;
+            }
+            else if( istart > 0 ) {
+                for(size_t i = 0; i < vstart.size(); ++i) {
+                    vstart[i] = _vlower[i] + RaveRandomFloat()*(_vupper[i]-_vlower[i]);
+                }
+            }
+            if( !_Iterate(paramworld, vstart, filteroptions) ) {
+                continue;
+            }
+            // only keep distinct solutions
+            bool bduplicate = false;
+            FOREACHC(itikreturn, vikreturns) {
+                dReal dist = 0;
+                for(size_t i = 0; i < _vq.size(); ++i) {
+                    dist += RaveFabs(_vq[i] - (*itikreturn)->_vsolution[i]);
+                }
+                if( dist < 10*_fErrorThresh ) {
+                    bduplicate = true;
+                    break;
+                }
+            }
+            if( bduplicate ) {
+                continue;
+            }
+
+            IkReturnPtr localret(new IkReturn(IKRA_Success));
+            localret->_vsolution = _vq;
+            retaction = _ValidateSolution(param, filteroptions, localret);
+            if( retaction != IKRA_Success ) {
+                if( (retaction & IKRA_Quit) == IKRA_Quit ) {
+                    return retaction;
+                }
+                continue;
+            }
+            _vlastsolution = localret->_vsolution;
+            _CallFinishCallbacks(localret, pmanip, param);
+            if( !!ikreturn ) {
+                ikreturn->Append(*localret);
+                ikreturn->_vsolution = localret->_vsolution;
+                return IKRA_Success;
+            }
+            vikreturns.push_back(localret);
+        }
+        if( vikreturns.size() > 0 ) {
+            return IKRA_Success;
+        }
+        return retaction;
+    }
+
+    /// \brief checks the joint limits, collisions and custom filters of the solution set on the robot
+    IkReturnAction _ValidateSolution(const IkParameterization& param, int filteroptions, IkReturnPtr ikreturn)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        if( !(filteroptions & IKFO_IgnoreJointLimits) ) {
+            for(size_t i = 0; i < _vq.size(); ++i) {
+                if( !_vcircular[i] && (_vq[i] < _vlower[i]-g_fEpsilonJointLimit || _vq[i] > _vupper[i]+g_fEpsilonJointLimit) ) {
+                    return IKRA_RejectJointLimits;
+                }
+            }
+        }
+        probot->SetActiveDOFValues(ikreturn->_vsolution, KinBody::CLA_Nothing);
+        if( !(filteroptions & IKFO_IgnoreCustomFilters) ) {
+            IkReturnAction retaction = _CallFilters(ikreturn->_vsolution, pmanip, param, ikreturn);
+            if( retaction != IKRA_Success ) {
+                return retaction;
+            }
+            // filters can change the solution
+            probot->SetActiveDOFValues(ikreturn->_vsolution, KinBody::CLA_Nothing);
+        }
+        if( !(filteroptions & IKFO_IgnoreSelfCollisions) && probot->CheckSelfCollision() ) {
+            return IKRA_RejectSelfCollision;
+        }
+        if( (filteroptions & IKFO_CheckEnvCollisions) && GetEnv()->CheckCollision(KinBodyConstPtr(probot)) ) {
+            return IKRA_RejectEnvCollision;
+        }
+        return IKRA_Success;
+    }
+
+    /// \brief computes the workspace error of the current robot configuration, returns its squared norm
+    dReal _ComputeError(const IkParameterization& paramworld, std::vector<dReal>& verror)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        const Transform tmanip = pmanip->GetTransform();
+        int index = 0;
+        switch(paramworld.GetType()) {
+        case IKP_Transform6D: {
+            const Transform tgoal = paramworld.GetTransform6D();
+            Vector vtrans = tgoal.trans - tmanip.trans;
+            Vector vrot = axisAngleFromQuat(quatMultiply(tgoal.rot, quatInverse(tmanip.rot)));
+            verror[index++] = vtrans.x; verror[index++] = vtrans.y; verror[index++] = vtrans.z;
+            verror[index++] = vrot.x; verror[index++] = vrot.y; verror[index++] = vrot.z;
+            break;
+        }
+        case IKP_Translation3D: {
+            Vector vtrans = paramworld.GetTranslation3D() - tmanip.trans;
+            verror[index++] = vtrans.x; verror[index++] = vtrans.y; verror[index++] = vtrans.z;
+            break;
+        }
+        case IKP_Rotation3D: {
+            Vector vrot = axisAngleFromQuat(quatMultiply(paramworld.GetRotation3D(), quatInverse(tmanip.rot)));
+            verror[index++] = vrot.x; verror[index++] = vrot.y; verror[index++] = vrot.z;
+            break;
+        }
+        default:
+            throw OPENRAVE_EXCEPTION_FORMAT("numerical iksolver does not support ik type %s", paramworld.GetName(), ORE_InvalidArguments);
+        }
+        dReal ferror2 = 0;
+        for(int i = 0; i < index; ++i) {
+            ferror2 += verror[i]*verror[i];
+        }
+        return ferror2;
+    }
+
+    /// \brief fills the rows of _J for the current robot configuration
+    int _ComputeJacobian(IkParameterizationType iktype)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        const int armdof = (int)_vq.size();
+        int numrows = 0;
+        if( iktype == IKP_Transform6D || iktype == IKP_Translation3D ) {
+            pmanip->CalculateJacobian(_vjacobiantrans);
+            std::copy(_vjacobiantrans.begin(), _vjacobiantrans.end(), _J.begin());
+            numrows += 3;
+        }
+        if( iktype == IKP_Transform6D || iktype == IKP_Rotation3D ) {
+            pmanip->CalculateAngularVelocityJacobian(_vjacobianrot);
+            std::copy(_vjacobianrot.begin(), _vjacobianrot.end(), _J.begin()+numrows*armdof);
+            numrows += 3;
+        }
+        return numrows;
+    }
+
+    /// \brief solves (J*L*J^T + lambda*I) y = e and sets _vdq = L*J^T*y, where L masks the locked joints
+    bool _SolveDampedLeastSquares(int numrows, dReal lambda, const std::vector<dReal>& verror)
+    {
+        const int armdof = (int)_vq.size();
+        for(int i = 0; i < numrows; ++i) {
+            for(int j = 0; j <= i; ++j) {
+                dReal f = 0;
+                for(int k = 0; k < armdof; ++k) {
+                    if( !_vlocked[k] ) {
+                        f += _J[i*armdof+k]*_J[j*armdof+k];
+                    }
+                }
+                _A[i*6+j] = f;
+            }
+            _A[i*6+i] += lambda;
+        }
+        // in-place cholesky of the lower triangle
+        for(int j = 0; j < numrows; ++j) {
+            dReal d = _A[j*6+j];
+            for(int k = 0; k < j; ++k) {
+                d -= _A[j*6+k]*_A[j*6+k];
+            }
+            if( d <= 0 ) {
+                return false;
+            }
+            d = RaveSqrt(d);
+            _A[j*6+j] = d;
+            for(int i = j+1; i < numrows; ++i) {
+                dReal f = _A[i*6+j];
+                for(int k = 0; k < j; ++k) {
+                    f -= _A[i*6+k]*_A[j*6+k];
+                }
+                _A[i*6+j] = f/d;
+            }
+        }
+        for(int i = 0; i < numrows; ++i) {
+            dReal f = verror[i];
+            for(int k = 0; k < i; ++k) {
+                f -= _A[i*6+k]*_vy[k];
+            }
+            _vy[i] = f/_A[i*6+i];
+        }
+        for(int i = numrows-1; i >= 0; --i) {
+            dReal f = _vy[i];
+            for(int k = i+1; k < numrows; ++k) {
+                f -= _A[k*6+i]*_vy[k];
+            }
+            _vy[i] = f/_A[i*6+i];
+        }
+        for(int k = 0; k < armdof; ++k) {
+            dReal f = 0;
+            if( !_vlocked[k] ) {
+                for(int i = 0; i < numrows; ++i) {
+                    f += _J[i*armdof+k]*_vy[i];
+                }
+            }
+            _vdq[k] = f;
+        }
+        return true;
+    }
+
+    /// \brief Levenberg-Marquardt iteration starting at vstart. On success _vq holds the solution.
+    bool _Iterate(const IkParameterization& paramworld, const std::vector<dReal>& vstart, int filteroptions)
+    {
+        RobotBase::ManipulatorPtr pmanip(_pmanip);
+        RobotBasePtr probot = pmanip->GetRobot();
+        const bool bCheckLimits = !(filteroptions & IKFO_IgnoreJointLimits);
+        const dReal ferrorthresh2 = _fErrorThresh*_fErrorThresh;
+        const int armdof = (int)_vq.size();
+        _vq = vstart;
+        if( bCheckLimits ) {
+            _ClampToLimits(_vq);
+        }
+        probot->SetActiveDOFValues(_vq, KinBody::CLA_Nothing);
+        dReal ferror2 = _ComputeError(paramworld, _verror);
+        dReal lambda = _fInitialDamping;
+        bool bJacobianValid = false;
+        int numrows = 0;
+        for(int iter = 0; iter < _nMaxIterations; ++iter) {
+            if( ferror2 <= ferrorthresh2 ) {
+                return true;
+            }
+            if( !bJacobianValid ) {
+                numrows = _ComputeJacobian(paramworld.GetType());
+                bJacobianValid = true;
+            }
+            std::fill(_vlocked.begin(), _vlocked.end(), 0);
+            if( !_SolveDampedLeastSquares(numrows, lambda, _verror) ) {
+                return false;
+            }
+            if( bCheckLimits ) {
+                // joints at their limits that are pushed further out do not move, resolve for the rest
+                bool bresolve = false;
+                for(int i = 0; i < armdof; ++i) {
+                    if( !_vcircular[i] && ((_vq[i] <= _vlower[i] && _vdq[i] < 0) || (_vq[i] >= _vupper[i] && _vdq[i] > 0)) ) {
+                        _vlocked[i] = 1;
+                        bresolve = true;
+                    }
+                }
+                if( bresolve && !_SolveDampedLeastSquares(numrows, lambda, _verror) ) {
+                    return false;
+                }
+            }
+            for(int i = 0; i < armdof; ++i) {
+                _vqnew[i] = _vq[i] + _vdq[i];
+            }
+            if( bCheckLimits ) {
+                _ClampToLimits(_vqnew);
+            }
+            probot->SetActiveDOFValues(_vqnew, KinBody::CLA_Nothing);
+            dReal fnewerror2 = _ComputeError(paramworld, _vnewerror);
+            if( fnewerror2 < ferror2 ) {
+                _vq.swap(_vqnew);
+                _verror.swap(_vnewerror);
+                ferror2 = fnewerror2;
+                lambda = max(lambda*0.5, dReal(1e-9));
+                bJacobianValid = false;
+            }
+            else {
+                // step rejected, the jacobian at _vq is still valid so only the damping changes
+                lambda *= 4;
+                if( lambda > 1e6 ) {
+                    break;
+                }
+                probot->SetActiveDOFValues(_vq, KinBody::CLA_Nothing);
+            }
+        }
+        return ferror2 <= ferrorthresh2;
+    }
+
+    void _ClampToLimits(std::vector<dReal>& q) const
+    {
+        for(size_t i = 0; i < q.size(); ++i) {
+            if( _vcircular[i] ) {
+                q[i] = utils::NormalizeCircularAngle(q[i], dReal(-PI), dReal(PI));
+            }
+            else if( q[i] < _vlower[i] ) {
+                q[i] = _vlower[i];
+            }
+            else if( q[i] > _vupper[i] ) {
+                q[i] = _vupper[i];
+            }
+        }
+    }
+
+    bool _SetMaxIterationsCommand(ostream& sout, istream& sinput)
+    {
+        sinput >> _nMaxIterations;
+        return !!sinput;
+    }
+
+    bool _SetErrorThreshCommand(ostream& sout, istream& sinput)
+    {
+        sinput >> _fErrorThresh;
+        return !!sinput;
+    }
+
+    bool _SetDampingCommand(ostream& sout, istream& sinput)
+    {
+        sinput >> _fInitialDamping;
+        return !!sinput;
+    }
+
+    bool _SetNumRestartsCommand(ostream& sout, istream& sinput)
+    {
+        sinput >> _nNumRestarts;
+        return !!sinput;
+    }
+
+    bool _SetWarmStartCommand(ostream& sout, istream& sinput)
+    {
+        sinput >> _bWarmStart;
+        return !!sinput;
+    }
+
+    bool _GetFreeIndicesCommand(ostream& sout, istream& sinput)
+    {
+        return true;
+    }
+
+    RobotBase::ManipulatorWeakPtr _pmanip;
+    std::string _kinematicshash;
+    int _nMaxIterations; ///< max iterations for one start configuration
+    dReal _fErrorThresh; ///< workspace error at which a solution is accepted
+    dReal _fInitialDamping; ///< starting Levenberg-Marquardt damping
+    int _nNumRestarts; ///< random start configurations to try after the first one
+    bool _bWarmStart; ///< if true, start from the previous solution when no q0 is given
+    std::vector<dReal> _vlower, _vupper; ///< arm joint limits
+    std::vector<uint8_t> _vcircular; ///< 1 if the arm joint is circular
+
+    // preallocated in Init
+    std::vector<dReal> _vjacobiantrans, _vjacobianrot; ///< 3 x armdof jacobians returned by the manipulator
+    std::vector<dReal> _J; ///< up to 6 x armdof stacked jacobian, row major
+    std::vector<dReal> _A; ///< 6x6 damped J*J^T and its cholesky factor
+    std::vector<dReal> _verror, _vnewerror, _vy; ///< workspace errors of the current and the trial configurations
+    std::vector<dReal> _vdq, _vq, _vqnew;
+    std::vector<uint8_t> _vlocked; ///< 1 if the joint is held at its limit in the current step
+    std::vector<dReal> _vlastsolution; ///< last returned solution, used for warm starting
+};
+
+} // end namespace ikfastsolvers
+
+IkSolverBasePtr CreateNumericalIkSolver(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return IkSolverBasePtr(new ikfastsolvers::NumericalIkSolver(penv, sinput));
+}
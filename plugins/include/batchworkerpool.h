@@ -0,0 +1,146 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_BATCH_WORKER_POOL_H
+#define OPENRAVE_BATCH_WORKER_POOL_H
+
+#include <openrave/openrave.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <string>
+#include <vector>
+
+/// \brief threads that stay alive between the batches of an interface, so that batched queries do not start threads on every call
+///
+/// Run hands the tasks of one batch to the threads and to the calling thread, and returns when all of them are done.
+/// Only one batch runs at a time, the tasks cannot call Run of the same pool.
+class BatchWorkerPool
+{
+public:
+    BatchWorkerPool() : _numtasks(0), _nNextTask(0), _nTasksLeft(0), _bShutdown(false) {
+    }
+    ~BatchWorkerPool() {
+        _StopThreads();
+    }
+
+    /// \brief calls fn(0), ..., fn(numtasks-1) with numthreads threads counting the calling thread
+    ///
+    /// Threads are started or stopped when numthreads is different from the previous batch. If a task throws, the other tasks
+    /// still run and the first error is thrown after all of them are done.
+    void Run(size_t numtasks, int numthreads, const boost::function<void(size_t)>& fn)
+    {
+        if( numtasks == 0 ) {
+            return;
+        }
+        size_t numpoolthreads = numthreads > 1 ? (size_t)numthreads-1 : 0;
+        if( numpoolthreads == 0 || numtasks == 1 ) {
+            for(size_t itask = 0; itask < numtasks; ++itask) {
+                fn(itask);
+            }
+            return;
+        }
+        if( _vthreads.size() != numpoolthreads ) {
+            _StopThreads();
+            for(size_t ithread = 0; ithread < numpoolthreads; ++ithread) {
+                _vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&BatchWorkerPool::_WorkerThread, this))));
+            }
+        }
+
+        boost::mutex::scoped_lock lock(_mutex);
+        _fn = fn;
+        _numtasks = numtasks;
+        _nNextTask = 0;
+        _nTasksLeft = numtasks;
+        _error.clear();
+        _condTasks.notify_all();
+        _RunTasks(lock);
+        while( _nTasksLeft > 0 ) {
+            _condDone.wait(lock);
+        }
+        _numtasks = 0;
+        _fn.clear();
+        if( _error.size() > 0 ) {
+            std::string error;
+            error.swap(_error);
+            throw OPENRAVE_EXCEPTION_FORMAT("batch task failed: %s", error, OpenRAVE::ORE_Failed);
+        }
+    }
+
+private:
+    /// \brief runs tasks of the current batch until there is none left to start, _mutex is locked
+    void _RunTasks(boost::mutex::scoped_lock& lock)
+    {
+        while( _nNextTask < _numtasks ) {
+            size_t itask = _nNextTask++;
+            lock.unlock();
+            std::string error;
+            try {
+                _fn(itask);
+            }
+            catch(const std::exception& ex) {
+                error = ex.what();
+            }
+            lock.lock();
+            if( error.size() > 0 && _error.size() == 0 ) {
+                _error = error;
+            }
+            if( --_nTasksLeft == 0 ) {
+                _condDone.notify_all();
+            }
+        }
+    }
+
+    void _WorkerThread()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        while( !_bShutdown ) {
+            if( _nNextTask >= _numtasks ) {
+                _condTasks.wait(lock);
+                continue;
+            }
+            _RunTasks(lock);
+        }
+    }
+
+    void _StopThreads()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+            _condTasks.notify_all();
+        }
+        for(size_t ithread = 0; ithread < _vthreads.size(); ++ithread) {
+            _vthreads[ithread]->join();
+        }
+        _vthreads.clear();
+        _bShutdown = false;
+    }
+
+    std::vector<boost::shared_ptr<boost::thread> > _vthreads;
+    boost::function<void(size_t)> _fn; ///< the task function of the current batch
+    size_t _numtasks, _nNextTask, _nTasksLeft;
+    std::string _error; ///< message of the first task of the current batch that threw
+    bool _bShutdown;
+    boost::mutex _mutex;
+    boost::condition_variable _condTasks; ///< notified when a batch starts or the threads should stop
+    boost::condition_variable _condDone; ///< notified when all tasks of the batch are done
+};
+
+#endif
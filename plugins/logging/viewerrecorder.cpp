@@ -99,6 +99,7 @@ class ViewerRecorder : public ModuleBase
     boost::mutex _mutex; // for video data passing
     boost::mutex _mutexlibrary; // for video encoding library resources
     boost::condition _condnewframe;
+    boost::condition _condframeremoved; // notified when frames are taken out of _listAddFrames
     bool _bContinueThread, _bStopRecord;
     boost::shared_ptr<boost::thread> _threadrecord;
 
@@ -108,18 +109,20 @@ class ViewerRecorder : public ModuleBase
     uint64_t _frameindex;
     uint64_t _starttime, _frametime;
     std::string _filename;
+    std::string _encodername; // if not empty, the name of the libavcodec encoder to use instead of the default encoder of the codec, for example a hardware encoder
     UserDataPtr _callback;
     int _nUseSimulationTime; // 0 to record as is, 1 to record with respect to simulation, 2 to control simulation to viewer updates
     dReal _fSimulationTimeMultiplier; // how many times to make the simulation time faster
-    list<boost::shared_ptr<VideoFrame> > _listAddFrames, _listFinishedFrames;
+    list<boost::shared_ptr<VideoFrame> > _listAddFrames, _listFinishedFrames; // _listFinishedFrames is the pool of frames whose memory can be reused, see _RecycleFrame
     boost::shared_ptr<VideoFrame> _frameLastAdded;
+    size_t _nMaxQueuedFrames; // the maximum size of _listAddFrames, when full the viewer waits with controlsimtime, otherwise the oldest frame is dropped
 
 public:
     ViewerRecorder(EnvironmentBasePtr penv, std::istream& sinput) : ModuleBase(penv)
     {
         __description = ":Interface Author: Rosen Diankov\n\nRecords the images produced from a viewer into video file. The recordings can be synchronized to real-time or simulation time, by default simulation time is used. Each instance can record only one file at a time. To record multiple files simultaneously, create multiple VideoRecorder instances";
         RegisterCommand("Start",boost::bind(&ViewerRecorder::_StartCommand,this,_1,_2),
-                        "Starts recording a file, this will stop all previous recordings and overwrite any previous files stored in this location. Format::\n\n  Start [width] [height] [framerate] codec [codec] timing [simtime/realtime/controlsimtime[=timestepmult]] viewer [name]\\n filename [filename]\\n\n\nBecause the viewer and filenames can have spaces, the names are ready until a newline is encountered");
+                        "Starts recording a file, this will stop all previous recordings and overwrite any previous files stored in this location. Format::\n\n  Start [width] [height] [framerate] codec [codec] encoder [name] maxqueuedframes [num] timing [simtime/realtime/controlsimtime[=timestepmult]] viewer [name]\\n filename [filename]\\n\n\nBecause the viewer and filenames can have spaces, the names are ready until a newline is encountered. encoder selects a libavcodec encoder by name (for example a hardware encoder) instead of the default encoder of the codec. maxqueuedframes bounds the number of frames waiting to be encoded (default 64).");
         RegisterCommand("Stop",boost::bind(&ViewerRecorder::_StopCommand,this,_1,_2),
                         "Stops recording and saves the file. Format::\n\n  Stop\n\n");
         RegisterCommand("GetCodecs",boost::bind(&ViewerRecorder::_GetCodecsCommand,this,_1,_2),
@@ -134,6 +137,7 @@ public:
         _bContinueThread = true;
         _bStopRecord = true;
         _frameindex = 0;
+        _nMaxQueuedFrames = 64;
 #ifdef _WIN32
         _pfile = NULL;
         _ps = NULL;
@@ -151,6 +155,7 @@ public:
         _outbuf = NULL;
         _picture_size = 0;
         _outbuf_size = 0;
+        _swscontext = NULL;
 #endif
         _threadrecord.reset(new boost::thread(boost::bind(&ViewerRecorder::_RecordThread,this)));
     }
@@ -162,6 +167,7 @@ public:
         {
             boost::mutex::scoped_lock lock(_mutex);
             _condnewframe.notify_all();
+            _condframeremoved.notify_all();
         }
         _threadrecord->join();
     }
@@ -191,6 +197,13 @@ protected:
                 if( cmd == "codec" ) {
                     sinput >> codecid;
                 }
+                else if( cmd == "encoder" ) {
+                    sinput >> _encodername;
+                }
+                else if( cmd == "maxqueuedframes" ) {
+                    sinput >> _nMaxQueuedFrames;
+                    _nMaxQueuedFrames = max(_nMaxQueuedFrames, (size_t)2);
+                }
                 else if( cmd == "filename" ) {
                     if( !getline(sinput, _filename) ) {
                         return false;
@@ -301,6 +314,22 @@ protected:
             }
         }
         if( !frame ) {
+            if( _nUseSimulationTime == 2 ) {
+                // the simulation waits for the viewer, so wait for the encoder instead of losing frames
+                while(_listAddFrames.size() >= _nMaxQueuedFrames && _bContinueThread && !_bStopRecord && !!_callback) {
+                    _condframeremoved.wait(lock);
+                }
+                if( !_callback ) {
+                    return;
+                }
+            }
+            else if( _listAddFrames.size() >= _nMaxQueuedFrames ) {
+                // the encoder is lagging, drop the oldest frame so memory stays bounded
+                RAVELOG_VERBOSE("encoder is lagging, dropping frame\n");
+                boost::shared_ptr<VideoFrame> droppedframe = _listAddFrames.front();
+                _listAddFrames.pop_front();
+                _RecycleFrame(droppedframe);
+            }
             if( _listFinishedFrames.size() > 0 ) {
                 frame = _listFinishedFrames.back();
                 _listFinishedFrames.pop_back();
@@ -314,6 +343,8 @@ protected:
         frame->_pixeldepth = pixeldepth;
         //RAVELOG_VERBOSE("image frame is %d x %d\n",width,height);
         frame->_timestamp = timestamp;
+        frame->_bProcessed = false;
+        // memory is only valid during the callback, so this is the only copy of the image until it is encoded. resize does not reallocate pooled frames of the same size
         frame->_vimagememory.resize(width*height*pixeldepth);
         std::copy(memory,memory+width*height*pixeldepth,frame->_vimagememory.begin());
         _listAddFrames.push_back(frame);
@@ -403,13 +434,19 @@ protected:
                     }
                     frame = *itbest;
                     size_t prevsize = _listAddFrames.size();
-                    _listAddFrames.erase(_listAddFrames.begin(),itbest);
+                    // the skipped frames go back to the pool
+                    while(_listAddFrames.begin() != itbest) {
+                        boost::shared_ptr<VideoFrame> skippedframe = _listAddFrames.front();
+                        _listAddFrames.pop_front();
+                        _RecycleFrame(skippedframe);
+                    }
                     if( frame->_timestamp-_starttime <= _frametime ) {
                         // the frame is before the next mark, so erase it
                         _listAddFrames.erase(itbest);
                     }
                     RAVELOG_VERBOSE(str(boost::format("frame size: %d -> %d\n")%prevsize%_listAddFrames.size()));
                     numstores = 1;
+                    _condframeremoved.notify_all();
                 }
             }
 
@@ -423,7 +460,12 @@ protected:
                 for(uint64_t i = 0; i < numstores; ++i) {
                     _AddFrame(&frame->_vimagememory.at(0));
                 }
+                boost::mutex::scoped_lock lock(_mutex);
+                boost::shared_ptr<VideoFrame> prevframe = _frameLastAdded;
                 _frameLastAdded = frame;
+                if( !!prevframe && prevframe != frame ) {
+                    _RecycleFrame(prevframe);
+                }
             }
             catch(const std::exception& ex) {
                 RAVELOG_WARN("%s\n",ex.what());
@@ -431,6 +473,18 @@ protected:
         }
     }
 
+    /// \brief puts the frame back into the pool if nothing else uses it, has to be called with _mutex locked
+    ///
+    /// \param frame a copy of the pointer that was just removed from its container
+    void _RecycleFrame(boost::shared_ptr<VideoFrame>& frame)
+    {
+        // a frame can still be in _listAddFrames or be _frameLastAdded. Nothing can get a new reference to the frame once it is unique, so it is safe to reuse its memory
+        if( frame.unique() && _listFinishedFrames.size() < _nMaxQueuedFrames ) {
+            _listFinishedFrames.push_back(frame);
+        }
+        frame.reset();
+    }
+
     void _AddWatermarkToImage(uint8_t* memory, int width, int height, int pixeldepth)
     {
         if( _vwatermarkimage.size() == 0 ) {
@@ -467,6 +521,8 @@ protected:
             _listFinishedFrames.clear();
             _frameLastAdded.reset();
             _filename = "";
+            _encodername = "";
+            _condframeremoved.notify_all();
         }
         {
             RAVELOG_DEBUG("ViewerRecorder _ResetLibrary\n");
@@ -646,9 +702,32 @@ protected:
     int _picture_size;
     int _outbuf_size;
     bool _bWroteURL, _bWroteHeader;
+#ifdef HAVE_NEW_FFMPEG
+    struct SwsContext *_swscontext; // reused for every frame
+#else
+    void* _swscontext;
+#endif
 
     void _ResetLibrary()
     {
+#if LIBAVFORMAT_VERSION_INT >= (54<<16)
+        if( !!_stream && !!_output && _bWroteHeader ) {
+            // the encoder threads and b-frames delay packets, so get the frames that are still in the encoder
+            try {
+                while(_EncodeFrame(NULL)) {
+                }
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN("failed to flush encoder: %s\n", ex.what());
+            }
+        }
+#endif
+#ifdef HAVE_NEW_FFMPEG
+        if( !!_swscontext ) {
+            sws_freeContext(_swscontext);
+        }
+#endif
+        _swscontext = NULL;
         free(_picture_buf); _picture_buf = NULL;
         free(_picture); _picture = NULL;
         free(_yuv420p); _yuv420p = NULL;
@@ -713,16 +792,22 @@ protected:
         OPENRAVE_ASSERT_OP_FORMAT0(bits,==,24,"START_AVI only supports 24bits",ORE_InvalidArguments);
         OPENRAVE_ASSERT_OP_FORMAT0(filename.size(),>,0,"filename needs to be valid",ORE_InvalidArguments);
         AVCodecContext *codec_ctx;
-        AVCodec *codec;
+        AVCodec *codec = NULL;
+        if( _encodername.size() > 0 ) {
+            codec = avcodec_find_encoder_by_name(_encodername.c_str());
+            if( !codec ) {
+                RAVELOG_WARN_FORMAT("could not find encoder %s, using the default encoder", _encodername);
+            }
+        }
 
         bool bFixH264 = false;
 #if defined(LIBAVCODEC_VERSION_INT) && LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(54,25,0) // introduced at http://git.libav.org/?p=libav.git;a=commit;h=104e10fb426f903ba9157fdbfe30292d0e4c3d72
-        AVCodecID video_codec = codecid == -1 ? AV_CODEC_ID_MPEG4 : (AVCodecID)codecid;
+        AVCodecID video_codec = !!codec ? codec->id : (codecid == -1 ? AV_CODEC_ID_MPEG4 : (AVCodecID)codecid);
         if (video_codec == AV_CODEC_ID_H264) {
             bFixH264 = true;
         }
 #else
-        CodecID video_codec = codecid == -1 ? CODEC_ID_MPEG4 : (CodecID)codecid;
+        CodecID video_codec = !!codec ? codec->id : (codecid == -1 ? CODEC_ID_MPEG4 : (CodecID)codecid);
 #endif
 #if LIBAVFORMAT_VERSION_INT >= (52<<16)
         AVOutputFormat *fmt = av_oformat_next(NULL); //first_oformat;
@@ -751,7 +836,9 @@ protected:
         
         snprintf(_output->filename, sizeof(_output->filename), "%s", filename.c_str());
 
-        codec = avcodec_find_encoder(video_codec);
+        if( !codec ) {
+            codec = avcodec_find_encoder(video_codec);
+        }
         BOOST_ASSERT(!!codec);
 
 #if LIBAVFORMAT_VERSION_INT >= (54<<16)     
@@ -781,6 +868,11 @@ protected:
         }
         codec_ctx->gop_size = 10;
         codec_ctx->max_b_frames = 1;
+#ifdef FF_THREAD_FRAME
+        // let libavcodec encode on as many threads as there are cores
+        codec_ctx->thread_count = 0;
+        codec_ctx->thread_type = FF_THREAD_FRAME|FF_THREAD_SLICE;
+#endif
 #if LIBAVFORMAT_VERSION_INT >= (55<<16)
         codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
 #else
@@ -859,31 +951,23 @@ protected:
             return;
         }
 
-        // flip vertically
-        static vector<char> newdata;
-        newdata.resize(_stream->codec->height*_stream->codec->width*3);
-        char* penddata = (char*)pdata + _stream->codec->height*_stream->codec->width*3;
-
-        for(int i = 0; i < _stream->codec->height; ++i) {
-            memcpy(&newdata[i*_stream->codec->width*3], (char*)penddata - (i+1)*_stream->codec->width*3, _stream->codec->width*3);
-        }
-
-        _picture->data[0] = (uint8_t*)&newdata[0];
-        _picture->linesize[0] = _stream->codec->width * 3;
+        // the first row of the image is the bottom, so flip vertically by starting at the last row with a negative stride
+        int linesize = _stream->codec->width * 3;
+        _picture->data[0] = (uint8_t*)pdata + (_stream->codec->height-1)*linesize;
+        _picture->linesize[0] = -linesize;
 
 #ifdef HAVE_NEW_FFMPEG
-        struct SwsContext *img_convert_ctx;
 #if LIBAVFORMAT_VERSION_INT >= (55<<16)
-        img_convert_ctx = sws_getContext(_stream->codec->width, _stream->codec->height, AV_PIX_FMT_BGR24, _stream->codec->width, _stream->codec->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC /* flags */, NULL, NULL, NULL);
+        _swscontext = sws_getCachedContext(_swscontext, _stream->codec->width, _stream->codec->height, AV_PIX_FMT_BGR24, _stream->codec->width, _stream->codec->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC /* flags */, NULL, NULL, NULL);
 #else
-        img_convert_ctx = sws_getContext(_stream->codec->width, _stream->codec->height, PIX_FMT_BGR24, _stream->codec->width, _stream->codec->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC /* flags */, NULL, NULL, NULL);
+        _swscontext = sws_getCachedContext(_swscontext, _stream->codec->width, _stream->codec->height, PIX_FMT_BGR24, _stream->codec->width, _stream->codec->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC /* flags */, NULL, NULL, NULL);
 #endif
-        if (!sws_scale(img_convert_ctx, _picture->data, _picture->linesize, 0, _stream->codec->height, _yuv420p->data, _yuv420p->linesize)) {
-            sws_freeContext(img_convert_ctx);
+        if( !_swscontext ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("ADD_FRAME sws_getCachedContext failed",ORE_Assert);
+        }
+        if (!sws_scale(_swscontext, _picture->data, _picture->linesize, 0, _stream->codec->height, _yuv420p->data, _yuv420p->linesize)) {
             throw OPENRAVE_EXCEPTION_FORMAT0("ADD_FRAME sws_scale failed",ORE_Assert);
         }
-
-        sws_freeContext(img_convert_ctx);
 #else
         if( img_convert((AVPicture*)_yuv420p, PIX_FMT_YUV420P, (AVPicture*)_picture, PIX_FMT_BGR24, _stream->codec->width, _stream->codec->height) ) {
             throw OPENRAVE_EXCEPTION_FORMAT0("ADD_FRAME img_convert failed",ORE_Assert);
@@ -892,10 +976,42 @@ protected:
 
 
 #if LIBAVFORMAT_VERSION_INT >= (54<<16)
+        _yuv420p->pts = _frameindex++;
+        _EncodeFrame(_yuv420p);
+#else
+        int size = avcodec_encode_video(_stream->codec, (uint8_t*)_outbuf, _outbuf_size, _yuv420p);
+        if (size < 0) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("error encoding frame",ORE_Assert);
+        }
+
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = (uint8_t*)_outbuf;
+        pkt.size = size;
+        pkt.stream_index = _stream->index;
+        //RAVELOG_INFO("%d\n",index);
+        pkt.pts = _frameindex++;
+        if( av_write_frame(_output, &pkt) < 0) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("av_write_frame failed",ORE_Assert);
+        }
+
+#endif
+        _nFrameCount++;
+    }
+
+#if LIBAVFORMAT_VERSION_INT >= (54<<16)
+    /// \brief encodes the frame and writes its packet if the encoder returned one
+    ///
+    /// \param frame the frame to encode, if NULL flushes the delayed frames of the encoder
+    /// \return true if a packet was written
+    bool _EncodeFrame(AVFrame* frame)
+    {
         int got_packet = 0;
         AVPacket pkt;
         av_init_packet(&pkt);
-        int ret = avcodec_encode_video2(_stream->codec, &pkt, _yuv420p, &got_packet);
+        pkt.data = NULL;
+        pkt.size = 0;
+        int ret = avcodec_encode_video2(_stream->codec, &pkt, frame, &got_packet);
         if( ret < 0 ) {
 #if LIBAVFORMAT_VERSION_INT >= (55<<16)
             av_free_packet(&pkt);
@@ -909,6 +1025,14 @@ protected:
                 _stream->codec->coded_frame->pts       = pkt.pts;
                 _stream->codec->coded_frame->key_frame = !!(pkt.flags & AV_PKT_FLAG_KEY);
             }
+            // the frames are counted in the codec time base
+            if( pkt.pts != (int64_t)AV_NOPTS_VALUE ) {
+                pkt.pts = av_rescale_q(pkt.pts, _stream->codec->time_base, _stream->time_base);
+            }
+            if( pkt.dts != (int64_t)AV_NOPTS_VALUE ) {
+                pkt.dts = av_rescale_q(pkt.dts, _stream->codec->time_base, _stream->time_base);
+            }
+            pkt.stream_index = _stream->index;
             if( av_write_frame(_output, &pkt) < 0) {
 #if LIBAVFORMAT_VERSION_INT >= (55<<16)
                 av_free_packet(&pkt);
@@ -923,27 +1047,10 @@ protected:
 #else
         av_destruct_packet(&pkt);
 #endif
-#else
-        int size = avcodec_encode_video(_stream->codec, (uint8_t*)_outbuf, _outbuf_size, _yuv420p);
-        if (size < 0) {
-            throw OPENRAVE_EXCEPTION_FORMAT0("error encoding frame",ORE_Assert);
-        }
-
-        AVPacket pkt;
-        av_init_packet(&pkt);
-        pkt.data = (uint8_t*)_outbuf;
-        pkt.size = size;
-        pkt.stream_index = _stream->index;
-        //RAVELOG_INFO("%d\n",index);
-        pkt.pts = _frameindex++;
-        if( av_write_frame(_output, &pkt) < 0) {
-            throw OPENRAVE_EXCEPTION_FORMAT0("av_write_frame failed",ORE_Assert);
-        }
-
-#endif
-        _nFrameCount++;
+        return !!got_packet;
     }
 #endif
+#endif
 };
 
 ModuleBasePtr CreateViewerRecorder(EnvironmentBasePtr penv, std::istream& sinput) {
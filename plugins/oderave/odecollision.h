@@ -31,8 +31,9 @@ class ODECollisionChecker : public OpenRAVE::CollisionCheckerBase
     class CollisionCallbackData
     {
     public:
-        CollisionCallbackData(boost::shared_ptr<ODECollisionChecker> pchecker, CollisionReportPtr report, KinBodyConstPtr pbody, KinBody::LinkConstPtr plink) : _pchecker(pchecker), _report(report), _pbody(pbody), _plink(plink), fraymaxdist(0), pvbodyexcluded(NULL), pvlinkexcluded(NULL), _bCollision(false), _bStopChecking(false)
+        CollisionCallbackData(boost::shared_ptr<ODECollisionChecker> pchecker, CollisionReportPtr report, KinBodyConstPtr pbody, KinBody::LinkConstPtr plink) : _pchecker(pchecker), _report(report), _pbody(pbody), _plink(plink), fraymaxdist(0), pvbodyexcluded(NULL), pvlinkexcluded(NULL), pvattachedspaces(NULL), _bCollision(false), _bStopChecking(false)
         {
+            pchecker->_pcounterqueries->Add();
             _bHasCallbacks = pchecker->GetEnv()->HasRegisteredCollisionCallbacks();
             if( _bHasCallbacks && !_report ) {
                 _report.reset(new CollisionReport());
@@ -93,6 +94,16 @@ class ODECollisionChecker : public OpenRAVE::CollisionCheckerBase
         OpenRAVE::dReal fraymaxdist;
         const std::vector<KinBodyConstPtr>* pvbodyexcluded;
         const std::vector<KinBody::LinkConstPtr>* pvlinkexcluded;
+        const std::vector<dSpaceID>* pvattachedspaces; ///< if not NULL, sorted spaces of the bodies attached to _pbody
+
+        /// \brief returns true if the space belongs to a body attached to _pbody
+        bool IsAttachedSpace(dGeomID o, KinBodyConstPtr pbody) const
+        {
+            if( !!pvattachedspaces ) {
+                return std::binary_search(pvattachedspaces->begin(), pvattachedspaces->end(), (dSpaceID)o);
+            }
+            return _pbody->IsAttached(*pbody);
+        }
 
         bool _bCollision;
         bool _bStopChecking; ///< if true, should stop checking for new collisions
@@ -121,6 +132,8 @@ public:
         __description = ":Interface Author: Rosen Diankov\n\nOpen Dynamics Engine collision checker (fast, but inaccurate for triangle meshes)";
         RegisterCommand("SetMaxContacts",boost::bind(&ODECollisionChecker::_SetMaxContactsCommand, this,_1,_2),
                         str(boost::format("sets the maximum contacts that can be returned by the checker (limit is %d)")%_nMaxContacts));
+        _pcounterqueries = RegisterPerfCounter("collision.queries");
+        _pcounternarrowphase = RegisterPerfCounter("collision.narrowphase");
 #ifndef ODE_USE_MULTITHREAD
         if( !_bnotifiedmessage ) {
             RAVELOG_DEBUG("ode will be slow in multi-threaded environments\n");
@@ -233,7 +246,7 @@ public:
         boost::mutex::scoped_lock lock(_mutexode);
 #endif
         _odespace->Synchronize();
-        dSpaceCollide(_odespace->GetSpace(), &cb, KinBodyCollisionCallback);
+        _CollideAttachedBodies(pbody, cb);
         return cb._bCollision;
     }
 
@@ -297,6 +310,14 @@ public:
     }
 
     int _GeomCollide(dGeomID geom1, dGeomID geom2, vector<dContact>& vcontacts, bool bComputeAllContacts)
+    {
+        uint64_t starttime = OpenRAVE::utils::GetNanoPerformanceTime();
+        int N = _GeomCollideContacts(geom1, geom2, vcontacts, bComputeAllContacts);
+        _pcounternarrowphase->Add(OpenRAVE::utils::GetNanoPerformanceTime() - starttime);
+        return N;
+    }
+
+    int _GeomCollideContacts(dGeomID geom1, dGeomID geom2, vector<dContact>& vcontacts, bool bComputeAllContacts)
     {
         vcontacts.resize(bComputeAllContacts ? _nMaxStartContacts : 1);
         int log2limit = (int)ceil(OpenRAVE::RaveLog(vcontacts.size())/OpenRAVE::RaveLog(2));
@@ -356,7 +377,7 @@ public:
         bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
         std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vcontacts;
         dGeomID geom1 = _odespace->GetLinkGeom(plink1);
         int igeom1 = 0;
         bool bCollision = false;
@@ -523,7 +544,7 @@ public:
 #endif
 
         _odespace->Synchronize();
-        dSpaceCollide(_odespace->GetSpace(), &cb, KinBodyCollisionCallback);
+        _CollideAttachedBodies(pbody, cb);
         return cb._bCollision;
     }
 
@@ -557,7 +578,7 @@ public:
         std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
         bool bCollision = false;
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vcontacts;
         dGeomID geom1 = _odespace->GetLinkGeom(plink);
         while(geom1 != NULL) {
             BOOST_ASSERT(dGeomIsEnabled(geom1));
@@ -707,6 +728,51 @@ public:
         return cb._bCollision;
     }
 
+    virtual int CheckCollisionRays(const std::vector<RAY>& vrays, KinBodyConstPtr pbody, std::vector<OpenRAVE::dReal>& vhitdistances, std::vector<Vector>& vhitnormals, std::vector<int>& vhitbodyids)
+    {
+        vhitdistances.resize(vrays.size());
+        vhitnormals.resize(vrays.size());
+        vhitbodyids.resize(vrays.size());
+        if( !!pbody && (pbody->GetLinks().size() == 0 || !pbody->IsEnabled()) ) {
+            std::fill(vhitdistances.begin(), vhitdistances.end(), OpenRAVE::dReal(-1));
+            std::fill(vhitnormals.begin(), vhitnormals.end(), Vector());
+            std::fill(vhitbodyids.begin(), vhitbodyids.end(), 0);
+            return 0;
+        }
+
+#ifndef ODE_USE_MULTITHREAD
+        boost::mutex::scoped_lock lock(_mutexode);
+#endif
+        // synchronize and set up the ray once for all the rays
+        _odespace->Synchronize();
+        dGeomID space = !!pbody ? (dGeomID)_odespace->GetBodySpace(pbody) : (dGeomID)_odespace->GetSpace();
+        dGeomRaySetClosestHit(geomray, !(_options&OpenRAVE::CO_RayAnyHit));
+        dGeomRaySetParams(geomray,0,0);
+        CollisionReportPtr report(new CollisionReport());
+        int numhits = 0;
+        for(size_t iray = 0; iray < vrays.size(); ++iray) {
+            const RAY& ray = vrays[iray];
+            CollisionCallbackData cb(shared_checker(),report,pbody,KinBody::LinkConstPtr());
+            cb.fraymaxdist = OpenRAVE::RaveSqrt(ray.dir.lengthsqr3());
+            Vector vnormdir = cb.fraymaxdist > 0 ? ray.dir*(1/cb.fraymaxdist) : ray.dir;
+            dGeomRaySet(geomray, ray.pos.x, ray.pos.y, ray.pos.z, vnormdir.x, vnormdir.y, vnormdir.z);
+            dGeomRaySetLength(geomray,cb.fraymaxdist);
+            dSpaceCollide2(space, geomray, &cb, RayCollisionCallback);
+            if( cb._bCollision ) {
+                vhitdistances[iray] = report->minDistance;
+                vhitnormals[iray] = report->contacts.size() > 0 ? report->contacts[0].norm : Vector();
+                vhitbodyids[iray] = !!report->plink1 ? report->plink1->GetParent()->GetEnvironmentId() : 0;
+                ++numhits;
+            }
+            else {
+                vhitdistances[iray] = -1;
+                vhitnormals[iray] = Vector();
+                vhitbodyids[iray] = 0;
+            }
+        }
+        return numhits;
+    }
+
     virtual bool CheckCollision(const OpenRAVE::TriMesh& trimesh, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
         RAVELOG_WARN("ODE doesn't support trimesh/body collision call");
@@ -836,6 +902,30 @@ public:
     }
 
 private:
+    /// \brief collides only the spaces of pbody and its attached bodies against the environment space
+    ///
+    /// ODE treats the body space as a single geometry of the environment space, so only the bodies whose AABBs overlap it are visited.
+    void _CollideAttachedBodies(KinBodyConstPtr pbody, CollisionCallbackData& cb)
+    {
+        std::set<KinBodyPtr> setattached;
+        pbody->GetAttached(setattached);
+        _vattachedspaces.resize(0);
+        FOREACHC(itbody, setattached) {
+            if( (*itbody)->IsEnabled() ) {
+                _vattachedspaces.push_back(_odespace->GetBodySpace(*itbody));
+            }
+        }
+        std::sort(_vattachedspaces.begin(), _vattachedspaces.end());
+        cb.pvattachedspaces = &_vattachedspaces;
+        FOREACHC(itspace, _vattachedspaces) {
+            dSpaceCollide2((dGeomID)*itspace, (dGeomID)_odespace->GetSpace(), &cb, KinBodyCollisionCallback);
+            if( cb._bStopChecking ) {
+                break;
+            }
+        }
+        cb.pvattachedspaces = NULL;
+    }
+
     static void KinBodyCollisionCallback (void *data, dGeomID o1, dGeomID o2)
     {
         CollisionCallbackData* pcb = (CollisionCallbackData*)data;
@@ -869,7 +959,7 @@ private:
         }
 
         // only recurse two spaces if exactly one of them is attached to _pbody
-        if( !!pbody1 && !!pbody2 &&( pcb->_pbody->IsAttached(*pbody1) == pcb->_pbody->IsAttached(*pbody2)) ) {
+        if( !!pbody1 && !!pbody2 &&( pcb->IsAttachedSpace(o1, pbody1) == pcb->IsAttachedSpace(o2, pbody2)) ) {
             return;
         }
         if (dGeomIsSpace(o1) || dGeomIsSpace(o2)) {
@@ -931,7 +1021,7 @@ private:
             }
         }
 
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vcontacts;
         int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
         if ( N > 0 ) {
             if( !!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
@@ -1048,7 +1138,7 @@ private:
         }
 
         // only care if one of the bodies is the link
-        vector<dContact> vcontacts;
+        vector<dContact>& vcontacts = _vcontacts;
         int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
         if ( N > 0 ) {
 
@@ -1183,7 +1273,7 @@ private:
 
         // only care if one of the bodies is the link
         if(( pkb1 == pcb->_plink) ||( pkb2 == pcb->_plink) ) {
-            vector<dContact> vcontacts;
+            vector<dContact>& vcontacts = _vcontacts;
             int N = _GeomCollide(o1,o2,vcontacts, !!pcb->_report && !!(_options & OpenRAVE::CO_Contacts));
             if (N) {
                 if(!!pcb->_report || pcb->GetCallbacks().size() > 0 ) {
@@ -1382,6 +1472,10 @@ private:
     size_t _nMaxStartContacts, _nMaxContacts;
     std::string _userdatakey;
     CollisionReport _report;
+    std::vector<dContact> _vcontacts; ///< contact buffer reused by all the narrow-phase calls
+    std::vector<dSpaceID> _vattachedspaces; ///< sorted spaces of the queried body and its attached bodies, cached for _CollideAttachedBodies
+    OpenRAVE::PerfCounterPtr _pcounterqueries; ///< number of collision queries
+    OpenRAVE::PerfCounterPtr _pcounternarrowphase; ///< number and duration in ns of the dCollide calls between two geometries
 
 
 };
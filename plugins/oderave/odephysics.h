@@ -148,6 +148,13 @@ public:
                 }
                 RAVELOG_DEBUG("Setting surface layer depth to: %f\n",_physics->_surfacelayer);
             }
+            else if( name == "islandthreads" ) {
+                int temp=0;
+                _ss >> temp;
+                if( !!_ss ) {
+                    _physics->_SetIslandThreads(temp);
+                }
+            }
             else {
                 RAVELOG_ERROR("unknown field %s\n", name.c_str());
             }
@@ -170,8 +177,8 @@ public:
             }
         }
 
-        static const boost::array<string, 11>& GetTags() {
-            static const boost::array<string, 11> tags = {{"friction","selfcollision", "gravity", "contact", "erp", "cfm", "elastic_reduction_parameter", "constraint_force_mixing", "dcontactapprox", "numiterations", "surfacelayer" }};
+        static const boost::array<string, 12>& GetTags() {
+            static const boost::array<string, 12> tags = {{"friction","selfcollision", "gravity", "contact", "erp", "cfm", "elastic_reduction_parameter", "constraint_force_mixing", "dcontactapprox", "numiterations", "surfacelayer", "islandthreads" }};
             return tags;
         }
 
@@ -216,6 +223,18 @@ The possible properties that can be set are: ";
         _surface_mode = 0;
         _surfacelayer = 0.001;
         _options = OpenRAVE::PEO_SelfCollisions;
+        _nIslandThreads = 1;
+        _bGatherCollisionPairs = false;
+        _ncollisionjob = 0;
+        _nextcollisionpair = 0;
+        _numbusycollisionthreads = 0;
+        _bStopCollisionThreads = false;
+#ifdef ODE_HAVE_THREADING_IMPLEMENTATION
+        _odethreading = NULL;
+        _odethreadpool = NULL;
+#endif
+        RegisterCommand("SetIslandThreads",boost::bind(&ODEPhysicsEngine::_SetIslandThreadsCommand, this,_1,_2),
+                        "\"numthreads\", with more than 1 thread the contacts of the colliding pairs are computed on a thread pool and merged in the order of the pairs, so the simulation stays deterministic. If ODE is built with its threading implementation, the independent contact islands are also stepped in parallel. Default is 1.");
 
         memset(_jointadd, 0, sizeof(_jointadd));
         _jointadd[dJointTypeBall] = DummyAddForce;
@@ -235,6 +254,7 @@ The possible properties that can be set are: ";
         _jointgetvel[dJointTypeHinge2].push_back(dJointGetHinge2Angle2Rate);
     }
     virtual ~ODEPhysicsEngine() {
+        _StopIslandThreads();
         _odespace->Destroy();
     }
 
@@ -260,6 +280,8 @@ The possible properties that can be set are: ";
         dWorldSetCFM(_odespace->GetWorld(),_globalcfm);
         dWorldSetQuickStepNumIterations (_odespace->GetWorld(), _num_iterations);
         dWorldSetContactSurfaceLayer(_odespace->GetWorld(), _surfacelayer);
+        _UpdateAutoDisable();
+        _InitStepThreading();
         return true;
     }
 
@@ -296,6 +318,7 @@ The possible properties that can be set are: ";
     virtual bool SetPhysicsOptions(int physicsoptions)
     {
         _options = physicsoptions;
+        _UpdateAutoDisable();
         return true;
     }
 
@@ -321,11 +344,13 @@ The possible properties that can be set are: ";
         _globalerp = r->_globalerp;
         _surface_mode = r->_surface_mode;
         _num_iterations = r->_num_iterations;
+        _SetIslandThreads(r->_nIslandThreads);
         if( !!_odespace && _odespace->IsInitialized() ) {
             dWorldSetERP(_odespace->GetWorld(),_globalerp);
             dWorldSetCFM(_odespace->GetWorld(),_globalcfm);
             dWorldSetQuickStepNumIterations (_odespace->GetWorld(), _num_iterations);
         }
+        _UpdateAutoDisable();
     }
 
     virtual bool SetLinkVelocity(KinBody::LinkPtr plink, const Vector& _linearvel, const Vector& angularvel)
@@ -336,6 +361,7 @@ The possible properties that can be set are: ";
             return false;
         }
         Vector linearvel = _linearvel + angularvel.cross(plink->GetTransform()*plink->GetCOMOffset() - plink->GetTransform().trans);
+        _WakeBody(body);
         dBodySetLinearVel(body, linearvel.x,linearvel.y,linearvel.z);
         dBodySetAngularVel(body, angularvel.x, angularvel.y, angularvel.z);
         return true;
@@ -348,6 +374,7 @@ The possible properties that can be set are: ";
         FOREACHC(itlink, pbody->GetLinks()) {
             dBodyID body = _odespace->GetLinkBody(*itlink);
             if( body ) {
+                _WakeBody(body);
                 Vector angularvel = velocities.at((*itlink)->GetIndex()).second;
                 dBodySetAngularVel(body, angularvel.x,angularvel.y,angularvel.z);
                 Vector linearvel = velocities.at((*itlink)->GetIndex()).first;
@@ -441,6 +468,7 @@ The possible properties that can be set are: ";
             return false;
         }
         _odespace->Synchronize(plink->GetParent());
+        _WakeBody(body);
         if( !bAdd ) {
             dBodySetForce(body, 0, 0, 0);
         }
@@ -455,6 +483,7 @@ The possible properties that can be set are: ";
             return false;
         }
         _odespace->Synchronize(plink->GetParent());
+        _WakeBody(body);
 
         if( !bAdd ) {
             dBodySetTorque(body, torque.x, torque.y, torque.z);
@@ -472,6 +501,8 @@ The possible properties that can be set are: ";
         _odespace->Synchronize(pjoint->GetParent());
         std::vector<dReal> vtorques(pTorques.size());
         std::copy(pTorques.begin(),pTorques.end(),vtorques.begin());
+        _WakeBody(dJointGetBody(joint, 0));
+        _WakeBody(dJointGetBody(joint, 1));
         _jointadd[dJointGetType(joint)](joint, &vtorques[0]);
         return true;
     }
@@ -501,6 +532,9 @@ The possible properties that can be set are: ";
             _listcallbacks.clear();
         }
 
+        // with island threads, the pairs are only gathered here and collided after all spaces are traversed
+        _bGatherCollisionPairs = _nIslandThreads > 1;
+        _vcollisionpairs.resize(0);
         dSpaceCollide (_odespace->GetSpace(),this,nearCallback);
 
         vector<KinBodyPtr> vbodies;
@@ -515,15 +549,39 @@ The possible properties that can be set are: ";
             }
         }
 
+        if( _bGatherCollisionPairs ) {
+            _bGatherCollisionPairs = false;
+            _CollidePairs();
+            // create the contact joints in the order the pairs were found, so independent of the threads
+            for(size_t ipair = 0; ipair < _vcollisionpairs.size(); ++ipair) {
+                const CollisionPair& pair = _vcollisionpairs[ipair];
+                if( pair.numcontacts > 0 ) {
+                    _ProcessContacts(pair.o1, pair.b1, pair.b2, pair.pkb1, pair.pkb2, &_vpaircontacts[ipair*s_nMaxPairContacts], pair.numcontacts);
+                }
+            }
+            _vcollisionpairs.resize(0);
+        }
+
+        // bodies that sleep before and after the step did not move
+        _vbodyawake.resize(vbodies.size());
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            _vbodyawake[ibody] = _IsAwake(_odespace->GetInfo(vbodies[ibody]));
+        }
+
         dWorldQuickStep(_odespace->GetWorld(), fTimeElapsed);
         dJointGroupEmpty (_odespace->GetContactGroup());
 
         // synchronize all the objects from the ODE world to the OpenRAVE world
         Transform t;
-        FOREACHC(itbody, vbodies) {
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            std::vector<KinBodyPtr>::const_iterator itbody = vbodies.begin()+ibody;
             ODESpace::KinBodyInfoPtr pinfo = _odespace->GetInfo(*itbody);
             BOOST_ASSERT( pinfo->vlinks.size() == (*itbody)->GetLinks().size());
-            if( (*itbody)->IsEnabled() ) {
+            if( (*itbody)->IsEnabled() && !_vbodyawake[ibody] && !_IsAwake(pinfo) ) {
+                // setting the same transforms would only update the stamps and the collision checkers
+                pinfo->nLastStamp = (*itbody)->GetUpdateStamp();
+            }
+            else if( (*itbody)->IsEnabled() ) {
                 vector<Transform> vtrans(pinfo->vlinks.size());
                 for(size_t i = 0; i < pinfo->vlinks.size(); ++i) {
                     const dReal* prot = dBodyGetQuaternion(pinfo->vlinks[i]->body);
@@ -601,13 +659,30 @@ private:
                 return;
         }
 
-        const int N = 16;
-        dContact contact[N];
-        int n = dCollide (o1,o2,N,&contact[0].geom,sizeof(dContact));
+        if( _bGatherCollisionPairs ) {
+            CollisionPair pair;
+            pair.o1 = o1;
+            pair.o2 = o2;
+            pair.b1 = b1;
+            pair.b2 = b2;
+            pair.pkb1 = pkb1;
+            pair.pkb2 = pkb2;
+            pair.numcontacts = 0;
+            _vcollisionpairs.push_back(pair);
+            return;
+        }
+
+        dContact contact[s_nMaxPairContacts];
+        int n = dCollide (o1,o2,s_nMaxPairContacts,&contact[0].geom,sizeof(dContact));
         if( n <= 0 ) {
             return;
         }
+        _ProcessContacts(o1, b1, b2, pkb1, pkb2, contact, n);
+    }
 
+    /// \brief calls the collision callbacks and creates the contact joints of one colliding pair
+    void _ProcessContacts(dGeomID o1, dBodyID b1, dBodyID b2, KinBody::LinkPtr pkb1, KinBody::LinkPtr pkb2, dContact* contact, int n)
+    {
         if( _listcallbacks.size() > 0 ) {
             // fill the collision report
             _report->Reset(OpenRAVE::CO_Contacts);
@@ -640,12 +715,12 @@ private:
             //        contact[i].surface.soft_cfm = 0.04;
             dJointID c = dJointCreateContact (_odespace->GetWorld(),_odespace->GetContactGroup(),contact+i);
 
-            // make sure that static objects are not enabled by adding a joint attaching them
+            // make sure that static objects are not enabled by adding a joint attaching them. sleeping bodies are attached so ode wakes them up
             if( b1 ) {
-                b1 = dBodyIsEnabled(b1) ? b1 : 0;
+                b1 = _IsDynamicBody(b1) ? b1 : 0;
             }
             if( b2 ) {
-                b2 = dBodyIsEnabled(b2) ? b2 : 0;
+                b2 = _IsDynamicBody(b2) ? b2 : 0;
             }
             dJointAttach (c, b1, b2);
 
@@ -667,8 +742,231 @@ private:
         //        dJointAttach (c,b1,b2);
     }
 
+    bool _SetIslandThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int numthreads = 0;
+        sinput >> numthreads;
+        if( !sinput ) {
+            return false;
+        }
+        _SetIslandThreads(numthreads);
+        return true;
+    }
+
+    /// \brief sets the number of threads for colliding the pairs and stepping the islands, restarts the thread pools
+    void _SetIslandThreads(int numthreads)
+    {
+        numthreads = max(1, numthreads);
+#ifndef ODE_USE_MULTITHREAD
+        if( numthreads > 1 ) {
+            RAVELOG_WARN_FORMAT("env=%d, ode is not built for multi-threading, so cannot use %d island threads", GetEnv()->GetId()%numthreads);
+            numthreads = 1;
+        }
+#endif
+        if( numthreads == _nIslandThreads ) {
+            return;
+        }
+        _StopIslandThreads();
+        _nIslandThreads = numthreads;
+        if( _nIslandThreads > 1 ) {
+            _bStopCollisionThreads = false;
+            // the stepping thread collides pairs too
+            for(int ithread = 1; ithread < _nIslandThreads; ++ithread) {
+                _vcollisionthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ODEPhysicsEngine::_CollisionThread, this, _ncollisionjob))));
+            }
+#ifndef ODE_HAVE_THREADING_IMPLEMENTATION
+            RAVELOG_DEBUG_FORMAT("env=%d, ode has no threading implementation, so the islands are stepped serially", GetEnv()->GetId());
+#endif
+        }
+        _InitStepThreading();
+    }
+
+    /// \brief lets ode step the islands of the world on a thread pool
+    void _InitStepThreading()
+    {
+#ifdef ODE_HAVE_THREADING_IMPLEMENTATION
+        if( _nIslandThreads > 1 && !_odethreading && !!_odespace && _odespace->IsInitialized() ) {
+            _odethreading = dThreadingAllocateMultiThreadedImplementation();
+            _odethreadpool = dThreadingAllocateThreadPool(_nIslandThreads, 0, dAllocateFlagBasicData, NULL);
+            dThreadingThreadPoolServeMultiThreadedImplementation(_odethreadpool, _odethreading);
+            dWorldSetStepIslandsProcessingMaxThreadCount(_odespace->GetWorld(), _nIslandThreads);
+            dWorldSetStepThreadingImplementation(_odespace->GetWorld(), dThreadingImplementationGetFunctions(_odethreading), _odethreading);
+        }
+#endif
+    }
+
+    void _StopIslandThreads()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexcollision);
+            _bStopCollisionThreads = true;
+            _condcollisionwork.notify_all();
+        }
+        FOREACH(itthread, _vcollisionthreads) {
+            (*itthread)->join();
+        }
+        _vcollisionthreads.resize(0);
+#ifdef ODE_HAVE_THREADING_IMPLEMENTATION
+        if( !!_odethreading ) {
+            dThreadingImplementationShutdownProcessing(_odethreading);
+            dThreadingFreeThreadPool(_odethreadpool);
+            if( !!_odespace && _odespace->IsInitialized() ) {
+                dWorldSetStepThreadingImplementation(_odespace->GetWorld(), NULL, NULL);
+            }
+            dThreadingFreeImplementation(_odethreading);
+            _odethreading = NULL;
+            _odethreadpool = NULL;
+        }
+#endif
+    }
+
+    /// \brief computes the contacts of all of _vcollisionpairs with the collision threads
+    void _CollidePairs()
+    {
+        _vpaircontacts.resize(_vcollisionpairs.size()*s_nMaxPairContacts);
+        if( _vcollisionthreads.size() == 0 || _vcollisionpairs.size() < 2*s_nCollisionPairChunk ) {
+            for(size_t ipair = 0; ipair < _vcollisionpairs.size(); ++ipair) {
+                _CollidePair(ipair);
+            }
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock lock(_mutexcollision);
+            _nextcollisionpair = 0;
+            _numbusycollisionthreads = _vcollisionthreads.size();
+            ++_ncollisionjob;
+            _condcollisionwork.notify_all();
+        }
+        _CollidePairChunks();
+        boost::mutex::scoped_lock lock(_mutexcollision);
+        while( _numbusycollisionthreads > 0 ) {
+            _condcollisiondone.wait(lock);
+        }
+    }
+
+    /// \brief collides chunks of pairs until there are none left
+    void _CollidePairChunks()
+    {
+        while(1) {
+            size_t istart;
+            {
+                boost::mutex::scoped_lock lock(_mutexcollision);
+                istart = _nextcollisionpair;
+                _nextcollisionpair += s_nCollisionPairChunk;
+            }
+            if( istart >= _vcollisionpairs.size() ) {
+                break;
+            }
+            size_t iend = min(istart+s_nCollisionPairChunk, _vcollisionpairs.size());
+            for(size_t ipair = istart; ipair < iend; ++ipair) {
+                _CollidePair(ipair);
+            }
+        }
+    }
+
+    inline void _CollidePair(size_t ipair)
+    {
+        CollisionPair& pair = _vcollisionpairs[ipair];
+        pair.numcontacts = dCollide(pair.o1, pair.o2, s_nMaxPairContacts, &_vpaircontacts[ipair*s_nMaxPairContacts].geom, sizeof(dContact));
+    }
+
+    /// \brief waits for collision jobs newer than njob
+    void _CollisionThread(uint64_t njob)
+    {
+#ifdef ODE_HAVE_ALLOCATE_DATA_THREAD
+        dAllocateODEDataForThread(dAllocateMaskAll);
+#endif
+        while(1) {
+            {
+                boost::mutex::scoped_lock lock(_mutexcollision);
+                while( !_bStopCollisionThreads && _ncollisionjob == njob ) {
+                    _condcollisionwork.wait(lock);
+                }
+                if( _bStopCollisionThreads ) {
+                    break;
+                }
+                njob = _ncollisionjob;
+            }
+            _CollidePairChunks();
+            boost::mutex::scoped_lock lock(_mutexcollision);
+            if( --_numbusycollisionthreads == 0 ) {
+                _condcollisiondone.notify_all();
+            }
+        }
+#ifdef ODE_HAVE_ALLOCATE_DATA_THREAD
+        dCleanupODEAllDataForThread();
+#endif
+    }
+
+    /// \brief true if the body is simulated, which includes sleeping bodies but not static or disabled links
+    static bool _IsDynamicBody(dBodyID body)
+    {
+        if( !body ) {
+            return false;
+        }
+        if( dBodyIsEnabled(body) ) {
+            return true;
+        }
+        ODESpace::KinBodyInfo::LINK* plink = (ODESpace::KinBodyInfo::LINK*)dBodyGetData(body);
+        return !!plink && plink->_bEnabled;
+    }
+
+    /// \brief wakes up body if it is sleeping
+    static void _WakeBody(dBodyID body)
+    {
+        if( _IsDynamicBody(body) ) {
+            dBodyEnable(body);
+        }
+    }
+
+    /// \brief true if any link of the body is simulated and not sleeping
+    static bool _IsAwake(ODESpace::KinBodyInfoConstPtr pinfo)
+    {
+        if( !pinfo ) {
+            return false;
+        }
+        FOREACHC(itlink, pinfo->vlinks) {
+            if( !!(*itlink)->body && dBodyIsEnabled((*itlink)->body) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief sets the auto disable flag of the world and all its bodies from PEO_AutoDisable
+    void _UpdateAutoDisable()
+    {
+        if( !_odespace || !_odespace->IsInitialized() ) {
+            return;
+        }
+        bool bAutoDisable = !!(_options & OpenRAVE::PEO_AutoDisable);
+        dWorldSetAutoDisableFlag(_odespace->GetWorld(), bAutoDisable);
+        // bodies only copy the world settings when created
+        vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        FOREACHC(itbody, vbodies) {
+            ODESpace::KinBodyInfoPtr pinfo = _odespace->GetInfo(*itbody);
+            if( !pinfo ) {
+                continue;
+            }
+            FOREACHC(itlink, pinfo->vlinks) {
+                if( !!(*itlink)->body ) {
+                    dBodySetAutoDisableDefaults((*itlink)->body);
+                    if( !bAutoDisable ) {
+                        _WakeBody((*itlink)->body);
+                    }
+                }
+            }
+        }
+    }
+
     void _SyncCallback(ODESpace::KinBodyInfoConstPtr pinfo)
     {
+        // the body was moved, so wake it up in case it was sleeping
+        FOREACHC(itlink, pinfo->vlinks) {
+            _WakeBody((*itlink)->body);
+        }
         // things very difficult when dynamics are not reset
 //        FOREACHC(itlink, pinfo->vlinks) {
 //            if( (*itlink)->body != NULL ) {
@@ -706,6 +1004,37 @@ private:
     vector<JointGetFn> _jointgetvel[12];
     std::list<EnvironmentBase::CollisionCallbackFn> _listcallbacks;
     CollisionReportPtr _report;
+    std::vector<uint8_t> _vbodyawake; ///< for every body of the current step, 1 if it was awake before stepping
+
+    static const int s_nMaxPairContacts = 16; ///< the maximum contacts between two geoms
+    static const size_t s_nCollisionPairChunk = 16; ///< the number of pairs a collision thread takes at once
+
+    /// \brief a pair of geoms found by the broadphase
+    struct CollisionPair
+    {
+        dGeomID o1, o2;
+        dBodyID b1, b2;
+        KinBody::LinkPtr pkb1, pkb2;
+        int numcontacts; ///< the contacts in _vpaircontacts, set by the collision threads
+    };
+
+    //@{ island threads
+    int _nIslandThreads; ///< the number of threads colliding pairs and stepping islands
+    bool _bGatherCollisionPairs; ///< if true, nearCallback only stores the pairs in _vcollisionpairs
+    std::vector<CollisionPair> _vcollisionpairs; ///< the pairs of the current step in the order the broadphase reported them
+    std::vector<dContact> _vpaircontacts; ///< s_nMaxPairContacts contacts for every pair of _vcollisionpairs
+    std::vector< boost::shared_ptr<boost::thread> > _vcollisionthreads;
+    boost::mutex _mutexcollision; ///< protects the collision job state below
+    boost::condition _condcollisionwork, _condcollisiondone;
+    uint64_t _ncollisionjob; ///< incremented for every batch of pairs given to the threads
+    size_t _nextcollisionpair; ///< the first pair not taken by a thread
+    size_t _numbusycollisionthreads;
+    bool _bStopCollisionThreads;
+#ifdef ODE_HAVE_THREADING_IMPLEMENTATION
+    dThreadingImplementationID _odethreading;
+    dThreadingThreadPoolID _odethreadpool;
+#endif
+    //@}
 };
 
 #endif
@@ -73,6 +73,55 @@ public:
     };
 
 public:
+    /// \brief ODE trimesh data of a mesh shared by the geometries of all the spaces of the process with the same mesh, see _GetSharedTriMeshData
+    ///
+    /// The data is never modified after it is built and temporal coherence is not enabled, so any number of geometries can use it.
+    class SharedTriMeshData
+    {
+public:
+        SharedTriMeshData(const OpenRAVE::TriMesh& mesh) : id(NULL)
+        {
+            indices.resize(mesh.indices.size());
+            for(size_t i = 0; i < mesh.indices.size(); ++i) {
+                indices[i] = mesh.indices[i];
+            }
+            vertices.resize(4*mesh.vertices.size());
+            for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+                vertices[4*i+0] = mesh.vertices[i].x; vertices[4*i+1] = mesh.vertices[i].y; vertices[4*i+2] = mesh.vertices[i].z; vertices[4*i+3] = 0;
+            }
+            id = dGeomTriMeshDataCreate();
+            dGeomTriMeshDataBuildSimple(id, &vertices[0], mesh.vertices.size(), &indices[0], indices.size());
+        }
+        virtual ~SharedTriMeshData() {
+            if( !!id ) {
+                dGeomTriMeshDataDestroy(id);
+            }
+        }
+
+        bool IsSame(const OpenRAVE::TriMesh& mesh) const
+        {
+            if( indices.size() != mesh.indices.size() || vertices.size() != 4*mesh.vertices.size() ) {
+                return false;
+            }
+            for(size_t i = 0; i < mesh.indices.size(); ++i) {
+                if( indices[i] != (dTriIndex)mesh.indices[i] ) {
+                    return false;
+                }
+            }
+            for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+                if( vertices[4*i+0] != (dReal)mesh.vertices[i].x || vertices[4*i+1] != (dReal)mesh.vertices[i].y || vertices[4*i+2] != (dReal)mesh.vertices[i].z ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<dReal> vertices; ///< 4 values per vertex as ODE expects
+        std::vector<dTriIndex> indices;
+        dTriMeshDataID id;
+    };
+    typedef boost::shared_ptr<SharedTriMeshData> SharedTriMeshDataPtr;
+
     // information about the kinematics of the body
     class KinBodyInfo : public boost::enable_shared_from_this<KinBodyInfo>, public OpenRAVE::UserData
     {
@@ -82,7 +131,7 @@ public:
             LINK() : body(NULL), geom(NULL), _bEnabled(true) {
             }
             virtual ~LINK() {
-                BOOST_ASSERT(listtrimeshinds.size()==0&&listvertices.size()==0&&body==NULL&&geom==NULL);
+                BOOST_ASSERT(listtrimeshdata.size()==0&&body==NULL&&geom==NULL);
             }
 
             dBodyID body;
@@ -127,8 +176,7 @@ public:
                 return _plink.lock();
             }
 
-            list<dTriIndex*> listtrimeshinds;
-            list<dReal*> listvertices;
+            list<SharedTriMeshDataPtr> listtrimeshdata; ///< the trimesh data used by the geometries of the link
             KinBody::LinkWeakPtr _plink;
             bool _bEnabled;
             Transform tlinkmass, tlinkmassinv; // the local mass frame ODE was initialized with
@@ -158,19 +206,6 @@ public:
                 dGeomID curgeom = (*itlink)->geom;
                 while(curgeom) {
                     dGeomID pnextgeom = dBodyGetNextGeom(curgeom);
-                    if( dGeomGetClass(curgeom) == dGeomTransformClass ) {
-                        dGeomID childgeom = dGeomTransformGetGeom(curgeom);
-                        if(( childgeom != NULL) &&( dGeomGetClass(childgeom) == dTriMeshClass) ) {
-                            if( dGeomTriMeshGetData(childgeom) != 0 ) {
-                                dGeomTriMeshDataDestroy(dGeomTriMeshGetData(childgeom));
-                            }
-                        }
-                    }
-                    else if( dGeomGetClass(curgeom) == dTriMeshClass ) {
-                        if( dGeomTriMeshGetData(curgeom) != 0 ) {
-                            dGeomTriMeshDataDestroy(dGeomTriMeshGetData(curgeom));
-                        }
-                    }
                     dGeomDestroy(curgeom);
                     curgeom = pnextgeom;
                 }
@@ -179,14 +214,8 @@ public:
                     dBodyDestroy((*itlink)->body);
                     (*itlink)->body = NULL;
                 }
-                FOREACH(itind, (*itlink)->listtrimeshinds) {
-                    delete[] *itind;
-                }
-                (*itlink)->listtrimeshinds.clear();
-                FOREACH(itind, (*itlink)->listvertices) {
-                    delete[] *itind;
-                }
-                (*itlink)->listvertices.clear();
+                // the trimesh data is shared with other spaces, so only release it after the geometries using it are destroyed
+                (*itlink)->listtrimeshdata.clear();
                 (*itlink)->_bEnabled = false;
             }
             vlinks.resize(0);
@@ -625,6 +654,84 @@ private:
     }
 
 private:
+    static boost::mutex& _GetSharedTriMeshDataMutex()
+    {
+        static boost::mutex mutex;
+        return mutex;
+    }
+
+    /// \brief maps the hash of the mesh data to the trimesh data with that hash
+    static std::multimap<size_t, boost::weak_ptr<SharedTriMeshData> >& _GetSharedTriMeshDatas()
+    {
+        static std::multimap<size_t, boost::weak_ptr<SharedTriMeshData> > mapdatas;
+        return mapdatas;
+    }
+
+    /// \brief returns the trimesh data of the mesh shared with every other geometry of the process that has the same mesh.
+    ///
+    /// Bodies with the same parts and cloned environments then store the vertices and build the OPCODE tree of every distinct mesh only once.
+    static SharedTriMeshDataPtr _GetSharedTriMeshData(const OpenRAVE::TriMesh& mesh)
+    {
+        size_t hash = 0;
+        boost::hash_combine(hash, mesh.vertices.size());
+        boost::hash_combine(hash, mesh.indices.size());
+        FOREACHC(itvertex, mesh.vertices) {
+            boost::hash_combine(hash, itvertex->x);
+            boost::hash_combine(hash, itvertex->y);
+            boost::hash_combine(hash, itvertex->z);
+        }
+        FOREACHC(itindex, mesh.indices) {
+            boost::hash_combine(hash, *itindex);
+        }
+
+        typedef std::multimap<size_t, boost::weak_ptr<SharedTriMeshData> >::iterator SharedTriMeshDataIterator;
+        {
+            boost::mutex::scoped_lock lock(_GetSharedTriMeshDataMutex());
+            std::pair<SharedTriMeshDataIterator, SharedTriMeshDataIterator> itrange = _GetSharedTriMeshDatas().equal_range(hash);
+            for(SharedTriMeshDataIterator it = itrange.first; it != itrange.second; ++it) {
+                SharedTriMeshDataPtr pdata = it->second.lock();
+                if( !!pdata && pdata->IsSame(mesh) ) {
+                    return pdata;
+                }
+            }
+        }
+
+        // build outside of the lock since it is the expensive part
+        SharedTriMeshDataPtr pnewdata(new SharedTriMeshData(mesh));
+
+        boost::mutex::scoped_lock lock(_GetSharedTriMeshDataMutex());
+        std::multimap<size_t, boost::weak_ptr<SharedTriMeshData> >& mapdatas = _GetSharedTriMeshDatas();
+        std::pair<SharedTriMeshDataIterator, SharedTriMeshDataIterator> itrange = mapdatas.equal_range(hash);
+        for(SharedTriMeshDataIterator it = itrange.first; it != itrange.second; ) {
+            SharedTriMeshDataPtr pdata = it->second.lock();
+            if( !pdata ) {
+                mapdatas.erase(it++);
+                continue;
+            }
+            if( pdata->IsSame(mesh) ) {
+                // another thread built the same mesh in the meantime
+                return pdata;
+            }
+            ++it;
+        }
+
+        // remove the data nobody uses anymore every time the map doubles
+        static size_t s_nextsweepsize = 64;
+        if( mapdatas.size() >= s_nextsweepsize ) {
+            for(SharedTriMeshDataIterator it = mapdatas.begin(); it != mapdatas.end(); ) {
+                if( it->second.expired() ) {
+                    mapdatas.erase(it++);
+                }
+                else {
+                    ++it;
+                }
+            }
+            s_nextsweepsize = std::max((size_t)64, 2*mapdatas.size());
+        }
+        mapdatas.insert(std::make_pair(hash, boost::weak_ptr<SharedTriMeshData>(pnewdata)));
+        return pnewdata;
+    }
+
     dGeomID _CreateODEGeomFromGeometryInfo(dSpaceID space, boost::shared_ptr<KinBodyInfo::LINK> link, const KinBody::GeometryInfo& info)
     {
         dGeomID odegeom = NULL;
@@ -642,22 +749,12 @@ private:
             break;
         case OpenRAVE::GT_Container:
         case OpenRAVE::GT_Cage:
+        case OpenRAVE::GT_Voxels:
         case OpenRAVE::GT_TriMesh:
             if( info._meshcollision.indices.size() > 0 ) {
-                dTriIndex* pindices = new dTriIndex[info._meshcollision.indices.size()];
-                for(size_t i = 0; i < info._meshcollision.indices.size(); ++i) {
-                    pindices[i] = info._meshcollision.indices[i];
-                }
-                dReal* pvertices = new dReal[4*info._meshcollision.vertices.size()];
-                for(size_t i = 0; i < info._meshcollision.vertices.size(); ++i) {
-                    Vector v = info._meshcollision.vertices[i];
-                    pvertices[4*i+0] = v.x; pvertices[4*i+1] = v.y; pvertices[4*i+2] = v.z;
-                }
-                dTriMeshDataID id = dGeomTriMeshDataCreate();
-                dGeomTriMeshDataBuildSimple(id, pvertices, info._meshcollision.vertices.size(), pindices, info._meshcollision.indices.size());
-                odegeom = dCreateTriMesh(0, id, NULL, NULL, NULL);
-                link->listtrimeshinds.push_back(pindices);
-                link->listvertices.push_back(pvertices);
+                SharedTriMeshDataPtr ptrimeshdata = _GetSharedTriMeshData(info._meshcollision);
+                odegeom = dCreateTriMesh(0, ptrimeshdata->id, NULL, NULL, NULL);
+                link->listtrimeshdata.push_back(ptrimeshdata);
             }
             break;
         default:
@@ -58,6 +58,8 @@
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/condition.hpp>
 
 #define _(msgid) OpenRAVE::RaveGetLocalizedTextForDomain("openrave_plugins_oderave", msgid)
 
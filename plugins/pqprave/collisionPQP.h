@@ -19,6 +19,8 @@
 
 #include "pqp/PQP.h"
 #include <boost/lexical_cast.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
 
 //wrapper class for PQP, distance and tolerance checking is _off_ by default, collision checking is _on_ by default
 class CollisionCheckerPQP : public CollisionCheckerBase
@@ -27,16 +29,22 @@ public:
     class KinBodyInfo : public OpenRAVE::UserData
     {
 public:
-        KinBodyInfo() : nLastStamp(0) {
+        KinBodyInfo() : nLastStamp(0), _bGeometryChanged(false) {
         }
         virtual ~KinBodyInfo() {
         }
         KinBodyPtr GetBody() const {
             return _pbody.lock();
         }
+        void _GeometryChangedCallback() {
+            _bGeometryChanged = true;
+        }
         KinBodyWeakPtr _pbody;
         vector<boost::shared_ptr<PQP_Model> > vlinks;
+        vector<AABB> vlinkaabbs; ///< the AABB of the collision mesh of every link in the link frame
         int nLastStamp;
+        UserDataPtr _geometrycallback;
+        bool _bGeometryChanged; ///< if true, the geometry of the links changed and the models have to be updated
     };
     typedef boost::shared_ptr<KinBodyInfo> KinBodyInfoPtr;
     typedef boost::shared_ptr<KinBodyInfo const> KinBodyInfoConstPtr;
@@ -90,32 +98,38 @@ public:
     {
         KinBodyInfoPtr pinfo = boost::dynamic_pointer_cast<KinBodyInfo>(pbody->GetUserData(_userdatakey));
         // need the pbody check since kinbodies can be cloned and could have the wrong pointer
-        if( !!pinfo && pinfo->GetBody() == pbody ) {
+        if( !!pinfo && pinfo->GetBody() == pbody && !pinfo->_bGeometryChanged && pinfo->vlinks.size() == pbody->GetLinks().size() ) {
             return true;
         }
 
-        pinfo.reset(new KinBodyInfo());
-
-        pinfo->_pbody = boost::const_pointer_cast<KinBody>(pbody);
-        pbody->SetUserData(_userdatakey, pinfo);
-
-        PQP_REAL p1[3], p2[3], p3[3];
+        if( !pinfo || pinfo->GetBody() != pbody ) {
+            pinfo.reset(new KinBodyInfo());
+            pinfo->_pbody = boost::const_pointer_cast<KinBody>(pbody);
+            pinfo->_geometrycallback = pbody->RegisterChangeCallback(KinBody::Prop_LinkGeometry, boost::bind(&KinBodyInfo::_GeometryChangedCallback, pinfo.get()));
+            pbody->SetUserData(_userdatakey, pinfo);
+        }
+        pinfo->_bGeometryChanged = false;
+        pinfo->vlinks.resize(0);
+        pinfo->vlinkaabbs.resize(0);
         pinfo->vlinks.reserve(pbody->GetLinks().size());
+        pinfo->vlinkaabbs.reserve(pbody->GetLinks().size());
         FOREACHC(itlink, pbody->GetLinks()) {
             const TriMesh& trimesh = (*itlink)->GetCollisionData();
+            AABB ab;
             boost::shared_ptr<PQP_Model> pm;
             if( trimesh.indices.size() > 0 ) {
-                pm.reset(new PQP_Model());
-                pm->BeginModel(trimesh.indices.size()/3);
-                for(int j = 0; j < (int)trimesh.indices.size(); j+=3) {
-                    p1[0] = trimesh.vertices[trimesh.indices[j]].x;     p1[1] = trimesh.vertices[trimesh.indices[j]].y;     p1[2] = trimesh.vertices[trimesh.indices[j]].z;
-                    p2[0] = trimesh.vertices[trimesh.indices[j+1]].x;   p2[1] = trimesh.vertices[trimesh.indices[j+1]].y;     p2[2] = trimesh.vertices[trimesh.indices[j+1]].z;
-                    p3[0] = trimesh.vertices[trimesh.indices[j+2]].x;   p3[1] = trimesh.vertices[trimesh.indices[j+2]].y;     p3[2] = trimesh.vertices[trimesh.indices[j+2]].z;
-                    pm->AddTri(p1, p2, p3, j/3);
+                pm = _GetSharedModel(trimesh);
+                Vector vmin = trimesh.vertices.at(trimesh.indices[0]), vmax = vmin;
+                FOREACHC(itindex, trimesh.indices) {
+                    const Vector& v = trimesh.vertices[*itindex];
+                    vmin.x = min(vmin.x, v.x); vmin.y = min(vmin.y, v.y); vmin.z = min(vmin.z, v.z);
+                    vmax.x = max(vmax.x, v.x); vmax.y = max(vmax.y, v.y); vmax.z = max(vmax.z, v.z);
                 }
-                pm->EndModel();
+                ab.pos = (vmin+vmax)*0.5;
+                ab.extents = (vmax-vmin)*0.5;
             }
             pinfo->vlinks.push_back(pm);
+            pinfo->vlinkaabbs.push_back(ab);
         }
 
         return true;
@@ -252,12 +266,16 @@ public:
         _InitKinBody(plink->GetParent());
 
         std::vector<KinBodyPtr> vecbodies;
-        GetEnv()->GetBodies(vecbodies);
+        if( _benablecol && !_benabledis && !_benabletol ) {
+            // only bodies overlapping the link can collide with it
+            GetEnv()->GetBodiesInAABB(plink->ComputeAABB(), vecbodies);
+        }
+        else {
+            GetEnv()->GetBodies(vecbodies);
+        }
 
         PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
-
-        std::vector<Transform> vtrans1,vtrans2;
-        plink->GetParent()->GetLinkTransformations(vtrans1);
+        GetPQPTransformFromTransform(plink->GetTransform(),R1,T1);
         FOREACH(itbody,vecbodies) {
             if(!!report) {
                 report->numWithinTol = 0;
@@ -271,18 +289,15 @@ public:
                 continue;
             }
             _InitKinBody(pbody2);
-            std::vector<KinBody::LinkPtr> veclinks2 = pbody2->GetLinks();
-            pbody2->GetLinkTransformations(vtrans2);
-            GetPQPTransformFromTransform(vtrans1[plink->GetIndex()],R1,T1);
-
-            for(int j = 0; j < (int)vtrans2.size(); j++) {
+            const std::vector<KinBody::LinkPtr>& veclinks2 = pbody2->GetLinks();
+            for(int j = 0; j < (int)veclinks2.size(); j++) {
                 if(plink == veclinks2[j]) {
                     continue;
                 }
                 if( find(vlinkexcluded.begin(),vlinkexcluded.end(),veclinks2[j]) != vlinkexcluded.end() ) {
                     continue;
                 }
-                GetPQPTransformFromTransform(vtrans2[j],R2,T2);
+                GetPQPTransformFromTransform(veclinks2[j]->GetTransform(),R2,T2);
 
                 retval = DoPQP(plink,R1,T1,veclinks2[j],R2,T2,report);
                 if(!report && _benablecol && !_benabledis && !_benabletol && retval) {
@@ -436,15 +451,17 @@ private:
         bool retval;
 
         std::vector<KinBodyPtr> vecbodies;
-        GetEnv()->GetBodies(vecbodies);
+        if( _benablecol && !_benabledis && !_benabletol ) {
+            GetEnv()->GetBodiesInAABB(pbody1->ComputeAABB(true), vecbodies);
+        }
+        else {
+            GetEnv()->GetBodies(vecbodies);
+        }
 
         PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
-
-        std::vector<Transform> vtrans1,vtrans2;
-        pbody1->GetLinkTransformations(vtrans1);
         _InitKinBody(pbody1);
 
-        std::vector<KinBody::LinkPtr> veclinks1 = pbody1->GetLinks();
+        const std::vector<KinBody::LinkPtr>& veclinks1 = pbody1->GetLinks();
         FOREACH(itbody,vecbodies) {
             if(!!report) {
                 report->numWithinTol = 0;
@@ -459,19 +476,18 @@ private:
             }
 
             _InitKinBody(pbody2);
-            std::vector<KinBody::LinkPtr> veclinks2 = pbody2->GetLinks();
-            pbody2->GetLinkTransformations(vtrans2);
-            for(int i = 0; i < (int)vtrans1.size(); i++) {
+            const std::vector<KinBody::LinkPtr>& veclinks2 = pbody2->GetLinks();
+            for(int i = 0; i < (int)veclinks1.size(); i++) {
                 if(find(vlinkexcluded.begin(),vlinkexcluded.end(),veclinks1[i]) != vlinkexcluded.end()) {
                     continue;
                 }
-                GetPQPTransformFromTransform(vtrans1[i],R1,T1);
+                GetPQPTransformFromTransform(veclinks1[i]->GetTransform(),R1,T1);
 
-                for(int j = 0; j < (int)vtrans2.size(); j++) {
+                for(int j = 0; j < (int)veclinks2.size(); j++) {
                     if(find(vlinkexcluded.begin(),vlinkexcluded.end(),veclinks2[j]) != vlinkexcluded.end()) {
                         continue;
                     }
-                    GetPQPTransformFromTransform(vtrans2[j],R2,T2);
+                    GetPQPTransformFromTransform(veclinks2[j]->GetTransform(),R2,T2);
                     retval = DoPQP(veclinks1[i],R1,T1,veclinks2[j],R2,T2,report);
                     if(!report && _benablecol && !_benabledis && !_benabletol && retval) {
                         return true;
@@ -545,6 +561,94 @@ private:
         return success;
     }
 
+    /// \brief returns the model of the collision mesh, models are shared between all checkers and bodies with the same mesh so cloned bodies and environments do not rebuild them
+    static boost::shared_ptr<PQP_Model> _GetSharedModel(const TriMesh& trimesh)
+    {
+        // meshes are identified by their hash and size
+        size_t hash = 0;
+        FOREACHC(itindex, trimesh.indices) {
+            const Vector& v = trimesh.vertices.at(*itindex);
+            boost::hash_combine(hash, v.x);
+            boost::hash_combine(hash, v.y);
+            boost::hash_combine(hash, v.z);
+        }
+        std::pair<size_t, size_t> key(hash, trimesh.indices.size());
+
+        static boost::mutex s_mutex;
+        static std::map<std::pair<size_t, size_t>, boost::weak_ptr<PQP_Model> > s_mapmodels;
+        {
+            boost::mutex::scoped_lock lock(s_mutex);
+            std::map<std::pair<size_t, size_t>, boost::weak_ptr<PQP_Model> >::iterator it = s_mapmodels.find(key);
+            if( it != s_mapmodels.end() ) {
+                boost::shared_ptr<PQP_Model> pm = it->second.lock();
+                if( !!pm ) {
+                    return pm;
+                }
+            }
+        }
+
+        PQP_REAL p1[3], p2[3], p3[3];
+        boost::shared_ptr<PQP_Model> pm(new PQP_Model());
+        pm->BeginModel(trimesh.indices.size()/3);
+        for(int j = 0; j < (int)trimesh.indices.size(); j+=3) {
+            p1[0] = trimesh.vertices[trimesh.indices[j]].x;     p1[1] = trimesh.vertices[trimesh.indices[j]].y;     p1[2] = trimesh.vertices[trimesh.indices[j]].z;
+            p2[0] = trimesh.vertices[trimesh.indices[j+1]].x;   p2[1] = trimesh.vertices[trimesh.indices[j+1]].y;     p2[2] = trimesh.vertices[trimesh.indices[j+1]].z;
+            p3[0] = trimesh.vertices[trimesh.indices[j+2]].x;   p3[1] = trimesh.vertices[trimesh.indices[j+2]].y;     p3[2] = trimesh.vertices[trimesh.indices[j+2]].z;
+            pm->AddTri(p1, p2, p3, j/3);
+        }
+        pm->EndModel();
+
+        boost::mutex::scoped_lock lock(s_mutex);
+        boost::weak_ptr<PQP_Model>& pweakmodel = s_mapmodels[key];
+        boost::shared_ptr<PQP_Model> pexisting = pweakmodel.lock();
+        if( !!pexisting ) {
+            // another thread built the same model
+            return pexisting;
+        }
+        pweakmodel = pm;
+        // remove the models that are not used anymore
+        std::map<std::pair<size_t, size_t>, boost::weak_ptr<PQP_Model> >::iterator it = s_mapmodels.begin();
+        while( it != s_mapmodels.end() ) {
+            if( it->second.expired() ) {
+                s_mapmodels.erase(it++);
+            }
+            else {
+                ++it;
+            }
+        }
+        return pm;
+    }
+
+    /// \brief returns true if the AABBs of the two links are far enough apart that none of the enabled queries can be affected by the pair
+    ///
+    /// \param ab1 the AABB of the first link in its link frame
+    /// \param ab2 the AABB of the second link in its link frame
+    bool _IsPairCulled(const AABB& ab1, PQP_REAL R1[3][3], PQP_REAL T1[3], const AABB& ab2, PQP_REAL R2[3][3], PQP_REAL T2[3], CollisionReportPtr report) const
+    {
+        dReal threshold = 0;
+        if( _benabletol ) {
+            threshold = max(threshold, (dReal)_tolerance);
+        }
+        if( _benabledis ) {
+            if( !report ) {
+                return false;
+            }
+            threshold = max(threshold, report->minDistance);
+        }
+        dReal distsqr = 0;
+        for(int i = 0; i < 3; ++i) {
+            dReal c1 = R1[i][0]*ab1.pos.x + R1[i][1]*ab1.pos.y + R1[i][2]*ab1.pos.z + T1[i];
+            dReal e1 = RaveFabs(R1[i][0])*ab1.extents.x + RaveFabs(R1[i][1])*ab1.extents.y + RaveFabs(R1[i][2])*ab1.extents.z;
+            dReal c2 = R2[i][0]*ab2.pos.x + R2[i][1]*ab2.pos.y + R2[i][2]*ab2.pos.z + T2[i];
+            dReal e2 = RaveFabs(R2[i][0])*ab2.extents.x + RaveFabs(R2[i][1])*ab2.extents.y + RaveFabs(R2[i][2])*ab2.extents.z;
+            dReal gap = RaveFabs(c1-c2) - e1 - e2;
+            if( gap > 0 ) {
+                distsqr += gap*gap;
+            }
+        }
+        return distsqr > threshold*threshold;
+    }
+
     Vector PQPRealToVector(const Vector& in, const PQP_REAL R[3][3], const PQP_REAL T[3])
     {
         return Vector(in.x*R[0][0]+in.y*R[0][1]+in.z*R[0][2]+T[0], in.x*R[1][0]+in.y*R[1][1]+in.z*R[1][2]+T[1], in.x*R[2][0]+in.y*R[2][1]+in.z*R[2][2]+T[2]);
@@ -558,12 +662,18 @@ private:
         if( !_IsActiveLink(link1->GetParent(),link1->GetIndex()) || !_IsActiveLink(link2->GetParent(),link2->GetIndex()) ) {
             return false;
         }
-        boost::shared_ptr<PQP_Model> m1 = GetLinkModel(link1);
-        boost::shared_ptr<PQP_Model> m2 = GetLinkModel(link2);
+        KinBodyInfoPtr pinfo1 = boost::dynamic_pointer_cast<KinBodyInfo>(link1->GetParent()->GetUserData(_userdatakey));
+        KinBodyInfoPtr pinfo2 = boost::dynamic_pointer_cast<KinBodyInfo>(link2->GetParent()->GetUserData(_userdatakey));
+        BOOST_ASSERT(pinfo1->GetBody() == link1->GetParent() && pinfo2->GetBody() == link2->GetParent());
+        const boost::shared_ptr<PQP_Model>& m1 = pinfo1->vlinks.at(link1->GetIndex());
+        const boost::shared_ptr<PQP_Model>& m2 = pinfo2->vlinks.at(link2->GetIndex());
         bool bcollision = false;
         if( !m1 || !m2 ) {
             return false;
         }
+        if( _IsPairCulled(pinfo1->vlinkaabbs[link1->GetIndex()],R1,T1,pinfo2->vlinkaabbs[link2->GetIndex()],R2,T2,report) ) {
+            return false;
+        }
         // collision
         if(_benablecol) {
             if( GetEnv()->HasRegisteredCollisionCallbacks() && !report ) {
@@ -572,9 +682,9 @@ private:
             }
 
             if(!report) {
-                PQP_CollideResult _colres;
-                PQP_Collide(&_colres,R1,T1,m1.get(),R2,T2,m2.get());
-                if(_colres.NumPairs() > 0) {
+                // only need to know if there is a contact, reuse the result so its pair buffer is not reallocated
+                PQP_Collide(&colres,R1,T1,m1.get(),R2,T2,m2.get(),PQP_FIRST_CONTACT);
+                if(colres.NumPairs() > 0) {
                     bcollision = true;
                 }
             }
@@ -670,7 +780,7 @@ private:
     PQP_REAL _rel_err;
     PQP_REAL _abs_err;
 
-    // collision
+    // collision, the results are kept so their buffers are reused between queries
     bool _benablecol;
     PQP_CollideResult colres;
 
@@ -261,6 +261,7 @@ void KinBodyItem::Load()
                     break;
                 }
                 case GT_Cage:
+                case GT_Voxels:
                 case GT_Container:
                 case GT_TriMesh: {
                     // actually don't set to dual-sided rendering since flipped triangles can cause problems with collision and user should know about it
@@ -881,7 +881,7 @@ GraphHandlePtr QtCoinViewer::plot3(const float* ppoints, int numPoints, int stri
     SoSwitch* handle = _createhandle();
     EnvMessagePtr pmsg(new DrawMessage(shared_viewer(), handle, ppoints, numPoints, stride, fPointSize, color, drawstyle ? DrawMessage::DT_Sphere : DrawMessage::DT_Point));
     pmsg->callerexecute(false);
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, drawstyle ? 0 : 1)); // spheres are separate nodes that cannot be updated
 }
 
 GraphHandlePtr QtCoinViewer::plot3(const float* ppoints, int numPoints, int stride, float fPointSize, const float* colors, int drawstyle, bool bhasalpha)
@@ -889,7 +889,7 @@ GraphHandlePtr QtCoinViewer::plot3(const float* ppoints, int numPoints, int stri
     SoSwitch* handle = _createhandle();
     EnvMessagePtr pmsg(new DrawMessage(shared_viewer(), handle, ppoints, numPoints, stride, fPointSize, colors, drawstyle ? DrawMessage::DT_Sphere : DrawMessage::DT_Point, bhasalpha));
     pmsg->callerexecute(false);
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, drawstyle ? 0 : numPoints));
 }
 
 GraphHandlePtr QtCoinViewer::drawlinestrip(const float* ppoints, int numPoints, int stride, float fwidth, const RaveVector<float>& color)
@@ -1199,6 +1199,45 @@ void QtCoinViewer::SetGraphShow(SoSwitch* handle, bool bshow)
     pmsg->callerexecute(false);
 }
 
+class SetGraphPointsMessage : public QtCoinViewer::EnvMessage
+{
+public:
+    SetGraphPointsMessage(QtCoinViewerPtr pviewer, void** ppreturn, SoSwitch* handle, const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha)
+        : EnvMessage(pviewer, ppreturn, false), _handle(handle), _bhasalpha(bhasalpha) {
+        _vpoints.resize(3*numPoints);
+        for(int i = 0; i < numPoints; ++i) {
+            _vpoints[3*i+0] = ppoints[0];
+            _vpoints[3*i+1] = ppoints[1];
+            _vpoints[3*i+2] = ppoints[2];
+            ppoints = (float*)((char*)ppoints + stride);
+        }
+        if( colors != NULL ) {
+            _vcolors.resize((_bhasalpha ? 4 : 3)*numPoints);
+            memcpy(&_vcolors[0], colors, sizeof(float)*_vcolors.size());
+        }
+    }
+
+    virtual void viewerexecute() {
+        QtCoinViewerPtr pviewer = _pviewer.lock();
+        if( !pviewer ) {
+            return;
+        }
+        pviewer->_SetGraphPoints(_handle,_vpoints,_vcolors,_bhasalpha);
+        EnvMessage::viewerexecute();
+    }
+
+private:
+    SoSwitch* _handle;
+    vector<float> _vpoints, _vcolors;
+    bool _bhasalpha;
+};
+
+void QtCoinViewer::SetGraphPoints(SoSwitch* handle, const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha)
+{
+    EnvMessagePtr pmsg(new SetGraphPointsMessage(shared_viewer(), (void**)NULL, handle, ppoints, numPoints, stride, colors, bhasalpha));
+    pmsg->callerexecute(false);
+}
+
 class DeselectMessage : public QtCoinViewer::EnvMessage
 {
 public:
@@ -1365,6 +1404,48 @@ void QtCoinViewer::_SetGraphShow(SoSwitch* handle, bool bshow)
     }
 }
 
+void QtCoinViewer::_SetGraphPoints(SoSwitch* handle, const std::vector<float>& vpoints, const std::vector<float>& vcolors, bool bhasalpha)
+{
+    if((handle == NULL)||(handle->getNumChildren() == 0)||(vpoints.size() == 0)) {
+        return;
+    }
+    SoNode* pparent = handle->getChild(0);
+    if((pparent == NULL)||(pparent->getTypeId() != SoSeparator::getClassTypeId())) {
+        return;
+    }
+    int numPoints = (int)vpoints.size()/3;
+    SoSeparator* psep = (SoSeparator*)pparent;
+    for(int ichild = 0; ichild < psep->getNumChildren(); ++ichild) {
+        SoNode* pchild = psep->getChild(ichild);
+        if( pchild->getTypeId() == SoCoordinate3::getClassTypeId() ) {
+            // SoPointSet draws all the coordinates, so changing their number is enough
+            SoCoordinate3* vprop = (SoCoordinate3*)pchild;
+            vprop->point.setNum(numPoints);
+            vprop->point.setValues(0,numPoints,(float(*)[3])&vpoints[0]);
+        }
+        else if( vcolors.size() > 0 && pchild->getTypeId() == SoMaterial::getClassTypeId() ) {
+            SoMaterial* mtrl = (SoMaterial*)pchild;
+            if( bhasalpha ) {
+                vector<float> colorsonly(numPoints*3),alphaonly(numPoints);
+                for(int i = 0; i < numPoints; ++i) {
+                    colorsonly[3*i+0] = vcolors[4*i+0];
+                    colorsonly[3*i+1] = vcolors[4*i+1];
+                    colorsonly[3*i+2] = vcolors[4*i+2];
+                    alphaonly[i] = 1-vcolors[4*i+3];
+                }
+                mtrl->diffuseColor.setNum(numPoints);
+                mtrl->diffuseColor.setValues(0, numPoints, (float(*)[3])&colorsonly[0]);
+                mtrl->transparency.setNum(numPoints);
+                mtrl->transparency.setValues(0,numPoints,(float*)&alphaonly[0]);
+            }
+            else {
+                mtrl->diffuseColor.setNum(numPoints);
+                mtrl->diffuseColor.setValues(0, numPoints, (float(*)[3])&vcolors[0]);
+            }
+        }
+    }
+}
+
 void QtCoinViewer::PrintCamera()
 {
     _UpdateCameraTransform(0);
@@ -245,7 +245,7 @@ protected:
     class PrivateGraphHandle : public GraphHandle
     {
 public:
-        PrivateGraphHandle(boost::weak_ptr<QtCoinViewer> wviewer, SoSwitch* handle) : _handle(handle), _wviewer(wviewer) {
+        PrivateGraphHandle(boost::weak_ptr<QtCoinViewer> wviewer, SoSwitch* handle, int numpoints=0, int numcolors=0) : _handle(handle), _wviewer(wviewer), _numpoints(numpoints), _numcolors(numcolors) {
             BOOST_ASSERT(_handle!=NULL);
         }
         virtual ~PrivateGraphHandle() {
@@ -271,8 +271,31 @@ public:
             }
         }
 
+        virtual bool SetPoints(const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha)
+        {
+            // a plot with one color has no per vertex material binding to update
+            if( _numcolors == 0 || numPoints <= 0 || (!!colors && _numcolors == 1) ) {
+                return false;
+            }
+            if( !colors && _numcolors > 1 && numPoints != _numpoints ) {
+                return false;
+            }
+            boost::shared_ptr<QtCoinViewer> viewer = _wviewer.lock();
+            if( !viewer ) {
+                return false;
+            }
+            viewer->SetGraphPoints(_handle, ppoints, numPoints, stride, colors, bhasalpha);
+            _numpoints = numPoints;
+            if( !!colors ) {
+                _numcolors = numPoints;
+            }
+            return true;
+        }
+
         SoSwitch* _handle;
         boost::weak_ptr<QtCoinViewer> _wviewer;
+        int _numpoints; ///< number of points currently drawn by the plot
+        int _numcolors; ///< 1 if the plot has one color, the number of points if it has a color per point, 0 if its points cannot be updated
     };
 
     inline QtCoinViewerPtr shared_viewer() {
@@ -300,6 +323,7 @@ public:
     virtual void closegraph(SoSwitch* handle);
     virtual void SetGraphTransform(SoSwitch* handle, const RaveTransform<float>& t);
     virtual void SetGraphShow(SoSwitch* handle, bool bshow);
+    virtual void SetGraphPoints(SoSwitch* handle, const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha);
 
     virtual SoSwitch* _createhandle();
     virtual void* _plot3(SoSwitch* handle, const float* ppoints, int numPoints, int stride, float fPointSize, const RaveVector<float>& color);
@@ -331,6 +355,8 @@ public:
     virtual void _closegraph(SoSwitch* handle);
     virtual void _SetGraphTransform(SoSwitch* handle, const RaveTransform<float>& t);
     virtual void _SetGraphShow(SoSwitch* handle, bool bshow);
+    /// \brief replaces the coordinates and colors of a point plot created by _plot3, vcolors can be empty to keep the current colors
+    virtual void _SetGraphPoints(SoSwitch* handle, const std::vector<float>& vpoints, const std::vector<float>& vcolors, bool bhasalpha);
 
     virtual void _StartPlaybackTimer();
     virtual void _StopPlaybackTimer();
@@ -517,6 +543,7 @@ public:
     friend class StopPlaybackTimerMessage;
     friend class SetGraphTransformMessage;
     friend class SetGraphShowMessage;
+    friend class SetGraphPointsMessage;
     friend class SetNearPlaneMessage;
     friend class ViewerShowMessage;
 
@@ -0,0 +1,351 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// OpenRAVE Qt/OpenSceneGraph Viewer is licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "osgoffscreenrenderer.h"
+
+#include <osg/BufferObject>
+#include <osg/GLExtensions>
+#include <cstring>
+
+namespace qtosgrave {
+
+/// \brief called by a camera right after it is drawn
+class OffscreenCameraRenderer::ReadPixelsCallback : public osg::Camera::DrawCallback
+{
+public:
+    ReadPixelsCallback(OffscreenCameraRenderer* prenderer, CameraSlot* pslot) : _prenderer(prenderer), _pslot(pslot) {
+    }
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        _prenderer->_ReadPixels(*_pslot, renderInfo);
+    }
+
+protected:
+    OffscreenCameraRenderer* _prenderer;
+    CameraSlot* _pslot; ///< owned by _prenderer, raw pointer since the slot holds the camera holding this callback
+};
+
+/// \brief called by the master camera once all the pre render cameras are drawn
+class OffscreenCameraRenderer::MapPixelsCallback : public osg::Camera::DrawCallback
+{
+public:
+    MapPixelsCallback(OffscreenCameraRenderer* prenderer) : _prenderer(prenderer) {
+    }
+
+    virtual void operator()(osg::RenderInfo& renderInfo) const
+    {
+        _prenderer->_MapPixels(renderInfo);
+    }
+
+protected:
+    OffscreenCameraRenderer* _prenderer;
+};
+
+OffscreenCameraRenderer::OffscreenCameraRenderer() : _numactiveslots(0), _pbufferwidth(0), _pbufferheight(0), _bfailedcontext(false)
+{
+}
+
+OffscreenCameraRenderer::~OffscreenCameraRenderer()
+{
+    _DestroyContext();
+}
+
+bool OffscreenCameraRenderer::Render(osg::ref_ptr<osg::Node> pscene, const osg::Vec4& clearcolor, const std::vector<CameraRequest*>& vrequests)
+{
+    int maxwidth = 0, maxheight = 0;
+    FOREACHC(itrequest, vrequests) {
+        (*itrequest)->bsuccess = false;
+        maxwidth = max(maxwidth, (*itrequest)->width);
+        maxheight = max(maxheight, (*itrequest)->height);
+    }
+    if( vrequests.size() == 0 || maxwidth <= 0 || maxheight <= 0 ) {
+        return vrequests.size() == 0;
+    }
+    if( !_InitContext(maxwidth, maxheight) ) {
+        return false;
+    }
+
+    // the camera is looking along +z with +y down, osg cameras look along -z with +y up
+    RaveTransform<float> tflip;
+    tflip.rot = quatFromAxisAngle(RaveVector<float>(1,0,0),(float)PI);
+
+    _osgroot->removeChildren(0, _osgroot->getNumChildren());
+    _numactiveslots = 0;
+    FOREACHC(itrequest, vrequests) {
+        CameraRequest& request = **itrequest;
+        if( request.width <= 0 || request.height <= 0 || request.KK.fx <= 0 || request.KK.fy <= 0 || request.fnear <= 0 || request.ffar <= request.fnear ) {
+            continue;
+        }
+        if( _numactiveslots >= _vslots.size() ) {
+            CameraSlotPtr slot(new CameraSlot());
+            slot->camera = new osg::Camera();
+            slot->camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+            slot->camera->setRenderOrder(osg::Camera::PRE_RENDER, (int)_vslots.size());
+            slot->camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER);
+            slot->camera->setDrawBuffer(GL_FRONT);
+            slot->camera->setReadBuffer(GL_FRONT);
+            slot->camera->setClearMask(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+            slot->camera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+            slot->camera->setFinalDrawCallback(new ReadPixelsCallback(this, slot.get()));
+            _vslots.push_back(slot);
+        }
+        CameraSlot& slot = *_vslots[_numactiveslots++];
+        slot.prequest = &request;
+        slot.bcolorread = slot.bdepthread = false;
+
+        osg::ref_ptr<osg::Camera> camera = slot.camera;
+        camera->removeChildren(0, camera->getNumChildren());
+        camera->addChild(pscene.get());
+        camera->setClearColor(clearcolor);
+        camera->setViewport(0, 0, request.width, request.height);
+        float fnear = request.fnear, ffar = request.ffar;
+        camera->setProjectionMatrixAsFrustum(-request.KK.cx*fnear/request.KK.fx, (request.width-request.KK.cx)*fnear/request.KK.fx,
+                                             -(request.height-request.KK.cy)*fnear/request.KK.fy, request.KK.cy*fnear/request.KK.fy, fnear, ffar);
+        camera->setViewMatrix(osg::Matrix::inverse(GetMatrixFromRaveTransform(request.t*tflip)));
+        _osgroot->addChild(camera.get());
+    }
+
+    _viewer->frame();
+
+    // do not keep the scene alive
+    for(size_t islot = 0; islot < _numactiveslots; ++islot) {
+        _vslots[islot]->camera->removeChildren(0, _vslots[islot]->camera->getNumChildren());
+        _vslots[islot]->prequest = NULL;
+    }
+    _osgroot->removeChildren(0, _osgroot->getNumChildren());
+    _numactiveslots = 0;
+    return true;
+}
+
+bool OffscreenCameraRenderer::_InitContext(int width, int height)
+{
+    if( _bfailedcontext ) {
+        return false;
+    }
+    if( !!_gc && width <= _pbufferwidth && height <= _pbufferheight ) {
+        return true;
+    }
+
+    int pbufferwidth = max(width, _pbufferwidth), pbufferheight = max(height, _pbufferheight);
+    _DestroyContext();
+
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits();
+    traits->readDISPLAY();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = pbufferwidth;
+    traits->height = pbufferheight;
+    traits->red = traits->green = traits->blue = traits->alpha = 8;
+    traits->depth = 24;
+    traits->windowDecoration = false;
+    traits->doubleBuffer = false;
+    traits->pbuffer = true;
+    traits->sharedContext = 0;
+    traits->setUndefinedScreenDetailsToDefaultScreen();
+    _gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if( !_gc || !_gc->valid() ) {
+        RAVELOG_WARN_FORMAT("failed to create a %dx%d pbuffer for offscreen camera rendering", pbufferwidth%pbufferheight);
+        _gc = NULL;
+        _bfailedcontext = true;
+        return false;
+    }
+
+    _viewer = new osgViewer::Viewer();
+    _viewer->setThreadingModel(osgViewer::ViewerBase::SingleThreaded);
+    _viewer->setKeyEventSetsDone(0);
+    _viewer->setQuitEventSetsDone(false);
+    osg::ref_ptr<osg::Camera> mastercamera = _viewer->getCamera();
+    mastercamera->setGraphicsContext(_gc.get());
+    mastercamera->setViewport(0, 0, pbufferwidth, pbufferheight);
+    mastercamera->setDrawBuffer(GL_FRONT);
+    mastercamera->setReadBuffer(GL_FRONT);
+    mastercamera->setClearMask(0);
+    mastercamera->setFinalDrawCallback(new MapPixelsCallback(this));
+    _osgroot = new osg::Group();
+    _viewer->setSceneData(_osgroot.get());
+    _viewer->realize();
+
+    _pbufferwidth = pbufferwidth;
+    _pbufferheight = pbufferheight;
+    RAVELOG_DEBUG_FORMAT("created %dx%d pbuffer for offscreen camera rendering", _pbufferwidth%_pbufferheight);
+    return true;
+}
+
+void OffscreenCameraRenderer::_DestroyContext()
+{
+    if( !!_gc && !!_gc->getState() && _gc->makeCurrent() ) {
+        osg::GLExtensions* ext = _gc->getState()->get<osg::GLExtensions>();
+        if( !!ext && ext->isPBOSupported ) {
+            FOREACH(itslot, _vslots) {
+                if( (*itslot)->pbocolor != 0 ) {
+                    ext->glDeleteBuffers(1, &(*itslot)->pbocolor);
+                }
+                if( (*itslot)->pbodepth != 0 ) {
+                    ext->glDeleteBuffers(1, &(*itslot)->pbodepth);
+                }
+            }
+        }
+        _gc->releaseContext();
+    }
+    _vslots.clear();
+    _numactiveslots = 0;
+    _osgroot = NULL;
+    _viewer = NULL;
+    if( !!_gc ) {
+        _gc->close();
+        _gc = NULL;
+    }
+    _pbufferwidth = _pbufferheight = 0;
+}
+
+void OffscreenCameraRenderer::_ReadPixels(CameraSlot& slot, osg::RenderInfo& renderInfo)
+{
+    CameraRequest* prequest = slot.prequest;
+    if( !prequest ) {
+        return;
+    }
+    const int width = prequest->width, height = prequest->height;
+    osg::GLExtensions* ext = renderInfo.getState()->get<osg::GLExtensions>();
+    const bool busepbo = !!ext && ext->isPBOSupported;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    if( prequest->bcolor ) {
+        size_t size = 3*width*height;
+        if( busepbo ) {
+            if( slot.pbocolor == 0 ) {
+                ext->glGenBuffers(1, &slot.pbocolor);
+            }
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot.pbocolor);
+            if( size > slot.colorsize ) {
+                ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, NULL, GL_STREAM_READ_ARB);
+                slot.colorsize = size;
+            }
+            // returns right away, the transfer finishes while the next cameras are drawn
+            glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+        }
+        else {
+            prequest->vimage.resize(size);
+            glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &prequest->vimage[0]);
+        }
+        slot.bcolorread = true;
+    }
+    if( prequest->bdepth ) {
+        size_t size = sizeof(float)*width*height;
+        if( busepbo ) {
+            if( slot.pbodepth == 0 ) {
+                ext->glGenBuffers(1, &slot.pbodepth);
+            }
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot.pbodepth);
+            if( size > slot.depthsize ) {
+                ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, NULL, GL_STREAM_READ_ARB);
+                slot.depthsize = size;
+            }
+            glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+        }
+        else {
+            prequest->vdepth.resize(width*height);
+            glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, &prequest->vdepth[0]);
+        }
+        slot.bdepthread = true;
+    }
+    if( busepbo ) {
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    }
+}
+
+void OffscreenCameraRenderer::_MapPixels(osg::RenderInfo& renderInfo)
+{
+    osg::GLExtensions* ext = renderInfo.getState()->get<osg::GLExtensions>();
+    const bool busepbo = !!ext && ext->isPBOSupported;
+    std::vector<uint8_t> vrow;
+    for(size_t islot = 0; islot < _numactiveslots; ++islot) {
+        CameraSlot& slot = *_vslots[islot];
+        CameraRequest* prequest = slot.prequest;
+        if( !prequest ) {
+            continue;
+        }
+        const int width = prequest->width, height = prequest->height;
+        bool bsuccess = true;
+        if( prequest->bcolor ) {
+            const size_t rowsize = 3*width;
+            if( !slot.bcolorread ) {
+                bsuccess = false;
+            }
+            else if( busepbo ) {
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot.pbocolor);
+                const uint8_t* psrc = static_cast<const uint8_t*>(ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB));
+                if( !psrc ) {
+                    bsuccess = false;
+                }
+                else {
+                    // opengl images start at the bottom row
+                    prequest->vimage.resize(rowsize*height);
+                    for(int irow = 0; irow < height; ++irow) {
+                        std::memcpy(&prequest->vimage[irow*rowsize], psrc + (height-1-irow)*rowsize, rowsize);
+                    }
+                    ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+                }
+            }
+            else {
+                vrow.resize(rowsize);
+                for(int irow = 0; irow < height/2; ++irow) {
+                    uint8_t* ptop = &prequest->vimage[irow*rowsize];
+                    uint8_t* pbottom = &prequest->vimage[(height-1-irow)*rowsize];
+                    std::memcpy(&vrow[0], ptop, rowsize);
+                    std::memcpy(ptop, pbottom, rowsize);
+                    std::memcpy(pbottom, &vrow[0], rowsize);
+                }
+            }
+        }
+        if( prequest->bdepth ) {
+            const float* psrc = NULL;
+            std::vector<float> vdepthbuffer;
+            if( !slot.bdepthread ) {
+                bsuccess = false;
+            }
+            else if( busepbo ) {
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot.pbodepth);
+                psrc = static_cast<const float*>(ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB));
+                if( !psrc ) {
+                    bsuccess = false;
+                }
+            }
+            else {
+                vdepthbuffer.swap(prequest->vdepth);
+                psrc = &vdepthbuffer[0];
+            }
+            if( !!psrc ) {
+                // convert the depth buffer values back to distances along the optical axis
+                const float fnear = prequest->fnear, ffar = prequest->ffar;
+                prequest->vdepth.resize(width*height);
+                for(int irow = 0; irow < height; ++irow) {
+                    const float* psrcrow = psrc + (height-1-irow)*width;
+                    float* pdstrow = &prequest->vdepth[irow*width];
+                    for(int icol = 0; icol < width; ++icol) {
+                        float fdepth = psrcrow[icol];
+                        pdstrow[icol] = fdepth >= 1 ? 0 : 2*fnear*ffar/(ffar + fnear - (2*fdepth-1)*(ffar-fnear));
+                    }
+                }
+                if( busepbo ) {
+                    ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+                }
+            }
+        }
+        prequest->bsuccess = bsuccess;
+    }
+    if( busepbo ) {
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    }
+}
+
+}
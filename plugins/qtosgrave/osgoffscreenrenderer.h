@@ -0,0 +1,108 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// OpenRAVE Qt/OpenSceneGraph Viewer is licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef OPENRAVE_QTOSG_OFFSCREENRENDERER_H
+#define OPENRAVE_QTOSG_OFFSCREENRENDERER_H
+
+#include "qtosg.h"
+
+#include <osg/GraphicsContext>
+#include <osgViewer/Viewer>
+
+namespace qtosgrave {
+
+using namespace OpenRAVE;
+
+/// \brief renders camera sensor images of a scene into a pbuffer, so no window has to be shown.
+///
+/// All cameras given to one Render call are drawn in the same frame as pre render cameras that share the pbuffer.
+/// Every camera starts reading its pixels into its own pixel buffer object right after it is drawn, so the
+/// transfers run while the next cameras are drawn, and the buffers are only mapped once all cameras are done.
+/// Depending on how OpenSceneGraph is built, the pbuffer is created with EGL, GLX or WGL.
+class OffscreenCameraRenderer
+{
+public:
+    /// \brief one camera image to render
+    struct CameraRequest
+    {
+        CameraRequest() : width(0), height(0), fnear(0), ffar(0), bcolor(true), bdepth(false), bsuccess(false) {
+        }
+
+        int width, height;
+        RaveTransform<float> t; ///< the camera transform in the world, looking along +z with +y down
+        SensorBase::CameraIntrinsics KK;
+        float fnear, ffar; ///< the clipping planes, the viewer uses its own if they are 0
+        bool bcolor; ///< if true, fills vimage
+        bool bdepth; ///< if true, fills vdepth
+        std::vector<uint8_t> vimage; ///< 24bit RGB and the first row is the top of the image
+        std::vector<float> vdepth; ///< the depth along the optical axis of every pixel with the same layout as vimage, 0 if nothing was hit
+        bool bsuccess; ///< set by Render
+    };
+
+    OffscreenCameraRenderer();
+    virtual ~OffscreenCameraRenderer();
+
+    /// \brief renders all the requests in one frame.
+    ///
+    /// Has to be called by the thread that modifies the scene graph.
+    /// \param pscene the root of the scene to render
+    /// \param clearcolor the background color of the images
+    /// \return true if the frame could be rendered, check bsuccess of every request
+    bool Render(osg::ref_ptr<osg::Node> pscene, const osg::Vec4& clearcolor, const std::vector<CameraRequest*>& vrequests);
+
+protected:
+    /// \brief the camera and pixel buffers reused for one request of a frame
+    struct CameraSlot : public osg::Referenced
+    {
+        CameraSlot() : prequest(NULL), pbocolor(0), pbodepth(0), colorsize(0), depthsize(0), bcolorread(false), bdepthread(false) {
+        }
+
+        osg::ref_ptr<osg::Camera> camera;
+        CameraRequest* prequest; ///< the request of the frame being rendered
+        GLuint pbocolor, pbodepth;
+        size_t colorsize, depthsize; ///< the allocated sizes of pbocolor and pbodepth
+        bool bcolorread, bdepthread; ///< true if the readback into the pixel buffer objects was started in this frame
+    };
+    typedef osg::ref_ptr<CameraSlot> CameraSlotPtr;
+
+    class ReadPixelsCallback;
+    class MapPixelsCallback;
+    friend class ReadPixelsCallback;
+    friend class MapPixelsCallback;
+
+    /// \brief creates the pbuffer and viewer, if the pbuffer is too small, everything is recreated
+    bool _InitContext(int width, int height);
+
+    /// \brief releases the pixel buffer objects and the context
+    void _DestroyContext();
+
+    /// \brief starts reading the pixels of the camera that just finished drawing
+    void _ReadPixels(CameraSlot& slot, osg::RenderInfo& renderInfo);
+
+    /// \brief copies the pixels of all cameras out of their pixel buffer objects
+    void _MapPixels(osg::RenderInfo& renderInfo);
+
+    osg::ref_ptr<osg::GraphicsContext> _gc; ///< the pbuffer context
+    osg::ref_ptr<osgViewer::Viewer> _viewer;
+    osg::ref_ptr<osg::Group> _osgroot; ///< parent of all the cameras of the frame
+    std::vector<CameraSlotPtr> _vslots;
+    size_t _numactiveslots; ///< the first slots used in the current frame
+    int _pbufferwidth, _pbufferheight;
+    bool _bfailedcontext; ///< true if creating the pbuffer failed, so it is not tried again
+};
+
+typedef boost::shared_ptr<OffscreenCameraRenderer> OffscreenCameraRendererPtr;
+
+}
+
+#endif
@@ -19,10 +19,16 @@
 #include "osgrenderitem.h"
 
 #include <osgUtil/SmoothingVisitor>
+#include <osgUtil/Simplifier>
 #include <osg/BlendFunc>
 #include <osg/PolygonOffset>
 #include <osg/LineStipple>
 #include <osg/Depth>
+#include <osg/LOD>
+#include <osg/observer_ptr>
+
+#include <boost/functional/hash.hpp>
+#include <cfloat>
 
 namespace qtosgrave {
 
@@ -98,6 +104,153 @@ OSGGroupPtr CreateOSGXYZAxes(double len, double axisthickness)
 }
 
 
+/// \brief meshes with at least this many triangles get a simplified level of detail
+static const size_t s_nLODMinTriangles = 2000;
+/// \brief the fraction of the triangles kept in the simplified level of detail
+static const float s_fLODSampleRatio = 0.2f;
+/// \brief the simplified level of detail is shown when the eye is further than this many times the radius of the mesh
+static const float s_fLODSwitchDistanceRatio = 20.0f;
+
+/// \brief a mesh node that is shared between all the geometries with the same mesh
+struct SharedMeshNode
+{
+    osg::observer_ptr<osg::Node> pnode; ///< the Geode or LOD that is added under the geometries
+    osg::observer_ptr<osg::Geometry> pgeometry; ///< the full detail geometry of pnode, used to compare the mesh in case of hash collisions
+};
+
+typedef std::multimap<size_t, SharedMeshNode> SharedMeshNodeMap;
+
+static const char s_sharedMeshNodeName[] = "sharedmesh";
+
+bool IsSharedMeshNode(const osg::Node& node)
+{
+    return node.getName() == s_sharedMeshNodeName;
+}
+
+static SharedMeshNodeMap& _GetSharedMeshNodes()
+{
+    static SharedMeshNodeMap s_mapSharedMeshNodes;
+    return s_mapSharedMeshNodes;
+}
+
+static boost::mutex& _GetSharedMeshNodesMutex()
+{
+    static boost::mutex s_mutexSharedMeshNodes;
+    return s_mutexSharedMeshNodes;
+}
+
+static bool _IsSameMesh(const osg::Geometry& geom, const TriMesh& mesh)
+{
+    const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geom.getVertexArray());
+    if( !vertices || vertices->size() != mesh.vertices.size() || geom.getNumPrimitiveSets() == 0 ) {
+        return false;
+    }
+    const osg::DrawElementsUInt* indices = dynamic_cast<const osg::DrawElementsUInt*>(geom.getPrimitiveSet(0));
+    if( !indices || indices->size() != mesh.indices.size() ) {
+        return false;
+    }
+    for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+        const osg::Vec3& v = (*vertices)[i];
+        if( v.x() != (float)mesh.vertices[i].x || v.y() != (float)mesh.vertices[i].y || v.z() != (float)mesh.vertices[i].z ) {
+            return false;
+        }
+    }
+    for(size_t i = 0; i < mesh.indices.size(); ++i) {
+        if( (*indices)[i] != (GLuint)mesh.indices[i] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief returns the osg node rendering the mesh.
+///
+/// Identical meshes of all bodies share the same node, so their vertex buffers are only uploaded and kept once.
+/// Large meshes get an osg::LOD that switches to a simplified mesh when they are far from the eye.
+/// The node does not have any state, the material is set by the parent group of every geometry.
+static OSGNodePtr _GetSharedMeshNode(const TriMesh& mesh)
+{
+    size_t hash = 0;
+    boost::hash_combine(hash, mesh.vertices.size());
+    boost::hash_combine(hash, mesh.indices.size());
+    FOREACHC(itvertex, mesh.vertices) {
+        boost::hash_combine(hash, (float)itvertex->x);
+        boost::hash_combine(hash, (float)itvertex->y);
+        boost::hash_combine(hash, (float)itvertex->z);
+    }
+    FOREACHC(itindex, mesh.indices) {
+        boost::hash_combine(hash, *itindex);
+    }
+
+    boost::mutex::scoped_lock lock(_GetSharedMeshNodesMutex());
+    SharedMeshNodeMap& mapnodes = _GetSharedMeshNodes();
+    std::pair<SharedMeshNodeMap::iterator, SharedMeshNodeMap::iterator> itrange = mapnodes.equal_range(hash);
+    SharedMeshNodeMap::iterator it = itrange.first;
+    while(it != itrange.second) {
+        osg::ref_ptr<osg::Node> pnode;
+        osg::ref_ptr<osg::Geometry> pgeometry;
+        if( !it->second.pnode.lock(pnode) || !it->second.pgeometry.lock(pgeometry) ) {
+            // all the geometries using the node were destroyed
+            mapnodes.erase(it++);
+            continue;
+        }
+        if( _IsSameMesh(*pgeometry, mesh) ) {
+            return pnode;
+        }
+        ++it;
+    }
+
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+    geom->setUseDisplayList(false);
+    geom->setUseVertexBufferObjects(true);
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array();
+    vertices->reserveArray(mesh.vertices.size());
+    for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+        RaveVector<float> v = mesh.vertices[i];
+        vertices->push_back(osg::Vec3(v.x, v.y, v.z));
+    }
+    geom->setVertexArray(vertices.get());
+
+    osg::DrawElementsUInt* geom_prim = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, mesh.indices.size());
+    for(size_t i = 0; i < mesh.indices.size(); ++i) {
+        (*geom_prim)[i] = mesh.indices[i];
+    }
+    geom->addPrimitiveSet(geom_prim);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geom);
+
+    OSGNodePtr pnode = geode;
+    if( mesh.indices.size()/3 >= s_nLODMinTriangles ) {
+        // simplify a copy of the mesh before computing the normals, since the simplifier looks at the vertices only
+        osg::ref_ptr<osg::Geometry> geomlow = new osg::Geometry(*geom, osg::CopyOp::DEEP_COPY_ARRAYS|osg::CopyOp::DEEP_COPY_PRIMITIVES);
+        osgUtil::Simplifier simplifier(s_fLODSampleRatio);
+        simplifier.setSmoothing(false);
+        simplifier.simplify(*geomlow);
+        osgUtil::SmoothingVisitor::smooth(*geomlow);
+        osg::ref_ptr<osg::Geode> geodelow = new osg::Geode;
+        geodelow->addDrawable(geomlow);
+
+        osgUtil::SmoothingVisitor::smooth(*geom); // compute vertex normals
+        float fswitchdistance = s_fLODSwitchDistanceRatio*geode->getBound().radius();
+        osg::ref_ptr<osg::LOD> plod = new osg::LOD;
+        plod->addChild(geode, 0, fswitchdistance);
+        plod->addChild(geodelow, fswitchdistance, FLT_MAX);
+        pnode = plod;
+    }
+    else {
+        osgUtil::SmoothingVisitor::smooth(*geom); // compute vertex normals
+    }
+
+    pnode->setName(s_sharedMeshNodeName);
+    SharedMeshNode sharednode;
+    sharednode.pnode = pnode.get();
+    sharednode.pgeometry = geom.get();
+    mapnodes.insert(std::make_pair(hash, sharednode));
+    return pnode;
+}
+
 // Visitor to return the coordinates of a node with respect to another node
 class WorldCoordOfNodeVisitor : public osg::NodeVisitor
 {
@@ -440,33 +593,11 @@ void KinBodyItem::Load()
                 }
                 //  Extract geometry from collision Mesh
                 case GT_Cage:
+                case GT_Voxels:
                 case GT_Container:
                 case GT_TriMesh: {
-                    // make triangleMesh
-                    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
-
-                    //geom->setColorBinding(osg::Geometry::BIND_OVERALL); // need to call geom->setColorArray first
-
-                    const TriMesh& mesh = orgeom->GetCollisionMesh();
-                    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array();
-                    vertices->reserveArray(mesh.vertices.size());
-                    for(size_t i = 0; i < mesh.vertices.size(); ++i) {
-                        RaveVector<float> v = mesh.vertices[i];
-                        vertices->push_back(osg::Vec3(v.x, v.y, v.z));
-                    }
-                    geom->setVertexArray(vertices.get());
-
-
-                    osg::DrawElementsUInt* geom_prim = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, mesh.indices.size());
-                    for(size_t i = 0; i < mesh.indices.size(); ++i) {
-                        (*geom_prim)[i] = mesh.indices[i];
-                    }
-                    geom->addPrimitiveSet(geom_prim);
-
-                    osgUtil::SmoothingVisitor::smooth(*geom); // compute vertex normals
-                    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-                    geode->addDrawable(geom);
-                    pgeometrydata->addChild(geode);
+                    // make triangleMesh, the material of the geometry is set on pgeometrydata so the mesh node can be shared
+                    pgeometrydata->addChild(_GetSharedMeshNode(orgeom->GetCollisionMesh()));
                     break;
                 }
                 default:
@@ -783,6 +914,18 @@ bool KinBodyItem::UpdateFromModel(const vector<dReal>& vjointvalues, const vecto
     return true;
 }
 
+bool KinBodyItem::UpdateFromPublishedState(KinBody::BodyStateConstPtr pstate)
+{
+    if( pstate == _pLastPublishedState && !_bReload && !_bDrawStateChanged ) {
+        return true;
+    }
+    if( !UpdateFromModel(pstate->jointvalues, pstate->vectrans) ) {
+        return false;
+    }
+    _pLastPublishedState = pstate;
+    return true;
+}
+
 void KinBodyItem::SetGrab(bool bGrab, bool bUpdate)
 {
     if(!_pbody ) {
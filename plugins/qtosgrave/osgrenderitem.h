@@ -30,6 +30,9 @@ enum ViewGeometry {
 /// \brief creates XYZ axes and returns their osg objects
 OSGGroupPtr CreateOSGXYZAxes(double len, double axisthickness);
 
+/// \brief returns true if the node renders a mesh that is shared between the geometries of several items, so its parents belong to different items
+bool IsSharedMeshNode(const osg::Node& node);
+
 /// \brief Encapsulate the Inventor rendering of an Item
 class Item : public boost::enable_shared_from_this<Item>, public OpenRAVE::UserData
 {
@@ -145,6 +148,12 @@ public:
     /// \brief updates from openrave model
     virtual bool UpdateFromModel(const vector<dReal>& vjointvalues, const vector<Transform>& vtrans);
 
+    /// \brief updates from a state published by the environment
+    ///
+    /// Published states of bodies that did not change are shared between snapshots, so if the state is the one applied
+    /// last time and the geometry did not change, the osg nodes are left as they are.
+    virtual bool UpdateFromPublishedState(KinBody::BodyStateConstPtr pstate);
+
     virtual void SetGrab(bool bGrab, bool bUpdate=true);
 
     inline KinBodyPtr GetBody() const {
@@ -210,6 +219,7 @@ protected:
 
     std::vector<dReal> _vjointvalues;
     vector<Transform> _vtrans;
+    KinBody::BodyStateConstPtr _pLastPublishedState; ///< the state last applied by UpdateFromPublishedState
     mutable boost::mutex _mutexjoints;
     UserDataPtr _geometrycallback, _drawcallback;
 
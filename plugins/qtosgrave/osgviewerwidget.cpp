@@ -698,7 +698,14 @@ void QOSGViewerWidget::HandleRayPick(const osgUtil::LineSegmentIntersector::Inte
         }
     }
     else {
+        // mesh nodes are shared between items, so use the node of the item right above the shared mesh
         OSGNodePtr node = intersection.nodePath.back();
+        for(size_t inode = 1; inode < intersection.nodePath.size(); ++inode) {
+            if( IsSharedMeshNode(*intersection.nodePath[inode]) ) {
+                node = intersection.nodePath[inode-1];
+                break;
+            }
+        }
 
         // something hit
         if( buttonPressed ) {
@@ -116,6 +116,11 @@ public:
         return _osgFigureRoot;
     }
 
+    /// \brief the root of everything the view renders including the lights and figures
+    osg::ref_ptr<osg::Node> GetViewSceneData() const {
+        return _osgview->getSceneData();
+    }
+
     /// \brief called when the mouse is over a specified point
     ///
     void HandleRayPick(const osgUtil::LineSegmentIntersector::Intersection &intersection, int buttonPressed, int modkeymask = 0);
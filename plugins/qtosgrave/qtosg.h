@@ -65,6 +65,7 @@
 #include <boost/bind.hpp>
 #include <boost/assert.hpp>
 #include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/version.hpp>
 
 #include <QtCore/QVariant>
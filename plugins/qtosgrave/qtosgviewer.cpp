@@ -17,6 +17,8 @@
 #include <iostream>
 
 #include <osg/ArgumentParser>
+#include <osgDB/FileNameUtils>
+#include <osgDB/WriteFile>
 
 #include "osgviewerwidget.h"
 
@@ -163,15 +165,24 @@ QtOSGViewer::QtOSGViewer(EnvironmentBasePtr penv, std::istream& sinput) : QMainW
                     "sets the viewer projection mode, perspective or orthogonal");
     RegisterCommand("Zoom", boost::bind(&QtOSGViewer::_ZoomCommand, this, _1, _2),
                     "Set the zooming factor of the view");
+    RegisterCommand("GetCameraDepthImage", boost::bind(&QtOSGViewer::_GetCameraDepthImageCommand, this, _1, _2),
+                    "\"width height tx ty tz qw qx qy qz fx fy cx cy\", renders the depth image of a camera offscreen and returns the width*height depths along the optical axis starting from the top row, 0 if nothing was hit");
     _bLockEnvironment = true;
     _InitGUI(bCreateStatusBar, bCreateMenu);
     _bUpdateEnvironment = true;
     _bExternalLoop = false;
+    _bStopPublishBodies = false;
+    _threadPublishBodies.reset(new boost::thread(boost::bind(&QtOSGViewer::_PublishBodiesThread, this)));
 }
 
 QtOSGViewer::~QtOSGViewer()
 {
     RAVELOG_DEBUG("destroying qtosg viewer\n");
+    _bStopPublishBodies = true;
+    if( !!_threadPublishBodies ) {
+        _threadPublishBodies->join();
+        _threadPublishBodies.reset();
+    }
     // _notifyGUIFunctionComplete can still be waiting. Code will crash when
     // the mutex is destroyed in that state. SetEnvironmentSync will release
     // _notifyGUIFunctionComplete
@@ -254,6 +265,7 @@ void QtOSGViewer::_InitGUI(bool bCreateStatusBar, bool bCreateMenu)
     _bAntialiasing = false;
     _viewGeometryMode = VG_RenderOnly;
     _bRenderFiguresInCamera = true;
+    _bRenderingCameraRequests = false;
     _bDisplayFeedBack = true;
 }
 
@@ -1385,12 +1397,129 @@ bool QtOSGViewer::GetFractionOccluded(KinBodyPtr pbody, int width, int height, f
 
 bool QtOSGViewer::GetCameraImage(std::vector<uint8_t>& memory, int width, int height, const RaveTransform<float>& t, const SensorBase::CameraIntrinsics& KK)
 {
-    return false;
+    OffscreenCameraRenderer::CameraRequest request;
+    request.width = width;
+    request.height = height;
+    request.t = t;
+    request.KK = KK;
+    if( !_RenderCameraRequest(request) ) {
+        return false;
+    }
+    memory.swap(request.vimage);
+    return true;
 }
 
 bool QtOSGViewer::WriteCameraImage(int width, int height, const RaveTransform<float>& t, const SensorBase::CameraIntrinsics& KK, const std::string& filename, const std::string& extension)
 {
-    return false;
+    std::vector<uint8_t> memory;
+    if( !GetCameraImage(memory, width, height, t, KK) ) {
+        return false;
+    }
+    // osg images start at the bottom row
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(width, height, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    for(int irow = 0; irow < height; ++irow) {
+        std::copy(memory.begin()+irow*3*width, memory.begin()+(irow+1)*3*width, image->data(0, height-1-irow));
+    }
+    std::string fullfilename = filename;
+    if( extension.size() > 0 && osgDB::getFileExtension(filename).size() == 0 ) {
+        fullfilename += "." + extension;
+    }
+    if( !osgDB::writeImageFile(*image, fullfilename) ) {
+        RAVELOG_WARN_FORMAT("failed to write camera image %s", fullfilename);
+        return false;
+    }
+    return true;
+}
+
+bool QtOSGViewer::_GetCameraDepthImageCommand(ostream& sout, istream& sinput)
+{
+    OffscreenCameraRenderer::CameraRequest request;
+    sinput >> request.width >> request.height >> request.t.trans.x >> request.t.trans.y >> request.t.trans.z >> request.t.rot.x >> request.t.rot.y >> request.t.rot.z >> request.t.rot.w >> request.KK.fx >> request.KK.fy >> request.KK.cx >> request.KK.cy;
+    if( !sinput ) {
+        return false;
+    }
+    request.bcolor = false;
+    request.bdepth = true;
+    if( !_RenderCameraRequest(request) ) {
+        return false;
+    }
+    FOREACHC(itdepth, request.vdepth) {
+        sout << *itdepth << " ";
+    }
+    return true;
+}
+
+bool QtOSGViewer::_RenderCameraRequest(OffscreenCameraRenderer::CameraRequest& request)
+{
+    request.bsuccess = false;
+    if( QThread::currentThread() == QCoreApplication::instance()->thread() ) {
+        {
+            boost::mutex::scoped_lock lock(_mutexCameraRequests);
+            _vPendingCameraRequests.push_back(&request);
+        }
+        _RenderPendingCameraRequests();
+        return request.bsuccess;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(_mutexCameraRequests);
+        _vPendingCameraRequests.push_back(&request);
+    }
+    // the first posted call renders every pending request, so cameras of concurrent sensors share one frame
+    _PostToGUIThread(boost::bind(&QtOSGViewer::_RenderPendingCameraRequests, this), true);
+
+    boost::mutex::scoped_lock lock(_mutexCameraRequests);
+    // the posted call could have been dropped, so have to make sure the GUI thread is not using request anymore
+    std::vector<OffscreenCameraRenderer::CameraRequest*>::iterator itrequest = std::find(_vPendingCameraRequests.begin(), _vPendingCameraRequests.end(), &request);
+    if( itrequest != _vPendingCameraRequests.end() ) {
+        _vPendingCameraRequests.erase(itrequest);
+    }
+    while( _bRenderingCameraRequests ) {
+        _condCameraRequests.wait(lock);
+    }
+    return request.bsuccess;
+}
+
+void QtOSGViewer::_RenderPendingCameraRequests()
+{
+    std::vector<OffscreenCameraRenderer::CameraRequest*> vrequests;
+    {
+        boost::mutex::scoped_lock lock(_mutexCameraRequests);
+        if( _vPendingCameraRequests.size() == 0 ) {
+            return;
+        }
+        vrequests.swap(_vPendingCameraRequests);
+        _bRenderingCameraRequests = true;
+    }
+
+    // make sure the flag is cleared even when rendering throws
+    boost::shared_ptr<void> finishfn((void*) 0, boost::bind(&QtOSGViewer::_FinishCameraRequests, this));
+    const float fnear = _posgWidget->GetCameraNearPlane();
+    FOREACH(itrequest, vrequests) {
+        if( (*itrequest)->fnear <= 0 ) {
+            (*itrequest)->fnear = fnear;
+            (*itrequest)->ffar = 10000*fnear;
+        }
+    }
+
+    if( !_poffscreenrenderer ) {
+        _poffscreenrenderer.reset(new OffscreenCameraRenderer());
+    }
+    OSGGroupPtr figureroot = _posgWidget->GetFigureRoot();
+    osg::Node::NodeMask figuremask = figureroot->getNodeMask();
+    if( !_bRenderFiguresInCamera ) {
+        figureroot->setNodeMask(0);
+    }
+    _poffscreenrenderer->Render(_posgWidget->GetViewSceneData(), _posgWidget->GetCamera()->getClearColor(), vrequests);
+    figureroot->setNodeMask(figuremask);
+}
+
+void QtOSGViewer::_FinishCameraRequests()
+{
+    boost::mutex::scoped_lock lock(_mutexCameraRequests);
+    _bRenderingCameraRequests = false;
+    _condCameraRequests.notify_all();
 }
 
 void QtOSGViewer::_SetCameraTransform()
@@ -1477,6 +1606,10 @@ void QtOSGViewer::_Draw(OSGSwitchPtr handle, osg::ref_ptr<osg::Vec3Array> vertic
     osg::ref_ptr<osg::Geode> geode(new osg::Geode());
     osg::ref_ptr<osg::Geometry> geometry(new osg::Geometry());
 
+    // keep the vertices in buffer objects that are updated in place by _SetGraphPoints instead of compiling a display list
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setDataVariance(osg::Object::DYNAMIC);
     geometry->setVertexArray(vertices.get());
     geometry->setColorArray(colors.get());
     geometry->setColorBinding(colors->size() == vertices->size() ? osg::Geometry::BIND_PER_VERTEX : osg::Geometry::BIND_OVERALL);
@@ -1507,7 +1640,7 @@ GraphHandlePtr QtOSGViewer::plot3(const float* ppoints, int numPoints, int strid
     osg::ref_ptr<osg::Vec4Array> vcolors = new osg::Vec4Array(1);
     (*vcolors)[0] = osg::Vec4f(color.x, color.y, color.z, color.w);
     _PostToGUIThread(boost::bind(&QtOSGViewer::_Draw, this, handle, vvertices, vcolors, osg::PrimitiveSet::POINTS, new osg::Point(fPointSize),color.w<1)); // copies ref counts
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, 1));
 }
 
 GraphHandlePtr QtOSGViewer::plot3(const float* ppoints, int numPoints, int stride, float fPointSize, const float* colors, int drawstyle, bool bhasalpha)
@@ -1528,7 +1661,7 @@ GraphHandlePtr QtOSGViewer::plot3(const float* ppoints, int numPoints, int strid
     }
 
     _PostToGUIThread(boost::bind(&QtOSGViewer::_Draw, this, handle, vvertices, vcolors, osg::PrimitiveSet::POINTS, osg::ref_ptr<osg::Point>(new osg::Point(fPointSize)), bhasalpha)); // copies ref counts
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, numPoints));
 }
 
 GraphHandlePtr QtOSGViewer::drawlinestrip(const float* ppoints, int numPoints, int stride, float fwidth, const RaveVector<float>& color)
@@ -1543,7 +1676,7 @@ GraphHandlePtr QtOSGViewer::drawlinestrip(const float* ppoints, int numPoints, i
     osg::ref_ptr<osg::Vec4Array> vcolors = new osg::Vec4Array(1);
     (*vcolors)[0] = osg::Vec4f(color.x, color.y, color.z, color.w);
     _PostToGUIThread(boost::bind(&QtOSGViewer::_Draw, this, handle, vvertices, vcolors, osg::PrimitiveSet::LINE_STRIP, osg::ref_ptr<osg::LineWidth>(new osg::LineWidth(fwidth)), color.w<1)); // copies ref counts
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, 1));
 }
 GraphHandlePtr QtOSGViewer::drawlinestrip(const float* ppoints, int numPoints, int stride, float fwidth, const float* colors)
 {
@@ -1558,7 +1691,7 @@ GraphHandlePtr QtOSGViewer::drawlinestrip(const float* ppoints, int numPoints, i
     }
 
     _PostToGUIThread(boost::bind(&QtOSGViewer::_Draw, this, handle, vvertices, vcolors, osg::PrimitiveSet::LINE_STRIP, osg::ref_ptr<osg::LineWidth>(new osg::LineWidth(fwidth)), false)); // copies ref counts
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, numPoints));
 }
 
 GraphHandlePtr QtOSGViewer::drawlinelist(const float* ppoints, int numPoints, int stride, float fwidth, const RaveVector<float>& color)
@@ -1572,7 +1705,7 @@ GraphHandlePtr QtOSGViewer::drawlinelist(const float* ppoints, int numPoints, in
     osg::ref_ptr<osg::Vec4Array> vcolors = new osg::Vec4Array(1);
     (*vcolors)[0] = osg::Vec4f(color.x, color.y, color.z, color.w);
     _PostToGUIThread(boost::bind(&QtOSGViewer::_Draw, this, handle, vvertices, vcolors, osg::PrimitiveSet::LINES, osg::ref_ptr<osg::LineWidth>(new osg::LineWidth(fwidth)), color.w<1)); // copies ref counts
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, 1));
 }
 GraphHandlePtr QtOSGViewer::drawlinelist(const float* ppoints, int numPoints, int stride, float fwidth, const float* colors)
 {
@@ -1587,7 +1720,7 @@ GraphHandlePtr QtOSGViewer::drawlinelist(const float* ppoints, int numPoints, in
     }
 
     _PostToGUIThread(boost::bind(&QtOSGViewer::_Draw, this, handle, vvertices, vcolors, osg::PrimitiveSet::LINES, osg::ref_ptr<osg::LineWidth>(new osg::LineWidth(fwidth)), false)); // copies ref counts
-    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle));
+    return GraphHandlePtr(new PrivateGraphHandle(shared_viewer(), handle, numPoints, numPoints));
 }
 
 GraphHandlePtr QtOSGViewer::drawarrow(const RaveVector<float>& p1, const RaveVector<float>& p2, float fwidth, const RaveVector<float>& color)
@@ -1889,7 +2022,6 @@ void QtOSGViewer::UpdateFromModel()
     }
 
     boost::mutex::scoped_lock lock(_mutexUpdateModels);
-    vector<KinBody::BodyState> vecbodies;
 
 #if BOOST_VERSION >= 103500
     EnvironmentMutex::scoped_try_lock lockenv(GetEnv()->GetMutex(),boost::defer_lock_t());
@@ -1897,30 +2029,15 @@ void QtOSGViewer::UpdateFromModel()
     EnvironmentMutex::scoped_try_lock lockenv(GetEnv()->GetMutex(),false);
 #endif
 
-    if( _bLockEnvironment && !lockenv ) {
-        uint64_t basetime = utils::GetMicroTime();
-        while(utils::GetMicroTime()-basetime<1000 ) {
-            if( lockenv.try_lock() ) {
-                // acquired the lock, so update the bodies!
-                GetEnv()->UpdatePublishedBodies();
-                break;
-            }
-        }
-    }
-
-    try {
-        GetEnv()->GetPublishedBodies(vecbodies,100000); // 0.1s
-    }
-    catch(const std::exception& ex) {
-        RAVELOG_WARN("timeout of GetPublishedBodies\n");
-        return;
-    }
+    // the bodies are published by _PublishBodiesThread and the simulation thread, so reading them never waits on the environment
+    EnvironmentSnapshotConstPtr psnapshot = GetEnv()->GetPublishedSnapshot();
     FOREACH(it, _mapbodies) {
         it->second->SetUserData(0);
     }
 
     bool newdata = false; // set to true if new object was created
-    FOREACH(itbody, vecbodies) {
+    FOREACHC(itstate, psnapshot->vbodies) {
+        const KinBody::BodyState* itbody = itstate->get();
         BOOST_ASSERT( !!itbody->pbody );
         KinBodyPtr pbody = itbody->pbody; // try to use only as an id, don't call any methods!
         KinBodyItemPtr pitem = boost::dynamic_pointer_cast<KinBodyItem>(pbody->GetUserData(_userdatakey));
@@ -1998,8 +2115,8 @@ void QtOSGViewer::UpdateFromModel()
 
         pitem->SetUserData(1);
 
-        //  Update viewer with core transforms
-        pitem->UpdateFromModel(itbody->jointvalues, itbody->vectrans);
+        //  Update viewer with core transforms, unchanged bodies keep their nodes
+        pitem->UpdateFromPublishedState(*itstate);
     }
 
     FOREACH_NOINC(it, _mapbodies) {
@@ -2065,6 +2182,30 @@ boost::shared_ptr<EnvironmentMutex::scoped_try_lock> QtOSGViewer::LockEnvironmen
     return lockenv;
 }
 
+void QtOSGViewer::_PublishBodiesThread()
+{
+    while(!_bStopPublishBodies) {
+        bool bUpdateEnvironment;
+        {
+            boost::mutex::scoped_lock lockupdating(_mutexUpdating);
+            bUpdateEnvironment = _bUpdateEnvironment;
+        }
+        if( bUpdateEnvironment && _bLockEnvironment ) {
+            // never block on the environment, the next period tries again
+            boost::shared_ptr<EnvironmentMutex::scoped_try_lock> lockenv = LockEnvironmentWithTimeout(GetEnv(), 1000);
+            if( !!lockenv ) {
+                try {
+                    GetEnv()->UpdatePublishedBodies(1000); // 1ms
+                }
+                catch(const std::exception& ex) {
+                    RAVELOG_VERBOSE_FORMAT("failed to update published bodies: %s", ex.what());
+                }
+            }
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1000/60));
+    }
+}
+
 void QtOSGViewer::_UpdateEnvironment(float fTimeElapsed)
 {
     boost::mutex::scoped_lock lockupd(_mutexUpdating);
@@ -2193,6 +2334,71 @@ void QtOSGViewer::_SetGraphShow(OSGSwitchPtr handle, bool bShow)
     }
 }
 
+void QtOSGViewer::_PostGraphPoints(OSGSwitchPtr handle, const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha)
+{
+    osg::ref_ptr<osg::Vec3Array> vvertices = new osg::Vec3Array(numPoints);
+    for(int i = 0; i < numPoints; ++i) {
+        (*vvertices)[i] = osg::Vec3(ppoints[0], ppoints[1], ppoints[2]);
+        ppoints = (float*)((char*)ppoints + stride);
+    }
+    osg::ref_ptr<osg::Vec4Array> vcolors;
+    if( !!colors ) {
+        vcolors = new osg::Vec4Array(numPoints);
+        for(int i = 0; i < numPoints; ++i) {
+            if (bhasalpha) {
+                (*vcolors)[i] = osg::Vec4f(colors[i * 4 + 0], colors[i * 4 + 1], colors[i * 4 + 2], colors[i * 4 + 3]);
+            }
+            else {
+                (*vcolors)[i] = osg::Vec4f(colors[i * 3 + 0], colors[i * 3 + 1], colors[i * 3 + 2], 1.0f);
+            }
+        }
+    }
+    _PostToGUIThread(boost::bind(&QtOSGViewer::_SetGraphPoints, this, handle, vvertices, vcolors)); // copies ref counts
+}
+
+void QtOSGViewer::_SetGraphPoints(OSGSwitchPtr handle, osg::ref_ptr<osg::Vec3Array> vertices, osg::ref_ptr<osg::Vec4Array> colors)
+{
+    // the plot is handle -> transform -> geode -> geometry, see _Draw
+    if( handle->getNumChildren() == 0 ) {
+        return;
+    }
+    OSGTransformPtr trans = OSGNodePtr(handle->getChild(0))->asTransform();
+    if( !trans || trans->getNumChildren() == 0 ) {
+        return;
+    }
+    osg::ref_ptr<osg::Geode> geode = dynamic_cast<osg::Geode*>(trans->getChild(0));
+    if( !geode || geode->getNumDrawables() == 0 ) {
+        return;
+    }
+    osg::ref_ptr<osg::Geometry> geometry = geode->getDrawable(0)->asGeometry();
+    if( !geometry || geometry->getNumPrimitiveSets() == 0 ) {
+        return;
+    }
+    osg::Vec3Array* pvertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+    osg::DrawArrays* pdrawarrays = dynamic_cast<osg::DrawArrays*>(geometry->getPrimitiveSet(0));
+    if( !pvertices || !pdrawarrays ) {
+        return;
+    }
+
+    // swap the contents so that the arrays and their buffer objects stay attached to the geometry
+    pvertices->asVector().swap(vertices->asVector());
+    pvertices->dirty();
+    if( !!colors ) {
+        osg::Vec4Array* pcolors = dynamic_cast<osg::Vec4Array*>(geometry->getColorArray());
+        if( !!pcolors ) {
+            pcolors->asVector().swap(colors->asVector());
+            pcolors->dirty();
+        }
+        else {
+            geometry->setColorArray(colors.get());
+        }
+        geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+    }
+    pdrawarrays->setCount(pvertices->size());
+    pdrawarrays->dirty();
+    geometry->dirtyBound();
+}
+
 UserDataPtr QtOSGViewer::RegisterItemSelectionCallback(const ItemSelectionCallbackFn& fncallback)
 {
     ItemSelectionCallbackDataPtr pdata(new ItemSelectionCallbackData(fncallback,shared_viewer()));
@@ -16,6 +16,7 @@
 
 #include "qtosg.h"
 #include "osgrenderitem.h"
+#include "osgoffscreenrenderer.h"
 #include <QLayout>
 #include <QComboBox>
 #include <QPushButton>
@@ -126,6 +127,8 @@ public:
     virtual bool LoadModel(const string& filename);
 
     /// \brief updates all render objects from the internal openrave classes
+    ///
+    /// Reads the snapshot published by the environment without locking it and only updates the items whose published state changed.
     void UpdateFromModel();
 
     /// \brief Set Sync environment
@@ -265,7 +268,7 @@ private:
     class PrivateGraphHandle : public GraphHandle
     {
 public:
-        PrivateGraphHandle(QtOSGViewerWeakPtr wviewer, OSGSwitchPtr handle) : _handle(handle), _wviewer(wviewer) {
+        PrivateGraphHandle(QtOSGViewerWeakPtr wviewer, OSGSwitchPtr handle, int numpoints=0, int numcolors=0) : _handle(handle), _wviewer(wviewer), _numpoints(numpoints), _numcolors(numcolors) {
             BOOST_ASSERT(_handle != NULL);
         }
         virtual ~PrivateGraphHandle() {
@@ -291,8 +294,30 @@ public:
             }
         }
 
+        virtual bool SetPoints(const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha)
+        {
+            if( _numcolors == 0 || numPoints <= 0 ) {
+                return false; // not drawn by _Draw
+            }
+            if( !colors && _numcolors > 1 && numPoints != _numpoints ) {
+                return false;
+            }
+            boost::shared_ptr<QtOSGViewer> viewer = _wviewer.lock();
+            if(!viewer) {
+                return false;
+            }
+            viewer->_PostGraphPoints(_handle, ppoints, numPoints, stride, colors, bhasalpha);
+            _numpoints = numPoints;
+            if( !!colors ) {
+                _numcolors = numPoints;
+            }
+            return true;
+        }
+
         OSGSwitchPtr _handle;
         QtOSGViewerWeakPtr _wviewer;
+        int _numpoints; ///< number of points currently drawn by the plot
+        int _numcolors; ///< 1 if the plot has one color, the number of points if it has a color per point, 0 if its points cannot be updated
     };
 
     inline QtOSGViewerPtr shared_viewer() {
@@ -312,6 +337,9 @@ public:
     virtual void _UpdateEnvironment(float fTimeElapsed);
     virtual bool _ForceUpdatePublishedBodies();
 
+    /// \brief periodically publishes the bodies of the environment so that the GUI thread never waits on the environment lock to get new states
+    void _PublishBodiesThread();
+
     /// \brief Reset update from model
     virtual void _Reset();
 
@@ -323,6 +351,10 @@ public:
     virtual void _CloseGraphHandle(OSGSwitchPtr handle);
     virtual void _SetGraphTransform(OSGSwitchPtr handle, const RaveTransform<float> t);
     virtual void _SetGraphShow(OSGSwitchPtr handle, bool bShow);
+    /// \brief copies the points and posts them to the GUI thread to replace the points of a plot drawn by _Draw
+    virtual void _PostGraphPoints(OSGSwitchPtr handle, const float* ppoints, int numPoints, int stride, const float* colors, bool bhasalpha);
+    /// \brief replaces the contents of the vertex and color arrays of a plot drawn by _Draw, colors can be empty to keep the current colors
+    virtual void _SetGraphPoints(OSGSwitchPtr handle, osg::ref_ptr<osg::Vec3Array> vertices, osg::ref_ptr<osg::Vec4Array> colors);
 
     virtual void _Draw(OSGSwitchPtr handle, osg::ref_ptr<osg::Vec3Array> vertices, osg::ref_ptr<osg::Vec4Array> colors, osg::PrimitiveSet::Mode mode, osg::ref_ptr<osg::StateAttribute> attribute, bool bUsingTransparency=false);
     virtual void _DrawTriMesh(OSGSwitchPtr handle, osg::ref_ptr<osg::Vec3Array> vertices, osg::ref_ptr<osg::Vec4Array> colors, osg::ref_ptr<osg::DrawElementsUInt> osgindices, bool bUsingTransparency);
@@ -385,6 +417,16 @@ public:
     bool _StartViewerLoopCommand(ostream& sout, istream& sinput);
     bool _SetProjectionModeCommand(ostream& sout, istream& sinput);
     bool _ZoomCommand(ostream& sout, istream& sinput);
+    bool _GetCameraDepthImageCommand(ostream& sout, istream& sinput);
+
+    /// \brief renders the request offscreen in the GUI thread together with all other pending requests, can be called from any thread
+    virtual bool _RenderCameraRequest(OffscreenCameraRenderer::CameraRequest& request);
+
+    /// \brief renders all of _vPendingCameraRequests in one frame. has to be called in the GUI thread
+    virtual void _RenderPendingCameraRequests();
+
+    /// \brief wakes up the threads waiting on _RenderPendingCameraRequests
+    void _FinishCameraRequests();
 
     //@{ Message Queue
     list<GUIThreadFunctionPtr> _listGUIFunctions; ///< list of GUI functions that should be called in the viewer update thread. protected by _mutexGUIFunctions
@@ -520,10 +562,20 @@ public:
     bool _bLockEnvironment; ///< if true, should lock the environment when updating from it. Otherwise, the environment can assumed to be already locked in another thread that the viewer controls
 
     bool _bExternalLoop; ///< If true, the Qt loop is not started by qtosgviewer, which means qtosgviewer should not terminate the Qt loop during deallocation.
+    boost::shared_ptr<boost::thread> _threadPublishBodies; ///< runs _PublishBodiesThread
+    bool _bStopPublishBodies; ///< if true, _PublishBodiesThread should exit
     int _nQuitMainLoop; ///< controls if the main loop's state. If 0, then nothing is initialized. If -1, then currently initializing/running. If 1, then currently quitting from the main loop. If 2, then successfully quit from the main loop.
 
     bool _bRenderFiguresInCamera;
 
+    //@{ offscreen camera rendering
+    OffscreenCameraRendererPtr _poffscreenrenderer; ///< only used in the GUI thread
+    std::vector<OffscreenCameraRenderer::CameraRequest*> _vPendingCameraRequests; ///< protected by _mutexCameraRequests
+    bool _bRenderingCameraRequests; ///< true while the GUI thread renders requests removed from _vPendingCameraRequests. protected by _mutexCameraRequests
+    boost::mutex _mutexCameraRequests;
+    boost::condition _condCameraRequests; ///< signaled when the GUI thread finishes rendering requests
+    //@}
+
     friend class ItemSelectionCallbackData;
     friend class ViewerThreadCallbackData;
     friend void DeleteItemCallbackSafe(QtOSGViewerWeakPtr, Item*);
@@ -0,0 +1,248 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "plugindefs.h"
+
+#include <boost/thread/thread.hpp>
+
+/// \brief computes the data of the linkstatistics database of openravepy, which only stores and applies it
+class LinkStatistics : public ModuleBase
+{
+public:
+    LinkStatistics(EnvironmentBasePtr penv) : ModuleBase(penv) {
+        __description = ":Interface Author: agent\n\nComputes the statistics of the links of a robot stored by the linkstatistics database";
+        RegisterCommand("ComputeJointSpheres",boost::bind(&LinkStatistics::ComputeJointSpheresCommand,this,_1,_2),
+                        "robotname. Returns one line of jointindex x y z radius for every revolute joint, the sphere contains all the links moved by the joint in the current configuration of the robot.");
+        RegisterCommand("ComputeUnreachableLinkPairs",boost::bind(&LinkStatistics::ComputeUnreachableLinkPairsCommand,this,_1,_2),
+                        "robotname [numsamples N] [padding P] [numthreads T] [seed S]. Samples the dof limits and returns the number of non-adjacent link pairs followed by the pairs of link indices whose bounding boxes padded with P never overlapped. The samples are split across T cloned environments.");
+    }
+
+    virtual ~LinkStatistics() {
+    }
+
+    /// e.g. "ComputeJointSpheres barrettwam"
+    bool ComputeJointSpheresCommand(ostream& sout, istream& sinput)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        RobotBasePtr probot = _GetRobot(sinput);
+        std::map<int, std::pair<Vector, dReal> > mapjointspheres;
+        std::vector<KinBody::LinkPtr> vchildlinks;
+        const std::vector<KinBody::JointPtr>& vorderedjoints = probot->GetDependencyOrderedJoints();
+        for(std::vector<KinBody::JointPtr>::const_reverse_iterator itjoint = vorderedjoints.rbegin(); itjoint != vorderedjoints.rend(); ++itjoint) {
+            KinBody::JointPtr pjoint = *itjoint;
+            if( !pjoint->IsRevolute(0) ) {
+                continue;
+            }
+            pjoint->GetHierarchyChildLink()->GetRigidlyAttachedLinks(vchildlinks);
+            Vector vanchor = pjoint->GetAnchor();
+            dReal fsphereradius = 0;
+            FOREACHC(itlink, vchildlinks) {
+                AABB ablocal = (*itlink)->ComputeLocalAABB();
+                dReal fextension = RaveSqrt((vanchor - (*itlink)->GetTransform()*ablocal.pos).lengthsqr3());
+                fsphereradius = max(fsphereradius, RaveSqrt(ablocal.extents.lengthsqr3()) + fextension);
+            }
+
+            // grow the sphere around the spheres of the joints moved by the child links
+            Vector vextents(fsphereradius, fsphereradius, fsphereradius);
+            Vector vmin = vanchor - vextents, vmax = vanchor + vextents;
+            std::vector<int> vchildjoints;
+            FOREACHC(itchildjoint, probot->GetJoints()) {
+                if( find(vchildlinks.begin(), vchildlinks.end(), (*itchildjoint)->GetHierarchyParentLink()) != vchildlinks.end() && mapjointspheres.find((*itchildjoint)->GetJointIndex()) != mapjointspheres.end() ) {
+                    vchildjoints.push_back((*itchildjoint)->GetJointIndex());
+                }
+            }
+            FOREACHC(itchildjoint, vchildjoints) {
+                const Vector& vchildpos = mapjointspheres[*itchildjoint].first;
+                for(int i = 0; i < 3; ++i) {
+                    vmin[i] = min(vmin[i], vchildpos[i] - fsphereradius);
+                    vmax[i] = max(vmax[i], vchildpos[i] + fsphereradius);
+                }
+            }
+            Vector vnewpos = 0.5*(vmin + vmax);
+            dReal fnewradius = RaveSqrt((vnewpos - vanchor).lengthsqr3()) + fsphereradius;
+            FOREACHC(itchildjoint, vchildjoints) {
+                const std::pair<Vector, dReal>& childsphere = mapjointspheres[*itchildjoint];
+                fnewradius = max(fnewradius, RaveSqrt((vnewpos - childsphere.first).lengthsqr3()) + childsphere.second);
+            }
+            mapjointspheres[pjoint->GetJointIndex()] = std::make_pair(vnewpos, fnewradius);
+        }
+
+        sout << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        FOREACHC(itsphere, mapjointspheres) {
+            const Vector& vpos = itsphere->second.first;
+            sout << itsphere->first << " " << vpos.x << " " << vpos.y << " " << vpos.z << " " << itsphere->second.second << endl;
+        }
+        return true;
+    }
+
+    /// e.g. "ComputeUnreachableLinkPairs barrettwam numsamples 10000 padding 0.02 numthreads 4"
+    bool ComputeUnreachableLinkPairsCommand(ostream& sout, istream& sinput)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        RobotBasePtr probot = _GetRobot(sinput);
+        int numsamples = 10000, numthreads = 1;
+        dReal fpadding = 0.02;
+        uint32_t seed = 0;
+        string cmd;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "numsamples" ) {
+                sinput >> numsamples;
+            }
+            else if( cmd == "padding" ) {
+                sinput >> fpadding;
+            }
+            else if( cmd == "numthreads" ) {
+                sinput >> numthreads;
+            }
+            else if( cmd == "seed" ) {
+                sinput >> seed;
+            }
+            else {
+                RAVELOG_WARN_FORMAT("unrecognized command: %s", cmd);
+                break;
+            }
+            if( !sinput ) {
+                RAVELOG_ERROR_FORMAT("failed processing command %s", cmd);
+                return false;
+            }
+        }
+
+        std::vector<dReal> vlower, vupper;
+        probot->GetDOFLimits(vlower, vupper);
+        for(int idof = 0; idof < probot->GetDOF(); ++idof) {
+            if( probot->IsDOFRevolute(idof) ) {
+                vlower[idof] = max(vlower[idof], -PI);
+                vupper[idof] = min(vupper[idof], PI);
+            }
+        }
+
+        // the pairs that are already unreachable have to be sampled again
+        std::vector<int> vprevunreachable(probot->GetUnreachableLinkPairs().begin(), probot->GetUnreachableLinkPairs().end());
+        probot->SetUnreachableLinkPairs(std::vector<int>());
+        std::vector<int> vnonadjacent = probot->GetNonAdjacentLinks();
+        probot->SetUnreachableLinkPairs(vprevunreachable);
+        std::sort(vnonadjacent.begin(), vnonadjacent.end());
+
+        numthreads = max(1, min(numthreads, numsamples));
+        std::vector< std::vector<int> > vthreadpairs(numthreads, vnonadjacent);
+        if( numthreads == 1 ) {
+            KinBody::KinBodyStateSaver saver(probot);
+            _SampleLinkPairs(probot, vlower, vupper, numsamples, fpadding, seed, vthreadpairs[0]);
+        }
+        else {
+            // changing the dof values modifies the robot, so every thread samples a robot of its own environment
+            std::vector<EnvironmentBasePtr> vclonedenvs(numthreads);
+            std::vector<boost::shared_ptr<boost::thread> > vthreads(numthreads);
+            for(int ithread = 0; ithread < numthreads; ++ithread) {
+                vclonedenvs[ithread] = GetEnv()->CloneSelf(Clone_Bodies);
+                RobotBasePtr pclonedrobot = vclonedenvs[ithread]->GetRobot(probot->GetName());
+                int numthreadsamples = numsamples/numthreads + (ithread < numsamples%numthreads ? 1 : 0);
+                vthreads[ithread].reset(new boost::thread(boost::bind(&LinkStatistics::_SampleLinkPairsWorker, vclonedenvs[ithread], pclonedrobot, boost::cref(vlower), boost::cref(vupper), numthreadsamples, fpadding, seed+ithread, boost::ref(vthreadpairs[ithread]))));
+            }
+            FOREACH(itthread, vthreads) {
+                (*itthread)->join();
+            }
+            FOREACH(itenv, vclonedenvs) {
+                (*itenv)->Destroy();
+            }
+        }
+
+        // a pair is unreachable only if no thread saw its boxes overlap
+        std::vector<int> vunreachable = vthreadpairs.at(0), vintersection;
+        for(size_t ithread = 1; ithread < vthreadpairs.size(); ++ithread) {
+            vintersection.resize(0);
+            std::set_intersection(vunreachable.begin(), vunreachable.end(), vthreadpairs[ithread].begin(), vthreadpairs[ithread].end(), std::back_inserter(vintersection));
+            vunreachable.swap(vintersection);
+        }
+        RAVELOG_INFO_FORMAT("env=%d, %d/%d non-adjacent link pairs of %s can never collide", GetEnv()->GetId()%vunreachable.size()%vnonadjacent.size()%probot->GetName());
+        sout << vnonadjacent.size();
+        FOREACHC(itpair, vunreachable) {
+            sout << " " << (*itpair&0xffff) << " " << (*itpair>>16);
+        }
+        return true;
+    }
+
+protected:
+    RobotBasePtr _GetRobot(istream& sinput)
+    {
+        string robotname;
+        sinput >> robotname;
+        RobotBasePtr probot = GetEnv()->GetRobot(robotname);
+        if( !probot ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, could not find robot %s", GetEnv()->GetId()%robotname, ORE_InvalidArguments);
+        }
+        return probot;
+    }
+
+    static void _SampleLinkPairsWorker(EnvironmentBasePtr penv, RobotBasePtr probot, const std::vector<dReal>& vlower, const std::vector<dReal>& vupper, int numsamples, dReal fpadding, uint32_t seed, std::vector<int>& vlinkpairs)
+    {
+        try {
+            EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+            _SampleLinkPairs(probot, vlower, vupper, numsamples, fpadding, seed, vlinkpairs);
+        }
+        catch(const std::exception& ex) {
+            // keep all the pairs so that a failed thread cannot make any pair unreachable
+            RAVELOG_WARN_FORMAT("env=%d, failed to sample link pairs: %s", penv->GetId()%ex.what());
+        }
+    }
+
+    /// \brief removes from vlinkpairs the pairs whose padded link boxes overlap in one of numsamples uniform samples of the limits, vlinkpairs stays sorted
+    static void _SampleLinkPairs(RobotBasePtr probot, const std::vector<dReal>& vlower, const std::vector<dReal>& vupper, int numsamples, dReal fpadding, uint32_t seed, std::vector<int>& vlinkpairs)
+    {
+        SpaceSamplerBasePtr psampler = RaveCreateSpaceSampler(probot->GetEnv(), "mt19937");
+        if( !psampler ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("failed to create mt19937 sampler", ORE_InvalidState);
+        }
+        psampler->SetSeed(seed);
+        const std::vector<KinBody::LinkPtr>& vlinks = probot->GetLinks();
+        std::vector<AABB> vaabbs(vlinks.size());
+        std::vector<dReal> vsample, vvalues(vlower.size());
+        for(int isample = 0; isample < numsamples && vlinkpairs.size() > 0; ++isample) {
+            psampler->SampleSequence(vsample, vlower.size(), IT_Closed);
+            for(size_t idof = 0; idof < vlower.size(); ++idof) {
+                vvalues[idof] = vlower[idof] + vsample.at(idof)*(vupper[idof] - vlower[idof]);
+            }
+            probot->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+            for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+                vaabbs[ilink] = vlinks[ilink]->ComputeAABB();
+            }
+            std::vector<int>::iterator itend = vlinkpairs.begin();
+            FOREACH(itpair, vlinkpairs) {
+                const AABB& ab0 = vaabbs.at(*itpair&0xffff);
+                const AABB& ab1 = vaabbs.at(*itpair>>16);
+                bool boverlap = true;
+                for(int i = 0; i < 3; ++i) {
+                    if( RaveFabs(ab0.pos[i] - ab1.pos[i]) > ab0.extents[i] + ab1.extents[i] + 2*fpadding ) {
+                        boverlap = false;
+                        break;
+                    }
+                }
+                if( !boverlap ) {
+                    *itend++ = *itpair;
+                }
+            }
+            vlinkpairs.erase(itend, vlinkpairs.end());
+        }
+    }
+};
+
+ModuleBasePtr CreateLinkStatistics(EnvironmentBasePtr penv) {
+    return ModuleBasePtr(new LinkStatistics(penv));
+}
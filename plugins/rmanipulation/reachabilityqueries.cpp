@@ -0,0 +1,433 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "plugindefs.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+/// \brief kd-tree over the points of a reachability database that can be searched from several threads at once
+///
+/// ANN keeps the state of a search in globals, so the tree is searched with per-query state only.
+class ReachabilityKDTree
+{
+public:
+    ReachabilityKDTree(int dim, std::vector<dReal>& vpoints, std::vector<dReal>& vweights, int bucketsize) : _dim(dim), _bucketsize(max(1,bucketsize))
+    {
+        _vpoints.swap(vpoints);
+        _vweights.swap(vweights);
+        int numpoints = _vpoints.size()/_dim;
+        _vindices.resize(numpoints);
+        for(int i = 0; i < numpoints; ++i) {
+            _vindices[i] = i;
+        }
+        if( numpoints > 0 ) {
+            _vnodes.reserve(2*numpoints/_bucketsize+1);
+            _BuildNode(0, numpoints);
+        }
+    }
+
+    int GetDim() const {
+        return _dim;
+    }
+    int GetNumPoints() const {
+        return _vindices.size();
+    }
+    bool HasWeights() const {
+        return _vweights.size() > 0;
+    }
+
+    /// \brief returns the number of points whose squared distance to pquery is within fsqradius, the closest k of them are set in vneighbors sorted by distance
+    ///
+    /// \param feps the approximation factor of ANN, a box is searched if its distance times (1+feps) is within the radius
+    int SearchRadius(const dReal* pquery, dReal fsqradius, int k, dReal feps, std::vector< std::pair<dReal, int> >& vneighbors) const
+    {
+        vneighbors.resize(0);
+        if( _vnodes.size() == 0 ) {
+            return 0;
+        }
+        std::vector<dReal> voffsets(_dim, 0);
+        int numinside = 0;
+        _SearchNode(0, pquery, fsqradius, k, (1+feps)*(1+feps), 0, voffsets, numinside, vneighbors);
+        std::sort_heap(vneighbors.begin(), vneighbors.end());
+        return numinside;
+    }
+
+    /// \brief returns the sum of the point weights times exp(sum_d vibandwidth[d]*(p[d]-pquery[d])^2) over the closest k points inside the radius, all of them if k <= 0
+    dReal ComputeKernelDensity(const dReal* pquery, dReal fsqradius, int k, dReal feps, const std::vector<dReal>& vibandwidth, std::vector< std::pair<dReal, int> >& vneighbors) const
+    {
+        int numinside = SearchRadius(pquery, fsqradius, k > 0 ? k : GetNumPoints(), feps, vneighbors);
+        dReal fdensity = 0;
+        if( numinside > 0 ) {
+            FOREACHC(itneighbor, vneighbors) {
+                const dReal* ppoint = &_vpoints[itneighbor->second*_dim];
+                dReal fexponent = 0;
+                for(int idim = 0; idim < _dim; ++idim) {
+                    fexponent += vibandwidth[idim]*(ppoint[idim]-pquery[idim])*(ppoint[idim]-pquery[idim]);
+                }
+                fdensity += (_vweights.size() > 0 ? _vweights[itneighbor->second] : dReal(1))*RaveExp(fexponent);
+            }
+        }
+        return fdensity;
+    }
+
+private:
+    struct Node
+    {
+        int splitdim; ///< -1 for a leaf
+        dReal splitvalue;
+        int children[2];
+        int start, end; ///< range of _vindices of a leaf
+    };
+
+    int _BuildNode(int start, int end)
+    {
+        int inode = _vnodes.size();
+        _vnodes.push_back(Node());
+        if( end - start <= _bucketsize ) {
+            _vnodes[inode].splitdim = -1;
+            _vnodes[inode].start = start;
+            _vnodes[inode].end = end;
+            return inode;
+        }
+
+        // split the dimension with the largest spread at its median
+        int splitdim = 0;
+        dReal fmaxspread = -1;
+        for(int idim = 0; idim < _dim; ++idim) {
+            dReal fmin = _vpoints[_vindices[start]*_dim+idim], fmax = fmin;
+            for(int i = start+1; i < end; ++i) {
+                dReal f = _vpoints[_vindices[i]*_dim+idim];
+                fmin = min(fmin, f);
+                fmax = max(fmax, f);
+            }
+            if( fmax - fmin > fmaxspread ) {
+                fmaxspread = fmax - fmin;
+                splitdim = idim;
+            }
+        }
+        int middle = (start+end)/2;
+        std::nth_element(_vindices.begin()+start, _vindices.begin()+middle, _vindices.begin()+end, PointComparator(_vpoints, _dim, splitdim));
+        _vnodes[inode].splitdim = splitdim;
+        _vnodes[inode].splitvalue = _vpoints[_vindices[middle]*_dim+splitdim];
+        int ilower = _BuildNode(start, middle);
+        int iupper = _BuildNode(middle, end);
+        _vnodes[inode].children[0] = ilower;
+        _vnodes[inode].children[1] = iupper;
+        return inode;
+    }
+
+    /// \param fboxdist squared distance from pquery to the box of the node, voffsets holds its per dimension offsets
+    void _SearchNode(int inode, const dReal* pquery, dReal fsqradius, int k, dReal fmaxerror, dReal fboxdist, std::vector<dReal>& voffsets, int& numinside, std::vector< std::pair<dReal, int> >& vneighbors) const
+    {
+        const Node& node = _vnodes[inode];
+        if( node.splitdim < 0 ) {
+            for(int i = node.start; i < node.end; ++i) {
+                int index = _vindices[i];
+                const dReal* ppoint = &_vpoints[index*_dim];
+                dReal fdist = 0;
+                for(int idim = 0; idim < _dim && fdist <= fsqradius; ++idim) {
+                    fdist += (ppoint[idim]-pquery[idim])*(ppoint[idim]-pquery[idim]);
+                }
+                if( fdist <= fsqradius ) {
+                    ++numinside;
+                    if( (int)vneighbors.size() < k ) {
+                        vneighbors.push_back(std::make_pair(fdist, index));
+                        std::push_heap(vneighbors.begin(), vneighbors.end());
+                    }
+                    else if( k > 0 && fdist < vneighbors.front().first ) {
+                        std::pop_heap(vneighbors.begin(), vneighbors.end());
+                        vneighbors.back() = std::make_pair(fdist, index);
+                        std::push_heap(vneighbors.begin(), vneighbors.end());
+                    }
+                }
+            }
+            return;
+        }
+
+        dReal fdiff = pquery[node.splitdim] - node.splitvalue;
+        int iclose = fdiff < 0 ? 0 : 1;
+        _SearchNode(node.children[iclose], pquery, fsqradius, k, fmaxerror, fboxdist, voffsets, numinside, vneighbors);
+
+        // the far box only moves away along the split dimension
+        dReal foldoffset = voffsets[node.splitdim];
+        dReal ffarboxdist = fboxdist + fdiff*fdiff - foldoffset*foldoffset;
+        if( ffarboxdist*fmaxerror <= fsqradius ) {
+            voffsets[node.splitdim] = fdiff;
+            _SearchNode(node.children[1-iclose], pquery, fsqradius, k, fmaxerror, ffarboxdist, voffsets, numinside, vneighbors);
+            voffsets[node.splitdim] = foldoffset;
+        }
+    }
+
+    struct PointComparator
+    {
+        PointComparator(const std::vector<dReal>& vpoints, int dim, int splitdim) : _vpoints(vpoints), _dim(dim), _splitdim(splitdim) {
+        }
+        bool operator()(int i0, int i1) const {
+            return _vpoints[i0*_dim+_splitdim] < _vpoints[i1*_dim+_splitdim];
+        }
+        const std::vector<dReal>& _vpoints;
+        int _dim, _splitdim;
+    };
+
+    int _dim, _bucketsize;
+    std::vector<dReal> _vpoints; ///< numpoints*_dim coordinates
+    std::vector<dReal> _vweights; ///< empty or one weight per point
+    std::vector<int> _vindices; ///< point indices ordered by the leaves
+    std::vector<Node> _vnodes;
+};
+
+typedef boost::shared_ptr<ReachabilityKDTree> ReachabilityKDTreePtr;
+typedef boost::shared_ptr<ReachabilityKDTree const> ReachabilityKDTreeConstPtr;
+
+/// \brief keeps the kd-trees of the reachability databases built once and answers batched queries on several threads
+class ReachabilityQueries : public ModuleBase
+{
+public:
+    ReachabilityQueries(EnvironmentBasePtr penv) : ModuleBase(penv) {
+        __description = ":Interface Author: agent\n\nBuilds kd-trees over the points of the kinematic and inverse reachability databases and answers batched radius and kernel density queries on several threads. The trees are shared by all the callers of the module.";
+        RegisterCommand("CreateIndex",boost::bind(&ReachabilityQueries::CreateIndexCommand,this,_1,_2),
+                        "name dim D [bucketsize B] [weights N w0 ... wN-1] points N p0 ... pN-1. Builds the kd-tree of N points of dimension D, replacing any previous tree with the same name. The weights are used by KernelDensity.");
+        RegisterCommand("DestroyIndex",boost::bind(&ReachabilityQueries::DestroyIndexCommand,this,_1,_2),
+                        "name. Removes the kd-tree.");
+        RegisterCommand("KFRSearch",boost::bind(&ReachabilityQueries::KFRSearchCommand,this,_1,_2),
+                        "name [sqrad R] [k K] [eps E] [numthreads T] queries N q0 ... qN-1. For every query returns a line with the number of points within squared distance R followed by the index and squared distance of the closest K of them.");
+        RegisterCommand("KernelDensity",boost::bind(&ReachabilityQueries::KernelDensityCommand,this,_1,_2),
+                        "name ibandwidth b0 ... bD-1 [sqrad R] [k K] [eps E] [numthreads T] queries N q0 ... qN-1. Returns for every query the sum of the point weights times exp(sum_d b_d*(p_d-q_d)^2) over the closest K points within squared distance R, all of them if K <= 0.");
+    }
+
+    virtual ~ReachabilityQueries() {
+    }
+
+    /// \brief returns the kd-tree of name, can be used by the planners sharing the module
+    ReachabilityKDTreeConstPtr GetIndex(const std::string& name) const
+    {
+        boost::mutex::scoped_lock lock(_mutexIndices);
+        std::map<std::string, ReachabilityKDTreePtr>::const_iterator it = _mapIndices.find(name);
+        if( it == _mapIndices.end() ) {
+            return ReachabilityKDTreeConstPtr();
+        }
+        return it->second;
+    }
+
+    /// e.g. "CreateIndex kinematicreachability dim 3 points 2 0 0 0 0.1 0 0"
+    bool CreateIndexCommand(ostream& sout, istream& sinput)
+    {
+        string name, cmd;
+        sinput >> name;
+        int dim = 0, bucketsize = 8;
+        std::vector<dReal> vpoints, vweights;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "dim" ) {
+                sinput >> dim;
+            }
+            else if( cmd == "bucketsize" ) {
+                sinput >> bucketsize;
+            }
+            else if( cmd == "weights" ) {
+                _ReadValues(sinput, 1, vweights);
+            }
+            else if( cmd == "points" ) {
+                if( dim <= 0 ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("index %s needs the dimension before the points", name, ORE_InvalidArguments);
+                }
+                _ReadValues(sinput, dim, vpoints);
+            }
+            else {
+                RAVELOG_WARN_FORMAT("unrecognized command: %s", cmd);
+                break;
+            }
+            if( !sinput ) {
+                RAVELOG_ERROR_FORMAT("failed processing command %s", cmd);
+                return false;
+            }
+        }
+        if( dim <= 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("index %s has invalid dimension %d", name%dim, ORE_InvalidArguments);
+        }
+        if( vweights.size() > 0 && vweights.size()*dim != vpoints.size() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("index %s has %d weights for %d points", name%vweights.size()%(vpoints.size()/dim), ORE_InvalidArguments);
+        }
+        uint32_t basetime = utils::GetMilliTime();
+        ReachabilityKDTreePtr pindex(new ReachabilityKDTree(dim, vpoints, vweights, bucketsize));
+        RAVELOG_DEBUG_FORMAT("env=%d, built index %s of %d points in %dms", GetEnv()->GetId()%name%pindex->GetNumPoints()%(utils::GetMilliTime()-basetime));
+        boost::mutex::scoped_lock lock(_mutexIndices);
+        _mapIndices[name] = pindex;
+        return true;
+    }
+
+    bool DestroyIndexCommand(ostream& sout, istream& sinput)
+    {
+        string name;
+        sinput >> name;
+        boost::mutex::scoped_lock lock(_mutexIndices);
+        return _mapIndices.erase(name) > 0;
+    }
+
+    /// e.g. "KFRSearch kinematicreachability sqrad 0.01 k 16 eps 0.001 numthreads 4 queries 1 0 0 0"
+    bool KFRSearchCommand(ostream& sout, istream& sinput)
+    {
+        QueryParameters params;
+        ReachabilityKDTreeConstPtr pindex = _ReadQuery(sinput, params, false);
+        std::vector<int> vnuminside(params.numqueries);
+        std::vector< std::vector< std::pair<dReal, int> > > vneighbors(params.numqueries);
+        _RunQueries(params, boost::bind(&ReachabilityQueries::_KFRSearchRange, pindex, boost::cref(params), boost::ref(vnuminside), boost::ref(vneighbors), _1, _2));
+        sout << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        for(int iquery = 0; iquery < params.numqueries; ++iquery) {
+            sout << vnuminside[iquery];
+            FOREACHC(itneighbor, vneighbors[iquery]) {
+                sout << " " << itneighbor->second << " " << itneighbor->first;
+            }
+            sout << endl;
+        }
+        return true;
+    }
+
+    /// e.g. "KernelDensity inversereachability ibandwidth -50 -50 -50 sqrad 0.1 k 16 queries 1 0 0 0"
+    bool KernelDensityCommand(ostream& sout, istream& sinput)
+    {
+        QueryParameters params;
+        ReachabilityKDTreeConstPtr pindex = _ReadQuery(sinput, params, true);
+        std::vector<dReal> vdensities(params.numqueries);
+        _RunQueries(params, boost::bind(&ReachabilityQueries::_KernelDensityRange, pindex, boost::cref(params), boost::ref(vdensities), _1, _2));
+        sout << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        FOREACHC(itdensity, vdensities) {
+            sout << *itdensity << " ";
+        }
+        return true;
+    }
+
+protected:
+    struct QueryParameters
+    {
+        QueryParameters() : fsqradius(0), k(0), feps(0), numthreads(0), numqueries(0) {
+        }
+        dReal fsqradius;
+        int k;
+        dReal feps;
+        int numthreads; ///< if <= 0, one thread per cpu
+        int numqueries;
+        std::vector<dReal> vqueries; ///< numqueries*dim coordinates
+        std::vector<dReal> vibandwidth;
+    };
+
+    /// \brief reads N followed by N*dim values into vvalues
+    static void _ReadValues(istream& sinput, int dim, std::vector<dReal>& vvalues)
+    {
+        int num = 0;
+        sinput >> num;
+        vvalues.resize(max(0, num)*dim);
+        FOREACH(itvalue, vvalues) {
+            sinput >> *itvalue;
+        }
+    }
+
+    ReachabilityKDTreeConstPtr _ReadQuery(istream& sinput, QueryParameters& params, bool bkerneldensity)
+    {
+        string name, cmd;
+        sinput >> name;
+        ReachabilityKDTreeConstPtr pindex = GetIndex(name);
+        if( !pindex ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, index %s does not exist", GetEnv()->GetId()%name, ORE_InvalidArguments);
+        }
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "sqrad" ) {
+                sinput >> params.fsqradius;
+            }
+            else if( cmd == "k" ) {
+                sinput >> params.k;
+            }
+            else if( cmd == "eps" ) {
+                sinput >> params.feps;
+            }
+            else if( cmd == "numthreads" ) {
+                sinput >> params.numthreads;
+            }
+            else if( cmd == "ibandwidth" ) {
+                params.vibandwidth.resize(pindex->GetDim());
+                FOREACH(itvalue, params.vibandwidth) {
+                    sinput >> *itvalue;
+                }
+            }
+            else if( cmd == "queries" ) {
+                _ReadValues(sinput, pindex->GetDim(), params.vqueries);
+                params.numqueries = params.vqueries.size()/pindex->GetDim();
+            }
+            else {
+                RAVELOG_WARN_FORMAT("unrecognized command: %s", cmd);
+                break;
+            }
+            if( !sinput ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("failed processing command %s", cmd, ORE_InvalidArguments);
+            }
+        }
+        if( bkerneldensity && (int)params.vibandwidth.size() != pindex->GetDim() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("kernel density of index %s needs %d ibandwidth values", name%pindex->GetDim(), ORE_InvalidArguments);
+        }
+        return pindex;
+    }
+
+    /// \brief splits the queries into contiguous ranges and calls fn(start, end) for each on its own thread
+    void _RunQueries(const QueryParameters& params, const boost::function<void(int, int)>& fn)
+    {
+        int numthreads = params.numthreads > 0 ? params.numthreads : (int)boost::thread::hardware_concurrency();
+        numthreads = max(1, min(numthreads, params.numqueries/s_nMinThreadQueries));
+        if( numthreads <= 1 ) {
+            fn(0, params.numqueries);
+            return;
+        }
+        std::vector<boost::shared_ptr<boost::thread> > vthreads(numthreads);
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            vthreads[ithread].reset(new boost::thread(boost::bind(fn, (params.numqueries*ithread)/numthreads, (params.numqueries*(ithread+1))/numthreads)));
+        }
+        FOREACH(itthread, vthreads) {
+            (*itthread)->join();
+        }
+    }
+
+    static void _KFRSearchRange(ReachabilityKDTreeConstPtr pindex, const QueryParameters& params, std::vector<int>& vnuminside, std::vector< std::vector< std::pair<dReal, int> > >& vneighbors, int start, int end)
+    {
+        for(int iquery = start; iquery < end; ++iquery) {
+            vnuminside[iquery] = pindex->SearchRadius(&params.vqueries[iquery*pindex->GetDim()], params.fsqradius, params.k, params.feps, vneighbors[iquery]);
+        }
+    }
+
+    static void _KernelDensityRange(ReachabilityKDTreeConstPtr pindex, const QueryParameters& params, std::vector<dReal>& vdensities, int start, int end)
+    {
+        std::vector< std::pair<dReal, int> > vneighbors;
+        for(int iquery = start; iquery < end; ++iquery) {
+            vdensities[iquery] = pindex->ComputeKernelDensity(&params.vqueries[iquery*pindex->GetDim()], params.fsqradius, params.k, params.feps, params.vibandwidth, vneighbors);
+        }
+    }
+
+    static const int s_nMinThreadQueries = 64; ///< minimum number of queries searched by a thread
+
+    mutable boost::mutex _mutexIndices; ///< protects _mapIndices
+    std::map<std::string, ReachabilityKDTreePtr> _mapIndices;
+};
+
+ModuleBasePtr CreateReachabilityQueries(EnvironmentBasePtr penv) {
+    return ModuleBasePtr(new ReachabilityQueries(penv));
+}
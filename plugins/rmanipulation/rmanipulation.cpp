@@ -20,6 +20,8 @@ ModuleBasePtr CreateBaseManipulation(EnvironmentBasePtr penv);
 ModuleBasePtr CreateTaskCaging(EnvironmentBasePtr penv);
 ModuleBasePtr CreateTaskManipulation(EnvironmentBasePtr penv);
 ModuleBasePtr CreateVisualFeedback(EnvironmentBasePtr penv);
+ModuleBasePtr CreateLinkStatistics(EnvironmentBasePtr penv);
+ModuleBasePtr CreateReachabilityQueries(EnvironmentBasePtr penv);
 
 InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string& interfacename, std::istream& sinput, EnvironmentBasePtr penv)
 {
@@ -37,6 +39,12 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
         else if( interfacename == "visualfeedback") {
             return CreateVisualFeedback(penv);
         }
+        else if( interfacename == "linkstatistics") {
+            return CreateLinkStatistics(penv);
+        }
+        else if( interfacename == "reachabilityqueries") {
+            return CreateReachabilityQueries(penv);
+        }
         break;
     default:
         break;
@@ -50,6 +58,8 @@ void GetPluginAttributesValidated(PLUGININFO& info)
     info.interfacenames[PT_Module].push_back("TaskManipulation");
     info.interfacenames[PT_Module].push_back("TaskCaging");
     info.interfacenames[PT_Module].push_back("VisualFeedback");
+    info.interfacenames[PT_Module].push_back("LinkStatistics");
+    info.interfacenames[PT_Module].push_back("ReachabilityQueries");
 }
 
 OPENRAVE_PLUGIN_API void DestroyPlugin()
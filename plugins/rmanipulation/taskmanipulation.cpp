@@ -327,10 +327,14 @@ protected:
     }
 
     /// \brief restores the empty geometry group
+    ///
+    /// The padded group is switched in the collision checkers of the body, which keep the collision objects of every group
+    /// they have seen, so switching back and forth does not rebuild them. Falls back to setting the link geometries if a
+    /// checker does not support geometry groups.
     class GeometryGroupSaver
     {
 public:
-        GeometryGroupSaver(KinBodyPtr pbody, const std::string& sPaddedGeometryGroup) : _pbody(pbody), _sPaddedGeometryGroup(sPaddedGeometryGroup), _bPadded(false) {
+        GeometryGroupSaver(KinBodyPtr pbody, const std::string& sPaddedGeometryGroup) : _pbody(pbody), _sPaddedGeometryGroup(sPaddedGeometryGroup), _bPadded(false), _bLinkGeometries(false) {
         }
         ~GeometryGroupSaver() {
             SwitchRegular();
@@ -338,21 +342,68 @@ public:
         void SwitchPadded() {
             if( !_bPadded && _sPaddedGeometryGroup.size() > 0 ) {
                 RAVELOG_DEBUG("switching to padded robot\n");
-                _pbody->SetLinkGeometriesFromGroup(_sPaddedGeometryGroup);
+                if( !_SetCheckerGeometryGroups() ) {
+                    _pbody->SetLinkGeometriesFromGroup(_sPaddedGeometryGroup);
+                    _bLinkGeometries = true;
+                }
                 _bPadded = true;
             }
         }
         void SwitchRegular() {
             if( _bPadded && _sPaddedGeometryGroup.size() > 0 ) {
                 RAVELOG_DEBUG("switching to regular robot\n");
-                _pbody->SetLinkGeometriesFromGroup("self");
+                if( _bLinkGeometries ) {
+                    _pbody->SetLinkGeometriesFromGroup("self");
+                    _bLinkGeometries = false;
+                }
+                else {
+                    _RestoreCheckerGeometryGroups();
+                }
                 _bPadded = false;
             }
         }
 protected:
+        /// \brief sets the padded group in the environment and self collision checkers, returns false and leaves them unchanged if one of them does not support it
+        bool _SetCheckerGeometryGroups() {
+            std::vector<CollisionCheckerBasePtr> vcheckers;
+            vcheckers.push_back(_pbody->GetEnv()->GetCollisionChecker());
+            CollisionCheckerBasePtr pselfchecker = _pbody->GetSelfCollisionChecker();
+            if( !!pselfchecker && pselfchecker != vcheckers.front() ) {
+                vcheckers.push_back(pselfchecker);
+            }
+            FOREACH(itchecker, vcheckers) {
+                if( !*itchecker ) {
+                    continue;
+                }
+                try {
+                    std::string previousgroup = (*itchecker)->GetBodyGeometryGroup(_pbody);
+                    if( !(*itchecker)->SetBodyGeometryGroup(_pbody, _sPaddedGeometryGroup) ) {
+                        _RestoreCheckerGeometryGroups();
+                        return false;
+                    }
+                    _vpreviousgroups.push_back(std::make_pair(*itchecker, previousgroup));
+                }
+                catch(const openrave_exception& ex) {
+                    RAVELOG_VERBOSE_FORMAT("collision checker %s does not support geometry groups: %s", (*itchecker)->GetXMLId()%ex.what());
+                    _RestoreCheckerGeometryGroups();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void _RestoreCheckerGeometryGroups() {
+            while(_vpreviousgroups.size() > 0) {
+                _vpreviousgroups.back().first->SetBodyGeometryGroup(_pbody, _vpreviousgroups.back().second);
+                _vpreviousgroups.pop_back();
+            }
+        }
+
         KinBodyPtr _pbody;
         std::string _sPaddedGeometryGroup;
         bool _bPadded;
+        bool _bLinkGeometries; ///< true if the padded group was set with SetLinkGeometriesFromGroup
+        std::vector< std::pair<CollisionCheckerBasePtr, std::string> > _vpreviousgroups; ///< the checkers whose geometry group was switched and their previous group of the body
     };
 
     bool GraspPlanning(ostream& sout, istream& sinput)
@@ -372,6 +423,7 @@ protected:
         bool bExecute = true;
         string strtrajfilename;
         bool bRandomDests = true, bRandomGrasps = true;     // if true, permute the grasps and destinations when iterating through them
+        bool bSortGraspsByCost = false; // if true, the grasps with the closest ik solutions are tried first when the grasp transforms are given
         boost::shared_ptr<ostream> pOutputTrajStream;
         int nMaxSeedGrasps = 20, nMaxSeedDests = 5, nMaxSeedIkSolutions = 0;
         int nMaxIterations = 4000;
@@ -417,6 +469,9 @@ protected:
             else if( cmd == "randomgrasps" ) {
                 sinput >> bRandomGrasps;
             }
+            else if( cmd == "sortgraspsbycost" ) {
+                sinput >> bSortGraspsByCost;
+            }
             else if( cmd == "writetraj" ) {
                 sinput >> strtrajfilename;
             }
@@ -621,6 +676,10 @@ protected:
                 return false;
             }
         }
+        else if( !nMobileAffine && !(!!_pGrasperPlanner && pmanip->GetIkSolver()->Supports(IKP_Transform6D)) && !pmanip->GetIkSolver()->Supports(IKP_TranslationDirection5D) && pmanip->GetIkSolver()->Supports(IKP_Transform6D) ) {
+            // the grasp transforms are the final ik goals, so the unreachable grasps can be removed with one batched ik query before trying them one by one
+            _PrefilterGraspsWithIk(pmanip, ptarget, vgrasps, nGraspDim, iGraspTransformNoCol, bSortGraspsByCost, vgrasppermuation);
+        }
 
         _phandtraj.reset();
 
@@ -1510,6 +1569,95 @@ protected:
         return true;
     }
 
+protected:
+    /// \brief removes the grasps that the arm cannot reach from vgrasppermutation
+    ///
+    /// First rejects the grasp transforms outside of the reach sphere of the arm, then solves the ik of the rest with one
+    /// batched query that ignores collisions. A grasp without any solution cannot succeed with the collision checked ik either.
+    /// \param bSortByCost if true, sorts the grasps by the distance of their closest ik solution to the current arm configuration
+    void _PrefilterGraspsWithIk(RobotBase::ManipulatorConstPtr pmanip, KinBodyConstPtr ptarget, const vector<dReal>& vgrasps, int nGraspDim, int iGraspTransformNoCol, bool bSortByCost, vector<int>& vgrasppermutation)
+    {
+        RobotBase::RobotStateSaver saver(_robot);
+        _robot->SetActiveDOFs(pmanip->GetArmIndices());
+        vector<dReal> vcurvalues, vdiff;
+        _robot->GetActiveDOFValues(vcurvalues);
+
+        // the distance between the anchors of consecutive revolute joints stays the same, so their sum bounds the reach from the first anchor
+        Vector vreachcenter;
+        dReal freach = 0;
+        vector<KinBody::JointPtr> vjoints;
+        FOREACHC(itindex, pmanip->GetArmIndices()) {
+            KinBody::JointPtr pjoint = _robot->GetJointFromDOFIndex(*itindex);
+            if( vjoints.size() == 0 || vjoints.back() != pjoint ) {
+                vjoints.push_back(pjoint);
+            }
+        }
+        if( vjoints.size() > 0 ) {
+            vreachcenter = vjoints[0]->GetAnchor();
+            Vector vprev = vreachcenter;
+            FOREACHC(itjoint, vjoints) {
+                freach += RaveSqrt(((*itjoint)->GetAnchor()-vprev).lengthsqr3());
+                vprev = (*itjoint)->GetAnchor();
+                for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
+                    if( (*itjoint)->IsPrismatic(idof) ) {
+                        freach += (*itjoint)->GetLimit(idof).second - (*itjoint)->GetLimit(idof).first;
+                    }
+                }
+            }
+            freach += RaveSqrt((pmanip->GetTransform().trans-vprev).lengthsqr3());
+            freach = 1.01*freach + 0.001;
+        }
+
+        Transform tbaseinv = pmanip->GetBase()->GetTransform().inverse();
+        vector<IkParameterization> vikparams;
+        vector<int> vcandidates;
+        vikparams.reserve(vgrasppermutation.size());
+        vcandidates.reserve(vgrasppermutation.size());
+        FOREACHC(itgrasp, vgrasppermutation) {
+            const dReal* pm = &vgrasps[*itgrasp*nGraspDim+iGraspTransformNoCol];
+            TransformMatrix tm;
+            tm.m[0] = pm[0]; tm.m[1] = pm[3]; tm.m[2] = pm[6]; tm.trans.x = pm[9];
+            tm.m[4] = pm[1]; tm.m[5] = pm[4]; tm.m[6] = pm[7]; tm.trans.y = pm[10];
+            tm.m[8] = pm[2]; tm.m[9] = pm[5]; tm.m[10] = pm[8]; tm.trans.z = pm[11];
+            Transform tgoal = !ptarget ? Transform(tm) : ptarget->GetTransform() * Transform(tm);
+            if( vjoints.size() > 0 && (tgoal.trans-vreachcenter).lengthsqr3() > freach*freach ) {
+                continue;
+            }
+            vikparams.push_back(IkParameterization());
+            vikparams.back().SetTransform6D(tbaseinv*tgoal);
+            vcandidates.push_back(*itgrasp);
+        }
+
+        vector< vector<IkReturnPtr> > vvikreturns;
+        pmanip->GetIkSolver()->SolveAllBatch(vikparams, IKFO_IgnoreSelfCollisions|IKFO_IgnoreCustomFilters, vvikreturns);
+        vector< pair<dReal, int> > vcostgrasps;
+        vcostgrasps.reserve(vcandidates.size());
+        for(size_t i = 0; i < vcandidates.size(); ++i) {
+            if( vvikreturns.at(i).size() == 0 ) {
+                continue;
+            }
+            dReal fmincost = 1e30;
+            FOREACHC(itikreturn, vvikreturns[i]) {
+                vdiff = (*itikreturn)->_vsolution;
+                _robot->SubtractActiveDOFValues(vdiff, vcurvalues);
+                dReal fcost = 0;
+                FOREACHC(itdiff, vdiff) {
+                    fcost += *itdiff * *itdiff;
+                }
+                fmincost = min(fmincost, fcost);
+            }
+            vcostgrasps.push_back(make_pair(fmincost, vcandidates[i]));
+        }
+        if( bSortByCost ) {
+            std::stable_sort(vcostgrasps.begin(), vcostgrasps.end(), [](const pair<dReal, int>& a, const pair<dReal, int>& b) { return a.first < b.first; });
+        }
+        RAVELOG_DEBUG_FORMAT("ik prefilter kept %d/%d grasps, %d were out of reach", vcostgrasps.size()%vgrasppermutation.size()%(vgrasppermutation.size()-vcandidates.size()));
+        vgrasppermutation.resize(vcostgrasps.size());
+        for(size_t i = 0; i < vcostgrasps.size(); ++i) {
+            vgrasppermutation[i] = vcostgrasps[i].second;
+        }
+    }
+
 protected:
     inline boost::shared_ptr<TaskManipulation> shared_problem() {
         return boost::static_pointer_cast<TaskManipulation>(shared_from_this());
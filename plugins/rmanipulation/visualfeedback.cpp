@@ -16,11 +16,12 @@
 #include "commonmanipulation.h"
 #include <boost/algorithm/string/replace.hpp>
 
-/// samples rays from the projected OBB and returns true if the test function returns true
-/// for all the rays. Otherwise, returns false
-/// allowableoutliers - specifies the % of allowable outliying rays
-bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::function<bool(const Vector&)>& testfn,dReal allowableocclusion=0)
+/// samples the ray directions of the projected OBB in the camera coordinate system
+/// \param[out] vsamples the sampled directions, the order is the same as SampleProjectedOBBWithTest tests them
+/// \return the number of rays that can fail given allowableocclusion, the % of allowable outliying rays
+int SampleProjectedOBB(const OBB& obb, dReal delta, std::vector<Vector>& vsamples, dReal allowableocclusion=0)
 {
+    vsamples.resize(0);
     dReal fscalefactor = 0.95f; // have to make box smaller or else rays might miss
     Vector vpoints[8] = { obb.pos + fscalefactor*(obb.right*obb.extents.x + obb.up*obb.extents.y + obb.dir*obb.extents.z),
                           obb.pos + fscalefactor*(obb.right*obb.extents.x + obb.up*obb.extents.y - obb.dir*obb.extents.z),
@@ -95,11 +96,7 @@ bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::functi
             int numsteps = (int)(ftotalen/delta);
             Vector vdelta = (vcur2-vcur1)*(1.0f/numsteps), vcur = vcur1;
             for(int k = 0; k <= numsteps; ++k, vcur += vdelta) {
-
-                if( !testfn(vcur) ) {
-                    if( nallowableoutliers-- <= 0 )
-                        return false;
-                }
+                vsamples.push_back(vcur);
             }
         }
 
@@ -122,14 +119,27 @@ bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::functi
             int numsteps = (int)(ftotalen/delta);
             Vector vdelta = (vcur2-vcur1)*(1.0f/numsteps), vcur = vcur1;
             for(int k = 0; k <= numsteps; ++k, vcur += vdelta) {
-                if( !testfn(vcur) ) {
-                    if( nallowableoutliers-- <= 0 )
-                        return false;
-                }
+                vsamples.push_back(vcur);
             }
         }
     }
 
+    return nallowableoutliers;
+}
+
+/// samples rays from the projected OBB and returns true if the test function returns true
+/// for all the rays. Otherwise, returns false
+/// allowableoutliers - specifies the % of allowable outliying rays
+bool SampleProjectedOBBWithTest(const OBB& obb, dReal delta, const boost::function<bool(const Vector&)>& testfn,dReal allowableocclusion=0)
+{
+    std::vector<Vector> vsamples;
+    int nallowableoutliers = SampleProjectedOBB(obb, delta, vsamples, allowableocclusion);
+    FOREACHC(itsample, vsamples) {
+        if( !testfn(*itsample) ) {
+            if( nallowableoutliers-- <= 0 )
+                return false;
+        }
+    }
     return true;
 }
 
@@ -252,6 +262,9 @@ public:
 
             _ikreturn.reset(new IkReturn(IKRA_Success));
             _bSamplingRays = false;
+            _bCachedOcclusionValid = false;
+            _bCachedOccluded = false;
+            _fCachedSampleRayDensity = _fCachedAllowableOcclusion = 0;
             if( _vf->_bIgnoreSensorCollision && !!_vf->_sensorrobot ) {
                 _collisionfn = _vf->_targetlink->GetParent()->GetEnv()->RegisterCollisionCallback(boost::bind(&VisibilityConstraintFunction::_IgnoreCollisionCallback,this,_1,_2));
             }
@@ -352,27 +365,56 @@ public:
 
         /// check if any part of the environment or robot is in front of the camera blocking the object
         /// sample object's surface and shoot rays
+        ///
+        /// All the rays of an OBB are checked with one CollisionCheckerBase::CheckCollisionRays call, only rays that do not hit the target box are checked again individually to find out what they hit.
+        /// The result is cached for the last camera pose as long as no body of the environment changed.
         /// \param tCameraInTarget in target coordinate system
         bool IsOccluded(const TransformMatrix& tCameraInTarget, bool bOutputError, std::string& errormsg)
         {
-            KinBody::KinBodyStateSaver saver1(_ptargetbox), saver2(_vf->_targetlink->GetParent(),KinBody::Save_LinkEnable);
-            TransformMatrix tCameraInTargetinv = tCameraInTarget.inverse();
             Transform ttarget = _vf->_targetlink->GetTransform();
-            _ptargetbox->SetTransform(ttarget); // world
             Transform tworldcamera = ttarget*tCameraInTarget;  // tCameraInTarget is in targetLink coordinates
-            _ptargetbox->Enable(true);
-            SampleRaysScope srs(*this);
-            std::string occludingbodyandlinkname = "";
-            FOREACH(itobb,_vTargetLocalOBBs) {  // itobb is in targetlink coordinates
-                OBB cameraobb = geometry::TransformOBB(tCameraInTargetinv,*itobb);
-                // SampleProjectedOBBWithTest usually quits when first occlusion is found, so just passing occludingbodyandlinkname to _TestRay should return the initial occluding part.
-                if( !SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, boost::bind(&VisibilityConstraintFunction::_TestRay, this, _1, boost::ref(tworldcamera), boost::ref(occludingbodyandlinkname)),_vf->_fAllowableOcclusion) ) {
-                    RAVELOG_VERBOSE("box is occluded\n");
-                    errormsg = str(boost::format("{\"type\":\"pattern_occluded\", \"bodylinkname\":\"%s\"}")%occludingbodyandlinkname);
-                    return true;
+            _GetEnvironmentStamps(_vstampscurrent);
+            if( _bCachedOcclusionValid && _IsSameTransform(tworldcamera, _tCachedWorldCamera) && _IsSameTransform(ttarget, _tCachedTarget) && _fCachedSampleRayDensity == _vf->_fSampleRayDensity && _fCachedAllowableOcclusion == _vf->_fAllowableOcclusion && _vstampscurrent == _vCachedStamps ) {
+                if( _bCachedOccluded ) {
+                    errormsg = _cachedOcclusionError;
+                }
+                return _bCachedOccluded;
+            }
+
+            bool bOccluded = false;
+            std::string occlusionerror;
+            {
+                KinBody::KinBodyStateSaver saver1(_ptargetbox), saver2(_vf->_targetlink->GetParent(),KinBody::Save_LinkEnable);
+                TransformMatrix tCameraInTargetinv = tCameraInTarget.inverse();
+                _ptargetbox->SetTransform(ttarget); // world
+                _ptargetbox->Enable(true);
+                SampleRaysScope srs(*this);
+                std::string occludingbodyandlinkname = "";
+                FOREACH(itobb,_vTargetLocalOBBs) {  // itobb is in targetlink coordinates
+                    OBB cameraobb = geometry::TransformOBB(tCameraInTargetinv,*itobb);
+                    // _TestRaysBatch quits when the first occlusion that is not allowed is found, so occludingbodyandlinkname is set by the initial occluding part.
+                    if( !_TestRaysBatch(cameraobb, tworldcamera, occludingbodyandlinkname) ) {
+                        RAVELOG_VERBOSE("box is occluded\n");
+                        occlusionerror = str(boost::format("{\"type\":\"pattern_occluded\", \"bodylinkname\":\"%s\"}")%occludingbodyandlinkname);
+                        bOccluded = true;
+                        break;
+                    }
                 }
             }
-            return false;
+
+            // the savers restored the stamps of the target bodies, so the stamps taken before still describe the environment
+            _bCachedOcclusionValid = true;
+            _tCachedWorldCamera = tworldcamera;
+            _tCachedTarget = ttarget;
+            _fCachedSampleRayDensity = _vf->_fSampleRayDensity;
+            _fCachedAllowableOcclusion = _vf->_fAllowableOcclusion;
+            _vCachedStamps.swap(_vstampscurrent);
+            _bCachedOccluded = bOccluded;
+            _cachedOcclusionError = occlusionerror;
+            if( bOccluded ) {
+                errormsg = occlusionerror;
+            }
+            return bOccluded;
         }
 
         /// check if just the rigidly attached links of the gripper are in the way
@@ -394,12 +436,18 @@ public:
             TransformMatrix tcamerainv = tcamera.inverse();
             Transform ttarget = _vf->_targetlink->GetTransform();
             _ptargetbox->SetTransform(ttarget);
-            Transform tworldcamera = ttarget*tcamera;
             _ptargetbox->Enable(true);
             SampleRaysScope srs(*this);
             FOREACH(itobb,_vTargetLocalOBBs) {
                 OBB cameraobb = geometry::TransformOBB(tcamerainv,*itobb);
-                if( !SampleProjectedOBBWithTest(cameraobb, _vf->_fSampleRayDensity, boost::bind(&VisibilityConstraintFunction::_TestRayRigid, this, _1, boost::ref(tworldcamera),boost::ref(vattachedlinks)), 0.0f) ) {
+                SampleProjectedOBB(cameraobb, _vf->_fSampleRayDensity, _vsamples, 0.0f);
+                _vrays.resize(_vsamples.size());
+                for(size_t isample = 0; isample < _vsamples.size(); ++isample) {
+                    // the attached links are in the camera coordinate system
+                    dReal filen = 1/RaveSqrt(_vsamples[isample].lengthsqr3());
+                    _vrays[isample] = RAY((_vf->_fRayMinDist*filen)*_vsamples[isample],(200.0f*filen)*_vsamples[isample]);           // hardcoded test ray length of 200 meters
+                }
+                if( _vf->_robot->GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, KinBodyConstPtr(_vf->_robot), _vhitdistances, _vhitnormals, _vhitbodyids) > 0 ) {
                     return true;
                 }
             }
@@ -414,9 +462,7 @@ private:
         bool _TestRay(const Vector& v, const TransformMatrix& tcamera, std::string& errormsg)
         {
             RAY r;
-            dReal filen = 1/RaveSqrt(v.lengthsqr3());
-            r.dir = tcamera.rotate((200.0f*filen)*v);                     // hardcoded test ray length of 200 meters
-            r.pos = tcamera.trans + 0.5f*_vf->_fRayMinDist*r.dir;         // move the rays a little forward
+            _GetWorldRay(v, tcamera, r);
             if( !_vf->_robot->GetEnv()->CheckCollision(r,_report) ) {
                 return true;         // not supposed to happen, but it is OK
             }
@@ -478,17 +524,68 @@ private:
             }
         }
 
-        bool _TestRayRigid(const Vector& v, const TransformMatrix& tcamera, const vector<KinBody::LinkPtr>& vattachedlinks)
+        /// \brief returns the world ray that _TestRay checks for the direction v in the camera coordinate system
+        void _GetWorldRay(const Vector& v, const TransformMatrix& tcamera, RAY& r) const
         {
             dReal filen = 1/RaveSqrt(v.lengthsqr3());
-            RAY r((_vf->_fRayMinDist*filen)*v,(200.0f*filen)*v);           // hardcoded test ray length of 200 meters
-            if( _vf->_robot->GetEnv()->CheckCollision(r,KinBodyConstPtr(_vf->_robot),_report) ) {
-                //RAVELOG_INFO(str(boost::format("ray col: %s\n")%_report->__str__()));
-                return false;
+            r.dir = tcamera.rotate((200.0f*filen)*v);                     // hardcoded test ray length of 200 meters
+            r.pos = tcamera.trans + 0.5f*_vf->_fRayMinDist*r.dir;         // move the rays a little forward
+        }
+
+        /// \brief same as SampleProjectedOBBWithTest with _TestRay, except all the rays are first checked in one batch
+        ///
+        /// Rays hitting the target box are visible without looking at them further. The others are passed to _TestRay to
+        /// get the hit link and contact point, since hits on the target link have to be inside the target geometry.
+        /// \param cameraobb the target geometry in the camera coordinate system
+        /// \param tcamera is the camera in the world coordinate system
+        bool _TestRaysBatch(const OBB& cameraobb, const TransformMatrix& tcamera, std::string& errormsg)
+        {
+            int nallowableoutliers = SampleProjectedOBB(cameraobb, _vf->_fSampleRayDensity, _vsamples, _vf->_fAllowableOcclusion);
+            _vrays.resize(_vsamples.size());
+            for(size_t isample = 0; isample < _vsamples.size(); ++isample) {
+                _GetWorldRay(_vsamples[isample], tcamera, _vrays[isample]);
+            }
+            _vf->_robot->GetEnv()->GetCollisionChecker()->CheckCollisionRays(_vrays, KinBodyConstPtr(), _vhitdistances, _vhitnormals, _vhitbodyids);
+            int targetboxid = _ptargetbox->GetEnvironmentId();
+            for(size_t isample = 0; isample < _vsamples.size(); ++isample) {
+                if( _vhitdistances[isample] < 0 || _vhitbodyids[isample] == targetboxid ) {
+                    continue; // no hit is also accepted by _TestRay
+                }
+                if( !_TestRay(_vsamples[isample], tcamera, errormsg) ) {
+                    if( nallowableoutliers-- <= 0 ) {
+                        return false;
+                    }
+                }
             }
             return true;
         }
 
+        /// \brief gets the update stamps of all the bodies that can occlude the target, compared to know if a cached occlusion is still valid
+        void _GetEnvironmentStamps(std::vector<int>& vstamps)
+        {
+            _vf->_robot->GetEnv()->GetBodies(_vbodies);
+            vstamps.resize(0);
+            FOREACHC(itbody, _vbodies) {
+                if( *itbody == _ptargetbox ) {
+                    continue;
+                }
+                vstamps.push_back((*itbody)->GetEnvironmentId());
+                vstamps.push_back((*itbody)->GetUpdateStamp());
+                // enabling links does not change the update stamp, so hash the enabled state of the links
+                uint32_t enabledhash = 0;
+                FOREACHC(itlink, (*itbody)->GetLinks()) {
+                    enabledhash = enabledhash*31 + ((*itlink)->IsEnabled() ? 1 : 2);
+                }
+                vstamps.push_back((int)enabledhash);
+            }
+            _vbodies.resize(0);
+        }
+
+        static bool _IsSameTransform(const Transform& t0, const Transform& t1)
+        {
+            return (t0.trans-t1.trans).lengthsqr3() <= 1e-14 && RaveFabs(RaveFabs(t0.rot.dot(t1.rot)) - 1) <= 1e-12;
+        }
+
         CollisionAction _IgnoreCollisionCallback(CollisionReportPtr preport, bool IsCalledFromPhysicsEngine)
         {
             if( _bSamplingRays ) {
@@ -516,6 +613,20 @@ private:
         CollisionReportPtr _report;
         AABB _abTarget;         // local aabb in the targetlink coordinate system
         vector<Vector> _vconvexplanes3d; ///< the convex planes of the camera in the target link coordinate system
+        vector<Vector> _vsamples; ///< the sampled ray directions in the camera coordinate system
+        vector<RAY> _vrays;
+        vector<dReal> _vhitdistances;
+        vector<Vector> _vhitnormals;
+        vector<int> _vhitbodyids;
+        vector<KinBodyPtr> _vbodies;
+        vector<int> _vstampscurrent;
+
+        // the occlusion of the last camera pose checked by IsOccluded
+        bool _bCachedOcclusionValid, _bCachedOccluded;
+        Transform _tCachedWorldCamera, _tCachedTarget;
+        dReal _fCachedSampleRayDensity, _fCachedAllowableOcclusion;
+        vector<int> _vCachedStamps;
+        std::string _cachedOcclusionError;
         PlannerBase::PlannerParameters::CheckPathVelocityConstraintFn _oldfn;
     };
 
@@ -0,0 +1,371 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "rplanners.h"
+#include <boost/algorithm/string.hpp>
+
+/// \brief reuses the paths of previous queries. The closest stored path is connected to the query and its invalid
+/// sections are repaired with local plans, a full plan is only done if no stored path can be repaired.
+class ExperiencePlanner : public PlannerBase
+{
+    /// \brief a successful path, the first and last waypoints are the start and goal of the query
+    struct Experience
+    {
+        std::vector<dReal> vpath; ///< dof*numpoints
+    };
+    typedef std::list<Experience> ExperienceLibrary;
+
+public:
+    ExperiencePlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
+    {
+        __description = ":Interface Author: agent\n\n\
+Stores the successful paths of a robot and configuration space. For a new query the stored paths whose start and goal \
+are closest to the query are retrieved, connected to the query start and goal, and every invalid section is replaced \
+by a local plan between the closest valid waypoints around it. If none of the candidates can be repaired, the query is \
+planned from scratch. Local and full plans use the planner given with SetPlanner (default BiRRT) with the same \
+parameters as this planner.";
+        RegisterCommand("SetPlanner",boost::bind(&ExperiencePlanner::_SetPlannerCommand,this,_1,_2),
+                        "sets the planner used for repairing and for planning from scratch");
+        RegisterCommand("SetLibraryParameters",boost::bind(&ExperiencePlanner::_SetLibraryParametersCommand,this,_1,_2),
+                        "\"maxpaths [maxcandidates]\". maxpaths is the maximum number of paths stored per robot, the oldest are removed first. maxcandidates is the number of stored paths tried before planning from scratch.");
+        RegisterCommand("ClearLibrary",boost::bind(&ExperiencePlanner::_ClearLibraryCommand,this,_1,_2),
+                        "removes all the stored paths");
+        RegisterCommand("GetLibraryInfo",boost::bind(&ExperiencePlanner::_GetLibraryInfoCommand,this,_1,_2),
+                        "returns \"numpaths numretrieved numrepaired numplanned\". numretrieved counts the queries solved without any local plan, numrepaired the ones that needed local plans, and numplanned the ones planned from scratch.");
+        _plannername = "BiRRT";
+        _nMaxPaths = 1000;
+        _nMaxCandidates = 3;
+        _nNumRetrieved = _nNumRepaired = _nNumPlanned = 0;
+    }
+    virtual ~ExperiencePlanner() {
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new PlannerParameters());
+        _parameters->copy(pparams);
+        return _InitPlan(pbase);
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, std::istream& isParameters)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new PlannerParameters());
+        isParameters >> *_parameters;
+        return _InitPlan(pbase);
+    }
+
+    virtual PlannerParametersConstPtr GetParameters() const {
+        return _parameters;
+    }
+
+    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        if(!_parameters) {
+            return PlannerStatus("ExperiencePlanner::PlanPath - Error, planner not initialized\n", PS_Failed);
+        }
+
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _nPlanStartTime = utils::GetMilliTime();
+        const int dof = _parameters->GetDOF();
+        ExperienceLibrary& library = _mapLibraries[_robotkey];
+
+        // the closest stored paths given the distance between their start and goal and the closest query start and goal
+        std::vector< std::pair<dReal, ExperienceLibrary::iterator> > vcandidates;
+        FOREACH(itexperience, library) {
+            int numpoints = (int)itexperience->vpath.size()/dof;
+            std::vector<dReal> vexpstart(itexperience->vpath.begin(), itexperience->vpath.begin()+dof), vexpgoal(itexperience->vpath.end()-dof, itexperience->vpath.end());
+            std::pair<dReal, int> beststart = _FindClosest(vexpstart, _parameters->vinitialconfig);
+            std::pair<dReal, int> bestgoal = _FindClosest(vexpgoal, _parameters->vgoalconfig);
+            if( numpoints >= 2 && beststart.second >= 0 && bestgoal.second >= 0 ) {
+                vcandidates.push_back(std::make_pair(beststart.first+bestgoal.first, itexperience));
+            }
+        }
+        size_t numcandidates = min((size_t)_nMaxCandidates, vcandidates.size());
+        std::partial_sort(vcandidates.begin(), vcandidates.begin()+numcandidates, vcandidates.end(), _CompareCandidates);
+
+        std::vector<dReal> vpath;
+        int nlocalplans = 0;
+        bool bFound = false, bStore = true;
+        for(size_t icandidate = 0; icandidate < numcandidates; ++icandidate) {
+            if( _IsPlanningTimeExpired() ) {
+                break;
+            }
+            const std::vector<dReal>& vexppath = vcandidates[icandidate].second->vpath;
+            std::vector<dReal> vexpstart(vexppath.begin(), vexppath.begin()+dof), vexpgoal(vexppath.end()-dof, vexppath.end());
+            int istart = _FindClosest(vexpstart, _parameters->vinitialconfig).second;
+            int igoal = _FindClosest(vexpgoal, _parameters->vgoalconfig).second;
+
+            // replace the stored start and goal with the ones of the query
+            vpath = vexppath;
+            std::copy(_parameters->vinitialconfig.begin()+istart*dof, _parameters->vinitialconfig.begin()+(istart+1)*dof, vpath.begin());
+            std::copy(_parameters->vgoalconfig.begin()+igoal*dof, _parameters->vgoalconfig.begin()+(igoal+1)*dof, vpath.end()-dof);
+            int nlocal = 0;
+            PlannerStatus repairstatus = _RepairPath(vpath, nlocal);
+            nlocalplans += nlocal;
+            if( repairstatus.GetStatusCode() == PS_Interrupted ) {
+                return repairstatus;
+            }
+            if( repairstatus.GetStatusCode() & PS_HasSolution ) {
+                bFound = true;
+                if( nlocal == 0 ) {
+                    ++_nNumRetrieved;
+                    bStore = false;
+                }
+                else {
+                    // a stored path that needed repairing is replaced by the repaired one
+                    ++_nNumRepaired;
+                    library.erase(vcandidates[icandidate].second);
+                }
+                break;
+            }
+            RAVELOG_DEBUG_FORMAT("env=%d, could not repair candidate %d/%d: %s", GetEnv()->GetId()%icandidate%numcandidates%repairstatus.description);
+        }
+
+        if( !bFound ) {
+            PlannerStatus planstatus = _PlanLocal(_parameters->vinitialconfig, _parameters->vgoalconfig, vpath);
+            if( planstatus.GetStatusCode() == PS_Interrupted ) {
+                return planstatus;
+            }
+            if( !(planstatus.GetStatusCode() & PS_HasSolution) ) {
+                std::string description = str(boost::format(_("env=%d, plan failed after trying %d stored paths: %s"))%GetEnv()->GetId()%numcandidates%planstatus.description);
+                RAVELOG_WARN(description);
+                return PlannerStatus(description, PS_Failed);
+            }
+            ++_nNumPlanned;
+        }
+
+        if( bStore ) {
+            library.push_back(Experience());
+            library.back().vpath = vpath;
+            while( (int)library.size() > _nMaxPaths ) {
+                library.pop_front();
+            }
+        }
+
+        if( ptraj->GetConfigurationSpecification().GetDOF() == 0 ) {
+            ptraj->Init(_parameters->_configurationspecification);
+        }
+        ptraj->Insert(ptraj->GetNumWaypoints(), vpath, _parameters->_configurationspecification);
+        std::string description = str(boost::format(_("env=%d, plan success, %s with %d local plans, path=%d points, stored paths=%d, computation time=%fs\n"))%GetEnv()->GetId()%(bFound ? "reused a stored path" : "planned from scratch")%nlocalplans%ptraj->GetNumWaypoints()%library.size()%(0.001f*(float)(utils::GetMilliTime()-_nPlanStartTime)));
+        RAVELOG_DEBUG(description);
+        PlannerStatus status = _ProcessPostPlanners(_robot,ptraj);
+        status.description = description;
+        return status;
+    }
+
+protected:
+    bool _InitPlan(RobotBasePtr pbase)
+    {
+        _parameters->Validate();
+        _robot = pbase;
+        const int dof = _parameters->GetDOF();
+        if( (int)_parameters->vinitialconfig.size() % dof || (int)_parameters->vgoalconfig.size() % dof || _parameters->vinitialconfig.size() == 0 || _parameters->vgoalconfig.size() == 0 ) {
+            RAVELOG_ERROR_FORMAT("env=%d, initial or goal configurations have wrong dimensions", GetEnv()->GetId());
+            return false;
+        }
+        if( !RaveHasInterface(PT_Planner, _plannername) ) {
+            RAVELOG_WARN_FORMAT("env=%d, planner %s does not exist", GetEnv()->GetId()%_plannername);
+            return false;
+        }
+
+        // the stored paths are only valid for the same robot and configuration space
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        if( !!_robot ) {
+            ss << _robot->GetKinematicsGeometryHash() << " ";
+        }
+        ss << _parameters->_configurationspecification;
+        _robotkey = utils::GetMD5HashString(ss.str());
+        return true;
+    }
+
+    static bool _CompareCandidates(const std::pair<dReal, ExperienceLibrary::iterator>& c0, const std::pair<dReal, ExperienceLibrary::iterator>& c1)
+    {
+        return c0.first < c1.first;
+    }
+
+    /// \brief returns the distance to and the index of the configuration of vconfigs closest to q
+    std::pair<dReal, int> _FindClosest(const std::vector<dReal>& q, const std::vector<dReal>& vconfigs) const
+    {
+        const int dof = _parameters->GetDOF();
+        std::pair<dReal, int> best(std::numeric_limits<dReal>::infinity(), -1);
+        std::vector<dReal> vconfig(dof);
+        for(size_t index = 0; index < vconfigs.size(); index += dof) {
+            std::copy(vconfigs.begin()+index, vconfigs.begin()+index+dof, vconfig.begin());
+            dReal fdist = _parameters->_distmetricfn(q, vconfig);
+            if( fdist < best.first ) {
+                best = std::make_pair(fdist, (int)(index/dof));
+            }
+        }
+        return best;
+    }
+
+    /// \brief replaces every invalid section of vpath with a local plan between the closest valid waypoints around it
+    ///
+    /// \param nlocalplans set to the number of local plans
+    PlannerStatus _RepairPath(std::vector<dReal>& vpath, int& nlocalplans)
+    {
+        const int dof = _parameters->GetDOF();
+        nlocalplans = 0;
+        std::vector<dReal> vprev(dof), vcur(dof), vlocalpath;
+        std::vector<dReal> vrepaired(vpath.begin(), vpath.begin()+dof);
+        int numpoints = (int)vpath.size()/dof;
+        int ipoint = 0; // last waypoint in vrepaired
+        PlannerParameters::StateSaver savestate(_parameters);
+        while( ipoint+1 < numpoints ) {
+            std::copy(vpath.begin()+ipoint*dof, vpath.begin()+(ipoint+1)*dof, vprev.begin());
+            std::copy(vpath.begin()+(ipoint+1)*dof, vpath.begin()+(ipoint+2)*dof, vcur.begin());
+            // checking the goal too since it was not part of the stored path
+            IntervalType interval = ipoint+2 == numpoints ? IT_Closed : IT_OpenStart;
+            if( _parameters->CheckPathAllConstraints(vprev, vcur, std::vector<dReal>(), std::vector<dReal>(), 0, interval) == 0 ) {
+                vrepaired.insert(vrepaired.end(), vcur.begin(), vcur.end());
+                ++ipoint;
+                continue;
+            }
+
+            // the next valid waypoint is where the local plan ends, the goal is always valid
+            int inext = ipoint+1;
+            while( inext+1 < numpoints ) {
+                std::copy(vpath.begin()+inext*dof, vpath.begin()+(inext+1)*dof, vcur.begin());
+                if( _parameters->CheckPathAllConstraints(vcur, vcur, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) == 0 ) {
+                    break;
+                }
+                ++inext;
+            }
+            std::copy(vpath.begin()+inext*dof, vpath.begin()+(inext+1)*dof, vcur.begin());
+            PlannerStatus status = _PlanLocal(vprev, vcur, vlocalpath);
+            ++nlocalplans;
+            if( !(status.GetStatusCode() & PS_HasSolution) ) {
+                return status;
+            }
+            // the first point of the local path is already in vrepaired
+            vrepaired.insert(vrepaired.end(), vlocalpath.begin()+dof, vlocalpath.end());
+            ipoint = inext;
+        }
+        vpath.swap(vrepaired);
+        return PlannerStatus(PS_HasSolution);
+    }
+
+    /// \brief plans from any of vinitialconfigs to any of vgoalconfigs with the planner and the parameters of this planner
+    ///
+    /// \param vpath the waypoints of the plan
+    PlannerStatus _PlanLocal(const std::vector<dReal>& vinitialconfigs, const std::vector<dReal>& vgoalconfigs, std::vector<dReal>& vpath)
+    {
+        vpath.resize(0);
+        PlannerParametersPtr params(new PlannerParameters());
+        params->copy(_parameters);
+        params->vinitialconfig = vinitialconfigs;
+        params->vgoalconfig = vgoalconfigs;
+        params->_sPostProcessingPlanner = ""; // post processing is done once on the result
+        params->_sPostProcessingParameters.resize(0);
+        if( _parameters->_nMaxPlanningTime > 0 ) {
+            int nremaining = _parameters->_nMaxPlanningTime - (int)(utils::GetMilliTime()-_nPlanStartTime);
+            if( nremaining <= 0 ) {
+                return PlannerStatus("time exceeded", PS_Failed);
+            }
+            params->_nMaxPlanningTime = nremaining;
+        }
+
+        if( !_planner ) {
+            _planner = RaveCreatePlanner(GetEnv(), _plannername);
+            if( !_planner ) {
+                return PlannerStatus(str(boost::format("failed to create planner %s")%_plannername), PS_Failed);
+            }
+        }
+        if( !_planner->InitPlan(_robot, params) ) {
+            return PlannerStatus(str(boost::format("failed to initialize planner %s")%_plannername), PS_Failed);
+        }
+        UserDataPtr callbackhandle = _planner->RegisterPlanCallback(boost::bind(&ExperiencePlanner::_CallCallbacks, this, _1));
+        if( !_localtraj ) {
+            _localtraj = RaveCreateTrajectory(GetEnv(), "");
+        }
+        _localtraj->Init(_parameters->_configurationspecification);
+        PlannerStatus status = _planner->PlanPath(_localtraj);
+        if( status.GetStatusCode() & PS_HasSolution ) {
+            _localtraj->GetWaypoints(0, _localtraj->GetNumWaypoints(), vpath, _parameters->_configurationspecification);
+        }
+        return status;
+    }
+
+    inline bool _IsPlanningTimeExpired() const {
+        return _parameters->_nMaxPlanningTime > 0 && utils::GetMilliTime()-_nPlanStartTime >= (uint32_t)_parameters->_nMaxPlanningTime;
+    }
+
+    bool _SetPlannerCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::string plannername;
+        sinput >> plannername;
+        if( !sinput || !RaveHasInterface(PT_Planner, plannername) ) {
+            return false;
+        }
+        _plannername = plannername;
+        _planner.reset();
+        return true;
+    }
+
+    bool _SetLibraryParametersCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sinput >> _nMaxPaths;
+        if( !sinput ) {
+            return false;
+        }
+        int nMaxCandidates = 0;
+        if( !!(sinput >> nMaxCandidates) ) {
+            _nMaxCandidates = nMaxCandidates;
+        }
+        FOREACH(itlibrary, _mapLibraries) {
+            while( (int)itlibrary->second.size() > _nMaxPaths ) {
+                itlibrary->second.pop_front();
+            }
+        }
+        return true;
+    }
+
+    bool _ClearLibraryCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _mapLibraries.clear();
+        _nNumRetrieved = _nNumRepaired = _nNumPlanned = 0;
+        return true;
+    }
+
+    bool _GetLibraryInfoCommand(std::ostream& sout, std::istream& sinput)
+    {
+        size_t numpaths = 0;
+        FOREACHC(itlibrary, _mapLibraries) {
+            numpaths += itlibrary->second.size();
+        }
+        sout << numpaths << " " << _nNumRetrieved << " " << _nNumRepaired << " " << _nNumPlanned;
+        return true;
+    }
+
+    PlannerParametersPtr _parameters;
+    RobotBasePtr _robot;
+    std::string _robotkey; ///< hash of the robot and configuration space of the current query
+    std::map<std::string, ExperienceLibrary> _mapLibraries; ///< the stored paths for every robot key, newest at the back
+
+    std::string _plannername;
+    PlannerBasePtr _planner; ///< plans the local repairs and from scratch
+    TrajectoryBasePtr _localtraj;
+    int _nMaxPaths, _nMaxCandidates;
+    int _nNumRetrieved, _nNumRepaired, _nNumPlanned;
+    uint32_t _nPlanStartTime;
+};
+
+PlannerBasePtr CreateExperiencePlanner(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return PlannerBasePtr(new ExperiencePlanner(penv, sinput));
+}
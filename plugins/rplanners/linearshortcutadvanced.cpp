@@ -27,6 +27,7 @@ public:
     {
         __description = ":Interface Author: Rosen Diankov\n\npath optimizer using linear shortcuts.";
         _linearretimer = RaveCreatePlanner(GetEnv(), "LinearTrajectoryRetimer");
+        _nPlanStartTime = 0;
     }
     virtual ~ShortcutLinearPlanner() {
     }
@@ -87,7 +88,13 @@ public:
             statesaver.reset(new RobotBase::RobotStateSaver(_probot));
         }
 
+        // should always set the seed since smoother can be called with different trajectories even though InitPlan was only called once
+        if( !!_puniformsampler ) {
+            _puniformsampler->SetSeed(_parameters->_nRandomGeneratorSeed);
+        }
+
         uint32_t basetime = utils::GetMilliTime();
+        _nPlanStartTime = basetime;
         PlannerParametersConstPtr parameters = GetParameters();
 
         // if( IS_DEBUGLEVEL(Level_Verbose) ) {
@@ -199,29 +206,45 @@ protected:
         std::stringstream ss;
         ss << std::setprecision(std::numeric_limits<dReal>::digits10 + 1);
 #endif
+        PlannerProgress progress;
+        // with a shortcut time limit, several random pairs are compared and the one that promises the largest reduction in path length is tried
+        const int nsamples = _parameters->_nMaxShortcutTime > 0 ? 4 : 1;
         // while(iiter > 0  && nrejected < (int)listpath.size()+4 && listpath.size() > 2 ) {
         while(iiter > 0 && listpath.size() > 2 ) {
+            if( _IsShortcutTimeExpired() ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, iter=%d/%d, shortcut time of %dms expired", GetEnv()->GetId()%itercount%numiters%_parameters->_nMaxShortcutTime);
+                break;
+            }
             --iiter;
             ++itercount;
 
-            // pick a random node on the listpath, and a random jump ahead
-            uint32_t endIndex = 2+(_puniformsampler->SampleSequenceOneUInt32()%((uint32_t)listpath.size()-2));
-            uint32_t startIndex = _puniformsampler->SampleSequenceOneUInt32()%(endIndex-1);
+            dReal totaldistance = 0, expectedtotaldistance = 0;
+            for(int isample = 0; isample < nsamples; ++isample) {
+                // pick a random node on the listpath, and a random jump ahead
+                uint32_t endIndex = 2+(_puniformsampler->SampleSequenceOneUInt32()%((uint32_t)listpath.size()-2));
+                uint32_t startIndex = _puniformsampler->SampleSequenceOneUInt32()%(endIndex-1);
 #ifdef PROGRESS_DEBUG
-            RAVELOG_DEBUG_FORMAT("env=%d, iter=%d/%d, start shortcutting with i0=%d; i1=%d", GetEnv()->GetId()%itercount%numiters%startIndex%endIndex);
+                RAVELOG_DEBUG_FORMAT("env=%d, iter=%d/%d, start shortcutting with i0=%d; i1=%d", GetEnv()->GetId()%itercount%numiters%startIndex%endIndex);
 #endif
 
-            itstartnode = listpath.begin();
-            advance(itstartnode, startIndex);
-            itendnode = itstartnode;
-            dReal totaldistance = 0;
-            for(uint32_t j = 0; j < endIndex-startIndex; ++j) {
-                ++itendnode;
-                totaldistance += itendnode->second;
+                list< std::pair< vector<dReal>, dReal> >::iterator itsamplestartnode = listpath.begin();
+                advance(itsamplestartnode, startIndex);
+                list< std::pair< vector<dReal>, dReal> >::iterator itsampleendnode = itsamplestartnode;
+                dReal sampletotaldistance = 0;
+                for(uint32_t j = 0; j < endIndex-startIndex; ++j) {
+                    ++itsampleendnode;
+                    sampletotaldistance += itsampleendnode->second;
+                }
+                dReal sampleexpectedtotaldistance = parameters->_distmetricfn(itsamplestartnode->first, itsampleendnode->first);
+                if( isample == 0 || sampletotaldistance - sampleexpectedtotaldistance > totaldistance - expectedtotaldistance ) {
+                    itstartnode = itsamplestartnode;
+                    itendnode = itsampleendnode;
+                    totaldistance = sampletotaldistance;
+                    expectedtotaldistance = sampleexpectedtotaldistance;
+                }
             }
             nrejected++;
 
-            dReal expectedtotaldistance = parameters->_distmetricfn(itstartnode->first, itendnode->first);
             if( expectedtotaldistance > totaldistance - 0.1*parameters->_fStepLength ) {
                 // The shortest possible distance between the start and the end of the shortcut (according to
                 // _distmetricfn) is not really short so reject it.
@@ -308,6 +331,12 @@ protected:
             nrejected = 0;
 
             ++numshortcuts;
+            progress._iteration = itercount;
+            progress._fCost = _ComputePathLength(listpath);
+            progress._nElapsedTime = utils::GetMilliTime() - _nPlanStartTime;
+            if( _CallCallbacks(progress) == PA_Interrupt ) {
+                break;
+            }
 #ifdef PROGRESS_DEBUG
             dReal newdistance = 0;
             FOREACH(ittempnode, listpath) {
@@ -352,6 +381,10 @@ protected:
 #endif
 
         for( int iiter = 0; iiter < numiters; ++iiter ) {
+            if( _IsShortcutTimeExpired() ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, iter=%d/%d, shortcut time of %dms expired", GetEnv()->GetId()%iiter%numiters%_parameters->_nMaxShortcutTime);
+                break;
+            }
             ++itercount;
             if( listpath.size() <= 2 ) {
                 return;
@@ -397,6 +430,8 @@ protected:
             }
 
             progress._iteration = iiter;
+            progress._fCost = _ComputePathLength(listpath);
+            progress._nElapsedTime = utils::GetMilliTime() - _nPlanStartTime;
             if( _CallCallbacks(progress) == PA_Interrupt ) {
                 return;
             }
@@ -548,6 +583,22 @@ protected:
         return;
     }
 
+    /// \brief true if TrajectoryTimingParameters::_nMaxShortcutTime is set and has passed since PlanPath started
+    inline bool _IsShortcutTimeExpired() const
+    {
+        return _parameters->_nMaxShortcutTime > 0 && utils::GetMilliTime() - _nPlanStartTime >= _parameters->_nMaxShortcutTime;
+    }
+
+    /// \brief sum of the distances stored in listpath, reported as the cost in PlannerProgress
+    dReal _ComputePathLength(const list< std::pair< vector<dReal>, dReal> >& listpath) const
+    {
+        dReal fLength = 0;
+        FOREACHC(itnode, listpath) {
+            fLength += itnode->second;
+        }
+        return fLength;
+    }
+
     /// \brief Subsample the given linear trajectory according to robot config resolution. Subsampling on each linear
     /// segment is done via calling to _neighstatefn. If this _neighstatefn call returns a config that deviates from the
     /// original stright line, we give up subsampling that segment and continue to the next one. (We do not perform any
@@ -671,6 +722,7 @@ protected:
     TrajectoryTimingParametersPtr _parameters;
     SpaceSamplerBasePtr _puniformsampler, _logginguniformsampler;
     uint32_t _fileindex;
+    uint32_t _nPlanStartTime; ///< ms when PlanPath started, used with TrajectoryTimingParameters::_nMaxShortcutTime
 
     RobotBasePtr _probot;
     PlannerBasePtr _linearretimer;
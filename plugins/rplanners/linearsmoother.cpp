@@ -113,6 +113,11 @@ public:
             statesaver.reset(new RobotBase::RobotStateSaver(_probot));
         }
 
+        // should always set the seed since smoother can be called with different trajectories even though InitPlan was only called once
+        if( !!_puniformsampler ) {
+            _puniformsampler->SetSeed(_parameters->_nRandomGeneratorSeed);
+        }
+
         uint32_t basetime = utils::GetMilliTime();
         PlannerParametersConstPtr parameters = GetParameters();
 
@@ -399,18 +399,11 @@ public:
                     _afill[itmanipinfo->vuseddofindices.at(index)] = ac.at(itmanipinfo->vconfigindices[index]);
                 }
 
-                int endeffindex = itmanipinfo->plink->GetIndex();
-                KinBody::KinBodyStateSaver saver(probot, KinBody::Save_LinkTransformation|KinBody::Save_LinkVelocities);
+                KinBody::KinBodyStateSaver saver(probot, KinBody::Save_LinkTransformation);
 
-                // Set the robot to the new state
+                // Set the robot to the new state, the end effector velocity and acceleration come from the kinematics so the dof velocities do not need to be set
                 probot->SetDOFValues(qfillactive, KinBody::CLA_CheckLimits, itmanipinfo->vuseddofindices);
-                probot->SetDOFVelocities(_vfillactive, KinBody::CLA_CheckLimits, itmanipinfo->vuseddofindices);
-                probot->GetLinkVelocities(endeffvels);
-                probot->GetLinkAccelerations(_afill,endeffaccs);
-                endeffvellin = endeffvels.at(endeffindex).first;
-                endeffvelang = endeffvels.at(endeffindex).second;
-                endeffacclin = endeffaccs.at(endeffindex).first;
-                endeffaccang = endeffaccs.at(endeffindex).second;
+                _ComputeEndEffectorVelocityAcceleration(*itmanipinfo, _vfillactive, _afill, endeffvellin, endeffvelang, endeffacclin, endeffaccang);
                 Transform R = itmanipinfo->plink->GetTransform();
 
                 FOREACH(itpoint, itmanipinfo->checkpoints) {
@@ -683,18 +676,11 @@ public:
                 _afill[itmanipinfo->vuseddofindices.at(index)] = ac.at(itmanipinfo->vconfigindices[index]);
             }
 
-            int endeffindex = itmanipinfo->plink->GetIndex();
-            KinBody::KinBodyStateSaver saver(probot, KinBody::Save_LinkTransformation|KinBody::Save_LinkVelocities);
+            KinBody::KinBodyStateSaver saver(probot, KinBody::Save_LinkTransformation);
 
-            // Set the robot to the new state
+            // Set the robot to the new state, the end effector velocity and acceleration come from the kinematics so the dof velocities do not need to be set
             probot->SetDOFValues(qfillactive, KinBody::CLA_CheckLimits, itmanipinfo->vuseddofindices);
-            probot->SetDOFVelocities(_vfillactive, KinBody::CLA_CheckLimits, itmanipinfo->vuseddofindices);
-            probot->GetLinkVelocities(endeffvels);
-            probot->GetLinkAccelerations(_afill,endeffaccs);
-            endeffvellin = endeffvels.at(endeffindex).first;
-            endeffvelang = endeffvels.at(endeffindex).second;
-            endeffacclin = endeffaccs.at(endeffindex).first;
-            endeffaccang = endeffaccs.at(endeffindex).second;
+            _ComputeEndEffectorVelocityAcceleration(*itmanipinfo, _vfillactive, _afill, endeffvellin, endeffvelang, endeffacclin, endeffaccang);
             Transform R = itmanipinfo->plink->GetTransform();
 
             FOREACH(itpoint, itmanipinfo->checkpoints) {
@@ -936,6 +922,43 @@ public:
     }
 
 private:
+    /// \brief computes the velocity and acceleration of the origin of the end effector link at the current configuration of the robot
+    ///
+    /// Uses v = J*qd and a = J*qdd + qd^T*H*qd with the jacobians and hessians of the end effector link only, so unlike
+    /// GetLinkVelocities/GetLinkAccelerations the dof velocities do not have to be set and the other links are not computed.
+    /// \param vdofvelocities the velocities of manipinfo.vuseddofindices
+    /// \param vdofaccelerations the accelerations of all the robot dofs, only manipinfo.vuseddofindices are read
+    void _ComputeEndEffectorVelocityAcceleration(const ManipConstraintInfo2& manipinfo, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccelerations, Vector& vellin, Vector& velang, Vector& acclin, Vector& accang)
+    {
+        KinBodyPtr probot = manipinfo.plink->GetParent();
+        int endeffindex = manipinfo.plink->GetIndex();
+        Vector vorigin = manipinfo.plink->GetTransform().trans;
+        probot->ComputeJacobianTranslation(endeffindex, vorigin, _vtransjacobian, manipinfo.vuseddofindices);
+        probot->ComputeJacobianAxisAngle(endeffindex, _vangularjacobian, manipinfo.vuseddofindices);
+        probot->ComputeHessianTranslation(endeffindex, vorigin, _vtranshessian, manipinfo.vuseddofindices);
+        probot->ComputeHessianAxisAngle(endeffindex, _vangularhessian, manipinfo.vuseddofindices);
+
+        size_t ndof = manipinfo.vuseddofindices.size();
+        vellin = Vector(); velang = Vector(); acclin = Vector(); accang = Vector();
+        for(size_t j = 0; j < 3; ++j) {
+            for(size_t k = 0; k < ndof; ++k) {
+                dReal fdofaccel = vdofaccelerations.at(manipinfo.vuseddofindices[k]);
+                vellin[j] += _vtransjacobian[j*ndof+k]*vdofvelocities[k];
+                velang[j] += _vangularjacobian[j*ndof+k]*vdofvelocities[k];
+                acclin[j] += _vtransjacobian[j*ndof+k]*fdofaccel;
+                accang[j] += _vangularjacobian[j*ndof+k]*fdofaccel;
+                // H[i,j,k] = hessian[k+DOF*(j+3*i)]
+                dReal ftranshessian = 0, fangularhessian = 0;
+                for(size_t i = 0; i < ndof; ++i) {
+                    ftranshessian += vdofvelocities[i]*_vtranshessian[k+ndof*(j+3*i)];
+                    fangularhessian += vdofvelocities[i]*_vangularhessian[k+ndof*(j+3*i)];
+                }
+                acclin[j] += ftranshessian*vdofvelocities[k];
+                accang[j] += fangularhessian*vdofvelocities[k];
+            }
+        }
+    }
+
     EnvironmentBasePtr _penv;
     std::string _manipname;
     std::vector<KinBodyPtr> listUsedBodies;
@@ -946,8 +969,8 @@ private:
     std::list< ManipConstraintInfo2 > _listCheckManips; ///< the manipulators and the points on their end efffectors to check for velocity and acceleration constraints
     std::vector<dReal> ac, qfillactive, _vfillactive; // the active DOF
     std::vector<dReal> _afill; // full robot DOF
-    std::vector<std::pair<Vector,Vector> > endeffvels, endeffaccs;
     std::vector<dReal> _vtransjacobian, _vangularjacobian, _vbestvels2, _vbestaccels2;
+    std::vector<dReal> _vtranshessian, _vangularhessian;
     std::vector<dReal> _vdotproducts, _vscalingfactors, _vdofvalues, _vdofvelocities, _vdofaccelerations;
     std::vector<int> _vindices;
 //@}
@@ -36,6 +36,15 @@ public:
     typedef boost::shared_ptr<ParabolicGroupInfo> ParabolicGroupInfoPtr;
     typedef boost::shared_ptr<ParabolicGroupInfo const> ParabolicGroupInfoConstPtr;
 
+    /// \brief buffers used for computing the minimum times in one thread
+    class MinimumTimeWorkspace
+    {
+public:
+        RampOptimizer::ParabolicInterpolator interpolator;
+        std::vector<dReal> v0pos, v0vel, v1pos, v1vel;
+        std::vector<RampOptimizer::RampND> rampndVect;
+    };
+
     ParabolicTrajectoryRetimer2(EnvironmentBasePtr penv, std::istream& sinput) : TrajectoryRetimer2(penv, sinput)
     {
         __description = ":Interface Author: Rosen Diankov\n\nSimple parabolic trajectory re-timing while passing through all the waypoints, waypoints will not be modified. This assumes all waypoints have velocity 0 (unless the start and final points are forced). Overwrites the velocities and timestamps of input trajectory.";
@@ -204,6 +213,60 @@ protected:
         }
     }
 
+    bool _InitParallelMinimumTime(int numthreads, std::vector< std::list<MinimumTimeFn> >& vlistmintimefns)
+    {
+        if( _bmanipconstraints ) {
+            // checking manip constraints sets the robot state
+            return false;
+        }
+        FOREACHC(itinfo, _listgroupinfo) {
+            if( (*itinfo)->gpos.name.compare(0, 12, "joint_values") != 0 ) {
+                return false;
+            }
+        }
+        if( (int)_vminimumtimeworkspaces.size() < numthreads ) {
+            _vminimumtimeworkspaces.resize(numthreads);
+        }
+        vlistmintimefns.resize(numthreads);
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            if( !_vminimumtimeworkspaces[ithread] ) {
+                _vminimumtimeworkspaces[ithread].reset(new MinimumTimeWorkspace());
+            }
+            _vminimumtimeworkspaces[ithread]->interpolator.Initialize(_parameters->GetDOF(), GetEnv()->GetId());
+            vlistmintimefns[ithread].clear();
+            FOREACHC(itinfo, _listgroupinfo) {
+                vlistmintimefns[ithread].push_back(boost::bind(&ParabolicTrajectoryRetimer2::_ComputeMinimumTimeJointValuesWorkspace,this,_vminimumtimeworkspaces[ithread],*itinfo,_1,_2,_3,_4));
+            }
+        }
+        return true;
+    }
+
+    /// \brief same as _ComputeMinimumTimeJointValues without manip constraints, but only uses the given workspace so that it can run concurrently
+    dReal _ComputeMinimumTimeJointValuesWorkspace(boost::shared_ptr<MinimumTimeWorkspace> workspace, GroupInfoConstPtr info, std::vector<dReal>::const_iterator itorgdiff, std::vector<dReal>::const_iterator itdataprev, std::vector<dReal>::const_iterator itdata, bool bUseEndVelocity)
+    {
+        workspace->v0pos.resize(info->gpos.dof);
+        workspace->v1pos.resize(info->gpos.dof);
+        for (int i = 0; i < info->gpos.dof; ++i) {
+            workspace->v0pos[i] = *(itdataprev + info->gpos.offset + i);
+            workspace->v1pos[i] = workspace->v0pos[i] + *(itorgdiff + info->orgposoffset + i);
+        }
+        workspace->v0vel.resize(info->gvel.dof);
+        workspace->v1vel.resize(info->gvel.dof);
+        for (int i = 0; i < info->gvel.dof; ++i) {
+            workspace->v0vel[i] = *(itdataprev+info->gvel.offset + i);
+            workspace->v1vel[i] = bUseEndVelocity ? *(itdata+info->gvel.offset + i) : 0;
+        }
+
+        if( !workspace->interpolator.ComputeArbitraryVelNDTrajectory(workspace->v0pos, workspace->v1pos, workspace->v0vel, workspace->v1vel, info->_vConfigLowerLimit, info->_vConfigUpperLimit, info->_vConfigVelocityLimit, info->_vConfigAccelerationLimit, workspace->rampndVect, false) ) {
+            return -1;
+        }
+        dReal duration = 0;
+        FOREACHC(itrampnd, workspace->rampndVect) {
+            duration += itrampnd->GetDuration();
+        }
+        return duration;
+    }
+
     void _ComputeVelocitiesJointValues(GroupInfoConstPtr info, std::vector<dReal>::const_iterator itorgdiff, std::vector<dReal>::const_iterator itdataprev, std::vector<dReal>::iterator itdata)
     {
         if( info->orgveloffset >= 0  ) {
@@ -1041,6 +1104,7 @@ protected:
     std::vector<dReal> _cachevellimits, _cacheaccellimits;
     std::vector<RampOptimizer::RampND> _cacheRampNDVect;
     RampOptimizer::ParabolicCurve _curve;
+    std::vector< boost::shared_ptr<MinimumTimeWorkspace> > _vminimumtimeworkspaces; ///< one per thread when computing the minimum times in parallel
 
 }; // end class ParabolicTrajectoryRetimer2
 
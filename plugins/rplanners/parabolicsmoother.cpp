@@ -19,6 +19,8 @@
 #include <openrave/planningutils.h>
 
 #include "manipconstraints.h"
+#include "segmentfeasibilitycache.h"
+#include "plannerstatistics.h"
 #include "ParabolicPathSmooth/DynamicPath.h"
 #include "trajectoryretimer.h" // _(msgid)
 
@@ -190,11 +192,13 @@ public:
         __description = ":Interface Author: Rosen Diankov\n\nInterface to `Indiana University Intelligent Motion Laboratory <http://www.iu.edu/~motion/software.html>`_ parabolic smoothing library (Kris Hauser).\n\n**Note:** The original trajectory will not be preserved at all, don't use this if the robot has to hit all points of the trajectory.\n";
         _bmanipconstraints = false;
         _constraintreturn.reset(new ConstraintFilterReturn());
+        _segmentcache.SetStatistics(&_statistics);
         _logginguniformsampler = RaveCreateSpaceSampler(GetEnv(),"mt19937");
         if( !!_logginguniformsampler ) {
             _logginguniformsampler->SetSeed(utils::GetMicroTime());
         }
         _usingNewHeuristics = 1;
+        _nPlanStartTime = 0;
         _vVisitedDiscretizationCache.resize(0x1000*0x1000,0); // pre-allocate in order to keep memory growth predictable
         _feasibilitychecker.SetEnvID(GetEnv()->GetId()); // set envid for logging purpose
     }
@@ -218,6 +222,7 @@ public:
     bool _InitPlan()
     {
         _zerovelpoints.resize(0);
+        _segmentcache.Reset();
 
         if( _parameters->_nMaxIterations <= 0 ) {
             _parameters->_nMaxIterations = 100;
@@ -262,6 +267,17 @@ public:
     }
 
     virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        PlannerStatisticsRecorder recorder(GetEnv(), _statistics);
+        _progress._iteration = 0;
+        PlannerStatus status = _PlanPath(ptraj, planningoptions);
+        _statistics.numIterations = _progress._iteration;
+        recorder.Finish(status);
+        return status;
+    }
+
+    /// \brief smooths the trajectory, called by PlanPath which fills the statistics
+    PlannerStatus _PlanPath(TrajectoryBasePtr ptraj, int planningoptions)
     {
         BOOST_ASSERT(!!_parameters && !!ptraj);
 
@@ -269,6 +285,8 @@ public:
             return PlannerStatus(PS_Failed);
         }
 
+        _segmentcache.Reset(); // the environment might have changed since the last call
+
         // should always set the seed since smoother can be called with different trajectories even though InitPlan was only called once
         if( !!_uniformsampler ) {
             _uniformsampler->SetSeed(_parameters->_nRandomGeneratorSeed);
@@ -321,6 +339,7 @@ public:
         }
 
         uint32_t basetime = utils::GetMilliTime();
+        _nPlanStartTime = basetime;
         ConfigurationSpecification posspec = _parameters->_configurationspecification;
         ConfigurationSpecification velspec = posspec.ConvertToVelocitySpecification();
         ConfigurationSpecification timespec;
@@ -832,6 +851,7 @@ public:
             return PlannerStatus(description, PS_Failed);
         }
         RAVELOG_DEBUG_FORMAT("env=%d, path optimizing - computation time=%fs", GetEnv()->GetId()%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+        RAVELOG_VERBOSE_FORMAT("env=%d, segment feasibility cache hits=%d/%d", GetEnv()->GetId()%_segmentcache.GetNumHits()%(_segmentcache.GetNumHits()+_segmentcache.GetNumMisses()));
         //====================================================================================================
         if (IS_DEBUGLEVEL(Level_Debug)) {
             RAVELOG_DEBUG_FORMAT("env=%d, start sampling the trajectory (verification purpose) after shortcutting", GetEnv()->GetId());
@@ -867,7 +887,7 @@ public:
             options |= CFO_CheckWithPerturbation;
         }
         try {
-            return _parameters->CheckPathAllConstraints(a,a, da, da, 0, IT_OpenStart, options);
+            return _segmentcache.CheckPathAllConstraints(_parameters, a,a, da, da, 0, IT_OpenStart, options);
         }
         catch(const std::exception& ex) {
             // some constraints assume initial conditions for a and b are followed, however at this point a and b are sa
@@ -886,7 +906,7 @@ public:
             _nCallsCheckPathAllConstraints_SegmentFeasible2 += 1;
             _tStartCheckPathAllConstraints = utils::GetMicroTime();
 #endif
-            int ret = _parameters->CheckPathAllConstraints(a,a, da, da, 0, IT_OpenStart, options);
+            int ret = _segmentcache.CheckPathAllConstraints(_parameters, a,a, da, da, 0, IT_OpenStart, options);
 #ifdef SMOOTHER1_TIMING_DEBUG
             _tEndCheckPathAllConstraints = utils::GetMicroTime();
             _totalTimeCheckPathAllConstraints_SegmentFeasible2 += 0.000001f*(float)(_tEndCheckPathAllConstraints - _tStartCheckPathAllConstraints);
@@ -925,7 +945,7 @@ public:
             _nCallsCheckPathAllConstraints_SegmentFeasible2 += 1;
             _tStartCheckPathAllConstraints = utils::GetMicroTime();
 #endif
-            int ret = _parameters->CheckPathAllConstraints(a,b,da, db, timeelapsed, IT_OpenStart, options, _constraintreturn);
+            int ret = _segmentcache.CheckPathAllConstraints(_parameters, a,b,da, db, timeelapsed, IT_OpenStart, options, _constraintreturn);
 #ifdef SMOOTHER1_TIMING_DEBUG
             _tEndCheckPathAllConstraints = utils::GetMicroTime();
             _totalTimeCheckPathAllConstraints_SegmentFeasible2 += 0.000001f*(float)(_tEndCheckPathAllConstraints - _tStartCheckPathAllConstraints);
@@ -1325,6 +1345,51 @@ protected:
         return true;
     }
 
+    /// \brief true if TrajectoryTimingParameters::_nMaxShortcutTime is set and has passed since PlanPath started
+    inline bool _IsShortcutTimeExpired() const
+    {
+        return _parameters->_nMaxShortcutTime > 0 && utils::GetMilliTime() - _nPlanStartTime >= _parameters->_nMaxShortcutTime;
+    }
+
+    /// \brief Estimates how much time shortcutting between t1 and t2 could save.
+    ///
+    /// The straight line between the two configurations cannot be traversed faster than the slowest DOF at its velocity
+    /// limit, so the gain is t2 - t1 minus that bound. It ignores acceleration limits and constraints.
+    dReal _ComputeExpectedShortcutGain(const ParabolicRamp::DynamicPath& dynamicpath, dReal t1, dReal t2, std::vector<dReal>& x1, std::vector<dReal>& x2) const
+    {
+        dynamicpath.Evaluate(t1, x1);
+        dynamicpath.Evaluate(t2, x2);
+        dReal fMinTime = 0;
+        for( size_t idof = 0; idof < x1.size(); ++idof ) {
+            if( _parameters->_vConfigVelocityLimit[idof] > 0 ) {
+                fMinTime = max(fMinTime, RaveFabs(x2[idof] - x1[idof])/_parameters->_vConfigVelocityLimit[idof]);
+            }
+        }
+        return (t2 - t1) - fMinTime;
+    }
+
+    /// \brief Draws three more pairs of shortcut times and keeps the one of them or of t1, t2 with the largest expected gain,
+    /// so that the iterations of a limited shortcut time go to the most promising shortcuts. t1 and t2 are sorted.
+    void _PrioritizeShortcutTimes(const ParabolicRamp::DynamicPath& dynamicpath, ParabolicRamp::RandomNumberGeneratorBase* rng, dReal endTime, dReal& t1, dReal& t2)
+    {
+        if( t1 > t2 ) {
+            ParabolicRamp::Swap(t1, t2);
+        }
+        dReal fBestGain = _ComputeExpectedShortcutGain(dynamicpath, t1, t2, _vSampleX1, _vSampleX2);
+        for( int isample = 1; isample < 4; ++isample ) {
+            dReal t1sample = rng->Rand()*endTime, t2sample = rng->Rand()*endTime;
+            if( t1sample > t2sample ) {
+                ParabolicRamp::Swap(t1sample, t2sample);
+            }
+            dReal fGain = _ComputeExpectedShortcutGain(dynamicpath, t1sample, t2sample, _vSampleX1, _vSampleX2);
+            if( fGain > fBestGain ) {
+                fBestGain = fGain;
+                t1 = t1sample;
+                t2 = t2sample;
+            }
+        }
+    }
+
     int _Shortcut(ParabolicRamp::DynamicPath& dynamicpath, int numIters, ParabolicRamp::RandomNumberGeneratorBase* rng, dReal mintimestep)
     {
         uint32_t fileindex;
@@ -1412,6 +1477,9 @@ protected:
 #endif
         int iters=0;
         for(iters=0; iters<numIters; iters++) {
+            if( _IsShortcutTimeExpired() ) {
+                break;
+            }
             nItersFromPrevSuccessful += 1;
             if (nItersFromPrevSuccessful > nCutoffIters) {
                 // No progress for already nCutOffIters. Stop right away.
@@ -1423,6 +1491,9 @@ protected:
                 t1 = 0;
                 t2 = endTime;
             }
+            else if( _parameters->_nMaxShortcutTime > 0 ) {
+                _PrioritizeShortcutTimes(dynamicpath, rng, endTime, t1, t2);
+            }
             if(t1 > t2) {
                 ParabolicRamp::Swap(t1,t2);
             }
@@ -1530,6 +1601,8 @@ protected:
                         RAVELOG_VERBOSE_FORMAT("env=%d, shortcut iter=%d t1 = %.15e; t2 = %.15e; newramptime = %.15e; tdiff = %.15e", GetEnv()->GetId()%iters%t1%t2%newramptime%(t2-t1));
                     }
 
+                    _progress._fCost = endTime;
+                    _progress._nElapsedTime = utils::GetMilliTime() - _nPlanStartTime;
                     if( _CallCallbacks(_progress) == PA_Interrupt ) {
                         return -1;
                     }
@@ -1871,6 +1944,9 @@ protected:
         else if (score/currentBestScore < cutoffRatio) {
             RAVELOG_INFO_FORMAT("env=%d, finished at shortcut iter=%d (current score falls below %.15e), successful=%d, slowdowns=%d, endTime: %.15e -> %.15e; diff = %.15e",GetEnv()->GetId()%iters%cutoffRatio%shortcuts%numslowdowns%originalEndTime%endTime%(originalEndTime - endTime));
         }
+        else if( _IsShortcutTimeExpired() ) {
+            RAVELOG_INFO_FORMAT("env=%d, finished at shortcut iter=%d (shortcut time of %dms expired), successful=%d, slowdowns=%d, endTime: %.15e -> %.15e; diff = %.15e",GetEnv()->GetId()%iters%_parameters->_nMaxShortcutTime%shortcuts%numslowdowns%originalEndTime%endTime%(originalEndTime - endTime));
+        }
         else if (nItersFromPrevSuccessful > nCutoffIters) {
             RAVELOG_INFO_FORMAT("env=%d, finished at shortcut iter=%d (did not make progress in the last %d iterations), successful=%d, slowdowns=%d, endTime: %.15e -> %.15e; diff = %.15e",GetEnv()->GetId()%iters%nCutoffIters%shortcuts%numslowdowns%originalEndTime%endTime%(originalEndTime - endTime));
         }
@@ -1991,6 +2067,10 @@ protected:
         dReal specialShortcutWeight = 0.1;
         dReal specialShortcutCutoffTime = 0.75;
         for (iters = 0; iters < numIters; iters++) {
+            if( _IsShortcutTimeExpired() ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, shortcut time of %dms expired, so break", GetEnv()->GetId()%_parameters->_nMaxShortcutTime);
+                break;
+            }
             nItersFromPrevSuccessful += 1;
             if (nItersFromPrevSuccessful + nNumTimeBasedConstraintsFailed > nCutoffIters) { // the same time based constraints can fail all the time meaning that the trajectory is already pretty optimal. This check makes smoother easier to stop when there's no improvement
                 // No progess for already nCutoffIters. Stop right away
@@ -2024,6 +2104,9 @@ protected:
             else {
                 t1 = rng->Rand()*endTime;
                 t2 = rng->Rand()*endTime;
+                if( _parameters->_nMaxShortcutTime > 0 ) {
+                    _PrioritizeShortcutTimes(dynamicpath, rng, endTime, t1, t2);
+                }
             }
             if (t1 > t2) {
                 ParabolicRamp::Swap(t1, t2);
@@ -2166,6 +2249,8 @@ protected:
                         break;
                     }
 
+                    _progress._fCost = endTime;
+                    _progress._nElapsedTime = utils::GetMilliTime() - _nPlanStartTime;
                     if (_CallCallbacks(_progress) == PA_Interrupt) {
                         return -1;
                     }
@@ -2760,6 +2845,10 @@ protected:
     SpaceSamplerBasePtr _uniformsampler; ///< used for planning, seed is controlled
     SpaceSamplerBasePtr _logginguniformsampler; ///< used for logging, seed is random
     ConstraintFilterReturnPtr _constraintreturn;
+    uint32_t _nPlanStartTime; ///< ms when PlanPath started, used with TrajectoryTimingParameters::_nMaxShortcutTime
+    std::vector<dReal> _vSampleX1, _vSampleX2; ///< cache for _PrioritizeShortcutTimes
+    SegmentFeasibilityCache _segmentcache; ///< remembers the checked segments during PlanPath, shortcuts and the final checks revisit many of them
+    PlannerStatistics _statistics; ///< statistics of the current PlanPath, _segmentcache accumulates the constraint checks in it
     MyRampFeasibilityChecker _feasibilitychecker;
     boost::shared_ptr<ManipConstraintChecker> _manipconstraintchecker;
 
@@ -19,6 +19,8 @@
 #include "rampoptimizer/parabolicchecker.h"
 #include "rampoptimizer/feasibilitychecker.h"
 #include "manipconstraints2.h"
+#include "segmentfeasibilitycache.h"
+#include "plannerstatistics.h"
 
 // #define SMOOTHER2_TIMING_DEBUG // uncomment this to get more information on time spent for collision checking, manip constraint checking, etc.
 // #define SMOOTHER2_PROGRESS_DEBUG // uncomment his to get more information on progress during each shortcut iteration
@@ -357,11 +359,13 @@ public:
         __description = "";
         _bmanipconstraints = false;
         _constraintreturn.reset(new ConstraintFilterReturn());
+        _segmentcache.SetStatistics(&_statistics);
         _logginguniformsampler = RaveCreateSpaceSampler(GetEnv(), "mt19937");
         if (!!_logginguniformsampler) {
             _logginguniformsampler->SetSeed(utils::GetMicroTime());
         }
         _environmentid = GetEnv()->GetId();
+        _nPlanStartTime = 0;
         _vVisitedDiscretizationCache.resize(0x1000*0x1000,0); // pre-allocate in order to keep memory growth predictable
         _feasibilitychecker.SetEnvID(_environmentid); // set envid for logging purpose
     }
@@ -389,6 +393,7 @@ public:
         }
 
         _bUsePerturbation = true;
+        _segmentcache.Reset();
         _bmanipconstraints = (_parameters->manipname.size() > 0) && (_parameters->maxmanipspeed > 0 || _parameters->maxmanipaccel > 0);
         _feasibilitychecker.SetParameters(GetParameters());
 
@@ -475,6 +480,17 @@ public:
     }
 
     virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        PlannerStatisticsRecorder recorder(GetEnv(), _statistics);
+        _progress._iteration = 0;
+        PlannerStatus status = _PlanPath(ptraj, planningoptions);
+        _statistics.numIterations = _progress._iteration;
+        recorder.Finish(status);
+        return status;
+    }
+
+    /// \brief smooths the trajectory, called by PlanPath which fills the statistics
+    PlannerStatus _PlanPath(TrajectoryBasePtr ptraj, int planningoptions)
     {
         BOOST_ASSERT(!!_parameters && !!ptraj);
 
@@ -482,6 +498,13 @@ public:
             return PlannerStatus(PS_Failed);
         }
 
+        // should always set the seed since smoother can be called with different trajectories even though InitPlan was only called once
+        if( !!_uniformsampler ) {
+            _uniformsampler->SetSeed(_parameters->_nRandomGeneratorSeed);
+        }
+
+        _segmentcache.Reset(); // the environment might have changed since the last call
+
         if( IS_DEBUGLEVEL(_dumplevel) ) {
             // Save parameters for planning
             uint32_t randNum;
@@ -518,6 +541,7 @@ public:
         }
 
         uint32_t baseTime = utils::GetMilliTime();
+        _nPlanStartTime = baseTime;
         ConfigurationSpecification posSpec = _parameters->_configurationspecification;
         ConfigurationSpecification velSpec = posSpec.ConvertToVelocitySpecification();
         ConfigurationSpecification timeSpec;
@@ -976,6 +1000,7 @@ public:
             return PlannerStatus(description, PS_Failed);
         }
         RAVELOG_DEBUG_FORMAT("env=%d, path optimizing - computation time = %f s.", _environmentid%(0.001f*(float)(utils::GetMilliTime() - baseTime)));
+        RAVELOG_VERBOSE_FORMAT("env=%d, segment feasibility cache hits=%d/%d", _environmentid%_segmentcache.GetNumHits()%(_segmentcache.GetNumHits()+_segmentcache.GetNumMisses()));
 
         if( IS_DEBUGLEVEL(Level_Verbose) ) {
             RAVELOG_VERBOSE_FORMAT("env=%d, Start sampling trajectory after shortcutting (for verification)", _environmentid);
@@ -1009,7 +1034,7 @@ public:
             options |= CFO_CheckWithPerturbation;
         }
         try {
-            return _parameters->CheckPathAllConstraints(q0, q0, dq0, dq0, 0, IT_OpenStart, options);
+            return _segmentcache.CheckPathAllConstraints(_parameters, q0, q0, dq0, dq0, 0, IT_OpenStart, options);
         }
         catch (const std::exception& ex) {
             RAVELOG_WARN_FORMAT("env=%d, CheckPathAllConstraints threw an exception: %s", _environmentid%ex.what());
@@ -1030,7 +1055,7 @@ public:
             _nCallsCheckPathAllConstraints_SegmentFeasible2 += 1;
             _tStartCheckPathAllConstraints = utils::GetMicroTime();
 #endif
-            int ret = _parameters->CheckPathAllConstraints(q0, q0, dq0, dq0, 0, IT_OpenStart, options);
+            int ret = _segmentcache.CheckPathAllConstraints(_parameters, q0, q0, dq0, dq0, 0, IT_OpenStart, options);
 #ifdef SMOOTHER2_TIMING_DEBUG
             _tEndCheckPathAllConstraints = utils::GetMicroTime();
             _totalTimeCheckPathAllConstraints_SegmentFeasible2 += 0.000001f*(float)(_tEndCheckPathAllConstraints - _tStartCheckPathAllConstraints);
@@ -1111,7 +1136,7 @@ public:
             _nCallsCheckPathAllConstraints_SegmentFeasible2 += 1;
             _tStartCheckPathAllConstraints = utils::GetMicroTime();
 #endif
-            int ret = _parameters->CheckPathAllConstraints(q0, q1, dq0, dq1, timeElapsed, IT_OpenStart, options, _constraintreturn);
+            int ret = _segmentcache.CheckPathAllConstraints(_parameters, q0, q1, dq0, dq1, timeElapsed, IT_OpenStart, options, _constraintreturn);
 #ifdef SMOOTHER2_TIMING_DEBUG
             _tEndCheckPathAllConstraints = utils::GetMicroTime();
             _totalTimeCheckPathAllConstraints_SegmentFeasible2 += 0.000001f*(float)(_tEndCheckPathAllConstraints - _tStartCheckPathAllConstraints);
@@ -1347,6 +1372,15 @@ protected:
         dReal rightneighbor; // the first switch time to the right of this zero-velocity point
     };
 
+    /// \brief A pair of time instants sampled for the parallel shortcut rounds.
+    struct ShortcutCandidate
+    {
+        ShortcutCandidate() : t0(0), t1(0), fSavedTime(0) {
+        }
+        dReal t0, t1;
+        dReal fSavedTime; // the duration the candidate removes from the path, 0 if it was rejected
+    };
+
     /// \brief Time-parameterize the ordered set of waypoints to a trajectory that stops at every
     /// waypoint. _SetMilestones also adds some extra waypoints to the original set if any two
     /// consecutive waypoints are too far apart.
@@ -1871,11 +1905,13 @@ protected:
 
                     do { // Start checking constraints.
                         if( _parameters->SetStateValues(x1Vect) != 0 ) {
-                            std::stringstream s;
-                            s << std::setprecision(RampOptimizer::g_nPrec) << "x1 = [";
-                            SerializeValues(s, x1Vect);
-                            s << "];";
-                            RAVELOG_VERBOSE_FORMAT("env=%d, shortcut iter=%d/%d, cannot set state: %s", _environmentid%iters%numIters%s.str());
+                            if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                                std::stringstream s;
+                                s << std::setprecision(RampOptimizer::g_nPrec) << "x1 = [";
+                                SerializeValues(s, x1Vect);
+                                s << "];";
+                                RAVELOG_VERBOSE_FORMAT("env=%d, shortcut iter=%d/%d, cannot set state: %s", _environmentid%iters%numIters%s.str());
+                            }
                             retcheck.retcode = CFO_StateSettingError;
 #ifdef SMOOTHER2_PROGRESS_DEBUG
                             ++vShortcutStats[SS_StateSettingFailed];
@@ -2382,6 +2418,210 @@ protected:
         return nummerges;
     }
 
+    /// \brief true if TrajectoryTimingParameters::_nMaxShortcutTime is set and has passed since PlanPath started
+    inline bool _IsShortcutTimeExpired() const
+    {
+        return _parameters->_nMaxShortcutTime > 0 && utils::GetMilliTime() - _nPlanStartTime >= _parameters->_nMaxShortcutTime;
+    }
+
+    /// \brief Estimates how much time shortcutting between t0 and t1 could save.
+    ///
+    /// The straight line between the two configurations cannot be traversed faster than the slowest DOF at its velocity
+    /// limit, so the gain is t1 - t0 minus that bound. It ignores acceleration limits and constraints.
+    dReal _ComputeExpectedShortcutGain(const RampOptimizer::ParabolicPath& parabolicpath, dReal t0, dReal t1, std::vector<dReal>& x0Vect, std::vector<dReal>& x1Vect) const
+    {
+        int i0, i1;
+        dReal u0, u1;
+        parabolicpath.FindRampNDIndex(t0, i0, u0);
+        parabolicpath.FindRampNDIndex(t1, i1, u1);
+        parabolicpath.GetRampNDVect()[i0].EvalPos(u0, x0Vect);
+        parabolicpath.GetRampNDVect()[i1].EvalPos(u1, x1Vect);
+        dReal fMinTime = 0;
+        for( size_t idof = 0; idof < x0Vect.size(); ++idof ) {
+            if( _parameters->_vConfigVelocityLimit[idof] > 0 ) {
+                fMinTime = max(fMinTime, RaveFabs(x1Vect[idof] - x0Vect[idof])/_parameters->_vConfigVelocityLimit[idof]);
+            }
+        }
+        return (t1 - t0) - fMinTime;
+    }
+
+    /// \brief Prepares one smoother per shortcut thread, each in its own clone of the environment, so that shortcut
+    /// candidates can be checked concurrently. Clears the workers if _parameters->nshortcutthreads <= 1.
+    void _InitShortcutWorkers()
+    {
+        int numthreads = _parameters->nshortcutthreads;
+        if( numthreads <= 1 ) {
+            _vshortcutworkers.resize(0);
+            return;
+        }
+        if( (int)_vshortcutworkers.size() > numthreads ) {
+            _vshortcutworkers.resize(numthreads);
+        }
+        try {
+            while( (int)_vshortcutworkers.size() < numthreads ) {
+                std::stringstream ss;
+                boost::shared_ptr<ParabolicSmoother2> pworker(new ParabolicSmoother2(GetEnv()->CloneSelf(Clone_Bodies), ss));
+                std::vector<uint8_t>().swap(pworker->_vVisitedDiscretizationCache); // workers never run _Shortcut
+                _vshortcutworkers.push_back(pworker);
+            }
+            FOREACH(itworker, _vshortcutworkers) {
+                EnvironmentBasePtr pworkerenv = (*itworker)->GetEnv();
+                pworkerenv->SynchronizeBodies(GetEnv());
+                EnvironmentMutex::scoped_lock lock(pworkerenv->GetMutex());
+                ConstraintTrajectoryTimingParametersPtr params(new ConstraintTrajectoryTimingParameters());
+                params->copy(_parameters);
+                // rebind the state and constraint functions to the bodies of the cloned environment but keep the limits of the request
+                params->SetConfigurationSpecification(pworkerenv, _parameters->_configurationspecification);
+                params->_vConfigLowerLimit = _parameters->_vConfigLowerLimit;
+                params->_vConfigUpperLimit = _parameters->_vConfigUpperLimit;
+                params->_vConfigVelocityLimit = _parameters->_vConfigVelocityLimit;
+                params->_vConfigAccelerationLimit = _parameters->_vConfigAccelerationLimit;
+                params->_vConfigResolution = _parameters->_vConfigResolution;
+                if( !(*itworker)->InitPlan(RobotBasePtr(), params) ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("env=%d, failed to init shortcut worker in env=%d", _environmentid%pworkerenv->GetId(), ORE_Failed);
+                }
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, cannot shortcut in parallel, falling back to serial shortcutting: %s", _environmentid%ex.what());
+            _vshortcutworkers.resize(0);
+        }
+    }
+
+    /// \brief Checks vcandidates with the shortcut workers and fills listQueuedShortcuts with the non-overlapping
+    /// candidates that save the most time, ordered by decreasing t0.
+    ///
+    /// Shortcutting the candidates in that order does not shift the time instants of the candidates still queued.
+    void _CheckShortcutCandidatesParallel(const RampOptimizer::ParabolicPath& parabolicpath, std::vector<ShortcutCandidate>& vcandidates, dReal fStartTimeVelMult, dReal fStartTimeAccelMult, dReal minTimeStep, std::list<ShortcutCandidate>& listQueuedShortcuts)
+    {
+        listQueuedShortcuts.clear();
+        size_t numthreads = min(_vshortcutworkers.size(), vcandidates.size());
+        std::vector< boost::shared_ptr<boost::thread> > vthreads(numthreads);
+        for(size_t ithread = 0; ithread < numthreads; ++ithread) {
+            _vshortcutworkers[ithread]->_bUsePerturbation = _bUsePerturbation;
+            _vshortcutworkers[ithread]->_bUseNewHeuristic = _bUseNewHeuristic;
+            vthreads[ithread].reset(new boost::thread(boost::bind(&ParabolicSmoother2::_CheckShortcutCandidatesWorker, _vshortcutworkers[ithread], boost::cref(parabolicpath), boost::ref(vcandidates), ithread, numthreads, fStartTimeVelMult, fStartTimeAccelMult, minTimeStep)));
+        }
+        FOREACH(itthread, vthreads) {
+            (*itthread)->join();
+        }
+
+        std::vector<ShortcutCandidate> vfeasible;
+        FOREACHC(itcandidate, vcandidates) {
+            if( itcandidate->fSavedTime > 0 ) {
+                vfeasible.push_back(*itcandidate);
+            }
+        }
+        // stable so that candidates saving the same time keep their sampling order on every platform
+        std::stable_sort(vfeasible.begin(), vfeasible.end(), [](const ShortcutCandidate& c0, const ShortcutCandidate& c1) {
+            return c0.fSavedTime > c1.fSavedTime;
+        });
+        FOREACHC(itcandidate, vfeasible) {
+            std::list<ShortcutCandidate>::iterator itinsert = listQueuedShortcuts.begin();
+            bool bOverlaps = false;
+            FOREACHC(itqueued, listQueuedShortcuts) {
+                if( itcandidate->t0 < itqueued->t1 && itqueued->t0 < itcandidate->t1 ) {
+                    bOverlaps = true;
+                    break;
+                }
+            }
+            if( bOverlaps ) {
+                continue;
+            }
+            while( itinsert != listQueuedShortcuts.end() && itinsert->t0 > itcandidate->t0 ) {
+                ++itinsert;
+            }
+            listQueuedShortcuts.insert(itinsert, *itcandidate);
+        }
+        RAVELOG_VERBOSE_FORMAT("env=%d, %d/%d shortcut candidates passed the parallel check, queued %d", _environmentid%vfeasible.size()%vcandidates.size()%listQueuedShortcuts.size());
+    }
+
+    /// \brief Runs in a shortcut thread on a worker smoother, checks every numthreads-th candidate starting at ithread.
+    void _CheckShortcutCandidatesWorker(const RampOptimizer::ParabolicPath& parabolicpath, std::vector<ShortcutCandidate>& vcandidates, size_t ithread, size_t numthreads, dReal fStartTimeVelMult, dReal fStartTimeAccelMult, dReal minTimeStep)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        for(size_t icandidate = ithread; icandidate < vcandidates.size(); icandidate += numthreads) {
+            ShortcutCandidate& candidate = vcandidates[icandidate];
+            candidate.fSavedTime = 0;
+            try {
+                candidate.fSavedTime = _CheckShortcutCandidate(parabolicpath, candidate.t0, candidate.t1, fStartTimeVelMult, fStartTimeAccelMult, minTimeStep);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_VERBOSE_FORMAT("env=%d, exception while checking shortcut candidate: %s", _environmentid%ex.what());
+            }
+        }
+    }
+
+    /// \brief Does the first interpolation and constraint check of a shortcut iteration of _Shortcut.
+    ///
+    /// \return the time the shortcut saves, or 0 if the shortcut iteration of _Shortcut would reject it. Failing
+    /// time-based constraints does not reject a candidate since _Shortcut can still slow it down.
+    dReal _CheckShortcutCandidate(const RampOptimizer::ParabolicPath& parabolicpath, dReal t0, dReal t1, dReal fStartTimeVelMult, dReal fStartTimeAccelMult, dReal minTimeStep)
+    {
+        if( t1 - t0 < minTimeStep ) {
+            return 0;
+        }
+        std::vector<RampOptimizer::RampND>& shortcutRampNDVect = _cacheRampNDVect, &shortcutRampNDVectOut = _cacheRampNDVectOut;
+        std::vector<dReal>& x0Vect = _cacheX0Vect, &x1Vect = _cacheX1Vect, &v0Vect = _cacheV0Vect, &v1Vect = _cacheV1Vect;
+        std::vector<dReal>& vellimits = _cacheVellimits, &accellimits = _cacheAccelLimits;
+        const std::vector<RampOptimizer::RampND>& rampndVect = parabolicpath.GetRampNDVect();
+
+        int i0, i1;
+        dReal u0, u1;
+        parabolicpath.FindRampNDIndex(t0, i0, u0);
+        parabolicpath.FindRampNDIndex(t1, i1, u1);
+
+        rampndVect[i0].EvalPos(u0, x0Vect);
+        if( _parameters->SetStateValues(x0Vect) != 0 ) {
+            return 0;
+        }
+        _parameters->_getstatefn(x0Vect);
+        rampndVect[i1].EvalPos(u1, x1Vect);
+        if( _parameters->SetStateValues(x1Vect) != 0 ) {
+            return 0;
+        }
+        _parameters->_getstatefn(x1Vect);
+        rampndVect[i0].EvalVel(u0, v0Vect);
+        rampndVect[i1].EvalVel(u1, v1Vect);
+
+        vellimits = _parameters->_vConfigVelocityLimit;
+        accellimits = _parameters->_vConfigAccelerationLimit;
+        if( !(_bmanipconstraints && _manipconstraintchecker && _bUseNewHeuristic) ) {
+            for (size_t j = 0; j < _parameters->_vConfigVelocityLimit.size(); ++j) {
+                dReal fminvel = max(RaveFabs(v0Vect[j]), RaveFabs(v1Vect[j]));
+                dReal f = max(fminvel, fStartTimeVelMult * _parameters->_vConfigVelocityLimit[j]);
+                if( vellimits[j] > f ) {
+                    vellimits[j] = f;
+                }
+                f = fStartTimeAccelMult * _parameters->_vConfigAccelerationLimit[j];
+                if( accellimits[j] > f ) {
+                    accellimits[j] = f;
+                }
+            }
+        }
+
+        if( !_interpolator.ComputeArbitraryVelNDTrajectory(x0Vect, x1Vect, v0Vect, v1Vect, _parameters->_vConfigLowerLimit, _parameters->_vConfigUpperLimit, vellimits, accellimits, shortcutRampNDVect, true) ) {
+            return 0;
+        }
+        dReal segmentTime = 0;
+        FOREACHC(itrampnd, shortcutRampNDVect) {
+            segmentTime += itrampnd->GetDuration();
+        }
+        if( segmentTime + minTimeStep > t1 - t0 ) {
+            return 0;
+        }
+
+        if( _parameters->SetStateValues(x1Vect) != 0 ) {
+            return 0;
+        }
+        _parameters->_getstatefn(x1Vect);
+        RampOptimizer::CheckReturn retcheck = _feasibilitychecker.Check2(shortcutRampNDVect, 0xffff, shortcutRampNDVectOut);
+        if( retcheck.retcode != 0 && retcheck.retcode != CFO_CheckTimeBasedConstraints ) {
+            return 0;
+        }
+        return (t1 - t0) - segmentTime;
+    }
+
     /// \brief Return the number of successful shortcut.
     int _Shortcut(RampOptimizer::ParabolicPath& parabolicpath, int numIters, RampOptimizer::RandomNumberGeneratorBase* rng, dReal minTimeStep)
     {
@@ -2456,30 +2696,17 @@ protected:
         uint32_t latestSuccessfulShortcutTimestamp = utils::GetMicroTime(), curtime;
 #endif
 
-        // Main shortcut loop
-        int iters = 0;
-        for (iters = 0; iters < numIters; ++iters) {
-            if( tTotal < minTimeStep ) {
-#ifdef SMOOTHER2_PROGRESS_DEBUG
-                RAVELOG_DEBUG_FORMAT("env=%d, shortcut iter=%d/%d, tTotal=%.15e is too short to continue shortcutting", _environmentid%iters%numIters%tTotal);
-#endif
-                break;
-            }
-
-            if( nItersFromPrevSuccessful + nTimeBasedConstraintsFailed > nCutoffIters  ) {
-                // There has been no progress in the last nCutoffIters iterations. Stop right away.
-                break;
-            }
-            nItersFromPrevSuccessful += 1;
+        std::vector<dReal> vSampleX0Vect, vSampleX1Vect;
+        const int nPrioritizedShortcutSamples = 4; // number of random pairs compared when the shortcut time is limited
 
-            // Sample t0 and t1. We could possibly add some heuristics here to get higher quality
-            // shortcuts
-            dReal t0, t1;
-            if( iters == 0 ) {
+        // Samples t0 and t1 for shortcut iteration iiter. We could possibly add some heuristics here to get higher quality
+        // shortcuts
+        auto sampleshortcuttimes = [&](int iiter, dReal& t0, dReal& t1) {
+            if( iiter == 0 ) {
                 t0 = 0;
                 t1 = tTotal;
             }
-            else if( (_vZeroVelPointInfos.size() > 0 && rng->Rand() <= specialShortcutWeight) || (numIters - iters <= (int)_vZeroVelPointInfos.size()) ) {
+            else if( (_vZeroVelPointInfos.size() > 0 && rng->Rand() <= specialShortcutWeight) || (numIters - iiter <= (int)_vZeroVelPointInfos.size()) ) {
                 /* We consider shortcutting around a zerovelpoint (the time instant of an original
                    waypoint which has not yet been shortcut) when there are some zerovelpoints left
                    and either
@@ -2491,7 +2718,7 @@ protected:
                 t0 = t - rng->Rand()*min(specialShortcutCutoffTime, t);
                 t1 = t + rng->Rand()*min(specialShortcutCutoffTime, tTotal - t);
 
-                if( numIters - iters <= (int)_vZeroVelPointInfos.size() ) {
+                if( numIters - iiter <= (int)_vZeroVelPointInfos.size() ) {
                     // By the time we reach here, it is likely that these multipliers have been
                     // scaled down to be very small. Try resetting it in hopes that it helps produce
                     // some successful shortcuts.
@@ -2506,11 +2733,84 @@ protected:
                 if( t0 > t1 ) {
                     RampOptimizer::Swap(t0, t1);
                 }
+                if( _parameters->_nMaxShortcutTime > 0 ) {
+                    // With a shortcut time limit, spend the iterations on the pairs that promise the largest time gain
+                    dReal fBestGain = _ComputeExpectedShortcutGain(parabolicpath, t0, t1, vSampleX0Vect, vSampleX1Vect);
+                    for( int isample = 1; isample < nPrioritizedShortcutSamples; ++isample ) {
+                        dReal t0sample = rng->Rand()*tTotal;
+                        dReal t1sample = rng->Rand()*tTotal;
+                        if( t0sample > t1sample ) {
+                            RampOptimizer::Swap(t0sample, t1sample);
+                        }
+                        dReal fGain = _ComputeExpectedShortcutGain(parabolicpath, t0sample, t1sample, vSampleX0Vect, vSampleX1Vect);
+                        if( fGain > fBestGain ) {
+                            fBestGain = fGain;
+                            t0 = t0sample;
+                            t1 = t1sample;
+                        }
+                    }
+                }
                 // 2019/04/26: Might be too constrained to only allow time instants that are not further apart than the largest ramp time. _maxInitialRampTime could be small due to various reasons. In such cases, shortcut performance will be poor.
                 // if( t1 - t0 > 2*_maxInitialRampTime ) {
                 //     t1 = t0 + 2*_maxInitialRampTime;
                 // }
             }
+        };
+
+        std::vector<ShortcutCandidate> vShortcutCandidates;
+        std::list<ShortcutCandidate> listQueuedShortcuts; ///< candidates that passed the parallel check, in decreasing t0
+        int nShortcutCandidates = _parameters->nshortcutcandidates > 0 ? _parameters->nshortcutcandidates : 2*_parameters->nshortcutthreads;
+        _InitShortcutWorkers();
+
+        // Main shortcut loop
+        int iters = 0;
+        for (iters = 0; iters < numIters; ++iters) {
+            if( _IsShortcutTimeExpired() ) {
+                break;
+            }
+            if( tTotal < minTimeStep ) {
+#ifdef SMOOTHER2_PROGRESS_DEBUG
+                RAVELOG_DEBUG_FORMAT("env=%d, shortcut iter=%d/%d, tTotal=%.15e is too short to continue shortcutting", _environmentid%iters%numIters%tTotal);
+#endif
+                break;
+            }
+
+            if( nItersFromPrevSuccessful + nTimeBasedConstraintsFailed > nCutoffIters  ) {
+                // There has been no progress in the last nCutoffIters iterations. Stop right away.
+                break;
+            }
+            nItersFromPrevSuccessful += 1;
+
+            dReal t0, t1;
+            if( _vshortcutworkers.size() > 0 && iters > 0 ) {
+                if( listQueuedShortcuts.size() == 0 ) {
+                    // Sample a round of candidates and have the workers reject the infeasible ones in parallel. The
+                    // survivors are then shortcut one per iteration with the serial code below, which does the final
+                    // checks in this environment.
+                    int numcandidates = min(nShortcutCandidates, numIters - iters);
+                    vShortcutCandidates.resize(numcandidates);
+                    for( int icandidate = 0; icandidate < numcandidates; ++icandidate ) {
+                        sampleshortcuttimes(iters + icandidate, vShortcutCandidates[icandidate].t0, vShortcutCandidates[icandidate].t1);
+                    }
+                    _CheckShortcutCandidatesParallel(parabolicpath, vShortcutCandidates, fStartTimeVelMult, fStartTimeAccelMult, minTimeStep, listQueuedShortcuts);
+                    // every candidate counts as one iteration, the queued ones are counted when they are shortcut
+                    int numrejected = numcandidates - (int)listQueuedShortcuts.size();
+                    if( listQueuedShortcuts.size() == 0 ) {
+                        numrejected -= 1; // this iteration
+                    }
+                    iters += numrejected;
+                    nItersFromPrevSuccessful += numrejected;
+                    if( listQueuedShortcuts.size() == 0 ) {
+                        continue;
+                    }
+                }
+                t0 = listQueuedShortcuts.front().t0;
+                t1 = listQueuedShortcuts.front().t1;
+                listQueuedShortcuts.pop_front();
+            }
+            else {
+                sampleshortcuttimes(iters, t0, t1);
+            }
 
 #ifdef SMOOTHER2_PROGRESS_DEBUG
             shortcutprogress << utils::GetMicroTime() << " " << tTotal << " " << t0 << " " << t1 << " ";
@@ -2694,6 +2994,8 @@ protected:
                     RAVELOG_DEBUG_FORMAT("env=%d, shortcut iter=%d/%d, finished initial interpolation. originalSegmentTime=%.15e, newSegmentTime=%.15e, diff=%.15e, minTimeStep=%.15e", _environmentid%iters%numIters%(t1 - t0)%segmentTime%(t1 - t0 - segmentTime)%minTimeStep);
 #endif
 
+                    _progress._fCost = tTotal;
+                    _progress._nElapsedTime = utils::GetMilliTime() - _nPlanStartTime;
                     if( _CallCallbacks(_progress) == PA_Interrupt ) {
                         return -1;
                     }
@@ -2704,11 +3006,13 @@ protected:
 
                     do { // Start checking constraints.
                         if( _parameters->SetStateValues(x1Vect) != 0 ) {
-                            std::stringstream s;
-                            s << std::setprecision(RampOptimizer::g_nPrec) << "x1 = [";
-                            SerializeValues(s, x1Vect);
-                            s << "];";
-                            RAVELOG_VERBOSE_FORMAT("env=%d, shortcut iter=%d/%d, cannot set state: %s", _environmentid%iters%numIters%s.str());
+                            if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                                std::stringstream s;
+                                s << std::setprecision(RampOptimizer::g_nPrec) << "x1 = [";
+                                SerializeValues(s, x1Vect);
+                                s << "];";
+                                RAVELOG_VERBOSE_FORMAT("env=%d, shortcut iter=%d/%d, cannot set state: %s", _environmentid%iters%numIters%s.str());
+                            }
                             retcheck.retcode = CFO_StateSettingError;
 #ifdef SMOOTHER2_PROGRESS_DEBUG
                             ++vShortcutStats[SS_StateSettingFailed];
@@ -3249,6 +3553,9 @@ protected:
         else if( score*iCurrentBestScore < cutoffRatio ) {
             RAVELOG_DEBUG_FORMAT("env=%d, finished at shortcut iter=%d (current score falls below %.15e), successful=%d, slowdowns=%d, endTime: %.15e -> %.15e; diff = %.15e", _environmentid%iters%cutoffRatio%numShortcuts%numSlowDowns%tOriginal%tTotal%(tOriginal - tTotal));
         }
+        else if( _IsShortcutTimeExpired() ) {
+            RAVELOG_DEBUG_FORMAT("env=%d, finished at shortcut iter=%d (shortcut time of %dms expired), successful=%d, slowdowns=%d, endTime: %.15e -> %.15e; diff = %.15e", _environmentid%iters%_parameters->_nMaxShortcutTime%numShortcuts%numSlowDowns%tOriginal%tTotal%(tOriginal - tTotal));
+        }
         else if( nItersFromPrevSuccessful + nTimeBasedConstraintsFailed > nCutoffIters ) {
             RAVELOG_DEBUG_FORMAT("env=%d, finished at shortcut iter=%d (did not make progress in the last %d iterations and time-based constraints failed %d times), successful=%d, slowdowns=%d, endTime: %.15e -> %.15e; diff = %.15e", _environmentid%iters%nItersFromPrevSuccessful%nTimeBasedConstraintsFailed%numShortcuts%numSlowDowns%tOriginal%tTotal%(tOriginal - tTotal));
         }
@@ -3343,6 +3650,8 @@ protected:
     ConstraintTrajectoryTimingParametersPtr _parameters;
     SpaceSamplerBasePtr _uniformsampler;        ///< used for planning, seed is controlled
     ConstraintFilterReturnPtr _constraintreturn;
+    SegmentFeasibilityCache _segmentcache; ///< remembers the checked segments during PlanPath, shortcuts and the final checks revisit many of them
+    PlannerStatistics _statistics; ///< statistics of the current PlanPath, _segmentcache accumulates the constraint checks in it
     MyRampNDFeasibilityChecker _feasibilitychecker;
     boost::shared_ptr<ManipConstraintChecker2> _manipconstraintchecker;
     TrajectoryBasePtr _pdummytraj;
@@ -3412,6 +3721,9 @@ protected:
 #endif
 
     bool _bUseNewHeuristic;
+    uint32_t _nPlanStartTime; ///< ms when PlanPath started, used with TrajectoryTimingParameters::_nMaxShortcutTime
+
+    std::vector< boost::shared_ptr<ParabolicSmoother2> > _vshortcutworkers; ///< one smoother per shortcut thread, each in its own cloned environment. Empty when shortcutting serially.
 
 }; // end class ParabolicSmoother2
 
@@ -0,0 +1,201 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef RAVE_PARALLEL_PLANNER_WORKERS_H
+#define RAVE_PARALLEL_PLANNER_WORKERS_H
+
+#include "openraveplugindefs.h"
+
+/// \brief runs planners on clones of an environment in parallel and picks the trajectory to return
+///
+/// Used by the planners that race several planners, the clones are kept between queries so that Clone only has to update what changed.
+/// The first worker that succeeds wins and the others are interrupted through their plan callbacks. In deterministic mode the successful
+/// worker with the lowest index wins instead, so the result does not depend on the timing of the threads.
+class ParallelPlannerWorkers
+{
+public:
+    ParallelPlannerWorkers() : _nWinner(-1), _nFinished(0), _bStop(false), _bDeterministic(false) {
+    }
+    virtual ~ParallelPlannerWorkers() {
+        FOREACH(itenv, _vWorkerEnvs) {
+            (*itenv)->Destroy();
+        }
+    }
+
+    /// \brief destroys the clones of the workers after the first nworkers
+    void SetNumWorkers(int nworkers)
+    {
+        if( (int)_vWorkerEnvs.size() > nworkers ) {
+            for(size_t iworker = nworkers; iworker < _vWorkerEnvs.size(); ++iworker) {
+                _vWorkerEnvs[iworker]->Destroy();
+            }
+            _vWorkerEnvs.resize(nworkers);
+        }
+    }
+
+    /// \brief returns the clone of penv of worker iworker, updated with the current bodies of penv. workers have to be updated in order
+    EnvironmentBasePtr UpdateWorkerEnv(EnvironmentBasePtr penv, int iworker)
+    {
+        if( iworker < (int)_vWorkerEnvs.size() ) {
+            _vWorkerEnvs[iworker]->Clone(penv, Clone_Bodies);
+        }
+        else {
+            BOOST_ASSERT(iworker == (int)_vWorkerEnvs.size());
+            _vWorkerEnvs.push_back(penv->CloneSelf(Clone_Bodies));
+        }
+        return _vWorkerEnvs[iworker];
+    }
+
+    /// \brief copies the xml data of params into the parameters of worker iworker, which plans in the environment of workerparams
+    ///
+    /// Only the xml data is transferred so none of the functions refer to the original environment, the tags of the specific planners are
+    /// kept in _sExtraParameters. The random seed is changed for every worker and post processing is left to the caller.
+    static void CopyWorkerParameters(PlannerBase::PlannerParametersConstPtr params, PlannerBase::PlannerParametersPtr workerparams, EnvironmentBasePtr penv, int iworker)
+    {
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        ss << *params;
+        ss >> *workerparams;
+        std::vector<dReal> vinitialconfig = workerparams->vinitialconfig, vgoalconfig = workerparams->vgoalconfig;
+        workerparams->SetConfigurationSpecification(penv, params->_configurationspecification);
+        workerparams->vinitialconfig.swap(vinitialconfig);
+        workerparams->vgoalconfig.swap(vgoalconfig);
+        workerparams->_nRandomGeneratorSeed = PlannerBase::PlannerParameters::GetParallelWorkerRandomGeneratorSeed(params->_nRandomGeneratorSeed, iworker);
+        workerparams->_sPostProcessingPlanner = "";
+        workerparams->_sPostProcessingParameters.resize(0);
+    }
+
+    /// \brief calls vplanners[i]->PlanPath(vtrajs[i]) on one thread per worker and returns when the winner is known
+    ///
+    /// \param callcallbacksfn called every 10ms on the calling thread while the workers run, if it returns PA_Interrupt all the workers are interrupted
+    /// \param callbackaction the last return value of callcallbacksfn
+    /// \return the index of the winning worker, -1 if none succeeded or planning was interrupted
+    int Run(const std::vector<PlannerBasePtr>& vplanners, const std::vector<TrajectoryBasePtr>& vtrajs, std::vector<PlannerStatus>& vstatus, int planningoptions, bool bDeterministic, const boost::function<PlannerAction()>& callcallbacksfn, PlannerAction& callbackaction)
+    {
+        int nworkers = (int)vplanners.size();
+        vstatus.resize(nworkers);
+        _nWinner = -1;
+        _nFinished = 0;
+        _vFinished.assign(nworkers, 0);
+        _bStop = false;
+        _bDeterministic = bDeterministic;
+        std::vector<UserDataPtr> vcallbackhandles(nworkers);
+        for(int iworker = 0; iworker < nworkers; ++iworker) {
+            vcallbackhandles[iworker] = vplanners[iworker]->RegisterPlanCallback(boost::bind(&ParallelPlannerWorkers::_WorkerCallback, this, iworker, _1));
+        }
+        std::vector<boost::shared_ptr<boost::thread> > listthreads(nworkers);
+        for(int iworker = 0; iworker < nworkers; ++iworker) {
+            listthreads[iworker].reset(new boost::thread(boost::bind(&ParallelPlannerWorkers::_WorkerThread, this, iworker, vplanners[iworker], vtrajs[iworker], planningoptions, boost::ref(vstatus[iworker]))));
+        }
+
+        callbackaction = PA_None;
+        {
+            boost::mutex::scoped_lock lock(_mutexWorkers);
+            while( !_IsDone(nworkers) ) {
+                _condWorkers.timed_wait(lock, boost::posix_time::milliseconds(10));
+                lock.unlock();
+                callbackaction = callcallbacksfn();
+                lock.lock();
+                if( callbackaction == PA_Interrupt ) {
+                    break;
+                }
+            }
+            _bStop = true;
+        }
+        FOREACH(itthread, listthreads) {
+            (*itthread)->join();
+        }
+        return callbackaction == PA_Interrupt ? -1 : _nWinner;
+    }
+
+    /// \brief checks the straight segments between the waypoints of ptraj with the constraints of params
+    ///
+    /// \param vdata filled with the waypoints of ptraj in the configuration specification of params
+    /// \return true if all segments satisfy the constraints
+    static bool CheckWorkerPath(PlannerBase::PlannerParametersPtr params, TrajectoryBasePtr ptraj, std::vector<dReal>& vdata)
+    {
+        std::vector<dReal> vprev(params->GetDOF()), vcur(params->GetDOF());
+        ptraj->GetWaypoints(0, ptraj->GetNumWaypoints(), vdata, params->_configurationspecification);
+        PlannerBase::PlannerParameters::StateSaver savestate(params);
+        for(size_t ipoint = 1; ipoint < ptraj->GetNumWaypoints(); ++ipoint) {
+            std::copy(vdata.begin()+(ipoint-1)*params->GetDOF(), vdata.begin()+ipoint*params->GetDOF(), vprev.begin());
+            std::copy(vdata.begin()+ipoint*params->GetDOF(), vdata.begin()+(ipoint+1)*params->GetDOF(), vcur.begin());
+            if( params->CheckPathAllConstraints(vprev, vcur, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) != 0 ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    void _WorkerThread(int iworker, PlannerBasePtr planner, TrajectoryBasePtr ptraj, int planningoptions, PlannerStatus& status)
+    {
+        try {
+            status = planner->PlanPath(ptraj, planningoptions);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, planner %s of parallel worker %d failed: %s", planner->GetEnv()->GetId()%planner->GetXMLId()%iworker%ex.what());
+            status = PlannerStatus(ex.what(), PS_Failed);
+        }
+        boost::mutex::scoped_lock lock(_mutexWorkers);
+        if( status.HasSolution() && (_nWinner < 0 || (_bDeterministic && iworker < _nWinner)) ) {
+            _nWinner = iworker;
+        }
+        _nFinished++;
+        _vFinished[iworker] = 1;
+        _condWorkers.notify_all();
+    }
+
+    /// \brief returns true if the trajectory to return is known, _mutexWorkers has to be locked
+    ///
+    /// In deterministic mode the workers before the current winner can still succeed, so all of them have to return.
+    bool _IsDone(int nworkers) const
+    {
+        if( _nWinner < 0 ) {
+            return _nFinished >= nworkers;
+        }
+        if( _bDeterministic ) {
+            for(int iworker = 0; iworker < _nWinner; ++iworker) {
+                if( !_vFinished[iworker] ) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    PlannerAction _WorkerCallback(int iworker, const PlannerBase::PlannerProgress& progress)
+    {
+        boost::mutex::scoped_lock lock(_mutexWorkers);
+        if( _bStop ) {
+            return PA_Interrupt;
+        }
+        if( _nWinner >= 0 && (!_bDeterministic || iworker > _nWinner) ) {
+            return PA_Interrupt;
+        }
+        return PA_None;
+    }
+
+    std::vector<EnvironmentBasePtr> _vWorkerEnvs; ///< cloned environments of the workers, kept between calls to Run
+    boost::mutex _mutexWorkers; ///< protects _nWinner, _nFinished, _vFinished and _bStop
+    boost::condition_variable _condWorkers; ///< notified when a worker finishes
+    int _nWinner; ///< index of the winning worker, -1 if none
+    int _nFinished; ///< number of workers that returned
+    std::vector<uint8_t> _vFinished; ///< 1 for every worker that returned
+    bool _bStop; ///< if true, the workers should interrupt
+    bool _bDeterministic; ///< if true, the successful worker with the lowest index wins
+};
+
+#endif
@@ -0,0 +1,188 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "rplanners.h"
+#include "parallelworkers.h"
+
+/// \brief races several planners on clones of the environment and returns the first successful trajectory
+class PlannerPortfolio : public PlannerBase
+{
+public:
+    class PortfolioParameters : public PlannerBase::PlannerParameters {
+public:
+        PortfolioParameters() : _bProcessingPortfolio(false) {
+            _vXMLParameters.push_back("planners");
+        }
+
+        std::vector<std::string> _vplanners; ///< the planner of each worker, a planner can be repeated to race different random seeds
+protected:
+        bool _bProcessingPortfolio;
+        virtual bool serialize(std::ostream& O, int options=0) const
+        {
+            if( !PlannerParameters::serialize(O, options|1) ) {
+                return false;
+            }
+            O << "<planners>";
+            FOREACHC(it, _vplanners) {
+                O << *it << " ";
+            }
+            O << "</planners>" << endl;
+            if( !(options & 1) ) {
+                O << _sExtraParameters << endl;
+            }
+            return !!O;
+        }
+
+        ProcessElement startElement(const std::string& name, const AttributesList& atts)
+        {
+            if( _bProcessingPortfolio ) {
+                return PE_Ignore;
+            }
+            switch( PlannerBase::PlannerParameters::startElement(name,atts) ) {
+            case PE_Pass: break;
+            case PE_Support: return PE_Support;
+            case PE_Ignore: return PE_Ignore;
+            }
+            _bProcessingPortfolio = name=="planners";
+            return _bProcessingPortfolio ? PE_Support : PE_Pass;
+        }
+        virtual bool endElement(const string& name)
+        {
+            if( _bProcessingPortfolio ) {
+                if( name == "planners") {
+                    _vplanners = std::vector<std::string>((istream_iterator<std::string>(_ss)), istream_iterator<std::string>());
+                }
+                else {
+                    RAVELOG_WARN(str(boost::format("unknown tag %s\n")%name));
+                }
+                _bProcessingPortfolio = false;
+                return false;
+            }
+            // give a chance for the default parameters to get processed
+            return PlannerParameters::endElement(name);
+        }
+    };
+    typedef boost::shared_ptr<PortfolioParameters> PortfolioParametersPtr;
+
+    PlannerPortfolio(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
+    {
+        __description = ":Interface Author: agent\n\nRuns the planners listed in the <planners> parameter in parallel, each on its own clone of the environment, and returns the first successful trajectory. The remaining planners are interrupted through their plan callbacks. A planner can be listed several times to race different random seeds, the seed of worker i is PlannerParameters::GetParallelWorkerRandomGeneratorSeed(_nRandomGeneratorSeed, i). With _bdeterministicparallel, the trajectory of the successful worker with the lowest index is returned instead, so the same seed and planners always give the same trajectory. The input trajectory is given to every planner, so smoothers can be raced too. All other parameters are passed to the planners.\n\nSince the workers cannot use the functions of the parameters, they plan with the default constraints of the configuration specification and the found trajectory is checked again with the constraints of the parameters.";
+    }
+
+    virtual ~PlannerPortfolio()
+    {
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset();
+        _robot = pbase;
+        PortfolioParametersPtr parameters(new PortfolioParameters());
+        parameters->copy(pparams);
+        if( parameters->_vplanners.size() == 0 ) {
+            parameters->_vplanners.push_back("birrt");
+        }
+        FOREACHC(itname, parameters->_vplanners) {
+            if( !RaveHasInterface(PT_Planner, *itname) ) {
+                RAVELOG_WARN_FORMAT("env=%d, planner %s does not exist", GetEnv()->GetId()%*itname);
+                return false;
+            }
+        }
+        _parameters = parameters;
+        return true;
+    }
+
+    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        if( !_parameters ) {
+            return PlannerStatus("PlannerPortfolio::PlanPath - Error, planner not initialized\n", PS_Failed);
+        }
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        uint32_t basetime = utils::GetMilliTime();
+        int nworkers = (int)_parameters->_vplanners.size();
+        _parallelworkers.SetNumWorkers(nworkers);
+        std::vector<PlannerBasePtr> vplanners(nworkers);
+        std::vector<TrajectoryBasePtr> vtrajs(nworkers);
+        std::vector<PlannerStatus> vstatus(nworkers);
+        for(int iworker = 0; iworker < nworkers; ++iworker) {
+            EnvironmentBasePtr penv = _parallelworkers.UpdateWorkerEnv(GetEnv(), iworker);
+            EnvironmentMutex::scoped_lock workerlock(penv->GetMutex());
+            RobotBasePtr probot;
+            if( !!_robot ) {
+                probot = penv->GetRobot(_robot->GetName());
+            }
+            PlannerParametersPtr params(new PlannerParameters());
+            ParallelPlannerWorkers::CopyWorkerParameters(_parameters, params, penv, iworker);
+            vplanners[iworker] = RaveCreatePlanner(penv, _parameters->_vplanners[iworker]);
+            if( !vplanners[iworker] || !vplanners[iworker]->InitPlan(probot, params) ) {
+                std::string description = str(boost::format(_("env=%d, failed to initialize planner %s of worker %d"))%GetEnv()->GetId()%_parameters->_vplanners[iworker]%iworker);
+                RAVELOG_WARN(description);
+                return PlannerStatus(description, PS_Failed);
+            }
+            vtrajs[iworker] = RaveCreateTrajectory(penv, ptraj->GetXMLId());
+            if( ptraj->GetNumWaypoints() > 0 ) {
+                vtrajs[iworker]->Clone(ptraj, 0);
+            }
+        }
+
+        // keep calling the callbacks of this planner while the workers run
+        PlannerProgress progress;
+        PlannerAction callbackaction = PA_None;
+        int nwinner = _parallelworkers.Run(vplanners, vtrajs, vstatus, planningoptions, _parameters->_bDeterministicParallel, boost::bind(&PlannerPortfolio::_CallCallbacks, this, boost::cref(progress)), callbackaction);
+        if( callbackaction == PA_Interrupt ) {
+            return PlannerStatus("Planning was interrupted", PS_Interrupted);
+        }
+        if( nwinner < 0 ) {
+            std::string description = str(boost::format(_("env=%d, all %d planners failed in %fs"))%GetEnv()->GetId()%nworkers%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+            RAVELOG_WARN(description);
+            return PlannerStatus(description, PS_Failed);
+        }
+
+        // validate the path with the real constraints before using it
+        TrajectoryBasePtr pworkertraj = vtrajs[nwinner];
+        std::vector<dReal> vdata;
+        if( !ParallelPlannerWorkers::CheckWorkerPath(_parameters, pworkertraj, vdata) ) {
+            std::string description = str(boost::format(_("env=%d, trajectory of planner %s of worker %d fails the planner constraints"))%GetEnv()->GetId()%_parameters->_vplanners[nwinner]%nwinner);
+            RAVELOG_WARN(description);
+            return PlannerStatus(description, PS_Failed);
+        }
+
+        // copy all the groups so that the timing of smoothers is kept
+        const ConfigurationSpecification& workerspec = pworkertraj->GetConfigurationSpecification();
+        pworkertraj->GetWaypoints(0, pworkertraj->GetNumWaypoints(), vdata);
+        ptraj->Init(workerspec);
+        ptraj->Insert(0, vdata, workerspec);
+        std::string description = str(boost::format(_("env=%d, planner %s of worker %d/%d succeeded, path=%d points, computation time=%fs\n"))%GetEnv()->GetId()%_parameters->_vplanners[nwinner]%nwinner%nworkers%ptraj->GetNumWaypoints()%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+        RAVELOG_DEBUG(description);
+        PlannerStatus status = _ProcessPostPlanners(_robot,ptraj);
+        status.description = description;
+        return status;
+    }
+
+    virtual PlannerParametersConstPtr GetParameters() const {
+        return _parameters;
+    }
+
+protected:
+    RobotBasePtr _robot;
+    PortfolioParametersPtr _parameters;
+
+    ParallelPlannerWorkers _parallelworkers; ///< runs the planners, keeps their cloned environments between calls to PlanPath
+};
+
+PlannerBasePtr CreatePlannerPortfolio(EnvironmentBasePtr penv, std::istream& sinput) {
+    return PlannerBasePtr(new PlannerPortfolio(penv, sinput));
+}
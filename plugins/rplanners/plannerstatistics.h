@@ -0,0 +1,63 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef RAVE_PLANNER_STATISTICS_H
+#define RAVE_PLANNER_STATISTICS_H
+
+#include "openraveplugindefs.h"
+
+/// \brief returns the "collision.queries" performance counter of the collision checker of the environment, 0 if the checker does not have one
+inline uint64_t GetCollisionQueryCount(EnvironmentBasePtr penv)
+{
+    CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+    if( !pchecker ) {
+        return 0;
+    }
+    std::map<std::string, PerfCounterPtr> mapcounters;
+    pchecker->GetPerfCounters(mapcounters);
+    std::map<std::string, PerfCounterPtr>::const_iterator itcounter = mapcounters.find("collision.queries");
+    return itcounter != mapcounters.end() ? itcounter->second->GetCount() : 0;
+}
+
+/// \brief resets the statistics of a plan on construction and fills its total time and collision queries in Finish
+class PlannerStatisticsRecorder
+{
+public:
+    PlannerStatisticsRecorder(EnvironmentBasePtr penv, PlannerStatistics& statistics) : _penv(penv), _statistics(statistics)
+    {
+        _statistics.Reset();
+        _starttime = utils::GetNanoPerformanceTime();
+        _startcollisionqueries = GetCollisionQueryCount(_penv);
+    }
+
+    /// \brief adds the time and the collision queries since the construction to the statistics and copies them to status
+    void Finish(PlannerStatus& status)
+    {
+        uint64_t endcollisionqueries = GetCollisionQueryCount(_penv);
+        if( endcollisionqueries >= _startcollisionqueries ) { // counters could have been reset in between
+            _statistics.numCollisionQueries += endcollisionqueries-_startcollisionqueries;
+        }
+        _statistics.totalTime = utils::GetNanoPerformanceTime()-_starttime;
+        status.statistics = _statistics;
+    }
+
+private:
+    EnvironmentBasePtr _penv;
+    PlannerStatistics& _statistics;
+    uint64_t _starttime, _startcollisionqueries;
+};
+
+#endif
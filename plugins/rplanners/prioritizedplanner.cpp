@@ -0,0 +1,285 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "rplanners.h"
+#include <openrave/planningutils.h>
+
+/// \brief plans the bodies of the configuration space one after the other, later bodies wait until the space-time reserved by the earlier ones is free
+class PrioritizedPlanner : public PlannerBase
+{
+    /// \brief the part of the configuration space that belongs to one body
+    struct PlannedBody
+    {
+        KinBodyPtr _pbody;
+        ConfigurationSpecification _spec; ///< the groups of the body
+    };
+
+public:
+    PrioritizedPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
+    {
+        __description = ":Interface Author: agent\n\n\
+Plans the bodies of the configuration specification one after the other in the order of their groups, the first body has the highest priority. \
+Every body is planned alone with the planner given with SetPlanner (default BiRRT) while the bodies that are already planned are disabled \
+and the bodies that are planned later stay at their initial configuration. The trajectory of the body is retimed and its start is delayed \
+until it does not collide with any earlier trajectory, checked with planningutils::TrajectoryConflictChecker. If no delay up to the maximum \
+works, the body is planned again with another seed. The result merges the trajectories of all the bodies. The post processing planner is \
+applied to each body before it is delayed, the merged trajectory is not post processed.";
+        RegisterCommand("SetPlanner",boost::bind(&PrioritizedPlanner::_SetPlannerCommand,this,_1,_2),
+                        "sets the planner used for every body");
+        RegisterCommand("SetDelayParameters",boost::bind(&PrioritizedPlanner::_SetDelayParametersCommand,this,_1,_2),
+                        "\"delaystep maxdelay [timestep [maxreplans]]\". The start of a body is delayed by multiples of delaystep up to maxdelay seconds. timestep is the sampling of the trajectories for the conflict checks, maxreplans the number of times a body is planned again when no delay works.");
+        _plannername = "BiRRT";
+        _fDelayStep = 0.1;
+        _fMaxDelay = 10;
+        _fTimeStep = 0.01;
+        _nMaxReplans = 2;
+    }
+    virtual ~PrioritizedPlanner() {
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new PlannerParameters());
+        _parameters->copy(pparams);
+        return _InitPlan(pbase);
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, std::istream& isParameters)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new PlannerParameters());
+        isParameters >> *_parameters;
+        return _InitPlan(pbase);
+    }
+
+    virtual PlannerParametersConstPtr GetParameters() const {
+        return _parameters;
+    }
+
+    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        if(!_parameters) {
+            return PlannerStatus("PrioritizedPlanner::PlanPath - Error, planner not initialized\n", PS_Failed);
+        }
+
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        uint32_t basetime = utils::GetMilliTime();
+        PlannerParameters::StateSaver savestate(_parameters);
+        // the bodies that are planned later are obstacles at their initial configuration
+        if( _parameters->SetStateValues(_parameters->vinitialconfig, 0) != 0 ) {
+            return PlannerStatus("failed to set the initial configuration", PS_Failed);
+        }
+
+        planningutils::TrajectoryConflictChecker reservations(GetEnv(), _fTimeStep);
+        std::list<TrajectoryBaseConstPtr> listtrajectories;
+        std::vector<dReal> vpoint;
+        for(size_t ibody = 0; ibody < _vbodies.size(); ++ibody) {
+            const PlannedBody& plannedbody = _vbodies[ibody];
+            TrajectoryBasePtr pbodytraj;
+            dReal fDelay = -1;
+            for(int ireplan = 0; ireplan <= _nMaxReplans && fDelay < 0; ++ireplan) {
+                pbodytraj = RaveCreateTrajectory(GetEnv(), ptraj->GetXMLId());
+                PlannerStatus status = _PlanBody(ibody, ireplan, pbodytraj, planningoptions);
+                if( status.GetStatusCode() == PS_Interrupted ) {
+                    return status;
+                }
+                if( !status.HasSolution() ) {
+                    RAVELOG_DEBUG_FORMAT("env=%d, failed to plan body %s, try %d: %s", GetEnv()->GetId()%plannedbody._pbody->GetName()%ireplan%status.description);
+                    continue;
+                }
+
+                // reserve the space-time of the body at the first delay that does not conflict with the earlier bodies
+                for(int idelay = 0; idelay*_fDelayStep <= _fMaxDelay; ++idelay) {
+                    int itraj = reservations.AddTrajectory(plannedbody._pbody, pbodytraj, idelay*_fDelayStep);
+                    bool bConflict = false;
+                    for(int iprev = 0; iprev < itraj && !bConflict; ++iprev) {
+                        bConflict = reservations.GetFirstConflictTime(iprev, itraj) >= 0;
+                    }
+                    if( !bConflict ) {
+                        fDelay = idelay*_fDelayStep;
+                        break;
+                    }
+                    reservations.RemoveTrajectory(itraj);
+                }
+                if( fDelay < 0 ) {
+                    RAVELOG_DEBUG_FORMAT("env=%d, trajectory of body %s conflicts with the earlier bodies for all delays up to %fs, try %d", GetEnv()->GetId()%plannedbody._pbody->GetName()%_fMaxDelay%ireplan);
+                }
+            }
+            if( fDelay < 0 ) {
+                std::string description = str(boost::format(_("env=%d, failed to plan body %s (priority %d) after %d tries"))%GetEnv()->GetId()%plannedbody._pbody->GetName()%ibody%(_nMaxReplans+1));
+                RAVELOG_WARN(description);
+                return PlannerStatus(description, PS_Failed);
+            }
+
+            if( fDelay > 0 ) {
+                // hold the first point for the delay, the retimed trajectories start at rest
+                int deltatimeoffset = pbodytraj->GetConfigurationSpecification().GetGroupFromName("deltatime").offset;
+                pbodytraj->GetWaypoint(0, vpoint);
+                pbodytraj->Insert(0, vpoint);
+                pbodytraj->GetWaypoint(1, vpoint);
+                vpoint.at(deltatimeoffset) = fDelay;
+                pbodytraj->Insert(1, vpoint, true);
+            }
+            RAVELOG_DEBUG_FORMAT("env=%d, planned body %s with delay %fs, duration %fs", GetEnv()->GetId()%plannedbody._pbody->GetName()%fDelay%pbodytraj->GetDuration());
+            listtrajectories.push_back(pbodytraj);
+        }
+
+        TrajectoryBasePtr pmergedtraj = planningutils::MergeTrajectories(listtrajectories);
+        const ConfigurationSpecification& mergedspec = pmergedtraj->GetConfigurationSpecification();
+        std::vector<dReal> vdata;
+        pmergedtraj->GetWaypoints(0, pmergedtraj->GetNumWaypoints(), vdata);
+        ptraj->Init(mergedspec);
+        ptraj->Insert(0, vdata, mergedspec);
+        std::string description = str(boost::format(_("env=%d, planned %d bodies, duration=%fs, computation time=%fs\n"))%GetEnv()->GetId()%_vbodies.size()%ptraj->GetDuration()%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+        RAVELOG_DEBUG(description);
+        return PlannerStatus(description, PS_HasSolution);
+    }
+
+protected:
+    bool _InitPlan(RobotBasePtr pbase)
+    {
+        _robot = pbase;
+        _vbodies.resize(0);
+        // split the configuration specification by body, keeping the order of the groups
+        FOREACHC(itgroup, _parameters->_configurationspecification._vgroups) {
+            std::stringstream ss(itgroup->name);
+            std::string type, bodyname;
+            ss >> type >> bodyname;
+            if( type != "joint_values" && type != "affine_transform" ) {
+                RAVELOG_WARN_FORMAT("env=%d, group %s is not supported by the prioritized planner", GetEnv()->GetId()%itgroup->name);
+                return false;
+            }
+            KinBodyPtr pbody = GetEnv()->GetKinBody(bodyname);
+            if( !pbody ) {
+                RAVELOG_WARN_FORMAT("env=%d, body %s of group %s does not exist", GetEnv()->GetId()%bodyname%itgroup->name);
+                return false;
+            }
+            std::vector<PlannedBody>::iterator itbody = _vbodies.begin();
+            while( itbody != _vbodies.end() && itbody->_pbody != pbody ) {
+                ++itbody;
+            }
+            if( itbody == _vbodies.end() ) {
+                _vbodies.push_back(PlannedBody());
+                itbody = _vbodies.end()-1;
+                itbody->_pbody = pbody;
+            }
+            ConfigurationSpecification::Group g = *itgroup;
+            g.offset = itbody->_spec.GetDOF();
+            itbody->_spec._vgroups.push_back(g);
+        }
+        if( _vbodies.size() == 0 ) {
+            RAVELOG_WARN_FORMAT("env=%d, configuration specification has no bodies", GetEnv()->GetId());
+            return false;
+        }
+        return true;
+    }
+
+    /// \brief plans the path of one body alone and retimes it, all the bodies planned before it are disabled
+    ///
+    /// \param ireplan the number of previous tries for this body, used to change the seed
+    PlannerStatus _PlanBody(size_t ibody, int ireplan, TrajectoryBasePtr pbodytraj, int planningoptions)
+    {
+        const PlannedBody& plannedbody = _vbodies[ibody];
+        std::vector<KinBody::KinBodyStateSaverPtr> vsavers;
+        for(size_t iprev = 0; iprev < ibody; ++iprev) {
+            std::set<KinBodyPtr> setattached;
+            _vbodies[iprev]._pbody->GetAttached(setattached);
+            FOREACH(itattached, setattached) {
+                vsavers.push_back(KinBody::KinBodyStateSaverPtr(new KinBody::KinBodyStateSaver(*itattached, KinBody::Save_LinkEnable)));
+                (*itattached)->Enable(false);
+            }
+        }
+
+        PlannerParametersPtr params(new PlannerParameters());
+        params->copy(_parameters);
+        params->SetConfigurationSpecification(GetEnv(), plannedbody._spec);
+        int dof = plannedbody._spec.GetDOF();
+        params->vinitialconfig.resize(dof);
+        ConfigurationSpecification::ConvertData(params->vinitialconfig.begin(), plannedbody._spec, _parameters->vinitialconfig.begin(), _parameters->_configurationspecification, 1, GetEnv());
+        size_t numgoals = _parameters->vgoalconfig.size()/_parameters->GetDOF();
+        params->vgoalconfig.resize(numgoals*dof);
+        if( numgoals > 0 ) {
+            ConfigurationSpecification::ConvertData(params->vgoalconfig.begin(), plannedbody._spec, _parameters->vgoalconfig.begin(), _parameters->_configurationspecification, numgoals, GetEnv());
+        }
+        params->_nRandomGeneratorSeed = PlannerParameters::GetParallelWorkerRandomGeneratorSeed(_parameters->_nRandomGeneratorSeed, (int)ibody*(_nMaxReplans+1)+ireplan);
+
+        if( !_planner ) {
+            _planner = RaveCreatePlanner(GetEnv(), _plannername);
+            if( !_planner ) {
+                return PlannerStatus(str(boost::format("failed to create planner %s")%_plannername), PS_Failed);
+            }
+        }
+        if( !_planner->InitPlan(RaveInterfaceCast<RobotBase>(plannedbody._pbody), params) ) {
+            return PlannerStatus(str(boost::format("failed to initialize planner %s")%_plannername), PS_Failed);
+        }
+        UserDataPtr callbackhandle = _planner->RegisterPlanCallback(boost::bind(&PrioritizedPlanner::_CallCallbacks, this, _1));
+        pbodytraj->Init(plannedbody._spec);
+        PlannerStatus status = _planner->PlanPath(pbodytraj, planningoptions);
+        if( !status.HasSolution() ) {
+            return status;
+        }
+        if( pbodytraj->GetDuration() <= 0 ) {
+            // the reservations need the timing of the body
+            status = planningutils::RetimeTrajectory(pbodytraj, false, 1, 1);
+        }
+        return status;
+    }
+
+    bool _SetPlannerCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::string plannername;
+        sinput >> plannername;
+        if( !sinput || !RaveHasInterface(PT_Planner, plannername) ) {
+            return false;
+        }
+        _plannername = plannername;
+        _planner.reset();
+        return true;
+    }
+
+    bool _SetDelayParametersCommand(std::ostream& sout, std::istream& sinput)
+    {
+        dReal fDelayStep = 0, fMaxDelay = 0;
+        sinput >> fDelayStep >> fMaxDelay;
+        if( !sinput || fDelayStep <= 0 ) {
+            return false;
+        }
+        _fDelayStep = fDelayStep;
+        _fMaxDelay = fMaxDelay;
+        dReal fTimeStep = 0;
+        if( !!(sinput >> fTimeStep) && fTimeStep > 0 ) {
+            _fTimeStep = fTimeStep;
+            int nMaxReplans = 0;
+            if( !!(sinput >> nMaxReplans) ) {
+                _nMaxReplans = nMaxReplans;
+            }
+        }
+        return true;
+    }
+
+    RobotBasePtr _robot;
+    PlannerParametersPtr _parameters;
+    std::vector<PlannedBody> _vbodies; ///< in the order of priority
+    std::string _plannername;
+    PlannerBasePtr _planner;
+    dReal _fDelayStep, _fMaxDelay; ///< the delays of the start of a body that are tried
+    dReal _fTimeStep; ///< the sampling of the trajectories for the conflict checks
+    int _nMaxReplans;
+};
+
+PlannerBasePtr CreatePrioritizedPlanner(EnvironmentBasePtr penv, std::istream& sinput) {
+    return PlannerBasePtr(new PrioritizedPlanner(penv, sinput));
+}
@@ -0,0 +1,836 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "rplanners.h"
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+#include <queue>
+
+/// \brief multi-query lazy PRM. The roadmap is kept between queries and persisted to disk.
+///
+/// Nodes and edges are only checked when a query path goes through them. Each node and edge remembers the AABB of the
+/// robot, so when a body of the scene moves only the parts of the roadmap close to its old and new AABBs have to be
+/// checked again.
+class PRMPlanner : public PlannerBase
+{
+    enum ValidityState
+    {
+        VS_Unknown=0, ///< has to be checked before it can be used
+        VS_Valid=1,
+        VS_Invalid=2,
+    };
+
+    struct RoadmapNode
+    {
+        RoadmapNode() : state(VS_Unknown) {
+        }
+        std::vector<dReal> q;
+        AABB ab; ///< AABB of the robot (and grabbed bodies) at q
+        int state;
+        std::vector<int> vedges; ///< indices into _vedges
+    };
+
+    struct RoadmapEdge
+    {
+        RoadmapEdge() : inode0(-1), inode1(-1), fLength(0), state(VS_Unknown) {
+        }
+        inline int GetOtherNode(int inode) const {
+            return inode == inode0 ? inode1 : inode0;
+        }
+        int inode0, inode1;
+        dReal fLength;
+        AABB ab; ///< AABB of the robot along the edge
+        int state;
+    };
+
+    /// \brief the state of a body of the scene when the roadmap was last synchronized with it
+    struct BodyState
+    {
+        BodyState() : bEnabled(false) {
+        }
+        std::string hash;
+        Transform t;
+        bool bEnabled;
+        AABB ab;
+    };
+
+public:
+    PRMPlanner(EnvironmentBasePtr penv) : PlannerBase(penv)
+    {
+        __description = ":Interface Author: agent\n\n\
+Multi-query lazy probabilistic roadmap planner. The roadmap is kept between queries and saved in the OpenRAVE home \
+directory, keyed by the kinematics hash of the robot and a hash of the static scene. Nodes and edges are only checked \
+when a query path uses them, and moving a body only invalidates the nodes and edges whose robot AABBs overlap the \
+old or new AABB of the body.\n\n\
+_nMaxIterations is the maximum number of nodes sampled for one query when the roadmap does not connect the query.";
+        RegisterCommand("SetRoadmapDirectory",boost::bind(&PRMPlanner::_SetRoadmapDirectoryCommand,this,_1,_2),
+                        "sets the directory where roadmaps are saved and loaded. Default is the OpenRAVE home directory.");
+        RegisterCommand("SaveRoadmap",boost::bind(&PRMPlanner::_SaveRoadmapCommand,this,_1,_2),
+                        "saves the roadmap to the given file, or to the roadmap directory if no file is given. Returns the filename.");
+        RegisterCommand("LoadRoadmap",boost::bind(&PRMPlanner::_LoadRoadmapCommand,this,_1,_2),
+                        "loads the roadmap from the given file. The robot of the last InitPlan has to match.");
+        RegisterCommand("ClearRoadmap",boost::bind(&PRMPlanner::_ClearRoadmapCommand,this,_1,_2),
+                        "removes all nodes and edges");
+        RegisterCommand("GetRoadmapInfo",boost::bind(&PRMPlanner::_GetRoadmapInfoCommand,this,_1,_2),
+                        "returns \"numnodes numedges numvalidnodes numvalidedges\"");
+        RegisterCommand("SetConnectionParameters",boost::bind(&PRMPlanner::_SetConnectionParametersCommand,this,_1,_2),
+                        "\"numneighbors [connectionradius] [aabbpadding]\". Every new node is connected to its numneighbors nearest nodes that are closer than connectionradius (0 for no limit). aabbpadding is added to the AABBs of the edges.");
+        RegisterCommand("SetAutoSave",boost::bind(&PRMPlanner::_SetAutoSaveCommand,this,_1,_2),
+                        "if 1 (default), the roadmap is saved after every query that changed it");
+        _nNumNeighbors = 10;
+        _fConnectionRadius = 0;
+        _fAABBPadding = 0.02;
+        _bAutoSave = true;
+        _bRoadmapModified = false;
+    }
+    virtual ~PRMPlanner() {
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new PlannerParameters());
+        _parameters->copy(pparams);
+        return _InitPlan(pbase);
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, std::istream& isParameters)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new PlannerParameters());
+        isParameters >> *_parameters;
+        return _InitPlan(pbase);
+    }
+
+    virtual PlannerParametersConstPtr GetParameters() const {
+        return _parameters;
+    }
+
+    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        if(!_parameters) {
+            return PlannerStatus("PRMPlanner::PlanPath - Error, planner not initialized\n", PS_Failed);
+        }
+
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        uint32_t basetime = utils::GetMilliTime();
+        PlannerParameters::StateSaver savestate(_parameters);
+        CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
+
+        _SynchronizeScene();
+
+        const int dof = _parameters->GetDOF();
+        std::vector<dReal> vconfig(dof);
+        std::vector<int> vstartnodes, vgoalnodes;
+        for(size_t index = 0; index < _parameters->vinitialconfig.size(); index += dof) {
+            std::copy(_parameters->vinitialconfig.begin()+index, _parameters->vinitialconfig.begin()+index+dof, vconfig.begin());
+            int inode = _AddQueryNode(vconfig);
+            if( inode >= 0 ) {
+                vstartnodes.push_back(inode);
+            }
+        }
+        for(size_t index = 0; index < _parameters->vgoalconfig.size(); index += dof) {
+            std::copy(_parameters->vgoalconfig.begin()+index, _parameters->vgoalconfig.begin()+index+dof, vconfig.begin());
+            int inode = _AddQueryNode(vconfig);
+            if( inode >= 0 ) {
+                vgoalnodes.push_back(inode);
+            }
+        }
+        if( vstartnodes.size() == 0 || vgoalnodes.size() == 0 ) {
+            std::string description = str(boost::format("env=%d, no valid initial (%d) or goal (%d) configurations")%GetEnv()->GetId()%vstartnodes.size()%vgoalnodes.size());
+            RAVELOG_WARN(description);
+            return PlannerStatus(description, PS_Failed);
+        }
+
+        PlannerProgress progress;
+        std::vector<int> vpath;
+        int nsampled = 0, nsearches = 0;
+        bool bFound = false;
+        while(1) {
+            ++nsearches;
+            if( _SearchRoadmap(vstartnodes, vgoalnodes, vpath) ) {
+                if( _ValidatePath(vpath) ) {
+                    bFound = true;
+                    break;
+                }
+                // some part of the path was invalid and got marked, so search again
+                continue;
+            }
+
+            // the roadmap does not connect the query, so grow it
+            if( nsampled >= _parameters->_nMaxIterations ) {
+                break;
+            }
+            if( _parameters->_nMaxPlanningTime > 0 && utils::GetMilliTime()-basetime >= _parameters->_nMaxPlanningTime ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, time exceeded (%dms) so breaking", GetEnv()->GetId()%_parameters->_nMaxPlanningTime);
+                break;
+            }
+            int nbatch = min(100, _parameters->_nMaxIterations-nsampled);
+            for(int isample = 0; isample < nbatch; ++isample) {
+                if( !_parameters->_samplefn(vconfig) ) {
+                    continue;
+                }
+                if( _CheckConfiguration(vconfig) ) {
+                    int inode = _AddNode(vconfig);
+                    _vnodes[inode].state = VS_Valid;
+                }
+            }
+            nsampled += nbatch;
+            progress._iteration = nsampled;
+            progress._nElapsedTime = utils::GetMilliTime()-basetime;
+            if( _CallCallbacks(progress) == PA_Interrupt ) {
+                return PlannerStatus("Planning was interrupted", PS_Interrupted);
+            }
+        }
+
+        if( _bAutoSave && _bRoadmapModified ) {
+            _SaveRoadmap(_GetRoadmapFilename(_scenehash));
+        }
+
+        if( !bFound ) {
+            std::string description = str(boost::format(_("env=%d, plan failed in %fs, sampled=%d, roadmap nodes=%d, edges=%d"))%GetEnv()->GetId()%(0.001f*(float)(utils::GetMilliTime()-basetime))%nsampled%_vnodes.size()%_vedges.size());
+            RAVELOG_WARN(description);
+            return PlannerStatus(description, PS_Failed);
+        }
+
+        if( ptraj->GetConfigurationSpecification().GetDOF() == 0 ) {
+            ptraj->Init(_parameters->_configurationspecification);
+        }
+        std::vector<dReal> vtrajdata(vpath.size()*dof);
+        for(size_t ipath = 0; ipath < vpath.size(); ++ipath) {
+            std::copy(_vnodes[vpath[ipath]].q.begin(), _vnodes[vpath[ipath]].q.end(), vtrajdata.begin()+ipath*dof);
+        }
+        ptraj->Insert(ptraj->GetNumWaypoints(), vtrajdata, _parameters->_configurationspecification);
+        std::string description = str(boost::format(_("env=%d, plan success, searches=%d, sampled=%d, path=%d points, roadmap nodes=%d, computation time=%fs\n"))%GetEnv()->GetId()%nsearches%nsampled%ptraj->GetNumWaypoints()%_vnodes.size()%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+        RAVELOG_DEBUG(description);
+        PlannerStatus status = _ProcessPostPlanners(_robot,ptraj);
+        status.description = description;
+        return status;
+    }
+
+protected:
+    bool _InitPlan(RobotBasePtr pbase)
+    {
+        _parameters->Validate();
+        _robot = pbase;
+        if( !_uniformsampler ) {
+            _uniformsampler = RaveCreateSpaceSampler(GetEnv(),"mt19937");
+        }
+        _uniformsampler->SetSeed(_parameters->_nRandomGeneratorSeed);
+        if( _parameters->_nMaxIterations <= 0 ) {
+            _parameters->_nMaxIterations = 1000;
+        }
+        if( (int)_parameters->vinitialconfig.size() % _parameters->GetDOF() || (int)_parameters->vgoalconfig.size() % _parameters->GetDOF() ) {
+            RAVELOG_ERROR_FORMAT("env=%d, initial or goal configurations have wrong dimensions", GetEnv()->GetId());
+            return false;
+        }
+
+        std::string robotkey = _ComputeRobotKey();
+        if( robotkey != _robotkey ) {
+            // different robot or configuration space, so the current roadmap cannot be used
+            _ClearRoadmap();
+            _robotkey = robotkey;
+            _mapBodyStates.clear();
+            _robotstatekey.clear();
+            _scenehash.clear();
+
+            PlannerParameters::StateSaver savestate(_parameters);
+            std::string scenehash = _ComputeSceneHash();
+            if( !_LoadRoadmap(_GetRoadmapFilename(scenehash)) ) {
+                // the latest roadmap of the robot, its stored body states let _SynchronizeScene invalidate what changed
+                std::ifstream flatest(_GetRoadmapFilename("latest").c_str());
+                std::string latesthash;
+                if( !!flatest && (flatest >> latesthash) ) {
+                    _LoadRoadmap(_GetRoadmapFilename(latesthash));
+                }
+            }
+        }
+        RAVELOG_DEBUG_FORMAT("env=%d, PRM Planner Initialized, roadmap nodes=%d, edges=%d", GetEnv()->GetId()%_vnodes.size()%_vedges.size());
+        return true;
+    }
+
+    /// \brief identifies the robot and configuration space the roadmap is valid for
+    std::string _ComputeRobotKey() const
+    {
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        if( !!_robot ) {
+            ss << _robot->GetKinematicsGeometryHash() << " ";
+        }
+        ss << _parameters->_configurationspecification;
+        FOREACHC(it, _parameters->_vConfigLowerLimit) {
+            ss << *it << " ";
+        }
+        FOREACHC(it, _parameters->_vConfigUpperLimit) {
+            ss << *it << " ";
+        }
+        return utils::GetMD5HashString(ss.str());
+    }
+
+    /// \brief state of the robot that is not part of the configuration space and that every check depends on
+    std::string _ComputeRobotStateKey() const
+    {
+        if( !_robot ) {
+            return std::string();
+        }
+        std::vector<dReal> vdofvalues;
+        _robot->GetDOFValues(vdofvalues);
+        // the active dofs are part of the roadmap
+        FOREACHC(itindex, _robot->GetActiveDOFIndices()) {
+            vdofvalues.at(*itindex) = 0;
+        }
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(6);
+        FOREACHC(it, vdofvalues) {
+            ss << *it << " ";
+        }
+        if( _robot->GetAffineDOF() == 0 ) {
+            ss << _robot->GetTransform();
+        }
+        std::vector<KinBodyPtr> vgrabbed;
+        _robot->GetGrabbed(vgrabbed);
+        FOREACHC(itgrabbed, vgrabbed) {
+            ss << (*itgrabbed)->GetName() << " " << (*itgrabbed)->GetKinematicsGeometryHash() << " ";
+        }
+        return ss.str();
+    }
+
+    /// \brief gathers the state of all bodies that are not the robot or grabbed by it
+    void _GetBodyStates(std::map<std::string, BodyState>& mapBodyStates) const
+    {
+        mapBodyStates.clear();
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        FOREACHC(itbody, vbodies) {
+            const KinBody& body = **itbody;
+            if( !!_robot && (&body == _robot.get() || !!_robot->IsGrabbing(body)) ) {
+                continue;
+            }
+            BodyState& state = mapBodyStates[body.GetName()];
+            state.hash = body.GetKinematicsGeometryHash();
+            state.t = body.GetTransform();
+            state.bEnabled = body.IsEnabled();
+            state.ab = body.ComputeAABB();
+        }
+    }
+
+    std::string _ComputeSceneHash() const
+    {
+        std::map<std::string, BodyState> mapBodyStates;
+        _GetBodyStates(mapBodyStates);
+        return _ComputeSceneHash(mapBodyStates, _ComputeRobotStateKey());
+    }
+
+    std::string _ComputeSceneHash(const std::map<std::string, BodyState>& mapBodyStates, const std::string& robotstatekey) const
+    {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(6) << robotstatekey << " ";
+        FOREACHC(itstate, mapBodyStates) {
+            ss << itstate->first << " " << itstate->second.hash << " " << itstate->second.bEnabled << " " << itstate->second.t << " ";
+        }
+        return utils::GetMD5HashString(ss.str());
+    }
+
+    /// \brief compares the scene with the state the roadmap was last synchronized with and marks the nodes and edges
+    /// close to the bodies that changed for checking
+    void _SynchronizeScene()
+    {
+        std::map<std::string, BodyState> mapBodyStates;
+        _GetBodyStates(mapBodyStates);
+        std::string robotstatekey = _ComputeRobotStateKey();
+        std::string scenehash = _ComputeSceneHash(mapBodyStates, robotstatekey);
+        if( scenehash == _scenehash ) {
+            return;
+        }
+
+        if( robotstatekey != _robotstatekey ) {
+            // the robot itself changed, so everything has to be checked again
+            FOREACH(itnode, _vnodes) {
+                itnode->state = VS_Unknown;
+            }
+            FOREACH(itedge, _vedges) {
+                itedge->state = VS_Unknown;
+            }
+            RAVELOG_DEBUG_FORMAT("env=%d, robot state changed, invalidating the whole roadmap", GetEnv()->GetId());
+        }
+        else {
+            std::vector<AABB> vchangedregions;
+            FOREACHC(itstate, mapBodyStates) {
+                std::map<std::string, BodyState>::const_iterator itold = _mapBodyStates.find(itstate->first);
+                if( itold == _mapBodyStates.end() ) {
+                    if( itstate->second.bEnabled ) {
+                        vchangedregions.push_back(itstate->second.ab);
+                    }
+                }
+                else if( itold->second.hash != itstate->second.hash || itold->second.bEnabled != itstate->second.bEnabled || !_IsSameTransform(itold->second.t, itstate->second.t) ) {
+                    if( itold->second.bEnabled ) {
+                        vchangedregions.push_back(itold->second.ab);
+                    }
+                    if( itstate->second.bEnabled ) {
+                        vchangedregions.push_back(itstate->second.ab);
+                    }
+                }
+            }
+            FOREACHC(itold, _mapBodyStates) {
+                if( itold->second.bEnabled && mapBodyStates.find(itold->first) == mapBodyStates.end() ) {
+                    vchangedregions.push_back(itold->second.ab);
+                }
+            }
+
+            int ninvalidatednodes = 0, ninvalidatededges = 0;
+            FOREACH(itnode, _vnodes) {
+                if( itnode->state != VS_Unknown && IsAABBIntersectingAny(itnode->ab, vchangedregions) ) {
+                    itnode->state = VS_Unknown;
+                    ++ninvalidatednodes;
+                }
+            }
+            FOREACH(itedge, _vedges) {
+                if( itedge->state != VS_Unknown && IsAABBIntersectingAny(itedge->ab, vchangedregions) ) {
+                    itedge->state = VS_Unknown;
+                    ++ninvalidatededges;
+                }
+            }
+            RAVELOG_DEBUG_FORMAT("env=%d, %d bodies changed, marked %d/%d nodes and %d/%d edges for checking", GetEnv()->GetId()%vchangedregions.size()%ninvalidatednodes%_vnodes.size()%ninvalidatededges%_vedges.size());
+        }
+
+        _mapBodyStates.swap(mapBodyStates);
+        _robotstatekey = robotstatekey;
+        _scenehash = scenehash;
+        _bRoadmapModified = true;
+    }
+
+    static bool _IsSameTransform(const Transform& t0, const Transform& t1)
+    {
+        return (t0.trans-t1.trans).lengthsqr3() <= g_fEpsilonLinear*g_fEpsilonLinear && RaveFabs(RaveFabs(t0.rot.dot(t1.rot))-1) <= g_fEpsilonLinear;
+    }
+
+    /// \brief the AABB of the robot and its grabbed bodies at q. The state is changed.
+    AABB _ComputeRobotAABB(const std::vector<dReal>& q)
+    {
+        if( !_robot ) {
+            // nothing to localize the configuration with, so any change of the scene affects it
+            return AABB(Vector(), Vector(1e10,1e10,1e10));
+        }
+        _parameters->_setstatevaluesfn(q, 0);
+        return ComputeRobotAABBWithGrabbed(_robot);
+    }
+
+    inline bool _CheckConfiguration(const std::vector<dReal>& q)
+    {
+        return _parameters->CheckPathAllConstraints(q, q, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) == 0;
+    }
+
+    /// \brief adds q to the roadmap and connects it with unchecked edges to its nearest nodes
+    int _AddNode(const std::vector<dReal>& q)
+    {
+        int inode = (int)_vnodes.size();
+        _vnodes.push_back(RoadmapNode());
+        _vnodes.back().q = q;
+        _vnodes.back().ab = _ComputeRobotAABB(q);
+
+        // nearest neighbors, the roadmaps stay at a few thousand nodes so a linear scan is fine
+        _vneighbors.resize(0);
+        for(int iother = 0; iother < inode; ++iother) {
+            if( _vnodes[iother].state == VS_Invalid ) {
+                continue;
+            }
+            dReal fdist = _parameters->_distmetricfn(q, _vnodes[iother].q);
+            if( _fConnectionRadius > 0 && fdist > _fConnectionRadius ) {
+                continue;
+            }
+            _vneighbors.push_back(std::make_pair(fdist, iother));
+        }
+        size_t numneighbors = min((size_t)_nNumNeighbors, _vneighbors.size());
+        std::partial_sort(_vneighbors.begin(), _vneighbors.begin()+numneighbors, _vneighbors.end());
+
+        std::vector<dReal> vmiddle;
+        for(size_t ineighbor = 0; ineighbor < numneighbors; ++ineighbor) {
+            int iother = _vneighbors[ineighbor].second;
+            RoadmapEdge edge;
+            edge.inode0 = iother;
+            edge.inode1 = inode;
+            edge.fLength = _vneighbors[ineighbor].first;
+            // the middle configuration catches most of the motion of the links between the two ends
+            vmiddle = q;
+            _parameters->_diffstatefn(vmiddle, _vnodes[iother].q);
+            for(size_t idof = 0; idof < vmiddle.size(); ++idof) {
+                vmiddle[idof] = _vnodes[iother].q[idof] + 0.5*vmiddle[idof];
+            }
+            edge.ab = MergeAABBs(MergeAABBs(_vnodes[iother].ab, _vnodes[inode].ab), _ComputeRobotAABB(vmiddle));
+            edge.ab.extents += Vector(_fAABBPadding, _fAABBPadding, _fAABBPadding);
+            int iedge = (int)_vedges.size();
+            _vedges.push_back(edge);
+            _vnodes[iother].vedges.push_back(iedge);
+            _vnodes[inode].vedges.push_back(iedge);
+        }
+        _bRoadmapModified = true;
+        return inode;
+    }
+
+    /// \brief returns the roadmap node of an initial or goal configuration, adding it if necessary. -1 if q is not valid
+    int _AddQueryNode(const std::vector<dReal>& q)
+    {
+        for(size_t inode = 0; inode < _vnodes.size(); ++inode) {
+            if( _parameters->_distmetricfn(q, _vnodes[inode].q) <= g_fEpsilonLinear ) {
+                if( _vnodes[inode].state == VS_Unknown ) {
+                    _vnodes[inode].state = _CheckConfiguration(_vnodes[inode].q) ? VS_Valid : VS_Invalid;
+                }
+                return _vnodes[inode].state == VS_Valid ? (int)inode : -1;
+            }
+        }
+        if( !_CheckConfiguration(q) ) {
+            return -1;
+        }
+        int inode = _AddNode(q);
+        _vnodes[inode].state = VS_Valid;
+        return inode;
+    }
+
+    /// \brief A* from the start nodes to the closest goal node, ignoring the nodes and edges known to be invalid
+    bool _SearchRoadmap(const std::vector<int>& vstartnodes, const std::vector<int>& vgoalnodes, std::vector<int>& vpath)
+    {
+        vpath.resize(0);
+        const dReal fInf = std::numeric_limits<dReal>::infinity();
+        _vcosts.assign(_vnodes.size(), fInf);
+        _vparents.assign(_vnodes.size(), -1);
+        _visgoal.assign(_vnodes.size(), 0);
+        FOREACHC(itgoal, vgoalnodes) {
+            _visgoal[*itgoal] = 1;
+        }
+
+        typedef std::pair<dReal, int> QueueElement;
+        std::priority_queue<QueueElement, std::vector<QueueElement>, std::greater<QueueElement> > queue;
+        FOREACHC(itstart, vstartnodes) {
+            _vcosts[*itstart] = 0;
+            queue.push(QueueElement(_ComputeHeuristic(*itstart, vgoalnodes), *itstart));
+        }
+
+        int ifoundgoal = -1;
+        while(!queue.empty()) {
+            QueueElement element = queue.top();
+            queue.pop();
+            int inode = element.second;
+            if( _visgoal[inode] ) {
+                ifoundgoal = inode;
+                break;
+            }
+            FOREACHC(itedge, _vnodes[inode].vedges) {
+                const RoadmapEdge& edge = _vedges[*itedge];
+                if( edge.state == VS_Invalid ) {
+                    continue;
+                }
+                int inext = edge.GetOtherNode(inode);
+                if( _vnodes[inext].state == VS_Invalid ) {
+                    continue;
+                }
+                dReal fcost = _vcosts[inode] + edge.fLength;
+                if( fcost < _vcosts[inext] ) {
+                    _vcosts[inext] = fcost;
+                    _vparents[inext] = inode;
+                    queue.push(QueueElement(fcost + _ComputeHeuristic(inext, vgoalnodes), inext));
+                }
+            }
+        }
+        if( ifoundgoal < 0 ) {
+            return false;
+        }
+        for(int inode = ifoundgoal; inode >= 0; inode = _vparents[inode]) {
+            vpath.push_back(inode);
+        }
+        std::reverse(vpath.begin(), vpath.end());
+        return true;
+    }
+
+    inline dReal _ComputeHeuristic(int inode, const std::vector<int>& vgoalnodes) const
+    {
+        dReal fmin = std::numeric_limits<dReal>::infinity();
+        FOREACHC(itgoal, vgoalnodes) {
+            fmin = min(fmin, _parameters->_distmetricfn(_vnodes[inode].q, _vnodes[*itgoal].q));
+        }
+        return fmin;
+    }
+
+    /// \brief checks the unchecked nodes and edges of the path, and marks them. Returns true if the whole path is valid.
+    bool _ValidatePath(const std::vector<int>& vpath)
+    {
+        bool bValid = true;
+        FOREACHC(itnode, vpath) {
+            RoadmapNode& node = _vnodes[*itnode];
+            if( node.state == VS_Unknown ) {
+                node.state = _CheckConfiguration(node.q) ? VS_Valid : VS_Invalid;
+                _bRoadmapModified = true;
+            }
+            if( node.state == VS_Invalid ) {
+                bValid = false;
+            }
+        }
+        if( !bValid ) {
+            return false;
+        }
+        for(size_t ipath = 0; ipath+1 < vpath.size(); ++ipath) {
+            RoadmapEdge* pedge = _FindEdge(vpath[ipath], vpath[ipath+1]);
+            BOOST_ASSERT(!!pedge);
+            if( pedge->state == VS_Unknown ) {
+                int ret = _parameters->CheckPathAllConstraints(_vnodes[vpath[ipath]].q, _vnodes[vpath[ipath+1]].q, std::vector<dReal>(), std::vector<dReal>(), 0, IT_Open);
+                pedge->state = ret == 0 ? VS_Valid : VS_Invalid;
+                _bRoadmapModified = true;
+            }
+            if( pedge->state == VS_Invalid ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief edge between the two nodes with the smallest length that is not invalid
+    RoadmapEdge* _FindEdge(int inode0, int inode1)
+    {
+        RoadmapEdge* pbest = NULL;
+        FOREACHC(itedge, _vnodes[inode0].vedges) {
+            RoadmapEdge& edge = _vedges[*itedge];
+            if( edge.GetOtherNode(inode0) == inode1 && edge.state != VS_Invalid && (!pbest || edge.fLength < pbest->fLength) ) {
+                pbest = &edge;
+            }
+        }
+        return pbest;
+    }
+
+    void _ClearRoadmap()
+    {
+        _vnodes.clear();
+        _vedges.clear();
+        _bRoadmapModified = false;
+    }
+
+    std::string _GetRoadmapFilename(const std::string& scenehash) const
+    {
+        std::string directory = _roadmapdirectory.size() > 0 ? _roadmapdirectory : RaveGetHomeDirectory();
+        return str(boost::format("%s/prm.%s.%s.txt")%directory%_robotkey%scenehash);
+    }
+
+    bool _SaveRoadmap(const std::string& filename)
+    {
+        // write to a temporary file first so that concurrent loaders never see a partial roadmap
+        std::string tempfilename = str(boost::format("%s.%d")%filename%utils::GetMicroTime());
+        {
+            std::ofstream f(tempfilename.c_str());
+            if( !f ) {
+                RAVELOG_WARN_FORMAT("env=%d, failed to open %s for writing the roadmap", GetEnv()->GetId()%tempfilename);
+                return false;
+            }
+            f << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+            f << "openrave_prm 1" << std::endl;
+            f << _parameters->GetDOF() << " " << _vnodes.size() << " " << _vedges.size() << " " << _mapBodyStates.size() << std::endl;
+            f << _robotstatekey.size() << " " << _robotstatekey << std::endl;
+            FOREACHC(itstate, _mapBodyStates) {
+                f << itstate->first << " " << itstate->second.hash << " " << itstate->second.bEnabled << " " << itstate->second.t << " " << itstate->second.ab.pos.x << " " << itstate->second.ab.pos.y << " " << itstate->second.ab.pos.z << " " << itstate->second.ab.extents.x << " " << itstate->second.ab.extents.y << " " << itstate->second.ab.extents.z << std::endl;
+            }
+            FOREACHC(itnode, _vnodes) {
+                f << itnode->state;
+                FOREACHC(itq, itnode->q) {
+                    f << " " << *itq;
+                }
+                f << " " << itnode->ab.pos.x << " " << itnode->ab.pos.y << " " << itnode->ab.pos.z << " " << itnode->ab.extents.x << " " << itnode->ab.extents.y << " " << itnode->ab.extents.z << std::endl;
+            }
+            FOREACHC(itedge, _vedges) {
+                f << itedge->inode0 << " " << itedge->inode1 << " " << itedge->fLength << " " << itedge->state << " " << itedge->ab.pos.x << " " << itedge->ab.pos.y << " " << itedge->ab.pos.z << " " << itedge->ab.extents.x << " " << itedge->ab.extents.y << " " << itedge->ab.extents.z << std::endl;
+            }
+            if( !f ) {
+                RAVELOG_WARN_FORMAT("env=%d, failed to write the roadmap to %s", GetEnv()->GetId()%tempfilename);
+                return false;
+            }
+        }
+        if( std::rename(tempfilename.c_str(), filename.c_str()) != 0 ) {
+            RAVELOG_WARN_FORMAT("env=%d, failed to move the roadmap to %s", GetEnv()->GetId()%filename);
+            std::remove(tempfilename.c_str());
+            return false;
+        }
+        if( _scenehash.size() > 0 && filename == _GetRoadmapFilename(_scenehash) ) {
+            std::ofstream flatest(_GetRoadmapFilename("latest").c_str());
+            flatest << _scenehash << std::endl;
+        }
+        _bRoadmapModified = false;
+        RAVELOG_DEBUG_FORMAT("env=%d, saved roadmap with %d nodes and %d edges to %s", GetEnv()->GetId()%_vnodes.size()%_vedges.size()%filename);
+        return true;
+    }
+
+    bool _LoadRoadmap(const std::string& filename)
+    {
+        std::ifstream f(filename.c_str());
+        if( !f ) {
+            return false;
+        }
+        std::string header;
+        int version = 0, dof = 0;
+        size_t numnodes = 0, numedges = 0, numbodies = 0, robotstatekeysize = 0;
+        f >> header >> version >> dof >> numnodes >> numedges >> numbodies >> robotstatekeysize;
+        if( !f || header != "openrave_prm" || version != 1 || dof != _parameters->GetDOF() ) {
+            RAVELOG_WARN_FORMAT("env=%d, %s is not a compatible roadmap", GetEnv()->GetId()%filename);
+            return false;
+        }
+        std::vector<RoadmapNode> vnodes(numnodes);
+        std::vector<RoadmapEdge> vedges(numedges);
+        std::map<std::string, BodyState> mapBodyStates;
+        std::string robotstatekey(robotstatekeysize, ' ');
+        f.get(); // separator
+        f.read(&robotstatekey[0], robotstatekeysize);
+        for(size_t ibody = 0; ibody < numbodies; ++ibody) {
+            std::string name;
+            f >> name;
+            BodyState& state = mapBodyStates[name];
+            f >> state.hash >> state.bEnabled >> state.t >> state.ab.pos.x >> state.ab.pos.y >> state.ab.pos.z >> state.ab.extents.x >> state.ab.extents.y >> state.ab.extents.z;
+        }
+        FOREACH(itnode, vnodes) {
+            itnode->q.resize(dof);
+            f >> itnode->state;
+            FOREACH(itq, itnode->q) {
+                f >> *itq;
+            }
+            f >> itnode->ab.pos.x >> itnode->ab.pos.y >> itnode->ab.pos.z >> itnode->ab.extents.x >> itnode->ab.extents.y >> itnode->ab.extents.z;
+        }
+        for(size_t iedge = 0; iedge < vedges.size(); ++iedge) {
+            RoadmapEdge& edge = vedges[iedge];
+            f >> edge.inode0 >> edge.inode1 >> edge.fLength >> edge.state >> edge.ab.pos.x >> edge.ab.pos.y >> edge.ab.pos.z >> edge.ab.extents.x >> edge.ab.extents.y >> edge.ab.extents.z;
+            if( edge.inode0 < 0 || edge.inode0 >= (int)numnodes || edge.inode1 < 0 || edge.inode1 >= (int)numnodes ) {
+                RAVELOG_WARN_FORMAT("env=%d, %s has an invalid edge %d", GetEnv()->GetId()%filename%iedge);
+                return false;
+            }
+            vnodes[edge.inode0].vedges.push_back(iedge);
+            vnodes[edge.inode1].vedges.push_back(iedge);
+        }
+        if( !f ) {
+            RAVELOG_WARN_FORMAT("env=%d, failed to read the roadmap from %s", GetEnv()->GetId()%filename);
+            return false;
+        }
+
+        _vnodes.swap(vnodes);
+        _vedges.swap(vedges);
+        _mapBodyStates.swap(mapBodyStates);
+        _robotstatekey = robotstatekey;
+        _scenehash = _ComputeSceneHash(_mapBodyStates, _robotstatekey);
+        _bRoadmapModified = false;
+        RAVELOG_DEBUG_FORMAT("env=%d, loaded roadmap with %d nodes and %d edges from %s", GetEnv()->GetId()%_vnodes.size()%_vedges.size()%filename);
+        return true;
+    }
+
+    bool _SetRoadmapDirectoryCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::getline(sinput, _roadmapdirectory);
+        boost::trim(_roadmapdirectory);
+        return true;
+    }
+
+    bool _SaveRoadmapCommand(std::ostream& sout, std::istream& sinput)
+    {
+        if( !_parameters ) {
+            return false;
+        }
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        std::string filename;
+        std::getline(sinput, filename);
+        boost::trim(filename);
+        if( filename.size() == 0 ) {
+            PlannerParameters::StateSaver savestate(_parameters);
+            _SynchronizeScene();
+            filename = _GetRoadmapFilename(_scenehash);
+        }
+        if( !_SaveRoadmap(filename) ) {
+            return false;
+        }
+        sout << filename;
+        return true;
+    }
+
+    bool _LoadRoadmapCommand(std::ostream& sout, std::istream& sinput)
+    {
+        if( !_parameters ) {
+            return false;
+        }
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        std::string filename;
+        std::getline(sinput, filename);
+        boost::trim(filename);
+        return _LoadRoadmap(filename);
+    }
+
+    bool _ClearRoadmapCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _ClearRoadmap();
+        return true;
+    }
+
+    bool _GetRoadmapInfoCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int numvalidnodes = 0, numvalidedges = 0;
+        FOREACHC(itnode, _vnodes) {
+            numvalidnodes += itnode->state == VS_Valid;
+        }
+        FOREACHC(itedge, _vedges) {
+            numvalidedges += itedge->state == VS_Valid;
+        }
+        sout << _vnodes.size() << " " << _vedges.size() << " " << numvalidnodes << " " << numvalidedges;
+        return true;
+    }
+
+    bool _SetConnectionParametersCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sinput >> _nNumNeighbors;
+        if( !sinput ) {
+            return false;
+        }
+        dReal fConnectionRadius = 0, fAABBPadding = 0;
+        if( !!(sinput >> fConnectionRadius) ) {
+            _fConnectionRadius = fConnectionRadius;
+            if( !!(sinput >> fAABBPadding) ) {
+                _fAABBPadding = fAABBPadding;
+            }
+        }
+        return true;
+    }
+
+    bool _SetAutoSaveCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sinput >> _bAutoSave;
+        return !!sinput;
+    }
+
+    PlannerParametersPtr _parameters;
+    RobotBasePtr _robot;
+    SpaceSamplerBasePtr _uniformsampler;
+
+    std::vector<RoadmapNode> _vnodes;
+    std::vector<RoadmapEdge> _vedges;
+    std::string _robotkey; ///< hash of the robot and configuration space the roadmap is for
+    std::string _robotstatekey; ///< state of the robot outside of the configuration space when the roadmap was last synchronized
+    std::string _scenehash; ///< hash of _mapBodyStates and _robotstatekey
+    std::map<std::string, BodyState> _mapBodyStates; ///< the scene when the roadmap was last synchronized
+    bool _bRoadmapModified; ///< true if the roadmap changed since it was last saved or loaded
+
+    std::string _roadmapdirectory;
+    int _nNumNeighbors;
+    dReal _fConnectionRadius, _fAABBPadding;
+    bool _bAutoSave;
+
+    // cache
+    std::vector< std::pair<dReal, int> > _vneighbors;
+    std::vector<dReal> _vcosts;
+    std::vector<int> _vparents;
+    std::vector<uint8_t> _visgoal;
+};
+
+PlannerBasePtr CreatePRMPlanner(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return PlannerBasePtr(new PRMPlanner(penv));
+}
@@ -0,0 +1,108 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the
+// GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+// of the License, or at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+// even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along with this program.
+// If not, see <http://www.gnu.org/licenses/>.
+
+/// Times the ND interpolation of ParabolicInterpolator on random boundary conditions, and the minimum durations of
+/// _ComputeMinimumDurations against the durations of the curves of Compute1DTrajectory.
+///
+/// Usage: benchmarkinterpolator [--samples N] [--dof N] [--seed N]
+#include "openraveplugindefs.h"
+#include <openrave/utils.h>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+
+#include "interpolator.h"
+
+using namespace OpenRAVE;
+using namespace OpenRAVE::RampOptimizerInternal;
+
+int main(int argc, char** argv)
+{
+    size_t numsamples = 10000, ndof = 6;
+    unsigned int seed = 0;
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "--samples") == 0 && i+1 < argc ) {
+            numsamples = atoi(argv[++i]);
+        }
+        else if( strcmp(argv[i], "--dof") == 0 && i+1 < argc ) {
+            ndof = atoi(argv[++i]);
+        }
+        else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+            seed = atoi(argv[++i]);
+        }
+        else {
+            RAVELOG_INFO("benchmarkinterpolator [--samples N] [--dof N] [--seed N]\n");
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if( numsamples == 0 || ndof == 0 ) {
+        RAVELOG_WARN("need at least one sample and one dof\n");
+        return 1;
+    }
+
+    // the boundary conditions of all the samples, sample i uses the elements [i*ndof, (i+1)*ndof)
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<dReal> unit(0, 1);
+    std::vector<dReal> vx0(numsamples*ndof), vx1(numsamples*ndof), vv0(numsamples*ndof), vv1(numsamples*ndof), vvm(numsamples*ndof), vam(numsamples*ndof);
+    for(size_t i = 0; i < vx0.size(); ++i) {
+        vvm[i] = 0.5 + 1.5*unit(rng);
+        vam[i] = 0.5 + 4.5*unit(rng);
+        vx0[i] = 2*unit(rng) - 1;
+        vx1[i] = 2*unit(rng) - 1;
+        vv0[i] = (2*unit(rng) - 1)*vvm[i];
+        vv1[i] = (2*unit(rng) - 1)*vvm[i];
+    }
+
+    ParabolicInterpolator interpolator(ndof);
+    std::vector<dReal> x0(ndof), x1(ndof), v0(ndof), v1(ndof), vm(ndof), am(ndof), xmin(ndof, -10), xmax(ndof, 10), durations;
+    std::vector<RampND> rampnds;
+    ParabolicCurve curve;
+
+    uint64_t timekernel = 0, time1d = 0, timend = 0;
+    dReal fmaxerror = 0;
+    size_t numsuccess = 0;
+    for(size_t isample = 0; isample < numsamples; ++isample) {
+        const size_t offset = isample*ndof;
+        std::copy(vx0.begin()+offset, vx0.begin()+offset+ndof, x0.begin());
+        std::copy(vx1.begin()+offset, vx1.begin()+offset+ndof, x1.begin());
+        std::copy(vv0.begin()+offset, vv0.begin()+offset+ndof, v0.begin());
+        std::copy(vv1.begin()+offset, vv1.begin()+offset+ndof, v1.begin());
+        std::copy(vvm.begin()+offset, vvm.begin()+offset+ndof, vm.begin());
+        std::copy(vam.begin()+offset, vam.begin()+offset+ndof, am.begin());
+
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        interpolator._ComputeMinimumDurations(x0, x1, v0, v1, vm, am, durations);
+        timekernel += utils::GetNanoPerformanceTime() - starttime;
+
+        starttime = utils::GetNanoPerformanceTime();
+        for(size_t idof = 0; idof < ndof; ++idof) {
+            if( interpolator.Compute1DTrajectory(x0[idof], x1[idof], v0[idof], v1[idof], vm[idof], am[idof], curve, false) ) {
+                fmaxerror = std::max(fmaxerror, RaveFabs(curve.GetDuration() - durations[idof]));
+            }
+        }
+        time1d += utils::GetNanoPerformanceTime() - starttime;
+
+        starttime = utils::GetNanoPerformanceTime();
+        if( interpolator.ComputeArbitraryVelNDTrajectory(x0, x1, v0, v1, xmin, xmax, vm, am, rampnds, false) ) {
+            ++numsuccess;
+        }
+        timend += utils::GetNanoPerformanceTime() - starttime;
+    }
+
+    RAVELOG_INFO_FORMAT("%d samples of %d dofs", numsamples%ndof);
+    RAVELOG_INFO_FORMAT("_ComputeMinimumDurations: %.3fns/sample", ((double)timekernel/numsamples));
+    RAVELOG_INFO_FORMAT("Compute1DTrajectory of all dofs: %.3fns/sample, max duration difference=%.3e", ((double)time1d/numsamples)%fmaxerror);
+    RAVELOG_INFO_FORMAT("ComputeArbitraryVelNDTrajectory: %.3fns/sample, %d/%d succeeded", ((double)timend/numsamples)%numsuccess%numsamples);
+    return 0;
+}
@@ -227,25 +227,35 @@ bool ParabolicInterpolator::ComputeArbitraryVelNDTrajectory(const std::vector<dR
         }
     }
 
-    // First compute the minimum trajectory duration for each joint.
+    // First compute the minimum trajectory duration for each joint. Only the slowest joint needs its actual
+    // minimum-time curve, the others are recomputed with the final duration anyway.
+    _ComputeMinimumDurations(x0Vect, x1Vect, v0Vect, v1Vect, vmVect, amVect, _cacheDurationsVect);
     dReal maxDuration = 0;
     size_t maxIndex = 0;
     for (size_t idof = 0; idof < _ndof; ++idof) {
-        if( !Compute1DTrajectory(x0Vect[idof], x1Vect[idof], v0Vect[idof], v1Vect[idof], vmVect[idof], amVect[idof], _cacheCurvesVect[idof], BCHECK_1D_TRAJ) ) {
-            return false;
-        }
-        if( _cacheCurvesVect[idof].GetDuration() > maxDuration ) {
-            maxDuration = _cacheCurvesVect[idof].GetDuration();
+        if( _cacheDurationsVect[idof] > maxDuration ) {
+            maxDuration = _cacheDurationsVect[idof];
             maxIndex = idof;
         }
     }
+    if( !Compute1DTrajectory(x0Vect[maxIndex], x1Vect[maxIndex], v0Vect[maxIndex], v1Vect[maxIndex], vmVect[maxIndex], amVect[maxIndex], _cacheCurvesVect[maxIndex], BCHECK_1D_TRAJ) ) {
+        return false;
+    }
+    if( BCHECK_1D_TRAJ ) {
+        // The curves of the other joints are not needed, only build them to check them like the slowest one
+        for (size_t idof = 0; idof < _ndof; ++idof) {
+            if( idof != maxIndex && !Compute1DTrajectory(x0Vect[idof], x1Vect[idof], v0Vect[idof], v1Vect[idof], vmVect[idof], amVect[idof], _cacheCurve, BCHECK_1D_TRAJ) ) {
+                return false;
+            }
+        }
+    }
 
     //RAVELOG_VERBOSE_FORMAT("Joint %d has the longest duration of %.15e s.", maxIndex%maxDuration);
 
     // Now stretch all the trajectories to some duration t. If not tryHarder, t will be
     // maxDuration. Otherwise, t will be the maximum of maxDuration and tbound (computed by taking
     // into account inoperative time intervals.
-    if( !_RecomputeNDTrajectoryFixedDuration(_cacheCurvesVect, vmVect, amVect, maxIndex, tryHarder) ) {
+    if( !_RecomputeNDTrajectoryFixedDuration(x0Vect, x1Vect, v0Vect, v1Vect, _cacheCurvesVect, vmVect, amVect, maxIndex, tryHarder) ) {
         // Note, however, that even with tryHarder = true, the above interpolation may fail due to
         // inability to fix joint limits violation.
         return false;
@@ -285,7 +295,7 @@ bool ParabolicInterpolator::ComputeArbitraryVelNDTrajectory(const std::vector<dR
     return true;
 }
 
-bool ParabolicInterpolator::_RecomputeNDTrajectoryFixedDuration(std::vector<ParabolicCurve>& curvesVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, size_t maxIndex, bool tryHarder)
+bool ParabolicInterpolator::_RecomputeNDTrajectoryFixedDuration(const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect, std::vector<ParabolicCurve>& curvesVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, size_t maxIndex, bool tryHarder)
 {
     dReal newDuration = curvesVect[maxIndex].GetDuration();
     bool bSuccess = true;
@@ -295,7 +305,7 @@ bool ParabolicInterpolator::_RecomputeNDTrajectoryFixedDuration(std::vector<Para
             //RAVELOG_VERBOSE_FORMAT("joint %d is already the slowest DOF, continue to the next DOF (if any)", idof);
             continue;
         }
-        if( !Compute1DTrajectoryFixedDuration(curvesVect[idof].GetX0(), curvesVect[idof].GetX1(), curvesVect[idof].GetV0(), curvesVect[idof].GetV1(), vmVect[idof], amVect[idof], newDuration, _cacheCurve) ) {
+        if( !Compute1DTrajectoryFixedDuration(x0Vect[idof], x1Vect[idof], v0Vect[idof], v1Vect[idof], vmVect[idof], amVect[idof], newDuration, _cacheCurve) ) {
             bSuccess = false;
             iFailingDOF = idof;
             break;
@@ -306,13 +316,13 @@ bool ParabolicInterpolator::_RecomputeNDTrajectoryFixedDuration(std::vector<Para
 
     if( !bSuccess ) {
         if( !tryHarder ) {
-            RAVELOG_VERBOSE_FORMAT("env=%d, Failed for joint %d. Info: x0=%.15e; x1=%.15e; v0=%.15e; v1=%.15e; duration=%.15e; vm=%.15e; am=%.15e", _envid%iFailingDOF%curvesVect[iFailingDOF].GetX0()%curvesVect[iFailingDOF].GetX1()%curvesVect[iFailingDOF].GetV0()%curvesVect[iFailingDOF].GetV1()%newDuration%vmVect[iFailingDOF]%amVect[iFailingDOF]);
+            RAVELOG_VERBOSE_FORMAT("env=%d, Failed for joint %d. Info: x0=%.15e; x1=%.15e; v0=%.15e; v1=%.15e; duration=%.15e; vm=%.15e; am=%.15e", _envid%iFailingDOF%x0Vect[iFailingDOF]%x1Vect[iFailingDOF]%v0Vect[iFailingDOF]%v1Vect[iFailingDOF]%newDuration%vmVect[iFailingDOF]%amVect[iFailingDOF]);
             return bSuccess;
         }
 
         for (size_t idof = 0; idof < _ndof; ++idof) {
             dReal tBound;
-            if( !_CalculateLeastUpperBoundInoperativeTimeInterval(curvesVect[idof].GetX0(), curvesVect[idof].GetX1(), curvesVect[idof].GetV0(), curvesVect[idof].GetV1(), vmVect[idof], amVect[idof], tBound) ) {
+            if( !_CalculateLeastUpperBoundInoperativeTimeInterval(x0Vect[idof], x1Vect[idof], v0Vect[idof], v1Vect[idof], vmVect[idof], amVect[idof], tBound) ) {
                 return false;
             }
             if( tBound > newDuration ) {
@@ -322,7 +332,7 @@ bool ParabolicInterpolator::_RecomputeNDTrajectoryFixedDuration(std::vector<Para
         RAVELOG_VERBOSE_FORMAT("env=%d, Desired trajectory duration changed: %.15e --> %.15e; diff = %.15e", _envid%curvesVect[maxIndex].GetDuration()%newDuration%(newDuration - curvesVect[maxIndex].GetDuration()));
         bSuccess = true;
         for (size_t idof = 0; idof < _ndof; ++idof) {
-            if( !Compute1DTrajectoryFixedDuration(curvesVect[idof].GetX0(), curvesVect[idof].GetX1(), curvesVect[idof].GetV0(), curvesVect[idof].GetV1(), vmVect[idof], amVect[idof], newDuration, _cacheCurve) ) {
+            if( !Compute1DTrajectoryFixedDuration(x0Vect[idof], x1Vect[idof], v0Vect[idof], v1Vect[idof], vmVect[idof], amVect[idof], newDuration, _cacheCurve) ) {
                 bSuccess = false;
                 iFailingDOF = idof;
                 break;
@@ -331,7 +341,7 @@ bool ParabolicInterpolator::_RecomputeNDTrajectoryFixedDuration(std::vector<Para
             curvesVect[idof] = _cacheCurve;
         }
         if( !bSuccess ) {
-            RAVELOG_VERBOSE_FORMAT("env=%d, Failed for joint %d. Info: x0=%.15e; x1=%.15e; v0=%.15e; v1=%.15e; duration=%.15e; vm=%.15e; am=%.15e", _envid%iFailingDOF%curvesVect[iFailingDOF].GetX0()%curvesVect[iFailingDOF].GetX1()%curvesVect[iFailingDOF].GetV0()%curvesVect[iFailingDOF].GetV1()%newDuration%vmVect[iFailingDOF]%amVect[iFailingDOF]);
+            RAVELOG_VERBOSE_FORMAT("env=%d, Failed for joint %d. Info: x0=%.15e; x1=%.15e; v0=%.15e; v1=%.15e; duration=%.15e; vm=%.15e; am=%.15e", _envid%iFailingDOF%x0Vect[iFailingDOF]%x1Vect[iFailingDOF]%v0Vect[iFailingDOF]%v1Vect[iFailingDOF]%newDuration%vmVect[iFailingDOF]%amVect[iFailingDOF]);
         }
     }
     return bSuccess;
@@ -443,6 +453,42 @@ bool ParabolicInterpolator::ComputeNDTrajectoryFixedDuration(const std::vector<d
     return true;
 }
 
+void ParabolicInterpolator::_ComputeMinimumDurations(const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, std::vector<dReal>& durationsVect) const
+{
+    durationsVect.resize(_ndof);
+    // Same preconditions as Compute1DTrajectory, checked for every DOF even though only the slowest curve is built
+    for (size_t idof = 0; idof < _ndof; ++idof) {
+        OPENRAVE_ASSERT_OP(vmVect[idof], >, 0);
+        OPENRAVE_ASSERT_OP(amVect[idof], >, 0);
+        OPENRAVE_ASSERT_OP(Abs(v0Vect[idof]), <=, vmVect[idof] + g_fRampEpsilon);
+        OPENRAVE_ASSERT_OP(Abs(v1Vect[idof]), <=, vmVect[idof] + g_fRampEpsilon);
+    }
+    const dReal* px0 = &x0Vect[0], *px1 = &x1Vect[0], *pv0 = &v0Vect[0], *pv1 = &v1Vect[0], *pvm = &vmVect[0], *pam = &amVect[0];
+    dReal* pdurations = &durationsVect[0];
+    const size_t ndof = _ndof;
+    // Same cases as Compute1DTrajectory, written with selects only so that the loop gets vectorized.
+    for (size_t idof = 0; idof < ndof; ++idof) {
+        const dReal v0 = pv0[idof], v1 = pv1[idof], vm = pvm[idof], am = pam[idof];
+        const dReal d = px1[idof] - px0[idof];
+        const dReal dv = v1 - v0;
+        const dReal dStraight = (dv > 0 ? 0.5 : -0.5)*(v1*v1 - v0*v0)/am;
+        const dReal tStraight = (dv > 0 ? dv : -dv)/am;
+
+        const dReal a0 = d > dStraight ? am : -am;
+        const dReal vpSqr = 0.5*(v0*v0 + v1*v1) + a0*d;
+        const dReal vpAbs = sqrt(vpSqr > 0 ? vpSqr : 0);
+        const dReal vp = a0 > 0 ? vpAbs : -vpAbs;
+        const dReal tNoViolation = (2*vp - v0 - v1)/a0;
+        // When the peak velocity exceeds vm, the excess triangle is replaced by a constant-velocity middle ramp
+        const dReal h = vpAbs - vm;
+        const dReal tViolation = tNoViolation + h*h/(am*vm);
+
+        const dReal tCurve = vpAbs > vm + g_fRampEpsilon ? tViolation : tNoViolation;
+        const dReal diff = d - dStraight;
+        pdurations[idof] = (diff <= g_fRampEpsilon && diff >= -g_fRampEpsilon) ? tStraight : tCurve;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // 1D Trajectory
 bool ParabolicInterpolator::Compute1DTrajectory(dReal x0, dReal x1, dReal v0, dReal v1, dReal vm, dReal am, ParabolicCurve& curveOut, bool bCheck)
@@ -85,13 +85,14 @@ public:
        trajectory duration. Otherwise, t will be calculated by taking into account inoperative time
        intervals of every joint.
 
-       \param curvesVect the input vector of ParabolicCurves. This will also carry the resulting ParabolicCurves.
+       \param x0Vect, x1Vect, v0Vect, v1Vect boundary conditions of all DOFs
+       \param curvesVect carries the resulting ParabolicCurves. Only curvesVect[maxIndex] has to be set on input.
        \param vmVect velocity limts
        \param amVect acceleration limits
        \param maxIndex the index of the trajectory with the longest duration
        \param tryHarder
      */
-    bool _RecomputeNDTrajectoryFixedDuration(std::vector<ParabolicCurve>& curvesVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, size_t maxIndex, bool tryHarder);
+    bool _RecomputeNDTrajectoryFixedDuration(const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect, std::vector<ParabolicCurve>& curvesVect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, size_t maxIndex, bool tryHarder);
 
     /**
 
@@ -140,6 +141,13 @@ public:
 
     /// Utilities
 
+    /**
+       \brief Compute the durations of the minimum-time 1D trajectories of all DOFs (the durations of the curves
+       Compute1DTrajectory would return) without constructing the curves. The computation is done on the whole
+       DOF arrays at once and is branch-free so that it can use SIMD instructions.
+     */
+    void _ComputeMinimumDurations(const std::vector<dReal>& x0Vect, const std::vector<dReal>& x1Vect, const std::vector<dReal>& v0Vect, const std::vector<dReal>& v1Vect, const std::vector<dReal>& vmVect, const std::vector<dReal>& amVect, std::vector<dReal>& durationsVect) const;
+
     /**
        \brief Calculate the least upper bound of the inoperative interval(s), t,of the given
        trajectory. The value t is such that stretching the trajectory with a duration of greater
@@ -197,6 +205,7 @@ private:
     // Caching stuff
     std::vector<dReal> _cacheVect, _cacheSwitchpointsList;
     std::vector<dReal> _cacheX0Vect, _cacheX1Vect, _cacheV0Vect, _cacheV1Vect, _cacheAVect;
+    std::vector<dReal> _cacheDurationsVect; // for _ComputeMinimumDurations
     Ramp _cacheRamp;
     std::vector<Ramp> _cacheRampsVect;
     std::vector<Ramp> _cacheRampsVect2; // for using in Compute1DTrajectoryFixedDuration
@@ -13,7 +13,7 @@
 //
 // You should have received a copy of the GNU Lesser General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
-#include "openraveplugindefs.h"
+#include "rplanners.h"
 
 class RandomizedAStarPlanner : public PlannerBase
 {
@@ -50,78 +50,6 @@ private:
     };
 
 
-    // sorted by increasing getvalue
-    template <class T, class S> class BinarySearchTree
-    {
-public:
-        BinarySearchTree() {
-            Reset();
-        }
-
-        // other global definitions
-        void Add(T& pex)
-        {
-            BOOST_ASSERT( pex != NULL );
-
-            switch(blocks.size()) {
-            case 0:
-                blocks.push_back(pex);
-                return;
-            case 1:
-                if( blocks.front()->getvalue() < pex->getvalue() ) {
-                    blocks.push_back(pex);
-                }
-                else blocks.insert(blocks.begin(), pex);
-
-                return;
-
-            default: {
-                int imin = 0, imax = (int)blocks.size(), imid;
-
-                while(imin < imax) {
-                    imid = (imin+imax)>>1;
-
-                    if( blocks[imid]->getvalue() > pex->getvalue() ) imax = imid;
-                    else imin = imid+1;
-                }
-
-                blocks.insert(blocks.begin()+imin, pex);
-                return;
-            }
-            }
-        }
-
-        ///< returns the index into blocks
-        int Get(S& s)
-        {
-            switch(blocks.size()) {
-            case 1: return 0;
-            case 2: return blocks.front()->getvalue() < s;
-            default: {
-                int imin = 0, imax = blocks.size()-1, imid;
-
-                while(imin < imax) {
-                    imid = (imin+imax)>>1;
-
-                    if( blocks[imid]->getvalue() > s ) imax = imid;
-                    else if( blocks[imid]->getvalue() == s ) return imid;
-                    else imin = imid+1;
-                }
-
-                return imin;
-            }
-            }
-        }
-
-        void Reset()
-        {
-            blocks.clear();
-            blocks.reserve(1<<16);
-        }
-
-        vector<T> blocks;
-    };
-
 public:
     class RAStarParameters : public PlannerBase::PlannerParameters {
 public:
@@ -189,86 +117,26 @@ protected:
         }
     };
 
-    struct Node
+    /// \brief the search data of a node of _spatialtree, the node stores its index in _vnodes as its user data
+    struct NodeInfo
     {
-        Node() {
-            parent = NULL; level = 0; numchildren = 0;
-        }
-
-        // negative because those are most likely to be popped first
-        dReal getvalue() {
-            return -ftotal;
-        }
-
-        bool compare(const Node* r) {
-            BOOST_ASSERT(r != NULL); return ftotal < r->ftotal;
+        NodeInfo() : fcost(0), ftotal(0), numchildren(0), node(NULL) {
         }
-
         dReal fcost, ftotal;
-        int level;
-        Node* parent;
         int numchildren;
-        vector<dReal> q;     // the configuration immediately follows the struct
+        SimpleNode* node;
     };
 
-    static bool SortChildGoal(const RandomizedAStarPlanner::Node* p1, const RandomizedAStarPlanner::Node* p2)
-    {
-        return p1->ftotal < p2->ftotal;    //p1->ftotal-p1->fcost < p2->ftotal-p2->fcost;
-    }
-
-    // implement kd-tree or approx-nn in the future, deallocates memory from Node
-    class SpatialTree
+    /// \brief orders the open list so that the node with the smallest ftotal is at the front of the heap
+    class OpenListCompare
     {
 public:
-        SpatialTree() {
-            _fBestDist = 0;
-        }
-        ~SpatialTree() {
-            Destroy();
-        }
-
-        void Destroy()
-        {
-            list<Node*>::iterator it;
-            FORIT(it, _nodes)
-            delete *it;
-            FORIT(it, _dead)
-            delete *it;
-            _nodes.clear();
-        }
-
-        inline void AddNode(Node* pnode) {
-            _nodes.push_back(pnode);
+        OpenListCompare(const std::vector<NodeInfo>& vnodes) : _vnodes(vnodes) {
         }
-        Node* GetNN(const vector<dReal>& q)
-        {
-            if( _nodes.size() == 0 )
-                return NULL;
-
-            list<Node*>::iterator itnode = _nodes.begin(), itbest = _nodes.begin();
-            dReal fbest = _pDistMetric(q, _nodes.front()->q);
-            ++itnode;
-
-            while(itnode != _nodes.end()) {
-                dReal f = _pDistMetric(q, (*itnode)->q);
-                if( f < fbest ) {
-                    itbest = itnode;
-                    fbest = f;
-                }
-                ++itnode;
-            }
-
-            _fBestDist = fbest;
-            return *itbest;
+        inline bool operator()(int inode0, int inode1) const {
+            return _vnodes[inode0].ftotal > _vnodes[inode1].ftotal;
         }
-        inline void RemoveNode(Node* pnode) {
-            _nodes.remove(pnode);
-        }
-
-        list<Node*> _nodes;
-        list<Node*> _dead;
-        boost::function<dReal(const std::vector<dReal>&, const std::vector<dReal>&)> _pDistMetric;
-        dReal _fBestDist;         ///< valid after a call to GetNN
+        const std::vector<NodeInfo>& _vnodes;
     };
 
     enum IntervalType {
@@ -278,7 +146,7 @@ public:
         CLOSED
     };
 
-    RandomizedAStarPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
+    RandomizedAStarPlanner(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv), _spatialtree(0)
     {
         __description = ":Interface Author: Rosen Diankov\n\nRandomized A*. A continuous version of A*. See:\n\
 Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf. on Intelligent Robots and Systems, October 2007.\"\n";
@@ -295,15 +163,10 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
 
     void Destroy()
     {
-        _spatialtree.Destroy();
-        _sortedtree.Reset();
-
-        //    for(size_t i = 0; i < _vdeadnodes.size(); ++i) {
-        //        _vdeadnodes[i]->~Node();
-        //        free(_vdeadnodes[i]);
-        //    }
-        _vdeadnodes.clear();
-        _vdeadnodes.reserve(1<<16);
+        _spatialtree.Reset();
+        // keep the memory of the node data and the open list for the next query
+        _vnodes.resize(0);
+        _vopenlist.resize(0);
     }
 
     // Planning Methods
@@ -324,10 +187,12 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
         if( !parameters->_costfn )
             parameters->_costfn = boost::bind(&SimpleCostMetric::Eval,boost::shared_ptr<SimpleCostMetric>(new SimpleCostMetric(_robot)),_1);
 
-        _vSampleConfig.resize(GetDOF());
-        _jointIncrement.resize(GetDOF());
-        _vzero.resize(GetDOF(),0);
-        _spatialtree._pDistMetric = parameters->_distmetricfn;
+        _vSampleConfig.resize(parameters->GetDOF());
+        _vCurrentConfig.resize(parameters->GetDOF());
+        _jointIncrement.resize(parameters->GetDOF());
+        _vzero.resize(parameters->GetDOF(),0);
+        // the cover tree of the rrts, gives logarithmic nearest neighbor queries and allocates the nodes from a pool
+        _spatialtree.Init(shared_planner(), parameters->GetDOF(), parameters->_distmetricfn, parameters->_fStepLength, parameters->_distmetricfn(parameters->_vConfigLowerLimit, parameters->_vConfigUpperLimit));
 
         _jointResolutionInv.resize(0);
         FOREACH(itj, parameters->_vConfigResolution) {
@@ -351,7 +216,7 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
         }
 
         RobotBase::RobotStateSaver saver(_robot);
-        Node* pcurrent=NULL, *pbest = NULL;
+        int icurrent = -1, ibest = -1;
 
         if( _parameters->CheckPathAllConstraints(_parameters->vinitialconfig,_parameters->vinitialconfig,std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) != 0 ) {
             return PlannerStatus(PS_Failed);
@@ -360,43 +225,37 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
         if( _parameters->SetStateValues(_parameters->vinitialconfig) != 0 ) {
             return PlannerStatus(PS_Failed);
         }
-        pcurrent = CreateNode(0, NULL, _parameters->vinitialconfig);
+        Destroy();
+        icurrent = CreateNode(0, -1, _parameters->vinitialconfig);
 
-        vector<dReal> tempconfig(GetDOF());
         int nMaxIter = _parameters->_nMaxIterations > 0 ? _parameters->_nMaxIterations : 8000;
 
         while(1) {
-            if( _sortedtree.blocks.size() == 0 ) {
+            if( _vopenlist.size() == 0 ) {
                 break;
             }
-            else {
-                pcurrent = _sortedtree.blocks.back();
-            }
-
-            // delete from current lists
-            _sortedtree.blocks.pop_back();
-            _vdeadnodes.push_back(pcurrent);
-            BOOST_ASSERT( pcurrent->numchildren < _parameters->nMaxChildren );
+            icurrent = _PopOpenNode();
+            BOOST_ASSERT( _vnodes[icurrent].numchildren < _parameters->nMaxChildren );
 
-            if( pcurrent->ftotal - pcurrent->fcost < 1e-4f ) {
-                pbest = pcurrent;
+            if( _vnodes[icurrent].ftotal - _vnodes[icurrent].fcost < 1e-4f ) {
+                ibest = icurrent;
                 break;
             }
 
-            list<Node*> children;
+            _spatialtree.GetVectorConfig(_vnodes[icurrent].node, _vCurrentConfig);
             int i;
 
-            for(i = 0; i < _parameters->nMaxChildren && pcurrent->numchildren < _parameters->nMaxChildren; ++i) {
+            for(i = 0; i < _parameters->nMaxChildren && _vnodes[icurrent].numchildren < _parameters->nMaxChildren; ++i) {
 
                 // keep on sampling until a valid config
                 int sample;
                 for(sample = 0; sample < _parameters->nMaxSampleTries; ++sample) {
-                    if( !_parameters->_sampleneighfn(_vSampleConfig, pcurrent->q, _parameters->fRadius) ) {
+                    if( !_parameters->_sampleneighfn(_vSampleConfig, _vCurrentConfig, _parameters->fRadius) ) {
                         sample = 1000;
                         break;
                     }
 
-                    if ( _parameters->CheckPathAllConstraints(pcurrent->q, _vSampleConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) == 0 ) {
+                    if ( _parameters->CheckPathAllConstraints(_vCurrentConfig, _vSampleConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) == 0 ) {
                         continue;
                     }
                     if( _parameters->SetStateValues(_vSampleConfig) != 0 ) {
@@ -408,48 +267,52 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
                     continue;
                 }
 
-                //while (getchar() != '\n') usleep(1000);
-
-                Node* nearestnode = _spatialtree.GetNN(_vSampleConfig);
-                if( _spatialtree._fBestDist > _parameters->fDistThresh ) {
-                    dReal fdist = _parameters->_distmetricfn(pcurrent->q, _vSampleConfig);
-                    CreateNode(nearestnode->fcost + fdist * _parameters->_costfn(_vSampleConfig), nearestnode, _vSampleConfig, true);
-                    pcurrent->numchildren++;
+                std::pair<NodeBasePtr, dReal> nn = _spatialtree.FindNearestNode(_vSampleConfig);
+                if( !!nn.first && nn.second > _parameters->fDistThresh ) {
+                    int inearest = (int)((SimpleNode*)nn.first)->_userdata;
+                    dReal fdist = _parameters->_distmetricfn(_vCurrentConfig, _vSampleConfig);
+                    if( CreateNode(_vnodes[inearest].fcost + fdist * _parameters->_costfn(_vSampleConfig), inearest, _vSampleConfig) < 0 ) {
+                        continue;
+                    }
+                    _vnodes[icurrent].numchildren++;
 
-                    if( (_spatialtree._nodes.size() % 50) == 0 ) {
+                    if( (_vnodes.size() % 50) == 0 ) {
                         //DumpNodes();
-                        RAVELOG_VERBOSE(str(boost::format("trees at %d(%d) : to goal at %f,%f\n")%_sortedtree.blocks.size()%_spatialtree._nodes.size()%((pcurrent->ftotal-pcurrent->fcost)/_parameters->fGoalCoeff)%pcurrent->fcost));
+                        RAVELOG_VERBOSE(str(boost::format("trees at %d(%d) : to goal at %f,%f\n")%_vopenlist.size()%_vnodes.size()%((_vnodes[icurrent].ftotal-_vnodes[icurrent].fcost)/_parameters->fGoalCoeff)%_vnodes[icurrent].fcost));
                     }
                 }
             }
 
-            if( (int)_spatialtree._nodes.size() > nMaxIter ) {
+            if( (int)_vnodes.size() > nMaxIter ) {
                 break;
             }
         }
 
-        if( !pbest ) {
+        if( ibest < 0 ) {
             return PlannerStatus(PS_Failed);
         }
 
-        RAVELOG_DEBUG("Path found, final node: %f, %f\n", pbest->fcost, pbest->ftotal-pbest->fcost);
-        if( _parameters->CheckPathAllConstraints(pbest->q,pbest->q,std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) != 0 ) {
+        const NodeInfo& best = _vnodes[ibest];
+        std::vector<dReal> vbestconfig;
+        _spatialtree.GetVectorConfig(best.node, vbestconfig);
+        RAVELOG_DEBUG("Path found, final node: %f, %f\n", best.fcost, best.ftotal-best.fcost);
+        if( _parameters->CheckPathAllConstraints(vbestconfig,vbestconfig,std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart) != 0 ) {
             RAVELOG_WARN("RA* bad initial config\n");
         }
 
         stringstream ss;
-        ss << endl << "Path found, final node: cost: " << pbest->fcost << ", goal: " << (pbest->ftotal-pbest->fcost)/_parameters->fGoalCoeff << endl;
+        ss << endl << "Path found, final node: cost: " << best.fcost << ", goal: " << (best.ftotal-best.fcost)/_parameters->fGoalCoeff << endl;
         for(int i = 0; i < GetDOF(); ++i) {
-            ss << pbest->q[i] << " ";
+            ss << vbestconfig[i] << " ";
         }
         ss << "\n-------\n";
         RAVELOG_DEBUG(ss.str());
 
-        list<Node*> vecnodes;
+        list< vector<dReal> > vecnodes;
 
-        while(pcurrent != NULL) {
-            vecnodes.push_back(pcurrent);
-            pcurrent = pcurrent->parent;
+        for(SimpleNode* pnode = best.node; pnode != NULL; pnode = pnode->rrtparent) {
+            vecnodes.push_back(vector<dReal>());
+            _spatialtree.GetVectorConfig(pnode, vecnodes.back());
         }
 
         _SimpleOptimizePath(vecnodes);
@@ -459,11 +322,11 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
         }
         ptraj->Insert(ptraj->GetNumWaypoints(),_parameters->vinitialconfig);
 
-        list<Node*>::reverse_iterator itcur, itprev;
+        list< vector<dReal> >::reverse_iterator itcur, itprev;
         itcur = vecnodes.rbegin();
         itprev = itcur++;
         while(itcur != vecnodes.rend() ) {
-            _InterpolateNodes((*itprev)->q, (*itcur)->q, ptraj);
+            _InterpolateNodes(*itprev, *itcur, ptraj);
             itprev = itcur;
             ++itcur;
         }
@@ -473,29 +336,43 @@ Rosen Diankov, James Kuffner. \"Randomized Statistical Path Planning. Intl. Conf
     }
 
     int GetTotalNodes() {
-        return (int)_sortedtree.blocks.size();
+        return (int)_vopenlist.size();
     }
 
     bool bUseGauss;
 
 private:
 
-    Node* CreateNode(dReal fcost, Node* parent, const vector<dReal>& pfConfig, bool add = true)
+    /// \brief adds a node to the tree and the open list
+    ///
+    /// \param iparent index of the parent in _vnodes, -1 for the root
+    /// \return the index of the new node in _vnodes, or -1 if the tree already has the configuration
+    int CreateNode(dReal fcost, int iparent, const vector<dReal>& pfConfig)
     {
-        Node* p = new Node();
-        p->parent = parent;
-        if( parent != NULL )
-            p->level = parent->level + 1;
-
-        p->q = pfConfig;
-        p->fcost = fcost;
-        p->ftotal = _parameters->fGoalCoeff*_parameters->_goalfn(pfConfig) + fcost;
-
-        if( add ) {
-            _spatialtree.AddNode(p);
-            _sortedtree.Add(p);
-        }
-        return p;
+        int inode = (int)_vnodes.size();
+        SimpleNode* parent = iparent >= 0 ? _vnodes[iparent].node : NULL;
+        SimpleNode* node = (SimpleNode*)_spatialtree.InsertNode(parent, pfConfig, inode);
+        if( !node ) {
+            return -1;
+        }
+        _vnodes.push_back(NodeInfo());
+        NodeInfo& info = _vnodes.back();
+        info.node = node;
+        info.fcost = fcost;
+        info.ftotal = _parameters->fGoalCoeff*_parameters->_goalfn(pfConfig) + fcost;
+
+        _vopenlist.push_back(inode);
+        std::push_heap(_vopenlist.begin(), _vopenlist.end(), OpenListCompare(_vnodes));
+        return inode;
+    }
+
+    /// \brief removes the node with the smallest ftotal from the open list
+    inline int _PopOpenNode()
+    {
+        std::pop_heap(_vopenlist.begin(), _vopenlist.end(), OpenListCompare(_vnodes));
+        int inode = _vopenlist.back();
+        _vopenlist.pop_back();
+        return inode;
     }
 
     void _InterpolateNodes(const vector<dReal>& pQ0, const vector<dReal>& pQ1, TrajectoryBasePtr ptraj)
@@ -523,12 +400,12 @@ private:
         }
     }
 
-    void _SimpleOptimizePath(list<Node*>& path)
+    void _SimpleOptimizePath(list< vector<dReal> >& path)
     {
         if( path.size() <= 2 )
             return;
 
-        list<Node*>::iterator startNode, endNode;
+        list< vector<dReal> >::iterator startNode, endNode;
 
         for(int i =10; i > 0; --i) {
             // pick a random node on the path, and a random jump ahead
@@ -542,7 +419,7 @@ private:
             advance(endNode, endIndex-startIndex);
 
             // check if the nodes can be connected by a straight line
-            if( _parameters->CheckPathAllConstraints((*startNode)->q, (*endNode)->q, std::vector<dReal>(), std::vector<dReal>(), 0, IT_Open)  != 0 ) {
+            if( _parameters->CheckPathAllConstraints(*startNode, *endNode, std::vector<dReal>(), std::vector<dReal>(), 0, IT_Open)  != 0 ) {
                 continue;
             }
 
@@ -563,39 +440,23 @@ private:
             return;
         }
 
-        vector<Node*>::iterator it;
-
-        vector<Node*>* allnodes[2] = { &_vdeadnodes, &_sortedtree.blocks };
-
         fprintf(f, "allnodes = [");
 
-        for(int n = 0; n < 2; ++n) {
-
-            FORIT(it, *allnodes[n]) {
-                for(int i = 0; i < GetDOF(); ++i) {
-                    fprintf(f, "%f ", (*it)->q[i]);
-                }
-
-                int index = 0;
-                if( (*it)->parent != NULL ) {
-
-                    index = 0;
-                    for(size_t j = 0; j < 2; ++j) {
-                        vector<Node*>::iterator itfound = find(allnodes[j]->begin(), allnodes[j]->end(), (*it)->parent);
-                        if( itfound != allnodes[j]->end() ) {
-                            index += (int)(itfound-allnodes[j]->begin());
-                            break;
-                        }
-                        index += (int)_vdeadnodes.size();
-                    }
-                }
+        FOREACHC(itnode, _vnodes) {
+            for(int i = 0; i < GetDOF(); ++i) {
+                fprintf(f, "%f ", itnode->node->q[i]);
+            }
 
-                fprintf(f, "%f %d\n", ((*it)->ftotal-(*it)->fcost)/_parameters->fGoalCoeff, index+1);
+            int index = 0;
+            if( itnode->node->rrtparent != NULL ) {
+                index = (int)itnode->node->rrtparent->_userdata;
             }
+
+            fprintf(f, "%f %d\n", (itnode->ftotal-itnode->fcost)/_parameters->fGoalCoeff, index+1);
         }
 
         fprintf(f,"];\r\n\r\n");
-        fprintf(f, "%s", str(boost::format("startindex = %d")%(_vdeadnodes.size()+1)).c_str());
+        fprintf(f, "%s", "startindex = 1");
 
         fclose(f);
     }
@@ -605,13 +466,13 @@ private:
     }
 
     boost::shared_ptr<RAStarParameters> _parameters;
-    SpatialTree _spatialtree;
-    BinarySearchTree<Node*, dReal> _sortedtree;       // sorted by decreasing value
+    SpatialTree<SimpleNode> _spatialtree; ///< stores the configurations of all the nodes
+    std::vector<NodeInfo> _vnodes; ///< indexed by the user data of the nodes of _spatialtree
+    std::vector<int> _vopenlist; ///< binary heap of the indices of the nodes that have not been expanded, see OpenListCompare
 
     RobotBasePtr _robot;
 
-    vector<Node*> _vdeadnodes;     ///< dead nodes
-    vector<dReal> _vSampleConfig;
+    vector<dReal> _vSampleConfig, _vCurrentConfig;
     vector<dReal> _jointIncrement, _jointResolutionInv;
     vector<dReal> _vzero;
 
@@ -0,0 +1,407 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "openraveplugindefs.h"
+
+#include <boost/algorithm/string.hpp>
+
+namespace rplanners {
+
+/** \brief time-optimal retiming of the piecewise linear path through the waypoints, respecting the velocity, acceleration and torque limits.
+
+    Hung Pham, Quang-Cuong Pham. "A New Approach to Time-Optimal Path Parameterization based on Reachability Analysis", IEEE Transactions on Robotics, 2018.
+
+    Every segment q(s) = q0 + s*(q1-q0), s in [0,1] is discretized into gridpoints. With x = sdot^2 and u = sddot, the joint
+    velocities are (q1-q0)*sqrt(x), the joint accelerations (q1-q0)*u and the torques are linear in (u,x):
+
+    \code
+    torque = M(q)*(q1-q0)*u + C(q,q1-q0)*x + G(q)
+    \endcode
+
+    The coefficients of all gridpoints of a segment are computed with one batched inverse dynamics call. A backward pass
+    computes the interval of x at every gridpoint from which the segment can still be stopped at its end, and a forward pass
+    takes the largest feasible u at every gridpoint. Since u is constant between gridpoints and the segments are linear, the
+    output is exactly quadratic between the gridpoints. The path stops at every waypoint, the torque limits are checked at the
+    gridpoints.
+ */
+class ReachabilityTrajectoryRetimer : public PlannerBase
+{
+    /// \brief the dofs of a body that have torque limits and the configuration indices they come from
+    struct TorqueBodyInfo
+    {
+        KinBodyPtr pbody;
+        std::vector<int> vuseddofindices, vusedconfigindices;
+        std::vector< std::pair<int, std::pair<dReal, dReal> > > vtorquelimits; ///< index into vuseddofindices and the lower and upper torque limits
+    };
+
+public:
+    ReachabilityTrajectoryRetimer(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
+    {
+        __description = ":Interface Author: agent\n\nTime-optimal re-timing of the linear path through the waypoints with reachability analysis (TOPP-RA), respecting the velocity, acceleration and torque limits of the dofs. The robot stops at every waypoint. Overwrites the velocities and timestamps.";
+        RegisterCommand("SetGridStep",boost::bind(&ReachabilityTrajectoryRetimer::_SetGridStepCommand,this,_1,_2),
+                        "\"gridstep [mingridpoints]\". Every segment is discretized so that no dof moves more than gridstep between gridpoints (default 0.02), and has at least mingridpoints intervals (default 4).");
+        RegisterCommand("SetTorqueLimitMode",boost::bind(&ReachabilityTrajectoryRetimer::_SetTorqueLimitModeCommand,this,_1,_2),
+                        "0 to use the nominal torque limits of the joints (default), 1 to use the instantaneous torque limits, -1 to ignore torques");
+        _fGridStep = 0.02;
+        _nMinGridPoints = 4;
+        _torquelimitmode = 0;
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr params)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        params->Validate();
+        _parameters.reset(new ConstraintTrajectoryTimingParameters());
+        _parameters->copy(params);
+        return _InitPlan();
+    }
+
+    virtual bool InitPlan(RobotBasePtr pbase, std::istream& isParameters)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        _parameters.reset(new ConstraintTrajectoryTimingParameters());
+        isParameters >> *_parameters;
+        _parameters->Validate();
+        return _InitPlan();
+    }
+
+    bool _InitPlan()
+    {
+        int dof = _parameters->GetDOF();
+        if( (int)_parameters->_vConfigVelocityLimit.size() != dof || (int)_parameters->_vConfigAccelerationLimit.size() != dof ) {
+            return false;
+        }
+        if( _parameters->_interpolation.size() == 0 ) {
+            _parameters->_interpolation = "quadratic";
+        }
+        else if( _parameters->_interpolation != "quadratic" ) {
+            RAVELOG_WARN_FORMAT("env=%d, %s only supports quadratic interpolation, not %s", GetEnv()->GetId()%GetXMLId()%_parameters->_interpolation);
+            return false;
+        }
+
+        _vtorquebodies.resize(0);
+        if( _torquelimitmode >= 0 ) {
+            std::vector<KinBodyPtr> vusedbodies;
+            _parameters->_configurationspecification.ExtractUsedBodies(GetEnv(), vusedbodies);
+            FOREACH(itbody, vusedbodies) {
+                TorqueBodyInfo info;
+                info.pbody = *itbody;
+                _parameters->_configurationspecification.ExtractUsedIndices(info.pbody, info.vuseddofindices, info.vusedconfigindices);
+                for(size_t index = 0; index < info.vuseddofindices.size(); ++index) {
+                    KinBody::JointPtr pjoint = info.pbody->GetJointFromDOFIndex(info.vuseddofindices[index]);
+                    int iaxis = info.vuseddofindices[index] - pjoint->GetDOFIndex();
+                    std::pair<dReal, dReal> torquelimits = _torquelimitmode == 1 ? pjoint->GetInstantaneousTorqueLimits(iaxis) : pjoint->GetNominalTorqueLimits(iaxis);
+                    if( torquelimits.first < torquelimits.second ) {
+                        info.vtorquelimits.push_back(std::make_pair((int)index, torquelimits));
+                    }
+                }
+                if( info.vtorquelimits.size() > 0 ) {
+                    _vtorquebodies.push_back(info);
+                }
+            }
+        }
+        return true;
+    }
+
+    virtual PlannerParametersConstPtr GetParameters() const {
+        return _parameters;
+    }
+
+    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        BOOST_ASSERT(!!_parameters && !!ptraj && ptraj->GetEnv()==GetEnv());
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        size_t numpoints = ptraj->GetNumWaypoints();
+        if( numpoints == 0 ) {
+            return PlannerStatus("there's nothing to retime", PS_Failed);
+        }
+        int dof = _parameters->GetDOF();
+        ptraj->GetWaypoints(0, numpoints, _vwaypoints, _parameters->_configurationspecification);
+
+        // the bodies are put in the gridpoint states by the inverse dynamics
+        std::vector<KinBody::KinBodyStateSaverPtr> vstatesavers;
+        FOREACH(itinfo, _vtorquebodies) {
+            vstatesavers.push_back(KinBody::KinBodyStateSaverPtr(new KinBody::KinBodyStateSaver(itinfo->pbody, KinBody::Save_LinkTransformation|KinBody::Save_LinkVelocities)));
+        }
+
+        // output data is [positions, velocities, deltatime]
+        ConfigurationSpecification outputspec = _parameters->_configurationspecification;
+        outputspec += _parameters->_configurationspecification.ConvertToVelocitySpecification();
+        int timeoffset = outputspec.AddDeltaTimeGroup();
+        int outputdof = outputspec.GetDOF();
+        _vdata.resize(outputdof);
+        std::fill(_vdata.begin(), _vdata.end(), 0);
+        std::copy(_vwaypoints.begin(), _vwaypoints.begin()+dof, _vdata.begin());
+
+        std::vector<dReal> vdiff(dof);
+        for(size_t ipoint = 0; ipoint+1 < numpoints; ++ipoint) {
+            std::vector<dReal>::const_iterator itq0 = _vwaypoints.begin()+ipoint*dof;
+            std::copy(itq0+dof, itq0+2*dof, vdiff.begin());
+            _vq0.assign(itq0, itq0+dof);
+            _parameters->_diffstatefn(vdiff, _vq0);
+            dReal fmaxdiff = 0;
+            for(int idof = 0; idof < dof; ++idof) {
+                fmaxdiff = max(fmaxdiff, RaveFabs(vdiff[idof]));
+            }
+            if( fmaxdiff <= g_fEpsilonLinear ) {
+                continue;
+            }
+            int numintervals = max(_nMinGridPoints, (int)ceil(fmaxdiff/_fGridStep));
+            std::string description;
+            if( !_RetimeSegment(vdiff, numintervals, description) ) {
+                description = str(boost::format("env=%d, failed to retime segment %d: %s")%GetEnv()->GetId()%ipoint%description);
+                RAVELOG_WARN(description);
+                return PlannerStatus(description, PS_Failed);
+            }
+
+            size_t offset = _vdata.size();
+            _vdata.resize(offset + numintervals*outputdof, 0);
+            dReal fstep = dReal(1)/numintervals;
+            for(int igrid = 1; igrid <= numintervals; ++igrid) {
+                std::vector<dReal>::iterator itdata = _vdata.begin() + offset + (igrid-1)*outputdof;
+                dReal s = igrid*fstep, sdot = RaveSqrt(_vx[igrid]);
+                for(int idof = 0; idof < dof; ++idof) {
+                    *(itdata+idof) = _vq0[idof] + s*vdiff[idof];
+                    *(itdata+dof+idof) = sdot*vdiff[idof];
+                }
+                *(itdata+timeoffset) = 2*fstep/(RaveSqrt(_vx[igrid-1]) + sdot);
+            }
+        }
+
+        ConfigurationSpecification newspec = _parameters->_configurationspecification;
+        FOREACH(itgroup, newspec._vgroups) {
+            itgroup->interpolation = _parameters->_interpolation;
+        }
+        newspec.AddDerivativeGroups(1,false);
+        newspec.AddDeltaTimeGroup();
+        ptraj->Init(newspec);
+        ptraj->Insert(0, _vdata, outputspec);
+        return PlannerStatus(PS_HasSolution);
+    }
+
+protected:
+    /// \brief fills the constraints alpha*u + beta*x <= gamma of every gridpoint of the segment q0 + s*vdiff, except the last one
+    void _ComputeConstraints(const std::vector<dReal>& vdiff, int numintervals)
+    {
+        int dof = _parameters->GetDOF();
+        _nNumConstraints = 1 + 3*dof;
+        FOREACHC(itinfo, _vtorquebodies) {
+            _nNumConstraints += 2*itinfo->vtorquelimits.size();
+        }
+        _vconstraints.resize(numintervals*_nNumConstraints*3);
+        dReal fstep = dReal(1)/numintervals;
+        for(int igrid = 0; igrid < numintervals; ++igrid) {
+            dReal* pconstraint = &_vconstraints[igrid*_nNumConstraints*3];
+            // x >= 0
+            pconstraint[0] = 0; pconstraint[1] = -1; pconstraint[2] = 0;
+            pconstraint += 3;
+            for(int idof = 0; idof < dof; ++idof) {
+                dReal fvellimit = _parameters->_vConfigVelocityLimit[idof], faccellimit = _parameters->_vConfigAccelerationLimit[idof];
+                pconstraint[0] = 0; pconstraint[1] = vdiff[idof]*vdiff[idof]; pconstraint[2] = fvellimit*fvellimit;
+                pconstraint[3] = vdiff[idof]; pconstraint[4] = 0; pconstraint[5] = faccellimit;
+                pconstraint[6] = -vdiff[idof]; pconstraint[7] = 0; pconstraint[8] = faccellimit;
+                pconstraint += 9;
+            }
+        }
+
+        // torque = M*vdiff*u + C(q,vdiff)*x + G, computed from three inverse dynamics samples (accel=vdiff), (vel=vdiff) and (nothing) at every gridpoint
+        size_t constraintoffset = 1 + 3*dof;
+        FOREACHC(itinfo, _vtorquebodies) {
+            KinBodyPtr pbody = itinfo->pbody;
+            int bodydof = pbody->GetDOF();
+            pbody->GetDOFValues(_vbodyvalues);
+            _vsamplevalues.resize(3*numintervals*bodydof);
+            _vsamplevelocities.resize(3*numintervals*bodydof);
+            _vsampleaccelerations.resize(3*numintervals*bodydof);
+            std::fill(_vsamplevelocities.begin(), _vsamplevelocities.end(), 0);
+            std::fill(_vsampleaccelerations.begin(), _vsampleaccelerations.end(), 0);
+            for(int igrid = 0; igrid < numintervals; ++igrid) {
+                for(size_t index = 0; index < itinfo->vuseddofindices.size(); ++index) {
+                    int configindex = itinfo->vusedconfigindices[index];
+                    _vbodyvalues[itinfo->vuseddofindices[index]] = _vq0[configindex] + igrid*fstep*vdiff[configindex];
+                }
+                for(int isample = 0; isample < 3; ++isample) {
+                    std::copy(_vbodyvalues.begin(), _vbodyvalues.end(), _vsamplevalues.begin()+(3*igrid+isample)*bodydof);
+                }
+                for(size_t index = 0; index < itinfo->vuseddofindices.size(); ++index) {
+                    dReal fdiff = vdiff[itinfo->vusedconfigindices[index]];
+                    _vsampleaccelerations[3*igrid*bodydof + itinfo->vuseddofindices[index]] = fdiff;
+                    _vsamplevelocities[(3*igrid+1)*bodydof + itinfo->vuseddofindices[index]] = fdiff;
+                }
+            }
+            pbody->ComputeInverseDynamicsSamples(_vsampletorques, _vsamplevalues, _vsamplevelocities, _vsampleaccelerations);
+
+            for(int igrid = 0; igrid < numintervals; ++igrid) {
+                dReal* pconstraint = &_vconstraints[(igrid*_nNumConstraints + constraintoffset)*3];
+                const dReal* ptorques = &_vsampletorques[3*igrid*bodydof];
+                FOREACHC(ittorquelimit, itinfo->vtorquelimits) {
+                    int dofindex = itinfo->vuseddofindices[ittorquelimit->first];
+                    dReal fgravity = ptorques[2*bodydof+dofindex];
+                    dReal a = ptorques[dofindex] - fgravity, b = ptorques[bodydof+dofindex] - fgravity;
+                    pconstraint[0] = a; pconstraint[1] = b; pconstraint[2] = ittorquelimit->second.second - fgravity;
+                    pconstraint[3] = -a; pconstraint[4] = -b; pconstraint[5] = fgravity - ittorquelimit->second.first;
+                    pconstraint += 6;
+                }
+            }
+            constraintoffset += 2*itinfo->vtorquelimits.size();
+        }
+    }
+
+    /// \brief computes the interval of x at a gridpoint for which a u satisfying the constraints of the gridpoint exists and brings x+2*fstep*u into [xnextmin, xnextmax]
+    ///
+    /// The constraints with alpha > 0 give upper bounds on u and the ones with alpha < 0 lower bounds, every pair of them gives a
+    /// bound on x. This is the exact projection of the two dimensional feasible set onto x.
+    bool _ComputeControllableInterval(const dReal* pconstraints, dReal fstep, dReal xnextmin, dReal xnextmax, dReal& xmin, dReal& xmax)
+    {
+        // u <= p - r*x and u >= p - r*x
+        _vupperbounds.resize(0);
+        _vlowerbounds.resize(0);
+        _vupperbounds.push_back(std::make_pair(xnextmax/(2*fstep), 1/(2*fstep)));
+        _vlowerbounds.push_back(std::make_pair(xnextmin/(2*fstep), 1/(2*fstep)));
+        xmin = 0;
+        xmax = std::numeric_limits<dReal>::infinity();
+        for(int iconstraint = 0; iconstraint < _nNumConstraints; ++iconstraint) {
+            dReal alpha = pconstraints[3*iconstraint], beta = pconstraints[3*iconstraint+1], gamma = pconstraints[3*iconstraint+2];
+            if( RaveFabs(alpha) <= g_fEpsilon ) {
+                if( !_AddLinearBound(beta, gamma, xmin, xmax) ) {
+                    return false;
+                }
+            }
+            else if( alpha > 0 ) {
+                _vupperbounds.push_back(std::make_pair(gamma/alpha, beta/alpha));
+            }
+            else {
+                _vlowerbounds.push_back(std::make_pair(gamma/alpha, beta/alpha));
+            }
+        }
+        FOREACHC(itupper, _vupperbounds) {
+            FOREACHC(itlower, _vlowerbounds) {
+                if( !_AddLinearBound(itupper->second - itlower->second, itupper->first - itlower->first, xmin, xmax) ) {
+                    return false;
+                }
+            }
+        }
+        return xmin <= xmax + g_fEpsilonLinear;
+    }
+
+    /// \brief intersects [xmin, xmax] with c*x <= d
+    static bool _AddLinearBound(dReal c, dReal d, dReal& xmin, dReal& xmax)
+    {
+        if( c > g_fEpsilon ) {
+            xmax = min(xmax, d/c);
+        }
+        else if( c < -g_fEpsilon ) {
+            xmin = max(xmin, d/c);
+        }
+        else if( d < -g_fEpsilonLinear ) {
+            return false;
+        }
+        return true;
+    }
+
+    /// \brief returns the largest u satisfying the constraints of the gridpoint at x that brings x+2*fstep*u into [xnextmin, xnextmax]
+    dReal _ComputeMaxControl(const dReal* pconstraints, dReal fstep, dReal x, dReal xnextmin, dReal xnextmax)
+    {
+        dReal umin = (xnextmin - x)/(2*fstep), umax = (xnextmax - x)/(2*fstep);
+        for(int iconstraint = 0; iconstraint < _nNumConstraints; ++iconstraint) {
+            dReal alpha = pconstraints[3*iconstraint], beta = pconstraints[3*iconstraint+1], gamma = pconstraints[3*iconstraint+2];
+            if( alpha > g_fEpsilon ) {
+                umax = min(umax, (gamma - beta*x)/alpha);
+            }
+            else if( alpha < -g_fEpsilon ) {
+                umin = max(umin, (gamma - beta*x)/alpha);
+            }
+        }
+        // x is inside the controllable interval, so umin > umax only from numerical errors
+        return max(umin, umax);
+    }
+
+    /// \brief computes _vx, the squared path velocity at every gridpoint of the segment q0 + s*vdiff that starts and ends at rest
+    bool _RetimeSegment(const std::vector<dReal>& vdiff, int numintervals, std::string& description)
+    {
+        _ComputeConstraints(vdiff, numintervals);
+        dReal fstep = dReal(1)/numintervals;
+        _vxmin.resize(numintervals+1);
+        _vxmax.resize(numintervals+1);
+        _vxmin[numintervals] = 0;
+        _vxmax[numintervals] = 0;
+        for(int igrid = numintervals-1; igrid >= 0; --igrid) {
+            if( !_ComputeControllableInterval(&_vconstraints[igrid*_nNumConstraints*3], fstep, _vxmin[igrid+1], _vxmax[igrid+1], _vxmin[igrid], _vxmax[igrid]) ) {
+                description = str(boost::format("gridpoint %d/%d is not controllable, the torque limits might be too small to hold the robot")%igrid%numintervals);
+                return false;
+            }
+        }
+        if( _vxmin[0] > g_fEpsilonLinear ) {
+            description = "cannot start the segment at rest";
+            return false;
+        }
+
+        _vx.resize(numintervals+1);
+        _vx[0] = 0;
+        for(int igrid = 0; igrid < numintervals; ++igrid) {
+            dReal u = _ComputeMaxControl(&_vconstraints[igrid*_nNumConstraints*3], fstep, _vx[igrid], _vxmin[igrid+1], _vxmax[igrid+1]);
+            _vx[igrid+1] = min(_vxmax[igrid+1], max(_vxmin[igrid+1], _vx[igrid] + 2*fstep*u));
+            if( RaveSqrt(_vx[igrid]) + RaveSqrt(_vx[igrid+1]) <= g_fEpsilon ) {
+                description = str(boost::format("cannot move at gridpoint %d/%d")%igrid%numintervals);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool _SetGridStepCommand(std::ostream& sout, std::istream& sinput)
+    {
+        dReal fgridstep = 0;
+        int nmingridpoints = _nMinGridPoints;
+        sinput >> fgridstep >> nmingridpoints;
+        if( fgridstep <= 0 || nmingridpoints < 2 ) {
+            return false;
+        }
+        _fGridStep = fgridstep;
+        _nMinGridPoints = nmingridpoints;
+        return true;
+    }
+
+    bool _SetTorqueLimitModeCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sinput >> _torquelimitmode;
+        if( !!_parameters ) {
+            EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+            _InitPlan();
+        }
+        return !!sinput;
+    }
+
+    ConstraintTrajectoryTimingParametersPtr _parameters;
+    std::vector<TorqueBodyInfo> _vtorquebodies;
+    dReal _fGridStep;
+    int _nMinGridPoints;
+    int _torquelimitmode;
+
+    // cache
+    int _nNumConstraints;
+    std::vector<dReal> _vwaypoints, _vdata, _vq0;
+    std::vector<dReal> _vconstraints; ///< alpha, beta, gamma of the _nNumConstraints constraints of every gridpoint
+    std::vector<dReal> _vxmin, _vxmax, _vx;
+    std::vector< std::pair<dReal, dReal> > _vupperbounds, _vlowerbounds;
+    std::vector<dReal> _vbodyvalues, _vsamplevalues, _vsamplevelocities, _vsampleaccelerations, _vsampletorques;
+};
+
+PlannerBasePtr CreateReachabilityTrajectoryRetimer(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return PlannerBasePtr(new ReachabilityTrajectoryRetimer(penv, sinput));
+}
+
+} // end namespace rplanners
@@ -25,6 +25,10 @@ PlannerBasePtr CreateRandomizedAStarPlanner(EnvironmentBasePtr penv, std::istrea
 PlannerBasePtr CreateWorkspaceTrajectoryTracker(EnvironmentBasePtr penv, std::istream& sinput);
 PlannerBasePtr CreateLinearSmoother(EnvironmentBasePtr penv, std::istream& sinput);
 PlannerBasePtr CreateConstraintParabolicSmoother(EnvironmentBasePtr penv, std::istream& sinput);
+PlannerBasePtr CreatePlannerPortfolio(EnvironmentBasePtr penv, std::istream& sinput);
+PlannerBasePtr CreatePrioritizedPlanner(EnvironmentBasePtr penv, std::istream& sinput);
+PlannerBasePtr CreatePRMPlanner(EnvironmentBasePtr penv, std::istream& sinput);
+PlannerBasePtr CreateExperiencePlanner(EnvironmentBasePtr penv, std::istream& sinput);
 
 namespace rplanners {
 PlannerBasePtr CreateParabolicSmoother(EnvironmentBasePtr penv, std::istream& sinput);
@@ -33,6 +37,7 @@ PlannerBasePtr CreateLinearTrajectoryRetimer(EnvironmentBasePtr penv, std::istre
 PlannerBasePtr CreateParabolicTrajectoryRetimer(EnvironmentBasePtr penv, std::istream& sinput);
 PlannerBasePtr CreateParabolicTrajectoryRetimer2(EnvironmentBasePtr penv, std::istream& sinput);
 PlannerBasePtr CreateCubicTrajectoryRetimer(EnvironmentBasePtr penv, std::istream& sinput);
+PlannerBasePtr CreateReachabilityTrajectoryRetimer(EnvironmentBasePtr penv, std::istream& sinput);
 }
 
 InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string& interfacename, std::istream& sinput, EnvironmentBasePtr penv)
@@ -49,6 +54,9 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
             RAVELOG_WARN("rBiRRT is deprecated, use BiRRT\n");
             return InterfaceBasePtr(new BirrtPlanner(penv));
         }
+        else if( interfacename == "lazybirrt") {
+            return InterfaceBasePtr(new BirrtPlanner(penv, true));
+        }
         else if( interfacename == "basicrrt") {
             return InterfaceBasePtr(new BasicRrtPlanner(penv));
         }
@@ -73,6 +81,9 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
         else if( interfacename == "cubictrajectoryretimer" ) {
             return rplanners::CreateCubicTrajectoryRetimer(penv,sinput);
         }
+        else if( interfacename == "reachabilitytrajectoryretimer" ) {
+            return rplanners::CreateReachabilityTrajectoryRetimer(penv,sinput);
+        }
         else if( interfacename == "workspacetrajectorytracker" ) {
             return CreateWorkspaceTrajectoryTracker(penv,sinput);
         }
@@ -88,6 +99,18 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
         else if( interfacename == "constraintparabolicsmoother" ) {
             return CreateConstraintParabolicSmoother(penv,sinput);
         }
+        else if( interfacename == "plannerportfolio" ) {
+            return CreatePlannerPortfolio(penv,sinput);
+        }
+        else if( interfacename == "prioritizedplanner" ) {
+            return CreatePrioritizedPlanner(penv,sinput);
+        }
+        else if( interfacename == "prm" ) {
+            return CreatePRMPlanner(penv,sinput);
+        }
+        else if( interfacename == "experienceplanner" ) {
+            return CreateExperiencePlanner(penv,sinput);
+        }
         break;
     default:
         break;
@@ -99,6 +122,7 @@ void GetPluginAttributesValidated(PLUGININFO& info)
 {
     info.interfacenames[PT_Planner].push_back("RAStar");
     info.interfacenames[PT_Planner].push_back("BiRRT");
+    info.interfacenames[PT_Planner].push_back("LazyBiRRT");
     info.interfacenames[PT_Planner].push_back("BasicRRT");
     info.interfacenames[PT_Planner].push_back("ExplorationRRT");
     info.interfacenames[PT_Planner].push_back("GraspGradient");
@@ -107,11 +131,16 @@ void GetPluginAttributesValidated(PLUGININFO& info)
     info.interfacenames[PT_Planner].push_back("ParabolicTrajectoryRetimer");
     info.interfacenames[PT_Planner].push_back("ParabolicTrajectoryRetimer2");
     info.interfacenames[PT_Planner].push_back("CubicTrajectoryRetimer");
+    info.interfacenames[PT_Planner].push_back("ReachabilityTrajectoryRetimer");
     info.interfacenames[PT_Planner].push_back("WorkspaceTrajectoryTracker");
     info.interfacenames[PT_Planner].push_back("LinearSmoother");
     info.interfacenames[PT_Planner].push_back("ParabolicSmoother");
     info.interfacenames[PT_Planner].push_back("ParabolicSmoother2");
     info.interfacenames[PT_Planner].push_back("ConstraintParabolicSmoother");
+    info.interfacenames[PT_Planner].push_back("PlannerPortfolio");
+    info.interfacenames[PT_Planner].push_back("PrioritizedPlanner");
+    info.interfacenames[PT_Planner].push_back("PRM");
+    info.interfacenames[PT_Planner].push_back("ExperiencePlanner");
 }
 
 OPENRAVE_PLUGIN_API void DestroyPlugin()
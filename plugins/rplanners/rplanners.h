@@ -18,6 +18,7 @@
 #define RAVE_PLANNERS_H
 
 #include "openraveplugindefs.h"
+#include "plannerstatistics.h"
 
 #include <boost/pool/pool.hpp>
 
@@ -68,6 +69,94 @@ public:
 #define VectorWrapper std::vector
 #endif // __clang__
 
+/// \brief monotonic memory arena of one planning tree, allocations are only released all at once by Release
+///
+/// The tree memory of a planning call does not go through the global allocator, so planners running in parallel do not contend for it. Not thread safe.
+class PlannerArena
+{
+public:
+    PlannerArena() : _nUsed(0), _nChunkSize(0), _nNextChunkSize(s_nMinChunkSize) {
+    }
+    ~PlannerArena() {
+        Release();
+    }
+
+    void* Allocate(size_t size)
+    {
+        size = (size + s_nAlignment - 1) & ~(s_nAlignment - 1);
+        if( _vchunks.size() == 0 || _nUsed + size > _nChunkSize ) {
+            _nChunkSize = max(size, _nNextChunkSize);
+            if( 2*_nNextChunkSize <= s_nMaxChunkSize ) {
+                _nNextChunkSize *= 2;
+            }
+            _vchunks.push_back(static_cast<uint8_t*>(::operator new(_nChunkSize)));
+            _nUsed = 0;
+        }
+        void* p = _vchunks.back() + _nUsed;
+        _nUsed += size;
+        return p;
+    }
+
+    /// \brief frees all the memory, the objects allocated from the arena have to be destroyed already
+    void Release()
+    {
+        FOREACH(itchunk, _vchunks) {
+            ::operator delete(*itchunk);
+        }
+        _vchunks.resize(0);
+        _nUsed = _nChunkSize = 0;
+        _nNextChunkSize = s_nMinChunkSize;
+    }
+
+private:
+    static const size_t s_nAlignment = 16;
+    static const size_t s_nMinChunkSize = 1<<16;
+    static const size_t s_nMaxChunkSize = 1<<22;
+    std::vector<uint8_t*> _vchunks;
+    size_t _nUsed; ///< bytes used of _vchunks.back()
+    size_t _nChunkSize; ///< size of _vchunks.back()
+    size_t _nNextChunkSize;
+};
+
+/// \brief allocates the containers of the planning trees from a PlannerArena, deallocation is a no-op. Uses the global allocator if no arena is set.
+template <typename T>
+class PlannerArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    PlannerArenaAllocator(PlannerArena* parena=NULL) : _parena(parena) {
+    }
+    template <typename U>
+    PlannerArenaAllocator(const PlannerArenaAllocator<U>& r) : _parena(r._parena) {
+    }
+
+    T* allocate(size_t n)
+    {
+        if( !_parena ) {
+            return static_cast<T*>(::operator new(n*sizeof(T)));
+        }
+        return static_cast<T*>(_parena->Allocate(n*sizeof(T)));
+    }
+    void deallocate(T* p, size_t n)
+    {
+        if( !_parena ) {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const PlannerArenaAllocator<U>& r) const {
+        return _parena == r._parena;
+    }
+    template <typename U>
+    bool operator!=(const PlannerArenaAllocator<U>& r) const {
+        return _parena != r._parena;
+    }
+
+    PlannerArena* _parena;
+};
+
 class NodeBase
 {
 public:
@@ -78,29 +167,38 @@ typedef NodeBase* NodeBasePtr;
 class SimpleNode : public NodeBase
 {
 public:
-    SimpleNode(SimpleNode* parent, const vector<dReal>& config) : rrtparent(parent) {
+    typedef std::vector<SimpleNode*, PlannerArenaAllocator<SimpleNode*> > NodeVector;
+
+    SimpleNode(SimpleNode* parent, const vector<dReal>& config, PlannerArena* parena=NULL) : rrtparent(parent), _vrrtchildren(PlannerArenaAllocator<SimpleNode*>(parena)), _vchildren(PlannerArenaAllocator<SimpleNode*>(parena)) {
         std::copy(config.begin(), config.end(), q);
         _level = 0;
         _hasselfchild = 0;
         _usenn = 1;
+        _edgestate = 1;
         _userdata = 0;
+        _flatindex = -1;
     }
-    SimpleNode(SimpleNode* parent, const dReal* pconfig, int dof) : rrtparent(parent) {
+    SimpleNode(SimpleNode* parent, const dReal* pconfig, int dof, PlannerArena* parena=NULL) : rrtparent(parent), _vrrtchildren(PlannerArenaAllocator<SimpleNode*>(parena)), _vchildren(PlannerArenaAllocator<SimpleNode*>(parena)) {
         std::copy(pconfig, pconfig+dof, q);
         _level = 0;
         _hasselfchild = 0;
         _usenn = 1;
+        _edgestate = 1;
         _userdata = 0;
+        _flatindex = -1;
     }
     ~SimpleNode() {
     }
 
     SimpleNode* rrtparent; ///< pointer to the RRT tree parent
-    std::vector<SimpleNode*> _vchildren; ///< cache tree direct children of this node (for the next cache level down). Has nothing to do with the RRT tree.
+    NodeVector _vrrtchildren; ///< the nodes whose rrtparent is this node, including cover tree clones. Maintained by SpatialTree so subtrees can be collected without scanning all nodes.
+    NodeVector _vchildren; ///< cache tree direct children of this node (for the next cache level down). Has nothing to do with the RRT tree.
     int16_t _level; ///< the level the node belongs to
     uint8_t _hasselfchild; ///< if 1, then _vchildren has contains a clone of this node in the level below it.
     uint8_t _usenn; ///< if 1, then use part of the nearest neighbor search, otherwise ignore
+    uint8_t _edgestate; ///< state of the edge from rrtparent when edges are checked lazily: 0 if not checked yet, 1 if valid, 2 if invalid
     uint32_t _userdata; ///< user specified data tagging this node
+    int32_t _flatindex; ///< index of the node in the flat nearest neighbor arrays of its tree, -1 if it is not stored there
 
 #ifdef _DEBUG
     int id;
@@ -108,6 +206,100 @@ public:
     dReal q[0]; // the configuration immediately follows the struct
 };
 
+/// \brief the smallest AABB containing ab0 and ab1
+inline AABB MergeAABBs(const AABB& ab0, const AABB& ab1)
+{
+    Vector vmin, vmax;
+    for(int i = 0; i < 3; ++i) {
+        vmin[i] = min(ab0.pos[i]-ab0.extents[i], ab1.pos[i]-ab1.extents[i]);
+        vmax[i] = max(ab0.pos[i]+ab0.extents[i], ab1.pos[i]+ab1.extents[i]);
+    }
+    return AABB(0.5*(vmin+vmax), 0.5*(vmax-vmin));
+}
+
+/// \brief true if ab overlaps any of vregions
+inline bool IsAABBIntersectingAny(const AABB& ab, const std::vector<AABB>& vregions)
+{
+    FOREACHC(itregion, vregions) {
+        if( RaveFabs(ab.pos.x-itregion->pos.x) <= ab.extents.x+itregion->extents.x && RaveFabs(ab.pos.y-itregion->pos.y) <= ab.extents.y+itregion->extents.y && RaveFabs(ab.pos.z-itregion->pos.z) <= ab.extents.z+itregion->extents.z ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// \brief the AABB of the enabled links of robot and of the bodies it grabs at their current state
+inline AABB ComputeRobotAABBWithGrabbed(RobotBasePtr robot)
+{
+    AABB ab = robot->ComputeAABB(true);
+    std::vector<KinBodyPtr> vgrabbed;
+    robot->GetGrabbed(vgrabbed);
+    FOREACHC(itgrabbed, vgrabbed) {
+        ab = MergeAABBs(ab, (*itgrabbed)->ComputeAABB(true));
+    }
+    return ab;
+}
+
+/// \brief gets the squared weights of a weighted L2 metric that gives the same distances as the distance metric of params
+///
+/// Only a single joint_values group without circular joints is handled, which is what PlannerParameters::SetConfigurationSpecification sets up for a regular arm.
+/// \return false if the metric of params cannot be computed that way, vweights2 is then empty
+inline bool GetWeightedL2DistanceMetric(EnvironmentBasePtr penv, PlannerBase::PlannerParametersConstPtr params, std::vector<dReal>& vweights2)
+{
+    vweights2.resize(0);
+    const ConfigurationSpecification& spec = params->_configurationspecification;
+    if( spec._vgroups.size() != 1 || spec._vgroups[0].name.size() < 12 || spec._vgroups[0].name.substr(0,12) != "joint_values" ) {
+        return false;
+    }
+    std::stringstream ss(spec._vgroups[0].name.substr(12));
+    std::string bodyname;
+    ss >> bodyname;
+    KinBodyPtr pbody = penv->GetKinBody(bodyname);
+    if( !pbody ) {
+        return false;
+    }
+    std::vector<int> dofindices((istream_iterator<int>(ss)), istream_iterator<int>());
+    if( dofindices.size() == 0 ) {
+        for(int idof = 0; idof < pbody->GetDOF(); ++idof) {
+            dofindices.push_back(idof);
+        }
+    }
+    if( (int)dofindices.size() != params->GetDOF() ) {
+        return false;
+    }
+    FOREACHC(itdof, dofindices) {
+        KinBody::JointPtr pjoint = pbody->GetJointFromDOFIndex(*itdof);
+        if( pjoint->IsCircular(*itdof-pjoint->GetDOFIndex()) ) {
+            return false;
+        }
+    }
+    std::vector<dReal> vtestweights2;
+    pbody->GetDOFWeights(vtestweights2, dofindices);
+    FOREACH(itweight, vtestweights2) {
+        *itweight *= *itweight;
+    }
+
+    // the metric could have been replaced after the configuration specification was set, so check that it agrees on a couple of configurations
+    std::vector<dReal> vmiddle(params->GetDOF());
+    for(int idof = 0; idof < params->GetDOF(); ++idof) {
+        vmiddle[idof] = 0.5*(params->_vConfigLowerLimit.at(idof)+params->_vConfigUpperLimit.at(idof));
+    }
+    const std::vector<dReal>* ptestconfigs[2] = {&params->_vConfigUpperLimit, &vmiddle};
+    for(int itest = 0; itest < 2; ++itest) {
+        dReal fdist2 = 0;
+        for(int idof = 0; idof < params->GetDOF(); ++idof) {
+            dReal fdiff = ptestconfigs[itest]->at(idof) - params->_vConfigLowerLimit.at(idof);
+            fdist2 += vtestweights2[idof]*fdiff*fdiff;
+        }
+        dReal fdist = params->_distmetricfn(*ptestconfigs[itest], params->_vConfigLowerLimit);
+        if( RaveFabs(RaveSqrt(fdist2) - fdist) > g_fEpsilonLinear*max(dReal(1), fdist) ) {
+            return false;
+        }
+    }
+    vweights2.swap(vtestweights2);
+    return true;
+}
+
 class SpatialTreeBase
 {
 public:
@@ -145,6 +337,7 @@ class SpatialTree : public SpatialTreeBase
 {
 public:
     typedef Node* NodePtr;
+    typedef std::set<NodePtr, std::less<NodePtr>, PlannerArenaAllocator<NodePtr> > LevelNodeSet;
 
     SpatialTree(int fromgoal) {
         _fromgoal = fromgoal;
@@ -159,6 +352,9 @@ public:
         _maxlevel = 0;
         _minlevel = 0;
         _fMaxLevelBound = 0;
+        _bUseFlatNearestNeighbor = false;
+        _bLazyEdges = false;
+        _pstatistics = NULL;
     }
 
     ~SpatialTree() {
@@ -191,9 +387,70 @@ public:
         _fMaxLevelBound = RavePow(_base, _maxlevel);
         int enclevel = _EncodeLevel(_maxlevel);
         if( enclevel >= (int)_vsetLevelNodes.size() ) {
-            _vsetLevelNodes.resize(enclevel+1);
+            _vsetLevelNodes.resize(enclevel+1, _GetEmptyLevelNodes());
         }
         _constraintreturn.reset(new ConstraintFilterReturn());
+        _bUseFlatNearestNeighbor = false;
+        _vFlatWeights2.resize(0);
+    }
+
+    /// \brief sets whether nearest neighbor queries linearly scan a contiguous copy of the configurations instead of traversing the cover tree
+    ///
+    /// Has to be called on an empty tree. The cover tree is still maintained for insertion and removal.
+    /// \param vweights2 if not empty, the squared weights of a weighted L2 metric equivalent to distmetricfn (see GetWeightedL2DistanceMetric), used to compute the distances inline
+    void SetFlatNearestNeighbor(bool bUseFlat, const std::vector<dReal>& vweights2=std::vector<dReal>())
+    {
+        OPENRAVE_ASSERT_OP(_numnodes,==,0);
+        _bUseFlatNearestNeighbor = bUseFlat;
+        _vFlatWeights2.resize(0);
+        if( bUseFlat && vweights2.size() > 0 ) {
+            OPENRAVE_ASSERT_OP((int)vweights2.size(),==,_dof);
+            _vFlatWeights2 = vweights2;
+        }
+    }
+
+    /// \brief sets the statistics the nearest neighbor queries and constraint checks of Extend and ValidateEdge are accumulated into, NULL to disable
+    ///
+    /// The statistics have to outlive the tree.
+    void SetStatistics(PlannerStatistics* pstatistics)
+    {
+        _pstatistics = pstatistics;
+    }
+
+    /// \brief sets whether Extend only checks the new configurations and leaves the edges to be checked with ValidateEdge
+    ///
+    /// Only trees whose _neighstatefn does not deviate from the straight line should check edges lazily.
+    void SetLazyEdges(bool bLazyEdges)
+    {
+        _bLazyEdges = bLazyEdges;
+    }
+
+    /// \brief checks the edge from the rrtparent of nodebase to nodebase with the constraints of the planner, if it has not been checked yet
+    ///
+    /// \return true if the edge satisfies the constraints. The result is stored on the node, so an edge is checked at most once.
+    bool ValidateEdge(NodeBasePtr nodebase)
+    {
+        NodePtr node = (NodePtr)nodebase;
+        if( node->_edgestate != 0 ) {
+            return node->_edgestate == 1;
+        }
+        boost::shared_ptr<PlannerBase> planner(_planner);
+        PlannerBase::PlannerParametersConstPtr params = planner->GetParameters();
+        _vCurConfig.resize(_dof);
+        _vNewConfig.resize(_dof);
+        std::copy(node->rrtparent->q, node->rrtparent->q+_dof, _vCurConfig.begin());
+        std::copy(node->q, node->q+_dof, _vNewConfig.begin());
+        _constraintreturn->Clear();
+        int ret;
+        if( _fromgoal ) {
+            ret = _CheckPathAllConstraints(params, _vNewConfig, _vCurConfig, IT_OpenEnd, 0xffff, _constraintreturn);
+        }
+        else {
+            ret = _CheckPathAllConstraints(params, _vCurConfig, _vNewConfig, IT_OpenStart, 0xffff, _constraintreturn);
+        }
+        // the tree only stores straight edges, so a deviated ramp cannot be used
+        node->_edgestate = ret == 0 && !_constraintreturn->_bHasRampDeviatedFromInterpolation ? 1 : 2;
+        return node->_edgestate == 1;
     }
 
     virtual void Reset()
@@ -211,7 +468,11 @@ public:
             //_pNodesPool->purge_memory();
             _pNodesPool.reset(new boost::pool<>(sizeof(Node)+_dof*sizeof(dReal)));
         }
+        // the children of the nodes and the level sets do not hold any memory anymore
+        _arena.Release();
         _numnodes = 0;
+        _vFlatNodes.resize(0);
+        _vFlatConfigs.resize(0);
     }
 
     inline dReal _ComputeDistance(const dReal* config0, const dReal* config1) const
@@ -243,26 +504,12 @@ public:
     {
         //BOOST_ASSERT(Validate());
         uint64_t starttime = utils::GetNanoPerformanceTime();
-        // first gather all the nodes, and then delete them in reverse order they were originally added in
         NodePtr parent = (NodePtr)parentbase;
-        parent->_usenn = 0;
-        _setchildcache.clear(); _setchildcache.insert(parent);
-        int numruns=0;
-        bool bchanged=true;
-        while(bchanged) {
-            bchanged=false;
-            FOREACHC(itchildren, _vsetLevelNodes) {
-                FOREACHC(itchild, *itchildren) {
-                    if( _setchildcache.find(*itchild) == _setchildcache.end() && _setchildcache.find((*itchild)->rrtparent) != _setchildcache.end() ) {
-                        (*itchild)->_usenn = 0;
-                        _setchildcache.insert(*itchild);
-                        bchanged=true;
-                    }
-                }
-            }
-            ++numruns;
+        _CollectSubtree(parent, _vchildcache);
+        FOREACH(itchild, _vchildcache) {
+            (*itchild)->_usenn = 0;
         }
-        RAVELOG_VERBOSE("computed in %fs", (1e-9*(utils::GetNanoPerformanceTime()-starttime)));
+        RAVELOG_VERBOSE_FORMAT("invalidated %d/%d nodes in %fs", _vchildcache.size()%_numnodes%(1e-9*(utils::GetNanoPerformanceTime()-starttime)));
     }
 
     /// deletes all nodes that have parentindex as their parent
@@ -270,29 +517,9 @@ public:
     {
         BOOST_ASSERT(Validate());
         uint64_t starttime = utils::GetNanoPerformanceTime();
-        // first gather all the nodes, and then delete them in reverse order they were originally added in
+        // first gather all the nodes, and then delete them in reverse order so that children are removed before their parents
         NodePtr parent = (NodePtr)parentbase;
-        if( _vchildcache.capacity() == 0 ) {
-            _vchildcache.reserve(128);
-        }
-        _vchildcache.resize(0); _vchildcache.push_back(parent);
-        _setchildcache.clear(); _setchildcache.insert(parent);
-        int numruns=0;
-        bool bchanged=true;
-        while(bchanged) {
-            bchanged=false;
-            FOREACHC(itchildren, _vsetLevelNodes) {
-                FOREACHC(itchild, *itchildren) {
-                    if( _setchildcache.find(*itchild) == _setchildcache.end() && _setchildcache.find((*itchild)->rrtparent) != _setchildcache.end() ) {
-                        //if( !std::binary_search(_vchildcache.begin(),_vchildcache.end(),(*itchild)->rrtparent) ) {
-                        _vchildcache.push_back(*itchild);
-                        _setchildcache.insert(*itchild);
-                        bchanged=true;
-                    }
-                }
-            }
-            ++numruns;
-        }
+        _CollectSubtree(parent, _vchildcache);
 
         int nremove=0;
         // systematically remove backwards
@@ -302,13 +529,19 @@ public:
             ++nremove;
         }
         BOOST_ASSERT(Validate());
-        RAVELOG_VERBOSE("computed in %fs", (1e-9*(utils::GetNanoPerformanceTime()-starttime)));
+        RAVELOG_VERBOSE_FORMAT("deleted %d nodes in %fs", nremove%(1e-9*(utils::GetNanoPerformanceTime()-starttime)));
     }
 
     virtual ExtendType Extend(const vector<dReal>& vTargetConfig, NodeBasePtr& lastnode, bool bOneStep=false)
     {
+        OPENRAVE_PROFILE_SCOPE("planner", "Extend");
         // get the nearest neighbor
+        uint64_t starttime = !!_pstatistics ? utils::GetNanoPerformanceTime() : 0;
         std::pair<NodePtr, dReal> nn = _FindNearestNode(vTargetConfig);
+        if( !!_pstatistics ) {
+            _pstatistics->numNearestNeighborQueries++;
+            _pstatistics->nearestNeighborTime += utils::GetNanoPerformanceTime()-starttime;
+        }
         if( !nn.first ) {
             return ET_Failed;
         }
@@ -361,13 +594,19 @@ public:
             }
 
             // necessary to pass in _constraintreturn since _neighstatefn can have constraints and it can change the interpolation. Use _constraintreturn->_bHasRampDeviatedFromInterpolation to figure out if something changed.
-            if( _fromgoal ) {
-                if( params->CheckPathAllConstraints(_vNewConfig, _vCurConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenEnd, 0xffff|CFO_FillCheckedConfiguration, _constraintreturn) != 0 ) {
+            if( _bLazyEdges ) {
+                // the edge is checked by ValidateEdge once it is part of a path
+                if( _CheckPathAllConstraints(params, _vNewConfig, _vNewConfig, IT_OpenStart, 0xffff, ConstraintFilterReturnPtr()) != 0 ) {
+                    return bHasAdded ? ET_Sucess : ET_Failed;
+                }
+            }
+            else if( _fromgoal ) {
+                if( _CheckPathAllConstraints(params, _vNewConfig, _vCurConfig, IT_OpenEnd, 0xffff|CFO_FillCheckedConfiguration, _constraintreturn) != 0 ) {
                     return bHasAdded ? ET_Sucess : ET_Failed;
                 }
             }
             else {
-                if( params->CheckPathAllConstraints(_vCurConfig, _vNewConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart, 0xffff|CFO_FillCheckedConfiguration, _constraintreturn) != 0 ) {
+                if( _CheckPathAllConstraints(params, _vCurConfig, _vNewConfig, IT_OpenStart, 0xffff|CFO_FillCheckedConfiguration, _constraintreturn) != 0 ) {
                     return bHasAdded ? ET_Sucess : ET_Failed;
                 }
             }
@@ -394,7 +633,7 @@ public:
             // dReal currentDistance =  _ComputeDistance(&_vCurConfig[0], _vNewConfig);
 
             int iAdded = 0;
-            if( _constraintreturn->_bHasRampDeviatedFromInterpolation ) {
+            if( !_bLazyEdges && _constraintreturn->_bHasRampDeviatedFromInterpolation ) {
                 // Since the path checked by CheckPathAllConstraints can be different from a straight line segment connecting _vNewConfig and _vCurConfig, we add all checked configurations along the checked segment to the tree.
                 if( _fromgoal ) {
                     // Need to add nodes to the tree starting from the one closest to the nearest neighbor. Since _fromgoal is true, the closest one is the last config in _constraintreturn->_configurations
@@ -493,7 +732,7 @@ public:
                 continue;
             }
 
-            const std::set<NodePtr>& setLevelRawChildren = _vsetLevelNodes.at(enclevel);
+            const LevelNodeSet& setLevelRawChildren = _vsetLevelNodes.at(enclevel);
             FOREACHC(itnode, setLevelRawChildren) {
                 FOREACH(itchild, (*itnode)->_vchildren) {
                     dReal curdist = _ComputeDistance(*itnode, *itchild);
@@ -585,7 +824,7 @@ public:
         }
         FOREACHC(itchildren, _vsetLevelNodes) {
             if( inode < itchildren->size() ) {
-                typename std::set<NodePtr>::iterator itchild = itchildren->begin();
+                typename LevelNodeSet::iterator itchild = itchildren->begin();
                 advance(itchild, inode);
                 return *itchild;
             }
@@ -613,15 +852,26 @@ private:
         int retid = s_id++;
         return retid;
     }
+    inline LevelNodeSet _GetEmptyLevelNodes()
+    {
+        return LevelNodeSet(std::less<NodePtr>(), PlannerArenaAllocator<NodePtr>(&_arena));
+    }
+
     inline NodePtr _CreateNode(NodePtr rrtparent, const vector<dReal>& config, uint32_t userdata)
     {
         // allocate memory for the structur and the internal state vectors
         void* pmemory = _pNodesPool->malloc();
-        NodePtr node = new (pmemory) Node(rrtparent, config);
+        NodePtr node = new (pmemory) Node(rrtparent, config, &_arena);
         node->_userdata = userdata;
+        if( _bLazyEdges && !!rrtparent ) {
+            node->_edgestate = 0;
+        }
 #ifdef _DEBUG
         node->id = GetNewStaticId();
 #endif
+        if( !!rrtparent ) {
+            rrtparent->_vrrtchildren.push_back(node);
+        }
         return node;
     }
 
@@ -629,17 +879,41 @@ private:
     {
         // allocate memory for the structur and the internal state vectors
         void* pmemory = _pNodesPool->malloc();
-        NodePtr node = new (pmemory) Node(refnode->rrtparent, refnode->q, _dof);
+        NodePtr node = new (pmemory) Node(refnode->rrtparent, refnode->q, _dof, &_arena);
         node->_userdata = refnode->_userdata;
+        node->_edgestate = refnode->_edgestate;
 #ifdef _DEBUG
         node->id = GetNewStaticId();
 #endif
+        if( !!node->rrtparent ) {
+            node->rrtparent->_vrrtchildren.push_back(node);
+        }
         return node;
     }
 
+    /// \brief gathers node and all the nodes below it in the RRT tree in breadth first order, so every node comes after its rrtparent
+    void _CollectSubtree(NodePtr node, std::vector<NodePtr>& vsubtree) const
+    {
+        vsubtree.resize(0);
+        vsubtree.push_back(node);
+        for(size_t inode = 0; inode < vsubtree.size(); ++inode) {
+            NodePtr curnode = vsubtree[inode];
+            vsubtree.insert(vsubtree.end(), curnode->_vrrtchildren.begin(), curnode->_vrrtchildren.end());
+        }
+    }
+
     void _DeleteNode(Node* p)
     {
         if( !!p ) {
+            if( !!p->rrtparent ) {
+                // the parent can outlive its children, so remove the edge
+                typename Node::NodeVector& vsiblings = p->rrtparent->_vrrtchildren;
+                typename Node::NodeVector::iterator itnode = std::find(vsiblings.begin(), vsiblings.end(), p);
+                if( itnode != vsiblings.end() ) {
+                    *itnode = vsiblings.back();
+                    vsiblings.pop_back();
+                }
+            }
             p->~Node();
             _pNodesPool->free(p);
         }
@@ -654,6 +928,22 @@ private:
         }
     }
 
+    /// \brief checks the constraints of the path between two configurations and accumulates the check in _pstatistics
+    int _CheckPathAllConstraints(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& q1, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn)
+    {
+        if( !_pstatistics ) {
+            return params->CheckPathAllConstraints(q0, q1, std::vector<dReal>(), std::vector<dReal>(), 0, interval, options, filterreturn);
+        }
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        int ret = params->CheckPathAllConstraints(q0, q1, std::vector<dReal>(), std::vector<dReal>(), 0, interval, options, filterreturn);
+        _pstatistics->numConstraintChecks++;
+        _pstatistics->constraintCheckTime += utils::GetNanoPerformanceTime()-starttime;
+        if( ret != 0 ) {
+            _pstatistics->numConstraintRejects++;
+        }
+        return ret;
+    }
+
     std::pair<NodePtr, dReal> _FindNearestNode(const std::vector<dReal>& vquerystate) const
     {
         std::pair<NodePtr, dReal> bestnode;
@@ -663,6 +953,9 @@ private:
             return bestnode;
         }
         OPENRAVE_ASSERT_OP((int)vquerystate.size(),==,_dof);
+        if( _bUseFlatNearestNeighbor ) {
+            return _FindNearestNodeFlat(vquerystate);
+        }
 
         int currentlevel = _maxlevel; // where the root node is
         // traverse all levels gathering up the children at each level
@@ -705,6 +998,70 @@ private:
         return bestnode;
     }
 
+    /// \brief linearly scans _vFlatConfigs, nodes with _usenn = 0 are skipped
+    std::pair<NodePtr, dReal> _FindNearestNodeFlat(const std::vector<dReal>& vquerystate) const
+    {
+        std::pair<NodePtr, dReal> bestnode;
+        bestnode.first = NULL;
+        bestnode.second = std::numeric_limits<dReal>::infinity();
+        const dReal* pconfig = _vFlatConfigs.size() > 0 ? &_vFlatConfigs[0] : NULL;
+        if( _vFlatWeights2.size() > 0 ) {
+            // compare the squared weighted distances block by block and only take the root of the best one
+            const size_t blocksize = 256;
+            _vFlatDistances2.resize(blocksize);
+            for(size_t istart = 0; istart < _vFlatNodes.size(); istart += blocksize, pconfig += blocksize*_dof) {
+                size_t numblock = min(blocksize, _vFlatNodes.size()-istart);
+                planningutils::ComputeWeightedDistances2(&vquerystate[0], pconfig, numblock, _dof, &_vFlatWeights2[0], &_vFlatDistances2[0]);
+                for(size_t inode = 0; inode < numblock; ++inode) {
+                    if( _vFlatDistances2[inode] < bestnode.second && _vFlatNodes[istart+inode]->_usenn ) {
+                        bestnode.first = _vFlatNodes[istart+inode];
+                        bestnode.second = _vFlatDistances2[inode];
+                    }
+                }
+            }
+            if( !!bestnode.first ) {
+                bestnode.second = RaveSqrt(bestnode.second);
+            }
+        }
+        else {
+            for(size_t inode = 0; inode < _vFlatNodes.size(); ++inode, pconfig += _dof) {
+                if( !_vFlatNodes[inode]->_usenn ) {
+                    continue;
+                }
+                dReal curdist = _ComputeDistance(pconfig, vquerystate);
+                if( curdist < bestnode.second ) {
+                    bestnode.first = _vFlatNodes[inode];
+                    bestnode.second = curdist;
+                }
+            }
+        }
+        return bestnode;
+    }
+
+    inline void _AddFlatNode(NodePtr node)
+    {
+        node->_flatindex = (int32_t)_vFlatNodes.size();
+        _vFlatNodes.push_back(node);
+        _vFlatConfigs.insert(_vFlatConfigs.end(), node->q, node->q+_dof);
+    }
+
+    /// \brief removes node from the flat arrays by moving the last node into its place. clones of nodes are never stored there
+    void _RemoveFlatNode(NodePtr node)
+    {
+        if( node->_flatindex < 0 || node->_flatindex >= (int32_t)_vFlatNodes.size() || _vFlatNodes[node->_flatindex] != node ) {
+            return;
+        }
+        size_t index = node->_flatindex, lastindex = _vFlatNodes.size()-1;
+        if( index != lastindex ) {
+            _vFlatNodes[index] = _vFlatNodes[lastindex];
+            _vFlatNodes[index]->_flatindex = (int32_t)index;
+            std::copy(_vFlatConfigs.begin()+lastindex*_dof, _vFlatConfigs.begin()+(lastindex+1)*_dof, _vFlatConfigs.begin()+index*_dof);
+        }
+        _vFlatNodes.pop_back();
+        _vFlatConfigs.resize(lastindex*_dof);
+        node->_flatindex = -1;
+    }
+
     NodePtr _InsertNode(NodePtr parent, const vector<dReal>& config, uint32_t userdata)
     {
         NodePtr newnode = _CreateNode(parent, config, userdata);
@@ -713,12 +1070,17 @@ private:
             _vsetLevelNodes.at(_EncodeLevel(_maxlevel)).insert(newnode); // add to the level
             newnode->_level = _maxlevel;
             _numnodes += 1;
+            _AddFlatNode(newnode);
         }
         else {
             _vCurrentLevelNodes.resize(1);
             _vCurrentLevelNodes[0].first = *_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).begin();
             _vCurrentLevelNodes[0].second = _ComputeDistance(_vCurrentLevelNodes[0].first->q, config);
             int nParentFound = _InsertRecursive(newnode, _vCurrentLevelNodes, _maxlevel, _fMaxLevelBound);
+            if( nParentFound <= 0 ) {
+                // newnode is not part of the tree, so it should not remain in the rrt children of parent
+                _DeleteNode(newnode);
+            }
             if( nParentFound == 0 ) {
                 // could possibly happen with circulr joints, still need to take a look at correct fix (see #323)
                 std::stringstream ss; ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
@@ -730,6 +1092,7 @@ private:
             if( nParentFound < 0 ) {
                 return NodePtr();
             }
+            _AddFlatNode(newnode);
         }
         //BOOST_ASSERT(Validate());
         return newnode;
@@ -872,7 +1235,7 @@ private:
             parentnode->_hasselfchild = 1;
             int encclonelevel = _EncodeLevel(clonenode->_level);
             if( encclonelevel >= (int)_vsetLevelNodes.size() ) {
-                _vsetLevelNodes.resize(encclonelevel+1);
+                _vsetLevelNodes.resize(encclonelevel+1, _GetEmptyLevelNodes());
             }
             _vsetLevelNodes.at(encclonelevel).insert(clonenode);
             _numnodes +=1;
@@ -885,7 +1248,7 @@ private:
         nodein->_level = insertlevel;
         int enclevel2 = _EncodeLevel(nodein->_level);
         if( enclevel2 >= (int)_vsetLevelNodes.size() ) {
-            _vsetLevelNodes.resize(enclevel2+1);
+            _vsetLevelNodes.resize(enclevel2+1, _GetEmptyLevelNodes());
         }
         _vsetLevelNodes.at(enclevel2).insert(nodein);
         parentnode->_vchildren.push_back(nodein);
@@ -917,6 +1280,7 @@ private:
         _vvCacheNodes.at(0).push_back(proot);
         bool bRemoved = _Remove(removenode, _vvCacheNodes, _maxlevel, _fMaxLevelBound);
         if( bRemoved ) {
+            _RemoveFlatNode(removenode);
             _DeleteNode(removenode);
         }
         if( removenode == proot ) {
@@ -924,6 +1288,7 @@ private:
             BOOST_ASSERT(_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).size()==1);
             //_vsetLevelNodes.at(_EncodeLevel(_maxlevel)).clear();
             _vsetLevelNodes.at(_EncodeLevel(_maxlevel)).erase(proot);
+            _RemoveFlatNode(proot);
             bRemoved = true;
             _numnodes--;
         }
@@ -938,7 +1303,7 @@ private:
         }
 
         // build the level below
-        std::set<NodePtr>& setLevelRawChildren = _vsetLevelNodes.at(enclevel);
+        LevelNodeSet& setLevelRawChildren = _vsetLevelNodes.at(enclevel);
         int coverindex = _maxlevel-(currentlevel-1);
         if( coverindex >= (int)vvCoverSetNodes.size() ) {
             vvCoverSetNodes.resize(coverindex+(_maxlevel-_minlevel)+1);
@@ -950,7 +1315,7 @@ private:
         FOREACH(itcurrentnode, vvCoverSetNodes.at(coverindex-1)) {
             // only take the children whose distances are within the bound
             if( setLevelRawChildren.find(*itcurrentnode) != setLevelRawChildren.end() ) {
-                typename std::vector<NodePtr>::iterator itchild = (*itcurrentnode)->_vchildren.begin();
+                typename Node::NodeVector::iterator itchild = (*itcurrentnode)->_vchildren.begin();
                 while(itchild != (*itcurrentnode)->_vchildren.end() ) {
                     dReal curdist = _ComputeDistance(removenode, *itchild);
                     if( *itchild == removenode ) {
@@ -1008,7 +1373,7 @@ private:
                             clonenode->_hasselfchild = 1;
                             int encclonelevel = _EncodeLevel(clonenode->_level);
                             if( encclonelevel >= (int)_vsetLevelNodes.size() ) {
-                                _vsetLevelNodes.resize(encclonelevel+1);
+                                _vsetLevelNodes.resize(encclonelevel+1, _GetEmptyLevelNodes());
                             }
                             _vsetLevelNodes.at(encclonelevel).insert(clonenode);
                             _numnodes +=1;
@@ -1053,8 +1418,9 @@ private:
 
     // cover tree data structures
     boost::shared_ptr< boost::pool<> > _pNodesPool; ///< pool nodes are created from
+    PlannerArena _arena; ///< memory of the children of the nodes and of _vsetLevelNodes, released by Reset. Declared before them so it is destroyed last.
 
-    std::vector< std::set<NodePtr> > _vsetLevelNodes; ///< _vsetLevelNodes[enc(level)][node] holds the indices of the children of "node" of a given the level. enc(level) maps (-inf,inf) into [0,inf) so it can be indexed by the vector. Every node has an entry in a map here. If the node doesn't hold any children, then it is at the leaf of the tree. _vsetLevelNodes.at(_EncodeLevel(_maxlevel)) is the root.
+    std::vector< LevelNodeSet > _vsetLevelNodes; ///< _vsetLevelNodes[enc(level)][node] holds the indices of the children of "node" of a given the level. enc(level) maps (-inf,inf) into [0,inf) so it can be indexed by the vector. Every node has an entry in a map here. If the node doesn't hold any children, then it is at the leaf of the tree. _vsetLevelNodes.at(_EncodeLevel(_maxlevel)) is the root.
 
     dReal _maxdistance; ///< maximum possible distance between two states. used to balance the tree. Has to be > 0.
     dReal _mindistance; ///< minimum possible distance between two states until they are declared the same
@@ -1064,9 +1430,18 @@ private:
     int _numnodes; ///< the number of nodes in the current tree starting at the root at _vsetLevelNodes.at(_EncodeLevel(_maxlevel))
     dReal _fMaxLevelBound; // pow(_base, _maxlevel)
 
+    bool _bLazyEdges; ///< if true, Extend does not check the edges of the new nodes, see ValidateEdge
+    PlannerStatistics* _pstatistics; ///< if not NULL, accumulates the nearest neighbor queries and constraint checks, see SetStatistics
+
+    // flat nearest neighbor data structures
+    bool _bUseFlatNearestNeighbor; ///< if true, _FindNearestNode scans _vFlatConfigs instead of the cover tree
+    std::vector<NodePtr> _vFlatNodes; ///< every inserted node except the cover tree clones
+    std::vector<dReal> _vFlatConfigs; ///< the configurations of _vFlatNodes one after the other, _dof values each
+    std::vector<dReal> _vFlatWeights2; ///< if not empty, the squared weights of the weighted L2 metric to use instead of _distmetricfn
+    mutable std::vector<dReal> _vFlatDistances2; ///< cache for the distances of one block of _vFlatConfigs
+
     // cache
     vector<NodePtr> _vchildcache;
-    set<NodePtr> _setchildcache;
     vector<dReal> _vNewConfig, _vDeltaConfig, _vCurConfig;
     mutable vector<dReal> _vTempConfig;
     ConstraintFilterReturnPtr _constraintreturn;
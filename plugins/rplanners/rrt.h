@@ -17,6 +17,7 @@
 #define  BIRRT_PLANNER_H
 
 #include "rplanners.h"
+#include "parallelworkers.h"
 #include <boost/algorithm/string.hpp>
 
 static const dReal g_fEpsilonDotProduct = RavePow(g_fEpsilon,0.8);
@@ -37,10 +38,24 @@ Uses the Rapidly-Exploring Random Trees Algorithm.\n\
         RegisterCommand("GetInitGoalIndices",boost::bind(&RrtPlanner<Node>::GetInitGoalIndicesCommand,this,_1,_2),
                         "returns the start and goal indices");
         _filterreturn.reset(new ConstraintFilterReturn());
+        _pcounterplans = RegisterPerfCounter("planner.plans");
+        _pcounteriterations = RegisterPerfCounter("planner.iterations");
+        _treeForward.SetStatistics(&_statistics);
     }
     virtual ~RrtPlanner() {
     }
 
+    /// \brief plans with _PlanPath and returns the statistics of the plan with the status
+    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    {
+        utils::PerfCounterTimer countertimer(*_pcounterplans);
+        PlannerStatisticsRecorder recorder(GetEnv(), _statistics);
+        PlannerStatus status = _PlanPath(ptraj, planningoptions);
+        _statistics.numNodes += _GetNumNodes();
+        recorder.Finish(status);
+        return status;
+    }
+
     virtual bool _InitPlan(RobotBasePtr pbase, PlannerParametersPtr params)
     {
         params->Validate();
@@ -69,6 +84,7 @@ Uses the Rapidly-Exploring Random Trees Algorithm.\n\
         _sampleConfig.resize(params->GetDOF());
         // TODO perhaps distmetricfn should take into number of revolutions of circular joints
         _treeForward.Init(shared_planner(), params->GetDOF(), params->_distmetricfn, params->_fStepLength, params->_distmetricfn(params->_vConfigLowerLimit, params->_vConfigUpperLimit));
+        _SetupNearestNeighbor(_treeForward, params);
         std::vector<dReal> vinitialconfig(params->GetDOF());
         for(size_t index = 0; index < params->vinitialconfig.size(); index += params->GetDOF()) {
             std::copy(params->vinitialconfig.begin()+index,params->vinitialconfig.begin()+index+params->GetDOF(),vinitialconfig.begin());
@@ -245,16 +261,52 @@ Uses the Rapidly-Exploring Random Trees Algorithm.\n\
     }
 
 protected:
+    /// \brief the planning loop of the planner, called by PlanPath
+    virtual PlannerStatus _PlanPath(TrajectoryBasePtr ptraj, int planningoptions) = 0;
+
+    /// \brief the number of nodes of all the trees of the planner
+    virtual int _GetNumNodes() const
+    {
+        return _treeForward.GetNumNodes();
+    }
+
+    /// \brief samples a configuration with the _samplefn of params and accumulates it in the statistics
+    bool _SampleConfiguration(const PlannerParameters& params, std::vector<dReal>& vsample)
+    {
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        bool bsuccess = params._samplefn(vsample);
+        _statistics.numSamples++;
+        _statistics.samplingTime += utils::GetNanoPerformanceTime()-starttime;
+        return bsuccess;
+    }
+
     RobotBasePtr _robot;
     std::vector<dReal> _sampleConfig;
     int _goalindex, _startindex;
     SpaceSamplerBasePtr _uniformsampler;
     ConstraintFilterReturnPtr _filterreturn;
     std::deque<dReal> _cachedpath;
+    PerfCounterPtr _pcounterplans; ///< number of PlanPath calls and their total time in ns
+    PerfCounterPtr _pcounteriterations; ///< number of iterations of the main loop
+    PlannerStatistics _statistics; ///< statistics of the current plan, the trees accumulate their nearest neighbor queries and constraint checks in it
 
     SpatialTree< Node > _treeForward;
     std::vector< NodeBase* > _vecInitialNodes;
 
+    /// \brief sets the nearest neighbor backend of tree from the RRTParameters::_nNearestNeighborType of params
+    template <typename TreeNode>
+    void _SetupNearestNeighbor(SpatialTree<TreeNode>& tree, PlannerParametersConstPtr params)
+    {
+        boost::shared_ptr<RRTParameters const> rrtparams = boost::dynamic_pointer_cast<RRTParameters const>(params);
+        if( !!rrtparams && rrtparams->_nNearestNeighborType == 1 ) {
+            std::vector<dReal> vweights2;
+            if( !GetWeightedL2DistanceMetric(GetEnv(), params, vweights2) ) {
+                RAVELOG_VERBOSE("distance metric is not a weighted L2 metric, so flat nearest neighbor queries call it directly\n");
+            }
+            tree.SetFlatNearestNeighbor(true, vweights2);
+        }
+    }
+
     inline boost::shared_ptr<RrtPlanner> shared_planner() {
         return boost::static_pointer_cast<RrtPlanner>(shared_from_this());
     }
@@ -266,8 +318,9 @@ protected:
 class BirrtPlanner : public RrtPlanner<SimpleNode>
 {
 public:
-    BirrtPlanner(EnvironmentBasePtr penv) : RrtPlanner<SimpleNode>(penv), _treeBackward(1)
+    BirrtPlanner(EnvironmentBasePtr penv, bool bLazyEdges=false) : RrtPlanner<SimpleNode>(penv), _treeBackward(1), _bLazyEdges(bLazyEdges)
     {
+        _treeBackward.SetStatistics(&_statistics);
         __description += "Bi-directional RRTs. See\n\n\
 - J.J. Kuffner and S.M. LaValle. RRT-Connect: An efficient approach to single-query path planning. In Proc. IEEE Int'l Conf. on Robotics and Automation (ICRA'2000), pages 995-1001, San Francisco, CA, April 2000.";
         RegisterCommand("DumpTree", boost::bind(&BirrtPlanner::_DumpTreeCommand,this,_1,_2),
@@ -280,6 +333,17 @@ Some python code to display data::\n\
   robot.SetActiveDOFValues(sourcetree[argmin(sourcedist)])\n\
 \n\
 ");
+        if( _bLazyEdges ) {
+            __description += "\n\nLazy variant: extending the trees only checks the new configurations. Once the trees connect, the unchecked edges of the path are checked starting from the ones closest to the last invalid edge, and every invalid edge removes its subtree from the search. Cannot be used with a _neighstatefn that deviates from straight lines.";
+        }
+        __description += "\n\nWith the 'SetReplanning' command, an InitPlan with the same robot, configuration space and goals as the previous one keeps the trees. At every PlanPath, the bodies that moved since the previous PlanPath only cause the edges whose robot AABBs overlap the old or new AABBs of the bodies to be checked again, and the subtrees of the invalid ones are removed from the search. If the initial configurations changed, only the backward tree is kept.";
+        RegisterCommand("SetReplanning", boost::bind(&BirrtPlanner::_SetReplanningCommand,this,_1,_2),
+                        "\"enable [aabbpadding]\", if enable is 1, the trees are kept between queries to the same goals and only the parts close to moved bodies are checked again. aabbpadding is added to the AABBs of the edges (default 0.02).");
+        _treeForward.SetLazyEdges(_bLazyEdges);
+        _treeBackward.SetLazyEdges(_bLazyEdges);
+        _bReplanning = false;
+        _bReplanStatesValid = false;
+        _fReplanAABBPadding = 0.02;
         _nValidGoals = 0;
     }
     virtual ~BirrtPlanner() {
@@ -297,6 +361,10 @@ Some python code to display data::\n\
     virtual bool InitPlan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
     {
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        if( _bReplanning && _CanReuseTrees(pbase, pparams) ) {
+            return _InitReplan(pbase, pparams);
+        }
+        _bReplanStatesValid = false;
         _parameters.reset(new RRTParameters());
         _parameters->copy(pparams);
         if( !RrtPlanner<SimpleNode>::_InitPlan(pbase,_parameters) ) {
@@ -310,6 +378,7 @@ Some python code to display data::\n\
 
         // TODO perhaps distmetricfn should take into number of revolutions of circular joints
         _treeBackward.Init(shared_planner(), _parameters->GetDOF(), _parameters->_distmetricfn, _parameters->_fStepLength, _parameters->_distmetricfn(_parameters->_vConfigLowerLimit, _parameters->_vConfigUpperLimit));
+        _SetupNearestNeighbor(_treeBackward, _parameters);
 
         //read in all goals
         if( (_parameters->vgoalconfig.size() % _parameters->GetDOF()) != 0 ) {
@@ -347,6 +416,7 @@ Some python code to display data::\n\
             _parameters->_nMaxIterations = 10000;
         }
 
+        _vLazyInvalidConfig.resize(0);
         _vgoalpaths.resize(0);
         if( _vgoalpaths.capacity() < _parameters->_minimumgoalpaths ) {
             _vgoalpaths.reserve(_parameters->_minimumgoalpaths);
@@ -355,7 +425,7 @@ Some python code to display data::\n\
         return true;
     }
 
-    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    virtual PlannerStatus _PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
     {
         _goalindex = -1;
         _startindex = -1;
@@ -366,10 +436,22 @@ Some python code to display data::\n\
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
         uint32_t basetime = utils::GetMilliTime();
 
+        // goal and initial samplers are bound to this environment, so they cannot be used by the workers
+        if( _parameters->_nParallelWorkers > 1 && !_parameters->_samplegoalfn && !_parameters->_sampleinitialfn ) {
+            PlannerStatus status;
+            if( _PlanPathParallel(ptraj, status) ) {
+                return status;
+            }
+        }
+
         // the main planning loop
         PlannerParameters::StateSaver savestate(_parameters);
         CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
 
+        if( _bReplanning ) {
+            _UpdateTreesForChangedScene();
+        }
+
         SpatialTreeBase* TreeA = &_treeForward;
         SpatialTreeBase* TreeB = &_treeBackward;
         NodeBase* iConnectedA=NULL, *iConnectedB=NULL;
@@ -381,6 +463,8 @@ Some python code to display data::\n\
         while(_vgoalpaths.size() < _parameters->_minimumgoalpaths && iter < 3*_parameters->_nMaxIterations) {
             RAVELOG_VERBOSE_FORMAT("env=%d, iter=%d, forward=%d, backward=%d", GetEnv()->GetId()%(iter/3)%_treeForward.GetNumNodes()%_treeBackward.GetNumNodes());
             ++iter;
+            _pcounteriterations->Add();
+            _statistics.numIterations++;
 
             // have to check callbacks at the beginning since code can continue
             callbackaction = _CallCallbacks(progress);
@@ -448,7 +532,7 @@ Some python code to display data::\n\
             }
 
             if( _sampleConfig.size() == 0 ) {
-                if( !_parameters->_samplefn(_sampleConfig) ) {
+                if( !_SampleConfiguration(*_parameters, _sampleConfig) ) {
                     continue;
                 }
             }
@@ -466,9 +550,12 @@ Some python code to display data::\n\
                 continue;
             }
 
-            et = TreeB->Extend(TreeA->GetVectorConfig(iConnectedA), iConnectedB);     // extend B toward A
+            {
+                OPENRAVE_PROFILE_SCOPE("planner", "Connect");
+                et = TreeB->Extend(TreeA->GetVectorConfig(iConnectedA), iConnectedB);     // extend B toward A
+            }
 
-            if( et == ET_Connected ) {
+            if( et == ET_Connected && (!_bLazyEdges || _ValidateLazyPath(TreeA == &_treeForward ? iConnectedA : iConnectedB, TreeA == &_treeBackward ? iConnectedA : iConnectedB)) ) {
                 // connected, process goal
                 _vgoalpaths.push_back(GOALPATH());
                 _ExtractPath(_vgoalpaths.back(), TreeA == &_treeForward ? iConnectedA : iConnectedB, TreeA == &_treeBackward ? iConnectedA : iConnectedB);
@@ -650,12 +737,401 @@ Some python code to display data::\n\
     }
 
 protected:
+    virtual int _GetNumNodes() const
+    {
+        return _treeForward.GetNumNodes()+_treeBackward.GetNumNodes();
+    }
+
+    /// \brief the state of a body of the scene the trees were last checked with
+    struct ReplanBodyState
+    {
+        ReplanBodyState() : bEnabled(false) {
+        }
+        std::string hash;
+        Transform t;
+        bool bEnabled;
+        AABB ab;
+    };
+
+    /// \brief true if the trees of the previous query can be used for pparams
+    bool _CanReuseTrees(RobotBasePtr pbase, PlannerParametersConstPtr pparams) const
+    {
+        if( !_parameters || pbase != _robot || _treeBackward.GetNumNodes() == 0 || !!pparams->_samplegoalfn || !!pparams->_sampleinitialfn ) {
+            return false;
+        }
+        return pparams->GetDOF() == _parameters->GetDOF() && pparams->_configurationspecification == _parameters->_configurationspecification && pparams->vgoalconfig == _parameters->vgoalconfig && pparams->_fStepLength == _parameters->_fStepLength;
+    }
+
+    /// \brief InitPlan that keeps the backward tree, and the forward tree if the initial configurations did not change
+    bool _InitReplan(RobotBasePtr pbase, PlannerParametersConstPtr pparams)
+    {
+        RRTParametersPtr parameters(new RRTParameters());
+        parameters->copy(pparams);
+        if( parameters->vinitialconfig != _parameters->vinitialconfig ) {
+            // the paths of the forward tree start from the previous initial configurations
+            if( !RrtPlanner<SimpleNode>::_InitPlan(pbase,parameters) ) {
+                _parameters.reset();
+                return false;
+            }
+        }
+        else {
+            parameters->Validate();
+            _goalindex = -1;
+            _startindex = -1;
+            _uniformsampler->SetSeed(parameters->_nRandomGeneratorSeed);
+            FOREACH(it, parameters->_listInternalSamplers) {
+                (*it)->SetSeed(parameters->_nRandomGeneratorSeed);
+            }
+        }
+        _parameters = parameters;
+        if( _parameters->_nMaxIterations <= 0 ) {
+            _parameters->_nMaxIterations = 10000;
+        }
+        _vLazyInvalidConfig.resize(0);
+        _vgoalpaths.resize(0);
+        RAVELOG_DEBUG_FORMAT("env=%d, BiRRT Planner reusing trees, forward=%d, backward=%d", GetEnv()->GetId()%_treeForward.GetNumNodes()%_treeBackward.GetNumNodes());
+        return true;
+    }
+
+    /// \brief gathers the state of all bodies that are not the robot or grabbed by it
+    void _GetReplanBodyStates(std::map<std::string, ReplanBodyState>& mapBodyStates) const
+    {
+        mapBodyStates.clear();
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        FOREACHC(itbody, vbodies) {
+            const KinBody& body = **itbody;
+            if( !!_robot && (&body == _robot.get() || !!_robot->IsGrabbing(body)) ) {
+                continue;
+            }
+            ReplanBodyState& state = mapBodyStates[body.GetName()];
+            state.hash = body.GetKinematicsGeometryHash();
+            state.t = body.GetTransform();
+            state.bEnabled = body.IsEnabled();
+            state.ab = body.ComputeAABB();
+        }
+    }
+
+    /// \brief the state of the robot outside of the configuration space, every check depends on it
+    std::string _ComputeReplanRobotStateKey() const
+    {
+        if( !_robot ) {
+            return std::string();
+        }
+        std::vector<dReal> vdofvalues;
+        _robot->GetDOFValues(vdofvalues);
+        FOREACHC(itindex, _robot->GetActiveDOFIndices()) {
+            vdofvalues.at(*itindex) = 0;
+        }
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(6);
+        FOREACHC(it, vdofvalues) {
+            ss << *it << " ";
+        }
+        if( _robot->GetAffineDOF() == 0 ) {
+            ss << _robot->GetTransform();
+        }
+        std::vector<KinBodyPtr> vgrabbed;
+        _robot->GetGrabbed(vgrabbed);
+        FOREACHC(itgrabbed, vgrabbed) {
+            ss << (*itgrabbed)->GetName() << " " << (*itgrabbed)->GetKinematicsGeometryHash() << " ";
+        }
+        return ss.str();
+    }
+
+    /// \brief checks again the parts of the trees close to the bodies that changed since the last call
+    void _UpdateTreesForChangedScene()
+    {
+        std::map<std::string, ReplanBodyState> mapBodyStates;
+        _GetReplanBodyStates(mapBodyStates);
+        std::string robotstatekey = _ComputeReplanRobotStateKey();
+        std::vector<AABB> vchangedregions;
+        if( _bReplanStatesValid ) {
+            if( robotstatekey != _replanrobotstatekey ) {
+                // the robot itself changed, so everything has to be checked again
+                vchangedregions.push_back(AABB(Vector(), Vector(1e10,1e10,1e10)));
+            }
+            else {
+                FOREACHC(itstate, mapBodyStates) {
+                    std::map<std::string, ReplanBodyState>::const_iterator itold = _mapReplanBodyStates.find(itstate->first);
+                    if( itold == _mapReplanBodyStates.end() ) {
+                        if( itstate->second.bEnabled ) {
+                            vchangedregions.push_back(itstate->second.ab);
+                        }
+                    }
+                    else if( itold->second.hash != itstate->second.hash || itold->second.bEnabled != itstate->second.bEnabled || (itold->second.t.trans-itstate->second.t.trans).lengthsqr3() > g_fEpsilonLinear*g_fEpsilonLinear || RaveFabs(RaveFabs(itold->second.t.rot.dot(itstate->second.t.rot))-1) > g_fEpsilonLinear ) {
+                        if( itold->second.bEnabled ) {
+                            vchangedregions.push_back(itold->second.ab);
+                        }
+                        if( itstate->second.bEnabled ) {
+                            vchangedregions.push_back(itstate->second.ab);
+                        }
+                    }
+                }
+                FOREACHC(itold, _mapReplanBodyStates) {
+                    if( itold->second.bEnabled && mapBodyStates.find(itold->first) == mapBodyStates.end() ) {
+                        vchangedregions.push_back(itold->second.ab);
+                    }
+                }
+            }
+        }
+        _mapReplanBodyStates.swap(mapBodyStates);
+        _replanrobotstatekey = robotstatekey;
+        _bReplanStatesValid = true;
+        if( vchangedregions.size() == 0 ) {
+            return;
+        }
+
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        int nforward = _UpdateTreeForChangedRegions(_treeForward, vchangedregions);
+        int nbackward = _UpdateTreeForChangedRegions(_treeBackward, vchangedregions);
+        RAVELOG_DEBUG_FORMAT("env=%d, %d regions changed, invalidated %d forward and %d backward subtrees in %fs", GetEnv()->GetId()%vchangedregions.size()%nforward%nbackward%(1e-9*(utils::GetNanoPerformanceTime()-starttime)));
+    }
+
+    /// \brief checks again the edges of tree whose robot AABBs overlap vregions, and removes the subtrees of the invalid ones from the search
+    ///
+    /// The AABB of an edge is the union of the robot AABBs at its two ends padded by _fReplanAABBPadding. With lazy edges, the edges are only marked as unchecked.
+    /// \return the number of subtrees that were invalidated
+    int _UpdateTreeForChangedRegions(SpatialTree<SimpleNode>& tree, const std::vector<AABB>& vregions)
+    {
+        const bool bFromGoal = &tree == &_treeBackward;
+        tree.GetNodesVector(_vReplanNodes);
+        _mapReplanNodeAABBs.clear();
+        int ninvalidated = 0;
+        FOREACHC(itnodebase, _vReplanNodes) {
+            SimpleNode* pnode = (SimpleNode*)*itnodebase;
+            if( !pnode->_usenn ) {
+                continue;
+            }
+            AABB ab = _GetReplanNodeAABB(tree, pnode);
+            if( !!pnode->rrtparent ) {
+                ab = MergeAABBs(ab, _GetReplanNodeAABB(tree, pnode->rrtparent));
+            }
+            ab.extents += Vector(_fReplanAABBPadding, _fReplanAABBPadding, _fReplanAABBPadding);
+            if( !IsAABBIntersectingAny(ab, vregions) ) {
+                continue;
+            }
+
+            tree.GetVectorConfig(pnode, _vReplanConfig);
+            int ret = 0;
+            if( !pnode->rrtparent ) {
+                ret = _parameters->CheckPathAllConstraints(_vReplanConfig, _vReplanConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart);
+            }
+            else if( _bLazyEdges ) {
+                // _ValidateLazyPath checks it again when a path uses it
+                pnode->_edgestate = 0;
+                continue;
+            }
+            else {
+                tree.GetVectorConfig(pnode->rrtparent, _vReplanParentConfig);
+                if( bFromGoal ) {
+                    ret = _parameters->CheckPathAllConstraints(_vReplanConfig, _vReplanParentConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenEnd);
+                }
+                else {
+                    ret = _parameters->CheckPathAllConstraints(_vReplanParentConfig, _vReplanConfig, std::vector<dReal>(), std::vector<dReal>(), 0, IT_OpenStart);
+                }
+            }
+            if( ret != 0 ) {
+                tree.InvalidateNodesWithParent(pnode);
+                ++ninvalidated;
+                if( !pnode->rrtparent && bFromGoal && pnode->_userdata < _vecGoalNodes.size() && !!_vecGoalNodes[pnode->_userdata] ) {
+                    RAVELOG_DEBUG_FORMAT("env=%d, goal %d became invalid", GetEnv()->GetId()%pnode->_userdata);
+                    _vecGoalNodes[pnode->_userdata] = NULL;
+                    --_nValidGoals;
+                }
+            }
+        }
+        return ninvalidated;
+    }
+
+    /// \brief the robot AABB at the configuration of pnode, computed once per update
+    const AABB& _GetReplanNodeAABB(SpatialTree<SimpleNode>& tree, SimpleNode* pnode)
+    {
+        std::map<SimpleNode*, AABB>::iterator itab = _mapReplanNodeAABBs.find(pnode);
+        if( itab != _mapReplanNodeAABBs.end() ) {
+            return itab->second;
+        }
+        AABB& ab = _mapReplanNodeAABBs[pnode];
+        if( !_robot ) {
+            ab = AABB(Vector(), Vector(1e10,1e10,1e10));
+        }
+        else {
+            tree.GetVectorConfig(pnode, _vReplanAABBConfig);
+            _parameters->SetStateValues(_vReplanAABBConfig, 0);
+            ab = ComputeRobotAABBWithGrabbed(_robot);
+        }
+        return ab;
+    }
+
+    bool _SetReplanningCommand(std::ostream& sout, std::istream& sinput)
+    {
+        bool bReplanning = false;
+        sinput >> bReplanning;
+        if( !sinput ) {
+            return false;
+        }
+        dReal fPadding = 0;
+        if( !!(sinput >> fPadding) ) {
+            _fReplanAABBPadding = fPadding;
+        }
+        _bReplanning = bReplanning;
+        _bReplanStatesValid = false;
+        return true;
+    }
+
+    /// \brief runs _nParallelWorkers independent bi-directional searches on clones of the environment and takes the first path found
+    ///
+    /// With PlannerParameters::_bDeterministicParallel, the path of the successful worker with the lowest index is taken instead, see ParallelPlannerWorkers.
+    /// The workers plan with the default constraints of the configuration specification, so the found path is checked again with the constraints of _parameters.
+    /// \return false if no path could be used, in which case the caller should plan on this environment
+    bool _PlanPathParallel(TrajectoryBasePtr ptraj, PlannerStatus& status)
+    {
+        uint32_t basetime = utils::GetMilliTime();
+        int nworkers = _parameters->_nParallelWorkers;
+        _parallelworkers.SetNumWorkers(nworkers);
+        std::vector<PlannerBasePtr> vplanners(nworkers);
+        std::vector<TrajectoryBasePtr> vtrajs(nworkers);
+        std::vector<PlannerStatus> vstatus(nworkers);
+        for(int iworker = 0; iworker < nworkers; ++iworker) {
+            EnvironmentBasePtr penv = _parallelworkers.UpdateWorkerEnv(GetEnv(), iworker);
+            EnvironmentMutex::scoped_lock workerlock(penv->GetMutex());
+            RobotBasePtr probot;
+            if( !!_robot ) {
+                probot = penv->GetRobot(_robot->GetName());
+            }
+            RRTParametersPtr params(new RRTParameters());
+            ParallelPlannerWorkers::CopyWorkerParameters(_parameters, params, penv, iworker);
+            params->_nParallelWorkers = 0;
+            vplanners[iworker] = RaveCreatePlanner(penv, _bLazyEdges ? "lazybirrt" : "birrt");
+            if( !vplanners[iworker]->InitPlan(probot, params) ) {
+                RAVELOG_WARN_FORMAT("env=%d, failed to initialize parallel worker %d", GetEnv()->GetId()%iworker);
+                return false;
+            }
+            vtrajs[iworker] = RaveCreateTrajectory(penv, ptraj->GetXMLId());
+        }
+
+        // keep calling the callbacks of this planner while the workers run
+        PlannerProgress progress;
+        PlannerAction callbackaction = PA_None;
+        int nwinner = _parallelworkers.Run(vplanners, vtrajs, vstatus, 0, _parameters->_bDeterministicParallel, boost::bind(&BirrtPlanner::_CallCallbacks, this, boost::cref(progress)), callbackaction);
+        // the work of the workers is part of this plan, the total time is set by PlanPath
+        FOREACHC(itstatus, vstatus) {
+            _statistics += itstatus->statistics;
+        }
+        _statistics.totalTime = 0;
+        if( callbackaction == PA_Interrupt ) {
+            status = PlannerStatus("Planning was interrupted", PS_Interrupted);
+            return true;
+        }
+        if( nwinner < 0 ) {
+            std::string description = str(boost::format(_("env=%d, parallel plan with %d workers failed in %fs"))%GetEnv()->GetId()%nworkers%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+            RAVELOG_WARN(description);
+            status = PlannerStatus(description, PS_Failed);
+            return true;
+        }
+
+        // validate the path with the real constraints before using it
+        std::vector<dReal> vdata;
+        {
+            CollisionOptionsStateSaver optionstate(GetEnv()->GetCollisionChecker(),GetEnv()->GetCollisionChecker()->GetCollisionOptions()|CO_ActiveDOFs,false);
+            if( !ParallelPlannerWorkers::CheckWorkerPath(_parameters, vtrajs[nwinner], vdata) ) {
+                RAVELOG_WARN_FORMAT("env=%d, path of parallel worker %d fails the planner constraints, so planning on this environment", GetEnv()->GetId()%nwinner);
+                return false;
+            }
+        }
+
+        std::stringstream sinput("GetInitGoalIndices"), soutput;
+        if( vplanners[nwinner]->SendCommand(soutput, sinput) ) {
+            soutput >> _startindex >> _goalindex;
+        }
+        if( ptraj->GetConfigurationSpecification().GetDOF() == 0 ) {
+            ptraj->Init(_parameters->_configurationspecification);
+        }
+        ptraj->Insert(ptraj->GetNumWaypoints(), vdata, _parameters->_configurationspecification);
+        std::string description = str(boost::format(_("env=%d, parallel plan success from worker %d/%d, path=%d points, computation time=%fs\n"))%GetEnv()->GetId()%nwinner%nworkers%ptraj->GetNumWaypoints()%(0.001f*(float)(utils::GetMilliTime()-basetime)));
+        RAVELOG_DEBUG(description);
+        status = _ProcessPostPlanners(_robot,ptraj);
+        status.description = description;
+        return true;
+    }
+
+    /// \brief checks the unchecked edges of the path through the connected nodes of the forward and backward trees
+    ///
+    /// Invalid edges are clustered, so the edges closest to the last invalid edge are checked first. Without one, the edges close to the connection are checked first since they were added last.
+    /// An invalid edge removes its subtree from the nearest neighbor search of its tree, the other edges keep their state.
+    /// \return true if all the edges of the path are valid
+    bool _ValidateLazyPath(NodeBase* iConnectedForward, NodeBase* iConnectedBackward)
+    {
+        _vLazyEdges.clear();
+        SpatialTree<SimpleNode>* ptrees[2] = {&_treeForward, &_treeBackward};
+        SimpleNode* pconnected[2] = {(SimpleNode*)iConnectedForward, (SimpleNode*)iConnectedBackward};
+        std::vector<dReal> vconfig;
+        for(int itree = 0; itree < 2; ++itree) {
+            int depth = 0;
+            for(SimpleNode* pnode = pconnected[itree]; !!pnode->rrtparent; pnode = pnode->rrtparent, ++depth) {
+                if( pnode->_edgestate == 1 ) {
+                    continue;
+                }
+                dReal fpriority = depth;
+                if( pnode->_edgestate == 2 ) {
+                    fpriority = -1; // known to be invalid
+                }
+                else if( _vLazyInvalidConfig.size() > 0 ) {
+                    ptrees[itree]->GetVectorConfig(pnode, vconfig);
+                    fpriority = _parameters->_distmetricfn(vconfig, _vLazyInvalidConfig);
+                }
+                _vLazyEdges.push_back(LazyEdge(fpriority, itree, pnode));
+            }
+        }
+        std::sort(_vLazyEdges.begin(), _vLazyEdges.end(), LazyEdge::Compare);
+        int nchecked = 0;
+        FOREACH(itedge, _vLazyEdges) {
+            SpatialTree<SimpleNode>* ptree = ptrees[itedge->itree];
+            nchecked += itedge->pnode->_edgestate == 0;
+            if( !ptree->ValidateEdge(itedge->pnode) ) {
+                ptree->GetVectorConfig(itedge->pnode, _vLazyInvalidConfig);
+                ptree->InvalidateNodesWithParent(itedge->pnode);
+                RAVELOG_VERBOSE_FORMAT("env=%d, lazy path has an invalid edge after checking %d/%d edges", GetEnv()->GetId()%nchecked%_vLazyEdges.size());
+                return false;
+            }
+        }
+        RAVELOG_VERBOSE_FORMAT("env=%d, lazy path is valid after checking %d edges", GetEnv()->GetId()%nchecked);
+        return true;
+    }
+
     RRTParametersPtr _parameters;
     SpatialTree< SimpleNode > _treeBackward;
     dReal _fGoalBiasProb;
     std::vector< NodeBase* > _vecGoalNodes;
     size_t _nValidGoals; ///< num valid goals
     std::vector<GOALPATH> _vgoalpaths;
+
+    /// \brief an unchecked edge of a lazy path, from pnode->rrtparent to pnode
+    struct LazyEdge
+    {
+        LazyEdge(dReal fpriority, int itree, SimpleNode* pnode) : fpriority(fpriority), itree(itree), pnode(pnode) {
+        }
+        static bool Compare(const LazyEdge& e0, const LazyEdge& e1) {
+            return e0.fpriority < e1.fpriority;
+        }
+        dReal fpriority; ///< edges with lower priority are checked first
+        int itree; ///< 0 if pnode is in the forward tree, 1 if in the backward tree
+        SimpleNode* pnode;
+    };
+    bool _bLazyEdges; ///< if true, the trees do not check edges while extending and _ValidateLazyPath checks the found paths
+    std::vector<LazyEdge> _vLazyEdges; ///< cache
+    std::vector<dReal> _vLazyInvalidConfig; ///< the end of the last invalid edge found, empty if none
+
+    bool _bReplanning; ///< if true, the trees are kept between queries to the same goals, see _CanReuseTrees
+    bool _bReplanStatesValid; ///< true if _mapReplanBodyStates is the scene the trees were last checked with
+    dReal _fReplanAABBPadding; ///< added to the robot AABBs of the edges
+    std::map<std::string, ReplanBodyState> _mapReplanBodyStates;
+    std::string _replanrobotstatekey;
+    std::vector<NodeBase*> _vReplanNodes; ///< cache
+    std::map<SimpleNode*, AABB> _mapReplanNodeAABBs; ///< cache
+    std::vector<dReal> _vReplanConfig, _vReplanParentConfig, _vReplanAABBConfig; ///< cache
+
+    ParallelPlannerWorkers _parallelworkers; ///< runs the parallel workers, keeps their cloned environments between calls to PlanPath
 };
 
 class BasicRrtPlanner : public RrtPlanner<SimpleNode>
@@ -723,7 +1199,7 @@ public:
         return true;
     }
 
-    PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    virtual PlannerStatus _PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
     {
         if(!_parameters) {
             std::string description = "RrtPlanner::PlanPath - Error, planner not initialized\n";
@@ -753,6 +1229,8 @@ public:
 
         while(iter < _parameters->_nMaxIterations) {
             iter++;
+            _pcounteriterations->Add();
+            _statistics.numIterations++;
             if( !!bestGoalNode && iter >= _parameters->_nMinIterations ) {
                 break;
             }
@@ -774,7 +1252,7 @@ public:
             if( (iter == 1 || RaveRandomFloat() < _fGoalBiasProb ) && _vecGoals.size() > 0 ) {
                 _sampleConfig = _vecGoals[RaveRandomInt()%_vecGoals.size()];
             }
-            else if( !_parameters->_samplefn(_sampleConfig) ) {
+            else if( !_SampleConfiguration(*_parameters, _sampleConfig) ) {
                 continue;
             }
 
@@ -947,7 +1425,7 @@ public:
         return true;
     }
 
-    virtual PlannerStatus PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
+    virtual PlannerStatus _PlanPath(TrajectoryBasePtr ptraj, int planningoptions) override
     {
         _goalindex = -1;
         _startindex = -1;
@@ -963,6 +1441,8 @@ public:
         int iter = 0;
         while(iter < _parameters->_nMaxIterations && _treeForward.GetNumNodes() < _parameters->_nExpectedDataSize ) {
             ++iter;
+            _pcounteriterations->Add();
+            _statistics.numIterations++;
 
             if( RaveRandomFloat() < _parameters->_fExploreProb ) {
                 // explore
@@ -979,7 +1459,7 @@ public:
                 }
             }
             else {     // rrt extend
-                if( !_parameters->_samplefn(vSampleConfig) ) {
+                if( !_SampleConfiguration(*_parameters, vSampleConfig) ) {
                     continue;
                 }
                 NodeBasePtr plastnode;
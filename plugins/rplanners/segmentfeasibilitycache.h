@@ -0,0 +1,159 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This program is free software: you can redistribute it and/or modify it under the terms of the
+// GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+// of the License, or at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+// even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along with this program.
+// If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_SEGMENT_FEASIBILITY_CACHE_H
+#define OPENRAVE_SEGMENT_FEASIBILITY_CACHE_H
+
+#include "openraveplugindefs.h"
+#include <boost/functional/hash.hpp>
+#include <unordered_map>
+
+namespace rplanners {
+
+/// \brief Memoizes PlannerParameters::CheckPathAllConstraints for the segments a smoother checks.
+///
+/// The key is the quantized (q0, q1, dq0, dq1, timeelapsed) together with the interval and the options, so only
+/// segments that are the same up to the quantization share a result. The checked configurations stored in the
+/// ConstraintFilterReturn are kept with the result since the smoothers rebuild the ramps from them.
+/// The environment has to stay unchanged while the cache is used, the smoothers reset it at every PlanPath.
+class SegmentFeasibilityCache
+{
+public:
+    SegmentFeasibilityCache() : _fQuantization(1e-9), _nMaxEntries(200000), _nHits(0), _nMisses(0), _pstatistics(NULL) {
+    }
+
+    /// \brief sets the statistics every check is accumulated into, including the checks answered from the cache. NULL to disable
+    void SetStatistics(PlannerStatistics* pstatistics)
+    {
+        _pstatistics = pstatistics;
+    }
+
+    /// \brief removes all results and resets the statistics
+    void Reset()
+    {
+        _mapResults.clear();
+        _nHits = 0;
+        _nMisses = 0;
+    }
+
+    /// \brief calls params->CheckPathAllConstraints unless the same segment was already checked
+    ///
+    /// Checks that fill a collision report (CFO_FillCollisionReport) are never cached.
+    int CheckPathAllConstraints(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options=0xffff, ConstraintFilterReturnPtr filterreturn=ConstraintFilterReturnPtr())
+    {
+        if( !_pstatistics ) {
+            return _CheckPathAllConstraints(params, q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+        }
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        int ret = _CheckPathAllConstraints(params, q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+        _pstatistics->numConstraintChecks++;
+        _pstatistics->constraintCheckTime += utils::GetNanoPerformanceTime()-starttime;
+        if( ret != 0 ) {
+            _pstatistics->numConstraintRejects++;
+        }
+        return ret;
+    }
+
+    /// \brief number of checks answered from the cache since the last Reset
+    inline size_t GetNumHits() const {
+        return _nHits;
+    }
+
+    /// \brief number of checks that called CheckPathAllConstraints since the last Reset
+    inline size_t GetNumMisses() const {
+        return _nMisses;
+    }
+
+private:
+    int _CheckPathAllConstraints(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& q1, const std::vector<dReal>& dq0, const std::vector<dReal>& dq1, dReal timeelapsed, IntervalType interval, int options, ConstraintFilterReturnPtr filterreturn)
+    {
+        if( options & CFO_FillCollisionReport ) {
+            return params->CheckPathAllConstraints(q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+        }
+
+        _vkey.resize(0);
+        _vkey.push_back(options);
+        _vkey.push_back(interval);
+        _vkey.push_back(_Quantize(timeelapsed));
+        _AppendQuantized(q0);
+        _AppendQuantized(q1);
+        _AppendQuantized(dq0);
+        _AppendQuantized(dq1);
+
+        std::unordered_map<std::vector<int64_t>, Result, boost::hash< std::vector<int64_t> > >::const_iterator itresult = _mapResults.find(_vkey);
+        if( itresult != _mapResults.end() && (!filterreturn || itresult->second._bHasFilterReturn) ) {
+            ++_nHits;
+            if( !!filterreturn ) {
+                const ConstraintFilterReturn& cached = itresult->second._filterreturn;
+                filterreturn->_configurations = cached._configurations;
+                filterreturn->_configurationtimes = cached._configurationtimes;
+                filterreturn->_invalidvalues = cached._invalidvalues;
+                filterreturn->_invalidvelocities = cached._invalidvelocities;
+                filterreturn->_fTimeWhenInvalid = cached._fTimeWhenInvalid;
+                filterreturn->_returncode = cached._returncode;
+                filterreturn->_bHasRampDeviatedFromInterpolation = cached._bHasRampDeviatedFromInterpolation;
+                filterreturn->_report.Reset();
+            }
+            return itresult->second._ret;
+        }
+
+        ++_nMisses;
+        int ret = params->CheckPathAllConstraints(q0, q1, dq0, dq1, timeelapsed, interval, options, filterreturn);
+        if( _mapResults.size() >= _nMaxEntries ) {
+            _mapResults.clear();
+        }
+        Result& result = _mapResults[_vkey];
+        result._ret = ret;
+        result._bHasFilterReturn = !!filterreturn;
+        if( !!filterreturn ) {
+            result._filterreturn._configurations = filterreturn->_configurations;
+            result._filterreturn._configurationtimes = filterreturn->_configurationtimes;
+            result._filterreturn._invalidvalues = filterreturn->_invalidvalues;
+            result._filterreturn._invalidvelocities = filterreturn->_invalidvelocities;
+            result._filterreturn._fTimeWhenInvalid = filterreturn->_fTimeWhenInvalid;
+            result._filterreturn._returncode = filterreturn->_returncode;
+            result._filterreturn._bHasRampDeviatedFromInterpolation = filterreturn->_bHasRampDeviatedFromInterpolation;
+        }
+        return ret;
+    }
+
+    struct Result
+    {
+        Result() : _ret(0), _bHasFilterReturn(false) {
+        }
+        int _ret;
+        bool _bHasFilterReturn;
+        ConstraintFilterReturn _filterreturn; ///< without the collision report
+    };
+
+    inline int64_t _Quantize(dReal f) const {
+        return (int64_t)std::floor(f/_fQuantization + 0.5);
+    }
+
+    inline void _AppendQuantized(const std::vector<dReal>& v) {
+        FOREACHC(it, v) {
+            _vkey.push_back(_Quantize(*it));
+        }
+    }
+
+    dReal _fQuantization; ///< values closer than this are considered the same
+    size_t _nMaxEntries; ///< the cache is cleared when it grows beyond this
+    std::unordered_map<std::vector<int64_t>, Result, boost::hash< std::vector<int64_t> > > _mapResults;
+    std::vector<int64_t> _vkey; ///< cache for the key of the current query
+    size_t _nHits, _nMisses;
+    PlannerStatistics* _pstatistics; ///< if not NULL, every check is accumulated in it, see SetStatistics
+};
+
+} // end namespace rplanners
+
+#endif
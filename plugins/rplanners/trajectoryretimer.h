@@ -286,6 +286,7 @@ public:
                         _timeoffset = itgroup->offset;
                     }
                 }
+                _velocityconverter.Init(_cachednewspec, velspec, GetEnv(), false);
             }
             else {
                 FOREACH(it, _listgroupinfo) {
@@ -323,7 +324,7 @@ public:
             }
             if( _parameters->_hasvelocities ) {
                 ptraj->GetWaypoints(0,numpoints,_vtempdata0,velspec);
-                ConfigurationSpecification::ConvertData(_vdata.begin(),_cachednewspec,_vtempdata0.begin(),velspec,numpoints,GetEnv(),false);
+                _velocityconverter.Convert(_vdata.begin(),_vtempdata0.begin(),numpoints);
             }
             try {
                 std::vector<dReal>::iterator itorgdiff = _vdiffdata.begin()+_cachedoldspec.GetDOF();
@@ -483,6 +484,7 @@ protected:
     
     // caching
     ConfigurationSpecification _cachedoldspec, _cachednewspec; ///< the configuration specification that the cached structures have been set for
+    ConfigurationSpecification::Converter _velocityconverter; ///< converts the velocities of _cachedoldspec to _cachednewspec
     std::string _cachedposinterpolation;
     std::list< boost::function<dReal(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,bool) > > _listmintimefns;
     std::list< boost::function<void(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::iterator) > > _listvelocityfns;
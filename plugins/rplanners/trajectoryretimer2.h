@@ -40,6 +40,7 @@ public:
     };
     typedef boost::shared_ptr<GroupInfo> GroupInfoPtr;
     typedef boost::shared_ptr<GroupInfo const> GroupInfoConstPtr;
+    typedef boost::function<dReal(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,bool)> MinimumTimeFn;
 
 public:
     TrajectoryRetimer2(EnvironmentBasePtr penv, std::istream& sinput) : PlannerBase(penv)
@@ -288,6 +289,7 @@ public:
                         _timeoffset = itgroup->offset;
                     }
                 }
+                _velocityconverter.Init(_cachednewspec, velspec, GetEnv(), false);
             }
             else {
                 FOREACH(it, _listgroupinfo) {
@@ -325,9 +327,21 @@ public:
             }
             if( _parameters->_hasvelocities ) {
                 ptraj->GetWaypoints(0,numpoints,_vtempdata0,velspec);
-                ConfigurationSpecification::ConvertData(_vdata.begin(),_cachednewspec,_vtempdata0.begin(),velspec,numpoints,GetEnv(),false);
+                _velocityconverter.Convert(_vdata.begin(),_vtempdata0.begin(),numpoints);
             }
             try {
+                // two-pass mode: compute the minimum times of all segments in parallel first, then resolve the rest sequentially
+                bool bParallelMinimumTimes = false;
+                if( !_parameters->_hastimestamps && _parameters->nretimingthreads > 1 && numpoints > 2 ) {
+                    int failedpoint = _ComputeMinimumTimesParallel(numpoints);
+                    if( failedpoint > 0 ) {
+                        std::string description = str(boost::format("point %d/%d has uncomputable minimum time, possibly due to boundary constraints")%failedpoint%numpoints);
+                        RAVELOG_VERBOSE(description);
+                        return PlannerStatus(description, PS_Failed);
+                    }
+                    bParallelMinimumTimes = failedpoint == 0;
+                }
+
                 std::vector<dReal>::iterator itorgdiff = _vdiffdata.begin()+_cachedoldspec.GetDOF();
                 std::vector<dReal>::iterator itdataprev = itdata;
                 itdata += dof;
@@ -347,6 +361,24 @@ public:
                             }
                         }
                     }
+                    else if( bParallelMinimumTimes ) {
+                        *(itdata+_timeoffset) = _vmintimes[i];
+                        if( _parameters->_hasvelocities ) {
+                            FOREACH(itfn,_listcheckvelocityfns) {
+                                if( !(*itfn)(itdataprev, itdata, 6) ) {
+                                    std::string description = str(boost::format("point %d/%d has unreachable velocity")%i%numpoints);
+                                    RAVELOG_WARN(description);
+                                    return PlannerStatus(description, PS_Failed);
+                                }
+                            }
+                        }
+                        else if( bUseEndVelocity ) {
+                            // the velocities of the other points were filled before computing the times
+                            FOREACH(itfn,_listvelocityfns) {
+                                (*itfn)(itorgdiff, itdataprev, itdata);
+                            }
+                        }
+                    }
                     else {
                         FOREACH(itmin, _listmintimefns) {
                             dReal fgrouptime = (*itmin)(itorgdiff, itdataprev, itdata,bUseEndVelocity);
@@ -356,14 +388,7 @@ public:
                                 return PlannerStatus(description, PS_Failed);
                             }
 
-                            if( _parameters->_fStepLength > 0 ) {
-                                if( fgrouptime < _parameters->_fStepLength ) {
-                                    fgrouptime = _parameters->_fStepLength;
-                                }
-                                else {
-                                    fgrouptime = std::ceil(fgrouptime/_parameters->_fStepLength-g_fEpsilonJointLimit)*_parameters->_fStepLength;
-                                }
-                            }
+                            fgrouptime = _RoundUpToStepLength(fgrouptime);
                             if( mintime < fgrouptime ) {
                                 mintime = fgrouptime;
                             }
@@ -480,13 +505,104 @@ protected:
         ptraj->Insert(0,data);
     }
 
+    /// \brief prepares the minimum time functions for computing the segments in parallel.
+    ///
+    /// A retimer can only support it if its minimum time functions can run concurrently and its velocity functions do
+    /// not depend on the computed times, since the velocities are filled before the times in that case.
+    /// \param vlistmintimefns filled with one list of minimum time functions (one per group, in the order of _listgroupinfo) for each thread
+    /// \return false if parallel computation is not supported for the current groups
+    virtual bool _InitParallelMinimumTime(int numthreads, std::vector< std::list<MinimumTimeFn> >& vlistmintimefns) {
+        return false;
+    }
+
+    /// \brief rounds the group time up to a multiple of _parameters->_fStepLength if it is set
+    inline dReal _RoundUpToStepLength(dReal fgrouptime) const {
+        if( _parameters->_fStepLength > 0 ) {
+            if( fgrouptime < _parameters->_fStepLength ) {
+                return _parameters->_fStepLength;
+            }
+            return std::ceil(fgrouptime/_parameters->_fStepLength-g_fEpsilonJointLimit)*_parameters->_fStepLength;
+        }
+        return fgrouptime;
+    }
+
+    /// \brief computes the minimum times of all segments of _vdata with _parameters->nretimingthreads threads and stores them in _vmintimes.
+    ///
+    /// If the velocities are not given, they are filled first for all points except the last one.
+    /// \return 0 if all the times were computed, the index of the first point whose time cannot be computed, or -1 if the retimer does not support it
+    int _ComputeMinimumTimesParallel(size_t numpoints)
+    {
+        int numthreads = (int)min((size_t)_parameters->nretimingthreads, numpoints-1);
+        if( !_InitParallelMinimumTime(numthreads, _vlistthreadmintimefns) ) {
+            return -1;
+        }
+
+        int dof = _cachednewspec.GetDOF(), orgdof = _cachedoldspec.GetDOF();
+        if( !_parameters->_hasvelocities ) {
+            for(size_t i = 1; i+1 < numpoints; ++i) {
+                FOREACH(itfn,_listvelocityfns) {
+                    (*itfn)(_vdiffdata.begin()+i*orgdof, _vdata.begin()+(i-1)*dof, _vdata.begin()+i*dof);
+                }
+            }
+        }
+
+        _vmintimes.resize(numpoints);
+        _vmintimes[0] = 0;
+        std::vector<int> vfailedpoints(numthreads, 0);
+        boost::thread_group threads;
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            threads.create_thread(boost::bind(&TrajectoryRetimer2::_ComputeMinimumTimesWorker, this, ithread, numthreads, numpoints, boost::ref(vfailedpoints[ithread])));
+        }
+        threads.join_all();
+
+        // the threads process consecutive chunks, so the first failure is the one of the lowest thread
+        FOREACHC(itfailedpoint, vfailedpoints) {
+            if( *itfailedpoint > 0 ) {
+                return *itfailedpoint;
+            }
+        }
+        return 0;
+    }
+
+    /// \brief computes the minimum times of the ithread-th chunk of segments. failedpoint is set to the first point whose time cannot be computed.
+    void _ComputeMinimumTimesWorker(int ithread, int numthreads, size_t numpoints, int& failedpoint)
+    {
+        int dof = _cachednewspec.GetDOF(), orgdof = _cachedoldspec.GetDOF();
+        size_t ibegin = 1 + (numpoints-1)*ithread/numthreads, iend = 1 + (numpoints-1)*(ithread+1)/numthreads;
+        const std::list<MinimumTimeFn>& listmintimefns = _vlistthreadmintimefns.at(ithread);
+        for(size_t i = ibegin; i < iend; ++i) {
+            dReal mintime = 0;
+            try {
+                FOREACHC(itmin, listmintimefns) {
+                    dReal fgrouptime = (*itmin)(_vdiffdata.begin()+i*orgdof, _vdata.begin()+(i-1)*dof, _vdata.begin()+i*dof, i+1==numpoints);
+                    if( fgrouptime < 0 ) {
+                        failedpoint = i;
+                        return;
+                    }
+                    fgrouptime = _RoundUpToStepLength(fgrouptime);
+                    if( mintime < fgrouptime ) {
+                        mintime = fgrouptime;
+                    }
+                }
+            }
+            catch (const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("env=%d, computing the minimum time of point %d/%d failed: %s", GetEnv()->GetId()%i%numpoints%ex.what());
+                failedpoint = i;
+                return;
+            }
+            _vmintimes[i] = mintime;
+        }
+    }
+
     ConstraintTrajectoryTimingParametersPtr _parameters;
     boost::shared_ptr<ManipConstraintChecker2> _manipconstraintchecker;
 
     // caching
     ConfigurationSpecification _cachedoldspec, _cachednewspec; ///< the configuration specification that the cached structures have been set for
+    ConfigurationSpecification::Converter _velocityconverter; ///< converts the velocities of _cachedoldspec to _cachednewspec
     std::string _cachedposinterpolation;
-    std::list< boost::function<dReal(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,bool) > > _listmintimefns;
+    std::list<MinimumTimeFn> _listmintimefns;
+    std::vector< std::list<MinimumTimeFn> > _vlistthreadmintimefns; ///< minimum time functions of each thread in the two-pass mode
     std::list< boost::function<void(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::iterator) > > _listvelocityfns;
     std::list< boost::function<bool(std::vector<dReal>::const_iterator,std::vector<dReal>::iterator, int) > > _listcheckvelocityfns;
     std::list< boost::function<bool(std::vector<dReal>::const_iterator,std::vector<dReal>::const_iterator,std::vector<dReal>::iterator) > > _listwritefns;
@@ -495,6 +611,7 @@ protected:
     int _timeoffset;
     std::list<GroupInfoPtr> _listgroupinfo;
     vector<dReal> _vtempdata0, _vtempdata1;
+    std::vector<dReal> _vmintimes; ///< minimum time of each segment computed in the two-pass mode
 
     bool _bmanipconstraints; /// if true, check workspace manip constraints
 };
@@ -33,6 +33,8 @@ Planner Parameters\n\
 \n\
 - **bool maintaintiming** - maintain timing with input trajectory\n\
 \n\
+- **bool greedysearch** - if true (default), solves the ik of one workspace sample after the other, always keeping the first continuous solution. If false, solves all the samples in one batch and picks the continuous ik branch with the shortest configuration space path, so an early branch choice cannot make a later sample fail.\n\
+\n\
 - **dReal ignorefirstcollision** - if > 0, will allow the robot to be in environment collision for the initial 'ignorefirstcollision' seconds of the trajectory. Once the robot gets out of collision, it will execute its normal following phase until it gets into collision again. This option is used when lifting objects from a surface, where the object is already in collision with the surface.\n\
 \n\
 - **dReal minimumcompletetime** - specifies the minimum trajectory that must be followed for planner to declare success. If 0, then the entire trajectory has to be followed.\n\
@@ -235,54 +237,59 @@ Planner Parameters\n\
             poutputtraj->Insert(poutputtraj->GetNumWaypoints(),_parameters->vinitialconfig,_parameters->_configurationspecification);
         }
 
-        UserDataPtr filterhandle = _manip->GetIkSolver()->RegisterCustomFilter(0,boost::bind(&WorkspaceTrajectoryTracker::_ValidateSolution,this,_1,_2,_3));
-        vector<dReal> vsolution;
         if( !_parameters->greedysearch ) {
-            RAVELOG_ERROR("WorkspaceTrajectoryTracker::PlanPath - do not support non-greedy search\n");
-        }
-
-        list<Transform>::iterator ittrans = listtransforms.begin();
-        bPrevInCollision = true;
-        ftime = 0;
-        for(; ittrans != listtransforms.end(); ftime += _parameters->_fStepLength, ++ittrans) {
-            _filteroptions = (ftime >= fstarttime) ? IKFO_CheckEnvCollisions : 0;
-            IkParameterization ikparam(*ittrans,IKP_Transform6D);
-            if( !_manip->FindIKSolution(ikparam,vsolution,_filteroptions) ) {
-                if( _filteroptions == 0 ) {
-                    // haven't even checked with environment collisions, so a solution really doesn't exist
-                    return PlannerStatus(PS_Failed);
-                }
-                if(( ftime < _parameters->ignorefirstcollision) && bPrevInCollision ) {
-                    _filteroptions = 0;
-                    if( !_manip->FindIKSolution(ikparam,vsolution,_filteroptions) ) {
+            PlannerStatus status = _PlanPathBatch(poutputtraj, listtransforms, fstarttime, minimumcompletetime);
+            if( status.GetStatusCode() != PS_HasSolution ) {
+                return status;
+            }
+        }
+        else {
+            UserDataPtr filterhandle = _manip->GetIkSolver()->RegisterCustomFilter(0,boost::bind(&WorkspaceTrajectoryTracker::_ValidateSolution,this,_1,_2,_3));
+            vector<dReal> vsolution;
+
+            list<Transform>::iterator ittrans = listtransforms.begin();
+            bPrevInCollision = true;
+            ftime = 0;
+            for(; ittrans != listtransforms.end(); ftime += _parameters->_fStepLength, ++ittrans) {
+                _filteroptions = (ftime >= fstarttime) ? IKFO_CheckEnvCollisions : 0;
+                IkParameterization ikparam(*ittrans,IKP_Transform6D);
+                if( !_manip->FindIKSolution(ikparam,vsolution,_filteroptions) ) {
+                    if( _filteroptions == 0 ) {
+                        // haven't even checked with environment collisions, so a solution really doesn't exist
                         return PlannerStatus(PS_Failed);
                     }
-                }
-                else {
-                    if( !bPrevInCollision ) {
-                        if( ftime >= minimumcompletetime ) {
-                            fendtime = ftime;
-                            break;
+                    if(( ftime < _parameters->ignorefirstcollision) && bPrevInCollision ) {
+                        _filteroptions = 0;
+                        if( !_manip->FindIKSolution(ikparam,vsolution,_filteroptions) ) {
+                            return PlannerStatus(PS_Failed);
                         }
                     }
-                    return PlannerStatus(PS_Failed);
+                    else {
+                        if( !bPrevInCollision ) {
+                            if( ftime >= minimumcompletetime ) {
+                                fendtime = ftime;
+                                break;
+                            }
+                        }
+                        return PlannerStatus(PS_Failed);
+                    }
+                }
+                else {
+                    bPrevInCollision = false;
                 }
-            }
-            else {
-                bPrevInCollision = false;
-            }
 
-            poutputtraj->Insert(poutputtraj->GetNumWaypoints(),vsolution,_parameters->_configurationspecification);
-            if( _parameters->SetStateValues(vsolution) ) {
-                std::string description = "failed to set state\n";
-                RAVELOG_ERROR(description);
-                return PlannerStatus(description, PS_Failed);
+                poutputtraj->Insert(poutputtraj->GetNumWaypoints(),vsolution,_parameters->_configurationspecification);
+                if( _parameters->SetStateValues(vsolution) ) {
+                    std::string description = "failed to set state\n";
+                    RAVELOG_ERROR(description);
+                    return PlannerStatus(description, PS_Failed);
+                }
+                _SetPreviousSolution(vsolution);
             }
-            _SetPreviousSolution(vsolution);
-        }
 
-        if( bPrevInCollision ) {
-            return PlannerStatus("bPrevInCollision" ,PS_Failed);
+            if( bPrevInCollision ) {
+                return PlannerStatus("bPrevInCollision" ,PS_Failed);
+            }
         }
 
         if( !_retimerplanner->InitPlan(RobotBasePtr(),_parameters) || !_retimerplanner->PlanPath(poutputtraj).GetStatusCode() ) {
@@ -298,6 +305,183 @@ Planner Parameters\n\
     }
 
 protected:
+    /// \brief solves the ik of all the workspace samples at once and picks the continuous branch with the shortest configuration space path.
+    ///
+    /// Edges between the solutions of consecutive samples are validated with _ValidateSolution without environment collisions.
+    /// The environment collisions of the segments are only checked on the chosen path. A colliding segment is removed and the
+    /// path is searched again.
+    PlannerStatus _PlanPathBatch(TrajectoryBasePtr poutputtraj, const std::list<Transform>& listtransforms, dReal fstarttime, dReal minimumcompletetime)
+    {
+        const size_t numsteps = listtransforms.size();
+        const dReal fduration = _parameters->workspacetraj->GetDuration();
+        IkSolverBasePtr piksolver = _manip->GetIkSolver();
+        std::vector<dReal> vtimes(numsteps);
+        std::vector<IkParameterization> vikparams(numsteps);
+        std::vector<IkParameterization> vikparamsfree, vikparamsenv;
+        std::vector<size_t> vfreeindices, venvindices;
+        size_t istep = 0;
+        FOREACHC(ittrans, listtransforms) {
+            // the trajectory always ends at the last point, not at a multiple of the step length
+            vtimes[istep] = istep+1 == numsteps ? fduration : istep*_parameters->_fStepLength;
+            // ik solvers take the base frame
+            vikparams[istep].SetTransform6D(_tbaseinv * *ittrans);
+            if( vtimes[istep] >= fstarttime ) {
+                vikparamsenv.push_back(vikparams[istep]);
+                venvindices.push_back(istep);
+            }
+            else {
+                vikparamsfree.push_back(vikparams[istep]);
+                vfreeindices.push_back(istep);
+            }
+            ++istep;
+        }
+
+        std::vector< std::vector< std::vector<dReal> > > vvsolutions(numsteps);
+        std::vector< std::vector<IkReturnPtr> > vvikreturns;
+        piksolver->SolveAllBatch(vikparamsfree, 0, vvikreturns);
+        for(size_t i = 0; i < vvikreturns.size(); ++i) {
+            FOREACHC(itikreturn, vvikreturns[i]) {
+                vvsolutions[vfreeindices[i]].push_back((*itikreturn)->_vsolution);
+            }
+        }
+        // vininitialcollision[istep] is 1 if the step belongs to the initial colliding stretch, which is allowed to collide. the stretch
+        // starts with the end effector collisions and ends at the first step with a collision free solution, like bPrevInCollision of the greedy search.
+        std::vector<uint8_t> vininitialcollision(numsteps, 0);
+        FOREACHC(itindex, vfreeindices) {
+            vininitialcollision[*itindex] = 1;
+        }
+        bool bPrevInCollision = true;
+        piksolver->SolveAllBatch(vikparamsenv, IKFO_CheckEnvCollisions, vvikreturns);
+        for(size_t i = 0; i < vvikreturns.size(); ++i) {
+            size_t index = venvindices[i];
+            if( vvikreturns[i].size() == 0 ) {
+                if( vtimes[index] < _parameters->ignorefirstcollision && bPrevInCollision ) {
+                    // the robot is allowed to start in collision
+                    piksolver->SolveAll(vikparams[index], 0, vvikreturns[i]);
+                    vininitialcollision[index] = 1;
+                }
+            }
+            else {
+                bPrevInCollision = false;
+            }
+            FOREACHC(itikreturn, vvikreturns[i]) {
+                vvsolutions[index].push_back((*itikreturn)->_vsolution);
+            }
+        }
+
+        // vvedgedists[istep][iprev*numsolutions+isolution] is the distance of the edge, or -1 if the solutions are not continuous.
+        // edges into the first step start from vinitialconfig if it is set, otherwise from the current configuration.
+        const bool bHasInitial = (int)_parameters->vinitialconfig.size() == _parameters->GetDOF();
+        std::vector<dReal> vcurrent;
+        _parameters->_getstatefn(vcurrent);
+        const std::vector< std::vector<dReal> > vstartsolutions(1, bHasInitial ? _parameters->vinitialconfig : vcurrent);
+        std::vector< std::vector<dReal> > vvedgedists(numsteps);
+        _filteroptions = 0;
+        vector<dReal> vsolution;
+        for(istep = 0; istep < numsteps; ++istep) {
+            const std::vector< std::vector<dReal> >& vprevsolutions = istep > 0 ? vvsolutions[istep-1] : vstartsolutions;
+            vvedgedists[istep].resize(vprevsolutions.size()*vvsolutions[istep].size(), -1);
+            for(size_t iprev = 0; iprev < vprevsolutions.size(); ++iprev) {
+                if( istep > 0 || bHasInitial ) {
+                    if( _parameters->SetStateValues(vprevsolutions[iprev]) != 0 ) {
+                        continue;
+                    }
+                    _SetPreviousSolution(vprevsolutions[iprev], istep > 0);
+                }
+                for(size_t isolution = 0; isolution < vvsolutions[istep].size(); ++isolution) {
+                    vsolution = vvsolutions[istep][isolution];
+                    if( (istep == 0 && !bHasInitial) || _ValidateSolution(vsolution, _manip, vikparams[istep]) == IKRA_Success ) {
+                        vvedgedists[istep][iprev*vvsolutions[istep].size()+isolution] = _parameters->_distmetricfn(vprevsolutions[iprev], vvsolutions[istep][isolution]);
+                    }
+                }
+            }
+        }
+
+        std::vector< std::vector<dReal> > vvcosts(numsteps);
+        std::vector< std::vector<int> > vvparents(numsteps);
+        std::vector<int> vpath;
+        for(size_t isearch = 0; isearch < 100; ++isearch) {
+            // shortest path through the steps, stops at the first step that cannot be reached
+            size_t numreachable = 0;
+            for(istep = 0; istep < numsteps; ++istep) {
+                const size_t numprev = istep > 0 ? vvsolutions[istep-1].size() : 1;
+                const size_t numsolutions = vvsolutions[istep].size();
+                vvcosts[istep].resize(0); vvcosts[istep].resize(numsolutions, -1);
+                vvparents[istep].resize(0); vvparents[istep].resize(numsolutions, -1);
+                bool breachable = false;
+                for(size_t iprev = 0; iprev < numprev; ++iprev) {
+                    dReal fprevcost = istep > 0 ? vvcosts[istep-1][iprev] : dReal(0);
+                    if( fprevcost < 0 ) {
+                        continue;
+                    }
+                    for(size_t isolution = 0; isolution < numsolutions; ++isolution) {
+                        dReal fedgedist = vvedgedists[istep][iprev*numsolutions+isolution];
+                        if( fedgedist >= 0 && (vvcosts[istep][isolution] < 0 || fprevcost+fedgedist < vvcosts[istep][isolution]) ) {
+                            vvcosts[istep][isolution] = fprevcost+fedgedist;
+                            vvparents[istep][isolution] = iprev;
+                            breachable = true;
+                        }
+                    }
+                }
+                if( !breachable ) {
+                    break;
+                }
+                numreachable = istep+1;
+            }
+            if( numreachable == 0 || (numreachable < numsteps && vtimes[numreachable] < minimumcompletetime) ) {
+                std::string description = str(boost::format("env=%d, no continuous ik branch reaches time %f/%f")%GetEnv()->GetId()%vtimes[numreachable]%fduration);
+                RAVELOG_DEBUG(description);
+                return PlannerStatus(description, PS_Failed);
+            }
+
+            vpath.resize(numreachable);
+            int ibest = -1;
+            for(size_t isolution = 0; isolution < vvcosts[numreachable-1].size(); ++isolution) {
+                if( vvcosts[numreachable-1][isolution] >= 0 && (ibest < 0 || vvcosts[numreachable-1][isolution] < vvcosts[numreachable-1][ibest]) ) {
+                    ibest = isolution;
+                }
+            }
+            for(int i = (int)numreachable-1; i >= 0; --i) {
+                vpath[i] = ibest;
+                ibest = vvparents[i][ibest];
+            }
+
+            // check the environment collisions of the segments on the path, the end effector links were checked already
+            FOREACH(it,_vchildlinks) {
+                (*it)->Enable(true);
+            }
+            int icollidingstep = -1;
+            for(istep = 0; istep < numreachable; ++istep) {
+                // segments that start inside the initial colliding stretch are allowed to collide
+                if( istep == 0 ? (!bHasInitial || vininitialcollision[0]) : vininitialcollision[istep-1] ) {
+                    continue;
+                }
+                const std::vector<dReal>& vprev = istep > 0 ? vvsolutions[istep-1][vpath[istep-1]] : _parameters->vinitialconfig;
+                if( _parameters->CheckPathAllConstraints(vprev, vvsolutions[istep][vpath[istep]], std::vector<dReal>(), std::vector<dReal>(), 0, IT_Open) != 0 ) {
+                    icollidingstep = istep;
+                    break;
+                }
+            }
+            FOREACH(it,_vchildlinks) {
+                (*it)->Enable(false);
+            }
+            if( icollidingstep < 0 ) {
+                for(istep = 0; istep < numreachable; ++istep) {
+                    poutputtraj->Insert(poutputtraj->GetNumWaypoints(),vvsolutions[istep][vpath[istep]],_parameters->_configurationspecification);
+                }
+                if( _parameters->SetStateValues(vvsolutions[numreachable-1][vpath[numreachable-1]]) != 0 ) {
+                    std::string description = "failed to set state\n";
+                    RAVELOG_ERROR(description);
+                    return PlannerStatus(description, PS_Failed);
+                }
+                return PlannerStatus(PS_HasSolution);
+            }
+            const size_t iprev = icollidingstep > 0 ? vpath[icollidingstep-1] : 0;
+            vvedgedists[icollidingstep][iprev*vvsolutions[icollidingstep].size()+vpath[icollidingstep]] = -1;
+        }
+        return PlannerStatus("too many colliding segments on the continuous ik branches", PS_Failed);
+    }
+
     void _SetPreviousSolution(const std::vector<dReal>& vsolution, bool bsetjacobian=true)
     {
         if( bsetjacobian ) {
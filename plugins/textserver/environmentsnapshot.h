@@ -0,0 +1,223 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_ENVIRONMENTSNAPSHOT
+#define OPENRAVE_ENVIRONMENTSNAPSHOT
+
+#include <openrave/openravejson.h>
+#include <openrave/utils.h>
+
+#include <sstream>
+
+/// \brief the bodies of an environment written as binary json, so that environments on other hosts can be rebuilt from it.
+///
+/// Every body is stored with its link, joint and manipulator infos, which include the collision meshes, and with its transform,
+/// dof values and link enable states. Attached sensors, grabbed bodies and controllers are not stored.
+/// Snapshots are identified by the md5 hash of their data.
+class EnvironmentSnapshot
+{
+public:
+    /// \brief writes all bodies of the environment, which should be locked
+    static void Serialize(EnvironmentBasePtr penv, std::string& data)
+    {
+        std::vector<KinBodyPtr> vbodies;
+        penv->GetBodies(vbodies);
+        rapidjson::Document doc;
+        doc.SetObject();
+        rapidjson::Document::AllocatorType& alloc = doc.GetAllocator();
+        rapidjson::Value rbodies(rapidjson::kArrayType);
+        FOREACHC(itbody, vbodies) {
+            rapidjson::Value rbody(rapidjson::kObjectType);
+            _SerializeBody(*itbody, rbody, alloc);
+            rbodies.PushBack(rbody, alloc);
+        }
+        doc.AddMember("bodies", rbodies, alloc);
+        std::stringstream ss;
+        openravejson::DumpBinaryJson(doc, ss);
+        data = ss.str();
+    }
+
+    static std::string GetHash(const std::string& data) {
+        return utils::GetMD5HashString(data);
+    }
+
+    /// \brief reads the data written by \ref Serialize
+    static void Parse(const std::string& data, rapidjson::Document& doc)
+    {
+        std::stringstream ss(data);
+        openravejson::ParseBinaryJson(doc, ss);
+    }
+
+    /// \brief makes the bodies of the environment the ones of the snapshot, the environment should be locked
+    ///
+    /// Bodies with the same name and kinematics geometry hash as in the snapshot are kept and only get the state of the snapshot, so
+    /// loading several snapshots of the same scene only moves the bodies that differ. All other bodies are removed.
+    static void Load(EnvironmentBasePtr penv, const rapidjson::Value& doc)
+    {
+        if( !doc.IsObject() || !doc.HasMember("bodies") || !doc["bodies"].IsArray() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("environment snapshot does not have bodies", ORE_InvalidArguments);
+        }
+        const rapidjson::Value& rbodies = doc["bodies"];
+        std::set<std::string> setnames;
+        for(rapidjson::Value::ConstValueIterator itbody = rbodies.Begin(); itbody != rbodies.End(); ++itbody) {
+            std::string name;
+            openravejson::LoadJsonValueByKey(*itbody, "name", name);
+            setnames.insert(name);
+        }
+        std::vector<KinBodyPtr> vbodies;
+        penv->GetBodies(vbodies);
+        FOREACH(itbody, vbodies) {
+            if( setnames.find((*itbody)->GetName()) == setnames.end() ) {
+                penv->Remove(*itbody);
+            }
+        }
+
+        for(rapidjson::Value::ConstValueIterator itbody = rbodies.Begin(); itbody != rbodies.End(); ++itbody) {
+            _LoadBody(penv, *itbody);
+        }
+    }
+
+private:
+    static void _SerializeBody(KinBodyPtr pbody, rapidjson::Value& rbody, rapidjson::Document::AllocatorType& alloc)
+    {
+        openravejson::SetJsonValueByKey(rbody, "name", pbody->GetName(), alloc);
+        openravejson::SetJsonValueByKey(rbody, "xmlid", pbody->GetXMLId(), alloc);
+        openravejson::SetJsonValueByKey(rbody, "uri", pbody->GetURI(), alloc);
+        openravejson::SetJsonValueByKey(rbody, "isRobot", pbody->IsRobot(), alloc);
+        openravejson::SetJsonValueByKey(rbody, "kinematicsGeometryHash", pbody->GetKinematicsGeometryHash(), alloc);
+
+        rapidjson::Value rlinks(rapidjson::kArrayType);
+        FOREACHC(itlink, pbody->GetLinks()) {
+            rapidjson::Value rlink(rapidjson::kObjectType);
+            (*itlink)->UpdateAndGetInfo().SerializeJSON(rlink, alloc);
+            rlinks.PushBack(rlink, alloc);
+        }
+        rbody.AddMember("links", rlinks, alloc);
+
+        rapidjson::Value rjoints(rapidjson::kArrayType);
+        for(int ijointlist = 0; ijointlist < 2; ++ijointlist) {
+            FOREACHC(itjoint, ijointlist == 0 ? pbody->GetJoints() : pbody->GetPassiveJoints()) {
+                rapidjson::Value rjoint(rapidjson::kObjectType);
+                (*itjoint)->UpdateAndGetInfo().SerializeJSON(rjoint, alloc);
+                rjoints.PushBack(rjoint, alloc);
+            }
+        }
+        rbody.AddMember("joints", rjoints, alloc);
+
+        if( pbody->IsRobot() ) {
+            RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+            rapidjson::Value rmanips(rapidjson::kArrayType);
+            FOREACHC(itmanip, probot->GetManipulators()) {
+                rapidjson::Value rmanip(rapidjson::kObjectType);
+                (*itmanip)->GetInfo().SerializeJSON(rmanip, alloc);
+                rmanips.PushBack(rmanip, alloc);
+            }
+            rbody.AddMember("manipulators", rmanips, alloc);
+        }
+
+        std::vector<dReal> vdofvalues;
+        pbody->GetDOFValues(vdofvalues);
+        std::vector<uint8_t> venablestates;
+        pbody->GetLinkEnableStates(venablestates);
+        openravejson::SetJsonValueByKey(rbody, "transform", pbody->GetTransform(), alloc);
+        openravejson::SetJsonValueByKey(rbody, "dofValues", vdofvalues, alloc);
+        openravejson::SetJsonValueByKey(rbody, "linkEnableStates", std::vector<int>(venablestates.begin(), venablestates.end()), alloc);
+    }
+
+    /// \brief creates the body unless the environment already has it, then sets its state
+    static void _LoadBody(EnvironmentBasePtr penv, const rapidjson::Value& rbody)
+    {
+        std::string name, xmlid, uri, kinematicsgeometryhash;
+        bool bIsRobot = false;
+        openravejson::LoadJsonValueByKey(rbody, "name", name);
+        openravejson::LoadJsonValueByKey(rbody, "xmlid", xmlid);
+        openravejson::LoadJsonValueByKey(rbody, "uri", uri);
+        openravejson::LoadJsonValueByKey(rbody, "isRobot", bIsRobot);
+        openravejson::LoadJsonValueByKey(rbody, "kinematicsGeometryHash", kinematicsgeometryhash);
+
+        KinBodyPtr pbody = penv->GetKinBody(name);
+        if( !!pbody && (pbody->IsRobot() != bIsRobot || pbody->GetKinematicsGeometryHash() != kinematicsgeometryhash) ) {
+            penv->Remove(pbody);
+            pbody.reset();
+        }
+        if( !pbody ) {
+            std::vector<KinBody::LinkInfoConstPtr> vlinkinfos;
+            std::vector<KinBody::JointInfoConstPtr> vjointinfos;
+            if( rbody.HasMember("links") ) {
+                const rapidjson::Value& rlinks = rbody["links"];
+                for(rapidjson::Value::ConstValueIterator itlink = rlinks.Begin(); itlink != rlinks.End(); ++itlink) {
+                    KinBody::LinkInfoPtr plinkinfo(new KinBody::LinkInfo());
+                    plinkinfo->DeserializeJSON(*itlink);
+                    vlinkinfos.push_back(plinkinfo);
+                }
+            }
+            if( rbody.HasMember("joints") ) {
+                const rapidjson::Value& rjoints = rbody["joints"];
+                for(rapidjson::Value::ConstValueIterator itjoint = rjoints.Begin(); itjoint != rjoints.End(); ++itjoint) {
+                    KinBody::JointInfoPtr pjointinfo(new KinBody::JointInfo());
+                    pjointinfo->DeserializeJSON(*itjoint);
+                    vjointinfos.push_back(pjointinfo);
+                }
+            }
+            bool bInit;
+            if( bIsRobot ) {
+                std::vector<RobotBase::ManipulatorInfoConstPtr> vmanipinfos;
+                if( rbody.HasMember("manipulators") ) {
+                    const rapidjson::Value& rmanips = rbody["manipulators"];
+                    for(rapidjson::Value::ConstValueIterator itmanip = rmanips.Begin(); itmanip != rmanips.End(); ++itmanip) {
+                        RobotBase::ManipulatorInfoPtr pmanipinfo(new RobotBase::ManipulatorInfo());
+                        pmanipinfo->DeserializeJSON(*itmanip);
+                        vmanipinfos.push_back(pmanipinfo);
+                    }
+                }
+                RobotBasePtr probot = RaveCreateRobot(penv, xmlid);
+                if( !probot ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("failed to create robot %s of type %s", name%xmlid, ORE_InvalidState);
+                }
+                bInit = probot->Init(vlinkinfos, vjointinfos, vmanipinfos, std::vector<RobotBase::AttachedSensorInfoConstPtr>(), uri);
+                pbody = probot;
+            }
+            else {
+                pbody = RaveCreateKinBody(penv, xmlid);
+                if( !pbody ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("failed to create body %s of type %s", name%xmlid, ORE_InvalidState);
+                }
+                bInit = pbody->Init(vlinkinfos, vjointinfos, uri);
+            }
+            if( !bInit ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("failed to initialize body %s of the environment snapshot", name, ORE_InvalidState);
+            }
+            pbody->SetName(name);
+            penv->Add(pbody, false);
+        }
+
+        Transform t;
+        std::vector<dReal> vdofvalues;
+        std::vector<int> venablestates;
+        openravejson::LoadJsonValueByKey(rbody, "transform", t);
+        openravejson::LoadJsonValueByKey(rbody, "dofValues", vdofvalues);
+        openravejson::LoadJsonValueByKey(rbody, "linkEnableStates", venablestates);
+        pbody->SetTransform(t);
+        if( vdofvalues.size() == (size_t)pbody->GetDOF() ) {
+            pbody->SetDOFValues(vdofvalues, KinBody::CLA_Nothing);
+        }
+        if( venablestates.size() == pbody->GetLinks().size() ) {
+            pbody->SetLinkEnableStates(std::vector<uint8_t>(venablestates.begin(), venablestates.end()));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,464 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_PLANNINGCOORDINATOR
+#define OPENRAVE_PLANNINGCOORDINATOR
+
+#include "planningserver.h"
+
+#ifndef _WIN32
+#include <netdb.h>
+#endif
+
+#include <deque>
+
+/// \brief distributes planning jobs over planningserver modules running on other hosts.
+///
+/// Snapshots of the environment are created with CreateSnapshot and the jobs refer to them by hash. Before a job is sent to a
+/// host, the host is asked whether it keeps the snapshot, and the data is only sent when it does not, so every snapshot crosses
+/// the network once per host even across coordinators. Every host gets as many jobs at a time as it has planning environments.
+/// When the connection to a host is lost, its jobs are given to the other hosts.
+class PlanningCoordinator : public ModuleBase
+{
+    struct CoordinatorJob
+    {
+        CoordinatorJob() : jobid(0), priority(0) {
+        }
+        int jobid;
+        int priority;
+        std::string snapshothash;
+        std::string request; ///< the plansnapshot request sent to the host
+    };
+    typedef boost::shared_ptr<CoordinatorJob> CoordinatorJobPtr;
+
+    struct WorkerNode
+    {
+        WorkerNode() : sockfd(-1), port(0), capacity(1), bClosed(false) {
+        }
+        int sockfd;
+        std::string host;
+        int port;
+        int capacity; ///< number of planning environments of the host
+        std::map<int, CoordinatorJobPtr> mapjobs; ///< the jobs sent to the host and not answered yet
+        std::map<std::string, bool> mapsnapshots; ///< true if the host has the snapshot, false while asking it
+        std::deque<std::string> queueSend; ///< requests the send thread still has to write, in order
+        boost::condition condSend;
+        bool bClosed;
+    };
+    typedef boost::shared_ptr<WorkerNode> WorkerNodePtr;
+
+public:
+    PlanningCoordinator(EnvironmentBasePtr penv) : ModuleBase(penv), _bShutdown(false), _nNextJobId(1)
+    {
+        __description = ":Interface Author: agent\n\nSends planning jobs and environment snapshots to planningserver modules on other hosts and collects the results.";
+        RegisterCommand("AddWorker",boost::bind(&PlanningCoordinator::_AddWorkerCommand,this,_1,_2),
+                        "host port. Connects to the planningserver of a host");
+        RegisterCommand("CreateSnapshot",boost::bind(&PlanningCoordinator::_CreateSnapshotCommand,this,_1,_2),
+                        "serializes the bodies of the environment and returns the hash the jobs refer to");
+        RegisterCommand("Submit",boost::bind(&PlanningCoordinator::_SubmitCommand,this,_1,_2),
+                        "snapshothash priority deadline robotname plannername numdofs dofindex0 ... affinedofs followed by the planner parameters xml. Returns the job id");
+        RegisterCommand("GetResults",boost::bind(&PlanningCoordinator::_GetResultsCommand,this,_1,_2),
+                        "[timeout]. Waits up to timeout seconds for a result, then returns every finished job as \"jobid numbytes\\n\" followed by its answer");
+        RegisterCommand("GetStatus",boost::bind(&PlanningCoordinator::_GetStatusCommand,this,_1,_2),
+                        "returns the number of pending jobs, sent jobs, finished results and connected hosts");
+    }
+
+    virtual ~PlanningCoordinator() {
+        Destroy();
+    }
+
+    virtual void Destroy()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+            FOREACH(itnode, _listNodes) {
+                (*itnode)->condSend.notify_all();
+            }
+        }
+        FOREACH(itthread, _listThreads) {
+            (*itthread)->join();
+        }
+        _listThreads.clear();
+        FOREACH(itnode, _listNodes) {
+            if( (*itnode)->sockfd >= 0 ) {
+                PLANNINGSERVER_CLOSESOCKET((*itnode)->sockfd);
+                (*itnode)->sockfd = -1;
+            }
+        }
+        _listNodes.clear();
+        _listPending.clear();
+        _listResults.clear();
+        _mapSnapshots.clear();
+        _bShutdown = false;
+    }
+
+private:
+    bool _AddWorkerCommand(ostream& sout, istream& sinput)
+    {
+        std::string host;
+        int port = 4766;
+        sinput >> host >> port;
+        if( host.size() == 0 ) {
+            return false;
+        }
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(1,1), &wsaData) != 0) {
+            RAVELOG_ERROR("Failed to start win socket\n");
+            return false;
+        }
+#endif
+        struct addrinfo hints, *paddresses = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if( getaddrinfo(host.c_str(), boost::lexical_cast<std::string>(port).c_str(), &hints, &paddresses) != 0 || !paddresses ) {
+            RAVELOG_WARN_FORMAT("failed to resolve planning host %s", host);
+            return false;
+        }
+        int sockfd = socket(paddresses->ai_family, paddresses->ai_socktype, paddresses->ai_protocol);
+        if( sockfd < 0 || connect(sockfd, paddresses->ai_addr, paddresses->ai_addrlen) != 0 ) {
+            freeaddrinfo(paddresses);
+            if( sockfd >= 0 ) {
+                PLANNINGSERVER_CLOSESOCKET(sockfd);
+            }
+            RAVELOG_WARN_FORMAT("failed to connect to planning host %s:%d", host%port);
+            return false;
+        }
+        freeaddrinfo(paddresses);
+
+        WorkerNodePtr pnode(new WorkerNode());
+        pnode->sockfd = sockfd;
+        pnode->host = host;
+        pnode->port = port;
+        // the number of environments of the host decides how many jobs it gets at a time
+        std::string answer;
+        if( !_Send(sockfd, "status\n") || !_ReceiveAnswer(sockfd, answer) ) {
+            PLANNINGSERVER_CLOSESOCKET(sockfd);
+            RAVELOG_WARN_FORMAT("planning host %s:%d did not answer the status request", host%port);
+            return false;
+        }
+        std::stringstream ss(answer);
+        std::string cmd;
+        int numqueued = 0, numrunning = 0;
+        ss >> cmd >> numqueued >> numrunning >> pnode->capacity;
+        pnode->capacity = max(1, pnode->capacity);
+
+        boost::mutex::scoped_lock lock(_mutex);
+        _listNodes.push_back(pnode);
+        _listThreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&PlanningCoordinator::_ReceiveThread, this, pnode))));
+        _listThreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&PlanningCoordinator::_SendThread, this, pnode))));
+        _Dispatch();
+        RAVELOG_DEBUG_FORMAT("connected to planning host %s:%d with %d environments", host%port%pnode->capacity);
+        return true;
+    }
+
+    bool _CreateSnapshotCommand(ostream& sout, istream& sinput)
+    {
+        boost::shared_ptr<std::string> pdata(new std::string());
+        {
+            EnvironmentMutex::scoped_lock lockenv(GetEnv()->GetMutex());
+            EnvironmentSnapshot::Serialize(GetEnv(), *pdata);
+        }
+        std::string hash = EnvironmentSnapshot::GetHash(*pdata);
+        boost::mutex::scoped_lock lock(_mutex);
+        _mapSnapshots[hash] = pdata;
+        sout << hash;
+        return true;
+    }
+
+    bool _SubmitCommand(ostream& sout, istream& sinput)
+    {
+        CoordinatorJobPtr pjob(new CoordinatorJob());
+        std::string robotname, plannername;
+        dReal fdeadline = 0;
+        int numdofs = 0, affinedofs = 0;
+        sinput >> pjob->snapshothash >> pjob->priority >> fdeadline >> robotname >> plannername >> numdofs;
+        if( !sinput || numdofs < 0 ) {
+            return false;
+        }
+        std::vector<int> vdofindices(numdofs);
+        FOREACH(it, vdofindices) {
+            sinput >> *it;
+        }
+        sinput >> affinedofs;
+        if( !sinput ) {
+            return false;
+        }
+        std::string parameters((std::istreambuf_iterator<char>(sinput)), std::istreambuf_iterator<char>());
+
+        boost::mutex::scoped_lock lock(_mutex);
+        if( _mapSnapshots.find(pjob->snapshothash) == _mapSnapshots.end() ) {
+            RAVELOG_WARN_FORMAT("unknown snapshot %s, call CreateSnapshot first", pjob->snapshothash);
+            return false;
+        }
+        pjob->jobid = _nNextJobId++;
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        ss << "plansnapshot " << pjob->snapshothash << " " << pjob->jobid << " " << pjob->priority << " " << fdeadline << " " << robotname << " " << plannername << " " << numdofs;
+        FOREACHC(it, vdofindices) {
+            ss << " " << *it;
+        }
+        ss << " " << affinedofs << " " << parameters.size() << "\n" << parameters;
+        pjob->request = ss.str();
+        _AddPending(pjob);
+        _Dispatch();
+        sout << pjob->jobid;
+        return true;
+    }
+
+    bool _GetResultsCommand(ostream& sout, istream& sinput)
+    {
+        dReal ftimeout = 0;
+        sinput >> ftimeout;
+        boost::mutex::scoped_lock lock(_mutex);
+        if( _listResults.empty() && ftimeout > 0 ) {
+            _condResults.timed_wait(lock, boost::posix_time::microseconds((int64_t)(ftimeout*1000000)));
+        }
+        FOREACHC(itresult, _listResults) {
+            sout << itresult->first << " " << itresult->second.size() << "\n" << itresult->second;
+        }
+        _listResults.clear();
+        return true;
+    }
+
+    bool _GetStatusCommand(ostream& sout, istream& sinput)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        size_t numsent = 0, numnodes = 0;
+        FOREACHC(itnode, _listNodes) {
+            if( !(*itnode)->bClosed ) {
+                numsent += (*itnode)->mapjobs.size();
+                ++numnodes;
+            }
+        }
+        sout << _listPending.size() << " " << numsent << " " << _listResults.size() << " " << numnodes;
+        return true;
+    }
+
+    /// \brief inserts the job after the pending jobs of the same or higher priority, _mutex should be locked
+    void _AddPending(CoordinatorJobPtr pjob)
+    {
+        std::list<CoordinatorJobPtr>::iterator it = _listPending.begin();
+        while(it != _listPending.end() && (*it)->priority >= pjob->priority) {
+            ++it;
+        }
+        _listPending.insert(it, pjob);
+    }
+
+    /// \brief gives the pending jobs to the hosts that have free environments, _mutex should be locked
+    ///
+    /// A job is only sent once the host is known to have its snapshot, the jobs of a snapshot that is being asked for wait.
+    void _Dispatch()
+    {
+        FOREACH(itnode, _listNodes) {
+            WorkerNode& node = **itnode;
+            std::list<CoordinatorJobPtr>::iterator itjob = _listPending.begin();
+            while(!node.bClosed && (int)node.mapjobs.size() < node.capacity && itjob != _listPending.end()) {
+                std::map<std::string, bool>::iterator itsnapshot = node.mapsnapshots.find((*itjob)->snapshothash);
+                if( itsnapshot == node.mapsnapshots.end() ) {
+                    node.mapsnapshots[(*itjob)->snapshothash] = false;
+                    node.queueSend.push_back(str(boost::format("hassnapshot %s\n")%(*itjob)->snapshothash));
+                    node.condSend.notify_all();
+                    ++itjob;
+                }
+                else if( !itsnapshot->second ) {
+                    ++itjob;
+                }
+                else {
+                    node.mapjobs[(*itjob)->jobid] = *itjob;
+                    node.queueSend.push_back((*itjob)->request);
+                    node.condSend.notify_all();
+                    itjob = _listPending.erase(itjob);
+                }
+            }
+        }
+    }
+
+    /// \brief writes the requests of one host in the order they were queued
+    void _SendThread(WorkerNodePtr pnode)
+    {
+        while(true) {
+            std::string request;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while(!_bShutdown && !pnode->bClosed && pnode->queueSend.empty()) {
+                    pnode->condSend.wait(lock);
+                }
+                if( _bShutdown || pnode->bClosed ) {
+                    break;
+                }
+                request.swap(pnode->queueSend.front());
+                pnode->queueSend.pop_front();
+            }
+            if( !_Send(pnode->sockfd, request) ) {
+                RAVELOG_WARN_FORMAT("failed to send to planning host %s:%d", pnode->host%pnode->port);
+                boost::mutex::scoped_lock lock(_mutex);
+                _CloseNode(*pnode);
+                break;
+            }
+        }
+    }
+
+    /// \brief reads the answers of one host
+    void _ReceiveThread(WorkerNodePtr pnode)
+    {
+        std::string answer;
+        while(!_bShutdown) {
+            if( !_WaitReadable(pnode->sockfd, 100000) ) {
+                boost::mutex::scoped_lock lock(_mutex);
+                if( pnode->bClosed ) {
+                    break;
+                }
+                continue;
+            }
+            if( !_ReceiveAnswer(pnode->sockfd, answer) ) {
+                RAVELOG_WARN_FORMAT("lost connection to planning host %s:%d", pnode->host%pnode->port);
+                boost::mutex::scoped_lock lock(_mutex);
+                _CloseNode(*pnode);
+                break;
+            }
+            boost::mutex::scoped_lock lock(_mutex);
+            _ProcessAnswer(*pnode, answer);
+            _Dispatch();
+        }
+    }
+
+    /// \brief _mutex should be locked
+    void _ProcessAnswer(WorkerNode& node, const std::string& answer)
+    {
+        std::stringstream ss(answer);
+        std::string cmd;
+        ss >> cmd;
+        if( cmd == "hassnapshot" ) {
+            std::string hash;
+            int bHasSnapshot = 0;
+            ss >> hash >> bHasSnapshot;
+            if( !bHasSnapshot ) {
+                std::map<std::string, boost::shared_ptr<std::string> >::iterator itdata = _mapSnapshots.find(hash);
+                if( itdata == _mapSnapshots.end() ) {
+                    return;
+                }
+                // the host reads its requests in order, so the jobs queued after the data find the snapshot
+                node.queueSend.push_back(str(boost::format("snapshot %s %d\n")%hash%itdata->second->size()) + *itdata->second);
+                node.condSend.notify_all();
+            }
+            node.mapsnapshots[hash] = true;
+        }
+        else if( cmd == "snapshot" ) {
+            std::string hash, status;
+            ss >> hash >> status;
+            if( status != "ok" ) {
+                RAVELOG_WARN_FORMAT("planning host %s:%d did not accept snapshot %s: %s", node.host%node.port%hash%answer);
+            }
+        }
+        else if( cmd != "status" ) {
+            int jobid = 0;
+            try {
+                jobid = boost::lexical_cast<int>(cmd);
+            }
+            catch(const boost::bad_lexical_cast&) {
+                RAVELOG_WARN_FORMAT("unknown answer from planning host %s:%d: %s", node.host%node.port%cmd);
+                return;
+            }
+            std::map<int, CoordinatorJobPtr>::iterator itjob = node.mapjobs.find(jobid);
+            if( itjob == node.mapjobs.end() ) {
+                return;
+            }
+            node.mapjobs.erase(itjob);
+            size_t pos = answer.find_first_not_of(' ', cmd.size());
+            _listResults.push_back(std::make_pair(jobid, pos != std::string::npos ? answer.substr(pos) : std::string()));
+            _condResults.notify_all();
+        }
+    }
+
+    /// \brief gives the jobs of the host to the others, _mutex should be locked
+    void _CloseNode(WorkerNode& node)
+    {
+        if( node.bClosed ) {
+            return;
+        }
+        node.bClosed = true;
+        node.condSend.notify_all();
+        FOREACH(itjob, node.mapjobs) {
+            _AddPending(itjob->second);
+        }
+        node.mapjobs.clear();
+        node.queueSend.clear();
+        _Dispatch();
+    }
+
+    static bool _WaitReadable(int sockfd, int timeoutus)
+    {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(sockfd, &readfds);
+        struct timeval tv;
+        tv.tv_sec = timeoutus/1000000;
+        tv.tv_usec = timeoutus%1000000;
+        return select(sockfd+1, &readfds, NULL, NULL, &tv) > 0;
+    }
+
+    static bool _Send(int sockfd, const std::string& data)
+    {
+        size_t offset = 0;
+        while(offset < data.size()) {
+            int nsent = send(sockfd, data.c_str()+offset, data.size()-offset, 0);
+            if( nsent <= 0 ) {
+                return false;
+            }
+            offset += nsent;
+        }
+        return true;
+    }
+
+    static bool _Receive(int sockfd, char* pdata, size_t size)
+    {
+        size_t offset = 0;
+        while(offset < size) {
+            int nread = recv(sockfd, pdata+offset, size-offset, 0);
+            if( nread <= 0 ) {
+                return false;
+            }
+            offset += nread;
+        }
+        return true;
+    }
+
+    /// \brief reads one answer prefixed by its size
+    static bool _ReceiveAnswer(int sockfd, std::string& answer)
+    {
+        uint32_t size = 0;
+        if( !_Receive(sockfd, (char*)&size, 4) ) {
+            return false;
+        }
+        answer.resize(size);
+        return size == 0 || _Receive(sockfd, &answer[0], size);
+    }
+
+    boost::mutex _mutex;
+    boost::condition _condResults;
+    bool _bShutdown;
+    int _nNextJobId;
+    std::list<WorkerNodePtr> _listNodes;
+    std::list<boost::shared_ptr<boost::thread> > _listThreads; ///< the send and receive threads of the hosts
+    std::list<CoordinatorJobPtr> _listPending; ///< jobs not sent to a host, by decreasing priority
+    std::list< std::pair<int, std::string> > _listResults; ///< job id and answer of the host without the job id
+    std::map<std::string, boost::shared_ptr<std::string> > _mapSnapshots; ///< data of the snapshots by hash
+};
+
+#endif
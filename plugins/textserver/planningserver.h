@@ -0,0 +1,680 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_PLANNINGSERVER
+#define OPENRAVE_PLANNINGSERVER
+
+#include <openrave/utils.h>
+#include "environmentsnapshot.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define PLANNINGSERVER_CLOSESOCKET close
+#else
+#undef WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define usleep(microseconds) Sleep((microseconds+999)/1000)
+#define PLANNINGSERVER_CLOSESOCKET closesocket
+typedef int socklen_t;
+#endif
+
+#include <queue>
+#include <sstream>
+
+/// \brief runs planning jobs received over a socket on a pool of environments cloned from the main environment.
+///
+/// Every worker thread owns one clone that is created once in main. Before a job is planned, the clone is
+/// brought up to date with SynchronizeBodies, so no cloning happens per job. Jobs wait in one queue sorted by
+/// priority, then deadline, then arrival.
+///
+/// Every request is one line, answers are prefixed with their size as a 4 byte integer:
+/// - plan jobid priority deadline robotname plannername numdofs dofindex0 ... affinedofs numbytes\n followed by numbytes of planner parameters xml.
+///   deadline is the number of seconds the client waits for the job, 0 for no deadline.
+///   The answer is "jobid success\n" followed by the serialized trajectory, or "jobid failed|expired|cancelled description".
+/// - plansnapshot hash jobid ...\n is the same as plan, except that the environment is first made the snapshot with that hash instead of being synchronized with the main environment.
+/// - snapshot hash numbytes\n followed by numbytes of \ref EnvironmentSnapshot data, kept by hash for later plansnapshot requests of any connection.
+///   The answer is "snapshot hash ok" or "snapshot hash failed description". Only the most recently used snapshots are kept.
+/// - hassnapshot hash\n answers "hassnapshot hash 1" if the snapshot is kept, otherwise "hassnapshot hash 0", so that a coordinator only sends the snapshots a host does not have.
+/// - cancel jobid\n stops the job of this connection, the job itself answers with cancelled.
+/// - status\n answers "status numqueued numrunning numworkers".
+class PlanningServer : public ModuleBase
+{
+    struct Connection
+    {
+        Connection() : sockfd(-1), bClosed(false), bFinished(false) {
+        }
+        int sockfd;
+        boost::mutex mutexSend; ///< serializes the answers of the workers
+        bool bClosed;
+        bool bFinished; ///< true when the thread of the connection returns, protected by _mutexJobs
+    };
+    typedef boost::shared_ptr<Connection> ConnectionPtr;
+
+    struct PlanningJob
+    {
+        PlanningJob() : jobid(0), priority(0), deadline(0), sequence(0), affinedofs(0), bCancelled(false) {
+        }
+        int jobid;
+        int priority; ///< higher runs first
+        uint64_t deadline; ///< absolute time in us, 0 if none
+        uint64_t sequence; ///< arrival order
+        std::string robotname, plannername;
+        std::vector<int> vdofindices;
+        int affinedofs;
+        std::string parameters; ///< planner parameters xml
+        std::string snapshothash; ///< if not empty, the environment snapshot the job is planned in
+        ConnectionPtr pconnection;
+        bool bCancelled; ///< protected by _mutexJobs
+    };
+    typedef boost::shared_ptr<PlanningJob> PlanningJobPtr;
+
+    /// \brief orders the queue so the top is the job to run next
+    struct PlanningJobCompare
+    {
+        bool operator()(const PlanningJobPtr& a, const PlanningJobPtr& b) const {
+            if( a->priority != b->priority ) {
+                return a->priority < b->priority;
+            }
+            if( a->deadline != b->deadline ) {
+                // no deadline goes last
+                if( a->deadline == 0 ) {
+                    return true;
+                }
+                if( b->deadline == 0 ) {
+                    return false;
+                }
+                return a->deadline > b->deadline;
+            }
+            return a->sequence > b->sequence;
+        }
+    };
+
+public:
+    PlanningServer(EnvironmentBasePtr penv) : ModuleBase(penv), _nPort(4766), _server_sockfd(-1), _bInit(false), _bShutdown(false), _nSequence(0), _nNumRunning(0), _nMaxSnapshots(16)
+    {
+        __description = ":Interface Author: agent\n\nAccepts planning jobs over a socket and plans them on a pool of synchronized environment clones. Start with \"port numenvironments [maxsnapshots]\".";
+        RegisterCommand("GetStatus",boost::bind(&PlanningServer::_GetStatusCommand,this,_1,_2),
+                        "returns the number of queued jobs, running jobs and workers");
+    }
+
+    virtual ~PlanningServer() {
+        Destroy();
+    }
+
+    virtual int main(const std::string& cmd)
+    {
+        Destroy();
+
+        int nNumEnvironments = 2;
+        _nPort = 4766;
+        _nMaxSnapshots = 16;
+        stringstream ss(cmd);
+        ss >> _nPort >> nNumEnvironments >> _nMaxSnapshots;
+        nNumEnvironments = max(1, nNumEnvironments);
+        _nMaxSnapshots = max(1, _nMaxSnapshots);
+
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(1,1), &wsaData) != 0) {
+            RAVELOG_ERROR("Failed to start win socket\n");
+            return -1;
+        }
+#endif
+
+        struct sockaddr_in server_address;
+        memset(&server_address, 0, sizeof(server_address));
+        _server_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        server_address.sin_family = AF_INET;
+        server_address.sin_addr.s_addr = htonl(INADDR_ANY);
+        server_address.sin_port = htons(_nPort);
+
+        int yes = 1;
+        if( setsockopt(_server_sockfd, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(int)) ) {
+            RAVELOG_ERROR("failed to set socket option\n");
+            _CloseServerSocket();
+            return -1;
+        }
+        if( ::bind(_server_sockfd, (struct sockaddr *)&server_address, sizeof(server_address)) ) {
+            RAVELOG_ERROR_FORMAT("failed to bind planning server to port %d", _nPort);
+            _CloseServerSocket();
+            return -1;
+        }
+        if( ::listen(_server_sockfd, 128) ) {
+            RAVELOG_ERROR_FORMAT("failed to listen to planning server port %d", _nPort);
+            _CloseServerSocket();
+            return -1;
+        }
+
+        // clone once, afterwards the clones are only synchronized
+        _vclones.resize(nNumEnvironments);
+        {
+            EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+            for(int ienv = 0; ienv < nNumEnvironments; ++ienv) {
+                _vclones[ienv] = GetEnv()->CloneSelf(Clone_Bodies);
+            }
+        }
+
+        _bShutdown = false;
+        for(int ienv = 0; ienv < nNumEnvironments; ++ienv) {
+            _listThreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&PlanningServer::_WorkerThread, this, _vclones[ienv]))));
+        }
+        _listThreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&PlanningServer::_ListenThread, this))));
+        _bInit = true;
+        RAVELOG_DEBUG_FORMAT("planning server listening on port %d with %d environments", _nPort%nNumEnvironments);
+        return 0;
+    }
+
+    virtual void Destroy()
+    {
+        if( !_bInit ) {
+            return;
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutexJobs);
+            _bShutdown = true;
+            FOREACH(itjob, _listActiveJobs) {
+                (*itjob)->bCancelled = true;
+            }
+            _condJobs.notify_all();
+        }
+        FOREACH(itthread, _listThreads) {
+            (*itthread)->join();
+        }
+        _listThreads.clear();
+        // the listen thread stopped, so no connections are added anymore
+        FOREACH(itthread, _listConnectionThreads) {
+            itthread->second->join();
+        }
+        _listConnectionThreads.clear();
+        {
+            boost::mutex::scoped_lock lock(_mutexJobs);
+            while(!_queueJobs.empty()) {
+                _queueJobs.pop();
+            }
+            _listActiveJobs.clear();
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutexSnapshots);
+            _listSnapshots.clear();
+        }
+        FOREACH(itenv, _vclones) {
+            (*itenv)->Destroy();
+        }
+        _vclones.clear();
+        _CloseServerSocket();
+        _bInit = false;
+    }
+
+private:
+    bool _GetStatusCommand(ostream& sout, istream& sinput)
+    {
+        boost::mutex::scoped_lock lock(_mutexJobs);
+        sout << _queueJobs.size() << " " << _nNumRunning << " " << _vclones.size();
+        return true;
+    }
+
+    void _CloseServerSocket()
+    {
+        if( _server_sockfd >= 0 ) {
+            PLANNINGSERVER_CLOSESOCKET(_server_sockfd);
+            _server_sockfd = -1;
+        }
+    }
+
+    /// \brief waits until the socket has data for at most timeoutus, returns false if it has no data
+    static bool _WaitReadable(int sockfd, int timeoutus)
+    {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(sockfd, &readfds);
+        struct timeval tv;
+        tv.tv_sec = timeoutus/1000000;
+        tv.tv_usec = timeoutus%1000000;
+        return select(sockfd+1, &readfds, NULL, NULL, &tv) > 0;
+    }
+
+    void _ListenThread()
+    {
+        while(!_bShutdown) {
+            if( !_WaitReadable(_server_sockfd, 100000) ) {
+                continue;
+            }
+            struct sockaddr_in client_address;
+            socklen_t client_len = sizeof(client_address);
+            int sockfd = accept(_server_sockfd, (struct sockaddr *)&client_address, &client_len);
+            if( sockfd < 0 ) {
+                continue;
+            }
+            ConnectionPtr pconnection(new Connection());
+            pconnection->sockfd = sockfd;
+            std::list< std::pair<ConnectionPtr, boost::shared_ptr<boost::thread> > > listFinished;
+            {
+                boost::mutex::scoped_lock lock(_mutexJobs);
+                std::list< std::pair<ConnectionPtr, boost::shared_ptr<boost::thread> > >::iterator itthread = _listConnectionThreads.begin();
+                while(itthread != _listConnectionThreads.end()) {
+                    if( itthread->first->bFinished ) {
+                        listFinished.splice(listFinished.end(), _listConnectionThreads, itthread++);
+                    }
+                    else {
+                        ++itthread;
+                    }
+                }
+                _listConnectionThreads.push_back(std::make_pair(pconnection, boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&PlanningServer::_ConnectionThread, this, pconnection)))));
+            }
+            // the finished threads only have to return, so joining them does not block
+            FOREACH(itthread, listFinished) {
+                itthread->second->join();
+            }
+        }
+    }
+
+    /// \brief reads requests of one connection, planning requests are queued for the workers
+    void _ConnectionThread(ConnectionPtr pconnection)
+    {
+        std::string buffer;
+        std::vector<char> vrecv(65536);
+        size_t nWaitBytes = 0; ///< if not 0, the size of the parameters of pjobwaiting or of the data of snapshotwaiting
+        PlanningJobPtr pjobwaiting;
+        std::string snapshotwaiting; ///< hash of the snapshot whose data is read
+        while(!_bShutdown) {
+            if( !_WaitReadable(pconnection->sockfd, 100000) ) {
+                continue;
+            }
+            int nread = recv(pconnection->sockfd, &vrecv[0], vrecv.size(), 0);
+            if( nread <= 0 ) {
+                break;
+            }
+            buffer.append(&vrecv[0], nread);
+            while(true) {
+                if( !!pjobwaiting ) {
+                    if( buffer.size() < nWaitBytes ) {
+                        break;
+                    }
+                    pjobwaiting->parameters = buffer.substr(0, nWaitBytes);
+                    buffer.erase(0, nWaitBytes);
+                    _QueueJob(pjobwaiting);
+                    pjobwaiting.reset();
+                    continue;
+                }
+                if( snapshotwaiting.size() > 0 ) {
+                    if( buffer.size() < nWaitBytes ) {
+                        break;
+                    }
+                    _AddSnapshot(pconnection, snapshotwaiting, buffer.substr(0, nWaitBytes));
+                    buffer.erase(0, nWaitBytes);
+                    snapshotwaiting.resize(0);
+                    continue;
+                }
+                size_t pos = buffer.find('\n');
+                if( pos == std::string::npos ) {
+                    break;
+                }
+                std::string line = buffer.substr(0, pos);
+                buffer.erase(0, pos+1);
+                pjobwaiting = _ProcessLine(pconnection, line, nWaitBytes, snapshotwaiting);
+            }
+        }
+
+        {
+            boost::mutex::scoped_lock lock(pconnection->mutexSend);
+            pconnection->bClosed = true;
+        }
+        {
+            // the client cannot receive the answers anymore
+            boost::mutex::scoped_lock lock(_mutexJobs);
+            FOREACH(itjob, _listActiveJobs) {
+                if( (*itjob)->pconnection == pconnection ) {
+                    (*itjob)->bCancelled = true;
+                }
+            }
+        }
+        PLANNINGSERVER_CLOSESOCKET(pconnection->sockfd);
+        boost::mutex::scoped_lock lock(_mutexJobs);
+        pconnection->bFinished = true;
+    }
+
+    /// \brief returns a job if the line starts a plan request whose parameters still have to be read
+    ///
+    /// \param snapshotwaiting set to the hash if the line starts a snapshot whose nWaitBytes of data still have to be read
+    PlanningJobPtr _ProcessLine(ConnectionPtr pconnection, const std::string& line, size_t& nWaitBytes, std::string& snapshotwaiting)
+    {
+        std::stringstream ss(line);
+        std::string cmd;
+        ss >> cmd;
+        if( cmd == "plan" || cmd == "plansnapshot" ) {
+            PlanningJobPtr pjob(new PlanningJob());
+            if( cmd == "plansnapshot" ) {
+                ss >> pjob->snapshothash;
+            }
+            dReal fdeadline = 0;
+            int numdofs = 0;
+            ss >> pjob->jobid >> pjob->priority >> fdeadline >> pjob->robotname >> pjob->plannername >> numdofs;
+            if( !!ss && numdofs >= 0 ) {
+                pjob->vdofindices.resize(numdofs);
+                FOREACH(it, pjob->vdofindices) {
+                    ss >> *it;
+                }
+                ss >> pjob->affinedofs >> nWaitBytes;
+            }
+            if( !ss ) {
+                RAVELOG_WARN_FORMAT("bad plan request: %s", line);
+                _SendAnswer(pconnection, str(boost::format("%d failed bad request")%pjob->jobid));
+                return PlanningJobPtr();
+            }
+            if( fdeadline > 0 ) {
+                pjob->deadline = utils::GetMicroTime() + (uint64_t)(fdeadline*1000000);
+            }
+            pjob->pconnection = pconnection;
+            if( nWaitBytes == 0 ) {
+                _QueueJob(pjob);
+                return PlanningJobPtr();
+            }
+            return pjob;
+        }
+        else if( cmd == "cancel" ) {
+            int jobid = 0;
+            ss >> jobid;
+            boost::mutex::scoped_lock lock(_mutexJobs);
+            FOREACH(itjob, _listActiveJobs) {
+                if( (*itjob)->pconnection == pconnection && (*itjob)->jobid == jobid ) {
+                    (*itjob)->bCancelled = true;
+                }
+            }
+        }
+        else if( cmd == "snapshot" ) {
+            std::string hash;
+            nWaitBytes = 0;
+            ss >> hash >> nWaitBytes;
+            if( !ss || hash.size() == 0 ) {
+                RAVELOG_WARN_FORMAT("bad snapshot request: %s", line);
+                nWaitBytes = 0;
+                _SendAnswer(pconnection, str(boost::format("snapshot %s failed bad request")%hash));
+            }
+            else if( nWaitBytes == 0 ) {
+                _SendAnswer(pconnection, str(boost::format("snapshot %s failed no data")%hash));
+            }
+            else {
+                snapshotwaiting = hash;
+            }
+        }
+        else if( cmd == "hassnapshot" ) {
+            std::string hash;
+            ss >> hash;
+            _SendAnswer(pconnection, str(boost::format("hassnapshot %s %d")%hash%(!!_GetSnapshot(hash))));
+        }
+        else if( cmd == "status" ) {
+            std::stringstream sout;
+            sout << "status ";
+            _GetStatusCommand(sout, ss);
+            _SendAnswer(pconnection, sout.str());
+        }
+        else if( cmd.size() > 0 ) {
+            RAVELOG_WARN_FORMAT("unknown planning server command %s", cmd);
+        }
+        return PlanningJobPtr();
+    }
+
+    /// \brief keeps the snapshot if its data has the announced hash, the least recently used snapshots are dropped
+    void _AddSnapshot(ConnectionPtr pconnection, const std::string& hash, const std::string& data)
+    {
+        if( EnvironmentSnapshot::GetHash(data) != hash ) {
+            RAVELOG_WARN_FORMAT("snapshot data of %d bytes does not have hash %s", data.size()%hash);
+            _SendAnswer(pconnection, str(boost::format("snapshot %s failed hash mismatch")%hash));
+            return;
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutexSnapshots);
+            _GetSnapshotNoLock(hash);
+            if( _listSnapshots.empty() || _listSnapshots.front().first != hash ) {
+                _listSnapshots.push_front(std::make_pair(hash, boost::shared_ptr<std::string const>(new std::string(data))));
+            }
+            while((int)_listSnapshots.size() > _nMaxSnapshots) {
+                _listSnapshots.pop_back();
+            }
+        }
+        RAVELOG_DEBUG_FORMAT("received snapshot %s of %d bytes", hash%data.size());
+        _SendAnswer(pconnection, str(boost::format("snapshot %s ok")%hash));
+    }
+
+    boost::shared_ptr<std::string const> _GetSnapshot(const std::string& hash)
+    {
+        boost::mutex::scoped_lock lock(_mutexSnapshots);
+        return _GetSnapshotNoLock(hash);
+    }
+
+    /// \brief returns the data of the snapshot and moves it to the front of _listSnapshots
+    boost::shared_ptr<std::string const> _GetSnapshotNoLock(const std::string& hash)
+    {
+        for(std::list< std::pair<std::string, boost::shared_ptr<std::string const> > >::iterator it = _listSnapshots.begin(); it != _listSnapshots.end(); ++it) {
+            if( it->first == hash ) {
+                _listSnapshots.splice(_listSnapshots.begin(), _listSnapshots, it);
+                return _listSnapshots.front().second;
+            }
+        }
+        return boost::shared_ptr<std::string const>();
+    }
+
+    void _QueueJob(PlanningJobPtr pjob)
+    {
+        boost::mutex::scoped_lock lock(_mutexJobs);
+        pjob->sequence = _nSequence++;
+        _queueJobs.push(pjob);
+        _listActiveJobs.push_back(pjob);
+        _condJobs.notify_one();
+    }
+
+    void _FinishJob(PlanningJobPtr pjob, const std::string& answer)
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexJobs);
+            _listActiveJobs.remove(pjob);
+        }
+        _SendAnswer(pjob->pconnection, answer);
+    }
+
+    void _SendAnswer(ConnectionPtr pconnection, const std::string& answer)
+    {
+        boost::mutex::scoped_lock lock(pconnection->mutexSend);
+        if( pconnection->bClosed ) {
+            return;
+        }
+        uint32_t size = answer.size();
+        std::string data((const char*)&size, 4);
+        data += answer;
+        size_t offset = 0;
+        while(offset < data.size()) {
+            int nsent = send(pconnection->sockfd, data.c_str()+offset, data.size()-offset, 0);
+            if( nsent <= 0 ) {
+                pconnection->bClosed = true;
+                break;
+            }
+            offset += nsent;
+        }
+    }
+
+    PlannerAction _PlanCallback(PlanningJobPtr pjob, const PlannerBase::PlannerProgress& progress)
+    {
+        if( pjob->bCancelled || _bShutdown || (pjob->deadline > 0 && utils::GetMicroTime() > pjob->deadline) ) {
+            return PA_Interrupt;
+        }
+        return PA_None;
+    }
+
+    /// \brief plans the jobs on its own environment, the planners are kept across jobs
+    void _WorkerThread(EnvironmentBasePtr penv)
+    {
+        std::map<std::string, PlannerBasePtr> mapplanners;
+        TrajectoryBasePtr ptraj = RaveCreateTrajectory(penv, "");
+        WorkerSnapshot snapshot;
+        while(true) {
+            PlanningJobPtr pjob;
+            {
+                boost::mutex::scoped_lock lock(_mutexJobs);
+                while(!_bShutdown && _queueJobs.empty()) {
+                    _condJobs.wait(lock);
+                }
+                if( _bShutdown ) {
+                    break;
+                }
+                pjob = _queueJobs.top();
+                _queueJobs.pop();
+                if( pjob->bCancelled ) {
+                    lock.unlock();
+                    _FinishJob(pjob, str(boost::format("%d cancelled")%pjob->jobid));
+                    continue;
+                }
+                ++_nNumRunning;
+            }
+            std::string answer;
+            try {
+                answer = _PlanJob(penv, pjob, mapplanners, ptraj, snapshot);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("planning job %d failed: %s", pjob->jobid%ex.what());
+                answer = str(boost::format("%d failed %s")%pjob->jobid%ex.what());
+            }
+            {
+                boost::mutex::scoped_lock lock(_mutexJobs);
+                --_nNumRunning;
+            }
+            _FinishJob(pjob, answer);
+        }
+    }
+
+    /// \brief the snapshot a worker environment was last made, parsed once
+    struct WorkerSnapshot
+    {
+        WorkerSnapshot() : bLoaded(false) {
+        }
+        std::string hash;
+        rapidjson::Document doc;
+        bool bLoaded; ///< true if the bodies of the environment may come from a snapshot instead of the main environment
+    };
+
+    std::string _PlanJob(EnvironmentBasePtr penv, PlanningJobPtr pjob, std::map<std::string, PlannerBasePtr>& mapplanners, TrajectoryBasePtr ptraj, WorkerSnapshot& snapshot)
+    {
+        if( pjob->deadline > 0 && utils::GetMicroTime() > pjob->deadline ) {
+            return str(boost::format("%d expired")%pjob->jobid);
+        }
+
+        if( pjob->snapshothash.size() > 0 ) {
+            if( snapshot.hash != pjob->snapshothash ) {
+                boost::shared_ptr<std::string const> pdata = _GetSnapshot(pjob->snapshothash);
+                if( !pdata ) {
+                    return str(boost::format("%d failed unknown snapshot %s")%pjob->jobid%pjob->snapshothash);
+                }
+                snapshot.hash.resize(0);
+                EnvironmentSnapshot::Parse(*pdata, snapshot.doc);
+                snapshot.hash = pjob->snapshothash;
+            }
+        }
+        else if( snapshot.bLoaded ) {
+            // the bodies do not correspond to the main environment anymore, so they cannot be synchronized
+            penv->Clone(GetEnv(), Clone_Bodies);
+            snapshot.bLoaded = false;
+        }
+        else {
+            penv->SynchronizeBodies(GetEnv());
+        }
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        if( pjob->snapshothash.size() > 0 ) {
+            // also resets the bodies that the previous job of the same snapshot moved
+            snapshot.bLoaded = true;
+            EnvironmentSnapshot::Load(penv, snapshot.doc);
+        }
+        RobotBasePtr probot = penv->GetRobot(pjob->robotname);
+        if( !probot ) {
+            return str(boost::format("%d failed unknown robot %s")%pjob->jobid%pjob->robotname);
+        }
+        RobotBase::RobotStateSaver saver(probot);
+        probot->SetActiveDOFs(pjob->vdofindices, pjob->affinedofs);
+
+        PlannerBase::PlannerParametersPtr params(new PlannerBase::PlannerParameters());
+        if( pjob->parameters.size() > 0 ) {
+            std::stringstream ss(pjob->parameters);
+            ss >> *params;
+        }
+        // the state functions can only come from the robot, keep the requested start and goal
+        std::vector<dReal> vinitialconfig = params->vinitialconfig, vgoalconfig = params->vgoalconfig;
+        params->SetRobotActiveJoints(probot);
+        if( vinitialconfig.size() > 0 ) {
+            params->vinitialconfig.swap(vinitialconfig);
+        }
+        params->vgoalconfig.swap(vgoalconfig);
+        if( pjob->deadline > 0 ) {
+            uint64_t curtime = utils::GetMicroTime();
+            uint32_t nRemainingTime = pjob->deadline > curtime ? (uint32_t)((pjob->deadline - curtime)/1000) : 1;
+            if( params->_nMaxPlanningTime == 0 || params->_nMaxPlanningTime > nRemainingTime ) {
+                params->_nMaxPlanningTime = nRemainingTime;
+            }
+        }
+
+        PlannerBasePtr& pplanner = mapplanners[pjob->plannername];
+        if( !pplanner ) {
+            pplanner = RaveCreatePlanner(penv, pjob->plannername);
+            if( !pplanner ) {
+                mapplanners.erase(pjob->plannername);
+                return str(boost::format("%d failed unknown planner %s")%pjob->jobid%pjob->plannername);
+            }
+        }
+        if( !pplanner->InitPlan(probot, params) ) {
+            return str(boost::format("%d failed InitPlan")%pjob->jobid);
+        }
+        UserDataPtr pcallback = pplanner->RegisterPlanCallback(boost::bind(&PlanningServer::_PlanCallback, this, pjob, _1));
+        ptraj->Init(probot->GetActiveConfigurationSpecification());
+        PlannerStatus status = pplanner->PlanPath(ptraj);
+        if( pjob->bCancelled ) {
+            return str(boost::format("%d cancelled")%pjob->jobid);
+        }
+        if( !status.HasSolution() ) {
+            if( pjob->deadline > 0 && utils::GetMicroTime() > pjob->deadline ) {
+                return str(boost::format("%d expired")%pjob->jobid);
+            }
+            return str(boost::format("%d failed %s")%pjob->jobid%status.description);
+        }
+        std::stringstream sout;
+        sout << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        sout << pjob->jobid << " success\n";
+        ptraj->serialize(sout);
+        return sout.str();
+    }
+
+    int _nPort;
+    int _server_sockfd;
+    bool _bInit;
+    bool _bShutdown;
+    std::vector<EnvironmentBasePtr> _vclones;
+    std::list<boost::shared_ptr<boost::thread> > _listThreads; ///< the workers and the listen thread
+    std::list< std::pair<ConnectionPtr, boost::shared_ptr<boost::thread> > > _listConnectionThreads; ///< the threads of the open connections and of the finished connections that were not joined yet, protected by _mutexJobs
+
+    boost::mutex _mutexJobs;
+    boost::condition _condJobs;
+    std::priority_queue<PlanningJobPtr, std::vector<PlanningJobPtr>, PlanningJobCompare> _queueJobs;
+    std::list<PlanningJobPtr> _listActiveJobs; ///< queued and running jobs, used for cancelling
+    uint64_t _nSequence;
+    int _nNumRunning;
+
+    boost::mutex _mutexSnapshots;
+    std::list< std::pair<std::string, boost::shared_ptr<std::string const> > > _listSnapshots; ///< hash and data of the received snapshots, most recently used first
+    int _nMaxSnapshots;
+};
+
+#endif
@@ -0,0 +1,444 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_SHAREDSTATE
+#define OPENRAVE_SHAREDSTATE
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <sstream>
+
+/// \brief start of the shared memory written by SharedStatePublisher, followed by capacity bytes of body records
+///
+/// The records are only consistent while sequence is even and did not change during the read (seqlock), there is one publisher per segment.
+struct SharedStateHeader
+{
+    SharedStateHeader() : magic(s_nMagic), version(s_nVersion), capacity(0), sequence(0), closed(0), numbodies(0), datasize(0), simulationtime(0), bodiesmodifiedstamp(0), reserved(0) {
+    }
+    static const uint32_t s_nMagic = 0x4f525353; // ORSS
+    static const uint32_t s_nVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity; ///< bytes of body data after the header
+    std::atomic<uint64_t> sequence; ///< odd while the publisher writes
+    std::atomic<uint32_t> closed; ///< set when the publisher is destroyed, the readers open the segment again
+    uint32_t numbodies;
+    uint64_t datasize; ///< bytes of the records of the numbodies bodies
+    uint64_t simulationtime;
+    int32_t bodiesmodifiedstamp;
+    uint32_t reserved;
+};
+
+/// \brief state of one body, followed by the name padded to 8 bytes, 7 doubles per link transform (rot xyzw, trans xyz) and numdofs doubles
+struct SharedStateBodyRecord
+{
+    int32_t environmentid;
+    int32_t updatestamp;
+    uint32_t namelength;
+    uint32_t numlinks;
+    uint32_t numdofs;
+    uint32_t reserved;
+};
+
+/// \brief writes the link transforms and dof values of the published bodies to shared memory, so readers on the same host get them without serialization or sockets.
+///
+/// The bodies are written every time UpdatePublishedBodies publishes a new snapshot, which is checked every period without locking the environment.
+/// Only the poses are shared, the readers load the same scene on their own. Start with "name [capacity [period]]".
+class SharedStatePublisher : public ModuleBase
+{
+public:
+    SharedStatePublisher(EnvironmentBasePtr penv) : ModuleBase(penv), _pheader(NULL), _fPeriod(0.001), _bShutdown(false), _bWarnedCapacity(false)
+    {
+        __description = ":Interface Author: agent\n\nPublishes the link transforms and dof values of the bodies to shared memory for sharedstatereader modules of other processes. Start with \"name [capacity [period]]\".";
+        RegisterCommand("GetStatus",boost::bind(&SharedStatePublisher::_GetStatusCommand,this,_1,_2),
+                        "returns the sequence, the number of bodies and the bytes of the last write");
+    }
+
+    virtual ~SharedStatePublisher() {
+        Destroy();
+    }
+
+    virtual int main(const std::string& cmd)
+    {
+        Destroy();
+        uint64_t capacity = 4<<20;
+        _fPeriod = 0.001;
+        stringstream ss(cmd);
+        ss >> _name >> capacity >> _fPeriod;
+        if( _name.size() == 0 ) {
+            RAVELOG_WARN("sharedstatepublisher needs the name of the shared memory\n");
+            return -1;
+        }
+        try {
+            // a previous publisher could have crashed without removing it
+            boost::interprocess::shared_memory_object::remove(_name.c_str());
+            boost::interprocess::shared_memory_object shm(boost::interprocess::create_only, _name.c_str(), boost::interprocess::read_write);
+            shm.truncate(sizeof(SharedStateHeader)+capacity);
+            _region.reset(new boost::interprocess::mapped_region(shm, boost::interprocess::read_write));
+        }
+        catch(const boost::interprocess::interprocess_exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, failed to create shared memory %s: %s", GetEnv()->GetId()%_name%ex.what());
+            _region.reset();
+            return -1;
+        }
+        _pheader = new (_region->get_address()) SharedStateHeader();
+        _pheader->capacity = capacity;
+        _bShutdown = false;
+        _bWarnedCapacity = false;
+        _pthread.reset(new boost::thread(boost::bind(&SharedStatePublisher::_PublishThread, this)));
+        RAVELOG_DEBUG_FORMAT("env=%d, publishing bodies to shared memory %s with %d bytes", GetEnv()->GetId()%_name%capacity);
+        return 0;
+    }
+
+    virtual void Destroy()
+    {
+        if( !!_pthread ) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                _bShutdown = true;
+                _cond.notify_all();
+            }
+            _pthread->join();
+            _pthread.reset();
+        }
+        if( !!_pheader ) {
+            _pheader->closed.store(1, std::memory_order_release);
+            _pheader = NULL;
+        }
+        if( !!_region ) {
+            _region.reset();
+            boost::interprocess::shared_memory_object::remove(_name.c_str());
+        }
+        _psnapshot.reset();
+    }
+
+private:
+    bool _GetStatusCommand(ostream& sout, istream& sinput)
+    {
+        if( !_pheader ) {
+            return false;
+        }
+        boost::mutex::scoped_lock lock(_mutex);
+        sout << _pheader->sequence.load(std::memory_order_relaxed) << " " << _pheader->numbodies << " " << _pheader->datasize;
+        return true;
+    }
+
+    void _PublishThread()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        while( !_bShutdown ) {
+            EnvironmentBase::EnvironmentSnapshotConstPtr psnapshot = GetEnv()->GetPublishedSnapshot();
+            if( psnapshot != _psnapshot ) {
+                _psnapshot = psnapshot;
+                _Write(*psnapshot);
+            }
+            _cond.timed_wait(lock, boost::posix_time::microseconds((int64_t)(_fPeriod*1e6)));
+        }
+    }
+
+    /// \brief fills _vdata with the records of the snapshot and copies them inside the seqlock
+    void _Write(const EnvironmentBase::EnvironmentSnapshot& snapshot)
+    {
+        _vdata.resize(0);
+        FOREACHC(itstate, snapshot.vbodies) {
+            _AppendBody(**itstate, _vdata);
+        }
+        if( _vdata.size() > _pheader->capacity ) {
+            if( !_bWarnedCapacity ) {
+                RAVELOG_WARN_FORMAT("env=%d, %d bytes of bodies do not fit in shared memory %s of %d bytes", GetEnv()->GetId()%_vdata.size()%_name%_pheader->capacity);
+                _bWarnedCapacity = true;
+            }
+            return;
+        }
+        uint64_t sequence = _pheader->sequence.load(std::memory_order_relaxed);
+        _pheader->sequence.store(sequence+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _pheader->numbodies = snapshot.vbodies.size();
+        _pheader->datasize = _vdata.size();
+        _pheader->simulationtime = snapshot.simulationtime;
+        _pheader->bodiesmodifiedstamp = snapshot.bodiesmodifiedstamp;
+        if( _vdata.size() > 0 ) {
+            std::memcpy(reinterpret_cast<uint8_t*>(_pheader+1), &_vdata[0], _vdata.size());
+        }
+        _pheader->sequence.store(sequence+2, std::memory_order_release);
+    }
+
+    static void _AppendBody(const KinBody::BodyState& state, std::vector<uint8_t>& vdata)
+    {
+        SharedStateBodyRecord record;
+        record.environmentid = state.environmentid;
+        record.updatestamp = state.updatestamp;
+        record.namelength = state.strname.size();
+        record.numlinks = state.vectrans.size();
+        record.numdofs = state.jointvalues.size();
+        record.reserved = 0;
+        size_t namesize = (state.strname.size()+7)&~(size_t)7;
+        size_t offset = vdata.size();
+        vdata.resize(offset + sizeof(record) + namesize + sizeof(double)*(7*record.numlinks+record.numdofs), 0);
+        uint8_t* p = &vdata[offset];
+        std::memcpy(p, &record, sizeof(record));
+        p += sizeof(record);
+        std::memcpy(p, state.strname.c_str(), state.strname.size());
+        p += namesize;
+        double* pvalues = reinterpret_cast<double*>(p);
+        FOREACHC(ittrans, state.vectrans) {
+            *pvalues++ = ittrans->rot.x;
+            *pvalues++ = ittrans->rot.y;
+            *pvalues++ = ittrans->rot.z;
+            *pvalues++ = ittrans->rot.w;
+            *pvalues++ = ittrans->trans.x;
+            *pvalues++ = ittrans->trans.y;
+            *pvalues++ = ittrans->trans.z;
+        }
+        FOREACHC(itvalue, state.jointvalues) {
+            *pvalues++ = *itvalue;
+        }
+    }
+
+    std::string _name;
+    boost::shared_ptr<boost::interprocess::mapped_region> _region;
+    SharedStateHeader* _pheader; ///< in _region
+    dReal _fPeriod; ///< seconds between checks for a new snapshot
+    EnvironmentBase::EnvironmentSnapshotConstPtr _psnapshot; ///< the last written snapshot
+    std::vector<uint8_t> _vdata; ///< cache for _Write
+    boost::shared_ptr<boost::thread> _pthread;
+    boost::mutex _mutex;
+    boost::condition _cond;
+    bool _bShutdown;
+    bool _bWarnedCapacity;
+};
+
+/// \brief keeps the bodies of the environment at the poses written by a SharedStatePublisher of another process on the same host.
+///
+/// Bodies are matched by name and only updated when their update stamp in the shared memory changed, bodies that are not in
+/// the environment or have a different number of links or dofs are skipped. The published bodies of the environment are updated
+/// after every change. Start with "name [period]".
+class SharedStateReader : public ModuleBase
+{
+public:
+    SharedStateReader(EnvironmentBasePtr penv) : ModuleBase(penv), _pheader(NULL), _fPeriod(0.001), _bShutdown(false), _nAppliedSequence(0), _nBodiesModifiedStamp(0), _nNumApplied(0)
+    {
+        __description = ":Interface Author: agent\n\nUpdates the bodies of the environment from the shared memory of a sharedstatepublisher module of another process. Start with \"name [period]\".";
+        RegisterCommand("GetStatus",boost::bind(&SharedStateReader::_GetStatusCommand,this,_1,_2),
+                        "returns 1 if the shared memory is open, the last applied sequence and the number of body updates applied so far");
+    }
+
+    virtual ~SharedStateReader() {
+        Destroy();
+    }
+
+    virtual int main(const std::string& cmd)
+    {
+        Destroy();
+        _fPeriod = 0.001;
+        stringstream ss(cmd);
+        ss >> _name >> _fPeriod;
+        if( _name.size() == 0 ) {
+            RAVELOG_WARN("sharedstatereader needs the name of the shared memory\n");
+            return -1;
+        }
+        _bShutdown = false;
+        _pthread.reset(new boost::thread(boost::bind(&SharedStateReader::_ReadThread, this)));
+        return 0;
+    }
+
+    virtual void Destroy()
+    {
+        if( !!_pthread ) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                _bShutdown = true;
+                _cond.notify_all();
+            }
+            _pthread->join();
+            _pthread.reset();
+        }
+        _Close();
+        _mapAppliedStamps.clear();
+    }
+
+private:
+    bool _GetStatusCommand(ostream& sout, istream& sinput)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        sout << (!!_pheader) << " " << _nAppliedSequence << " " << _nNumApplied;
+        return true;
+    }
+
+    /// \brief maps the shared memory, the publisher might not have created it yet. _mutex should be locked
+    bool _Open()
+    {
+        try {
+            boost::interprocess::shared_memory_object shm(boost::interprocess::open_only, _name.c_str(), boost::interprocess::read_only);
+            _region.reset(new boost::interprocess::mapped_region(shm, boost::interprocess::read_only));
+        }
+        catch(const boost::interprocess::interprocess_exception& ex) {
+            _region.reset();
+            return false;
+        }
+        const SharedStateHeader* pheader = static_cast<const SharedStateHeader*>(_region->get_address());
+        if( _region->get_size() < sizeof(SharedStateHeader) || pheader->magic != SharedStateHeader::s_nMagic || pheader->version != SharedStateHeader::s_nVersion || pheader->capacity > _region->get_size()-sizeof(SharedStateHeader) ) {
+            RAVELOG_WARN_FORMAT("env=%d, shared memory %s was not written by a compatible sharedstatepublisher", GetEnv()->GetId()%_name);
+            _region.reset();
+            return false;
+        }
+        _pheader = pheader;
+        _nAppliedSequence = 0;
+        RAVELOG_DEBUG_FORMAT("env=%d, reading bodies from shared memory %s", GetEnv()->GetId()%_name);
+        return true;
+    }
+
+    void _Close()
+    {
+        _pheader = NULL;
+        _region.reset();
+    }
+
+    void _ReadThread()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        while( !_bShutdown ) {
+            if( !!_pheader && _pheader->closed.load(std::memory_order_acquire) ) {
+                // the publisher removed the segment, wait for the next one
+                _Close();
+            }
+            if( !!_pheader || _Open() ) {
+                if( _Read() ) {
+                    _Apply();
+                }
+            }
+            _cond.timed_wait(lock, boost::posix_time::microseconds((int64_t)(_fPeriod*1e6)));
+        }
+    }
+
+    /// \brief copies the records to _vdata if the publisher wrote since the last read
+    /// \return true if _vdata holds a consistent new write
+    bool _Read()
+    {
+        for(int itry = 0; itry < 100; ++itry) {
+            uint64_t sequence = _pheader->sequence.load(std::memory_order_acquire);
+            if( sequence == _nAppliedSequence ) {
+                return false;
+            }
+            if( sequence & 1 ) {
+                boost::this_thread::yield();
+                continue;
+            }
+            uint64_t datasize = _pheader->datasize;
+            if( datasize > _pheader->capacity ) {
+                continue;
+            }
+            _vdata.resize(datasize);
+            if( datasize > 0 ) {
+                std::memcpy(&_vdata[0], reinterpret_cast<const uint8_t*>(_pheader+1), datasize);
+            }
+            _nNumBodies = _pheader->numbodies;
+            int bodiesmodifiedstamp = _pheader->bodiesmodifiedstamp;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if( _pheader->sequence.load(std::memory_order_relaxed) == sequence ) {
+                _nAppliedSequence = sequence;
+                if( bodiesmodifiedstamp != _nBodiesModifiedStamp ) {
+                    // bodies were added or removed, names can refer to different bodies
+                    _mapAppliedStamps.clear();
+                    _nBodiesModifiedStamp = bodiesmodifiedstamp;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief sets the bodies of the environment to the records of _vdata
+    void _Apply()
+    {
+        EnvironmentMutex::scoped_lock lockenv(GetEnv()->GetMutex());
+        std::vector<Transform> vtrans;
+        std::vector<dReal> vdofvalues;
+        bool bChanged = false;
+        const uint8_t* p = _vdata.size() > 0 ? &_vdata[0] : NULL;
+        const uint8_t* pend = p + _vdata.size();
+        for(uint32_t ibody = 0; ibody < _nNumBodies; ++ibody) {
+            SharedStateBodyRecord record;
+            if( p + sizeof(record) > pend ) {
+                break;
+            }
+            std::memcpy(&record, p, sizeof(record));
+            p += sizeof(record);
+            size_t namesize = (record.namelength+7)&~(size_t)7;
+            size_t valuessize = sizeof(double)*(7*(size_t)record.numlinks+record.numdofs);
+            if( p + namesize + valuessize > pend ) {
+                RAVELOG_WARN_FORMAT("env=%d, shared memory %s has invalid body records", GetEnv()->GetId()%_name);
+                break;
+            }
+            std::string name(reinterpret_cast<const char*>(p), record.namelength);
+            p += namesize;
+            const double* pvalues = reinterpret_cast<const double*>(p);
+            p += valuessize;
+
+            std::map<std::string, int>::iterator itstamp = _mapAppliedStamps.find(name);
+            if( itstamp != _mapAppliedStamps.end() && itstamp->second == record.updatestamp ) {
+                continue;
+            }
+            KinBodyPtr pbody = GetEnv()->GetKinBody(name);
+            if( !pbody || pbody->GetLinks().size() != record.numlinks || pbody->GetDOF() != (int)record.numdofs ) {
+                continue;
+            }
+            vtrans.resize(record.numlinks);
+            FOREACH(ittrans, vtrans) {
+                ittrans->rot.x = pvalues[0];
+                ittrans->rot.y = pvalues[1];
+                ittrans->rot.z = pvalues[2];
+                ittrans->rot.w = pvalues[3];
+                ittrans->trans.x = pvalues[4];
+                ittrans->trans.y = pvalues[5];
+                ittrans->trans.z = pvalues[6];
+                pvalues += 7;
+            }
+            vdofvalues.resize(record.numdofs);
+            FOREACH(itvalue, vdofvalues) {
+                *itvalue = *pvalues++;
+            }
+            pbody->SetLinkTransformations(vtrans, vdofvalues);
+            _mapAppliedStamps[name] = record.updatestamp;
+            ++_nNumApplied;
+            bChanged = true;
+        }
+        if( bChanged ) {
+            GetEnv()->UpdatePublishedBodies();
+        }
+    }
+
+    std::string _name;
+    boost::shared_ptr<boost::interprocess::mapped_region> _region;
+    const SharedStateHeader* _pheader; ///< in _region, NULL while the shared memory is not open
+    dReal _fPeriod; ///< seconds between checks for a new write
+    boost::shared_ptr<boost::thread> _pthread;
+    boost::mutex _mutex;
+    boost::condition _cond;
+    bool _bShutdown;
+    uint64_t _nAppliedSequence; ///< sequence of the last read write
+    int _nBodiesModifiedStamp; ///< bodiesmodifiedstamp of the last read write
+    uint32_t _nNumBodies; ///< number of records in _vdata
+    uint64_t _nNumApplied;
+    std::vector<uint8_t> _vdata; ///< copy of the records of the last read write
+    std::map<std::string, int> _mapAppliedStamps; ///< body name to the update stamp of the record last applied to it
+};
+
+#endif
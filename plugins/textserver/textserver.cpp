@@ -15,6 +15,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "plugindefs.h"
 #include "textserver.h"
+#include "planningserver.h"
+#include "planningcoordinator.h"
+#include "sharedstate.h"
 #include <openrave/plugin.h>
 
 InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string& interfacename, std::istream& sinput, EnvironmentBasePtr penv)
@@ -23,6 +26,14 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
     case OpenRAVE::PT_Module:
         if( interfacename == "textserver")
             return InterfaceBasePtr(new SimpleTextServer(penv));
+        else if( interfacename == "planningserver")
+            return InterfaceBasePtr(new PlanningServer(penv));
+        else if( interfacename == "planningcoordinator")
+            return InterfaceBasePtr(new PlanningCoordinator(penv));
+        else if( interfacename == "sharedstatepublisher")
+            return InterfaceBasePtr(new SharedStatePublisher(penv));
+        else if( interfacename == "sharedstatereader")
+            return InterfaceBasePtr(new SharedStateReader(penv));
         break;
     default:
         break;
@@ -33,6 +44,10 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
 void GetPluginAttributesValidated(PLUGININFO& info)
 {
     info.interfacenames[OpenRAVE::PT_Module].push_back("textserver");
+    info.interfacenames[OpenRAVE::PT_Module].push_back("planningserver");
+    info.interfacenames[OpenRAVE::PT_Module].push_back("planningcoordinator");
+    info.interfacenames[OpenRAVE::PT_Module].push_back("sharedstatepublisher");
+    info.interfacenames[OpenRAVE::PT_Module].push_back("sharedstatereader");
 }
 
 OPENRAVE_PLUGIN_API void DestroyPlugin()
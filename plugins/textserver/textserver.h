@@ -18,6 +18,7 @@
 #define OPENRAVE_TEXTSERVER
 
 #include <openrave/planningutils.h>
+#include <openrave/utils.h>
 #include <cstdlib>
 
 #ifndef _WIN32
@@ -38,10 +39,18 @@
 typedef int socklen_t;
 #else
 #include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
 #define CLOSESOCKET close
 #endif
 
-/// manages all connections. At the moment, server can handle only one connectino at a time
+#include <deque>
+
+/// manages all connections.
+///
+/// On posix systems, one thread polls all the sockets and a fixed pool of threads runs the commands, the commands of one connection are run in the order they were received.
+/// On windows, every connection is read by its own thread.
 class SimpleTextServer : public ModuleBase
 {
     // socket just accepts connections
@@ -249,6 +258,14 @@ private:
     /// \param boost::shared_ptr<void> is a pointer to a void that willl be passed to the worker thread function
     typedef boost::function<bool (istream&, ostream&, boost::shared_ptr<void>&)> OpenRaveNetworkFn;
     typedef boost::function<bool (boost::shared_ptr<istream>, boost::shared_ptr<void>)> OpenRaveWorkerFn;
+    /// \param pdata, size the payload of a binary request
+    /// \param sout the payload of the response
+    typedef boost::function<bool (const char*, size_t, string&)> OpenRaveBinaryFn;
+#ifndef _WIN32
+    struct Connection;
+    /// \brief a command changing the state of the connection it was received on, the uint32_t is the request id on binary connections
+    typedef boost::function<bool (boost::shared_ptr<Connection>, uint32_t, istream&)> OpenRaveConnectionFn;
+#endif
 
     /// each network function has a function to intially processes the data on the socket function
     /// and one that is executed on the main worker thread to avoid multithreading data synchronization issues
@@ -268,9 +285,16 @@ public:
     SimpleTextServer(EnvironmentBasePtr penv) : ModuleBase(penv) {
         _nIdIndex = 1;
         _nNextFigureId = 1;
+        _nNumPoolThreads = 4;
         _bWorking = false;
         bDestroying = false;
-        __description=":Interface Author: Rosen Diankov\n\nSimple text-based server using sockets.";
+        bInitThread = false;
+        bCloseThread = false;
+        server_sockfd = 0;
+#ifndef _WIN32
+        _wakeupfds[0] = _wakeupfds[1] = -1;
+#endif
+        __description=":Interface Author: Rosen Diankov\n\nSimple text-based server using sockets. Start it with \"port [numthreads]\", numthreads is the number of threads running the commands of the connections (default 4).";
         mapNetworkFns["body_checkcollision"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvCheckCollision, this, _1, _2, _3), OpenRaveWorkerFn(), true);
         mapNetworkFns["body_getjoints"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBodyGetJointValues, this,_1, _2, _3), OpenRaveWorkerFn(), true);
         mapNetworkFns["body_destroy"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orBodyDestroy,this,_1,_2,_3), OpenRaveWorkerFn(), false);
@@ -290,6 +314,10 @@ public:
         mapNetworkFns["env_getbodies"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvGetBodies,this,_1,_2,_3), OpenRaveWorkerFn(), true);
         mapNetworkFns["env_getrobots"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvGetRobots,this,_1,_2,_3), OpenRaveWorkerFn(), true);
         mapNetworkFns["env_getbody"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvGetBody,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+        mapNetworkFns["env_checkcollisions"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvCheckCollisions,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+        mapNetworkFns["env_getbodyaabbs"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvGetBodyAABBs,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+        mapNetworkFns["env_setbodyjoints"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvSetBodyJoints,this,_1,_2,_3), OpenRaveWorkerFn(), false);
+        mapNetworkFns["env_setbodytransforms"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvSetBodyTransforms,this,_1,_2,_3), OpenRaveWorkerFn(), false);
         mapNetworkFns["env_loadplugin"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvLoadPlugin,this,_1,_2,_3), OpenRaveWorkerFn(), true);
         mapNetworkFns["env_raycollision"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvRayCollision,this,_1,_2,_3), OpenRaveWorkerFn(), true);
         mapNetworkFns["env_stepsimulation"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvStepSimulation,this,_1,_2,_3), boost::bind(&SimpleTextServer::worEnvStepSimulation,this,_1,_2), false);
@@ -316,6 +344,19 @@ public:
         mapNetworkFns["setoptions"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvSetOptions,this,_1,_2,_3), boost::bind(&SimpleTextServer::worSetOptions,this,_1,_2), false);
         mapNetworkFns["test"] = RAVENETWORKFN(OpenRaveNetworkFn(), OpenRaveWorkerFn(), false);
         mapNetworkFns["wait"] = RAVENETWORKFN(boost::bind(&SimpleTextServer::orEnvWait,this,_1,_2,_3), OpenRaveWorkerFn(), true);
+#ifndef _WIN32
+        // commands of the binary protocol with raw payloads, the other commands take their text arguments
+        mapBinaryFns["body_setjoints"] = boost::bind(&SimpleTextServer::borBodySetJointValues,this,_1,_2,_3);
+        mapBinaryFns["body_getjoints"] = boost::bind(&SimpleTextServer::borBodyGetJointValues,this,_1,_2,_3,false);
+        mapBinaryFns["robot_getdofvalues"] = boost::bind(&SimpleTextServer::borBodyGetJointValues,this,_1,_2,_3,true);
+        mapBinaryFns["body_settransform"] = boost::bind(&SimpleTextServer::borKinBodySetTransform,this,_1,_2,_3);
+        mapBinaryFns["body_getaabb"] = boost::bind(&SimpleTextServer::borBodyGetAABBs,this,_1,_2,_3,false);
+        mapBinaryFns["body_getaabbs"] = boost::bind(&SimpleTextServer::borBodyGetAABBs,this,_1,_2,_3,true);
+        mapBinaryFns["env_setbodyjoints"] = boost::bind(&SimpleTextServer::borEnvSetBodyJoints,this,_1,_2,_3);
+        mapBinaryFns["env_setbodytransforms"] = boost::bind(&SimpleTextServer::borEnvSetBodyTransforms,this,_1,_2,_3);
+        mapConnectionFns["env_subscribe"] = boost::bind(&SimpleTextServer::orEnvSubscribe,this,_1,_2,_3);
+        mapConnectionFns["env_unsubscribe"] = boost::bind(&SimpleTextServer::orEnvUnsubscribe,this,_1,_2,_3);
+#endif
 
         string logfilename = RaveGetHomeDirectory() + string("/textserver.log");
         flog.open(logfilename.c_str());
@@ -332,6 +373,10 @@ public:
         _nPort = 4765;
         stringstream ss(cmd);
         ss >> _nPort;
+        int nNumPoolThreads = 0;
+        if( ss >> nNumPoolThreads ) {
+            _nNumPoolThreads = max(1, nNumPoolThreads);
+        }
 
         Destroy();
 
@@ -369,7 +414,7 @@ public:
             return -1;
         }
 
-        err = ::listen(server_sockfd, 16);
+        err = ::listen(server_sockfd, 128);
         if( err ) {
             RAVELOG_ERROR("failed to listen to server port %d, error=%d\n", _nPort, err);
             return -1;
@@ -401,7 +446,21 @@ public:
 #endif
 
         RAVELOG_DEBUG("text server listening on port %d\n",_nPort);
+#ifdef _WIN32
         _servthread.reset(new boost::thread(boost::bind(&SimpleTextServer::_listen_threadcb,this)));
+#else
+        if( pipe(_wakeupfds) != 0 ) {
+            RAVELOG_ERROR("failed to create the wakeup pipe of the server\n");
+            CLOSESOCKET(server_sockfd); server_sockfd = 0;
+            return -1;
+        }
+        fcntl(_wakeupfds[0], F_SETFL, fcntl(_wakeupfds[0], F_GETFL, 0) | O_NONBLOCK);
+        fcntl(_wakeupfds[1], F_SETFL, fcntl(_wakeupfds[1], F_GETFL, 0) | O_NONBLOCK);
+        _servthread.reset(new boost::thread(boost::bind(&SimpleTextServer::_eventloop_threadcb,this)));
+        for(int ithread = 0; ithread < _nNumPoolThreads; ++ithread) {
+            _listReadThreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&SimpleTextServer::_pool_threadcb,this))));
+        }
+#endif
         _workerthread.reset(new boost::thread(boost::bind(&SimpleTextServer::_worker_threadcb,this)));
         bInitThread = true;
         return 0;
@@ -424,6 +483,13 @@ public:
         if( bInitThread ) {
             bCloseThread = true;
             _condWorker.notify_all();
+#ifndef _WIN32
+            _WakeEventLoop();
+            {
+                boost::mutex::scoped_lock lock(_mutexConnections);
+                _condConnectionReady.notify_all();
+            }
+#endif
             if( !!_servthread ) {
                 _servthread->join();
             }
@@ -431,9 +497,28 @@ public:
 
             FOREACH(it, _listReadThreads) {
                 _condWorker.notify_all();
+#ifndef _WIN32
+                {
+                    boost::mutex::scoped_lock lock(_mutexConnections);
+                    _condConnectionReady.notify_all();
+                }
+#endif
                 (*it)->join();
             }
             _listReadThreads.clear();
+#ifndef _WIN32
+            FOREACH(itconnection, _listConnections) {
+                CLOSESOCKET((*itconnection)->sockfd);
+            }
+            _listConnections.clear();
+            _listReadyConnections.clear();
+            for(int i = 0; i < 2; ++i) {
+                if( _wakeupfds[i] >= 0 ) {
+                    close(_wakeupfds[i]);
+                    _wakeupfds[i] = -1;
+                }
+            }
+#endif
             _condHasWork.notify_all();
             if( !!_workerthread ) {
                 _workerthread->join();
@@ -556,95 +641,849 @@ private:
     void _read_threadcb(SocketPtr psocket)
     {
         RAVELOG_VERBOSE("started new server connection\n");
-        string cmd, line;
-        stringstream sout;
+        string line;
         while(!bCloseThread) {
             if( psocket->ReadLine(line) && line.length() ) {
+                _ProcessLine(line, boost::bind(&Socket::SendData, psocket, _1, _2));
+            }
+            else if( !psocket->IsInit() ) {
+                break;
+            }
+            usleep(1000);
+        }
+
+        RAVELOG_VERBOSE("Closing socket connection\n");
+    }
+
+    /// \brief runs the command of one line received from a client
+    ///
+    /// \param fnsend sends the data back to the client, every call is one message prefixed with its size
+    /// \return false if the command is unknown or failed
+    bool _ProcessLine(const string& line, const boost::function<void(const void*, int)>& fnsend)
+    {
+        if( !!flog &&( GetEnv()->GetDebugLevel()>0) ) {
+            static int index=0;
+            flog << index++ << ": " << line << endl;
+        }
+
+        string cmd;
+        boost::shared_ptr<istream> is(new stringstream(line));
+        *is >> cmd;
+        if( !*is ) {
+            RAVELOG_ERROR("Failed to get command\n");
+            fnsend("error\n",1);
+            return false;
+        }
+        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+        stringstream::streampos inputpos = is->tellg();
+
+        map<string, RAVENETWORKFN>::iterator itfn = mapNetworkFns.find(cmd);
+        if( itfn != mapNetworkFns.end() ) {
+            bool bCallWorker = true;
+            boost::shared_ptr<void> pdata;
 
-                if( !!flog &&( GetEnv()->GetDebugLevel()>0) ) {
-                    static int index=0;
-                    flog << index++ << ": " << line << endl;
+            // need to set w.args before pcmdend is modified
+            stringstream sout;
+            if( !!itfn->second.fnSocketThread ) {
+                bool bSuccess = false;
+                try {
+                    bSuccess = itfn->second.fnSocketThread(*is, sout, pdata);
+                }
+                catch(const std::exception& ex) {
+                    RAVELOG_FATAL("server caught exception: %s\n",ex.what());
+                }
+                catch(...) {
+                    RAVELOG_FATAL("unknown exception!!\n");
                 }
 
-                boost::shared_ptr<istream> is(new stringstream(line));
-                *is >> cmd;
-                if( !*is ) {
-                    RAVELOG_ERROR("Failed to get command\n");
-                    psocket->SendData("error\n",1);
-                    continue;
+                if( bSuccess ) {
+                    if( itfn->second.bReturnResult ) {
+                        fnsend(sout.str().c_str(), sout.str().size());
+                    }
+                    if( !itfn->second.fnWorker ) {
+                        bCallWorker = false;
+                    }
                 }
-                std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
-                stringstream::streampos inputpos = is->tellg();
-
-                map<string, RAVENETWORKFN>::iterator itfn = mapNetworkFns.find(cmd);
-                if( itfn != mapNetworkFns.end() ) {
-                    bool bCallWorker = true;
-                    boost::shared_ptr<void> pdata;
-
-                    // need to set w.args before pcmdend is modified
-                    sout.str(""); sout.clear();
-                    if( !!itfn->second.fnSocketThread ) {
-                        bool bSuccess = false;
-                        try {
-                            bSuccess = itfn->second.fnSocketThread(*is, sout, pdata);
-                        }
-                        catch(const std::exception& ex) {
-                            RAVELOG_FATAL("server caught exception: %s\n",ex.what());
-                        }
-                        catch(...) {
-                            RAVELOG_FATAL("unknown exception!!\n");
+                else {
+                    bCallWorker = false;
+                    if( !!flog  ) {
+                        flog << " error" << endl;
+                    }
+                    if( itfn->second.bReturnResult ) {
+                        fnsend("error\n", 6);
+                    }
+                    return false;
+                }
+            }
+            else {
+                if( itfn->second.bReturnResult ) {
+                    fnsend(sout.str().c_str(), sout.str().size());     // return dummy
+                }
+                bCallWorker = !!itfn->second.fnWorker;
+            }
+
+            if( bCallWorker ) {
+                BOOST_ASSERT(!!itfn->second.fnWorker);
+                is->clear();
+                is->seekg(inputpos);
+                ScheduleWorker(boost::bind(itfn->second.fnWorker,is,pdata));
+            }
+            return true;
+        }
+        else {
+            RAVELOG_ERROR("Failed to recognize command: %s\n", cmd.c_str());
+            fnsend("error\n",1);
+            return false;
+        }
+    }
+
+#ifndef _WIN32
+    /// \brief a client connection served by the event loop
+    ///
+    /// A connection starts with the text protocol. After the client sends the line "binary", every request is a binary frame, see \ref _ProcessBinaryRequest.
+    struct Connection
+    {
+        Connection(int sockfd) : sockfd(sockfd), bBinary(false), numtextlines(0), outputoffset(0), bProcessing(false), bClosed(false), subscriptionperiod(0), nextpublishtime(0), subscriptionrequestid(0) {
+        }
+        int sockfd; ///< only used by the event loop thread
+        string sinput; ///< received bytes of an incomplete line or frame, only used by the event loop thread
+        bool bBinary; ///< true if the connection switched to the binary protocol, only changed by the event loop thread before the binary frames are queued
+        boost::mutex mutex; ///< protects the members below
+        std::deque<string> listlines; ///< received lines or binary frames (without their size) waiting for their command to run
+        size_t numtextlines; ///< when bBinary is set, the number of text lines received before the switch at the front of listlines
+        string soutput; ///< framed messages waiting to be sent
+        size_t outputoffset; ///< the bytes of soutput that were sent already
+        bool bProcessing; ///< text protocol only, true if the connection is in _listReadyConnections or a pool thread runs one of its lines
+        bool bClosed; ///< set by the event loop when the socket is closed, the remaining lines are dropped
+
+        uint64_t subscriptionperiod; ///< microseconds between the pushed updates of env_subscribe, 0 if not subscribed
+        uint64_t nextpublishtime; ///< when the event loop checks the published bodies for this connection next
+        uint32_t subscriptionrequestid; ///< binary protocol only, the request id of the pushed updates
+        std::set<int> setsubscribedbodyids; ///< the environment ids of the subscribed bodies, all bodies if empty
+        std::map<int, int> mapsentupdatestamps; ///< the update stamps of the body states that were pushed last
+        EnvironmentBase::EnvironmentSnapshotConstPtr psentsnapshot; ///< the snapshot that was pushed last
+    };
+    typedef boost::shared_ptr<Connection> ConnectionPtr;
+
+    static const size_t s_nMaxPendingLines = 64; ///< stop reading from a connection while this many lines wait for their command
+    static const size_t s_nMaxPendingOutput = 16*1024*1024; ///< stop reading from a connection while this many bytes wait to be sent to the client
+    static const uint32_t s_nMaxBinaryFrameSize = 64*1024*1024; ///< connections sending bigger binary frames are closed
+
+    /// \brief makes the event loop rebuild its poll set, called when a pool thread queued output or finished the lines of a connection
+    void _WakeEventLoop()
+    {
+        if( _wakeupfds[1] >= 0 ) {
+            char c = 0;
+            if( write(_wakeupfds[1], &c, 1) < 0 ) {
+                // the pipe is full, so the event loop wakes up anyway
+            }
+        }
+    }
+
+    /// \brief frames the data like Socket::SendData and queues it on the connection
+    void _QueueOutput(ConnectionPtr pconnection, const void* pdata, int size)
+    {
+        boost::mutex::scoped_lock lock(pconnection->mutex);
+        if( pconnection->bClosed ) {
+            return;
+        }
+        pconnection->soutput.append((const char*)&size, 4);
+        pconnection->soutput.append((const char*)pdata, size);
+    }
+
+    /// \brief the payload of a binary request, all values are in the byte order of the server
+    class BinaryReader
+    {
+public:
+        BinaryReader(const char* pdata, size_t size) : _pdata(pdata), _size(size), _offset(0) {
+        }
+
+        template <typename T>
+        bool Read(T& value)
+        {
+            if( _offset + sizeof(T) > _size ) {
+                return false;
+            }
+            memcpy(&value, _pdata + _offset, sizeof(T));
+            _offset += sizeof(T);
+            return true;
+        }
+
+        size_t GetRemaining() const {
+            return _size - _offset;
+        }
+
+private:
+        const char* _pdata;
+        size_t _size, _offset;
+    };
+
+    template <typename T>
+    static void _AppendBinary(string& s, const T& value)
+    {
+        s.append((const char*)&value, sizeof(T));
+    }
+
+    /// \brief queues the response frame of a binary request: uint32 size, uint32 requestid, uint8 status (1 success, 0 error), payload
+    void _QueueBinaryOutput(ConnectionPtr pconnection, uint32_t requestid, bool bsuccess, const string& payload)
+    {
+        boost::mutex::scoped_lock lock(pconnection->mutex);
+        if( pconnection->bClosed ) {
+            return;
+        }
+        uint32_t framesize = 5 + payload.size();
+        _AppendBinary(pconnection->soutput, framesize);
+        _AppendBinary(pconnection->soutput, requestid);
+        _AppendBinary(pconnection->soutput, (uint8_t)bsuccess);
+        pconnection->soutput.append(payload);
+    }
+
+    static void _AppendToString(string* pout, const void* pdata, int size)
+    {
+        pout->append((const char*)pdata, size);
+    }
+
+    /// \brief runs one binary request and queues its response
+    ///
+    /// A request frame is uint32 size (of the rest of the frame), uint32 requestid, uint8 length of the command name, the command name and the payload.
+    /// Every request gets a response with the same requestid. The requests of one connection run in parallel, so the responses can come in any order.
+    /// The commands of mapBinaryFns take raw payloads, see their descriptions. For all the other commands the payload is the text of the arguments and
+    /// the response payload is the text result.
+    void _ProcessBinaryRequest(ConnectionPtr pconnection, const string& frame)
+    {
+        BinaryReader reader(frame.c_str(), frame.size());
+        uint32_t requestid = 0;
+        uint8_t cmdlength = 0;
+        if( !reader.Read(requestid) || !reader.Read(cmdlength) || reader.GetRemaining() < cmdlength ) {
+            RAVELOG_ERROR("Failed to get the command of a binary request\n");
+            _QueueBinaryOutput(pconnection, requestid, false, string());
+            return;
+        }
+        string cmd = frame.substr(5, cmdlength);
+        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+        const char* ppayload = frame.c_str() + 5 + cmdlength;
+        size_t payloadsize = frame.size() - 5 - cmdlength;
+
+        string sout;
+        bool bSuccess = false;
+        map<string, OpenRaveBinaryFn>::iterator itfn = mapBinaryFns.find(cmd);
+        if( itfn != mapBinaryFns.end() ) {
+            try {
+                bSuccess = itfn->second(ppayload, payloadsize, sout);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_FATAL("server caught exception: %s\n",ex.what());
+            }
+            catch(...) {
+                RAVELOG_FATAL("unknown exception!!\n");
+            }
+        }
+        else {
+            string line = cmd;
+            line.push_back(' ');
+            line.append(ppayload, payloadsize);
+            bSuccess = _ProcessConnectionLine(pconnection, requestid, line, boost::bind(&SimpleTextServer::_AppendToString, &sout, _1, _2));
+        }
+        if( !bSuccess ) {
+            sout.resize(0);
+        }
+        _QueueBinaryOutput(pconnection, requestid, bSuccess, sout);
+    }
+
+    /// int32 bodyid, uint32 num, num float64 values, optionally num int32 dof indices. Same as body_setjoints.
+    bool borBodySetJointValues(const char* pdata, size_t size, string& sout)
+    {
+        BinaryReader reader(pdata, size);
+        int32_t bodyid = 0;
+        uint32_t num = 0;
+        if( !reader.Read(bodyid) || !reader.Read(num) || num == 0 || reader.GetRemaining() < num*sizeof(double) ) {
+            return false;
+        }
+        vector<dReal> vvalues(num);
+        vector<int> vindices;
+        for(uint32_t i = 0; i < num; ++i) {
+            double f = 0;
+            reader.Read(f);
+            vvalues[i] = f;
+        }
+        if( reader.GetRemaining() > 0 ) {
+            if( reader.GetRemaining() != num*sizeof(int32_t) ) {
+                RAVELOG_WARN(str(boost::format("incorrect number of indices %d, ignoring")%num));
+                return false;
+            }
+            vindices.resize(num);
+            for(uint32_t i = 0; i < num; ++i) {
+                int32_t index = 0;
+                reader.Read(index);
+                vindices[i] = index;
+            }
+        }
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(bodyid);
+        if( !pbody ) {
+            return false;
+        }
+        return _SetBodyJointValues(pbody, vvalues, vindices);
+    }
+
+    /// int32 bodyid, optionally int32 dof indices. Returns float64 values. Same as body_getjoints, or robot_getdofvalues when bActive is true.
+    bool borBodyGetJointValues(const char* pdata, size_t size, string& sout, bool bActive)
+    {
+        BinaryReader reader(pdata, size);
+        int32_t bodyid = 0;
+        if( !reader.Read(bodyid) ) {
+            return false;
+        }
+        vector<int> vindices(reader.GetRemaining()/sizeof(int32_t));
+        for(size_t i = 0; i < vindices.size(); ++i) {
+            int32_t index = 0;
+            reader.Read(index);
+            vindices[i] = index;
+        }
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(bodyid);
+        if( !pbody || (bActive && !pbody->IsRobot()) ) {
+            return false;
+        }
+        vector<dReal> values;
+        if( vindices.size() == 0 && bActive ) {
+            RaveInterfaceCast<RobotBase>(pbody)->GetActiveDOFValues(values);
+        }
+        else {
+            pbody->GetDOFValues(values);
+        }
+        if( vindices.size() == 0 ) {
+            FOREACHC(it, values) {
+                _AppendBinary(sout, (double)*it);
+            }
+        }
+        else {
+            FOREACHC(it, vindices) {
+                if(( *it < 0) ||( *it >= pbody->GetDOF()) ) {
+                    RAVELOG_ERROR("orBodyGetJointValues bad index\n");
+                    return false;
+                }
+                _AppendBinary(sout, (double)values[*it]);
+            }
+        }
+        return true;
+    }
+
+    /// int32 bodyid, 7, 12 or 3 float64 values like body_settransform.
+    bool borKinBodySetTransform(const char* pdata, size_t size, string& sout)
+    {
+        BinaryReader reader(pdata, size);
+        int32_t bodyid = 0;
+        if( !reader.Read(bodyid) || reader.GetRemaining()%sizeof(double) != 0 ) {
+            return false;
+        }
+        vector<dReal> values(reader.GetRemaining()/sizeof(double));
+        for(size_t i = 0; i < values.size(); ++i) {
+            double f = 0;
+            reader.Read(f);
+            values[i] = f;
+        }
+        _SyncWithWorkerThread();
+        return _SetBodyTransform(GetEnv()->GetBodyFromEnvironmentId(bodyid), values);
+    }
+
+    /// int32 bodyid. Returns 6 float64 values pos and extents for the body like body_getaabb, or for every link like body_getaabbs when bLinks is true.
+    bool borBodyGetAABBs(const char* pdata, size_t size, string& sout, bool bLinks)
+    {
+        BinaryReader reader(pdata, size);
+        int32_t bodyid = 0;
+        if( !reader.Read(bodyid) ) {
+            return false;
+        }
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(bodyid);
+        if( !pbody ) {
+            return false;
+        }
+        std::vector<AABB> vaabbs;
+        if( bLinks ) {
+            FOREACHC(itlink, pbody->GetLinks()) {
+                vaabbs.push_back((*itlink)->ComputeAABB());
+            }
+        }
+        else {
+            vaabbs.push_back(pbody->ComputeAABB());
+        }
+        FOREACHC(itab, vaabbs) {
+            for(int i = 0; i < 3; ++i) {
+                _AppendBinary(sout, (double)itab->pos[i]);
+            }
+            for(int i = 0; i < 3; ++i) {
+                _AppendBinary(sout, (double)itab->extents[i]);
+            }
+        }
+        return true;
+    }
+
+    /// \brief reads uint32 num and num float64 values
+    static bool _ReadBinaryValues(BinaryReader& reader, vector<dReal>& values)
+    {
+        uint32_t num = 0;
+        if( !reader.Read(num) || reader.GetRemaining() < num*sizeof(double) ) {
+            return false;
+        }
+        values.resize(num);
+        for(uint32_t i = 0; i < num; ++i) {
+            double f = 0;
+            reader.Read(f);
+            values[i] = f;
+        }
+        return true;
+    }
+
+    /// uint32 num, [int32 bodyid, uint32 numvalues, numvalues float64 values]*. Same as env_setbodytransforms.
+    bool borEnvSetBodyTransforms(const char* pdata, size_t size, string& sout)
+    {
+        BinaryReader reader(pdata, size);
+        uint32_t num = 0;
+        if( !reader.Read(num) ) {
+            return false;
+        }
+        vector<int> vbodyids;
+        vector< vector<dReal> > vvalues;
+        for(uint32_t ibody = 0; ibody < num; ++ibody) {
+            int32_t bodyid = 0;
+            vvalues.push_back(vector<dReal>());
+            if( !reader.Read(bodyid) || !_ReadBinaryValues(reader, vvalues.back()) ) {
+                return false;
+            }
+            vbodyids.push_back(bodyid);
+        }
+        _SyncWithWorkerThread();
+        return _SetBodyTransforms(vbodyids, vvalues);
+    }
+
+    /// uint32 num, [int32 bodyid, uint32 dof, dof float64 values, uint32 numindices, numindices int32 indices]*, numindices is 0 or dof. Same as env_setbodyjoints.
+    bool borEnvSetBodyJoints(const char* pdata, size_t size, string& sout)
+    {
+        BinaryReader reader(pdata, size);
+        uint32_t num = 0;
+        if( !reader.Read(num) ) {
+            return false;
+        }
+        vector<int> vbodyids;
+        vector< vector<dReal> > vvalues;
+        vector< vector<int> > vindices;
+        for(uint32_t ibody = 0; ibody < num; ++ibody) {
+            int32_t bodyid = 0;
+            uint32_t numindices = 0;
+            vvalues.push_back(vector<dReal>());
+            if( !reader.Read(bodyid) || !_ReadBinaryValues(reader, vvalues.back()) || !reader.Read(numindices) ) {
+                return false;
+            }
+            if( (numindices != 0 && numindices != vvalues.back().size()) || reader.GetRemaining() < numindices*sizeof(int32_t) ) {
+                return false;
+            }
+            vindices.push_back(vector<int>(numindices));
+            for(uint32_t i = 0; i < numindices; ++i) {
+                int32_t index = 0;
+                reader.Read(index);
+                vindices.back()[i] = index;
+            }
+            vbodyids.push_back(bodyid);
+        }
+        _SyncWithWorkerThread();
+        return _SetBodiesJointValues(vbodyids, vvalues, vindices);
+    }
+
+    /// \brief runs the commands of mapConnectionFns that change the state of the connection itself, passes all the other lines to _ProcessLine
+    bool _ProcessConnectionLine(ConnectionPtr pconnection, uint32_t requestid, const string& line, const boost::function<void(const void*, int)>& fnsend)
+    {
+        stringstream is(line);
+        string cmd;
+        is >> cmd;
+        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+        map<string, OpenRaveConnectionFn>::iterator itfn = mapConnectionFns.find(cmd);
+        if( itfn == mapConnectionFns.end() ) {
+            return _ProcessLine(line, fnsend);
+        }
+        if( !itfn->second(pconnection, requestid, is) ) {
+            RAVELOG_ERROR("failed to run %s\n", cmd.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// orEnvSubscribe(period, bodyids) - pushes the changes of the published bodies (see EnvironmentBase::GetPublishedSnapshot) to this connection every period seconds.
+    ///
+    /// Subscribes to all bodies if no ids are given. Every update is one message
+    ///   update simulationtime numchanged [bodyid name dof values rotx roty rotz rotw transx transy transz]* numremoved [bodyid]*
+    /// with the dof values and base link transform (in the order of body_settransform) of the bodies whose state changed since the last update.
+    /// The first update has all subscribed bodies. No message is sent when nothing changed. On binary connections the updates are response frames with the request id of the subscription.
+    bool orEnvSubscribe(ConnectionPtr pconnection, uint32_t requestid, istream& is)
+    {
+        dReal fperiod = 0;
+        is >> fperiod;
+        if( !is || fperiod <= 0 ) {
+            return false;
+        }
+        vector<int> vbodyids = vector<int>((istream_iterator<int>(is)), istream_iterator<int>());
+        boost::mutex::scoped_lock lock(pconnection->mutex);
+        pconnection->subscriptionperiod = max((uint64_t)1, (uint64_t)(fperiod*1000000));
+        pconnection->nextpublishtime = 0;
+        pconnection->subscriptionrequestid = requestid;
+        pconnection->setsubscribedbodyids.clear();
+        pconnection->setsubscribedbodyids.insert(vbodyids.begin(), vbodyids.end());
+        pconnection->mapsentupdatestamps.clear();
+        pconnection->psentsnapshot.reset();
+        return true;
+    }
+
+    /// orEnvUnsubscribe() - stops the updates of env_subscribe
+    bool orEnvUnsubscribe(ConnectionPtr pconnection, uint32_t requestid, istream& is)
+    {
+        boost::mutex::scoped_lock lock(pconnection->mutex);
+        pconnection->subscriptionperiod = 0;
+        pconnection->setsubscribedbodyids.clear();
+        pconnection->mapsentupdatestamps.clear();
+        pconnection->psentsnapshot.reset();
+        return true;
+    }
+
+    /// \brief queues the changes of the snapshot since the last update of the connection, connection.mutex has to be locked
+    void _PublishSnapshot(Connection& connection, EnvironmentBase::EnvironmentSnapshotConstPtr psnapshot)
+    {
+        if( connection.psentsnapshot == psnapshot ) {
+            return;
+        }
+        _vCachedChangedStates.resize(0);
+        _mapCachedUpdateStamps.clear();
+        FOREACHC(itstate, psnapshot->vbodies) {
+            const KinBody::BodyState& state = **itstate;
+            if( connection.setsubscribedbodyids.size() > 0 && connection.setsubscribedbodyids.find(state.environmentid) == connection.setsubscribedbodyids.end() ) {
+                continue;
+            }
+            _mapCachedUpdateStamps[state.environmentid] = state.updatestamp;
+            std::map<int, int>::const_iterator itsent = connection.mapsentupdatestamps.find(state.environmentid);
+            if( itsent == connection.mapsentupdatestamps.end() || itsent->second != state.updatestamp ) {
+                _vCachedChangedStates.push_back(&state);
+            }
+        }
+        _vCachedRemovedIds.resize(0);
+        FOREACHC(itsent, connection.mapsentupdatestamps) {
+            if( _mapCachedUpdateStamps.find(itsent->first) == _mapCachedUpdateStamps.end() ) {
+                _vCachedRemovedIds.push_back(itsent->first);
+            }
+        }
+        connection.psentsnapshot = psnapshot;
+        connection.mapsentupdatestamps.swap(_mapCachedUpdateStamps);
+        if( _vCachedChangedStates.size() == 0 && _vCachedRemovedIds.size() == 0 ) {
+            return;
+        }
+
+        _ssCachedUpdate.str(""); _ssCachedUpdate.clear();
+        _ssCachedUpdate << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        _ssCachedUpdate << "update " << psnapshot->simulationtime << " " << _vCachedChangedStates.size() << " ";
+        FOREACHC(itstate, _vCachedChangedStates) {
+            const KinBody::BodyState& state = **itstate;
+            _ssCachedUpdate << state.environmentid << " " << state.strname << " " << state.jointvalues.size() << " ";
+            FOREACHC(itvalue, state.jointvalues) {
+                _ssCachedUpdate << *itvalue << " ";
+            }
+            Transform t = state.vectrans.size() > 0 ? state.vectrans[0] : Transform();
+            _ssCachedUpdate << t.rot.x << " " << t.rot.y << " " << t.rot.z << " " << t.rot.w << " " << t.trans.x << " " << t.trans.y << " " << t.trans.z << " ";
+        }
+        _ssCachedUpdate << _vCachedRemovedIds.size();
+        FOREACHC(itid, _vCachedRemovedIds) {
+            _ssCachedUpdate << " " << *itid;
+        }
+        _ssCachedUpdate << "\n";
+        string supdate = _ssCachedUpdate.str();
+        if( connection.bBinary ) {
+            uint32_t framesize = 5 + supdate.size();
+            _AppendBinary(connection.soutput, framesize);
+            _AppendBinary(connection.soutput, connection.subscriptionrequestid);
+            _AppendBinary(connection.soutput, (uint8_t)1);
+        }
+        else {
+            int size = supdate.size();
+            connection.soutput.append((const char*)&size, 4);
+        }
+        connection.soutput.append(supdate);
+    }
+
+    /// \brief accepts connections, reads lines and sends the queued output of all connections with one poll call
+    void _eventloop_threadcb()
+    {
+        std::vector<struct pollfd> vpollfds;
+        std::vector<ConnectionPtr> vpolledconnections;
+        char buffer[4096];
+        while(!bCloseThread) {
+            vpollfds.resize(2+_listConnections.size());
+            vpolledconnections.resize(0);
+            vpollfds[0].fd = _wakeupfds[0];
+            vpollfds[0].events = POLLIN;
+            vpollfds[1].fd = server_sockfd;
+            vpollfds[1].events = POLLIN;
+            uint64_t curtime = utils::GetMicroTime();
+            int timeout = 100;
+            EnvironmentBase::EnvironmentSnapshotConstPtr psnapshot;
+            FOREACH(itconnection, _listConnections) {
+                Connection& connection = **itconnection;
+                struct pollfd& pfd = vpollfds[2+vpolledconnections.size()];
+                pfd.fd = connection.sockfd;
+                pfd.events = 0;
+                {
+                    boost::mutex::scoped_lock lock(connection.mutex);
+                    if( connection.subscriptionperiod > 0 ) {
+                        if( curtime >= connection.nextpublishtime ) {
+                            // skip the update if the client is slow, the next update has all the changes since the last one that was queued
+                            if( connection.soutput.size() - connection.outputoffset < s_nMaxPendingOutput/2 ) {
+                                if( !psnapshot ) {
+                                    psnapshot = GetEnv()->GetPublishedSnapshot();
+                                }
+                                _PublishSnapshot(connection, psnapshot);
+                            }
+                            connection.nextpublishtime = curtime + connection.subscriptionperiod;
                         }
+                        timeout = min(timeout, (int)((connection.nextpublishtime - curtime + 999)/1000));
+                    }
+                    size_t pendingoutput = connection.soutput.size() - connection.outputoffset;
+                    // backpressure, do not read more commands while the client does not take the results of the previous ones
+                    if( connection.listlines.size() < s_nMaxPendingLines && pendingoutput < s_nMaxPendingOutput ) {
+                        pfd.events |= POLLIN;
+                    }
+                    if( pendingoutput > 0 ) {
+                        pfd.events |= POLLOUT;
+                    }
+                }
+                vpolledconnections.push_back(*itconnection);
+            }
+            for(size_t i = 0; i < vpollfds.size(); ++i) {
+                vpollfds[i].revents = 0;
+            }
+
+            int num = poll(&vpollfds[0], vpollfds.size(), timeout);
+            if( num < 0 ) {
+                if( errno == EINTR ) {
+                    continue;
+                }
+                perror("server failed to poll sockets");
+                break;
+            }
+            if( num == 0 ) {
+                continue;
+            }
+
+            if( vpollfds[0].revents & POLLIN ) {
+                while(read(_wakeupfds[0], buffer, sizeof(buffer)) > 0) {
+                }
+            }
+
+            if( vpollfds[1].revents & POLLIN ) {
+                while(1) {
+                    int client_sockfd = accept(server_sockfd, NULL, NULL);
+                    if( client_sockfd < 0 ) {
+                        break;
+                    }
+                    fcntl(client_sockfd, F_SETFL, fcntl(client_sockfd, F_GETFL, 0) | O_NONBLOCK);
+                    RAVELOG_VERBOSE("started new server connection\n");
+                    _listConnections.push_back(ConnectionPtr(new Connection(client_sockfd)));
+                }
+            }
 
-                        if( bSuccess ) {
-                            if( itfn->second.bReturnResult ) {
-                                psocket->SendData(sout.str().c_str(), sout.str().size());
+            for(size_t iconnection = 0; iconnection < vpolledconnections.size(); ++iconnection) {
+                Connection& connection = *vpolledconnections[iconnection];
+                short revents = vpollfds[2+iconnection].revents;
+                bool bClose = !!(revents & POLLNVAL);
+                bool bNewLines = false;
+                size_t numNewFrames = 0;
+                if( !bClose && (revents & (POLLIN|POLLHUP|POLLERR)) ) {
+                    ssize_t nBytesReceived = recv(connection.sockfd, buffer, sizeof(buffer), 0);
+                    if( nBytesReceived > 0 ) {
+                        boost::mutex::scoped_lock lock(connection.mutex);
+                        ssize_t i = 0;
+                        for(; i < nBytesReceived && !connection.bBinary; ++i) {
+                            char c = buffer[i];
+                            if( c == '\n' || c == '\r' ) {
+                                if( connection.sinput == "binary" ) {
+                                    // the rest are binary frames. The text lines still waiting get one entry each like the frames
+                                    connection.sinput.resize(0);
+                                    connection.bBinary = true;
+                                    connection.numtextlines = connection.listlines.size();
+                                    numNewFrames += connection.listlines.size();
+                                    bNewLines = false;
+                                }
+                                else if( connection.sinput.size() > 0 ) {
+                                    connection.listlines.push_back(string());
+                                    connection.listlines.back().swap(connection.sinput);
+                                    bNewLines = true;
+                                }
                             }
-                            if( !itfn->second.fnWorker ) {
-                                bCallWorker = false;
+                            else {
+                                connection.sinput.push_back(c);
                             }
                         }
-                        else {
-                            bCallWorker = false;
-                            if( !!flog  ) {
-                                flog << " error" << endl;
-                            }
-                            if( itfn->second.bReturnResult ) {
-                                psocket->SendData("error\n", 6);
+                        if( connection.bBinary ) {
+                            connection.sinput.append(buffer+i, nBytesReceived-i);
+                            size_t offset = 0;
+                            while(connection.sinput.size() >= offset + 4) {
+                                uint32_t framesize = 0;
+                                memcpy(&framesize, connection.sinput.c_str() + offset, 4);
+                                if( framesize > s_nMaxBinaryFrameSize ) {
+                                    RAVELOG_ERROR("binary frame of %d bytes is too big, closing connection\n", framesize);
+                                    bClose = true;
+                                    break;
+                                }
+                                if( connection.sinput.size() < offset + 4 + framesize ) {
+                                    break;
+                                }
+                                connection.listlines.push_back(connection.sinput.substr(offset+4, framesize));
+                                offset += 4 + framesize;
+                                ++numNewFrames;
                             }
+                            connection.sinput.erase(0, offset);
                         }
                     }
-                    else {
-                        if( itfn->second.bReturnResult ) {
-                            psocket->SendData(sout.str().c_str(), sout.str().size());     // return dummy
+                    else if( nBytesReceived == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) ) {
+                        bClose = true;
+                    }
+                }
+                if( !bClose && (revents & POLLOUT) ) {
+                    boost::mutex::scoped_lock lock(connection.mutex);
+                    int flags = 0;
+#ifdef MSG_NOSIGNAL
+                    flags |= MSG_NOSIGNAL;
+#endif
+                    ssize_t nBytesSent = send(connection.sockfd, connection.soutput.c_str() + connection.outputoffset, connection.soutput.size() - connection.outputoffset, flags);
+                    if( nBytesSent > 0 ) {
+                        connection.outputoffset += nBytesSent;
+                        if( connection.outputoffset >= connection.soutput.size() ) {
+                            connection.soutput.resize(0);
+                            connection.outputoffset = 0;
                         }
-                        bCallWorker = !!itfn->second.fnWorker;
                     }
+                    else if( nBytesSent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) {
+                        bClose = true;
+                    }
+                }
 
-                    if( bCallWorker ) {
-                        BOOST_ASSERT(!!itfn->second.fnWorker);
-                        is->clear();
-                        is->seekg(inputpos);
-                        ScheduleWorker(boost::bind(itfn->second.fnWorker,is,pdata));
+                if( bClose ) {
+                    RAVELOG_VERBOSE("Closing socket connection\n");
+                    {
+                        boost::mutex::scoped_lock lock(connection.mutex);
+                        connection.bClosed = true;
+                        connection.listlines.clear();
+                    }
+                    CLOSESOCKET(connection.sockfd);
+                    _listConnections.remove(vpolledconnections[iconnection]);
+                }
+                else if( bNewLines || numNewFrames > 0 ) {
+                    bool bSchedule = false;
+                    if( bNewLines ) {
+                        boost::mutex::scoped_lock lock(connection.mutex);
+                        if( !connection.bProcessing ) {
+                            connection.bProcessing = true;
+                            bSchedule = true;
+                        }
+                    }
+                    if( bSchedule || numNewFrames > 0 ) {
+                        boost::mutex::scoped_lock lock(_mutexConnections);
+                        if( bSchedule ) {
+                            _listReadyConnections.push_back(vpolledconnections[iconnection]);
+                        }
+                        // every binary frame is an independent request with its own entry, so the frames of one connection can run in parallel
+                        for(size_t iframe = 0; iframe < numNewFrames; ++iframe) {
+                            _listReadyConnections.push_back(vpolledconnections[iconnection]);
+                        }
+                        _condConnectionReady.notify_all();
                     }
                 }
+            }
+        }
+
+        RAVELOG_DEBUG("**Server thread exiting\n");
+    }
+
+    /// \brief runs the lines of the connections that are ready, one line at a time so that the connections share the pool fairly
+    void _pool_threadcb()
+    {
+        string line;
+        while(!bCloseThread) {
+            ConnectionPtr pconnection;
+            {
+                boost::mutex::scoped_lock lock(_mutexConnections);
+                while(_listReadyConnections.empty() && !bCloseThread) {
+                    _condConnectionReady.wait(lock);
+                }
+                if( bCloseThread ) {
+                    break;
+                }
+                pconnection = _listReadyConnections.front();
+                _listReadyConnections.pop_front();
+            }
+
+            bool bHasLine = false, bBinary = false;
+            {
+                boost::mutex::scoped_lock lock(pconnection->mutex);
+                if( !pconnection->bClosed && pconnection->listlines.size() > 0 ) {
+                    line.swap(pconnection->listlines.front());
+                    pconnection->listlines.pop_front();
+                    bHasLine = true;
+                    if( pconnection->numtextlines > 0 ) {
+                        --pconnection->numtextlines;
+                    }
+                    else {
+                        bBinary = pconnection->bBinary;
+                    }
+                }
+            }
+            if( bHasLine ) {
+                if( bBinary ) {
+                    _ProcessBinaryRequest(pconnection, line);
+                }
                 else {
-                    RAVELOG_ERROR("Failed to recognize command: %s\n", cmd.c_str());
-                    psocket->SendData("error\n",1);
+                    _ProcessConnectionLine(pconnection, 0, line, boost::bind(&SimpleTextServer::_QueueOutput, this, pconnection, _1, _2));
                 }
             }
-            else if( !psocket->IsInit() ) {
-                break;
+
+            bool bRequeue = false;
+            {
+                boost::mutex::scoped_lock lock(pconnection->mutex);
+                if( !pconnection->bBinary && !pconnection->bClosed && pconnection->listlines.size() > 0 ) {
+                    bRequeue = true;
+                }
+                else {
+                    pconnection->bProcessing = false;
+                }
             }
-            usleep(1000);
+            if( bRequeue ) {
+                boost::mutex::scoped_lock lock(_mutexConnections);
+                _listReadyConnections.push_back(pconnection);
+                _condConnectionReady.notify_one();
+            }
+            _WakeEventLoop();
         }
-
-        RAVELOG_VERBOSE("Closing socket connection\n");
     }
+#endif
 
     int _nPort;     ///< port used for listening to incoming connections
 
     boost::shared_ptr<boost::thread> _servthread, _workerthread;
-    list<boost::shared_ptr<boost::thread> > _listReadThreads;
+    list<boost::shared_ptr<boost::thread> > _listReadThreads; ///< the threads reading the connections on windows, otherwise the pool threads running the lines
+    int _nNumPoolThreads;
+#ifndef _WIN32
+    list<ConnectionPtr> _listConnections; ///< only used by the event loop thread
+    std::deque<ConnectionPtr> _listReadyConnections; ///< connections with lines waiting for a pool thread
+    boost::mutex _mutexConnections; ///< protects _listReadyConnections
+    boost::condition _condConnectionReady;
+    int _wakeupfds[2]; ///< pipe waking up the event loop
+    map<string, OpenRaveBinaryFn> mapBinaryFns;
+    map<string, OpenRaveConnectionFn> mapConnectionFns;
+    // only used by the event loop thread to push the subscribed updates
+    std::vector<const KinBody::BodyState*> _vCachedChangedStates;
+    std::vector<int> _vCachedRemovedIds;
+    std::map<int, int> _mapCachedUpdateStamps;
+    stringstream _ssCachedUpdate;
+#endif
 
     boost::mutex _mutexWorker;
     boost::condition _condWorker;
@@ -1036,7 +1875,15 @@ protected:
         _SyncWithWorkerThread();
         KinBodyPtr pbody = orMacroGetBody(is);
         vector<dReal> values = vector<dReal>((istream_iterator<dReal>(is)), istream_iterator<dReal>());
+        return _SetBodyTransform(pbody, values);
+    }
 
+    /// \brief sets the transform of a body from 7 values (quaternion and translation), 12 values (rotation matrix by columns and translation) or 3 values (translation)
+    bool _SetBodyTransform(KinBodyPtr pbody, const vector<dReal>& values)
+    {
+        if( !pbody ) {
+            return false;
+        }
         Transform t;
         if( values.size() == 7 ) {
             // quaternion and translation
@@ -1803,6 +2650,18 @@ protected:
             bUseIndices = true;
         }
 
+        if( !bUseIndices ) {
+            vindices.resize(0);
+        }
+        return _SetBodyJointValues(pbody, vvalues, vindices);
+    }
+
+    /// \brief sets the dof values of a body, the environment has to be locked
+    ///
+    /// \param vindices the dof indices of vvalues, if empty vvalues has all the dof values
+    bool _SetBodyJointValues(KinBodyPtr pbody, vector<dReal>& vvalues, const vector<int>& vindices)
+    {
+        bool bUseIndices = vindices.size() > 0;
         if( bUseIndices ) {
             vector<dReal> v;
             pbody->GetDOFValues(v);
@@ -2097,6 +2956,175 @@ protected:
         return true;
     }
 
+    /// orEnvSetBodyTransforms(num, [bodyid, numvalues, values]*) - sets the transforms of many bodies under one lock, numvalues is 7, 12 or 3 like body_settransform.
+    /// Nothing is set if one of the bodies is not found.
+    bool orEnvSetBodyTransforms(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        int num = 0;
+        is >> num;
+        if( !is || num < 0 ) {
+            return false;
+        }
+        vector<int> vbodyids(num);
+        vector< vector<dReal> > vvalues(num);
+        for(int ibody = 0; ibody < num; ++ibody) {
+            int numvalues = 0;
+            is >> vbodyids[ibody] >> numvalues;
+            if( !is || numvalues < 0 ) {
+                return false;
+            }
+            vvalues[ibody].resize(numvalues);
+            for(int i = 0; i < numvalues; ++i) {
+                is >> vvalues[ibody][i];
+            }
+            if( !is ) {
+                return false;
+            }
+        }
+        _SyncWithWorkerThread();
+        return _SetBodyTransforms(vbodyids, vvalues);
+    }
+
+    bool _SetBodyTransforms(const vector<int>& vbodyids, const vector< vector<dReal> >& vvalues)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        vector<KinBodyPtr> vbodies(vbodyids.size());
+        for(size_t ibody = 0; ibody < vbodyids.size(); ++ibody) {
+            vbodies[ibody] = GetEnv()->GetBodyFromEnvironmentId(vbodyids[ibody]);
+            if( !vbodies[ibody] ) {
+                RAVELOG_WARN("failed to find body %d\n", vbodyids[ibody]);
+                return false;
+            }
+        }
+        bool bSuccess = true;
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            bSuccess &= _SetBodyTransform(vbodies[ibody], vvalues[ibody]);
+        }
+        return bSuccess;
+    }
+
+    /// orEnvSetBodyJoints(num, [bodyid, dof, values, numindices, indices]*) - sets the dof values of many bodies under one lock, numindices is 0 or dof like body_setjoints.
+    /// Nothing is set if one of the bodies is not found.
+    bool orEnvSetBodyJoints(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        int num = 0;
+        is >> num;
+        if( !is || num < 0 ) {
+            return false;
+        }
+        vector<int> vbodyids(num);
+        vector< vector<dReal> > vvalues(num);
+        vector< vector<int> > vindices(num);
+        for(int ibody = 0; ibody < num; ++ibody) {
+            int dof = 0, numindices = 0;
+            is >> vbodyids[ibody] >> dof;
+            if( !is || dof < 0 ) {
+                return false;
+            }
+            vvalues[ibody].resize(dof);
+            for(int i = 0; i < dof; ++i) {
+                is >> vvalues[ibody][i];
+            }
+            is >> numindices;
+            if( !is || (numindices != 0 && numindices != dof) ) {
+                return false;
+            }
+            vindices[ibody].resize(numindices);
+            for(int i = 0; i < numindices; ++i) {
+                is >> vindices[ibody][i];
+            }
+            if( !is ) {
+                return false;
+            }
+        }
+        _SyncWithWorkerThread();
+        return _SetBodiesJointValues(vbodyids, vvalues, vindices);
+    }
+
+    bool _SetBodiesJointValues(const vector<int>& vbodyids, vector< vector<dReal> >& vvalues, const vector< vector<int> >& vindices)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        vector<KinBodyPtr> vbodies(vbodyids.size());
+        for(size_t ibody = 0; ibody < vbodyids.size(); ++ibody) {
+            vbodies[ibody] = GetEnv()->GetBodyFromEnvironmentId(vbodyids[ibody]);
+            if( !vbodies[ibody] ) {
+                RAVELOG_WARN("failed to find body %d\n", vbodyids[ibody]);
+                return false;
+            }
+        }
+        bool bSuccess = true;
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            bSuccess &= _SetBodyJointValues(vbodies[ibody], vvalues[ibody], vindices[ibody]);
+        }
+        return bSuccess;
+    }
+
+    /// aabbs = orEnvGetBodyAABBs(num, bodyids) - returns pos and extents of the aabb of every body under one lock
+    bool orEnvGetBodyAABBs(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        vector<int> vbodyids;
+        if( !_ReadBodyIds(is, vbodyids) ) {
+            return false;
+        }
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        FOREACHC(itbodyid, vbodyids) {
+            KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(*itbodyid);
+            if( !pbody ) {
+                RAVELOG_WARN("failed to find body %d\n", *itbodyid);
+                return false;
+            }
+            AABB ab = pbody->ComputeAABB();
+            os << ab.pos.x << " " << ab.pos.y << " " << ab.pos.z << " " << ab.extents.x << " " << ab.extents.y << " " << ab.extents.z << " ";
+        }
+        return true;
+    }
+
+    /// [collision, bodycolliding]* = orEnvCheckCollisions(num, bodyids) - checks every body against the scene under one lock like body_checkcollision without contacts
+    bool orEnvCheckCollisions(istream& is, ostream& os, boost::shared_ptr<void>& pdata)
+    {
+        vector<int> vbodyids;
+        if( !_ReadBodyIds(is, vbodyids) ) {
+            return false;
+        }
+        _SyncWithWorkerThread();
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        CollisionReportPtr preport(new CollisionReport());
+        CollisionOptionsStateSaver optionsaver(GetEnv()->GetCollisionChecker(),0);
+        FOREACHC(itbodyid, vbodyids) {
+            KinBodyPtr pbody = GetEnv()->GetBodyFromEnvironmentId(*itbodyid);
+            if( !pbody ) {
+                RAVELOG_WARN("failed to find body %d\n", *itbodyid);
+                return false;
+            }
+            os << (GetEnv()->CheckCollision(KinBodyConstPtr(pbody), preport) ? "1 " : "0 ");
+            int bodyindex = 0;
+            if( !!preport->plink1 &&( preport->plink1->GetParent() != pbody) ) {
+                bodyindex = preport->plink1->GetParent()->GetEnvironmentId();
+            }
+            if( !!preport->plink2 &&( preport->plink2->GetParent() != pbody) ) {
+                bodyindex = preport->plink2->GetParent()->GetEnvironmentId();
+            }
+            os << bodyindex << " ";
+        }
+        return true;
+    }
+
+    /// \brief reads num followed by num body ids
+    bool _ReadBodyIds(istream& is, vector<int>& vbodyids)
+    {
+        int num = 0;
+        is >> num;
+        if( !is || num < 0 ) {
+            return false;
+        }
+        vbodyids.resize(num);
+        for(int i = 0; i < num; ++i) {
+            is >> vbodyids[i];
+        }
+        return !!is;
+    }
+
     /// [collision, info] = orEnvRayCollision(rays) - returns the position and normals where all the rays collide
     /// every ray is 6 dims
     /// collision is a N dim vector that is 0 for non colliding rays and 1 for colliding rays
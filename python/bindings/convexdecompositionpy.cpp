@@ -23,6 +23,10 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/format.hpp>
 #include <boost/assert.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
 #include <openrave/config.h>
 
 #define OPENRAVE_BINDINGS_PYARRAY
@@ -91,15 +95,198 @@ inline void assertion_failed_msg(char const * expr, char const * msg, char const
 }
 #endif
 
-#ifdef USE_PYBIND11_PYTHON_BINDINGS
-object computeConvexDecomposition(py::array_t<float>& vertices, py::array_t<int>& indices,
-#else
-object computeConvexDecomposition(const boost::multi_array<float, 2>& vertices, const boost::multi_array<int, 2>& indices,
-#endif
-                                  NxF32 skinWidth=0, NxU32 decompositionDepth=8, NxU32 maxHullVertices=64, NxF32 concavityThresholdPercent=0.1f, NxF32 mergeThresholdPercent=30.0f, NxF32 volumeSplitThresholdPercent=0.1f, bool useInitialIslandGeneration=true, bool useIslandGeneration=false)
+/// \brief the arguments of iConvexDecomposition::computeConvexDecomposition
+struct ConvexDecompositionParameters
+{
+    NxF32 skinWidth;
+    NxU32 decompositionDepth;
+    NxU32 maxHullVertices;
+    NxF32 concavityThresholdPercent;
+    NxF32 mergeThresholdPercent;
+    NxF32 volumeSplitThresholdPercent;
+    bool useInitialIslandGeneration;
+    bool useIslandGeneration;
+};
+
+/// \brief a triangle mesh, or a triangle list when indices is empty
+struct ConvexDecompositionMesh
+{
+    std::vector<NxF32> vertices;
+    std::vector<NxU32> indices;
+};
+
+typedef ConvexDecompositionMesh ConvexHullMesh;
+typedef OPENRAVE_SHARED_PTR<const std::vector<ConvexHullMesh> > ConvexHullsConstPtr;
+
+/// \brief decomposes the mesh, the library only keeps thread local state so that several meshes can be decomposed at the same time
+static ConvexHullsConstPtr ComputeConvexHulls(const ConvexDecompositionMesh& mesh, const ConvexDecompositionParameters& params)
 {
     OPENRAVE_SHARED_PTR<CONVEX_DECOMPOSITION::iConvexDecomposition> ic(CONVEX_DECOMPOSITION::createConvexDecomposition(),CONVEX_DECOMPOSITION::releaseConvexDecomposition);
+    if( mesh.indices.size() > 0 ) {
+        for(size_t i = 0; i+2 < mesh.indices.size(); i += 3) {
+            ic->addTriangle(&mesh.vertices.at(3*mesh.indices[i]), &mesh.vertices.at(3*mesh.indices[i+1]), &mesh.vertices.at(3*mesh.indices[i+2]));
+        }
+    }
+    else {
+        BOOST_ASSERT((mesh.vertices.size()%9)==0);
+        for(size_t i = 0; i < mesh.vertices.size(); i += 9) {
+            ic->addTriangle(&mesh.vertices[i], &mesh.vertices[i+3], &mesh.vertices[i+6]);
+        }
+    }
+
+    ic->computeConvexDecomposition(params.skinWidth, params.decompositionDepth, params.maxHullVertices, params.concavityThresholdPercent, params.mergeThresholdPercent, params.volumeSplitThresholdPercent, params.useInitialIslandGeneration, params.useIslandGeneration, false);
+    NxU32 hullCount = ic->getHullCount();
+    OPENRAVE_SHARED_PTR<std::vector<ConvexHullMesh> > phulls(new std::vector<ConvexHullMesh>(hullCount));
+    CONVEX_DECOMPOSITION::ConvexHullResult result;
+    for(NxU32 i = 0; i < hullCount; ++i) {
+        ic->getConvexHullResult(i,result);
+        (*phulls)[i].vertices.assign(result.mVertices, result.mVertices + 3 * result.mVcount);
+        (*phulls)[i].indices.assign(result.mIndices, result.mIndices + 3 * result.mTcount);
+    }
+    return phulls;
+}
+
+/// \brief the hulls of all the meshes decomposed by the module, keyed by the mesh data and the parameters
+///
+/// Robots often have the same mesh on several links, like fingers or the two sides of a symmetric arm, so those are only decomposed once.
+class ConvexDecompositionCache
+{
+public:
+    static ConvexDecompositionCache& GetInstance() {
+        static ConvexDecompositionCache s_cache;
+        return s_cache;
+    }
+
+    static std::string GetKey(const ConvexDecompositionMesh& mesh, const ConvexDecompositionParameters& params)
+    {
+        std::string key(sizeof(params) + sizeof(NxF32)*mesh.vertices.size() + sizeof(NxU32)*mesh.indices.size(), '\0');
+        // params is copied member by member since its padding bytes are not initialized
+        size_t offset = 0;
+        _Append(key, offset, &params.skinWidth, sizeof(params.skinWidth));
+        _Append(key, offset, &params.decompositionDepth, sizeof(params.decompositionDepth));
+        _Append(key, offset, &params.maxHullVertices, sizeof(params.maxHullVertices));
+        _Append(key, offset, &params.concavityThresholdPercent, sizeof(params.concavityThresholdPercent));
+        _Append(key, offset, &params.mergeThresholdPercent, sizeof(params.mergeThresholdPercent));
+        _Append(key, offset, &params.volumeSplitThresholdPercent, sizeof(params.volumeSplitThresholdPercent));
+        _Append(key, offset, &params.useInitialIslandGeneration, sizeof(params.useInitialIslandGeneration));
+        _Append(key, offset, &params.useIslandGeneration, sizeof(params.useIslandGeneration));
+        offset = sizeof(params);
+        if( mesh.vertices.size() > 0 ) {
+            _Append(key, offset, &mesh.vertices[0], sizeof(NxF32)*mesh.vertices.size());
+        }
+        if( mesh.indices.size() > 0 ) {
+            _Append(key, offset, &mesh.indices[0], sizeof(NxU32)*mesh.indices.size());
+        }
+        return key;
+    }
+
+    ConvexHullsConstPtr Find(const std::string& key) const {
+        boost::mutex::scoped_lock lock(_mutex);
+        boost::unordered_map<std::string, ConvexHullsConstPtr>::const_iterator it = _mapHulls.find(key);
+        return it != _mapHulls.end() ? it->second : ConvexHullsConstPtr();
+    }
+
+    void Insert(const std::string& key, ConvexHullsConstPtr phulls) {
+        boost::mutex::scoped_lock lock(_mutex);
+        _mapHulls[key] = phulls;
+    }
+
+    void Clear() {
+        boost::mutex::scoped_lock lock(_mutex);
+        _mapHulls.clear();
+    }
+
+private:
+    static void _Append(std::string& key, size_t& offset, const void* pdata, size_t size) {
+        std::copy((const char*)pdata, (const char*)pdata + size, key.begin() + offset);
+        offset += size;
+    }
+
+    mutable boost::mutex _mutex;
+    boost::unordered_map<std::string, ConvexHullsConstPtr> _mapHulls;
+};
+
+/// \brief decomposes the meshes of vcompute that no other thread took yet, they are large meshes so a shared counter balances the threads well enough
+static void _ComputeConvexDecompositionsWorker(const std::vector<ConvexDecompositionMesh>& vmeshes, const ConvexDecompositionParameters& params, const std::vector<size_t>& vcompute, boost::mutex& mutex, size_t& inext, std::vector<ConvexHullsConstPtr>& vhulls, std::vector<std::string>& verrors)
+{
+    while(1) {
+        size_t i;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            if( inext >= vcompute.size() ) {
+                return;
+            }
+            i = inext++;
+        }
+        try {
+            vhulls[vcompute[i]] = ComputeConvexHulls(vmeshes[vcompute[i]], params);
+        }
+        catch(const std::exception& ex) {
+            verrors[i] = ex.what();
+        }
+    }
+}
+
+/// \brief decomposes the meshes on numthreads threads (0 uses one per cpu), only the meshes that are not in the cache are decomposed
+static void ComputeConvexDecompositions(const std::vector<ConvexDecompositionMesh>& vmeshes, const ConvexDecompositionParameters& params, int numthreads, std::vector<ConvexHullsConstPtr>& vhulls)
+{
+    ConvexDecompositionCache& cache = ConvexDecompositionCache::GetInstance();
+    std::vector<std::string> vkeys(vmeshes.size());
+    vhulls.resize(vmeshes.size());
+    // identical meshes of the same call are decomposed once too
+    std::map<std::string, size_t> mapcomputed;
+    std::vector<size_t> vcompute, vduplicates;
+    for(size_t imesh = 0; imesh < vmeshes.size(); ++imesh) {
+        vkeys[imesh] = ConvexDecompositionCache::GetKey(vmeshes[imesh], params);
+        vhulls[imesh] = cache.Find(vkeys[imesh]);
+        if( !vhulls[imesh] ) {
+            if( mapcomputed.insert(std::make_pair(vkeys[imesh], imesh)).second ) {
+                vcompute.push_back(imesh);
+            }
+            else {
+                vduplicates.push_back(imesh);
+            }
+        }
+    }
+
+    if( numthreads <= 0 ) {
+        numthreads = std::max(1, (int)boost::thread::hardware_concurrency());
+    }
+    numthreads = std::min(numthreads, (int)vcompute.size());
+    std::vector<std::string> verrors(vcompute.size());
+    if( numthreads <= 1 ) {
+        for(size_t i = 0; i < vcompute.size(); ++i) {
+            vhulls[vcompute[i]] = ComputeConvexHulls(vmeshes[vcompute[i]], params);
+        }
+    }
+    else {
+        boost::mutex mutex;
+        size_t inext = 0;
+        std::vector<OPENRAVE_SHARED_PTR<boost::thread> > vthreads(numthreads);
+        FOREACH(itthread, vthreads) {
+            itthread->reset(new boost::thread(boost::bind(&_ComputeConvexDecompositionsWorker, boost::cref(vmeshes), boost::cref(params), boost::cref(vcompute), boost::ref(mutex), boost::ref(inext), boost::ref(vhulls), boost::ref(verrors))));
+        }
+        FOREACH(itthread, vthreads) {
+            (*itthread)->join();
+        }
+        FOREACH(iterror, verrors) {
+            if( iterror->size() > 0 ) {
+                throw cdpy_exception(*iterror);
+            }
+        }
+    }
+
+    FOREACHC(itcompute, vcompute) {
+        cache.Insert(vkeys[*itcompute], vhulls[*itcompute]);
+    }
+    FOREACHC(itduplicate, vduplicates) {
+        vhulls[*itduplicate] = vhulls.at(mapcomputed[vkeys[*itduplicate]]);
+    }
+}
+
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
+static void ExtractConvexDecompositionMesh(py::array_t<float>& vertices, py::array_t<int>& indices, ConvexDecompositionMesh& mesh)
+{
     // https://pybind11.readthedocs.io/en/stable/advanced/pycpp/numpy.html#direct-access
     // https://stackoverflow.com/questions/49582252/pybind-numpy-access-2d-nd-arrays
     const py::buffer_info& vertices_info = vertices.request();
@@ -108,72 +295,135 @@ object computeConvexDecomposition(const boost::multi_array<float, 2>& vertices,
     const size_t nvertices = vertices_shape[0];
     BOOST_ASSERT(vertices_shape[1] == 3);
     float const* const p_vertices = (float *) vertices_info.ptr;
+    mesh.vertices.assign(p_vertices, p_vertices + 3*nvertices);
 
     const py::buffer_info& indices_info = indices.request();
     const std::vector<ssize_t> &indices_shape = indices_info.shape;
-    BOOST_ASSERT(indices_shape.size() == 2);
-    const size_t nindices = indices_shape[0];
-    BOOST_ASSERT(indices_shape[1] == 3);
-    int const* const p_indices = (int *) indices_info.ptr;
-#endif
-
+    mesh.indices.resize(0);
     if( indices.size() > 0 ) {
-#ifdef USE_PYBIND11_PYTHON_BINDINGS
-        for(size_t iindex = 0; iindex < 3 * nindices; iindex += 3) {
-            ic->addTriangle(p_vertices + 3*(*(p_indices+iindex+0)),
-                            p_vertices + 3*(*(p_indices+iindex+1)),
-                            p_vertices + 3*(*(p_indices+iindex+2))
-            );
-        }
-#else
-        FOREACHC(it,indices) {
-            ic->addTriangle(&vertices[(*it)[0]][0], &vertices[(*it)[1]][0], &vertices[(*it)[2]][0]);
-        }
-#endif // USE_PYBIND11_PYTHON_BINDINGS
+        BOOST_ASSERT(indices_shape.size() == 2);
+        const size_t nindices = indices_shape[0];
+        BOOST_ASSERT(indices_shape[1] == 3);
+        int const* const p_indices = (int *) indices_info.ptr;
+        mesh.indices.assign(p_indices, p_indices + 3*nindices);
     }
-    else {
-        BOOST_ASSERT((vertices.size()%3)==0);
-        for(size_t i = 0; i < vertices.size(); i += 3) {
-#ifdef USE_PYBIND11_PYTHON_BINDINGS
-            ic->addTriangle(p_vertices + 3*(i+0),
-                            p_vertices + 3*(i+1),
-                            p_vertices + 3*(i+2));
+}
 #else
-            ic->addTriangle(&vertices[i][0], &vertices[i+1][0], &vertices[i+2][0]);
-#endif
-        }
+static void ExtractConvexDecompositionMesh(const boost::multi_array<float, 2>& vertices, const boost::multi_array<int, 2>& indices, ConvexDecompositionMesh& mesh)
+{
+    mesh.vertices.resize(0);
+    mesh.vertices.reserve(3*vertices.size());
+    FOREACHC(it,vertices) {
+        mesh.vertices.push_back((*it)[0]);
+        mesh.vertices.push_back((*it)[1]);
+        mesh.vertices.push_back((*it)[2]);
+    }
+    mesh.indices.resize(0);
+    mesh.indices.reserve(3*indices.size());
+    FOREACHC(it,indices) {
+        mesh.indices.push_back((*it)[0]);
+        mesh.indices.push_back((*it)[1]);
+        mesh.indices.push_back((*it)[2]);
     }
+}
+#endif // USE_PYBIND11_PYTHON_BINDINGS
 
-    ic->computeConvexDecomposition(skinWidth, decompositionDepth, maxHullVertices, concavityThresholdPercent, mergeThresholdPercent, volumeSplitThresholdPercent, useInitialIslandGeneration, useIslandGeneration, false);
-    NxU32 hullCount = ic->getHullCount();
+/// \brief returns the hulls as a list of (vertices, indices) numpy arrays
+static py::list ConvertConvexHulls(const std::vector<ConvexHullMesh>& vhulls)
+{
     py::list hulls;
-    CONVEX_DECOMPOSITION::ConvexHullResult result;
-    for(NxU32 i = 0; i < hullCount; ++i) {
-        ic->getConvexHullResult(i,result);
+    FOREACHC(ithull, vhulls) {
+        const NxU32 vcount = ithull->vertices.size()/3, tcount = ithull->indices.size()/3;
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
-        py::array_t<NxF32> pyvertices(3 * result.mVcount, result.mVertices);
-        pyvertices.resize({(int) result.mVcount, 3});
-        py::array_t<NxU32> pyindices(3 * result.mTcount, result.mIndices);
-        pyindices.resize({(int) result.mTcount, 3});
+        py::array_t<NxF32> pyvertices(3 * vcount, ithull->vertices.data());
+        pyvertices.resize({(int) vcount, 3});
+        py::array_t<NxU32> pyindices(3 * tcount, ithull->indices.data());
+        pyindices.resize({(int) tcount, 3});
         hulls.append(py::make_tuple(pyvertices, pyindices));
 #else // USE_PYBIND11_PYTHON_BINDINGS
-        npy_intp dims[] = { result.mVcount,3};
-        PyObject *pyvertices = PyArray_SimpleNew(2,dims, sizeof(result.mVertices[0])==8 ? PyArray_DOUBLE : PyArray_FLOAT);
-        std::copy(result.mVertices, result.mVertices + 3 * result.mVcount, (NxF32*)PyArray_DATA(pyvertices));
+        npy_intp dims[] = { vcount,3};
+        PyObject *pyvertices = PyArray_SimpleNew(2,dims, sizeof(NxF32)==8 ? PyArray_DOUBLE : PyArray_FLOAT);
+        std::copy(ithull->vertices.begin(), ithull->vertices.end(), (NxF32*)PyArray_DATA(pyvertices));
 
-        dims[0] = result.mTcount;
+        dims[0] = tcount;
         dims[1] = 3;
         PyObject *pyindices = PyArray_SimpleNew(2,dims, PyArray_INT);
-        std::copy(result.mIndices, result.mIndices + 3 * result.mTcount, (int*)PyArray_DATA(pyindices));
+        std::copy(ithull->indices.begin(), ithull->indices.end(), (int*)PyArray_DATA(pyindices));
         hulls.append(py::make_tuple(py::to_array_astype<NxF32>(pyvertices), py::to_array_astype<int>(pyindices)));
 #endif // USE_PYBIND11_PYTHON_BINDINGS
     }
-
     return hulls;
 }
 
+/// \brief releases the python lock while the meshes are decomposed
+class ConvexDecompositionThreadSaver
+{
+public:
+    ConvexDecompositionThreadSaver() {
+        _save = PyEval_SaveThread();
+    }
+    ~ConvexDecompositionThreadSaver() {
+        PyEval_RestoreThread(_save);
+    }
+private:
+    PyThreadState *_save;
+};
+
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+object computeConvexDecomposition(py::array_t<float>& vertices, py::array_t<int>& indices,
+#else
+object computeConvexDecomposition(const boost::multi_array<float, 2>& vertices, const boost::multi_array<int, 2>& indices,
+#endif
+                                  NxF32 skinWidth=0, NxU32 decompositionDepth=8, NxU32 maxHullVertices=64, NxF32 concavityThresholdPercent=0.1f, NxF32 mergeThresholdPercent=30.0f, NxF32 volumeSplitThresholdPercent=0.1f, bool useInitialIslandGeneration=true, bool useIslandGeneration=false)
+{
+    ConvexDecompositionParameters params = { skinWidth, decompositionDepth, maxHullVertices, concavityThresholdPercent, mergeThresholdPercent, volumeSplitThresholdPercent, useInitialIslandGeneration, useIslandGeneration };
+    std::vector<ConvexDecompositionMesh> vmeshes(1);
+    ExtractConvexDecompositionMesh(vertices, indices, vmeshes[0]);
+    std::vector<ConvexHullsConstPtr> vhulls;
+    {
+        ConvexDecompositionThreadSaver saver;
+        ComputeConvexDecompositions(vmeshes, params, 1, vhulls);
+    }
+    return ConvertConvexHulls(*vhulls.at(0));
+}
+
+/// \brief decomposes a list of (vertices, indices) meshes on numthreads threads and returns the list of hulls of every mesh
+object computeConvexDecompositions(object meshes, NxF32 skinWidth=0, NxU32 decompositionDepth=8, NxU32 maxHullVertices=64, NxF32 concavityThresholdPercent=0.1f, NxF32 mergeThresholdPercent=30.0f, NxF32 volumeSplitThresholdPercent=0.1f, bool useInitialIslandGeneration=true, bool useIslandGeneration=false, int numthreads=0)
+{
+    ConvexDecompositionParameters params = { skinWidth, decompositionDepth, maxHullVertices, concavityThresholdPercent, mergeThresholdPercent, volumeSplitThresholdPercent, useInitialIslandGeneration, useIslandGeneration };
+    const size_t nummeshes = py::len(meshes);
+    std::vector<ConvexDecompositionMesh> vmeshes(nummeshes);
+    for(size_t imesh = 0; imesh < nummeshes; ++imesh) {
+        object omesh = meshes[imesh];
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+        py::array_t<float> vertices = extract<py::array_t<float> >(omesh[0]);
+        py::array_t<int> indices = extract<py::array_t<int> >(omesh[1]);
+#else
+        boost::multi_array<float, 2> vertices = extract<boost::multi_array<float, 2> >(omesh[0]);
+        boost::multi_array<int, 2> indices = extract<boost::multi_array<int, 2> >(omesh[1]);
+#endif
+        ExtractConvexDecompositionMesh(vertices, indices, vmeshes[imesh]);
+    }
+    std::vector<ConvexHullsConstPtr> vhulls;
+    {
+        ConvexDecompositionThreadSaver saver;
+        ComputeConvexDecompositions(vmeshes, params, numthreads, vhulls);
+    }
+    py::list allhulls;
+    FOREACHC(ithulls, vhulls) {
+        allhulls.append(ConvertConvexHulls(**ithulls));
+    }
+    return allhulls;
+}
+
+void clearConvexDecompositionCache()
+{
+    ConvexDecompositionCache::GetInstance().Clear();
+}
+
 #ifndef USE_PYBIND11_PYTHON_BINDINGS
 BOOST_PYTHON_FUNCTION_OVERLOADS(computeConvexDecomposition_overloads, computeConvexDecomposition, 2, 10)
+BOOST_PYTHON_FUNCTION_OVERLOADS(computeConvexDecompositions_overloads, computeConvexDecompositions, 1, 10)
 #endif
 
 OPENRAVE_PYTHON_MODULE(convexdecompositionpy)
@@ -213,9 +463,29 @@ OPENRAVE_PYTHON_MODULE(convexdecompositionpy)
         "useInitialIslandGeneration"_a = true,
         "useIslandGeneration"_a = false,
         "John Ratcliff's Convex Decomposition")
+    ;
+    m.def("computeConvexDecompositions", computeConvexDecompositions,
+        "meshes"_a,
+        "skinWidth"_a = 0,
+        "decompositionDepth"_a = 8,
+        "maxHullVertices"_a = 64,
+        "concavityThresholdPercent"_a = 0.1,
+        "mergeThresholdPercent"_a = 30.0,
+        "volumeSplitThresholdPercent"_a = 0.1,
+        "useInitialIslandGeneration"_a = true,
+        "useIslandGeneration"_a = false,
+        "numthreads"_a = 0,
+        "Computes the convex decompositions of a list of (vertices, indices) meshes on numthreads threads (0 uses one per cpu). The hulls of every mesh are cached, so meshes decomposed before with the same parameters are not decomposed again.")
+    ;
+    m.def("clearConvexDecompositionCache", clearConvexDecompositionCache, "Clears the hulls cached by computeConvexDecomposition and computeConvexDecompositions")
 #else
     def("computeConvexDecomposition", computeConvexDecomposition,
         computeConvexDecomposition_overloads(PY_ARGS("vertices", "indices", "skinWidth", "decompositionDepth", "maxHullVertices", "concavityThresholdPercent", "mergeThresholdPercent", "volumeSplitThresholdPercent", "useInitialIslandGeneration", "useIslandGeneration") "John Ratcliff's Convex Decomposition"))
+    ;
+    def("computeConvexDecompositions", computeConvexDecompositions,
+        computeConvexDecompositions_overloads(PY_ARGS("meshes", "skinWidth", "decompositionDepth", "maxHullVertices", "concavityThresholdPercent", "mergeThresholdPercent", "volumeSplitThresholdPercent", "useInitialIslandGeneration", "useIslandGeneration", "numthreads") "Computes the convex decompositions of a list of (vertices, indices) meshes on numthreads threads (0 uses one per cpu). The hulls of every mesh are cached, so meshes decomposed before with the same parameters are not decomposed again."))
+    ;
+    def("clearConvexDecompositionCache", clearConvexDecompositionCache, "Clears the hulls cached by computeConvexDecomposition and computeConvexDecompositions")
 #endif
     ;
 
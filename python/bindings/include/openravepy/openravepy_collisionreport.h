@@ -47,6 +47,8 @@ public:
     std::string __str__();
     object __unicode__();
 
+    void Reserve(int numcontacts, int numlinkpairs, bool bfixedcapacity=true);
+
     int options;
     object plink1 = py::none_();
     object plink2 = py::none_();
@@ -55,6 +57,7 @@ public:
     int numWithinTol;
     py::list contacts;
     uint32_t nKeepPrevious;
+    bool bTruncated = false;
     CollisionReportPtr report;
 };
 
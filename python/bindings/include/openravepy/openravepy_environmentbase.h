@@ -53,6 +53,8 @@ public:
 
     void Clone(PyEnvironmentBasePtr pyreference, int options);
 
+    void SynchronizeBodies(PyEnvironmentBasePtr pyreference);
+
     bool SetCollisionChecker(PyCollisionCheckerBasePtr pchecker);
     object GetCollisionChecker();
     bool CheckCollision(PyKinBodyPtr pbody1);
@@ -118,6 +120,7 @@ public:
     object ReadTrimeshData(const std::string& data, const std::string& formathint, object odictatts);
 
     void Add(PyInterfaceBasePtr pinterface, bool bAnonymous=false, const std::string& cmdargs="");
+    void AddBodies(object obodies, bool bAnonymous=false);
 
     void AddKinBody(PyKinBodyPtr pbody);
     void AddKinBody(PyKinBodyPtr pbody, bool bAnonymous);
@@ -130,6 +133,7 @@ public:
     bool RemoveKinBody(PyKinBodyPtr pbody);
 
     bool RemoveKinBodyByName(const std::string& name);
+    int RemoveBodies(object obodies);
 
     object GetKinBody(const std::string &name);
     object GetRobot(const std::string &name);
@@ -172,6 +176,16 @@ public:
 
     bool TryLock();
 
+    void SetMutexInstrumentationEnabled(bool bEnable);
+    bool IsMutexInstrumentationEnabled();
+
+    /// \brief returns a list of dicts with the statistics of every call site that locked the environment mutex
+    object GetMutexStatistics();
+    void ResetMutexStatistics();
+
+    /// \brief returns (threadid, callsite, heldtime) of the thread holding the environment mutex or None
+    object GetMutexHolder();
+
     bool Lock(float timeout);
 
     void __enter__();
@@ -210,6 +224,12 @@ public:
 
     object GetBodies();
 
+    object GetBodiesInAABB(object oaabb);
+
+    void SetSpatialGridCellSize(dReal fCellSize);
+
+    dReal GetSpatialGridCellSize() const;
+
     object GetRobots();
 
     object GetSensors();
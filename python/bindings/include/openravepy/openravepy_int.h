@@ -85,6 +85,12 @@ OPENRAVEPY_API py::object toPyIkParameterization(const IkParameterization& ikpar
 OPENRAVEPY_API py::object toPyIkParameterization(const std::string& serializeddata);
 //@}
 
+/// \brief returns the data of oarray if it is a writeable C contiguous dReal array with numvalues values, otherwise throws
+OPENRAVEPY_API dReal* GetWriteableArrayData(py::object oarray, size_t numvalues);
+
+/// \brief returns a read-only array that refers to pdata instead of copying it. The array keeps a reference to obase, which should own the data
+OPENRAVEPY_API py::object toPyArrayView(const dReal* pdata, const std::vector<npy_intp>& dims, py::object obase);
+
 
 struct DummyStruct {};
 
@@ -485,6 +491,7 @@ public:
     void SetShow(bool bshow) {
         _handle->SetShow(bshow);
     }
+    bool SetPoints(py::object opoints, py::object ocolors=py::none_());
     void Close()
     {
         _handle.reset();
@@ -662,6 +669,10 @@ public:
     bool SupportsJSONCommand(const string& cmd);
     py::object SendJSONCommand(const string& cmd, py::object input, bool releasegil=false, bool lockenv=false);
 
+    /// \brief returns a dict of counter name to (count, total)
+    py::object GetPerfCounters();
+    void ResetPerfCounters();
+
     virtual py::object GetReadableInterfaces();
     virtual py::object GetReadableInterface(const std::string& xmltag);
 
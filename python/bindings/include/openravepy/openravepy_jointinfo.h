@@ -231,6 +231,10 @@ public:
 
         bool InitCollisionMesh(float fTessellation=1.0);
         uint8_t GetSideWallExists() const;
+        int InsertVoxelPoints(object opoints);
+        int ClearVoxelPoints(object opoints);
+        void ClearVoxels();
+        dReal GetVoxelResolution() const;
 
         object GetCollisionMesh();
         object ComputeAABB(object otransform) const;
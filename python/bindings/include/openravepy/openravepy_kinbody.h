@@ -192,6 +192,7 @@ public:
     py::object GetTransform() const;
     py::object GetTransformPose() const;
     py::object GetLinkTransformations(bool returndoflastvlaues=false) const;
+    py::object GetLinkTransformationsArrays() const;
     void SetLinkTransformations(py::object transforms, py::object odoflastvalues=py::none_());
     void SetLinkVelocities(py::object ovelocities);
     py::object GetLinkEnableStates() const;
@@ -232,6 +233,22 @@ public:
     void SetDOFTorques(py::object otorques, bool bAdd);
     py::object ComputeJacobianTranslation(int index, py::object oposition, py::object oindices=py::none_());
     py::object ComputeJacobianAxisAngle(int index, py::object oindices=py::none_());
+    py::object ComputeJacobians(py::object olinkindices, py::object opositions);
+    py::object ComputeJacobiansAndHessians(py::object olinkindices, py::object opositions);
+
+    /// \brief batched versions that release the GIL for the whole batch.
+    ///
+    /// ovalues is a N x len(indices) array of dof values, every row is set and the results are written into the preallocated
+    /// writeable C contiguous output arrays. The state of the body is restored afterwards. The arrays must not be modified by other threads during the call.
+    //@{
+    /// \param otransforms N x numlinks x 7 array of the link poses as [qw,qx,qy,qz,x,y,z]
+    void ComputeLinkTransformationsBatch(py::object ovalues, py::object otransforms, py::object oindices=py::none_());
+    /// \param olocalposition the point on the link in the coordinate system of the link, so it moves with the link
+    /// \param ojacobians N x 3 x len(indices) array of the translation jacobians of the point
+    void ComputeJacobianTranslationBatch(int index, py::object olocalposition, py::object ovalues, py::object ojacobians, py::object oindices=py::none_());
+    /// \param ocollisions array with N bool or uint8 values, set to 1 if the body is in collision with the environment or itself
+    void CheckCollisionBatch(py::object ovalues, py::object ocollisions, py::object oindices=py::none_(), bool bCheckSelfCollision=true);
+    //@}
     py::object CalculateJacobian(int index, py::object oposition);
     py::object CalculateRotationJacobian(int index, py::object q) const;
     py::object CalculateAngularVelocityJacobian(int index) const;
@@ -268,6 +285,8 @@ public:
     py::object GetNonAdjacentLinks(int adjacentoptions) const;
     void SetAdjacentLinks(int linkindex0, int linkindex1);
     py::object GetAdjacentLinks() const;
+    void SetUnreachableLinkPairs(py::object olinkpairs);
+    py::object GetUnreachableLinkPairs() const;
     py::object GetManageData() const;
     int GetUpdateStamp() const;
     std::string serialize(int options) const;
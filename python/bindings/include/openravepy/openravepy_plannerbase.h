@@ -30,6 +30,8 @@ public:
     PyPlannerProgress(const PlannerBase::PlannerProgress& progress);
     std::string __str__();
     int _iteration = 0;
+    dReal _fCost = 0;
+    uint32_t _nElapsedTime = 0;
 };
 
 
@@ -45,6 +47,7 @@ public:
     object errorOrigin = py::none_();
     object jointValues = py::none_();
     object ikparam = py::none_();
+    object statistics = py::none_(); ///< dict of the PlannerStatistics fields if the planner filled them
     uint32_t statusCode = 0;
 };
 
@@ -93,6 +96,8 @@ public:
         void SetConfigResolution(object o);
 
         void SetMaxIterations(int nMaxIterations);
+        void SetSegmentCheckOrder(int nSegmentCheckOrder);
+        void SetDeterministicParallel(bool bDeterministicParallel);
 
         object CheckPathAllConstraints(object oq0, object oq1, object odq0, object odq1, dReal timeelapsed, IntervalType interval, uint32_t options=0xffff, bool filterreturn=false);
 
@@ -121,6 +121,9 @@ public:
 
         bool CheckEndEffectorCollision(object otrans, PyCollisionReportPtr pyreport=PyCollisionReportPtr(), int numredundantsamples=0) const;
 
+        /// \brief returns a list of bools, true for every transform or ik parameterization of oposes where the gripper is in collision
+        object CheckEndEffectorCollisions(object oposes, int numredundantsamples=0) const;
+
         bool CheckEndEffectorSelfCollision(PyCollisionReportPtr pyreport) const;
         bool CheckEndEffectorSelfCollision(object otrans, PyCollisionReportPtr pyreport=PyCollisionReportPtr(), int numredundantsamples=0, bool ignoreManipulatorLinks=false) const;
         bool CheckIndependentCollision() const;
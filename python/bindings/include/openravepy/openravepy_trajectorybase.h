@@ -52,6 +52,11 @@ public:
 
     object SamplePoints2D(object otimes, PyConfigurationSpecificationPtr pyspec) const;
 
+    /// \brief samples the times into oarray, a writeable C contiguous array with len(otimes)*dof values, instead of allocating a new array
+    void SamplePointsToArray(object otimes, object oarray) const;
+
+    void SamplePointsToArray(object otimes, object oarray, PyConfigurationSpecificationPtr pyspec) const;
+
     object GetConfigurationSpecification() const;
 
     size_t GetNumWaypoints() const;
@@ -102,6 +107,9 @@ public:
     object GetWaypoints2D(size_t startindex, size_t endindex, OPENRAVE_SHARED_PTR<ConfigurationSpecification::Group> pygroup) const;
     object GetAllWaypoints2D(OPENRAVE_SHARED_PTR<ConfigurationSpecification::Group> pygroup) const;
     object GetWaypoint(int index, OPENRAVE_SHARED_PTR<ConfigurationSpecification::Group> pygroup) const;
+
+protected:
+    mutable std::vector<dReal> _vsampledata; ///< cache for SamplePointsToArray
 };
 
 } // namespace openravepy
@@ -81,6 +81,7 @@ void PyCollisionReport::init(PyEnvironmentBasePtr pyenv)
     minDistance = report->minDistance;
     numWithinTol = report->numWithinTol;
     nKeepPrevious = report->nKeepPrevious;
+    bTruncated = report->bTruncated;
     if( !!report->plink1 ) {
         plink1 = openravepy::toPyKinBodyLink(OPENRAVE_CONST_POINTER_CAST<KinBody::Link>(report->plink1), pyenv);
     }
@@ -113,6 +114,11 @@ void PyCollisionReport::init(PyEnvironmentBasePtr pyenv)
     vLinkColliding = newLinkColliding;
 }
 
+void PyCollisionReport::Reserve(int numcontacts, int numlinkpairs, bool bfixedcapacity)
+{
+    report->Reserve(numcontacts, numlinkpairs, bfixedcapacity);
+}
+
 std::string PyCollisionReport::__str__()
 {
     return report->__str__();
@@ -700,6 +706,7 @@ PyCollisionCheckerBasePtr RaveCreateCollisionChecker(PyEnvironmentBasePtr pyenv,
 
 #ifndef USE_PYBIND11_PYTHON_BINDINGS
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionRays_overloads, CheckCollisionRays, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ReserveCollisionReport_overloads, Reserve, 2, 3)
 #endif
 
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
@@ -766,6 +773,16 @@ void init_openravepy_collisionchecker()
     .def_readonly("contacts",&PyCollisionReport::contacts)
     .def_readonly("vLinkColliding",&PyCollisionReport::vLinkColliding)
     .def_readonly("nKeepPrevious", &PyCollisionReport::nKeepPrevious)
+    .def_readonly("bTruncated", &PyCollisionReport::bTruncated)
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+    .def("Reserve", &PyCollisionReport::Reserve,
+         "numcontacts"_a,
+         "numlinkpairs"_a,
+         "fixedcapacity"_a = true,
+         DOXY_FN(CollisionReport, Reserve))
+#else
+    .def("Reserve", &PyCollisionReport::Reserve, ReserveCollisionReport_overloads(PY_ARGS("numcontacts", "numlinkpairs", "fixedcapacity") DOXY_FN(CollisionReport, Reserve)))
+#endif
     .def("__str__",&PyCollisionReport::__str__)
     .def("__unicode__",&PyCollisionReport::__unicode__)
     ;
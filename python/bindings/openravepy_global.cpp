@@ -129,6 +129,26 @@ PyXMLReadablePtr pyCreateStringXMLReadable(const std::string& xmlid, const std::
 
 } // end namespace xmlreaders
 
+bool PyGraphHandle::SetPoints(object opoints, object ocolors)
+{
+    if( !_handle ) {
+        return false;
+    }
+    std::vector<float> vpoints, vcolors;
+    size_t numpoints = PyEnvironmentBase::_getGraphPoints(opoints,vpoints);
+    if( numpoints <= 0 ) {
+        throw OpenRAVEException(_("points cannot be empty"),ORE_InvalidArguments);
+    }
+    if( IS_PYTHONOBJECT_NONE(ocolors) ) {
+        return _handle->SetPoints(vpoints.data(),numpoints,sizeof(float)*3);
+    }
+    size_t numcolors = PyEnvironmentBase::_getGraphColors(ocolors,vcolors);
+    if( numpoints != numcolors ) {
+        throw OpenRAVEException(boost::str(boost::format(_("number of points (%d) need to match number of colors (%d)"))%numpoints%numcolors));
+    }
+    return _handle->SetPoints(vpoints.data(),numpoints,sizeof(float)*3,vcolors.data(),vcolors.size() == 4*numcolors);
+}
+
 object toPyGraphHandle(const GraphHandlePtr p)
 {
     if( !p ) {
@@ -871,6 +891,13 @@ int pyRaveInitialize(bool bLoadAllPlugins=true, object olevel=py::none_())
     return OpenRAVE::RaveInitialize(bLoadAllPlugins,pyGetIntFromPy(olevel, Level_Info));
 }
 
+object pyRaveGetProfilingChromeTrace()
+{
+    std::stringstream ss;
+    OpenRAVE::RaveWriteProfilingChromeTrace(ss);
+    return ConvertStringToUnicode(ss.str());
+}
+
 void pyRaveSetDataAccess(object oaccess)
 {
     OpenRAVE::RaveSetDataAccess(pyGetIntFromPy(oaccess, Level_Info));
@@ -1227,6 +1254,7 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ExtractAffineValues_overloads, PyConfigur
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ExtractJointValues_overloads, PyConfigurationSpecification::ExtractJointValues, 3, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(RemoveGroups_overloads, PyConfigurationSpecification::RemoveGroups, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Serialize_overloads, Serialize, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetPoints_overloads, PyGraphHandle::SetPoints, 1, 2)
 #endif // USE_PYBIND11_PYTHON_BINDINGS
 
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
@@ -1326,6 +1354,7 @@ void init_openravepy_global()
     enum_<PhysicsEngineOptions>("PhysicsEngineOptions" DOXY_ENUM(PhysicsEngineOptions))
 #endif
     .value("SelfCollisions",PEO_SelfCollisions)
+    .value("AutoDisable",PEO_AutoDisable)
     ;
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
     enum_<IntervalType>(m, "Interval", py::arithmetic() DOXY_ENUM(IntervalType))
@@ -1370,6 +1399,15 @@ void init_openravepy_global()
 #endif
     .def("SetTransform",&PyGraphHandle::SetTransform,DOXY_FN(GraphHandle,SetTransform))
     .def("SetShow",&PyGraphHandle::SetShow,DOXY_FN(GraphHandle,SetShow))
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+    .def("SetPoints",&PyGraphHandle::SetPoints,
+         "points"_a,
+         "colors"_a = py::none_(),
+         DOXY_FN(GraphHandle,SetPoints)
+         )
+#else
+    .def("SetPoints",&PyGraphHandle::SetPoints,SetPoints_overloads(PY_ARGS("points","colors") DOXY_FN(GraphHandle,SetPoints)))
+#endif
     .def("Close",&PyGraphHandle::Close,DOXY_FN(GraphHandle,Close))
     ;
 
@@ -1755,6 +1793,19 @@ void init_openravepy_global()
 #else
     def("RaveGetDataAccess",OpenRAVE::RaveGetDataAccess, DOXY_FN1(RaveGetDataAccess));
 #endif
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+    m.def("RaveSetProfilingEnabled",OpenRAVE::RaveSetProfilingEnabled, PY_ARGS("enable") DOXY_FN1(RaveSetProfilingEnabled));
+    m.def("RaveIsProfilingEnabled",OpenRAVE::RaveIsProfilingEnabled, DOXY_FN1(RaveIsProfilingEnabled));
+    m.def("RaveClearProfilingSpans",OpenRAVE::RaveClearProfilingSpans, DOXY_FN1(RaveClearProfilingSpans));
+    m.def("RaveSaveProfilingChromeTrace",OpenRAVE::RaveSaveProfilingChromeTrace, PY_ARGS("filename") DOXY_FN1(RaveSaveProfilingChromeTrace));
+    m.def("RaveGetProfilingChromeTrace",openravepy::pyRaveGetProfilingChromeTrace, "Returns the recorded profiling spans as a Chrome trace JSON string");
+#else
+    def("RaveSetProfilingEnabled",OpenRAVE::RaveSetProfilingEnabled, PY_ARGS("enable") DOXY_FN1(RaveSetProfilingEnabled));
+    def("RaveIsProfilingEnabled",OpenRAVE::RaveIsProfilingEnabled, DOXY_FN1(RaveIsProfilingEnabled));
+    def("RaveClearProfilingSpans",OpenRAVE::RaveClearProfilingSpans, DOXY_FN1(RaveClearProfilingSpans));
+    def("RaveSaveProfilingChromeTrace",OpenRAVE::RaveSaveProfilingChromeTrace, PY_ARGS("filename") DOXY_FN1(RaveSaveProfilingChromeTrace));
+    def("RaveGetProfilingChromeTrace",openravepy::pyRaveGetProfilingChromeTrace, "Returns the recorded profiling spans as a Chrome trace JSON string");
+#endif
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
     m.def("RaveGetDefaultViewerType", OpenRAVE::RaveGetDefaultViewerType, DOXY_FN1(RaveGetDefaultViewerType));
 #else
@@ -157,7 +157,10 @@ PyIkReturnPtr PyIkSolverBase::Solve(object oparam, object oq0, int filteroptions
     if( !ExtractIkParameterization(oparam,ikparam) ) {
         throw openrave_exception(_("first argument to IkSolver.Solve needs to be IkParameterization"),ORE_InvalidArguments);
     }
-    _pIkSolver->Solve(ikparam, q0, filteroptions, preturn);
+    {
+        openravepy::PythonThreadSaver threadsaver; // custom filters re-acquire the GIL
+        _pIkSolver->Solve(ikparam, q0, filteroptions, preturn);
+    }
     return pyreturn;
 }
 
@@ -169,7 +172,10 @@ object PyIkSolverBase::SolveAll(object oparam, int filteroptions)
     if( !ExtractIkParameterization(oparam,ikparam) ) {
         throw openrave_exception(_("first argument to IkSolver.Solve needs to be IkParameterization"),ORE_InvalidArguments);
     }
-    _pIkSolver->SolveAll(ikparam, filteroptions, vikreturns);
+    {
+        openravepy::PythonThreadSaver threadsaver;
+        _pIkSolver->SolveAll(ikparam, filteroptions, vikreturns);
+    }
     FOREACH(itikreturn,vikreturns) {
         pyreturns.append(py::to_object(PyIkReturnPtr(new PyIkReturn(*itikreturn))));
     }
@@ -191,7 +197,10 @@ PyIkReturnPtr PyIkSolverBase::Solve(object oparam, object oq0, object oFreeParam
     if( !ExtractIkParameterization(oparam,ikparam) ) {
         throw openrave_exception(_("first argument to IkSolver.Solve needs to be IkParameterization"),ORE_InvalidArguments);
     }
-    _pIkSolver->Solve(ikparam, q0, vFreeParameters,filteroptions, preturn);
+    {
+        openravepy::PythonThreadSaver threadsaver;
+        _pIkSolver->Solve(ikparam, q0, vFreeParameters,filteroptions, preturn);
+    }
     return pyreturn;
 }
 
@@ -207,13 +216,41 @@ object PyIkSolverBase::SolveAll(object oparam, object oFreeParameters, int filte
     if( !IS_PYTHONOBJECT_NONE(oFreeParameters) ) {
         vFreeParameters = ExtractArray<dReal>(oFreeParameters);
     }
-    _pIkSolver->SolveAll(ikparam, vFreeParameters, filteroptions, vikreturns);
+    {
+        openravepy::PythonThreadSaver threadsaver;
+        _pIkSolver->SolveAll(ikparam, vFreeParameters, filteroptions, vikreturns);
+    }
     FOREACH(itikreturn,vikreturns) {
         pyreturns.append(py::to_object(PyIkReturnPtr(new PyIkReturn(*itikreturn))));
     }
     return pyreturns;
 }
 
+object PyIkSolverBase::SolveAllBatch(object oparams, int filteroptions)
+{
+    size_t numparams = len(oparams);
+    std::vector<IkParameterization> vikparams(numparams);
+    for(size_t i = 0; i < numparams; ++i) {
+        if( !ExtractIkParameterization(oparams[i],vikparams[i]) ) {
+            throw openrave_exception(_("first argument to IkSolver.SolveAllBatch needs to be a list of IkParameterization"),ORE_InvalidArguments);
+        }
+    }
+    std::vector< std::vector<IkReturnPtr> > vvikreturns;
+    {
+        openravepy::PythonThreadSaver threadsaver;
+        _pIkSolver->SolveAllBatch(vikparams, filteroptions, vvikreturns);
+    }
+    py::list pyallreturns;
+    FOREACH(itikreturns,vvikreturns) {
+        py::list pyreturns;
+        FOREACH(itikreturn,*itikreturns) {
+            pyreturns.append(py::to_object(PyIkReturnPtr(new PyIkReturn(*itikreturn))));
+        }
+        pyallreturns.append(pyreturns);
+    }
+    return pyallreturns;
+}
+
 PyIkReturnPtr PyIkSolverBase::CallFilters(object oparam)
 {
     PyIkReturnPtr pyreturn(new PyIkReturn(IKRA_Reject));
@@ -361,6 +398,7 @@ void init_openravepy_iksolver()
         .def("Solve",SolveFree, PY_ARGS("ikparam","q0","freeparameters", "filteroptions") DOXY_FN(IkSolverBase, Solve "const IkParameterization&; const std::vector; const std::vector; int; IkReturnPtr"))
         .def("SolveAll",SolveAll, PY_ARGS("ikparam","filteroptions") DOXY_FN(IkSolverBase, SolveAll "const IkParameterization&; int; std::vector<IkReturnPtr>"))
         .def("SolveAll",SolveAllFree, PY_ARGS("ikparam","freeparameters","filteroptions") DOXY_FN(IkSolverBase, SolveAll "const IkParameterization&; const std::vector; int; std::vector<IkReturnPtr>"))
+        .def("SolveAllBatch",&PyIkSolverBase::SolveAllBatch, PY_ARGS("ikparams","filteroptions") DOXY_FN(IkSolverBase, SolveAllBatch))
         .def("GetNumFreeParameters",&PyIkSolverBase::GetNumFreeParameters, DOXY_FN(IkSolverBase,GetNumFreeParameters))
         .def("GetFreeParameters",&PyIkSolverBase::GetFreeParameters, DOXY_FN(IkSolverBase,GetFreeParameters))
         .def("Supports",&PyIkSolverBase::Supports, PY_ARGS("iktype") DOXY_FN(IkSolverBase,Supports))
@@ -353,6 +353,36 @@ void SetReturnTransformQuaternions(bool bset) {
     s_bReturnTransformQuaternions = bset;
 }
 
+dReal* GetWriteableArrayData(object oarray, size_t numvalues)
+{
+    PyObject* pyarray = oarray.ptr();
+    if( !PyArray_Check(pyarray) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("data needs to be a numpy array"), ORE_InvalidArguments);
+    }
+    PyArrayObject* pyarrayobject = reinterpret_cast<PyArrayObject*>(pyarray);
+    if( !PyArray_ISCARRAY(pyarrayobject) || !PyArray_ISFLOAT(pyarrayobject) || PyArray_ITEMSIZE(pyarrayobject) != sizeof(dReal) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("data needs to be a writeable C contiguous array of %d byte floats"), sizeof(dReal), ORE_InvalidArguments);
+    }
+    if( (size_t)PyArray_SIZE(pyarrayobject) != numvalues ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("data has %d values, but %d values are needed"), (size_t)PyArray_SIZE(pyarrayobject)%numvalues, ORE_InvalidArguments);
+    }
+    return reinterpret_cast<dReal*>(PyArray_DATA(pyarrayobject));
+}
+
+object toPyArrayView(const dReal* pdata, const std::vector<npy_intp>& dims, object obase)
+{
+    PyObject *pyarray = PyArray_SimpleNewFromData(dims.size(), const_cast<npy_intp*>(&dims[0]), sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT, const_cast<dReal*>(pdata));
+    PyArrayObject* pyarrayobject = reinterpret_cast<PyArrayObject*>(pyarray);
+    PyArray_CLEARFLAGS(pyarrayobject, NPY_ARRAY_WRITEABLE);
+    Py_INCREF(obase.ptr());
+    PyArray_SetBaseObject(pyarrayobject, obase.ptr()); // steals the reference
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+    return py::reinterpret_steal<object>(pyarray);
+#else
+    return object(py::handle<>(pyarray));
+#endif
+}
+
 Transform ExtractTransform(const object& oraw)
 {
     return ExtractTransformType<dReal>(oraw);
@@ -870,6 +900,22 @@ object PyInterfaceBase::GetReadableInterfaces()
     return ointerfaces;
 }
 
+object PyInterfaceBase::GetPerfCounters()
+{
+    std::map<std::string, PerfCounterPtr> mapcounters;
+    _pbase->GetPerfCounters(mapcounters);
+    py::dict ocounters;
+    FOREACHC(it, mapcounters) {
+        ocounters[it->first] = py::make_tuple(it->second->GetCount(), it->second->GetTotal());
+    }
+    return ocounters;
+}
+
+void PyInterfaceBase::ResetPerfCounters()
+{
+    _pbase->ResetPerfCounters();
+}
+
 object PyInterfaceBase::GetReadableInterface(const std::string& xmltag)
 {
     return toPyXMLReadable(_pbase->GetReadableInterface(xmltag));
@@ -982,7 +1028,12 @@ PyEnvironmentBasePtr PyEnvironmentBase::CloneSelf(int options)
 //                strviewer = _penv->GetViewer()->GetXMLId();
 //            }
 //        }
-    PyEnvironmentBasePtr pnewenv(new PyEnvironmentBase(_penv->CloneSelf(options)));
+    EnvironmentBasePtr pnewpenv;
+    {
+        openravepy::PythonThreadSaver threadsaver;
+        pnewpenv = _penv->CloneSelf(options);
+    }
+    PyEnvironmentBasePtr pnewenv(new PyEnvironmentBase(pnewpenv));
 //        if( strviewer.size() > 0 ) {
 //            pnewenv->SetViewer(strviewer);
 //        }
@@ -1000,7 +1051,14 @@ void PyEnvironmentBase::Clone(PyEnvironmentBasePtr pyreference, int options)
             }
         }
     }
-    _penv->Clone(pyreference->GetEnv(),options);
+    EnvironmentBasePtr preference = pyreference->GetEnv();
+    openravepy::PythonThreadSaver threadsaver;
+    _penv->Clone(preference,options);
+}
+
+void PyEnvironmentBase::SynchronizeBodies(PyEnvironmentBasePtr pyreference)
+{
+    _penv->SynchronizeBodies(pyreference->GetEnv());
 }
 
 bool PyEnvironmentBase::SetCollisionChecker(PyCollisionCheckerBasePtr pchecker)
@@ -1604,6 +1662,18 @@ void PyEnvironmentBase::Add(PyInterfaceBasePtr pinterface, bool bAnonymous, cons
     _penv->Add(pinterface->GetInterfaceBase(), bAnonymous, cmdargs);
 }
 
+void PyEnvironmentBase::AddBodies(object obodies, bool bAnonymous)
+{
+    std::vector<KinBodyPtr> vbodies;
+    vbodies.reserve(len(obodies));
+    for(size_t i = 0; i < (size_t)len(obodies); ++i) {
+        PyKinBodyPtr pbody = extract<PyKinBodyPtr>(obodies[i]);
+        CHECK_POINTER(pbody);
+        vbodies.push_back(openravepy::GetKinBody(pbody));
+    }
+    _penv->AddBodies(vbodies, bAnonymous);
+}
+
 void PyEnvironmentBase::AddKinBody(PyKinBodyPtr pbody) {
     CHECK_POINTER(pbody); _penv->Add(openravepy::GetKinBody(pbody));
 }
@@ -1641,6 +1711,18 @@ bool PyEnvironmentBase::RemoveKinBodyByName(const std::string& name) {
     return _penv->RemoveKinBodyByName(name);
 }
 
+int PyEnvironmentBase::RemoveBodies(object obodies)
+{
+    std::vector<KinBodyPtr> vbodies;
+    vbodies.reserve(len(obodies));
+    for(size_t i = 0; i < (size_t)len(obodies); ++i) {
+        PyKinBodyPtr pbody = extract<PyKinBodyPtr>(obodies[i]);
+        CHECK_POINTER(pbody);
+        vbodies.push_back(openravepy::GetKinBody(pbody));
+    }
+    return _penv->RemoveBodies(vbodies);
+}
+
 object PyEnvironmentBase::GetKinBody(const string &name)
 {
     KinBodyPtr pbody = _penv->GetKinBody(name);
@@ -1839,6 +1921,56 @@ bool PyEnvironmentBase::TryLock()
     return bSuccess;
 }
 
+void PyEnvironmentBase::SetMutexInstrumentationEnabled(bool bEnable)
+{
+    _penv->GetMutex().SetInstrumentationEnabled(bEnable);
+}
+
+bool PyEnvironmentBase::IsMutexInstrumentationEnabled()
+{
+    return _penv->GetMutex().IsInstrumentationEnabled();
+}
+
+object PyEnvironmentBase::GetMutexStatistics()
+{
+    std::vector<EnvironmentMutexStatistics> vstatistics;
+    _penv->GetMutex().GetStatistics(vstatistics);
+    py::list ostatistics;
+    FOREACHC(itstatistics, vstatistics) {
+        py::list owaithistogram, oholdhistogram;
+        for(size_t i = 0; i < itstatistics->vWaitHistogram.size(); ++i) {
+            owaithistogram.append(itstatistics->vWaitHistogram[i]);
+            oholdhistogram.append(itstatistics->vHoldHistogram[i]);
+        }
+        py::dict ostat;
+        ostat["callsite"] = itstatistics->callsite;
+        ostat["numAcquisitions"] = itstatistics->numAcquisitions;
+        ostat["totalWaitTime"] = itstatistics->totalWaitTime;
+        ostat["maxWaitTime"] = itstatistics->maxWaitTime;
+        ostat["totalHoldTime"] = itstatistics->totalHoldTime;
+        ostat["maxHoldTime"] = itstatistics->maxHoldTime;
+        ostat["waitHistogram"] = owaithistogram;
+        ostat["holdHistogram"] = oholdhistogram;
+        ostatistics.append(ostat);
+    }
+    return ostatistics;
+}
+
+void PyEnvironmentBase::ResetMutexStatistics()
+{
+    _penv->GetMutex().ResetStatistics();
+}
+
+object PyEnvironmentBase::GetMutexHolder()
+{
+    std::string threadid, callsite;
+    uint64_t heldtime = 0;
+    if( !_penv->GetMutex().GetHolder(threadid, callsite, heldtime) ) {
+        return py::none_();
+    }
+    return py::make_tuple(threadid, callsite, heldtime);
+}
+
 
 bool PyEnvironmentBase::Lock(float timeout)
 {
@@ -2093,6 +2225,32 @@ object PyEnvironmentBase::GetBodies()
     return bodies;
 }
 
+object PyEnvironmentBase::GetBodiesInAABB(object oaabb)
+{
+    std::vector<KinBodyPtr> vbodies;
+    _penv->GetBodiesInAABB(ExtractAABB(oaabb), vbodies);
+    py::list bodies;
+    FOREACHC(itbody, vbodies) {
+        if( (*itbody)->IsRobot() ) {
+            bodies.append(openravepy::toPyRobot(RaveInterfaceCast<RobotBase>(*itbody),shared_from_this()));
+        }
+        else {
+            bodies.append(openravepy::toPyKinBody(*itbody,shared_from_this()));
+        }
+    }
+    return bodies;
+}
+
+void PyEnvironmentBase::SetSpatialGridCellSize(dReal fCellSize)
+{
+    _penv->SetSpatialGridCellSize(fCellSize);
+}
+
+dReal PyEnvironmentBase::GetSpatialGridCellSize() const
+{
+    return _penv->GetSpatialGridCellSize();
+}
+
 object PyEnvironmentBase::GetRobots()
 {
     std::vector<RobotBasePtr> vrobots;
@@ -2389,6 +2547,7 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(drawtrimesh_overloads, drawtrimesh, 1, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SendCommand_overloads, SendCommand, 1, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SendJSONCommand_overloads, SendJSONCommand, 2, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Add_overloads, Add, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(AddBodies_overloads, AddBodies, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Save_overloads, Save, 1, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(WriteToMemory_overloads, WriteToMemory, 1, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetUserData_overloads, GetUserData, 0, 1)
@@ -2597,6 +2756,8 @@ Because race conditions can pop up when trying to lock the openrave environment
         .def("GetReadableInterfaces",&PyInterfaceBase::GetReadableInterfaces, DOXY_FN(InterfaceBase,GetReadableInterfaces))
         .def("GetReadableInterface",&PyInterfaceBase::GetReadableInterface, DOXY_FN(InterfaceBase,GetReadableInterface))
         .def("SetReadableInterface",&PyInterfaceBase::SetReadableInterface, PY_ARGS("xmltag","xmlreadable") DOXY_FN(InterfaceBase,SetReadableInterface))
+        .def("GetPerfCounters",&PyInterfaceBase::GetPerfCounters, "Returns a dict of the performance counters of the interface, mapping the counter name to (count, total)")
+        .def("ResetPerfCounters",&PyInterfaceBase::ResetPerfCounters, DOXY_FN(InterfaceBase,ResetPerfCounters))
         .def("__repr__", &PyInterfaceBase::__repr__)
         .def("__str__", &PyInterfaceBase::__str__)
         .def("__unicode__", &PyInterfaceBase::__unicode__)
@@ -2671,6 +2832,7 @@ Because race conditions can pop up when trying to lock the openrave environment
                      .def("Destroy",&PyEnvironmentBase::Destroy, DOXY_FN(EnvironmentBase,Destroy))
                      .def("CloneSelf",&PyEnvironmentBase::CloneSelf, PY_ARGS("options") DOXY_FN(EnvironmentBase,CloneSelf))
                      .def("Clone",&PyEnvironmentBase::Clone, PY_ARGS("reference","options") DOXY_FN(EnvironmentBase,Clone))
+                     .def("SynchronizeBodies",&PyEnvironmentBase::SynchronizeBodies, PY_ARGS("reference") DOXY_FN(EnvironmentBase,SynchronizeBodies))
                      .def("SetCollisionChecker",&PyEnvironmentBase::SetCollisionChecker, PY_ARGS("collisionchecker") DOXY_FN(EnvironmentBase,SetCollisionChecker))
                      .def("GetCollisionChecker",&PyEnvironmentBase::GetCollisionChecker, DOXY_FN(EnvironmentBase,GetCollisionChecker))
 
@@ -2772,6 +2934,15 @@ Because race conditions can pop up when trying to lock the openrave environment
                           )
 #else
                      .def("Add", &PyEnvironmentBase::Add, Add_overloads(PY_ARGS("interface","anonymous","cmdargs") DOXY_FN(EnvironmentBase,Add)))
+#endif
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+                     .def("AddBodies", &PyEnvironmentBase::AddBodies,
+                          "bodies"_a,
+                          "anonymous"_a = false,
+                          DOXY_FN(EnvironmentBase, AddBodies)
+                          )
+#else
+                     .def("AddBodies", &PyEnvironmentBase::AddBodies, AddBodies_overloads(PY_ARGS("bodies","anonymous") DOXY_FN(EnvironmentBase,AddBodies)))
 #endif
                      .def("AddKinBody",addkinbody1, PY_ARGS("body") DOXY_FN(EnvironmentBase,AddKinBody))
                      .def("AddKinBody",addkinbody2, PY_ARGS("body","anonymous") DOXY_FN(EnvironmentBase,AddKinBody))
@@ -2783,6 +2954,7 @@ Because race conditions can pop up when trying to lock the openrave environment
                      .def("RemoveKinBody",&PyEnvironmentBase::RemoveKinBody, PY_ARGS("body") DOXY_FN(EnvironmentBase,RemoveKinBody))
                      .def("RemoveKinBodyByName",&PyEnvironmentBase::RemoveKinBodyByName, PY_ARGS("name") DOXY_FN(EnvironmentBase,RemoveKinBodyByName))
                      .def("Remove",&PyEnvironmentBase::Remove, PY_ARGS("interface") DOXY_FN(EnvironmentBase,Remove))
+                     .def("RemoveBodies",&PyEnvironmentBase::RemoveBodies, PY_ARGS("bodies") DOXY_FN(EnvironmentBase,RemoveBodies))
                      .def("GetKinBody",&PyEnvironmentBase::GetKinBody, PY_ARGS("name") DOXY_FN(EnvironmentBase,GetKinBody))
                      .def("GetRobot",&PyEnvironmentBase::GetRobot, PY_ARGS("name") DOXY_FN(EnvironmentBase,GetRobot))
                      .def("GetSensor",&PyEnvironmentBase::GetSensor, PY_ARGS("name") DOXY_FN(EnvironmentBase,GetSensor))
@@ -2821,6 +2993,11 @@ Because race conditions can pop up when trying to lock the openrave environment
                      .def("Lock",Lock2,PY_ARGS("timeout") "Locks the environment mutex with a timeout.")
                      .def("Unlock",&PyEnvironmentBase::Unlock,"Unlocks the environment mutex.")
                      .def("TryLock",&PyEnvironmentBase::TryLock,"Tries to locks the environment mutex, returns false if it failed.")
+                     .def("SetMutexInstrumentationEnabled",&PyEnvironmentBase::SetMutexInstrumentationEnabled, PY_ARGS("enable") DOXY_FN(EnvironmentMutex,SetInstrumentationEnabled))
+                     .def("IsMutexInstrumentationEnabled",&PyEnvironmentBase::IsMutexInstrumentationEnabled, DOXY_FN(EnvironmentMutex,IsInstrumentationEnabled))
+                     .def("GetMutexStatistics",&PyEnvironmentBase::GetMutexStatistics, "Returns a list of dicts with the wait and hold times (ns) and their log2(us) histograms of every call site that locked the environment mutex while the instrumentation was enabled.")
+                     .def("ResetMutexStatistics",&PyEnvironmentBase::ResetMutexStatistics, DOXY_FN(EnvironmentMutex,ResetStatistics))
+                     .def("GetMutexHolder",&PyEnvironmentBase::GetMutexHolder, "Returns (threadid, callsite, heldtime) of the thread holding the environment mutex, or None if not known.")
                      .def("LockPhysics", Lock1, "Locks the environment mutex.")
                      .def("LockPhysics", Lock2, PY_ARGS("timeout") "Locks the environment mutex with a timeout.")
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
@@ -2909,6 +3086,9 @@ Because race conditions can pop up when trying to lock the openrave environment
 #endif
                      .def("GetRobots",&PyEnvironmentBase::GetRobots, DOXY_FN(EnvironmentBase,GetRobots))
                      .def("GetBodies",&PyEnvironmentBase::GetBodies, DOXY_FN(EnvironmentBase,GetBodies))
+                     .def("GetBodiesInAABB",&PyEnvironmentBase::GetBodiesInAABB, PY_ARGS("aabb") DOXY_FN(EnvironmentBase,GetBodiesInAABB))
+                     .def("SetSpatialGridCellSize",&PyEnvironmentBase::SetSpatialGridCellSize, PY_ARGS("cellsize") DOXY_FN(EnvironmentBase,SetSpatialGridCellSize))
+                     .def("GetSpatialGridCellSize",&PyEnvironmentBase::GetSpatialGridCellSize, DOXY_FN(EnvironmentBase,GetSpatialGridCellSize))
                      .def("GetSensors",&PyEnvironmentBase::GetSensors, DOXY_FN(EnvironmentBase,GetSensors))
                      .def("UpdatePublishedBodies",&PyEnvironmentBase::UpdatePublishedBodies, DOXY_FN(EnvironmentBase,UpdatePublishedBodies))
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
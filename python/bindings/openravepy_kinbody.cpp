@@ -971,6 +971,35 @@ void PyLink::PyGeometry::SetCollisionMesh(object pytrimesh) {
 bool PyLink::PyGeometry::InitCollisionMesh(float fTessellation) {
     return _pgeometry->InitCollisionMesh(fTessellation);
 }
+/// \brief extracts a Nx3 array of points
+static void _ExtractVoxelPoints(object opoints, std::vector<Vector>& vpoints)
+{
+    std::vector<dReal> vvalues = ExtractArray<dReal>(opoints.attr("flat"));
+    if( vvalues.size() % 3 ) {
+        throw openrave_exception(_("points must be a Nx3 array"), ORE_InvalidArguments);
+    }
+    vpoints.resize(vvalues.size()/3);
+    for(size_t i = 0; i < vpoints.size(); ++i) {
+        vpoints[i] = Vector(vvalues[3*i], vvalues[3*i+1], vvalues[3*i+2]);
+    }
+}
+
+int PyLink::PyGeometry::InsertVoxelPoints(object opoints) {
+    std::vector<Vector> vpoints;
+    _ExtractVoxelPoints(opoints, vpoints);
+    return _pgeometry->InsertVoxelPoints(vpoints);
+}
+int PyLink::PyGeometry::ClearVoxelPoints(object opoints) {
+    std::vector<Vector> vpoints;
+    _ExtractVoxelPoints(opoints, vpoints);
+    return _pgeometry->ClearVoxelPoints(vpoints);
+}
+void PyLink::PyGeometry::ClearVoxels() {
+    _pgeometry->ClearVoxels();
+}
+dReal PyLink::PyGeometry::GetVoxelResolution() const {
+    return _pgeometry->GetVoxelResolution();
+}
 uint8_t PyLink::PyGeometry::GetSideWallExists() const {
     return _pgeometry->GetSideWallExists();
 }
@@ -2612,6 +2641,43 @@ object PyKinBody::GetTransformPose() const {
     return toPyArray(_pbody->GetTransform());
 }
 
+object PyKinBody::GetLinkTransformationsArrays() const
+{
+    size_t numlinks = _pbody->GetLinks().size();
+    const dReal* parrays = _pbody->GetLinkTransformationsArrays();
+    std::vector<dReal> varrays(parrays, parrays+7*numlinks);
+    std::vector<npy_intp> dims(2); dims[0] = 7; dims[1] = numlinks;
+    return toPyArray(varrays,dims);
+}
+
+/// \brief returns a read-only 7 x numlinks array that refers to the link transformations arrays of the body instead of copying them.
+///
+/// The array keeps the python body alive, but is only valid until the update stamp of the body changes.
+static object GetLinkTransformationsView(object opybody)
+{
+    KinBodyPtr pbody = openravepy::GetKinBody(opybody);
+    if( !pbody ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("GetLinkTransformationsView needs a body"), ORE_InvalidArguments);
+    }
+    const dReal* pdata = pbody->GetLinkTransformationsArrays();
+    std::vector<npy_intp> dims(2); dims[0] = 7; dims[1] = pbody->GetLinks().size();
+    return toPyArrayView(pdata, dims, opybody);
+}
+
+/// \brief returns a read-only array that refers to the dof values array of the body instead of copying them.
+///
+/// The array keeps the python body alive, but is only valid until the update stamp of the body changes.
+static object GetDOFValuesView(object opybody)
+{
+    KinBodyPtr pbody = openravepy::GetKinBody(opybody);
+    if( !pbody ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("GetDOFValuesView needs a body"), ORE_InvalidArguments);
+    }
+    const dReal* pdata = pbody->GetDOFValuesArray();
+    std::vector<npy_intp> dims(1); dims[0] = pbody->GetDOF();
+    return toPyArrayView(pdata, dims, opybody);
+}
+
 object PyKinBody::GetLinkTransformations(bool returndoflastvlaues) const
 {
     py::list otransforms;
@@ -3080,6 +3146,149 @@ object PyKinBody::ComputeJacobianAxisAngle(int index, object oindices)
     return toPyArray(vjacobian,dims);
 }
 
+object PyKinBody::ComputeJacobians(object olinkindices, object opositions)
+{
+    std::vector<int> vlinkindices = ExtractArray<int>(olinkindices);
+    OPENRAVE_ASSERT_OP((size_t)len(opositions),==,vlinkindices.size());
+    std::vector< std::pair<int, Vector> > vlinkpositions(vlinkindices.size());
+    for(size_t i = 0; i < vlinkindices.size(); ++i) {
+        vlinkpositions[i] = std::make_pair(vlinkindices[i], ExtractVector3(opositions[i]));
+    }
+    int dof = _pbody->GetDOF();
+    std::vector<dReal> vtranslationjacobians(3*dof*vlinkpositions.size()), vaxisanglejacobians(3*dof*vlinkpositions.size());
+    if( vtranslationjacobians.size() > 0 ) {
+        _pbody->ComputeJacobians(vlinkpositions, &vtranslationjacobians[0], &vaxisanglejacobians[0]);
+    }
+    std::vector<npy_intp> dims(3); dims[0] = vlinkpositions.size(); dims[1] = 3; dims[2] = dof;
+    return py::make_tuple(toPyArray(vtranslationjacobians,dims), toPyArray(vaxisanglejacobians,dims));
+}
+
+object PyKinBody::ComputeJacobiansAndHessians(object olinkindices, object opositions)
+{
+    std::vector<int> vlinkindices = ExtractArray<int>(olinkindices);
+    OPENRAVE_ASSERT_OP((size_t)len(opositions),==,vlinkindices.size());
+    std::vector< std::pair<int, Vector> > vlinkpositions(vlinkindices.size());
+    for(size_t i = 0; i < vlinkindices.size(); ++i) {
+        vlinkpositions[i] = std::make_pair(vlinkindices[i], ExtractVector3(opositions[i]));
+    }
+    int dof = _pbody->GetDOF();
+    std::vector<dReal> vtranslationjacobians(3*dof*vlinkpositions.size()), vaxisanglejacobians(3*dof*vlinkpositions.size());
+    std::vector<dReal> vtranslationhessians(dof*3*dof*vlinkpositions.size()), vaxisanglehessians(dof*3*dof*vlinkpositions.size());
+    if( vtranslationjacobians.size() > 0 ) {
+        _pbody->ComputeJacobiansAndHessians(vlinkpositions, &vtranslationjacobians[0], &vaxisanglejacobians[0], &vtranslationhessians[0], &vaxisanglehessians[0]);
+    }
+    std::vector<npy_intp> dims(3); dims[0] = vlinkpositions.size(); dims[1] = 3; dims[2] = dof;
+    std::vector<npy_intp> hessiandims(4); hessiandims[0] = vlinkpositions.size(); hessiandims[1] = dof; hessiandims[2] = 3; hessiandims[3] = dof;
+    return py::make_tuple(toPyArray(vtranslationjacobians,dims), toPyArray(vaxisanglejacobians,dims), toPyArray(vtranslationhessians,hessiandims), toPyArray(vaxisanglehessians,hessiandims));
+}
+
+/// \brief returns the N x numcolumns values of ovalues as a C contiguous dReal array, the caller has to decref it
+static PyArrayObject* _GetBatchValuesArray(object ovalues, size_t numcolumns)
+{
+    PyArrayObject* pyvalues = reinterpret_cast<PyArrayObject*>(PyArray_FROMANY(ovalues.ptr(), sizeof(dReal)==8 ? NPY_DOUBLE : NPY_FLOAT, 2, 2, NPY_ARRAY_CARRAY_RO));
+    if( !pyvalues ) {
+        PyErr_Clear();
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("values need to be a 2D array of numbers"), ORE_InvalidArguments);
+    }
+    if( (size_t)PyArray_DIM(pyvalues,1) != numcolumns ) {
+        size_t numvaluecolumns = PyArray_DIM(pyvalues,1);
+        Py_DECREF(pyvalues);
+        throw OPENRAVE_EXCEPTION_FORMAT(_("values have %d columns, but there are %d dofs"), numvaluecolumns%numcolumns, ORE_InvalidArguments);
+    }
+    return pyvalues;
+}
+
+void PyKinBody::ComputeLinkTransformationsBatch(object ovalues, object otransforms, object oindices)
+{
+    std::vector<int> vindices;
+    if( !IS_PYTHONOBJECT_NONE(oindices) ) {
+        vindices = ExtractArray<int>(oindices);
+    }
+    const size_t numdofs = IS_PYTHONOBJECT_NONE(oindices) ? _pbody->GetDOF() : vindices.size();
+    PyArrayObject* pyvalues = _GetBatchValuesArray(ovalues, numdofs);
+    AutoPyArrayObjectDereferencer valuesdereferencer(pyvalues);
+    const size_t numconfigs = PyArray_DIM(pyvalues,0);
+    const size_t numlinks = _pbody->GetLinks().size();
+    dReal* ptransforms = GetWriteableArrayData(otransforms, numconfigs*numlinks*7);
+    const dReal* pvalues = reinterpret_cast<const dReal*>(PyArray_DATA(pyvalues));
+
+    openravepy::PythonThreadSaver threadsaver;
+    KinBody::KinBodyStateSaver saver(_pbody, KinBody::Save_LinkTransformation); // restored before the GIL is taken again
+    std::vector<dReal> vvalues(numdofs);
+    for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        std::copy(pvalues+iconfig*numdofs, pvalues+(iconfig+1)*numdofs, vvalues.begin());
+        _pbody->SetDOFValues(vvalues, KinBody::CLA_CheckLimits, vindices);
+        FOREACHC(itlink, _pbody->GetLinks()) {
+            const Transform& t = (*itlink)->GetTransform();
+            ptransforms[0] = t.rot.x; ptransforms[1] = t.rot.y; ptransforms[2] = t.rot.z; ptransforms[3] = t.rot.w;
+            ptransforms[4] = t.trans.x; ptransforms[5] = t.trans.y; ptransforms[6] = t.trans.z;
+            ptransforms += 7;
+        }
+    }
+}
+
+void PyKinBody::ComputeJacobianTranslationBatch(int index, object olocalposition, object ovalues, object ojacobians, object oindices)
+{
+    std::vector<int> vindices;
+    if( !IS_PYTHONOBJECT_NONE(oindices) ) {
+        vindices = ExtractArray<int>(oindices);
+    }
+    const size_t numdofs = IS_PYTHONOBJECT_NONE(oindices) ? _pbody->GetDOF() : vindices.size();
+    KinBody::LinkPtr plink = _pbody->GetLinks().at(index);
+    Vector vlocalposition = ExtractVector3(olocalposition);
+    PyArrayObject* pyvalues = _GetBatchValuesArray(ovalues, numdofs);
+    AutoPyArrayObjectDereferencer valuesdereferencer(pyvalues);
+    const size_t numconfigs = PyArray_DIM(pyvalues,0);
+    dReal* pjacobians = GetWriteableArrayData(ojacobians, numconfigs*3*numdofs);
+    const dReal* pvalues = reinterpret_cast<const dReal*>(PyArray_DATA(pyvalues));
+
+    openravepy::PythonThreadSaver threadsaver;
+    KinBody::KinBodyStateSaver saver(_pbody, KinBody::Save_LinkTransformation); // restored before the GIL is taken again
+    std::vector<dReal> vvalues(numdofs), vjacobian;
+    for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        std::copy(pvalues+iconfig*numdofs, pvalues+(iconfig+1)*numdofs, vvalues.begin());
+        _pbody->SetDOFValues(vvalues, KinBody::CLA_CheckLimits, vindices);
+        _pbody->ComputeJacobianTranslation(index, plink->GetTransform()*vlocalposition, vjacobian, vindices);
+        BOOST_ASSERT(vjacobian.size() == 3*numdofs);
+        std::copy(vjacobian.begin(), vjacobian.end(), pjacobians+iconfig*3*numdofs);
+    }
+}
+
+void PyKinBody::CheckCollisionBatch(object ovalues, object ocollisions, object oindices, bool bCheckSelfCollision)
+{
+    std::vector<int> vindices;
+    if( !IS_PYTHONOBJECT_NONE(oindices) ) {
+        vindices = ExtractArray<int>(oindices);
+    }
+    const size_t numdofs = IS_PYTHONOBJECT_NONE(oindices) ? _pbody->GetDOF() : vindices.size();
+    PyArrayObject* pyvalues = _GetBatchValuesArray(ovalues, numdofs);
+    AutoPyArrayObjectDereferencer valuesdereferencer(pyvalues);
+    const size_t numconfigs = PyArray_DIM(pyvalues,0);
+    if( !PyArray_Check(ocollisions.ptr()) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("collisions needs to be a numpy array"), ORE_InvalidArguments);
+    }
+    PyArrayObject* pycollisions = reinterpret_cast<PyArrayObject*>(ocollisions.ptr());
+    if( !PyArray_ISCARRAY(pycollisions) || PyArray_ITEMSIZE(pycollisions) != 1 || (!PyArray_ISBOOL(pycollisions) && PyArray_TYPE(pycollisions) != NPY_UINT8) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("collisions needs to be a writeable C contiguous bool or uint8 array"), ORE_InvalidArguments);
+    }
+    if( (size_t)PyArray_SIZE(pycollisions) != numconfigs ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("collisions has %d values, but there are %d configurations"), (size_t)PyArray_SIZE(pycollisions)%numconfigs, ORE_InvalidArguments);
+    }
+    uint8_t* pcollisions = reinterpret_cast<uint8_t*>(PyArray_DATA(pycollisions));
+    const dReal* pvalues = reinterpret_cast<const dReal*>(PyArray_DATA(pyvalues));
+
+    openravepy::PythonThreadSaver threadsaver;
+    KinBody::KinBodyStateSaver saver(_pbody, KinBody::Save_LinkTransformation); // restored before the GIL is taken again
+    EnvironmentBasePtr penv = _pbody->GetEnv();
+    std::vector<dReal> vvalues(numdofs);
+    for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        std::copy(pvalues+iconfig*numdofs, pvalues+(iconfig+1)*numdofs, vvalues.begin());
+        _pbody->SetDOFValues(vvalues, KinBody::CLA_CheckLimits, vindices);
+        bool bCollision = penv->CheckCollision(KinBodyConstPtr(_pbody)) || (bCheckSelfCollision && _pbody->CheckSelfCollision());
+        pcollisions[iconfig] = bCollision ? 1 : 0;
+    }
+}
+
 object PyKinBody::CalculateJacobian(int index, object oposition)
 {
     std::vector<dReal> vjacobian;
@@ -3358,6 +3567,25 @@ void PyKinBody::SetAdjacentLinks(int linkindex0, int linkindex1)
     _pbody->SetAdjacentLinks(linkindex0, linkindex1);
 }
 
+void PyKinBody::SetUnreachableLinkPairs(object olinkpairs)
+{
+    std::vector<int> linkpairs(len(olinkpairs));
+    for(size_t i = 0; i < linkpairs.size(); ++i) {
+        int linkindex0 = py::extract<int>(olinkpairs[i][0]), linkindex1 = py::extract<int>(olinkpairs[i][1]);
+        linkpairs[i] = linkindex0|(linkindex1<<16);
+    }
+    _pbody->SetUnreachableLinkPairs(linkpairs);
+}
+
+object PyKinBody::GetUnreachableLinkPairs() const
+{
+    py::list olinkpairs;
+    FOREACHC(it,_pbody->GetUnreachableLinkPairs()) {
+        olinkpairs.append(py::make_tuple((int)(*it)&0xffff,(int)(*it)>>16));
+    }
+    return olinkpairs;
+}
+
 object PyKinBody::GetAdjacentLinks() const
 {
     py::list adjacent;
@@ -3885,6 +4113,9 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetLinkTransformations_overloads, SetLink
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetDOFLimits_overloads, SetDOFLimits, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SubtractDOFValues_overloads, SubtractDOFValues, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeJacobianTranslation_overloads, ComputeJacobianTranslation, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeLinkTransformationsBatch_overloads, ComputeLinkTransformationsBatch, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeJacobianTranslationBatch_overloads, ComputeJacobianTranslationBatch, 4, 5)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionBatch_overloads, CheckCollisionBatch, 2, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeJacobianAxisAngle_overloads, ComputeJacobianAxisAngle, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeHessianTranslation_overloads, ComputeHessianTranslation, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeHessianAxisAngle_overloads, ComputeHessianAxisAngle, 1, 2)
@@ -3961,6 +4192,7 @@ void init_openravepy_kinbody()
                           .value("Trimesh",GT_TriMesh)
                           .value("Container",GT_Container)
                           .value("Cage",GT_Cage)
+                          .value("Voxels",GT_Voxels)
     ;
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
     object sidewalltype = enum_<KinBody::GeometryInfo::SideWallType>(m, "SideWallType" DOXY_ENUM(KinBody::GeometryInfo::SideWallType))
@@ -4439,6 +4671,11 @@ void init_openravepy_kinbody()
         object (PyKinBody::*GetNonAdjacentLinks2)(int) const = &PyKinBody::GetNonAdjacentLinks;
         std::string sInitFromBoxesDoc = std::string(DOXY_FN(KinBody,InitFromBoxes "const std::vector< AABB; bool")) + std::string("\nboxes is a Nx6 array, first 3 columsn are position, last 3 are extents");
         std::string sGetChainDoc = std::string(DOXY_FN(KinBody,GetChain)) + std::string("If returnjoints is false will return a list of links, otherwise will return a list of links (default is true)");
+        std::string sGetViewDoc = "Returns a read-only numpy array that refers to the internal arrays of the body instead of copying them, the layout is the same as GetLinkTransformationsArrays and GetDOFValues. The array is only valid until GetUpdateStamp changes, call the function again to get a valid array.";
+        std::string sBatchDoc = "\n\nEvery row of the N x dof array values is set as the dof values (of indices if given) and the results are written into the preallocated writeable C contiguous output array. The python GIL is released for the whole batch and the state of the body is restored afterwards.\n\n";
+        std::string sComputeLinkTransformationsBatchDoc = std::string("Computes the link poses of many configurations.") + sBatchDoc + std::string(":param transforms: N x numlinks x 7 array, every pose is [qw,qx,qy,qz,x,y,z]\n");
+        std::string sComputeJacobianTranslationBatchDoc = std::string("Computes the translation jacobians of a point on a link for many configurations.") + sBatchDoc + std::string(":param localposition: the point in the coordinate system of the link\n\n:param jacobians: N x 3 x dof array\n\n") + std::string(DOXY_FN(KinBody,ComputeJacobianTranslation));
+        std::string sCheckCollisionBatchDoc = std::string("Checks collision with the environment and optionally self collision for many configurations.") + sBatchDoc + std::string(":param collisions: array of N bool or uint8, set to 1 for the configurations in collision\n");
         std::string sComputeInverseDynamicsDoc = std::string(":param returncomponents: If True will return three N-element arrays that represents the torque contributions to M, C, and G.\n\n:param externalforcetorque: A dictionary of link indices and a 6-element array of forces/torques in that order.\n\n") + std::string(DOXY_FN(KinBody, ComputeInverseDynamics));
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
         scope_ kinbody = class_<PyKinBody, OPENRAVE_SHARED_PTR<PyKinBody>, PyInterfaceBase>(m, "KinBody", DOXY_CLASS(KinBody))
@@ -4579,6 +4816,9 @@ void init_openravepy_kinbody()
 #else
                          .def("GetLinkTransformations",&PyKinBody::GetLinkTransformations, GetLinkTransformations_overloads(PY_ARGS("returndoflastvlaues") DOXY_FN(KinBody,GetLinkTransformations)))
 #endif
+                         .def("GetLinkTransformationsArrays",&PyKinBody::GetLinkTransformationsArrays, DOXY_FN(KinBody,GetLinkTransformationsArrays))
+                         .def("GetLinkTransformationsView",GetLinkTransformationsView, sGetViewDoc.c_str())
+                         .def("GetDOFValuesView",GetDOFValuesView, sGetViewDoc.c_str())
                          .def("GetBodyTransformations",&PyKinBody::GetLinkTransformations, DOXY_FN(KinBody,GetLinkTransformations))
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
                          .def("SetLinkTransformations",&PyKinBody::SetLinkTransformations,
@@ -4679,6 +4919,33 @@ void init_openravepy_kinbody()
 #else
                          .def("ComputeJacobianTranslation",&PyKinBody::ComputeJacobianTranslation,ComputeJacobianTranslation_overloads(PY_ARGS("linkindex","position","indices") DOXY_FN(KinBody,ComputeJacobianTranslation)))
 #endif
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+                         .def("ComputeLinkTransformationsBatch", &PyKinBody::ComputeLinkTransformationsBatch,
+                              "values"_a,
+                              "transforms"_a,
+                              "indices"_a = py::none_(),
+                              sComputeLinkTransformationsBatchDoc.c_str()
+                              )
+                         .def("ComputeJacobianTranslationBatch", &PyKinBody::ComputeJacobianTranslationBatch,
+                              "linkindex"_a,
+                              "localposition"_a,
+                              "values"_a,
+                              "jacobians"_a,
+                              "indices"_a = py::none_(),
+                              sComputeJacobianTranslationBatchDoc.c_str()
+                              )
+                         .def("CheckCollisionBatch", &PyKinBody::CheckCollisionBatch,
+                              "values"_a,
+                              "collisions"_a,
+                              "indices"_a = py::none_(),
+                              "checkself"_a = true,
+                              sCheckCollisionBatchDoc.c_str()
+                              )
+#else
+                         .def("ComputeLinkTransformationsBatch",&PyKinBody::ComputeLinkTransformationsBatch,ComputeLinkTransformationsBatch_overloads(PY_ARGS("values","transforms","indices") sComputeLinkTransformationsBatchDoc.c_str()))
+                         .def("ComputeJacobianTranslationBatch",&PyKinBody::ComputeJacobianTranslationBatch,ComputeJacobianTranslationBatch_overloads(PY_ARGS("linkindex","localposition","values","jacobians","indices") sComputeJacobianTranslationBatchDoc.c_str()))
+                         .def("CheckCollisionBatch",&PyKinBody::CheckCollisionBatch,CheckCollisionBatch_overloads(PY_ARGS("values","collisions","indices","checkself") sCheckCollisionBatchDoc.c_str()))
+#endif
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
                          .def("ComputeJacobianAxisAngle", &PyKinBody::ComputeJacobianAxisAngle,
                               "linkindex"_a,
@@ -4688,6 +4955,8 @@ void init_openravepy_kinbody()
 #else
                          .def("ComputeJacobianAxisAngle",&PyKinBody::ComputeJacobianAxisAngle,ComputeJacobianAxisAngle_overloads(PY_ARGS("linkindex","indices") DOXY_FN(KinBody,ComputeJacobianAxisAngle)))
 #endif
+                         .def("ComputeJacobians",&PyKinBody::ComputeJacobians,PY_ARGS("linkindices","positions") DOXY_FN(KinBody,ComputeJacobians))
+                         .def("ComputeJacobiansAndHessians",&PyKinBody::ComputeJacobiansAndHessians,PY_ARGS("linkindices","positions") DOXY_FN(KinBody,ComputeJacobiansAndHessians))
                          .def("CalculateJacobian",&PyKinBody::CalculateJacobian,PY_ARGS("linkindex","position") DOXY_FN(KinBody,CalculateJacobian "int; const Vector; std::vector"))
                          .def("CalculateRotationJacobian",&PyKinBody::CalculateRotationJacobian,PY_ARGS("linkindex","quat") DOXY_FN(KinBody,CalculateRotationJacobian "int; const Vector; std::vector"))
                          .def("CalculateAngularVelocityJacobian",&PyKinBody::CalculateAngularVelocityJacobian,PY_ARGS("linkindex") DOXY_FN(KinBody,CalculateAngularVelocityJacobian "int; std::vector"))
@@ -4782,6 +5051,8 @@ void init_openravepy_kinbody()
                          .def("GetNonAdjacentLinks",GetNonAdjacentLinks2, PY_ARGS("adjacentoptions") DOXY_FN(KinBody,GetNonAdjacentLinks))
                          .def("SetAdjacentLinks",&PyKinBody::SetAdjacentLinks, PY_ARGS("linkindex0", "linkindex1") DOXY_FN(KinBody,SetAdjacentLinks))
                          .def("GetAdjacentLinks",&PyKinBody::GetAdjacentLinks, DOXY_FN(KinBody,GetAdjacentLinks))
+                         .def("SetUnreachableLinkPairs",&PyKinBody::SetUnreachableLinkPairs, PY_ARGS("linkpairs") DOXY_FN(KinBody,SetUnreachableLinkPairs))
+                         .def("GetUnreachableLinkPairs",&PyKinBody::GetUnreachableLinkPairs, DOXY_FN(KinBody,GetUnreachableLinkPairs))
                          .def("GetManageData",&PyKinBody::GetManageData, DOXY_FN(KinBody,GetManageData))
                          .def("GetUpdateStamp",&PyKinBody::GetUpdateStamp, DOXY_FN(KinBody,GetUpdateStamp))
                          .def("serialize",&PyKinBody::serialize,PY_ARGS("options") DOXY_FN(KinBody,serialize))
@@ -4947,6 +5218,10 @@ void init_openravepy_kinbody()
 #endif
                                   .def("SetCollisionMesh",&PyLink::PyGeometry::SetCollisionMesh,PY_ARGS("trimesh") DOXY_FN(KinBody::Link::Geometry,SetCollisionMesh))
                                   .def("GetCollisionMesh",&PyLink::PyGeometry::GetCollisionMesh, DOXY_FN(KinBody::Link::Geometry,GetCollisionMesh))
+                                  .def("InsertVoxelPoints",&PyLink::PyGeometry::InsertVoxelPoints,PY_ARGS("points") DOXY_FN(KinBody::Link::Geometry,InsertVoxelPoints))
+                                  .def("ClearVoxelPoints",&PyLink::PyGeometry::ClearVoxelPoints,PY_ARGS("points") DOXY_FN(KinBody::Link::Geometry,ClearVoxelPoints))
+                                  .def("ClearVoxels",&PyLink::PyGeometry::ClearVoxels, DOXY_FN(KinBody::Link::Geometry,ClearVoxels))
+                                  .def("GetVoxelResolution",&PyLink::PyGeometry::GetVoxelResolution, DOXY_FN(KinBody::Link::Geometry,GetVoxelResolution))
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
                                   .def("InitCollisionMesh", &PyLink::PyGeometry::InitCollisionMesh,
                                        "tesselation"_a = 1.0,
@@ -54,9 +54,11 @@ PyPlannerProgress::PyPlannerProgress() {
 }
 PyPlannerProgress::PyPlannerProgress(const PlannerBase::PlannerProgress& progress) {
     _iteration = progress._iteration;
+    _fCost = progress._fCost;
+    _nElapsedTime = progress._nElapsedTime;
 }
 std::string PyPlannerProgress::__str__() {
-    return boost::str(boost::format("<PlannerProgress: iter=%d>")%_iteration);
+    return boost::str(boost::format("<PlannerProgress: iter=%d, cost=%f, elapsed=%dms>")%_iteration%_fCost%_nElapsedTime);
 }
 
 PyPlannerStatus::PyPlannerStatus() {
@@ -79,6 +81,23 @@ PyPlannerStatus::PyPlannerStatus(const PlannerStatus& status) {
     }
 
     ikparam = toPyIkParameterization(status.ikparam);
+
+    if( !status.statistics.IsEmpty() ) {
+        const PlannerStatistics& stats = status.statistics;
+        py::dict ostatistics;
+        ostatistics["numIterations"] = stats.numIterations;
+        ostatistics["numNodes"] = stats.numNodes;
+        ostatistics["numSamples"] = stats.numSamples;
+        ostatistics["samplingTime"] = stats.samplingTime;
+        ostatistics["numNearestNeighborQueries"] = stats.numNearestNeighborQueries;
+        ostatistics["nearestNeighborTime"] = stats.nearestNeighborTime;
+        ostatistics["numConstraintChecks"] = stats.numConstraintChecks;
+        ostatistics["constraintCheckTime"] = stats.constraintCheckTime;
+        ostatistics["numConstraintRejects"] = stats.numConstraintRejects;
+        ostatistics["numCollisionQueries"] = stats.numCollisionQueries;
+        ostatistics["totalTime"] = stats.totalTime;
+        statistics = ostatistics;
+    }
 }
 
 object toPyPlannerStatus(const PlannerStatus& status)
@@ -176,6 +195,16 @@ void PyPlannerBase::PyPlannerParameters::SetMaxIterations(int nMaxIterations)
     _paramswrite->_nMaxIterations = nMaxIterations;
 }
 
+void PyPlannerBase::PyPlannerParameters::SetSegmentCheckOrder(int nSegmentCheckOrder)
+{
+    _paramswrite->_nSegmentCheckOrder = nSegmentCheckOrder;
+}
+
+void PyPlannerBase::PyPlannerParameters::SetDeterministicParallel(bool bDeterministicParallel)
+{
+    _paramswrite->_bDeterministicParallel = bDeterministicParallel;
+}
+
 object PyPlannerBase::PyPlannerParameters::CheckPathAllConstraints(object oq0, object oq1, object odq0, object odq1, dReal timeelapsed, IntervalType interval, uint32_t options, bool filterreturn)
 {
     const std::vector<dReal> q0, q1, dq0, dq1;
@@ -406,6 +435,7 @@ void init_openravepy_planner()
     .def_readwrite("jointValues",&PyPlannerStatus::jointValues)
     .def_readwrite("ikparam",&PyPlannerStatus::ikparam)
     .def_readwrite("statusCode",&PyPlannerStatus::statusCode)
+    .def_readwrite("statistics",&PyPlannerStatus::statistics)
     ;
 
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
@@ -414,6 +444,8 @@ void init_openravepy_planner()
     class_<PyPlannerProgress, OPENRAVE_SHARED_PTR<PyPlannerProgress> >("PlannerProgress", DOXY_CLASS(PlannerBase::PlannerProgress))
 #endif
     .def_readwrite("_iteration",&PyPlannerProgress::_iteration)
+    .def_readwrite("_fCost",&PyPlannerProgress::_fCost)
+    .def_readwrite("_nElapsedTime",&PyPlannerProgress::_nElapsedTime)
     ;
 
     {
@@ -472,6 +504,8 @@ void init_openravepy_planner()
         .def("SetConfigAccelerationLimit",&PyPlannerBase::PyPlannerParameters::SetConfigAccelerationLimit, PY_ARGS("accelerations") "sets PlannerParameters::_vConfigAccelerationLimit")
         .def("SetConfigResolution",&PyPlannerBase::PyPlannerParameters::SetConfigResolution, PY_ARGS("resolutions") "sets PlannerParameters::_vConfigResolution")
         .def("SetMaxIterations",&PyPlannerBase::PyPlannerParameters::SetMaxIterations, PY_ARGS("maxiterations") "sets PlannerParameters::_nMaxIterations")
+        .def("SetSegmentCheckOrder",&PyPlannerBase::PyPlannerParameters::SetSegmentCheckOrder, PY_ARGS("segmentcheckorder") "sets PlannerParameters::_nSegmentCheckOrder, 0 for sequential and 1 for bisection order")
+        .def("SetDeterministicParallel",&PyPlannerBase::PyPlannerParameters::SetDeterministicParallel, PY_ARGS("deterministic") "sets PlannerParameters::_bDeterministicParallel, if True planners with parallel workers return the same trajectory for the same seed and number of workers")
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
         .def("CheckPathAllConstraints", &PyPlannerBase::PyPlannerParameters::CheckPathAllConstraints,
              "q0"_a,
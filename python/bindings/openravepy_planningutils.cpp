@@ -95,10 +95,15 @@ void pyVerifyTrajectory(object pyparameters, PyTrajectoryBasePtr pytraj, dReal s
     OpenRAVE::planningutils::VerifyTrajectory(openravepy::GetPlannerParametersConst(pyparameters), openravepy::GetTrajectory(pytraj),samplingstep);
 }
 
-// GIL is assumed locked
+// GIL is assumed locked, it is released while planning
 object pySmoothActiveDOFTrajectory(PyTrajectoryBasePtr pytraj, PyRobotBasePtr pyrobot, dReal fmaxvelmult=1.0, dReal fmaxaccelmult=1.0, const std::string& plannername="", const std::string& plannerparameters="")
 {
-    return openravepy::toPyPlannerStatus(OpenRAVE::planningutils::SmoothActiveDOFTrajectory(openravepy::GetTrajectory(pytraj),openravepy::GetRobot(pyrobot),fmaxvelmult,fmaxaccelmult,plannername,plannerparameters));
+    TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+    RobotBasePtr probot = openravepy::GetRobot(pyrobot);
+    openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+    PlannerStatus status = OpenRAVE::planningutils::SmoothActiveDOFTrajectory(ptraj,probot,fmaxvelmult,fmaxaccelmult,plannername,plannerparameters);
+    statesaver.reset(); // re-lock GIL
+    return openravepy::toPyPlannerStatus(status);
 }
 
 class PyActiveDOFTrajectorySmoother
@@ -126,22 +131,37 @@ public:
 
 typedef OPENRAVE_SHARED_PTR<PyActiveDOFTrajectorySmoother> PyActiveDOFTrajectorySmootherPtr;
 
-// assume python GIL is locked
+// assume python GIL is locked, it is released while planning
 object pySmoothAffineTrajectory(PyTrajectoryBasePtr pytraj, object omaxvelocities, object omaxaccelerations, const std::string& plannername="", const std::string& plannerparameters="")
 {
-    return openravepy::toPyPlannerStatus(OpenRAVE::planningutils::SmoothAffineTrajectory(openravepy::GetTrajectory(pytraj),ExtractArray<dReal>(omaxvelocities), ExtractArray<dReal>(omaxaccelerations),plannername,plannerparameters));
+    TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+    std::vector<dReal> vmaxvelocities = ExtractArray<dReal>(omaxvelocities);
+    std::vector<dReal> vmaxaccelerations = ExtractArray<dReal>(omaxaccelerations);
+    openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+    PlannerStatus status = OpenRAVE::planningutils::SmoothAffineTrajectory(ptraj,vmaxvelocities,vmaxaccelerations,plannername,plannerparameters);
+    statesaver.reset(); // re-lock GIL
+    return openravepy::toPyPlannerStatus(status);
 }
 
-// assume python GIL is locked
+// assume python GIL is locked, it is released while planning
 object pySmoothTrajectory(PyTrajectoryBasePtr pytraj, dReal fmaxvelmult=1.0, dReal fmaxaccelmult=1.0, const std::string& plannername="", const std::string& plannerparameters="")
 {
-    return openravepy::toPyPlannerStatus(OpenRAVE::planningutils::SmoothTrajectory(openravepy::GetTrajectory(pytraj),fmaxvelmult,fmaxaccelmult,plannername,plannerparameters));
+    TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+    openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+    PlannerStatus status = OpenRAVE::planningutils::SmoothTrajectory(ptraj,fmaxvelmult,fmaxaccelmult,plannername,plannerparameters);
+    statesaver.reset(); // re-lock GIL
+    return openravepy::toPyPlannerStatus(status);
 }
 
-// assume python GIL is locked
+// assume python GIL is locked, it is released while planning
 object pyRetimeActiveDOFTrajectory(PyTrajectoryBasePtr pytraj, PyRobotBasePtr pyrobot, bool hastimestamps=false, dReal fmaxvelmult=1.0, dReal fmaxaccelmult=1.0, const std::string& plannername="", const std::string& plannerparameters="")
 {
-    return openravepy::toPyPlannerStatus(OpenRAVE::planningutils::RetimeActiveDOFTrajectory(openravepy::GetTrajectory(pytraj),openravepy::GetRobot(pyrobot),hastimestamps,fmaxvelmult,fmaxaccelmult,plannername,plannerparameters));
+    TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+    RobotBasePtr probot = openravepy::GetRobot(pyrobot);
+    openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+    PlannerStatus status = OpenRAVE::planningutils::RetimeActiveDOFTrajectory(ptraj,probot,hastimestamps,fmaxvelmult,fmaxaccelmult,plannername,plannerparameters);
+    statesaver.reset(); // re-lock GIL
+    return openravepy::toPyPlannerStatus(status);
 }
 
 class PyActiveDOFTrajectoryRetimer
@@ -263,6 +283,24 @@ public:
         _pconstraints->SetTorqueLimitMode(torquelimitmode);
     }
 
+    void SetContinuousCollisionChecking(bool bcontinuous) {
+        _pconstraints->SetContinuousCollisionChecking(bcontinuous);
+    }
+
+    void SetDistanceBoundStepping(bool bdistancestepping) {
+        _pconstraints->SetDistanceBoundStepping(bdistancestepping);
+    }
+
+    object GetDistanceBoundStatistics() const {
+        int numdistancequeries = 0, numchecks = 0, numskipped = 0;
+        _pconstraints->GetDistanceBoundStatistics(numdistancequeries, numchecks, numskipped);
+        return py::make_tuple(numdistancequeries, numchecks, numskipped);
+    }
+
+    void ResetDistanceBoundStatistics() {
+        _pconstraints->ResetDistanceBoundStatistics();
+    }
+
 
     PyEnvironmentBasePtr _pyenv;
     OpenRAVE::planningutils::DynamicsCollisionConstraintPtr _pconstraints;
@@ -270,14 +308,26 @@ public:
 
 typedef OPENRAVE_SHARED_PTR<PyDynamicsCollisionConstraint> PyDynamicsCollisionConstraintPtr;
 
+// assume python GIL is locked, it is released while planning
 object pyRetimeAffineTrajectory(PyTrajectoryBasePtr pytraj, object omaxvelocities, object omaxaccelerations, bool hastimestamps=false, const std::string& plannername="", const std::string& plannerparameters="")
 {
-    return openravepy::toPyPlannerStatus(OpenRAVE::planningutils::RetimeAffineTrajectory(openravepy::GetTrajectory(pytraj),ExtractArray<dReal>(omaxvelocities), ExtractArray<dReal>(omaxaccelerations),hastimestamps,plannername,plannerparameters));
+    TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+    std::vector<dReal> vmaxvelocities = ExtractArray<dReal>(omaxvelocities);
+    std::vector<dReal> vmaxaccelerations = ExtractArray<dReal>(omaxaccelerations);
+    openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+    PlannerStatus status = OpenRAVE::planningutils::RetimeAffineTrajectory(ptraj,vmaxvelocities,vmaxaccelerations,hastimestamps,plannername,plannerparameters);
+    statesaver.reset(); // re-lock GIL
+    return openravepy::toPyPlannerStatus(status);
 }
 
+// assume python GIL is locked, it is released while planning
 object pyRetimeTrajectory(PyTrajectoryBasePtr pytraj, bool hastimestamps=false, dReal fmaxvelmult=1.0, dReal fmaxaccelmult=1.0, const std::string& plannername="", const std::string& plannerparameters="")
 {
-    return openravepy::toPyPlannerStatus(OpenRAVE::planningutils::RetimeTrajectory(openravepy::GetTrajectory(pytraj),hastimestamps,fmaxvelmult,fmaxaccelmult,plannername,plannerparameters));
+    TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+    openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+    PlannerStatus status = OpenRAVE::planningutils::RetimeTrajectory(ptraj,hastimestamps,fmaxvelmult,fmaxaccelmult,plannername,plannerparameters);
+    statesaver.reset(); // re-lock GIL
+    return openravepy::toPyPlannerStatus(status);
 }
 
 size_t pyExtendWaypoint(int index, object odofvalues, object odofvelocities, PyTrajectoryBasePtr pytraj, PyPlannerBasePtr pyplanner)
@@ -451,11 +501,60 @@ public:
         return _sampler->GetIkParameterizationIndex(index);
     }
 
+    void SetNumThreads(int numthreads)
+    {
+        _sampler->SetNumThreads(numthreads);
+    }
+
     OpenRAVE::planningutils::ManipulatorIKGoalSamplerPtr _sampler;
 };
 
 typedef OPENRAVE_SHARED_PTR<PyManipulatorIKGoalSampler> PyManipulatorIKGoalSamplerPtr;
 
+class PyAsyncPlanPath
+{
+public:
+    PyAsyncPlanPath(PyPlannerBasePtr pyplanner, PyRobotBasePtr pyrobot, int planningoptions=0) : _asyncplan(openravepy::GetPlanner(pyplanner), openravepy::GetRobot(pyrobot), planningoptions) {
+    }
+    virtual ~PyAsyncPlanPath() {
+    }
+
+    bool IsDone() const
+    {
+        return _asyncplan.IsDone();
+    }
+
+    bool Wait(uint32_t timeout=0)
+    {
+        openravepy::PythonThreadSaver statesaver;
+        return _asyncplan.Wait(timeout);
+    }
+
+    void Cancel()
+    {
+        _asyncplan.Cancel();
+    }
+
+    object GetProgress() const
+    {
+        OPENRAVE_SHARED_PTR<PyPlannerProgress> pyprogress(new PyPlannerProgress(_asyncplan.GetProgress()));
+        return py::to_object(pyprogress);
+    }
+
+    object GetResult(PyTrajectoryBasePtr pytraj)
+    {
+        TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+        openravepy::PythonThreadSaverPtr statesaver(new openravepy::PythonThreadSaver());
+        PlannerStatus status = _asyncplan.GetResult(ptraj);
+        statesaver.reset(); // re-lock GIL
+        return openravepy::toPyPlannerStatus(status);
+    }
+
+    OpenRAVE::planningutils::AsyncPlanPath _asyncplan;
+};
+
+typedef OPENRAVE_SHARED_PTR<PyAsyncPlanPath> PyAsyncPlanPathPtr;
+
 
 } // end namespace planningutils
 
@@ -479,6 +578,7 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Check_overloads, Check, 5, 8)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads, PlanPath, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads2, PlanPath, 3, 5)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads3, PlanPath, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Wait_overloads, Wait, 0, 1)
 #endif // USE_PYBIND11_PYTHON_BINDINGS
 
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
@@ -793,6 +893,7 @@ void InitPlanningUtils()
 
 #endif
         .def("GetIkParameterizationIndex", &planningutils::PyManipulatorIKGoalSampler::GetIkParameterizationIndex, PY_ARGS("index") DOXY_FN(planningutils::ManipulatorIKGoalSampler, GetIkParameterizationIndex))
+        .def("SetNumThreads", &planningutils::PyManipulatorIKGoalSampler::SetNumThreads, PY_ARGS("numthreads") DOXY_FN(planningutils::ManipulatorIKGoalSampler, SetNumThreads))
         ;
 
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
@@ -883,6 +984,31 @@ void InitPlanningUtils()
         .def("SetFilterMask", &planningutils::PyDynamicsCollisionConstraint::SetFilterMask, PY_ARGS("filtermask") DOXY_FN(planningutils::DynamicsCollisionConstraint,SetFilterMask))
         .def("SetPerturbation", &planningutils::PyDynamicsCollisionConstraint::SetPerturbation, PY_ARGS("parameters") DOXY_FN(planningutils::DynamicsCollisionConstraint,SetPerturbation))
         .def("SetTorqueLimitMode", &planningutils::PyDynamicsCollisionConstraint::SetTorqueLimitMode, PY_ARGS("torquelimitmode") DOXY_FN(planningutils::DynamicsCollisionConstraint,SetTorqueLimitMode))
+        .def("SetContinuousCollisionChecking", &planningutils::PyDynamicsCollisionConstraint::SetContinuousCollisionChecking, PY_ARGS("continuous") DOXY_FN(planningutils::DynamicsCollisionConstraint,SetContinuousCollisionChecking))
+        .def("SetDistanceBoundStepping", &planningutils::PyDynamicsCollisionConstraint::SetDistanceBoundStepping, PY_ARGS("distancestepping") DOXY_FN(planningutils::DynamicsCollisionConstraint,SetDistanceBoundStepping))
+        .def("GetDistanceBoundStatistics", &planningutils::PyDynamicsCollisionConstraint::GetDistanceBoundStatistics, "returns (numdistancequeries, numchecks, numskipped)")
+        .def("ResetDistanceBoundStatistics", &planningutils::PyDynamicsCollisionConstraint::ResetDistanceBoundStatistics, DOXY_FN(planningutils::DynamicsCollisionConstraint,ResetDistanceBoundStatistics))
+        ;
+
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+        class_<planningutils::PyAsyncPlanPath, planningutils::PyAsyncPlanPathPtr >(planningutils, "AsyncPlanPath", DOXY_CLASS(planningutils::AsyncPlanPath))
+        .def(init<PyPlannerBasePtr, PyRobotBasePtr, int>(), "planner"_a, "robot"_a, "planningoptions"_a = 0)
+#else
+        class_<planningutils::PyAsyncPlanPath, planningutils::PyAsyncPlanPathPtr >("AsyncPlanPath", DOXY_CLASS(planningutils::AsyncPlanPath), no_init)
+        .def(init<PyPlannerBasePtr, PyRobotBasePtr, optional<int> >(py::args("planner", "robot", "planningoptions")))
+#endif
+        .def("IsDone", &planningutils::PyAsyncPlanPath::IsDone, DOXY_FN(planningutils::AsyncPlanPath,IsDone))
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+        .def("Wait", &planningutils::PyAsyncPlanPath::Wait,
+             "timeout"_a = 0,
+             DOXY_FN(planningutils::AsyncPlanPath,Wait)
+             )
+#else
+        .def("Wait",&planningutils::PyAsyncPlanPath::Wait,Wait_overloads(PY_ARGS("timeout") DOXY_FN(planningutils::AsyncPlanPath,Wait)))
+#endif
+        .def("Cancel", &planningutils::PyAsyncPlanPath::Cancel, DOXY_FN(planningutils::AsyncPlanPath,Cancel))
+        .def("GetProgress", &planningutils::PyAsyncPlanPath::GetProgress, DOXY_FN(planningutils::AsyncPlanPath,GetProgress))
+        .def("GetResult", &planningutils::PyAsyncPlanPath::GetResult, PY_ARGS("traj") DOXY_FN(planningutils::AsyncPlanPath,GetResult))
         ;
     }
 }
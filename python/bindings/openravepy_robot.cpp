@@ -765,6 +765,34 @@ bool PyRobotBase::PyManipulator::CheckEndEffectorCollision(object otrans, PyColl
     return bCollision;
 }
 
+object PyRobotBase::PyManipulator::CheckEndEffectorCollisions(object oposes, int numredundantsamples) const
+{
+    size_t numposes = len(oposes);
+    std::vector<uint8_t> vincollision;
+    std::vector<IkParameterization> vikparams(numposes);
+    bool bIkParameterizations = numposes > 0 && ExtractIkParameterization(oposes[0], vikparams[0]);
+    if( bIkParameterizations ) {
+        for(size_t i = 1; i < numposes; ++i) {
+            if( !ExtractIkParameterization(oposes[i], vikparams[i]) ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("pose %d is not an IkParameterization"), i, ORE_InvalidArguments);
+            }
+        }
+        _pmanip->CheckEndEffectorCollisions(vikparams, vincollision, numredundantsamples);
+    }
+    else {
+        std::vector<Transform> vtEE(numposes);
+        for(size_t i = 0; i < numposes; ++i) {
+            vtEE[i] = ExtractTransform(oposes[i]);
+        }
+        _pmanip->CheckEndEffectorCollisions(vtEE, vincollision);
+    }
+    py::list oincollision;
+    FOREACHC(it, vincollision) {
+        oincollision.append(*it != 0);
+    }
+    return oincollision;
+}
+
 bool PyRobotBase::PyManipulator::CheckEndEffectorSelfCollision(PyCollisionReportPtr pyreport) const
 {
     BOOST_ASSERT(0);
@@ -1816,6 +1844,7 @@ PyRobotBasePtr RaveCreateRobot(PyEnvironmentBasePtr pyenv, const std::string& na
 #ifndef USE_PYBIND11_PYTHON_BINDINGS
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetIkParameterization_overloads, GetIkParameterization, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckEndEffectorCollision_overloads, CheckEndEffectorCollision, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckEndEffectorCollisions_overloads, CheckEndEffectorCollisions, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckEndEffectorSelfCollision_overloads, CheckEndEffectorSelfCollision, 1, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(FindIKSolution_overloads, FindIKSolution, 2, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(FindIKSolutionFree_overloads, FindIKSolution, 3, 5)
@@ -2330,6 +2359,15 @@ void init_openravepy_robot()
         .def("CheckEndEffectorCollision",pCheckEndEffectorCollision1,CheckEndEffectorCollision_overloads(PY_ARGS("transform", "report", "numredundantsamples") DOXY_FN(RobotBase::Manipulator,CheckEndEffectorCollision)))
 #endif
         .def("CheckEndEffectorCollision",pCheckEndEffectorCollision0, PY_ARGS("report") DOXY_FN(RobotBase::Manipulator,CheckEndEffectorCollision))
+#ifdef USE_PYBIND11_PYTHON_BINDINGS
+        .def("CheckEndEffectorCollisions", &PyRobotBase::PyManipulator::CheckEndEffectorCollisions,
+             "poses"_a,
+             "numredundantsamples"_a = 0,
+             DOXY_FN(RobotBase::Manipulator, CheckEndEffectorCollisions)
+             )
+#else
+        .def("CheckEndEffectorCollisions",&PyRobotBase::PyManipulator::CheckEndEffectorCollisions,CheckEndEffectorCollisions_overloads(PY_ARGS("poses", "numredundantsamples") DOXY_FN(RobotBase::Manipulator,CheckEndEffectorCollisions)))
+#endif
         .def("CheckEndEffectorSelfCollision",pCheckEndEffectorSelfCollision0, PY_ARGS("report") DOXY_FN(RobotBase::Manipulator,CheckEndEffectorSelfCollision))
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
         .def("CheckEndEffectorSelfCollision", pCheckEndEffectorSelfCollision1,
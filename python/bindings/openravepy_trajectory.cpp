@@ -191,6 +191,40 @@ object PyTrajectoryBase::SamplePoints2D(object otimes, OPENRAVE_SHARED_PTR<Confi
     return this->SamplePoints2D(otimes, pyspec);
 }
 
+void PyTrajectoryBase::SamplePointsToArray(object otimes, object oarray) const
+{
+    std::vector<dReal> vtimes = ExtractArray<dReal>(otimes);
+    dReal* pdata = GetWriteableArrayData(oarray, vtimes.size()*_ptrajectory->GetConfigurationSpecification().GetDOF());
+    _ptrajectory->SamplePoints(_vsampledata, vtimes);
+    std::copy(_vsampledata.begin(), _vsampledata.end(), pdata);
+}
+
+void PyTrajectoryBase::SamplePointsToArray(object otimes, object oarray, PyConfigurationSpecificationPtr pyspec) const
+{
+    ConfigurationSpecification spec = openravepy::GetConfigurationSpecification(pyspec);
+    std::vector<dReal> vtimes = ExtractArray<dReal>(otimes);
+    dReal* pdata = GetWriteableArrayData(oarray, vtimes.size()*spec.GetDOF());
+    _ptrajectory->SamplePoints(_vsampledata, vtimes, spec);
+    std::copy(_vsampledata.begin(), _vsampledata.end(), pdata);
+}
+
+/// \brief returns a read-only 2D array that refers to the waypoints of the trajectory instead of copying them.
+///
+/// The array keeps the python trajectory alive, but has to be discarded when the trajectory is modified. If the trajectory does not store its waypoints contiguously, they are copied.
+static object GetWaypointsView(object opytrajectory)
+{
+    TrajectoryBasePtr ptrajectory = openravepy::GetTrajectory(opytrajectory);
+    if( !ptrajectory ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("GetWaypointsView needs a trajectory"), ORE_InvalidArguments);
+    }
+    const dReal* pdata = ptrajectory->GetWaypointsData();
+    if( !pdata ) {
+        return opytrajectory.attr("GetAllWaypoints2D")();
+    }
+    std::vector<npy_intp> dims(2); dims[0] = ptrajectory->GetNumWaypoints(); dims[1] = ptrajectory->GetConfigurationSpecification().GetDOF();
+    return toPyArrayView(pdata, dims, opytrajectory);
+}
+
 object PyTrajectoryBase::GetConfigurationSpecification() const {
     return py::to_object(openravepy::toPyConfigurationSpecification(_ptrajectory->GetConfigurationSpecification()));
 }
@@ -483,6 +517,8 @@ void init_openravepy_trajectory()
     object (PyTrajectoryBase::*SamplePoints2D1)(object) const = &PyTrajectoryBase::SamplePoints2D;
     object (PyTrajectoryBase::*SamplePoints2D2)(object, PyConfigurationSpecificationPtr) const = &PyTrajectoryBase::SamplePoints2D;
     object (PyTrajectoryBase::*SamplePoints2D3)(object, OPENRAVE_SHARED_PTR<ConfigurationSpecification::Group>) const = &PyTrajectoryBase::SamplePoints2D;
+    void (PyTrajectoryBase::*SamplePointsToArray1)(object, object) const = &PyTrajectoryBase::SamplePointsToArray;
+    void (PyTrajectoryBase::*SamplePointsToArray2)(object, object, PyConfigurationSpecificationPtr) const = &PyTrajectoryBase::SamplePointsToArray;
     object (PyTrajectoryBase::*GetWaypoints1)(size_t,size_t) const = &PyTrajectoryBase::GetWaypoints;
     object (PyTrajectoryBase::*GetWaypoints2)(size_t,size_t,PyConfigurationSpecificationPtr) const = &PyTrajectoryBase::GetWaypoints;
     object (PyTrajectoryBase::*GetWaypoints3)(size_t, size_t, OPENRAVE_SHARED_PTR<ConfigurationSpecification::Group>) const = &PyTrajectoryBase::GetWaypoints;
@@ -520,6 +556,8 @@ void init_openravepy_trajectory()
     .def("SamplePoints2D",SamplePoints2D1, PY_ARGS("times") DOXY_FN(TrajectoryBase,SamplePoints2D "std::vector; std::vector"))
     .def("SamplePoints2D",SamplePoints2D2, PY_ARGS("times","spec") DOXY_FN(TrajectoryBase,SamplePoints2D "std::vector; std::vector; const ConfigurationSpecification"))
     .def("SamplePoints2D",SamplePoints2D3, PY_ARGS("times","group") DOXY_FN(TrajectoryBase,SamplePoints2D "std::vector; std::vector; const ConfigurationSpecification::Group"))
+    .def("SamplePointsToArray",SamplePointsToArray1, PY_ARGS("times","data") DOXY_FN(TrajectoryBase,SamplePoints "std::vector; std::vector"))
+    .def("SamplePointsToArray",SamplePointsToArray2, PY_ARGS("times","data","spec") DOXY_FN(TrajectoryBase,SamplePoints "std::vector; std::vector; const ConfigurationSpecification"))
     .def("GetConfigurationSpecification",&PyTrajectoryBase::GetConfigurationSpecification,DOXY_FN(TrajectoryBase,GetConfigurationSpecification))
     .def("GetNumWaypoints",&PyTrajectoryBase::GetNumWaypoints,DOXY_FN(TrajectoryBase,GetNumWaypoints))
     .def("GetWaypoints",GetWaypoints1, PY_ARGS("startindex","endindex") DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector"))
@@ -534,6 +572,7 @@ void init_openravepy_trajectory()
     .def("GetWaypoint",GetWaypoint1, PY_ARGS("index") DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector"))
     .def("GetWaypoint",GetWaypoint2, PY_ARGS("index","spec") DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector; const ConfigurationSpecification"))
     .def("GetWaypoint",GetWaypoint3, PY_ARGS("index","group") DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector; const ConfigurationSpecification::Group"))
+    .def("GetWaypointsView",GetWaypointsView, DOXY_FN(TrajectoryBase, GetWaypointsData))
     .def("GetFirstWaypointIndexAfterTime",&PyTrajectoryBase::GetFirstWaypointIndexAfterTime, DOXY_FN(TrajectoryBase, GetFirstWaypointIndexAfterTime))
     .def("GetDuration",&PyTrajectoryBase::GetDuration,DOXY_FN(TrajectoryBase, GetDuration))
 #ifdef USE_PYBIND11_PYTHON_BINDINGS
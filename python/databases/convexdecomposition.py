@@ -260,11 +260,12 @@ class ConvexDecompositionModel(DatabaseGenerator):
         else:
             self.generate()
         self.save()
-    def generate(self,padding=None,minTriangleConvexHullThresh=None,convexHullLinks=None,**kwargs):
+    def generate(self,padding=None,minTriangleConvexHullThresh=None,convexHullLinks=None,numthreads=0,**kwargs):
         """
         :param padding: the padding in meters
         :param minTriangleConvexHullThresh: If not None, then describes the minimum number of triangles needed to use convex hull rather than convex decomposition. Although this might seem counter intuitive, the current convex decomposition module cannot handle really complex meshes and it takes a long time if it does handle them.
         :param convexHullLinks: a list of link names to compute convex hulls instead of decomposition
+        :param numthreads: number of threads decomposing the geometries of all links at the same time, 0 uses one per cpu
         """
         self.convexparams = kwargs
         if padding is None:
@@ -278,6 +279,8 @@ class ConvexDecompositionModel(DatabaseGenerator):
         self.linkgeometry = []
         with self.env:
             links = self.robot.GetLinks()
+            # the decompositions of all geometries are computed together at the end, so gather the meshes first
+            decompositions = [] # list of (link, cdhulls, trimesh) where cdhulls gets the decomposed hulls
             for il,link in enumerate(links):
                 geomhulls = []
                 geometries = link.GetGeometries()
@@ -287,22 +290,30 @@ class ConvexDecompositionModel(DatabaseGenerator):
                         if len(trimesh.indices) == 0:
                             geom.InitCollisionMesh()
                             trimesh = geom.GetCollisionMesh()
+                        cdhulls = []
                         if link.GetName() in convexHullLinks or (minTriangleConvexHullThresh is not None and len(trimesh.indices) > minTriangleConvexHullThresh):
                             log.info(u'computing hull for link %d/%d geom %d/%d: vertices=%d, indices=%d',il,len(links), ig, len(geometries), len(trimesh.vertices), len(trimesh.indices))
-                            orghulls = [self.ComputePaddedConvexHullFromTriMesh(trimesh,padding)]
-                        else:
-                            log.info(u'computing decomposition for link %d/%d geom %d/%d type %s',il,len(links), ig, len(geometries), geom.GetType())
-                            orghulls = self.ComputePaddedConvexDecompositionFromTriMesh(trimesh,padding)
-                        cdhulls = []
-                        for hull in orghulls:
-                            if any(isnan(hull[0])):
-                                raise ConvexDecompositionError(u'geom link %s has NaNs', link.GetName())
-                            cdhulls.append((hull[0],hull[1],self.ComputeHullPlanes(hull)))
+                            self._AppendHulls(link, cdhulls, [self.ComputePaddedConvexHullFromTriMesh(trimesh,padding)])
+                        elif len(trimesh.indices) > 0:
+                            decompositions.append((link, cdhulls, trimesh))
                         geomhulls.append((ig,cdhulls))
                 self.linkgeometry.append(geomhulls)
+            if len(decompositions) > 0:
+                log.info(u'computing decompositions of %d geometries', len(decompositions))
+                allhulls = convexdecompositionpy.computeConvexDecompositions([(trimesh.vertices,trimesh.indices) for link, cdhulls, trimesh in decompositions], numthreads=numthreads, **self.convexparams)
+                for (link, cdhulls, trimesh), orghulls in izip(decompositions, allhulls):
+                    if padding != 0:
+                        orghulls = [self.PadMesh(hull[0],hull[1],padding) for hull in orghulls]
+                    self._AppendHulls(link, cdhulls, orghulls)
         self._padding = padding
         log.info(u'all convex decomposition finished in %fs',time.time()-starttime)
 
+    def _AppendHulls(self, link, cdhulls, orghulls):
+        for hull in orghulls:
+            if any(isnan(hull[0])):
+                raise ConvexDecompositionError(u'geom link %s has NaNs', link.GetName())
+            cdhulls.append((hull[0],hull[1],self.ComputeHullPlanes(hull)))
+
     def ComputePaddedConvexDecompositionFromTriMesh(self, trimesh, padding=0.0):
         if len(trimesh.indices) > 0:
             orghulls = convexdecompositionpy.computeConvexDecomposition(trimesh.vertices,trimesh.indices,**self.convexparams)
@@ -239,6 +239,11 @@ class GraspingModel(DatabaseGenerator):
         self.approachgraphs = None
         self.contactgraph = None
         self.numthreads=None
+        self.numprocesses=None # if > 1, grasps are generated by worker processes, see _generateDistributed
+        self.numshards=1
+        self.shardindex=0
+        self.checkpointfilename=None
+        self.distributedchunksize=10 # number of approach rays a worker process evaluates at a time
         self.disableallbodies=True
         self.translationstepmult = None
         self.finestep = None
@@ -365,6 +370,14 @@ class GraspingModel(DatabaseGenerator):
                 finestep = options.finestep
             if hasattr(options,'numthreads') and options.numthreads is not None:
                 self.numthreads = options.numthreads
+            if hasattr(options,'numprocesses') and options.numprocesses is not None:
+                self.numprocesses = options.numprocesses
+            if hasattr(options,'numshards') and options.numshards is not None:
+                self.numshards = options.numshards
+            if hasattr(options,'shardindex') and options.shardindex is not None:
+                self.shardindex = options.shardindex
+            if hasattr(options,'checkpoint') and options.checkpoint is not None:
+                self.checkpointfilename = options.checkpoint
         # check for specific robots
         if self.robot.GetRobotStructureHash() == '2b0b07cce5d2f9c321010e74273a77f2' or self.robot.GetRobotStructureHash() == 'ca823aed89e08c7020b2cd7d2e5ff145': # wam+barretthand
             if preshapes is None:
@@ -399,7 +412,9 @@ class GraspingModel(DatabaseGenerator):
             for b in bodies:
                 b[0].Enable(False)
         try:
-            if self.numthreads is not None and self.numthreads > 1:
+            if (self.numprocesses is not None and self.numprocesses > 1) or self.numshards > 1:
+                self._generateDistributed(*args,**kwargs)
+            elif self.numthreads is not None and self.numthreads > 1:
                 self._generateThreaded(*args,**kwargs)
             else:
                 with self.GripperVisibility(self.manip):
@@ -540,6 +555,126 @@ class GraspingModel(DatabaseGenerator):
         
         return producer, consumer, gatherer, totalgrasps
 
+    def _generateDistributed(self,preshapes=None,standoffs=None,rolls=None,approachrays=None, graspingnoise=None,forceclosure=True,forceclosurethreshold=1e-9,checkgraspfn=None,manipulatordirections=None,translationstepmult=None,finestep=None,friction=None,avoidlinks=None,plannername=None,boxdelta=None,spheredelta=None,normalanglerange=None):
+        """Generates a grasp set with a pool of self.numprocesses worker processes that each load the robot and target once.
+
+        The approach rays are split into chunks of self.distributedchunksize rays. This call only evaluates the chunks whose index modulo self.numshards is self.shardindex, so several hosts can each generate one shard of the same grasp set and merge them with :meth:`.loadGraspCheckpoints`.
+        Every finished chunk is appended to the checkpoint file (self.checkpointfilename or a file next to the database). Calling again with the same file skips the stored chunks, so the generation resumes after a failure.
+        The arguments are the same as :meth:`.generatepcg`.
+        """
+        import multiprocessing
+        print 'Generating Grasp Set for %s:%s:%s with %s processes, shard %d/%d'%(self.robot.GetName(),self.manip.GetName(),self.target.GetName(),self.numprocesses,self.shardindex,self.numshards)
+        if friction is None:
+            friction = 0.4
+        if avoidlinks is None:
+            avoidlinks = []
+        self.init(friction=friction,avoidlinks=avoidlinks,plannername=plannername)
+        self.translationstepmult = translationstepmult
+        self.finestep = finestep
+        if approachrays is None:
+            if boxdelta is not None:
+                approachrays = self.computeBoxApproachRays(delta=boxdelta,normalanglerange=normalanglerange)
+            elif spheredelta is not None:
+                approachrays = self.computeSphereApproachRays(delta=spheredelta,normalanglerange=normalanglerange)
+            else:
+                approachrays = self.computeBoxApproachRays(delta=0.02,normalanglerange=0)
+        if preshapes is None:
+            # compute once here instead of in every chunk
+            with self.target:
+                self.target.Enable(False)
+                taskmanip = interfaces.TaskManipulation(self.robot)
+                final,traj = taskmanip.ReleaseFingers(execute=False,outputfinal=True)
+            preshapes = array([final])
+        with self.env:
+            robotfilename = self.robot.GetXMLFilename()
+            targetfilename = self.target.GetXMLFilename()
+            if len(robotfilename) == 0 or len(targetfilename) == 0:
+                raise ValueError('distributed grasp generation needs the robot and target to be loaded from files')
+            initargs = (robotfilename, self.robot.GetName(), self.robot.GetDOFValues(), self.robot.GetTransform(), self.manip.GetName(), targetfilename, self.target.GetName(), self.target.GetTransform(),
+                        {'preshapes':preshapes, 'standoffs':standoffs, 'rolls':rolls, 'graspingnoise':graspingnoise, 'forceclosure':forceclosure, 'forceclosurethreshold':forceclosurethreshold, 'checkgraspfn':checkgraspfn, 'manipulatordirections':manipulatordirections, 'translationstepmult':translationstepmult, 'finestep':finestep, 'friction':friction, 'avoidlinknames':[link.GetName() for link in avoidlinks], 'plannername':plannername})
+        
+        chunksize = self.distributedchunksize
+        numchunks = (len(approachrays)+chunksize-1)/chunksize
+        chunks = [(ichunk,approachrays[ichunk*chunksize:(ichunk+1)*chunksize]) for ichunk in range(numchunks) if ichunk%self.numshards == self.shardindex]
+        checkpointfilename = self.checkpointfilename
+        if checkpointfilename is None:
+            checkpointfilename = self.getfilename(False)+'.shard%d_%d.checkpoint'%(self.shardindex,self.numshards)
+        header = {'numapproachrays':len(approachrays), 'chunksize':chunksize, 'numshards':self.numshards, 'shardindex':self.shardindex}
+        finishedchunks = {}
+        validsize = 0
+        if os.path.isfile(checkpointfilename):
+            storedheader, finishedchunks, validsize = self._readGraspCheckpoint(checkpointfilename)
+            if storedheader != header:
+                raise ValueError('checkpoint %s was generated with %r, now %r'%(checkpointfilename,storedheader,header))
+            print 'resuming from %s with %d finished chunks'%(checkpointfilename,len(finishedchunks))
+        remainingchunks = [chunk for chunk in chunks if chunk[0] not in finishedchunks]
+        
+        fcheckpoint = open(checkpointfilename,'r+b' if validsize > 0 else 'wb')
+        try:
+            if validsize > 0:
+                # drop a record that was only partially written when the last run stopped
+                fcheckpoint.truncate(validsize)
+                fcheckpoint.seek(validsize)
+            else:
+                pickle.dump(header,fcheckpoint,pickle.HIGHEST_PROTOCOL)
+                fcheckpoint.flush()
+            if len(remainingchunks) > 0:
+                pool = multiprocessing.Pool(self.numprocesses if self.numprocesses is not None else 1,_InitDistributedGraspWorker,initargs)
+                try:
+                    for chunkindex,grasps in pool.imap_unordered(_RunDistributedGraspChunk,remainingchunks):
+                        finishedchunks[chunkindex] = grasps
+                        pickle.dump((chunkindex,grasps),fcheckpoint,pickle.HIGHEST_PROTOCOL)
+                        fcheckpoint.flush()
+                        print 'grasp chunk %d finished with %d grasps, %d/%d chunks'%(chunkindex,len(grasps),len(finishedchunks),len(chunks))
+                    pool.close()
+                except:
+                    pool.terminate()
+                    raise
+                finally:
+                    pool.join()
+        finally:
+            fcheckpoint.close()
+        self._gatherGraspChunks(finishedchunks)
+        if self.numshards > 1:
+            print 'shard %d/%d is stored in %s, merge all shards with loadGraspCheckpoints'%(self.shardindex,self.numshards,checkpointfilename)
+        else:
+            os.remove(checkpointfilename)
+
+    def loadGraspCheckpoints(self,checkpointfilenames):
+        """Sets the grasps from the checkpoint files of all the shards that :meth:`._generateDistributed` generated, afterwards the set can be saved.
+        """
+        allchunks = {}
+        for checkpointfilename in checkpointfilenames:
+            header, finishedchunks, validsize = self._readGraspCheckpoint(checkpointfilename)
+            allchunks.update(finishedchunks)
+        self._gatherGraspChunks(allchunks)
+
+    @staticmethod
+    def _readGraspCheckpoint(checkpointfilename):
+        """returns the header, the grasps of each chunk and the size of the file up to the last complete record"""
+        finishedchunks = {}
+        with open(checkpointfilename,'rb') as f:
+            header = pickle.load(f)
+            validsize = f.tell()
+            while True:
+                try:
+                    chunkindex,grasps = pickle.load(f)
+                except Exception:
+                    # end of file or a partially written record
+                    break
+                finishedchunks[chunkindex] = grasps
+                validsize = f.tell()
+        return header, finishedchunks, validsize
+
+    def _gatherGraspChunks(self,finishedchunks):
+        grasps = []
+        for chunkindex in sorted(finishedchunks.keys()):
+            grasps += finishedchunks[chunkindex]
+        self.grasps = array(grasps)
+        if len(self.grasps) > 1:
+            order = argsort(self.grasps[:,self.graspindices.get('performance')[0]])
+            self.grasps = self.grasps[order]
+
     def _generateThreaded(self,preshapes=None,standoffs=None,rolls=None,approachrays=None, graspingnoise=None,forceclosure=True,forceclosurethreshold=1e-9,checkgraspfn=None,manipulatordirections=None,translationstepmult=None,finestep=None,friction=None,avoidlinks=None,plannername=None):
         """Generates a grasp set by searching space and evaluating contact points.
 
@@ -1133,6 +1268,14 @@ class GraspingModel(DatabaseGenerator):
                           help='Random undeterministic noise to add to the target object, represents the max possible displacement of any point on the object. Noise is added after global direction and start have been determined (default=0)')
         parser.add_option('--graspindex', action='store', type='int',dest='graspindex',default=None,
                           help='If set, then will only show this grasp index')
+        parser.add_option('--numprocesses', action='store', type='int',dest='numprocesses',default=None,
+                          help='If set, generates the grasps with this many worker processes')
+        parser.add_option('--numshards', action='store', type='int',dest='numshards',default=None,
+                          help='Splits the approach rays into this many shards so several hosts can generate one grasp set (default=1)')
+        parser.add_option('--shardindex', action='store', type='int',dest='shardindex',default=None,
+                          help='The shard this process generates when --numshards is set (default=0)')
+        parser.add_option('--checkpoint', action='store', type='string',dest='checkpoint',default=None,
+                          help='The file storing finished chunks of a distributed generation, used to resume it')
         return parser
     @staticmethod
     def InitializeFromParser(Model=None,parser=None,defaultviewer=True,args=[],*margs,**kwargs):
@@ -1151,6 +1294,39 @@ class GraspingModel(DatabaseGenerator):
         kwargs.update({ 'args':args, 'defaultviewer':True })
         return DatabaseGenerator.InitializeFromParser(Model,parser,*margs,**kwargs)
 
+_distributedgraspmodel = None # the model of a worker process of GraspingModel._generateDistributed
+_distributedgraspkwargs = None
+
+def _InitDistributedGraspWorker(robotfilename,robotname,dofvalues,Trobot,manipname,targetfilename,targetname,Ttarget,kwargs):
+    """loads the scene of a worker process once"""
+    global _distributedgraspmodel, _distributedgraspkwargs
+    env = Environment()
+    with env:
+        robot = env.ReadRobotXMLFile(robotfilename)
+        robot.SetName(robotname)
+        env.Add(robot)
+        robot.SetTransform(Trobot)
+        robot.SetDOFValues(dofvalues)
+        robot.SetActiveManipulator(manipname)
+        target = env.ReadKinBodyXMLFile(targetfilename)
+        target.SetName(targetname)
+        env.Add(target)
+        target.SetTransform(Ttarget)
+    _distributedgraspmodel = GraspingModel(robot=robot,target=target)
+    _distributedgraspkwargs = dict(kwargs)
+    _distributedgraspkwargs['avoidlinks'] = [robot.GetLink(name) for name in _distributedgraspkwargs.pop('avoidlinknames')]
+
+def _RunDistributedGraspChunk(chunk):
+    """evaluates all the grasps of one chunk of approach rays, returns the chunk index and the good grasps"""
+    chunkindex,approachrays = chunk
+    producer,consumer,gatherer,numjobs = _distributedgraspmodel.generatepcg(approachrays=approachrays,**_distributedgraspkwargs)
+    grasps = []
+    for work in producer():
+        results = consumer(*work)
+        if len(results) > 0:
+            grasps.append(results[0])
+    return chunkindex,grasps
+
 def run(args,*margs,**kwargs):
     """Command-line execution of the example. ``args`` specifies a list of the arguments to the script.
     """
@@ -640,6 +640,8 @@ class InverseKinematicsModel(DatabaseGenerator):
         ipython = None
         freeinc = None
         ikfastmaxcasedepth = 3
+        ikfastnumprocesses = 1
+        ikfastcachedir = None
         filepermissions = None
         if options is not None:
             forceikbuild=options.force
@@ -651,6 +653,8 @@ class InverseKinematicsModel(DatabaseGenerator):
             if options.freeinc is not None:
                 freeinc = [float64(s) for s in options.freeinc]
             ikfastmaxcasedepth = options.maxcasedepth
+            ikfastnumprocesses = options.numprocesses
+            ikfastcachedir = options.ikfastcachedir
             filepermissions = options.filepermissions
         if self.manip.GetKinematicsStructureHash() == 'f17f58ee53cc9d185c2634e721af7cd3': # wam 4dof
             if iktype is None:
@@ -680,7 +684,7 @@ class InverseKinematicsModel(DatabaseGenerator):
                 freejoints = [self.robot.GetJoints()[ind].GetName() for ind in self.manip.GetArmIndices()[3:]]
             if iktype==None:
                 iktype == IkParameterizationType.TranslationDirection5D
-        self.generate(iktype=iktype,freejoints=freejoints,precision=precision,forceikbuild=forceikbuild,outputlang=outputlang,ipython=ipython,ikfastmaxcasedepth=ikfastmaxcasedepth)
+        self.generate(iktype=iktype,freejoints=freejoints,precision=precision,forceikbuild=forceikbuild,outputlang=outputlang,ipython=ipython,ikfastmaxcasedepth=ikfastmaxcasedepth,ikfastnumprocesses=ikfastnumprocesses,ikfastcachedir=ikfastcachedir)
         self.save(filepermissions)
 
     def getIndicesFromJointNames(self,freejoints):
@@ -699,10 +703,12 @@ class InverseKinematicsModel(DatabaseGenerator):
         print 'getIndicesFromJointNames',freeindices,freejoints
         return freeindices
 
-    def generate(self,iktype=None, freejoints=None, freeinc=None, freeindices=None, precision=None, forceikbuild=True, outputlang=None, avoidPrismaticAsFree=False, ipython=False, ikfastoptions=0, ikfastmaxcasedepth=3):
+    def generate(self,iktype=None, freejoints=None, freeinc=None, freeindices=None, precision=None, forceikbuild=True, outputlang=None, avoidPrismaticAsFree=False, ipython=False, ikfastoptions=0, ikfastmaxcasedepth=3, ikfastnumprocesses=1, ikfastcachedir=None):
         """
         :param ikfastoptions: see IKFastSolver.generateIkSolver
         :param ikfastmaxcasedepth: the max level of degenerate cases to solve for
+        :param ikfastnumprocesses: the number of processes trying the independent ikfast solving attempts at the same time
+        :param ikfastcachedir: if not None, the directory where ikfast stores the attempts that failed for the kinematics, so that generating them again skips them
         :param avoidPrismaticAsFree: if True for redundant manipulators, will attempt to avoid setting prismatic joints as free joints.
         """
         self.iksolver = None
@@ -896,7 +902,7 @@ class InverseKinematicsModel(DatabaseGenerator):
             except OSError:
                 pass
             
-            solver = self.ikfast.IKFastSolver(kinbody=self.robot,kinematicshash=self.manip.GetInverseKinematicsStructureHash(self.iktype),precision=precision, checkpreemptfn=self._checkpreemptfn)
+            solver = self.ikfast.IKFastSolver(kinbody=self.robot,kinematicshash=self.manip.GetInverseKinematicsStructureHash(self.iktype),precision=precision, checkpreemptfn=self._checkpreemptfn, numprocesses=ikfastnumprocesses, cachedir=ikfastcachedir)
             solver.maxcasedepth = ikfastmaxcasedepth
             if self.iktype == IkParameterizationType.TranslationXAxisAngle4D or self.iktype == IkParameterizationType.TranslationYAxisAngle4D or self.iktype == IkParameterizationType.TranslationZAxisAngle4D or self.iktype == IkParameterizationType.TranslationXAxisAngleZNorm4D or self.iktype == IkParameterizationType.TranslationYAxisAngleXNorm4D or self.iktype == IkParameterizationType.TranslationZAxisAngleYNorm4D or self.iktype == IkParameterizationType.TranslationXYOrientation3D:
                 solver.useleftmultiply = False
@@ -1092,6 +1098,10 @@ class InverseKinematicsModel(DatabaseGenerator):
                           help='The precision to compute the inverse kinematics in, (default=%default).')
         parser.add_option('--maxcasedepth', action='store', type='int', dest='maxcasedepth',default=3,
                           help='The max depth to go into degenerate cases. If ikfast file is too big, try reducing this, (default=%default).')
+        parser.add_option('--numprocesses', action='store', type='int', dest='numprocesses',default=1,
+                          help='The number of processes ikfast uses to try the independent solving attempts at the same time, (default=%default).')
+        parser.add_option('--ikfastcachedir', action='store', type='string', dest='ikfastcachedir',default=None,
+                          help='If set, the directory where ikfast stores the solving attempts that failed, so that generating the same kinematics again skips them.')
         parser.add_option('--usecached', action='store_false', dest='force',default=True,
                           help='If set, will always try to use the cached ik c++ file, instead of generating a new one.')
         parser.add_option('--freeinc', action='append', type='float', dest='freeinc',default=None,
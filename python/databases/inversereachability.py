@@ -210,7 +210,7 @@ class InverseReachabilityModel(DatabaseGenerator):
             basetrans[:,0:7] = poseMultArrayT(poseFromMatrix(Tbase),basetrans[:,0:7])
             # find the density of the points
             searchtrans = c_[basetrans[:,0:4],basetrans[:,6:7]]
-            kdtree = kinematicreachability.ReachabilityModel.QuaternionKDTree(searchtrans,1.0/self.rotweight)
+            kdtree = kinematicreachability.ReachabilityModel.QuaternionKDTree(searchtrans,1.0/self.rotweight,self.env)
             transdensity = kdtree.kFRSearchArray(searchtrans,0.25*quateucdist2,0,quatthresh*0.2)[2]
             basetrans = basetrans[argsort(-transdensity),:]
             Nminimum = max(Nminimum,4)
@@ -317,10 +317,11 @@ class InverseReachabilityModel(DatabaseGenerator):
            bounds[1,0] = pi
 
         points[:,0] *= rotweight
-        kdtree = pyANN.KDTree(points)
         searchradius=9.0*sum(bandwidth**2)
         searcheps=bandwidth[0]*0.2
         weights=equivalenceclass[2][:,3]*normalizationconst
+        nativekdtree = kinematicreachability.ReachabilityQueryIndex.Create(self.env,points,weights)
+        kdtree = pyANN.KDTree(points) if nativekdtree is None else None
         cumweights = cumsum(weights)
         cumweights = cumweights[1:]/cumweights[-1]
 
@@ -328,6 +329,8 @@ class InverseReachabilityModel(DatabaseGenerator):
             """returns the density"""
             qposes,zposeangles = normalizeZRotation(poses[:,0:4])
             p = c_[zposeangles*rotweight,poses[:,4:6]]
+            if nativekdtree is not None:
+                return nativekdtree.kernelDensityArray(p,searchradius,16,searcheps,ibandwidth)
             neighs,dists,kball = kdtree.kFRSearchArray(p,searchradius,16,searcheps)
             probs = zeros(p.shape[0])
             for i in range(p.shape[0]):
@@ -402,7 +405,8 @@ class InverseReachabilityModel(DatabaseGenerator):
             bounds[0,0] = -pi
             bounds[1,0] = pi
         points[:,0] *= rotweight
-        kdtree = pyANN.KDTree(points)
+        nativekdtree = kinematicreachability.ReachabilityQueryIndex.Create(self.env,points,weights)
+        kdtree = pyANN.KDTree(points) if nativekdtree is None else None
         cumweights = cumsum(weights)
         cumweights = cumweights[1:]/cumweights[-1]
         
@@ -410,6 +414,8 @@ class InverseReachabilityModel(DatabaseGenerator):
             """returns the density"""
             qposes,zposeangles = normalizeZRotation(poses[:,0:4])
             p = c_[zposeangles*rotweight,poses[:,4:6]]
+            if nativekdtree is not None:
+                return nativekdtree.kernelDensityArray(p,searchradius,16,searcheps,ibandwidth)
             neighs,dists,kball = kdtree.kFRSearchArray(p,searchradius,16,searcheps)
             probs = zeros(p.shape[0])
             for i in range(p.shape[0]):
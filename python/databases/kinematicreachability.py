@@ -57,7 +57,7 @@ if not __openravepy_build_doc__:
 else:
     from numpy import array
 
-from ..openravepy_int import RaveFindDatabaseFile, IkParameterization, rotationMatrixFromQArray, poseFromMatrix
+from ..openravepy_int import RaveFindDatabaseFile, RaveCreateModule, IkParameterization, rotationMatrixFromQArray, poseFromMatrix
 from ..openravepy_ext import transformPoints, quatArrayTDist
 from .. import metaclass, pyANN
 from ..misc import SpaceSamplerExtra
@@ -74,21 +74,80 @@ from optparse import OptionParser
 import logging
 log = logging.getLogger('openravepy.'+__name__.split('.',2)[-1])
 
+class ReachabilityQueryIndex(metaclass.AutoReloader):
+    """kd-tree built once by the reachabilityqueries module, the batched queries are answered by several threads in C++.
+
+    Has the same kFRSearchArray interface as pyANN.KDTree.
+    """
+    _numindices = 0
+    def __init__(self,module,points,weights=None,numthreads=0):
+        self.module = module
+        self.dim = points.shape[1]
+        self.numthreads = numthreads
+        ReachabilityQueryIndex._numindices += 1
+        self.name = 'index%d'%ReachabilityQueryIndex._numindices
+        cmd = 'CreateIndex %s dim %d '%(self.name,self.dim)
+        if weights is not None:
+            cmd += 'weights %d %s '%(len(weights),self._FormatArray(weights))
+        self.module.SendCommand(cmd + 'points %d %s'%(len(points),self._FormatArray(points)))
+    def __del__(self):
+        try:
+            self.module.SendCommand('DestroyIndex %s'%self.name)
+        except:
+            pass
+    @staticmethod
+    def Create(env,points,weights=None,numthreads=0):
+        """returns None if the reachabilityqueries module is not available"""
+        module = RaveCreateModule(env,'reachabilityqueries')
+        if module is None:
+            log.debug('reachabilityqueries module not found, using pyANN')
+            return None
+        return ReachabilityQueryIndex(module,array(points),weights,numthreads)
+    @staticmethod
+    def _FormatArray(values):
+        return ' '.join(['%.15e'%v for v in numpy.ravel(values)])
+    def _QueryCommand(self,command,qarray,radiussq,k,eps,options=''):
+        return '%s %s %ssqrad %.15e k %d eps %.15e numthreads %d queries %d %s'%(command,self.name,options,radiussq,k,eps,self.numthreads,len(qarray),self._FormatArray(qarray))
+    def kFRSearchArray(self,qarray,radiussq,k,eps):
+        """returns the neighbor indices and squared distances padded with -1 and inf, and the number of points inside the radius"""
+        lines = self.module.SendCommand(self._QueryCommand('KFRSearch',qarray,radiussq,k,eps)).splitlines()
+        kball = zeros(len(qarray),int)
+        neighs = -ones((len(qarray),max(k,0)),int)
+        dists = tile(inf,(len(qarray),max(k,0)))
+        for i,line in enumerate(lines):
+            values = line.split()
+            kball[i] = int(values[0])
+            numneighs = (len(values)-1)//2
+            neighs[i,0:numneighs] = [int(v) for v in values[1::2]]
+            dists[i,0:numneighs] = [float(v) for v in values[2::2]]
+        return neighs,dists,kball
+    def kernelDensityArray(self,qarray,radiussq,k,eps,ibandwidth):
+        """returns the sum of the point weights times exp(dot((p-q)**2,ibandwidth)) of the closest k points p inside the radius of every query q"""
+        cmd = self._QueryCommand('KernelDensity',qarray,radiussq,k,eps,'ibandwidth %s '%self._FormatArray(ibandwidth))
+        return array([float(v) for v in self.module.SendCommand(cmd).split()])
+
 class ReachabilityModel(DatabaseGenerator):
     """Computes the robot manipulator's reachability space (stores it in 6D) and
     offers several functions to use it effectively in planning."""
 
     class QuaternionKDTree(metaclass.AutoReloader):
         """Artificially add more weight to the X,Y,Z translation dimensions"""
-        def __init__(self, poses,transmult):
+        def __init__(self, poses,transmult,env=None):
+            """if env is given, the batched searches use the reachabilityqueries module when it is available"""
             self.numposes = len(poses)
             self.transmult = transmult
             self.itransmult = 1/transmult
             searchposes = array(poses)
             searchposes[:,4:] *= self.transmult # take translation errors more seriously
-            allposes = r_[searchposes,searchposes]
-            allposes[self.numposes:,0:4] *= -1
-            self.nnposes = pyANN.KDTree(allposes)
+            self.allposes = r_[searchposes,searchposes]
+            self.allposes[self.numposes:,0:4] *= -1
+            self.nativeposes = ReachabilityQueryIndex.Create(env,self.allposes) if env is not None else None
+            self._nnposes = None
+        @property
+        def nnposes(self):
+            if self._nnposes is None:
+                self._nnposes = pyANN.KDTree(self.allposes)
+            return self._nnposes
         def kSearch(self,poses,k,eps):
             """returns distance squared"""
             poses[:,4:] *= self.transmult
@@ -107,7 +166,10 @@ class ReachabilityModel(DatabaseGenerator):
         def kFRSearchArray(self,poses,radiussq,k,eps):
             """returns distance squared"""
             poses[:,4:] *= self.transmult
-            neighs,dists,kball = self.nnposes.kFRSearchArray(poses,radiussq,k,eps)
+            if self.nativeposes is not None:
+                neighs,dists,kball = self.nativeposes.kFRSearchArray(poses,radiussq,k,eps)
+            else:
+                neighs,dists,kball = self.nnposes.kFRSearchArray(poses,radiussq,k,eps)
             neighs[neighs>=self.numposes] -= self.numposes
             poses[:,4:] *= self.itransmult
             return neighs,dists,kball
@@ -323,9 +385,28 @@ class ReachabilityModel(DatabaseGenerator):
                 if mod(i,1000)==0:
                     log.info('%s/%d', i,len(insideinds))
                 yield ind,T
+        # quaternions of the sampled rotations, the ikfast module solves a whole translation at once when available
+        rotationposes = []
+        for rotation in rotations:
+            Trot = eye(4)
+            Trot[0:3,0:3] = rotation
+            rotationposes.append(poseFromMatrix(Trot))
+        rotationsstring = ' '.join('%.16e %.16e %.16e %.16e'%tuple(pose[0:4]) for pose in rotationposes)
+        ikfastproblem = self.ikmodel.ikfastproblem
         def consumer(ind,T):
             with self.robot:
                 self.robot.SetTransform(Trobot)
+                if ikfastproblem is not None:
+                    cmd = 'ComputeReachability robot %s manip %s usefreespace %d rotations %d %s translations 1 %.16e %.16e %.16e'%(self.robot.GetName(),self.manip.GetName(),usefreespace,len(rotations),rotationsstring,T[0,3],T[1,3],T[2,3])
+                    res = ikfastproblem.SendCommand(cmd)
+                    if res is not None:
+                        values = [int(v) for v in res.split()]
+                        reachabilitystats = []
+                        for i in range(values[1]):
+                            pose = array(rotationposes[values[2+2*i]])
+                            pose[4:7] = T[0:3,3]
+                            reachabilitystats.append(r_[pose,values[3+2*i]])
+                        return ind,reachabilitystats,values[0],values[1]
                 reachabilitystats = []
                 numvalid = 0
                 numrotvalid = 0
@@ -404,11 +485,14 @@ class ReachabilityModel(DatabaseGenerator):
     def ComputeNN(self,translationonly=False):
         if translationonly:
             if self.kdtree3d is None:
-                self.kdtree3d = pyANN.KDTree(self._GetValue(self.reachabilitystats)[:,4:7])
+                points = self._GetValue(self.reachabilitystats)[:,4:7]
+                self.kdtree3d = ReachabilityQueryIndex.Create(self.env,points)
+                if self.kdtree3d is None:
+                    self.kdtree3d = pyANN.KDTree(points)
             return self.kdtree3d
         else:
             if self.kdtree6d is None:
-                self.kdtree6d = self.QuaternionKDTree(self._GetValue(self.reachabilitystats)[:,0:7],5.0)
+                self.kdtree6d = self.QuaternionKDTree(self._GetValue(self.reachabilitystats)[:,0:7],5.0,self.env)
             return self.kdtree6d
     @staticmethod
     def CreateOptionParser():
@@ -48,6 +48,7 @@ When using link statics, it is possible to set the joints weights and resolution
        lmodel.autogenerate()
    lmodel.setRobotWeights()
    lmodel.setRobotResolutions(xyzdelta=0.01)
+   lmodel.setRobotUnreachableLinkPairs()
    print 'robot resolutions: ',repr(robot.GetDOFResolutions())
    print 'robot weights: ',repr(robot.GetDOFWeights())
 
@@ -67,13 +68,14 @@ else:
 
 import numpy
 from ..openravepy_ext import transformPoints
-from ..openravepy_int import RaveFindDatabaseFile, RaveDestroy, Environment, KinBody, rotationMatrixFromQuat, quatRotateDirection, rotationMatrixFromAxisAngle, RaveGetDefaultViewerType
+from ..openravepy_int import RaveFindDatabaseFile, RaveDestroy, Environment, RaveCreateModule, KinBody, rotationMatrixFromQuat, quatRotateDirection, rotationMatrixFromAxisAngle, RaveGetDefaultViewerType
 from . import DatabaseGenerator
 from .. import pyANN
 import convexdecomposition
 from ..misc import ComputeGeodesicSphereMesh, ComputeBoxMesh, ComputeCylinderYMesh, SpaceSamplerExtra
 import time
 import os.path
+import multiprocessing
 from optparse import OptionParser
 from itertools import izip
 from os import makedirs
@@ -85,6 +87,8 @@ class LinkStatisticsModel(DatabaseGenerator):
     """Computes the convex decomposition of all of the robot's links"""
     
     grabbedjointspheres = None # a list of (grabbedinfo, dict) that stores swept spheres of each joint. key is joint index. 
+    unreachablelinkpairs = None # list of (linkindex0, linkindex1) non-adjacent link pairs whose bounding boxes never overlapped when sampling the joint limits
+    _linkstatisticsmodule = None # computes the statistics
     def __init__(self,robot):
         DatabaseGenerator.__init__(self,robot=robot)
     
@@ -99,7 +103,7 @@ class LinkStatisticsModel(DatabaseGenerator):
             return value
 
     def getversion(self):
-        return 6
+        return 7
     
     def save(self):
         self.SavePickle()
@@ -108,7 +112,7 @@ class LinkStatisticsModel(DatabaseGenerator):
         return self.LoadPickle()
     
     def SavePickle(self):
-        DatabaseGenerator.save(self,self.grabbedjointspheres)
+        DatabaseGenerator.save(self,(self.grabbedjointspheres, self.unreachablelinkpairs))
     
     def LoadPickle(self):
         try:
@@ -119,7 +123,7 @@ class LinkStatisticsModel(DatabaseGenerator):
         
         if params is None:
             return False
-        self.grabbedjointspheres = params
+        self.grabbedjointspheres, self.unreachablelinkpairs = params
         return self.has()
     
     def getfilename(self,read=False):
@@ -187,6 +191,12 @@ class LinkStatisticsModel(DatabaseGenerator):
             else:
                 raise ValueError('no such type')
     
+    def setRobotUnreachableLinkPairs(self):
+        """makes the self-collision checks of the robot skip the link pairs that were never close when sampling its joint limits
+        """
+        if self.unreachablelinkpairs is not None:
+            self.robot.SetUnreachableLinkPairs(self.unreachablelinkpairs)
+
     def autogenerate(self,options=None):
         self.generate()
         self.save()
@@ -194,11 +204,14 @@ class LinkStatisticsModel(DatabaseGenerator):
     def generate(self,**kwargs):
         """
         :param computeaffinevolumes: if True will compute affine volumes
+        :param numlinkpairsamples: number of configurations sampled to find the link pairs that can never collide
+        :param numthreads: number of threads sampling the configurations, by default one per cpu
         """
         with self.robot:
             self.robot.SetTransform(eye(4))
             self.robot.SetDOFValues(zeros(self.robot.GetDOF()))
             self.grabbedjointspheres = [(self.robot.GetGrabbedInfo(), self._ComputeJointSpheres())]
+            self.unreachablelinkpairs = self._ComputeUnreachableLinkPairs(numsamples=kwargs.get('numlinkpairsamples',10000), numthreads=kwargs.get('numthreads',None))
     
     def _GetJointSpheresFromGrabbed(self, grabbedinfo):
         for testgrabbedinfo, testjointspheres in self.grabbedjointspheres:
@@ -211,45 +224,37 @@ class LinkStatisticsModel(DatabaseGenerator):
         self.grabbedjointspheres.append((grabbedinfo, jointspheres)) # tuple copies so that it doesn't change...
         return jointspheres
     
+    def _GetModule(self):
+        if self._linkstatisticsmodule is None:
+            self._linkstatisticsmodule = RaveCreateModule(self.env,'linkstatistics')
+            if self._linkstatisticsmodule is None:
+                raise ValueError(u'failed to create linkstatistics module')
+        return self._linkstatisticsmodule
+
     def _ComputeJointSpheres(self):
+        """returns a dict of the spheres containing the links moved by each revolute joint in the current configuration, computed by the linkstatistics module
+        """
         jointspheres = {}
-        for j in self.robot.GetDependencyOrderedJoints()[::-1]:
-            if not j.IsRevolute(0):
-                continue
-            
-            childlinks = j.GetHierarchyChildLink().GetRigidlyAttachedLinks()
-            sphereradius = 0.0
-            for childlink in childlinks:
-                Tlink = childlink.GetTransform()
-                localaabb = childlink.ComputeLocalAABB()
-                linkpos = dot(Tlink[:3,:3], localaabb.pos()) + Tlink[:3,3]
-                extensiondist = linalg.norm(j.GetAnchor() - linkpos)
-                linkradius = linalg.norm(localaabb.extents())
-                sphereradius = max(sphereradius, linkradius+extensiondist)
-
-            spherepos = j.GetAnchor()
-            # process any child joints
-            minpos = spherepos - sphereradius*ones([1,1,1])
-            maxpos = spherepos + sphereradius*ones([1,1,1])
-
-            childjoints = [testj for testj in self.robot.GetJoints() if testj.GetHierarchyParentLink() in childlinks]
-            for childjoint in childjoints:
-                if childjoint.GetJointIndex() in jointspheres:
-                    childpos, childradius = jointspheres[childjoint.GetJointIndex()]
-                    minpos = numpy.minimum(minpos, childpos - sphereradius*ones([1,1,1]))
-                    maxpos = numpy.maximum(maxpos, childpos + sphereradius*ones([1,1,1]))
-            
-            newspherepos = 0.5*(minpos + maxpos)
-            newsphereradius = linalg.norm(newspherepos - spherepos) + sphereradius
-            for childjoint in childjoints:
-                if childjoint.GetJointIndex() in jointspheres:
-                    childpos, childradius = jointspheres[childjoint.GetJointIndex()]
-                    newsphereradius = max(newsphereradius, linalg.norm(newspherepos - childpos) + childradius)
-
-            # go through all the spheres and get the max radius
-            jointspheres[j.GetJointIndex()] = (numpy.around(newspherepos, 8), numpy.around(newsphereradius, 8))
+        res = self._GetModule().SendCommand('ComputeJointSpheres %s'%self.robot.GetName())
+        for line in res.splitlines():
+            values = line.split()
+            if len(values) == 5:
+                jointspheres[int(values[0])] = (numpy.around(array([float(v) for v in values[1:4]]), 8), numpy.around(float(values[4]), 8))
         return jointspheres
     
+    def _ComputeUnreachableLinkPairs(self, numsamples=10000, padding=0.02, numthreads=None):
+        """samples the joint limits and returns the non-adjacent link pairs whose bounding boxes padded with padding never overlapped
+
+        The samples are split across numthreads environment clones by the linkstatistics module, by default one per cpu.
+        """
+        if numthreads is None:
+            numthreads = multiprocessing.cpu_count()
+        res = self._GetModule().SendCommand('ComputeUnreachableLinkPairs %s numsamples %d padding %.15e numthreads %d'%(self.robot.GetName(), numsamples, padding, numthreads))
+        values = [int(v) for v in res.split()]
+        linkpairs = [(values[i], values[i+1]) for i in range(1, len(values), 2)]
+        log.info('%d/%d non-adjacent link pairs of %s can never collide', len(linkpairs), values[0], self.robot.GetName())
+        return linkpairs
+
     def show(self,options=None):
         pass
     
@@ -0,0 +1,274 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# Copyright (C) 2026 agent <agent@local>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""
+.. _fkfast_compiler:
+
+FKFast: generated forward kinematics
+------------------------------------
+
+Generates C++ code that computes the poses of all the links of a body from its dof values. The
+joint frames are constant folded and every joint is unrolled into a few multiplications and one
+sin/cos pair, so there is no loop over the joints and no quaternion normalization.
+
+The generated code is only valid for the kinematics it was generated from, so it exports the
+kinematics hash of the body and KinBody::SetForwardKinematicsFunctions refuses it for any other
+body. Bodies with mimic joints, moving passive joints or special joints (spherical, hinge2,
+trajectory) are not supported.
+
+Usage::
+
+  python fkfast.py --robot=robots/barrettwam.robot.xml --savefile=fk_wam.cpp
+  g++ -O3 -fPIC -shared fk_wam.cpp -o fk_wam.so
+
+Then load it with the ikfast module::
+
+  module = RaveCreateModule(env,'ikfast')
+  env.Add(module)
+  module.SendCommand('AddFkLibrary %s %s'%(robot.GetName(),'./fk_wam.so'))
+
+Once loaded, `KinBody.SetDOFValues` computes the link transformations with the generated code. The
+jacobians and dynamics are computed by the regular functions from those transformations.
+"""
+from __future__ import with_statement # for python 2.5
+
+import numpy
+from optparse import OptionParser
+
+from openravepy import KinBody, Environment, RaveDestroy, quatFromRotationMatrix
+
+_epsilon = 1e-12
+
+def _quatmult(a, b):
+    return numpy.array([a[0]*b[0] - a[1]*b[1] - a[2]*b[2] - a[3]*b[3],
+                        a[0]*b[1] + a[1]*b[0] + a[2]*b[3] - a[3]*b[2],
+                        a[0]*b[2] - a[1]*b[3] + a[2]*b[0] + a[3]*b[1],
+                        a[0]*b[3] + a[1]*b[2] - a[2]*b[1] + a[3]*b[0]])
+
+def _quatrotation(q):
+    w, x, y, z = q
+    return numpy.array([[1-2*(y*y+z*z), 2*(x*y-w*z), 2*(x*z+w*y)],
+                        [2*(x*y+w*z), 1-2*(x*x+z*z), 2*(y*z-w*x)],
+                        [2*(x*z-w*y), 2*(y*z+w*x), 1-2*(x*x+y*y)]])
+
+def _pose(T):
+    return numpy.array(quatFromRotationMatrix(T[0:3,0:3])), numpy.array(T[0:3,3])
+
+def _number(value):
+    return repr(float(value))
+
+def _linear(terms):
+    """returns the C++ expression of sum(coef*expr) for (coef, expr) pairs, expr is None for constants, negligible coefficients are dropped
+    """
+    s = ''
+    for coef, expr in terms:
+        if abs(coef) <= _epsilon:
+            continue
+        if expr is None:
+            term = _number(abs(coef))
+        elif abs(abs(coef)-1) <= _epsilon:
+            term = expr
+        else:
+            term = '%s*%s'%(_number(abs(coef)), expr)
+        if len(s) == 0:
+            s = term if coef > 0 else '-'+term
+        else:
+            s += (' + ' if coef > 0 else ' - ') + term
+    return s if len(s) > 0 else '0'
+
+def _GetParentIndex(joint):
+    """returns the index of the link the pose of the child link of joint is computed from, joints without a parent link are attached to the base link like in KinBody.SetDOFValues
+    """
+    parent = joint.GetHierarchyParentLink()
+    return 0 if parent is None else parent.GetIndex()
+
+class ForwardKinematicsGenerator(object):
+    """generates the forward kinematics code of a body
+    """
+    def __init__(self, body):
+        self.body = body
+
+    def _GetOrderedJoints(self):
+        """returns the joints so that the parent link of every joint is computed before it
+        """
+        body = self.body
+        for joint in body.GetJoints():
+            if joint.IsMimic() or not joint.GetType() in (KinBody.JointType.Revolute, KinBody.JointType.Prismatic):
+                raise ValueError('joint %s of type %s is not supported'%(joint.GetName(), joint.GetType()))
+        for joint in body.GetPassiveJoints():
+            if joint.IsMimic() or not joint.IsStatic() or joint.GetDOF() != 1 or not joint.GetType() in (KinBody.JointType.Revolute, KinBody.JointType.Prismatic):
+                raise ValueError('passive joint %s is not static'%joint.GetName())
+        joints = list(body.GetJoints()) + list(body.GetPassiveJoints())
+        computed = set([0])
+        ordered = []
+        while len(joints) > 0:
+            # joints whose child is already computed, like static joints attached to the base link, do not move anything
+            joints = [joint for joint in joints if joint.GetHierarchyChildLink().GetIndex() not in computed]
+            ready = [joint for joint in joints if _GetParentIndex(joint) in computed]
+            if len(ready) == 0:
+                break
+            for joint in ready:
+                if joint.GetHierarchyChildLink().GetIndex() not in computed:
+                    computed.add(joint.GetHierarchyChildLink().GetIndex())
+                    ordered.append(joint)
+        if len(computed) != len(body.GetLinks()):
+            raise ValueError('links %s are not attached to the base link'%[link.GetName() for link in body.GetLinks() if link.GetIndex() not in computed])
+        return ordered
+
+    def generate(self):
+        body = self.body
+        lines = []
+        # constant links are stored as numbers, the others as the names of the variables holding them
+        poses = [None]*len(body.GetLinks())
+        poses[0] = (numpy.array([1.0,0,0,0]), numpy.zeros(3), True)
+        rotations = {}
+        def getrotation(ilink):
+            if not ilink in rotations:
+                q = poses[ilink][0]
+                names = [['m%d_%d%d'%(ilink,i,j) for j in range(3)] for i in range(3)]
+                exprs = [['1 - 2*(%s*%s + %s*%s)'%(q[2],q[2],q[3],q[3]), '2*(%s*%s - %s*%s)'%(q[1],q[2],q[0],q[3]), '2*(%s*%s + %s*%s)'%(q[1],q[3],q[0],q[2])],
+                         ['2*(%s*%s + %s*%s)'%(q[1],q[2],q[0],q[3]), '1 - 2*(%s*%s + %s*%s)'%(q[1],q[1],q[3],q[3]), '2*(%s*%s - %s*%s)'%(q[2],q[3],q[0],q[1])],
+                         ['2*(%s*%s - %s*%s)'%(q[1],q[3],q[0],q[2]), '2*(%s*%s + %s*%s)'%(q[2],q[3],q[0],q[1]), '1 - 2*(%s*%s + %s*%s)'%(q[1],q[1],q[2],q[2])]]
+                for i in range(3):
+                    for j in range(3):
+                        lines.append('const double %s = %s;'%(names[i][j], exprs[i][j]))
+                rotations[ilink] = names
+            return rotations[ilink]
+
+        for joint in self._GetOrderedJoints():
+            iparent = _GetParentIndex(joint)
+            ichild = joint.GetHierarchyChildLink().GetIndex()
+            qL, tL = _pose(joint.GetInternalHierarchyLeftTransform())
+            qR, tR = _pose(joint.GetInternalHierarchyRightTransform())
+            axis = numpy.array(joint.GetInternalHierarchyAxis(0))
+            RL = _quatrotation(qL)
+            lines.append('// %s'%joint.GetName())
+            # the relative pose of the child is qA*c + qB*s, U*cos + V*sin + W, with (c,s) the terms of the joint value
+            if joint.GetDOFIndex() < 0:
+                value = joint.GetLimits()[0][0]
+                if joint.IsRevolute(0):
+                    qJ = numpy.r_[numpy.cos(0.5*value), numpy.sin(0.5*value)*axis]
+                    tJ = numpy.zeros(3)
+                else:
+                    qJ = numpy.array([1.0,0,0,0])
+                    tJ = axis*value
+                qA, qB = _quatmult(_quatmult(qL, qJ), qR), numpy.zeros(4)
+                U, V, W = numpy.zeros(3), numpy.zeros(3), tL + numpy.dot(RL, tJ + numpy.dot(_quatrotation(qJ), tR))
+                c, s, cos, sin = None, None, None, None
+            elif joint.IsRevolute(0):
+                dofindex = joint.GetDOFIndex()
+                qA = _quatmult(qL, qR)
+                qB = _quatmult(_quatmult(qL, numpy.r_[0, axis]), qR)
+                tRaxis = axis*numpy.dot(axis, tR)
+                U, V, W = numpy.dot(RL, tR-tRaxis), numpy.dot(RL, numpy.cross(axis, tR)), tL + numpy.dot(RL, tRaxis)
+                c, s, cos, sin = 'c%d'%ichild, 's%d'%ichild, 'cos%d'%ichild, 'sin%d'%ichild
+                lines.append('const double %s = std::cos(0.5*pdofvalues[%d]), %s = std::sin(0.5*pdofvalues[%d]);'%(c,dofindex,s,dofindex))
+                lines.append('const double %s = %s*%s - %s*%s, %s = 2*%s*%s;'%(cos,c,c,s,s,sin,s,c))
+            else:
+                dofindex = joint.GetDOFIndex()
+                qA, qB = _quatmult(qL, qR), numpy.zeros(4)
+                U, V, W = numpy.dot(RL, axis), numpy.zeros(3), tL + numpy.dot(RL, tR)
+                c, s, cos, sin = None, None, 'pdofvalues[%d]'%dofindex, None
+
+            qparent, tparent, bconstant = poses[iparent]
+            if bconstant:
+                # fold the parent pose into the coefficients
+                Rparent = _quatrotation(qparent)
+                qA, qB = _quatmult(qparent, qA), _quatmult(qparent, qB)
+                U, V, W = numpy.dot(Rparent, U), numpy.dot(Rparent, V), tparent + numpy.dot(Rparent, W)
+                if c is None and cos is None:
+                    poses[ichild] = (qA, W, True)
+                    continue
+                qnames = ['q%d_%d'%(ichild,k) for k in range(4)]
+                tnames = ['t%d_%d'%(ichild,k) for k in range(3)]
+                for k in range(4):
+                    lines.append('const double %s = %s;'%(qnames[k], _linear([(qA[k], c), (qB[k], s)]) if c is not None else _number(qA[k])))
+                for k in range(3):
+                    lines.append('const double %s = %s;'%(tnames[k], _linear([(U[k], cos), (V[k], sin), (W[k], None)])))
+            else:
+                qnames = ['q%d_%d'%(ichild,k) for k in range(4)]
+                tnames = ['t%d_%d'%(ichild,k) for k in range(3)]
+                if c is not None:
+                    qrel = ['qr%d_%d'%(ichild,k) for k in range(4)]
+                    for k in range(4):
+                        lines.append('const double %s = %s;'%(qrel[k], _linear([(qA[k], c), (qB[k], s)])))
+                    a, b = qparent, qrel
+                    lines.append('const double %s = %s*%s - %s*%s - %s*%s - %s*%s;'%(qnames[0], a[0],b[0],a[1],b[1],a[2],b[2],a[3],b[3]))
+                    lines.append('const double %s = %s*%s + %s*%s + %s*%s - %s*%s;'%(qnames[1], a[0],b[1],a[1],b[0],a[2],b[3],a[3],b[2]))
+                    lines.append('const double %s = %s*%s - %s*%s + %s*%s + %s*%s;'%(qnames[2], a[0],b[2],a[1],b[3],a[2],b[0],a[3],b[1]))
+                    lines.append('const double %s = %s*%s + %s*%s - %s*%s + %s*%s;'%(qnames[3], a[0],b[3],a[1],b[2],a[2],b[1],a[3],b[0]))
+                else:
+                    # constant relative rotation
+                    a, b = qparent, qA
+                    lines.append('const double %s = %s;'%(qnames[0], _linear([(b[0],a[0]), (-b[1],a[1]), (-b[2],a[2]), (-b[3],a[3])])))
+                    lines.append('const double %s = %s;'%(qnames[1], _linear([(b[1],a[0]), (b[0],a[1]), (-b[3],a[2]), (b[2],a[3])])))
+                    lines.append('const double %s = %s;'%(qnames[2], _linear([(b[2],a[0]), (b[3],a[1]), (b[0],a[2]), (-b[1],a[3])])))
+                    lines.append('const double %s = %s;'%(qnames[3], _linear([(b[3],a[0]), (-b[2],a[1]), (b[1],a[2]), (b[0],a[3])])))
+                trel = ['tr%d_%d'%(ichild,k) for k in range(3)]
+                for k in range(3):
+                    lines.append('const double %s = %s;'%(trel[k], _linear([(U[k], cos), (V[k], sin), (W[k], None)])))
+                m = getrotation(iparent)
+                for k in range(3):
+                    lines.append('const double %s = %s + %s*%s + %s*%s + %s*%s;'%(tnames[k], tparent[k], m[k][0], trel[0], m[k][1], trel[1], m[k][2], trel[2]))
+            poses[ichild] = (qnames, tnames, False)
+
+        for ilink, (q, t, bconstant) in enumerate(poses):
+            values = [_number(v) for v in q] + [_number(v) for v in t] if bconstant else list(q) + list(t)
+            lines.append(' '.join(['plinkposes[%d] = %s;'%(7*ilink+k, value) for k, value in enumerate(values)]))
+
+        code = """/// autogenerated forward kinematics of %(name)s by fkfast.py, see KinBody::SetForwardKinematicsFunctions
+#include <cmath>
+
+#ifdef _MSC_VER
+#define FKFAST_API extern "C" __declspec(dllexport)
+#else
+#define FKFAST_API extern "C"
+#endif
+
+FKFAST_API int GetFkRealSize() { return sizeof(double); }
+FKFAST_API const char* GetFkKinematicsHash() { return "%(hash)s"; }
+FKFAST_API int GetFkNumDOFs() { return %(dof)d; }
+FKFAST_API int GetFkNumLinks() { return %(numlinks)d; }
+
+/// \\brief computes the poses of all the links relative to the base link, 7 values per link: quaternion (w,x,y,z) followed by the translation
+FKFAST_API void ComputeFkLinkPoses(const double* pdofvalues, double* plinkposes)
+{
+%(code)s
+}
+"""%{'name':body.GetName(), 'hash':body.GetKinematicsGeometryHash(), 'dof':body.GetDOF(), 'numlinks':len(body.GetLinks()), 'code':'\n'.join(['    '+line for line in lines])}
+        return code
+
+def main():
+    parser = OptionParser(description='Generates C++ code computing the forward kinematics of a robot.')
+    parser.add_option('--robot', action='store', type='string', dest='robot', default=None,
+                      help='robot file (COLLADA or OpenRAVE XML)')
+    parser.add_option('--savefile', action='store', type='string', dest='savefile', default='fk.cpp',
+                      help='filename where to store the generated c++ code')
+    (options, args) = parser.parse_args()
+    if options.robot is None:
+        parser.print_help()
+        return
+    env = Environment()
+    try:
+        with env:
+            body = env.ReadRobotURI(options.robot)
+            env.Add(body)
+            code = ForwardKinematicsGenerator(body).generate()
+        open(options.savefile,'w').write(code)
+    finally:
+        env.Destroy()
+        RaveDestroy()
+
+if __name__ == '__main__':
+    main()
@@ -138,7 +138,7 @@ template <typename T>
 class IkFastFunctions
 {
 public:
-    IkFastFunctions() : _ComputeIk(NULL), _ComputeIk2(NULL), _ComputeFk(NULL), _GetNumFreeParameters(NULL), _GetFreeIndices(NULL), _GetNumJoints(NULL), _GetIkRealSize(NULL), _GetIkFastVersion(NULL), _GetIkType(NULL), _GetKinematicsHash(NULL) {
+    IkFastFunctions() : _ComputeIk(NULL), _ComputeIk2(NULL), _ComputeIkBatch(NULL), _ComputeFk(NULL), _GetNumFreeParameters(NULL), _GetFreeIndices(NULL), _GetNumJoints(NULL), _GetIkRealSize(NULL), _GetIkFastVersion(NULL), _GetIkType(NULL), _GetKinematicsHash(NULL) {
     }
     virtual ~IkFastFunctions() {
     }
@@ -146,6 +146,8 @@ public:
     ComputeIkFn _ComputeIk;
     typedef bool (*ComputeIk2Fn)(const T*, const T*, const T*, IkSolutionListBase<T>&, void*);
     ComputeIk2Fn _ComputeIk2;
+    typedef int (*ComputeIkBatchFn)(int, const T*, const T*, const T*, IkSolutionListBase<T>**, unsigned char*);
+    ComputeIkBatchFn _ComputeIkBatch;
     typedef void (*ComputeFkFn)(const T*, T*, T*);
     ComputeFkFn _ComputeFk;
     typedef int (*GetNumFreeParametersFn)();
@@ -569,6 +571,15 @@ IKFAST_API bool ComputeIk(const IkReal* eetrans, const IkReal* eerot, const IkRe
  */
 IKFAST_API bool ComputeIk2(const IkReal* eetrans, const IkReal* eerot, const IkReal* pfree, ikfast::IkSolutionListBase<IkReal>& solutions, void* pOpenRAVEManip);
 
+/** \brief Solves the ik of numposes poses in one call, optional.
+
+    eetrans and eerot hold the poses as structure-of-arrays, so element j of pose i is at eetrans[j*numposes+i]. They follow
+    the same conventions as \ref ComputeIk and can be NULL when the ik type does not use them. All poses share pfree.
+    psuccess[i] is set to 1 if solutions[i] has solutions.
+    \return the number of poses that have solutions
+ */
+IKFAST_API int ComputeIkBatch(int numposes, const IkReal* eetrans, const IkReal* eerot, const IkReal* pfree, ikfast::IkSolutionListBase<IkReal>** solutions, unsigned char* psuccess);
+
 /// \brief Computes the end effector coordinates given the joint values. This function is used to double check ik.
 IKFAST_API void ComputeFk(const IkReal* joints, IkReal* eetrans, IkReal* eerot);
 
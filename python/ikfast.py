@@ -187,6 +187,7 @@ __license__ = 'Lesser GPL, Version 3'
 __version__ = '0x1000004b' # hex of the version, has to be prefixed with 0x. also in ikfast.h
 
 import sys, copy, time, math, datetime
+import os, hashlib, cPickle, multiprocessing, Queue
 import __builtin__
 from optparse import OptionParser
 try:
@@ -1373,11 +1374,15 @@ class IKFastSolver(AutoReloader):
                     return True
             return False
     
-    def __init__(self, kinbody=None,kinematicshash='',precision=None, checkpreemptfn=None):
+    def __init__(self, kinbody=None,kinematicshash='',precision=None, checkpreemptfn=None, numprocesses=1, cachedir=None):
         """
         :param checkpreemptfn: checkpreemptfn(msg, progress) called periodically at various points in ikfast. Takes in two arguments to notify user how far the process has completed.
+        :param numprocesses: number of processes trying the independent solving attempts at the same time. The extra processes are forked, so only available on posix systems.
+        :param cachedir: if not None, the directory storing which solving attempts failed for the kinematics, these are skipped when generating the same kinematics again.
         """
         self._checkpreemptfn = checkpreemptfn
+        self.numprocesses = numprocesses
+        self.cachedir = cachedir
         self.usinglapack = False
         self.useleftmultiply = True
         self.freevarsubs = []
@@ -1412,6 +1417,118 @@ class IKFastSolver(AutoReloader):
         if self._checkpreemptfn is not None:
             self._checkpreemptfn(msg, progress=progress)
     
+    def _GetAttemptCacheFilename(self):
+        kinematicshash = self.kinematicshash if isinstance(self.kinematicshash,basestring) else ''
+        if len(kinematicshash) == 0 and self.kinbody is not None:
+            kinematicshash = self.kinbody.GetKinematicsGeometryHash()
+        return os.path.join(self.cachedir,'ikfastattempts.%s.%s.pp'%(kinematicshash,__version__))
+
+    def _LoadAttemptCache(self):
+        """returns the dict of the attempt keys that failed before for the kinematics
+        """
+        if self.cachedir is None:
+            return {}
+        try:
+            with open(self._GetAttemptCacheFilename(),'rb') as f:
+                return cPickle.load(f)
+        except (IOError, EOFError, cPickle.UnpicklingError):
+            return {}
+
+    def _SaveAttemptCache(self, cache):
+        if self.cachedir is None:
+            return
+        try:
+            if not os.path.isdir(self.cachedir):
+                os.makedirs(self.cachedir)
+            filename = self._GetAttemptCacheFilename()
+            with open(filename+'.tmp','wb') as f:
+                cPickle.dump(cache,f,cPickle.HIGHEST_PROTOCOL)
+            os.rename(filename+'.tmp',filename)
+        except (IOError, OSError), e:
+            log.warn(u'failed to save the ikfast attempt cache: %s', e)
+
+    def _GetAttemptKey(self, description):
+        """the key of an attempt also depends on the options changing what is solved
+        """
+        return hashlib.md5(repr((self._iktype,[str(v) for v in self.freejointvars],self.maxcasedepth,self.precision,self._ikfastoptions,description))).hexdigest()
+
+    def _TryAttemptInProcess(self, index, fn, queue):
+        """runs the attempt fn in a forked process and puts (index, success, message) in queue. success is None if the attempt failed for an unexpected reason.
+        """
+        try:
+            fn()
+            queue.put((index,True,u''))
+        except (self.CannotSolveError,self.IKFeasibilityError), e:
+            queue.put((index,False,unicode(e)))
+        except Exception, e:
+            queue.put((index,None,unicode(e)))
+
+    def SolveFirstAttempt(self, attempts):
+        """Returns the tree of the first attempt that solves in the order of attempts, or None if all attempts fail.
+
+        :param attempts: list of (description, fn). fn() returns the tree or raises CannotSolveError or IKFeasibilityError, description is a tuple identifying the attempt for the current kinematics.
+
+        If cachedir is set, the attempts that failed when generating the same kinematics before are skipped.
+        If numprocesses > 1, the next attempts are tried by forked processes while the current one is solved. The tree of an attempt that succeeds in another process cannot be sent back, so it is solved again in this process.
+        """
+        cache = self._LoadAttemptCache()
+        pending = []
+        for description, fn in attempts:
+            key = self._GetAttemptKey(description)
+            if cache.get(key,True) is False:
+                log.info('skipping attempt %r, it failed before for this kinematics', description)
+            else:
+                pending.append((key,description,fn))
+        queue = None
+        if self.numprocesses > 1 and len(pending) > 1 and hasattr(os,'fork'):
+            queue = multiprocessing.Queue()
+        processes = {}
+        results = {}
+        inextprocess = 1
+        try:
+            for ipending, (key, description, fn) in enumerate(pending):
+                if queue is not None:
+                    while ipending not in results:
+                        # keep numprocesses-1 processes trying the attempts after the current one
+                        while inextprocess < len(pending) and len(processes) < self.numprocesses-1:
+                            process = multiprocessing.Process(target=self._TryAttemptInProcess, args=(inextprocess,pending[inextprocess][2],queue))
+                            process.daemon = True
+                            process.start()
+                            processes[inextprocess] = process
+                            inextprocess += 1
+                        if ipending == 0:
+                            break
+                        try:
+                            index, success, message = queue.get(True,1.0)
+                        except Queue.Empty:
+                            for index, process in processes.items():
+                                if not process.is_alive() and process.exitcode != 0:
+                                    results[index] = (None,u'process exited with %s'%process.exitcode)
+                                    processes.pop(index)
+                            continue
+                        results[index] = (success,message)
+                        processes.pop(index).join()
+                        if success is False:
+                            cache[pending[index][0]] = False
+                            self._SaveAttemptCache(cache)
+                    if ipending > 0:
+                        success, message = results.pop(ipending)
+                        if not success:
+                            log.warn(u'attempt %r: %s', description, message)
+                            continue
+                        log.info('attempt %r succeeded in another process, solving it again', description)
+                try:
+                    return fn()
+                except (self.CannotSolveError,self.IKFeasibilityError), e:
+                    log.warn(u'%s',e)
+                    cache[key] = False
+                    self._SaveAttemptCache(cache)
+        finally:
+            for process in processes.itervalues():
+                process.terminate()
+                process.join()
+        return None
+
     def convertRealToRational(self, x,precision=None):
         if precision is None:
             precision=self.precision
@@ -2964,31 +3081,23 @@ class IKFastSolver(AutoReloader):
                                 if tree is not None:
                                     break
         if tree is None:
-            linklist = list(self.iterateThreeNonIntersectingAxes(solvejointvars,Links, LinksInv))
-            # first try LiWoernleHiller since it is most robust
-            for ilinklist, (T0links, T1links) in enumerate(linklist):
-                log.info('try first group %d/%d', ilinklist, len(linklist))
-                try:
-                    # if T1links[-1] doesn't have any symbols, put it over to T0links. Since T1links has the position unknowns, putting over the coefficients to T0links makes things simpler
-                    if not self.has(T1links[-1], *solvejointvars):
-                        T0links.append(self.affineInverse(T1links.pop(-1)))
-                    tree = self.solveFullIK_6DGeneral(T0links, T1links, solvejointvars, endbranchtree, usesolvers=1)
-                    break
-                except (self.CannotSolveError,self.IKFeasibilityError), e:
-                    log.warn('%s',e)
+            linklist = []
+            for T0links, T1links in self.iterateThreeNonIntersectingAxes(solvejointvars,Links, LinksInv):
+                # if T1links[-1] doesn't have any symbols, put it over to T0links. Since T1links has the position unknowns, putting over the coefficients to T0links makes things simpler
+                if not self.has(T1links[-1], *solvejointvars):
+                    T0links.append(self.affineInverse(T1links.pop(-1)))
+                linklist.append((T0links, T1links))
+            
+            def _Solve6DGeneral(ilinklist, usesolvers):
+                log.info('try group %d/%d with solvers %d', ilinklist, len(linklist), usesolvers)
+                T0links, T1links = linklist[ilinklist]
+                return self.solveFullIK_6DGeneral(list(T0links), list(T1links), solvejointvars, endbranchtree, usesolvers=usesolvers)
             
+            # first try LiWoernleHiller since it is most robust
+            tree = self.SolveFirstAttempt([(('6dgeneral',1,ilinklist), lambda ilinklist=ilinklist: _Solve6DGeneral(ilinklist,1)) for ilinklist in range(len(linklist))])
             if tree is None:
                 log.info('trying the rest of the general ik solvers')
-                for ilinklist, (T0links, T1links) in enumerate(linklist):
-                    log.info('try second group %d/%d', ilinklist, len(linklist))
-                    try:
-                        # if T1links[-1] doesn't have any symbols, put it over to T0links. Since T1links has the position unknowns, putting over the coefficients to T0links makes things simpler
-                        if not self.has(T1links[-1], *solvejointvars):
-                            T0links.append(self.affineInverse(T1links.pop(-1)))
-                        tree = self.solveFullIK_6DGeneral(T0links, T1links, solvejointvars, endbranchtree, usesolvers=6)
-                        break
-                    except (self.CannotSolveError,self.IKFeasibilityError), e:
-                        log.warn('%s',e)
+                tree = self.SolveFirstAttempt([(('6dgeneral',6,ilinklist), lambda ilinklist=ilinklist: _Solve6DGeneral(ilinklist,6)) for ilinklist in range(len(linklist))])
                 
         if tree is None:
             raise self.CannotSolveError('cannot solve 6D mechanism!')
@@ -2998,13 +3107,11 @@ class IKFastSolver(AutoReloader):
         return chaintree
     
     def TestIntersectingAxes(self,solvejointvars,Links,LinksInv,endbranchtree):
-        for T0links,T1links,transvars,rotvars,solveRotationFirst in self.iterateThreeIntersectingAxes(solvejointvars,Links, LinksInv):
-            try:
-                return self.solve6DIntersectingAxes(T0links,T1links,transvars,rotvars,solveRotationFirst=solveRotationFirst, endbranchtree=endbranchtree)
-            
-            except (self.CannotSolveError,self.IKFeasibilityError), e:
-                log.warn('%s',e)
-        return None
+        attempts = []
+        linkshash = hashlib.md5(repr(Links)).hexdigest()
+        for iattempt, (T0links,T1links,transvars,rotvars,solveRotationFirst) in enumerate(self.iterateThreeIntersectingAxes(solvejointvars,Links, LinksInv)):
+            attempts.append((('intersectingaxes',linkshash,iattempt), lambda T0links=T0links,T1links=T1links,transvars=transvars,rotvars=rotvars,solveRotationFirst=solveRotationFirst: self.solve6DIntersectingAxes(T0links,T1links,transvars,rotvars,solveRotationFirst=solveRotationFirst, endbranchtree=endbranchtree)))
+        return self.SolveFirstAttempt(attempts)
 
     def _ExtractTranslationsOutsideOfMatrixMultiplication(self, Links, solvejointvars):
         """try to extract translations outside of the multiplication (left and right)
@@ -9594,6 +9701,10 @@ python ikfast.py --robot=robots/barrettwam.robot.xml --baselink=0 --eelink=7 --s
                       help='The max depth to go into degenerate cases. If ikfast file is too big, try reducing this, (default=%default).')
     parser.add_option('--lang', action='store',type='string',dest='lang',default='cpp',
                       help='The language to generate the code in (default=%default), available=('+','.join(name for name,value in CodeGenerators.iteritems())+')')
+    parser.add_option('--numprocesses', action='store', type='int', dest='numprocesses',default=1,
+                      help='The number of processes trying the independent solving attempts at the same time (default=%default).')
+    parser.add_option('--cachedir', action='store', type='string', dest='cachedir',default=None,
+                      help='If set, the directory storing the solving attempts that failed, so that generating the same kinematics again skips them.')
     parser.add_option('--debug','-d', action='store', type='int',dest='debug',default=logging.INFO,
                       help='Debug level for python nose (smaller values allow more text).')
     
@@ -9614,7 +9725,7 @@ python ikfast.py --robot=robots/barrettwam.robot.xml --baselink=0 --eelink=7 --s
             env=openravepy.Environment()
             kinbody=env.ReadRobotXMLFile(options.robot)
             env.Add(kinbody)
-            solver = IKFastSolver(kinbody,kinbody)
+            solver = IKFastSolver(kinbody,kinbody,numprocesses=options.numprocesses,cachedir=options.cachedir)
             solver.maxcasedepth = options.maxcasedepth
             chaintree = solver.generateIkSolver(options.baselink,options.eelink,options.freeindices,solvefn=solvefn)
             code=solver.writeIkSolver(chaintree,lang=options.lang)
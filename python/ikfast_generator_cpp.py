@@ -552,6 +552,33 @@ IKSolver solver;
 return solver.ComputeIk(eetrans,eerot,pfree,solutions);
 }
 
+/// solves the inverse kinematics equations for numposes poses sharing the same free joint values.
+/// \param eetrans structure-of-arrays translations, element j of pose i is at eetrans[j*numposes+i]. NULL if the ik type does not use it.
+/// \param eerot structure-of-arrays rotations, element j of pose i is at eerot[j*numposes+i]. NULL if the ik type does not use it.
+/// \param solutions numposes pointers to the solution lists to fill
+/// \param psuccess numposes flags set to 1 if the pose has solutions
+/// \return the number of poses that have solutions
+IKFAST_API int ComputeIkBatch(int numposes, const IkReal* eetrans, const IkReal* eerot, const IkReal* pfree, IkSolutionListBase<IkReal>** solutions, unsigned char* psuccess) {
+IKSolver solver;
+IkReal posetrans[3], poserot[9];
+int numsuccess = 0;
+for(int ipose = 0; ipose < numposes; ++ipose) {
+    if( eetrans != NULL ) {
+        for(int j = 0; j < 3; ++j) {
+            posetrans[j] = eetrans[j*numposes+ipose];
+        }
+    }
+    if( eerot != NULL ) {
+        for(int j = 0; j < 9; ++j) {
+            poserot[j] = eerot[j*numposes+ipose];
+        }
+    }
+    psuccess[ipose] = solver.ComputeIk(eetrans != NULL ? posetrans : NULL, eerot != NULL ? poserot : NULL, pfree, *solutions[ipose]) ? 1 : 0;
+    numsuccess += psuccess[ipose];
+}
+return numsuccess;
+}
+
 IKFAST_API const char* GetKinematicsHash() { return "%s"; }
 
 IKFAST_API const char* GetIkFastVersion() { return "%s"; }
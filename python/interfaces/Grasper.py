@@ -181,6 +181,29 @@ class Grasper:
             resvalues.append([position, direction, roll, standoff, manipulatordirection, mindist, volume, preshape,Tfinal,finalshape,contacts])
         return nextid, resvalues
 
+    def ComputeForceClosures(self,contactsets,friction=None,conepoints=None,threshold=None):
+        """Computes the force closure of many contact sets with one command.
+
+        :param contactsets: list of Nx6 arrays of contact positions and normals
+        :param threshold: if set, contact sets whose approximate force closure distance is below it return 0 without computing the convex hull
+        :return: Mx2 array of mindist and volume
+        """
+        cmd = 'ComputeForceClosures '
+        if friction is None:
+            friction = self.friction
+        cmd += 'friction %.15e '%friction
+        if conepoints is not None:
+            cmd += 'conepoints %d '%conepoints
+        if threshold is not None:
+            cmd += 'threshold %.15e '%threshold
+        cmd += 'contactsets %d '%len(contactsets)
+        for contacts in contactsets:
+            cmd += '%d '%len(contacts) + ' '.join('%.15e'%f for f in array(contacts).flat) + ' '
+        res = self.prob.SendCommand(cmd)
+        if res is None:
+            raise PlanningError('ComputeForceClosures')
+        return reshape(array([float64(f) for f in res.split()],float64),(len(contactsets),2))
+
     def ConvexHull(self,points,returnplanes=True,returnfaces=True,returntriangles=True):
         """See :ref:`module-grasper-convexhull`
         """
@@ -65,11 +65,12 @@ class TaskManipulation:
         self.robot = robot
         return self.prob.SendCommand(u'setrobot '+robot.GetName())
     
-    def GraspPlanning(self,graspindices=None,grasps=None,target=None,approachoffset=0,destposes=None,seedgrasps=None,seeddests=None,seedik=None,maxiter=None,randomgrasps=None,randomdests=None, execute=None,outputtraj=None,grasptranslationstepmult=None,graspfinestep=None,outputtrajobj=None,gmodel=None,paddedgeometryinfo=None,steplength=None,releasegil=False):
+    def GraspPlanning(self,graspindices=None,grasps=None,target=None,approachoffset=0,destposes=None,seedgrasps=None,seeddests=None,seedik=None,maxiter=None,randomgrasps=None,randomdests=None, execute=None,outputtraj=None,grasptranslationstepmult=None,graspfinestep=None,outputtrajobj=None,gmodel=None,paddedgeometryinfo=None,steplength=None,releasegil=False,sortgraspsbycost=None):
         """See :ref:`module-taskmanipulation-graspplanning`
 
         If gmodel is specified, then do not have to fill graspindices, grasps, target, grasptranslationstepmult, graspfinestep
         :param paddedgeometryinfo: (groupname, padding)
+        :param sortgraspsbycost: if True and the grasps are given by their transforms, tries the grasps with the closest ik solutions first
         """
         if gmodel is not None:
             if target is None:
@@ -118,6 +119,8 @@ class TaskManipulation:
             cmd.write('randomgrasps %d '%randomgrasps)
         if randomdests is not None:
             cmd.write('randomdests %d '%randomdests)
+        if sortgraspsbycost is not None:
+            cmd.write('sortgraspsbycost %d '%sortgraspsbycost)
         if steplength is not None:
             cmd.write('steplength %.15e '%steplength)
         if execute is not None:
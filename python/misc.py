@@ -875,3 +875,97 @@ def CompareEnvironments(env,env2,options=openravepy_int.CloningOptions.Bodies,ep
                 assert( set([body.GetName() for body in grabbed]) == set([body.GetName() for body in grabbed2]) )
                 assert( transdist(robot.GetActiveDOFIndices(),robot2.GetActiveDOFIndices()) == 0)
                 assert( robot.GetActiveManipulator().GetName() == robot2.GetActiveManipulator().GetName())
+
+_poolworkerenv = None # the environment of the EnvironmentPool worker process
+
+def _InitializeEnvironmentPoolWorker(filenames, initfn):
+    global _poolworkerenv
+    openravepy_int.RaveInitialize(True)
+    _poolworkerenv = openravepy_int.Environment()
+    for filename in filenames:
+        if not _poolworkerenv.Load(filename):
+            raise OpenRAVEException('EnvironmentPool worker failed to load %s'%filename)
+    if initfn is not None:
+        initfn(_poolworkerenv)
+
+def _RunEnvironmentPoolTask(fnarg):
+    fn, arg = fnarg
+    with _poolworkerenv:
+        return fn(_poolworkerenv, arg)
+
+class EnvironmentPool:
+    """Runs tasks on worker processes that each keep an environment with the same scene loaded.
+
+    The scene files are loaded once by the calling process to fill the binary scene cache (see OPENRAVE_SCENE_CACHE), so every worker builds its bodies from the cache instead of parsing the files and triangulating the meshes again. If OPENRAVE_SCENE_CACHE is not set, a temporary cache directory is used until the pool is closed. Together with the plugin manifest this keeps the start of a worker well below the time of a normal load.
+
+    Workers are spawned instead of forked when python supports it, because an initialized openrave process cannot be forked safely: the simulation and plugin threads do not exist in the child and can hold locks.
+
+    Every task is called as fn(env, arg) with the environment of the worker locked. fn and arg have to be picklable, so fn has to be defined at module level. Usage::
+
+      def CheckConfiguration(env, values):
+          robot = env.GetRobots()[0]
+          robot.SetDOFValues(values)
+          return env.CheckCollision(robot)
+
+      with EnvironmentPool(['data/lab1.env.xml'], numworkers=4) as pool:
+          collisions = pool.map(CheckConfiguration, configurations)
+
+    :param filenames: the files every worker loads into its environment
+    :param numworkers: the number of processes, defaults to the number of cores
+    :param initfn: if not None, called as initfn(env) by every worker after loading, for example to set the active dofs. Has to be picklable.
+    """
+    def __init__(self, filenames, numworkers=None, initfn=None):
+        import multiprocessing, tempfile
+        self._tempcachedir = None
+        if os.environ.get('OPENRAVE_SCENE_CACHE') is None:
+            self._tempcachedir = tempfile.mkdtemp(prefix='openravescenecache')
+            os.environ['OPENRAVE_SCENE_CACHE'] = self._tempcachedir # inherited by the workers
+        # fill the scene cache before the workers start
+        env = openravepy_int.Environment()
+        try:
+            for filename in filenames:
+                if not env.Load(filename):
+                    raise OpenRAVEException('EnvironmentPool failed to load %s'%filename)
+        finally:
+            env.Destroy()
+        if hasattr(multiprocessing, 'get_context'):
+            context = multiprocessing.get_context('spawn')
+        else:
+            log.warn('python cannot spawn processes, so the EnvironmentPool workers are forked')
+            context = multiprocessing
+        self._pool = context.Pool(numworkers, _InitializeEnvironmentPoolWorker, (list(filenames), initfn))
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.Close()
+
+    def map(self, fn, args, chunksize=None):
+        """returns [fn(env, arg) for arg in args] computed by the workers
+        """
+        return self._pool.map(_RunEnvironmentPoolTask, [(fn, arg) for arg in args], chunksize)
+
+    def imap_unordered(self, fn, args, chunksize=1):
+        """returns an iterator over fn(env, arg) in the order the workers finish them
+        """
+        return self._pool.imap_unordered(_RunEnvironmentPoolTask, ((fn, arg) for arg in args), chunksize)
+
+    def apply_async(self, fn, arg):
+        """starts fn(env, arg) on a worker and returns its multiprocessing.pool.AsyncResult
+        """
+        return self._pool.apply_async(_RunEnvironmentPoolTask, ((fn, arg),))
+
+    def Close(self):
+        """waits for the tasks to finish and stops the workers
+        """
+        if self._pool is not None:
+            self._pool.close()
+            self._pool.join()
+            self._pool = None
+        if self._tempcachedir is not None:
+            import shutil
+            if os.environ.get('OPENRAVE_SCENE_CACHE') == self._tempcachedir:
+                del os.environ['OPENRAVE_SCENE_CACHE']
+            shutil.rmtree(self._tempcachedir, ignore_errors=True)
+            self._tempcachedir = None
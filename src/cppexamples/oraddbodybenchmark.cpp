@@ -0,0 +1,114 @@
+/** \example oraddbodybenchmark.cpp
+    \author agent
+
+    Measures how long it takes to add a serial chain of box links connected by revolute joints to the
+    environment for increasing number of links. Adding a body computes its internal kinematics
+    information, so this shows how that computation scales with the size of the body.
+
+    Usage:
+    \verbatim
+    oraddbodybenchmark [--repetitions N] [numlinks ...]
+    \endverbatim
+
+    Example:
+    \verbatim
+    oraddbodybenchmark 10 100 1000
+    \endverbatim
+
+    <b>Full Example Code:</b>
+ */
+#include <openrave-core.h>
+#include <openrave/utils.h>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+using namespace OpenRAVE;
+using namespace std;
+
+void printhelp()
+{
+    RAVELOG_INFO("oraddbodybenchmark [--repetitions N] [numlinks ...]\n");
+}
+
+/// \brief creates a chain of numlinks boxes, every link is connected to the previous one with a revolute joint
+KinBodyPtr CreateChain(EnvironmentBasePtr penv, int numlinks)
+{
+    vector<KinBody::LinkInfoConstPtr> vlinkinfos;
+    vector<KinBody::JointInfoConstPtr> vjointinfos;
+    for(int i = 0; i < numlinks; ++i) {
+        KinBody::LinkInfoPtr plinkinfo(new KinBody::LinkInfo());
+        plinkinfo->_name = str(boost::format("link%d")%i);
+        plinkinfo->_t.trans = Vector(0,0,0.1*i);
+        KinBody::GeometryInfoPtr pgeominfo(new KinBody::GeometryInfo());
+        pgeominfo->_type = GT_Box;
+        pgeominfo->_vGeomData = Vector(0.02,0.02,0.04);
+        pgeominfo->_t.trans = Vector(0,0,0.05);
+        plinkinfo->_vgeometryinfos.push_back(pgeominfo);
+        vlinkinfos.push_back(plinkinfo);
+        if( i > 0 ) {
+            KinBody::JointInfoPtr pjointinfo(new KinBody::JointInfo());
+            pjointinfo->_type = KinBody::JointRevolute;
+            pjointinfo->_name = str(boost::format("joint%d")%i);
+            pjointinfo->_linkname0 = str(boost::format("link%d")%(i-1));
+            pjointinfo->_linkname1 = plinkinfo->_name;
+            pjointinfo->_vanchor = Vector(0,0,0.1*i);
+            pjointinfo->_vaxes[0] = Vector(1,0,0);
+            pjointinfo->_vlowerlimit[0] = -PI;
+            pjointinfo->_vupperlimit[0] = PI;
+            vjointinfos.push_back(pjointinfo);
+        }
+    }
+    KinBodyPtr pbody = RaveCreateKinBody(penv);
+    pbody->Init(vlinkinfos, vjointinfos);
+    pbody->SetName(str(boost::format("chain%d")%numlinks));
+    return pbody;
+}
+
+int main(int argc, char ** argv)
+{
+    vector<int> vnumlinks;
+    int numrepetitions = 5;
+    for(int i = 1; i < argc; ++i) {
+        if((strcmp(argv[i], "-h") == 0)||(strcmp(argv[i], "--help") == 0)) {
+            printhelp();
+            return 0;
+        }
+        else if( strcmp(argv[i], "--repetitions") == 0 && i+1 < argc ) {
+            numrepetitions = atoi(argv[++i]);
+        }
+        else {
+            vnumlinks.push_back(atoi(argv[i]));
+        }
+    }
+    if( vnumlinks.size() == 0 ) {
+        for(int numlinks = 8; numlinks <= 1024; numlinks *= 2) {
+            vnumlinks.push_back(numlinks);
+        }
+    }
+
+    RaveInitialize(true); // start openrave core
+    EnvironmentBasePtr penv = RaveCreateEnvironment(); // create the main environment
+
+    {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        for(size_t inumlinks = 0; inumlinks < vnumlinks.size(); ++inumlinks) {
+            // create the bodies beforehand so that only adding to the environment is measured
+            vector<KinBodyPtr> vbodies;
+            for(int irep = 0; irep < numrepetitions; ++irep) {
+                vbodies.push_back(CreateChain(penv, vnumlinks[inumlinks]));
+            }
+            uint64_t totaltime = 0;
+            for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+                uint64_t starttime = OpenRAVE::utils::GetNanoPerformanceTime();
+                penv->Add(vbodies[ibody]);
+                totaltime += OpenRAVE::utils::GetNanoPerformanceTime()-starttime;
+                penv->Remove(vbodies[ibody]);
+            }
+            RAVELOG_INFO("%d links: %fms/add\n", vnumlinks[inumlinks], 1e-6*totaltime/numrepetitions);
+        }
+    }
+
+    penv->Destroy(); // destroy
+    return 0;
+}
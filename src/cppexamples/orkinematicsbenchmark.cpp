@@ -0,0 +1,130 @@
+/** \example orkinematicsbenchmark.cpp
+    \author agent
+
+    Measures the time and the number of heap allocations of setting joint values and reading the link
+    transformations and a jacobian in a loop, once with the std::vector functions of KinBody and once
+    with the array functions that reuse the internal buffers of the body.
+
+    Usage:
+    \verbatim
+    orkinematicsbenchmark [--iterations N] [robot_model]
+    \endverbatim
+
+    Example:
+    \verbatim
+    orkinematicsbenchmark robots/barrettwam.robot.xml
+    \endverbatim
+
+    <b>Full Example Code:</b>
+ */
+#include <openrave-core.h>
+#include <openrave/utils.h>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+using namespace OpenRAVE;
+using namespace std;
+
+// count every heap allocation of the process
+static size_t s_numallocations = 0;
+
+void* operator new(size_t size)
+{
+    ++s_numallocations;
+    void* p = malloc(size > 0 ? size : 1);
+    if( !p ) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void printhelp()
+{
+    RAVELOG_INFO("orkinematicsbenchmark [--iterations N] [robot_model]\n");
+}
+
+int main(int argc, char ** argv)
+{
+    string robotname = "robots/barrettwam.robot.xml";
+    int numiterations = 100000;
+    for(int i = 1; i < argc; ++i) {
+        if((strcmp(argv[i], "-h") == 0)||(strcmp(argv[i], "--help") == 0)) {
+            printhelp();
+            return 0;
+        }
+        else if( strcmp(argv[i], "--iterations") == 0 && i+1 < argc ) {
+            numiterations = atoi(argv[++i]);
+        }
+        else {
+            robotname = argv[i];
+        }
+    }
+
+    RaveInitialize(true); // start openrave core
+    EnvironmentBasePtr penv = RaveCreateEnvironment(); // create the main environment
+    RobotBasePtr probot = penv->ReadRobotURI(RobotBasePtr(), robotname);
+    if( !probot ) {
+        RAVELOG_ERROR("failed to load %s\n", robotname.c_str());
+        penv->Destroy();
+        return -1;
+    }
+    penv->Add(probot);
+
+    {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        int dof = probot->GetDOF();
+        int linkindex = probot->GetLinks().size()-1;
+        vector<dReal> vlower, vupper;
+        probot->GetDOFLimits(vlower, vupper);
+
+        // precompute the configurations so that sampling does not count
+        vector<dReal> vconfigs(dof*64);
+        for(size_t i = 0; i < vconfigs.size(); ++i) {
+            vconfigs[i] = vlower[i%dof] + (vupper[i%dof]-vlower[i%dof])*(dReal)(i%17)/16;
+        }
+
+        // std::vector functions, with the temporaries a planner typically creates every iteration
+        size_t startallocations = s_numallocations;
+        uint64_t starttime = OpenRAVE::utils::GetNanoPerformanceTime();
+        for(int iter = 0; iter < numiterations; ++iter) {
+            vector<dReal> vvalues(vconfigs.begin()+(iter%64)*dof, vconfigs.begin()+(iter%64+1)*dof);
+            probot->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+            vector<dReal> vcurvalues;
+            probot->GetDOFValues(vcurvalues);
+            vector<Transform> vtransforms;
+            probot->GetLinkTransformations(vtransforms);
+            vector<dReal> vjacobian;
+            probot->ComputeJacobianTranslation(linkindex, vtransforms.at(linkindex).trans, vjacobian);
+        }
+        double vectortime = 1e-9*(OpenRAVE::utils::GetNanoPerformanceTime()-starttime);
+        double vectorallocations = (double)(s_numallocations-startallocations)/numiterations;
+
+        // array functions with buffers allocated once
+        vector<dReal> vcurvalues(dof), vjacobian(3*dof);
+        vector<Transform> vtransforms(probot->GetLinks().size());
+        startallocations = s_numallocations;
+        starttime = OpenRAVE::utils::GetNanoPerformanceTime();
+        for(int iter = 0; iter < numiterations; ++iter) {
+            probot->SetDOFValues(&vconfigs[(iter%64)*dof], dof, KinBody::CLA_Nothing);
+            probot->GetDOFValues(&vcurvalues[0]);
+            probot->GetLinkTransformations(&vtransforms[0]);
+            probot->ComputeJacobianTranslation(linkindex, vtransforms[linkindex].trans, &vjacobian[0]);
+        }
+        double arraytime = 1e-9*(OpenRAVE::utils::GetNanoPerformanceTime()-starttime);
+        double arrayallocations = (double)(s_numallocations-startallocations)/numiterations;
+
+        RAVELOG_INFO("%s: %d dof, %d links, %d iterations\n", probot->GetName().c_str(), dof, (int)probot->GetLinks().size(), numiterations);
+        RAVELOG_INFO("std::vector functions: %fus/iteration, %f allocations/iteration\n", 1e6*vectortime/numiterations, vectorallocations);
+        RAVELOG_INFO("array functions: %fus/iteration, %f allocations/iteration\n", 1e6*arraytime/numiterations, arrayallocations);
+    }
+
+    penv->Destroy(); // destroy
+    return 0;
+}
@@ -19,6 +19,10 @@
 
 #include "ravep.h"
 #include "colladaparser/colladacommon.h"
+#include "scenecache.h"
+#include "spatialgrid.h"
+
+#include <boost/thread/tss.hpp>
 
 #ifdef HAVE_BOOST_FILESYSTEM
 #include <boost/filesystem/operations.hpp>
@@ -35,6 +39,12 @@
         CHECK_INTERFACE(body); \
 }
 
+// the simulation worker threads run while the thread calling StepSimulation holds the environment mutex, so they query without locking it
+#define LOCK_COLLISION_QUERY(lockname) EnvironmentMutex::scoped_lock lockname(GetMutex(), boost::defer_lock_t()); \
+    if( !_IsSimulationWorkerThread() ) { \
+        lockname.lock(); \
+    }
+
 class Environment : public EnvironmentBase
 {
     class GraphHandleMulti : public GraphHandle
@@ -115,20 +125,34 @@ public:
     {
         _homedirectory = RaveGetHomeDirectory();
         RAVELOG_DEBUG_FORMAT("setting openrave home directory to %s", _homedirectory);
+        const char* pOPENRAVE_SCENE_CACHE = std::getenv("OPENRAVE_SCENE_CACHE");
+        if( !!pOPENRAVE_SCENE_CACHE ) {
+            _scenecachedirectory = pOPENRAVE_SCENE_CACHE;
+        }
 
         _nBodiesModifiedStamp = 0;
         _nEnvironmentIndex = 1;
+        _nSyncBodiesModifiedStamp = 0;
+        _nBodyNameIndexStamp = -1;
 
         _fDeltaSimTime = 0.01f;
         _nCurSimTime = 0;
         _nSimStartTime = utils::GetMicroTime();
         _bRealTime = true;
         _bInit = false;
+        _nSensorSimulationThreads = 1;
+        _nBodySimulationThreads = 1;
+        _bShutdownSimulationWorkers = false;
+        _nNextSimulationTask = 0;
+        _nSimulationTasksLeft = 0;
+        _nSimulationWorkerCheckersStamp = -1;
+        _pPublishedSnapshot.reset(new EnvironmentSnapshot());
         _bEnableSimulation = true;     // need to start by default
         _unit = std::make_pair("meter",1.0); //default unit settings
 
         _handlegenericrobot = RaveRegisterInterface(PT_Robot,"GenericRobot", RaveGetInterfaceHash(PT_Robot), GetHash(), CreateGenericRobot);
         _handlegenerictrajectory = RaveRegisterInterface(PT_Trajectory,"GenericTrajectory", RaveGetInterfaceHash(PT_Trajectory), GetHash(), CreateGenericTrajectory);
+        _handlestreamingtrajectory = RaveRegisterInterface(PT_Trajectory,"StreamingTrajectory", RaveGetInterfaceHash(PT_Trajectory), GetHash(), CreateStreamingTrajectory);
         _handlemulticontroller = RaveRegisterInterface(PT_Controller,"GenericMultiController", RaveGetInterfaceHash(PT_Controller), GetHash(), CreateMultiController);
         _handlegenericphysicsengine = RaveRegisterInterface(PT_PhysicsEngine,"GenericPhysicsEngine", RaveGetInterfaceHash(PT_PhysicsEngine), GetHash(), CreateGenericPhysicsEngine);
         _handlegenericcollisionchecker = RaveRegisterInterface(PT_CollisionChecker,"GenericCollisionChecker", RaveGetInterfaceHash(PT_CollisionChecker), GetHash(), CreateGenericCollisionChecker);
@@ -253,6 +277,7 @@ public:
         {
             EnvironmentMutex::scoped_lock lockenv(GetMutex());
             _bEnableSimulation = false;
+            _StopSimulationWorkerThreads();
             if( !!_pPhysicsEngine ) {
                 _pPhysicsEngine->DestroyEnvironment();
             }
@@ -269,12 +294,16 @@ public:
                 vecrobots.swap(_vecrobots);
                 vecbodies.swap(_vecbodies);
                 listSensors.swap(_listSensors);
-                _vPublishedBodies.clear();
                 _nBodiesModifiedStamp++;
+                _ClearPublishedBodies();
                 _listModules.clear();
                 _listViewers.clear();
                 _listOwnedInterfaces.clear();
             }
+            {
+                boost::mutex::scoped_lock lockgrid(_mutexSpatialGrid);
+                _spatialgrid.Reset();
+            }
 
             // destroy the dangling pointers outside of _mutexInterfaces
 
@@ -344,8 +373,8 @@ public:
                 vcallbackbodies.insert(vcallbackbodies.end(), _vecrobots.begin(), _vecrobots.end());
             }
             _vecrobots.clear();
-            _vPublishedBodies.clear();
             _nBodiesModifiedStamp++;
+            _ClearPublishedBodies();
 
             _mapBodies.clear();
 
@@ -415,6 +444,62 @@ public:
         _Clone(boost::static_pointer_cast<Environment const>(preference),cloningoptions,true);
     }
 
+    virtual void SynchronizeBodies(EnvironmentBaseConstPtr preference)
+    {
+        boost::shared_ptr<Environment const> r = boost::static_pointer_cast<Environment const>(preference);
+        EnvironmentMutex::scoped_lock lockref(r->GetMutex());
+        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        bool bFullClone = _pSyncReference.lock() != r || _nSyncBodiesModifiedStamp != r->_nBodiesModifiedStamp || _vecbodies.size() != r->_vecbodies.size();
+        std::vector< std::pair<KinBodyPtr, KinBodyPtr> > vchangedbodies; // reference body and its clone
+        if( !bFullClone ) {
+            FOREACHC(itbody, r->_vecbodies) {
+                std::map<int, KinBodyWeakPtr>::const_iterator itnewbody = _mapBodies.find((*itbody)->GetEnvironmentId());
+                KinBodyPtr pnewbody;
+                if( itnewbody != _mapBodies.end() ) {
+                    pnewbody = itnewbody->second.lock();
+                }
+                if( !pnewbody || pnewbody->GetName() != (*itbody)->GetName() || pnewbody->GetKinematicsGeometryHash() != (*itbody)->GetKinematicsGeometryHash() ) {
+                    bFullClone = true;
+                    break;
+                }
+                // the clone can also have been moved since the last copy, for example by the planner of a worker
+                std::map<int, std::pair<int, int> >::const_iterator itstamp = _mapSyncBodyStamps.find((*itbody)->GetEnvironmentId());
+                if( itstamp != _mapSyncBodyStamps.end() && itstamp->second.first == (*itbody)->GetUpdateStamp() && itstamp->second.second == pnewbody->GetUpdateStamp() ) {
+                    continue;
+                }
+                vchangedbodies.push_back(std::make_pair(*itbody, pnewbody));
+            }
+        }
+
+        if( bFullClone ) {
+            RAVELOG_VERBOSE_FORMAT("env=%d, bodies of env=%d changed, cloning all bodies", GetId()%r->GetId());
+            _Clone(r, Clone_Bodies, true); // records the stamps
+            return;
+        }
+
+        // grabbed bodies are restored after all the poses are set since grabbing records the relative transforms
+        FOREACH(itbody, vchangedbodies) {
+            if( itbody->second->IsRobot() ) {
+                RobotBase::RobotStateSaver saver(RaveInterfaceCast<RobotBase>(itbody->first), 0xffffffff&~KinBody::Save_GrabbedBodies);
+                saver.Restore(RaveInterfaceCast<RobotBase>(itbody->second));
+            }
+            else {
+                KinBody::KinBodyStateSaver saver(itbody->first, 0xffffffff&~KinBody::Save_GrabbedBodies);
+                saver.Restore(itbody->second);
+            }
+        }
+        FOREACH(itbody, vchangedbodies) {
+            if( itbody->first->_vGrabbedBodies.size() > 0 || itbody->second->_vGrabbedBodies.size() > 0 ) {
+                KinBody::KinBodyStateSaver saver(itbody->first, KinBody::Save_GrabbedBodies);
+                saver.Restore(itbody->second);
+            }
+        }
+        if( vchangedbodies.size() > 0 ) {
+            // restoring the grabbed bodies can move clones of unchanged bodies too
+            _RecordSyncBodyStamps(r);
+        }
+    }
+
     virtual int AddModule(ModuleBasePtr module, const std::string& cmdargs)
     {
         CHECK_INTERFACE(module);
@@ -460,6 +545,45 @@ public:
     virtual bool Load(const std::string& filename, const AttributesList& atts)
     {
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        std::string cachefilename = _GetSceneCacheFilename(filename, atts);
+        if( cachefilename.size() > 0 && _LoadSceneCache(cachefilename) ) {
+            UpdatePublishedBodies();
+            return true;
+        }
+
+        // the cache only holds the bodies, so remember everything else the file could modify
+        size_t nprevbodies = _vecbodies.size(), nprevmodules = _listModules.size(), nprevsensors = _listSensors.size(), nprevviewers = _listViewers.size();
+        CollisionCheckerBasePtr pprevchecker = _pCurrentChecker;
+        PhysicsEngineBasePtr pprevphysics = _pPhysicsEngine;
+        std::pair<std::string, dReal> prevunit = _unit;
+        std::vector<KinBodyPtr> vprevbodies = _vecbodies;
+        std::vector<int> vprevupdatestamps(nprevbodies);
+        for(size_t ibody = 0; ibody < nprevbodies; ++ibody) {
+            vprevupdatestamps[ibody] = _vecbodies[ibody]->GetUpdateStamp();
+        }
+
+        if( !_LoadFile(filename, atts) ) {
+            return false;
+        }
+
+        if( cachefilename.size() > 0 ) {
+            bool bCacheable = _vecbodies.size() > nprevbodies && _listModules.size() == nprevmodules && _listSensors.size() == nprevsensors && _listViewers.size() == nprevviewers && _pCurrentChecker == pprevchecker && _pPhysicsEngine == pprevphysics && _unit == prevunit;
+            for(size_t ibody = 0; ibody < nprevbodies && bCacheable; ++ibody) {
+                bCacheable = _vecbodies[ibody] == vprevbodies[ibody] && _vecbodies[ibody]->GetUpdateStamp() == vprevupdatestamps[ibody];
+            }
+            if( bCacheable ) {
+                _WriteSceneCache(cachefilename, filename, std::vector<KinBodyPtr>(_vecbodies.begin()+nprevbodies, _vecbodies.end()));
+            }
+            else {
+                RAVELOG_DEBUG_FORMAT("env=%d, %s modifies more than its bodies so is not cached", GetId()%filename);
+            }
+        }
+        return true;
+    }
+
+    /// \brief loads the file with its parser, \see Load
+    virtual bool _LoadFile(const std::string& filename, const AttributesList& atts)
+    {
         OpenRAVEXMLParser::GetXMLErrorCount() = 0;
         if( _IsColladaURI(filename) ) {
             if( RaveParseColladaURI(shared_from_this(), filename, atts) ) {
@@ -729,6 +853,124 @@ public:
         _CallBodyCallbacks(robot, 1);
     }
 
+    virtual void AddBodies(const std::vector<KinBodyPtr>& vbodies, bool bAnonymous)
+    {
+        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        // validate and name everything first so that nothing is added when one of the bodies is invalid
+        std::set<std::string> setnames;
+        FOREACHC(itbody, _vecbodies) {
+            setnames.insert((*itbody)->GetName());
+        }
+        std::set<KinBodyPtr> setadded;
+        FOREACHC(itbody, vbodies) {
+            KinBodyPtr pbody = *itbody;
+            CHECK_INTERFACE(pbody);
+            if( pbody->GetEnvironmentId() != 0 || !setadded.insert(pbody).second ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("env=%d, body %s is added more than once"), GetId()%pbody->GetName(), ORE_InvalidArguments);
+            }
+            if( !utils::IsValidName(pbody->GetName()) ) {
+                throw openrave_exception(str(boost::format(_("kinbody name: \"%s\" is not valid"))%pbody->GetName()));
+            }
+            if( setnames.find(pbody->GetName()) != setnames.end() ) {
+                if( !bAnonymous ) {
+                    throw openrave_exception(str(boost::format(_("env=%d, body %s does not have unique name"))%GetId()%pbody->GetName()));
+                }
+                // continue to add random numbers until a unique name is found
+                string oldname=pbody->GetName(),newname;
+                for(int i = 0;; ++i) {
+                    newname = str(boost::format("%s%d")%oldname%i);
+                    if( utils::IsValidName(newname) && setnames.find(newname) == setnames.end() ) {
+                        break;
+                    }
+                }
+                pbody->SetName(newname);
+            }
+            setnames.insert(pbody->GetName());
+        }
+
+        {
+            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
+            _vecbodies.reserve(_vecbodies.size()+vbodies.size());
+            FOREACHC(itbody, vbodies) {
+                _vecbodies.push_back(*itbody);
+                if( (*itbody)->IsRobot() ) {
+                    _vecrobots.push_back(RaveInterfaceCast<RobotBase>(*itbody));
+                }
+                SetEnvironmentId(*itbody);
+            }
+            _nBodiesModifiedStamp++;
+        }
+        FOREACHC(itbody, vbodies) {
+            const KinBodyPtr& pbody = *itbody;
+            pbody->_ComputeInternalInformation();
+            _pCurrentChecker->InitKinBody(pbody);
+            if( !!pbody->GetSelfCollisionChecker() && pbody->GetSelfCollisionChecker() != _pCurrentChecker ) {
+                // also initialize external collision checker if specified for this body
+                pbody->GetSelfCollisionChecker()->InitKinBody(pbody);
+            }
+            _pPhysicsEngine->InitKinBody(pbody);
+            // send all the changed callbacks of the body since anything could have changed
+            pbody->_PostprocessChangedParameters(0xffffffff&~KinBody::Prop_JointMimic&~KinBody::Prop_LinkStatic&~KinBody::Prop_BodyRemoved);
+        }
+        _CallBodyCallbacks(vbodies, 1);
+    }
+
+    virtual int RemoveBodies(const std::vector<KinBodyPtr>& vbodies)
+    {
+        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        std::vector<KinBodyPtr> vremovedbodies;
+        {
+            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
+            std::set<KinBodyPtr> setremove;
+            FOREACHC(itbody, vbodies) {
+                if( !!*itbody && (*itbody)->GetEnvironmentId() != 0 && (*itbody)->GetEnv() == shared_from_this() && setremove.insert(*itbody).second ) {
+                    vremovedbodies.push_back(*itbody);
+                }
+            }
+            if( vremovedbodies.size() == 0 ) {
+                return 0;
+            }
+
+            // before deleting, make sure no remaining bodies are grabbing them
+            std::vector<KinBodyPtr> vgrabbed;
+            FOREACHC(itbody, _vecbodies) {
+                if( setremove.find(*itbody) != setremove.end() ) {
+                    continue;
+                }
+                (*itbody)->GetGrabbed(vgrabbed);
+                FOREACHC(itgrabbed, vgrabbed) {
+                    if( setremove.find(*itgrabbed) != setremove.end() ) {
+                        RAVELOG_WARN_FORMAT("env=%d, remove %s already grabbed by robot %s!", GetId()%(*itgrabbed)->GetName()%(*itbody)->GetName());
+                        (*itbody)->Release(**itgrabbed);
+                    }
+                }
+            }
+            FOREACHC(itbody, vremovedbodies) {
+                _DeinitializeRemovedBody(*itbody);
+            }
+            // compact in one pass instead of erasing every body separately
+            size_t inewbody = 0;
+            for(size_t ibody = 0; ibody < _vecbodies.size(); ++ibody) {
+                if( setremove.find(_vecbodies[ibody]) == setremove.end() ) {
+                    _vecbodies[inewbody++] = _vecbodies[ibody];
+                }
+            }
+            _vecbodies.resize(inewbody);
+            std::vector<RobotBasePtr>::iterator itrobot = _vecrobots.begin();
+            while( itrobot != _vecrobots.end() ) {
+                if( setremove.find(*itrobot) != setremove.end() ) {
+                    itrobot = _vecrobots.erase(itrobot);
+                }
+                else {
+                    ++itrobot;
+                }
+            }
+            _nBodiesModifiedStamp++;
+        }
+        _CallBodyCallbacks(vremovedbodies, 0);
+        return (int)vremovedbodies.size();
+    }
+
     virtual void _AddSensor(SensorBasePtr psensor, bool bAnonymous)
     {
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
@@ -818,18 +1060,12 @@ public:
         KinBodyPtr pbody;
         {
             boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            vector<KinBodyPtr>::iterator it = _vecbodies.end();
-            FOREACHC(itbody, _vecbodies) {
-                if( (*itbody)->GetName() == name ) {
-                    it = itbody;
-                    break;
-                }
-            }
-            if( it == _vecbodies.end() ) {
+            _UpdateBodyNameIndices();
+            pbody = _FindBodyByName(_vecbodies, _mapBodyNameIndex, name);
+            if( !pbody ) {
                 return false;
             }
-            pbody = *it;
-            _RemoveKinBodyFromIterator(it);
+            _RemoveKinBodyFromIterator(std::find(_vecbodies.begin(), _vecbodies.end(), pbody));
         }
         // pbody is valid so run any callbacks and exit
         _CallBodyCallbacks(pbody, 0);
@@ -847,23 +1083,15 @@ public:
     virtual KinBodyPtr GetKinBody(const std::string& pname) const
     {
         boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-        FOREACHC(it, _vecbodies) {
-            if((*it)->GetName()==pname) {
-                return *it;
-            }
-        }
-        return KinBodyPtr();
+        _UpdateBodyNameIndices();
+        return _FindBodyByName(_vecbodies, _mapBodyNameIndex, pname);
     }
 
     virtual RobotBasePtr GetRobot(const std::string& pname) const
     {
         boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-        FOREACHC(it, _vecrobots) {
-            if((*it)->GetName()==pname) {
-                return *it;
-            }
-        }
-        return RobotBasePtr();
+        _UpdateBodyNameIndices();
+        return _FindBodyByName(_vecrobots, _mapRobotNameIndex, pname);
     }
 
     virtual SensorBasePtr GetSensor(const std::string& name) const
@@ -954,91 +1182,113 @@ public:
         return _pCurrentChecker->InitEnvironment();
     }
 
+    /// \brief returns true if called by a thread of the simulation worker pool
+    bool _IsSimulationWorkerThread() const {
+        return !!_tlsSimulationWorkerChecker.get();
+    }
+
     virtual CollisionCheckerBasePtr GetCollisionChecker() const {
+        // the simulation worker threads query their own checker, see _UpdateSimulationWorkerCheckers
+        CollisionCheckerBasePtr* pworkerchecker = _tlsSimulationWorkerChecker.get();
+        if( !!pworkerchecker && !!*pworkerchecker ) {
+            return *pworkerchecker;
+        }
         return _pCurrentChecker;
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(pbody1);
-        return _pCurrentChecker->CheckCollision(pbody1,report);
+        return GetCollisionChecker()->CheckCollision(pbody1,report);
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(pbody1);
         CHECK_COLLISION_BODY(pbody2);
-        return _pCurrentChecker->CheckCollision(pbody1,pbody2,report);
+        return GetCollisionChecker()->CheckCollision(pbody1,pbody2,report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report )
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(plink->GetParent());
-        return _pCurrentChecker->CheckCollision(plink,report);
+        return GetCollisionChecker()->CheckCollision(plink,report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(plink1->GetParent());
         CHECK_COLLISION_BODY(plink2->GetParent());
-        return _pCurrentChecker->CheckCollision(plink1,plink2,report);
+        return GetCollisionChecker()->CheckCollision(plink1,plink2,report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(plink->GetParent());
         CHECK_COLLISION_BODY(pbody);
-        return _pCurrentChecker->CheckCollision(plink,pbody,report);
+        return GetCollisionChecker()->CheckCollision(plink,pbody,report);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(plink->GetParent());
-        return _pCurrentChecker->CheckCollision(plink,vbodyexcluded,vlinkexcluded,report);
+        return GetCollisionChecker()->CheckCollision(plink,vbodyexcluded,vlinkexcluded,report);
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(pbody);
-        return _pCurrentChecker->CheckCollision(pbody,vbodyexcluded,vlinkexcluded,report);
+        return GetCollisionChecker()->CheckCollision(pbody,vbodyexcluded,vlinkexcluded,report);
     }
 
     virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(plink->GetParent());
-        return _pCurrentChecker->CheckCollision(ray,plink,report);
+        return GetCollisionChecker()->CheckCollision(ray,plink,report);
     }
     virtual bool CheckCollision(const RAY& ray, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(pbody);
-        return _pCurrentChecker->CheckCollision(ray,pbody,report);
+        return GetCollisionChecker()->CheckCollision(ray,pbody,report);
     }
     virtual bool CheckCollision(const RAY& ray, CollisionReportPtr report)
     {
-        return _pCurrentChecker->CheckCollision(ray,report);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
+        return GetCollisionChecker()->CheckCollision(ray,report);
     }
 
     virtual bool CheckCollision(const TriMesh& trimesh, KinBodyConstPtr pbody, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckCollision");
         CHECK_COLLISION_BODY(pbody);
-        return _pCurrentChecker->CheckCollision(trimesh,pbody,report);
+        return GetCollisionChecker()->CheckCollision(trimesh,pbody,report);
     }
 
     virtual bool CheckStandaloneSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report)
     {
-        EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        LOCK_COLLISION_QUERY(lockenv);
+        OPENRAVE_PROFILE_SCOPE("collision", "CheckStandaloneSelfCollision");
         CHECK_COLLISION_BODY(pbody);
-        return _pCurrentChecker->CheckStandaloneSelfCollision(pbody,report);
+        return GetCollisionChecker()->CheckStandaloneSelfCollision(pbody,report);
     }
 
     virtual void StepSimulation(dReal fTimeStep)
@@ -1064,26 +1314,36 @@ public:
             listModules = _listModules;
         }
 
-        FOREACH(it, vecbodies) {
-            if( (*it)->GetEnvironmentId() ) {     // have to check if valid
-                (*it)->SimulationStep(fTimeStep);
+        if( GetBodySimulationThreads() > 1 && vecbodies.size() > 1 ) {
+            _StepBodiesConcurrently(vecbodies, fTimeStep);
+        }
+        else {
+            FOREACH(it, vecbodies) {
+                if( (*it)->GetEnvironmentId() ) {     // have to check if valid
+                    (*it)->SimulationStep(fTimeStep);
+                }
             }
         }
+        // modules and sensors are stepped by this thread after all the bodies moved
         FOREACH(itmodule, listModules) {
             itmodule->first->SimulationStep(fTimeStep);
         }
 
         // simulate the sensors last (ie, they always reflect the most recent bodies
+        std::vector< std::pair<SensorBasePtr, dReal> > vconcurrentsensors;
         FOREACH(itsensor, listSensors) {
-            (*itsensor)->SimulationStep(fTimeStep);
+            _StepSensor(*itsensor, fTimeStep, vconcurrentsensors);
         }
         FOREACH(itrobot, vecrobots) {
             FOREACH(itsensor, (*itrobot)->GetAttachedSensors()) {
                 if( !!(*itsensor)->GetSensor() ) {
-                    (*itsensor)->GetSensor()->SimulationStep(fTimeStep);
+                    _StepSensor((*itsensor)->GetSensor(), fTimeStep, vconcurrentsensors);
                 }
             }
         }
+        if( vconcurrentsensors.size() > 0 ) {
+            _StepSensorsConcurrently(vconcurrentsensors);
+        }
         _nCurSimTime += step;
     }
 
@@ -1106,6 +1366,29 @@ public:
         }
     }
 
+    virtual void GetBodiesInAABB(const AABB& ab, std::vector<KinBodyPtr>& bodies)
+    {
+        boost::mutex::scoped_lock lockgrid(_mutexSpatialGrid);
+        {
+            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
+            _spatialgrid.UpdateBodies(_vecbodies, _nBodiesModifiedStamp);
+        }
+        // computing the aabbs does not need _mutexInterfaces
+        _spatialgrid.GetBodies(ab, bodies);
+    }
+
+    virtual void SetSpatialGridCellSize(dReal fCellSize)
+    {
+        boost::mutex::scoped_lock lockgrid(_mutexSpatialGrid);
+        _spatialgrid.SetCellSize(fCellSize);
+    }
+
+    virtual dReal GetSpatialGridCellSize() const
+    {
+        boost::mutex::scoped_lock lockgrid(_mutexSpatialGrid);
+        return _spatialgrid.GetCellSize();
+    }
+
     virtual void GetRobots(std::vector<RobotBasePtr>& robots, uint64_t timeout) const
     {
         if( timeout == 0 ) {
@@ -1152,50 +1435,44 @@ public:
     virtual void Triangulate(TriMesh& trimesh, const KinBody &body)
     {
         EnvironmentMutex::scoped_lock lockenv(GetMutex());     // reading collision data, so don't want anyone modifying it
-        FOREACHC(it, body.GetLinks()) {
-            trimesh.Append((*it)->GetCollisionData(), (*it)->GetTransform());
-        }
+        std::vector<KinBody::LinkPtr> vlinks(body.GetLinks().begin(), body.GetLinks().end());
+        _TriangulateLinks(trimesh, vlinks);
     }
 
     virtual void TriangulateScene(TriMesh& trimesh, SelectionOptions options,const std::string& selectname)
     {
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        std::vector<KinBody::LinkPtr> vlinks;
         FOREACH(itbody, _vecbodies) {
-            RobotBasePtr robot;
-            if( (*itbody)->IsRobot() ) {
-                robot = RaveInterfaceCast<RobotBase>(*itbody);
-            }
+            bool bTriangulate = false;
             switch(options) {
             case SO_NoRobots:
-                if( !robot ) {
-                    Triangulate(trimesh, **itbody);
-                }
+                bTriangulate = !(*itbody)->IsRobot();
                 break;
-
             case SO_Robots:
-                if( !!robot ) {
-                    Triangulate(trimesh, **itbody);
-                }
+                bTriangulate = (*itbody)->IsRobot();
                 break;
             case SO_Everything:
-                Triangulate(trimesh, **itbody);
+                bTriangulate = true;
                 break;
             case SO_Body:
-                if( (*itbody)->GetName() == selectname ) {
-                    Triangulate(trimesh, **itbody);
-                }
+                bTriangulate = (*itbody)->GetName() == selectname;
                 break;
             case SO_AllExceptBody:
-                if( (*itbody)->GetName() != selectname ) {
-                    Triangulate(trimesh, **itbody);
-                }
+                bTriangulate = (*itbody)->GetName() != selectname;
                 break;
 //            case SO_BodyList:
 //                if( find(listnames.begin(),listnames.end(),(*itbody)->GetName()) != listnames.end() ) {
 //                    Triangulate(trimesh,*itbody);
 //                }
+            default:
+                break;
+            }
+            if( bTriangulate ) {
+                vlinks.insert(vlinks.end(), (*itbody)->GetLinks().begin(), (*itbody)->GetLinks().end());
             }
         }
+        _TriangulateLinks(trimesh, vlinks);
     }
 
     virtual void TriangulateScene(TriMesh& trimesh, TriangulateOptions options)
@@ -1907,6 +2184,50 @@ public:
         return _nCurSimTime;
     }
 
+    virtual void SetSensorSimulationThreads(int numthreads)
+    {
+        boost::mutex::scoped_lock lock(_mutexSensorSimulation);
+        _nSensorSimulationThreads = numthreads;
+    }
+
+    virtual int GetSensorSimulationThreads() const
+    {
+        boost::mutex::scoped_lock lock(_mutexSensorSimulation);
+        return _nSensorSimulationThreads;
+    }
+
+    virtual void SetBodySimulationThreads(int numthreads)
+    {
+        boost::mutex::scoped_lock lock(_mutexSensorSimulation);
+        _nBodySimulationThreads = numthreads;
+    }
+
+    virtual int GetBodySimulationThreads() const
+    {
+        boost::mutex::scoped_lock lock(_mutexSensorSimulation);
+        return _nBodySimulationThreads;
+    }
+
+    virtual void SetSensorSimulationParameters(SensorBaseConstPtr psensor, dReal fPeriod, bool bConcurrent)
+    {
+        OPENRAVE_ASSERT_FORMAT0(!!psensor, "need a valid sensor", ORE_InvalidArguments);
+        boost::mutex::scoped_lock lock(_mutexSensorSimulation);
+        // forget the sensors that were destroyed
+        std::map<SensorBase const*, SensorSimulationInfo>::iterator it = _mapSensorSimulationInfos.begin();
+        while( it != _mapSensorSimulationInfos.end() ) {
+            if( it->second._psensor.expired() ) {
+                _mapSensorSimulationInfos.erase(it++);
+            }
+            else {
+                ++it;
+            }
+        }
+        SensorSimulationInfo& info = _mapSensorSimulationInfos[psensor.get()];
+        info._psensor = psensor;
+        info._fPeriod = max(dReal(0), fPeriod);
+        info._bConcurrent = bConcurrent;
+    }
+
     virtual void SetDebugLevel(int level) {
         RaveSetDebugLevel(level);
     }
@@ -1916,101 +2237,48 @@ public:
 
     virtual void GetPublishedBodies(std::vector<KinBody::BodyState>& vbodies, uint64_t timeout)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            vbodies = _vPublishedBodies;
-        }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-            vbodies = _vPublishedBodies;
+        // published states are never modified, so readers only hold _mutexPublishedSnapshot while copying the pointer
+        EnvironmentSnapshotConstPtr psnapshot = GetPublishedSnapshot();
+        vbodies.resize(psnapshot->vbodies.size());
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            vbodies[ibody] = *psnapshot->vbodies[ibody];
         }
     }
 
     virtual bool GetPublishedBody(const std::string &name, KinBody::BodyState& bodystate, uint64_t timeout=0)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    bodystate = _vPublishedBodies[ibody];
-                    return true;
-                }
-            }
-        }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    bodystate = _vPublishedBodies[ibody];
-                    return true;
-                }
+        EnvironmentSnapshotConstPtr psnapshot = GetPublishedSnapshot();
+        FOREACHC(itstate, psnapshot->vbodies) {
+            if( (*itstate)->strname == name ) {
+                bodystate = **itstate;
+                return true;
             }
         }
-
         return false;
     }
 
     virtual bool GetPublishedBodyJointValues(const std::string& name, std::vector<dReal> &jointValues, uint64_t timeout=0)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    jointValues = _vPublishedBodies[ibody].jointvalues;
-                    return true;
-                }
-            }
-        }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( _vPublishedBodies[ibody].strname == name) {
-                    jointValues = _vPublishedBodies[ibody].jointvalues;
-                    return true;
-                }
+        EnvironmentSnapshotConstPtr psnapshot = GetPublishedSnapshot();
+        FOREACHC(itstate, psnapshot->vbodies) {
+            if( (*itstate)->strname == name ) {
+                jointValues = (*itstate)->jointvalues;
+                return true;
             }
         }
-
         return false;
     }
 
     void GetPublishedBodyTransformsMatchingPrefix(const std::string& prefix, std::vector<std::pair<std::string, Transform> >& nameTransfPairs, uint64_t timeout = 0)
     {
-        if( timeout == 0 ) {
-            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
-            nameTransfPairs.resize(0);
-            if( nameTransfPairs.capacity() < _vPublishedBodies.size() ) {
-                nameTransfPairs.reserve(_vPublishedBodies.size());
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( strncmp(_vPublishedBodies[ibody].strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
-                    nameTransfPairs.emplace_back(_vPublishedBodies[ibody].strname,  _vPublishedBodies[ibody].vectrans.at(0));
-                }
-            }
+        EnvironmentSnapshotConstPtr psnapshot = GetPublishedSnapshot();
+        nameTransfPairs.resize(0);
+        if( nameTransfPairs.capacity() < psnapshot->vbodies.size() ) {
+            nameTransfPairs.reserve(psnapshot->vbodies.size());
         }
-        else {
-            boost::timed_mutex::scoped_timed_lock lock(_mutexInterfaces, boost::get_system_time() + boost::posix_time::microseconds(timeout));
-            if (!lock.owns_lock()) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("timeout of %f s failed"),(1e-6*static_cast<double>(timeout)),ORE_Timeout);
-            }
-
-            nameTransfPairs.resize(0);
-            if( nameTransfPairs.capacity() < _vPublishedBodies.size() ) {
-                nameTransfPairs.reserve(_vPublishedBodies.size());
-            }
-            for ( size_t ibody = 0; ibody < _vPublishedBodies.size(); ++ibody) {
-                if ( strncmp(_vPublishedBodies[ibody].strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
-                    nameTransfPairs.emplace_back(_vPublishedBodies[ibody].strname,  _vPublishedBodies[ibody].vectrans.at(0));
-                }
+        FOREACHC(itstate, psnapshot->vbodies) {
+            if ( strncmp((*itstate)->strname.c_str(), prefix.c_str(), prefix.size()) == 0 ) {
+                nameTransfPairs.emplace_back((*itstate)->strname, (*itstate)->vectrans.at(0));
             }
         }
     }
@@ -2031,12 +2299,22 @@ public:
         }
     }
 
+    virtual EnvironmentSnapshotConstPtr GetPublishedSnapshot() const
+    {
+        boost::mutex::scoped_lock lock(_mutexPublishedSnapshot);
+        return _pPublishedSnapshot;
+    }
+
+    /// \brief publishes a new snapshot where only the bodies whose update stamp changed are copied. _mutexInterfaces should be locked
     virtual void _UpdatePublishedBodies()
     {
-        // updated the published bodies, resize dynamically in case an exception occurs
-        // when creating an item and bad data is left inside _vPublishedBodies
-        _vPublishedBodies.resize(_vecbodies.size());
-        int iwritten = 0;
+        EnvironmentSnapshotConstPtr pprevsnapshot = GetPublishedSnapshot();
+        std::map<int, KinBody::BodyStateConstPtr> mapprevstates; // only filled if bodies were reordered
+
+        boost::shared_ptr<EnvironmentSnapshot> psnapshot(new EnvironmentSnapshot());
+        psnapshot->vbodies.reserve(_vecbodies.size());
+        psnapshot->bodiesmodifiedstamp = _nBodiesModifiedStamp;
+        psnapshot->simulationtime = _nCurSimTime;
 
         std::vector<dReal> vdoflastsetvalues;
         for(int ibody = 0; ibody < (int)_vecbodies.size(); ++ibody) {
@@ -2046,34 +2324,70 @@ public:
                 continue;
             }
 
-            KinBody::BodyState& state = _vPublishedBodies[iwritten];
-            state.Reset();
-            state.pbody = pbody;
-            pbody->GetLinkTransformations(state.vectrans, vdoflastsetvalues);
-            pbody->GetLinkEnableStates(state.vLinkEnableStates);
-            pbody->GetDOFValues(state.jointvalues);
-            pbody->GetGrabbedInfo(state.vGrabbedInfos);
-            state.strname =pbody->GetName();
-            state.uri = pbody->GetURI();
-            state.updatestamp = pbody->GetUpdateStamp();
-            state.environmentid = pbody->GetEnvironmentId();
+            RobotBasePtr probot;
+            RobotBase::ManipulatorPtr pmanip;
             if( pbody->IsRobot() ) {
-                RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+                probot = RaveInterfaceCast<RobotBase>(pbody);
                 if( !!probot ) {
-                    RobotBase::ManipulatorPtr pmanip = probot->GetActiveManipulator();
-                    if( !!pmanip ) {
-                        state.activeManipulatorName = pmanip->GetName();
-                        state.activeManipulatorTransform = pmanip->GetTransform();
+                    pmanip = probot->GetActiveManipulator();
+                }
+            }
+
+            // bodies usually keep their order, so first check the state at the same position
+            size_t iwritten = psnapshot->vbodies.size();
+            KinBody::BodyStateConstPtr pprevstate;
+            if( iwritten < pprevsnapshot->vbodies.size() && pprevsnapshot->vbodies[iwritten]->pbody == pbody ) {
+                pprevstate = pprevsnapshot->vbodies[iwritten];
+            }
+            else if( pprevsnapshot->vbodies.size() > 0 ) {
+                if( mapprevstates.size() == 0 ) {
+                    FOREACHC(itstate, pprevsnapshot->vbodies) {
+                        mapprevstates[(*itstate)->environmentid] = *itstate;
                     }
-                    probot->GetConnectedBodyActiveStates(state.vConnectedBodyActiveStates);
+                }
+                std::map<int, KinBody::BodyStateConstPtr>::const_iterator itprevstate = mapprevstates.find(pbody->GetEnvironmentId());
+                if( itprevstate != mapprevstates.end() && itprevstate->second->pbody == pbody ) {
+                    pprevstate = itprevstate->second;
                 }
             }
-            ++iwritten;
-        }
+            // the active manipulator is the only published state that can change without changing the update stamp
+            if( !!pprevstate && pprevstate->updatestamp == pbody->GetUpdateStamp() && pprevstate->uri == pbody->GetURI() && pprevstate->activeManipulatorName == (!!pmanip ? pmanip->GetName() : std::string()) ) {
+                psnapshot->vbodies.push_back(pprevstate);
+                continue;
+            }
 
-        if( iwritten < _vPublishedBodies.size() ) {
-            _vPublishedBodies.resize(iwritten);
+            KinBody::BodyStatePtr pstate(new KinBody::BodyState());
+            pstate->pbody = pbody;
+            pbody->GetLinkTransformations(pstate->vectrans, vdoflastsetvalues);
+            pbody->GetLinkEnableStates(pstate->vLinkEnableStates);
+            pbody->GetDOFValues(pstate->jointvalues);
+            pbody->GetGrabbedInfo(pstate->vGrabbedInfos);
+            pstate->strname =pbody->GetName();
+            pstate->uri = pbody->GetURI();
+            pstate->updatestamp = pbody->GetUpdateStamp();
+            pstate->environmentid = pbody->GetEnvironmentId();
+            if( !!probot ) {
+                if( !!pmanip ) {
+                    pstate->activeManipulatorName = pmanip->GetName();
+                    pstate->activeManipulatorTransform = pmanip->GetTransform();
+                }
+                probot->GetConnectedBodyActiveStates(pstate->vConnectedBodyActiveStates);
+            }
+            psnapshot->vbodies.push_back(pstate);
         }
+
+        boost::mutex::scoped_lock lock(_mutexPublishedSnapshot);
+        _pPublishedSnapshot = psnapshot;
+    }
+
+    /// \brief publishes an empty snapshot so that no removed body is kept alive by it. _mutexInterfaces should be locked
+    void _ClearPublishedBodies()
+    {
+        boost::shared_ptr<EnvironmentSnapshot> psnapshot(new EnvironmentSnapshot());
+        psnapshot->bodiesmodifiedstamp = _nBodiesModifiedStamp;
+        psnapshot->simulationtime = _nCurSimTime;
+        boost::mutex::scoped_lock lock(_mutexPublishedSnapshot);
+        _pPublishedSnapshot = psnapshot;
     }
 
     virtual std::pair<std::string, dReal> GetUnit() const
@@ -2103,23 +2417,65 @@ protected:
             }
         }
 
-        (*it)->ReleaseAllGrabbed();
         if( (*it)->IsRobot() ) {
             vector<RobotBasePtr>::iterator itrobot = std::find(_vecrobots.begin(), _vecrobots.end(), RaveInterfaceCast<RobotBase>(*it));
             if( itrobot != _vecrobots.end() ) {
                 _vecrobots.erase(itrobot);
             }
         }
+        _DeinitializeRemovedBody(*it);
+        _vecbodies.erase(it);
+        _nBodiesModifiedStamp++;
+    }
+
+    /// \brief releases the grabbed bodies of a body being removed and detaches it from the collision checker, physics engine and environment ids. _mutexInterfaces should be locked
+    void _DeinitializeRemovedBody(const KinBodyPtr& pbody)
+    {
+        pbody->ReleaseAllGrabbed();
         if( !!_pCurrentChecker ) {
-            _pCurrentChecker->RemoveKinBody(*it);
+            _pCurrentChecker->RemoveKinBody(pbody);
         }
         if( !!_pPhysicsEngine ) {
-            _pPhysicsEngine->RemoveKinBody(*it);
+            _pPhysicsEngine->RemoveKinBody(pbody);
         }
-        (*it)->_PostprocessChangedParameters(KinBody::Prop_BodyRemoved);
-        RemoveEnvironmentId(*it);
-        _vecbodies.erase(it);
-        _nBodiesModifiedStamp++;
+        pbody->_PostprocessChangedParameters(KinBody::Prop_BodyRemoved);
+        RemoveEnvironmentId(pbody);
+    }
+
+    /// \brief rebuilds the name indices of _vecbodies and _vecrobots after bodies were added or removed. _mutexInterfaces should be locked
+    void _UpdateBodyNameIndices() const
+    {
+        if( _nBodyNameIndexStamp == _nBodiesModifiedStamp ) {
+            return;
+        }
+        _mapBodyNameIndex.clear();
+        for(int ibody = 0; ibody < (int)_vecbodies.size(); ++ibody) {
+            _mapBodyNameIndex[_vecbodies[ibody]->GetName()] = ibody;
+        }
+        _mapRobotNameIndex.clear();
+        for(int irobot = 0; irobot < (int)_vecrobots.size(); ++irobot) {
+            _mapRobotNameIndex[_vecrobots[irobot]->GetName()] = irobot;
+        }
+        _nBodyNameIndexStamp = _nBodiesModifiedStamp;
+    }
+
+    /// \brief finds the body through mapindex, falling back to a linear search when the entry is missing or stale. _mutexInterfaces should be locked
+    ///
+    /// Bodies can be renamed without the environment being notified, so every entry is validated against the current name.
+    template <typename T>
+    static boost::shared_ptr<T> _FindBodyByName(const std::vector< boost::shared_ptr<T> >& vbodies, std::map<std::string, int>& mapindex, const std::string& name)
+    {
+        std::map<std::string, int>::const_iterator itindex = mapindex.find(name);
+        if( itindex != mapindex.end() && itindex->second < (int)vbodies.size() && vbodies[itindex->second]->GetName() == name ) {
+            return vbodies[itindex->second];
+        }
+        for(int ibody = 0; ibody < (int)vbodies.size(); ++ibody) {
+            if( vbodies[ibody]->GetName() == name ) {
+                mapindex[name] = ibody;
+                return vbodies[ibody];
+            }
+        }
+        return boost::shared_ptr<T>();
     }
 
     void _SetDefaultGravity()
@@ -2136,6 +2492,7 @@ protected:
     virtual bool _ParseXMLFile(BaseXMLReaderPtr preader, const std::string& filename)
     {
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        OpenRAVEXMLParser::MeshImportScope meshimportscope(filename);
         return OpenRAVEXMLParser::ParseXMLFile(preader, filename);
     }
 
@@ -2145,6 +2502,290 @@ protected:
         return OpenRAVEXMLParser::ParseXMLData(preader, pdata);
     }
 
+    /// \brief returns the scene cache file of a load, or empty if the load should not use the cache
+    ///
+    /// The cache is keyed by the content and path of the file, the load attributes, the unit, and the collision checker since it computes the non-adjacent links.
+    virtual std::string _GetSceneCacheFilename(const std::string& filename, const AttributesList& atts)
+    {
+        if( _scenecachedirectory.size() == 0 || _IsColladaURI(filename) ) {
+            return std::string();
+        }
+        std::string fullfilename = RaveFindLocalFile(filename);
+        if( fullfilename.size() == 0 ) {
+            return std::string();
+        }
+        std::ifstream f(fullfilename.c_str(), std::ios::in|std::ios::binary);
+        if( !f ) {
+            return std::string();
+        }
+        std::string key((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        key.push_back(0);
+        key += fullfilename;
+        key.push_back(0);
+        key += str(boost::format("%s %.15e %s")%_unit.first%_unit.second%(!_pCurrentChecker ? std::string() : _pCurrentChecker->GetXMLId()));
+        FOREACHC(itatt, atts) {
+            key.push_back(0);
+            key += itatt->first;
+            key.push_back(0);
+            key += itatt->second;
+        }
+        return _scenecachedirectory + s_filesep + utils::GetMD5HashString(key) + ".scenecache";
+    }
+
+    /// \brief adds the bodies of the scene cache to the environment
+    ///
+    /// \return false if the cache does not exist or is out of date, in which case nothing is added
+    virtual bool _LoadSceneCache(const std::string& cachefilename)
+    {
+        std::ifstream f(cachefilename.c_str(), std::ios::in|std::ios::binary);
+        if( !f ) {
+            return false;
+        }
+
+        std::vector<KinBodyPtr> vaddedbodies;
+        try {
+            SceneCacheReader reader(f);
+            if( !reader.ReadHeader() ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, scene cache %s was written by a different version", GetId()%cachefilename);
+                return false;
+            }
+            std::vector<SceneCacheDependency> vdependencies;
+            reader.Read(vdependencies);
+            FOREACHC(itdependency, vdependencies) {
+                if( !itdependency->IsValid() ) {
+                    RAVELOG_DEBUG_FORMAT("env=%d, scene cache %s is out of date since %s changed", GetId()%cachefilename%itdependency->filename);
+                    return false;
+                }
+            }
+            std::vector<SceneCacheBody> vbodies;
+            reader.Read(vbodies);
+            FOREACHC(itbody, vbodies) {
+                _AddSceneCacheBody(*itbody, vaddedbodies);
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, failed to load scene cache %s, removing it: %s", GetId()%cachefilename%ex.what());
+            FOREACH(itbody, vaddedbodies) {
+                Remove(*itbody);
+            }
+            f.close();
+            std::remove(cachefilename.c_str());
+            return false;
+        }
+        RAVELOG_DEBUG_FORMAT("env=%d, loaded %d bodies from scene cache %s", GetId()%vaddedbodies.size()%cachefilename);
+        return true;
+    }
+
+    /// \brief creates the body of the scene cache and adds it to the environment and vaddedbodies, throws if the body does not come out the same as when it was cached
+    virtual void _AddSceneCacheBody(const SceneCacheBody& cachebody, std::vector<KinBodyPtr>& vaddedbodies)
+    {
+        KinBodyPtr pbody;
+        RobotBasePtr probot;
+        if( cachebody.bIsRobot ) {
+            probot = RaveCreateRobot(shared_from_this(), cachebody.xmlid);
+            pbody = probot;
+        }
+        else {
+            pbody = RaveCreateKinBody(shared_from_this(), cachebody.xmlid);
+        }
+        if( !pbody ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("failed to create body %s of type %s"), cachebody.name%cachebody.xmlid, ORE_InvalidState);
+        }
+
+        std::vector<KinBody::LinkInfoConstPtr> vlinkinfos(cachebody.vLinkInfos.begin(), cachebody.vLinkInfos.end());
+        std::vector<KinBody::JointInfoConstPtr> vjointinfos(cachebody.vJointInfos.begin(), cachebody.vJointInfos.end());
+        bool bInit;
+        if( !!probot ) {
+            std::vector<RobotBase::ManipulatorInfoConstPtr> vmanipinfos(cachebody.vManipulatorInfos.begin(), cachebody.vManipulatorInfos.end());
+            bInit = probot->Init(vlinkinfos, vjointinfos, vmanipinfos, std::vector<RobotBase::AttachedSensorInfoConstPtr>(), cachebody.uri);
+        }
+        else {
+            bInit = pbody->Init(vlinkinfos, vjointinfos, cachebody.uri);
+        }
+        if( !bInit ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("failed to initialize body %s"), cachebody.name, ORE_InvalidState);
+        }
+        pbody->SetName(cachebody.name);
+        if( !!probot ) {
+            _AddRobot(probot, true);
+        }
+        else {
+            _AddKinBody(pbody, true);
+        }
+        vaddedbodies.push_back(pbody);
+
+        if( pbody->GetKinematicsGeometryHash() != cachebody.kinematicsgeometryhash ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("body %s has a different kinematics geometry hash"), cachebody.name, ORE_InvalidState);
+        }
+        if( cachebody.vInitialLinkTransformations.size() != pbody->GetLinks().size() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("body %s has %d initial link transforms, expected %d"), cachebody.name%cachebody.vInitialLinkTransformations.size()%pbody->GetLinks().size(), ORE_InvalidState);
+        }
+        // the self-collision checks of the non-adjacent links are what makes adding large robots slow
+        pbody->_vInitialLinkTransformations = cachebody.vInitialLinkTransformations;
+        FOREACH(itnonadjacent, pbody->_vNonAdjacentLinks) {
+            itnonadjacent->resize(0);
+        }
+        pbody->_vNonAdjacentLinks[0] = cachebody.vNonAdjacentLinks;
+        pbody->_nNonAdjacentLinkCache = 0;
+
+        if( !!probot ) {
+            if( cachebody.controllerxmlid.size() > 0 ) {
+                ControllerBasePtr pcontroller = probot->GetController();
+                if( !pcontroller || pcontroller->GetXMLId() != cachebody.controllerxmlid || pcontroller->GetControlDOFIndices() != cachebody.vControlDOFIndices || pcontroller->IsControlTransformation() != cachebody.nControlTransformation ) {
+                    if( !probot->SetController(RaveCreateController(shared_from_this(), cachebody.controllerxmlid), cachebody.vControlDOFIndices, cachebody.nControlTransformation) ) {
+                        throw OPENRAVE_EXCEPTION_FORMAT(_("failed to set controller %s of robot %s"), cachebody.controllerxmlid%cachebody.name, ORE_InvalidState);
+                    }
+                }
+            }
+            probot->SetActiveDOFs(cachebody.vActiveDOFIndices, cachebody.nActiveAffineDOFs, cachebody.vActiveRotationAxis);
+            if( probot->GetRobotStructureHash() != cachebody.robotstructurehash ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("robot %s has a different structure hash"), cachebody.name, ORE_InvalidState);
+            }
+        }
+    }
+
+    /// \brief fills the cache of a loaded body
+    ///
+    /// \return false if the body holds state the cache cannot reconstruct
+    virtual bool _GetSceneCacheBody(KinBodyPtr pbody, SceneCacheBody& cachebody, std::vector<SceneCacheDependency>& vdependencies)
+    {
+        if( pbody->GetReadableInterfaces().size() > 0 ) {
+            return false;
+        }
+        cachebody.xmlid = pbody->GetXMLId();
+        cachebody.name = pbody->GetName();
+        cachebody.uri = pbody->GetURI();
+        cachebody.bIsRobot = pbody->IsRobot();
+        std::vector<std::string> vfilenames;
+        if( cachebody.uri.size() > 0 ) {
+            vfilenames.push_back(cachebody.uri.substr(0, cachebody.uri.find('#')));
+        }
+
+        // computes the non-adjacent links if the load has not
+        pbody->GetNonAdjacentLinks(0);
+        cachebody.vNonAdjacentLinks = pbody->_vNonAdjacentLinks[0];
+        cachebody.vInitialLinkTransformations = pbody->_vInitialLinkTransformations;
+
+        cachebody.vLinkInfos.resize(0);
+        FOREACHC(itlink, pbody->GetLinks()) {
+            cachebody.vLinkInfos.push_back(KinBody::LinkInfoPtr(new KinBody::LinkInfo((*itlink)->UpdateAndGetInfo())));
+            std::vector<KinBody::GeometryInfoPtr> vgeometryinfos = cachebody.vLinkInfos.back()->_vgeometryinfos;
+            FOREACHC(itextra, cachebody.vLinkInfos.back()->_mapExtraGeometries) {
+                vgeometryinfos.insert(vgeometryinfos.end(), itextra->second.begin(), itextra->second.end());
+            }
+            FOREACHC(itgeominfo, vgeometryinfos) {
+                vfilenames.push_back((*itgeominfo)->_filenamerender);
+                vfilenames.push_back((*itgeominfo)->_filenamecollision);
+            }
+        }
+        cachebody.vJointInfos.resize(0);
+        for(int ijointlist = 0; ijointlist < 2; ++ijointlist) {
+            FOREACHC(itjoint, ijointlist == 0 ? pbody->GetJoints() : pbody->GetPassiveJoints()) {
+                const KinBody::JointInfo& jointinfo = (*itjoint)->UpdateAndGetInfo();
+                // Init attaches the joint to _linkname0 first, so joints whose links were swapped during parsing cannot be restored
+                if( !!jointinfo._trajfollow || !(*itjoint)->GetFirstAttached() || (*itjoint)->GetFirstAttached()->GetName() != jointinfo._linkname0 ) {
+                    return false;
+                }
+                cachebody.vJointInfos.push_back(KinBody::JointInfoPtr(new KinBody::JointInfo(jointinfo)));
+            }
+        }
+        cachebody.kinematicsgeometryhash = pbody->GetKinematicsGeometryHash();
+
+        if( cachebody.bIsRobot ) {
+            RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+            if( probot->GetAttachedSensors().size() > 0 || probot->GetConnectedBodies().size() > 0 || probot->GetGripperInfos().size() > 0 ) {
+                return false;
+            }
+            cachebody.vManipulatorInfos.resize(0);
+            FOREACHC(itmanip, probot->GetManipulators()) {
+                cachebody.vManipulatorInfos.push_back(RobotBase::ManipulatorInfoPtr(new RobotBase::ManipulatorInfo((*itmanip)->GetInfo())));
+            }
+            ControllerBasePtr pcontroller = probot->GetController();
+            if( !!pcontroller ) {
+                cachebody.controllerxmlid = pcontroller->GetXMLId();
+                cachebody.vControlDOFIndices = pcontroller->GetControlDOFIndices();
+                cachebody.nControlTransformation = pcontroller->IsControlTransformation();
+            }
+            cachebody.vActiveDOFIndices = probot->GetActiveDOFIndices();
+            cachebody.nActiveAffineDOFs = probot->GetAffineDOF();
+            cachebody.vActiveRotationAxis = probot->GetAffineRotationAxis();
+            cachebody.robotstructurehash = probot->GetRobotStructureHash();
+        }
+
+        FOREACHC(itfilename, vfilenames) {
+            std::string filename = *itfilename;
+            if( filename.size() == 0 ) {
+                continue;
+            }
+            if( filename.find("__norenderif__:") == 0 ) {
+                continue;
+            }
+            SceneCacheDependency dependency;
+            if( !dependency.InitFromFile(filename) ) {
+                // not a local file, so cannot tell when it changes
+                return false;
+            }
+            vdependencies.push_back(dependency);
+        }
+        return true;
+    }
+
+    /// \brief writes the scene cache of the bodies a load added
+    virtual void _WriteSceneCache(const std::string& cachefilename, const std::string& filename, const std::vector<KinBodyPtr>& vbodies)
+    {
+        std::vector<SceneCacheDependency> vdependencies(1);
+        if( !vdependencies[0].InitFromFile(RaveFindLocalFile(filename)) ) {
+            return;
+        }
+        std::vector<SceneCacheBody> vcachebodies(vbodies.size());
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            if( !_GetSceneCacheBody(vbodies[ibody], vcachebodies[ibody], vdependencies) ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, body %s of %s cannot be cached", GetId()%vbodies[ibody]->GetName()%filename);
+                return;
+            }
+        }
+
+        // write to a temporary file so that other processes never read a partial cache
+        std::string tempfilename = str(boost::format("%s.%d.tmp")%cachefilename%getpid());
+        {
+            std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+            if( !f ) {
+                RAVELOG_DEBUG_FORMAT("env=%d, failed to open scene cache %s for writing", GetId()%tempfilename);
+                return;
+            }
+            SceneCacheWriter writer(f);
+            writer.WriteHeader();
+            writer.Write(vdependencies);
+            writer.Write(vcachebodies);
+            if( !f ) {
+                f.close();
+                std::remove(tempfilename.c_str());
+                RAVELOG_WARN_FORMAT("env=%d, failed to write scene cache %s", GetId()%tempfilename);
+                return;
+            }
+        }
+        if( std::rename(tempfilename.c_str(), cachefilename.c_str()) != 0 ) {
+            std::remove(tempfilename.c_str());
+            RAVELOG_WARN_FORMAT("env=%d, failed to rename scene cache to %s", GetId()%cachefilename);
+            return;
+        }
+        RAVELOG_DEBUG_FORMAT("env=%d, wrote scene cache %s of %s", GetId()%cachefilename%filename);
+    }
+
+    /// \brief records the update stamps of the bodies of r and of their clones in this environment, both environments have to be locked
+    void _RecordSyncBodyStamps(boost::shared_ptr<Environment const> r)
+    {
+        _mapSyncBodyStamps.clear();
+        FOREACHC(itbody, r->_vecbodies) {
+            std::map<int, KinBodyWeakPtr>::const_iterator itnewbody = _mapBodies.find((*itbody)->GetEnvironmentId());
+            KinBodyPtr pnewbody;
+            if( itnewbody != _mapBodies.end() ) {
+                pnewbody = itnewbody->second.lock();
+            }
+            _mapSyncBodyStamps[(*itbody)->GetEnvironmentId()] = std::make_pair((*itbody)->GetUpdateStamp(), !!pnewbody ? pnewbody->GetUpdateStamp() : -1);
+        }
+    }
+
     virtual void _Clone(boost::shared_ptr<Environment const> r, int options, bool bCheckSharedResources=false)
     {
         if( !bCheckSharedResources ) {
@@ -2159,6 +2800,13 @@ protected:
 
         _nBodiesModifiedStamp = r->_nBodiesModifiedStamp;
         _homedirectory = r->_homedirectory;
+        _scenecachedirectory = r->_scenecachedirectory;
+        {
+            // the bodies modified stamp was copied, so the grid cannot tell that its bodies are stale
+            boost::mutex::scoped_lock lockgrid(_mutexSpatialGrid);
+            _spatialgrid.Reset();
+            _spatialgrid.SetCellSize(r->GetSpatialGridCellSize());
+        }
         _fDeltaSimTime = r->_fDeltaSimTime;
         _nCurSimTime = 0;
         _nSimStartTime = utils::GetMicroTime();
@@ -2186,7 +2834,7 @@ protected:
                     (*itrobot)->Destroy();
                 }
                 _vecrobots.clear();
-                _vPublishedBodies.clear();
+                _ClearPublishedBodies();
             }
             // a little tricky due to a deadlocking situation
             std::map<int, KinBodyWeakPtr> mapBodies;
@@ -2415,6 +3063,11 @@ protected:
                     }
                 }
             }
+
+            // SynchronizeBodies only needs to copy what changes after this
+            _pSyncReference = r;
+            _nSyncBodiesModifiedStamp = r->_nBodiesModifiedStamp;
+            _RecordSyncBodyStamps(r);
         }
         if( options & Clone_Sensors ) {
             boost::timed_mutex::scoped_lock lock(r->_mutexInterfaces);
@@ -2574,6 +3227,270 @@ protected:
         }
     }
 
+    /// \brief steps psensor now, or appends it to vconcurrentsensors if it is concurrent. Does nothing if its period did not pass yet.
+    void _StepSensor(SensorBasePtr psensor, dReal fTimeStep, std::vector< std::pair<SensorBasePtr, dReal> >& vconcurrentsensors)
+    {
+        dReal fElapsedTime = fTimeStep;
+        bool bConcurrent = false;
+        {
+            boost::mutex::scoped_lock lock(_mutexSensorSimulation);
+            std::map<SensorBase const*, SensorSimulationInfo>::iterator it = _mapSensorSimulationInfos.find(psensor.get());
+            if( it != _mapSensorSimulationInfos.end() && it->second._psensor.lock() == psensor ) {
+                SensorSimulationInfo& info = it->second;
+                info._fElapsedTime += fTimeStep;
+                if( info._fElapsedTime < info._fPeriod - 1e-7 ) { // time steps are rounded to microseconds
+                    return;
+                }
+                fElapsedTime = info._fElapsedTime;
+                info._fElapsedTime = 0;
+                bConcurrent = info._bConcurrent && _nSensorSimulationThreads > 1;
+            }
+        }
+        if( bConcurrent ) {
+            vconcurrentsensors.push_back(std::make_pair(psensor, fElapsedTime));
+        }
+        else {
+            psensor->SimulationStep(fElapsedTime);
+        }
+    }
+
+    /// \brief a task of the simulation worker threads, steps a concurrent sensor or a group of attached bodies
+    struct SimulationTask
+    {
+        SimulationTask() : _fTimeStep(0) {
+        }
+        SensorBasePtr _psensor; ///< if set, the sensor to step
+        std::vector<KinBodyPtr> _vbodies; ///< the bodies to step one after the other
+        dReal _fTimeStep;
+    };
+
+    /// \brief steps the sensors with the simulation worker threads and waits for all of them. Has to be called with the environment locked.
+    void _StepSensorsConcurrently(const std::vector< std::pair<SensorBasePtr, dReal> >& vsensors)
+    {
+        std::vector<SimulationTask> vtasks(vsensors.size());
+        for(size_t i = 0; i < vsensors.size(); ++i) {
+            vtasks[i]._psensor = vsensors[i].first;
+            vtasks[i]._fTimeStep = vsensors[i].second;
+        }
+        _RunSimulationTasks(vtasks);
+    }
+
+    /// \brief appends the collision meshes of the links in world coordinates to trimesh, has to be called with the environment locked
+    ///
+    /// The sizes of all meshes are summed first so that trimesh is only resized once, then every link writes its transformed vertices and
+    /// offset indices to its own range. Large scenes are filled by several threads.
+    void _TriangulateLinks(TriMesh& trimesh, const std::vector<KinBody::LinkPtr>& vlinks)
+    {
+        std::vector< std::pair<size_t, size_t> > voffsets(vlinks.size()); // (vertex offset, index offset) of every link in trimesh
+        size_t numvertices = trimesh.vertices.size(), numindices = trimesh.indices.size();
+        for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+            const TriMesh& linkmesh = vlinks[ilink]->GetCollisionData();
+            voffsets[ilink] = std::make_pair(numvertices, numindices);
+            numvertices += linkmesh.vertices.size();
+            numindices += linkmesh.indices.size();
+        }
+        const size_t numnewvertices = numvertices - trimesh.vertices.size();
+        trimesh.vertices.resize(numvertices);
+        trimesh.indices.resize(numindices);
+
+        int numthreads = 1;
+        if( numnewvertices >= s_nParallelTriangulationVertices ) {
+            numthreads = std::min((int)boost::thread::hardware_concurrency(), (int)(numnewvertices/(s_nParallelTriangulationVertices/2)));
+        }
+        if( numthreads <= 1 || vlinks.size() <= 1 ) {
+            _FillTriangulation(trimesh, vlinks, voffsets, 0, vlinks.size());
+            return;
+        }
+
+        // split the links in ranges of about the same number of vertices
+        std::vector< boost::shared_ptr<boost::thread> > vthreads;
+        size_t ilinkstart = 0;
+        for(int ithread = 0; ithread < numthreads && ilinkstart < vlinks.size(); ++ithread) {
+            size_t endvertex = voffsets[0].first + (numnewvertices*(ithread+1))/numthreads;
+            size_t ilinkend = ilinkstart+1;
+            while( ilinkend < vlinks.size() && voffsets[ilinkend].first < endvertex ) {
+                ++ilinkend;
+            }
+            if( ithread+1 == numthreads ) {
+                ilinkend = vlinks.size();
+            }
+            vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&Environment::_FillTriangulation, boost::ref(trimesh), boost::cref(vlinks), boost::cref(voffsets), ilinkstart, ilinkend))));
+            ilinkstart = ilinkend;
+        }
+        FOREACH(itthread, vthreads) {
+            (*itthread)->join();
+        }
+    }
+
+    /// \brief writes the collision meshes of the links [ilinkstart, ilinkend) to their ranges of trimesh computed by _TriangulateLinks
+    static void _FillTriangulation(TriMesh& trimesh, const std::vector<KinBody::LinkPtr>& vlinks, const std::vector< std::pair<size_t, size_t> >& voffsets, size_t ilinkstart, size_t ilinkend)
+    {
+        for(size_t ilink = ilinkstart; ilink < ilinkend; ++ilink) {
+            const TriMesh& linkmesh = vlinks[ilink]->GetCollisionData();
+            const Transform t = vlinks[ilink]->GetTransform();
+            std::vector<Vector>::iterator itvertex = trimesh.vertices.begin() + voffsets[ilink].first;
+            FOREACHC(itlinkvertex, linkmesh.vertices) {
+                *itvertex++ = t * *itlinkvertex;
+            }
+            const int vertexoffset = (int)voffsets[ilink].first;
+            std::vector<int32_t>::iterator itindex = trimesh.indices.begin() + voffsets[ilink].second;
+            FOREACHC(itlinkindex, linkmesh.indices) {
+                *itindex++ = *itlinkindex + vertexoffset;
+            }
+        }
+    }
+
+    /// \brief steps the bodies with the simulation worker threads and waits for all of them. Has to be called with the environment locked.
+    ///
+    /// Bodies attached to each other, for example a robot and the bodies it grabs, are stepped one after the other by the same task in the order of vecbodies.
+    void _StepBodiesConcurrently(const std::vector<KinBodyPtr>& vecbodies, dReal fTimeStep)
+    {
+        std::map<KinBody*, size_t> mapBodyTask;
+        std::set<KinBodyPtr> setattached;
+        std::vector<SimulationTask> vtasks;
+        FOREACHC(itbody, vecbodies) {
+            if( !(*itbody)->GetEnvironmentId() ) {     // have to check if valid
+                continue;
+            }
+            size_t itask;
+            std::map<KinBody*, size_t>::iterator itmap = mapBodyTask.find(itbody->get());
+            if( itmap != mapBodyTask.end() ) {
+                itask = itmap->second;
+            }
+            else {
+                itask = vtasks.size();
+                vtasks.push_back(SimulationTask());
+                vtasks.back()._fTimeStep = fTimeStep;
+                if( (*itbody)->HasAttached() ) {
+                    setattached.clear();
+                    (*itbody)->GetAttached(setattached);
+                    FOREACHC(itattached, setattached) {
+                        mapBodyTask[itattached->get()] = itask;
+                    }
+                }
+            }
+            vtasks[itask]._vbodies.push_back(*itbody);
+        }
+        _RunSimulationTasks(vtasks);
+    }
+
+    /// \brief runs the tasks with the simulation worker threads and waits for all of them. vtasks is cleared.
+    void _RunSimulationTasks(std::vector<SimulationTask>& vtasks)
+    {
+        int numthreads = max(GetSensorSimulationThreads(), GetBodySimulationThreads());
+        if( (int)_vSimulationWorkerThreads.size() != numthreads ) {
+            _StopSimulationWorkerThreads();
+            _UpdateSimulationWorkerCheckers(numthreads);
+            for(int ithread = 0; ithread < numthreads; ++ithread) {
+                _vSimulationWorkerThreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&Environment::_SimulationWorkerThread, this, ithread))));
+            }
+        }
+        else {
+            _UpdateSimulationWorkerCheckers(numthreads);
+        }
+
+        boost::mutex::scoped_lock lock(_mutexSimulationTasks);
+        _vSimulationTasks.swap(vtasks);
+        vtasks.clear();
+        _nNextSimulationTask = 0;
+        _nSimulationTasksLeft = _vSimulationTasks.size();
+        _conditionSimulationTasks.notify_all();
+        while( _nSimulationTasksLeft > 0 ) {
+            _conditionSimulationTasksDone.wait(lock);
+        }
+        _vSimulationTasks.clear();
+    }
+
+    /// \brief makes sure there is one collision checker per simulation worker thread that knows all the bodies, has to be called with the environment locked and the worker threads waiting
+    ///
+    /// Checkers keep caches that are modified by every query, so concurrent tasks cannot share the environment checker.
+    /// The worker checkers are of the same type as the environment checker and are recreated when it or the set of bodies changes.
+    void _UpdateSimulationWorkerCheckers(int numthreads)
+    {
+        if( _vSimulationWorkerCheckers.size() > 0 && (_pSimulationWorkerCheckerSource.lock() != _pCurrentChecker || _nSimulationWorkerCheckersStamp != _nBodiesModifiedStamp || (int)_vSimulationWorkerCheckers.size() != numthreads) ) {
+            _DestroySimulationWorkerCheckers();
+        }
+        if( _vSimulationWorkerCheckers.size() == 0 ) {
+            for(int ithread = 0; ithread < numthreads; ++ithread) {
+                CollisionCheckerBasePtr pchecker = RaveCreateCollisionChecker(shared_from_this(), _pCurrentChecker->GetXMLId());
+                if( !pchecker ) {
+                    _DestroySimulationWorkerCheckers();
+                    throw OPENRAVE_EXCEPTION_FORMAT("env=%d, failed to create collision checker %s for simulation worker %d", GetId()%_pCurrentChecker->GetXMLId()%ithread, ORE_InvalidPlugin);
+                }
+                pchecker->InitEnvironment();
+                _vSimulationWorkerCheckers.push_back(pchecker);
+            }
+            _pSimulationWorkerCheckerSource = _pCurrentChecker;
+            _nSimulationWorkerCheckersStamp = _nBodiesModifiedStamp;
+        }
+        FOREACH(itchecker, _vSimulationWorkerCheckers) {
+            (*itchecker)->SetCollisionOptions(_pCurrentChecker->GetCollisionOptions());
+        }
+    }
+
+    void _DestroySimulationWorkerCheckers()
+    {
+        FOREACH(itchecker, _vSimulationWorkerCheckers) {
+            (*itchecker)->DestroyEnvironment();
+        }
+        _vSimulationWorkerCheckers.clear();
+        _pSimulationWorkerCheckerSource.reset();
+    }
+
+    /// \brief loop of the simulation worker threads, runs the tasks of _vSimulationTasks
+    ///
+    /// \param ithread index of the thread, the tasks use the collision checker _vSimulationWorkerCheckers[ithread]
+    void _SimulationWorkerThread(int ithread)
+    {
+        _tlsSimulationWorkerChecker.reset(new CollisionCheckerBasePtr());
+        boost::mutex::scoped_lock lock(_mutexSimulationTasks);
+        while( !_bShutdownSimulationWorkers ) {
+            if( _nNextSimulationTask >= _vSimulationTasks.size() ) {
+                _conditionSimulationTasks.wait(lock);
+                continue;
+            }
+            SimulationTask& task = _vSimulationTasks[_nNextSimulationTask++];
+            // the checkers only change while the threads wait
+            *_tlsSimulationWorkerChecker = _vSimulationWorkerCheckers.at(ithread);
+            lock.unlock();
+            if( !!task._psensor ) {
+                try {
+                    task._psensor->SimulationStep(task._fTimeStep);
+                }
+                catch(const std::exception& ex) {
+                    RAVELOG_WARN_FORMAT("env=%d, failed to step sensor %s: %s", GetId()%task._psensor->GetName()%ex.what());
+                }
+            }
+            FOREACH(itbody, task._vbodies) {
+                try {
+                    (*itbody)->SimulationStep(task._fTimeStep);
+                }
+                catch(const std::exception& ex) {
+                    RAVELOG_WARN_FORMAT("env=%d, failed to step body %s: %s", GetId()%(*itbody)->GetName()%ex.what());
+                }
+            }
+            lock.lock();
+            if( --_nSimulationTasksLeft == 0 ) {
+                _conditionSimulationTasksDone.notify_all();
+            }
+        }
+    }
+
+    void _StopSimulationWorkerThreads()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexSimulationTasks);
+            _bShutdownSimulationWorkers = true;
+            _conditionSimulationTasks.notify_all();
+        }
+        FOREACH(itthread, _vSimulationWorkerThreads) {
+            (*itthread)->join();
+        }
+        _vSimulationWorkerThreads.clear();
+        _bShutdownSimulationWorkers = false;
+        _DestroySimulationWorkerCheckers();
+    }
+
     void _StopSimulationThread()
     {
         _bShutdownSimulation = true;
@@ -2665,6 +3582,27 @@ protected:
         }
     }
 
+    /// \brief calls the body callbacks for every body with the callback list copied once. _mutexInterfaces should not be locked
+    void _CallBodyCallbacks(const std::vector<KinBodyPtr>& vbodies, int action)
+    {
+        std::list<UserDataWeakPtr> listRegisteredBodyCallbacks;
+        {
+            boost::timed_mutex::scoped_lock lock(_mutexInterfaces);
+            listRegisteredBodyCallbacks = _listRegisteredBodyCallbacks;
+        }
+        if( listRegisteredBodyCallbacks.size() == 0 ) {
+            return;
+        }
+        FOREACH(it, listRegisteredBodyCallbacks) {
+            BodyCallbackDataPtr pdata = boost::dynamic_pointer_cast<BodyCallbackData>(it->lock());
+            if( !!pdata ) {
+                FOREACHC(itbody, vbodies) {
+                    pdata->_callback(*itbody, action);
+                }
+            }
+        }
+    }
+
     /// _mutexInterfaces should not be locked
     void _CallBodyCallbacks(KinBodyPtr pbody, int action)
     {
@@ -2800,6 +3738,12 @@ protected:
     uint64_t _nCurSimTime;                        ///< simulation time since the start of the environment
     uint64_t _nSimStartTime;
     int _nBodiesModifiedStamp;     ///< incremented every tiem bodies vector is modified
+    boost::weak_ptr<Environment const> _pSyncReference; ///< the environment bodies were last cloned from with Clone_Bodies or SynchronizeBodies
+    int _nSyncBodiesModifiedStamp; ///< _nBodiesModifiedStamp of _pSyncReference when its bodies were last copied
+    std::map<int, std::pair<int, int> > _mapSyncBodyStamps; ///< environment id of the bodies of _pSyncReference to their update stamp and the update stamp of their clone when they were last copied
+    mutable std::map<std::string, int> _mapBodyNameIndex; ///< body name to index into _vecbodies, see _FindBodyByName. protected by _mutexInterfaces
+    mutable std::map<std::string, int> _mapRobotNameIndex; ///< robot name to index into _vecrobots, see _FindBodyByName. protected by _mutexInterfaces
+    mutable int _nBodyNameIndexStamp; ///< _nBodiesModifiedStamp when the name indices were built
 
     CollisionCheckerBasePtr _pCurrentChecker;
     PhysicsEngineBasePtr _pPhysicsEngine;
@@ -2809,16 +3753,51 @@ protected:
 
     boost::shared_ptr<boost::thread> _threadSimulation;                      ///< main loop for environment simulation
 
+    /// \brief how StepSimulation steps a sensor, see SetSensorSimulationParameters
+    struct SensorSimulationInfo
+    {
+        SensorSimulationInfo() : _fPeriod(0), _fElapsedTime(0), _bConcurrent(false) {
+        }
+        boost::weak_ptr<SensorBase const> _psensor; ///< to detect when the sensor is destroyed and its address reused
+        dReal _fPeriod;
+        dReal _fElapsedTime; ///< simulation time since the sensor was last stepped
+        bool _bConcurrent;
+    };
+    std::map<SensorBase const*, SensorSimulationInfo> _mapSensorSimulationInfos; ///< protected by _mutexSensorSimulation
+    int _nSensorSimulationThreads; ///< protected by _mutexSensorSimulation
+    int _nBodySimulationThreads; ///< protected by _mutexSensorSimulation
+    mutable boost::mutex _mutexSensorSimulation;
+
+    // pool of threads stepping the concurrent sensors and bodies, only accessed with the environment locked
+    std::vector< boost::shared_ptr<boost::thread> > _vSimulationWorkerThreads;
+    static const size_t s_nParallelTriangulationVertices = 200000; ///< minimum number of vertices of a TriangulateScene call to fill the mesh with several threads
+    std::vector<SimulationTask> _vSimulationTasks; ///< the tasks to run, protected by _mutexSimulationTasks while the threads run
+    size_t _nNextSimulationTask; ///< index of the next task of _vSimulationTasks to start
+    size_t _nSimulationTasksLeft; ///< number of tasks not finished yet
+    bool _bShutdownSimulationWorkers;
+    boost::mutex _mutexSimulationTasks;
+    boost::condition_variable _conditionSimulationTasks; ///< notified when there are new tasks or the threads should stop
+    boost::condition_variable _conditionSimulationTasksDone; ///< notified when all tasks are finished
+    std::vector<CollisionCheckerBasePtr> _vSimulationWorkerCheckers; ///< one collision checker per simulation worker thread
+    boost::weak_ptr<CollisionCheckerBase> _pSimulationWorkerCheckerSource; ///< the environment checker the worker checkers were created for
+    int _nSimulationWorkerCheckersStamp; ///< _nBodiesModifiedStamp when the worker checkers were initialized
+    boost::thread_specific_ptr<CollisionCheckerBasePtr> _tlsSimulationWorkerChecker; ///< the checker GetCollisionChecker returns in the worker threads
+
     mutable EnvironmentMutex _mutexEnvironment;          ///< protects internal data from multithreading issues
     mutable boost::mutex _mutexEnvironmentIds;      ///< protects _vecbodies/_vecrobots from multithreading issues
     mutable boost::timed_mutex _mutexInterfaces;     ///< lock when managing interfaces like _listOwnedInterfaces, _listModules, _mapBodies
     mutable boost::mutex _mutexInit;     ///< lock for destroying the environment
 
-    vector<KinBody::BodyState> _vPublishedBodies;
+    BodySpatialGrid _spatialgrid; ///< \see GetBodiesInAABB, protected by _mutexSpatialGrid
+    mutable boost::mutex _mutexSpatialGrid; ///< always locked before _mutexInterfaces
+
+    EnvironmentSnapshotConstPtr _pPublishedSnapshot; ///< states of the bodies as of the last UpdatePublishedBodies, handed out by GetPublishedSnapshot. never null
+    mutable boost::mutex _mutexPublishedSnapshot; ///< only protects swapping _pPublishedSnapshot, never held while copying the bodies
     string _homedirectory;
+    string _scenecachedirectory; ///< directory of the binary caches of loaded files, if empty then Load does not use caches
     std::pair<std::string, dReal> _unit; ///< unit name mm, cm, inches, m and the conversion for meters
 
-    UserDataPtr _handlegenericrobot, _handlegenerictrajectory, _handlemulticontroller, _handlegenericphysicsengine, _handlegenericcollisionchecker;
+    UserDataPtr _handlegenericrobot, _handlegenerictrajectory, _handlestreamingtrajectory, _handlemulticontroller, _handlegenericphysicsengine, _handlegenericcollisionchecker;
 
     list<InterfaceBasePtr> _listOwnedInterfaces;
 
@@ -18,17 +18,35 @@
 #include <boost/lambda/lambda.hpp>
 #include <boost/lexical_cast.hpp>
 #include <openrave/xmlreaders.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/streams/bufferstream.hpp>
 
 namespace OpenRAVE {
 
 // To distinguish between binary and XML trajectory files
 static const uint16_t MAGIC_NUMBER = 0x62ff;
-static const uint16_t BINARY_TRAJECTORY_VERSION_NUMBER = 0x0003;  // Version number for serialization
+static const uint16_t BINARY_TRAJECTORY_VERSION_NUMBER = 0x0005;  // Version number for serialization
+static const uint16_t BINARY_TRAJECTORY_UNCOMPRESSED_VERSION_NUMBER = 0x0004; // uncompressed trajectories are still written with this version so older readers can load them
+static const size_t BINARY_TRAJECTORY_DATA_ALIGNMENT = 64; // starting with 0x0004, the waypoint data starts at a multiple of this from the magic number
+
+/// \brief how the values of one column of the waypoint data are stored, added on BINARY_TRAJECTORY_VERSION_NUMBER=0x0005
+enum BinaryTrajectoryDataEncoding
+{
+    BTDE_Raw = 0, ///< dReal values
+    BTDE_Float32 = 1, ///< float values
+    BTDE_QuantizedDelta = 2, ///< the values are rounded to multiples of a step, and the differences of consecutive multiples are stored as zigzag varints
+};
 
 static const dReal g_fEpsilonLinear = RavePow(g_fEpsilon,0.9);
 static const dReal g_fEpsilonQuadratic = RavePow(g_fEpsilon,0.45); // should be 0.6...perhaps this is related to parabolic smoother epsilons?
 
 /* Helper functions for binary trajectory file writing */
+inline void WriteBinaryUInt8(std::ostream& f, uint8_t value)
+{
+    f.write((const char*) &value, sizeof(value));
+}
+
 inline void WriteBinaryUInt16(std::ostream& f, uint16_t value)
 {
     f.write((const char*) &value, sizeof(value));
@@ -44,6 +62,15 @@ inline void WriteBinaryInt(std::ostream& f, int value)
     f.write((const char*) &value, sizeof(value));
 }
 
+inline void WriteBinaryVarUInt64(std::ostream& f, uint64_t value)
+{
+    while( value >= 0x80 ) {
+        f.put((char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    f.put((char) value);
+}
+
 inline void WriteBinaryString(std::ostream& f, const std::string& s)
 {
     BOOST_ASSERT(s.length() <= std::numeric_limits<uint16_t>::max());
@@ -67,6 +94,12 @@ inline void WriteBinaryVector(std::ostream&f, const std::vector<dReal>& v)
 }
 
 /* Helper functions for binary trajectory file reading */
+inline bool ReadBinaryUInt8(std::istream& f, uint8_t& value)
+{
+    f.read((char*) &value, sizeof(value));
+    return !!f;
+}
+
 inline bool ReadBinaryUInt16(std::istream& f, uint16_t& value)
 {
     f.read((char*) &value, sizeof(value));
@@ -85,6 +118,22 @@ inline bool ReadBinaryInt(std::istream& f, int& value)
     return !!f;
 }
 
+inline bool ReadBinaryVarUInt64(std::istream& f, uint64_t& value)
+{
+    value = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        int c = f.get();
+        if( c == std::char_traits<char>::eof() ) {
+            return false;
+        }
+        value |= (uint64_t) (c & 0x7f) << shift;
+        if( !(c & 0x80) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
 inline bool ReadBinaryString(std::istream& f, std::string& s)
 {
     uint16_t length = 0;
@@ -134,7 +183,15 @@ public:
         _maporder["affine_transform"] = 10;
         _maporder["joint_torques"] = 11;
         _bInit = false;
+        _bChanged = true;
+        _nChangedIndex = 0;
         _bSamplingVerified = false;
+        _dataencoding = BTDE_Raw;
+        _fQuantizationTolerance = 0;
+        RegisterCommand("DeserializeFile",boost::bind(&GenericTrajectory::_DeserializeFileCommand,this,_1,_2),
+                        "\"filename [lazyreadable]\", deserializes the binary trajectory file by memory mapping it instead of reading it through a stream. If lazyreadable is 1 (default), the readable interfaces are only parsed when GetReadableInterface is called for them.");
+        RegisterCommand("SetCompression",boost::bind(&GenericTrajectory::_SetCompressionCommand,this,_1,_2),
+                        "\"none|float32|quantized [tolerance [groupname tolerance]...]\", sets how serialize stores the waypoint values in the binary format. float32 stores them as floats, quantized rounds them to a multiple of 2*tolerance and stores the differences between consecutive waypoints, so every value is within tolerance of the original. Group names like joint_velocities can be given their own tolerance. The deltatime group is always stored with full precision. Default is none.");
     }
 
     bool SortGroups(const ConfigurationSpecification::Group& g1, const ConfigurationSpecification::Group& g2)
@@ -182,11 +239,12 @@ public:
                 }
             }
             _InitializeGroupFunctions();
+            _converter = ConfigurationSpecification::Converter();
         }
         _vtrajdata.resize(0);
         _vaccumtime.resize(0);
         _vdeltainvtime.resize(0);
-        _bChanged = true;
+        _SetChanged(0);
         _bSamplingVerified = false;
         _bInit = true;
     }
@@ -210,7 +268,7 @@ public:
         else {
             _vtrajdata.insert(_vtrajdata.begin()+index*_spec.GetDOF(),data.begin(),data.end());
         }
-        _bChanged = true;
+        _SetChanged(index);
     }
 
     void Insert(size_t index, const std::vector<dReal>& data, const ConfigurationSpecification& spec, bool bOverwrite)
@@ -226,6 +284,7 @@ public:
             Insert(index,data,bOverwrite);
         }
         else {
+            _SetChanged(index);
             std::vector< std::vector<ConfigurationSpecification::Group>::const_iterator > vconvertgroups(_spec._vgroups.size());
             for(size_t i = 0; i < vconvertgroups.size(); ++i) {
                 vconvertgroups[i] = spec.FindCompatibleGroup(_spec._vgroups[i]);
@@ -250,7 +309,6 @@ public:
                 _ConvertData(ittargetdata,itsourcedata,vconvertgroups,spec,numelements,true);
                 _vtrajdata.insert(_vtrajdata.begin()+index*_spec.GetDOF(),vtemp.begin(),vtemp.end());
             }
-            _bChanged = true;
         }
     }
 
@@ -263,11 +321,12 @@ public:
         BOOST_ASSERT(startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
         OPENRAVE_ASSERT_OP(startindex,<,endindex);
         _vtrajdata.erase(_vtrajdata.begin()+startindex*_spec.GetDOF(),_vtrajdata.begin()+endindex*_spec.GetDOF());
-        _bChanged = true;
+        _SetChanged(startindex);
     }
 
     void Sample(std::vector<dReal>& data, dReal time) const
     {
+        OPENRAVE_PROFILE_SCOPE("trajectory", "Sample");
         BOOST_ASSERT(_bInit);
         BOOST_ASSERT(_timeoffset>=0);
         BOOST_ASSERT(time >= 0);
@@ -312,6 +371,7 @@ public:
 
     void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, bool reintializeData) const
     {
+        OPENRAVE_PROFILE_SCOPE("trajectory", "Sample");
         BOOST_ASSERT(_bInit);
         OPENRAVE_ASSERT_OP(_timeoffset,>=,0);
         OPENRAVE_ASSERT_OP(time, >=, -g_fEpsilon);
@@ -325,16 +385,17 @@ public:
         }
         data.resize(spec.GetDOF(),0);
         if( time >= GetDuration() ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.end()-_spec.GetDOF(),_spec,1,GetEnv());
+            _GetConverter(spec).Convert(data.begin(),_vtrajdata.end()-_spec.GetDOF(),1);
         }
         else {
             std::vector<dReal>::iterator it = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time);
             if( it == _vaccumtime.begin() ) {
-                ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin(),_spec,1,GetEnv());
+                _GetConverter(spec).Convert(data.begin(),_vtrajdata.begin(),1);
             }
             else {
-                // could be faster
-                vector<dReal> vinternaldata(_spec.GetDOF(),0);
+                std::vector<dReal>& vinternaldata = _vsampledata;
+                vinternaldata.resize(_spec.GetDOF());
+                std::fill(vinternaldata.begin(), vinternaldata.end(), 0);
                 size_t index = it-_vaccumtime.begin();
                 dReal deltatime = time-_vaccumtime.at(index-1);
                 dReal waypointdeltatime = _vtrajdata.at(_spec.GetDOF()*index + _timeoffset);
@@ -351,9 +412,82 @@ public:
                         _vgroupinterpolators[i](index-1,deltatime,vinternaldata);
                     }
                 }
-                ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,1,GetEnv());
+                _GetConverter(spec).Convert(data.begin(),vinternaldata.begin(),1);
+            }
+        }
+    }
+
+    void SampleWithHint(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, size_t& waypointhint) const
+    {
+        OPENRAVE_PROFILE_SCOPE("trajectory", "Sample");
+        OPENRAVE_ASSERT_OP(time, >=, -g_fEpsilon);
+        _InitSamplePoints();
+        data.resize(0);
+        data.resize(spec.GetDOF(),0);
+        if( time >= GetDuration() ) {
+            waypointhint = _vaccumtime.size()-1;
+            _GetConverter(spec).Convert(data.begin(),_vtrajdata.end()-_spec.GetDOF(),1);
+            return;
+        }
+        size_t index = _MoveWaypointCursor(waypointhint, time);
+        waypointhint = index;
+        if( index == 0 ) {
+            _GetConverter(spec).Convert(data.begin(),_vtrajdata.begin(),1);
+            return;
+        }
+        dReal deltatime = time-_vaccumtime[index-1];
+        dReal waypointdeltatime = _vtrajdata[_spec.GetDOF()*index + _timeoffset];
+        // unfortunately due to floating-point error deltatime might not be in the range [0, waypointdeltatime], so double check!
+        if( deltatime < 0 ) {
+            deltatime = 0;
+        }
+        else if( deltatime > waypointdeltatime ) {
+            deltatime = waypointdeltatime;
+        }
+        _vsampledata.resize(_spec.GetDOF());
+        std::fill(_vsampledata.begin(), _vsampledata.end(), 0);
+        for(size_t i = 0; i < _vgroupinterpolators.size(); ++i) {
+            if( !!_vgroupinterpolators[i] ) {
+                _vgroupinterpolators[i](index-1,deltatime,_vsampledata);
             }
         }
+        _GetConverter(spec).Convert(data.begin(),_vsampledata.begin(),1);
+    }
+
+    void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times) const
+    {
+        _InitSamplePoints();
+        data.resize(_spec.GetDOF()*times.size());
+        _SamplePoints(data.begin(), times.size(), [&times](size_t i) { return times[i]; }, true);
+    }
+
+    void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const
+    {
+        _InitSamplePoints();
+        _vsamplepoints.resize(_spec.GetDOF()*times.size());
+        _SamplePoints(_vsamplepoints.begin(), times.size(), [&times](size_t i) { return times[i]; }, false);
+        data.resize(spec.GetDOF()*times.size());
+        if( times.size() > 0 ) {
+            _GetConverter(spec).Convert(data.begin(),_vsamplepoints.begin(),times.size());
+        }
+    }
+
+    void SampleRange(std::vector<dReal>& data, dReal starttime, dReal timestep, size_t numpoints) const
+    {
+        _InitSamplePoints();
+        data.resize(_spec.GetDOF()*numpoints);
+        _SamplePoints(data.begin(), numpoints, [starttime, timestep](size_t i) { return starttime + i*timestep; }, true);
+    }
+
+    void SampleRange(std::vector<dReal>& data, dReal starttime, dReal timestep, size_t numpoints, const ConfigurationSpecification& spec) const
+    {
+        _InitSamplePoints();
+        _vsamplepoints.resize(_spec.GetDOF()*numpoints);
+        _SamplePoints(_vsamplepoints.begin(), numpoints, [starttime, timestep](size_t i) { return starttime + i*timestep; }, false);
+        data.resize(spec.GetDOF()*numpoints);
+        if( numpoints > 0 ) {
+            _GetConverter(spec).Convert(data.begin(),_vsamplepoints.begin(),numpoints);
+        }
     }
 
     const ConfigurationSpecification& GetConfigurationSpecification() const
@@ -381,10 +515,15 @@ public:
         BOOST_ASSERT(startindex<=endindex && startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
         data.resize(spec.GetDOF()*(endindex-startindex),0);
         if( startindex < endindex ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin()+startindex*_spec.GetDOF(),_spec,endindex-startindex,GetEnv());
+            _GetConverter(spec).Convert(data.begin(),_vtrajdata.begin()+startindex*_spec.GetDOF(),endindex-startindex);
         }
     }
 
+    const dReal* GetWaypointsData() const override
+    {
+        return _vtrajdata.size() > 0 ? &_vtrajdata[0] : NULL;
+    }
+
     size_t GetFirstWaypointIndexAfterTime(dReal time) const
     {
         BOOST_ASSERT(_bInit);
@@ -421,7 +560,7 @@ public:
 
             // Write binary file header
             WriteBinaryUInt16(O, MAGIC_NUMBER);
-            WriteBinaryUInt16(O, BINARY_TRAJECTORY_VERSION_NUMBER);
+            WriteBinaryUInt16(O, _dataencoding != BTDE_Raw ? BINARY_TRAJECTORY_VERSION_NUMBER : BINARY_TRAJECTORY_UNCOMPRESSED_VERSION_NUMBER);
 
             /* Store meta-data */
 
@@ -438,15 +577,46 @@ public:
                 WriteBinaryString(O, itgroup->interpolation);  // Writes interpolation
             }
 
-            /* Store data waypoints */
-            WriteBinaryVector(O, this->_vtrajdata);
+            if( _dataencoding != BTDE_Raw ) {
+                // Store compressed data waypoints column by column, added on BINARY_TRAJECTORY_VERSION_NUMBER=0x0005
+                WriteBinaryUInt32(O, _vtrajdata.size());
+                WriteBinaryUInt16(O, sizeof(dReal));
+                _WriteCompressedData(O);
+            }
+            else {
+                /* Store data waypoints, added on BINARY_TRAJECTORY_VERSION_NUMBER=0x0004: aligned so that a memory mapped file can be read in place */
+                size_t headersize = 6;
+                FOREACHC(itgroup, spec._vgroups) {
+                    headersize += 12 + itgroup->name.size() + itgroup->interpolation.size();
+                }
+                headersize += 8; // number of values, sizeof(dReal), number of padding bytes
+                const uint16_t numPaddingBytes = (BINARY_TRAJECTORY_DATA_ALIGNMENT - headersize%BINARY_TRAJECTORY_DATA_ALIGNMENT)%BINARY_TRAJECTORY_DATA_ALIGNMENT;
+                WriteBinaryUInt32(O, _vtrajdata.size());
+                WriteBinaryUInt16(O, sizeof(dReal));
+                WriteBinaryUInt16(O, numPaddingBytes);
+                const char padding[BINARY_TRAJECTORY_DATA_ALIGNMENT] = {0};
+                O.write(padding, numPaddingBytes);
+                if( _vtrajdata.size() > 0 ) {
+                    O.write((const char*) &_vtrajdata[0], _vtrajdata.size()*sizeof(dReal));
+                }
+            }
 
             WriteBinaryString(O, GetDescription());
 
             // Readable interfaces, added on BINARY_TRAJECTORY_VERSION_NUMBER=0x0002
             std::stringstream ss;
             const uint16_t numReadableInterfaces = GetReadableInterfaces().size();
-            WriteBinaryUInt16(O, numReadableInterfaces);
+            {
+                boost::mutex::scoped_lock lock(_mutexLazyReadableInterfaces);
+                const uint16_t numLazyReadableInterfaces = _mapLazyReadableInterfaces.size();
+                WriteBinaryUInt16(O, numReadableInterfaces + numLazyReadableInterfaces);
+                // readable interfaces that were not parsed yet are written as they were read
+                FOREACHC(itLazyReadableInterface, _mapLazyReadableInterfaces) {
+                    WriteBinaryString(O, itLazyReadableInterface->first);
+                    WriteBinaryString(O, itLazyReadableInterface->second.first);
+                    WriteBinaryString(O, itLazyReadableInterface->second.second);
+                }
+            }
             FOREACHC(itReadableInterface, GetReadableInterfaces()) {
                 WriteBinaryString(O, itReadableInterface->first);  // xmlid
 
@@ -474,6 +644,111 @@ public:
 
     void deserialize(std::istream& I) override
     {
+        _Deserialize(I, false);
+    }
+
+    XMLReadablePtr GetReadableInterface(const std::string& xmltag) const override
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexLazyReadableInterfaces);
+            std::map<std::string, std::pair<std::string, std::string> >::iterator it = _mapLazyReadableInterfaces.find(xmltag);
+            if( it != _mapLazyReadableInterfaces.end() ) {
+                XMLReadablePtr readableInterface = _ParseReadableInterface(it->first, it->second.first, it->second.second);
+                _mapLazyReadableInterfaces.erase(it);
+                const_cast<GenericTrajectory*>(this)->TrajectoryBase::SetReadableInterface(xmltag, readableInterface);
+                return readableInterface;
+            }
+        }
+        return TrajectoryBase::GetReadableInterface(xmltag);
+    }
+
+    XMLReadablePtr SetReadableInterface(const std::string& xmltag, XMLReadablePtr readable) override
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexLazyReadableInterfaces);
+            _mapLazyReadableInterfaces.erase(xmltag);
+        }
+        return TrajectoryBase::SetReadableInterface(xmltag, readable);
+    }
+
+    void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    {
+        InterfaceBase::Clone(preference,cloningoptions);
+        TrajectoryBaseConstPtr r = RaveInterfaceConstCast<TrajectoryBase>(preference);
+        Init(r->GetConfigurationSpecification());
+        r->GetWaypoints(0,r->GetNumWaypoints(),_vtrajdata);
+        _SetChanged(0);
+        boost::shared_ptr<GenericTrajectory const> rgeneric = boost::dynamic_pointer_cast<GenericTrajectory const>(r);
+        if( !!rgeneric ) {
+            std::map<std::string, std::pair<std::string, std::string> > mapLazyReadableInterfaces;
+            {
+                boost::mutex::scoped_lock lock(rgeneric->_mutexLazyReadableInterfaces);
+                mapLazyReadableInterfaces = rgeneric->_mapLazyReadableInterfaces;
+            }
+            boost::mutex::scoped_lock lock(_mutexLazyReadableInterfaces);
+            _mapLazyReadableInterfaces.swap(mapLazyReadableInterfaces);
+            _dataencoding = rgeneric->_dataencoding;
+            _fQuantizationTolerance = rgeneric->_fQuantizationTolerance;
+            _mapGroupQuantizationTolerances = rgeneric->_mapGroupQuantizationTolerances;
+        }
+    }
+
+    void Swap(TrajectoryBasePtr rawtraj)
+    {
+        OPENRAVE_ASSERT_OP(GetXMLId(),==,rawtraj->GetXMLId());
+        boost::shared_ptr<GenericTrajectory> traj = boost::dynamic_pointer_cast<GenericTrajectory>(rawtraj);
+        _spec.Swap(traj->_spec);
+        _vderivoffsets.swap(traj->_vderivoffsets);
+        _vddoffsets.swap(traj->_vddoffsets);
+        _vdddoffsets.swap(traj->_vdddoffsets);
+        _vintegraloffsets.swap(traj->_vintegraloffsets);
+        std::swap(_timeoffset, traj->_timeoffset);
+        std::swap(_bInit, traj->_bInit);
+        std::swap(_vtrajdata, traj->_vtrajdata);
+        std::swap(_vaccumtime, traj->_vaccumtime);
+        std::swap(_vdeltainvtime, traj->_vdeltainvtime);
+        std::swap(_bChanged, traj->_bChanged);
+        std::swap(_nChangedIndex, traj->_nChangedIndex);
+        std::swap(_bSamplingVerified, traj->_bSamplingVerified);
+        _InitializeGroupFunctions();
+    }
+
+protected:
+    /// \brief creates the readable interface xmlid from its serialized data in the binary format
+    static XMLReadablePtr _ParseReadableInterface(const std::string& xmlid, const std::string& serializedReadableInterface, const std::string& readerType)
+    {
+        XMLReadablePtr readableInterface;
+        if( readerType == "HierarchicalXMLReadable" ) {
+            xmlreaders::HierarchicalXMLReader xmlreader(xmlid, AttributesList());
+            xmlreaders::ParseXMLData(xmlreader, serializedReadableInterface.c_str(), serializedReadableInterface.size());
+            if( !!xmlreader.GetHierarchicalReadable() ) {
+                // should be one root only
+                if( xmlreader.GetHierarchicalReadable()->_listchildren.size() == 1 ) {
+                    readableInterface = xmlreader.GetHierarchicalReadable()->_listchildren.front();
+                }
+                else {
+                    RAVELOG_WARN_FORMAT("tried to parse readable interface %s, but got more than one root", xmlid);
+                    readableInterface = xmlreader.GetHierarchicalReadable();
+                }
+            }
+            else {
+                readableInterface = xmlreader.GetReadable();
+            }
+        }
+        else {
+            readableInterface.reset(new xmlreaders::StringXMLReadable(xmlid, serializedReadableInterface));
+        }
+        return readableInterface;
+    }
+
+    /// \brief deserializes binary or XML data
+    /// \param bLazyReadable if true, the readable interfaces of binary data are parsed by GetReadableInterface when they are first requested
+    void _Deserialize(std::istream& I, bool bLazyReadable)
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutexLazyReadableInterfaces);
+            _mapLazyReadableInterfaces.clear();
+        }
         // Check whether binary or XML file
         stringstream::streampos pos = I.tellg();  // Save old position
         uint16_t binaryFileHeader = 0;
@@ -487,7 +762,7 @@ public:
             uint16_t versionNumber = 0;
             ReadBinaryUInt16(I, versionNumber);
 
-            // currently supported versions: 0x0001, 0x0002
+            // currently supported versions: 0x0001 - 0x0005
             if (versionNumber > BINARY_TRAJECTORY_VERSION_NUMBER || versionNumber < 0x0001)
             {
                 throw OPENRAVE_EXCEPTION_FORMAT(_("unsupported trajectory format version %d "),versionNumber,ORE_InvalidArguments);
@@ -511,7 +786,34 @@ public:
             this->Init(_spec);
 
             /* Read trajectory data */
-            ReadBinaryVector(I, this->_vtrajdata);
+            if( versionNumber >= 0x0005 ) {
+                uint32_t numDataPoints = 0;
+                uint16_t sizeofValue = 0;
+                ReadBinaryUInt32(I, numDataPoints);
+                ReadBinaryUInt16(I, sizeofValue);
+                if( sizeofValue != sizeof(dReal) ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT(_("trajectory values have %d bytes, but dReal has %d bytes"),sizeofValue%sizeof(dReal),ORE_InvalidArguments);
+                }
+                _ReadCompressedData(I, numDataPoints);
+            }
+            else if( versionNumber >= 0x0004 ) {
+                uint32_t numDataPoints = 0;
+                uint16_t sizeofValue = 0, numPaddingBytes = 0;
+                ReadBinaryUInt32(I, numDataPoints);
+                ReadBinaryUInt16(I, sizeofValue);
+                ReadBinaryUInt16(I, numPaddingBytes);
+                if( sizeofValue != sizeof(dReal) ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT(_("trajectory values have %d bytes, but dReal has %d bytes"),sizeofValue%sizeof(dReal),ORE_InvalidArguments);
+                }
+                I.ignore(numPaddingBytes);
+                _vtrajdata.resize(numDataPoints);
+                if( numDataPoints > 0 ) {
+                    I.read((char*) &_vtrajdata[0], numDataPoints*sizeof(dReal));
+                }
+            }
+            else {
+                ReadBinaryVector(I, this->_vtrajdata);
+            }
             ReadBinaryString(I, __description);
 
             // clear out existing readable interfaces
@@ -534,33 +836,16 @@ public:
                     ReadBinaryString(I, xmlid);
                     ReadBinaryString(I, serializedReadableInterface);
 
-                    XMLReadablePtr readableInterface;
+                    readerType.clear();
                     if( versionNumber >= 3 ) {
                         ReadBinaryString(I, readerType);
-                        if( readerType == "HierarchicalXMLReadable" ) {
-                            xmlreaders::HierarchicalXMLReader xmlreader(xmlid, AttributesList());
-                            xmlreaders::ParseXMLData(xmlreader, serializedReadableInterface.c_str(), serializedReadableInterface.size());
-                            if( !!xmlreader.GetHierarchicalReadable() ) {
-                                // should be one root only
-                                if( xmlreader.GetHierarchicalReadable()->_listchildren.size() == 1 ) {
-                                    readableInterface = xmlreader.GetHierarchicalReadable()->_listchildren.front();
-                                }
-                                else {
-                                    RAVELOG_WARN_FORMAT("tried to parse readable interface %s, but got more than one root", xmlid);
-                                    readableInterface = xmlreader.GetHierarchicalReadable();
-                                }
-                            }
-                            else {
-                                readableInterface = xmlreader.GetReadable();
-                            }
-                        }
-                        else {
-                            readableInterface.reset(new xmlreaders::StringXMLReadable(xmlid, serializedReadableInterface));
-                        }
                     }
-                    else {
-                        readableInterface.reset(new xmlreaders::StringXMLReadable(xmlid, serializedReadableInterface));
+                    if( bLazyReadable ) {
+                        boost::mutex::scoped_lock lock(_mutexLazyReadableInterfaces);
+                        _mapLazyReadableInterfaces[xmlid] = std::make_pair(serializedReadableInterface, readerType);
+                        continue;
                     }
+                    XMLReadablePtr readableInterface = _ParseReadableInterface(xmlid, serializedReadableInterface, readerType);
                     SetReadableInterface(xmlid, readableInterface);
                 }
             }
@@ -572,35 +857,177 @@ public:
         }
     }
 
-    void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    bool _DeserializeFileCommand(std::ostream& sout, std::istream& sinput)
     {
-        InterfaceBase::Clone(preference,cloningoptions);
-        TrajectoryBaseConstPtr r = RaveInterfaceConstCast<TrajectoryBase>(preference);
-        Init(r->GetConfigurationSpecification());
-        r->GetWaypoints(0,r->GetNumWaypoints(),_vtrajdata);
-        _bChanged = true;
+        std::string filename;
+        sinput >> filename;
+        if( !sinput ) {
+            return false;
+        }
+        int lazyreadable = 1;
+        sinput >> lazyreadable;
+        try {
+            boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+            boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+            boost::interprocess::ibufferstream I(static_cast<const char*>(region.get_address()), region.get_size());
+            _Deserialize(I, lazyreadable != 0);
+        }
+        catch(const boost::interprocess::interprocess_exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, failed to map trajectory file %s: %s", GetEnv()->GetId()%filename%ex.what());
+            return false;
+        }
+        return true;
     }
 
-    void Swap(TrajectoryBasePtr rawtraj)
+    bool _SetCompressionCommand(std::ostream& sout, std::istream& sinput)
     {
-        OPENRAVE_ASSERT_OP(GetXMLId(),==,rawtraj->GetXMLId());
-        boost::shared_ptr<GenericTrajectory> traj = boost::dynamic_pointer_cast<GenericTrajectory>(rawtraj);
-        _spec.Swap(traj->_spec);
-        _vderivoffsets.swap(traj->_vderivoffsets);
-        _vddoffsets.swap(traj->_vddoffsets);
-        _vdddoffsets.swap(traj->_vdddoffsets);
-        _vintegraloffsets.swap(traj->_vintegraloffsets);
-        std::swap(_timeoffset, traj->_timeoffset);
-        std::swap(_bInit, traj->_bInit);
-        std::swap(_vtrajdata, traj->_vtrajdata);
-        std::swap(_vaccumtime, traj->_vaccumtime);
-        std::swap(_vdeltainvtime, traj->_vdeltainvtime);
-        std::swap(_bChanged, traj->_bChanged);
-        std::swap(_bSamplingVerified, traj->_bSamplingVerified);
-        _InitializeGroupFunctions();
+        std::string encoding;
+        sinput >> encoding;
+        if( encoding == "none" ) {
+            _dataencoding = BTDE_Raw;
+            _mapGroupQuantizationTolerances.clear();
+            return true;
+        }
+        if( encoding == "float32" ) {
+            _dataencoding = BTDE_Float32;
+            _mapGroupQuantizationTolerances.clear();
+            return true;
+        }
+        if( encoding != "quantized" ) {
+            return false;
+        }
+        dReal ftolerance = 0;
+        sinput >> ftolerance;
+        if( !sinput || ftolerance <= 0 ) {
+            return false;
+        }
+        std::map<std::string, dReal> mapGroupQuantizationTolerances;
+        std::string groupname;
+        while( sinput >> groupname ) {
+            dReal fgrouptolerance = 0;
+            sinput >> fgrouptolerance;
+            if( !sinput || fgrouptolerance <= 0 ) {
+                return false;
+            }
+            mapGroupQuantizationTolerances[groupname] = fgrouptolerance;
+        }
+        _dataencoding = BTDE_QuantizedDelta;
+        _fQuantizationTolerance = ftolerance;
+        _mapGroupQuantizationTolerances.swap(mapGroupQuantizationTolerances);
+        return true;
+    }
+
+    /// \brief writes _vtrajdata column by column with _dataencoding. Columns that cannot be encoded within the tolerance fall back to raw values.
+    void _WriteCompressedData(std::ostream& O) const
+    {
+        const int dof = _spec.GetDOF();
+        const size_t numpoints = dof > 0 ? _vtrajdata.size()/dof : 0;
+        std::vector<uint8_t> vencodings(dof, _dataencoding);
+        std::vector<dReal> vtolerances(dof, _fQuantizationTolerance);
+        FOREACHC(itgroup, _spec._vgroups) {
+            std::string basename = itgroup->name.substr(0, itgroup->name.find_first_of(' '));
+            std::map<std::string, dReal>::const_iterator ittolerance = _mapGroupQuantizationTolerances.find(basename);
+            for(int j = 0; j < itgroup->dof; ++j) {
+                if( basename == "deltatime" ) {
+                    // errors would accumulate in the waypoint times
+                    vencodings.at(itgroup->offset+j) = BTDE_Raw;
+                }
+                else if( ittolerance != _mapGroupQuantizationTolerances.end() ) {
+                    vtolerances.at(itgroup->offset+j) = ittolerance->second;
+                }
+            }
+        }
+
+        std::vector<float> vfloatvalues;
+        for(int idof = 0; idof < dof; ++idof) {
+            dReal fstep = 2*vtolerances[idof];
+            if( vencodings[idof] == BTDE_QuantizedDelta ) {
+                // llround has to be exact, so the multiples have to be representable
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    dReal f = _vtrajdata[ipoint*dof+idof]/fstep;
+                    if( !(RaveFabs(f) < (dReal)(1LL<<52)) ) {
+                        vencodings[idof] = BTDE_Raw;
+                        break;
+                    }
+                }
+            }
+            WriteBinaryUInt8(O, vencodings[idof]);
+            if( vencodings[idof] == BTDE_QuantizedDelta ) {
+                O.write((const char*) &fstep, sizeof(fstep));
+                int64_t prevmultiple = 0;
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    int64_t multiple = llround(_vtrajdata[ipoint*dof+idof]/fstep);
+                    int64_t delta = multiple - prevmultiple;
+                    WriteBinaryVarUInt64(O, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+                    prevmultiple = multiple;
+                }
+            }
+            else if( vencodings[idof] == BTDE_Float32 ) {
+                vfloatvalues.resize(numpoints);
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    vfloatvalues[ipoint] = (float)_vtrajdata[ipoint*dof+idof];
+                }
+                if( numpoints > 0 ) {
+                    O.write((const char*) &vfloatvalues[0], numpoints*sizeof(float));
+                }
+            }
+            else {
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    O.write((const char*) &_vtrajdata[ipoint*dof+idof], sizeof(dReal));
+                }
+            }
+        }
+    }
+
+    /// \brief reads numDataPoints values written by _WriteCompressedData into _vtrajdata
+    void _ReadCompressedData(std::istream& I, uint32_t numDataPoints)
+    {
+        const int dof = _spec.GetDOF();
+        if( dof <= 0 ? numDataPoints > 0 : (numDataPoints % dof) != 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("compressed trajectory has %d values, which is not a multiple of the dof %d"),numDataPoints%dof,ORE_InvalidArguments);
+        }
+        const size_t numpoints = dof > 0 ? numDataPoints/dof : 0;
+        _vtrajdata.resize(numDataPoints);
+        std::vector<float> vfloatvalues;
+        for(int idof = 0; idof < dof; ++idof) {
+            uint8_t encoding = 0;
+            ReadBinaryUInt8(I, encoding);
+            if( encoding == BTDE_QuantizedDelta ) {
+                dReal fstep = 0;
+                I.read((char*) &fstep, sizeof(fstep));
+                int64_t multiple = 0;
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    uint64_t zigzag = 0;
+                    if( !ReadBinaryVarUInt64(I, zigzag) ) {
+                        throw OPENRAVE_EXCEPTION_FORMAT(_("failed to read quantized value %d of column %d"),ipoint%idof,ORE_InvalidArguments);
+                    }
+                    multiple += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+                    _vtrajdata[ipoint*dof+idof] = multiple*fstep;
+                }
+            }
+            else if( encoding == BTDE_Float32 ) {
+                vfloatvalues.resize(numpoints);
+                if( numpoints > 0 ) {
+                    I.read((char*) &vfloatvalues[0], numpoints*sizeof(float));
+                }
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    _vtrajdata[ipoint*dof+idof] = vfloatvalues[ipoint];
+                }
+            }
+            else if( encoding == BTDE_Raw ) {
+                for(size_t ipoint = 0; ipoint < numpoints; ++ipoint) {
+                    I.read((char*) &_vtrajdata[ipoint*dof+idof], sizeof(dReal));
+                }
+            }
+            else {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("unknown trajectory data encoding %d for column %d"),(int)encoding%idof,ORE_InvalidArguments);
+            }
+        }
+        if( !I ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0(_("failed to read compressed trajectory data"),ORE_InvalidArguments);
+        }
     }
 
-protected:
     void _ConvertData(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, const std::vector< std::vector<ConfigurationSpecification::Group>::const_iterator >& vconvertgroups, const ConfigurationSpecification& spec, size_t numelements, bool filluninitialized)
     {
         for(size_t igroup = 0; igroup < vconvertgroups.size(); ++igroup) {
@@ -633,6 +1060,16 @@ protected:
         }
     }
 
+    /// \brief marks that the waypoints starting at index have changed, so their accumulated times have to be recomputed
+    inline void _SetChanged(size_t index)
+    {
+        _nChangedIndex = _bChanged ? min(_nChangedIndex, index) : index;
+        _bChanged = true;
+    }
+
+    /// \brief computes _vaccumtime and _vdeltainvtime for the waypoints starting at _nChangedIndex.
+    ///
+    /// The waypoints before _nChangedIndex did not change, so editing the end of the trajectory does not recompute all the times.
     void _ComputeInternal() const
     {
         if( !_bChanged ) {
@@ -648,9 +1085,13 @@ protected:
             if( _vaccumtime.size() == 0 ) {
                 return;
             }
-            _vaccumtime.at(0) = _vtrajdata.at(_timeoffset);
-            _vdeltainvtime.at(0) = 1/_vtrajdata.at(_timeoffset);
-            for(size_t i = 1; i < _vaccumtime.size(); ++i) {
+            size_t startindex = min(_nChangedIndex, _vaccumtime.size());
+            if( startindex == 0 ) {
+                _vaccumtime.at(0) = _vtrajdata.at(_timeoffset);
+                _vdeltainvtime.at(0) = 1/_vtrajdata.at(_timeoffset);
+                startindex = 1;
+            }
+            for(size_t i = startindex; i < _vaccumtime.size(); ++i) {
                 dReal deltatime = _vtrajdata[_spec.GetDOF()*i+_timeoffset];
                 if( deltatime < 0 ) {
                     throw OPENRAVE_EXCEPTION_FORMAT("deltatime (%.15e) is < 0 at point %d/%d", deltatime%i%_vaccumtime.size(), ORE_InvalidState);
@@ -663,6 +1104,108 @@ protected:
         _bSamplingVerified = false;
     }
 
+    /// \brief returns the converter from the internal specification to spec, reusing the previous one when spec is the same
+    ///
+    /// If the previous converter has default values from the environment, it is initialized again since the environment might have changed.
+    const ConfigurationSpecification::Converter& _GetConverter(const ConfigurationSpecification& spec) const
+    {
+        if( !_converter.IsInitialized() || _converter.HasEnvironmentDefaults() || _converterspec != spec ) {
+            _converter.Init(spec, _spec, GetEnv());
+            _converterspec = spec;
+        }
+        return _converter;
+    }
+
+    /// \brief the checks Sample does before sampling, done once for all the points of SamplePoints/SampleRange
+    void _InitSamplePoints() const
+    {
+        BOOST_ASSERT(_bInit);
+        OPENRAVE_ASSERT_OP(_timeoffset,>=,0);
+        _ComputeInternal();
+        OPENRAVE_ASSERT_OP_FORMAT0((int)_vtrajdata.size(),>=,_spec.GetDOF(), "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
+            _VerifySampling();
+        }
+    }
+
+    /// \brief returns the first waypoint whose accumulated time is >= time starting the search from the waypoint index of a previous time, assumes time < GetDuration().
+    ///
+    /// Times that increase a little only move the index a few waypoints forward instead of a binary search over all the waypoints.
+    /// Times going backwards search the waypoints before the index.
+    size_t _MoveWaypointCursor(size_t index, dReal time) const
+    {
+        const size_t numsearchsteps = 8; // after that many steps forward, binary search the remaining waypoints
+        if( index >= _vaccumtime.size() ) {
+            index = _vaccumtime.size()-1;
+        }
+        if( index > 0 && _vaccumtime[index-1] >= time ) {
+            return std::lower_bound(_vaccumtime.begin(),_vaccumtime.begin()+index,time)-_vaccumtime.begin();
+        }
+        // time < duration, so the cursor never goes past the last waypoint
+        size_t nsteps = 0;
+        while( _vaccumtime[index] < time ) {
+            ++index;
+            if( ++nsteps >= numsearchsteps ) {
+                return std::lower_bound(_vaccumtime.begin()+index,_vaccumtime.end(),time)-_vaccumtime.begin();
+            }
+        }
+        return index;
+    }
+
+    /// \brief samples numpoints at the times gettime(0..numpoints-1) with the internal specification into itdata, the same way as Sample.
+    ///
+    /// The times are usually increasing, so the waypoint of every time is found by moving a cursor forward from the
+    /// waypoint of the previous one instead of a binary search over all the waypoints. Times going backwards restart the search.
+    /// \param bSetSampleTime if true, the time offset of the samples is set like Sample does, otherwise it is left like the spec overload of Sample does
+    template <typename TimeFn>
+    void _SamplePoints(std::vector<dReal>::iterator itdata, size_t numpoints, const TimeFn& gettime, bool bSetSampleTime) const
+    {
+        OPENRAVE_PROFILE_SCOPE("trajectory", "SamplePoints");
+        const int dof = _spec.GetDOF();
+        const dReal duration = GetDuration();
+        _vsampleinterpolators.resize(0);
+        for(size_t i = 0; i < _vgroupinterpolators.size(); ++i) {
+            if( !!_vgroupinterpolators[i] ) {
+                _vsampleinterpolators.push_back(&_vgroupinterpolators[i]);
+            }
+        }
+        _vsampledata.resize(dof);
+        size_t index = 0; // first waypoint whose accumulated time is >= the sample time
+        for(size_t ipoint = 0; ipoint < numpoints; ++ipoint, itdata += dof) {
+            dReal time = gettime(ipoint);
+            if( time >= duration ) {
+                std::copy(_vtrajdata.end()-dof,_vtrajdata.end(),itdata);
+                continue;
+            }
+            index = _MoveWaypointCursor(index, time);
+            if( index == 0 ) {
+                std::copy(_vtrajdata.begin(),_vtrajdata.begin()+dof,itdata);
+                if( bSetSampleTime ) {
+                    *(itdata+_timeoffset) = time;
+                }
+                continue;
+            }
+            dReal deltatime = time-_vaccumtime[index-1];
+            dReal waypointdeltatime = _vtrajdata[dof*index + _timeoffset];
+            // unfortunately due to floating-point error deltatime might not be in the range [0, waypointdeltatime], so double check!
+            if( deltatime < 0 ) {
+                deltatime = 0;
+            }
+            else if( deltatime > waypointdeltatime ) {
+                deltatime = waypointdeltatime;
+            }
+            std::fill(_vsampledata.begin(), _vsampledata.end(), 0);
+            for(size_t i = 0; i < _vsampleinterpolators.size(); ++i) {
+                (*_vsampleinterpolators[i])(index-1,deltatime,_vsampledata);
+            }
+            if( bSetSampleTime ) {
+                // should return the sample time relative to the last endpoint so it is easier to re-insert in the trajectory
+                _vsampledata[_timeoffset] = deltatime;
+            }
+            std::copy(_vsampledata.begin(), _vsampledata.end(), itdata);
+        }
+    }
+
     /// \brief assumes _ComputeInternal has finished
     void _VerifySampling() const
     {
@@ -1301,7 +1844,20 @@ protected:
     mutable std::vector<dReal> _vaccumtime, _vdeltainvtime;
     bool _bInit;
     mutable bool _bChanged; ///< if true, then _ComputeInternal() has to be called in order to compute _vaccumtime and _vdeltainvtime
+    mutable size_t _nChangedIndex; ///< if _bChanged, the first waypoint whose _vaccumtime and _vdeltainvtime have to be recomputed
     mutable bool _bSamplingVerified; ///< if false, then _VerifySampling() has not be called yet to verify that all points can be sampled.
+
+    mutable std::vector<dReal> _vsampledata, _vsamplepoints; ///< caches for sampling
+    mutable ConfigurationSpecification _converterspec; ///< the target specification of _converter
+    mutable ConfigurationSpecification::Converter _converter; ///< converts from _spec to _converterspec
+
+    mutable std::map<std::string, std::pair<std::string, std::string> > _mapLazyReadableInterfaces; ///< readable interfaces that are not parsed yet, xmlid -> (serialized data, reader type)
+    mutable boost::mutex _mutexLazyReadableInterfaces; ///< protects _mapLazyReadableInterfaces
+
+    BinaryTrajectoryDataEncoding _dataencoding; ///< how serialize stores the waypoint values, set with SetCompression
+    dReal _fQuantizationTolerance; ///< maximum error of a value when _dataencoding is BTDE_QuantizedDelta
+    std::map<std::string, dReal> _mapGroupQuantizationTolerances; ///< group name without arguments -> tolerance overriding _fQuantizationTolerance
+    mutable std::vector< const boost::function<void(size_t,dReal,std::vector<dReal>&)>* > _vsampleinterpolators; ///< cache of the valid _vgroupinterpolators for SamplePoints/SampleRange
 };
 
 TrajectoryBasePtr CreateGenericTrajectory(EnvironmentBasePtr penv, std::istream& sinput)
@@ -103,6 +103,7 @@ class ColladaWriter;
 RobotBasePtr CreateGenericRobot(EnvironmentBasePtr penv, std::istream& sinput);
 MultiControllerBasePtr CreateMultiController(EnvironmentBasePtr penv, std::istream& sinput);
 TrajectoryBasePtr CreateGenericTrajectory(EnvironmentBasePtr penv, std::istream& sinput);
+TrajectoryBasePtr CreateStreamingTrajectory(EnvironmentBasePtr penv, std::istream& sinput);
 PhysicsEngineBasePtr CreateGenericPhysicsEngine(EnvironmentBasePtr penv, std::istream& sinput);
 CollisionCheckerBasePtr CreateGenericCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput);
 
@@ -288,6 +289,20 @@ bool CreateTriMeshFromFile(EnvironmentBasePtr, const std::string& filename, cons
 bool CreateTriMeshFromData(const std::string& data, const std::string& formathint, const Vector &vscale, TriMesh& trimesh, RaveVector<float>&diffuseColor, RaveVector<float>&ambientColor, float &ftransparency);
 
 bool CreateGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries);
+
+/// \brief while in scope, the meshes referenced by the OpenRAVE XML file are imported on worker threads ahead of the parser and every mesh file is imported only once
+///
+/// Locks the XML parser. Nested scopes reuse the imports of the outermost one.
+class MeshImportScope
+{
+public:
+    MeshImportScope(const std::string& filename);
+    ~MeshImportScope();
+
+private:
+    EnvironmentMutex::scoped_lock _lock;
+    bool _bOwner; ///< true if this is the outermost scope
+};
 }
 
 #ifdef _WIN32
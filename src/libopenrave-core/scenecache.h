@@ -0,0 +1,658 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef RAVE_SCENE_CACHE_H
+#define RAVE_SCENE_CACHE_H
+
+#include "ravep.h"
+
+#include <sys/stat.h>
+
+/// \brief a file the cached scene was loaded from, the cache is only valid while it is unchanged
+struct SceneCacheDependency
+{
+    SceneCacheDependency() : filesize(0), modifiedtime(0) {
+    }
+
+    /// \brief fills the stamp of the file, returns false if the file cannot be read
+    bool InitFromFile(const std::string& filename_) {
+        struct stat filestat;
+        if( stat(filename_.c_str(), &filestat) != 0 ) {
+            return false;
+        }
+        filename = filename_;
+        filesize = filestat.st_size;
+        modifiedtime = filestat.st_mtime;
+        return true;
+    }
+
+    /// \brief returns true if the file still has the stamp
+    bool IsValid() const {
+        SceneCacheDependency current;
+        return current.InitFromFile(filename) && current.filesize == filesize && current.modifiedtime == modifiedtime;
+    }
+
+    std::string filename;
+    uint64_t filesize, modifiedtime;
+};
+
+/// \brief everything needed to construct a body of a cached scene without parsing its source files
+struct SceneCacheBody
+{
+    SceneCacheBody() : bIsRobot(false), nControlTransformation(0), nActiveAffineDOFs(0) {
+    }
+
+    std::string xmlid, name, uri;
+    bool bIsRobot;
+    std::vector<KinBody::LinkInfoPtr> vLinkInfos;
+    std::vector<KinBody::JointInfoPtr> vJointInfos; ///< the active joints followed by the passive joints
+    std::vector<RobotBase::ManipulatorInfoPtr> vManipulatorInfos;
+    std::string controllerxmlid; ///< empty if the robot has no controller
+    std::vector<int> vControlDOFIndices;
+    int nControlTransformation;
+    std::vector<int> vActiveDOFIndices;
+    int nActiveAffineDOFs;
+    Vector vActiveRotationAxis;
+    std::vector<int> vNonAdjacentLinks; ///< the non-adjacent link pairs without any adjacent options, computed by self-collision checks
+    std::vector<Transform> vInitialLinkTransformations; ///< the link transforms vNonAdjacentLinks were computed at
+    std::string kinematicsgeometryhash; ///< checked after the body is constructed
+    std::string robotstructurehash;
+};
+
+/// \brief writes scene cache data in native binary.
+///
+/// The cache is only read by the same build of openrave on the same machine, so values are written with their native layout.
+class SceneCacheWriter
+{
+public:
+    SceneCacheWriter(std::ostream& O) : _O(O) {
+    }
+
+    void WriteHeader() {
+        Write(std::string("openrave_scene_cache"));
+        Write((int32_t)s_nVersion);
+        Write(std::string(OPENRAVE_VERSION_STRING));
+        Write(std::string(OPENRAVE_KINBODY_HASH));
+        Write(std::string(OPENRAVE_ROBOT_HASH));
+        Write((uint8_t)sizeof(dReal));
+    }
+
+    void Write(bool b) {
+        _WritePOD((uint8_t)b);
+    }
+    void Write(uint8_t v) {
+        _WritePOD(v);
+    }
+    void Write(int16_t v) {
+        _WritePOD(v);
+    }
+    void Write(int32_t v) {
+        _WritePOD(v);
+    }
+    void Write(uint64_t v) {
+        _WritePOD(v);
+    }
+    void Write(float f) {
+        _WritePOD(f);
+    }
+    void Write(double f) {
+        _WritePOD(f);
+    }
+    void Write(const std::string& s) {
+        Write((uint64_t)s.size());
+        _O.write(s.c_str(), s.size());
+    }
+    template <typename T> void Write(const RaveVector<T>& v) {
+        _WritePOD(v);
+    }
+    void Write(const Transform& t) {
+        _WritePOD(t);
+    }
+    // vertices and indices of meshes are written in one block
+    void Write(const std::vector<Vector>& v) {
+        Write((uint64_t)v.size());
+        if( v.size() > 0 ) {
+            _O.write((const char*)&v[0], v.size()*sizeof(v[0]));
+        }
+    }
+    void Write(const std::vector<int32_t>& v) {
+        Write((uint64_t)v.size());
+        if( v.size() > 0 ) {
+            _O.write((const char*)&v[0], v.size()*sizeof(v[0]));
+        }
+    }
+    template <typename T> void Write(const std::vector<T>& v) {
+        Write((uint64_t)v.size());
+        FOREACHC(it, v) {
+            Write(*it);
+        }
+    }
+    template <typename T, std::size_t N> void Write(const boost::array<T, N>& v) {
+        FOREACHC(it, v) {
+            Write(*it);
+        }
+    }
+    template <typename T> void Write(const std::set<T>& v) {
+        Write((uint64_t)v.size());
+        FOREACHC(it, v) {
+            Write(*it);
+        }
+    }
+    template <typename T, typename U> void Write(const std::pair<T, U>& p) {
+        Write(p.first);
+        Write(p.second);
+    }
+    template <typename T, typename U> void Write(const std::map<T, U>& m) {
+        Write((uint64_t)m.size());
+        FOREACHC(it, m) {
+            Write(it->first);
+            Write(it->second);
+        }
+    }
+    /// \brief writes if the pointer is set and then the pointed value
+    template <typename T> void Write(const boost::shared_ptr<T>& p) {
+        Write(!!p);
+        if( !!p ) {
+            Write(*p);
+        }
+    }
+
+    void Write(const TriMesh& mesh) {
+        Write(mesh.vertices);
+        Write(mesh.indices);
+    }
+
+    void Write(const SceneCacheDependency& dependency) {
+        Write(dependency.filename);
+        Write(dependency.filesize);
+        Write(dependency.modifiedtime);
+    }
+
+    void Write(const KinBody::GeometryInfo::SideWall& sidewall) {
+        Write(sidewall.transf);
+        Write(sidewall.vExtents);
+        Write((int32_t)sidewall.type);
+    }
+
+    void Write(const KinBody::GeometryInfo& info) {
+        Write(info._t);
+        Write(info._vGeomData);
+        Write(info._vGeomData2);
+        Write(info._vGeomData3);
+        Write(info._vGeomData4);
+        Write(info._vSideWalls);
+        Write(info._setVoxels);
+        Write(info._vDiffuseColor);
+        Write(info._vAmbientColor);
+        Write(info._meshcollision);
+        Write((int32_t)info._type);
+        Write(info._name);
+        Write(info._filenamerender);
+        Write(info._filenamecollision);
+        Write(info._vRenderScale);
+        Write(info._vCollisionScale);
+        Write(info._fTransparency);
+        Write(info._bVisible);
+        Write(info._bModifiable);
+    }
+
+    void Write(const KinBody::LinkInfo& info) {
+        Write(info._vgeometryinfos);
+        Write(info._mapExtraGeometries);
+        Write(info._name);
+        Write(info._t);
+        Write(info._tMassFrame);
+        Write(info._mass);
+        Write(info._vinertiamoments);
+        Write(info._mapFloatParameters);
+        Write(info._mapIntParameters);
+        Write(info._mapStringParameters);
+        Write(info._vForcedAdjacentLinks);
+        Write(info._bStatic);
+        Write(info._bIsEnabled);
+    }
+
+    void Write(const KinBody::MimicInfo& info) {
+        Write(info._equations);
+    }
+
+    void Write(const ElectricMotorActuatorInfo& info) {
+        Write(info.model_type);
+        Write(info.assigned_power_rating);
+        Write(info.max_speed);
+        Write(info.no_load_speed);
+        Write(info.stall_torque);
+        Write(info.max_instantaneous_torque);
+        Write(info.nominal_speed_torque_points);
+        Write(info.max_speed_torque_points);
+        Write(info.nominal_torque);
+        Write(info.rotor_inertia);
+        Write(info.torque_constant);
+        Write(info.nominal_voltage);
+        Write(info.speed_constant);
+        Write(info.starting_current);
+        Write(info.terminal_resistance);
+        Write(info.gear_ratio);
+        Write(info.coloumb_friction);
+        Write(info.viscous_friction);
+    }
+
+    void Write(const KinBody::JointInfo::JointControlInfo_RobotController& info) {
+        Write((int32_t)info.robotId);
+        Write(info.robotControllerDOFIndex);
+    }
+
+    void Write(const KinBody::JointInfo::JointControlInfo_IO& info) {
+        Write((int32_t)info.deviceId);
+        Write(info.vMoveIONames);
+        Write(info.vUpperLimitIONames);
+        Write(info.vUpperLimitSensorIsOn);
+        Write(info.vLowerLimitIONames);
+        Write(info.vLowerLimitSensorIsOn);
+    }
+
+    void Write(const KinBody::JointInfo::JointControlInfo_ExternalDevice& info) {
+        Write(info.externalDeviceId);
+    }
+
+    void Write(const KinBody::JointInfo& info) {
+        Write((int32_t)info._type);
+        Write(info._name);
+        Write(info._linkname0);
+        Write(info._linkname1);
+        Write(info._vanchor);
+        Write(info._vaxes);
+        Write(info._vcurrentvalues);
+        Write(info._vresolution);
+        Write(info._vmaxvel);
+        Write(info._vhardmaxvel);
+        Write(info._vmaxaccel);
+        Write(info._vhardmaxaccel);
+        Write(info._vmaxjerk);
+        Write(info._vhardmaxjerk);
+        Write(info._vmaxtorque);
+        Write(info._vmaxinertia);
+        Write(info._vweights);
+        Write(info._voffsets);
+        Write(info._vlowerlimit);
+        Write(info._vupperlimit);
+        Write(info._vmimic);
+        Write(info._mapFloatParameters);
+        Write(info._mapIntParameters);
+        Write(info._mapStringParameters);
+        Write(info._infoElectricMotor);
+        Write(info._bIsCircular);
+        Write(info._bIsActive);
+        Write((int32_t)info._controlMode);
+        Write(info._jci_robotcontroller);
+        Write(info._jci_io);
+        Write(info._jci_externaldevice);
+    }
+
+    void Write(const RobotBase::ManipulatorInfo& info) {
+        Write(info._name);
+        Write(info._sBaseLinkName);
+        Write(info._sEffectorLinkName);
+        Write(info._tLocalTool);
+        Write(info._vChuckingDirection);
+        Write(info._vdirection);
+        Write(info._sIkSolverXMLId);
+        Write(info._vGripperJointNames);
+        Write(info._gripperid);
+    }
+
+    void Write(const SceneCacheBody& body) {
+        Write(body.xmlid);
+        Write(body.name);
+        Write(body.uri);
+        Write(body.bIsRobot);
+        Write(body.vLinkInfos);
+        Write(body.vJointInfos);
+        Write(body.vManipulatorInfos);
+        Write(body.controllerxmlid);
+        Write(body.vControlDOFIndices);
+        Write((int32_t)body.nControlTransformation);
+        Write(body.vActiveDOFIndices);
+        Write((int32_t)body.nActiveAffineDOFs);
+        Write(body.vActiveRotationAxis);
+        Write(body.vNonAdjacentLinks);
+        Write(body.vInitialLinkTransformations);
+        Write(body.kinematicsgeometryhash);
+        Write(body.robotstructurehash);
+    }
+
+    static const int s_nVersion = 1;
+
+private:
+    template <typename T> void _WritePOD(const T& t) {
+        _O.write((const char*)&t, sizeof(T));
+    }
+
+    std::ostream& _O;
+};
+
+/// \brief reads the data written by SceneCacheWriter, throws openrave_exception if the data is truncated
+class SceneCacheReader
+{
+public:
+    SceneCacheReader(std::istream& I) : _I(I) {
+    }
+
+    /// \brief returns false if the cache was written by a different version
+    bool ReadHeader() {
+        std::string magic, version, kinbodyhash, robothash;
+        int32_t cacheversion = 0;
+        uint8_t realsize = 0;
+        Read(magic);
+        if( magic != "openrave_scene_cache" ) {
+            return false;
+        }
+        Read(cacheversion);
+        Read(version);
+        Read(kinbodyhash);
+        Read(robothash);
+        Read(realsize);
+        return cacheversion == SceneCacheWriter::s_nVersion && version == OPENRAVE_VERSION_STRING && kinbodyhash == OPENRAVE_KINBODY_HASH && robothash == OPENRAVE_ROBOT_HASH && realsize == sizeof(dReal);
+    }
+
+    void Read(bool& b) {
+        uint8_t v = 0;
+        _ReadPOD(v);
+        b = !!v;
+    }
+    void Read(uint8_t& v) {
+        _ReadPOD(v);
+    }
+    void Read(int16_t& v) {
+        _ReadPOD(v);
+    }
+    void Read(int32_t& v) {
+        _ReadPOD(v);
+    }
+    void Read(uint64_t& v) {
+        _ReadPOD(v);
+    }
+    void Read(float& f) {
+        _ReadPOD(f);
+    }
+    void Read(double& f) {
+        _ReadPOD(f);
+    }
+    void Read(std::string& s) {
+        s.resize(_ReadSize());
+        if( s.size() > 0 ) {
+            _ReadBlock(&s[0], s.size());
+        }
+    }
+    template <typename T> void Read(RaveVector<T>& v) {
+        _ReadPOD(v);
+    }
+    void Read(Transform& t) {
+        _ReadPOD(t);
+    }
+    void Read(std::vector<Vector>& v) {
+        v.resize(_ReadSize());
+        if( v.size() > 0 ) {
+            _ReadBlock((char*)&v[0], v.size()*sizeof(v[0]));
+        }
+    }
+    void Read(std::vector<int32_t>& v) {
+        v.resize(_ReadSize());
+        if( v.size() > 0 ) {
+            _ReadBlock((char*)&v[0], v.size()*sizeof(v[0]));
+        }
+    }
+    template <typename T> void Read(std::vector<T>& v) {
+        v.resize(_ReadSize());
+        FOREACH(it, v) {
+            Read(*it);
+        }
+    }
+    template <typename T, std::size_t N> void Read(boost::array<T, N>& v) {
+        FOREACH(it, v) {
+            Read(*it);
+        }
+    }
+    template <typename T> void Read(std::set<T>& v) {
+        v.clear();
+        uint64_t num = _ReadSize();
+        for(uint64_t i = 0; i < num; ++i) {
+            T t;
+            Read(t);
+            v.insert(v.end(), t);
+        }
+    }
+    template <typename T, typename U> void Read(std::pair<T, U>& p) {
+        Read(p.first);
+        Read(p.second);
+    }
+    template <typename T, typename U> void Read(std::map<T, U>& m) {
+        m.clear();
+        uint64_t num = _ReadSize();
+        for(uint64_t i = 0; i < num; ++i) {
+            T key;
+            Read(key);
+            Read(m[key]);
+        }
+    }
+    template <typename T> void Read(boost::shared_ptr<T>& p) {
+        bool bHasValue = false;
+        Read(bHasValue);
+        if( bHasValue ) {
+            p.reset(new T());
+            Read(*p);
+        }
+        else {
+            p.reset();
+        }
+    }
+
+    void Read(TriMesh& mesh) {
+        Read(mesh.vertices);
+        Read(mesh.indices);
+    }
+
+    void Read(SceneCacheDependency& dependency) {
+        Read(dependency.filename);
+        Read(dependency.filesize);
+        Read(dependency.modifiedtime);
+    }
+
+    void Read(KinBody::GeometryInfo::SideWall& sidewall) {
+        Read(sidewall.transf);
+        Read(sidewall.vExtents);
+        sidewall.type = (KinBody::GeometryInfo::SideWallType)_ReadInt();
+    }
+
+    void Read(KinBody::GeometryInfo& info) {
+        Read(info._t);
+        Read(info._vGeomData);
+        Read(info._vGeomData2);
+        Read(info._vGeomData3);
+        Read(info._vGeomData4);
+        Read(info._vSideWalls);
+        Read(info._setVoxels);
+        Read(info._vDiffuseColor);
+        Read(info._vAmbientColor);
+        Read(info._meshcollision);
+        info._type = (GeometryType)_ReadInt();
+        Read(info._name);
+        Read(info._filenamerender);
+        Read(info._filenamecollision);
+        Read(info._vRenderScale);
+        Read(info._vCollisionScale);
+        Read(info._fTransparency);
+        Read(info._bVisible);
+        Read(info._bModifiable);
+    }
+
+    void Read(KinBody::LinkInfo& info) {
+        Read(info._vgeometryinfos);
+        Read(info._mapExtraGeometries);
+        Read(info._name);
+        Read(info._t);
+        Read(info._tMassFrame);
+        Read(info._mass);
+        Read(info._vinertiamoments);
+        Read(info._mapFloatParameters);
+        Read(info._mapIntParameters);
+        Read(info._mapStringParameters);
+        Read(info._vForcedAdjacentLinks);
+        Read(info._bStatic);
+        Read(info._bIsEnabled);
+    }
+
+    void Read(KinBody::MimicInfo& info) {
+        Read(info._equations);
+    }
+
+    void Read(ElectricMotorActuatorInfo& info) {
+        Read(info.model_type);
+        Read(info.assigned_power_rating);
+        Read(info.max_speed);
+        Read(info.no_load_speed);
+        Read(info.stall_torque);
+        Read(info.max_instantaneous_torque);
+        Read(info.nominal_speed_torque_points);
+        Read(info.max_speed_torque_points);
+        Read(info.nominal_torque);
+        Read(info.rotor_inertia);
+        Read(info.torque_constant);
+        Read(info.nominal_voltage);
+        Read(info.speed_constant);
+        Read(info.starting_current);
+        Read(info.terminal_resistance);
+        Read(info.gear_ratio);
+        Read(info.coloumb_friction);
+        Read(info.viscous_friction);
+    }
+
+    void Read(KinBody::JointInfo::JointControlInfo_RobotController& info) {
+        info.robotId = _ReadInt();
+        Read(info.robotControllerDOFIndex);
+    }
+
+    void Read(KinBody::JointInfo::JointControlInfo_IO& info) {
+        info.deviceId = _ReadInt();
+        Read(info.vMoveIONames);
+        Read(info.vUpperLimitIONames);
+        Read(info.vUpperLimitSensorIsOn);
+        Read(info.vLowerLimitIONames);
+        Read(info.vLowerLimitSensorIsOn);
+    }
+
+    void Read(KinBody::JointInfo::JointControlInfo_ExternalDevice& info) {
+        Read(info.externalDeviceId);
+    }
+
+    void Read(KinBody::JointInfo& info) {
+        info._type = (KinBody::JointType)_ReadInt();
+        Read(info._name);
+        Read(info._linkname0);
+        Read(info._linkname1);
+        Read(info._vanchor);
+        Read(info._vaxes);
+        Read(info._vcurrentvalues);
+        Read(info._vresolution);
+        Read(info._vmaxvel);
+        Read(info._vhardmaxvel);
+        Read(info._vmaxaccel);
+        Read(info._vhardmaxaccel);
+        Read(info._vmaxjerk);
+        Read(info._vhardmaxjerk);
+        Read(info._vmaxtorque);
+        Read(info._vmaxinertia);
+        Read(info._vweights);
+        Read(info._voffsets);
+        Read(info._vlowerlimit);
+        Read(info._vupperlimit);
+        Read(info._vmimic);
+        Read(info._mapFloatParameters);
+        Read(info._mapIntParameters);
+        Read(info._mapStringParameters);
+        Read(info._infoElectricMotor);
+        Read(info._bIsCircular);
+        Read(info._bIsActive);
+        info._controlMode = (KinBody::JointControlMode)_ReadInt();
+        Read(info._jci_robotcontroller);
+        Read(info._jci_io);
+        Read(info._jci_externaldevice);
+    }
+
+    void Read(RobotBase::ManipulatorInfo& info) {
+        Read(info._name);
+        Read(info._sBaseLinkName);
+        Read(info._sEffectorLinkName);
+        Read(info._tLocalTool);
+        Read(info._vChuckingDirection);
+        Read(info._vdirection);
+        Read(info._sIkSolverXMLId);
+        Read(info._vGripperJointNames);
+        Read(info._gripperid);
+    }
+
+    void Read(SceneCacheBody& body) {
+        Read(body.xmlid);
+        Read(body.name);
+        Read(body.uri);
+        Read(body.bIsRobot);
+        Read(body.vLinkInfos);
+        Read(body.vJointInfos);
+        Read(body.vManipulatorInfos);
+        Read(body.controllerxmlid);
+        Read(body.vControlDOFIndices);
+        body.nControlTransformation = _ReadInt();
+        Read(body.vActiveDOFIndices);
+        body.nActiveAffineDOFs = _ReadInt();
+        Read(body.vActiveRotationAxis);
+        Read(body.vNonAdjacentLinks);
+        Read(body.vInitialLinkTransformations);
+        Read(body.kinematicsgeometryhash);
+        Read(body.robotstructurehash);
+    }
+
+private:
+    template <typename T> void _ReadPOD(T& t) {
+        _ReadBlock((char*)&t, sizeof(T));
+    }
+
+    void _ReadBlock(char* pdata, size_t size) {
+        _I.read(pdata, size);
+        if( !_I ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0(_("scene cache is truncated"), ORE_InvalidState);
+        }
+    }
+
+    int32_t _ReadInt() {
+        int32_t v = 0;
+        _ReadPOD(v);
+        return v;
+    }
+
+    /// \brief reads the size of a container, throws if it is not reasonable so that a corrupted cache does not allocate everything
+    uint64_t _ReadSize() {
+        uint64_t size = 0;
+        _ReadPOD(size);
+        if( size > ((uint64_t)1<<32) ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("scene cache has invalid container size %d"), size, ORE_InvalidState);
+        }
+        return size;
+    }
+
+    std::istream& _I;
+};
+
+#endif
@@ -0,0 +1,281 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef RAVE_SPATIAL_GRID_H
+#define RAVE_SPATIAL_GRID_H
+
+#include "ravep.h"
+
+/// \brief uniform grid of cells over the world aabbs of the bodies of an environment, see EnvironmentBase::GetBodiesInAABB
+///
+/// The grid is updated lazily by the queries. A body is only moved between cells when its update stamp changed or when its geometry or enabled state changed, the other bodies are not touched.
+class BodySpatialGrid
+{
+    /// \brief aabb and cells of one body
+    struct Entry
+    {
+        Entry() : nUpdateStamp(-1), bChanged(true), bLarge(false), bInGrid(false), nQueryStamp(0) {
+        }
+        KinBodyWeakPtr pbody;
+        int nEnvironmentId;
+        int nUpdateStamp; ///< KinBody::GetUpdateStamp when the body was last binned
+        bool bChanged; ///< set by the change callback when the geometry or enabled state changed
+        bool bLarge; ///< if true, the body overlaps too many cells and is checked on every query instead of being binned
+        bool bInGrid; ///< if false, the body is disabled and not in any cell
+        int nQueryStamp; ///< _nQueryStamp of the last query that visited the entry, prevents adding a body several times
+        AABB ab; ///< world aabb of the enabled links
+        int vmincell[3], vmaxcell[3];
+        UserDataPtr changehandle;
+    };
+    typedef boost::shared_ptr<Entry> EntryPtr;
+
+public:
+    BodySpatialGrid() : _fCellSize(1.0), _fInvCellSize(1.0), _nBodiesModifiedStamp(-1), _nQueryStamp(0) {
+    }
+
+    /// \brief removes all the bodies, they are binned again by the next query
+    void Reset()
+    {
+        _mapCells.clear();
+        _setLargeEntries.clear();
+        _mapEntries.clear();
+        _nBodiesModifiedStamp = -1;
+    }
+
+    void SetCellSize(dReal fCellSize)
+    {
+        OPENRAVE_ASSERT_OP_FORMAT0(fCellSize, >, 0, "cell size has to be positive", ORE_InvalidArguments);
+        if( _fCellSize != fCellSize ) {
+            Reset();
+            _fCellSize = fCellSize;
+            _fInvCellSize = 1/fCellSize;
+        }
+    }
+
+    dReal GetCellSize() const {
+        return _fCellSize;
+    }
+
+    /// \brief makes the entries consistent with the bodies of the environment
+    ///
+    /// \param nBodiesModifiedStamp changes whenever vbodies changes, the bodies are only compared when it is different from the previous call
+    void UpdateBodies(const std::vector<KinBodyPtr>& vbodies, int nBodiesModifiedStamp)
+    {
+        if( _nBodiesModifiedStamp == nBodiesModifiedStamp ) {
+            return;
+        }
+        std::map<int, EntryPtr> mapPrevEntries;
+        mapPrevEntries.swap(_mapEntries);
+        FOREACHC(itbody, vbodies) {
+            int envid = (*itbody)->GetEnvironmentId();
+            std::map<int, EntryPtr>::iterator itentry = mapPrevEntries.find(envid);
+            if( itentry != mapPrevEntries.end() && itentry->second->pbody.lock() == *itbody ) {
+                _mapEntries[envid] = itentry->second;
+                mapPrevEntries.erase(itentry);
+                continue;
+            }
+            EntryPtr pentry(new Entry());
+            pentry->pbody = *itbody;
+            pentry->nEnvironmentId = envid;
+            pentry->changehandle = (*itbody)->RegisterChangeCallback(KinBody::Prop_LinkGeometry|KinBody::Prop_LinkEnable, boost::bind(&BodySpatialGrid::_SetChanged, boost::weak_ptr<Entry>(pentry)));
+            _mapEntries[envid] = pentry;
+        }
+        // whatever is left was removed from the environment
+        FOREACH(itentry, mapPrevEntries) {
+            _RemoveFromCells(*itentry->second);
+        }
+        _nBodiesModifiedStamp = nBodiesModifiedStamp;
+    }
+
+    /// \brief fills the bodies whose aabbs overlap ab sorted by environment id, rebins the bodies that changed
+    void GetBodies(const AABB& ab, std::vector<KinBodyPtr>& bodies)
+    {
+        bodies.resize(0);
+        FOREACH(itentry, _mapEntries) {
+            Entry& entry = *itentry->second;
+            if( entry.bChanged || entry.nUpdateStamp != _GetUpdateStamp(entry) ) {
+                _Rebin(entry);
+            }
+        }
+
+        ++_nQueryStamp;
+        _vcandidates.resize(0);
+        int vmincell[3], vmaxcell[3];
+        _GetCellRange(ab, vmincell, vmaxcell);
+        if( _GetNumCells(vmincell, vmaxcell) > s_nMaxQueryCells ) {
+            // cheaper to go through all the bodies
+            FOREACH(itentry, _mapEntries) {
+                if( itentry->second->bInGrid ) {
+                    _vcandidates.push_back(itentry->second.get());
+                }
+            }
+        }
+        else {
+            for(int x = vmincell[0]; x <= vmaxcell[0]; ++x) {
+                for(int y = vmincell[1]; y <= vmaxcell[1]; ++y) {
+                    for(int z = vmincell[2]; z <= vmaxcell[2]; ++z) {
+                        std::map<uint64_t, std::vector<Entry*> >::iterator itcell = _mapCells.find(_GetCellKey(x,y,z));
+                        if( itcell == _mapCells.end() ) {
+                            continue;
+                        }
+                        FOREACH(itpentry, itcell->second) {
+                            if( (*itpentry)->nQueryStamp != _nQueryStamp ) {
+                                (*itpentry)->nQueryStamp = _nQueryStamp;
+                                _vcandidates.push_back(*itpentry);
+                            }
+                        }
+                    }
+                }
+            }
+            _vcandidates.insert(_vcandidates.end(), _setLargeEntries.begin(), _setLargeEntries.end());
+        }
+
+        FOREACH(itpentry, _vcandidates) {
+            const AABB& abbody = (*itpentry)->ab;
+            if( RaveFabs(abbody.pos.x-ab.pos.x) > abbody.extents.x+ab.extents.x || RaveFabs(abbody.pos.y-ab.pos.y) > abbody.extents.y+ab.extents.y || RaveFabs(abbody.pos.z-ab.pos.z) > abbody.extents.z+ab.extents.z ) {
+                continue;
+            }
+            KinBodyPtr pbody = (*itpentry)->pbody.lock();
+            if( !!pbody ) {
+                bodies.push_back(pbody);
+            }
+        }
+        std::sort(bodies.begin(), bodies.end(), _CompareEnvironmentId);
+    }
+
+private:
+    static void _SetChanged(boost::weak_ptr<Entry> pweakentry)
+    {
+        EntryPtr pentry = pweakentry.lock();
+        if( !!pentry ) {
+            pentry->bChanged = true;
+        }
+    }
+
+    static bool _CompareEnvironmentId(const KinBodyPtr& pbody0, const KinBodyPtr& pbody1)
+    {
+        return pbody0->GetEnvironmentId() < pbody1->GetEnvironmentId();
+    }
+
+    static int _GetUpdateStamp(const Entry& entry)
+    {
+        KinBodyPtr pbody = entry.pbody.lock();
+        return !!pbody ? pbody->GetUpdateStamp() : entry.nUpdateStamp;
+    }
+
+    /// \brief packs the cell coordinates in 21 bits each, cells far enough to wrap around only share a key
+    static uint64_t _GetCellKey(int x, int y, int z)
+    {
+        return ((uint64_t)(x&0x1fffff)<<42)|((uint64_t)(y&0x1fffff)<<21)|(uint64_t)(z&0x1fffff);
+    }
+
+    static uint64_t _GetNumCells(const int vmincell[3], const int vmaxcell[3])
+    {
+        return (uint64_t)(vmaxcell[0]-vmincell[0]+1)*(uint64_t)(vmaxcell[1]-vmincell[1]+1)*(uint64_t)(vmaxcell[2]-vmincell[2]+1);
+    }
+
+    void _GetCellRange(const AABB& ab, int vmincell[3], int vmaxcell[3]) const
+    {
+        for(int i = 0; i < 3; ++i) {
+            vmincell[i] = (int)floor((ab.pos[i]-ab.extents[i])*_fInvCellSize);
+            vmaxcell[i] = (int)floor((ab.pos[i]+ab.extents[i])*_fInvCellSize);
+        }
+    }
+
+    void _RemoveFromCells(Entry& entry)
+    {
+        if( !entry.bInGrid ) {
+            return;
+        }
+        if( entry.bLarge ) {
+            _setLargeEntries.erase(&entry);
+        }
+        else {
+            for(int x = entry.vmincell[0]; x <= entry.vmaxcell[0]; ++x) {
+                for(int y = entry.vmincell[1]; y <= entry.vmaxcell[1]; ++y) {
+                    for(int z = entry.vmincell[2]; z <= entry.vmaxcell[2]; ++z) {
+                        std::map<uint64_t, std::vector<Entry*> >::iterator itcell = _mapCells.find(_GetCellKey(x,y,z));
+                        if( itcell == _mapCells.end() ) {
+                            continue;
+                        }
+                        std::vector<Entry*>::iterator itpentry = std::find(itcell->second.begin(), itcell->second.end(), &entry);
+                        if( itpentry != itcell->second.end() ) {
+                            *itpentry = itcell->second.back();
+                            itcell->second.pop_back();
+                        }
+                        if( itcell->second.size() == 0 ) {
+                            _mapCells.erase(itcell);
+                        }
+                    }
+                }
+            }
+        }
+        entry.bInGrid = false;
+        entry.bLarge = false;
+    }
+
+    void _Rebin(Entry& entry)
+    {
+        KinBodyPtr pbody = entry.pbody.lock();
+        entry.bChanged = false;
+        if( !pbody ) {
+            _RemoveFromCells(entry);
+            return;
+        }
+        entry.nUpdateStamp = pbody->GetUpdateStamp();
+        if( !pbody->IsEnabled() ) {
+            _RemoveFromCells(entry);
+            return;
+        }
+
+        entry.ab = pbody->ComputeAABB(true);
+        int vmincell[3], vmaxcell[3];
+        _GetCellRange(entry.ab, vmincell, vmaxcell);
+        if( entry.bInGrid && !entry.bLarge && std::equal(vmincell, vmincell+3, entry.vmincell) && std::equal(vmaxcell, vmaxcell+3, entry.vmaxcell) ) {
+            // moved inside its cells
+            return;
+        }
+        _RemoveFromCells(entry);
+        std::copy(vmincell, vmincell+3, entry.vmincell);
+        std::copy(vmaxcell, vmaxcell+3, entry.vmaxcell);
+        entry.bInGrid = true;
+        if( _GetNumCells(vmincell, vmaxcell) > s_nMaxBodyCells ) {
+            entry.bLarge = true;
+            _setLargeEntries.insert(&entry);
+            return;
+        }
+        for(int x = vmincell[0]; x <= vmaxcell[0]; ++x) {
+            for(int y = vmincell[1]; y <= vmaxcell[1]; ++y) {
+                for(int z = vmincell[2]; z <= vmaxcell[2]; ++z) {
+                    _mapCells[_GetCellKey(x,y,z)].push_back(&entry);
+                }
+            }
+        }
+    }
+
+    static const uint64_t s_nMaxBodyCells = 64; ///< bodies overlapping more cells are kept in _setLargeEntries, like floors and walls
+    static const uint64_t s_nMaxQueryCells = 4096; ///< queries overlapping more cells go through all the bodies
+
+    dReal _fCellSize, _fInvCellSize;
+    int _nBodiesModifiedStamp; ///< Environment::_nBodiesModifiedStamp when the entries were last updated
+    int _nQueryStamp;
+    std::map<int, EntryPtr> _mapEntries; ///< environment id to entry
+    std::map<uint64_t, std::vector<Entry*> > _mapCells; ///< cell key to the entries of the bodies overlapping the cell
+    std::set<Entry*> _setLargeEntries;
+    std::vector<Entry*> _vcandidates; ///< cache for GetBodies
+};
+
+#endif
@@ -0,0 +1,357 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "ravep.h"
+#include <atomic>
+
+namespace OpenRAVE {
+
+/** \brief trajectory that can only be appended to, so that one thread can append waypoints while another thread samples it.
+
+    The waypoints are stored in chunks, one for every Insert call. A chunk is a GenericTrajectory that starts with the
+    last waypoint of the previous chunk, so that it can be sampled independently of the other chunks. Chunks are never
+    changed once they are published, so appending only needs to publish the new chunk with an atomic counter.
+
+    Only one thread can append and only one thread can sample at the same time, and Init/Clone/deserialize should not
+    be called while another thread uses the trajectory.
+ */
+class StreamingTrajectory : public TrajectoryBase
+{
+    /// \brief the waypoints added by one Insert call
+    struct Chunk
+    {
+        Chunk() : startindex(0), starttime(0), endtime(0) {
+        }
+        TrajectoryBasePtr traj; ///< GenericTrajectory of the waypoints, for all chunks except the first it starts with the last waypoint of the previous chunk
+        size_t startindex; ///< the index of the first waypoint of the chunk in the streaming trajectory
+        dReal starttime, endtime; ///< the time range of the chunk in the streaming trajectory
+    };
+
+    static const int s_numblocks = 32; ///< the chunks are stored in blocks of increasing size, block k holds s_blocksize<<k chunks
+    static const size_t s_blocksize = 16;
+
+public:
+    StreamingTrajectory(EnvironmentBasePtr penv, std::istream& sinput) : TrajectoryBase(penv), _timeoffset(-1), _numchunks(0), _bFinished(false), _bInit(false)
+    {
+        for(int i = 0; i < s_numblocks; ++i) {
+            _vblocks[i].store(NULL);
+        }
+        RegisterCommand("SetFinished",boost::bind(&StreamingTrajectory::_SetFinishedCommand,this,_1,_2),
+                        "\"0/1\", if 1, no more waypoints will be appended, so controllers following the trajectory can stop at its end. Init resets it to 0.");
+        RegisterCommand("IsFinished",boost::bind(&StreamingTrajectory::_IsFinishedCommand,this,_1,_2),
+                        "returns 1 if SetFinished was called, otherwise 0.");
+    }
+
+    virtual ~StreamingTrajectory()
+    {
+        _Reset();
+    }
+
+    void Init(const ConfigurationSpecification& spec)
+    {
+        _Reset();
+        _spec = spec;
+        _timeoffset = -1;
+        FOREACH(itgroup,_spec._vgroups) {
+            if( itgroup->name == "deltatime" ) {
+                _timeoffset = itgroup->offset;
+            }
+        }
+        _bFinished = false;
+        _bInit = true;
+    }
+
+    void Insert(size_t index, const std::vector<dReal>& data, bool bOverwrite)
+    {
+        BOOST_ASSERT(_bInit);
+        if( data.size() == 0 ) {
+            return;
+        }
+        OPENRAVE_ASSERT_OP_FORMAT((int)data.size()%_spec.GetDOF(),==,0, "%d does not divide dof %d", data.size()%_spec.GetDOF(), ORE_InvalidArguments);
+        size_t numwaypoints = GetNumWaypoints();
+        if( index != numwaypoints || bOverwrite ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("streaming trajectory can only append waypoints at index %d, got index %d"), numwaypoints%index, ORE_NotImplemented);
+        }
+        _AppendChunk(data);
+    }
+
+    void Insert(size_t index, const std::vector<dReal>& data, const ConfigurationSpecification& spec, bool bOverwrite)
+    {
+        BOOST_ASSERT(_bInit);
+        if( data.size() == 0 ) {
+            return;
+        }
+        OPENRAVE_ASSERT_OP_FORMAT((int)data.size()%spec.GetDOF(),==,0, "%d does not divide dof %d", data.size()%spec.GetDOF(), ORE_InvalidArguments);
+        size_t numpoints = data.size()/spec.GetDOF();
+        _vconverteddata.resize(numpoints*_spec.GetDOF());
+        std::fill(_vconverteddata.begin(), _vconverteddata.end(), 0);
+        ConfigurationSpecification::ConvertData(_vconverteddata.begin(), _spec, data.begin(), spec, numpoints, GetEnv());
+        Insert(index, _vconverteddata, bOverwrite);
+    }
+
+    void Remove(size_t startindex, size_t endindex)
+    {
+        throw OPENRAVE_EXCEPTION_FORMAT0(_("cannot remove waypoints from a streaming trajectory"), ORE_NotImplemented);
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time) const
+    {
+        BOOST_ASSERT(_bInit);
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        OPENRAVE_ASSERT_OP_FORMAT0(numchunks,>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        const Chunk& chunk = _GetChunk(_FindChunkFromTime(time, numchunks));
+        chunk.traj->Sample(data, time - chunk.starttime);
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, bool reintializeData) const
+    {
+        BOOST_ASSERT(_bInit);
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        OPENRAVE_ASSERT_OP_FORMAT0(numchunks,>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        const Chunk& chunk = _GetChunk(_FindChunkFromTime(time, numchunks));
+        chunk.traj->Sample(data, time - chunk.starttime, spec, reintializeData);
+    }
+
+    void SampleWithHint(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, size_t& waypointhint) const
+    {
+        BOOST_ASSERT(_bInit);
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        OPENRAVE_ASSERT_OP_FORMAT0(numchunks,>,0, "trajectory needs at least one point to sample from", ORE_InvalidArguments);
+        // the hint is the waypoint index in the streaming trajectory, so start from its chunk and move forward
+        size_t ichunk = _FindChunkFromIndex(waypointhint, numchunks);
+        if( _GetChunk(ichunk).starttime > time ) {
+            ichunk = _FindChunkFromTime(time, numchunks);
+        }
+        else {
+            while( ichunk+1 < numchunks && _GetChunk(ichunk).endtime < time ) {
+                ++ichunk;
+            }
+        }
+        const Chunk& chunk = _GetChunk(ichunk);
+        // the first waypoint of all chunks except the first one belongs to the previous chunk
+        size_t firstlocalindex = ichunk > 0 ? 1 : 0;
+        size_t localhint = waypointhint+firstlocalindex > chunk.startindex ? waypointhint+firstlocalindex-chunk.startindex : 0;
+        chunk.traj->SampleWithHint(data, time - chunk.starttime, spec, localhint);
+        waypointhint = chunk.startindex + localhint - std::min(localhint, firstlocalindex);
+    }
+
+    const ConfigurationSpecification& GetConfigurationSpecification() const
+    {
+        return _spec;
+    }
+
+    size_t GetNumWaypoints() const
+    {
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        if( numchunks == 0 ) {
+            return 0;
+        }
+        const Chunk& chunk = _GetChunk(numchunks-1);
+        return chunk.startindex + chunk.traj->GetNumWaypoints() - (numchunks > 1 ? 1 : 0);
+    }
+
+    void GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data) const
+    {
+        BOOST_ASSERT(_bInit);
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        int dof = _spec.GetDOF();
+        data.resize(0);
+        if( startindex >= endindex ) {
+            return;
+        }
+        data.reserve((endindex-startindex)*dof);
+        for(size_t ichunk = _FindChunkFromIndex(startindex, numchunks); ichunk < numchunks && startindex < endindex; ++ichunk) {
+            const Chunk& chunk = _GetChunk(ichunk);
+            // the first waypoint of all chunks except the first one belongs to the previous chunk
+            size_t firstlocalindex = ichunk > 0 ? 1 : 0;
+            size_t chunkendindex = chunk.startindex + chunk.traj->GetNumWaypoints() - firstlocalindex;
+            size_t copyendindex = min(endindex, chunkendindex);
+            chunk.traj->GetWaypoints(startindex-chunk.startindex+firstlocalindex, copyendindex-chunk.startindex+firstlocalindex, _vtempdata);
+            data.insert(data.end(), _vtempdata.begin(), _vtempdata.end());
+            startindex = copyendindex;
+        }
+        OPENRAVE_ASSERT_OP_FORMAT0(startindex,==,endindex, "waypoints are out of range", ORE_InvalidArguments);
+    }
+
+    size_t GetFirstWaypointIndexAfterTime(dReal time) const
+    {
+        BOOST_ASSERT(_bInit);
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        if( numchunks == 0 ) {
+            return 0;
+        }
+        size_t ichunk = _FindChunkFromTime(time, numchunks);
+        if( time >= _GetChunk(numchunks-1).endtime ) {
+            return GetNumWaypoints();
+        }
+        const Chunk& chunk = _GetChunk(ichunk);
+        size_t localindex = chunk.traj->GetFirstWaypointIndexAfterTime(time - chunk.starttime);
+        if( ichunk > 0 ) {
+            // the first waypoint of the chunk is the last waypoint of the previous chunk
+            return localindex > 0 ? chunk.startindex + localindex - 1 : chunk.startindex - 1;
+        }
+        return localindex;
+    }
+
+    dReal GetDuration() const
+    {
+        size_t numchunks = _numchunks.load(std::memory_order_acquire);
+        return numchunks > 0 ? _GetChunk(numchunks-1).endtime : 0;
+    }
+
+    void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    {
+        InterfaceBase::Clone(preference,cloningoptions);
+        TrajectoryBaseConstPtr r = RaveInterfaceConstCast<TrajectoryBase>(preference);
+        Init(r->GetConfigurationSpecification());
+        std::vector<dReal> data;
+        r->GetWaypoints(0,r->GetNumWaypoints(),data);
+        Insert(0, data, false);
+        boost::shared_ptr<StreamingTrajectory const> rstreaming = boost::dynamic_pointer_cast<StreamingTrajectory const>(r);
+        if( !!rstreaming ) {
+            _bFinished = rstreaming->_bFinished.load();
+        }
+    }
+
+protected:
+    /// \brief creates the chunk for the waypoints and publishes it. Only called by the thread that appends
+    void _AppendChunk(const std::vector<dReal>& data)
+    {
+        size_t numchunks = _numchunks.load(std::memory_order_relaxed);
+        Chunk chunk;
+        std::stringstream ss;
+        chunk.traj = CreateGenericTrajectory(GetEnv(), ss);
+        chunk.traj->Init(_spec);
+        if( numchunks > 0 ) {
+            const Chunk& prevchunk = _GetChunk(numchunks-1);
+            size_t prevnumwaypoints = prevchunk.traj->GetNumWaypoints();
+            prevchunk.traj->GetWaypoints(prevnumwaypoints-1, prevnumwaypoints, _vprevwaypoint);
+            if( _timeoffset >= 0 ) {
+                _vprevwaypoint.at(_timeoffset) = 0;
+            }
+            chunk.traj->Insert(0, _vprevwaypoint);
+            chunk.startindex = prevchunk.startindex + prevnumwaypoints - (numchunks > 1 ? 1 : 0);
+            chunk.starttime = prevchunk.endtime;
+        }
+        chunk.traj->Insert(chunk.traj->GetNumWaypoints(), data);
+        // also computes the internal sampling data of the chunk, so the sampling thread never has to change it
+        chunk.endtime = chunk.starttime + (_timeoffset >= 0 ? chunk.traj->GetDuration() : 0);
+
+        size_t blockindex, indexinblock;
+        _GetBlockIndex(numchunks, blockindex, indexinblock);
+        if( blockindex >= (size_t)s_numblocks ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("streaming trajectory cannot hold more than %d chunks"), numchunks, ORE_InvalidState);
+        }
+        Chunk* pblock = _vblocks[blockindex].load(std::memory_order_relaxed);
+        if( !pblock ) {
+            pblock = new Chunk[s_blocksize<<blockindex];
+            _vblocks[blockindex].store(pblock, std::memory_order_release);
+        }
+        pblock[indexinblock] = chunk;
+        _numchunks.store(numchunks+1, std::memory_order_release);
+    }
+
+    /// \brief removes all chunks
+    void _Reset()
+    {
+        _numchunks.store(0);
+        for(int i = 0; i < s_numblocks; ++i) {
+            delete[] _vblocks[i].exchange(NULL);
+        }
+    }
+
+    inline static void _GetBlockIndex(size_t ichunk, size_t& blockindex, size_t& indexinblock)
+    {
+        blockindex = 0;
+        indexinblock = ichunk;
+        while( indexinblock >= (s_blocksize<<blockindex) ) {
+            indexinblock -= s_blocksize<<blockindex;
+            ++blockindex;
+        }
+    }
+
+    inline const Chunk& _GetChunk(size_t ichunk) const
+    {
+        size_t blockindex, indexinblock;
+        _GetBlockIndex(ichunk, blockindex, indexinblock);
+        return _vblocks[blockindex].load(std::memory_order_acquire)[indexinblock];
+    }
+
+    /// \brief returns the first chunk whose end time is >= time, or the last chunk
+    size_t _FindChunkFromTime(dReal time, size_t numchunks) const
+    {
+        size_t low = 0, high = numchunks-1;
+        while( low < high ) {
+            size_t mid = (low+high)/2;
+            if( _GetChunk(mid).endtime < time ) {
+                low = mid+1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    /// \brief returns the chunk that holds the waypoint index
+    size_t _FindChunkFromIndex(size_t index, size_t numchunks) const
+    {
+        if( numchunks == 0 ) {
+            return 0;
+        }
+        size_t low = 0, high = numchunks-1;
+        while( low < high ) {
+            size_t mid = (low+high+1)/2;
+            if( _GetChunk(mid).startindex <= index ) {
+                low = mid;
+            }
+            else {
+                high = mid-1;
+            }
+        }
+        return low;
+    }
+
+    bool _SetFinishedCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int finished = 1;
+        sinput >> finished;
+        _bFinished = finished != 0;
+        return true;
+    }
+
+    bool _IsFinishedCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sout << (int)_bFinished.load();
+        return true;
+    }
+
+    ConfigurationSpecification _spec;
+    int _timeoffset;
+    std::atomic<Chunk*> _vblocks[s_numblocks]; ///< the blocks of chunks, allocated when needed
+    std::atomic<size_t> _numchunks; ///< the number of published chunks
+    std::atomic<bool> _bFinished; ///< true if no more waypoints will be appended
+    bool _bInit;
+    mutable std::vector<dReal> _vtempdata; ///< cache of the sampling thread
+    std::vector<dReal> _vconverteddata, _vprevwaypoint; ///< caches of the appending thread
+};
+
+TrajectoryBasePtr CreateStreamingTrajectory(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return TrajectoryBasePtr(new StreamingTrajectory(penv,sinput));
+}
+
+}
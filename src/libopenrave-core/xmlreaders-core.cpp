@@ -764,53 +764,444 @@ protected:
     boost::shared_ptr<BaseXMLReader> _pcurreader;
 };
 
-class LinkXMLReader : public StreamXMLReader
+/// \brief imports the geometries of a mesh file, appending them to listGeometries
+static bool _CreateGeometriesFromFile(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries)
+{
+    string extension;
+    if( filename.find_last_of('.') != string::npos ) {
+        extension = filename.substr(filename.find_last_of('.')+1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    }
+
+#ifdef OPENRAVE_ASSIMP
+    // assimp doesn't support vrml/iv, so don't waste time
+    if( extension != "iv" && extension != "wrl" && extension != "vrml" ) {
+        //Assimp::DefaultLogger::get()->setLogSeverity(Assimp::Logger::Debugging);
+        {
+            aiSceneManaged scene(filename);
+            if( !!scene._scene && !!scene._scene->mRootNode && !!scene._scene->HasMeshes() ) {
+                if( _AssimpCreateGeometries(scene._scene,scene._scene->mRootNode, vscale, listGeometries) ) {
+                    return true;
+                }
+            }
+        }
+        if( extension == "stl" || extension == "x") {
+            if( extension == "stl" ) {
+                if( _ParseSpecialSTLFile(penv, filename, vscale, listGeometries) ) {
+                    return true;
+                }
+                RAVELOG_WARN_FORMAT("failed to load STL file %s. If it is in binary format, make sure the first 5 characters of the file are not 'solid'!", filename);
+            }
+            return false;
+        }
+    }
+#endif
+
+    // for other importers, just convert into one big trimesh
+    listGeometries.push_back(KinBody::GeometryInfo());
+    KinBody::GeometryInfo& g = listGeometries.back();
+    g._type = GT_TriMesh;
+    g._vDiffuseColor=Vector(1,0.5f,0.5f,1);
+    g._vAmbientColor=Vector(0.1,0.0f,0.0f,0);
+    g._vRenderScale = vscale;
+    if( !CreateTriMeshFromFile(penv,filename,vscale,g._meshcollision,g._vDiffuseColor,g._vAmbientColor,g._fTransparency) ) {
+        return false;
+    }
+    return true;
+}
+
+/// \brief imports mesh files on worker threads ahead of the parser and imports every mesh file only once, see MeshImportScope
+///
+/// Worker threads only use assimp since the other importers are not thread safe. Files assimp cannot import are imported by
+/// the parser thread when it needs them.
+class MeshImportCache
 {
 public:
+    MeshImportCache() : _bShutdown(false) {
+    }
+    virtual ~MeshImportCache() {
+        Shutdown();
+    }
 
-    static bool CreateGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries)
+    /// \brief queues the import of the mesh file if it was not requested before
+    void Prefetch(const std::string& filename, const Vector& vscale)
     {
+#ifdef OPENRAVE_ASSIMP
         string extension;
         if( filename.find_last_of('.') != string::npos ) {
             extension = filename.substr(filename.find_last_of('.')+1);
             std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
         }
+        if( extension == "iv" || extension == "wrl" || extension == "vrml" ) {
+            return;
+        }
+        ImportKey key(filename, _GetScaleKey(vscale));
+        boost::mutex::scoped_lock lock(_mutex);
+        if( _mapEntries.find(key) == _mapEntries.end() ) {
+            ImportEntryPtr entry(new ImportEntry());
+            entry->filename = filename;
+            entry->vscale = vscale;
+            _mapEntries[key] = entry;
+            _listQueue.push_back(entry);
+        }
+#endif
+    }
 
-#ifdef OPENRAVE_ASSIMP
-        // assimp doesn't support vrml/iv, so don't waste time
-        if( extension != "iv" && extension != "wrl" && extension != "vrml" ) {
-            //Assimp::DefaultLogger::get()->setLogSeverity(Assimp::Logger::Debugging);
+    /// \brief starts the worker threads on the queued imports
+    void StartWorkers()
+    {
+        size_t numthreads = std::max(1u, boost::thread::hardware_concurrency());
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            numthreads = std::min(numthreads, _listQueue.size());
+        }
+        while( _threads.size() < numthreads ) {
+            _threads.create_thread(boost::bind(&MeshImportCache::_WorkerThread, this));
+        }
+    }
+
+    /// \brief appends the geometries of the mesh file to listGeometries, waits for the import if it is running on a worker thread
+    bool GetGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries)
+    {
+        ImportKey key(filename, _GetScaleKey(vscale));
+        ImportEntryPtr entry;
+        bool bImport = false;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            std::map<ImportKey, ImportEntryPtr>::iterator itentry = _mapEntries.find(key);
+            if( itentry == _mapEntries.end() ) {
+                entry.reset(new ImportEntry());
+                entry->filename = filename;
+                entry->vscale = vscale;
+                entry->state = IS_Running;
+                _mapEntries[key] = entry;
+                bImport = true;
+            }
+            else {
+                entry = itentry->second;
+                if( entry->state == IS_Queued ) {
+                    // the parser caught up with the workers, so import it here
+                    entry->state = IS_Running;
+                    bImport = true;
+                }
+                else {
+                    while( entry->state != IS_Done ) {
+                        _condition.wait(lock);
+                    }
+                    if( !entry->bSuccess && entry->bAssimpOnly ) {
+                        // worker failed with assimp, so try all the importers
+                        entry->state = IS_Running;
+                        bImport = true;
+                    }
+                }
+            }
+        }
+
+        if( bImport ) {
+            std::list<KinBody::GeometryInfo> listNewGeometries;
+            bool bSuccess = _CreateGeometriesFromFile(penv, filename, vscale, listNewGeometries);
+            boost::mutex::scoped_lock lock(_mutex);
+            entry->listGeometries.swap(listNewGeometries);
+            entry->bSuccess = bSuccess;
+            entry->bAssimpOnly = false;
+            entry->state = IS_Done;
+        }
+        if( !entry->bSuccess ) {
+            return false;
+        }
+        listGeometries.insert(listGeometries.end(), entry->listGeometries.begin(), entry->listGeometries.end());
+        return true;
+    }
+
+    /// \brief drops the queued imports and waits for the running ones
+    void Shutdown()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+            _listQueue.clear();
+        }
+        _threads.join_all();
+    }
+
+private:
+    enum ImportState {
+        IS_Queued=0,
+        IS_Running=1,
+        IS_Done=2,
+    };
+
+    struct ImportEntry
+    {
+        ImportEntry() : state(IS_Queued), bSuccess(false), bAssimpOnly(false) {
+        }
+        std::string filename;
+        Vector vscale;
+        ImportState state;
+        bool bSuccess;
+        bool bAssimpOnly; ///< true if imported by a worker thread
+        std::list<KinBody::GeometryInfo> listGeometries;
+    };
+    typedef boost::shared_ptr<ImportEntry> ImportEntryPtr;
+    typedef std::pair<std::string, boost::array<dReal, 3> > ImportKey;
+
+    static boost::array<dReal, 3> _GetScaleKey(const Vector& vscale)
+    {
+        boost::array<dReal, 3> scalekey = { { vscale.x, vscale.y, vscale.z } };
+        return scalekey;
+    }
+
+    void _WorkerThread()
+    {
+        while(1) {
+            ImportEntryPtr entry;
             {
-                aiSceneManaged scene(filename);
+                boost::mutex::scoped_lock lock(_mutex);
+                while( _listQueue.size() > 0 && _listQueue.front()->state != IS_Queued ) {
+                    _listQueue.pop_front();
+                }
+                if( _bShutdown || _listQueue.size() == 0 ) {
+                    return;
+                }
+                entry = _listQueue.front();
+                _listQueue.pop_front();
+                entry->state = IS_Running;
+            }
+
+            std::list<KinBody::GeometryInfo> listNewGeometries;
+            bool bSuccess = false;
+#ifdef OPENRAVE_ASSIMP
+            try {
+                aiSceneManaged scene(entry->filename);
                 if( !!scene._scene && !!scene._scene->mRootNode && !!scene._scene->HasMeshes() ) {
-                    if( _AssimpCreateGeometries(scene._scene,scene._scene->mRootNode, vscale, listGeometries) ) {
-                        return true;
-                    }
+                    bSuccess = _AssimpCreateGeometries(scene._scene,scene._scene->mRootNode, entry->vscale, listNewGeometries);
                 }
             }
-            if( extension == "stl" || extension == "x") {
-                if( extension == "stl" ) {
-                    if( _ParseSpecialSTLFile(penv, filename, vscale, listGeometries) ) {
-                        return true;
+            catch(const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("failed to import %s: %s", entry->filename%ex.what());
+                bSuccess = false;
+            }
+#endif
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                if( bSuccess ) {
+                    entry->listGeometries.swap(listNewGeometries);
+                }
+                entry->bSuccess = bSuccess;
+                entry->bAssimpOnly = true;
+                entry->state = IS_Done;
+            }
+            _condition.notify_all();
+        }
+    }
+
+    std::map<ImportKey, ImportEntryPtr> _mapEntries; ///< all the requested imports
+    std::list<ImportEntryPtr> _listQueue; ///< imports for the workers, entries taken by the parser are skipped
+    boost::thread_group _threads;
+    boost::mutex _mutex; ///< protects _mapEntries, _listQueue and the entries
+    boost::condition_variable _condition; ///< notified when an entry is done
+    bool _bShutdown;
+};
+
+typedef boost::shared_ptr<MeshImportCache> MeshImportCachePtr;
+
+/// \brief the cache of the outermost MeshImportScope, protected by GetXMLMutex
+static MeshImportCachePtr& GetMeshImportCache()
+{
+    static MeshImportCachePtr s_pcache;
+    return s_pcache;
+}
+
+/// \brief collects the mesh files referenced by an OpenRAVE XML file and its included files without creating any interfaces
+///
+/// Mesh filenames are resolved like KinBodyXMLReader::GetModelsDir, meshes that resolve differently are just imported when the parser reaches them.
+class MeshPrefetchXMLReader : public BaseXMLReader
+{
+public:
+    MeshPrefetchXMLReader(MeshImportCachePtr pcache) : _pcache(pcache), _bInTriMesh(false) {
+    }
+
+    virtual ProcessElement startElement(const std::string& xmlname, const AttributesList& atts)
+    {
+        _ss.str(std::string());
+        _ss.clear();
+        if( xmlname == "kinbody" || xmlname == "robot" ) {
+            _vmodelsdirs.push_back(std::string());
+        }
+        if( xmlname == "kinbody" || xmlname == "robot" || xmlname == "body" || xmlname == "environment" ) {
+            FOREACHC(itatt, atts) {
+                if( itatt->first == "file" ) {
+                    string filedata = RaveFindLocalFile(itatt->second,GetParseDirectory());
+                    size_t len = filedata.size();
+                    if( len >= 4 && filedata[len-4] == '.' && ::tolower(filedata[len-3]) == 'x' && ::tolower(filedata[len-2]) == 'm' && ::tolower(filedata[len-1]) == 'l' ) {
+                        ParseXMLFile(BaseXMLReaderPtr(new MeshPrefetchXMLReader(_pcache)), filedata);
                     }
-                    RAVELOG_WARN_FORMAT("failed to load STL file %s. If it is in binary format, make sure the first 5 characters of the file are not 'solid'!", filename);
                 }
-                return false;
             }
         }
+        else if( xmlname == "geom" || xmlname == "geometry" ) {
+            _bInTriMesh = false;
+            bool bSelfGroup = true;
+            FOREACHC(itatt, atts) {
+                if( itatt->first == "type" ) {
+                    _bInTriMesh = _stricmp(itatt->second.c_str(), "trimesh") == 0;
+                }
+                else if( itatt->first == "group" && !itatt->second.empty() ) {
+                    bSelfGroup = itatt->second == "self";
+                }
+            }
+            // meshes of the other geometry groups are only loaded when the group is requested
+            _bInTriMesh &= bSelfGroup;
+            _filenamerender.resize(0);
+            _filenamecollision.resize(0);
+        }
+        else if( _bInTriMesh && (xmlname == "render" || xmlname == "collision") ) {
+            std::string& filename = xmlname == "render" ? _filenamerender : _filenamecollision;
+            Vector& vscale = xmlname == "render" ? _vRenderScale : _vCollisionScale;
+            FOREACHC(itatt, atts) {
+                if( itatt->first == "file" ) {
+                    filename = itatt->second;
+                }
+                else if( itatt->first == "scale" ) {
+                    vscale = Vector(1,1,1);
+                    stringstream sslocal(itatt->second);
+                    sslocal >> vscale.x; vscale.y = vscale.z = vscale.x;
+                    sslocal >> vscale.y >> vscale.z;
+                }
+            }
+        }
+        return PE_Support;
+    }
+
+    virtual bool endElement(const std::string& xmlname)
+    {
+        if( _bInTriMesh ) {
+            if( xmlname == "render" && _filenamerender.size() == 0 ) {
+                _ParseFilename(_filenamerender, _vRenderScale);
+            }
+            else if( (xmlname == "data" || xmlname == "collision") && _filenamecollision.size() == 0 ) {
+                _ParseFilename(_filenamecollision, _vCollisionScale);
+            }
+            else if( xmlname == "geom" || xmlname == "geometry" ) {
+                // the parser imports the collision file first and only falls back to the render file
+                if( _filenamecollision.size() > 0 ) {
+                    _Prefetch(_filenamecollision, _vCollisionScale);
+                }
+                else if( _filenamerender.size() > 0 ) {
+                    _Prefetch(_filenamerender, _vRenderScale);
+                }
+                _bInTriMesh = false;
+            }
+        }
+        if( xmlname == "modelsdir" && _vmodelsdirs.size() > 0 ) {
+            _vmodelsdirs.back() = _ss.str();
+            boost::trim(_vmodelsdirs.back());
+            _vmodelsdirs.back() += "/";
+        }
+        else if( (xmlname == "kinbody" || xmlname == "robot") && _vmodelsdirs.size() > 0 ) {
+            _vmodelsdirs.pop_back();
+        }
+        _ss.str(std::string());
+        _ss.clear();
+        return false;
+    }
+
+    virtual void characters(const std::string& ch)
+    {
+        _ss << ch;
+    }
+
+protected:
+    void _ParseFilename(std::string& filename, Vector& vscale)
+    {
+        vscale = Vector(1,1,1);
+        _ss >> filename;
+        _ss >> vscale.x; vscale.y = vscale.z = vscale.x;
+        _ss >> vscale.y >> vscale.z;
+    }
+
+    void _Prefetch(const std::string& filename, const Vector& vscale)
+    {
+        std::string fullfilename;
+#ifdef _WIN32
+        if( filename.find_first_of(':') != string::npos ) {
+            fullfilename = filename;
+        }
+#else
+        if( filename[0] == '/' ) {
+            fullfilename = filename;
+        }
+#endif
+        if( fullfilename.size() == 0 && _vmodelsdirs.size() > 0 && _vmodelsdirs.back().size() > 0 ) {
+            string s = GetParseDirectory();
+            if( s.size() > 0 ) {
+                s += s_filesep;
+            }
+            s += _vmodelsdirs.back();
+            fullfilename = RaveFindLocalFile(filename, s);
+        }
+        if( fullfilename.size() == 0 ) {
+            fullfilename = RaveFindLocalFile(filename, GetParseDirectory());
+        }
+        if( fullfilename.size() > 0 ) {
+            _pcache->Prefetch(fullfilename, vscale);
+        }
+    }
+
+    MeshImportCachePtr _pcache;
+    stringstream _ss;
+    std::vector<std::string> _vmodelsdirs; ///< the modelsdir of every kinbody being read
+    bool _bInTriMesh;
+    std::string _filenamerender, _filenamecollision;
+    Vector _vRenderScale, _vCollisionScale;
+};
+
+MeshImportScope::MeshImportScope(const std::string& filename) : _lock(*GetXMLMutex()), _bOwner(false)
+{
+    if( !!GetMeshImportCache() ) {
+        // the outermost scope already collected the meshes of the included files
+        return;
+    }
+    _bOwner = true;
+    MeshImportCachePtr pcache(new MeshImportCache());
+    GetMeshImportCache() = pcache;
+#ifdef OPENRAVE_ASSIMP
+    // only assimp imports on the worker threads, so without it there is nothing to collect
+    int nerrorcount = GetXMLErrorCount();
+    try {
+        ParseXMLFile(BaseXMLReaderPtr(new MeshPrefetchXMLReader(pcache)), filename);
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_DEBUG_FORMAT("failed to collect the meshes of %s: %s", filename%ex.what());
+    }
+    // the file is parsed again, so do not count its errors twice
+    GetXMLErrorCount() = nerrorcount;
+    pcache->StartWorkers();
 #endif
+}
 
-        // for other importers, just convert into one big trimesh
-        listGeometries.push_back(KinBody::GeometryInfo());
-        KinBody::GeometryInfo& g = listGeometries.back();
-        g._type = GT_TriMesh;
-        g._vDiffuseColor=Vector(1,0.5f,0.5f,1);
-        g._vAmbientColor=Vector(0.1,0.0f,0.0f,0);
-        g._vRenderScale = vscale;
-        if( !CreateTriMeshFromFile(penv,filename,vscale,g._meshcollision,g._vDiffuseColor,g._vAmbientColor,g._fTransparency) ) {
-            return false;
+MeshImportScope::~MeshImportScope()
+{
+    if( _bOwner ) {
+        MeshImportCachePtr pcache = GetMeshImportCache();
+        GetMeshImportCache().reset();
+        if( !!pcache ) {
+            pcache->Shutdown();
         }
-        return true;
+    }
+}
+
+class LinkXMLReader : public StreamXMLReader
+{
+public:
+
+    static bool CreateGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries)
+    {
+        MeshImportCachePtr pcache = GetMeshImportCache();
+        if( !!pcache ) {
+            return pcache->GetGeometries(penv, filename, vscale, listGeometries);
+        }
+        return _CreateGeometriesFromFile(penv, filename, vscale, listGeometries);
     }
 
     LinkXMLReader(KinBody::LinkPtr& plink, KinBodyPtr pparent, const AttributesList &atts) : _plink(plink) {
@@ -968,9 +1359,15 @@ public:
                 if( !!geomreader ) {
                     KinBody::GeometryInfoPtr info = geomreader->GetGeometryInfo();
 
-                    // geometry is not in the default group, so we add it to the LinkInfo without instantiating it
+                    // geometry is not in the default group, so we add it to the LinkInfo without instantiating it.
+                    // trimeshes keep only their resolved file names and are loaded when the group is first requested, see KinBody::Link::GetGeometriesFromGroup
                     string groupname = geomreader->GetGroupName();
                     if( groupname != "self" ) {
+                        if( info->_type == GT_TriMesh && !!_fnGetModelsDir ) {
+                            bool bsame = info->_filenamerender == info->_filenamecollision;
+                            info->_filenamerender = _fnGetModelsDir(info->_filenamerender);
+                            info->_filenamecollision = bsame ? info->_filenamerender : _fnGetModelsDir(info->_filenamecollision);
+                        }
                         _plink->_info._mapExtraGeometries[groupname].push_back(info);
                         _pcurreader.reset();
                         return false;
@@ -1328,7 +1725,7 @@ private:
 
 bool CreateGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector &vscale, std::list<KinBody::GeometryInfo>& listGeometries)
 {
-    return LinkXMLReader::CreateGeometries(penv,filename,vscale,listGeometries);
+    return _CreateGeometriesFromFile(penv,filename,vscale,listGeometries);
 }
 
 // Joint Reader
@@ -1366,401 +1366,487 @@ static void ConvertDOFRotation_QuatFrom3D(std::vector<dReal>::iterator ittarget,
     *(ittarget+3) = quat[3];
 }
 
-void ConfigurationSpecification::ConvertGroupData(std::vector<dReal>::iterator ittargetdata, size_t targetstride, const ConfigurationSpecification::Group& gtarget, std::vector<dReal>::const_iterator itsourcedata, size_t sourcestride, const ConfigurationSpecification::Group& gsource, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+ConfigurationSpecification::Converter::Converter() : _targetstride(0), _sourcestride(0), _bInit(false), _bEnvironmentDefaults(false)
+{
+}
+
+ConfigurationSpecification::Converter::Converter(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, EnvironmentBaseConstPtr penv, bool filluninitialized) : _targetstride(0), _sourcestride(0), _bInit(false), _bEnvironmentDefaults(false)
+{
+    Init(targetspec, sourcespec, penv, filluninitialized);
+}
+
+void ConfigurationSpecification::Converter::Init(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, EnvironmentBaseConstPtr penv, bool filluninitialized)
 {
+    _Reset(targetspec.GetDOF(), sourcespec.GetDOF());
+    for(size_t igroup = 0; igroup < targetspec._vgroups.size(); ++igroup) {
+        const ConfigurationSpecification::Group& gtarget = targetspec._vgroups[igroup];
+        std::vector<ConfigurationSpecification::Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(gtarget);
+        if( itcompatgroup != sourcespec._vgroups.end() ) {
+            _AddGroup(gtarget.offset, gtarget, itcompatgroup->offset, *itcompatgroup, penv, filluninitialized);
+        }
+        else if( filluninitialized ) {
+            vector<dReal> vdefaultvalues(gtarget.dof,0);
+            const string& name = gtarget.name;
+            if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
+                string bodyname;
+                stringstream ss(name.substr(12));
+                ss >> bodyname;
+                if( !!ss ) {
+                    if( !!penv ) {
+                        _bEnvironmentDefaults = true;
+                        KinBodyPtr body = penv->GetKinBody(bodyname);
+                        if( !!body ) {
+                            vector<dReal> values;
+                            body->GetDOFValues(values);
+                            std::vector<int> indices((istream_iterator<int>(ss)), istream_iterator<int>());
+                            for(size_t i = 0; i < indices.size(); ++i) {
+                                vdefaultvalues.at(i) = values.at(indices[i]);
+                            }
+                        }
+                    }
+                }
+            }
+            else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
+                string bodyname;
+                int affinedofs;
+                stringstream ss(name.substr(16));
+                ss >> bodyname >> affinedofs;
+                if( !!ss ) {
+                    Transform tdefault;
+                    if( !!penv ) {
+                        _bEnvironmentDefaults = true;
+                        KinBodyPtr body = penv->GetKinBody(bodyname);
+                        if( !!body ) {
+                            tdefault = body->GetTransform();
+                        }
+                    }
+                    BOOST_ASSERT((int)vdefaultvalues.size() == RaveGetAffineDOF(affinedofs));
+                    RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),tdefault,affinedofs);
+                }
+            }
+            else if( name.size() >= 13 && name.substr(0,13) == "outputSignals") {
+                std::fill(vdefaultvalues.begin(), vdefaultvalues.end(), -1);
+            }
+            else if( name != "deltatime" ) {
+                // messages are too frequent
+                //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+            }
+            for(size_t j = 0; j < vdefaultvalues.size(); ++j) {
+                _AddFill(gtarget.offset+j, vdefaultvalues[j]);
+            }
+        }
+    }
+    _bInit = true;
+}
+
+void ConfigurationSpecification::Converter::Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints) const
+{
+    BOOST_ASSERT(_bInit);
     if( numpoints > 1 ) {
-        BOOST_ASSERT(targetstride != 0 && sourcestride != 0 );
+        BOOST_ASSERT(_targetstride != 0 && _sourcestride != 0 );
+    }
+    for(size_t i = 0; i < numpoints; ++i) {
+        if( i != 0 ) {
+            itsourcedata += _sourcestride;
+            ittargetdata += _targetstride;
+        }
+        FOREACHC(itrun, _vcopyruns) {
+            std::copy(itsourcedata+itrun->sourceoffset, itsourcedata+itrun->sourceoffset+itrun->dof, ittargetdata+itrun->targetoffset);
+        }
+        FOREACHC(itrun, _vfillruns) {
+            std::copy(_vfillvalues.begin()+itrun->sourceoffset, _vfillvalues.begin()+itrun->sourceoffset+itrun->dof, ittargetdata+itrun->targetoffset);
+        }
+        FOREACHC(itrotation, _vrotationconversions) {
+            itrotation->converterfn(ittargetdata+itrotation->targetoffset, itsourcedata+itrotation->sourceoffset);
+        }
     }
+}
+
+void ConfigurationSpecification::Converter::_Reset(size_t targetstride, size_t sourcestride)
+{
+    _vcopyruns.resize(0);
+    _vfillruns.resize(0);
+    _vfillvalues.resize(0);
+    _vrotationconversions.resize(0);
+    _targetstride = targetstride;
+    _sourcestride = sourcestride;
+    _bInit = false;
+    _bEnvironmentDefaults = false;
+}
+
+void ConfigurationSpecification::Converter::_AddCopy(int targetindex, int sourceindex)
+{
+    if( _vcopyruns.size() > 0 ) {
+        CopyRun& run = _vcopyruns.back();
+        if( run.targetoffset+run.dof == targetindex && run.sourceoffset+run.dof == sourceindex ) {
+            ++run.dof;
+            return;
+        }
+    }
+    CopyRun run;
+    run.targetoffset = targetindex;
+    run.sourceoffset = sourceindex;
+    run.dof = 1;
+    _vcopyruns.push_back(run);
+}
+
+void ConfigurationSpecification::Converter::_AddFill(int targetindex, dReal value)
+{
+    _vfillvalues.push_back(value);
+    if( _vfillruns.size() > 0 ) {
+        CopyRun& run = _vfillruns.back();
+        if( run.targetoffset+run.dof == targetindex ) {
+            ++run.dof;
+            return;
+        }
+    }
+    CopyRun run;
+    run.targetoffset = targetindex;
+    run.sourceoffset = (int)_vfillvalues.size()-1;
+    run.dof = 1;
+    _vfillruns.push_back(run);
+}
+
+void ConfigurationSpecification::Converter::_AddGroup(int targetoffset, const ConfigurationSpecification::Group& gtarget, int sourceoffset, const ConfigurationSpecification::Group& gsource, EnvironmentBaseConstPtr penv, bool filluninitialized)
+{
     if( gsource.name == gtarget.name ) {
         BOOST_ASSERT(gsource.dof==gtarget.dof);
-        for(size_t i = 0; i < numpoints; ++i) {
-            if( i != 0 ) {
-                itsourcedata += sourcestride;
-                ittargetdata += targetstride;
-            }
-            std::copy(itsourcedata,itsourcedata+gsource.dof,ittargetdata);
+        for(int j = 0; j < gsource.dof; ++j) {
+            _AddCopy(targetoffset+j, sourceoffset+j);
         }
+        return;
     }
-    else {
-        stringstream ss(gtarget.name);
-        std::vector<std::string> targettokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
-        ss.clear();
-        ss.str(gsource.name);
-        std::vector<std::string> sourcetokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
-
-        BOOST_ASSERT(targettokens.at(0) == sourcetokens.at(0));
-        vector<int> vtransferindices; vtransferindices.reserve(gtarget.dof);
-        std::vector<dReal> vdefaultvalues;
-        if( targettokens.at(0).size() >= 6 && targettokens.at(0).substr(0,6) == "joint_") {
-            std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
-            if( (int)sourcetokens.size() < gsource.dof+2 ) {
-                RAVELOG_DEBUG(str(boost::format("source tokens '%s' do not have %d dof indices, guessing....")%gsource.name%gsource.dof));
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vsourceindices[i] = i;
-                }
+
+    stringstream ss(gtarget.name);
+    std::vector<std::string> targettokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+    ss.clear();
+    ss.str(gsource.name);
+    std::vector<std::string> sourcetokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+
+    BOOST_ASSERT(targettokens.at(0) == sourcetokens.at(0));
+    vector<int> vtransferindices; vtransferindices.reserve(gtarget.dof);
+    std::vector<dReal> vdefaultvalues;
+    if( targettokens.at(0).size() >= 6 && targettokens.at(0).substr(0,6) == "joint_") {
+        std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
+        if( (int)sourcetokens.size() < gsource.dof+2 ) {
+            RAVELOG_DEBUG(str(boost::format("source tokens '%s' do not have %d dof indices, guessing....")%gsource.name%gsource.dof));
+            for(int i = 0; i < gsource.dof; ++i) {
+                vsourceindices[i] = i;
             }
-            else {
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
-                }
+        }
+        else {
+            for(int i = 0; i < gsource.dof; ++i) {
+                vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
             }
-            if( (int)targettokens.size() < gtarget.dof+2 ) {
-                RAVELOG_WARN(str(boost::format("target tokens '%s' do not match dof '%d', guessing....")%gtarget.name%gtarget.dof));
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vtargetindices[i] = i;
-                }
+        }
+        if( (int)targettokens.size() < gtarget.dof+2 ) {
+            RAVELOG_WARN(str(boost::format("target tokens '%s' do not match dof '%d', guessing....")%gtarget.name%gtarget.dof));
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vtargetindices[i] = i;
             }
-            else {
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
-                }
+        }
+        else {
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
             }
+        }
 
-            bool bUninitializedData=false;
-            FOREACH(ittargetindex,vtargetindices) {
-                std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
-                if( it == vsourceindices.end() ) {
-                    bUninitializedData = true;
-                    vtransferindices.push_back(-1);
-                }
-                else {
-                    vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
-                }
+        bool bUninitializedData=false;
+        FOREACH(ittargetindex,vtargetindices) {
+            std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
+            if( it == vsourceindices.end() ) {
+                bUninitializedData = true;
+                vtransferindices.push_back(-1);
+            }
+            else {
+                vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
             }
+        }
 
-            if( bUninitializedData && filluninitialized ) {
-                KinBodyPtr pbody;
-                if( targettokens.size() > 1 ) {
-                    pbody = penv->GetKinBody(targettokens.at(1));
-                }
-                if( !pbody && sourcetokens.size() > 1 ) {
-                    pbody = penv->GetKinBody(sourcetokens.at(1));
+        if( bUninitializedData && filluninitialized ) {
+            _bEnvironmentDefaults = true;
+            KinBodyPtr pbody;
+            if( targettokens.size() > 1 ) {
+                pbody = penv->GetKinBody(targettokens.at(1));
+            }
+            if( !pbody && sourcetokens.size() > 1 ) {
+                pbody = penv->GetKinBody(sourcetokens.at(1));
+            }
+            if( !pbody ) {
+                RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
+                vdefaultvalues.resize(vtargetindices.size(),0);
+            }
+            else {
+                std::vector<dReal> vbodyvalues;
+                vdefaultvalues.resize(vtargetindices.size(),0);
+                if( targettokens[0] == "joint_values" ) {
+                    pbody->GetDOFValues(vbodyvalues);
                 }
-                if( !pbody ) {
-                    RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
-                    vdefaultvalues.resize(vtargetindices.size(),0);
+                else if( targettokens[0] == "joint_velocities" ) {
+                    pbody->GetDOFVelocities(vbodyvalues);
                 }
-                else {
-                    std::vector<dReal> vbodyvalues;
-                    vdefaultvalues.resize(vtargetindices.size(),0);
-                    if( targettokens[0] == "joint_values" ) {
-                        pbody->GetDOFValues(vbodyvalues);
-                    }
-                    else if( targettokens[0] == "joint_velocities" ) {
-                        pbody->GetDOFVelocities(vbodyvalues);
-                    }
-                    if( vbodyvalues.size() > 0 ) {
-                        for(size_t i = 0; i < vdefaultvalues.size(); ++i) {
-                            if( vtargetindices[i] >= 0 ) { // sometimes index can be -1 to indicate that no robot value is mapped. This is used when trying to preserve an output order of values
-                                vdefaultvalues[i] = vbodyvalues.at(vtargetindices[i]);
-                            }
+                if( vbodyvalues.size() > 0 ) {
+                    for(size_t i = 0; i < vdefaultvalues.size(); ++i) {
+                        if( vtargetindices[i] >= 0 ) { // sometimes index can be -1 to indicate that no robot value is mapped. This is used when trying to preserve an output order of values
+                            vdefaultvalues[i] = vbodyvalues.at(vtargetindices[i]);
                         }
                     }
                 }
             }
         }
-        else if( targettokens.at(0).size() >= 13 && targettokens.at(0).substr(0,13) == "outputSignals") {
-            std::vector<std::string> vSourceSignalNames(gsource.dof), vTargetSignalNames(gtarget.dof);
-            if( (int)sourcetokens.size() < gsource.dof+1 ) {
-                throw OPENRAVE_EXCEPTION_FORMAT("source tokens '%s' do not have %d dof indices, guessing....", gsource.name%gsource.dof, ORE_InvalidArguments);
+    }
+    else if( targettokens.at(0).size() >= 13 && targettokens.at(0).substr(0,13) == "outputSignals") {
+        std::vector<std::string> vSourceSignalNames(gsource.dof), vTargetSignalNames(gtarget.dof);
+        if( (int)sourcetokens.size() < gsource.dof+1 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("source tokens '%s' do not have %d dof indices, guessing....", gsource.name%gsource.dof, ORE_InvalidArguments);
+        }
+        else {
+            for(int i = 0; i < gsource.dof; ++i) {
+                vSourceSignalNames[i] = sourcetokens.at(i+1);
             }
-            else {
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vSourceSignalNames[i] = sourcetokens.at(i+1);
-                }
+        }
+        if( (int)targettokens.size() < gtarget.dof+1 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("target tokens '%s' do not match dof '%d', guessing....", gtarget.name%gtarget.dof, ORE_InvalidArguments);
+        }
+        else {
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vTargetSignalNames[i] = targettokens.at(i+1);
             }
-            if( (int)targettokens.size() < gtarget.dof+1 ) {
-                throw OPENRAVE_EXCEPTION_FORMAT("target tokens '%s' do not match dof '%d', guessing....", gtarget.name%gtarget.dof, ORE_InvalidArguments);
+        }
+
+        bool bUninitializedData=false;
+        FOREACH(itTargetSignalName,vTargetSignalNames) {
+            std::vector<std::string>::iterator itSourceSignalName = find(vSourceSignalNames.begin(),vSourceSignalNames.end(),*itTargetSignalName);
+            if( itSourceSignalName == vSourceSignalNames.end() ) {
+                bUninitializedData = true;
+                vtransferindices.push_back(-1); // nothing mapped
             }
             else {
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vTargetSignalNames[i] = targettokens.at(i+1);
-                }
+                vtransferindices.push_back(static_cast<int>(itSourceSignalName-vSourceSignalNames.begin()));
             }
+        }
 
-            bool bUninitializedData=false;
-            FOREACH(itTargetSignalName,vTargetSignalNames) {
-                std::vector<std::string>::iterator itSourceSignalName = find(vSourceSignalNames.begin(),vSourceSignalNames.end(),*itTargetSignalName);
-                if( itSourceSignalName == vSourceSignalNames.end() ) {
-                    bUninitializedData = true;
-                    vtransferindices.push_back(-1); // nothing mapped
-                }
-                else {
-                    vtransferindices.push_back(static_cast<int>(itSourceSignalName-vSourceSignalNames.begin()));
+        if( bUninitializedData && filluninitialized ) {
+            vdefaultvalues.resize(vTargetSignalNames.size(),-1);
+        }
+    }
+    else if( targettokens.at(0).size() >= 7 && targettokens.at(0).substr(0,7) == "affine_") {
+        int affinesource = 0, affinetarget = 0;
+        Vector sourceaxis(0,0,1), targetaxis(0,0,1);
+        if( sourcetokens.size() < 3 ) {
+            if( targettokens.size() < 3 && gsource.dof == gtarget.dof ) {
+                for(int i = 0; i < gtarget.dof; ++i) {
+                    vtransferindices.push_back(i);
                 }
             }
-
-            if( bUninitializedData && filluninitialized ) {
-                vdefaultvalues.resize(vTargetSignalNames.size(),-1);
+            else {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("source affine information not present '%s'\n"),gsource.name,ORE_InvalidArguments);
             }
         }
-        else if( targettokens.at(0).size() >= 7 && targettokens.at(0).substr(0,7) == "affine_") {
-            int affinesource = 0, affinetarget = 0;
-            Vector sourceaxis(0,0,1), targetaxis(0,0,1);
-            if( sourcetokens.size() < 3 ) {
-                if( targettokens.size() < 3 && gsource.dof == gtarget.dof ) {
-                    for(size_t i = 0; i < targettokens.size(); ++i) {
-                        vtransferindices[i] = i;
-                    }
-                }
-                else {
-                    throw OPENRAVE_EXCEPTION_FORMAT(_("source affine information not present '%s'\n"),gsource.name,ORE_InvalidArguments);
-                }
+        else {
+            affinesource = boost::lexical_cast<int>(sourcetokens.at(2));
+            BOOST_ASSERT(RaveGetAffineDOF(affinesource) == gsource.dof);
+            if( (affinesource & DOF_RotationAxis) && sourcetokens.size() >= 6 ) {
+                sourceaxis.x = boost::lexical_cast<dReal>(sourcetokens.at(3));
+                sourceaxis.y = boost::lexical_cast<dReal>(sourcetokens.at(4));
+                sourceaxis.z = boost::lexical_cast<dReal>(sourcetokens.at(5));
             }
-            else {
-                affinesource = boost::lexical_cast<int>(sourcetokens.at(2));
-                BOOST_ASSERT(RaveGetAffineDOF(affinesource) == gsource.dof);
-                if( (affinesource & DOF_RotationAxis) && sourcetokens.size() >= 6 ) {
-                    sourceaxis.x = boost::lexical_cast<dReal>(sourcetokens.at(3));
-                    sourceaxis.y = boost::lexical_cast<dReal>(sourcetokens.at(4));
-                    sourceaxis.z = boost::lexical_cast<dReal>(sourcetokens.at(5));
-                }
+        }
+        if( vtransferindices.size() == 0 ) {
+            if( targettokens.size() < 3 ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("target affine information not present '%s'\n"),gtarget.name,ORE_InvalidArguments);
             }
-            if( vtransferindices.size() == 0 ) {
-                if( targettokens.size() < 3 ) {
-                    throw OPENRAVE_EXCEPTION_FORMAT(_("target affine information not present '%s'\n"),gtarget.name,ORE_InvalidArguments);
-                }
-                else {
-                    affinetarget = boost::lexical_cast<int>(targettokens.at(2));
-                    BOOST_ASSERT(RaveGetAffineDOF(affinetarget) == gtarget.dof);
-                    if( (affinetarget & DOF_RotationAxis) && targettokens.size() >= 6 ) {
-                        targetaxis.x = boost::lexical_cast<dReal>(targettokens.at(3));
-                        targetaxis.y = boost::lexical_cast<dReal>(targettokens.at(4));
-                        targetaxis.z = boost::lexical_cast<dReal>(targettokens.at(5));
-                    }
-                }
-
-                int commondata = affinesource&affinetarget;
-                int uninitdata = affinetarget&(~commondata);
-                int sourcerotationstart = -1, targetrotationstart = -1, targetrotationend = -1;
-                boost::function< void(std::vector<dReal>::iterator, std::vector<dReal>::const_iterator) > rotconverterfn;
-                if( (uninitdata & DOF_RotationMask) && (affinetarget & DOF_RotationMask) && (affinesource & DOF_RotationMask) ) {
-                    // both hold rotations, but need to convert
-                    uninitdata &= ~DOF_RotationMask;
-                    sourcerotationstart = RaveGetIndexFromAffineDOF(affinesource,DOF_RotationMask);
-                    targetrotationstart = RaveGetIndexFromAffineDOF(affinetarget,DOF_RotationMask);
-                    targetrotationend = targetrotationstart+RaveGetAffineDOF(affinetarget&DOF_RotationMask);
-                    if( affinetarget & DOF_RotationAxis ) {
-                        if( affinesource & DOF_Rotation3D ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_AxisFrom3D,_1,_2,targetaxis);
-                        }
-                        else if( affinesource & DOF_RotationQuat ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_AxisFromQuat,_1,_2,targetaxis);
-                        }
+            else {
+                affinetarget = boost::lexical_cast<int>(targettokens.at(2));
+                BOOST_ASSERT(RaveGetAffineDOF(affinetarget) == gtarget.dof);
+                if( (affinetarget & DOF_RotationAxis) && targettokens.size() >= 6 ) {
+                    targetaxis.x = boost::lexical_cast<dReal>(targettokens.at(3));
+                    targetaxis.y = boost::lexical_cast<dReal>(targettokens.at(4));
+                    targetaxis.z = boost::lexical_cast<dReal>(targettokens.at(5));
+                }
+            }
+
+            int commondata = affinesource&affinetarget;
+            int uninitdata = affinetarget&(~commondata);
+            int sourcerotationstart = -1, targetrotationstart = -1, targetrotationend = -1;
+            boost::function< void(std::vector<dReal>::iterator, std::vector<dReal>::const_iterator) > rotconverterfn;
+            if( (uninitdata & DOF_RotationMask) && (affinetarget & DOF_RotationMask) && (affinesource & DOF_RotationMask) ) {
+                // both hold rotations, but need to convert
+                uninitdata &= ~DOF_RotationMask;
+                sourcerotationstart = RaveGetIndexFromAffineDOF(affinesource,DOF_RotationMask);
+                targetrotationstart = RaveGetIndexFromAffineDOF(affinetarget,DOF_RotationMask);
+                targetrotationend = targetrotationstart+RaveGetAffineDOF(affinetarget&DOF_RotationMask);
+                if( affinetarget & DOF_RotationAxis ) {
+                    if( affinesource & DOF_Rotation3D ) {
+                        rotconverterfn = boost::bind(ConvertDOFRotation_AxisFrom3D,_1,_2,targetaxis);
                     }
-                    else if( affinetarget & DOF_Rotation3D ) {
-                        if( affinesource & DOF_RotationAxis ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_3DFromAxis,_1,_2,sourceaxis);
-                        }
-                        else if( affinesource & DOF_RotationQuat ) {
-                            rotconverterfn = ConvertDOFRotation_3DFromQuat;
-                        }
+                    else if( affinesource & DOF_RotationQuat ) {
+                        rotconverterfn = boost::bind(ConvertDOFRotation_AxisFromQuat,_1,_2,targetaxis);
                     }
-                    else if( affinetarget & DOF_RotationQuat ) {
-                        if( affinesource & DOF_RotationAxis ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_QuatFromAxis,_1,_2,sourceaxis);
-                        }
-                        else if( affinesource & DOF_Rotation3D ) {
-                            rotconverterfn = ConvertDOFRotation_QuatFrom3D;
-                        }
-                    }
-                    BOOST_ASSERT(!!rotconverterfn);
                 }
-                if( uninitdata && filluninitialized ) {
-                    // initialize with the current body values
-                    KinBodyPtr pbody;
-                    if( targettokens.size() > 1 ) {
-                        pbody = penv->GetKinBody(targettokens.at(1));
-                    }
-                    if( !pbody && sourcetokens.size() > 1 ) {
-                        pbody = penv->GetKinBody(sourcetokens.at(1));
+                else if( affinetarget & DOF_Rotation3D ) {
+                    if( affinesource & DOF_RotationAxis ) {
+                        rotconverterfn = boost::bind(ConvertDOFRotation_3DFromAxis,_1,_2,sourceaxis);
                     }
-                    if( !pbody ) {
-                        RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
-                        vdefaultvalues.resize(gtarget.dof,0);
-                    }
-                    else {
-                        vdefaultvalues.resize(gtarget.dof);
-                        RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),pbody->GetTransform(),affinetarget);
+                    else if( affinesource & DOF_RotationQuat ) {
+                        rotconverterfn = ConvertDOFRotation_3DFromQuat;
                     }
                 }
-
-                for(int index = 0; index < gtarget.dof; ++index) {
-                    DOFAffine dof = RaveGetAffineDOFFromIndex(affinetarget,index);
-                    int startindex = RaveGetIndexFromAffineDOF(affinetarget,dof);
-                    if( affinesource & dof ) {
-                        int sourceindex = RaveGetIndexFromAffineDOF(affinesource,dof);
-                        vtransferindices.push_back(sourceindex + (index-startindex));
-                    }
-                    else {
-                        vtransferindices.push_back(-1);
+                else if( affinetarget & DOF_RotationQuat ) {
+                    if( affinesource & DOF_RotationAxis ) {
+                        rotconverterfn = boost::bind(ConvertDOFRotation_QuatFromAxis,_1,_2,sourceaxis);
                     }
-                }
-
-                for(size_t i = 0; i < numpoints; ++i, itsourcedata += sourcestride, ittargetdata += targetstride) {
-                    for(int j = 0; j < (int)vtransferindices.size(); ++j) {
-                        if( vtransferindices[j] >= 0 ) {
-                            *(ittargetdata+j) = *(itsourcedata+vtransferindices[j]);
-                        }
-                        else {
-                            if( j >= targetrotationstart && j < targetrotationend ) {
-                                if( j == targetrotationstart ) {
-                                    // only convert when at first index
-                                    rotconverterfn(ittargetdata+targetrotationstart,itsourcedata+sourcerotationstart);
-                                }
-                            }
-                            else if( filluninitialized ) {
-                                *(ittargetdata+j) = vdefaultvalues.at(j);
-                            }
-                        }
+                    else if( affinesource & DOF_Rotation3D ) {
+                        rotconverterfn = ConvertDOFRotation_QuatFrom3D;
                     }
                 }
-                return;
+                BOOST_ASSERT(!!rotconverterfn);
             }
-        }
-        else if( targettokens.at(0).size() >= 8 && targettokens.at(0).substr(0,8) == "ikparam_") {
-            IkParameterizationType iktypesource, iktypetarget;
-            if( sourcetokens.size() >= 2 ) {
-                iktypesource = static_cast<IkParameterizationType>(boost::lexical_cast<int>(sourcetokens[1]));
-            }
-            else {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("ikparam type not present '%s'\n"),gsource.name,ORE_InvalidArguments);
-            }
-            if( targettokens.size() >= 2 ) {
-                iktypetarget = static_cast<IkParameterizationType>(boost::lexical_cast<int>(targettokens[1]));
-            }
-            else {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("ikparam type not present '%s'\n"),gtarget.name,ORE_InvalidArguments);
-            }
-
-            if( iktypetarget == iktypesource ) {
-                vtransferindices.resize(IkParameterization::GetDOF(iktypetarget));
-                for(size_t i = 0; i < vtransferindices.size(); ++i) {
-                    vtransferindices[i] = i;
+            if( uninitdata && filluninitialized ) {
+                // initialize with the current body values
+                _bEnvironmentDefaults = true;
+                KinBodyPtr pbody;
+                if( targettokens.size() > 1 ) {
+                    pbody = penv->GetKinBody(targettokens.at(1));
                 }
-            }
-            else {
-                RAVELOG_WARN("ikparam types do not match");
-            }
-        }
-        // need a space since grabbody is also a group
-        else if( targettokens.at(0) == std::string("grab") ) {
-            std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
-            if( (int)sourcetokens.size() < gsource.dof+2 ) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("source tokens '%s' do not have %d dof indices, guessing...."), gsource.name%gsource.dof, ORE_InvalidArguments);
-            }
-            else {
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
+                if( !pbody && sourcetokens.size() > 1 ) {
+                    pbody = penv->GetKinBody(sourcetokens.at(1));
                 }
-            }
-            if( (int)targettokens.size() < gtarget.dof+2 ) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("target tokens '%s' do not match dof '%d', guessing...."), gtarget.name%gtarget.dof, ORE_InvalidArguments);
-            }
-            else {
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
+                if( !pbody ) {
+                    RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
+                    vdefaultvalues.resize(gtarget.dof,0);
+                }
+                else {
+                    vdefaultvalues.resize(gtarget.dof);
+                    RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),pbody->GetTransform(),affinetarget);
                 }
             }
 
-            bool bUninitializedData=false;
-            FOREACH(ittargetindex,vtargetindices) {
-                std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
-                if( it == vsourceindices.end() ) {
-                    bUninitializedData = true;
-                    vtransferindices.push_back(-1);
+            for(int index = 0; index < gtarget.dof; ++index) {
+                DOFAffine dof = RaveGetAffineDOFFromIndex(affinetarget,index);
+                int startindex = RaveGetIndexFromAffineDOF(affinetarget,dof);
+                if( affinesource & dof ) {
+                    int sourceindex = RaveGetIndexFromAffineDOF(affinesource,dof);
+                    vtransferindices.push_back(sourceindex + (index-startindex));
                 }
                 else {
-                    vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
+                    vtransferindices.push_back(-1);
                 }
             }
 
-            if( bUninitializedData && filluninitialized ) {
-                vdefaultvalues.resize(vtargetindices.size(),0);
+            for(int j = 0; j < (int)vtransferindices.size(); ++j) {
+                if( vtransferindices[j] >= 0 ) {
+                    _AddCopy(targetoffset+j, sourceoffset+vtransferindices[j]);
+                }
+                else if( j >= targetrotationstart && j < targetrotationend ) {
+                    if( j == targetrotationstart ) {
+                        // only convert when at first index
+                        RotationConversion rotation;
+                        rotation.targetoffset = targetoffset+targetrotationstart;
+                        rotation.sourceoffset = sourceoffset+sourcerotationstart;
+                        rotation.converterfn = rotconverterfn;
+                        _vrotationconversions.push_back(rotation);
+                    }
+                }
+                else if( filluninitialized ) {
+                    _AddFill(targetoffset+j, vdefaultvalues.at(j));
+                }
             }
+            return;
+        }
+    }
+    else if( targettokens.at(0).size() >= 8 && targettokens.at(0).substr(0,8) == "ikparam_") {
+        IkParameterizationType iktypesource, iktypetarget;
+        if( sourcetokens.size() >= 2 ) {
+            iktypesource = static_cast<IkParameterizationType>(boost::lexical_cast<int>(sourcetokens[1]));
+        }
+        else {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("ikparam type not present '%s'\n"),gsource.name,ORE_InvalidArguments);
         }
-        else if( targettokens.at(0) == std::string("grabbody") ) {
-            // TODO
+        if( targettokens.size() >= 2 ) {
+            iktypetarget = static_cast<IkParameterizationType>(boost::lexical_cast<int>(targettokens[1]));
         }
         else {
-            throw OPENRAVE_EXCEPTION_FORMAT(_("unsupported token conversion: %s"),gtarget.name,ORE_InvalidArguments);
+            throw OPENRAVE_EXCEPTION_FORMAT(_("ikparam type not present '%s'\n"),gtarget.name,ORE_InvalidArguments);
         }
 
-        for(size_t i = 0; i < numpoints; ++i, itsourcedata += sourcestride, ittargetdata += targetstride) {
-            for(size_t j = 0; j < vtransferindices.size(); ++j) {
-                if( vtransferindices[j] >= 0 ) {
-                    *(ittargetdata+j) = *(itsourcedata+vtransferindices[j]);
-                }
-                else if( filluninitialized ) {
-                    *(ittargetdata+j) = vdefaultvalues.at(j);
-                }
+        if( iktypetarget == iktypesource ) {
+            vtransferindices.resize(IkParameterization::GetDOF(iktypetarget));
+            for(size_t i = 0; i < vtransferindices.size(); ++i) {
+                vtransferindices[i] = i;
             }
         }
+        else {
+            RAVELOG_WARN("ikparam types do not match");
+        }
     }
-}
-
-void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification &targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification &sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
-{
-    for(size_t igroup = 0; igroup < targetspec._vgroups.size(); ++igroup) {
-        std::vector<ConfigurationSpecification::Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(targetspec._vgroups[igroup]);
-        if( itcompatgroup != sourcespec._vgroups.end() ) {
-            ConfigurationSpecification::ConvertGroupData(ittargetdata+targetspec._vgroups[igroup].offset, targetspec.GetDOF(), targetspec._vgroups[igroup], itsourcedata+itcompatgroup->offset, sourcespec.GetDOF(), *itcompatgroup,numpoints,penv,filluninitialized);
+    // need a space since grabbody is also a group
+    else if( targettokens.at(0) == std::string("grab") ) {
+        std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
+        if( (int)sourcetokens.size() < gsource.dof+2 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("source tokens '%s' do not have %d dof indices, guessing...."), gsource.name%gsource.dof, ORE_InvalidArguments);
         }
-        else if( filluninitialized ) {
-            vector<dReal> vdefaultvalues(targetspec._vgroups[igroup].dof,0);
-            const string& name = targetspec._vgroups[igroup].name;
-            if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
-                string bodyname;
-                stringstream ss(name.substr(12));
-                ss >> bodyname;
-                if( !!ss ) {
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            vector<dReal> values;
-                            body->GetDOFValues(values);
-                            std::vector<int> indices((istream_iterator<int>(ss)), istream_iterator<int>());
-                            for(size_t i = 0; i < indices.size(); ++i) {
-                                vdefaultvalues.at(i) = values.at(indices[i]);
-                            }
-                        }
-                    }
-                }
-            }
-            else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
-                string bodyname;
-                int affinedofs;
-                stringstream ss(name.substr(16));
-                ss >> bodyname >> affinedofs;
-                if( !!ss ) {
-                    Transform tdefault;
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            tdefault = body->GetTransform();
-                        }
-                    }
-                    BOOST_ASSERT((int)vdefaultvalues.size() == RaveGetAffineDOF(affinedofs));
-                    RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),tdefault,affinedofs);
-                }
+        else {
+            for(int i = 0; i < gsource.dof; ++i) {
+                vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
             }
-            else if( name.size() >= 13 && name.substr(0,13) == "outputSignals") {
-                std::fill(vdefaultvalues.begin(), vdefaultvalues.end(), -1);
+        }
+        if( (int)targettokens.size() < gtarget.dof+2 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("target tokens '%s' do not match dof '%d', guessing...."), gtarget.name%gtarget.dof, ORE_InvalidArguments);
+        }
+        else {
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
             }
-            else if( name != "deltatime" ) {
-                // messages are too frequent
-                //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+        }
+
+        bool bUninitializedData=false;
+        FOREACH(ittargetindex,vtargetindices) {
+            std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
+            if( it == vsourceindices.end() ) {
+                bUninitializedData = true;
+                vtransferindices.push_back(-1);
             }
-            int offset = targetspec._vgroups[igroup].offset;
-            for(size_t i = 0; i < numpoints; ++i, offset += targetspec.GetDOF()) {
-                for(size_t j = 0; j < vdefaultvalues.size(); ++j) {
-                    *(ittargetdata+offset+j) = vdefaultvalues[j];
-                }
+            else {
+                vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
             }
         }
+
+        if( bUninitializedData && filluninitialized ) {
+            vdefaultvalues.resize(vtargetindices.size(),0);
+        }
+    }
+    else if( targettokens.at(0) == std::string("grabbody") ) {
+        // TODO
+    }
+    else {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("unsupported token conversion: %s"),gtarget.name,ORE_InvalidArguments);
+    }
+
+    for(size_t j = 0; j < vtransferindices.size(); ++j) {
+        if( vtransferindices[j] >= 0 ) {
+            _AddCopy(targetoffset+j, sourceoffset+vtransferindices[j]);
+        }
+        else if( filluninitialized ) {
+            _AddFill(targetoffset+j, vdefaultvalues.at(j));
+        }
     }
 }
 
+void ConfigurationSpecification::ConvertGroupData(std::vector<dReal>::iterator ittargetdata, size_t targetstride, const ConfigurationSpecification::Group& gtarget, std::vector<dReal>::const_iterator itsourcedata, size_t sourcestride, const ConfigurationSpecification::Group& gsource, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+{
+    Converter converter;
+    converter._Reset(targetstride, sourcestride);
+    converter._AddGroup(0, gtarget, 0, gsource, penv, filluninitialized);
+    converter._bInit = true;
+    converter.Convert(ittargetdata, itsourcedata, numpoints);
+}
+
+void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification &targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification &sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+{
+    Converter(targetspec, sourcespec, penv, filluninitialized).Convert(ittargetdata, itsourcedata, numpoints);
+}
+
 std::string ConfigurationSpecification::GetInterpolationDerivative(const std::string& interpolation, int deriv)
 {
     const static boost::array<std::string,7> s_InterpolationOrder = {{"next","linear","quadratic","cubic","quartic","quintic","sextic"}};
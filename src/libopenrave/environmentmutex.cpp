@@ -0,0 +1,248 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "libopenrave.h"
+
+#include <boost/core/demangle.hpp>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#ifdef __GNUC__
+#define OPENRAVE_CALLSITE() __builtin_return_address(0)
+#else
+#define OPENRAVE_CALLSITE() NULL
+#endif
+
+namespace OpenRAVE {
+
+namespace {
+
+/// \brief returns the histogram bucket of a duration in ns, see \ref EnvironmentMutexStatistics
+static size_t GetHistogramBucket(uint64_t duration)
+{
+    uint64_t us = duration/1000;
+    size_t ibucket = 0;
+    while( us > 0 && ibucket+1 < EnvironmentMutexStatistics::NumHistogramBuckets ) {
+        us >>= 1;
+        ++ibucket;
+    }
+    return ibucket;
+}
+
+static std::string GetCallSiteName(void* callsite)
+{
+    if( !callsite ) {
+        return "unknown";
+    }
+    std::string name = str(boost::format("%p")%callsite);
+#ifndef _WIN32
+    Dl_info info;
+    if( dladdr(callsite, &info) != 0 ) {
+        if( !!info.dli_sname ) {
+            name = boost::core::demangle(info.dli_sname);
+        }
+        else if( !!info.dli_fbase ) {
+            name += str(boost::format("(+0x%x)")%((const char*)callsite - (const char*)info.dli_fbase));
+        }
+        if( !!info.dli_fname ) {
+            name += str(boost::format(" in %s")%info.dli_fname);
+        }
+    }
+#endif
+    return name;
+}
+
+} // end namespace
+
+struct EnvironmentMutex::CallSiteData
+{
+    CallSiteData() : numAcquisitions(0), totalWaitTime(0), maxWaitTime(0), totalHoldTime(0), maxHoldTime(0) {
+        std::fill(vWaitHistogram, vWaitHistogram+EnvironmentMutexStatistics::NumHistogramBuckets, 0);
+        std::fill(vHoldHistogram, vHoldHistogram+EnvironmentMutexStatistics::NumHistogramBuckets, 0);
+    }
+
+    uint64_t numAcquisitions;
+    uint64_t totalWaitTime, maxWaitTime;
+    uint64_t totalHoldTime, maxHoldTime;
+    uint64_t vWaitHistogram[EnvironmentMutexStatistics::NumHistogramBuckets];
+    uint64_t vHoldHistogram[EnvironmentMutexStatistics::NumHistogramBuckets];
+};
+
+EnvironmentMutexStatistics::EnvironmentMutexStatistics() : numAcquisitions(0), totalWaitTime(0), maxWaitTime(0), totalHoldTime(0), maxHoldTime(0), vWaitHistogram(NumHistogramBuckets, 0), vHoldHistogram(NumHistogramBuckets, 0)
+{
+}
+
+EnvironmentMutex::EnvironmentMutex() : _bInstrumentationEnabled(false), _nDepth(0), _bRecordingHold(false), _holdercallsite(NULL), _holdstarttime(0)
+{
+}
+
+EnvironmentMutex::~EnvironmentMutex()
+{
+}
+
+void EnvironmentMutex::lock()
+{
+    if( IsInstrumentationEnabled() ) {
+        _LockInstrumented(OPENRAVE_CALLSITE());
+        return;
+    }
+    boost::recursive_try_mutex::lock();
+    ++_nDepth;
+}
+
+bool EnvironmentMutex::try_lock()
+{
+    if( IsInstrumentationEnabled() ) {
+        return _TryLockInstrumented(OPENRAVE_CALLSITE());
+    }
+    if( !boost::recursive_try_mutex::try_lock() ) {
+        return false;
+    }
+    ++_nDepth;
+    return true;
+}
+
+void EnvironmentMutex::unlock()
+{
+    if( --_nDepth == 0 && _bRecordingHold ) {
+        _OnReleased();
+    }
+    boost::recursive_try_mutex::unlock();
+}
+
+void EnvironmentMutex::_LockInstrumented(void* callsite)
+{
+    uint64_t starttime = utils::GetNanoPerformanceTime();
+    boost::recursive_try_mutex::lock();
+    if( ++_nDepth == 1 ) {
+        _OnAcquired(callsite, starttime, utils::GetNanoPerformanceTime());
+    }
+}
+
+bool EnvironmentMutex::_TryLockInstrumented(void* callsite)
+{
+    uint64_t starttime = utils::GetNanoPerformanceTime();
+    if( !boost::recursive_try_mutex::try_lock() ) {
+        return false;
+    }
+    if( ++_nDepth == 1 ) {
+        _OnAcquired(callsite, starttime, utils::GetNanoPerformanceTime());
+    }
+    return true;
+}
+
+void EnvironmentMutex::_OnAcquired(void* callsite, uint64_t starttime, uint64_t acquiretime)
+{
+    uint64_t waittime = acquiretime - starttime;
+    boost::mutex::scoped_lock lock(_mutexStatistics);
+    boost::shared_ptr<CallSiteData>& pdata = _mapCallSites[callsite];
+    if( !pdata ) {
+        pdata.reset(new CallSiteData());
+    }
+    pdata->numAcquisitions++;
+    pdata->totalWaitTime += waittime;
+    pdata->maxWaitTime = std::max(pdata->maxWaitTime, waittime);
+    pdata->vWaitHistogram[GetHistogramBucket(waittime)]++;
+    _holdercallsite = callsite;
+    _holderthreadid = boost::this_thread::get_id();
+    _holdstarttime = acquiretime;
+    _bRecordingHold = true;
+}
+
+void EnvironmentMutex::_OnReleased()
+{
+    uint64_t holdtime = utils::GetNanoPerformanceTime() - _holdstarttime;
+    boost::mutex::scoped_lock lock(_mutexStatistics);
+    _bRecordingHold = false;
+    std::map<void*, boost::shared_ptr<CallSiteData> >::iterator it = _mapCallSites.find(_holdercallsite);
+    if( it != _mapCallSites.end() ) {
+        it->second->totalHoldTime += holdtime;
+        it->second->maxHoldTime = std::max(it->second->maxHoldTime, holdtime);
+        it->second->vHoldHistogram[GetHistogramBucket(holdtime)]++;
+    }
+    _holdercallsite = NULL;
+    _holderthreadid = boost::thread::id();
+}
+
+void EnvironmentMutex::SetInstrumentationEnabled(bool bEnable)
+{
+    _bInstrumentationEnabled.store(bEnable, std::memory_order_relaxed);
+}
+
+void EnvironmentMutex::GetStatistics(std::vector<EnvironmentMutexStatistics>& vstatistics) const
+{
+    std::vector< std::pair<void*, CallSiteData> > vdata;
+    {
+        boost::mutex::scoped_lock lock(_mutexStatistics);
+        vdata.reserve(_mapCallSites.size());
+        FOREACHC(it, _mapCallSites) {
+            vdata.push_back(std::make_pair(it->first, *it->second));
+        }
+    }
+    // resolve the names outside of the lock since dladdr can be slow
+    vstatistics.resize(vdata.size());
+    for(size_t i = 0; i < vdata.size(); ++i) {
+        const CallSiteData& data = vdata[i].second;
+        EnvironmentMutexStatistics& statistics = vstatistics[i];
+        statistics.callsite = GetCallSiteName(vdata[i].first);
+        statistics.numAcquisitions = data.numAcquisitions;
+        statistics.totalWaitTime = data.totalWaitTime;
+        statistics.maxWaitTime = data.maxWaitTime;
+        statistics.totalHoldTime = data.totalHoldTime;
+        statistics.maxHoldTime = data.maxHoldTime;
+        statistics.vWaitHistogram.assign(data.vWaitHistogram, data.vWaitHistogram+EnvironmentMutexStatistics::NumHistogramBuckets);
+        statistics.vHoldHistogram.assign(data.vHoldHistogram, data.vHoldHistogram+EnvironmentMutexStatistics::NumHistogramBuckets);
+    }
+}
+
+void EnvironmentMutex::ResetStatistics()
+{
+    boost::mutex::scoped_lock lock(_mutexStatistics);
+    // keep the data of the current holder so its hold time is still recorded on release
+    std::map<void*, boost::shared_ptr<CallSiteData> >::iterator it = _mapCallSites.begin();
+    while( it != _mapCallSites.end() ) {
+        if( _holderthreadid != boost::thread::id() && it->first == _holdercallsite ) {
+            *it->second = CallSiteData();
+            it->second->numAcquisitions = 1;
+            ++it;
+        }
+        else {
+            _mapCallSites.erase(it++);
+        }
+    }
+}
+
+bool EnvironmentMutex::GetHolder(std::string& threadid, std::string& callsite, uint64_t& heldtime) const
+{
+    void* holdercallsite;
+    {
+        boost::mutex::scoped_lock lock(_mutexStatistics);
+        if( _holderthreadid == boost::thread::id() ) {
+            return false;
+        }
+        std::stringstream ss;
+        ss << _holderthreadid;
+        threadid = ss.str();
+        holdercallsite = _holdercallsite;
+        heldtime = utils::GetNanoPerformanceTime() - _holdstarttime;
+    }
+    callsite = GetCallSiteName(holdercallsite);
+    return true;
+}
+
+} // end namespace OpenRAVE
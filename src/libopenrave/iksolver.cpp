@@ -164,6 +164,18 @@ bool IkSolverBase::SolveAll(const IkParameterization& param, const std::vector<d
     return vsolutions.size() > 0;
 }
 
+bool IkSolverBase::SolveAllBatch(const std::vector<IkParameterization>& params, int filteroptions, std::vector< std::vector<IkReturnPtr> >& ikreturns)
+{
+    ikreturns.resize(params.size());
+    bool bsuccess = false;
+    for(size_t i = 0; i < params.size(); ++i) {
+        if( SolveAll(params[i], filteroptions, ikreturns[i]) ) {
+            bsuccess = true;
+        }
+    }
+    return bsuccess;
+}
+
 UserDataPtr IkSolverBase::RegisterCustomFilter(int32_t priority, const IkSolverBase::IkFilterCallbackFn &filterfn)
 {
     CustomIkSolverFilterDataPtr pdata(new CustomIkSolverFilterData(priority,filterfn,shared_iksolver()));
@@ -22,6 +22,9 @@ InterfaceBase::InterfaceBase(InterfaceType type, EnvironmentBasePtr penv) : __ty
     RaveInitializeFromState(penv->GlobalState()); // make sure global state is set
     RegisterCommand("help",boost::bind(&InterfaceBase::_GetCommandHelp,this,_1,_2), "display help commands.");
     RegisterJSONCommand("help",boost::bind(&InterfaceBase::_GetJSONCommandHelp,this,_1,_2,_3), "display help commands.");
+    RegisterCommand("GetPerfCounters",boost::bind(&InterfaceBase::_GetPerfCountersCommand,this,_1,_2), "returns one line of \"name count total\" for every performance counter of the interface.");
+    RegisterJSONCommand("GetPerfCounters",boost::bind(&InterfaceBase::_GetPerfCountersJSONCommand,this,_1,_2,_3), "returns an object with the count and total of every performance counter of the interface.");
+    RegisterCommand("ResetPerfCounters",boost::bind(&InterfaceBase::_ResetPerfCountersCommand,this,_1,_2), "sets all the performance counters of the interface to 0.");
 }
 
 InterfaceBase::~InterfaceBase()
@@ -32,6 +35,7 @@ InterfaceBase::~InterfaceBase()
     __mapReadableInterfaces.clear();
     __penv.reset();
     __mapJSONCommands.clear();
+    __mapPerfCounters.clear();
 }
 
 void InterfaceBase::SetUserData(const std::string& key, UserDataPtr data) const
@@ -257,6 +261,59 @@ void InterfaceBase::_GetJSONCommandHelp(const rapidjson::Value& input, rapidjson
     }
 }
 
+PerfCounterPtr InterfaceBase::RegisterPerfCounter(const std::string& name)
+{
+    boost::unique_lock< boost::shared_mutex > lock(_mutexInterface);
+    PerfCounterPtr& pcounter = __mapPerfCounters[name];
+    if( !pcounter ) {
+        pcounter.reset(new PerfCounter());
+    }
+    return pcounter;
+}
+
+void InterfaceBase::GetPerfCounters(std::map<std::string, PerfCounterPtr>& mapcounters) const
+{
+    boost::shared_lock< boost::shared_mutex > lock(_mutexInterface);
+    mapcounters = __mapPerfCounters;
+}
+
+void InterfaceBase::ResetPerfCounters()
+{
+    boost::shared_lock< boost::shared_mutex > lock(_mutexInterface);
+    FOREACHC(itcounter, __mapPerfCounters) {
+        itcounter->second->Reset();
+    }
+}
+
+bool InterfaceBase::_GetPerfCountersCommand(std::ostream& sout, std::istream& sinput) const
+{
+    std::map<std::string, PerfCounterPtr> mapcounters;
+    GetPerfCounters(mapcounters);
+    FOREACHC(itcounter, mapcounters) {
+        sout << itcounter->first << " " << itcounter->second->GetCount() << " " << itcounter->second->GetTotal() << std::endl;
+    }
+    return true;
+}
+
+void InterfaceBase::_GetPerfCountersJSONCommand(const rapidjson::Value& input, rapidjson::Value& output, rapidjson::Document::AllocatorType& allocator) const
+{
+    std::map<std::string, PerfCounterPtr> mapcounters;
+    GetPerfCounters(mapcounters);
+    output.SetObject();
+    FOREACHC(itcounter, mapcounters) {
+        rapidjson::Value rcounter(rapidjson::kObjectType);
+        rcounter.AddMember("count", rapidjson::Value().SetUint64(itcounter->second->GetCount()), allocator);
+        rcounter.AddMember("total", rapidjson::Value().SetUint64(itcounter->second->GetTotal()), allocator);
+        output.AddMember(rapidjson::Value().SetString(itcounter->first.c_str(), allocator), rcounter, allocator);
+    }
+}
+
+bool InterfaceBase::_ResetPerfCountersCommand(std::ostream& sout, std::istream& sinput)
+{
+    ResetPerfCounters();
+    return true;
+}
+
 XMLReadablePtr InterfaceBase::GetReadableInterface(const std::string& xmltag) const
 {
     boost::shared_lock< boost::shared_mutex > lock(_mutexInterface);
@@ -46,6 +46,25 @@ protected:
     boost::weak_ptr<KinBody const> _pweakbody;
 };
 
+/// \brief buffers of ComputeInverseDynamics kept between the calls so that computing the torques of many states does not allocate
+///
+/// ComputeInverseDynamics is const and can be called from several threads on the same body, so every thread has its own buffers.
+struct InverseDynamicsCache
+{
+    std::vector<dReal> vDOFVelocities;
+    std::vector< std::pair<Vector, Vector> > vLinkVelocities, vLinkAccelerations, vLinkForceTorques; ///< linear, angular
+    std::vector<Vector> vLinkCOMLinearAccelerations, vLinkCOMMomentOfInertia;
+    std::vector<std::pair<int,dReal> > vpartials;
+    KinBody::AccelerationMap externalaccelerations;
+    std::vector<dReal> vSampleVelocities, vSampleAccelerations, vSampleTorques; ///< cache for ComputeInverseDynamicsSamples
+};
+
+static InverseDynamicsCache& GetInverseDynamicsCache()
+{
+    static thread_local InverseDynamicsCache s_cache;
+    return s_cache;
+}
+
 class CallFunctionAtDestructor
 {
 public:
@@ -129,10 +148,16 @@ KinBody::KinBody(InterfaceType type, EnvironmentBasePtr penv) : InterfaceBase(ty
 {
     _nHierarchyComputed = 0;
     _nParametersChanged = 0;
+    _nChangeCallbackBatchDepth = 0;
+    _nBatchedParametersChanged = 0;
     _bMakeJoinedLinksAdjacent = true;
     _environmentid = 0;
     _nNonAdjacentLinkCache = 0x80000000;
     _nUpdateStampId = 0;
+    _nLastSetDOFValuesStamp = -1;
+    _nLinkTransformationsArraysStamp = -1;
+    _nDOFValuesArrayStamp = -1;
+    _nCloneUpdateStamp = -1;
     _bAreAllJoints1DOFAndNonCircular = false;
 }
 
@@ -168,6 +193,7 @@ void KinBody::Destroy()
     _vDOFIndices.clear();
 
     _setAdjacentLinks.clear();
+    _setUnreachableLinkPairs.clear();
     _vInitialLinkTransformations.clear();
     _vAllPairsShortestPaths.clear();
     _vClosedLoops.clear();
@@ -355,6 +381,7 @@ void KinBody::SetLinkGeometriesFromGroup(const std::string& geomname)
                 throw OPENRAVE_EXCEPTION_FORMAT(_("could not find geometries %s for link %s"),geomname%GetName(),ORE_InvalidArguments);
             }
             pvinfos = &it->second;
+            (*itlink)->_LoadGroupGeometryMeshes(*pvinfos);
         }
         (*itlink)->_vGeometries.resize(pvinfos->size());
         for(size_t i = 0; i < pvinfos->size(); ++i) {
@@ -382,6 +409,27 @@ void KinBody::SetLinkGroupGeometries(const std::string& geomname, const std::vec
     _PostprocessChangedParameters(Prop_LinkGeometryGroup); // have to notify collision checkers that the geometry info they are caching could have changed.
 }
 
+void KinBody::InitBoundingSphereGeometryGroup(const std::string& name, int nMaxSpheres)
+{
+    std::vector< std::vector<KinBody::GeometryInfoPtr> > linkgeometries(_veclinks.size());
+    std::vector< std::pair<Vector, dReal> > vspheres;
+    FOREACHC(itlink, _veclinks) {
+        (*itlink)->ComputeBoundingSpheres(vspheres, nMaxSpheres);
+        std::vector<KinBody::GeometryInfoPtr>& geometries = linkgeometries.at((*itlink)->GetIndex());
+        for(size_t isphere = 0; isphere < vspheres.size(); ++isphere) {
+            KinBody::GeometryInfoPtr pinfo(new KinBody::GeometryInfo());
+            pinfo->_type = GT_Sphere;
+            pinfo->_t.trans = vspheres[isphere].first;
+            pinfo->_vGeomData.x = vspheres[isphere].second;
+            pinfo->_name = str(boost::format("%s_sphere%d")%name%isphere);
+            pinfo->_bVisible = false;
+            pinfo->InitCollisionMesh();
+            geometries.push_back(pinfo);
+        }
+    }
+    SetLinkGroupGeometries(name, linkgeometries);
+}
+
 bool KinBody::Init(const std::vector<KinBody::LinkInfoConstPtr>& linkinfos, const std::vector<KinBody::JointInfoConstPtr>& jointinfos, const std::string& uri)
 {
     OPENRAVE_ASSERT_FORMAT(GetEnvironmentId()==0, "%s: cannot Init a body while it is added to the environment", GetName(), ORE_Failed);
@@ -480,6 +528,28 @@ void KinBody::GetDOFValues(std::vector<dReal>& v, const std::vector<int>& dofind
     }
 }
 
+void KinBody::GetDOFValues(dReal* pvalues, const std::vector<int>& dofindices) const
+{
+    CHECK_INTERNAL_COMPUTATION;
+    if( dofindices.size() == 0 ) {
+        FOREACHC(it, _vDOFOrderedJoints) {
+            if( (*it)->GetDOF() == 1 ) {
+                pvalues[(*it)->GetDOFIndex()] = (*it)->GetValue(0);
+            }
+            else {
+                (*it)->GetValues(_vTempJointValues);
+                std::copy(_vTempJointValues.begin(), _vTempJointValues.end(), pvalues+(*it)->GetDOFIndex());
+            }
+        }
+    }
+    else {
+        for(size_t i = 0; i < dofindices.size(); ++i) {
+            JointPtr pjoint = GetJointFromDOFIndex(dofindices[i]);
+            pvalues[i] = pjoint->GetValue(dofindices[i]-pjoint->GetDOFIndex());
+        }
+    }
+}
+
 void KinBody::GetDOFVelocities(std::vector<dReal>& v, const std::vector<int>& dofindices) const
 {
     if( dofindices.size() == 0 ) {
@@ -1265,6 +1335,46 @@ void KinBody::GetLinkTransformations(vector<Transform>& vtrans) const
     }
 }
 
+void KinBody::GetLinkTransformations(Transform* ptransforms) const
+{
+    for(size_t ilink = 0; ilink < _veclinks.size(); ++ilink) {
+        ptransforms[ilink] = _veclinks[ilink]->GetTransform();
+    }
+}
+
+const dReal* KinBody::GetDOFValuesArray() const
+{
+    if( _nDOFValuesArrayStamp != _nUpdateStampId || (int)_vDOFValuesArrayCache.size() != GetDOF() ) {
+        _vDOFValuesArrayCache.resize(GetDOF());
+        if( _vDOFValuesArrayCache.size() > 0 ) {
+            GetDOFValues(&_vDOFValuesArrayCache[0]);
+        }
+        _nDOFValuesArrayStamp = _nUpdateStampId;
+    }
+    return _vDOFValuesArrayCache.size() > 0 ? &_vDOFValuesArrayCache[0] : NULL;
+}
+
+const dReal* KinBody::GetLinkTransformationsArrays() const
+{
+    size_t numlinks = _veclinks.size();
+    if( _nLinkTransformationsArraysStamp != _nUpdateStampId || _vLinkTransformationsArraysCache.size() != 7*numlinks ) {
+        _vLinkTransformationsArraysCache.resize(7*numlinks);
+        dReal* p = _vLinkTransformationsArraysCache.size() > 0 ? &_vLinkTransformationsArraysCache[0] : NULL;
+        for(size_t ilink = 0; ilink < numlinks; ++ilink) {
+            const Transform& t = _veclinks[ilink]->GetTransform();
+            p[ilink] = t.rot.x;
+            p[numlinks+ilink] = t.rot.y;
+            p[2*numlinks+ilink] = t.rot.z;
+            p[3*numlinks+ilink] = t.rot.w;
+            p[4*numlinks+ilink] = t.trans.x;
+            p[5*numlinks+ilink] = t.trans.y;
+            p[6*numlinks+ilink] = t.trans.z;
+        }
+        _nLinkTransformationsArraysStamp = _nUpdateStampId;
+    }
+    return _vLinkTransformationsArraysCache.size() > 0 ? &_vLinkTransformationsArraysCache[0] : NULL;
+}
+
 void KinBody::GetLinkTransformations(std::vector<Transform>& transforms, std::vector<dReal>& doflastsetvalues) const
 {
     transforms.resize(_veclinks.size());
@@ -1518,6 +1628,11 @@ void KinBody::SetLinkEnableStates(const std::vector<uint8_t>& enablestates)
 }
 
 void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, const Transform& transBase, uint32_t checklimits)
+{
+    SetDOFValues(vJointValues.size() > 0 ? &vJointValues[0] : NULL, vJointValues.size(), transBase, checklimits);
+}
+
+void KinBody::SetDOFValues(const dReal* pvalues, size_t dof, const Transform& transBase, uint32_t checklimits)
 {
     if( _veclinks.size() == 0 ) {
         return;
@@ -1529,25 +1644,32 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, const Transfo
     for(size_t i = 1; i < _veclinks.size(); ++i) {
         _veclinks[i]->SetTransform(tbase*_veclinks[i]->GetTransform());
     }
-    SetDOFValues(vJointValues,checklimits);
+    // every link moved, so SetDOFValues cannot be incremental: all the grabbed bodies have to follow and Prop_LinkTransforms has to be posted
+    SetDOFValues(pvalues,dof,checklimits);
 }
 
 void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t checklimits, const std::vector<int>& dofindices)
+{
+    SetDOFValues(vJointValues.size() > 0 ? &vJointValues[0] : NULL, vJointValues.size(), checklimits, dofindices);
+}
+
+void KinBody::SetDOFValues(const dReal* pvalues, size_t dof, uint32_t checklimits, const std::vector<int>& dofindices)
 {
     CHECK_INTERNAL_COMPUTATION;
-    if( vJointValues.size() == 0 || _veclinks.size() == 0) {
+    OPENRAVE_PROFILE_SCOPE("kinbody", "SetDOFValues");
+    if( dof == 0 || _veclinks.size() == 0) {
         return;
     }
     int expecteddof = dofindices.size() > 0 ? (int)dofindices.size() : GetDOF();
-    OPENRAVE_ASSERT_OP_FORMAT((int)vJointValues.size(),>=,expecteddof, "not enough values %d<%d", vJointValues.size()%GetDOF(),ORE_InvalidArguments);
+    OPENRAVE_ASSERT_OP_FORMAT((int)dof,>=,expecteddof, "not enough values %d<%d", dof%GetDOF(),ORE_InvalidArguments);
 
-    const dReal* pJointValues = &vJointValues[0];
+    const dReal* pJointValues = pvalues;
     if( checklimits != CLA_Nothing || dofindices.size() > 0 ) {
         _vTempJoints.resize(GetDOF());
         if( dofindices.size() > 0 ) {
             // user only set a certain number of indices, so have to fill the temporary array with the full set of values first
             // and then overwrite with the user set values
-            GetDOFValues(_vTempJoints);
+            GetDOFValues(&_vTempJoints[0]);
             for(size_t i = 0; i < dofindices.size(); ++i) {
                 _vTempJoints.at(dofindices[i]) = pJointValues[i];
             }
@@ -1556,7 +1678,6 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
         dReal* ptempjoints = &_vTempJoints[0];
 
         // check the limits
-        vector<dReal> upperlim, lowerlim;
         FOREACHC(it, _vecjoints) {
             const dReal* p = pJointValues+(*it)->GetDOFIndex();
             if( checklimits == CLA_Nothing ) {
@@ -1567,7 +1688,8 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
                 continue;
             }
             OPENRAVE_ASSERT_OP( (*it)->GetDOF(), <=, 3 );
-            (*it)->GetLimits(lowerlim, upperlim);
+            const boost::array<dReal,3>& lowerlim = (*it)->_info._vlowerlimit;
+            const boost::array<dReal,3>& upperlim = (*it)->_info._vupperlimit;
             if( (*it)->GetType() == JointSpherical ) {
                 dReal fcurang = fmod(RaveSqrt(p[0]*p[0]+p[1]*p[1]+p[2]*p[2]),2*PI);
                 if( fcurang < lowerlim[0] ) {
@@ -1631,11 +1753,35 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
         pJointValues = &_vTempJoints[0];
     }
 
+    if( !!_pForwardKinematicsFunctions ) {
+        // generated code computes all the links at once, there are no mimic or moving passive joints
+        _vForwardKinematicsPosesCache.resize(7*_veclinks.size());
+        _pForwardKinematicsFunctions->computelinkposes(pJointValues, &_vForwardKinematicsPosesCache[0]);
+        const Transform tbase = _veclinks[0]->GetTransform();
+        const dReal* ppose = &_vForwardKinematicsPosesCache[7];
+        for(size_t ilink = 1; ilink < _veclinks.size(); ++ilink, ppose += 7) {
+            _veclinks[ilink]->SetTransform(tbase * Transform(Vector(ppose[0], ppose[1], ppose[2], ppose[3]), Vector(ppose[4], ppose[5], ppose[6])));
+        }
+        FOREACH(itjoint, _vecjoints) {
+            if( (*itjoint)->GetType() == JointRevolute ) {
+                (*itjoint)->_doflastsetvalues[0] = pJointValues[(*itjoint)->GetDOFIndex()];
+            }
+        }
+        _vLastSetDOFValues.resize(GetDOF());
+        std::copy(pJointValues, pJointValues+GetDOF(), _vLastSetDOFValues.begin());
+        _UpdateGrabbedBodies();
+        _PostprocessChangedParameters(Prop_LinkTransforms);
+        _nLastSetDOFValuesStamp = _nUpdateStampId;
+        return;
+    }
+
     boost::array<dReal,3> dummyvalues; // dummy values for a joint
-    std::vector<dReal> vtempvalues, veval;
+    std::vector<dReal>& vtempvalues = _vMimicTempValues;
+    std::vector<dReal>& veval = _vMimicEvalValues;
 
     // have to compute the angles ahead of time since they are dependent on the link transformations
-    std::vector< std::vector<dReal> > vPassiveJointValues(_vPassiveJoints.size());
+    std::vector< std::vector<dReal> >& vPassiveJointValues = _vPassiveJointValuesCache;
+    vPassiveJointValues.resize(_vPassiveJoints.size());
     for(size_t i = 0; i < vPassiveJointValues.size(); ++i) {
         if( !_vPassiveJoints[i]->IsMimic() ) {
             _vPassiveJoints[i]->GetValues(vPassiveJointValues[i]);
@@ -1658,13 +1804,22 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
             }
         }
         else {
+            vPassiveJointValues[i].resize(0);
             vPassiveJointValues[i].reserve(_vPassiveJoints[i]->GetDOF()); // do not resize so that we can catch hierarchy errors
         }
     }
 
-    std::vector<uint8_t> vlinkscomputed(_veclinks.size(),0);
+    std::vector<uint8_t>& vlinkscomputed = _vLinksComputedCache;
+    vlinkscomputed.resize(_veclinks.size());
+    std::fill(vlinkscomputed.begin(), vlinkscomputed.end(), 0);
     vlinkscomputed[0] = 1;
 
+    // if nothing else moved the links since the last call, only the links downstream of the joints whose values changed have to be computed
+    bool bIncremental = _nLastSetDOFValuesStamp == _nUpdateStampId && (int)_vLastSetDOFValues.size() == GetDOF();
+    _vLinksUpdatedCache.resize(_veclinks.size());
+    std::fill(_vLinksUpdatedCache.begin(), _vLinksUpdatedCache.end(), 0);
+    bool bAnyLinkUpdated = false;
+
     for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
         JointPtr pjoint = _vTopologicallySortedJointsAll[ijoint];
         int jointindex = _vTopologicallySortedJointIndicesAll[ijoint];
@@ -1688,7 +1843,8 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
                         RAVELOG_WARN(str(boost::format("failed to evaluate joint %s, fparser error %d")%pjoint->GetName()%err));
                     }
                     else {
-                        vector<dReal> vevalcopy = veval;
+                        std::vector<dReal>& vevalcopy = _vMimicEvalValuesCopy;
+                        vevalcopy = veval;
                         vector<dReal>::iterator iteval = veval.begin();
                         while(iteval != veval.end()) {
                             bool removevalue = false;
@@ -1779,6 +1935,35 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
         if( vlinkscomputed[pjoint->GetHierarchyChildLink()->GetIndex()] ) {
             continue;
         }
+        if( bIncremental ) {
+            bool bchanged = !!pjoint->GetHierarchyParentLink() && _vLinksUpdatedCache[pjoint->GetHierarchyParentLink()->GetIndex()];
+            if( !bchanged && dofindex >= 0 ) {
+                for(int i = 0; i < pjoint->GetDOF(); ++i) {
+                    if( pJointValues[dofindex+i] != _vLastSetDOFValues[dofindex+i] ) {
+                        bchanged = true;
+                        break;
+                    }
+                }
+            }
+            if( !bchanged && pjoint->IsMimic() ) {
+                for(int i = 0; i < pjoint->GetDOF() && !bchanged; ++i) {
+                    if( pjoint->IsMimic(i) ) {
+                        FOREACHC(itdof, pjoint->_vmimic[i]->_vdofformat) {
+                            // passive joint values are not tracked, so always compute
+                            if( itdof->dofindex < 0 || pJointValues[itdof->dofindex] != _vLastSetDOFValues[itdof->dofindex] ) {
+                                bchanged = true;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            if( !bchanged ) {
+                // the transform of the child link is the same as the last time it was computed
+                vlinkscomputed[pjoint->GetHierarchyChildLink()->GetIndex()] = 1;
+                continue;
+            }
+        }
         if( !pvalues ) {
             // has to be a passive joint
             pvalues = &vPassiveJointValues.at(jointindex-(int)_vecjoints.size()).at(0);
@@ -1858,10 +2043,95 @@ void KinBody::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t chec
         }
         pjoint->GetHierarchyChildLink()->SetTransform(t);
         vlinkscomputed[pjoint->GetHierarchyChildLink()->GetIndex()] = 1;
+        _vLinksUpdatedCache[pjoint->GetHierarchyChildLink()->GetIndex()] = 1;
+        bAnyLinkUpdated = true;
     }
 
-    _UpdateGrabbedBodies();
+    _vLastSetDOFValues.resize(GetDOF());
+    std::copy(pJointValues, pJointValues+GetDOF(), _vLastSetDOFValues.begin());
+    if( bIncremental ) {
+        if( !bAnyLinkUpdated ) {
+            // nothing moved, so there is nothing to notify
+            _nLastSetDOFValuesStamp = _nUpdateStampId;
+            return;
+        }
+        _UpdateGrabbedBodies(_vLinksUpdatedCache);
+    }
+    else {
+        _UpdateGrabbedBodies();
+    }
     _PostprocessChangedParameters(Prop_LinkTransforms);
+    _nLastSetDOFValuesStamp = _nUpdateStampId;
+}
+
+bool KinBody::SetForwardKinematicsFunctions(ForwardKinematicsFunctionsConstPtr pfunctions)
+{
+    if( !pfunctions ) {
+        _pForwardKinematicsFunctions.reset();
+        return true;
+    }
+    CHECK_INTERNAL_COMPUTATION;
+    if( !pfunctions->computelinkposes || pfunctions->kinematicshash != GetKinematicsGeometryHash() || pfunctions->numdofs != GetDOF() || pfunctions->numlinks != (int)_veclinks.size() ) {
+        RAVELOG_WARN_FORMAT("env=%d, forward kinematics functions with hash %s do not match body %s with hash %s", GetEnv()->GetId()%pfunctions->kinematicshash%GetName()%GetKinematicsGeometryHash());
+        return false;
+    }
+    FOREACHC(itjoint, _vecjoints) {
+        if( (*itjoint)->IsMimic() || ((*itjoint)->GetType() != JointRevolute && (*itjoint)->GetType() != JointPrismatic) ) {
+            RAVELOG_WARN_FORMAT("env=%d, body %s joint %s cannot use generated forward kinematics", GetEnv()->GetId()%GetName()%(*itjoint)->GetName());
+            return false;
+        }
+    }
+    FOREACHC(itjoint, _vPassiveJoints) {
+        if( (*itjoint)->IsMimic() || !(*itjoint)->IsStatic() ) {
+            RAVELOG_WARN_FORMAT("env=%d, body %s passive joint %s cannot use generated forward kinematics", GetEnv()->GetId()%GetName()%(*itjoint)->GetName());
+            return false;
+        }
+    }
+    _pForwardKinematicsFunctions = pfunctions;
+    return true;
+}
+
+bool KinBody::_IsLinkTransformationFromDOFValues() const
+{
+    if( _nHierarchyComputed != 2 || GetDOF() == 0 || _nLastSetDOFValuesStamp != _nUpdateStampId || (int)_vLastSetDOFValues.size() != GetDOF() ) {
+        return false;
+    }
+    // the values of passive joints are read back from the link transformations, so they have to be fixed
+    FOREACHC(itjoint, _vPassiveJoints) {
+        if( !(*itjoint)->IsMimic() && !(*itjoint)->IsStatic() ) {
+            return false;
+        }
+    }
+    if( !_pForwardKinematicsFunctions ) {
+        // links that are not the child of any joint are not set by SetDOFValues
+        if( _vLinksComputedCache.size() != _veclinks.size() ) {
+            return false;
+        }
+        FOREACHC(it, _vLinksComputedCache) {
+            if( !*it ) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void KinBody::_PopStateSaverBuffer(std::vector<dReal>& buffer)
+{
+    if( _vStateSaverBuffersPool.size() > 0 ) {
+        buffer.swap(_vStateSaverBuffersPool.back());
+        _vStateSaverBuffersPool.pop_back();
+    }
+}
+
+void KinBody::_PushStateSaverBuffer(std::vector<dReal>& buffer)
+{
+    // savers are nested, so only a few buffers are needed
+    if( buffer.capacity() > 0 && _vStateSaverBuffersPool.size() < 16 ) {
+        _vStateSaverBuffersPool.push_back(std::vector<dReal>());
+        _vStateSaverBuffersPool.back().swap(buffer);
+    }
+    buffer.clear();
 }
 
 bool KinBody::IsDOFRevolute(int dofindex) const
@@ -1878,6 +2148,11 @@ bool KinBody::IsDOFPrismatic(int dofindex) const
 
 KinBody::LinkPtr KinBody::GetLink(const std::string& linkname) const
 {
+    std::map<std::string, int>::const_iterator itindex = _mapLinkNameIndex.find(linkname);
+    if( itindex != _mapLinkNameIndex.end() && itindex->second < (int)_veclinks.size() && _veclinks[itindex->second]->GetName() == linkname ) {
+        return _veclinks[itindex->second];
+    }
+    // the index is not built before _ComputeInternalInformation
     for(std::vector<LinkPtr>::const_iterator it = _veclinks.begin(); it != _veclinks.end(); ++it) {
         if ( (*it)->GetName() == linkname ) {
             return *it;
@@ -1967,6 +2242,17 @@ int KinBody::GetJointIndex(const std::string& jointname) const
 
 KinBody::JointPtr KinBody::GetJoint(const std::string& jointname) const
 {
+    std::map<std::string, int>::const_iterator itindex = _mapJointNameIndex.find(jointname);
+    if( itindex != _mapJointNameIndex.end() ) {
+        if( itindex->second < (int)_vecjoints.size() ) {
+            if( _vecjoints[itindex->second]->GetName() == jointname ) {
+                return _vecjoints[itindex->second];
+            }
+        }
+        else if( itindex->second-_vecjoints.size() < _vPassiveJoints.size() && _vPassiveJoints[itindex->second-_vecjoints.size()]->GetName() == jointname ) {
+            return _vPassiveJoints[itindex->second-_vecjoints.size()];
+        }
+    }
     FOREACHC(it,_vecjoints) {
         if ((*it)->GetName() == jointname ) {
             return *it;
@@ -1981,6 +2267,16 @@ KinBody::JointPtr KinBody::GetJoint(const std::string& jointname) const
 }
 
 void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position, vector<dReal>& vjacobian,const std::vector<int>& dofindices) const
+{
+    size_t dofstride = dofindices.size() > 0 ? dofindices.size() : GetDOF();
+    vjacobian.resize(3*dofstride);
+    if( dofstride == 0 ) {
+        return;
+    }
+    ComputeJacobianTranslation(linkindex, position, &vjacobian[0], dofindices);
+}
+
+void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position, dReal* pjacobian, const std::vector<int>& dofindices) const
 {
     CHECK_INTERNAL_COMPUTATION;
     OPENRAVE_ASSERT_FORMAT(linkindex >= 0 && linkindex < (int)_veclinks.size(), "body %s bad link index %d (num links %d)", GetName()%linkindex%_veclinks.size(),ORE_InvalidArguments);
@@ -1991,17 +2287,15 @@ void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position,
     else {
         dofstride = GetDOF();
     }
-    vjacobian.resize(3*dofstride);
     if( dofstride == 0 ) {
         return;
     }
-    std::fill(vjacobian.begin(),vjacobian.end(),0);
+    std::fill(pjacobian,pjacobian+3*dofstride,0);
 
     Vector v;
     int offset = linkindex*_veclinks.size();
     int curlink = 0;
-    std::vector<std::pair<int,dReal> > vpartials;
-    std::vector<int> vpartialindices;
+    std::vector<std::pair<int,dReal> >& vpartials = _vPartialsCache;
     std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
     while(_vAllPairsShortestPaths[offset+curlink].first>=0) {
         int jointindex = _vAllPairsShortestPaths[offset+curlink].second;
@@ -2026,11 +2320,11 @@ void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position,
                         std::vector<int>::const_iterator itindex = find(dofindices.begin(),dofindices.end(),dofindex+dof);
                         if( itindex != dofindices.end() ) {
                             size_t index = itindex-dofindices.begin();
-                            vjacobian[index] += v.x; vjacobian[index+dofstride] += v.y; vjacobian[index+2*dofstride] += v.z;
+                            pjacobian[index] += v.x; pjacobian[index+dofstride] += v.y; pjacobian[index+2*dofstride] += v.z;
                         }
                     }
                     else {
-                        vjacobian[dofindex+dof] += v.x; vjacobian[dofstride+dofindex+dof] += v.y; vjacobian[2*dofstride+dofindex+dof] += v.z;
+                        pjacobian[dofindex+dof] += v.x; pjacobian[dofstride+dofindex+dof] += v.y; pjacobian[2*dofstride+dofindex+dof] += v.z;
                     }
                 }
             }
@@ -2072,9 +2366,9 @@ void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position,
                                 }
                                 index = itindex-dofindices.begin();
                             }
-                            vjacobian[index] += v.x;
-                            vjacobian[dofstride+index] += v.y;
-                            vjacobian[2*dofstride+index] += v.z;
+                            pjacobian[index] += v.x;
+                            pjacobian[dofstride+index] += v.y;
+                            pjacobian[2*dofstride+index] += v.z;
                         }
                     }
                 }
@@ -2084,6 +2378,302 @@ void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position,
     }
 }
 
+void KinBody::ComputeJacobians(const std::vector< std::pair<int, Vector> >& vlinkpositions, dReal* ptranslationjacobians, dReal* paxisanglejacobians) const
+{
+    CHECK_INTERNAL_COMPUTATION;
+    const size_t dofstride = GetDOF();
+    const size_t numpositions = vlinkpositions.size();
+    if( dofstride == 0 || numpositions == 0 ) {
+        return;
+    }
+    if( !!ptranslationjacobians ) {
+        std::fill(ptranslationjacobians, ptranslationjacobians+3*dofstride*numpositions, 0);
+    }
+    if( !!paxisanglejacobians ) {
+        std::fill(paxisanglejacobians, paxisanglejacobians+3*dofstride*numpositions, 0);
+    }
+
+    const size_t numalljoints = _vecjoints.size()+_vPassiveJoints.size();
+    std::vector<uint8_t>& vjointsinchain = _vJointsInChainCache;
+    _ComputeJointsInChains(vlinkpositions, vjointsinchain);
+
+    std::vector<std::pair<int,dReal> >& vpartials = _vPartialsCache;
+    std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
+    for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
+        const JointPtr& pjoint = _vTopologicallySortedJointsAll[ijoint];
+        int jointindex = _vTopologicallySortedJointIndicesAll[ijoint];
+        bool bused = false;
+        for(size_t ipos = 0; ipos < numpositions; ++ipos) {
+            if( vjointsinchain[ipos*numalljoints+jointindex] ) {
+                bused = true;
+                break;
+            }
+        }
+        if( !bused ) {
+            continue;
+        }
+
+        bool bactive = jointindex < (int)_vecjoints.size();
+        Vector vanchor = pjoint->GetAnchor();
+        for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
+            if( bactive ) {
+                vpartials.resize(1);
+                vpartials[0] = std::make_pair(pjoint->GetDOFIndex()+idof, dReal(1));
+            }
+            else if( pjoint->IsMimic(idof) ) {
+                // passive joint, its velocity is a combination of the velocities of the dofs it depends on
+                pjoint->_ComputePartialVelocities(vpartials,idof,mapcachedpartials);
+            }
+            else {
+                continue;
+            }
+            bool brevolute = pjoint->IsRevolute(idof);
+            if( !brevolute && !pjoint->IsPrismatic(idof) ) {
+                RAVELOG_WARN("ComputeJacobians joint %d not supported\n", pjoint->GetType());
+                continue;
+            }
+
+            Vector vaxis = pjoint->GetAxis(idof);
+            for(size_t ipos = 0; ipos < numpositions; ++ipos) {
+                if( !vjointsinchain[ipos*numalljoints+jointindex] ) {
+                    continue;
+                }
+                if( !!ptranslationjacobians ) {
+                    Vector v = brevolute ? vaxis.cross(vlinkpositions[ipos].second-vanchor) : vaxis;
+                    dReal* pjacobian = ptranslationjacobians + ipos*3*dofstride;
+                    FOREACHC(itpartial,vpartials) {
+                        int index = itpartial->first;
+                        pjacobian[index] += v.x*itpartial->second;
+                        pjacobian[dofstride+index] += v.y*itpartial->second;
+                        pjacobian[2*dofstride+index] += v.z*itpartial->second;
+                    }
+                }
+                if( !!paxisanglejacobians && brevolute ) {
+                    dReal* pjacobian = paxisanglejacobians + ipos*3*dofstride;
+                    FOREACHC(itpartial,vpartials) {
+                        int index = itpartial->first;
+                        pjacobian[index] += vaxis.x*itpartial->second;
+                        pjacobian[dofstride+index] += vaxis.y*itpartial->second;
+                        pjacobian[2*dofstride+index] += vaxis.z*itpartial->second;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void KinBody::_ComputeJointsInChains(const std::vector< std::pair<int, Vector> >& vlinkpositions, std::vector<uint8_t>& vjointsinchain) const
+{
+    // the passive joint indices have _vecjoints.size() added to them like in _vAllPairsShortestPaths
+    const size_t numalljoints = _vecjoints.size()+_vPassiveJoints.size();
+    vjointsinchain.assign(vlinkpositions.size()*numalljoints, 0);
+    for(size_t ipos = 0; ipos < vlinkpositions.size(); ++ipos) {
+        int linkindex = vlinkpositions[ipos].first;
+        OPENRAVE_ASSERT_FORMAT(linkindex >= 0 && linkindex < (int)_veclinks.size(), "body %s bad link index %d (num links %d)", GetName()%linkindex%_veclinks.size(),ORE_InvalidArguments);
+        int offset = linkindex*_veclinks.size();
+        int curlink = 0;
+        while(_vAllPairsShortestPaths[offset+curlink].first>=0) {
+            int jointindex = _vAllPairsShortestPaths[offset+curlink].second;
+            if( jointindex >= (int)_vecjoints.size() || _vJointsAffectingLinks[jointindex*_veclinks.size()+linkindex] != 0 ) {
+                vjointsinchain[ipos*numalljoints+jointindex] = 1;
+            }
+            curlink = _vAllPairsShortestPaths[offset+curlink].first;
+        }
+    }
+}
+
+void KinBody::ComputeJacobiansAndHessians(const std::vector< std::pair<int, Vector> >& vlinkpositions, dReal* ptranslationjacobians, dReal* paxisanglejacobians, dReal* ptranslationhessians, dReal* paxisanglehessians, std::vector<uint8_t>* pvdofsinchain) const
+{
+    CHECK_INTERNAL_COMPUTATION;
+    const size_t dofstride = GetDOF();
+    const size_t numpositions = vlinkpositions.size();
+    if( !!pvdofsinchain ) {
+        pvdofsinchain->assign(numpositions*dofstride, 0);
+    }
+    if( dofstride == 0 || numpositions == 0 ) {
+        return;
+    }
+
+    const size_t numalljoints = _vecjoints.size()+_vPassiveJoints.size();
+    std::vector<uint8_t>& vjointsinchain = _vJointsInChainCache;
+    _ComputeJointsInChains(vlinkpositions, vjointsinchain);
+
+    // gather the axes of the joints used by any of the positions once
+    JacobianHessianCache& cache = _jacobianHessianCache;
+    cache.vaxes.resize(0);
+    cache.vpartials.resize(0);
+    std::vector<std::pair<int,dReal> >& vjointpartials = _vPartialsCache;
+    std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
+    for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
+        const JointPtr& pjoint = _vTopologicallySortedJointsAll[ijoint];
+        int jointindex = _vTopologicallySortedJointIndicesAll[ijoint];
+        bool bused = false;
+        for(size_t ipos = 0; ipos < numpositions; ++ipos) {
+            if( vjointsinchain[ipos*numalljoints+jointindex] ) {
+                bused = true;
+                break;
+            }
+        }
+        if( !bused ) {
+            continue;
+        }
+        bool bactive = jointindex < (int)_vecjoints.size();
+        for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
+            if( bactive ) {
+                vjointpartials.resize(1);
+                vjointpartials[0] = std::make_pair(pjoint->GetDOFIndex()+idof, dReal(1));
+            }
+            else if( pjoint->IsMimic(idof) ) {
+                pjoint->_ComputePartialVelocities(vjointpartials,idof,mapcachedpartials);
+            }
+            else {
+                continue;
+            }
+            bool brevolute = pjoint->IsRevolute(idof);
+            if( !brevolute && !pjoint->IsPrismatic(idof) ) {
+                RAVELOG_WARN("ComputeJacobiansAndHessians joint %d not supported\n", pjoint->GetType());
+                continue;
+            }
+            JacobianHessianCache::ChainAxis axis;
+            axis.vaxis = pjoint->GetAxis(idof);
+            axis.vanchor = pjoint->GetAnchor();
+            axis.jointindex = jointindex;
+            axis.brevolute = brevolute;
+            axis.partialsbegin = cache.vpartials.size();
+            cache.vpartials.insert(cache.vpartials.end(), vjointpartials.begin(), vjointpartials.end());
+            axis.partialsend = cache.vpartials.size();
+            cache.vaxes.push_back(axis);
+        }
+    }
+
+    const size_t jacobianstride = 3*dofstride, hessianstride = dofstride*3*dofstride;
+    for(size_t ipos = 0; ipos < numpositions; ++ipos) {
+        const Vector& position = vlinkpositions[ipos].second;
+        cache.vchainaxes.resize(0);
+        cache.vchainjacobians.resize(0);
+        for(size_t iaxis = 0; iaxis < cache.vaxes.size(); ++iaxis) {
+            const JacobianHessianCache::ChainAxis& axis = cache.vaxes[iaxis];
+            if( vjointsinchain[ipos*numalljoints+axis.jointindex] ) {
+                cache.vchainaxes.push_back(iaxis);
+                cache.vchainjacobians.push_back(axis.brevolute ? axis.vaxis.cross(position-axis.vanchor) : axis.vaxis);
+            }
+        }
+
+        dReal* ptransjacobian = !!ptranslationjacobians ? ptranslationjacobians + ipos*jacobianstride : NULL;
+        dReal* paxisjacobian = !!paxisanglejacobians ? paxisanglejacobians + ipos*jacobianstride : NULL;
+        dReal* ptranshessian = !!ptranslationhessians ? ptranslationhessians + ipos*hessianstride : NULL;
+        dReal* paxishessian = !!paxisanglehessians ? paxisanglehessians + ipos*hessianstride : NULL;
+        if( !pvdofsinchain ) {
+            if( !!ptransjacobian ) {
+                std::fill(ptransjacobian, ptransjacobian+jacobianstride, 0);
+            }
+            if( !!paxisjacobian ) {
+                std::fill(paxisjacobian, paxisjacobian+jacobianstride, 0);
+            }
+            if( !!ptranshessian ) {
+                std::fill(ptranshessian, ptranshessian+hessianstride, 0);
+            }
+            if( !!paxishessian ) {
+                std::fill(paxishessian, paxishessian+hessianstride, 0);
+            }
+        }
+        else {
+            // only zero the entries of the dofs in the chain, the rest is known to be zero by the caller
+            uint8_t* pdofsinchain = &pvdofsinchain->at(ipos*dofstride);
+            cache.vchaindofs.resize(0);
+            FOREACHC(itaxisindex, cache.vchainaxes) {
+                const JacobianHessianCache::ChainAxis& axis = cache.vaxes[*itaxisindex];
+                for(size_t ipartial = axis.partialsbegin; ipartial < axis.partialsend; ++ipartial) {
+                    int dofindex = cache.vpartials[ipartial].first;
+                    if( !pdofsinchain[dofindex] ) {
+                        pdofsinchain[dofindex] = 1;
+                        cache.vchaindofs.push_back(dofindex);
+                    }
+                }
+            }
+            FOREACHC(itdof, cache.vchaindofs) {
+                for(int j = 0; j < 3; ++j) {
+                    if( !!ptransjacobian ) {
+                        ptransjacobian[j*dofstride+*itdof] = 0;
+                    }
+                    if( !!paxisjacobian ) {
+                        paxisjacobian[j*dofstride+*itdof] = 0;
+                    }
+                    FOREACHC(itdof2, cache.vchaindofs) {
+                        size_t index = (*itdof*3+j)*dofstride+*itdof2;
+                        if( !!ptranshessian ) {
+                            ptranshessian[index] = 0;
+                        }
+                        if( !!paxishessian ) {
+                            paxishessian[index] = 0;
+                        }
+                    }
+                }
+            }
+        }
+
+        for(size_t ichain = 0; ichain < cache.vchainaxes.size(); ++ichain) {
+            const JacobianHessianCache::ChainAxis& axis = cache.vaxes[cache.vchainaxes[ichain]];
+            const Vector& vjacobian = cache.vchainjacobians[ichain];
+            for(size_t ipartial = axis.partialsbegin; ipartial < axis.partialsend; ++ipartial) {
+                int index = cache.vpartials[ipartial].first;
+                dReal fpartial = cache.vpartials[ipartial].second;
+                if( !!ptransjacobian ) {
+                    ptransjacobian[index] += vjacobian.x*fpartial;
+                    ptransjacobian[dofstride+index] += vjacobian.y*fpartial;
+                    ptransjacobian[2*dofstride+index] += vjacobian.z*fpartial;
+                }
+                if( !!paxisjacobian && axis.brevolute ) {
+                    paxisjacobian[index] += axis.vaxis.x*fpartial;
+                    paxisjacobian[dofstride+index] += axis.vaxis.y*fpartial;
+                    paxisjacobian[2*dofstride+index] += axis.vaxis.z*fpartial;
+                }
+            }
+            if( (!ptranshessian && !paxishessian) || !axis.brevolute ) {
+                // prismatic axes do not rotate the axes after them
+                continue;
+            }
+
+            // the axis rotates all the axes after it in the chain, H[i,:,j] = H[j,:,i] = axis_i x jacobian_j
+            for(size_t jchain = ichain; jchain < cache.vchainaxes.size(); ++jchain) {
+                const JacobianHessianCache::ChainAxis& axis2 = cache.vaxes[cache.vchainaxes[jchain]];
+                Vector vtrans = axis.vaxis.cross(cache.vchainjacobians[jchain]);
+                bool baxisangle = !!paxishessian && jchain != ichain && axis2.brevolute;
+                Vector vaxisangle;
+                if( baxisangle ) {
+                    vaxisangle = axis.vaxis.cross(axis2.vaxis);
+                }
+                for(size_t ipartial = axis.partialsbegin; ipartial < axis.partialsend; ++ipartial) {
+                    int index = cache.vpartials[ipartial].first;
+                    for(size_t jpartial = axis2.partialsbegin; jpartial < axis2.partialsend; ++jpartial) {
+                        int index2 = cache.vpartials[jpartial].first;
+                        dReal f = cache.vpartials[ipartial].second*cache.vpartials[jpartial].second;
+                        size_t offset = 3*dofstride*index+index2, offset2 = 3*dofstride*index2+index;
+                        if( !!ptranshessian ) {
+                            ptranshessian[offset] += vtrans.x*f;
+                            ptranshessian[offset+dofstride] += vtrans.y*f;
+                            ptranshessian[offset+2*dofstride] += vtrans.z*f;
+                            if( jchain != ichain ) {
+                                ptranshessian[offset2] += vtrans.x*f;
+                                ptranshessian[offset2+dofstride] += vtrans.y*f;
+                                ptranshessian[offset2+2*dofstride] += vtrans.z*f;
+                            }
+                        }
+                        if( baxisangle ) {
+                            paxishessian[offset] += vaxisangle.x*f;
+                            paxishessian[offset+dofstride] += vaxisangle.y*f;
+                            paxishessian[offset+2*dofstride] += vaxisangle.z*f;
+                            paxishessian[offset2] += vaxisangle.x*f;
+                            paxishessian[offset2+dofstride] += vaxisangle.y*f;
+                            paxishessian[offset2+2*dofstride] += vaxisangle.z*f;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 void KinBody::CalculateJacobian(int linkindex, const Vector& trans, boost::multi_array<dReal,2>& mjacobian) const
 {
     mjacobian.resize(boost::extents[3][GetDOF()]);
@@ -2752,8 +3342,10 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     }
 
     Vector vgravity = GetEnv()->GetPhysicsEngine()->GetGravity();
-    std::vector<dReal> vDOFVelocities;
-    std::vector<pair<Vector, Vector> > vLinkVelocities, vLinkAccelerations; // linear, angular
+    // reuse the buffers of the previous calls of this thread, the vectors keep their capacity
+    InverseDynamicsCache& cache = GetInverseDynamicsCache();
+    std::vector<dReal>& vDOFVelocities = cache.vDOFVelocities;
+    std::vector<pair<Vector, Vector> >& vLinkVelocities = cache.vLinkVelocities, &vLinkAccelerations = cache.vLinkAccelerations; // linear, angular
     _ComputeDOFLinkVelocities(vDOFVelocities, vLinkVelocities);
     // check if all velocities are 0, if yes, then can simplify some computations since only have contributions from dofacell and external forces
     bool bHasVelocity = false;
@@ -2766,9 +3358,11 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     if( !bHasVelocity ) {
         vDOFVelocities.resize(0);
     }
-    AccelerationMap externalaccelerations;
+    AccelerationMap& externalaccelerations = cache.externalaccelerations;
     externalaccelerations[0] = make_pair(-vgravity, Vector());
     AccelerationMapPtr pexternalaccelerations(&externalaccelerations, utils::null_deleter());
+    // _ComputeLinkAccelerations adds to the accelerations it is given
+    vLinkAccelerations.assign(_veclinks.size(), std::pair<Vector, Vector>());
     _ComputeLinkAccelerations(vDOFVelocities, vDOFAccelerations, vLinkVelocities, vLinkAccelerations, pexternalaccelerations);
 
     // all valuess are in the global coordinate system
@@ -2776,7 +3370,9 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     // v_B = v_A + angularvel x (B-A)
     // a_B = a_A + angularaccel x (B-A) + angularvel x (angularvel x (B-A))
     // forward recursion
-    std::vector<Vector> vLinkCOMLinearAccelerations(_veclinks.size()), vLinkCOMMomentOfInertia(_veclinks.size());
+    std::vector<Vector>& vLinkCOMLinearAccelerations = cache.vLinkCOMLinearAccelerations, &vLinkCOMMomentOfInertia = cache.vLinkCOMMomentOfInertia;
+    vLinkCOMLinearAccelerations.resize(_veclinks.size());
+    vLinkCOMMomentOfInertia.resize(_veclinks.size());
     for(size_t i = 0; i < vLinkVelocities.size(); ++i) {
         Vector vglobalcomfromlink = _veclinks.at(i)->GetGlobalCOM() - _veclinks.at(i)->_info._t.trans;
         Vector vangularaccel = vLinkAccelerations.at(i).second;
@@ -2787,13 +3383,14 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     }
 
     // backward recursion
-    std::vector< std::pair<Vector, Vector> > vLinkForceTorques(_veclinks.size());
+    std::vector< std::pair<Vector, Vector> >& vLinkForceTorques = cache.vLinkForceTorques;
+    vLinkForceTorques.assign(_veclinks.size(), std::pair<Vector, Vector>());
     FOREACHC(it,mapExternalForceTorque) {
         vLinkForceTorques.at(it->first) = it->second;
     }
     std::fill(doftorques.begin(),doftorques.end(),0);
 
-    std::vector<std::pair<int,dReal> > vpartials;
+    std::vector<std::pair<int,dReal> >& vpartials = cache.vpartials;
     std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
 
     // go backwards
@@ -2877,6 +3474,38 @@ void KinBody::ComputeInverseDynamics(std::vector<dReal>& doftorques, const std::
     }
 }
 
+void KinBody::ComputeInverseDynamicsSamples(std::vector<dReal>& doftorques, const std::vector<dReal>& vDOFValues, const std::vector<dReal>& vDOFVelocities, const std::vector<dReal>& vDOFAccelerations, const KinBody::ForceTorqueMap& mapExternalForceTorque)
+{
+    CHECK_INTERNAL_COMPUTATION;
+    const int dof = GetDOF();
+    if( dof == 0 ) {
+        doftorques.resize(0);
+        return;
+    }
+    OPENRAVE_ASSERT_OP(vDOFValues.size()%dof,==,0);
+    OPENRAVE_ASSERT_OP(vDOFVelocities.size(),==,vDOFValues.size());
+    if( vDOFAccelerations.size() > 0 ) {
+        OPENRAVE_ASSERT_OP(vDOFAccelerations.size(),==,vDOFValues.size());
+    }
+    const size_t numsamples = vDOFValues.size()/dof;
+    doftorques.resize(numsamples*dof);
+
+    // SetDOFVelocities and ComputeInverseDynamics take vectors, so copy every sample into buffers that keep their capacity
+    InverseDynamicsCache& cache = GetInverseDynamicsCache();
+    std::vector<dReal>& vsamplevelocities = cache.vSampleVelocities, &vsampleaccelerations = cache.vSampleAccelerations, &vsampletorques = cache.vSampleTorques;
+    vsampleaccelerations.resize(0);
+    for(size_t isample = 0; isample < numsamples; ++isample) {
+        SetDOFValues(&vDOFValues[isample*dof], dof, CLA_Nothing);
+        vsamplevelocities.assign(vDOFVelocities.begin()+isample*dof, vDOFVelocities.begin()+(isample+1)*dof);
+        SetDOFVelocities(vsamplevelocities, CLA_Nothing);
+        if( vDOFAccelerations.size() > 0 ) {
+            vsampleaccelerations.assign(vDOFAccelerations.begin()+isample*dof, vDOFAccelerations.begin()+(isample+1)*dof);
+        }
+        ComputeInverseDynamics(vsampletorques, vsampleaccelerations, mapExternalForceTorque);
+        std::copy(vsampletorques.begin(), vsampletorques.end(), doftorques.begin()+isample*dof);
+    }
+}
+
 void KinBody::ComputeInverseDynamics(boost::array< std::vector<dReal>, 3>& vDOFTorqueComponents, const std::vector<dReal>& vDOFAccelerations, const KinBody::ForceTorqueMap& mapExternalForceTorque) const
 {
     CHECK_INTERNAL_COMPUTATION;
@@ -3375,12 +4004,18 @@ CollisionCheckerBasePtr KinBody::GetSelfCollisionChecker() const
 void KinBody::_ComputeInternalInformation()
 {
     uint64_t starttime = utils::GetMicroTime();
+    // the mimic equations below change the update stamp, so check if the body is unchanged since Clone first
+    const bool bFromClone = _nCloneUpdateStamp >= 0 && _nCloneUpdateStamp == _nUpdateStampId;
+    _nCloneUpdateStamp = -1;
     _nHierarchyComputed = 1;
 
     int lindex=0;
     FOREACH(itlink,_veclinks) {
         (*itlink)->_index = lindex; // always reset, necessary since index cannot be initialized by custom links
-        (*itlink)->_vParentLinks.clear();
+        if( !bFromClone ) {
+            (*itlink)->_vParentLinks.clear();
+        }
+        (*itlink)->_InvalidateAABBCache(); // readers can fill the geometries directly
         if((_veclinks.size() > 1)&&((*itlink)->GetName().size() == 0)) {
             RAVELOG_WARN(str(boost::format("%s link index %d has no name")%GetName()%lindex));
         }
@@ -3539,57 +4174,172 @@ void KinBody::_ComputeInternalInformation()
         }
     }
 
-    _vTopologicallySortedJoints.resize(0);
-    _vTopologicallySortedJointsAll.resize(0);
-    _vTopologicallySortedJointIndicesAll.resize(0);
-    _vJointsAffectingLinks.resize(_vecjoints.size()*_veclinks.size());
+    // a clone already copied the hierarchy, the adjacency and the non-adjacent links from an initialized body with the same kinematics
+    if( !bFromClone ) {
+        _ComputeInternalHierarchy();
+    }
 
-    // compute the all-pairs shortest paths
-    {
-        _vAllPairsShortestPaths.resize(_veclinks.size()*_veclinks.size());
+    // name indices for GetLink and GetJoint, keep the first of duplicate names like the linear search
+    _mapLinkNameIndex.clear();
+    for(int ilink = (int)_veclinks.size()-1; ilink >= 0; --ilink) {
+        _mapLinkNameIndex[_veclinks[ilink]->GetName()] = ilink;
+    }
+    _mapJointNameIndex.clear();
+    for(int ijoint = (int)_vPassiveJoints.size()-1; ijoint >= 0; --ijoint) {
+        _mapJointNameIndex[_vPassiveJoints[ijoint]->GetName()] = _vecjoints.size()+ijoint;
+    }
+    for(int ijoint = (int)_vecjoints.size()-1; ijoint >= 0; --ijoint) {
+        _mapJointNameIndex[_vecjoints[ijoint]->GetName()] = ijoint;
+    }
+    _nHierarchyComputed = 2;
+    if( !!_pForwardKinematicsFunctions ) {
+        // the kinematics could have changed, so only keep the generated code if it still matches
+        ForwardKinematicsFunctionsConstPtr pfunctions = _pForwardKinematicsFunctions;
+        _pForwardKinematicsFunctions.reset();
+        SetForwardKinematicsFunctions(pfunctions);
+    }
+    // because of mimic joints, need to call SetDOFValues at least once, also use this to check for links that are off
+    {
+        vector<Transform> vprevtrans, vnewtrans;
+        vector<dReal> vprevdoflastsetvalues, vnewdoflastsetvalues;
+        GetLinkTransformations(vprevtrans, vprevdoflastsetvalues);
+        vector<dReal> vcurrentvalues;
+        // unfortunately if SetDOFValues is overloaded by the robot, it could call the robot's _UpdateGrabbedBodies, which is a problem during environment cloning since the grabbed bodies might not be initialized. Therefore, call KinBody::SetDOFValues
+        GetDOFValues(vcurrentvalues);
+        std::vector<UserDataPtr> vGrabbedBodies; vGrabbedBodies.swap(_vGrabbedBodies); // swap to get rid of _vGrabbedBodies
+        KinBody::SetDOFValues(vcurrentvalues,CLA_CheckLimits, std::vector<int>());
+        vGrabbedBodies.swap(_vGrabbedBodies); // swap back
+        GetLinkTransformations(vnewtrans, vnewdoflastsetvalues);
+        for(size_t i = 0; i < vprevtrans.size(); ++i) {
+            if( TransformDistanceFast(vprevtrans[i],vnewtrans[i]) > 1e-5 ) {
+                RAVELOG_VERBOSE(str(boost::format("link %d has different transformation after SetDOFValues (error=%f), this could be due to mimic joint equations kicking into effect.")%_veclinks.at(i)->GetName()%TransformDistanceFast(vprevtrans[i],vnewtrans[i])));
+            }
+        }
+        for(int i = 0; i < GetDOF(); ++i) {
+            if( vprevdoflastsetvalues.at(i) != vnewdoflastsetvalues.at(i) ) {
+                RAVELOG_VERBOSE(str(boost::format("dof %d has different values after SetDOFValues %d!=%d, this could be due to mimic joint equations kicking into effect.")%i%vprevdoflastsetvalues.at(i)%vnewdoflastsetvalues.at(i)));
+            }
+        }
+        if( !bFromClone ) {
+            // a clone keeps the initial transformations its non-adjacent links were computed with
+            _vInitialLinkTransformations = vnewtrans;
+        }
+    }
+
+    {
+        // do not initialize interpolation, since it implies a motion sampling strategy
+        int offset = 0;
+        _spec._vgroups.resize(0);
+        if( GetDOF() > 0 ) {
+            ConfigurationSpecification::Group group;
+            stringstream ss;
+            ss << "joint_values " << GetName();
+            for(int i = 0; i < GetDOF(); ++i) {
+                ss << " " << i;
+            }
+            group.name = ss.str();
+            group.dof = GetDOF();
+            group.offset = offset;
+            offset += group.dof;
+            _spec._vgroups.push_back(group);
+        }
+
+        ConfigurationSpecification::Group group;
+        group.name = str(boost::format("affine_transform %s %d")%GetName()%DOF_Transform);
+        group.offset = offset;
+        group.dof = RaveGetAffineDOF(DOF_Transform);
+        _spec._vgroups.push_back(group);
+    }
+
+    // set the "self" extra geometry group
+    std::string selfgroup("self");
+    FOREACH(itlink, _veclinks) {
+        if( (*itlink)->_info._mapExtraGeometries.find(selfgroup) == (*itlink)->_info._mapExtraGeometries.end() ) {
+            std::vector<GeometryInfoPtr> vgeoms;
+            FOREACH(itgeom, (*itlink)->_vGeometries) {
+                vgeoms.push_back(GeometryInfoPtr(new GeometryInfo((*itgeom)->GetInfo())));
+            }
+            (*itlink)->_info._mapExtraGeometries.insert(make_pair(selfgroup, vgeoms));
+        }
+    }
+
+    _bAreAllJoints1DOFAndNonCircular = true;
+    for (size_t ijoint = 0; ijoint < _vecjoints.size(); ++ijoint) {
+        if (_vecjoints[ijoint]->GetDOF() != 1 || _vecjoints[ijoint]->IsCircular()) {
+            _bAreAllJoints1DOFAndNonCircular = false;
+            break;
+        }
+    }
+
+    // notify any callbacks of the changes
+    uint32_t parameters = _nParametersChanged;
+    _nParametersChanged = 0;
+    _NotifyChangeCallbacks(parameters);
+    RAVELOG_VERBOSE_FORMAT("initialized %s in %fs", GetName()%(1e-6*(utils::GetMicroTime()-starttime)));
+}
+
+void KinBody::_ComputeInternalHierarchy()
+{
+    _vTopologicallySortedJoints.resize(0);
+    _vTopologicallySortedJointsAll.resize(0);
+    _vTopologicallySortedJointIndicesAll.resize(0);
+    _vJointsAffectingLinks.resize(_vecjoints.size()*_veclinks.size());
+
+    // compute the all-pairs shortest paths with a breadth first search from every link, which is O(links*(links+joints)) instead of the cubic Floyd-Warshall since the link graph is sparse
+    {
+        const size_t numlinks = _veclinks.size();
+        _vAllPairsShortestPaths.resize(numlinks*numlinks);
         FOREACH(it,_vAllPairsShortestPaths) {
             it->first = -1;
             it->second = -1;
         }
-        vector<uint32_t> vcosts(_veclinks.size()*_veclinks.size(),0x3fffffff); // initialize to 2^30-1 since we'll be adding
-        for(size_t i = 0; i < _veclinks.size(); ++i) {
-            vcosts[i*_veclinks.size()+i] = 0;
-        }
-        FOREACHC(itjoint,_vecjoints) {
-            if( !!(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() ) {
-                int index = (*itjoint)->GetFirstAttached()->GetIndex()*_veclinks.size()+(*itjoint)->GetSecondAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetFirstAttached()->GetIndex(),(*itjoint)->GetJointIndex());
-                vcosts[index] = 1;
-                index = (*itjoint)->GetSecondAttached()->GetIndex()*_veclinks.size()+(*itjoint)->GetFirstAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetSecondAttached()->GetIndex(),(*itjoint)->GetJointIndex());
-                vcosts[index] = 1;
+        // for every link the neighboring links and the joint connecting them, a later joint between the same links replaces the earlier one
+        std::vector< std::vector< std::pair<int, int> > > vlinkneighbors(numlinks);
+        for(int ijoints = 0; ijoints < 2; ++ijoints) {
+            const std::vector<JointPtr>& vjoints = ijoints ? _vPassiveJoints : _vecjoints;
+            int jointindex = ijoints ? (int)_vecjoints.size() : 0;
+            FOREACHC(itjoint,vjoints) {
+                if( !!(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() ) {
+                    int index0 = (*itjoint)->GetFirstAttached()->GetIndex(), index1 = (*itjoint)->GetSecondAttached()->GetIndex();
+                    if( index0 == index1 ) {
+                        _vAllPairsShortestPaths[index0*numlinks+index0] = std::pair<int16_t,int16_t>(index0,jointindex);
+                    }
+                    else {
+                        for(int iside = 0; iside < 2; ++iside) {
+                            std::vector< std::pair<int, int> >& vneighbors = vlinkneighbors[iside ? index1 : index0];
+                            int neighborindex = iside ? index0 : index1;
+                            std::vector< std::pair<int, int> >::iterator itneighbor = vneighbors.begin();
+                            while(itneighbor != vneighbors.end() && itneighbor->first != neighborindex) {
+                                ++itneighbor;
+                            }
+                            if( itneighbor != vneighbors.end() ) {
+                                itneighbor->second = jointindex;
+                            }
+                            else {
+                                vneighbors.emplace_back(neighborindex, jointindex);
+                            }
+                        }
+                    }
+                }
+                ++jointindex;
             }
         }
-        int jointindex = (int)_vecjoints.size();
-        FOREACHC(itjoint,_vPassiveJoints) {
-            if( !!(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() ) {
-                int index = (*itjoint)->GetFirstAttached()->GetIndex()*_veclinks.size()+(*itjoint)->GetSecondAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetFirstAttached()->GetIndex(),jointindex);
-                vcosts[index] = 1;
-                index = (*itjoint)->GetSecondAttached()->GetIndex()*_veclinks.size()+(*itjoint)->GetFirstAttached()->GetIndex();
-                _vAllPairsShortestPaths[index] = std::pair<int16_t,int16_t>((*itjoint)->GetSecondAttached()->GetIndex(),jointindex);
-                vcosts[index] = 1;
-            }
-            ++jointindex;
-        }
-        for(size_t k = 0; k < _veclinks.size(); ++k) {
-            for(size_t i = 0; i < _veclinks.size(); ++i) {
-                if( i == k ) {
-                    continue;
-                }
-                for(size_t j = 0; j < _veclinks.size(); ++j) {
-                    if((j == i)||(j == k)) {
-                        continue;
-                    }
-                    uint32_t kcost = vcosts[k*_veclinks.size()+i] + vcosts[j*_veclinks.size()+k];
-                    if( vcosts[j*_veclinks.size()+i] > kcost ) {
-                        vcosts[j*_veclinks.size()+i] = kcost;
-                        _vAllPairsShortestPaths[j*_veclinks.size()+i] = _vAllPairsShortestPaths[k*_veclinks.size()+i];
+        // the entry of a link on the path towards the destination link is the next link and the joint connecting them
+        std::vector<int> vqueue; vqueue.reserve(numlinks);
+        std::vector<uint8_t> vvisited(numlinks);
+        for(size_t idest = 0; idest < numlinks; ++idest) {
+            std::pair<int16_t,int16_t>* ppaths = &_vAllPairsShortestPaths[idest*numlinks];
+            std::fill(vvisited.begin(), vvisited.end(), 0);
+            vvisited[idest] = 1;
+            vqueue.resize(0);
+            vqueue.push_back(idest);
+            for(size_t iqueue = 0; iqueue < vqueue.size(); ++iqueue) {
+                int curlink = vqueue[iqueue];
+                FOREACHC(itneighbor, vlinkneighbors[curlink]) {
+                    if( !vvisited[itneighbor->first] ) {
+                        vvisited[itneighbor->first] = 1;
+                        ppaths[itneighbor->first] = std::pair<int16_t,int16_t>(curlink, itneighbor->second);
+                        vqueue.push_back(itneighbor->first);
                     }
                 }
             }
@@ -3726,6 +4476,12 @@ void KinBody::_ComputeInternalInformation()
 
         // build up a directed graph of joint dependencies
         int numjoints = (int)(_vecjoints.size()+_vPassiveJoints.size());
+        // edges sorted by link depth have the weight depthweight-depth so the edges closer to the root are removed first when breaking cycles.
+        // it has to stay above the static and mimic levels, so grow it for bodies that are deeper than 100 links
+        int depthweight = 100;
+        FOREACHC(itdepth, vlinkdepths) {
+            depthweight = max(depthweight, *itdepth+3);
+        }
         // build the adjacency list
         vector<int> vjointadjacency(numjoints*numjoints,0);
         for(int ij0 = 0; ij0 < numjoints; ++ij0) {
@@ -3764,40 +4520,42 @@ void KinBody::_ComputeInternalInformation()
                 int j1l1 = vlinkdepths[j1->GetSecondAttached()->GetIndex()];
                 int diff = min(j0l0,j0l1) - min(j1l0,j1l1);
                 if( diff < 0 ) {
-                    OPENRAVE_ASSERT_OP(min(j0l0,j0l1),<,100);
-                    vjointadjacency[ij0*numjoints+ij1] = 100-min(j0l0,j0l1);
+                    OPENRAVE_ASSERT_OP(min(j0l0,j0l1),<,depthweight);
+                    vjointadjacency[ij0*numjoints+ij1] = depthweight-min(j0l0,j0l1);
                     continue;
                 }
                 if( diff > 0 ) {
-                    OPENRAVE_ASSERT_OP(min(j1l0,j1l1),<,100);
-                    vjointadjacency[ij1*numjoints+ij0] = 100-min(j1l0,j1l1);
+                    OPENRAVE_ASSERT_OP(min(j1l0,j1l1),<,depthweight);
+                    vjointadjacency[ij1*numjoints+ij0] = depthweight-min(j1l0,j1l1);
                     continue;
                 }
                 diff = max(j0l0,j0l1) - max(j1l0,j1l1);
                 if( diff < 0 ) {
-                    OPENRAVE_ASSERT_OP(max(j0l0,j0l1),<,100);
-                    vjointadjacency[ij0*numjoints+ij1] = 100-max(j0l0,j0l1);
+                    OPENRAVE_ASSERT_OP(max(j0l0,j0l1),<,depthweight);
+                    vjointadjacency[ij0*numjoints+ij1] = depthweight-max(j0l0,j0l1);
                     continue;
                 }
                 if( diff > 0 ) {
-                    OPENRAVE_ASSERT_OP(max(j1l0,j1l1),<,100);
-                    vjointadjacency[ij1*numjoints+ij0] = 100-max(j1l0,j1l1);
+                    OPENRAVE_ASSERT_OP(max(j1l0,j1l1),<,depthweight);
+                    vjointadjacency[ij1*numjoints+ij0] = depthweight-max(j1l0,j1l1);
                     continue;
                 }
             }
         }
         // topologically sort the joints
         _vTopologicallySortedJointIndicesAll.resize(0); _vTopologicallySortedJointIndicesAll.reserve(numjoints);
-        std::list<int> noincomingedges;
-        for(int i = 0; i < numjoints; ++i) {
-            bool hasincoming = false;
-            for(int j = 0; j < numjoints; ++j) {
+        // count the incoming edges of every joint so that removing an edge does not have to scan the column again
+        std::vector<int> vnumincomingedges(numjoints,0);
+        for(int j = 0; j < numjoints; ++j) {
+            for(int i = 0; i < numjoints; ++i) {
                 if( vjointadjacency[j*numjoints+i] ) {
-                    hasincoming = true;
-                    break;
+                    ++vnumincomingedges[i];
                 }
             }
-            if( !hasincoming ) {
+        }
+        std::list<int> noincomingedges;
+        for(int i = 0; i < numjoints; ++i) {
+            if( vnumincomingedges[i] == 0 ) {
                 noincomingedges.push_back(i);
             }
         }
@@ -3811,14 +4569,7 @@ void KinBody::_ComputeInternalInformation()
                 for(int i = 0; i < numjoints; ++i) {
                     if( vjointadjacency[n*numjoints+i] ) {
                         vjointadjacency[n*numjoints+i] = 0;
-                        bool hasincoming = false;
-                        for(int j = 0; j < numjoints; ++j) {
-                            if( vjointadjacency[j*numjoints+i] ) {
-                                hasincoming = true;
-                                break;
-                            }
-                        }
-                        if( !hasincoming ) {
+                        if( --vnumincomingedges[i] == 0 ) {
                             noincomingedges.push_back(i);
                         }
                     }
@@ -3843,14 +4594,7 @@ void KinBody::_ComputeInternalInformation()
                 }
                 // remove this edge
                 vjointadjacency[imaxadjind] = 0;
-                bool hasincoming = false;
-                for(int j = 0; j < numjoints; ++j) {
-                    if( vjointadjacency[j*numjoints+isecond] ) {
-                        hasincoming = true;
-                        break;
-                    }
-                }
-                if( !hasincoming ) {
+                if( --vnumincomingedges[isecond] == 0 ) {
                     noincomingedges.push_back(isecond);
                 }
             }
@@ -4009,60 +4753,63 @@ void KinBody::_ComputeInternalInformation()
     }
 
     // compute the rigidly attached links
-    for(size_t ilink = 0; ilink < _veclinks.size(); ++ilink) {
-        vector<int>& vattachedlinks = _veclinks[ilink]->_vRigidlyAttachedLinks;
-        vattachedlinks.resize(0);
-        vattachedlinks.push_back(ilink);
-        if((ilink == 0)|| _veclinks[ilink]->IsStatic() ) {
-            FOREACHC(itlink,_veclinks) {
-                if( (*itlink)->IsStatic() ) {
-                    if( (*itlink)->GetIndex() != (int)ilink ) {
-                        vattachedlinks.push_back((*itlink)->GetIndex());
-                    }
+    {
+        // the links connected by static joints in the order the joints are stored, so the breadth first search does not have to go through all joints for every link
+        std::vector< std::vector<int> > vstaticneighbors(_veclinks.size());
+        for(int ijoints = 0; ijoints < 2; ++ijoints) {
+            const std::vector<JointPtr>& vjoints = ijoints ? _vPassiveJoints : _vecjoints;
+            FOREACHC(itjoint, vjoints) {
+                if( (*itjoint)->IsStatic() && !!(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() ) {
+                    vstaticneighbors.at((*itjoint)->GetFirstAttached()->GetIndex()).push_back((*itjoint)->GetSecondAttached()->GetIndex());
+                    vstaticneighbors.at((*itjoint)->GetSecondAttached()->GetIndex()).push_back((*itjoint)->GetFirstAttached()->GetIndex());
                 }
             }
-            FOREACHC(itjoint, GetJoints()) {
-                if( (*itjoint)->IsStatic() ) {
-                    if( !(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() && !(*itjoint)->GetSecondAttached()->IsStatic() ) {
-                        vattachedlinks.push_back((*itjoint)->GetSecondAttached()->GetIndex());
-                    }
-                    if( !(*itjoint)->GetSecondAttached() && !!(*itjoint)->GetFirstAttached() && !(*itjoint)->GetFirstAttached()->IsStatic() ) {
-                        vattachedlinks.push_back((*itjoint)->GetFirstAttached()->GetIndex());
+        }
+        std::vector<uint8_t> vattached(_veclinks.size());
+        for(size_t ilink = 0; ilink < _veclinks.size(); ++ilink) {
+            vector<int>& vattachedlinks = _veclinks[ilink]->_vRigidlyAttachedLinks;
+            vattachedlinks.resize(0);
+            vattachedlinks.push_back(ilink);
+            if((ilink == 0)|| _veclinks[ilink]->IsStatic() ) {
+                FOREACHC(itlink,_veclinks) {
+                    if( (*itlink)->IsStatic() ) {
+                        if( (*itlink)->GetIndex() != (int)ilink ) {
+                            vattachedlinks.push_back((*itlink)->GetIndex());
+                        }
                     }
                 }
-            }
-            FOREACHC(itpassive, GetPassiveJoints()) {
-                if( (*itpassive)->IsStatic() ) {
-                    if( !(*itpassive)->GetFirstAttached() && !!(*itpassive)->GetSecondAttached() && !(*itpassive)->GetSecondAttached()->IsStatic() ) {
-                        vattachedlinks.push_back((*itpassive)->GetSecondAttached()->GetIndex());
+                FOREACHC(itjoint, GetJoints()) {
+                    if( (*itjoint)->IsStatic() ) {
+                        if( !(*itjoint)->GetFirstAttached() && !!(*itjoint)->GetSecondAttached() && !(*itjoint)->GetSecondAttached()->IsStatic() ) {
+                            vattachedlinks.push_back((*itjoint)->GetSecondAttached()->GetIndex());
+                        }
+                        if( !(*itjoint)->GetSecondAttached() && !!(*itjoint)->GetFirstAttached() && !(*itjoint)->GetFirstAttached()->IsStatic() ) {
+                            vattachedlinks.push_back((*itjoint)->GetFirstAttached()->GetIndex());
+                        }
                     }
-                    if( !(*itpassive)->GetSecondAttached() && !!(*itpassive)->GetFirstAttached() && !(*itpassive)->GetFirstAttached()->IsStatic() ) {
-                        vattachedlinks.push_back((*itpassive)->GetFirstAttached()->GetIndex());
+                }
+                FOREACHC(itpassive, GetPassiveJoints()) {
+                    if( (*itpassive)->IsStatic() ) {
+                        if( !(*itpassive)->GetFirstAttached() && !!(*itpassive)->GetSecondAttached() && !(*itpassive)->GetSecondAttached()->IsStatic() ) {
+                            vattachedlinks.push_back((*itpassive)->GetSecondAttached()->GetIndex());
+                        }
+                        if( !(*itpassive)->GetSecondAttached() && !!(*itpassive)->GetFirstAttached() && !(*itpassive)->GetFirstAttached()->IsStatic() ) {
+                            vattachedlinks.push_back((*itpassive)->GetFirstAttached()->GetIndex());
+                        }
                     }
                 }
             }
-        }
 
-        // breadth first search for rigid links
-        for(size_t icurlink = 0; icurlink<vattachedlinks.size(); ++icurlink) {
-            LinkPtr plink=_veclinks.at(vattachedlinks[icurlink]);
-            FOREACHC(itjoint, _vecjoints) {
-                if( (*itjoint)->IsStatic() ) {
-                    if(((*itjoint)->GetFirstAttached() == plink)&& !!(*itjoint)->GetSecondAttached() &&(find(vattachedlinks.begin(),vattachedlinks.end(),(*itjoint)->GetSecondAttached()->GetIndex()) == vattachedlinks.end())) {
-                        vattachedlinks.push_back((*itjoint)->GetSecondAttached()->GetIndex());
-                    }
-                    if(((*itjoint)->GetSecondAttached() == plink)&& !!(*itjoint)->GetFirstAttached() &&(find(vattachedlinks.begin(),vattachedlinks.end(),(*itjoint)->GetFirstAttached()->GetIndex()) == vattachedlinks.end())) {
-                        vattachedlinks.push_back((*itjoint)->GetFirstAttached()->GetIndex());
-                    }
-                }
+            // breadth first search for rigid links
+            std::fill(vattached.begin(), vattached.end(), 0);
+            FOREACHC(itattached, vattachedlinks) {
+                vattached.at(*itattached) = 1;
             }
-            FOREACHC(itpassive, _vPassiveJoints) {
-                if( (*itpassive)->IsStatic() ) {
-                    if(((*itpassive)->GetFirstAttached() == plink)&& !!(*itpassive)->GetSecondAttached() &&(find(vattachedlinks.begin(),vattachedlinks.end(),(*itpassive)->GetSecondAttached()->GetIndex()) == vattachedlinks.end())) {
-                        vattachedlinks.push_back((*itpassive)->GetSecondAttached()->GetIndex());
-                    }
-                    if(((*itpassive)->GetSecondAttached() == plink)&& !!(*itpassive)->GetFirstAttached() &&(find(vattachedlinks.begin(),vattachedlinks.end(),(*itpassive)->GetFirstAttached()->GetIndex()) == vattachedlinks.end())) {
-                        vattachedlinks.push_back((*itpassive)->GetFirstAttached()->GetIndex());
+            for(size_t icurlink = 0; icurlink<vattachedlinks.size(); ++icurlink) {
+                FOREACHC(itneighbor, vstaticneighbors.at(vattachedlinks[icurlink])) {
+                    if( !vattached[*itneighbor] ) {
+                        vattached[*itneighbor] = 1;
+                        vattachedlinks.push_back(*itneighbor);
                     }
                 }
             }
@@ -4079,12 +4826,20 @@ void KinBody::_ComputeInternalInformation()
             RAVELOG_WARN(str(boost::format("%s passive joint index %d has no name")%GetName()%ijoint));
         }
     }
-    for(size_t ijoint0 = 0; ijoint0 < _vTopologicallySortedJointsAll.size(); ++ijoint0 ) {
-        JointPtr pjoint0 = _vTopologicallySortedJointsAll[ijoint0];
-        for(size_t ijoint1 = ijoint0+1; ijoint1 < _vTopologicallySortedJointsAll.size(); ++ijoint1 ) {
-            JointPtr pjoint1 = _vTopologicallySortedJointsAll[ijoint1];
-            if( pjoint0->GetName() == pjoint1->GetName() && (pjoint0->GetJointIndex() >= 0 || pjoint1->GetJointIndex() >= 0) ) {
-                throw OPENRAVE_EXCEPTION_FORMAT(_("joint indices %d and %d share the same name '%s'"), pjoint0->GetJointIndex()%pjoint1->GetJointIndex()%pjoint0->GetName(), ORE_InvalidState);
+    {
+        // passive joints are allowed to share names with each other, so remember the first joint and the first active joint of every name
+        std::map<std::string, std::pair<JointPtr, JointPtr> > mapjointnames;
+        FOREACHC(itjoint, _vTopologicallySortedJointsAll) {
+            std::pair<JointPtr, JointPtr>& jointnames = mapjointnames[(*itjoint)->GetName()];
+            JointPtr pjoint0 = (*itjoint)->GetJointIndex() >= 0 ? jointnames.first : jointnames.second;
+            if( !!pjoint0 ) {
+                throw OPENRAVE_EXCEPTION_FORMAT(_("joint indices %d and %d share the same name '%s'"), pjoint0->GetJointIndex()%(*itjoint)->GetJointIndex()%pjoint0->GetName(), ORE_InvalidState);
+            }
+            if( !jointnames.first ) {
+                jointnames.first = *itjoint;
+            }
+            if( !jointnames.second && (*itjoint)->GetJointIndex() >= 0 ) {
+                jointnames.second = *itjoint;
             }
         }
     }
@@ -4150,121 +4905,40 @@ void KinBody::_ComputeInternalInformation()
                 }
             }
 
-            // if a pair links has exactly one non-static joint in the middle, then make the pair adjacent
-            vector<JointPtr> vjoints;
-            for(int i = 0; i < (int)_veclinks.size()-1; ++i) {
-                for(int j = i+1; j < (int)_veclinks.size(); ++j) {
-                    GetChain(i,j,vjoints);
-                    size_t numstatic = 0;
-                    FOREACH(it,vjoints) {
-                        numstatic += (*it)->IsStatic();
-                    }
-                    if( numstatic+1 >= vjoints.size() ) {
-                        if( i < j ) {
-                            _setAdjacentLinks.insert(i|(j<<16));
-                        }
-                        else {
-                            _setAdjacentLinks.insert(j|(i<<16));
+            // if a pair links has exactly one non-static joint in the middle, then make the pair adjacent.
+            // the number of non-static joints on the chain is memoized along the shortest paths towards every link instead of calling GetChain for every pair
+            const int numlinks = (int)_veclinks.size();
+            std::vector<int> vnumnonstatic(numlinks), vchain;
+            for(int j = 1; j < numlinks; ++j) {
+                const std::pair<int16_t,int16_t>* ppaths = &_vAllPairsShortestPaths[j*numlinks];
+                std::fill(vnumnonstatic.begin(), vnumnonstatic.end(), -1);
+                vnumnonstatic[j] = 0;
+                for(int i = 0; i < j; ++i) {
+                    int curlink = i;
+                    vchain.resize(0);
+                    while(vnumnonstatic[curlink] < 0) {
+                        if( ppaths[curlink].first < 0 ) {
+                            vnumnonstatic[curlink] = 0; // disconnected, GetChain returns no joints
+                            break;
                         }
+                        vchain.push_back(curlink);
+                        curlink = ppaths[curlink].first;
+                    }
+                    while(!vchain.empty()) {
+                        int prevlink = vchain.back();
+                        vchain.pop_back();
+                        int jointindex = ppaths[prevlink].second;
+                        JointPtr pjoint = jointindex < (int)_vecjoints.size() ? _vecjoints.at(jointindex) : _vPassiveJoints.at(jointindex-_vecjoints.size());
+                        vnumnonstatic[prevlink] = vnumnonstatic[ppaths[prevlink].first] + !pjoint->IsStatic();
+                    }
+                    if( vnumnonstatic[i] <= 1 ) {
+                        _setAdjacentLinks.insert(i|(j<<16));
                     }
                 }
             }
         }
         _ResetInternalCollisionCache();
     }
-    _nHierarchyComputed = 2;
-    // because of mimic joints, need to call SetDOFValues at least once, also use this to check for links that are off
-    {
-        vector<Transform> vprevtrans, vnewtrans;
-        vector<dReal> vprevdoflastsetvalues, vnewdoflastsetvalues;
-        GetLinkTransformations(vprevtrans, vprevdoflastsetvalues);
-        vector<dReal> vcurrentvalues;
-        // unfortunately if SetDOFValues is overloaded by the robot, it could call the robot's _UpdateGrabbedBodies, which is a problem during environment cloning since the grabbed bodies might not be initialized. Therefore, call KinBody::SetDOFValues
-        GetDOFValues(vcurrentvalues);
-        std::vector<UserDataPtr> vGrabbedBodies; vGrabbedBodies.swap(_vGrabbedBodies); // swap to get rid of _vGrabbedBodies
-        KinBody::SetDOFValues(vcurrentvalues,CLA_CheckLimits, std::vector<int>());
-        vGrabbedBodies.swap(_vGrabbedBodies); // swap back
-        GetLinkTransformations(vnewtrans, vnewdoflastsetvalues);
-        for(size_t i = 0; i < vprevtrans.size(); ++i) {
-            if( TransformDistanceFast(vprevtrans[i],vnewtrans[i]) > 1e-5 ) {
-                RAVELOG_VERBOSE(str(boost::format("link %d has different transformation after SetDOFValues (error=%f), this could be due to mimic joint equations kicking into effect.")%_veclinks.at(i)->GetName()%TransformDistanceFast(vprevtrans[i],vnewtrans[i])));
-            }
-        }
-        for(int i = 0; i < GetDOF(); ++i) {
-            if( vprevdoflastsetvalues.at(i) != vnewdoflastsetvalues.at(i) ) {
-                RAVELOG_VERBOSE(str(boost::format("dof %d has different values after SetDOFValues %d!=%d, this could be due to mimic joint equations kicking into effect.")%i%vprevdoflastsetvalues.at(i)%vnewdoflastsetvalues.at(i)));
-            }
-        }
-        _vInitialLinkTransformations = vnewtrans;
-    }
-
-    {
-        // do not initialize interpolation, since it implies a motion sampling strategy
-        int offset = 0;
-        _spec._vgroups.resize(0);
-        if( GetDOF() > 0 ) {
-            ConfigurationSpecification::Group group;
-            stringstream ss;
-            ss << "joint_values " << GetName();
-            for(int i = 0; i < GetDOF(); ++i) {
-                ss << " " << i;
-            }
-            group.name = ss.str();
-            group.dof = GetDOF();
-            group.offset = offset;
-            offset += group.dof;
-            _spec._vgroups.push_back(group);
-        }
-
-        ConfigurationSpecification::Group group;
-        group.name = str(boost::format("affine_transform %s %d")%GetName()%DOF_Transform);
-        group.offset = offset;
-        group.dof = RaveGetAffineDOF(DOF_Transform);
-        _spec._vgroups.push_back(group);
-    }
-
-    // set the "self" extra geometry group
-    std::string selfgroup("self");
-    FOREACH(itlink, _veclinks) {
-        if( (*itlink)->_info._mapExtraGeometries.find(selfgroup) == (*itlink)->_info._mapExtraGeometries.end() ) {
-            std::vector<GeometryInfoPtr> vgeoms;
-            FOREACH(itgeom, (*itlink)->_vGeometries) {
-                vgeoms.push_back(GeometryInfoPtr(new GeometryInfo((*itgeom)->GetInfo())));
-            }
-            (*itlink)->_info._mapExtraGeometries.insert(make_pair(selfgroup, vgeoms));
-        }
-    }
-
-    _bAreAllJoints1DOFAndNonCircular = true;
-    for (size_t ijoint = 0; ijoint < _vecjoints.size(); ++ijoint) {
-        if (_vecjoints[ijoint]->GetDOF() != 1 || _vecjoints[ijoint]->IsCircular()) {
-            _bAreAllJoints1DOFAndNonCircular = false;
-            break;
-        }
-    }
-
-    // notify any callbacks of the changes
-    std::list<UserDataWeakPtr> listRegisteredCallbacks;
-    uint32_t index = 0;
-    uint32_t parameters = _nParametersChanged;
-    while(parameters && index < _vlistRegisteredCallbacks.size()) {
-        if( (parameters & 1) &&  _vlistRegisteredCallbacks.at(index).size() > 0 ) {
-            {
-                boost::shared_lock< boost::shared_mutex > lock(GetInterfaceMutex());
-                listRegisteredCallbacks = _vlistRegisteredCallbacks.at(index); // copy since it can be changed
-            }
-            FOREACH(it,listRegisteredCallbacks) {
-                ChangeCallbackDataPtr pdata = boost::dynamic_pointer_cast<ChangeCallbackData>(it->lock());
-                if( !!pdata ) {
-                    pdata->_callback();
-                }
-            }
-        }
-        parameters >>= 1;
-        index += 1;
-    }
-    _nParametersChanged = 0;
-    RAVELOG_VERBOSE_FORMAT("initialized %s in %fs", GetName()%(1e-6*(utils::GetMicroTime()-starttime)));
 }
 
 void KinBody::_DeinitializeInternalInformation()
@@ -4503,7 +5177,7 @@ private:
         _vNonAdjacentLinks[0].resize(0);
         for(size_t i = 0; i < _veclinks.size(); ++i) {
             for(size_t j = i+1; j < _veclinks.size(); ++j) {
-                if((_setAdjacentLinks.find(i|(j<<16)) == _setAdjacentLinks.end())&& !collisionchecker->CheckCollision(LinkConstPtr(_veclinks[i]), LinkConstPtr(_veclinks[j])) ) {
+                if((_setAdjacentLinks.find(i|(j<<16)) == _setAdjacentLinks.end())&& (_setUnreachableLinkPairs.find(i|(j<<16)) == _setUnreachableLinkPairs.end()) && !collisionchecker->CheckCollision(LinkConstPtr(_veclinks[i]), LinkConstPtr(_veclinks[j])) ) {
                     _vNonAdjacentLinks[0].push_back(i|(j<<16));
                 }
             }
@@ -4556,6 +5230,23 @@ void KinBody::SetAdjacentLinks(int linkindex0, int linkindex1)
     _ResetInternalCollisionCache();
 }
 
+void KinBody::SetUnreachableLinkPairs(const std::vector<int>& linkpairs)
+{
+    _setUnreachableLinkPairs.clear();
+    FOREACHC(itpair, linkpairs) {
+        int linkindex0 = *itpair&0xffff, linkindex1 = (*itpair>>16)&0xffff;
+        OPENRAVE_ASSERT_OP(linkindex0,<,(int)_veclinks.size());
+        OPENRAVE_ASSERT_OP(linkindex1,<,(int)_veclinks.size());
+        if( linkindex0 > linkindex1 ) {
+            std::swap(linkindex0, linkindex1);
+        }
+        if( linkindex0 != linkindex1 ) {
+            _setUnreachableLinkPairs.insert(linkindex0|(linkindex1<<16));
+        }
+    }
+    _ResetInternalCollisionCache();
+}
+
 void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
 {
     InterfaceBase::Clone(preference,cloningoptions);
@@ -4565,7 +5256,9 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
     _nHierarchyComputed = r->_nHierarchyComputed;
     _bMakeJoinedLinksAdjacent = r->_bMakeJoinedLinksAdjacent;
     __hashkinematics = r->__hashkinematics;
+    _pForwardKinematicsFunctions = r->_pForwardKinematicsFunctions;
     _vTempJoints = r->_vTempJoints;
+    _vLastSetDOFValues.resize(0);
 
     _veclinks.resize(0); _veclinks.reserve(r->_veclinks.size());
     FOREACHC(itlink, r->_veclinks) {
@@ -4602,11 +5295,11 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
         _vPassiveJoints.push_back(pnewjoint);
     }
 
-    _vTopologicallySortedJoints.resize(0); _vTopologicallySortedJoints.resize(r->_vTopologicallySortedJoints.size());
+    _vTopologicallySortedJoints.resize(0); _vTopologicallySortedJoints.reserve(r->_vTopologicallySortedJoints.size());
     FOREACHC(itjoint, r->_vTopologicallySortedJoints) {
         _vTopologicallySortedJoints.push_back(_vecjoints.at((*itjoint)->GetJointIndex()));
     }
-    _vTopologicallySortedJointsAll.resize(0); _vTopologicallySortedJointsAll.resize(r->_vTopologicallySortedJointsAll.size());
+    _vTopologicallySortedJointsAll.resize(0); _vTopologicallySortedJointsAll.reserve(r->_vTopologicallySortedJointsAll.size());
     FOREACHC(itjoint, r->_vTopologicallySortedJointsAll) {
         std::vector<JointPtr>::const_iterator it = find(r->_vecjoints.begin(),r->_vecjoints.end(),*itjoint);
         if( it != r->_vecjoints.end() ) {
@@ -4622,17 +5315,24 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
             }
         }
     }
-    _vDOFOrderedJoints = r->_vDOFOrderedJoints;
+    _vTopologicallySortedJointIndicesAll = r->_vTopologicallySortedJointIndicesAll;
+    _vDOFOrderedJoints.resize(0); _vDOFOrderedJoints.reserve(r->_vDOFOrderedJoints.size());
+    FOREACHC(itjoint, r->_vDOFOrderedJoints) {
+        _vDOFOrderedJoints.push_back(_vecjoints.at((*itjoint)->GetJointIndex()));
+    }
+    _mapLinkNameIndex = r->_mapLinkNameIndex;
+    _mapJointNameIndex = r->_mapJointNameIndex;
     _vJointsAffectingLinks = r->_vJointsAffectingLinks;
     _vDOFIndices = r->_vDOFIndices;
 
     _setAdjacentLinks = r->_setAdjacentLinks;
+    _setUnreachableLinkPairs = r->_setUnreachableLinkPairs;
     _vInitialLinkTransformations = r->_vInitialLinkTransformations;
     _vForcedAdjacentLinks = r->_vForcedAdjacentLinks;
     _vAllPairsShortestPaths = r->_vAllPairsShortestPaths;
     _vClosedLoopIndices = r->_vClosedLoopIndices;
     _vClosedLoops.resize(0); _vClosedLoops.reserve(r->_vClosedLoops.size());
-    FOREACHC(itloop,_vClosedLoops) {
+    FOREACHC(itloop,r->_vClosedLoops) {
         _vClosedLoops.push_back(std::vector< std::pair<LinkPtr,JointPtr> >());
         FOREACHC(it,*itloop) {
             _vClosedLoops.back().emplace_back(_veclinks.at(it->first->GetIndex()), JointPtr());
@@ -4671,8 +5371,15 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
     // do not force-reset the callbacks!! since the ChangeCallbackData destructors will crash
     //_listRegisteredCallbacks.clear();
 
-    // cache
-    _ResetInternalCollisionCache();
+    // the non-adjacent links only depend on the geometry and the initial transformations, so keep them instead of checking all link pairs again
+    if( r->_nHierarchyComputed == 2 && !(r->_nNonAdjacentLinkCache & 0x80000000) ) {
+        _vNonAdjacentLinks = r->_vNonAdjacentLinks;
+        _cacheSetNonAdjacentLinks = r->_cacheSetNonAdjacentLinks;
+        _nNonAdjacentLinkCache = r->_nNonAdjacentLinkCache;
+    }
+    else {
+        _ResetInternalCollisionCache();
+    }
 
     // clone the grabbed bodies, note that this can fail if the new cloned environment hasn't added the bodies yet (check out Environment::Clone)
     _vGrabbedBodies.resize(0);
@@ -4704,11 +5411,17 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
     }
 
     _nUpdateStampId++; // update the stamp instead of copying
+    _nCloneUpdateStamp = r->_nHierarchyComputed == 2 ? _nUpdateStampId : -1;
 }
 
 void KinBody::_PostprocessChangedParameters(uint32_t parameters)
 {
     _nUpdateStampId++;
+    if( !!(parameters & (Prop_LinkGeometry|Prop_LinkGeometryGroup)) ) {
+        FOREACH(itlink, _veclinks) {
+            (*itlink)->_InvalidateAABBCache();
+        }
+    }
     if( _nHierarchyComputed == 1 ) {
         _nParametersChanged |= parameters;
         return;
@@ -4779,6 +5492,15 @@ void KinBody::_PostprocessChangedParameters(uint32_t parameters)
 //        }
     }
 
+    _NotifyChangeCallbacks(parameters);
+}
+
+void KinBody::_NotifyChangeCallbacks(uint32_t parameters)
+{
+    if( _nChangeCallbackBatchDepth > 0 ) {
+        _nBatchedParametersChanged |= parameters & ~Prop_BodyRemoved;
+        parameters &= Prop_BodyRemoved;
+    }
     std::list<UserDataWeakPtr> listRegisteredCallbacks;
     uint32_t index = 0;
     while(parameters && index < _vlistRegisteredCallbacks.size()) {
@@ -4799,6 +5521,25 @@ void KinBody::_PostprocessChangedParameters(uint32_t parameters)
     }
 }
 
+KinBody::ChangeCallbackBatch::ChangeCallbackBatch(KinBodyPtr pbody) : _pbody(pbody)
+{
+    _pbody->_nChangeCallbackBatchDepth++;
+}
+
+KinBody::ChangeCallbackBatch::~ChangeCallbackBatch()
+{
+    if( --_pbody->_nChangeCallbackBatchDepth == 0 ) {
+        uint32_t parameters = _pbody->_nBatchedParametersChanged;
+        _pbody->_nBatchedParametersChanged = 0;
+        try {
+            _pbody->_NotifyChangeCallbacks(parameters);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("env=%d, body %s change callbacks failed: %s", _pbody->GetEnv()->GetId()%_pbody->GetName()%ex.what());
+        }
+    }
+}
+
 void KinBody::Serialize(BaseXMLWriterPtr writer, int options) const
 {
     InterfaceBase::Serialize(writer,options);
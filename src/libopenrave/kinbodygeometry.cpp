@@ -165,6 +165,41 @@ void AppendBoxTriangulation(const Vector& pos, const Vector& ex, TriMesh& tri)
     tri.indices.insert(tri.indices.end(), &indices[0], &indices[nindices]);
 }
 
+static const int s_nVoxelIndexBits = 21;
+static const int64_t s_nVoxelIndexOffset = (int64_t)1<<(s_nVoxelIndexBits-1);
+static const uint64_t s_nVoxelIndexMask = ((uint64_t)1<<s_nVoxelIndexBits)-1;
+
+/// \brief the corners of the six faces of a unit voxel in the order -x,+x,-y,+y,-z,+z, counter clockwise when seen from outside
+static const int s_voxelFaceCorners[6][4][3] = {
+    { {0,0,0}, {0,0,1}, {0,1,1}, {0,1,0} },
+    { {1,0,0}, {1,1,0}, {1,1,1}, {1,0,1} },
+    { {0,0,0}, {1,0,0}, {1,0,1}, {0,0,1} },
+    { {0,1,0}, {0,1,1}, {1,1,1}, {1,1,0} },
+    { {0,0,0}, {0,1,0}, {1,1,0}, {1,0,0} },
+    { {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} },
+};
+
+/// \brief computes the key of the voxel containing p, returns false if p is outside of the representable grid
+static inline bool _GetVoxelKey(const Vector& p, dReal fInvResolution, uint64_t& key)
+{
+    key = 0;
+    for(int idim = 0; idim < 3; ++idim) {
+        dReal findex = std::floor(p[idim]*fInvResolution) + s_nVoxelIndexOffset;
+        if( !(findex >= 0 && findex <= s_nVoxelIndexMask) ) {
+            return false;
+        }
+        key |= (uint64_t)findex<<(idim*s_nVoxelIndexBits);
+    }
+    return true;
+}
+
+static inline void _GetVoxelIndices(uint64_t key, int64_t indices[3])
+{
+    for(int idim = 0; idim < 3; ++idim) {
+        indices[idim] = (int64_t)((key>>(idim*s_nVoxelIndexBits))&s_nVoxelIndexMask);
+    }
+}
+
 KinBody::GeometryInfo::GeometryInfo() : XMLReadable("geometry")
 {
     _vDiffuseColor = Vector(1,1,1);
@@ -309,6 +344,35 @@ bool KinBody::GeometryInfo::InitCollisionMesh(float fTessellation)
         }
         break;
     }
+    case GT_Voxels: {
+        // only the faces between occupied and free voxels are needed
+        const dReal fResolution = GetVoxelResolution();
+        int64_t indices[3];
+        FOREACHC(itkey, _setVoxels) {
+            _GetVoxelIndices(*itkey, indices);
+            Vector vmin((indices[0]-s_nVoxelIndexOffset)*fResolution, (indices[1]-s_nVoxelIndexOffset)*fResolution, (indices[2]-s_nVoxelIndexOffset)*fResolution);
+            for(int iface = 0; iface < 6; ++iface) {
+                int idim = iface/2;
+                uint64_t nstep = (uint64_t)1<<(idim*s_nVoxelIndexBits);
+                if( iface & 1 ) {
+                    if( indices[idim] < (int64_t)s_nVoxelIndexMask && _setVoxels.count(*itkey+nstep) > 0 ) {
+                        continue;
+                    }
+                }
+                else if( indices[idim] > 0 && _setVoxels.count(*itkey-nstep) > 0 ) {
+                    continue;
+                }
+                int off = (int)_meshcollision.vertices.size();
+                for(int icorner = 0; icorner < 4; ++icorner) {
+                    const int* corner = s_voxelFaceCorners[iface][icorner];
+                    _meshcollision.vertices.push_back(vmin + Vector(corner[0],corner[1],corner[2])*fResolution);
+                }
+                _meshcollision.indices.push_back(off);   _meshcollision.indices.push_back(off+1);   _meshcollision.indices.push_back(off+2);
+                _meshcollision.indices.push_back(off);   _meshcollision.indices.push_back(off+2);   _meshcollision.indices.push_back(off+3);
+            }
+        }
+        break;
+    }
     default:
         throw OPENRAVE_EXCEPTION_FORMAT(_("unrecognized geom type %d!"), _type, ORE_InvalidArguments);
     }
@@ -316,6 +380,59 @@ bool KinBody::GeometryInfo::InitCollisionMesh(float fTessellation)
     return true;
 }
 
+void KinBody::GeometryInfo::GetVoxelCenters(std::vector<Vector>& vcenters) const
+{
+    vcenters.resize(0);
+    if( _type != GT_Voxels ) {
+        return;
+    }
+    const dReal fResolution = GetVoxelResolution();
+    vcenters.reserve(_setVoxels.size());
+    int64_t indices[3];
+    FOREACHC(itkey, _setVoxels) {
+        _GetVoxelIndices(*itkey, indices);
+        vcenters.push_back(Vector((indices[0]-s_nVoxelIndexOffset+0.5)*fResolution, (indices[1]-s_nVoxelIndexOffset+0.5)*fResolution, (indices[2]-s_nVoxelIndexOffset+0.5)*fResolution));
+    }
+}
+
+int KinBody::GeometryInfo::InsertVoxelPoints(const std::vector<Vector>& vpoints)
+{
+    if( _type != GT_Voxels ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("geometry %s is not a voxel geometry"), _name, ORE_InvalidState);
+    }
+    if( GetVoxelResolution() <= 0 ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("geometry %s has invalid voxel resolution %f"), _name%GetVoxelResolution(), ORE_InvalidState);
+    }
+    const dReal fInvResolution = 1/GetVoxelResolution();
+    int nchanged = 0;
+    uint64_t key;
+    FOREACHC(itpoint, vpoints) {
+        if( _GetVoxelKey(*itpoint, fInvResolution, key) && _setVoxels.insert(key).second ) {
+            ++nchanged;
+        }
+    }
+    return nchanged;
+}
+
+int KinBody::GeometryInfo::ClearVoxelPoints(const std::vector<Vector>& vpoints)
+{
+    if( _type != GT_Voxels ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("geometry %s is not a voxel geometry"), _name, ORE_InvalidState);
+    }
+    if( GetVoxelResolution() <= 0 ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("geometry %s has invalid voxel resolution %f"), _name%GetVoxelResolution(), ORE_InvalidState);
+    }
+    const dReal fInvResolution = 1/GetVoxelResolution();
+    int nchanged = 0;
+    uint64_t key;
+    FOREACHC(itpoint, vpoints) {
+        if( _GetVoxelKey(*itpoint, fInvResolution, key) ) {
+            nchanged += (int)_setVoxels.erase(key);
+        }
+    }
+    return nchanged;
+}
+
 bool KinBody::GeometryInfo::ComputeInnerEmptyVolume(Transform& tInnerEmptyVolume, Vector& abInnerEmptyExtents) const
 {
     switch(_type) {
@@ -515,6 +632,23 @@ void KinBody::GeometryInfo::SerializeJSON(rapidjson::Value& value, rapidjson::Do
         openravejson::SetJsonValueByKey(value, "mesh", _meshcollision, allocator);
         break;
 
+    case GT_Voxels: {
+        openravejson::SetJsonValueByKey(value, "type", "voxels", allocator);
+        openravejson::SetJsonValueByKey(value, "resolution", _vGeomData.x*fUnitScale, allocator);
+        // the voxel indices of every occupied voxel, 3 values each
+        std::vector<int> vindices;
+        vindices.reserve(3*_setVoxels.size());
+        int64_t indices[3];
+        FOREACHC(itkey, _setVoxels) {
+            _GetVoxelIndices(*itkey, indices);
+            for(int idim = 0; idim < 3; ++idim) {
+                vindices.push_back((int)(indices[idim]-s_nVoxelIndexOffset));
+            }
+        }
+        openravejson::SetJsonValueByKey(value, "voxels", vindices, allocator);
+        break;
+    }
+
     default:
         break;
     }
@@ -598,6 +732,23 @@ void KinBody::GeometryInfo::DeserializeJSON(const rapidjson::Value &value, const
             *itvertex *= fUnitScale;
         }
     }
+    else if (typestr == "voxels") {
+        _type = GT_Voxels;
+        openravejson::LoadJsonValueByKey(value, "resolution", _vGeomData.x);
+        _vGeomData.x *= fUnitScale;
+
+        std::vector<int> vindices;
+        openravejson::LoadJsonValueByKey(value, "voxels", vindices);
+        OPENRAVE_ASSERT_OP(vindices.size() % 3, ==, 0);
+        _setVoxels.clear();
+        for(size_t i = 0; i+2 < vindices.size(); i += 3) {
+            uint64_t key = 0;
+            for(int idim = 0; idim < 3; ++idim) {
+                key |= ((uint64_t)(vindices[i+idim]+s_nVoxelIndexOffset)&s_nVoxelIndexMask)<<(idim*s_nVoxelIndexBits);
+            }
+            _setVoxels.insert(key);
+        }
+    }
     else {
         throw OPENRAVE_EXCEPTION_FORMAT("failed to deserialize json, unsupported geometry type \"%s\"", typestr, ORE_InvalidArguments);
     }
@@ -754,6 +905,7 @@ AABB KinBody::GeometryInfo::ComputeAABB(const Transform& tGeometryWorld) const
         break;
 
     }
+    case GT_Voxels:
     case GT_TriMesh: {
         // Cage: init collision mesh?
         // just use _meshcollision
@@ -839,6 +991,12 @@ void KinBody::Link::Geometry::serialize(std::ostream& o, int options) const
             SerializeRound3(o,_info._vGeomData3);
             SerializeRound3(o,_info._vGeomData4);
         }
+        else if( _info._type == GT_Voxels ) {
+            o << _info._setVoxels.size() << " ";
+            FOREACHC(itkey, _info._setVoxels) {
+                o << *itkey << " ";
+            }
+        }
     }
 }
 
@@ -850,6 +1008,63 @@ void KinBody::Link::Geometry::SetCollisionMesh(const TriMesh& mesh)
     parent->_Update();
 }
 
+int KinBody::Link::Geometry::InsertVoxelPoints(const std::vector<Vector>& vpoints)
+{
+    OPENRAVE_ASSERT_FORMAT0(_info._bModifiable, "geometry cannot be modified", ORE_Failed);
+    int nchanged;
+    if( TransformDistanceFast(Transform(), _info._t) <= g_fEpsilonLinear ) {
+        nchanged = _info.InsertVoxelPoints(vpoints);
+    }
+    else {
+        Transform tinv = _info._t.inverse();
+        std::vector<Vector> vlocalpoints(vpoints.size());
+        for(size_t i = 0; i < vpoints.size(); ++i) {
+            vlocalpoints[i] = tinv*vpoints[i];
+        }
+        nchanged = _info.InsertVoxelPoints(vlocalpoints);
+    }
+    if( nchanged > 0 ) {
+        LinkPtr parent(_parent);
+        _info.InitCollisionMesh();
+        parent->_Update();
+    }
+    return nchanged;
+}
+
+int KinBody::Link::Geometry::ClearVoxelPoints(const std::vector<Vector>& vpoints)
+{
+    OPENRAVE_ASSERT_FORMAT0(_info._bModifiable, "geometry cannot be modified", ORE_Failed);
+    int nchanged;
+    if( TransformDistanceFast(Transform(), _info._t) <= g_fEpsilonLinear ) {
+        nchanged = _info.ClearVoxelPoints(vpoints);
+    }
+    else {
+        Transform tinv = _info._t.inverse();
+        std::vector<Vector> vlocalpoints(vpoints.size());
+        for(size_t i = 0; i < vpoints.size(); ++i) {
+            vlocalpoints[i] = tinv*vpoints[i];
+        }
+        nchanged = _info.ClearVoxelPoints(vlocalpoints);
+    }
+    if( nchanged > 0 ) {
+        LinkPtr parent(_parent);
+        _info.InitCollisionMesh();
+        parent->_Update();
+    }
+    return nchanged;
+}
+
+void KinBody::Link::Geometry::ClearVoxels()
+{
+    OPENRAVE_ASSERT_FORMAT0(_info._bModifiable, "geometry cannot be modified", ORE_Failed);
+    if( _info._setVoxels.size() > 0 ) {
+        LinkPtr parent(_parent);
+        _info._setVoxels.clear();
+        _info.InitCollisionMesh();
+        parent->_Update();
+    }
+}
+
 bool KinBody::Link::Geometry::SetVisible(bool visible)
 {
     if( _info._bVisible != visible ) {
@@ -427,19 +427,42 @@ void KinBody::GetIgnoredLinksOfGrabbed(KinBodyConstPtr body, std::list<KinBody::
     RAVELOG_WARN(str(boost::format("body %s is not currently grabbed")%body->GetName()));
 }
 
+static bool _IsSameVelocity(const std::pair<Vector, Vector>& v0, const std::pair<Vector, Vector>& v1)
+{
+    return v0.first.x == v1.first.x && v0.first.y == v1.first.y && v0.first.z == v1.first.z && v0.second.x == v1.second.x && v0.second.y == v1.second.y && v0.second.z == v1.second.z;
+}
+
 void KinBody::_UpdateGrabbedBodies()
+{
+    _UpdateGrabbedBodies(std::vector<uint8_t>());
+}
+
+void KinBody::_UpdateGrabbedBodies(const std::vector<uint8_t>& vlinksupdated)
 {
     vector<UserDataPtr>::iterator itgrabbed = _vGrabbedBodies.begin();
     while(itgrabbed != _vGrabbedBodies.end() ) {
         GrabbedPtr pgrabbed = boost::dynamic_pointer_cast<Grabbed>(*itgrabbed);
         KinBodyPtr pbody = pgrabbed->_pgrabbedbody.lock();
         if( !!pbody ) {
+            if( vlinksupdated.size() > 0 && !vlinksupdated.at(pgrabbed->_plinkrobot->GetIndex()) ) {
+                ++itgrabbed;
+                continue;
+            }
             Transform t = pgrabbed->_plinkrobot->GetTransform();
+            std::pair<Vector, Vector> linkvelocity = pgrabbed->_plinkrobot->GetVelocity();
+            if( pbody->GetUpdateStamp() == pgrabbed->_nLastUpdateStamp && IsSameTransform(t, pgrabbed->_tLastLinkTransform) && _IsSameVelocity(linkvelocity, pgrabbed->_vLastLinkVelocity) ) {
+                // neither the grabbing link nor the grabbed body moved, so do not notify the callbacks and collision checkers of the grabbed body again
+                ++itgrabbed;
+                continue;
+            }
             pbody->SetTransform(t * pgrabbed->_troot);
             // set the correct velocity
-            std::pair<Vector, Vector> velocity = pgrabbed->_plinkrobot->GetVelocity();
+            std::pair<Vector, Vector> velocity = linkvelocity;
             velocity.first += velocity.second.cross(t.rotate(pgrabbed->_troot.trans));
             pbody->SetVelocity(velocity.first, velocity.second);
+            pgrabbed->_tLastLinkTransform = t;
+            pgrabbed->_vLastLinkVelocity = linkvelocity;
+            pgrabbed->_nLastUpdateStamp = pbody->GetUpdateStamp();
             ++itgrabbed;
         }
         else {
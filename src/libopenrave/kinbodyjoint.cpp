@@ -411,6 +411,158 @@ OpenRAVEFunctionParserRealPtr CreateJointFunctionParser()
     return parser;
 }
 
+/// \brief evaluates a parsed equation for _SpecializeEquation, returns false if the parser fails or gives several values
+static bool _EvalParsedEquation(OpenRAVEFunctionParserRealPtr fn, bool bmultivalued, const std::vector<dReal>& vvalues, std::vector<dReal>& vtemp, dReal& fresult)
+{
+    const dReal* pvalues = vvalues.empty() ? NULL : &vvalues[0];
+    if( bmultivalued ) {
+        fn->EvalMulti(vtemp, pvalues);
+        if( fn->EvalError() != 0 || vtemp.size() != 1 ) {
+            return false;
+        }
+        fresult = vtemp[0];
+    }
+    else {
+        fresult = fn->Eval(pvalues);
+        if( fn->EvalError() != 0 ) {
+            return false;
+        }
+    }
+    return RaveFabs(fresult) < 1e100; // reject inf and nan
+}
+
+/// \brief returns true if the equation only uses numbers, the variables, + - * / ^ and parentheses, which makes it a rational function of the variables
+static bool _IsArithmeticEquation(const std::string& equation, const std::vector<std::string>& vvariables)
+{
+    size_t index = 0;
+    while( index < equation.size() ) {
+        char c = equation[index];
+        if( isalpha(c) || c == '_' ) {
+            size_t startindex = index;
+            while( index < equation.size() && (isalnum(equation[index]) || equation[index] == '_') ) {
+                ++index;
+            }
+            if( find(vvariables.begin(), vvariables.end(), equation.substr(startindex, index-startindex)) == vvariables.end() ) {
+                return false; // a function or a constant the parser knows
+            }
+        }
+        else if( isdigit(c) || c == '.' ) {
+            while( index < equation.size() && (isdigit(equation[index]) || equation[index] == '.') ) {
+                ++index;
+            }
+            if( index < equation.size() && (equation[index] == 'e' || equation[index] == 'E') ) {
+                ++index;
+                if( index < equation.size() && (equation[index] == '+' || equation[index] == '-') ) {
+                    ++index;
+                }
+            }
+        }
+        else if( isspace(c) || c == '+' || c == '-' || c == '*' || c == '/' || c == '^' || c == '(' || c == ')' ) {
+            ++index;
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief tries to reduce a parsed equation to an affine function of its values, or to a polynomial of degree at most 4 when it has one value
+///
+/// The coefficients are fitted from the parser and then compared with it at other values. Since the equation is a rational function, agreeing at these generic values means it is the fitted function.
+static void _SpecializeEquation(const std::string& equation, OpenRAVEFunctionParserRealPtr fn, bool bmultivalued, const std::vector<std::string>& vvariables, KinBody::Mimic::SpecializedEquation& specialized)
+{
+    specialized = KinBody::Mimic::SpecializedEquation();
+    if( !_IsArithmeticEquation(equation, vvariables) ) {
+        return;
+    }
+    static const dReal s_ftestvalues[] = {0.7316, -1.2947, 1.8823, -0.4411, 1.1597, -1.7063};
+    static const size_t s_numtestvalues = sizeof(s_ftestvalues)/sizeof(s_ftestvalues[0]);
+    const size_t numvalues = vvariables.size();
+    std::vector<dReal> vvalues(numvalues, 0), vtemp, vcoeffs(numvalues+1);
+    dReal f;
+
+    // affine, c_0 + sum_i c_i x_i
+    bool bvalid = _EvalParsedEquation(fn, bmultivalued, vvalues, vtemp, vcoeffs[0]);
+    for(size_t i = 0; i < numvalues && bvalid; ++i) {
+        vvalues.assign(numvalues, 0);
+        vvalues[i] = 1;
+        bvalid = _EvalParsedEquation(fn, bmultivalued, vvalues, vtemp, f);
+        vcoeffs[i+1] = f - vcoeffs[0];
+    }
+    if( !bvalid ) {
+        return;
+    }
+    specialized.coeffs = vcoeffs;
+    specialized.variableindex = -1;
+    bool baffine = true;
+    for(size_t itest = 0; itest < s_numtestvalues && baffine; ++itest) {
+        for(size_t i = 0; i < numvalues; ++i) {
+            vvalues[i] = s_ftestvalues[(itest+i)%s_numtestvalues]*(1+0.37*i);
+        }
+        baffine = _EvalParsedEquation(fn, bmultivalued, vvalues, vtemp, f) && RaveFabs(f-specialized.Eval(&vvalues[0])) <= 1e-10*(1+RaveFabs(f));
+    }
+    if( baffine ) {
+        return;
+    }
+    specialized.coeffs.resize(0);
+    if( numvalues != 1 ) {
+        return;
+    }
+
+    // polynomial of one value, fit the coefficients by solving the vandermonde system at degree+1 values
+    for(int degree = 2; degree <= 4; ++degree) {
+        int n = degree+1;
+        std::vector<dReal> A(n*(n+1));
+        for(int irow = 0; irow < n; ++irow) {
+            vvalues[0] = -1 + 2*dReal(irow)/degree;
+            if( !_EvalParsedEquation(fn, bmultivalued, vvalues, vtemp, f) ) {
+                return;
+            }
+            dReal fpower = 1;
+            for(int icol = 0; icol < n; ++icol) {
+                A[irow*(n+1)+icol] = fpower;
+                fpower *= vvalues[0];
+            }
+            A[irow*(n+1)+n] = f;
+        }
+        // gaussian elimination with partial pivoting
+        for(int icol = 0; icol < n; ++icol) {
+            int ipivot = icol;
+            for(int irow = icol+1; irow < n; ++irow) {
+                if( RaveFabs(A[irow*(n+1)+icol]) > RaveFabs(A[ipivot*(n+1)+icol]) ) {
+                    ipivot = irow;
+                }
+            }
+            for(int j = 0; j <= n; ++j) {
+                std::swap(A[icol*(n+1)+j], A[ipivot*(n+1)+j]);
+            }
+            for(int irow = 0; irow < n; ++irow) {
+                if( irow != icol ) {
+                    dReal fmult = A[irow*(n+1)+icol]/A[icol*(n+1)+icol];
+                    for(int j = icol; j <= n; ++j) {
+                        A[irow*(n+1)+j] -= fmult*A[icol*(n+1)+j];
+                    }
+                }
+            }
+        }
+        specialized.coeffs.resize(n);
+        for(int i = 0; i < n; ++i) {
+            specialized.coeffs[i] = A[i*(n+1)+n]/A[i*(n+1)+i];
+        }
+        specialized.variableindex = 0;
+        bool bpolynomial = true;
+        for(size_t itest = 0; itest < s_numtestvalues && bpolynomial; ++itest) {
+            vvalues[0] = s_ftestvalues[itest];
+            bpolynomial = _EvalParsedEquation(fn, bmultivalued, vvalues, vtemp, f) && RaveFabs(f-specialized.Eval(&vvalues[0])) <= 1e-9*(1+RaveFabs(f));
+        }
+        if( bpolynomial ) {
+            return;
+        }
+    }
+    specialized = KinBody::Mimic::SpecializedEquation();
+}
+
 KinBody::Joint::Joint(KinBodyPtr parent, KinBody::JointType type)
 {
     _parent = parent;
@@ -1731,6 +1883,7 @@ void KinBody::Joint::SetMimicEquations(int iaxis, const std::string& poseq, cons
     if( ret >= 0 ) {
         throw OPENRAVE_EXCEPTION_FORMAT(_("failed to set equation '%s' on %s:%s, at %d. Error is %s\n"), mimic->_equations[0]%parent->GetName()%GetName()%ret%posfn->ErrorMsg(),ORE_InvalidArguments);
     }
+    _SpecializeEquation(eq, posfn, true, resultVars, mimic->_posspecialized);
     // process the variables
     FOREACH(itvar,resultVars) {
         OPENRAVE_ASSERT_FORMAT(itvar->find("joint") == 0, "equation '%s' uses unknown variable", mimic->_equations[0], ORE_InvalidArguments);
@@ -1771,6 +1924,7 @@ void KinBody::Joint::SetMimicEquations(int iaxis, const std::string& poseq, cons
         }
 
         std::vector<OpenRAVEFunctionParserRealPtr> vfns(resultVars.size());
+        std::vector<std::string> vfnequations(resultVars.size());
         // extract the equations
         utils::SearchAndReplace(eq,mimic->_equations[itype],jointnamepairs);
         size_t index = eq.find('|');
@@ -1805,6 +1959,7 @@ void KinBody::Joint::SetMimicEquations(int iaxis, const std::string& poseq, cons
                 throw OPENRAVE_EXCEPTION_FORMAT(_("failed to set equation '%s' on %s:%s, at %d. Error is %s"), sequation%parent->GetName()%GetName()%ret%fn->ErrorMsg(),ORE_InvalidArguments);
             }
             vfns.at(itnameindex-resultVars.begin()) = fn;
+            vfnequations.at(itnameindex-resultVars.begin()) = sequation;
         }
         // check if anything is missing
         for(size_t j = 0; j < resultVars.size(); ++j) {
@@ -1813,9 +1968,16 @@ void KinBody::Joint::SetMimicEquations(int iaxis, const std::string& poseq, cons
                 RAVELOG_WARN(str(boost::format("SetMimicEquations: missing variable %s from partial derivatives of joint %s!")%mapinvnames[resultVars[j]]%_info._name));
                 vfns[j] = CreateJointFunctionParser();
                 vfns[j]->Parse("0","");
+                vfnequations[j] = "0";
             }
         }
 
+        std::vector<Mimic::SpecializedEquation>& vspecialized = itype == 1 ? mimic->_velspecialized : mimic->_accelspecialized;
+        vspecialized.resize(vfns.size());
+        for(size_t j = 0; j < vfns.size(); ++j) {
+            // the missing equations are parsed without variables
+            _SpecializeEquation(vfnequations[j], vfns[j], false, vfnequations[j] == "0" ? std::vector<std::string>() : resultVars, vspecialized[j]);
+        }
         if( itype == 1 ) {
             mimic->_velfns.swap(vfns);
         }
@@ -1856,7 +2018,8 @@ void KinBody::Joint::_ComputePartialVelocities(std::vector<std::pair<int,dReal>
                     vtempvalues.push_back(itdofformat->GetJoint(*parent)->GetValue(itdofformat->axis));
                 }
             }
-            dReal fvel = _vmimic[iaxis]->_velfns.at(itmimicdof->dofformatindex)->Eval(vtempvalues.empty() ? NULL : &vtempvalues[0]);
+            const Mimic::SpecializedEquation& velspecialized = _vmimic[iaxis]->_velspecialized.at(itmimicdof->dofformatindex);
+            dReal fvel = velspecialized.IsValid() ? velspecialized.Eval(vtempvalues.empty() ? NULL : &vtempvalues[0]) : _vmimic[iaxis]->_velfns.at(itmimicdof->dofformatindex)->Eval(vtempvalues.empty() ? NULL : &vtempvalues[0]);
             const MIMIC::DOFFormat& dofformat = _vmimic[iaxis]->_vdofformat.at(itmimicdof->dofformatindex);
             if( dofformat.GetJoint(*parent)->IsMimic(dofformat.axis) ) {
                 dofformat.GetJoint(*parent)->_ComputePartialVelocities(vtemppartials,dofformat.axis,mapcachedpartials);
@@ -1898,25 +2061,28 @@ void KinBody::Joint::_ComputePartialVelocities(std::vector<std::pair<int,dReal>
 
 int KinBody::Joint::_Eval(int axis, uint32_t timederiv, const std::vector<dReal>& vdependentvalues, std::vector<dReal>& voutput)
 {
+    const Mimic& mimic = *_vmimic.at(axis);
+    const dReal* pvalues = vdependentvalues.empty() ? NULL : &vdependentvalues[0];
     if( timederiv == 0 ) {
-        _vmimic.at(axis)->_posfn->EvalMulti(voutput, vdependentvalues.empty() ? NULL : &vdependentvalues[0]);
-        return _vmimic.at(axis)->_posfn->EvalError();
-    }
-    else if( timederiv == 1 ) {
-        voutput.resize(_vmimic.at(axis)->_velfns.size());
+        if( mimic._posspecialized.IsValid() ) {
+            voutput.resize(1);
+            voutput[0] = mimic._posspecialized.Eval(pvalues);
+            return 0;
+        }
+        mimic._posfn->EvalMulti(voutput, pvalues);
+        return mimic._posfn->EvalError();
+    }
+    else if( timederiv == 1 || timederiv == 2 ) {
+        const std::vector<OpenRAVEFunctionParserRealPtr>& vfns = timederiv == 1 ? mimic._velfns : mimic._accelfns;
+        const std::vector<Mimic::SpecializedEquation>& vspecialized = timederiv == 1 ? mimic._velspecialized : mimic._accelspecialized;
+        voutput.resize(vfns.size());
         for(size_t i = 0; i < voutput.size(); ++i) {
-            voutput[i] = _vmimic.at(axis)->_velfns.at(i)->Eval(vdependentvalues.empty() ? NULL : &vdependentvalues[0]);
-            int err = _vmimic.at(axis)->_velfns.at(i)->EvalError();
-            if( err ) {
-                return err;
+            if( i < vspecialized.size() && vspecialized[i].IsValid() ) {
+                voutput[i] = vspecialized[i].Eval(pvalues);
+                continue;
             }
-        }
-    }
-    else if( timederiv == 2 ) {
-        voutput.resize(_vmimic.at(axis)->_accelfns.size());
-        for(size_t i = 0; i < voutput.size(); ++i) {
-            voutput[i] = _vmimic.at(axis)->_accelfns.at(i)->Eval(vdependentvalues.empty() ? NULL : &vdependentvalues[0]);
-            int err = _vmimic.at(axis)->_accelfns.at(i)->EvalError();
+            voutput[i] = vfns.at(i)->Eval(pvalues);
+            int err = vfns.at(i)->EvalError();
             if( err ) {
                 return err;
             }
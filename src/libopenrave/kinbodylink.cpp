@@ -177,6 +177,7 @@ KinBody::Link::Link(KinBodyPtr parent)
 {
     _parent = parent;
     _index = -1;
+    _nAABBCacheFlags = 0;
 }
 
 KinBody::Link::~Link()
@@ -295,14 +296,198 @@ void KinBody::Link::SetMass(dReal mass)
     GetParent()->_PostprocessChangedParameters(Prop_LinkDynamics);
 }
 
+/// \brief a convex piece of a geometry for ComputeBoundingSpheres, contained in the spheres of radius fpadding around vpoints
+struct BoundingPrimitive
+{
+    BoundingPrimitive() : fpadding(0) {
+    }
+    Vector vcenter;
+    std::vector<Vector> vpoints;
+    dReal fpadding;
+};
+
+struct BoundingPrimitiveAxisLess
+{
+    BoundingPrimitiveAxisLess(int iaxis) : _iaxis(iaxis) {
+    }
+    bool operator()(const BoundingPrimitive& p0, const BoundingPrimitive& p1) const {
+        return p0.vcenter[_iaxis] < p1.vcenter[_iaxis];
+    }
+    int _iaxis;
+};
+
+/// \brief appends the box pieces of a box with half extents vextents, cut along the longest axis so that the pieces are not much longer than wide
+static void _AppendBoxBoundingPrimitives(const Transform& tbox, const Vector& vextents, std::vector<BoundingPrimitive>& vprimitives)
+{
+    int ilongest = 0;
+    for(int idim = 1; idim < 3; ++idim) {
+        if( vextents[idim] > vextents[ilongest] ) {
+            ilongest = idim;
+        }
+    }
+    dReal fwidth = 0;
+    for(int idim = 0; idim < 3; ++idim) {
+        if( idim != ilongest ) {
+            fwidth = max(fwidth, vextents[idim]);
+        }
+    }
+    int npieces = 1;
+    if( fwidth > g_fEpsilonLinear ) {
+        npieces = max(1, min(8, (int)(vextents[ilongest]/fwidth + 0.5)));
+    }
+    else if( vextents[ilongest] > g_fEpsilonLinear ) {
+        npieces = 8;
+    }
+    Vector vpieceextents = vextents;
+    vpieceextents[ilongest] = vextents[ilongest]/npieces;
+    for(int ipiece = 0; ipiece < npieces; ++ipiece) {
+        Vector voffset;
+        voffset[ilongest] = -vextents[ilongest] + (2*ipiece+1)*vpieceextents[ilongest];
+        BoundingPrimitive primitive;
+        primitive.vcenter = tbox*voffset;
+        for(int icorner = 0; icorner < 8; ++icorner) {
+            Vector vcorner(icorner&1 ? vpieceextents.x : -vpieceextents.x, icorner&2 ? vpieceextents.y : -vpieceextents.y, icorner&4 ? vpieceextents.z : -vpieceextents.z);
+            primitive.vpoints.push_back(tbox*(voffset+vcorner));
+        }
+        vprimitives.push_back(primitive);
+    }
+}
+
+static void _AppendGeometryBoundingPrimitives(const KinBody::GeometryInfo& info, std::vector<BoundingPrimitive>& vprimitives)
+{
+    switch(info._type) {
+    case GT_None:
+        break;
+    case GT_Sphere: {
+        BoundingPrimitive primitive;
+        primitive.vcenter = info._t.trans;
+        primitive.vpoints.push_back(info._t.trans);
+        primitive.fpadding = info._vGeomData.x;
+        vprimitives.push_back(primitive);
+        break;
+    }
+    case GT_Box:
+        _AppendBoxBoundingPrimitives(info._t, info._vGeomData, vprimitives);
+        break;
+    case GT_Cylinder:
+        _AppendBoxBoundingPrimitives(info._t, Vector(info._vGeomData.x, info._vGeomData.x, 0.5*info._vGeomData.y), vprimitives);
+        break;
+    default: {
+        // the triangles are contained in any sphere containing their vertices
+        const TriMesh& mesh = info._meshcollision;
+        for(size_t i = 0; i+2 < mesh.indices.size(); i += 3) {
+            BoundingPrimitive primitive;
+            for(int j = 0; j < 3; ++j) {
+                primitive.vpoints.push_back(info._t*mesh.vertices.at(mesh.indices[i+j]));
+            }
+            primitive.vcenter = (primitive.vpoints[0]+primitive.vpoints[1]+primitive.vpoints[2])*(dReal(1)/3);
+            vprimitives.push_back(primitive);
+        }
+        break;
+    }
+    }
+}
+
+/// \brief splits the primitives at the median of the longest axis of their centers until there are nspheres clusters, and bounds every cluster with a sphere
+static void _ClusterBoundingPrimitives(std::vector<BoundingPrimitive>& vprimitives, size_t ibegin, size_t iend, int nspheres, std::vector< std::pair<Vector, dReal> >& vspheres)
+{
+    if( nspheres <= 1 || iend-ibegin <= 1 ) {
+        Vector vmin, vmax;
+        bool binitialized = false;
+        for(size_t i = ibegin; i < iend; ++i) {
+            FOREACHC(itpoint, vprimitives[i].vpoints) {
+                Vector vpad(vprimitives[i].fpadding, vprimitives[i].fpadding, vprimitives[i].fpadding);
+                Vector vpointmin = *itpoint - vpad, vpointmax = *itpoint + vpad;
+                if( !binitialized ) {
+                    vmin = vpointmin;
+                    vmax = vpointmax;
+                    binitialized = true;
+                }
+                else {
+                    for(int idim = 0; idim < 3; ++idim) {
+                        vmin[idim] = min(vmin[idim], vpointmin[idim]);
+                        vmax[idim] = max(vmax[idim], vpointmax[idim]);
+                    }
+                }
+            }
+        }
+        if( !binitialized ) {
+            return;
+        }
+        Vector vcenter = 0.5*(vmin+vmax);
+        dReal fradius = 0;
+        for(size_t i = ibegin; i < iend; ++i) {
+            FOREACHC(itpoint, vprimitives[i].vpoints) {
+                fradius = max(fradius, RaveSqrt((*itpoint-vcenter).lengthsqr3()) + vprimitives[i].fpadding);
+            }
+        }
+        vspheres.push_back(std::make_pair(vcenter, fradius));
+        return;
+    }
+
+    Vector vmin = vprimitives[ibegin].vcenter, vmax = vprimitives[ibegin].vcenter;
+    for(size_t i = ibegin+1; i < iend; ++i) {
+        for(int idim = 0; idim < 3; ++idim) {
+            vmin[idim] = min(vmin[idim], vprimitives[i].vcenter[idim]);
+            vmax[idim] = max(vmax[idim], vprimitives[i].vcenter[idim]);
+        }
+    }
+    int iaxis = 0;
+    for(int idim = 1; idim < 3; ++idim) {
+        if( vmax[idim]-vmin[idim] > vmax[iaxis]-vmin[iaxis] ) {
+            iaxis = idim;
+        }
+    }
+    size_t imid = (ibegin+iend)/2;
+    std::nth_element(vprimitives.begin()+ibegin, vprimitives.begin()+imid, vprimitives.begin()+iend, BoundingPrimitiveAxisLess(iaxis));
+    _ClusterBoundingPrimitives(vprimitives, ibegin, imid, nspheres/2, vspheres);
+    _ClusterBoundingPrimitives(vprimitives, imid, iend, nspheres-nspheres/2, vspheres);
+}
+
+void KinBody::Link::ComputeBoundingSpheres(std::vector< std::pair<Vector, dReal> >& vspheres, int nMaxSpheres, const std::string& groupname) const
+{
+    vspheres.resize(0);
+    std::vector<BoundingPrimitive> vprimitives;
+    std::map< std::string, std::vector<KinBody::GeometryInfoPtr> >::const_iterator itgroup = _info._mapExtraGeometries.end();
+    if( groupname.size() > 0 ) {
+        itgroup = _info._mapExtraGeometries.find(groupname);
+    }
+    if( itgroup != _info._mapExtraGeometries.end() ) {
+        FOREACHC(itgeominfo, itgroup->second) {
+            if( !!*itgeominfo ) {
+                _AppendGeometryBoundingPrimitives(**itgeominfo, vprimitives);
+            }
+        }
+    }
+    else {
+        FOREACHC(itgeom, _vGeometries) {
+            _AppendGeometryBoundingPrimitives((*itgeom)->GetInfo(), vprimitives);
+        }
+    }
+    if( vprimitives.size() > 0 ) {
+        _ClusterBoundingPrimitives(vprimitives, 0, vprimitives.size(), max(1, nMaxSpheres), vspheres);
+    }
+}
+
 AABB KinBody::Link::ComputeLocalAABB() const
 {
-    return ComputeAABBFromTransform(Transform());
+    if( !(_nAABBCacheFlags & 1) ) {
+        _abLocalCache = ComputeAABBFromTransform(Transform());
+        _nAABBCacheFlags |= 1;
+    }
+    return _abLocalCache;
 }
 
 AABB KinBody::Link::ComputeAABB() const
 {
-    return ComputeAABBFromTransform(_info._t);
+    const Transform& t = _info._t;
+    const Transform& tcache = _tWorldAABBCache;
+    if( !(_nAABBCacheFlags & 2) || t.trans.x != tcache.trans.x || t.trans.y != tcache.trans.y || t.trans.z != tcache.trans.z || t.rot.x != tcache.rot.x || t.rot.y != tcache.rot.y || t.rot.z != tcache.rot.z || t.rot.w != tcache.rot.w ) {
+        _abWorldCache = ComputeAABBFromTransform(t);
+        _tWorldAABBCache = t;
+        _nAABBCacheFlags |= 2;
+    }
+    return _abWorldCache;
 }
 
 AABB KinBody::Link::ComputeAABBFromTransform(const Transform& tLink) const
@@ -484,6 +669,7 @@ void KinBody::Link::SetGeometriesFromGroup(const std::string& groupname)
             throw OPENRAVE_EXCEPTION_FORMAT(_("could not find geometries %s for link %s"),groupname%GetName(),ORE_InvalidArguments);
         }
         pvinfos = &it->second;
+        _LoadGroupGeometryMeshes(*pvinfos);
     }
     _vGeometries.resize(pvinfos->size());
     for(size_t i = 0; i < pvinfos->size(); ++i) {
@@ -502,9 +688,36 @@ const std::vector<KinBody::GeometryInfoPtr>& KinBody::Link::GetGeometriesFromGro
     if( it == _info._mapExtraGeometries.end() ) {
         throw OPENRAVE_EXCEPTION_FORMAT(_("geometry group %s does not exist for link %s"), groupname%GetName(), ORE_InvalidArguments);
     }
+    _LoadGroupGeometryMeshes(it->second);
     return it->second;
 }
 
+void KinBody::Link::_LoadGroupGeometryMeshes(const std::vector<KinBody::GeometryInfoPtr>& vgeometryinfos) const
+{
+    FOREACHC(itinfo, vgeometryinfos) {
+        KinBody::GeometryInfo& info = **itinfo;
+        if( info._type != GT_TriMesh || info._meshcollision.vertices.size() > 0 ) {
+            continue;
+        }
+        // like the xml reader, use the render file when there is no collision file
+        bool bcollision = info._filenamecollision.size() > 0;
+        const std::string& filename = bcollision ? info._filenamecollision : info._filenamerender;
+        if( filename.size() == 0 || filename.find("__norenderif__") == 0 ) {
+            continue;
+        }
+        const Vector& vscale = bcollision ? info._vCollisionScale : info._vRenderScale;
+        AttributesList atts;
+        atts.emplace_back("scalegeometry", str(boost::format("%.15e %.15e %.15e")%vscale.x%vscale.y%vscale.z));
+        boost::shared_ptr<TriMesh> ptrimesh = GetParent()->GetEnv()->ReadTrimeshURI(boost::shared_ptr<TriMesh>(), filename, atts);
+        if( !ptrimesh ) {
+            RAVELOG_WARN_FORMAT("failed to load %s for geometry %s of link %s", filename%info._name%GetName());
+            continue;
+        }
+        info._meshcollision.vertices.swap(ptrimesh->vertices);
+        info._meshcollision.indices.swap(ptrimesh->indices);
+    }
+}
+
 void KinBody::Link::SetGroupGeometries(const std::string& groupname, const std::vector<KinBody::GeometryInfoPtr>& geometries)
 {
     FOREACH(itgeominfo, geometries) {
@@ -701,6 +914,7 @@ void KinBody::Link::UpdateInfo()
 
 void KinBody::Link::_Update(bool parameterschanged, uint32_t extraParametersChanged)
 {
+    _InvalidateAABBCache();
     // if there's only one trimesh geometry and it has identity offset, then copy it directly
     if( _vGeometries.size() == 1 && _vGeometries.at(0)->GetType() == GT_TriMesh && TransformDistanceFast(Transform(), _vGeometries.at(0)->GetTransform()) <= g_fEpsilonLinear ) {
         _collision = _vGeometries.at(0)->GetCollisionMesh();
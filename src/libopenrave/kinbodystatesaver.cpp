@@ -18,10 +18,31 @@
 
 namespace OpenRAVE {
 
-KinBody::KinBodyStateSaver::KinBodyStateSaver(KinBodyPtr pbody, int options) : _pbody(pbody), _options(options), _bRestoreOnDestructor(true)
+/// \brief restores link transformations saved as dof values, the links of the joints that did not change are not computed again
+static void _SetSavedDOFValues(KinBody& body, const std::vector<dReal>& vdofvalues, const Transform& tbase)
+{
+    if( IsSameTransform(body.GetTransform(), tbase) ) {
+        body.SetDOFValues(vdofvalues, KinBody::CLA_Nothing);
+    }
+    else {
+        body.SetDOFValues(vdofvalues, tbase, KinBody::CLA_Nothing);
+    }
+}
+
+KinBody::KinBodyStateSaver::KinBodyStateSaver(KinBodyPtr pbody, int options) : _pbody(pbody), _options(options), _nSavedUpdateStamp(0), _bSavedDOFValues(false), _bRestoreOnDestructor(true)
 {
     if( _options & Save_LinkTransformation ) {
-        _pbody->GetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        _nSavedUpdateStamp = _pbody->GetUpdateStamp();
+        _bSavedDOFValues = _pbody->_IsLinkTransformationFromDOFValues();
+        if( _bSavedDOFValues ) {
+            // planners save the state around every check, so only copy the dof values into a pooled buffer
+            _pbody->_PopStateSaverBuffer(_vSavedDOFValues);
+            _vSavedDOFValues = _pbody->_vLastSetDOFValues;
+            _tSavedBase = _pbody->GetTransform();
+        }
+        else {
+            _pbody->GetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        }
     }
     if( _options & Save_LinkEnable ) {
         _vEnabledLinks.resize(_pbody->GetLinks().size());
@@ -54,6 +75,9 @@ KinBody::KinBodyStateSaver::~KinBodyStateSaver()
     if( _bRestoreOnDestructor && !!_pbody && _pbody->GetEnvironmentId() != 0 ) {
         _RestoreKinBody(_pbody);
     }
+    if( !!_pbody ) {
+        _pbody->_PushStateSaverBuffer(_vSavedDOFValues);
+    }
 }
 
 void KinBody::KinBodyStateSaver::Restore(boost::shared_ptr<KinBody> body)
@@ -80,6 +104,8 @@ void KinBody::KinBodyStateSaver::_RestoreKinBody(boost::shared_ptr<KinBody> pbod
         RAVELOG_WARN_FORMAT("env=%d, body %s not added to environment, skipping restore", pbody->GetEnv()->GetId()%pbody->GetName());
         return;
     }
+    // if nothing changed the body since it was saved, the link transformations do not have to be set again
+    bool bLinkTransformationUnchanged = pbody == _pbody && pbody->GetUpdateStamp() == _nSavedUpdateStamp;
     if( _options & Save_JointLimits ) {
         pbody->SetDOFLimits(_vDOFLimits[0], _vDOFLimits[1]);
     }
@@ -122,12 +148,19 @@ void KinBody::KinBodyStateSaver::_RestoreKinBody(boost::shared_ptr<KinBody> pbod
         }
 
         // if not calling SetLinkTransformations, then manually call _UpdateGrabbedBodies
-        if( !(_options & Save_LinkTransformation ) ) {
+        if( !(_options & Save_LinkTransformation ) || bLinkTransformationUnchanged ) {
             pbody->_UpdateGrabbedBodies();
         }
     }
     if( _options & Save_LinkTransformation ) {
-        pbody->SetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        if( _bSavedDOFValues ) {
+            if( !bLinkTransformationUnchanged ) {
+                _SetSavedDOFValues(*pbody, _vSavedDOFValues, _tSavedBase);
+            }
+        }
+        else if( !bLinkTransformationUnchanged ) {
+            pbody->SetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        }
 //        if( IS_DEBUGLEVEL(Level_Warn) ) {
 //            stringstream ss; ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
 //            ss << "restoring kinbody " << pbody->GetName() << " to values=[";
@@ -168,10 +201,20 @@ void KinBody::KinBodyStateSaver::_RestoreKinBody(boost::shared_ptr<KinBody> pbod
 }
 
 
-KinBody::KinBodyStateSaverRef::KinBodyStateSaverRef(KinBody& body, int options) : _body(body), _options(options), _bRestoreOnDestructor(true), _bReleased(false)
+KinBody::KinBodyStateSaverRef::KinBodyStateSaverRef(KinBody& body, int options) : _body(body), _options(options), _nSavedUpdateStamp(0), _bSavedDOFValues(false), _bRestoreOnDestructor(true), _bReleased(false)
 {
     if( _options & Save_LinkTransformation ) {
-        body.GetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        _nSavedUpdateStamp = body.GetUpdateStamp();
+        _bSavedDOFValues = body._IsLinkTransformationFromDOFValues();
+        if( _bSavedDOFValues ) {
+            // planners save the state around every check, so only copy the dof values into a pooled buffer
+            body._PopStateSaverBuffer(_vSavedDOFValues);
+            _vSavedDOFValues = body._vLastSetDOFValues;
+            _tSavedBase = body.GetTransform();
+        }
+        else {
+            body.GetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        }
     }
     if( _options & Save_LinkEnable ) {
         _vEnabledLinks.resize(body.GetLinks().size());
@@ -203,6 +246,7 @@ KinBody::KinBodyStateSaverRef::~KinBodyStateSaverRef()
     if( _bRestoreOnDestructor && !_bReleased && _body.GetEnvironmentId() != 0 ) {
         _RestoreKinBody(_body);
     }
+    _body._PushStateSaverBuffer(_vSavedDOFValues);
 }
 
 void KinBody::KinBodyStateSaverRef::Restore()
@@ -233,6 +277,8 @@ void KinBody::KinBodyStateSaverRef::_RestoreKinBody(KinBody& body)
         RAVELOG_WARN(str(boost::format("body %s not added to environment, skipping restore")%body.GetName()));
         return;
     }
+    // if nothing changed the body since it was saved, the link transformations do not have to be set again
+    bool bLinkTransformationUnchanged = &body == &_body && body.GetUpdateStamp() == _nSavedUpdateStamp;
     if( _options & Save_JointLimits ) {
         body.SetDOFLimits(_vDOFLimits[0], _vDOFLimits[1]);
     }
@@ -270,12 +316,19 @@ void KinBody::KinBodyStateSaverRef::_RestoreKinBody(KinBody& body)
         }
 
         // if not calling SetLinkTransformations, then manually call _UpdateGrabbedBodies
-        if( !(_options & Save_LinkTransformation ) ) {
+        if( !(_options & Save_LinkTransformation ) || bLinkTransformationUnchanged ) {
             body._UpdateGrabbedBodies();
         }
     }
     if( _options & Save_LinkTransformation ) {
-        body.SetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        if( _bSavedDOFValues ) {
+            if( !bLinkTransformationUnchanged ) {
+                _SetSavedDOFValues(body, _vSavedDOFValues, _tSavedBase);
+            }
+        }
+        else if( !bLinkTransformationUnchanged ) {
+            body.SetLinkTransformations(_vLinkTransforms, _vdoflastsetvalues);
+        }
 //        if( IS_DEBUGLEVEL(Level_Warn) ) {
 //            stringstream ss; ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
 //            ss << "restoring kinbody " << body.GetName() << " to values=[";
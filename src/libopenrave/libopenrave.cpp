@@ -437,11 +437,6 @@ public:
             RAVELOG_WARN("failed to set to C locale: %s\n",e.what());
         }
 
-        _pdatabase.reset(new RaveDatabase());
-        if( !_pdatabase->Init(bLoadAllPlugins) ) {
-            RAVELOG_FATAL("failed to create the openrave plugin database\n");
-        }
-
         char* phomedir = getenv("OPENRAVE_HOME"); // getenv not thread-safe?
         if( phomedir == NULL ) {
 #ifndef _WIN32
@@ -459,6 +454,17 @@ public:
         CreateDirectory(_homedirectory.c_str(),NULL);
 #endif
 
+        // the plugin manifest lets short lived processes start without opening every plugin
+        std::string pluginmanifest = _homedirectory + s_filesep + "plugins.manifest";
+        const char* pOPENRAVE_PLUGIN_MANIFEST = getenv("OPENRAVE_PLUGIN_MANIFEST"); // getenv not thread-safe?
+        if( pOPENRAVE_PLUGIN_MANIFEST != NULL ) {
+            pluginmanifest = pOPENRAVE_PLUGIN_MANIFEST;
+        }
+        _pdatabase.reset(new RaveDatabase());
+        if( !_pdatabase->Init(bLoadAllPlugins, pluginmanifest) ) {
+            RAVELOG_FATAL("failed to create the openrave plugin database\n");
+        }
+
 #ifdef _WIN32
         const char* delim = ";";
 #else
@@ -477,6 +483,14 @@ public:
             _defaultviewertype = std::string(pOPENRAVE_DEFAULT_VIEWER);
         }
 
+        // record profiling spans for the lifetime of openrave and write them to a chrome trace on destroy
+        _profilingtracefilename.clear();
+        const char* pOPENRAVE_PROFILE_FILE = std::getenv("OPENRAVE_PROFILE_FILE");
+        if( !!pOPENRAVE_PROFILE_FILE && strlen(pOPENRAVE_PROFILE_FILE) > 0 ) {
+            _profilingtracefilename = std::string(pOPENRAVE_PROFILE_FILE);
+            RaveSetProfilingEnabled(true);
+        }
+
         _UpdateDataDirs();
         return 0;
     }
@@ -516,6 +530,12 @@ public:
         }
         listDestroyCallbacks.clear();
 
+        if( _profilingtracefilename.size() > 0 ) {
+            RaveSetProfilingEnabled(false);
+            RaveSaveProfilingChromeTrace(_profilingtracefilename);
+            _profilingtracefilename.clear();
+        }
+
         if( !!_pdatabase ) {
             // force destroy in case some one is holding a pointer to it
             _pdatabase->Destroy();
@@ -1053,6 +1073,7 @@ private:
     std::list<boost::function<void()> > _listDestroyCallbacks;
     std::string _homedirectory;
     std::string _defaultviewertype; ///< the default viewer type from the environment variable OPENRAVE_DEFAULT_VIEWER
+    std::string _profilingtracefilename; ///< the file to write the profiling spans to on destroy, from the environment variable OPENRAVE_PROFILE_FILE
     std::vector<std::string> _vdbdirectories;
     int _nGlobalEnvironmentId;
     SpaceSamplerBasePtr _pdefaultsampler;
@@ -1928,9 +1949,54 @@ void CollisionReport::Reset(int coloptions)
         vLinkColliding.resize(0);
         plink1.reset();
         plink2.reset();
+        bTruncated = false;
     }
 }
 
+void CollisionReport::Reserve(size_t numcontacts, size_t numlinkpairs, bool bfixedcapacity)
+{
+    contacts.reserve(numcontacts);
+    vLinkColliding.reserve(numlinkpairs);
+    bFixedCapacity = bfixedcapacity;
+}
+
+bool CollisionReport::AddContact(const CONTACT& contact)
+{
+    if( bFixedCapacity && contacts.size() >= contacts.capacity() ) {
+        bTruncated = true;
+        return false;
+    }
+    contacts.push_back(contact);
+    return true;
+}
+
+bool CollisionReport::AddLinkColliding(KinBody::LinkConstPtr plinka, KinBody::LinkConstPtr plinkb)
+{
+    std::pair<KinBody::LinkConstPtr, KinBody::LinkConstPtr> linkpair(plinka, plinkb);
+    std::vector<std::pair<KinBody::LinkConstPtr, KinBody::LinkConstPtr> >::iterator it = std::lower_bound(vLinkColliding.begin(), vLinkColliding.end(), linkpair);
+    if( it != vLinkColliding.end() && *it == linkpair ) {
+        return true;
+    }
+    if( bFixedCapacity && vLinkColliding.size() >= vLinkColliding.capacity() ) {
+        bTruncated = true;
+        return false;
+    }
+    vLinkColliding.insert(it, linkpair);
+    return true;
+}
+
+size_t CollisionReport::GetCollidingLinkPairs(std::vector<std::pair<KinBody::LinkConstPtr, KinBody::LinkConstPtr> >& vlinkpairs) const
+{
+    vlinkpairs.resize(0);
+    if( vLinkColliding.size() > 0 ) {
+        vlinkpairs = vLinkColliding;
+    }
+    else if( !!plink1 || !!plink2 ) {
+        vlinkpairs.push_back(std::make_pair(plink1, plink2));
+    }
+    return vlinkpairs.size();
+}
+
 std::string CollisionReport::__str__() const
 {
     stringstream s;
@@ -2052,17 +2118,115 @@ bool PhysicsEngineBase::GetLinkForceTorque(KinBody::LinkConstPtr plink, Vector&
     return true;
 }
 
+/// \brief simulates the rollouts ithread, ithread+numthreads, ... in the world penv of one thread
+static void _SimulateRolloutsThread(EnvironmentBasePtr penv, int ithread, int numthreads, int numsteps, dReal fTimeElapsed, const PhysicsEngineBase::RolloutActionFn& actionfn, const std::vector<PhysicsEngineBase::RolloutBodyState>& vinitialstates, std::vector< std::vector<PhysicsEngineBase::RolloutBodyState> >& vrolloutstates, std::string& errormsg)
+{
+    try {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        PhysicsEngineBasePtr pphysics = penv->GetPhysicsEngine();
+        std::vector<KinBodyPtr> vbodies(vinitialstates.size());
+        for(size_t ibody = 0; ibody < vinitialstates.size(); ++ibody) {
+            vbodies[ibody] = penv->GetBodyFromEnvironmentId(vinitialstates[ibody].environmentid);
+            if( !vbodies[ibody] ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("env=%d, body with id %d is not in the rollout world", penv->GetId()%vinitialstates[ibody].environmentid, ORE_Assert);
+            }
+        }
+        for(int irollout = ithread; irollout < (int)vrolloutstates.size(); irollout += numthreads) {
+            for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+                vbodies[ibody]->SetLinkTransformations(vinitialstates[ibody].vlinktransforms, vinitialstates[ibody].vdofvalues);
+                pphysics->SetLinkVelocities(vbodies[ibody], vinitialstates[ibody].vlinkvelocities);
+            }
+            for(int istep = 0; istep < numsteps; ++istep) {
+                if( !!actionfn ) {
+                    actionfn(penv, irollout, istep);
+                }
+                pphysics->SimulateStep(fTimeElapsed);
+            }
+            std::vector<PhysicsEngineBase::RolloutBodyState>& vstates = vrolloutstates[irollout];
+            vstates.resize(vbodies.size());
+            for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+                vstates[ibody].environmentid = vinitialstates[ibody].environmentid;
+                vbodies[ibody]->GetLinkTransformations(vstates[ibody].vlinktransforms, vstates[ibody].vdofvalues);
+                pphysics->GetLinkVelocities(vbodies[ibody], vstates[ibody].vlinkvelocities);
+            }
+        }
+    }
+    catch(const std::exception& ex) {
+        errormsg = ex.what();
+    }
+}
+
+void PhysicsEngineBase::SimulateRollouts(int numrollouts, int numsteps, dReal fTimeElapsed, const RolloutActionFn& actionfn, std::vector< std::vector<RolloutBodyState> >& vrolloutstates, int numthreads)
+{
+    vrolloutstates.resize(0);
+    vrolloutstates.resize(std::max(0, numrollouts));
+    if( numrollouts <= 0 ) {
+        return;
+    }
+    EnvironmentBasePtr penv = GetEnv();
+    if( numthreads <= 0 ) {
+        numthreads = std::max(1, (int)boost::thread::hardware_concurrency());
+    }
+    numthreads = std::min(numthreads, numrollouts);
+
+    std::vector<KinBodyPtr> vbodies;
+    penv->GetBodies(vbodies);
+    std::vector<RolloutBodyState> vinitialstates(vbodies.size());
+    for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+        vinitialstates[ibody].environmentid = vbodies[ibody]->GetEnvironmentId();
+        vbodies[ibody]->GetLinkTransformations(vinitialstates[ibody].vlinktransforms, vinitialstates[ibody].vdofvalues);
+        GetLinkVelocities(vbodies[ibody], vinitialstates[ibody].vlinkvelocities);
+    }
+
+    while( (int)_vrolloutenvs.size() < numthreads ) {
+        EnvironmentBasePtr pthreadenv = penv->CloneSelf(Clone_Bodies);
+        // the rollouts step the physics engine directly
+        pthreadenv->StopSimulation();
+        _vrolloutenvs.push_back(pthreadenv);
+    }
+    for(int ithread = 0; ithread < numthreads; ++ithread) {
+        EnvironmentBasePtr pthreadenv = _vrolloutenvs[ithread];
+        pthreadenv->SynchronizeBodies(penv);
+        EnvironmentMutex::scoped_lock lock(pthreadenv->GetMutex());
+        PhysicsEngineBasePtr pthreadphysics = pthreadenv->GetPhysicsEngine();
+        if( !pthreadphysics || pthreadphysics->GetXMLId() != GetXMLId() ) {
+            pthreadphysics = RaveCreatePhysicsEngine(pthreadenv, GetXMLId());
+            if( !pthreadphysics ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("env=%d, failed to create physics engine %s", penv->GetId()%GetXMLId(), ORE_InvalidPlugin);
+            }
+            pthreadenv->SetPhysicsEngine(pthreadphysics);
+        }
+        // copy the current parameters like gravity
+        pthreadphysics->Clone(shared_from_this(), 0);
+    }
+
+    std::vector<std::string> verrormsgs(numthreads);
+    std::vector< boost::shared_ptr<boost::thread> > vthreads(numthreads);
+    for(int ithread = 0; ithread < numthreads; ++ithread) {
+        vthreads[ithread].reset(new boost::thread(boost::bind(_SimulateRolloutsThread, _vrolloutenvs[ithread], ithread, numthreads, numsteps, fTimeElapsed, boost::cref(actionfn), boost::cref(vinitialstates), boost::ref(vrolloutstates), boost::ref(verrormsgs[ithread]))));
+    }
+    FOREACH(itthread, vthreads) {
+        (*itthread)->join();
+    }
+    FOREACHC(iterrormsg, verrormsgs) {
+        if( iterrormsg->size() > 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, rollout failed: %s", penv->GetId()%*iterrormsg, ORE_Failed);
+        }
+    }
+    RAVELOG_VERBOSE_FORMAT("env=%d, simulated %d rollouts of %d steps with %d threads", penv->GetId()%numrollouts%numsteps%numthreads);
+}
+
 void TriMesh::ApplyTransform(const Transform& t)
 {
-    FOREACH(it, vertices) {
-        *it = t * *it;
+    if( vertices.size() > 0 ) {
+        geometry::TransformPoints(t, &vertices[0], vertices.size(), &vertices[0]);
     }
 }
 
 void TriMesh::ApplyTransform(const TransformMatrix& t)
 {
-    FOREACH(it, vertices) {
-        *it = t * *it;
+    if( vertices.size() > 0 ) {
+        geometry::TransformPoints(t, &vertices[0], vertices.size(), &vertices[0]);
     }
 }
 
@@ -2140,6 +2304,130 @@ void TriMesh::serialize(std::ostream& o, int options) const
     }
 }
 
+CompactTriMesh::CompactTriMesh()
+{
+}
+
+CompactTriMesh::CompactTriMesh(const TriMesh& mesh)
+{
+    OPENRAVE_ASSERT_OP(mesh.indices.size()%3, ==, 0);
+    boost::shared_ptr<std::vector<float> > pvertices(new std::vector<float>(3*mesh.vertices.size()));
+    for(size_t i = 0; i < mesh.vertices.size(); ++i) {
+        (*pvertices)[3*i+0] = (float)mesh.vertices[i].x;
+        (*pvertices)[3*i+1] = (float)mesh.vertices[i].y;
+        (*pvertices)[3*i+2] = (float)mesh.vertices[i].z;
+    }
+    _pvertices = pvertices;
+    if( mesh.vertices.size() <= 0x10000 ) {
+        boost::shared_ptr<std::vector<uint16_t> > pindices(new std::vector<uint16_t>(mesh.indices.size()));
+        for(size_t i = 0; i < mesh.indices.size(); ++i) {
+            (*pindices)[i] = (uint16_t)mesh.indices[i];
+        }
+        _pindices16 = pindices;
+    }
+    else {
+        _pindices32.reset(new std::vector<uint32_t>(mesh.indices.begin(), mesh.indices.end()));
+    }
+}
+
+void CompactTriMesh::GetTriMesh(TriMesh& mesh) const
+{
+    size_t numvertices = GetNumVertices(), numindices = GetNumIndices();
+    mesh.vertices.resize(numvertices);
+    for(size_t i = 0; i < numvertices; ++i) {
+        mesh.vertices[i] = GetVertex(i);
+    }
+    mesh.indices.resize(numindices);
+    for(size_t i = 0; i < numindices; ++i) {
+        mesh.indices[i] = (int32_t)GetIndex(i);
+    }
+}
+
+AABB CompactTriMesh::ComputeAABB() const
+{
+    AABB ab;
+    size_t numvertices = GetNumVertices();
+    if( numvertices == 0 ) {
+        return ab;
+    }
+    const float* p = GetVertices();
+    float vmin[3] = {p[0], p[1], p[2]}, vmax[3] = {p[0], p[1], p[2]};
+    for(size_t i = 1; i < numvertices; ++i) {
+        p += 3;
+        for(int j = 0; j < 3; ++j) {
+            if( vmin[j] > p[j] ) {
+                vmin[j] = p[j];
+            }
+            if( vmax[j] < p[j] ) {
+                vmax[j] = p[j];
+            }
+        }
+    }
+    ab.extents = Vector(0.5*(vmax[0]-vmin[0]), 0.5*(vmax[1]-vmin[1]), 0.5*(vmax[2]-vmin[2]));
+    ab.pos = Vector(0.5*(vmax[0]+vmin[0]), 0.5*(vmax[1]+vmin[1]), 0.5*(vmax[2]+vmin[2]));
+    return ab;
+}
+
+size_t CompactTriMesh::GetMemoryUsage() const
+{
+    size_t usage = 0;
+    if( !!_pvertices ) {
+        usage += _pvertices->size()*sizeof(float);
+    }
+    if( !!_pindices16 ) {
+        usage += _pindices16->size()*sizeof(uint16_t);
+    }
+    if( !!_pindices32 ) {
+        usage += _pindices32->size()*sizeof(uint32_t);
+    }
+    return usage;
+}
+
+/// \brief contacts can be reported slightly before the geometries touch, so aabbs closer than this are still checked
+static const dReal s_fGrabbedAABBPadding = 0.001;
+
+/// \brief true if ab is within s_fGrabbedAABBPadding of one of vaabbs
+static bool _IsNearAABBs(const AABB& ab, const std::vector<AABB>& vaabbs)
+{
+    FOREACHC(itab, vaabbs) {
+        if( RaveFabs(ab.pos.x - itab->pos.x) <= ab.extents.x + itab->extents.x + s_fGrabbedAABBPadding
+            && RaveFabs(ab.pos.y - itab->pos.y) <= ab.extents.y + itab->extents.y + s_fGrabbedAABBPadding
+            && RaveFabs(ab.pos.z - itab->pos.z) <= ab.extents.z + itab->extents.z + s_fGrabbedAABBPadding ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector< std::vector<GrabbedCollisionCache::LinkResult> >* Grabbed::_GetCachedLinkResults(KinBodyPtr pbody, CollisionCheckerBasePtr pchecker, KinBodyConstPtr pgrabbedbody)
+{
+    if( pgrabbedbody->GetDOF() > 0 ) {
+        // the links of the grabbed body can move relative to each other
+        return NULL;
+    }
+    GrabbedCollisionCachePtr pcache = boost::dynamic_pointer_cast<GrabbedCollisionCache>(pbody->_pGrabbedCollisionCache);
+    if( !pcache ) {
+        pcache.reset(new GrabbedCollisionCache());
+        pbody->_pGrabbedCollisionCache = pcache;
+    }
+    if( pcache->bodyhash != pbody->GetKinematicsGeometryHash() || pcache->pwchecker.lock() != pchecker ) {
+        pcache->mapLinkResults.clear();
+        pcache->bodyhash = pbody->GetKinematicsGeometryHash();
+        pcache->pwchecker = pchecker;
+    }
+    const std::string& grabbedhash = pgrabbedbody->GetKinematicsGeometryHash();
+    std::map<std::string, std::vector< std::vector<GrabbedCollisionCache::LinkResult> > >::iterator it = pcache->mapLinkResults.find(grabbedhash);
+    if( it == pcache->mapLinkResults.end() ) {
+        if( pcache->mapLinkResults.size() >= 32 ) {
+            // too many kinds of bodies, start over
+            pcache->mapLinkResults.clear();
+        }
+        it = pcache->mapLinkResults.insert(std::make_pair(grabbedhash, std::vector< std::vector<GrabbedCollisionCache::LinkResult> >())).first;
+    }
+    it->second.resize(pbody->GetLinks().size());
+    return &it->second;
+}
+
 void Grabbed::ProcessCollidingLinks(const std::set<int>& setRobotLinksToIgnore)
 {
     _setRobotLinksToIgnore = setRobotLinksToIgnore;
@@ -2162,18 +2450,56 @@ void Grabbed::ProcessCollidingLinks(const std::set<int>& setRobotLinksToIgnore)
 
         //uint64_t starttime = utils::GetMicroTime();
 
+        // links whose aabbs are away from the grabbed body cannot collide with it
+        std::vector<AABB> vgrabbedaabbs;
+        FOREACHC(itgrabbedlink, pgrabbedbody->GetLinks()) {
+            if( (*itgrabbedlink)->GetGeometries().size() > 0 ) {
+                vgrabbedaabbs.push_back((*itgrabbedlink)->ComputeAABB());
+            }
+        }
+        std::vector< std::vector<GrabbedCollisionCache::LinkResult> >* pvlinkresults = _GetCachedLinkResults(pbody, pchecker, pgrabbedbody);
+        Transform tgrabbedinv = pgrabbedbody->GetTransform().inverse();
+
         // check collision with all links to see which are valid
         int numchecked = 0;
         FOREACHC(itlink, pbody->GetLinks()) {
             int noncolliding = 0;
             if( find(_vattachedlinks.begin(),_vattachedlinks.end(), *itlink) == _vattachedlinks.end() ) {
                 if( setRobotLinksToIgnore.find((*itlink)->GetIndex()) == setRobotLinksToIgnore.end() ) {
-                    ++numchecked;
-                    //uint64_t localstarttime = utils::GetMicroTime();
-                    if( !pchecker->CheckCollision(KinBody::LinkConstPtr(*itlink), pgrabbedbody) ) {
+                    if( !_IsNearAABBs((*itlink)->ComputeAABB(), vgrabbedaabbs) ) {
                         noncolliding = 1;
                     }
-                    //RAVELOG_DEBUG_FORMAT("check %s col %s %s %fs", pchecker->GetXMLId()%(*itlink)->GetName()%pgrabbedbody->GetName()%(1e-6*(utils::GetMicroTime()-localstarttime)));
+                    else {
+                        bool bcached = false;
+                        Transform tLinkInGrabbed = tgrabbedinv * (*itlink)->GetTransform();
+                        if( !!pvlinkresults ) {
+                            FOREACHC(itresult, pvlinkresults->at((*itlink)->GetIndex())) {
+                                if( TransformDistance2(itresult->tLinkInGrabbed, tLinkInGrabbed) <= g_fEpsilonLinear ) {
+                                    noncolliding = itresult->noncolliding;
+                                    bcached = true;
+                                    break;
+                                }
+                            }
+                        }
+                        if( !bcached ) {
+                            ++numchecked;
+                            //uint64_t localstarttime = utils::GetMicroTime();
+                            if( !pchecker->CheckCollision(KinBody::LinkConstPtr(*itlink), pgrabbedbody) ) {
+                                noncolliding = 1;
+                            }
+                            //RAVELOG_DEBUG_FORMAT("check %s col %s %s %fs", pchecker->GetXMLId()%(*itlink)->GetName()%pgrabbedbody->GetName()%(1e-6*(utils::GetMicroTime()-localstarttime)));
+                            if( !!pvlinkresults ) {
+                                std::vector<GrabbedCollisionCache::LinkResult>& vresults = pvlinkresults->at((*itlink)->GetIndex());
+                                if( vresults.size() >= 8 ) {
+                                    vresults.erase(vresults.begin());
+                                }
+                                GrabbedCollisionCache::LinkResult result;
+                                result.tLinkInGrabbed = tLinkInGrabbed;
+                                result.noncolliding = noncolliding;
+                                vresults.push_back(result);
+                            }
+                        }
+                    }
                 }
             }
             _mapLinkIsNonColliding[*itlink] = noncolliding;
@@ -2200,7 +2526,7 @@ void Grabbed::ProcessCollidingLinks(const std::set<int>& setRobotLinksToIgnore)
                     int noncolliding = 0;
                     if( bsamelink && find(vbodyattachedlinks.begin(),vbodyattachedlinks.end(), *itlink) != vbodyattachedlinks.end() ) {
                     }
-                    else if( !pchecker->CheckCollision(KinBody::LinkConstPtr(*itlink), pgrabbedbody) ) {
+                    else if( !_IsNearAABBs((*itlink)->ComputeAABB(), vgrabbedaabbs) || !pchecker->CheckCollision(KinBody::LinkConstPtr(*itlink), pgrabbedbody) ) {
                         noncolliding = 1;
                     }
                     _mapLinkIsNonColliding[*itlink] = noncolliding;
@@ -2460,6 +2786,91 @@ bool SensorBase::CameraSensorData::serialize(std::ostream& O) const
     return true;
 }
 
+SensorBase::SensorDataRingBuffer::SensorDataRingBuffer(size_t capacity) : _capacity(max(capacity, (size_t)1)), _nextsequence(1)
+{
+}
+
+SensorBase::SensorDataPtr SensorBase::SensorDataRingBuffer::AcquireFrame(const boost::function<SensorDataPtr()>& fncreate)
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        for(size_t i = 0; i < _vpool.size(); ++i) {
+            if( _vpool[i].unique() ) {
+                // no consumer holds it anymore
+                SensorDataPtr pframe = _vpool[i];
+                _vpool[i] = _vpool.back();
+                _vpool.pop_back();
+                return pframe;
+            }
+        }
+    }
+    return fncreate();
+}
+
+void SensorBase::SensorDataRingBuffer::Publish(SensorDataPtr pframe)
+{
+    BOOST_ASSERT(!!pframe);
+    boost::mutex::scoped_lock lock(_mutex);
+    pframe->__sequence = _nextsequence++;
+    _dequeframes.push_back(pframe);
+    while( _dequeframes.size() > _capacity ) {
+        if( _vpool.size() < _capacity ) {
+            _vpool.push_back(_dequeframes.front());
+        }
+        _dequeframes.pop_front();
+    }
+}
+
+SensorBase::SensorDataConstPtr SensorBase::SensorDataRingBuffer::GetLatest() const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    if( _dequeframes.size() == 0 ) {
+        return SensorDataConstPtr();
+    }
+    return _dequeframes.back();
+}
+
+int SensorBase::SensorDataRingBuffer::GetFramesSince(uint64_t sequence, std::vector<SensorDataConstPtr>& vframes) const
+{
+    vframes.resize(0);
+    boost::mutex::scoped_lock lock(_mutex);
+    if( _dequeframes.size() == 0 ) {
+        return 0;
+    }
+    FOREACHC(itframe, _dequeframes) {
+        if( (*itframe)->__sequence > sequence ) {
+            vframes.push_back(*itframe);
+        }
+    }
+    uint64_t oldestsequence = _dequeframes.front()->__sequence;
+    return oldestsequence > sequence+1 ? (int)(oldestsequence - sequence - 1) : 0;
+}
+
+void SensorBase::SensorDataRingBuffer::Clear()
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _dequeframes.clear();
+    _vpool.clear();
+}
+
+void SensorBase::SensorDataRingBuffer::SetCapacity(size_t capacity)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _capacity = max(capacity, (size_t)1);
+    while( _dequeframes.size() > _capacity ) {
+        _dequeframes.pop_front();
+    }
+    if( _vpool.size() > _capacity ) {
+        _vpool.resize(_capacity);
+    }
+}
+
+size_t SensorBase::SensorDataRingBuffer::GetCapacity() const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _capacity;
+}
+
 void SensorBase::SensorGeometry::Serialize(BaseXMLWriterPtr writer, int options) const
 {
     AttributesList atts;
@@ -2602,6 +3013,57 @@ CollisionOptionsStateSaver::~CollisionOptionsStateSaver()
     _p->SetCollisionOptions(_oldoptions);
 }
 
+int CollisionCheckerBase::CheckCollisionConfigurations(KinBodyPtr pbody, const std::vector<int>& vdofindices, const std::vector<dReal>& vconfigurations, std::vector<uint8_t>& vcollisions, bool bCheckSelfCollision)
+{
+    const size_t dof = vdofindices.size() > 0 ? vdofindices.size() : (size_t)pbody->GetDOF();
+    vcollisions.resize(0);
+    if( dof == 0 ) {
+        return 0;
+    }
+    OPENRAVE_ASSERT_OP(vconfigurations.size()%dof, ==, 0);
+    const size_t numconfigurations = vconfigurations.size()/dof;
+    vcollisions.resize(numconfigurations, 0);
+
+    KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+    std::vector<dReal> vvalues(dof);
+    int numcollisions = 0;
+    for(size_t iconfig = 0; iconfig < numconfigurations; ++iconfig) {
+        std::copy(vconfigurations.begin()+iconfig*dof, vconfigurations.begin()+(iconfig+1)*dof, vvalues.begin());
+        pbody->SetDOFValues(vvalues, KinBody::CLA_Nothing, vdofindices);
+        if( CheckCollision(KinBodyConstPtr(pbody)) || (bCheckSelfCollision && pbody->CheckSelfCollision(CollisionReportPtr(), shared_collisionchecker())) ) {
+            vcollisions[iconfig] = 1;
+            ++numcollisions;
+        }
+    }
+    return numcollisions;
+}
+
+int CollisionCheckerBase::CheckCollisionRays(const std::vector<RAY>& vrays, KinBodyConstPtr pbody, std::vector<dReal>& vhitdistances, std::vector<Vector>& vhitnormals, std::vector<int>& vhitbodyids)
+{
+    vhitdistances.resize(vrays.size());
+    vhitnormals.resize(vrays.size());
+    vhitbodyids.resize(vrays.size());
+    CollisionOptionsStateSaver optionsaver(shared_collisionchecker(), GetCollisionOptions()|CO_Distance, false);
+    CollisionReportPtr report(new CollisionReport());
+    int numhits = 0;
+    for(size_t iray = 0; iray < vrays.size(); ++iray) {
+        bool bCollision = !!pbody ? CheckCollision(vrays[iray], pbody, report) : CheckCollision(vrays[iray], report);
+        if( bCollision ) {
+            vhitdistances[iray] = report->minDistance;
+            vhitnormals[iray] = report->contacts.size() > 0 ? report->contacts[0].norm : Vector();
+            KinBody::LinkConstPtr plink = !!report->plink1 ? report->plink1 : report->plink2;
+            vhitbodyids[iray] = !!plink ? plink->GetParent()->GetEnvironmentId() : 0;
+            ++numhits;
+        }
+        else {
+            vhitdistances[iray] = -1;
+            vhitnormals[iray] = Vector();
+            vhitbodyids[iray] = 0;
+        }
+    }
+    return numhits;
+}
+
 void RaveInitRandomGeneration(uint32_t seed)
 {
     RaveGlobal::instance()->GetDefaultSampler()->SetSeed(seed);
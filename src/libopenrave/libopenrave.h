@@ -280,6 +280,12 @@ inline dReal TransformDistance2(const Transform& t1, const Transform& t2, dReal
     return (t1.trans-t2.trans).lengthsqr3() + frotweight*fcos; //*fcos;
 }
 
+/// \brief true if the transforms are exactly the same, used to check if something moved since it was last computed
+inline bool IsSameTransform(const Transform& t0, const Transform& t1)
+{
+    return t0.rot.x == t1.rot.x && t0.rot.y == t1.rot.y && t0.rot.z == t1.rot.z && t0.rot.w == t1.rot.w && t0.trans.x == t1.trans.x && t0.trans.y == t1.trans.y && t0.trans.z == t1.trans.z;
+}
+
 int SetDOFValuesIndicesParameters(KinBodyPtr pbody, const std::vector<dReal>& values, const std::vector<int>& vindices, int options);
 int SetDOFVelocitiesIndicesParameters(KinBodyPtr pbody, const std::vector<dReal>& velocities, const std::vector<int>& vindices, int options);
 int CallSetStateValuesFns(const std::vector< std::pair<PlannerBase::PlannerParameters::SetStateValuesFn, int> >& vfunctions, int nDOF, int nMaxDOFForGroup, const std::vector<dReal>& v, int options);
@@ -289,10 +295,29 @@ void CallGetStateFns(const std::vector< std::pair<PlannerBase::PlannerParameters
 void subtractstates(std::vector<dReal>& q1, const std::vector<dReal>& q2);
 
 /// \brief The information of a currently grabbed body.
+/// \brief collision results of Grabbed::ProcessCollidingLinks stored in the grabbing body
+///
+/// Whether a link collides with a rigid grabbed body only depends on their geometries and relative pose, so the results are reused when a body with the same geometry is grabbed again at the same pose relative to the link.
+class GrabbedCollisionCache : public UserData
+{
+public:
+    struct LinkResult
+    {
+        Transform tLinkInGrabbed; ///< transform of the link in the frame of the grabbed body
+        int noncolliding;
+    };
+
+    std::string bodyhash; ///< GetKinematicsGeometryHash of the grabbing body when the results were computed
+    CollisionCheckerBaseWeakPtr pwchecker; ///< checker used to compute the results
+    std::map<std::string, std::vector< std::vector<LinkResult> > > mapLinkResults; ///< for every GetKinematicsGeometryHash of a grabbed body, the results indexed by the grabbing body link index
+};
+
+typedef boost::shared_ptr<GrabbedCollisionCache> GrabbedCollisionCachePtr;
+
 class Grabbed : public UserData, public boost::enable_shared_from_this<Grabbed>
 {
 public:
-    Grabbed(KinBodyPtr pgrabbedbody, KinBody::LinkPtr plinkrobot) : _pgrabbedbody(pgrabbedbody), _plinkrobot(plinkrobot) {
+    Grabbed(KinBodyPtr pgrabbedbody, KinBody::LinkPtr plinkrobot) : _pgrabbedbody(pgrabbedbody), _plinkrobot(plinkrobot), _nLastUpdateStamp(-1) {
         _enablecallback = pgrabbedbody->RegisterChangeCallback(KinBody::Prop_LinkEnable, boost::bind(&Grabbed::UpdateCollidingLinks, this));
         _plinkrobot->GetRigidlyAttachedLinks(_vattachedlinks);
     }
@@ -303,6 +328,9 @@ public:
     std::list<KinBody::LinkConstPtr> _listNonCollidingLinks;         ///< links that are not colliding with the grabbed body at the time of Grab
     Transform _troot;         ///< root transform (of first link of body) relative to plinkrobot's transform. In other words, pbody->GetTransform() == plinkrobot->GetTransform()*troot
     std::set<int> _setRobotLinksToIgnore; ///< original links of the robot to force ignoring
+    Transform _tLastLinkTransform; ///< transform of plinkrobot when the grabbed body was last moved
+    std::pair<Vector, Vector> _vLastLinkVelocity; ///< velocity of plinkrobot when the grabbed body was last moved
+    int _nLastUpdateStamp; ///< update stamp of the grabbed body after it was last moved, if it is the same and plinkrobot did not move the body does not have to be moved
 
     /// \brief check collision with all links to see which are valid.
     ///
@@ -326,6 +354,9 @@ public:
     void UpdateCollidingLinks();
 
 private:
+    /// \brief returns the cached results for the links of pbody colliding with pgrabbedbody, or NULL if they cannot be reused
+    std::vector< std::vector<GrabbedCollisionCache::LinkResult> >* _GetCachedLinkResults(KinBodyPtr pbody, CollisionCheckerBasePtr pchecker, KinBodyConstPtr pgrabbedbody);
+
     std::vector<KinBody::LinkPtr> _vattachedlinks;
     UserDataPtr _enablecallback; ///< callback for grabbed body when it is enabled/disabled
 
@@ -63,6 +63,29 @@ inline ModuleBasePtr GetModule(void* module)
     return RaveInterfaceCast<ModuleBase>(*static_cast<InterfaceBasePtr*>(module));
 }
 
+inline Transform GetTransformFromPose(const dReal* pose)
+{
+    Transform t;
+    for(int i = 0; i < 4; ++i) {
+        t.rot[i] = pose[i];
+    }
+    for(int i = 0; i < 3; ++i) {
+        t.trans[i] = pose[4+i];
+    }
+    t.rot.normalize4();
+    return t;
+}
+
+inline void GetPoseFromTransform(const Transform& t, dReal* pose)
+{
+    for(int i = 0; i < 4; ++i) {
+        pose[i] = t.rot[i];
+    }
+    for(int i = 0; i < 3; ++i) {
+        pose[4+i] = t.trans[i];
+    }
+}
+
 }
 
 extern "C" {
@@ -342,15 +365,7 @@ int ORCBodyGetLinks(void* body, void** links)
 
 void ORCBodySetTransform(void* body, const dReal* pose)
 {
-    Transform t;
-    for(int i = 0; i < 4; ++i) {
-        t.rot[i] = pose[i];
-    }
-    for(int i = 0; i < 3; ++i) {
-        t.trans[i] = pose[4+i];
-    }
-    t.rot.normalize4();
-    GetBody(body)->SetTransform(t);
+    GetBody(body)->SetTransform(GetTransformFromPose(pose));
 }
 
 void ORCBodySetTransformMatrix(void* body, const dReal* matrix)
@@ -367,13 +382,7 @@ void ORCBodySetTransformMatrix(void* body, const dReal* matrix)
 
 void ORCBodyGetTransform(void* body, dReal* pose)
 {
-    Transform t = GetBody(body)->GetTransform();
-    for(int i = 0; i < 4; ++i) {
-        pose[i] = t.rot[i];
-    }
-    for(int i = 0; i < 3; ++i) {
-        pose[4+i] = t.trans[i];
-    }
+    GetPoseFromTransform(GetBody(body)->GetTransform(), pose);
 }
 
 void ORCBodyGetTransformMatrix(void* body, dReal* matrix)
@@ -404,6 +413,152 @@ int ORCBodyInitFromTrimesh(void* body, void* trimesh, int visible)
     }
 }
 
+void ORCBodyGetLinkTransforms(void* body, dReal* poses)
+{
+    const std::vector<KinBody::LinkPtr>& vlinks = GetBody(body)->GetLinks();
+    for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+        GetPoseFromTransform(vlinks[ilink]->GetTransform(), poses+7*ilink);
+    }
+}
+
+void ORCBodiesSetStates(void** bodies, int numbodies, const dReal* poses, const dReal* dofvalues)
+{
+    if( numbodies <= 0 ) {
+        return;
+    }
+    KinBodyPtr pfirstbody = GetBody(bodies[0]);
+    EnvironmentMutex::scoped_lock lock(pfirstbody->GetEnv()->GetMutex());
+    for(int ibody = 0; ibody < numbodies; ++ibody) {
+        KinBodyPtr pbody = GetBody(bodies[ibody]);
+        if( !!dofvalues && pbody->GetDOF() > 0 ) {
+            Transform t = !!poses ? GetTransformFromPose(poses+7*ibody) : pbody->GetTransform();
+            pbody->SetDOFValues(dofvalues, pbody->GetDOF(), t, KinBody::CLA_CheckLimits);
+            dofvalues += pbody->GetDOF();
+        }
+        else if( !!poses ) {
+            pbody->SetTransform(GetTransformFromPose(poses+7*ibody));
+        }
+    }
+}
+
+void ORCBodyComputeLinkTransformsBatch(void* body, const dReal* dofvalues, int numconfigs, dReal* poses)
+{
+    KinBodyPtr pbody = GetBody(body);
+    EnvironmentMutex::scoped_lock lock(pbody->GetEnv()->GetMutex());
+    KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+    const std::vector<KinBody::LinkPtr>& vlinks = pbody->GetLinks();
+    int dof = pbody->GetDOF();
+    for(int iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        pbody->SetDOFValues(dofvalues+iconfig*dof, dof, pbody->GetTransform(), KinBody::CLA_CheckLimits);
+        dReal* pconfigposes = poses+7*vlinks.size()*iconfig;
+        for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+            GetPoseFromTransform(vlinks[ilink]->GetTransform(), pconfigposes+7*ilink);
+        }
+    }
+}
+
+/// \brief true if every dof of the configuration is inside the limits, so CLA_CheckLimits would neither clamp nor warn
+inline bool IsConfigurationInLimits(const dReal* pvalues, const std::vector<dReal>& vlower, const std::vector<dReal>& vupper, const std::vector<uint8_t>& vcircular)
+{
+    for(size_t i = 0; i < vlower.size(); ++i) {
+        if( !vcircular[i] && (pvalues[i] < vlower[i] || pvalues[i] > vupper[i]) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ORCBodyCheckCollisionBatch(void* body, const dReal* dofvalues, int numconfigs, int checkself, int* results)
+{
+    KinBodyPtr pbody = GetBody(body);
+    EnvironmentBasePtr penv = pbody->GetEnv();
+    EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+    if( numconfigs <= 0 ) {
+        return 0;
+    }
+    KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+    int dof = pbody->GetDOF();
+    CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+
+    // configurations the checker can take in one batch, the others go through CLA_CheckLimits to be clamped and warned about like single queries
+    std::vector<int> vbatchindices;
+    if( !!pchecker && dof > 0 ) {
+        bool bHasSpherical = false;
+        std::vector<uint8_t> vcircular(dof, 0);
+        FOREACHC(itjoint, pbody->GetJoints()) {
+            bHasSpherical |= (*itjoint)->GetType() == KinBody::JointSpherical;
+            for(int i = 0; i < (*itjoint)->GetDOF(); ++i) {
+                vcircular[(*itjoint)->GetDOFIndex()+i] = (*itjoint)->IsCircular(i);
+            }
+        }
+        if( !bHasSpherical ) {
+            std::vector<dReal> vlower, vupper;
+            pbody->GetDOFLimits(vlower, vupper);
+            for(int iconfig = 0; iconfig < numconfigs; ++iconfig) {
+                if( IsConfigurationInLimits(dofvalues+iconfig*dof, vlower, vupper, vcircular) ) {
+                    vbatchindices.push_back(iconfig);
+                }
+            }
+        }
+    }
+
+    std::vector<uint8_t> vbatched(numconfigs, 0);
+    if( vbatchindices.size() > 0 ) {
+        std::vector<dReal> vconfigurations(vbatchindices.size()*dof);
+        for(size_t ibatch = 0; ibatch < vbatchindices.size(); ++ibatch) {
+            std::copy(dofvalues+vbatchindices[ibatch]*dof, dofvalues+(vbatchindices[ibatch]+1)*dof, vconfigurations.begin()+ibatch*dof);
+        }
+        std::vector<uint8_t> vcollisions;
+        // self collisions are checked below with KinBody::CheckSelfCollision so that the self collision checker and the grabbed bodies are used like before
+        pchecker->CheckCollisionConfigurations(pbody, std::vector<int>(), vconfigurations, vcollisions, false);
+        for(size_t ibatch = 0; ibatch < vbatchindices.size(); ++ibatch) {
+            vbatched[vbatchindices[ibatch]] = 1;
+            results[vbatchindices[ibatch]] = vcollisions[ibatch];
+        }
+    }
+
+    int numcolliding = 0;
+    for(int iconfig = 0; iconfig < numconfigs; ++iconfig) {
+        bool bcolliding;
+        if( vbatched[iconfig] ) {
+            bcolliding = results[iconfig] != 0;
+            if( !bcolliding && checkself == 1 ) {
+                pbody->SetDOFValues(dofvalues+iconfig*dof, dof, pbody->GetTransform(), KinBody::CLA_Nothing);
+                bcolliding = pbody->CheckSelfCollision();
+            }
+        }
+        else {
+            pbody->SetDOFValues(dofvalues+iconfig*dof, dof, pbody->GetTransform(), KinBody::CLA_CheckLimits);
+            bcolliding = penv->CheckCollision(KinBodyConstPtr(pbody)) || (checkself == 1 && pbody->CheckSelfCollision());
+        }
+        results[iconfig] = bcolliding ? 1 : 0;
+        numcolliding += results[iconfig];
+    }
+    return numcolliding;
+}
+
+int ORCRobotFindIKSolutionsBatch(void* robot, const char* manipname, const dReal* poses, int numposes, int filteroptions, dReal* solutions, int* results)
+{
+    RobotBasePtr probot = GetRobot(robot);
+    EnvironmentMutex::scoped_lock lock(probot->GetEnv()->GetMutex());
+    RobotBase::ManipulatorPtr pmanip = (!manipname || strlen(manipname) == 0) ? probot->GetActiveManipulator() : probot->GetManipulator(manipname);
+    if( !pmanip || !pmanip->GetIkSolver() ) {
+        RAVELOG_WARN_FORMAT("env=%d, robot %s does not have a manipulator with an ik solver", probot->GetEnv()->GetId()%probot->GetName());
+        return -1;
+    }
+    size_t armdof = pmanip->GetArmIndices().size();
+    std::vector<dReal> vsolution;
+    int numfound = 0;
+    for(int ipose = 0; ipose < numposes; ++ipose) {
+        results[ipose] = pmanip->FindIKSolution(IkParameterization(GetTransformFromPose(poses+7*ipose)), vsolution, filteroptions) ? 1 : 0;
+        if( results[ipose] ) {
+            std::copy(vsolution.begin(), vsolution.begin()+armdof, solutions+armdof*ipose);
+            ++numfound;
+        }
+    }
+    return numfound;
+}
+
 int ORCBodyLinkGetGeometries(void* link, void** geometries)
 {
     KinBody::LinkPtr plink = GetBodyLink(link);
@@ -99,6 +99,63 @@ int AddStatesWithLimitCheck(std::vector<dReal>& q, const std::vector<dReal>& qde
     return status;
 }
 
+PlannerStatistics::PlannerStatistics()
+{
+    Reset();
+}
+
+void PlannerStatistics::Reset()
+{
+    numIterations = 0;
+    numNodes = 0;
+    numSamples = 0;
+    samplingTime = 0;
+    numNearestNeighborQueries = 0;
+    nearestNeighborTime = 0;
+    numConstraintChecks = 0;
+    constraintCheckTime = 0;
+    numConstraintRejects = 0;
+    numCollisionQueries = 0;
+    totalTime = 0;
+}
+
+bool PlannerStatistics::IsEmpty() const
+{
+    return numIterations == 0 && numNodes == 0 && numSamples == 0 && numNearestNeighborQueries == 0 && numConstraintChecks == 0 && numCollisionQueries == 0 && totalTime == 0;
+}
+
+PlannerStatistics& PlannerStatistics::operator+=(const PlannerStatistics& r)
+{
+    numIterations += r.numIterations;
+    numNodes += r.numNodes;
+    numSamples += r.numSamples;
+    samplingTime += r.samplingTime;
+    numNearestNeighborQueries += r.numNearestNeighborQueries;
+    nearestNeighborTime += r.nearestNeighborTime;
+    numConstraintChecks += r.numConstraintChecks;
+    constraintCheckTime += r.constraintCheckTime;
+    numConstraintRejects += r.numConstraintRejects;
+    numCollisionQueries += r.numCollisionQueries;
+    totalTime += r.totalTime;
+    return *this;
+}
+
+void PlannerStatistics::SaveToJson(rapidjson::Value& rPlannerStatistics, rapidjson::Document::AllocatorType& alloc) const
+{
+    rPlannerStatistics.SetObject();
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numIterations", numIterations, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numNodes", numNodes, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numSamples", numSamples, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "samplingTime", samplingTime, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numNearestNeighborQueries", numNearestNeighborQueries, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "nearestNeighborTime", nearestNeighborTime, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numConstraintChecks", numConstraintChecks, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "constraintCheckTime", constraintCheckTime, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numConstraintRejects", numConstraintRejects, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "numCollisionQueries", numCollisionQueries, alloc);
+    openravejson::SetJsonValueByKey(rPlannerStatistics, "totalTime", totalTime, alloc);
+}
+
 PlannerStatus::PlannerStatus() : statusCode(0)
 {
 }
@@ -214,6 +271,12 @@ void PlannerStatus::SaveToJson(rapidjson::Value& rPlannerStatus, rapidjson::Docu
         openravejson::SetJsonValueByKey(rPlannerStatus, "collisionReport", reportjson, alloc);
     }
 
+    if( !statistics.IsEmpty() ) {
+        rapidjson::Value statisticsjson;
+        statistics.SaveToJson(statisticsjson, alloc);
+        openravejson::SetJsonValueByKey(rPlannerStatus, "statistics", statisticsjson, alloc);
+    }
+
     //Eventually, serialization could be in openravejson.h ?
     if( ikparam.GetType() != IKP_None ) {
         std::stringstream ss;
@@ -245,7 +308,7 @@ void PlannerParameters::StateSaver::_Restore()
     BOOST_ASSERT(ret==0);
 }
 
-PlannerParameters::PlannerParameters() : XMLReadable("plannerparameters"), _fStepLength(0.04f), _nMaxIterations(0), _nMaxPlanningTime(0), _sPostProcessingPlanner(s_linearsmoother), _nRandomGeneratorSeed(0)
+PlannerParameters::PlannerParameters() : XMLReadable("plannerparameters"), _fStepLength(0.04f), _nMaxIterations(0), _nMaxPlanningTime(0), _sPostProcessingPlanner(s_linearsmoother), _nRandomGeneratorSeed(0), _bDeterministicParallel(false), _nSegmentCheckOrder(SCO_Sequential)
 {
     _diffstatefn = SubtractStates;
     _neighstatefn = AddStates;
@@ -269,6 +332,8 @@ PlannerParameters::PlannerParameters() : XMLReadable("plannerparameters"), _fSte
     _vXMLParameters.push_back("_fsteplength");
     _vXMLParameters.push_back("_postprocessing");
     _vXMLParameters.push_back("_nrandomgeneratorseed");
+    _vXMLParameters.push_back("_nsegmentcheckorder");
+    _vXMLParameters.push_back("_bdeterministicparallel");
 }
 
 PlannerParameters::~PlannerParameters()
@@ -297,33 +362,53 @@ PlannerParameters& PlannerParameters::operator=(const PlannerParameters& r)
     _neighstatefn = r._neighstatefn;
     _listInternalSamplers = r._listInternalSamplers;
 
-    vinitialconfig.resize(0);
-    _vInitialConfigVelocities.resize(0);
-    _vGoalConfigVelocities.resize(0);
-    vgoalconfig.resize(0);
-    _configurationspecification = ConfigurationSpecification();
-    _vConfigLowerLimit.resize(0);
-    _vConfigUpperLimit.resize(0);
-    _vConfigResolution.resize(0);
-    _vConfigVelocityLimit.resize(0);
-    _vConfigAccelerationLimit.resize(0);
-    _sPostProcessingPlanner = "";
-    _sPostProcessingParameters.resize(0);
-    _sExtraParameters.resize(0);
-    _nMaxIterations = 0;
-    _nMaxPlanningTime = 0;
-    _fStepLength = 0.04f;
-    _nRandomGeneratorSeed = 0;
     _plannerparametersdepth = 0;
 
+    // the parameters known by both sides do not need the xml round trip
+    bool bcopiedall = _CopyParameters(r);
+    if( bcopiedall && r._sExtraParameters.size() == 0 ) {
+        return *this;
+    }
+
     // transfer data
     std::stringstream ss;
     ss << std::setprecision(std::numeric_limits<dReal>::digits10+1); /// have to do this or otherwise precision gets lost and planners' initial conditions can vioalte constraints
-    ss << r;
+    ss << "<" << r.GetXMLId() << ">" << endl;
+    if( bcopiedall ) {
+        ss << r._sExtraParameters << endl;
+    }
+    else {
+        r.serialize(ss, 2);
+    }
+    ss << "</" << r.GetXMLId() << ">" << endl;
     ss >> *this;
     return *this;
 }
 
+bool PlannerParameters::_CopyParameters(const PlannerParameters& r)
+{
+    vinitialconfig = r.vinitialconfig;
+    _vInitialConfigVelocities = r._vInitialConfigVelocities;
+    _vGoalConfigVelocities = r._vGoalConfigVelocities;
+    vgoalconfig = r.vgoalconfig;
+    _configurationspecification = r._configurationspecification;
+    _vConfigLowerLimit = r._vConfigLowerLimit;
+    _vConfigUpperLimit = r._vConfigUpperLimit;
+    _vConfigResolution = r._vConfigResolution;
+    _vConfigVelocityLimit = r._vConfigVelocityLimit;
+    _vConfigAccelerationLimit = r._vConfigAccelerationLimit;
+    _sPostProcessingPlanner = r._sPostProcessingPlanner;
+    _sPostProcessingParameters = r._sPostProcessingParameters;
+    _sExtraParameters.resize(0);
+    _nMaxIterations = r._nMaxIterations;
+    _nMaxPlanningTime = r._nMaxPlanningTime;
+    _fStepLength = r._fStepLength;
+    _nRandomGeneratorSeed = r._nRandomGeneratorSeed;
+    _bDeterministicParallel = r._bDeterministicParallel;
+    _nSegmentCheckOrder = r._nSegmentCheckOrder;
+    return typeid(r) == typeid(PlannerParameters);
+}
+
 void PlannerParameters::copy(boost::shared_ptr<PlannerParameters const> r)
 {
     *this = *r;
@@ -339,6 +424,12 @@ int PlannerParameters::SetStateValues(const std::vector<dReal>& values, int opti
 
 bool PlannerParameters::serialize(std::ostream& O, int options) const
 {
+    if( options & 2 ) {
+        if( !(options & 1) ) {
+            O << _sExtraParameters << endl;
+        }
+        return !!O;
+    }
     O << _configurationspecification << endl;
     O << "<_vinitialconfig>";
     FOREACHC(it, vinitialconfig) {
@@ -390,6 +481,8 @@ bool PlannerParameters::serialize(std::ostream& O, int options) const
     O << "<_nmaxplanningtime>" << _nMaxPlanningTime << "</_nmaxplanningtime>" << endl;
     O << "<_fsteplength>" << _fStepLength << "</_fsteplength>" << endl;
     O << "<_nrandomgeneratorseed>" << _nRandomGeneratorSeed << "</_nrandomgeneratorseed>" << endl;
+    O << "<_nsegmentcheckorder>" << _nSegmentCheckOrder << "</_nsegmentcheckorder>" << endl;
+    O << "<_bdeterministicparallel>" << _bDeterministicParallel << "</_bdeterministicparallel>" << endl;
     O << "<_postprocessing planner=\"" << _sPostProcessingPlanner << "\">" << _sPostProcessingParameters << "</_postprocessing>" << endl;
     if( !(options & 1) ) {
         O << _sExtraParameters << endl;
@@ -444,7 +537,7 @@ BaseXMLReader::ProcessElement PlannerParameters::startElement(const std::string&
         return PE_Support;
     }
 
-    static const boost::array<std::string,14> names = {{"_vinitialconfig","_vgoalconfig","_vconfiglowerlimit","_vconfigupperlimit","_vconfigvelocitylimit","_vconfigaccelerationlimit","_vconfigresolution","_nmaxiterations","_nmaxplanningtime","_fsteplength","_postprocessing", "_nrandomgeneratorseed", "_vinitialconfigvelocities", "_vgoalconfigvelocities"}};
+    static const boost::array<std::string,16> names = {{"_vinitialconfig","_vgoalconfig","_vconfiglowerlimit","_vconfigupperlimit","_vconfigvelocitylimit","_vconfigaccelerationlimit","_vconfigresolution","_nmaxiterations","_nmaxplanningtime","_fsteplength","_postprocessing", "_nrandomgeneratorseed", "_vinitialconfigvelocities", "_vgoalconfigvelocities", "_nsegmentcheckorder", "_bdeterministicparallel"}};
     if( find(names.begin(),names.end(),name) != names.end() ) {
         __processingtag = name;
         return PE_Support;
@@ -514,6 +607,12 @@ bool PlannerParameters::endElement(const std::string& name)
         else if( name == "_nrandomgeneratorseed") {
             _ss >> _nRandomGeneratorSeed;
         }
+        else if( name == "_nsegmentcheckorder") {
+            _ss >> _nSegmentCheckOrder;
+        }
+        else if( name == "_bdeterministicparallel") {
+            _ss >> _bDeterministicParallel;
+        }
         if( name !=__processingtag ) {
             RAVELOG_WARN(str(boost::format("invalid tag %s!=%s\n")%name%__processingtag));
         }
@@ -535,6 +634,15 @@ void PlannerParameters::characters(const std::string& ch)
     }
 }
 
+uint32_t PlannerParameters::GetParallelWorkerRandomGeneratorSeed(uint32_t seed, int workerindex)
+{
+    uint64_t z = ((uint64_t)seed << 32) + (uint32_t)workerindex + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (uint32_t)(z >> 32);
+}
+
 std::ostream& operator<<(std::ostream& O, const PlannerParameters& v)
 {
     O << "<" << v.GetXMLId() << ">" << endl;
@@ -580,12 +688,14 @@ void PlannerParameters::SetRobotActiveJoints(RobotBasePtr robot)
     _distmetricfn = boost::bind(&SimpleDistanceMetric::Eval,boost::shared_ptr<SimpleDistanceMetric>(new SimpleDistanceMetric(robot)),_1,_2);
     if( robot->GetActiveDOF() == (int)robot->GetActiveDOFIndices().size() ) {
         // only roobt joint indices, so use a more resiliant function
-        _getstatefn = boost::bind(&RobotBase::GetDOFValues,robot,_1,robot->GetActiveDOFIndices());
+        void (KinBody::*getdofvaluesptr)(std::vector<dReal>&, const std::vector<int>&) const = &KinBody::GetDOFValues;
+        _getstatefn = boost::bind(getdofvaluesptr,robot,_1,robot->GetActiveDOFIndices());
         _setstatevaluesfn = boost::bind(SetDOFValuesIndicesParameters,robot, _1, robot->GetActiveDOFIndices(), _2);
         _diffstatefn = boost::bind(&RobotBase::SubtractDOFValues,robot,_1,_2, robot->GetActiveDOFIndices());
     }
     else {
-        _getstatefn = boost::bind(&RobotBase::GetActiveDOFValues,robot,_1);
+        void (RobotBase::*getactivedofvaluesptr)(std::vector<dReal>&) const = &RobotBase::GetActiveDOFValues;
+        _getstatefn = boost::bind(getactivedofvaluesptr,robot,_1);
         _setstatevaluesfn = boost::bind(SetActiveDOFValuesParameters,robot, _1, _2);
         _diffstatefn = boost::bind(&RobotBase::SubtractActiveDOFValues,robot,_1,_2);
     }
@@ -867,7 +977,8 @@ void PlannerParameters::SetConfigurationSpecification(EnvironmentBasePtr penv, c
             sampleneighfns[isavegroup].second = g.dof;
             setstatevaluesfns[isavegroup].first = boost::bind(SetDOFValuesIndicesParameters, pbody, _1, dofindices, _2);
             setstatevaluesfns[isavegroup].second = g.dof;
-            getstatefns[isavegroup].first = boost::bind(&KinBody::GetDOFValues, pbody, _1, dofindices);
+            void (KinBody::*getdofvaluesptr)(std::vector<dReal>&, const std::vector<int>&) const = &KinBody::GetDOFValues;
+            getstatefns[isavegroup].first = boost::bind(getdofvaluesptr, pbody, _1, dofindices);
             getstatefns[isavegroup].second = g.dof;
             neighstatefns[isavegroup].second = g.dof;
             pbody->GetDOFLimits(v0,v1,dofindices);
@@ -986,7 +1097,7 @@ void PlannerParameters::Validate() const
     }
 }
 
-PlannerBase::PlannerProgress::PlannerProgress() : _iteration(0)
+PlannerBase::PlannerProgress::PlannerProgress() : _iteration(0), _fCost(0), _nElapsedTime(0)
 {
 }
 
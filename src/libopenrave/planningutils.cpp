@@ -19,6 +19,14 @@
 #include <openrave/planningutils.h>
 #include <openrave/plannerparameters.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 //#include <boost/iostreams/device/file_descriptor.hpp>
 //#include <boost/iostreams/stream.hpp>
 //#include <boost/version.hpp>
@@ -491,25 +499,54 @@ public:
                 }
                 IntervalType interval = bHasAllLinearInterpolation ? (IntervalType)(IT_Closed | IT_AllLinear) : IT_Closed;
 
-                std::vector<dReal> vprevdata, vprevdatavel;
-                ConstraintFilterReturnPtr filterreturn(new ConstraintFilterReturn());
-                trajectory->Sample(vprevdata,0,_parameters->_configurationspecification);
-                trajectory->Sample(vprevdatavel,0,velspec);
-                std::vector<dReal>::iterator itprevtime = vsampletimes.begin();
+                // sample all the times at once, skipping the ones too close to the previous checked time
+                std::vector<dReal> vchecktimes;
+                vchecktimes.reserve(vsampletimes.size());
+                vchecktimes.push_back(vsampletimes.at(0));
                 for(std::vector<dReal>::iterator itsampletime = vsampletimes.begin()+1; itsampletime != vsampletimes.end(); ++itsampletime) {
-                    if (*itsampletime < *itprevtime + 1e-5 ) {
-                        continue;
+                    if( *itsampletime >= vchecktimes.back() + 1e-5 ) {
+                        vchecktimes.push_back(*itsampletime);
                     }
-                    filterreturn->Clear();
-                    trajectory->Sample(vdata,*itsampletime,_parameters->_configurationspecification);
-                    trajectory->Sample(vdatavel,*itsampletime,velspec);
-                    dReal deltatime = *itsampletime - *itprevtime;
-                    vdiff = vdata;
+                }
+                const int dof = _parameters->GetDOF();
+                std::vector<dReal> vpoints, vpointsvel;
+                trajectory->SamplePoints(vpoints, vchecktimes, _parameters->_configurationspecification);
+                trajectory->SamplePoints(vpointsvel, vchecktimes, velspec);
+                OPENRAVE_ASSERT_OP(vpoints.size(),==,vchecktimes.size()*dof);
+                OPENRAVE_ASSERT_OP(vpointsvel.size(),==,vchecktimes.size()*dof);
+
+                // the distance traveled between samples is cheap to check, so check all segments before any of the path constraints. The path constraints only have to be checked up to the first segment that fails, so the earliest failing time is reported.
+                size_t nfirstinvalidsample = vchecktimes.size();
+                size_t invaliddof = 0;
+                dReal finvaliddist = 0, finvalidthresh = 0;
+                std::vector<dReal> vprevdata, vprevdatavel;
+                for(size_t isample = 1; isample < vchecktimes.size() && nfirstinvalidsample == vchecktimes.size(); ++isample) {
+                    vprevdata.assign(vpoints.begin()+(isample-1)*dof, vpoints.begin()+isample*dof);
+                    vdiff.assign(vpoints.begin()+isample*dof, vpoints.begin()+(isample+1)*dof);
                     _parameters->_diffstatefn(vdiff,vprevdata);
+                    dReal deltatime = vchecktimes[isample] - vchecktimes[isample-1];
                     for(size_t i = 0; i < _parameters->_vConfigVelocityLimit.size(); ++i) {
                         dReal velthresh = _parameters->_vConfigVelocityLimit.at(i)*deltatime+fthresh;
-                        OPENRAVE_ASSERT_OP_FORMAT(RaveFabs(vdiff.at(i)), <=, velthresh, "time %fs-%fs, dof %d traveled %f, but maxvelocity only allows %f, wrote trajectory to %s",*itprevtime%*itsampletime%i%RaveFabs(vdiff.at(i))%velthresh%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
+                        if( !(RaveFabs(vdiff.at(i)) <= velthresh) ) {
+                            nfirstinvalidsample = isample;
+                            invaliddof = i;
+                            finvaliddist = RaveFabs(vdiff.at(i));
+                            finvalidthresh = velthresh;
+                            break;
+                        }
                     }
+                }
+
+                ConstraintFilterReturnPtr filterreturn(new ConstraintFilterReturn());
+                vprevdata.assign(vpoints.begin(), vpoints.begin()+dof);
+                vprevdatavel.assign(vpointsvel.begin(), vpointsvel.begin()+dof);
+                for(size_t isample = 1; isample < nfirstinvalidsample; ++isample) {
+                    const dReal* itprevtime = &vchecktimes[isample-1];
+                    const dReal* itsampletime = &vchecktimes[isample];
+                    filterreturn->Clear();
+                    vdata.assign(vpoints.begin()+isample*dof, vpoints.begin()+(isample+1)*dof);
+                    vdatavel.assign(vpointsvel.begin()+isample*dof, vpointsvel.begin()+(isample+1)*dof);
+                    dReal deltatime = *itsampletime - *itprevtime;
                     if( _parameters->CheckPathAllConstraints(vprevdata,vdata,vprevdatavel, vdatavel, deltatime, interval, 0xffff|CFO_FillCheckedConfiguration, filterreturn) != 0 ) {
                         if( IS_DEBUGLEVEL(Level_Verbose) ) {
                             _parameters->CheckPathAllConstraints(vprevdata,vdata,vprevdatavel, vdatavel, deltatime, interval, 0xffff|CFO_FillCheckedConfiguration, filterreturn);
@@ -543,7 +580,9 @@ public:
                     }
                     vprevdata.swap(vdata);
                     vprevdatavel.swap(vdatavel);
-                    itprevtime = itsampletime;
+                }
+                if( nfirstinvalidsample < vchecktimes.size() ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT(_("time %fs-%fs, dof %d traveled %f, but maxvelocity only allows %f, wrote trajectory to %s"),vchecktimes[nfirstinvalidsample-1]%vchecktimes[nfirstinvalidsample]%invaliddof%finvaliddist%finvalidthresh%DumpTrajectory(trajectory),ORE_InconsistentConstraints);
                 }
             }
             else {
@@ -584,6 +623,7 @@ void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, Traject
 
 PlannerStatus _PlanActiveDOFTrajectory(TrajectoryBasePtr traj, RobotBasePtr probot, bool hastimestamps, dReal fmaxvelmult, dReal fmaxaccelmult, const std::string& plannername, bool bsmooth, const std::string& plannerparameters)
 {
+    OPENRAVE_PROFILE_SCOPE("smoothing", bsmooth ? "SmoothActiveDOFTrajectory" : "RetimeActiveDOFTrajectory");
     if( traj->GetNumWaypoints() == 1 ) {
         // don't need velocities, but should at least add a time group
         ConfigurationSpecification spec = traj->GetConfigurationSpecification();
@@ -653,6 +693,7 @@ ActiveDOFTrajectorySmoother::ActiveDOFTrajectorySmoother(RobotBasePtr robot, con
 
 PlannerStatus ActiveDOFTrajectorySmoother::PlanPath(TrajectoryBasePtr traj, int planningoptions)
 {
+    OPENRAVE_PROFILE_SCOPE("smoothing", "ActiveDOFTrajectorySmoother::PlanPath");
     if( traj->GetNumWaypoints() == 1 ) {
         // don't need velocities, but should at least add a time group
         ConfigurationSpecification spec = traj->GetConfigurationSpecification();
@@ -716,6 +757,7 @@ ActiveDOFTrajectoryRetimer::ActiveDOFTrajectoryRetimer(RobotBasePtr robot, const
 
 PlannerStatus ActiveDOFTrajectoryRetimer::PlanPath(TrajectoryBasePtr traj, bool hastimestamps, int planningoptions)
 {
+    OPENRAVE_PROFILE_SCOPE("smoothing", "ActiveDOFTrajectoryRetimer::PlanPath");
     if( traj->GetNumWaypoints() == 1 ) {
         // don't need velocities, but should at least add a time group
         ConfigurationSpecification spec = traj->GetConfigurationSpecification();
@@ -757,6 +799,7 @@ void ActiveDOFTrajectoryRetimer::_UpdateParameters()
 
 PlannerStatus _PlanTrajectory(TrajectoryBasePtr traj, bool hastimestamps, dReal fmaxvelmult, dReal fmaxaccelmult, const std::string& plannername, bool bsmooth, const std::string& plannerparameters)
 {
+    OPENRAVE_PROFILE_SCOPE("smoothing", bsmooth ? "SmoothTrajectory" : "RetimeTrajectory");
     if( traj->GetNumWaypoints() == 1 ) {
         // don't need velocities, but should at least add a time group
         ConfigurationSpecification spec = traj->GetConfigurationSpecification();
@@ -884,6 +927,7 @@ private:
 // this function is very messed up...?
 static PlannerStatus _PlanAffineTrajectory(TrajectoryBasePtr traj, const std::vector<dReal>& maxvelocities, const std::vector<dReal>& maxaccelerations, bool hastimestamps, const std::string& plannername, bool bsmooth, const std::string& plannerparameters)
 {
+    OPENRAVE_PROFILE_SCOPE("smoothing", bsmooth ? "SmoothAffineTrajectory" : "RetimeAffineTrajectory");
     if( traj->GetNumWaypoints() == 1 ) {
         // don't need retiming, but should at least add a time group
         ConfigurationSpecification spec = traj->GetConfigurationSpecification();
@@ -1034,6 +1078,7 @@ void AffineTrajectoryRetimer::SetPlanner(const std::string& plannername, const s
 
 PlannerStatus AffineTrajectoryRetimer::PlanPath(TrajectoryBasePtr traj, const std::vector<dReal>& maxvelocities, const std::vector<dReal>& maxaccelerations, bool hastimestamps, int planningoptions)
 {
+    OPENRAVE_PROFILE_SCOPE("smoothing", "AffineTrajectoryRetimer::PlanPath");
     if( traj->GetNumWaypoints() == 1 ) {
         // don't need retiming, but should at least add a time group
         ConfigurationSpecification spec = traj->GetConfigurationSpecification();
@@ -1888,6 +1933,19 @@ TrajectoryBasePtr GetTrajectorySegment(TrajectoryBaseConstPtr traj, dReal startt
     return outtraj;
 }
 
+/// \brief samples vtrajectories[istart], vtrajectories[istart+step], ... at vtimes in their own specification. Exceptions are stored in verrors since they cannot leave the thread.
+static void _SampleMergedTrajectoriesWorker(const std::vector<TrajectoryBaseConstPtr>& vtrajectories, const std::vector<dReal>& vtimes, int istart, int step, std::vector< std::vector<dReal> >& vvpointdata, std::vector<std::string>& verrors)
+{
+    for(size_t itraj = istart; itraj < vtrajectories.size(); itraj += step) {
+        try {
+            vtrajectories[itraj]->SamplePoints(vvpointdata[itraj], vtimes);
+        }
+        catch(const std::exception& ex) {
+            verrors[itraj] = ex.what();
+        }
+    }
+}
+
 TrajectoryBasePtr MergeTrajectories(const std::list<TrajectoryBaseConstPtr>& listtrajectories)
 {
     // merge both deltatime and iswaypoint groups
@@ -1904,25 +1962,27 @@ TrajectoryBasePtr MergeTrajectories(const std::list<TrajectoryBaseConstPtr>& lis
     ConfigurationSpecification spec;
     vector<dReal> vpointdata;
     vector<dReal> vtimes; vtimes.reserve(listtrajectories.front()->GetNumWaypoints());
+    ConfigurationSpecification deltatimespec;
+    deltatimespec.AddDeltaTimeGroup();
     int totaldof = 1; // for delta time
     FOREACHC(ittraj,listtrajectories) {
         const ConfigurationSpecification& trajspec = (*ittraj)->GetConfigurationSpecification();
-        ConfigurationSpecification::Group gtime = trajspec.GetGroupFromName("deltatime");
+        trajspec.GetGroupFromName("deltatime"); // throws if there are no timestamps
         spec += trajspec;
         totaldof += trajspec.GetDOF()-1;
         if( trajspec.FindCompatibleGroup("iswaypoint",true) != trajspec._vgroups.end() ) {
             totaldof -= 1;
         }
+        (*ittraj)->GetWaypoints(0,(*ittraj)->GetNumWaypoints(),vpointdata,deltatimespec);
         dReal curtime = 0;
-        for(size_t ipoint = 0; ipoint < (*ittraj)->GetNumWaypoints(); ++ipoint) {
-            (*ittraj)->GetWaypoint(ipoint,vpointdata);
-            curtime += vpointdata.at(gtime.offset);
-            vector<dReal>::iterator it = lower_bound(vtimes.begin(),vtimes.end(),curtime);
-            if( *it != curtime ) {
-                vtimes.insert(it,curtime);
-            }
+        FOREACH(ittime, vpointdata) {
+            curtime += *ittime;
+            vtimes.push_back(curtime);
         }
     }
+    // the union of all the timestamps
+    std::sort(vtimes.begin(), vtimes.end());
+    vtimes.erase(std::unique(vtimes.begin(), vtimes.end()), vtimes.end());
 
     vector<ConfigurationSpecification::Group>::const_iterator itwaypointgroup = spec.FindCompatibleGroup("iswaypoint",true);
     vector<dReal> vwaypoints;
@@ -1941,39 +2001,60 @@ TrajectoryBasePtr MergeTrajectories(const std::list<TrajectoryBaseConstPtr>& lis
         return presulttraj;
     }
 
-    // need to find all waypoints
-    vector<dReal> vtemp, vnewdata;
+    // the first trajectory is sampled directly into the merged specification, so its uninitialized groups get their defaults from the environment. The others only read their own data, so they can be sampled in parallel.
+    std::vector<TrajectoryBaseConstPtr> vtrajectories(listtrajectories.begin(), listtrajectories.end());
+    std::vector< std::vector<dReal> > vvpointdata(vtrajectories.size());
+    std::vector<std::string> vsampleerrors(vtrajectories.size());
+    std::set<TrajectoryBaseConstPtr> settrajectories(vtrajectories.begin()+1, vtrajectories.end());
+    int numthreads = 0;
+    if( settrajectories.size() == vtrajectories.size()-1 && settrajectories.count(vtrajectories[0]) == 0 && vtimes.size()*(vtrajectories.size()-1) >= 10000 ) {
+        // sampling caches are per trajectory, so a trajectory cannot be sampled by two threads
+        numthreads = std::min((int)vtrajectories.size()-1, (int)boost::thread::hardware_concurrency());
+    }
+    std::vector< boost::shared_ptr<boost::thread> > vthreads;
+    for(int ithread = 0; ithread < numthreads; ++ithread) {
+        vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(_SampleMergedTrajectoriesWorker, boost::cref(vtrajectories), boost::cref(vtimes), ithread+1, numthreads, boost::ref(vvpointdata), boost::ref(vsampleerrors)))));
+    }
+    vector<dReal> vnewdata;
+    try {
+        vtrajectories[0]->SamplePoints(vnewdata,vtimes,spec);
+    }
+    catch(const std::exception& ex) {
+        vsampleerrors[0] = ex.what();
+    }
+    if( numthreads == 0 ) {
+        _SampleMergedTrajectoriesWorker(vtrajectories, vtimes, 1, 1, vvpointdata, vsampleerrors);
+    }
+    FOREACH(itthread, vthreads) {
+        (*itthread)->join();
+    }
+    FOREACH(iterror, vsampleerrors) {
+        if( iterror->size() > 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("failed to sample trajectory %d for merging: %s"),(iterror-vsampleerrors.begin())%*iterror,ORE_InvalidArguments);
+        }
+    }
+
     stringstream sdesc;
     int deltatimeoffset = spec.GetGroupFromName("deltatime").offset;
-    FOREACHC(ittraj,listtrajectories) {
-        vector<ConfigurationSpecification::Group>::const_iterator itwaypointgrouptraj = (*ittraj)->GetConfigurationSpecification().FindCompatibleGroup("iswaypoint",true);
-        int waypointoffset = -1;
-        if( itwaypointgrouptraj != (*ittraj)->GetConfigurationSpecification()._vgroups.end() ) {
-            waypointoffset = itwaypointgrouptraj->offset;
-        }
-        if( vnewdata.size() == 0 ) {
-            vnewdata.reserve(vtimes.size()*spec.GetDOF());
-            for(size_t i = 0; i < vtimes.size(); ++i) {
-                (*ittraj)->Sample(vtemp,vtimes[i],spec);
-                vnewdata.insert(vnewdata.end(),vtemp.begin(),vtemp.end());
-                if( waypointoffset >= 0 ) {
-                    vwaypoints[i] += vtemp[itwaypointgroup->offset]; // have to use the final spec's offset
+    for(size_t itraj = 0; itraj < vtrajectories.size(); ++itraj) {
+        const ConfigurationSpecification& trajspec = vtrajectories[itraj]->GetConfigurationSpecification();
+        vector<ConfigurationSpecification::Group>::const_iterator itwaypointgrouptraj = trajspec.FindCompatibleGroup("iswaypoint",true);
+        if( itraj == 0 ) {
+            if( itwaypointgrouptraj != trajspec._vgroups.end() ) {
+                for(size_t i = 0; i < vtimes.size(); ++i) {
+                    vwaypoints[i] += vnewdata[i*spec.GetDOF()+itwaypointgroup->offset]; // have to use the final spec's offset
                 }
             }
         }
         else {
-            vpointdata.resize(0);
-            for(size_t i = 0; i < vtimes.size(); ++i) {
-                (*ittraj)->Sample(vtemp,vtimes[i]);
-                vpointdata.insert(vpointdata.end(),vtemp.begin(),vtemp.end());
-                if( waypointoffset >= 0 ) {
-                    vwaypoints[i] += vtemp[itwaypointgroup->offset]; // have to use the final spec's offset
+            if( itwaypointgrouptraj != trajspec._vgroups.end() ) {
+                for(size_t i = 0; i < vtimes.size(); ++i) {
+                    vwaypoints[i] += vvpointdata[itraj][i*trajspec.GetDOF()+itwaypointgrouptraj->offset];
                 }
             }
-            ConfigurationSpecification::ConvertData(vnewdata.begin(),spec,vpointdata.begin(),(*ittraj)->GetConfigurationSpecification(),vtimes.size(),presulttraj->GetEnv(),false);
+            ConfigurationSpecification::ConvertData(vnewdata.begin(),spec,vvpointdata[itraj].begin(),trajspec,vtimes.size(),presulttraj->GetEnv(),false);
         }
-
-        sdesc << (*ittraj)->GetDescription() << endl;
+        sdesc << vtrajectories[itraj]->GetDescription() << endl;
     }
 
     vnewdata.at(deltatimeoffset) = vtimes[0];
@@ -2083,7 +2164,480 @@ void GetDHParameters(std::vector<DHParameter>& vparameters, KinBodyConstPtr pbod
     }
 }
 
-DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerParametersConstPtr parameters, const std::list<KinBodyPtr>& listCheckBodies, int filtermask) : _listCheckBodies(listCheckBodies), _filtermask(filtermask), _torquelimitmode(0), _perturbation(0.1)
+static const char s_SignedDistanceFieldMagic[] = "openrave_signeddistancefield";
+static const int s_SignedDistanceFieldVersion = 1;
+
+/// \brief computes the squared distance transform of f along one line of n samples with a stride, see Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled Functions"
+static void _DistanceTransform1D(float* f, int n, size_t stride, std::vector<float>& vd, std::vector<int>& vv, std::vector<float>& vz)
+{
+    vd.resize(n);
+    vv.resize(n);
+    vz.resize(n+1);
+    // lower envelope of the parabolas rooted at the finite samples
+    int k = -1;
+    for(int q = 0; q < n; ++q) {
+        float fq = f[q*stride];
+        if( fq == std::numeric_limits<float>::infinity() ) {
+            continue;
+        }
+        if( k < 0 ) {
+            k = 0;
+            vv[0] = q;
+            vz[0] = -std::numeric_limits<float>::infinity();
+            vz[1] = std::numeric_limits<float>::infinity();
+            continue;
+        }
+        float sintersect = ((fq + q*q) - (f[vv[k]*stride] + vv[k]*vv[k]))/(2*(q-vv[k]));
+        while( sintersect <= vz[k] ) {
+            --k;
+            sintersect = ((fq + q*q) - (f[vv[k]*stride] + vv[k]*vv[k]))/(2*(q-vv[k]));
+        }
+        ++k;
+        vv[k] = q;
+        vz[k] = sintersect;
+        vz[k+1] = std::numeric_limits<float>::infinity();
+    }
+    if( k < 0 ) {
+        // no finite samples on this line
+        return;
+    }
+    k = 0;
+    for(int q = 0; q < n; ++q) {
+        while( vz[k+1] < q ) {
+            ++k;
+        }
+        float fdelta = (float)(q-vv[k]);
+        vd[q] = fdelta*fdelta + f[vv[k]*stride];
+    }
+    for(int q = 0; q < n; ++q) {
+        f[q*stride] = vd[q];
+    }
+}
+
+/// \brief converts f from 0 at the features and infinity elsewhere to the squared voxel distance to the closest feature
+static void _DistanceTransform3D(std::vector<float>& f, const boost::array<int, 3>& dims)
+{
+    std::vector<float> vd, vz;
+    std::vector<int> vv;
+    size_t stride[3] = { 1, (size_t)dims[0], (size_t)dims[0]*dims[1] };
+    for(int idim = 0; idim < 3; ++idim) {
+        int i0 = idim == 0 ? 1 : 0, i1 = idim == 2 ? 1 : 2;
+        for(int a = 0; a < dims[i0]; ++a) {
+            for(int b = 0; b < dims[i1]; ++b) {
+                _DistanceTransform1D(&f[a*stride[i0] + b*stride[i1]], dims[idim], stride[idim], vd, vv, vz);
+            }
+        }
+    }
+}
+
+SignedDistanceField::SignedDistanceField() : _fResolution(0), _fErrorBound(0)
+{
+    _dims[0] = _dims[1] = _dims[2] = 0;
+}
+
+void SignedDistanceField::Compute(const std::vector<KinBodyConstPtr>& vbodies, dReal fResolution, dReal fPadding)
+{
+    OPENRAVE_ASSERT_OP(fResolution,>,0);
+    _vbodynames.resize(0);
+    _vdistances.resize(0);
+    _dims[0] = _dims[1] = _dims[2] = 0;
+    _fResolution = fResolution;
+    // trilinear interpolation over a cell diagonal, distances between voxel centers, and the spacing of the triangle samples
+    _fErrorBound = (1.5*RaveSqrt(3.0)+0.5)*fResolution;
+
+    TriMesh trimesh;
+    FOREACHC(itbody, vbodies) {
+        _vbodynames.push_back((*itbody)->GetName());
+        FOREACHC(itlink, (*itbody)->GetLinks()) {
+            if( (*itlink)->IsEnabled() ) {
+                trimesh.Append((*itlink)->GetCollisionData(), (*itlink)->GetTransform());
+            }
+        }
+    }
+    if( trimesh.vertices.size() == 0 ) {
+        RAVELOG_WARN("no collision meshes to compute the distance field from\n");
+        return;
+    }
+
+    // keep the border of the grid free so that the outside can be flood filled from it
+    fPadding = max(fPadding, 2*fResolution);
+    AABB ab = trimesh.ComputeAABB();
+    Vector vmin = ab.pos - ab.extents - Vector(fPadding, fPadding, fPadding);
+    size_t numvoxels = 1;
+    for(int idim = 0; idim < 3; ++idim) {
+        _dims[idim] = (int)RaveCeil(2*(ab.extents[idim]+fPadding)/fResolution);
+        numvoxels *= _dims[idim];
+    }
+    if( numvoxels > ((size_t)1<<28) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("distance field of %dx%dx%d voxels is too big, increase the resolution %f"), _dims[0]%_dims[1]%_dims[2]%fResolution, ORE_InvalidArguments);
+    }
+    _vorigin = vmin + Vector(0.5*fResolution, 0.5*fResolution, 0.5*fResolution);
+
+    // 0 is unknown, 1 is occupied, 2 is outside
+    std::vector<uint8_t> vstate(numvoxels, 0);
+    const dReal fInvResolution = 1/fResolution;
+    const dReal fSampleSpacing = 0.5*fResolution;
+    for(size_t itri = 0; itri+2 < trimesh.indices.size(); itri += 3) {
+        const Vector& p0 = trimesh.vertices.at(trimesh.indices[itri]);
+        Vector e1 = trimesh.vertices.at(trimesh.indices[itri+1]) - p0;
+        Vector e2 = trimesh.vertices.at(trimesh.indices[itri+2]) - p0;
+        dReal fmaxedge = RaveSqrt(max(max(e1.lengthsqr3(), e2.lengthsqr3()), (e2-e1).lengthsqr3()));
+        int nsteps = max(1, (int)RaveCeil(fmaxedge/fSampleSpacing));
+        dReal fstep = 1.0/nsteps;
+        for(int a = 0; a <= nsteps; ++a) {
+            for(int b = 0; a+b <= nsteps; ++b) {
+                Vector v = (p0 + e1*(a*fstep) + e2*(b*fstep) - vmin)*fInvResolution;
+                int index[3];
+                for(int idim = 0; idim < 3; ++idim) {
+                    index[idim] = min(max((int)std::floor(v[idim]), 0), _dims[idim]-1);
+                }
+                vstate[_GetIndex(index[0], index[1], index[2])] = 1;
+            }
+        }
+    }
+
+    // flood fill the outside from the border
+    std::vector<size_t> vstack;
+    for(int iz = 0; iz < _dims[2]; ++iz) {
+        for(int iy = 0; iy < _dims[1]; ++iy) {
+            for(int ix = 0; ix < _dims[0]; ++ix) {
+                if( ix == 0 || iy == 0 || iz == 0 || ix == _dims[0]-1 || iy == _dims[1]-1 || iz == _dims[2]-1 ) {
+                    size_t index = _GetIndex(ix, iy, iz);
+                    if( vstate[index] == 0 ) {
+                        vstate[index] = 2;
+                        vstack.push_back(index);
+                    }
+                }
+            }
+        }
+    }
+    const size_t stride[3] = { 1, (size_t)_dims[0], (size_t)_dims[0]*_dims[1] };
+    while(vstack.size() > 0) {
+        size_t index = vstack.back();
+        vstack.pop_back();
+        size_t rest = index;
+        for(int idim = 2; idim >= 0; --idim) {
+            int icoord = (int)(rest/stride[idim]);
+            rest -= icoord*stride[idim];
+            if( icoord > 0 && vstate[index-stride[idim]] == 0 ) {
+                vstate[index-stride[idim]] = 2;
+                vstack.push_back(index-stride[idim]);
+            }
+            if( icoord < _dims[idim]-1 && vstate[index+stride[idim]] == 0 ) {
+                vstate[index+stride[idim]] = 2;
+                vstack.push_back(index+stride[idim]);
+            }
+        }
+    }
+
+    // outside voxels get the distance to the occupied voxels, the others minus the distance to the outside voxels
+    std::vector<float> voccupied(numvoxels), voutside(numvoxels);
+    for(size_t i = 0; i < numvoxels; ++i) {
+        voccupied[i] = vstate[i] == 1 ? 0 : std::numeric_limits<float>::infinity();
+        voutside[i] = vstate[i] == 2 ? 0 : std::numeric_limits<float>::infinity();
+    }
+    _DistanceTransform3D(voccupied, _dims);
+    _DistanceTransform3D(voutside, _dims);
+    _vdistances.resize(numvoxels);
+    for(size_t i = 0; i < numvoxels; ++i) {
+        if( vstate[i] == 2 ) {
+            _vdistances[i] = (float)(RaveSqrt((dReal)voccupied[i])*fResolution);
+        }
+        else {
+            _vdistances[i] = (float)(-RaveSqrt((dReal)voutside[i])*fResolution);
+        }
+    }
+    RAVELOG_DEBUG_FORMAT("computed distance field of %d bodies with %dx%dx%d voxels", vbodies.size()%_dims[0]%_dims[1]%_dims[2]);
+}
+
+void SignedDistanceField::Save(const std::string& filename) const
+{
+    std::ofstream f(filename.c_str(), std::ios::binary);
+    if( !f ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("failed to open %s for writing the distance field"), filename, ORE_InvalidArguments);
+    }
+    f.write(s_SignedDistanceFieldMagic, sizeof(s_SignedDistanceFieldMagic));
+    f.write((const char*)&s_SignedDistanceFieldVersion, sizeof(s_SignedDistanceFieldVersion));
+    uint32_t numbodies = _vbodynames.size();
+    f.write((const char*)&numbodies, sizeof(numbodies));
+    FOREACHC(itname, _vbodynames) {
+        uint32_t namelength = itname->size();
+        f.write((const char*)&namelength, sizeof(namelength));
+        f.write(itname->c_str(), namelength);
+    }
+    double values[5] = { _vorigin.x, _vorigin.y, _vorigin.z, _fResolution, _fErrorBound };
+    f.write((const char*)values, sizeof(values));
+    f.write((const char*)&_dims[0], sizeof(int)*3);
+    if( _vdistances.size() > 0 ) {
+        f.write((const char*)&_vdistances[0], sizeof(float)*_vdistances.size());
+    }
+    if( !f ) {
+        throw OPENRAVE_EXCEPTION_FORMAT(_("failed to write the distance field to %s"), filename, ORE_Failed);
+    }
+}
+
+bool SignedDistanceField::Load(const std::string& filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary);
+    if( !f ) {
+        return false;
+    }
+    char magic[sizeof(s_SignedDistanceFieldMagic)];
+    int version = 0;
+    f.read(magic, sizeof(magic));
+    f.read((char*)&version, sizeof(version));
+    if( !f || memcmp(magic, s_SignedDistanceFieldMagic, sizeof(magic)) != 0 || version != s_SignedDistanceFieldVersion ) {
+        RAVELOG_WARN_FORMAT("%s is not a distance field of version %d", filename%s_SignedDistanceFieldVersion);
+        return false;
+    }
+    uint32_t numbodies = 0;
+    f.read((char*)&numbodies, sizeof(numbodies));
+    std::vector<std::string> vbodynames(numbodies);
+    for(uint32_t ibody = 0; ibody < numbodies && !!f; ++ibody) {
+        uint32_t namelength = 0;
+        f.read((char*)&namelength, sizeof(namelength));
+        if( !f || namelength > 4096 ) {
+            return false;
+        }
+        vbodynames[ibody].resize(namelength);
+        f.read(&vbodynames[ibody][0], namelength);
+    }
+    double values[5];
+    boost::array<int, 3> dims;
+    f.read((char*)values, sizeof(values));
+    f.read((char*)&dims[0], sizeof(int)*3);
+    if( !f || dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0 || (size_t)dims[0]*dims[1]*dims[2] > ((size_t)1<<28) ) {
+        return false;
+    }
+    std::vector<float> vdistances((size_t)dims[0]*dims[1]*dims[2]);
+    f.read((char*)&vdistances[0], sizeof(float)*vdistances.size());
+    if( !f ) {
+        RAVELOG_WARN_FORMAT("%s is truncated", filename);
+        return false;
+    }
+    _vbodynames.swap(vbodynames);
+    _vorigin = Vector(values[0], values[1], values[2]);
+    _fResolution = values[3];
+    _fErrorBound = values[4];
+    _dims = dims;
+    _vdistances.swap(vdistances);
+    return true;
+}
+
+dReal SignedDistanceField::GetDistance(const Vector& position, Vector* pgradient) const
+{
+    if( _vdistances.size() == 0 ) {
+        if( !!pgradient ) {
+            *pgradient = Vector();
+        }
+        return std::numeric_limits<dReal>::infinity();
+    }
+    // voxel coordinates clamped to the centers of the grid and the interpolation weights
+    int index[3];
+    dReal frac[3];
+    for(int idim = 0; idim < 3; ++idim) {
+        dReal f = (position[idim]-_vorigin[idim])/_fResolution;
+        if( _dims[idim] == 1 || f <= 0 ) {
+            index[idim] = 0;
+            frac[idim] = 0;
+        }
+        else if( f >= _dims[idim]-1 ) {
+            index[idim] = _dims[idim]-2;
+            frac[idim] = 1;
+        }
+        else {
+            index[idim] = (int)f;
+            frac[idim] = f-index[idim];
+        }
+    }
+    const size_t stride[3] = { _dims[0] > 1 ? (size_t)1 : 0, _dims[1] > 1 ? (size_t)_dims[0] : 0, _dims[2] > 1 ? (size_t)_dims[0]*_dims[1] : 0 };
+    const size_t base = _GetIndex(index[0], index[1], index[2]);
+    dReal c[8];
+    for(int icorner = 0; icorner < 8; ++icorner) {
+        c[icorner] = _vdistances[base + (icorner&1)*stride[0] + ((icorner>>1)&1)*stride[1] + ((icorner>>2)&1)*stride[2]];
+    }
+    const dReal fx = frac[0], fy = frac[1], fz = frac[2];
+    dReal c00 = c[0]*(1-fx) + c[1]*fx, c10 = c[2]*(1-fx) + c[3]*fx, c01 = c[4]*(1-fx) + c[5]*fx, c11 = c[6]*(1-fx) + c[7]*fx;
+    dReal c0 = c00*(1-fy) + c10*fy, c1 = c01*(1-fy) + c11*fy;
+    if( !!pgradient ) {
+        dReal dx0 = (c[1]-c[0])*(1-fy) + (c[3]-c[2])*fy, dx1 = (c[5]-c[4])*(1-fy) + (c[7]-c[6])*fy;
+        dReal dy0 = c10-c00, dy1 = c11-c01;
+        pgradient->x = (dx0*(1-fz) + dx1*fz)/_fResolution;
+        pgradient->y = (dy0*(1-fz) + dy1*fz)/_fResolution;
+        pgradient->z = (c1-c0)/_fResolution;
+    }
+    return c0*(1-fz) + c1*fz;
+}
+
+/// \brief returns the union of two AABBs, empty boxes have negative extents
+static AABB MergeAABBs(const AABB& ab0, const AABB& ab1)
+{
+    Vector vmin0 = ab0.pos-ab0.extents, vmax0 = ab0.pos+ab0.extents;
+    Vector vmin1 = ab1.pos-ab1.extents, vmax1 = ab1.pos+ab1.extents;
+    Vector vmin(min(vmin0.x,vmin1.x), min(vmin0.y,vmin1.y), min(vmin0.z,vmin1.z));
+    Vector vmax(max(vmax0.x,vmax1.x), max(vmax0.y,vmax1.y), max(vmax0.z,vmax1.z));
+    AABB ab;
+    ab.pos = (vmin+vmax)*0.5;
+    ab.extents = (vmax-vmin)*0.5;
+    return ab;
+}
+
+TrajectoryConflictChecker::TrajectoryConflictChecker(EnvironmentBasePtr penv, dReal fTimeStep) : _penv(penv), _fTimeStep(fTimeStep), _nCollisionChecks(0)
+{
+    OPENRAVE_ASSERT_OP(fTimeStep,>,0);
+}
+
+int TrajectoryConflictChecker::AddTrajectory(KinBodyPtr pbody, TrajectoryBaseConstPtr ptraj, dReal fStartTime)
+{
+    OPENRAVE_ASSERT_OP(ptraj->GetNumWaypoints(),>,0);
+    _vtrajectories.push_back(SampledTrajectory());
+    SampledTrajectory& traj = _vtrajectories.back();
+    traj._pbody = pbody;
+    ConfigurationSpecification spec = pbody->GetConfigurationSpecification();
+    traj._nConfigDOF = spec.GetDOF();
+
+    dReal fDuration = ptraj->GetDuration();
+    int numsamples = max(0, (int)RaveCeil((fStartTime+fDuration)/_fTimeStep - g_fEpsilonLinear)) + 1;
+    std::vector<dReal> vtimes(numsamples);
+    for(int isample = 0; isample < numsamples; ++isample) {
+        vtimes[isample] = min(max(isample*_fTimeStep - fStartTime, dReal(0)), fDuration);
+    }
+    ptraj->SamplePoints(traj._vconfigs, vtimes, spec);
+
+    KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+    std::set<KinBodyPtr> setattached;
+    pbody->GetAttached(setattached);
+    AABB abempty;
+    abempty.extents = Vector(-1e30,-1e30,-1e30);
+    traj._vlevels.resize(1);
+    traj._vlevels[0].resize(numsamples, abempty);
+    for(int isample = 0; isample < numsamples; ++isample) {
+        pbody->SetConfigurationValues(traj._vconfigs.begin()+isample*traj._nConfigDOF, KinBody::CLA_Nothing);
+        AABB& ab = traj._vlevels[0][isample];
+        FOREACHC(itbody, setattached) {
+            FOREACHC(itlink, (*itbody)->GetLinks()) {
+                if( (*itlink)->IsEnabled() ) {
+                    ab = MergeAABBs(ab, (*itlink)->ComputeAABB());
+                }
+            }
+        }
+    }
+
+    while( traj._vlevels.back().size() > 1 ) {
+        std::vector<AABB> vlevel((traj._vlevels.back().size()+1)/2);
+        const std::vector<AABB>& vchildren = traj._vlevels.back();
+        for(size_t index = 0; index < vlevel.size(); ++index) {
+            vlevel[index] = 2*index+1 < vchildren.size() ? MergeAABBs(vchildren[2*index], vchildren[2*index+1]) : vchildren[2*index];
+        }
+        traj._vlevels.push_back(vlevel);
+    }
+    return (int)_vtrajectories.size()-1;
+}
+
+void TrajectoryConflictChecker::RemoveTrajectory(int itrajectory)
+{
+    OPENRAVE_ASSERT_FORMAT(itrajectory >= 0 && itrajectory < (int)_vtrajectories.size(), "trajectory index %d is out of range", itrajectory, ORE_InvalidArguments);
+    _vtrajectories.erase(_vtrajectories.begin()+itrajectory);
+}
+
+void TrajectoryConflictChecker::Clear()
+{
+    _vtrajectories.clear();
+}
+
+dReal TrajectoryConflictChecker::GetFirstConflictTime(int itrajectory0, int itrajectory1, CollisionReportPtr report)
+{
+    OPENRAVE_ASSERT_FORMAT(itrajectory0 >= 0 && itrajectory0 < (int)_vtrajectories.size(), "trajectory index %d is out of range", itrajectory0, ORE_InvalidArguments);
+    OPENRAVE_ASSERT_FORMAT(itrajectory1 >= 0 && itrajectory1 < (int)_vtrajectories.size(), "trajectory index %d is out of range", itrajectory1, ORE_InvalidArguments);
+    OPENRAVE_ASSERT_FORMAT(_vtrajectories[itrajectory0]._pbody != _vtrajectories[itrajectory1]._pbody, "trajectories %d and %d are of the same body", itrajectory0%itrajectory1, ORE_InvalidArguments);
+    _nCollisionChecks = 0;
+    int isample = _FindFirstConflict(_vtrajectories[itrajectory0], _vtrajectories[itrajectory1], std::numeric_limits<int>::max(), report);
+    return isample >= 0 ? isample*_fTimeStep : dReal(-1);
+}
+
+dReal TrajectoryConflictChecker::GetFirstConflictTime(std::pair<int, int>& conflictpair, CollisionReportPtr report)
+{
+    _nCollisionChecks = 0;
+    conflictpair = std::make_pair(-1,-1);
+    int nFirstSample = std::numeric_limits<int>::max();
+    for(size_t i = 0; i < _vtrajectories.size(); ++i) {
+        for(size_t j = i+1; j < _vtrajectories.size(); ++j) {
+            if( _vtrajectories[i]._pbody == _vtrajectories[j]._pbody ) {
+                continue;
+            }
+            // only samples before the earliest conflict found so far can change the result
+            int isample = _FindFirstConflict(_vtrajectories[i], _vtrajectories[j], nFirstSample, CollisionReportPtr());
+            if( isample >= 0 ) {
+                nFirstSample = isample;
+                conflictpair = std::make_pair((int)i, (int)j);
+            }
+        }
+    }
+    if( conflictpair.first < 0 ) {
+        return -1;
+    }
+    if( !!report ) {
+        // the checks of the other pairs reset the report, so fill it again
+        const SampledTrajectory& traj0 = _vtrajectories[conflictpair.first];
+        const SampledTrajectory& traj1 = _vtrajectories[conflictpair.second];
+        KinBody::KinBodyStateSaver saver0(traj0._pbody, KinBody::Save_LinkTransformation), saver1(traj1._pbody, KinBody::Save_LinkTransformation);
+        _CheckSample(traj0, traj1, nFirstSample, report);
+    }
+    return nFirstSample*_fTimeStep;
+}
+
+const AABB& TrajectoryConflictChecker::_GetNodeAABB(const SampledTrajectory& traj, size_t level, size_t index) const
+{
+    if( level >= traj._vlevels.size() ) {
+        // the node covers the whole trajectory or is after its end
+        return index == 0 ? traj._vlevels.back().at(0) : traj._vlevels[0].back();
+    }
+    const std::vector<AABB>& vlevel = traj._vlevels[level];
+    return index < vlevel.size() ? vlevel[index] : traj._vlevels[0].back();
+}
+
+int TrajectoryConflictChecker::_FindFirstConflict(const SampledTrajectory& traj0, const SampledTrajectory& traj1, int nEndSample, CollisionReportPtr report)
+{
+    int numsamples = (int)max(traj0._vlevels[0].size(), traj1._vlevels[0].size());
+    nEndSample = min(nEndSample, numsamples);
+    size_t level = 0;
+    while( ((size_t)1<<level) < (size_t)numsamples ) {
+        ++level;
+    }
+    KinBody::KinBodyStateSaver saver0(traj0._pbody, KinBody::Save_LinkTransformation), saver1(traj1._pbody, KinBody::Save_LinkTransformation);
+    return _FindFirstConflictInNode(traj0, traj1, level, 0, nEndSample, report);
+}
+
+int TrajectoryConflictChecker::_FindFirstConflictInNode(const SampledTrajectory& traj0, const SampledTrajectory& traj1, size_t level, size_t index, int nEndSample, CollisionReportPtr report)
+{
+    size_t nStartSample = index<<level;
+    if( nStartSample >= (size_t)nEndSample ) {
+        return -1;
+    }
+    if( !geometry::AABBCollision(_GetNodeAABB(traj0, level, index), _GetNodeAABB(traj1, level, index)) ) {
+        return -1;
+    }
+    if( level == 0 ) {
+        return _CheckSample(traj0, traj1, (int)nStartSample, report) ? (int)nStartSample : -1;
+    }
+    int isample = _FindFirstConflictInNode(traj0, traj1, level-1, 2*index, nEndSample, report);
+    if( isample >= 0 ) {
+        return isample;
+    }
+    return _FindFirstConflictInNode(traj0, traj1, level-1, 2*index+1, nEndSample, report);
+}
+
+bool TrajectoryConflictChecker::_CheckSample(const SampledTrajectory& traj0, const SampledTrajectory& traj1, int isample, CollisionReportPtr report)
+{
+    int isample0 = min(isample, (int)traj0._vlevels[0].size()-1);
+    int isample1 = min(isample, (int)traj1._vlevels[0].size()-1);
+    traj0._pbody->SetConfigurationValues(traj0._vconfigs.begin()+isample0*traj0._nConfigDOF, KinBody::CLA_Nothing);
+    traj1._pbody->SetConfigurationValues(traj1._vconfigs.begin()+isample1*traj1._nConfigDOF, KinBody::CLA_Nothing);
+    ++_nCollisionChecks;
+    return _penv->CheckCollision(KinBodyConstPtr(traj0._pbody), KinBodyConstPtr(traj1._pbody), report);
+}
+
+DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerParametersConstPtr parameters, const std::list<KinBodyPtr>& listCheckBodies, int filtermask) : _listCheckBodies(listCheckBodies), _filtermask(filtermask), _torquelimitmode(0), _perturbation(0.1), _bContinuousCollision(false), _bHasContinuousPrevState(false), _bDistanceStepping(false), _bHasDistanceAnchor(false), _fDistanceAnchor(0), _nDistanceAnchorSkips(0), _nDistanceBackoff(0), _nDistanceBackoffCount(0), _nDistanceQueries(0), _nDistanceChecks(0), _nDistanceSkipped(0), _bDeferChecks(false)
 {
     BOOST_ASSERT(listCheckBodies.size()>0);
     _report.reset(new CollisionReport());
@@ -2123,6 +2677,41 @@ void DynamicsCollisionConstraint::SetPerturbation(dReal perturbation)
     _perturbation = perturbation;
 }
 
+void DynamicsCollisionConstraint::SetContinuousCollisionChecking(bool bcontinuous)
+{
+    _bContinuousCollision = bcontinuous;
+}
+
+void DynamicsCollisionConstraint::SetDistanceBoundStepping(bool bdistancestepping)
+{
+    _bDistanceStepping = bdistancestepping;
+    _bHasDistanceAnchor = false;
+    _nDistanceBackoff = 0;
+    _nDistanceBackoffCount = 0;
+}
+
+void DynamicsCollisionConstraint::SetStaticDistanceField(SignedDistanceFieldConstPtr pfield)
+{
+    _pStaticDistanceField = pfield;
+    _bHasDistanceAnchor = false;
+    _nDistanceBackoff = 0;
+    _nDistanceBackoffCount = 0;
+}
+
+void DynamicsCollisionConstraint::GetDistanceBoundStatistics(int& numdistancequeries, int& numchecks, int& numskipped) const
+{
+    numdistancequeries = _nDistanceQueries;
+    numchecks = _nDistanceChecks;
+    numskipped = _nDistanceSkipped;
+}
+
+void DynamicsCollisionConstraint::ResetDistanceBoundStatistics()
+{
+    _nDistanceQueries = 0;
+    _nDistanceChecks = 0;
+    _nDistanceSkipped = 0;
+}
+
 int DynamicsCollisionConstraint::_SetAndCheckState(PlannerBase::PlannerParametersConstPtr params, const std::vector<dReal>& vdofvalues, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccels, int options, ConstraintFilterReturnPtr filterreturn)
 {
 //    if( IS_DEBUGLEVEL(Level_Verbose) ) {
@@ -2143,6 +2732,18 @@ int DynamicsCollisionConstraint::_SetAndCheckState(PlannerBase::PlannerParameter
     if( params->SetStateValues(vdofvalues, 0) != 0 ) {
         return CFO_StateSettingError;
     }
+    if( _bDeferChecks ) {
+        _vDeferredValues.insert(_vDeferredValues.end(), vdofvalues.begin(), vdofvalues.end());
+        _vDeferredVelocities.insert(_vDeferredVelocities.end(), vdofvelocities.begin(), vdofvelocities.end());
+        _vDeferredAccelerations.insert(_vDeferredAccelerations.end(), vdofaccels.begin(), vdofaccels.end());
+        if( !!filterreturn ) {
+            _vDeferredFilterIndices.push_back(std::make_pair(filterreturn->_configurations.size(), filterreturn->_configurationtimes.size()));
+        }
+        else {
+            _vDeferredFilterIndices.push_back(std::make_pair(size_t(0), size_t(0)));
+        }
+        return 0;
+    }
     if( (options & CFO_CheckTimeBasedConstraints) && !!_setvelstatefn && vdofvelocities.size() == vdofvalues.size() ) {
         (*_setvelstatefn)(vdofvelocities);
     }
@@ -2150,6 +2751,12 @@ int DynamicsCollisionConstraint::_SetAndCheckState(PlannerBase::PlannerParameter
     if( nstateret != 0 ) {
         return nstateret;
     }
+    if( _bContinuousCollision ) {
+        nstateret = _CheckContinuousState(options, filterreturn);
+        if( nstateret != 0 ) {
+            return nstateret;
+        }
+    }
     if( (options & CFO_CheckWithPerturbation) && _perturbation > 0 ) {
         // only check collision constraints with the perturbation since they are the only ones that don't have settable limits
         _vperturbedvalues.resize(vdofvalues.size());
@@ -2241,7 +2848,7 @@ int DynamicsCollisionConstraint::_CheckState(const std::vector<dReal>& vdofveloc
         }
     }
     FOREACHC(itbody, _listCheckBodies) {
-        if( (options&CFO_CheckEnvCollisions) && (*itbody)->GetEnv()->CheckCollision(KinBodyConstPtr(*itbody),_report) ) {
+        if( (options&CFO_CheckEnvCollisions) && _CheckEnvCollision(*itbody) ) {
             if( (options & CFO_FillCollisionReport) && !!filterreturn ) {
                 filterreturn->_report = *_report;
             }
@@ -2271,6 +2878,289 @@ int DynamicsCollisionConstraint::_CheckState(const std::vector<dReal>& vdofveloc
     return 0;
 }
 
+int DynamicsCollisionConstraint::_CheckDeferredStates(PlannerBase::PlannerParametersConstPtr params, int options, ConstraintFilterReturnPtr filterreturn)
+{
+    const int numstates = (int)_vDeferredFilterIndices.size();
+    if( numstates == 0 ) {
+        return 0;
+    }
+    const size_t dof = _vDeferredValues.size()/numstates, veldof = _vDeferredVelocities.size()/numstates, acceldof = _vDeferredAccelerations.size()/numstates;
+    _vprevtempconfig.resize(dof);
+    _vprevtempvelconfig.resize(veldof);
+    _vDeferredAccelConfig.resize(acceldof);
+    _vBisectionIntervals.resize(0);
+    _vBisectionIntervals.push_back(std::make_pair(0, numstates-1));
+    for(size_t iinterval = 0; iinterval < _vBisectionIntervals.size(); ++iinterval) {
+        const std::pair<int, int> interval = _vBisectionIntervals[iinterval];
+        if( interval.first > interval.second ) {
+            continue;
+        }
+        const int imid = (interval.first+interval.second)/2;
+        std::copy(_vDeferredValues.begin()+imid*dof, _vDeferredValues.begin()+(imid+1)*dof, _vprevtempconfig.begin());
+        std::copy(_vDeferredVelocities.begin()+imid*veldof, _vDeferredVelocities.begin()+(imid+1)*veldof, _vprevtempvelconfig.begin());
+        std::copy(_vDeferredAccelerations.begin()+imid*acceldof, _vDeferredAccelerations.begin()+(imid+1)*acceldof, _vDeferredAccelConfig.begin());
+        int nstateret = _SetAndCheckState(params, _vprevtempconfig, _vprevtempvelconfig, _vDeferredAccelConfig, options, filterreturn);
+        if( nstateret != 0 ) {
+            if( !!filterreturn ) {
+                // only keep the configurations up to the invalid one like the sequential order does
+                const std::pair<size_t, size_t>& filterindices = _vDeferredFilterIndices[imid];
+                filterreturn->_returncode = nstateret;
+                filterreturn->_invalidvalues = _vprevtempconfig;
+                filterreturn->_invalidvelocities = _vprevtempvelconfig;
+                if( filterreturn->_configurationtimes.size() > filterindices.second ) {
+                    filterreturn->_fTimeWhenInvalid = filterreturn->_configurationtimes[filterindices.second];
+                    filterreturn->_configurations.resize(filterindices.first+dof);
+                    filterreturn->_configurationtimes.resize(filterindices.second+1);
+                }
+                else {
+                    filterreturn->_configurations.resize(filterindices.first);
+                    filterreturn->_configurationtimes.resize(filterindices.second);
+                }
+            }
+            return nstateret;
+        }
+        _vBisectionIntervals.push_back(std::make_pair(interval.first, imid-1));
+        _vBisectionIntervals.push_back(std::make_pair(imid+1, interval.second));
+    }
+    return 0;
+}
+
+bool DynamicsCollisionConstraint::_CheckEnvCollision(KinBodyPtr pbody)
+{
+    if( !_bDistanceStepping || _listCheckBodies.size() != 1 ) {
+        return pbody->GetEnv()->CheckCollision(KinBodyConstPtr(pbody),_report);
+    }
+
+    pbody->GetDOFValues(_vDistanceValues);
+    if( _bHasDistanceAnchor ) {
+        const Transform t = pbody->GetTransform();
+        if( _vDistanceValues.size() == _vDistanceAnchorValues.size() && (t.trans-_tDistanceAnchor.trans).lengthsqr3() <= g_fEpsilon && (t.rot-_tDistanceAnchor.rot).lengthsqr4() <= g_fEpsilon ) {
+            dReal fbound = 0;
+            for(size_t i = 0; i < _vDistanceValues.size(); ++i) {
+                fbound += RaveFabs(_vDistanceValues[i]-_vDistanceAnchorValues[i])*_vDistanceAnchorRadii[i];
+            }
+            if( fbound < _fDistanceAnchor ) {
+                ++_nDistanceAnchorSkips;
+                ++_nDistanceSkipped;
+                return false;
+            }
+        }
+        // the anchor is too far, if it did not save anything then stop querying distances for a while
+        _bHasDistanceAnchor = false;
+        if( _nDistanceAnchorSkips == 0 ) {
+            _nDistanceBackoff = min(2*_nDistanceBackoff+1, 16);
+            _nDistanceBackoffCount = _nDistanceBackoff;
+        }
+        else {
+            _nDistanceBackoff = 0;
+        }
+    }
+
+    CollisionCheckerBasePtr pchecker = pbody->GetEnv()->GetCollisionChecker();
+    if( !!_pStaticDistanceField && _pStaticDistanceField->IsInitialized() && !!pchecker ) {
+        // the field is cheap to look up, so only the regular check is needed
+        ++_nDistanceChecks;
+        if( pbody->GetEnv()->CheckCollision(KinBodyConstPtr(pbody),_report) ) {
+            return true;
+        }
+        dReal fdistance = _ComputeStaticFieldDistance(pbody, pchecker);
+        if( fdistance > 0 ) {
+            _fDistanceAnchor = fdistance;
+            if( _ComputeDistanceAnchorRadii(pbody) ) {
+                _vDistanceAnchorValues.swap(_vDistanceValues);
+                _tDistanceAnchor = pbody->GetTransform();
+                _nDistanceAnchorSkips = 0;
+                _bHasDistanceAnchor = true;
+            }
+        }
+        return false;
+    }
+
+    if( _nDistanceBackoffCount > 0 || !pchecker ) {
+        --_nDistanceBackoffCount;
+        ++_nDistanceChecks;
+        return pbody->GetEnv()->CheckCollision(KinBodyConstPtr(pbody),_report);
+    }
+
+    bool bCollision;
+    {
+        CollisionOptionsStateSaver optionsaver(pchecker, pchecker->GetCollisionOptions()|CO_Distance, false);
+        if( !(pchecker->GetCollisionOptions() & CO_Distance) ) {
+            // checker cannot compute distances
+            _nDistanceBackoff = 16;
+            _nDistanceBackoffCount = _nDistanceBackoff;
+            ++_nDistanceChecks;
+            return pbody->GetEnv()->CheckCollision(KinBodyConstPtr(pbody),_report);
+        }
+        bCollision = pbody->GetEnv()->CheckCollision(KinBodyConstPtr(pbody),_report);
+    }
+    ++_nDistanceQueries;
+    if( !bCollision && _report->minDistance > 0 && _report->minDistance < 1e10 ) {
+        _fDistanceAnchor = _report->minDistance;
+        if( _ComputeDistanceAnchorRadii(pbody) ) {
+            _vDistanceAnchorValues.swap(_vDistanceValues);
+            _tDistanceAnchor = pbody->GetTransform();
+            _nDistanceAnchorSkips = 0;
+            _bHasDistanceAnchor = true;
+        }
+    }
+    return bCollision;
+}
+
+bool DynamicsCollisionConstraint::_ComputeDistanceAnchorRadii(KinBodyPtr pbody)
+{
+    FOREACHC(itjoint, pbody->GetJoints()) {
+        if( (*itjoint)->IsMimic() ) {
+            return false;
+        }
+    }
+    FOREACHC(itjoint, pbody->GetPassiveJoints()) {
+        if( (*itjoint)->IsMimic() ) {
+            return false;
+        }
+    }
+
+    // bounding spheres of the links followed by the grabbed bodies
+    _vDistanceSpheres.resize(0);
+    FOREACHC(itlink, pbody->GetLinks()) {
+        AABB ab = (*itlink)->ComputeAABB();
+        _vDistanceSpheres.push_back(std::make_pair(ab.pos, RaveSqrt(ab.extents.lengthsqr3())));
+    }
+    pbody->GetGrabbed(_vDistanceGrabbed);
+    FOREACHC(itgrabbed, _vDistanceGrabbed) {
+        AABB ab = (*itgrabbed)->ComputeAABB();
+        _vDistanceSpheres.push_back(std::make_pair(ab.pos, RaveSqrt(ab.extents.lengthsqr3())));
+    }
+
+    // the distance of a point to a joint anchor can grow by at most twice the displacement while the displacement stays below _fDistanceAnchor
+    _vDistanceAnchorRadii.resize(pbody->GetDOF());
+    for(int idof = 0; idof < pbody->GetDOF(); ++idof) {
+        KinBody::JointPtr pjoint = pbody->GetJointFromDOFIndex(idof);
+        if( pjoint->IsPrismatic(idof-pjoint->GetDOFIndex()) ) {
+            _vDistanceAnchorRadii[idof] = 1;
+            continue;
+        }
+        const Vector vanchor = pjoint->GetAnchor();
+        dReal fradius = 0;
+        for(size_t ilink = 0; ilink < pbody->GetLinks().size(); ++ilink) {
+            if( pbody->DoesDOFAffectLink(idof, ilink) ) {
+                fradius = max(fradius, RaveSqrt((_vDistanceSpheres[ilink].first-vanchor).lengthsqr3()) + _vDistanceSpheres[ilink].second);
+            }
+        }
+        for(size_t igrabbed = 0; igrabbed < _vDistanceGrabbed.size(); ++igrabbed) {
+            KinBody::LinkPtr pgrabbinglink = pbody->IsGrabbing(*_vDistanceGrabbed[igrabbed]);
+            if( !!pgrabbinglink && pbody->DoesDOFAffectLink(idof, pgrabbinglink->GetIndex()) ) {
+                const std::pair<Vector, dReal>& sphere = _vDistanceSpheres.at(pbody->GetLinks().size()+igrabbed);
+                fradius = max(fradius, RaveSqrt((sphere.first-vanchor).lengthsqr3()) + sphere.second);
+            }
+        }
+        _vDistanceAnchorRadii[idof] = fradius + 2*_fDistanceAnchor;
+    }
+    return true;
+}
+
+dReal DynamicsCollisionConstraint::_ComputeStaticFieldDistance(KinBodyPtr pbody, CollisionCheckerBasePtr pchecker)
+{
+    // the bounding spheres of the links and grabbed bodies against the field
+    const dReal fErrorBound = _pStaticDistanceField->GetErrorBound();
+    dReal fdistance = std::numeric_limits<dReal>::infinity();
+    FOREACHC(itlink, pbody->GetLinks()) {
+        if( (*itlink)->IsEnabled() ) {
+            AABB ab = (*itlink)->ComputeAABB();
+            fdistance = min(fdistance, _pStaticDistanceField->GetDistance(ab.pos) - fErrorBound - RaveSqrt(ab.extents.lengthsqr3()));
+        }
+    }
+    pbody->GetGrabbed(_vDistanceGrabbed);
+    FOREACHC(itgrabbed, _vDistanceGrabbed) {
+        AABB ab = (*itgrabbed)->ComputeAABB();
+        fdistance = min(fdistance, _pStaticDistanceField->GetDistance(ab.pos) - fErrorBound - RaveSqrt(ab.extents.lengthsqr3()));
+    }
+    if( fdistance <= 0 ) {
+        return 0;
+    }
+
+    // the bodies that are not in the field have to be queried
+    const std::vector<std::string>& vfieldnames = _pStaticDistanceField->GetBodyNames();
+    pbody->GetEnv()->GetBodies(_vDistanceEnvBodies);
+    CollisionOptionsStateSaver optionsaver(pchecker, pchecker->GetCollisionOptions()|CO_Distance, false);
+    FOREACHC(itbody, _vDistanceEnvBodies) {
+        const KinBodyPtr& potherbody = *itbody;
+        if( potherbody == pbody || !potherbody->IsEnabled() || !!pbody->IsGrabbing(*potherbody) ) {
+            continue;
+        }
+        if( find(vfieldnames.begin(), vfieldnames.end(), potherbody->GetName()) != vfieldnames.end() ) {
+            continue;
+        }
+        if( !(pchecker->GetCollisionOptions() & CO_Distance) ) {
+            // checker cannot compute distances
+            fdistance = 0;
+            break;
+        }
+        if( pchecker->CheckCollision(KinBodyConstPtr(pbody), KinBodyConstPtr(potherbody), _report) || !(_report->minDistance > 0) ) {
+            fdistance = 0;
+            break;
+        }
+        fdistance = min(fdistance, _report->minDistance);
+        FOREACHC(itgrabbed, _vDistanceGrabbed) {
+            if( pchecker->CheckCollision(KinBodyConstPtr(*itgrabbed), KinBodyConstPtr(potherbody), _report) || !(_report->minDistance > 0) ) {
+                fdistance = 0;
+                break;
+            }
+            fdistance = min(fdistance, _report->minDistance);
+        }
+        if( fdistance <= 0 ) {
+            break;
+        }
+    }
+    _vDistanceEnvBodies.resize(0);
+    if( fdistance > 1e10 ) {
+        // nothing to bound the distance with
+        return 0;
+    }
+    return fdistance;
+}
+
+int DynamicsCollisionConstraint::_CheckContinuousState(int options, ConstraintFilterReturnPtr filterreturn)
+{
+    options &= _filtermask;
+    bool bCheck = _bHasContinuousPrevState && (options & CFO_CheckEnvCollisions) && _vContinuousPrevValues.size() == _listCheckBodies.size();
+    _vContinuousPrevValues.resize(_listCheckBodies.size());
+    std::vector< std::vector<dReal> >::iterator itprevvalues = _vContinuousPrevValues.begin();
+    int ret = 0;
+    FOREACHC(itbody, _listCheckBodies) {
+        (*itbody)->GetDOFValues(_vContinuousValues);
+        if( bCheck && itprevvalues->size() == _vContinuousValues.size() && *itprevvalues != _vContinuousValues ) {
+            CollisionCheckerBasePtr pchecker = (*itbody)->GetEnv()->GetCollisionChecker();
+            if( !!pchecker && pchecker != _pContinuousUnsupportedChecker.lock() ) {
+                try {
+                    if( pchecker->CheckContinuousCollision(*itbody, std::vector<int>(), *itprevvalues, _vContinuousValues, _report) ) {
+                        if( (options & CFO_FillCollisionReport) && !!filterreturn ) {
+                            filterreturn->_report = *_report;
+                        }
+                        if( IS_DEBUGLEVEL(Level_Verbose) ) {
+                            _PrintOnFailure(std::string("continuous collision failed ")+_report->__str__());
+                        }
+                        ret = CFO_CheckEnvCollisions;
+                        bCheck = false;
+                    }
+                }
+                catch(const openrave_exception& ex) {
+                    if( ex.GetCode() != ORE_NotImplemented ) {
+                        throw;
+                    }
+                    RAVELOG_DEBUG_FORMAT("env=%d, collision checker %s does not support continuous collision checking, so only checking the discretized states", (*itbody)->GetEnv()->GetId()%pchecker->GetXMLId());
+                    _pContinuousUnsupportedChecker = pchecker;
+                    bCheck = false;
+                }
+            }
+        }
+        itprevvalues->swap(_vContinuousValues);
+        ++itprevvalues;
+    }
+    _bHasContinuousPrevState = true;
+    return ret;
+}
+
 void DynamicsCollisionConstraint::_PrintOnFailure(const std::string& prefix)
 {
     if( IS_DEBUGLEVEL(Level_Verbose) ) {
@@ -2341,6 +3231,9 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
     if( !!filterreturn ) {
         filterreturn->Clear();
     }
+    _bHasContinuousPrevState = false;
+    _bHasDistanceAnchor = false;
+    _bDeferChecks = false;
     // set the bounds based on the interval type
     PlannerBase::PlannerParametersConstPtr params = _parameters.lock();
     if( !params ) {
@@ -2525,6 +3418,17 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
             filterreturn->_configurationtimes.reserve(1+numSteps);
         }
     }
+    // the end was checked on its own, so the continuous checks start from q0
+    _bHasContinuousPrevState = false;
+    if( _bContinuousCollision && start > 0 ) {
+        if( params->SetStateValues(q0, 0) != 0 ) {
+            if( !!filterreturn ) {
+                filterreturn->_returncode = CFO_StateSettingError;
+            }
+            return CFO_StateSettingError;
+        }
+        _CheckContinuousState(0, filterreturn);
+    }
     if (start == 0 ) {
         int nstateret = _SetAndCheckState(params, q0, dq0, _vtempaccelconfig, maskoptions, filterreturn);
         if( options & CFO_FillCheckedConfiguration ) {
@@ -2553,6 +3457,15 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
         return 0;
     }
 
+    if( params->_nSegmentCheckOrder == SCO_Bisection && !_bContinuousCollision ) {
+        // compute all the states from start to end first, then check them in bisection order
+        _vDeferredValues.resize(0);
+        _vDeferredVelocities.resize(0);
+        _vDeferredAccelerations.resize(0);
+        _vDeferredFilterIndices.resize(0);
+        _bDeferChecks = true;
+    }
+
     for (i = 0; i < params->GetDOF(); i++) {
         _vtempconfig.at(i) = q0.at(i);
     }
@@ -3302,6 +4215,34 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
         }
     }
 
+    if( _bDeferChecks ) {
+        _bDeferChecks = false;
+        int nstateret = _CheckDeferredStates(params, maskoptions, filterreturn);
+        if( nstateret != 0 ) {
+            return nstateret;
+        }
+    }
+
+    if( _bContinuousCollision && bCheckEnd && _bHasContinuousPrevState ) {
+        // sweep the last step into q1
+        if( params->SetStateValues(q1, 0) != 0 ) {
+            if( !!filterreturn ) {
+                filterreturn->_returncode = CFO_StateSettingError;
+            }
+            return CFO_StateSettingError;
+        }
+        int nstateret = _CheckContinuousState(maskoptions, filterreturn);
+        if( nstateret != 0 ) {
+            if( !!filterreturn ) {
+                filterreturn->_returncode = nstateret;
+                filterreturn->_invalidvalues = q1;
+                filterreturn->_invalidvelocities = dq1;
+                filterreturn->_fTimeWhenInvalid = timeelapsed > 0 ? timeelapsed : dReal(1.0);
+            }
+            return nstateret;
+        }
+    }
+
     if( !!filterreturn ) {
         filterreturn->_bHasRampDeviatedFromInterpolation = bHasRampDeviatedFromInterpolation;
         if( options & CFO_FillCheckedConfiguration ) {
@@ -3321,6 +4262,70 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
     return 0;
 }
 
+dReal ComputeWeightedDistance2(const dReal* pconfig0, const dReal* pconfig1, int dof, const dReal* pweights2)
+{
+    int i = 0;
+    dReal dist2 = 0;
+#if OPENRAVE_PRECISION // double
+#if defined(__AVX__)
+    __m256d vsum4 = _mm256_setzero_pd();
+    for(; i+4 <= dof; i += 4) {
+        __m256d vdiff = _mm256_sub_pd(_mm256_loadu_pd(pconfig0+i), _mm256_loadu_pd(pconfig1+i));
+        vsum4 = _mm256_add_pd(vsum4, _mm256_mul_pd(_mm256_loadu_pd(pweights2+i), _mm256_mul_pd(vdiff, vdiff)));
+    }
+    __m128d vsum = _mm_add_pd(_mm256_castpd256_pd128(vsum4), _mm256_extractf128_pd(vsum4, 1));
+#elif defined(__SSE2__)
+    __m128d vsum = _mm_setzero_pd();
+#endif
+#if defined(__SSE2__) || defined(__AVX__)
+    for(; i+2 <= dof; i += 2) {
+        __m128d vdiff = _mm_sub_pd(_mm_loadu_pd(pconfig0+i), _mm_loadu_pd(pconfig1+i));
+        vsum = _mm_add_pd(vsum, _mm_mul_pd(_mm_loadu_pd(pweights2+i), _mm_mul_pd(vdiff, vdiff)));
+    }
+    double fsum[2];
+    _mm_storeu_pd(fsum, vsum);
+    dist2 = fsum[0] + fsum[1];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float64x2_t vsum = vdupq_n_f64(0);
+    for(; i+2 <= dof; i += 2) {
+        float64x2_t vdiff = vsubq_f64(vld1q_f64(pconfig0+i), vld1q_f64(pconfig1+i));
+        vsum = vfmaq_f64(vsum, vld1q_f64(pweights2+i), vmulq_f64(vdiff, vdiff));
+    }
+    dist2 = vaddvq_f64(vsum);
+#endif
+#else // float
+#if defined(__SSE2__) || defined(__AVX__)
+    __m128 vsum = _mm_setzero_ps();
+    for(; i+4 <= dof; i += 4) {
+        __m128 vdiff = _mm_sub_ps(_mm_loadu_ps(pconfig0+i), _mm_loadu_ps(pconfig1+i));
+        vsum = _mm_add_ps(vsum, _mm_mul_ps(_mm_loadu_ps(pweights2+i), _mm_mul_ps(vdiff, vdiff)));
+    }
+    float fsum[4];
+    _mm_storeu_ps(fsum, vsum);
+    dist2 = (fsum[0] + fsum[1]) + (fsum[2] + fsum[3]);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t vsum = vdupq_n_f32(0);
+    for(; i+4 <= dof; i += 4) {
+        float32x4_t vdiff = vsubq_f32(vld1q_f32(pconfig0+i), vld1q_f32(pconfig1+i));
+        vsum = vfmaq_f32(vsum, vld1q_f32(pweights2+i), vmulq_f32(vdiff, vdiff));
+    }
+    dist2 = vaddvq_f32(vsum);
+#endif
+#endif
+    for(; i < dof; ++i) {
+        dReal fdiff = pconfig0[i] - pconfig1[i];
+        dist2 += pweights2[i]*fdiff*fdiff;
+    }
+    return dist2;
+}
+
+void ComputeWeightedDistances2(const dReal* pquery, const dReal* pconfigs, size_t numconfigs, int dof, const dReal* pweights2, dReal* pdistances2)
+{
+    for(size_t iconfig = 0; iconfig < numconfigs; ++iconfig, pconfigs += dof) {
+        pdistances2[iconfig] = ComputeWeightedDistance2(pconfigs, pquery, dof, pweights2);
+    }
+}
+
 SimpleDistanceMetric::SimpleDistanceMetric(RobotBasePtr robot) : _robot(robot)
 {
     _robot->GetActiveDOFWeights(weights2);
@@ -3376,6 +4381,7 @@ ManipulatorIKGoalSampler::ManipulatorIKGoalSampler(RobotBase::ManipulatorConstPt
 {
     _tempikindex = -1;
     _fjittermaxdist = 0;
+    _nNumThreads = 0;
     _probot = _pmanip->GetRobot();
     _pindexsampler = RaveCreateSpaceSampler(_probot->GetEnv(),"mt19937");
     int orgindex = 0;
@@ -3658,8 +4664,11 @@ IkReturnPtr ManipulatorIKGoalSampler::Sample()
     return IkReturnPtr();
 }
 
-bool ManipulatorIKGoalSampler::SampleAll(std::list<IkReturnPtr>& samples, int maxsamples, int maxchecksamples)
+bool ManipulatorIKGoalSampler::SampleAll(std::list<IkReturnPtr>& samples, int maxsamples, int maxchecksamples, const SampleCallbackFn& fncallback)
 {
+    if( _nNumThreads > 1 ) {
+        return _SampleAllParallel(samples, maxsamples, maxchecksamples, fncallback);
+    }
     // currently this is a very slow implementation...
     samples.clear();
     int numchecked=0;
@@ -3669,6 +4678,9 @@ bool ManipulatorIKGoalSampler::SampleAll(std::list<IkReturnPtr>& samples, int ma
             break;
         }
         samples.push_back(ikreturn);
+        if( !!fncallback && !fncallback(ikreturn, _listreturnedsamples.back()) ) {
+            return true;
+        }
         if( maxsamples > 0 && (int)samples.size() >= maxsamples ) {
             return true;
         }
@@ -3681,6 +4693,177 @@ bool ManipulatorIKGoalSampler::SampleAll(std::list<IkReturnPtr>& samples, int ma
     return samples.size()>0;
 }
 
+struct ManipulatorIKGoalSampler::ParallelSampleState
+{
+    ParallelSampleState() : _numrunning(0), _bstop(false) {
+    }
+    boost::mutex _mutex;
+    boost::condition_variable _condition; ///< notified when a sample is added or a worker finishes
+    std::list< std::pair<IkReturnPtr, int> > _listreturns; ///< samples and their original parameterization index not yet taken by the calling thread
+    int _numrunning; ///< number of workers still sampling
+    bool _bstop; ///< set by the calling thread to stop the workers
+};
+
+void ManipulatorIKGoalSampler::_SampleAllWorker(boost::shared_ptr<ManipulatorIKGoalSampler> pworker, const std::vector<int>& vorgindices, boost::shared_ptr<ParallelSampleState> pstate)
+{
+    try {
+        EnvironmentMutex::scoped_lock lock(pworker->_probot->GetEnv()->GetMutex());
+        // Sample returns nothing when it runs out of tries, so keep going until the parameterizations are exhausted
+        while( pworker->_listsamples.size() > 0 || pworker->_vikreturns.size() > 0 ) {
+            {
+                boost::mutex::scoped_lock statelock(pstate->_mutex);
+                if( pstate->_bstop ) {
+                    break;
+                }
+            }
+            IkReturnPtr ikreturn = pworker->Sample();
+            if( !ikreturn ) {
+                continue;
+            }
+            int orgindex = vorgindices.at(pworker->_listreturnedsamples.back());
+            {
+                boost::mutex::scoped_lock statelock(pstate->_mutex);
+                pstate->_listreturns.push_back(std::make_pair(ikreturn, orgindex));
+            }
+            pstate->_condition.notify_one();
+        }
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_WARN_FORMAT("goal sampling thread failed: %s", ex.what());
+    }
+    {
+        boost::mutex::scoped_lock statelock(pstate->_mutex);
+        --pstate->_numrunning;
+    }
+    pstate->_condition.notify_one();
+}
+
+bool ManipulatorIKGoalSampler::_SampleAllParallel(std::list<IkReturnPtr>& samples, int maxsamples, int maxchecksamples, const SampleCallbackFn& fncallback)
+{
+    samples.clear();
+    int numchecked = 0;
+    // return the solutions left over from a previous Sample call first
+    while( _vikreturns.size() > 0 ) {
+        IkReturnPtr ikreturn = _vikreturns.back();
+        _vikreturns.pop_back();
+        _listreturnedsamples.push_back(_tempikindex);
+        samples.push_back(ikreturn);
+        numchecked += 1;
+        if( (!!fncallback && !fncallback(ikreturn, _tempikindex)) || (maxsamples > 0 && (int)samples.size() >= maxsamples) ) {
+            if( _vikreturns.size() == 0 ) {
+                _tempikindex = -1;
+            }
+            return true;
+        }
+    }
+    _tempikindex = -1;
+    if( _listsamples.size() == 0 || (maxchecksamples > 0 && numchecked >= maxchecksamples) ) {
+        return samples.size()>0;
+    }
+
+    IkSolverBasePtr piksolver = _pmanip->GetIkSolver();
+    EnvironmentBasePtr penv = _probot->GetEnv();
+    size_t numthreads = std::min(_listsamples.size(), (size_t)_nNumThreads);
+    while( _vthreadenvs.size() < numthreads ) {
+        _vthreadenvs.push_back(penv->CloneSelf(Clone_Bodies));
+        _vthreadiksolvers.push_back(IkSolverBasePtr());
+    }
+
+    // distribute the parameterizations round robin so that every thread gets a similar mix
+    std::vector< std::list<IkParameterization> > vlistparameterizations(numthreads);
+    std::vector< std::vector<int> > vvorgindices(numthreads);
+    std::vector< std::vector<int> > vvnumleft(numthreads);
+    size_t ithread = 0;
+    FOREACHC(itsample, _listsamples) {
+        vlistparameterizations[ithread].push_back(itsample->_ikparam);
+        vvorgindices[ithread].push_back(itsample->_orgindex);
+        vvnumleft[ithread].push_back(itsample->_numleft);
+        ithread = (ithread+1)%numthreads;
+    }
+    _listsamples.clear();
+
+    std::vector< boost::shared_ptr<ManipulatorIKGoalSampler> > vworkers(numthreads);
+    for(ithread = 0; ithread < numthreads; ++ithread) {
+        EnvironmentBasePtr pthreadenv = _vthreadenvs[ithread];
+        pthreadenv->SynchronizeBodies(penv);
+        EnvironmentMutex::scoped_lock lock(pthreadenv->GetMutex());
+        RobotBasePtr pthreadrobot = pthreadenv->GetRobot(_probot->GetName());
+        if( !pthreadrobot ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, robot %s is not in the cloned environment", penv->GetId()%_probot->GetName(), ORE_Assert);
+        }
+        RobotBase::ManipulatorPtr pthreadmanip = pthreadrobot->GetManipulator(_pmanip->GetName());
+        if( !pthreadmanip ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("env=%d, manipulator %s is not in the cloned robot", penv->GetId()%_pmanip->GetName(), ORE_Assert);
+        }
+        // a full clone recreates the manipulators, so check whether the solver is still ours
+        if( !_vthreadiksolvers[ithread] || pthreadmanip->GetIkSolver() != _vthreadiksolvers[ithread] ) {
+            IkSolverBasePtr pthreadiksolver = RaveCreateIkSolver(pthreadenv, piksolver->GetXMLId());
+            if( !pthreadiksolver ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("env=%d, failed to create ik solver %s", penv->GetId()%piksolver->GetXMLId(), ORE_InvalidPlugin);
+            }
+            pthreadiksolver->Clone(piksolver, 0);
+            if( !pthreadmanip->SetIkSolver(pthreadiksolver) ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("env=%d, failed to set ik solver %s on cloned manipulator", penv->GetId()%piksolver->GetXMLId(), ORE_Failed);
+            }
+            _vthreadiksolvers[ithread] = pthreadiksolver;
+        }
+        vworkers[ithread].reset(new ManipulatorIKGoalSampler(pthreadmanip, vlistparameterizations[ithread], _nummaxsamples, _nummaxtries, 1, _searchfreeparameters, _ikfilteroptions, _vfreegoalvalues));
+        vworkers[ithread]->SetJitter(_fjittermaxdist);
+        std::vector<int>::const_iterator itnumleft = vvnumleft[ithread].begin();
+        FOREACH(itsample, vworkers[ithread]->_listsamples) {
+            itsample->_numleft = *itnumleft++;
+        }
+    }
+
+    boost::shared_ptr<ParallelSampleState> pstate(new ParallelSampleState());
+    pstate->_numrunning = numthreads;
+    std::vector< boost::shared_ptr<boost::thread> > vthreads(numthreads);
+    for(ithread = 0; ithread < numthreads; ++ithread) {
+        vthreads[ithread].reset(new boost::thread(boost::bind(&ManipulatorIKGoalSampler::_SampleAllWorker, vworkers[ithread], boost::cref(vvorgindices[ithread]), pstate)));
+    }
+
+    bool bstop = false;
+    while(!bstop) {
+        std::list< std::pair<IkReturnPtr, int> > listreturns;
+        {
+            boost::mutex::scoped_lock statelock(pstate->_mutex);
+            while( pstate->_listreturns.size() == 0 && pstate->_numrunning > 0 ) {
+                pstate->_condition.wait(statelock);
+            }
+            if( pstate->_listreturns.size() == 0 ) {
+                break;
+            }
+            listreturns.swap(pstate->_listreturns);
+        }
+        FOREACH(itreturn, listreturns) {
+            samples.push_back(itreturn->first);
+            _listreturnedsamples.push_back(itreturn->second);
+            numchecked += 1;
+            if( !!fncallback && !fncallback(itreturn->first, itreturn->second) ) {
+                bstop = true;
+            }
+            else if( maxsamples > 0 && (int)samples.size() >= maxsamples ) {
+                bstop = true;
+            }
+            else if( maxchecksamples > 0 && numchecked >= maxchecksamples ) {
+                bstop = true;
+            }
+            if( bstop ) {
+                break;
+            }
+        }
+    }
+    {
+        boost::mutex::scoped_lock statelock(pstate->_mutex);
+        pstate->_bstop = true;
+    }
+    FOREACH(itthread, vthreads) {
+        (*itthread)->join();
+    }
+    RAVELOG_VERBOSE_FORMAT("env=%d, computed %d samples with %d threads", penv->GetId()%samples.size()%numthreads);
+    return samples.size()>0;
+}
+
 int ManipulatorIKGoalSampler::GetIkParameterizationIndex(int index)
 {
     BOOST_ASSERT(index >= 0 && index < (int)_listreturnedsamples.size());
@@ -3699,5 +4882,187 @@ void ManipulatorIKGoalSampler::SetJitter(dReal maxdist)
     _fjittermaxdist = maxdist;
 }
 
+void ManipulatorIKGoalSampler::SetNumThreads(int numthreads)
+{
+    _nNumThreads = numthreads;
+}
+
+struct AsyncPlanPath::AsyncPlanState
+{
+    AsyncPlanState() : _planningoptions(0), _bDone(false), _bCancel(false) {
+    }
+
+    /// \brief plan callback of the worker's planner, records the progress and interrupts when cancelled
+    PlannerAction _PlanCallback(const PlannerBase::PlannerProgress& progress)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _progress = progress;
+        return _bCancel ? PA_Interrupt : PA_None;
+    }
+
+    EnvironmentBasePtr _penv; ///< clone of the environment of the original planner, only used by the worker
+    std::string _plannername, _robotname;
+    std::string _sparameters; ///< serialized parameters of the original planner
+    int _planningoptions;
+    TrajectoryBasePtr _ptraj; ///< planned trajectory in _penv
+    PlannerStatus _status;
+    PlannerBase::PlannerProgress _progress;
+    boost::mutex _mutex;
+    boost::condition_variable _condition; ///< notified when the worker finishes
+    bool _bDone; ///< set by the worker after _status is set
+    bool _bCancel; ///< set by the calling thread to interrupt the worker
+};
+
+AsyncPlanPath::AsyncPlanPath(PlannerBasePtr planner, RobotBasePtr robot, int planningoptions)
+{
+    OPENRAVE_ASSERT_FORMAT0(!!planner, "need a planner", ORE_InvalidArguments);
+    PlannerBase::PlannerParametersConstPtr parameters = planner->GetParameters();
+    OPENRAVE_ASSERT_FORMAT(!!parameters, "env=%d, planner %s is not initialized", planner->GetEnv()->GetId()%planner->GetXMLId(), ORE_InvalidState);
+    _pstate.reset(new AsyncPlanState());
+    _pstate->_plannername = planner->GetXMLId();
+    if( !!robot ) {
+        _pstate->_robotname = robot->GetName();
+    }
+    _pstate->_planningoptions = planningoptions;
+    std::stringstream ss;
+    ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+    ss << *parameters;
+    _pstate->_sparameters = ss.str();
+    _pstate->_penv = planner->GetEnv()->CloneSelf(Clone_Bodies);
+    _pthread.reset(new boost::thread(boost::bind(&AsyncPlanPath::_PlanWorker, _pstate)));
+}
+
+AsyncPlanPath::~AsyncPlanPath()
+{
+    Cancel();
+    _pthread->join();
+    _pstate->_penv->Destroy();
+}
+
+bool AsyncPlanPath::IsDone() const
+{
+    boost::mutex::scoped_lock lock(_pstate->_mutex);
+    return _pstate->_bDone;
+}
+
+bool AsyncPlanPath::Wait(uint32_t timeout)
+{
+    boost::mutex::scoped_lock lock(_pstate->_mutex);
+    if( timeout == 0 ) {
+        while( !_pstate->_bDone ) {
+            _pstate->_condition.wait(lock);
+        }
+        return true;
+    }
+    boost::system_time endtime = boost::get_system_time() + boost::posix_time::milliseconds(timeout);
+    while( !_pstate->_bDone ) {
+        if( !_pstate->_condition.timed_wait(lock, endtime) ) {
+            break;
+        }
+    }
+    return _pstate->_bDone;
+}
+
+void AsyncPlanPath::Cancel()
+{
+    boost::mutex::scoped_lock lock(_pstate->_mutex);
+    _pstate->_bCancel = true;
+}
+
+PlannerBase::PlannerProgress AsyncPlanPath::GetProgress() const
+{
+    boost::mutex::scoped_lock lock(_pstate->_mutex);
+    return _pstate->_progress;
+}
+
+PlannerStatus AsyncPlanPath::GetResult(TrajectoryBasePtr traj)
+{
+    Wait();
+    // the worker does not touch the state anymore
+    if( !!traj && _pstate->_status.HasSolution() && !!_pstate->_ptraj ) {
+        traj->Clone(_pstate->_ptraj, 0);
+    }
+    return _pstate->_status;
+}
+
+void AsyncPlanPath::_PlanWorker(boost::shared_ptr<AsyncPlanState> pstate)
+{
+    PlannerStatus status;
+    try {
+        EnvironmentBasePtr penv = pstate->_penv;
+        PlannerBasePtr planner = RaveCreatePlanner(penv, pstate->_plannername);
+        OPENRAVE_ASSERT_FORMAT(!!planner, "env=%d, failed to create planner %s", penv->GetId()%pstate->_plannername, ORE_InvalidPlugin);
+        UserDataPtr callbackhandle = planner->RegisterPlanCallback(boost::bind(&AsyncPlanState::_PlanCallback, pstate.get(), _1));
+        bool bInitialized = false;
+        {
+            EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+            RobotBasePtr probot;
+            if( pstate->_robotname.size() > 0 ) {
+                probot = penv->GetRobot(pstate->_robotname);
+                OPENRAVE_ASSERT_FORMAT(!!probot, "env=%d, robot %s is not in the cloned environment", penv->GetId()%pstate->_robotname, ORE_InvalidArguments);
+            }
+
+            // the parameters not known to PlannerParameters go to _sExtraParameters, so the planner recovers them when copying
+            PlannerBase::PlannerParametersPtr params(new PlannerBase::PlannerParameters());
+            std::stringstream ss(pstate->_sparameters);
+            ss >> *params;
+            ConfigurationSpecification spec = params->_configurationspecification;
+            std::vector<dReal> vinitialconfig = params->vinitialconfig, vgoalconfig = params->vgoalconfig;
+            std::vector<dReal> vlowerlimit = params->_vConfigLowerLimit, vupperlimit = params->_vConfigUpperLimit, vresolution = params->_vConfigResolution;
+            std::vector<dReal> vvelocitylimit = params->_vConfigVelocityLimit, vaccelerationlimit = params->_vConfigAccelerationLimit;
+            params->SetConfigurationSpecification(penv, spec);
+            params->vinitialconfig.swap(vinitialconfig);
+            params->vgoalconfig.swap(vgoalconfig);
+            if( vlowerlimit.size() == params->_vConfigLowerLimit.size() && vupperlimit.size() == params->_vConfigUpperLimit.size() ) {
+                params->_vConfigLowerLimit.swap(vlowerlimit);
+                params->_vConfigUpperLimit.swap(vupperlimit);
+            }
+            if( vresolution.size() == params->_vConfigResolution.size() ) {
+                params->_vConfigResolution.swap(vresolution);
+            }
+            if( vvelocitylimit.size() == params->_vConfigVelocityLimit.size() ) {
+                params->_vConfigVelocityLimit.swap(vvelocitylimit);
+            }
+            if( vaccelerationlimit.size() == params->_vConfigAccelerationLimit.size() ) {
+                params->_vConfigAccelerationLimit.swap(vaccelerationlimit);
+            }
+            bInitialized = planner->InitPlan(probot, params);
+            if( bInitialized ) {
+                pstate->_ptraj = RaveCreateTrajectory(penv, "");
+            }
+        }
+
+        if( !bInitialized ) {
+            status = PlannerStatus(str(boost::format("env=%d, failed to initialize planner %s on the cloned environment")%penv->GetId()%pstate->_plannername), PS_Failed);
+        }
+        else {
+            bool bCancel;
+            {
+                boost::mutex::scoped_lock lock(pstate->_mutex);
+                bCancel = pstate->_bCancel;
+            }
+            if( bCancel ) {
+                status = PlannerStatus("Planning was interrupted", PS_Interrupted);
+            }
+            else {
+                status = planner->PlanPath(pstate->_ptraj, pstate->_planningoptions);
+            }
+        }
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_WARN_FORMAT("env=%d, async plan with %s failed: %s", pstate->_penv->GetId()%pstate->_plannername%ex.what());
+        status = PlannerStatus(ex.what(), PS_Failed);
+    }
+    boost::mutex::scoped_lock lock(pstate->_mutex);
+    pstate->_status = status;
+    pstate->_bDone = true;
+    pstate->_condition.notify_all();
+}
+
+AsyncPlanPathPtr PlanPathAsync(PlannerBasePtr planner, RobotBasePtr robot, int planningoptions)
+{
+    return AsyncPlanPathPtr(new AsyncPlanPath(planner, robot, planningoptions));
+}
+
 } // planningutils
 } // OpenRAVE
@@ -35,6 +35,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <unistd.h>
 
 #ifdef __APPLE_CC__
 #define PLUGIN_EXT ".dylib"
@@ -88,7 +89,7 @@ public:
     class Plugin : public UserData, public boost::enable_shared_from_this<Plugin>
     {
 public:
-        Plugin(boost::shared_ptr<RaveDatabase> pdatabase) : _pdatabase(pdatabase), plibrary(NULL), pfnCreate(NULL), pfnCreateNew(NULL), pfnGetPluginAttributes(NULL), pfnGetPluginAttributesNew(NULL), pfnDestroyPlugin(NULL), pfnOnRaveInitialized(NULL), pfnOnRavePreDestroy(NULL), _bShutdown(false), _bInitializing(true), _bHasCalledOnRaveInitialized(false) {
+        Plugin(boost::shared_ptr<RaveDatabase> pdatabase) : _pdatabase(pdatabase), plibrary(NULL), pfnCreate(NULL), pfnCreateNew(NULL), pfnGetPluginAttributes(NULL), pfnGetPluginAttributesNew(NULL), pfnDestroyPlugin(NULL), pfnOnRaveInitialized(NULL), pfnOnRavePreDestroy(NULL), _bShutdown(false), _bInitializing(true), _bHasCalledOnRaveInitialized(false), _bLoadDeferred(false) {
         }
         virtual ~Plugin() {
             Destroy();
@@ -138,6 +139,11 @@ public:
             return !_bShutdown;
         }
 
+        /// \brief true if the plugin info was read from the manifest and the library has not been opened yet
+        bool IsLoadDeferred() const {
+            return _bLoadDeferred && plibrary == NULL;
+        }
+
         const string& GetName() const {
             return ppluginname;
         }
@@ -287,6 +293,11 @@ public:
                 if( !Load_CreateInterfaceGlobal() ) {
                     throw openrave_exception(str(boost::format(_("%s: can't load CreateInterface function\n"))%ppluginname),ORE_InvalidPlugin);
                 }
+                if( _bLoadDeferred ) {
+                    // the library was opened for the first time, so it still has to be initialized
+                    _bLoadDeferred = false;
+                    OnRaveInitialized();
+                }
                 InterfaceBasePtr pinterface;
                 if( pfnCreateNew != NULL ) {
                     pinterface = pfnCreateNew(type,name,interfacehash,OPENRAVE_ENVIRONMENT_HASH,penv);
@@ -375,6 +386,7 @@ protected:
         bool _bShutdown;         ///< managed by plugin database
         bool _bInitializing; ///< still in the initialization phase
         bool _bHasCalledOnRaveInitialized; ///< if true, then OnRaveInitialized has been called and does not need to call it again.
+        bool _bLoadDeferred; ///< if true, _infocached comes from the manifest and the library is only opened when an interface is created
 
         friend class RaveDatabase;
     };
@@ -382,7 +394,7 @@ protected:
     typedef boost::shared_ptr<Plugin const> PluginConstPtr;
     friend class Plugin;
 
-    RaveDatabase() : _bShutdown(false) {
+    RaveDatabase() : _bManifestModified(false), _bShutdown(false) {
     }
     virtual ~RaveDatabase() {
         Destroy();
@@ -428,8 +440,15 @@ protected:
         return RaveInterfaceCast<SpaceSamplerBase>(Create(penv, PT_SpaceSampler, name));
     }
 
-    virtual bool Init(bool bLoadAllPlugins)
+    /// \param manifestfilename file caching the interfaces of the plugins, so libraries that did not change are only opened on the first interface they create. If empty, the manifest is not used.
+    virtual bool Init(bool bLoadAllPlugins, const std::string& manifestfilename=std::string())
     {
+#ifndef _WIN32
+        _manifestfilename = manifestfilename;
+        if( _manifestfilename.size() > 0 ) {
+            _ReadManifest();
+        }
+#endif
         _threadPluginLoader.reset(new boost::thread(boost::bind(&RaveDatabase::_PluginLoaderThread, this)));
         std::vector<std::string> vplugindirs;
 #ifdef _WIN32
@@ -506,6 +525,10 @@ protected:
                 }
             }
         }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _WriteManifest();
+        }
         return true;
     }
 
@@ -726,7 +749,9 @@ protected:
     {
         boost::mutex::scoped_lock lock(_mutex);
         FOREACH(itplugin, _listplugins) {
-            (*itplugin)->OnRaveInitialized();
+            if( !(*itplugin)->IsLoadDeferred() ) {
+                (*itplugin)->OnRaveInitialized();
+            }
         }
     }
 
@@ -734,7 +759,9 @@ protected:
     {
         boost::mutex::scoped_lock lock(_mutex);
         FOREACH(itplugin, _listplugins) {
-            (*itplugin)->OnRavePreDestroy();
+            if( !(*itplugin)->IsLoadDeferred() ) {
+                (*itplugin)->OnRavePreDestroy();
+            }
         }
     }
 
@@ -900,56 +927,69 @@ protected:
         return _listplugins.end();
     }
 
-    PluginPtr _LoadPlugin(const string& _libraryname)
+    /// \brief returns the file of the library, tries adding PLUGIN_EXT, the lib prefix and the plugin directories in that order. Empty if the library cannot be found.
+    std::string _FindLibraryFile(const string& _libraryname) const
     {
         string libraryname = _libraryname;
-        void* plibrary = _SysLoadLibrary(libraryname,OPENRAVE_LAZY_LOADING);
-        if( plibrary == NULL ) {
-            // check if PLUGIN_EXT is missing
-            if( libraryname.find(PLUGIN_EXT) == string::npos ) {
-                libraryname += PLUGIN_EXT;
-                plibrary = _SysLoadLibrary(libraryname,OPENRAVE_LAZY_LOADING);
+        if( _IsFile(libraryname) ) {
+            return libraryname;
+        }
+        // check if PLUGIN_EXT is missing
+        if( libraryname.find(PLUGIN_EXT) == string::npos ) {
+            libraryname += PLUGIN_EXT;
+            if( _IsFile(libraryname) ) {
+                return libraryname;
             }
         }
 #ifndef _WIN32
-        if( plibrary == NULL ) {
-            // unix libraries are prefixed with 'lib', first have to split
+        // unix libraries are prefixed with 'lib', first have to split
 #if defined(HAVE_BOOST_FILESYSTEM) && BOOST_VERSION >= 103600 // stem() was introduced in 1.36
 #if defined(BOOST_FILESYSTEM_VERSION) && BOOST_FILESYSTEM_VERSION >= 3
-            boost::filesystem::path _librarypath(libraryname);
-            string librarypath = _librarypath.parent_path().string();
-            string libraryfilename = _librarypath.filename().string();
+        boost::filesystem::path _librarypath(libraryname);
+        string librarypath = _librarypath.parent_path().string();
+        string libraryfilename = _librarypath.filename().string();
 #else
-            boost::filesystem::path _librarypath(libraryname, boost::filesystem::native);
-            string librarypath = _librarypath.parent_path().string();
-            string libraryfilename = _librarypath.filename();
+        boost::filesystem::path _librarypath(libraryname, boost::filesystem::native);
+        string librarypath = _librarypath.parent_path().string();
+        string libraryfilename = _librarypath.filename();
 #endif
-            if(( libraryfilename.size() > 3) &&( libraryfilename.substr(0,3) != string("lib")) ) {
-                libraryname = librarypath;
-                if( libraryname.size() > 0 ) {
-                    libraryname += s_filesep;
-                }
-                libraryname += string("lib");
-                libraryname += libraryfilename;
-                plibrary = _SysLoadLibrary(libraryname.c_str(),OPENRAVE_LAZY_LOADING);
+        if(( libraryfilename.size() > 3) &&( libraryfilename.substr(0,3) != string("lib")) ) {
+            libraryname = librarypath;
+            if( libraryname.size() > 0 ) {
+                libraryname += s_filesep;
+            }
+            libraryname += string("lib");
+            libraryname += libraryfilename;
+            if( _IsFile(libraryname) ) {
+                return libraryname;
             }
-#endif
         }
 #endif
+#endif
 
 #ifdef HAVE_BOOST_FILESYSTEM
-        if( plibrary == NULL ) {
-            // try adding from the current plugin libraries
-            FOREACH(itdir,_listplugindirs) {
-                string newlibraryname = boost::filesystem::absolute(libraryname,*itdir).string();
-                plibrary = _SysLoadLibrary(newlibraryname,OPENRAVE_LAZY_LOADING);
-                if( !!plibrary ) {
-                    libraryname = newlibraryname;
-                    break;
-                }
+        // try adding from the current plugin libraries
+        FOREACHC(itdir,_listplugindirs) {
+            string newlibraryname = boost::filesystem::absolute(libraryname,*itdir).string();
+            if( _IsFile(newlibraryname) ) {
+                return newlibraryname;
             }
         }
 #endif
+        return string();
+    }
+
+    PluginPtr _LoadPlugin(const string& _libraryname)
+    {
+        string libraryname = _FindLibraryFile(_libraryname);
+        void* plibrary = NULL;
+        if( libraryname.size() > 0 ) {
+            PluginPtr pmanifestplugin;
+            if( _LoadPluginFromManifest(libraryname, pmanifestplugin) ) {
+                return pmanifestplugin;
+            }
+            plibrary = _SysLoadLibrary(libraryname,OPENRAVE_LAZY_LOADING);
+        }
         if( plibrary == NULL ) {
             RAVELOG_WARN("failed to load: %s\n", _libraryname.c_str());
             return PluginPtr();
@@ -963,6 +1003,7 @@ protected:
             if( !p->Load_GetPluginAttributes() ) {
                 // might not be a plugin
                 RAVELOG_VERBOSE(str(boost::format("%s: can't load GetPluginAttributes function, might not be an OpenRAVE plugin\n")%libraryname));
+                _AddToManifest(libraryname, PluginPtr());
                 return PluginPtr();
             }
 
@@ -1005,9 +1046,205 @@ protected:
         }
 
         p->OnRaveInitialized(); // openrave runtime is most likely loaded already, so can safely initialize
+        _AddToManifest(libraryname, p);
         return p;
     }
 
+    /// \brief the manifest entry of one library
+    struct ManifestEntry
+    {
+        ManifestEntry() : filesize(0), modifiedtime(0), inode(0), bIsPlugin(false), bHasOnRaveInitialized(false) {
+        }
+        uint64_t filesize, modifiedtime, inode; ///< the stamp of the file when the entry was written
+        bool bIsPlugin; ///< false if the library does not export GetPluginAttributes
+        bool bHasOnRaveInitialized; ///< if true, the library is opened right away so that it can be initialized
+        PLUGININFO info;
+        std::map<InterfaceType, std::string> mapInterfaceHashes; ///< the interface hashes of info.interfacenames when the entry was written
+    };
+
+    static bool _IsFile(const std::string& filename)
+    {
+        return !!ifstream(filename.c_str());
+    }
+
+    /// \brief gets the size, modification time, and inode of the file, false if it cannot be read.
+    static bool _GetFileStamp(const std::string& filename, ManifestEntry& entry)
+    {
+#ifdef _WIN32
+        return false;
+#else
+        struct stat filestat;
+        if( stat(filename.c_str(), &filestat) != 0 ) {
+            return false;
+        }
+        entry.filesize = filestat.st_size;
+        entry.modifiedtime = filestat.st_mtime;
+        entry.inode = filestat.st_ino;
+        return true;
+#endif
+    }
+
+    /// \brief creates the plugin from its manifest entry without opening the library
+    ///
+    /// \param[out] p the plugin, empty if the manifest says that the library is not a plugin
+    /// \return true if the manifest has an up to date entry for the library
+    bool _LoadPluginFromManifest(const std::string& libraryname, PluginPtr& p)
+    {
+        if( _manifestfilename.size() == 0 ) {
+            return false;
+        }
+        std::map<std::string, ManifestEntry>::const_iterator itentry = _mapManifest.find(libraryname);
+        if( itentry == _mapManifest.end() ) {
+            return false;
+        }
+        const ManifestEntry& entry = itentry->second;
+        ManifestEntry filestamp;
+        if( !_GetFileStamp(libraryname, filestamp) || filestamp.filesize != entry.filesize || filestamp.modifiedtime != entry.modifiedtime || filestamp.inode != entry.inode ) {
+            return false;
+        }
+        FOREACHC(ithash, entry.mapInterfaceHashes) {
+            if( ithash->second != RaveGetInterfaceHash(ithash->first) ) {
+                return false;
+            }
+        }
+
+        if( !entry.bIsPlugin ) {
+            RAVELOG_VERBOSE_FORMAT("%s: manifest says it is not an OpenRAVE plugin", libraryname);
+            p.reset();
+            return true;
+        }
+        p.reset(new Plugin(shared_from_this()));
+        p->ppluginname = libraryname;
+        p->_infocached = entry.info;
+        p->_bInitializing = false;
+        p->_bLoadDeferred = true;
+        RAVELOG_DEBUG_FORMAT("loading plugin from manifest: %s", libraryname);
+        if( entry.bHasOnRaveInitialized ) {
+            p->_bLoadDeferred = false;
+            p->OnRaveInitialized();
+        }
+        return true;
+    }
+
+    /// \brief records the library in the manifest
+    ///
+    /// \param p the loaded plugin, or empty if the library is not a plugin
+    void _AddToManifest(const std::string& libraryname, PluginPtr p)
+    {
+        if( _manifestfilename.size() == 0 ) {
+            return;
+        }
+        ManifestEntry entry;
+        if( !_GetFileStamp(libraryname, entry) ) {
+            return;
+        }
+        entry.bIsPlugin = !!p;
+        if( !!p ) {
+            entry.bHasOnRaveInitialized = p->pfnOnRaveInitialized != NULL;
+            entry.info = p->_infocached;
+            FOREACHC(itnames, entry.info.interfacenames) {
+                entry.mapInterfaceHashes[itnames->first] = RaveGetInterfaceHash(itnames->first);
+            }
+        }
+        _mapManifest[libraryname] = entry;
+        _bManifestModified = true;
+    }
+
+    /// \brief reads _manifestfilename into _mapManifest, ignores it if it was written by a different plugin info version
+    ///
+    /// The first line is the header, then every library has its path on one line followed by
+    /// "filesize modifiedtime inode isplugin hasonraveinitialized version numtypes" and one
+    /// "type hash numnames names..." line for every interface type it offers.
+    void _ReadManifest()
+    {
+        _mapManifest.clear();
+        ifstream f(_manifestfilename.c_str());
+        if( !f ) {
+            return;
+        }
+        std::string header, version, plugininfohash;
+        f >> header >> version >> plugininfohash;
+        if( header != "openrave_plugin_manifest" || version != "1" || plugininfohash != OPENRAVE_PLUGININFO_HASH ) {
+            RAVELOG_DEBUG_FORMAT("ignoring plugin manifest %s written by a different version", _manifestfilename);
+            return;
+        }
+        std::string libraryname;
+        std::getline(f, libraryname); // rest of the header line
+        while( !!std::getline(f, libraryname) ) {
+            if( libraryname.size() == 0 ) {
+                continue;
+            }
+            ManifestEntry entry;
+            int numtypes = 0;
+            f >> entry.filesize >> entry.modifiedtime >> entry.inode >> entry.bIsPlugin >> entry.bHasOnRaveInitialized >> entry.info.version >> numtypes;
+            for(int itype = 0; itype < numtypes && !!f; ++itype) {
+                int type = 0, numnames = 0;
+                std::string hash;
+                f >> type >> hash >> numnames;
+                entry.mapInterfaceHashes[(InterfaceType)type] = hash;
+                std::vector<std::string>& vnames = entry.info.interfacenames[(InterfaceType)type];
+                vnames.resize(std::max(0, numnames));
+                FOREACH(itname, vnames) {
+                    f >> *itname;
+                }
+            }
+            if( !f ) {
+                RAVELOG_WARN_FORMAT("plugin manifest %s is corrupted, ignoring it", _manifestfilename);
+                _mapManifest.clear();
+                return;
+            }
+            std::getline(f, header); // rest of the last line
+            _mapManifest[libraryname] = entry;
+        }
+        RAVELOG_VERBOSE_FORMAT("read %d libraries from plugin manifest %s", _mapManifest.size()%_manifestfilename);
+    }
+
+    /// \brief writes _mapManifest if it changed, entries of libraries not in the current plugin directories are kept
+    ///
+    /// The manifest is first written to a temporary file and then renamed, so concurrent processes never read a partial file.
+    void _WriteManifest()
+    {
+#ifndef _WIN32
+        if( _manifestfilename.size() == 0 || !_bManifestModified ) {
+            return;
+        }
+        std::string tempfilename = str(boost::format("%s.%d")%_manifestfilename%getpid());
+        {
+            ofstream f(tempfilename.c_str());
+            if( !f ) {
+                RAVELOG_DEBUG_FORMAT("cannot write plugin manifest %s", tempfilename);
+                return;
+            }
+            f << "openrave_plugin_manifest 1 " << OPENRAVE_PLUGININFO_HASH << endl;
+            FOREACHC(itentry, _mapManifest) {
+                const ManifestEntry& entry = itentry->second;
+                f << itentry->first << endl;
+                f << entry.filesize << " " << entry.modifiedtime << " " << entry.inode << " " << entry.bIsPlugin << " " << entry.bHasOnRaveInitialized << " " << entry.info.version << " " << entry.info.interfacenames.size() << endl;
+                FOREACHC(itnames, entry.info.interfacenames) {
+                    std::map<InterfaceType, std::string>::const_iterator ithash = entry.mapInterfaceHashes.find(itnames->first);
+                    f << (int)itnames->first << " " << (ithash != entry.mapInterfaceHashes.end() ? ithash->second : std::string("none")) << " " << itnames->second.size();
+                    FOREACHC(itname, itnames->second) {
+                        f << " " << *itname;
+                    }
+                    f << endl;
+                }
+            }
+            if( !f ) {
+                RAVELOG_DEBUG_FORMAT("failed to write plugin manifest %s", tempfilename);
+                f.close();
+                std::remove(tempfilename.c_str());
+                return;
+            }
+        }
+        if( std::rename(tempfilename.c_str(), _manifestfilename.c_str()) != 0 ) {
+            RAVELOG_DEBUG_FORMAT("failed to rename plugin manifest to %s", _manifestfilename);
+            std::remove(tempfilename.c_str());
+            return;
+        }
+        _bManifestModified = false;
+#endif
+    }
+
     static void* _SysLoadLibrary(const std::string& lib, bool bLazy=false)
     {
         // check if file exists first
@@ -1131,6 +1368,13 @@ protected:
     std::list< boost::weak_ptr<RegisteredInterface> > _listRegisteredInterfaces;
     std::list<std::string> _listplugindirs;
 
+    /// \name plugin manifest, protected by _mutex
+    //@{
+    std::string _manifestfilename; ///< empty if the manifest is not used
+    std::map<std::string, ManifestEntry> _mapManifest; ///< indexed by the library file
+    bool _bManifestModified; ///< true if _mapManifest has to be written
+    //@}
+
     /// \name plugin loading
     //@{
     mutable boost::mutex _mutexPluginLoader;     ///< specifically for loading shared objects
@@ -0,0 +1,205 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "libopenrave.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define OPENRAVE_GETPID _getpid
+#else
+#include <unistd.h>
+#define OPENRAVE_GETPID getpid
+#endif
+
+namespace OpenRAVE {
+
+std::atomic<bool> g_bRaveProfilingEnabled(false);
+
+namespace {
+
+/// \brief the maximum number of spans a thread records, after that the spans are dropped so memory stays bounded
+static const size_t s_nMaxSpansPerThread = 1<<20;
+
+struct ProfilingSpanData
+{
+    const char* category;
+    const char* name;
+    uint64_t starttime, duration;
+};
+
+/// \brief the spans of one thread, only locked by the thread itself and when exporting
+struct ProfilingThreadBuffer
+{
+    ProfilingThreadBuffer(int threadid) : _threadid(threadid), _numdropped(0) {
+        _vspans.reserve(1024);
+    }
+
+    boost::mutex _mutex;
+    std::vector<ProfilingSpanData> _vspans;
+    int _threadid; ///< sequential id of the thread in the trace
+    size_t _numdropped;
+};
+
+typedef boost::shared_ptr<ProfilingThreadBuffer> ProfilingThreadBufferPtr;
+
+/// \brief keeps the buffers of all threads, even of threads that have exited, so their spans can be exported
+struct ProfilingRegistry
+{
+    ProfilingRegistry() : _nextthreadid(1) {
+    }
+
+    boost::mutex _mutex;
+    std::vector<ProfilingThreadBufferPtr> _vbuffers;
+    int _nextthreadid;
+};
+
+static ProfilingRegistry& GetProfilingRegistry()
+{
+    static ProfilingRegistry s_registry;
+    return s_registry;
+}
+
+static ProfilingThreadBuffer& GetProfilingThreadBuffer()
+{
+    static thread_local ProfilingThreadBufferPtr s_pbuffer;
+    if( !s_pbuffer ) {
+        ProfilingRegistry& registry = GetProfilingRegistry();
+        boost::mutex::scoped_lock lock(registry._mutex);
+        s_pbuffer.reset(new ProfilingThreadBuffer(registry._nextthreadid++));
+        registry._vbuffers.push_back(s_pbuffer);
+    }
+    return *s_pbuffer;
+}
+
+static void WriteJSONString(std::ostream& O, const char* s)
+{
+    O << '"';
+    for(; *s != 0; ++s) {
+        switch(*s) {
+        case '"': O << "\\\""; break;
+        case '\\': O << "\\\\"; break;
+        case '\n': O << "\\n"; break;
+        case '\t': O << "\\t"; break;
+        default:
+            if( (unsigned char)*s < 0x20 ) {
+                O << ' ';
+            }
+            else {
+                O << *s;
+            }
+        }
+    }
+    O << '"';
+}
+
+} // end namespace
+
+void ProfilingSpan::_Start()
+{
+    _brecording = true;
+    _starttime = utils::GetNanoPerformanceTime();
+}
+
+void ProfilingSpan::_Stop()
+{
+    uint64_t endtime = utils::GetNanoPerformanceTime();
+    ProfilingThreadBuffer& buffer = GetProfilingThreadBuffer();
+    boost::mutex::scoped_lock lock(buffer._mutex);
+    if( buffer._vspans.size() >= s_nMaxSpansPerThread ) {
+        ++buffer._numdropped;
+        return;
+    }
+    ProfilingSpanData span;
+    span.category = _category;
+    span.name = _name;
+    span.starttime = _starttime;
+    span.duration = endtime - _starttime;
+    buffer._vspans.push_back(span);
+}
+
+void RaveSetProfilingEnabled(bool bEnable)
+{
+    g_bRaveProfilingEnabled.store(bEnable, std::memory_order_relaxed);
+}
+
+void RaveClearProfilingSpans()
+{
+    ProfilingRegistry& registry = GetProfilingRegistry();
+    boost::mutex::scoped_lock lock(registry._mutex);
+    FOREACH(itbuffer, registry._vbuffers) {
+        boost::mutex::scoped_lock lockbuffer((*itbuffer)->_mutex);
+        (*itbuffer)->_vspans.clear();
+        (*itbuffer)->_numdropped = 0;
+    }
+}
+
+void RaveWriteProfilingChromeTrace(std::ostream& O)
+{
+    int pid = OPENRAVE_GETPID();
+    std::vector<ProfilingThreadBufferPtr> vbuffers;
+    {
+        ProfilingRegistry& registry = GetProfilingRegistry();
+        boost::mutex::scoped_lock lock(registry._mutex);
+        vbuffers = registry._vbuffers;
+    }
+
+    O << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool bfirst = true;
+    std::vector<ProfilingSpanData> vspans;
+    FOREACH(itbuffer, vbuffers) {
+        size_t numdropped;
+        {
+            boost::mutex::scoped_lock lockbuffer((*itbuffer)->_mutex);
+            vspans = (*itbuffer)->_vspans;
+            numdropped = (*itbuffer)->_numdropped;
+        }
+        if( vspans.size() == 0 ) {
+            continue;
+        }
+        int tid = (*itbuffer)->_threadid;
+        if( !bfirst ) {
+            O << ",";
+        }
+        bfirst = false;
+        O << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        if( numdropped > 0 ) {
+            RAVELOG_WARN_FORMAT("thread %d dropped %d profiling spans since it recorded more than %d", tid%numdropped%s_nMaxSpansPerThread);
+        }
+        FOREACHC(itspan, vspans) {
+            // chrome expects microseconds
+            O << ",\n{\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"cat\":";
+            WriteJSONString(O, itspan->category);
+            O << ",\"name\":";
+            WriteJSONString(O, itspan->name);
+            O << ",\"ts\":" << (itspan->starttime/1000) << "." << std::setw(3) << std::setfill('0') << (itspan->starttime%1000);
+            O << ",\"dur\":" << (itspan->duration/1000) << "." << std::setw(3) << std::setfill('0') << (itspan->duration%1000) << "}";
+        }
+    }
+    O << "\n]}\n";
+}
+
+bool RaveSaveProfilingChromeTrace(const std::string& filename)
+{
+    std::ofstream f(filename.c_str());
+    if( !f ) {
+        RAVELOG_WARN_FORMAT("failed to open %s for writing the profiling trace", filename);
+        return false;
+    }
+    RaveWriteProfilingChromeTrace(f);
+    return !!f;
+}
+
+} // end namespace OpenRAVE
@@ -378,6 +378,7 @@ RobotBase::RobotBase(EnvironmentBasePtr penv) : KinBody(PT_Robot, penv)
 {
     _nAffineDOFs = 0;
     _nActiveDOF = -1;
+    _bActiveDOFIndicesIdentity = true;
     vActvAffineRotationAxis = Vector(0,0,1);
 
     //set limits for the affine DOFs
@@ -421,6 +422,7 @@ void RobotBase::Destroy()
     _vecConnectedBodies.clear();
     _nActiveDOF = 0;
     _vActiveDOFIndices.resize(0);
+    _UpdateActiveDOFMapping();
     _vAllDOFIndices.resize(0);
     SetController(ControllerBasePtr(),std::vector<int>(),0);
 
@@ -484,7 +486,12 @@ void RobotBase::SetName(const std::string& newname)
 
 void RobotBase::SetDOFValues(const std::vector<dReal>& vJointValues, uint32_t bCheckLimits, const std::vector<int>& dofindices)
 {
-    KinBody::SetDOFValues(vJointValues, bCheckLimits,dofindices);
+    KinBody::SetDOFValues(vJointValues, bCheckLimits,dofindices); // calls the array version, so no need to update attached sensors
+}
+
+void RobotBase::SetDOFValues(const dReal* pJointValues, size_t dof, uint32_t bCheckLimits, const std::vector<int>& dofindices)
+{
+    KinBody::SetDOFValues(pJointValues, dof, bCheckLimits, dofindices);
     _UpdateAttachedSensors();
 }
 
@@ -493,6 +500,11 @@ void RobotBase::SetDOFValues(const std::vector<dReal>& vJointValues, const Trans
     KinBody::SetDOFValues(vJointValues, transbase, bCheckLimits); // should call RobotBase::SetDOFValues, so no need to upgrade grabbed bodies, attached sensors
 }
 
+void RobotBase::SetDOFValues(const dReal* pJointValues, size_t dof, const Transform& transbase, uint32_t bCheckLimits)
+{
+    KinBody::SetDOFValues(pJointValues, dof, transbase, bCheckLimits); // should call RobotBase::SetDOFValues, so no need to upgrade grabbed bodies, attached sensors
+}
+
 void RobotBase::SetLinkTransformations(const std::vector<Transform>& transforms)
 {
     KinBody::SetLinkTransformations(transforms);
@@ -685,6 +697,7 @@ void RobotBase::SetActiveDOFs(const std::vector<int>& vJointIndices, int nAffine
     }
     if( bactivedofchanged ) {
         _vActiveDOFIndices = vJointIndices;
+        _UpdateActiveDOFMapping();
     }
 
     if( _nAffineDOFs != nAffineDOFBitmask ) {
@@ -723,6 +736,17 @@ void RobotBase::SetActiveDOFs(const std::vector<int>& vJointIndices, int nAffine
     }
 }
 
+void RobotBase::_UpdateActiveDOFMapping()
+{
+    _bActiveDOFIndicesIdentity = true;
+    for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
+        if( _vActiveDOFIndices[i] != (int)i ) {
+            _bActiveDOFIndicesIdentity = false;
+            break;
+        }
+    }
+}
+
 void RobotBase::SetActiveDOFValues(const std::vector<dReal>& values, uint32_t bCheckLimits)
 {
     if(_nActiveDOF < 0) {
@@ -730,11 +754,23 @@ void RobotBase::SetActiveDOFValues(const std::vector<dReal>& values, uint32_t bC
         return;
     }
     OPENRAVE_ASSERT_OP_FORMAT((int)values.size(),>=,GetActiveDOF(), "not enough values %d<%d",values.size()%GetActiveDOF(),ORE_InvalidArguments);
+    SetActiveDOFValues(values.size() > 0 ? &values[0] : NULL, values.size(), bCheckLimits);
+}
+
+void RobotBase::SetActiveDOFValues(const dReal* pvalues, size_t dof, uint32_t bCheckLimits)
+{
+    if(_nActiveDOF < 0) {
+        SetDOFValues(pvalues,dof,bCheckLimits);
+        return;
+    }
+    OPENRAVE_ASSERT_OP_FORMAT((int)dof,>=,GetActiveDOF(), "not enough values %d<%d",dof%GetActiveDOF(),ORE_InvalidArguments);
 
     Transform t;
     if( (int)_vActiveDOFIndices.size() < _nActiveDOF ) {
         t = GetTransform();
-        RaveGetTransformFromAffineDOFValues(t, values.begin()+_vActiveDOFIndices.size(),_nAffineDOFs,vActvAffineRotationAxis);
+        _vTempActiveAffineValues.resize(_nActiveDOF-_vActiveDOFIndices.size());
+        std::copy(pvalues+_vActiveDOFIndices.size(), pvalues+_nActiveDOF, _vTempActiveAffineValues.begin());
+        RaveGetTransformFromAffineDOFValues(t, _vTempActiveAffineValues.begin(),_nAffineDOFs,vActvAffineRotationAxis);
         if( _nAffineDOFs & OpenRAVE::DOF_RotationQuat ) {
             t.rot = quatMultiply(_vRotationQuatLimitStart, t.rot);
         }
@@ -744,15 +780,23 @@ void RobotBase::SetActiveDOFValues(const std::vector<dReal>& values, uint32_t bC
     }
 
     if( _vActiveDOFIndices.size() > 0 ) {
-        GetDOFValues(_vTempRobotJoints);
-        for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
-            _vTempRobotJoints[_vActiveDOFIndices[i]] = values[i];
+        int dofrobot = GetDOF();
+        const dReal* pjointvalues = pvalues;
+        if( !_bActiveDOFIndicesIdentity || (int)_vActiveDOFIndices.size() != dofrobot ) {
+            // only some of the joints are active, so start from the current values
+            _vTempRobotJoints.resize(dofrobot);
+            const dReal* pcurvalues = GetDOFValuesArray();
+            std::copy(pcurvalues, pcurvalues+dofrobot, _vTempRobotJoints.begin());
+            for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
+                _vTempRobotJoints[_vActiveDOFIndices[i]] = pvalues[i];
+            }
+            pjointvalues = &_vTempRobotJoints[0];
         }
         if( (int)_vActiveDOFIndices.size() < _nActiveDOF ) {
-            SetDOFValues(_vTempRobotJoints, t, bCheckLimits);
+            SetDOFValues(pjointvalues, dofrobot, t, bCheckLimits);
         }
         else {
-            SetDOFValues(_vTempRobotJoints, bCheckLimits);
+            SetDOFValues(pjointvalues, dofrobot, bCheckLimits);
         }
     }
 }
@@ -768,11 +812,20 @@ void RobotBase::GetActiveDOFValues(std::vector<dReal>& values) const
     if( values.size() == 0 ) {
         return;
     }
-    vector<dReal>::iterator itvalues = values.begin();
+    GetActiveDOFValues(&values[0]);
+}
+
+void RobotBase::GetActiveDOFValues(dReal* pvalues) const
+{
+    if( _nActiveDOF < 0 ) {
+        GetDOFValues(pvalues);
+        return;
+    }
+
     if( _vActiveDOFIndices.size() != 0 ) {
-        GetDOFValues(_vTempRobotJoints);
-        FOREACHC(it, _vActiveDOFIndices) {
-            *itvalues++ = _vTempRobotJoints[*it];
+        const dReal* pcurvalues = GetDOFValuesArray();
+        for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
+            pvalues[i] = pcurvalues[_vActiveDOFIndices[i]];
         }
     }
 
@@ -783,7 +836,9 @@ void RobotBase::GetActiveDOFValues(std::vector<dReal>& values) const
     if( _nAffineDOFs & OpenRAVE::DOF_RotationQuat ) {
         t.rot = quatMultiply(quatInverse(_vRotationQuatLimitStart), t.rot);
     }
-    RaveGetAffineDOFValuesFromTransform(itvalues,t,_nAffineDOFs,vActvAffineRotationAxis);
+    _vTempActiveAffineValues.resize(_nActiveDOF-_vActiveDOFIndices.size());
+    RaveGetAffineDOFValuesFromTransform(_vTempActiveAffineValues.begin(),t,_nAffineDOFs,vActvAffineRotationAxis);
+    std::copy(_vTempActiveAffineValues.begin(), _vTempActiveAffineValues.end(), pvalues+_vActiveDOFIndices.size());
 }
 
 void RobotBase::SetActiveDOFVelocities(const std::vector<dReal>& velocities, uint32_t bCheckLimits)
@@ -1261,10 +1316,9 @@ void RobotBase::CalculateActiveJacobian(int index, const Vector& offset, vector<
             return;
         }
         // have to copy
-        std::vector<dReal> vjacobianjoints;
-        ComputeJacobianTranslation(index, offset, vjacobianjoints, _vActiveDOFIndices);
+        ComputeJacobianTranslation(index, offset, _vTempActiveJacobian, _vActiveDOFIndices);
         for(size_t i = 0; i < 3; ++i) {
-            std::copy(vjacobianjoints.begin()+i*_vActiveDOFIndices.size(),vjacobianjoints.begin()+(i+1)*_vActiveDOFIndices.size(),vjacobian.begin()+i*dofstride);
+            std::copy(_vTempActiveJacobian.begin()+i*_vActiveDOFIndices.size(),_vTempActiveJacobian.begin()+(i+1)*_vActiveDOFIndices.size(),vjacobian.begin()+i*dofstride);
         }
     }
 
@@ -1371,11 +1425,10 @@ void RobotBase::CalculateActiveJacobian(int linkindex, const Vector& offset, boo
         CalculateJacobian(linkindex, offset, mjacobian);
         return;
     }
-    std::vector<dReal> vjacobian;
-    RobotBase::CalculateActiveJacobian(linkindex,offset,vjacobian);
-    OPENRAVE_ASSERT_OP((int)vjacobian.size(),==,3*GetActiveDOF());
+    RobotBase::CalculateActiveJacobian(linkindex,offset,_vTempActiveJacobianMatrix);
+    OPENRAVE_ASSERT_OP((int)_vTempActiveJacobianMatrix.size(),==,3*GetActiveDOF());
     mjacobian.resize(boost::extents[3][GetActiveDOF()]);
-    vector<dReal>::const_iterator itsrc = vjacobian.begin();
+    vector<dReal>::const_iterator itsrc = _vTempActiveJacobianMatrix.begin();
     FOREACH(itdst,mjacobian) {
         std::copy(itsrc,itsrc+GetActiveDOF(),itdst->begin());
         itsrc += GetActiveDOF();
@@ -1391,13 +1444,13 @@ void RobotBase::CalculateActiveRotationJacobian(int index, const Vector& q, std:
     int dofstride = GetActiveDOF();
     vjacobian.resize(4*dofstride);
     if( _vActiveDOFIndices.size() != 0 ) {
-        std::vector<dReal> vjacobianjoints;
-        CalculateRotationJacobian(index, q, vjacobianjoints);
+        CalculateRotationJacobian(index, q, _vTempActiveJacobian);
+        int dofrobot = GetDOF();
         for(size_t i = 0; i < _vActiveDOFIndices.size(); ++i) {
-            vjacobian[i] = vjacobianjoints[_vActiveDOFIndices[i]];
-            vjacobian[dofstride+i] = vjacobianjoints[GetDOF()+_vActiveDOFIndices[i]];
-            vjacobian[2*dofstride+i] = vjacobianjoints[2*GetDOF()+_vActiveDOFIndices[i]];
-            vjacobian[3*dofstride+i] = vjacobianjoints[3*GetDOF()+_vActiveDOFIndices[i]];
+            vjacobian[i] = _vTempActiveJacobian[_vActiveDOFIndices[i]];
+            vjacobian[dofstride+i] = _vTempActiveJacobian[dofrobot+_vActiveDOFIndices[i]];
+            vjacobian[2*dofstride+i] = _vTempActiveJacobian[2*dofrobot+_vActiveDOFIndices[i]];
+            vjacobian[3*dofstride+i] = _vTempActiveJacobian[3*dofrobot+_vActiveDOFIndices[i]];
         }
     }
 
@@ -1451,11 +1504,10 @@ void RobotBase::CalculateActiveRotationJacobian(int linkindex, const Vector& q,
         CalculateRotationJacobian(linkindex, q, mjacobian);
         return;
     }
-    std::vector<dReal> vjacobian;
-    RobotBase::CalculateActiveRotationJacobian(linkindex,q,vjacobian);
-    OPENRAVE_ASSERT_OP((int)vjacobian.size(),==,4*GetActiveDOF());
+    RobotBase::CalculateActiveRotationJacobian(linkindex,q,_vTempActiveJacobianMatrix);
+    OPENRAVE_ASSERT_OP((int)_vTempActiveJacobianMatrix.size(),==,4*GetActiveDOF());
     mjacobian.resize(boost::extents[4][GetActiveDOF()]);
-    vector<dReal>::const_iterator itsrc = vjacobian.begin();
+    vector<dReal>::const_iterator itsrc = _vTempActiveJacobianMatrix.begin();
     FOREACH(itdst,mjacobian) {
         std::copy(itsrc,itsrc+GetActiveDOF(),itdst->begin());
         itsrc += GetActiveDOF();
@@ -1477,10 +1529,9 @@ void RobotBase::CalculateActiveAngularVelocityJacobian(int index, std::vector<dR
             return;
         }
         // have to copy
-        std::vector<dReal> vjacobianjoints;
-        ComputeJacobianAxisAngle(index, vjacobianjoints, _vActiveDOFIndices);
+        ComputeJacobianAxisAngle(index, _vTempActiveJacobian, _vActiveDOFIndices);
         for(size_t i = 0; i < 3; ++i) {
-            std::copy(vjacobianjoints.begin()+i*_vActiveDOFIndices.size(),vjacobianjoints.begin()+(i+1)*_vActiveDOFIndices.size(),vjacobian.begin()+i*dofstride);
+            std::copy(_vTempActiveJacobian.begin()+i*_vActiveDOFIndices.size(),_vTempActiveJacobian.begin()+(i+1)*_vActiveDOFIndices.size(),vjacobian.begin()+i*dofstride);
         }
     }
 
@@ -1545,11 +1596,10 @@ void RobotBase::CalculateActiveAngularVelocityJacobian(int linkindex, boost::mul
         CalculateAngularVelocityJacobian(linkindex, mjacobian);
         return;
     }
-    std::vector<dReal> vjacobian;
-    CalculateActiveAngularVelocityJacobian(linkindex,vjacobian);
-    OPENRAVE_ASSERT_OP((int)vjacobian.size(),==,3*GetActiveDOF());
+    CalculateActiveAngularVelocityJacobian(linkindex,_vTempActiveJacobianMatrix);
+    OPENRAVE_ASSERT_OP((int)_vTempActiveJacobianMatrix.size(),==,3*GetActiveDOF());
     mjacobian.resize(boost::extents[3][GetActiveDOF()]);
-    vector<dReal>::const_iterator itsrc = vjacobian.begin();
+    vector<dReal>::const_iterator itsrc = _vTempActiveJacobianMatrix.begin();
     FOREACH(itdst,mjacobian) {
         std::copy(itsrc,itsrc+GetActiveDOF(),itdst->begin());
         itsrc += GetActiveDOF();
@@ -2041,6 +2091,7 @@ void RobotBase::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
     _UpdateAttachedSensors();
 
     _vActiveDOFIndices = r->_vActiveDOFIndices;
+    _bActiveDOFIndicesIdentity = r->_bActiveDOFIndicesIdentity;
     _activespec = r->_activespec;
     _vAllDOFIndices = r->_vAllDOFIndices;
     vActvAffineRotationAxis = r->vActvAffineRotationAxis;
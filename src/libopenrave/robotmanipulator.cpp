@@ -215,6 +215,7 @@ bool RobotBase::Manipulator::FindIKSolution(const IkParameterization& goal, vect
 
 bool RobotBase::Manipulator::FindIKSolution(const IkParameterization& goal, const std::vector<dReal>& vFreeParameters, vector<dReal>& solution, int filteroptions) const
 {
+    OPENRAVE_PROFILE_SCOPE("ik", "FindIKSolution");
     IkSolverBasePtr pIkSolver = GetIkSolver();
     OPENRAVE_ASSERT_FORMAT(!!pIkSolver, "manipulator %s:%s does not have an IK solver set",RobotBasePtr(__probot)->GetName()%GetName(),ORE_Failed);
     RobotBasePtr probot = GetRobot();
@@ -242,6 +243,7 @@ bool RobotBase::Manipulator::FindIKSolutions(const IkParameterization& goal, std
 
 bool RobotBase::Manipulator::FindIKSolutions(const IkParameterization& goal, const std::vector<dReal>& vFreeParameters, std::vector<std::vector<dReal> >& solutions, int filteroptions) const
 {
+    OPENRAVE_PROFILE_SCOPE("ik", "FindIKSolutions");
     IkSolverBasePtr pIkSolver = GetIkSolver();
     OPENRAVE_ASSERT_FORMAT(!!pIkSolver, "manipulator %s:%s does not have an IK solver set",RobotBasePtr(__probot)->GetName()%GetName(),ORE_Failed);
     BOOST_ASSERT(pIkSolver->GetManipulator() == shared_from_this() );
@@ -263,6 +265,7 @@ bool RobotBase::Manipulator::FindIKSolution(const IkParameterization& goal, int
 
 bool RobotBase::Manipulator::FindIKSolution(const IkParameterization& goal, const std::vector<dReal>& vFreeParameters, int filteroptions, IkReturnPtr ikreturn) const
 {
+    OPENRAVE_PROFILE_SCOPE("ik", "FindIKSolution");
     IkSolverBasePtr pIkSolver = GetIkSolver();
     OPENRAVE_ASSERT_FORMAT(!!pIkSolver, "manipulator %s:%s does not have an IK solver set",RobotBasePtr(__probot)->GetName()%GetName(),ORE_Failed);
     RobotBasePtr probot = GetRobot();
@@ -289,6 +292,7 @@ bool RobotBase::Manipulator::FindIKSolutions(const IkParameterization& goal, int
 
 bool RobotBase::Manipulator::FindIKSolutions(const IkParameterization& goal, const std::vector<dReal>& vFreeParameters, int filteroptions, std::vector<IkReturnPtr>& vikreturns) const
 {
+    OPENRAVE_PROFILE_SCOPE("ik", "FindIKSolutions");
     IkSolverBasePtr pIkSolver = GetIkSolver();
     OPENRAVE_ASSERT_FORMAT(!!pIkSolver, "manipulator %s:%s does not have an IK solver set",RobotBasePtr(__probot)->GetName()%GetName(),ORE_Failed);
     BOOST_ASSERT(pIkSolver->GetManipulator() == shared_from_this() );
@@ -821,15 +825,50 @@ bool RobotBase::Manipulator::CheckEndEffectorCollision(CollisionReportPtr report
     return bincollision;
 }
 
-bool RobotBase::Manipulator::CheckEndEffectorCollision(const Transform& tEE, CollisionReportPtr report) const
+void RobotBase::Manipulator::_GetEndEffectorCollisionLinkIndices(RobotBasePtr probot, std::vector<int>& vlinkindices) const
 {
-    RobotBasePtr probot(__probot);
-    Transform toldEE = GetTransform();
-    Transform tdelta = tEE*toldEE.inverse();
+    vlinkindices.resize(0);
     // get all child links of the manipualtor
     int iattlink = __pEffector->GetIndex();
     vector<LinkPtr> vattachedlinks;
     __pEffector->GetRigidlyAttachedLinks(vattachedlinks);
+    FOREACHC(itlink,vattachedlinks) {
+        vlinkindices.push_back((*itlink)->GetIndex());
+    }
+    size_t numattachedlinks = vlinkindices.size();
+    FOREACHC(itlink, probot->GetLinks()) {
+        int ilink = (*itlink)->GetIndex();
+        if((ilink == iattlink)|| !(*itlink)->IsEnabled() ) {
+            continue;
+        }
+        // gripper needs to be affected by all joints
+        bool bGripperLink = true;
+        FOREACHC(itarmdof,__varmdofindices) {
+            if( !probot->DoesAffect(probot->GetJointFromDOFIndex(*itarmdof)->GetJointIndex(),ilink) ) {
+                bGripperLink = false;
+                break;
+            }
+        }
+        if( !bGripperLink ) {
+            continue;
+        }
+        // if the link is affected by a joint not affecting the end effector, it is a gripper link. if it is not affected
+        // by any of the joints, perhaps there could be passive joints that are attached to the end effector that are
+        // non-static. if a link is affected by all the joints in the chain, then it is most likely a child just by the
+        // fact that all the arm joints affect it. either way it has to be checked once.
+        if( find(vlinkindices.begin(), vlinkindices.begin()+numattachedlinks, ilink) == vlinkindices.begin()+numattachedlinks ) {
+            vlinkindices.push_back(ilink);
+        }
+    }
+}
+
+bool RobotBase::Manipulator::CheckEndEffectorCollision(const Transform& tEE, CollisionReportPtr report) const
+{
+    RobotBasePtr probot(__probot);
+    Transform toldEE = GetTransform();
+    Transform tdelta = tEE*toldEE.inverse();
+    vector<int> vlinkindices;
+    _GetEndEffectorCollisionLinkIndices(probot, vlinkindices);
 
     CollisionCheckerBasePtr pchecker = probot->GetEnv()->GetCollisionChecker();
     bool bAllLinkCollisions = !!(pchecker->GetCollisionOptions()&CO_AllLinkCollisions);
@@ -840,57 +879,104 @@ bool RobotBase::Manipulator::CheckEndEffectorCollision(const Transform& tEE, Col
     }
 
     bool bincollision = false;
-
-    FOREACHC(itlink,vattachedlinks) {
-        if( probot->CheckLinkCollision((*itlink)->GetIndex(),tdelta*(*itlink)->GetTransform(),report) ) {
+    FOREACHC(itlinkindex, vlinkindices) {
+        if( probot->CheckLinkCollision(*itlinkindex,tdelta*probot->GetLinks()[*itlinkindex]->GetTransform(),report) ) {
             if( !bAllLinkCollisions ) { // if checking all collisions, have to continue
                 return true;
             }
             bincollision = true;
         }
     }
-    FOREACHC(itlink, probot->GetLinks()) {
-        int ilink = (*itlink)->GetIndex();
-        if((ilink == iattlink)|| !(*itlink)->IsEnabled() ) {
-            continue;
+    return bincollision;
+}
+
+int RobotBase::Manipulator::CheckEndEffectorCollisions(const std::vector<Transform>& vtEE, std::vector<uint8_t>& vincollision) const
+{
+    RobotBasePtr probot(__probot);
+    vincollision.resize(vtEE.size());
+    std::fill(vincollision.begin(), vincollision.end(), 0);
+    if( vtEE.size() == 0 ) {
+        return 0;
+    }
+
+    vector<int> vlinkindices;
+    _GetEndEffectorCollisionLinkIndices(probot, vlinkindices);
+    vector<LinkPtr> vlinks(vlinkindices.size());
+    vector<Transform> vlinktransforms(vlinkindices.size());
+    for(size_t i = 0; i < vlinkindices.size(); ++i) {
+        vlinks[i] = probot->GetLinks().at(vlinkindices[i]);
+        vlinktransforms[i] = vlinks[i]->GetTransform();
+    }
+
+    int numincollision = 0;
+    // bodies grabbed by the gripper move with it, so they need the full CheckLinkCollision
+    bool bGrabbing = false;
+    std::vector<KinBodyPtr> vgrabbed;
+    probot->GetGrabbed(vgrabbed);
+    FOREACHC(itgrabbed, vgrabbed) {
+        if( find(vlinks.begin(), vlinks.end(), probot->IsGrabbing(**itgrabbed)) != vlinks.end() ) {
+            bGrabbing = true;
+            break;
         }
-        // gripper needs to be affected by all joints
-        bool bGripperLink = true;
-        FOREACHC(itarmdof,__varmdofindices) {
-            if( !probot->DoesAffect(probot->GetJointFromDOFIndex(*itarmdof)->GetJointIndex(),ilink) ) {
-                bGripperLink = false;
-                break;
+    }
+    if( bGrabbing ) {
+        for(size_t ipose = 0; ipose < vtEE.size(); ++ipose) {
+            if( CheckEndEffectorCollision(vtEE[ipose]) ) {
+                vincollision[ipose] = 1;
+                ++numincollision;
             }
         }
-        if( !bGripperLink ) {
-            continue;
-        }
+        return numincollision;
+    }
 
-        bool bIsAffected = false;
-        for(size_t ijoint = 0; ijoint < probot->GetJoints().size(); ++ijoint) {
-            if( probot->DoesAffect(ijoint,ilink) && !probot->DoesAffect(ijoint,iattlink) ) {
-                bIsAffected = true;
-                if( probot->CheckLinkCollision(ilink,tdelta*(*itlink)->GetTransform(),report) ) {
-                    if( !bAllLinkCollisions ) { // if checking all collisions, have to continue
-                        return true;
-                    }
-                    bincollision = true;
-                }
+    // all the gripper links are moved together, the link checks ignore the robot so the links cannot collide with each other
+    CollisionCheckerBasePtr pchecker = probot->GetEnv()->GetCollisionChecker();
+    Transform tinvEE = GetTransform().inverse();
+    std::vector< boost::shared_ptr< TransformSaver<LinkPtr> > > vlinksavers(vlinks.size());
+    for(size_t i = 0; i < vlinks.size(); ++i) {
+        vlinksavers[i].reset(new TransformSaver<LinkPtr>(vlinks[i]));
+    }
+    for(size_t ipose = 0; ipose < vtEE.size(); ++ipose) {
+        Transform tdelta = vtEE[ipose]*tinvEE;
+        for(size_t i = 0; i < vlinks.size(); ++i) {
+            vlinks[i]->SetTransform(tdelta*vlinktransforms[i]);
+        }
+        for(size_t i = 0; i < vlinks.size(); ++i) {
+            if( vlinks[i]->IsEnabled() && pchecker->CheckCollision(LinkConstPtr(vlinks[i])) ) {
+                vincollision[ipose] = 1;
+                ++numincollision;
                 break;
             }
         }
+    }
+    return numincollision;
+}
 
-        if( !bIsAffected ) {
-            // link is not affected by any of the joints, perhaps there could be passive joints that are attached to the end effector that are non-static. if a link is affected by all the joints in the chain, then it is most likely a child just by the fact that all the arm joints affect it.
-            if( probot->CheckLinkCollision(ilink,tdelta*(*itlink)->GetTransform(),report) ) {
-                if( !bAllLinkCollisions ) { // if checking all collisions, have to continue
-                    return true;
-                }
-                bincollision = true;
-            }
+int RobotBase::Manipulator::CheckEndEffectorCollisions(const std::vector<IkParameterization>& vikparams, std::vector<uint8_t>& vincollision, int numredundantsamples) const
+{
+    vincollision.resize(vikparams.size());
+    std::fill(vincollision.begin(), vincollision.end(), 0);
+    std::vector<Transform> vtEE;
+    std::vector<size_t> vtransformindices;
+    int numincollision = 0;
+    for(size_t i = 0; i < vikparams.size(); ++i) {
+        if( vikparams[i].GetType() == IKP_Transform6D ) {
+            vtEE.push_back(vikparams[i].GetTransform6D());
+            vtransformindices.push_back(i);
+        }
+        else if( CheckEndEffectorCollision(vikparams[i], CollisionReportPtr(), numredundantsamples) ) {
+            vincollision[i] = 1;
+            ++numincollision;
         }
     }
-    return bincollision;
+    if( vtEE.size() > 0 ) {
+        std::vector<uint8_t> vtransformincollision;
+        numincollision += CheckEndEffectorCollisions(vtEE, vtransformincollision);
+        for(size_t i = 0; i < vtransformindices.size(); ++i) {
+            vincollision[vtransformindices[i]] = vtransformincollision[i];
+        }
+    }
+    return numincollision;
 }
 
 bool RobotBase::Manipulator::CheckEndEffectorSelfCollision(CollisionReportPtr report, bool bIgnoreManipulatorLinks) const
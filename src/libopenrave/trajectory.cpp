@@ -93,6 +93,11 @@ void TrajectoryBase::Sample(std::vector<dReal>& data, dReal time, const Configur
     ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),GetConfigurationSpecification(),1,GetEnv(),reintializeData);
 }
 
+void TrajectoryBase::SampleWithHint(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec, size_t& waypointhint) const
+{
+    Sample(data, time, spec);
+}
+
 void TrajectoryBase::SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times) const
 {
     std::vector<dReal> tempdata;
@@ -116,6 +121,24 @@ void TrajectoryBase::SamplePoints(std::vector<dReal>& data, const std::vector<dR
     }
 }
 
+void TrajectoryBase::SampleRange(std::vector<dReal>& data, dReal starttime, dReal timestep, size_t numpoints) const
+{
+    std::vector<dReal> times(numpoints);
+    for(size_t i = 0; i < numpoints; ++i) {
+        times[i] = starttime + i*timestep;
+    }
+    SamplePoints(data, times);
+}
+
+void TrajectoryBase::SampleRange(std::vector<dReal>& data, dReal starttime, dReal timestep, size_t numpoints, const ConfigurationSpecification& spec) const
+{
+    std::vector<dReal> times(numpoints);
+    for(size_t i = 0; i < numpoints; ++i) {
+        times[i] = starttime + i*timestep;
+    }
+    SamplePoints(data, times, spec);
+}
+
 void TrajectoryBase::GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data, const ConfigurationSpecification& spec) const
 {
     RAVELOG_VERBOSE(str(boost::format("TrajectoryBase::GetWaypoints: calling slow implementation %s")%GetXMLId()));
@@ -69,9 +69,204 @@ void HierarchicalXMLReadable::Serialize(BaseXMLWriterPtr writer, int options) co
     }
 }
 
+static inline bool _IsXMLWhitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+NumberArrayParser::NumberArrayParser() : _bFailed(false)
+{
+    _ssfallback.imbue(std::locale::classic());
+}
+
+void NumberArrayParser::Reset()
+{
+    _unfinished.resize(0);
+    _bFailed = false;
+}
+
+void NumberArrayParser::Parse(const char* pdata, size_t len, std::vector<dReal>& vvalues)
+{
+    const char* p = pdata, *pend = pdata+len;
+    if( _unfinished.size() > 0 ) {
+        // finish the number that was cut off by the previous chunk
+        while(p != pend && !_IsXMLWhitespace(*p)) {
+            ++p;
+        }
+        _unfinished.append(pdata, p);
+        if( p == pend ) {
+            return;
+        }
+        if( !_bFailed ) {
+            _ParseNumber(_unfinished.c_str(), _unfinished.c_str()+_unfinished.size(), vvalues);
+        }
+        _unfinished.resize(0);
+    }
+    while(p != pend && !_bFailed) {
+        while(p != pend && _IsXMLWhitespace(*p)) {
+            ++p;
+        }
+        const char* pstart = p;
+        while(p != pend && !_IsXMLWhitespace(*p)) {
+            ++p;
+        }
+        if( p == pend ) {
+            // the next chunk can continue the number
+            _unfinished.assign(pstart, pend);
+            break;
+        }
+        _ParseNumber(pstart, p, vvalues);
+    }
+}
+
+void NumberArrayParser::Finish(std::vector<dReal>& vvalues)
+{
+    if( _unfinished.size() > 0 && !_bFailed ) {
+        _ParseNumber(_unfinished.c_str(), _unfinished.c_str()+_unfinished.size(), vvalues);
+    }
+    _unfinished.resize(0);
+}
+
+void NumberArrayParser::ParseAll(const char* pdata, size_t len, std::vector<dReal>& vvalues)
+{
+    // below this size starting the threads costs more than they save
+    static const size_t s_nParallelParseBytes = 1<<21;
+    Reset();
+    size_t numthreads = 1;
+    if( len >= 2*s_nParallelParseBytes ) {
+        numthreads = std::min((size_t)std::max(1u, boost::thread::hardware_concurrency()), len/s_nParallelParseBytes);
+    }
+    if( numthreads <= 1 ) {
+        Parse(pdata, len, vvalues);
+        Finish(vvalues);
+        return;
+    }
+
+    // cut at whitespace so that every number is in exactly one part
+    const char* pend = pdata+len;
+    std::vector<const char*> vpartstarts(numthreads+1, pend);
+    vpartstarts[0] = pdata;
+    for(size_t ipart = 1; ipart < numthreads; ++ipart) {
+        const char* p = std::max(pdata + (len*ipart)/numthreads, vpartstarts[ipart-1]);
+        while(p != pend && !_IsXMLWhitespace(*p)) {
+            ++p;
+        }
+        vpartstarts[ipart] = p;
+    }
+    std::vector< std::vector<dReal> > vpartvalues(numthreads);
+    std::vector<uint8_t> vpartfailed(numthreads, 0);
+    std::vector< boost::shared_ptr<boost::thread> > vthreads;
+    for(size_t ipart = 1; ipart < numthreads; ++ipart) {
+        vthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&NumberArrayParser::_ParsePart, vpartstarts[ipart], vpartstarts[ipart+1], boost::ref(vpartvalues[ipart]), boost::ref(vpartfailed[ipart])))));
+    }
+    _ParsePart(vpartstarts[0], vpartstarts[1], vpartvalues[0], vpartfailed[0]);
+    FOREACH(itthread, vthreads) {
+        (*itthread)->join();
+    }
+
+    // like a stream, nothing after the first string that is not a number is used
+    size_t numparts = numthreads, numvalues = vvalues.size();
+    for(size_t ipart = 0; ipart < numthreads; ++ipart) {
+        numvalues += vpartvalues[ipart].size();
+        if( vpartfailed[ipart] ) {
+            _bFailed = true;
+            numparts = ipart+1;
+            break;
+        }
+    }
+    vvalues.reserve(numvalues);
+    for(size_t ipart = 0; ipart < numparts; ++ipart) {
+        vvalues.insert(vvalues.end(), vpartvalues[ipart].begin(), vpartvalues[ipart].end());
+    }
+}
+
+void NumberArrayParser::_ParsePart(const char* pstart, const char* pend, std::vector<dReal>& vvalues, uint8_t& bfailed)
+{
+    NumberArrayParser parser;
+    parser.Parse(pstart, pend-pstart, vvalues);
+    parser.Finish(vvalues);
+    bfailed = parser.IsFailed();
+}
+
+void NumberArrayParser::_ParseNumber(const char* pstart, const char* pend, std::vector<dReal>& vvalues)
+{
+    // powers of ten that are exact doubles, so that a mantissa of at most 53 bits multiplied or divided by them is correctly rounded
+    static const double s_fPowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* p = pstart;
+    bool bnegative = false;
+    if( p != pend && (*p == '-' || *p == '+') ) {
+        bnegative = *p == '-';
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0, numsignificant = 0;
+    bool bhasdigits = false, bexact = true;
+    for(int ipart = 0; ipart < 2 && bexact; ++ipart) {
+        for(; p != pend && *p >= '0' && *p <= '9'; ++p) {
+            bhasdigits = true;
+            int digit = *p - '0';
+            if( mantissa > 0 || digit > 0 ) {
+                if( ++numsignificant > 19 ) {
+                    bexact = false;
+                    break;
+                }
+            }
+            mantissa = mantissa*10 + digit;
+            if( ipart == 1 ) {
+                --exponent;
+            }
+        }
+        if( ipart == 0 ) {
+            if( p == pend || *p != '.' ) {
+                break;
+            }
+            ++p;
+        }
+    }
+    if( bexact && bhasdigits && p != pend && (*p == 'e' || *p == 'E') ) {
+        ++p;
+        bool bnegativeexponent = false;
+        if( p != pend && (*p == '-' || *p == '+') ) {
+            bnegativeexponent = *p == '-';
+            ++p;
+        }
+        if( p == pend ) {
+            bexact = false;
+        }
+        int numberexponent = 0;
+        for(; p != pend && *p >= '0' && *p <= '9'; ++p) {
+            if( numberexponent < 10000 ) {
+                numberexponent = numberexponent*10 + (*p - '0');
+            }
+        }
+        exponent += bnegativeexponent ? -numberexponent : numberexponent;
+    }
+    if( bexact && bhasdigits && p == pend && mantissa <= (uint64_t(1)<<53) && exponent >= -22 && exponent <= 22 ) {
+        double fvalue = exponent < 0 ? (double)mantissa / s_fPowersOfTen[-exponent] : (double)mantissa * s_fPowersOfTen[exponent];
+        vvalues.push_back((dReal)(bnegative ? -fvalue : fvalue));
+        return;
+    }
+
+    // anything else like long mantissas, large exponents or a string that is not a number is parsed like before
+    _ssfallback.clear();
+    _ssfallback.str(std::string(pstart, pend));
+    dReal fvalue = 0;
+    _ssfallback >> fvalue;
+    if( !_ssfallback ) {
+        _bFailed = true;
+        return;
+    }
+    vvalues.push_back(fvalue);
+    if( !_ssfallback.eof() ) {
+        // the number is followed by other characters, a stream would fail on the next read
+        _bFailed = true;
+    }
+}
+
 TrajectoryReader::TrajectoryReader(EnvironmentBasePtr penv, TrajectoryBasePtr ptraj, const AttributesList& atts) : _ptraj(ptraj)
 {
     _bInReadable = false;
+    _bInData = false;
     _datacount = 0;
     FOREACHC(itatt, atts) {
         if( itatt->first == "type" ) {
@@ -121,6 +316,11 @@ BaseXMLReader::ProcessElement TrajectoryReader::startElement(const std::string&
                 _datacount = boost::lexical_cast<int>(itatt->second);
             }
         }
+        if( _datacount > 0 ) {
+            _vdata.reserve(_spec.GetDOF()*_datacount);
+        }
+        _sdata.resize(0);
+        _bInData = true;
         return PE_Support;
     }
     else if( name == "description" ) {
@@ -152,14 +352,15 @@ bool TrajectoryReader::endElement(const std::string& name)
         }
     }
     else if( name == "data" ) {
-        _vdata.resize(_spec.GetDOF()*_datacount);
-        for(size_t i = 0; i < _vdata.size(); ++i) {
-            _ss >> _vdata[i];
-        }
-        if( !_ss ) {
-            throw OPENRAVE_EXCEPTION_FORMAT(_("failed reading %d numbers from trajectory <data> element"), _vdata.size(), ORE_Assert);
+        _bInData = false;
+        _dataparser.ParseAll(_sdata.c_str(), _sdata.size(), _vdata);
+        std::string().swap(_sdata);
+        size_t numvalues = _spec.GetDOF()*_datacount;
+        if( _vdata.size() < numvalues ) {
+            throw OPENRAVE_EXCEPTION_FORMAT(_("failed reading %d numbers from trajectory <data> element"), numvalues, ORE_Assert);
         }
         else {
+            _vdata.resize(numvalues);
             _ptraj->Insert(_ptraj->GetNumWaypoints(),_vdata);
         }
     }
@@ -180,6 +381,9 @@ void TrajectoryReader::characters(const std::string& ch)
     if( !!_pcurreader ) {
         _pcurreader->characters(ch);
     }
+    else if( _bInData ) {
+        _sdata.append(ch);
+    }
     else {
         _ss.clear();
         _ss << ch;
@@ -188,6 +392,7 @@ void TrajectoryReader::characters(const std::string& ch)
 
 GeometryInfoReader::GeometryInfoReader(KinBody::GeometryInfoPtr pgeom, const AttributesList& atts) : _pgeom(pgeom)
 {
+    _bInVertices = false;
     _bOverwriteDiffuse = _bOverwriteAmbient = _bOverwriteTransparency = false;
     _sGroupName = "self";
     string type, name;
@@ -295,7 +500,13 @@ BaseXMLReader::ProcessElement GeometryInfoReader::startElement(const std::string
     }
     switch(_pgeom->_type) {
     case GT_TriMesh:
-        if(xmlname=="collision"|| xmlname=="data" || xmlname=="vertices" ) {
+        if( xmlname == "vertices" ) {
+            _vvertexvalues.resize(0);
+            _vertexparser.Reset();
+            _bInVertices = true;
+            return PE_Support;
+        }
+        if(xmlname=="collision"|| xmlname=="data" ) {
             return PE_Support;
         }
         break;
@@ -439,7 +650,10 @@ bool GeometryInfoReader::endElement(const std::string& xmlname)
                 }
             }
             else if( xmlname == "vertices" ) {
-                vector<dReal> values((istream_iterator<dReal>(_ss)), istream_iterator<dReal>());
+                _bInVertices = false;
+                _vertexparser.Finish(_vvertexvalues);
+                vector<dReal> values;
+                values.swap(_vvertexvalues);
                 if( (values.size()%9) ) {
                     RAVELOG_WARN(str(boost::format("number of points specified in the vertices field needs to be a multiple of 3 (it is %d), ignoring...\n")%values.size()));
                 }
@@ -472,6 +686,9 @@ void GeometryInfoReader::characters(const std::string& ch)
     if( !!_pcurreader ) {
         _pcurreader->characters(ch);
     }
+    else if( _bInVertices ) {
+        _vertexparser.Parse(ch.c_str(), ch.size(), _vvertexvalues);
+    }
     else {
         _ss.clear();
         _ss << ch;
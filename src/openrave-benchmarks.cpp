@@ -0,0 +1,557 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file openrave-benchmarks.cpp
+    \brief Measures the hot paths of the core on the scenes and robots shipped with openrave.
+
+    Every benchmark samples its inputs from a random generator initialized with --seed, so two runs with the same
+    arguments measure the same queries. The results are printed as a table, and --json writes them in a machine readable
+    format so they can be compared across commits, "--json -" writes them to stdout instead of the table.
+
+    \verbatim
+    openrave-benchmarks [--scene data/lab1.env.xml] [--collision name] [--samples N] [--plans N] [--seed N]
+                        [--benchmark name]... [--json filename]
+    \endverbatim
+ */
+#include "libopenrave-core/openrave-core.h"
+#include <openrave/planningutils.h>
+#include <openrave/utils.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+using namespace OpenRAVE;
+using namespace std;
+
+/// \brief the timings of one benchmark
+struct BenchmarkResult
+{
+    BenchmarkResult(const std::string& name) : _name(name) {
+    }
+
+    std::string _name;
+    std::vector<uint64_t> _vtimes; ///< ns of every measured operation
+    std::vector< std::pair<std::string, double> > _vextra; ///< benchmark specific values, e.g. success rates
+};
+
+/// \brief a robot of src/robots with a compiled ikfast solver in the ikfastsolvers plugin
+struct IkBenchmarkRobot
+{
+    const char* uri;
+    const char* manipname; ///< empty for the active manipulator
+    const char* iksolvername;
+};
+
+static const IkBenchmarkRobot s_ikrobots[] = {
+    { "robots/barrettwam.robot.xml", "", "wam7ikfast" },
+    { "robots/puma.robot.xml", "", "pumaikfast" },
+    { "robots/pa10schunk.robot.xml", "", "pa10ikfast" },
+    { "robots/schunk-lwa3.zae", "", "ikfast_schunk_lwa3" },
+    { "robots/pr2-beta-static.zae", "rightarm", "ikfast_pr2_rightarm" },
+};
+
+class OpenRAVEBenchmarks
+{
+public:
+    OpenRAVEBenchmarks() : _scenename("data/lab1.env.xml"), _numsamples(1000), _numplans(20), _seed(0) {
+    }
+
+    void PrintHelp()
+    {
+        RAVELOG_INFO("openrave-benchmarks [--scene filename] [--collision name] [--samples N] [--plans N] [--seed N] [--benchmark name]... [--json filename]\n\n"
+                     "benchmarks: setdof_checkcollision, selfcollision, raycast, ik, birrt, smoothing, trajectory_sample, env_load, env_clone\n"
+                     "birrt is needed by smoothing and trajectory_sample to get their trajectories.\n");
+    }
+
+    /// \return 0 if the benchmarks should be run, otherwise the exit code
+    int ParseArguments(int argc, char ** argv)
+    {
+        for(int i = 1; i < argc; ++i) {
+            if( strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ) {
+                PrintHelp();
+                return 1;
+            }
+            else if( strcmp(argv[i], "--scene") == 0 && i+1 < argc ) {
+                _scenename = argv[++i];
+            }
+            else if( strcmp(argv[i], "--collision") == 0 && i+1 < argc ) {
+                _collisionname = argv[++i];
+            }
+            else if( strcmp(argv[i], "--samples") == 0 && i+1 < argc ) {
+                _numsamples = max(1, atoi(argv[++i]));
+            }
+            else if( strcmp(argv[i], "--plans") == 0 && i+1 < argc ) {
+                _numplans = max(1, atoi(argv[++i]));
+            }
+            else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+                _seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+            }
+            else if( strcmp(argv[i], "--benchmark") == 0 && i+1 < argc ) {
+                _setbenchmarks.insert(argv[++i]);
+            }
+            else if( strcmp(argv[i], "--json") == 0 && i+1 < argc ) {
+                _jsonfilename = argv[++i];
+            }
+            else {
+                RAVELOG_ERROR("unknown argument %s\n", argv[i]);
+                PrintHelp();
+                return 2;
+            }
+        }
+        return 0;
+    }
+
+    int Run()
+    {
+        RaveInitRandomGeneration(_seed);
+        EnvironmentBasePtr penv = _CreateEnvironment();
+        if( !penv->Load(_scenename) ) {
+            RAVELOG_ERROR("failed to load scene %s\n", _scenename.c_str());
+            return 1;
+        }
+        if( !!penv->GetCollisionChecker() ) {
+            _collisionname = penv->GetCollisionChecker()->GetXMLId();
+        }
+
+        {
+            EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+            vector<RobotBasePtr> vrobots;
+            penv->GetRobots(vrobots);
+            if( vrobots.size() == 0 || !vrobots[0]->GetActiveManipulator() ) {
+                RAVELOG_ERROR("scene %s needs a robot with a manipulator\n", _scenename.c_str());
+                return 1;
+            }
+            RobotBasePtr probot = vrobots[0];
+            probot->SetActiveDOFs(probot->GetActiveManipulator()->GetArmIndices());
+
+            if( _IsEnabled("setdof_checkcollision") ) {
+                _BenchmarkSetDOFCheckCollision(penv, probot);
+            }
+            if( _IsEnabled("selfcollision") ) {
+                _BenchmarkSelfCollision(probot);
+            }
+            if( _IsEnabled("raycast") ) {
+                _BenchmarkRayCast(penv);
+            }
+
+            std::vector<TrajectoryBasePtr> vtrajectories;
+            if( _IsEnabled("birrt") || _IsEnabled("smoothing") || _IsEnabled("trajectory_sample") ) {
+                _BenchmarkBiRRT(penv, probot, vtrajectories);
+            }
+            if( _IsEnabled("smoothing") || _IsEnabled("trajectory_sample") ) {
+                _BenchmarkSmoothing(penv, probot, vtrajectories);
+            }
+            if( _IsEnabled("trajectory_sample") ) {
+                _BenchmarkTrajectorySample(probot, vtrajectories);
+            }
+            if( _IsEnabled("env_clone") ) {
+                _BenchmarkEnvironmentClone(penv);
+            }
+        }
+        if( _IsEnabled("env_load") ) {
+            _BenchmarkEnvironmentLoad();
+        }
+        if( _IsEnabled("ik") ) {
+            _BenchmarkIk();
+        }
+        penv->Destroy();
+
+        if( _jsonfilename == "-" ) {
+            _WriteJSON(cout);
+        }
+        else {
+            _PrintResults();
+            if( _jsonfilename.size() > 0 ) {
+                ofstream f(_jsonfilename.c_str());
+                if( !f ) {
+                    RAVELOG_ERROR("failed to open %s\n", _jsonfilename.c_str());
+                    return 1;
+                }
+                _WriteJSON(f);
+            }
+        }
+        return 0;
+    }
+
+private:
+    bool _IsEnabled(const std::string& name) const
+    {
+        return _setbenchmarks.size() == 0 || _setbenchmarks.find(name) != _setbenchmarks.end();
+    }
+
+    EnvironmentBasePtr _CreateEnvironment()
+    {
+        EnvironmentBasePtr penv = RaveCreateEnvironment();
+        if( _collisionname.size() > 0 ) {
+            CollisionCheckerBasePtr pchecker = RaveCreateCollisionChecker(penv, _collisionname);
+            if( !pchecker ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("failed to create collision checker %s", _collisionname, ORE_InvalidArguments);
+            }
+            penv->SetCollisionChecker(pchecker);
+        }
+        return penv;
+    }
+
+    /// \brief samples configurations uniformly in the active dof limits of the robot
+    void _SampleActiveConfigurations(RobotBasePtr probot, int numconfigs, std::vector<dReal>& vconfigs)
+    {
+        vector<dReal> vlower, vupper;
+        probot->GetActiveDOFLimits(vlower, vupper);
+        int dof = probot->GetActiveDOF();
+        vconfigs.resize(numconfigs*dof);
+        for(int i = 0; i < numconfigs*dof; ++i) {
+            vconfigs[i] = vlower[i%dof] + (vupper[i%dof]-vlower[i%dof])*RaveRandomFloat();
+        }
+    }
+
+    /// \brief samples a configuration of the active dofs that is not in collision
+    bool _SampleFreeConfiguration(EnvironmentBasePtr penv, RobotBasePtr probot, std::vector<dReal>& vconfig)
+    {
+        RobotBase::RobotStateSaver saver(probot);
+        for(int itry = 0; itry < 1000; ++itry) {
+            _SampleActiveConfigurations(probot, 1, vconfig);
+            probot->SetActiveDOFValues(vconfig);
+            if( !penv->CheckCollision(KinBodyConstPtr(probot)) && !probot->CheckSelfCollision() ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void _BenchmarkSetDOFCheckCollision(EnvironmentBasePtr penv, RobotBasePtr probot)
+    {
+        RobotBase::RobotStateSaver saver(probot);
+        BenchmarkResult result("setdof_checkcollision");
+        int dof = probot->GetActiveDOF();
+        vector<dReal> vconfigs;
+        _SampleActiveConfigurations(probot, _numsamples, vconfigs);
+        vector<dReal> vconfig(dof);
+        int numcollisions = 0;
+        for(int isample = 0; isample < _numsamples; ++isample) {
+            std::copy(vconfigs.begin()+isample*dof, vconfigs.begin()+(isample+1)*dof, vconfig.begin());
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            probot->SetActiveDOFValues(vconfig, KinBody::CLA_Nothing);
+            if( penv->CheckCollision(KinBodyConstPtr(probot)) ) {
+                ++numcollisions;
+            }
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+        }
+        result._vextra.push_back(make_pair(string("collisionrate"), (double)numcollisions/_numsamples));
+        _vresults.push_back(result);
+    }
+
+    void _BenchmarkSelfCollision(RobotBasePtr probot)
+    {
+        RobotBase::RobotStateSaver saver(probot);
+        BenchmarkResult result("selfcollision");
+        int dof = probot->GetActiveDOF();
+        vector<dReal> vconfigs;
+        _SampleActiveConfigurations(probot, _numsamples, vconfigs);
+        vector<dReal> vconfig(dof);
+        int numcollisions = 0;
+        for(int isample = 0; isample < _numsamples; ++isample) {
+            std::copy(vconfigs.begin()+isample*dof, vconfigs.begin()+(isample+1)*dof, vconfig.begin());
+            probot->SetActiveDOFValues(vconfig, KinBody::CLA_Nothing);
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            if( probot->CheckSelfCollision() ) {
+                ++numcollisions;
+            }
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+        }
+        result._vextra.push_back(make_pair(string("collisionrate"), (double)numcollisions/_numsamples));
+        _vresults.push_back(result);
+    }
+
+    /// \brief casts rays from random points in the bounding box of the scene towards random directions
+    void _BenchmarkRayCast(EnvironmentBasePtr penv)
+    {
+        BenchmarkResult result("raycast");
+        vector<KinBodyPtr> vbodies;
+        penv->GetBodies(vbodies);
+        Vector vmin(1e30,1e30,1e30), vmax(-1e30,-1e30,-1e30);
+        for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+            AABB ab = vbodies[ibody]->ComputeAABB();
+            for(int j = 0; j < 3; ++j) {
+                vmin[j] = min(vmin[j], ab.pos[j]-ab.extents[j]);
+                vmax[j] = max(vmax[j], ab.pos[j]+ab.extents[j]);
+            }
+        }
+        dReal flength = RaveSqrt((vmax-vmin).lengthsqr3());
+        CollisionReportPtr report(new CollisionReport());
+        int numhits = 0;
+        for(int isample = 0; isample < _numsamples; ++isample) {
+            Vector vpos, vdir;
+            for(int j = 0; j < 3; ++j) {
+                vpos[j] = vmin[j] + (vmax[j]-vmin[j])*RaveRandomFloat();
+                vdir[j] = 2*RaveRandomFloat()-1;
+            }
+            vdir.normalize3();
+            RAY r(vpos, vdir*flength);
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            if( penv->CheckCollision(r, report) ) {
+                ++numhits;
+            }
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+        }
+        result._vextra.push_back(make_pair(string("hitrate"), (double)numhits/_numsamples));
+        _vresults.push_back(result);
+    }
+
+    /// \brief solves the ik of the end effector poses of random configurations for every robot of s_ikrobots in its own environment
+    void _BenchmarkIk()
+    {
+        for(size_t irobot = 0; irobot < sizeof(s_ikrobots)/sizeof(s_ikrobots[0]); ++irobot) {
+            const IkBenchmarkRobot& ikrobot = s_ikrobots[irobot];
+            EnvironmentBasePtr penv = _CreateEnvironment();
+            {
+                EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+                RobotBasePtr probot = penv->ReadRobotURI(RobotBasePtr(), ikrobot.uri);
+                if( !probot ) {
+                    RAVELOG_WARN("failed to load %s, skipping its ik benchmark\n", ikrobot.uri);
+                    penv->Destroy();
+                    continue;
+                }
+                penv->Add(probot);
+                RobotBase::ManipulatorPtr pmanip = strlen(ikrobot.manipname) > 0 ? probot->GetManipulator(ikrobot.manipname) : probot->GetActiveManipulator();
+                IkSolverBasePtr piksolver = RaveCreateIkSolver(penv, ikrobot.iksolvername);
+                if( !pmanip || !piksolver || !pmanip->SetIkSolver(piksolver) ) {
+                    RAVELOG_WARN("failed to set ik solver %s on %s, skipping its ik benchmark\n", ikrobot.iksolvername, ikrobot.uri);
+                    penv->Destroy();
+                    continue;
+                }
+                IkParameterizationType iktype = IKP_Transform6D;
+                if( !piksolver->Supports(iktype) ) {
+                    iktype = IKP_TranslationDirection5D;
+                }
+
+                BenchmarkResult result(str(boost::format("ik.%s")%probot->GetName()));
+                probot->SetActiveDOFs(pmanip->GetArmIndices());
+                vector<dReal> vconfigs, vsolution;
+                _SampleActiveConfigurations(probot, _numsamples, vconfigs);
+                int dof = probot->GetActiveDOF();
+                vector<dReal> vconfig(dof);
+                int numsuccess = 0;
+                for(int isample = 0; isample < _numsamples; ++isample) {
+                    std::copy(vconfigs.begin()+isample*dof, vconfigs.begin()+(isample+1)*dof, vconfig.begin());
+                    probot->SetActiveDOFValues(vconfig);
+                    IkParameterization ikparam = pmanip->GetIkParameterization(iktype);
+                    uint64_t starttime = utils::GetNanoPerformanceTime();
+                    if( pmanip->FindIKSolution(ikparam, vsolution, IKFO_CheckEnvCollisions) ) {
+                        ++numsuccess;
+                    }
+                    result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+                }
+                result._vextra.push_back(make_pair(string("successrate"), (double)numsuccess/_numsamples));
+                _vresults.push_back(result);
+            }
+            penv->Destroy();
+        }
+    }
+
+    /// \brief plans from the initial configuration of the robot to random free configurations
+    void _BenchmarkBiRRT(EnvironmentBasePtr penv, RobotBasePtr probot, std::vector<TrajectoryBasePtr>& vtrajectories)
+    {
+        RobotBase::RobotStateSaver saver(probot);
+        BenchmarkResult result("birrt");
+        PlannerBasePtr planner = RaveCreatePlanner(penv, "birrt");
+        vector<dReal> vinitialconfig;
+        probot->GetActiveDOFValues(vinitialconfig);
+        int numsuccess = 0;
+        for(int iplan = 0; iplan < _numplans; ++iplan) {
+            PlannerBase::PlannerParametersPtr params(new PlannerBase::PlannerParameters());
+            params->SetRobotActiveJoints(probot);
+            params->_nMaxIterations = 4000;
+            params->_nRandomGeneratorSeed = _seed+iplan;
+            params->vinitialconfig = vinitialconfig;
+            if( !_SampleFreeConfiguration(penv, probot, params->vgoalconfig) ) {
+                RAVELOG_WARN("failed to sample a free goal configuration for plan %d\n", iplan);
+                continue;
+            }
+            probot->SetActiveDOFValues(vinitialconfig);
+            TrajectoryBasePtr ptraj = RaveCreateTrajectory(penv, "");
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            bool bsuccess = planner->InitPlan(probot, params) && planner->PlanPath(ptraj).GetStatusCode() == PS_HasSolution;
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+            if( bsuccess ) {
+                ++numsuccess;
+                vtrajectories.push_back(ptraj);
+            }
+        }
+        result._vextra.push_back(make_pair(string("successrate"), (double)numsuccess/_numplans));
+        if( _IsEnabled("birrt") ) {
+            _vresults.push_back(result);
+        }
+    }
+
+    /// \brief smooths the birrt trajectories with the parabolic smoother, replacing them with the smoothed trajectories
+    void _BenchmarkSmoothing(EnvironmentBasePtr penv, RobotBasePtr probot, std::vector<TrajectoryBasePtr>& vtrajectories)
+    {
+        RobotBase::RobotStateSaver saver(probot);
+        BenchmarkResult result("smoothing");
+        std::vector<TrajectoryBasePtr> vsmoothed;
+        for(size_t itraj = 0; itraj < vtrajectories.size(); ++itraj) {
+            TrajectoryBasePtr ptraj = RaveCreateTrajectory(penv, vtrajectories[itraj]->GetXMLId());
+            ptraj->Clone(vtrajectories[itraj], 0);
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            PlannerStatus status = planningutils::SmoothActiveDOFTrajectory(ptraj, probot, 1, 1, "parabolicsmoother", "");
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+            if( status.GetStatusCode() == PS_HasSolution ) {
+                vsmoothed.push_back(ptraj);
+            }
+        }
+        result._vextra.push_back(make_pair(string("successrate"), vtrajectories.size() > 0 ? (double)vsmoothed.size()/vtrajectories.size() : 0.0));
+        if( _IsEnabled("smoothing") ) {
+            _vresults.push_back(result);
+        }
+        vtrajectories.swap(vsmoothed);
+    }
+
+    /// \brief samples the trajectories at uniform times, every measurement is the average of a batch of samples since one sample is too short to time
+    void _BenchmarkTrajectorySample(RobotBasePtr probot, const std::vector<TrajectoryBasePtr>& vtrajectories)
+    {
+        BenchmarkResult result("trajectory_sample");
+        const int batchsize = 100;
+        ConfigurationSpecification spec = probot->GetActiveConfigurationSpecification();
+        vector<dReal> vdata;
+        for(size_t itraj = 0; itraj < vtrajectories.size(); ++itraj) {
+            dReal fduration = vtrajectories[itraj]->GetDuration();
+            for(int isample = 0; isample < _numsamples; isample += batchsize) {
+                uint64_t starttime = utils::GetNanoPerformanceTime();
+                for(int ibatch = 0; ibatch < batchsize; ++ibatch) {
+                    vtrajectories[itraj]->Sample(vdata, fduration*(isample+ibatch)/_numsamples, spec);
+                }
+                result._vtimes.push_back((utils::GetNanoPerformanceTime()-starttime)/batchsize);
+            }
+        }
+        _vresults.push_back(result);
+    }
+
+    void _BenchmarkEnvironmentLoad()
+    {
+        BenchmarkResult result("env_load");
+        int numloads = max(1, _numplans/2);
+        for(int iload = 0; iload < numloads; ++iload) {
+            EnvironmentBasePtr penv = _CreateEnvironment();
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            penv->Load(_scenename);
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+            penv->Destroy();
+        }
+        _vresults.push_back(result);
+    }
+
+    void _BenchmarkEnvironmentClone(EnvironmentBasePtr penv)
+    {
+        BenchmarkResult result("env_clone");
+        int numclones = max(1, _numplans/2);
+        for(int iclone = 0; iclone < numclones; ++iclone) {
+            uint64_t starttime = utils::GetNanoPerformanceTime();
+            EnvironmentBasePtr pclone = penv->CloneSelf(Clone_Bodies);
+            result._vtimes.push_back(utils::GetNanoPerformanceTime()-starttime);
+            pclone->Destroy();
+        }
+        _vresults.push_back(result);
+    }
+
+    /// \brief computes the statistics of the times, in ns
+    static void _ComputeStatistics(const std::vector<uint64_t>& vtimes, uint64_t& mean, uint64_t& minimum, uint64_t& median, uint64_t& p90, uint64_t& maximum)
+    {
+        mean = minimum = median = p90 = maximum = 0;
+        if( vtimes.size() == 0 ) {
+            return;
+        }
+        std::vector<uint64_t> vsorted = vtimes;
+        std::sort(vsorted.begin(), vsorted.end());
+        uint64_t total = 0;
+        for(size_t i = 0; i < vsorted.size(); ++i) {
+            total += vsorted[i];
+        }
+        mean = total/vsorted.size();
+        minimum = vsorted.front();
+        median = vsorted[vsorted.size()/2];
+        p90 = vsorted[std::min(vsorted.size()-1, (vsorted.size()*9)/10)];
+        maximum = vsorted.back();
+    }
+
+    void _PrintResults()
+    {
+        cout << setw(28) << left << "benchmark" << right << setw(8) << "count" << setw(14) << "mean(us)" << setw(14) << "min(us)" << setw(14) << "median(us)" << setw(14) << "p90(us)" << setw(14) << "max(us)" << endl;
+        for(size_t iresult = 0; iresult < _vresults.size(); ++iresult) {
+            const BenchmarkResult& result = _vresults[iresult];
+            uint64_t mean, minimum, median, p90, maximum;
+            _ComputeStatistics(result._vtimes, mean, minimum, median, p90, maximum);
+            cout << setw(28) << left << result._name << right << setw(8) << result._vtimes.size() << fixed << setprecision(3)
+                 << setw(14) << 1e-3*mean << setw(14) << 1e-3*minimum << setw(14) << 1e-3*median << setw(14) << 1e-3*p90 << setw(14) << 1e-3*maximum;
+            for(size_t iextra = 0; iextra < result._vextra.size(); ++iextra) {
+                cout << "  " << result._vextra[iextra].first << "=" << result._vextra[iextra].second;
+            }
+            cout << endl;
+        }
+    }
+
+    void _WriteJSON(std::ostream& O)
+    {
+        O << "{\"version\":\"" << OPENRAVE_VERSION_STRING << "\",\"scene\":\"" << _scenename << "\",\"collisionchecker\":\"" << _collisionname
+          << "\",\"seed\":" << _seed << ",\"unit\":\"ns\",\"benchmarks\":[";
+        for(size_t iresult = 0; iresult < _vresults.size(); ++iresult) {
+            const BenchmarkResult& result = _vresults[iresult];
+            uint64_t mean, minimum, median, p90, maximum;
+            _ComputeStatistics(result._vtimes, mean, minimum, median, p90, maximum);
+            if( iresult > 0 ) {
+                O << ",";
+            }
+            O << "\n{\"name\":\"" << result._name << "\",\"count\":" << result._vtimes.size() << ",\"mean\":" << mean << ",\"min\":" << minimum
+              << ",\"median\":" << median << ",\"p90\":" << p90 << ",\"max\":" << maximum;
+            for(size_t iextra = 0; iextra < result._vextra.size(); ++iextra) {
+                O << ",\"" << result._vextra[iextra].first << "\":" << result._vextra[iextra].second;
+            }
+            O << "}";
+        }
+        O << "\n]}\n";
+    }
+
+    std::string _scenename, _collisionname, _jsonfilename;
+    std::set<std::string> _setbenchmarks; ///< the benchmarks to run, all if empty
+    int _numsamples; ///< number of queries of the collision, ik and sampling benchmarks
+    int _numplans; ///< number of birrt plans
+    uint32_t _seed;
+    std::vector<BenchmarkResult> _vresults;
+};
+
+int main(int argc, char ** argv)
+{
+    OpenRAVEBenchmarks benchmarks;
+    int ret = benchmarks.ParseArguments(argc, argv);
+    if( ret != 0 ) {
+        return ret == 1 ? 0 : ret;
+    }
+    RaveInitialize(true);
+    try {
+        ret = benchmarks.Run();
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_ERROR("benchmarks failed: %s\n", ex.what());
+        ret = 1;
+    }
+    RaveDestroy();
+    return ret;
+}
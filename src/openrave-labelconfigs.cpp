@@ -0,0 +1,500 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2026 agent <agent@local>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file openrave-labelconfigs.cpp
+    \brief Samples configurations of a robot and labels them as colliding or free, for datasets of learned collision models.
+
+    The configurations are sampled in batches on the main thread with the BodyConfiguration sampler of the basesamplers plugin,
+    and every worker thread labels whole batches in its own clone of the environment with
+    CollisionCheckerBase::CheckCollisionConfigurations. With --distance, every configuration is checked with CO_Distance and
+    the minimum distance to the environment reported by the collision checker is stored too. The batches are written in the
+    order they were sampled, so two runs with the same arguments write the same file.
+
+    \verbatim
+    openrave-labelconfigs --scene filename --output filename [--robot name] [--manip name | --alldofs] [--collision name]
+                          [--sampler name] [--samples N] [--batch N] [--threads N] [--seed N] [--distance] [--noselfcollision]
+    \endverbatim
+
+    The output is a native endian binary file, compressed with gzip when the filename ends in .gz. It starts with the header
+
+    \verbatim
+    char magic[4] = "ORLC"; uint32 version = 1; uint32 dof; uint32 flags (1 if distances are stored); int32 dofindices[dof];
+    \endverbatim
+
+    followed by one packed record per configuration: float64 values[dof]; uint8 incollision; float64 distance (only with --distance).
+ */
+#include "libopenrave-core/openrave-core.h"
+#include <openrave/utils.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <sstream>
+
+#ifdef OPENRAVE_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace OpenRAVE;
+using namespace std;
+
+/// \brief writes the labeled configurations to a plain or gzip compressed file
+class LabelFileWriter
+{
+public:
+    LabelFileWriter() : _pfile(NULL)
+#ifdef OPENRAVE_HAS_ZLIB
+        , _gzfile(NULL)
+#endif
+    {
+    }
+    ~LabelFileWriter() {
+        Close();
+    }
+
+    bool Open(const std::string& filename)
+    {
+        if( filename.size() > 3 && filename.substr(filename.size()-3) == ".gz" ) {
+#ifdef OPENRAVE_HAS_ZLIB
+            _gzfile = gzopen(filename.c_str(), "wb1");
+            if( !!_gzfile ) {
+                // the default 8KB buffer makes zlib the bottleneck
+                gzbuffer(_gzfile, 1<<20);
+            }
+            return !!_gzfile;
+#else
+            RAVELOG_WARN("openrave was compiled without zlib, %s is written uncompressed\n", filename.c_str());
+#endif
+        }
+        _pfile = fopen(filename.c_str(), "wb");
+        return !!_pfile;
+    }
+
+    bool Write(const void* pdata, size_t size)
+    {
+        if( size == 0 ) {
+            return true;
+        }
+#ifdef OPENRAVE_HAS_ZLIB
+        if( !!_gzfile ) {
+            return gzwrite(_gzfile, pdata, size) == (int)size;
+        }
+#endif
+        return !!_pfile && fwrite(pdata, 1, size, _pfile) == size;
+    }
+
+    /// \return false if the buffered data could not be written
+    bool Close()
+    {
+        bool bSuccess = true;
+#ifdef OPENRAVE_HAS_ZLIB
+        if( !!_gzfile ) {
+            bSuccess = gzclose(_gzfile) == Z_OK;
+            _gzfile = NULL;
+        }
+#endif
+        if( !!_pfile ) {
+            bSuccess = fclose(_pfile) == 0;
+            _pfile = NULL;
+        }
+        return bSuccess;
+    }
+
+private:
+    FILE* _pfile;
+#ifdef OPENRAVE_HAS_ZLIB
+    gzFile _gzfile;
+#endif
+};
+
+/// \brief configurations labeled together by one worker
+struct LabelBatch
+{
+    LabelBatch() : bDone(false) {
+    }
+    std::vector<dReal> vconfigs; ///< dof values of every configuration, stored contiguously
+    std::vector<uint8_t> vcollisions;
+    std::vector<dReal> vdistances; ///< only filled with --distance
+    bool bDone;
+};
+typedef boost::shared_ptr<LabelBatch> LabelBatchPtr;
+
+class OpenRAVELabelConfigs
+{
+public:
+    OpenRAVELabelConfigs() : _samplername("mt19937"), _numsamples(1000000), _batchsize(1024), _numthreads(0), _seed(0), _bAllDOFs(false), _bDistance(false), _bSelfCollision(true), _bShutdown(false), _bFailed(false) {
+    }
+
+    void PrintHelp()
+    {
+        RAVELOG_INFO("openrave-labelconfigs --scene filename --output filename [--robot name] [--manip name | --alldofs] [--collision name]\n"
+                     "                      [--sampler name] [--samples N] [--batch N] [--threads N] [--seed N] [--distance] [--noselfcollision]\n\n"
+                     "Labels sampled configurations of the arm of the manipulator (or all the dofs of the robot) as colliding or free.\n"
+                     "--sampler is a sampler returning values in [0,1] like mt19937 or halton, --threads 0 uses all the cores.\n"
+                     "--distance also stores the minimum distance to the environment, the collision checker has to support CO_Distance.\n"
+                     "The output is gzip compressed when the filename ends in .gz.\n");
+    }
+
+    /// \return 0 if the configurations should be labeled, otherwise the exit code
+    int ParseArguments(int argc, char ** argv)
+    {
+        for(int i = 1; i < argc; ++i) {
+            if( strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ) {
+                PrintHelp();
+                return 1;
+            }
+            else if( strcmp(argv[i], "--scene") == 0 && i+1 < argc ) {
+                _scenename = argv[++i];
+            }
+            else if( strcmp(argv[i], "--output") == 0 && i+1 < argc ) {
+                _outputname = argv[++i];
+            }
+            else if( strcmp(argv[i], "--robot") == 0 && i+1 < argc ) {
+                _robotname = argv[++i];
+            }
+            else if( strcmp(argv[i], "--manip") == 0 && i+1 < argc ) {
+                _manipname = argv[++i];
+            }
+            else if( strcmp(argv[i], "--alldofs") == 0 ) {
+                _bAllDOFs = true;
+            }
+            else if( strcmp(argv[i], "--collision") == 0 && i+1 < argc ) {
+                _collisionname = argv[++i];
+            }
+            else if( strcmp(argv[i], "--sampler") == 0 && i+1 < argc ) {
+                _samplername = argv[++i];
+            }
+            else if( strcmp(argv[i], "--samples") == 0 && i+1 < argc ) {
+                _numsamples = strtoull(argv[++i], NULL, 10);
+            }
+            else if( strcmp(argv[i], "--batch") == 0 && i+1 < argc ) {
+                _batchsize = max(1, atoi(argv[++i]));
+            }
+            else if( strcmp(argv[i], "--threads") == 0 && i+1 < argc ) {
+                _numthreads = max(0, atoi(argv[++i]));
+            }
+            else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+                _seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+            }
+            else if( strcmp(argv[i], "--distance") == 0 ) {
+                _bDistance = true;
+            }
+            else if( strcmp(argv[i], "--noselfcollision") == 0 ) {
+                _bSelfCollision = false;
+            }
+            else {
+                RAVELOG_ERROR("unknown argument %s\n", argv[i]);
+                PrintHelp();
+                return 2;
+            }
+        }
+        if( _scenename.size() == 0 || _outputname.size() == 0 ) {
+            RAVELOG_ERROR("--scene and --output are required\n");
+            PrintHelp();
+            return 2;
+        }
+        return 0;
+    }
+
+    int Run()
+    {
+        EnvironmentBasePtr penv = RaveCreateEnvironment();
+        if( _collisionname.size() > 0 ) {
+            CollisionCheckerBasePtr pchecker = RaveCreateCollisionChecker(penv, _collisionname);
+            if( !pchecker ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("failed to create collision checker %s", _collisionname, ORE_InvalidArguments);
+            }
+            penv->SetCollisionChecker(pchecker);
+        }
+        if( !penv->Load(_scenename) ) {
+            RAVELOG_ERROR("failed to load scene %s\n", _scenename.c_str());
+            return 1;
+        }
+
+        SpaceSamplerBasePtr psampler;
+        {
+            EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+            if( !_InitRobot(penv) ) {
+                return 1;
+            }
+            psampler = RaveCreateSpaceSampler(penv, str(boost::format("bodyconfiguration %s %s")%_robotname%_samplername));
+            stringstream sout, sinput;
+            sinput << "SetDOFs";
+            for(size_t i = 0; i < _vdofindices.size(); ++i) {
+                sinput << " " << _vdofindices[i];
+            }
+            if( !psampler || !psampler->SendCommand(sout, sinput) ) {
+                RAVELOG_ERROR("failed to create the configuration sampler with %s\n", _samplername.c_str());
+                return 1;
+            }
+            psampler->SetSeed(_seed);
+        }
+
+        LabelFileWriter writer;
+        if( !writer.Open(_outputname) || !_WriteHeader(writer) ) {
+            RAVELOG_ERROR("failed to open %s\n", _outputname.c_str());
+            return 1;
+        }
+
+        int numthreads = _numthreads > 0 ? _numthreads : max(1, (int)boost::thread::hardware_concurrency());
+        std::list<EnvironmentBasePtr> listclones;
+        std::list<boost::shared_ptr<boost::thread> > listthreads;
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            EnvironmentBasePtr pclone = penv->CloneSelf(Clone_Bodies);
+            listclones.push_back(pclone);
+            listthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&OpenRAVELabelConfigs::_LabelThread, this, pclone))));
+        }
+
+        bool bSuccess = _SampleAndWrite(psampler, writer, 2*numthreads);
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bShutdown = true;
+            _condPending.notify_all();
+        }
+        for(std::list<boost::shared_ptr<boost::thread> >::iterator itthread = listthreads.begin(); itthread != listthreads.end(); ++itthread) {
+            (*itthread)->join();
+        }
+        for(std::list<EnvironmentBasePtr>::iterator itclone = listclones.begin(); itclone != listclones.end(); ++itclone) {
+            (*itclone)->Destroy();
+        }
+        if( !writer.Close() ) {
+            RAVELOG_ERROR("failed to write %s\n", _outputname.c_str());
+            bSuccess = false;
+        }
+        psampler.reset();
+        penv->Destroy();
+        return bSuccess ? 0 : 1;
+    }
+
+private:
+    /// \brief sets _robotname and _vdofindices from the arguments. The environment should be locked
+    bool _InitRobot(EnvironmentBasePtr penv)
+    {
+        RobotBasePtr probot;
+        if( _robotname.size() > 0 ) {
+            probot = penv->GetRobot(_robotname);
+        }
+        else {
+            vector<RobotBasePtr> vrobots;
+            penv->GetRobots(vrobots);
+            if( vrobots.size() > 0 ) {
+                probot = vrobots[0];
+            }
+        }
+        if( !probot ) {
+            RAVELOG_ERROR("scene %s has no robot %s\n", _scenename.c_str(), _robotname.c_str());
+            return false;
+        }
+        _robotname = probot->GetName();
+        if( _bAllDOFs ) {
+            _vdofindices.resize(probot->GetDOF());
+            for(int i = 0; i < probot->GetDOF(); ++i) {
+                _vdofindices[i] = i;
+            }
+        }
+        else {
+            RobotBase::ManipulatorPtr pmanip = _manipname.size() > 0 ? probot->GetManipulator(_manipname) : probot->GetActiveManipulator();
+            if( !pmanip ) {
+                RAVELOG_ERROR("robot %s has no manipulator %s, use --alldofs to sample all the dofs\n", _robotname.c_str(), _manipname.c_str());
+                return false;
+            }
+            _vdofindices = pmanip->GetArmIndices();
+        }
+        if( _vdofindices.size() == 0 ) {
+            RAVELOG_ERROR("robot %s has no dofs to sample\n", _robotname.c_str());
+            return false;
+        }
+        if( _bDistance ) {
+            // fail before starting the threads when the checker cannot compute distances
+            CollisionOptionsStateSaver optionsaver(penv->GetCollisionChecker(), penv->GetCollisionChecker()->GetCollisionOptions()|CO_Distance, true);
+        }
+        return true;
+    }
+
+    bool _WriteHeader(LabelFileWriter& writer)
+    {
+        uint32_t vheader[3] = { 1, (uint32_t)_vdofindices.size(), _bDistance ? 1u : 0u };
+        std::vector<int32_t> vdofindices(_vdofindices.begin(), _vdofindices.end());
+        return writer.Write("ORLC", 4) && writer.Write(vheader, sizeof(vheader)) && writer.Write(&vdofindices[0], vdofindices.size()*sizeof(int32_t));
+    }
+
+    /// \brief samples the batches for the workers and writes them in order, keeping at most maxbatches batches in flight
+    bool _SampleAndWrite(SpaceSamplerBasePtr psampler, LabelFileWriter& writer, int maxbatches)
+    {
+        const size_t dof = _vdofindices.size();
+        const size_t recordsize = dof*sizeof(double) + 1 + (_bDistance ? sizeof(double) : 0);
+        std::list<LabelBatchPtr> listinflight; ///< in the order they were sampled
+        std::vector<uint8_t> vbuffer;
+        uint64_t numsampled = 0, numwritten = 0, numcolliding = 0;
+        uint64_t starttime = utils::GetMicroTime(), lastlogtime = starttime;
+        while( numwritten < _numsamples ) {
+            while( numsampled < _numsamples && (int)listinflight.size() < maxbatches ) {
+                LabelBatchPtr pbatch(new LabelBatch());
+                size_t num = (size_t)min((uint64_t)_batchsize, _numsamples-numsampled);
+                psampler->SampleSequence(pbatch->vconfigs, num);
+                numsampled += num;
+                listinflight.push_back(pbatch);
+                boost::mutex::scoped_lock lock(_mutex);
+                _listPending.push_back(pbatch);
+                _condPending.notify_one();
+            }
+
+            LabelBatchPtr pbatch = listinflight.front();
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while( !pbatch->bDone && !_bFailed ) {
+                    _condDone.wait(lock);
+                }
+                if( _bFailed ) {
+                    return false;
+                }
+            }
+            listinflight.pop_front();
+
+            size_t num = pbatch->vcollisions.size();
+            vbuffer.resize(num*recordsize);
+            uint8_t* p = &vbuffer[0];
+            for(size_t iconfig = 0; iconfig < num; ++iconfig) {
+                for(size_t idof = 0; idof < dof; ++idof) {
+                    double value = pbatch->vconfigs[iconfig*dof+idof];
+                    memcpy(p, &value, sizeof(value));
+                    p += sizeof(value);
+                }
+                *p++ = pbatch->vcollisions[iconfig];
+                numcolliding += pbatch->vcollisions[iconfig];
+                if( _bDistance ) {
+                    double distance = pbatch->vdistances[iconfig];
+                    memcpy(p, &distance, sizeof(distance));
+                    p += sizeof(distance);
+                }
+            }
+            if( !writer.Write(&vbuffer[0], vbuffer.size()) ) {
+                RAVELOG_ERROR("failed to write %s\n", _outputname.c_str());
+                return false;
+            }
+            numwritten += num;
+
+            uint64_t curtime = utils::GetMicroTime();
+            if( curtime - lastlogtime > 5000000 || numwritten == _numsamples ) {
+                RAVELOG_INFO_FORMAT("labeled %d/%d configurations at %.0f/s, %.3f colliding", numwritten%_numsamples%(1e6*numwritten/max((uint64_t)1, curtime-starttime))%((double)numcolliding/numwritten));
+                lastlogtime = curtime;
+            }
+        }
+        return true;
+    }
+
+    void _LabelThread(EnvironmentBasePtr penv)
+    {
+        try {
+            EnvironmentMutex::scoped_lock lockenv(penv->GetMutex());
+            RobotBasePtr probot = penv->GetRobot(_robotname);
+            CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+            boost::shared_ptr<CollisionOptionsStateSaver> poptionsaver;
+            if( _bDistance ) {
+                poptionsaver.reset(new CollisionOptionsStateSaver(pchecker, pchecker->GetCollisionOptions()|CO_Distance, true));
+            }
+            while(1) {
+                LabelBatchPtr pbatch;
+                {
+                    boost::mutex::scoped_lock lock(_mutex);
+                    while( _listPending.size() == 0 && !_bShutdown ) {
+                        _condPending.wait(lock);
+                    }
+                    if( _bShutdown ) {
+                        break;
+                    }
+                    pbatch = _listPending.front();
+                    _listPending.pop_front();
+                }
+                if( _bDistance ) {
+                    _LabelDistances(probot, pchecker, *pbatch);
+                }
+                else {
+                    pchecker->CheckCollisionConfigurations(probot, _vdofindices, pbatch->vconfigs, pbatch->vcollisions, _bSelfCollision);
+                }
+                boost::mutex::scoped_lock lock(_mutex);
+                pbatch->bDone = true;
+                _condDone.notify_all();
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_ERROR_FORMAT("failed to label configurations: %s", ex.what());
+            boost::mutex::scoped_lock lock(_mutex);
+            _bFailed = true;
+            _condDone.notify_all();
+        }
+    }
+
+    /// \brief labels every configuration with its own distance query since CheckCollisionConfigurations does not return distances
+    void _LabelDistances(RobotBasePtr probot, CollisionCheckerBasePtr pchecker, LabelBatch& batch)
+    {
+        KinBody::KinBodyStateSaver saver(probot, KinBody::Save_LinkTransformation);
+        const size_t dof = _vdofindices.size();
+        size_t num = batch.vconfigs.size()/dof;
+        batch.vcollisions.resize(num);
+        batch.vdistances.resize(num);
+        CollisionReportPtr report(new CollisionReport());
+        std::vector<dReal> vvalues(dof);
+        for(size_t iconfig = 0; iconfig < num; ++iconfig) {
+            std::copy(batch.vconfigs.begin()+iconfig*dof, batch.vconfigs.begin()+(iconfig+1)*dof, vvalues.begin());
+            probot->SetDOFValues(vvalues, KinBody::CLA_Nothing, _vdofindices);
+            bool bCollision = pchecker->CheckCollision(KinBodyConstPtr(probot), report);
+            batch.vdistances[iconfig] = report->minDistance;
+            if( !bCollision && _bSelfCollision ) {
+                bCollision = pchecker->CheckStandaloneSelfCollision(KinBodyConstPtr(probot));
+            }
+            batch.vcollisions[iconfig] = bCollision;
+        }
+    }
+
+    std::string _scenename, _outputname, _robotname, _manipname, _collisionname, _samplername;
+    uint64_t _numsamples;
+    int _batchsize; ///< configurations per batch handed to a worker
+    int _numthreads; ///< 0 for one per core
+    uint32_t _seed;
+    bool _bAllDOFs, _bDistance, _bSelfCollision;
+    std::vector<int> _vdofindices; ///< dofs of the robot the configurations are sampled for
+
+    boost::mutex _mutex; ///< protects _listPending, _bShutdown, _bFailed and LabelBatch::bDone
+    boost::condition _condPending, _condDone;
+    std::list<LabelBatchPtr> _listPending; ///< batches that no worker took yet
+    bool _bShutdown, _bFailed;
+};
+
+int main(int argc, char ** argv)
+{
+    OpenRAVELabelConfigs labelconfigs;
+    int ret = labelconfigs.ParseArguments(argc, argv);
+    if( ret != 0 ) {
+        return ret == 1 ? 0 : ret;
+    }
+    RaveInitialize(true);
+    try {
+        ret = labelconfigs.Run();
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_ERROR("labeling failed: %s\n", ex.what());
+        ret = 1;
+    }
+    RaveDestroy();
+    return ret;
+}
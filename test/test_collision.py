@@ -67,6 +67,50 @@ class RunCollision(EnvironmentSetup):
                     assert(check==robot.CheckSelfCollision())
                 env.Remove(robot)
 
+    def test_cachedqueries(self):
+        # queries that reuse the pairs and managers the checker cached from previous queries have to give the same results as a new checker
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            manip = robot.GetActiveManipulator()
+            mug = env.GetKinBody('mug1')
+            mug.SetTransform(manip.GetTransform())
+            robot.Grab(mug)
+            box = RaveCreateKinBody(env,'')
+            box.InitFromBoxes(array([[0,0,0,0.03,0.03,0.03]]),True)
+            box.SetName('obstacle')
+            env.Add(box,True)
+            links = [robot.GetLinks()[0], manip.GetEndEffector(), robot.GetLinks()[-1]]
+            def Query():
+                return [env.CheckCollision(robot), robot.CheckSelfCollision(), env.CheckCollision(robot,box), env.CheckCollision(mug)] + [env.CheckCollision(link) for link in links] + [env.CheckCollision(link,box) for link in links]
+
+            lower,upper = robot.GetDOFLimits()
+            values = robot.GetDOFValues()
+            states = []
+            for i in range(40):
+                if i%8 == 0:
+                    values = lower+random.rand(len(lower))*(upper-lower)
+                else:
+                    # small steps keep the objects within the margins of the cached pairs
+                    values = minimum(upper,maximum(lower,values+0.01*(random.rand(len(lower))-0.5)))
+                robot.SetDOFValues(values)
+                Tbox = box.GetTransform()
+                if i%3 == 0:
+                    # move the obstacle next to the gripper, sometimes into it
+                    Tbox = array(manip.GetTransform())
+                    Tbox[0:3,3] += 0.1*(random.rand(3)-0.5)
+                elif i%3 == 1:
+                    Tbox[0:3,3] += 0.005*(random.rand(3)-0.5)
+                box.SetTransform(Tbox)
+                states.append((values,Tbox,Query()))
+
+            for values,Tbox,results in states:
+                env.SetCollisionChecker(RaveCreateCollisionChecker(env,self.collisioncheckername))
+                robot.SetDOFValues(values)
+                box.SetTransform(Tbox)
+                assert(Query() == results)
+
     def test_selfcollision(self):
         with self.env:
             self.LoadEnv('data/lab1.env.xml')
@@ -268,6 +312,117 @@ class RunCollision(EnvironmentSetup):
         manip.CheckEndEffectorCollision(report)
         assert(len(report.vLinkColliding)==4)
 
+    def _LoadSliderAndWall(self):
+        # a box sliding along x from -2 to 2 and a thin wall at x=0.5
+        env=self.env
+        robot = env.ReadRobotXMLData("""<robot name="slider">
+          <kinbody>
+            <body name="base" type="static">
+              <geom type="box">
+                <extents>0.01 0.01 0.01</extents>
+                <translation>0 0 -1</translation>
+              </geom>
+            </body>
+            <body name="slide">
+              <geom type="box">
+                <extents>0.05 0.05 0.05</extents>
+              </geom>
+            </body>
+            <joint name="j" type="slider">
+              <body>base</body>
+              <body>slide</body>
+              <axis>1 0 0</axis>
+              <limits>-2 2</limits>
+            </joint>
+          </kinbody>
+        </robot>""")
+        env.Add(robot)
+        wall = RaveCreateKinBody(env,'')
+        wall.SetName('wall')
+        wall.InitFromBoxes(array([[0.5,0,0,0.001,0.5,0.5]]),True)
+        env.Add(wall)
+        robot.SetActiveDOFs([0])
+        return robot
+
+    def test_continuouscollision(self):
+        env=self.env
+        with env:
+            robot = self._LoadSliderAndWall()
+            # the resolution is coarser than the motion, so only the two ends are checked discretely
+            robot.SetDOFResolutions([2.0])
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            constraint = planningutils.DynamicsCollisionConstraint(params,[robot])
+            assert(constraint.Check([0],[1],[0],[0],0,Interval.Closed) == 0)
+            constraint.SetContinuousCollisionChecking(True)
+            ret = constraint.Check([0],[1],[0],[0],0,Interval.Closed)
+            if self.collisioncheckername == 'fcl_':
+                # the sweep crosses the wall
+                assert(ret != 0)
+                assert(constraint.Check([-1],[0],[0],[0],0,Interval.Closed) == 0)
+            else:
+                # checkers without continuous checks are skipped
+                assert(ret == 0)
+
+    def test_distanceboundstepping(self):
+        env=self.env
+        with env:
+            robot = self._LoadSliderAndWall()
+            robot.SetDOFResolutions([0.01])
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            constraint = planningutils.DynamicsCollisionConstraint(params,[robot])
+            segments = [([-2],[0]), ([-2],[1]), ([1],[0.2]), ([2],[0.6])]
+            results = [constraint.Check(q0,q1,[0],[0],0,Interval.Closed) for q0,q1 in segments]
+            assert(results[0] == 0 and results[1] != 0 and results[2] != 0 and results[3] == 0)
+            # skipping states within the distance bound does not change the results
+            constraint.SetDistanceBoundStepping(True)
+            constraint.ResetDistanceBoundStatistics()
+            assert([constraint.Check(q0,q1,[0],[0],0,Interval.Closed) for q0,q1 in segments] == results)
+            numdistancequeries, numchecks, numskipped = constraint.GetDistanceBoundStatistics()
+            if self.collisioncheckername == 'fcl_':
+                assert(numdistancequeries > 0 and numskipped > 0)
+
+    def test_trackedlinkpairdistances(self):
+        # the distances GetTrackedLinkPairDistances keeps between calls have to stay within the tolerance of the distances of CO_Distance
+        if self.collisioncheckername != 'fcl_':
+            return
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            manip = robot.GetActiveManipulator()
+            mug = env.GetKinBody('mug2')
+            checker = env.GetCollisionChecker()
+            lower,upper = robot.GetDOFLimits()
+            values = robot.GetDOFValues()
+            numchecked = 0
+            for i in range(40):
+                if i%10 == 0:
+                    values = lower+random.rand(len(lower))*(upper-lower)
+                else:
+                    values = minimum(upper,maximum(lower,values+0.02*(random.rand(len(lower))-0.5)))
+                robot.SetDOFValues(values)
+                if i%5 == 0:
+                    Tmug = array(manip.GetTransform())
+                    Tmug[0:3,3] += 0.4*(random.rand(3)-0.5)
+                    mug.SetTransform(Tmug)
+                if env.CheckCollision(robot,mug):
+                    continue
+                tolerance = [0,0.01][i%2]
+                lines = checker.SendCommand('GetTrackedLinkPairDistances %s %s %.15e'%(robot.GetName(),mug.GetName(),tolerance)).splitlines()
+                assert(len(lines) > 0)
+                with CollisionOptionsStateSaver(checker,CollisionOptions.Distance):
+                    for line in lines:
+                        bodyname1,linkname1,bodyname2,linkname2,distance = line.split()
+                        assert(bodyname1 == robot.GetName() and bodyname2 == mug.GetName())
+                        report = CollisionReport()
+                        env.CheckCollision(robot.GetLink(linkname1),mug.GetLink(linkname2),report=report)
+                        # the tracked distance is a lower bound that is at most tolerance below the exact one
+                        assert(float(distance) <= report.minDistance+1e-6 and report.minDistance-float(distance) <= tolerance+1e-6)
+                numchecked += 1
+            assert(numchecked > 0)
+
 #generate_classes(RunCollision, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunCollision):
@@ -282,3 +437,9 @@ class test_fcl(RunCollision):
 #     def __init__(self):
 #         RunCollision.__init__(self, 'bullet')
 # 
+
+class test_bulletcachedqueries(EnvironmentSetup):
+    # only the cached queries, the other tests of RunCollision do not pass with bullet yet
+    collisioncheckername = 'bullet'
+    setup = RunCollision.setup.im_func
+    test_cachedqueries = RunCollision.test_cachedqueries.im_func
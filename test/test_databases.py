@@ -37,6 +37,25 @@ class TestDatabases(EnvironmentSetup):
             out=ikmodule.SendCommand('LoadIKFastSolver %s %d 1'%(robot.GetName(),iktype))
             assert(out is not None)
             assert(manip.GetIkSolver() is not None)
-            
+
+    def test_reachabilityqueries(self):
+        from openravepy import pyANN
+        env=self.env
+        points = random.rand(2000,5)
+        weights = random.rand(len(points))
+        queries = random.rand(300,5)
+        nativekdtree = databases.kinematicreachability.ReachabilityQueryIndex.Create(env,points,weights,numthreads=4)
+        assert(nativekdtree is not None)
+        kdtree = pyANN.KDTree(points)
+        neighs,dists,kball = nativekdtree.kFRSearchArray(queries,0.04,8,0)
+        neighs2,dists2,kball2 = kdtree.kFRSearchArray(queries,0.04,8,0)
+        assert(all(kball==kball2))
+        assert(all(neighs[neighs2>=0]==neighs2[neighs2>=0]))
+        ibandwidth = -0.5/array([0.1,0.1,0.1,0.1,0.1])**2
+        densities = nativekdtree.kernelDensityArray(queries,0.04,8,0,ibandwidth)
+        for i in range(len(queries)):
+            inds = neighs2[i,neighs2[i,:]>=0]
+            assert(abs(densities[i]-dot(weights[inds],numpy.exp(dot((points[inds,:]-queries[i])**2,ibandwidth)))) <= 1e-7)
+
 #     def test_database_paths(self):
 #         pass
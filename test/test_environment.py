@@ -15,6 +15,7 @@ from common_test_openrave import *
 from subprocess import Popen, PIPE
 import shutil
 import threading
+import json
 
 class TestEnvironment(EnvironmentSetup):
     def test_load(self):
@@ -191,6 +192,40 @@ class TestEnvironment(EnvironmentSetup):
             assert(endtime <= 0.05)
             misc.CompareEnvironments(env,clonedenv,epsilon=g_epsilon)
             
+    def test_synchronizebodies(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            clonedenv = env.CloneSelf(CloningOptions.Bodies)
+            clonedenv.SynchronizeBodies(env)
+            misc.CompareEnvironments(env,clonedenv,epsilon=g_epsilon)
+
+            # only state changes
+            Trobot=robot.GetTransform()
+            Trobot[0,3] += 0.5
+            robot.SetTransform(Trobot)
+            lower,upper = robot.GetDOFLimits()
+            robot.SetDOFValues(0.5*(lower+upper))
+            body = [b for b in env.GetBodies() if not b.IsRobot()][0]
+            body.Enable(False)
+            clonedenv.SynchronizeBodies(env)
+            misc.CompareEnvironments(env,clonedenv,epsilon=g_epsilon)
+            assert(not clonedenv.GetKinBody(body.GetName()).IsEnabled())
+
+            # moving the clone without touching the reference is undone too
+            clonedrobot = clonedenv.GetRobot(robot.GetName())
+            clonedrobot.SetDOFValues(lower)
+            clonedenv.SynchronizeBodies(env)
+            misc.CompareEnvironments(env,clonedenv,epsilon=g_epsilon)
+
+            # adding a body makes a full clone
+            mug = env.ReadKinBodyURI('data/mug1.kinbody.xml')
+            env.Add(mug,True)
+            clonedenv.SynchronizeBodies(env)
+            misc.CompareEnvironments(env,clonedenv,epsilon=g_epsilon)
+            clonedenv.Destroy()
+
     def test_multithread(self):
         self.log.info('test multiple threads accessing same resource')
         def mythread(env,threadid):
@@ -262,3 +297,211 @@ class TestEnvironment(EnvironmentSetup):
         # thread is done, so should be able to lock
         assert(env.Lock(1.0))
         env.Unlock()
+
+    def test_profiling(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        RaveClearProfilingSpans()
+        RaveSetProfilingEnabled(True)
+        try:
+            assert(RaveIsProfilingEnabled())
+            with env:
+                robot.SetDOFValues(robot.GetDOFValues())
+                env.CheckCollision(robot)
+        finally:
+            RaveSetProfilingEnabled(False)
+        trace = json.loads(RaveGetProfilingChromeTrace())
+        names = set(event['name'] for event in trace['traceEvents'] if event['ph'] == 'X')
+        assert('SetDOFValues' in names)
+        assert('CheckCollision' in names)
+        RaveClearProfilingSpans()
+        trace = json.loads(RaveGetProfilingChromeTrace())
+        assert(len(trace['traceEvents']) == 0)
+
+    def test_perfcounters(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        checker=env.GetCollisionChecker()
+        checker.ResetPerfCounters()
+        with env:
+            env.CheckCollision(robot)
+        counters = checker.GetPerfCounters()
+        assert(counters['collision.queries'][0] > 0)
+        lines = checker.SendCommand('GetPerfCounters').splitlines()
+        assert(any(line.split()[0] == 'collision.queries' for line in lines))
+        checker.ResetPerfCounters()
+        assert(checker.GetPerfCounters()['collision.queries'] == (0,0))
+
+    def test_mutexstatistics(self):
+        env=self.env
+        env.ResetMutexStatistics()
+        env.SetMutexInstrumentationEnabled(True)
+        try:
+            with env:
+                holder = env.GetMutexHolder()
+                assert(holder is not None and holder[2] >= 0)
+                time.sleep(0.01)
+        finally:
+            env.SetMutexInstrumentationEnabled(False)
+        assert(env.GetMutexHolder() is None)
+        statistics = env.GetMutexStatistics()
+        assert(sum(stat['numAcquisitions'] for stat in statistics) > 0)
+        assert(max(stat['maxHoldTime'] for stat in statistics) >= 10000000)
+        for stat in statistics:
+            assert(sum(stat['holdHistogram']) <= stat['numAcquisitions'])
+        env.ResetMutexStatistics()
+        assert(len(env.GetMutexStatistics()) <= 1) # only the current holder is kept
+
+    def test_addbodies(self):
+        env=self.env
+        with env:
+            bodies = []
+            for i in range(20):
+                body = RaveCreateKinBody(env,'')
+                body.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+                body.SetName('parcel')
+                bodies.append(body)
+            env.AddBodies(bodies, True)
+            assert(len(env.GetBodies()) == 20)
+            assert(len(set(body.GetName() for body in env.GetBodies())) == 20)
+            assert(all(body.GetEnvironmentId() > 0 for body in bodies))
+            assert(env.CheckCollision(bodies[0]))
+            assert(env.RemoveBodies(bodies[::2]) == 10)
+            assert(len(env.GetBodies()) == 10)
+            assert(bodies[0].GetEnvironmentId() == 0)
+            assert(env.GetKinBody(bodies[1].GetName()) == bodies[1])
+            assert(env.RemoveBodies(bodies) == 10)
+            assert(len(env.GetBodies()) == 0)
+
+    def test_bodiesinaabb(self):
+        env=self.env
+        with env:
+            env.SetSpatialGridCellSize(0.5)
+            assert(env.GetSpatialGridCellSize() == 0.5)
+            bodies = []
+            for i in range(10):
+                body = RaveCreateKinBody(env,'')
+                body.InitFromBoxes(array([[0,0,0,0.05,0.05,0.05]]),True)
+                body.SetName('parcel%d'%i)
+                body.SetTransform(matrixFromPose([1,0,0,0,i,0,0]))
+                bodies.append(body)
+            env.AddBodies(bodies)
+            floor = RaveCreateKinBody(env,'')
+            floor.InitFromBoxes(array([[0,0,-0.1,100,100,0.05]]),True)
+            floor.SetName('floor')
+            env.Add(floor)
+            found = env.GetBodiesInAABB(AABB([3,0,0],[0.1,0.1,0.1]))
+            assert(len(found) == 1 and found[0] == bodies[3])
+            bodies[3].SetTransform(matrixFromPose([1,0,0,0,20,0,0]))
+            assert(len(env.GetBodiesInAABB(AABB([3,0,0],[0.1,0.1,0.1]))) == 0)
+            assert(env.GetBodiesInAABB(AABB([20,0,0],[0.1,0.1,0.1]))[0] == bodies[3])
+            bodies[4].Enable(False)
+            assert(len(env.GetBodiesInAABB(AABB([4,0,0],[0.1,0.1,0.1]))) == 0)
+            found = env.GetBodiesInAABB(AABB([5,0,-0.1],[0.1,0.1,0.1]))
+            assert(len(found) == 2 and floor in found and bodies[5] in found)
+            env.Remove(bodies[5])
+            assert(env.GetBodiesInAABB(AABB([5,0,0],[0.1,0.1,0.1])) == [])
+
+    def test_scenecache(self):
+        self.log.info('bodies loaded from the scene cache are the same as the parsed ones')
+        import tempfile
+        xml = """<robot name="cachearm">
+  <kinbody>
+    <body name="base">
+      <geom type="box"><extents>0.1 0.1 0.1</extents></geom>
+    </body>
+    <body name="link1">
+      <offsetfrom>base</offsetfrom>
+      <translation>0 0 0.3</translation>
+      <geom type="box"><extents>0.05 0.05 0.2</extents></geom>
+    </body>
+    <body name="link2">
+      <offsetfrom>link1</offsetfrom>
+      <translation>0 0 0.4</translation>
+      <geom type="box"><extents>0.05 0.05 0.2</extents></geom>
+    </body>
+    <joint name="j1" type="hinge">
+      <body>base</body><body>link1</body>
+      <offsetfrom>link1</offsetfrom><anchor>0 0 -0.2</anchor>
+      <axis>0 1 0</axis><limitsdeg>-90 90</limitsdeg>
+    </joint>
+    <joint name="j2" type="hinge">
+      <body>link1</body><body>link2</body>
+      <offsetfrom>link2</offsetfrom><anchor>0 0 -0.2</anchor>
+      <axis>0 1 0</axis><limitsdeg>-120 120</limitsdeg>
+    </joint>
+  </kinbody>
+  <manipulator name="arm">
+    <base>base</base><effector>link2</effector>
+    <translation>0 0 0.2</translation>
+  </manipulator>
+</robot>
+"""
+        cachedir = tempfile.mkdtemp()
+        robotfilename = os.path.join(cachedir,'cachearm.robot.xml')
+        open(robotfilename,'w').write(xml)
+        def getcachefiles():
+            return [os.path.join(cachedir,f) for f in os.listdir(cachedir) if f.endswith('.scenecache')]
+        
+        OPENRAVE_SCENE_CACHE = os.environ.get('OPENRAVE_SCENE_CACHE',None)
+        os.environ['OPENRAVE_SCENE_CACHE'] = cachedir # read by new environments
+        envs = []
+        try:
+            # the first load writes the cache, the second one reads it so does not replace the file
+            cacheinodes = []
+            for ienv in range(2):
+                env2 = Environment()
+                envs.append(env2)
+                assert(env2.Load(robotfilename))
+                cachefiles = getcachefiles()
+                assert(len(cachefiles) == 1)
+                cacheinodes.append(os.stat(cachefiles[0]).st_ino)
+            assert(cacheinodes[0] == cacheinodes[1])
+            
+            misc.CompareEnvironments(envs[0],envs[1],epsilon=g_epsilon)
+            robot = envs[0].GetRobot('cachearm')
+            cachedrobot = envs[1].GetRobot('cachearm')
+            assert(robot.GetRobotStructureHash() == cachedrobot.GetRobotStructureHash())
+            assert(robot.GetURI() == cachedrobot.GetURI())
+            assert(set(robot.GetNonAdjacentLinks()) == set(cachedrobot.GetNonAdjacentLinks()))
+            assert(transdist(robot.GetDOFLimits(),cachedrobot.GetDOFLimits()) <= g_epsilon)
+            assert(len(cachedrobot.GetManipulators()) == 1)
+            manip = robot.GetManipulators()[0]
+            cachedmanip = cachedrobot.GetManipulators()[0]
+            assert(manip.GetName() == cachedmanip.GetName())
+            assert(list(manip.GetArmIndices()) == list(cachedmanip.GetArmIndices()))
+            assert(transdist(manip.GetLocalToolTransform(),cachedmanip.GetLocalToolTransform()) <= g_epsilon)
+            with envs[0]:
+                with envs[1]:
+                    initialvalues = robot.GetDOFValues()
+                    lower,upper = robot.GetDOFLimits()
+                    for values in [lower, upper, 0.5*(lower+upper)]:
+                        robot.SetDOFValues(values)
+                        cachedrobot.SetDOFValues(values)
+                        assert(transdist(robot.GetLinkTransformations(),cachedrobot.GetLinkTransformations()) <= g_epsilon)
+                        assert(transdist(manip.GetTransform(),cachedmanip.GetTransform()) <= g_epsilon)
+                        assert(envs[0].CheckCollision(robot) == envs[1].CheckCollision(cachedrobot))
+                        assert(robot.CheckSelfCollision() == cachedrobot.CheckSelfCollision())
+                    robot.SetDOFValues(initialvalues)
+                    cachedrobot.SetDOFValues(initialvalues)
+            
+            # a cache that cannot be read is replaced by the parsed bodies
+            open(cachefiles[0],'wb').write('not a scene cache')
+            env2 = Environment()
+            envs.append(env2)
+            assert(env2.Load(robotfilename))
+            misc.CompareEnvironments(envs[0],env2,epsilon=g_epsilon)
+            assert(env2.GetRobot('cachearm').GetRobotStructureHash() == robot.GetRobotStructureHash())
+            cachefiles = getcachefiles()
+            assert(len(cachefiles) == 1)
+            assert(os.stat(cachefiles[0]).st_ino != cacheinodes[0])
+        finally:
+            for env2 in envs:
+                env2.Destroy()
+            if OPENRAVE_SCENE_CACHE is None:
+                del os.environ['OPENRAVE_SCENE_CACHE']
+            else:
+                os.environ['OPENRAVE_SCENE_CACHE'] = OPENRAVE_SCENE_CACHE
+            shutil.rmtree(cachedir)
@@ -94,6 +94,161 @@ class TestIkSolver(EnvironmentSetup):
             sampler=planningutils.ManipulatorIKGoalSampler(robot.GetActiveManipulator(),[ikparam],nummaxsamples=20,nummaxtries=10,jitter=0.03)
             assert(sampler.Sample() is not None)
 
+    def test_freesweepparallel(self):
+        self.log.info('check that the parallel free joint sweep gives the same solutions and goal samples as the serial one')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot,IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+
+        with env:
+            manip = ikmodel.manip
+            iksolver = manip.GetIkSolver()
+            assert(iksolver.GetNumFreeParameters() > 0)
+            lower,upper = robot.GetDOFLimits(manip.GetArmIndices())
+            orgvalues = robot.GetDOFValues()
+            ikparams = []
+            for i in range(10):
+                robot.SetDOFValues(lower+random.rand(len(lower))*(upper-lower),manip.GetArmIndices())
+                ikparams.append(manip.GetIkParameterization(IkParameterization.Type.Transform6D))
+            robot.SetDOFValues(orgvalues)
+            results = []
+            for numthreads in [1,4]:
+                assert(iksolver.SendCommand('SetFreeSweepNumThreads %d'%numthreads) is not None)
+                sols = [manip.FindIKSolution(ikparam,IkFilterOptions.CheckEnvCollisions) for ikparam in ikparams]
+                allsols = [manip.FindIKSolutions(ikparam,IkFilterOptions.CheckEnvCollisions) for ikparam in ikparams]
+                sampler = planningutils.ManipulatorIKGoalSampler(manip,ikparams,nummaxsamples=20,nummaxtries=10,jitter=0)
+                samples = [sampler.Sample() for i in range(5)]
+                results.append((sols,allsols,samples))
+            iksolver.SendCommand('SetFreeSweepNumThreads 1')
+            for serial, parallel in zip(results[0],results[1]):
+                assert(len(serial) == len(parallel))
+                for value0, value1 in zip(serial,parallel):
+                    assert((value0 is None) == (value1 is None))
+                    if value0 is not None:
+                        assert(len(value0) == len(value1))
+                        assert(transdist(value0,value1) <= g_epsilon)
+
+    def test_numericalik(self):
+        self.log.info('check that the numerical ik solver reaches reachable poses along a path')
+        env=self.env
+        robot=self.LoadRobot('robots/barrettwam.robot.xml')
+        with env:
+            manip = robot.GetActiveManipulator()
+            iksolver = RaveCreateIkSolver(env,'numericalik')
+            assert(iksolver is not None)
+            manip.SetIkSolver(iksolver)
+            assert(manip.GetIkSolver().Supports(IkParameterization.Type.Transform6D))
+            lower,upper = robot.GetDOFLimits(manip.GetArmIndices())
+            orgvalues = robot.GetDOFValues()
+            values = lower+0.5*(upper-lower)
+            robot.SetDOFValues(values,manip.GetArmIndices())
+            # a small step from the current configuration converges from the current configuration
+            robot.SetDOFValues(values+0.05,manip.GetArmIndices())
+            Tgoal = manip.GetTransform()
+            robot.SetDOFValues(values,manip.GetArmIndices())
+            sol = manip.FindIKSolution(Tgoal,IkFilterOptions.IgnoreSelfCollisions)
+            assert(sol is not None)
+            assert(all(sol >= lower-g_epsilon) and all(sol <= upper+g_epsilon))
+            robot.SetDOFValues(sol,manip.GetArmIndices())
+            assert(transdist(manip.GetTransform(),Tgoal) <= 1e-4)
+            robot.SetDOFValues(values,manip.GetArmIndices())
+
+            # a batch along a path warm starts every pose from the previous solution
+            ikparams = []
+            for i in range(10):
+                robot.SetDOFValues(values+0.02*i,manip.GetArmIndices())
+                ikparams.append(manip.GetIkParameterization(IkParameterization.Type.Transform6D))
+            robot.SetDOFValues(values,manip.GetArmIndices())
+            allikreturns = manip.GetIkSolver().SolveAllBatch(ikparams,IkFilterOptions.IgnoreSelfCollisions)
+            assert(len(allikreturns) == len(ikparams))
+            for ikparam, ikreturns in zip(ikparams,allikreturns):
+                assert(len(ikreturns) == 1)
+                robot.SetDOFValues(ikreturns[0].GetSolution(),manip.GetArmIndices())
+                assert(transdist(manip.GetTransform(),ikparam.GetTransform6D()) <= 1e-4)
+
+            # translation only
+            robot.SetDOFValues(values+0.1,manip.GetArmIndices())
+            ikparam = manip.GetIkParameterization(IkParameterization.Type.Translation3D)
+            robot.SetDOFValues(values,manip.GetArmIndices())
+            sol = manip.FindIKSolution(ikparam,IkFilterOptions.IgnoreSelfCollisions)
+            assert(sol is not None)
+            robot.SetDOFValues(sol,manip.GetArmIndices())
+            assert(transdist(manip.GetTransform()[0:3,3],ikparam.GetTranslation3D()) <= 1e-4)
+            robot.SetDOFValues(orgvalues)
+
+    def test_goalsamplerparallel(self):
+        self.log.info('check that the parallel SampleAll returns the same goals as the serial one')
+        env=self.env
+        robot=self.LoadRobot('robots/kuka-kr5-r650.zae')
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot,IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+
+        with env:
+            manip = ikmodel.manip
+            lower,upper = robot.GetDOFLimits(manip.GetArmIndices())
+            orgvalues = robot.GetDOFValues()
+            ikparams = []
+            for i in range(12):
+                robot.SetDOFValues(lower+random.rand(len(lower))*(upper-lower),manip.GetArmIndices())
+                ikparams.append(manip.GetIkParameterization(IkParameterization.Type.Transform6D))
+            robot.SetDOFValues(orgvalues)
+            results = []
+            for numthreads in [1,3]:
+                sampler = planningutils.ManipulatorIKGoalSampler(manip,ikparams,nummaxsamples=20,nummaxtries=10,jitter=0)
+                sampler.SetNumThreads(numthreads)
+                ikreturns = sampler.SampleAll()
+                # the threads return the goals in the order they finish, so only compare the set of goals of every parameterization
+                goals = sorted([(sampler.GetIkParameterizationIndex(i), tuple(round(value,6) for value in ikreturn.GetSolution())) for i, ikreturn in enumerate(ikreturns)])
+                results.append(goals)
+                # all the parameterizations were consumed
+                assert(len(sampler.SampleAll()) == 0)
+            assert(len(results[0]) > 0)
+            assert(results[0] == results[1])
+            assert(transdist(robot.GetDOFValues(),orgvalues) <= g_epsilon)
+
+    def test_solutioncache(self):
+        self.log.info('check that the SolveAll cache only returns solutions of the same pose and state')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot,IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+
+        with env:
+            manip = ikmodel.manip
+            iksolver = manip.GetIkSolver()
+            lower,upper = robot.GetDOFLimits(manip.GetArmIndices())
+            orgvalues = robot.GetDOFValues()
+            robot.SetDOFValues(lower+0.4*(upper-lower),manip.GetArmIndices())
+            Tee = manip.GetTransform()
+            robot.SetDOFValues(orgvalues)
+            # a coarse quantization puts both poses in the same cache entry
+            Tee2 = array(Tee)
+            Tee2[0,3] += 0.001
+            ikparam = IkParameterization(Tee,IkParameterization.Type.Transform6D)
+            ikparam2 = IkParameterization(Tee2,IkParameterization.Type.Transform6D)
+            expected = [manip.FindIKSolutions(p,IkFilterOptions.CheckEnvCollisions) for p in [ikparam,ikparam2,ikparam]]
+            expectedself = manip.FindIKSolutions(ikparam,IkFilterOptions.IgnoreSelfCollisions)
+            try:
+                assert(iksolver.SendCommand('SetSolutionCache 10 0.1') is not None)
+                for p, sols in zip([ikparam,ikparam2,ikparam],expected):
+                    cachedsols = manip.FindIKSolutions(p,IkFilterOptions.CheckEnvCollisions)
+                    assert(len(cachedsols) == len(sols))
+                    for sol, cachedsol in zip(sols,cachedsols):
+                        assert(transdist(sol,cachedsol) <= g_epsilon)
+                # the filter options are part of the key
+                cachedsols = manip.FindIKSolutions(ikparam,IkFilterOptions.IgnoreSelfCollisions)
+                assert(len(cachedsols) == len(expectedself))
+                for sol, cachedsol in zip(expectedself,cachedsols):
+                    assert(transdist(sol,cachedsol) <= g_epsilon)
+            finally:
+                iksolver.SendCommand('SetSolutionCache 0')
+
     def test_jointlimitsfilter(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
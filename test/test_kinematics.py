@@ -527,6 +527,73 @@ class TestKinematics(EnvironmentSetup):
                         assert( transdist(-torquegravity, gravitypartials) < 0.1*deltastep*len(gravitypartials))
                         assert( transdist(torquegravity, testtorque_e-testtorque_e2) <= 1e-10 )
 
+    def test_jacobians(self):
+        self.log.info('check that computing the jacobians of several links at once matches computing them one by one')
+        env=self.env
+        for envfile in g_robotfiles:
+            env.Reset()
+            self.LoadEnv(envfile,{'skipgeometry':'1'})
+            for body in env.GetBodies():
+                if body.GetDOF() == 0:
+                    continue
+                lowerlimit,upperlimit = body.GetDOFLimits()
+                body.SetDOFValues(randlimits(lowerlimit, upperlimit))
+                linkindices = list(range(len(body.GetLinks())))
+                positions = [link.GetTransform()[0:3,3]+random.rand(3)-0.5 for link in body.GetLinks()]
+                Jts,Jas = body.ComputeJacobians(linkindices,positions)
+                for ilink in linkindices:
+                    assert(transdist(Jts[ilink],body.ComputeJacobianTranslation(ilink,positions[ilink])) <= g_epsilon)
+                    assert(transdist(Jas[ilink],body.ComputeJacobianAxisAngle(ilink)) <= g_epsilon)
+                Jts2,Jas2,Hts,Has = body.ComputeJacobiansAndHessians(linkindices,positions)
+                assert(numpy.max(abs(Jts-Jts2)) <= g_epsilon)
+                assert(numpy.max(abs(Jas-Jas2)) <= g_epsilon)
+                if len(body.GetPassiveJoints()) == 0:
+                    for ilink in linkindices:
+                        assert(numpy.max(abs(Hts[ilink]-body.ComputeHessianTranslation(ilink,positions[ilink]))) <= g_epsilon)
+                        assert(numpy.max(abs(Has[ilink]-body.ComputeHessianAxisAngle(ilink))) <= g_epsilon)
+
+    def test_batchkinematics(self):
+        self.log.info('check that the batched kinematics and collision functions match calling them one configuration at a time')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            lower,upper = robot.GetDOFLimits()
+            initialvalues = robot.GetDOFValues()
+            numconfigs = 10
+            values = array([randlimits(lower, upper) for i in range(numconfigs)])
+            transforms = zeros((numconfigs,len(robot.GetLinks()),7))
+            robot.ComputeLinkTransformationsBatch(values, transforms)
+            assert(transdist(robot.GetDOFValues(), initialvalues) <= g_epsilon)
+            ilink = len(robot.GetLinks())-1
+            localposition = [0.1,0.2,0.3]
+            jacobians = zeros((numconfigs,3,robot.GetDOF()))
+            robot.ComputeJacobianTranslationBatch(ilink, localposition, values, jacobians)
+            collisions = zeros(numconfigs, dtype=bool)
+            robot.CheckCollisionBatch(values, collisions)
+            for i in range(numconfigs):
+                robot.SetDOFValues(values[i])
+                for j,link in enumerate(robot.GetLinks()):
+                    assert(transdist(matrixFromPose(transforms[i,j]), link.GetTransform()) <= g_epsilon)
+                position = transformPoints(robot.GetLinks()[ilink].GetTransform(), [localposition])[0]
+                assert(transdist(jacobians[i], robot.ComputeJacobianTranslation(ilink, position)) <= g_epsilon)
+                assert(collisions[i] == (env.CheckCollision(robot) or robot.CheckSelfCollision()))
+
+    def test_arrayviews(self):
+        self.log.info('check that the read-only views of the body state match the copied values')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            lower,upper = robot.GetDOFLimits()
+            robot.SetDOFValues(randlimits(lower, upper))
+            dofvalues = robot.GetDOFValuesView()
+            assert(not dofvalues.flags.writeable)
+            assert(transdist(dofvalues, robot.GetDOFValues()) <= g_epsilon)
+            linkposes = robot.GetLinkTransformationsView()
+            assert(not linkposes.flags.writeable)
+            assert(transdist(linkposes, robot.GetLinkTransformationsArrays()) <= g_epsilon)
+
     def test_hessian(self):
         self.log.info('check the jacobian and hessian computation')
         env=self.env
@@ -876,6 +943,167 @@ class TestKinematics(EnvironmentSetup):
         assert(J0a.GetMimicDOFIndices() == [0])
         assert(J0b.GetMimicDOFIndices() == [0])
 
+    def test_incrementalfk(self):
+        self.log.info('check that setting a subset of the dof values gives the same link transforms as computing all of them')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            lower,upper = robot.GetDOFLimits()
+            robot.SetDOFValues(lower+0.3*(upper-lower))
+            for i in range(20):
+                values = robot.GetDOFValues()
+                dofindex = i%robot.GetDOF()
+                values[dofindex] = lower[dofindex]+random.rand()*(upper[dofindex]-lower[dofindex])
+                robot.SetDOFValues(values)
+                incrementaltransforms = robot.GetLinkTransformations()
+                # moving the base forces all the links to be computed
+                robot.SetTransform(robot.GetTransform())
+                robot.SetDOFValues(values)
+                for T0,T1 in zip(incrementaltransforms,robot.GetLinkTransformations()):
+                    assert(transdist(T0,T1) <= g_epsilon)
+                # setting the same values does not move anything
+                stamp = robot.GetUpdateStamp()
+                robot.SetDOFValues(values)
+                assert(robot.GetUpdateStamp() == stamp)
+
+
+    def test_incrementalfkmovebase(self):
+        self.log.info('check that moving the base with SetDOFValues moves the grabbed bodies')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            manip = robot.GetActiveManipulator()
+            mug = env.GetKinBody('mug1')
+            mug.SetTransform(manip.GetEndEffectorTransform())
+            robot.Grab(mug)
+            Trelative = dot(linalg.inv(manip.GetEndEffectorTransform()),mug.GetTransform())
+            values = robot.GetDOFValues()
+            robot.SetDOFValues(values)
+            stamp = robot.GetUpdateStamp()
+            T = robot.GetTransform()
+            T[0,3] += 0.1
+            robot.SetTransformWithDOFValues(T,values)
+            assert(robot.GetUpdateStamp() != stamp)
+            assert(transdist(T,robot.GetTransform()) <= g_epsilon)
+            assert(transdist(dot(manip.GetEndEffectorTransform(),Trelative),mug.GetTransform()) <= g_epsilon)
+            # moving the base and one joint at once
+            values[manip.GetArmIndices()[0]] += 0.1
+            T[1,3] += 0.1
+            robot.SetTransformWithDOFValues(T,values)
+            assert(transdist(dot(manip.GetEndEffectorTransform(),Trelative),mug.GetTransform()) <= g_epsilon)
+
+    def test_fkfast(self):
+        self.log.info('check that the generated forward kinematics give the same link transforms as SetDOFValues')
+        from openravepy import fkfast
+        import tempfile, shutil, subprocess
+        env=self.env
+        xmldata = """<kinbody name="%s">
+  <body name="base">
+    <geom type="box"><extents>0.1 0.1 0.1</extents></geom>
+  </body>
+  <body name="l1">
+    <offsetfrom>base</offsetfrom>
+    <translation>0 0 0.2</translation>
+    <geom type="box"><extents>0.05 0.05 0.1</extents></geom>
+  </body>
+  <body name="l2">
+    <offsetfrom>l1</offsetfrom>
+    <translation>0.2 0 0.1</translation>
+    <rotationaxis>1 0 0 30</rotationaxis>
+    <geom type="box"><extents>0.1 0.02 0.02</extents></geom>
+  </body>
+  <body name="l3">
+    <offsetfrom>l2</offsetfrom>
+    <translation>0 0.2 0</translation>
+    <geom type="box"><extents>0.02 0.1 0.02</extents></geom>
+  </body>
+  <body name="l4">
+    <offsetfrom>base</offsetfrom>
+    <translation>0 0.3 0</translation>
+    <geom type="box"><extents>0.02 0.02 0.02</extents></geom>
+  </body>
+  <joint name="j1" type="hinge">
+    <body>base</body><body>l1</body>
+    <offsetfrom>l1</offsetfrom>
+    <axis>0 0 1</axis>
+    <limitsdeg>-90 90</limitsdeg>
+  </joint>
+  <joint name="j2" type="slider">
+    <body>l1</body><body>l2</body>
+    <offsetfrom>l2</offsetfrom>
+    <axis>1 0 0</axis>
+    <limits>-0.1 0.1</limits>
+  </joint>
+  <joint name="f3" type="hinge" enable="false">
+    <body>l2</body><body>l3</body>
+    <offsetfrom>l3</offsetfrom>
+    <axis>0 1 0</axis>
+    <limitsdeg>20 20</limitsdeg>
+  </joint>
+  <joint name="f4" type="hinge" enable="false">
+    <body>base</body><body>l4</body>
+    <offsetfrom>l4</offsetfrom>
+    <axis>1 0 0</axis>
+    <limitsdeg>0 0</limitsdeg>
+  </joint>
+</kinbody>"""
+        tempdir = tempfile.mkdtemp()
+        try:
+            with env:
+                body = env.ReadKinBodyXMLData(xmldata%'fkbody')
+                env.Add(body)
+                refbody = env.ReadKinBodyXMLData(xmldata%'refbody')
+                env.Add(refbody)
+                assert(len(body.GetPassiveJoints()) == 2 and all([joint.IsStatic() for joint in body.GetPassiveJoints()]))
+                code = fkfast.ForwardKinematicsGenerator(body).generate()
+            sourcefile = os.path.join(tempdir,'fk.cpp')
+            libraryfile = os.path.join(tempdir,'fk.so')
+            open(sourcefile,'w').write(code)
+            assert(subprocess.call(['g++','-O2','-fPIC','-shared',sourcefile,'-o',libraryfile]) == 0)
+            module = RaveCreateModule(env,'ikfast')
+            env.Add(module)
+            with env:
+                assert(module.SendCommand('AddFkLibrary %s %s'%(body.GetName(),libraryfile)) is not None)
+                T = matrixFromAxisAngle([0.1,0.2,0.3])
+                T[0:3,3] = [0.5,-0.2,0.1]
+                body.SetTransform(T)
+                refbody.SetTransform(T)
+                lower,upper = body.GetDOFLimits()
+                for i in range(20):
+                    values = lower+random.rand(body.GetDOF())*(upper-lower)
+                    body.SetDOFValues(values)
+                    refbody.SetDOFValues(values)
+                    for T0,T1 in izip(body.GetLinkTransformations(),refbody.GetLinkTransformations()):
+                        assert(transdist(T0,T1) <= g_epsilon)
+        finally:
+            shutil.rmtree(tempdir)
+
+    def test_statesaverdofvalues(self):
+        self.log.info('check that state savers restore the link transforms when only the dof values were saved')
+        env=self.env
+        with env:
+            self.LoadEnv('data/lab1.env.xml')
+            robot = env.GetRobots()[0]
+            lower,upper = robot.GetDOFLimits()
+            robot.SetDOFValues(lower+0.3*(upper-lower))
+            savedtransforms = robot.GetLinkTransformations()
+            for i in range(10):
+                with robot.CreateKinBodyStateSaver():
+                    robot.SetDOFValues(lower+random.rand(robot.GetDOF())*(upper-lower))
+                    if i%2 == 1:
+                        T = robot.GetTransform()
+                        T[0:3,3] += random.rand(3)
+                        robot.SetTransform(T)
+                for T0,T1 in zip(savedtransforms,robot.GetLinkTransformations()):
+                    assert(transdist(T0,T1) <= g_epsilon)
+            # nothing changed, so restoring does not move anything
+            stamp = robot.GetUpdateStamp()
+            with robot.CreateKinBodyStateSaver():
+                pass
+            assert(robot.GetUpdateStamp() == stamp)
+
     def test_specification(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
@@ -1123,3 +1351,68 @@ class TestKinematics(EnvironmentSetup):
         assert(robot.CheckSelfCollision())
         robot.SetNonCollidingConfiguration()
         assert(not robot.CheckSelfCollision())
+
+    def test_clonehierarchy(self):
+        self.log.info('clones keep the hierarchy of their reference, and it has to be the one the reference computed')
+        env=self.env
+        for robotfile in g_robotfiles+['testdata/bobcat.robot.xml']:
+            env.Reset()
+            self.LoadEnv(robotfile)
+            clonedenv = env.CloneSelf(CloningOptions.Bodies)
+            try:
+                with env:
+                    with clonedenv:
+                        for body in env.GetBodies():
+                            clonedbody = clonedenv.GetKinBody(body.GetName())
+                            assert(body.GetKinematicsGeometryHash() == clonedbody.GetKinematicsGeometryHash())
+                            
+                            # all the copied joints belong to the clone
+                            orderedjoints = clonedbody.GetDependencyOrderedJoints()
+                            assert([joint.GetName() for joint in orderedjoints] == [joint.GetName() for joint in body.GetDependencyOrderedJoints()])
+                            assert(all([joint.GetParent() == clonedbody for joint in orderedjoints]))
+                            for idof in range(body.GetDOF()):
+                                clonedjoint = clonedbody.GetJointFromDOFIndex(idof)
+                                assert(clonedjoint.GetParent() == clonedbody)
+                                assert(clonedjoint.GetName() == body.GetJointFromDOFIndex(idof).GetName())
+                            
+                            for ijoint in range(len(body.GetJoints())):
+                                for ilink in range(len(body.GetLinks())):
+                                    assert(body.DoesAffect(ijoint,ilink) == clonedbody.DoesAffect(ijoint,ilink))
+                            for ilink0,ilink1 in combinations(range(len(body.GetLinks())),2):
+                                assert([joint.GetName() for joint in body.GetChain(ilink0,ilink1,returnjoints=True)] == [joint.GetName() for joint in clonedbody.GetChain(ilink0,ilink1,returnjoints=True)])
+                                assert([link.GetIndex() for link in body.GetChain(ilink0,ilink1,returnjoints=False)] == [link.GetIndex() for link in clonedbody.GetChain(ilink0,ilink1,returnjoints=False)])
+                            for link, clonedlink in izip(body.GetLinks(),clonedbody.GetLinks()):
+                                assert([parent.GetIndex() for parent in link.GetParentLinks()] == [parent.GetIndex() for parent in clonedlink.GetParentLinks()])
+                                assert(set([attached.GetIndex() for attached in link.GetRigidlyAttachedLinks()]) == set([attached.GetIndex() for attached in clonedlink.GetRigidlyAttachedLinks()]))
+                            def getloopnames(b):
+                                return [[(link.GetName(), joint.GetName() if joint is not None else None) for link,joint in loop] for loop in b.GetClosedLoops()]
+                            assert(getloopnames(body) == getloopnames(clonedbody))
+                            assert(set(body.GetAdjacentLinks()) == set(clonedbody.GetAdjacentLinks()))
+                            
+                            # the clone keeps the non-adjacent links instead of checking every link pair again
+                            assert(set(body.GetNonAdjacentLinks()) == set(clonedbody.GetNonAdjacentLinks()))
+                            assert(set(body.GetNonAdjacentLinks(KinBody.AdjacentOptions.Enabled)) == set(clonedbody.GetNonAdjacentLinks(KinBody.AdjacentOptions.Enabled)))
+                            
+                            if body.GetDOF() > 0:
+                                lower,upper = body.GetDOFLimits()
+                                lower = maximum(lower,-pi)
+                                upper = minimum(upper,pi)
+                                for i in range(5):
+                                    values = lower+random.rand(len(lower))*(upper-lower)
+                                    body.SetDOFValues(values)
+                                    clonedbody.SetDOFValues(values)
+                                    assert(transdist(body.GetLinkTransformations(),clonedbody.GetLinkTransformations()) <= g_epsilon)
+                                    assert(body.CheckSelfCollision() == clonedbody.CheckSelfCollision())
+                        
+                        # adding the clone again recomputes its hierarchy, which has to give the copied one
+                        body = env.GetBodies()[0]
+                        clonedbody = clonedenv.GetKinBody(body.GetName())
+                        clonedenv.Remove(clonedbody)
+                        clonedenv.Add(clonedbody)
+                        assert([joint.GetName() for joint in clonedbody.GetDependencyOrderedJoints()] == [joint.GetName() for joint in body.GetDependencyOrderedJoints()])
+                        for ijoint in range(len(body.GetJoints())):
+                            for ilink in range(len(body.GetLinks())):
+                                assert(body.DoesAffect(ijoint,ilink) == clonedbody.DoesAffect(ijoint,ilink))
+                        assert(set(body.GetAdjacentLinks()) == set(clonedbody.GetAdjacentLinks()))
+            finally:
+                clonedenv.Destroy()
@@ -19,6 +19,27 @@ class RunPlanning(EnvironmentSetup):
     def setup(self):
         EnvironmentSetup.setup(self)
         self.env.SetCollisionChecker(RaveCreateCollisionChecker(self.env,self.collisioncheckername))
+
+    def _LoadLab1ArmGoal(self):
+        # loads lab1 and returns the robot with its arm active and a goal that cannot be reached with a straight line
+        self.LoadEnv('data/lab1.env.xml')
+        robot = self.env.GetRobots()[0]
+        robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+        goal = robot.GetActiveDOFValues()
+        goal[0] += 0.8
+        goal[1] -= 0.4
+        return robot, goal
+
+    def _PlanToGoal(self,plannername,robot,params,goal):
+        # plans with plannername and checks that the trajectory ends at goal and satisfies the constraints of params
+        planner = RaveCreatePlanner(self.env,plannername)
+        assert(planner.InitPlan(robot,params))
+        traj = RaveCreateTrajectory(self.env,'')
+        status = planner.PlanPath(traj)
+        assert(status.statusCode == PlannerStatusCode.HasSolution)
+        assert(sum(abs(traj.GetWaypoint(-1,robot.GetActiveConfigurationSpecification())-goal)) <= g_epsilon)
+        planningutils.VerifyTrajectory(params,traj,samplingstep=0.002)
+        return traj, status
         
     def test_basicplanning(self):
         env = self.env
@@ -50,6 +71,238 @@ class RunPlanning(EnvironmentSetup):
             useddofindices, usedconfigindices = spec.ExtractUsedIndices(robot)
             assert(sorted(useddofindices) == sorted(manip.GetArmIndices()))
             
+    def test_birrtflatnearestneighbor(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            vwaypoints = []
+            for nearestneighbortype in [0,1]:
+                params = Planner.PlannerParameters()
+                params.SetRobotActiveJoints(robot)
+                params.SetGoalConfig(goal)
+                params.SetRandomGeneratorSeed(10)
+                params.SetExtraParameters('<nearestneighbortype>%d</nearestneighbortype>'%nearestneighbortype)
+                traj, status = self._PlanToGoal('birrt',robot,params,goal)
+                vwaypoints.append(traj.GetWaypoints(0,traj.GetNumWaypoints(),robot.GetActiveConfigurationSpecification()))
+            # both backends return the exact nearest neighbor, so the same seed grows the same trees
+            assert(len(vwaypoints[0]) == len(vwaypoints[1]))
+            assert(sum(abs(vwaypoints[0]-vwaypoints[1])) <= g_epsilon*len(vwaypoints[0]))
+
+    def test_birrtparallelworkers(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetGoalConfig(goal)
+            params.SetExtraParameters('<parallelworkers>3</parallelworkers>')
+            initialvalues = robot.GetDOFValues()
+            numbodies = len(env.GetBodies())
+            traj, status = self._PlanToGoal('birrt',robot,params,goal)
+            # the workers plan on clones, so the robot and the environment of the caller are not touched
+            assert(sum(abs(robot.GetDOFValues()-initialvalues)) <= g_epsilon)
+            assert(len(env.GetBodies()) == numbodies)
+
+    def test_birrtdeterministicparallel(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetGoalConfig(goal)
+            params.SetRandomGeneratorSeed(10)
+            params.SetDeterministicParallel(True)
+            params.SetExtraParameters('<parallelworkers>3</parallelworkers>')
+            vwaypoints = []
+            for itry in range(2):
+                planner = RaveCreatePlanner(env,'birrt')
+                assert(planner.InitPlan(robot,params))
+                traj = RaveCreateTrajectory(env,'')
+                assert(planner.PlanPath(traj).statusCode == PlannerStatusCode.HasSolution)
+                vwaypoints.append(traj.GetWaypoints(0,traj.GetNumWaypoints(),robot.GetActiveConfigurationSpecification()))
+            assert(len(vwaypoints[0]) == len(vwaypoints[1]) and all(vwaypoints[0] == vwaypoints[1]))
+
+    def test_parametercopy(self):
+        # the direct copy of the parameters a class knows has to give the same parameters as the copy through xml
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetInitialConfig(robot.GetActiveDOFValues())
+            params.SetGoalConfig(goal)
+            params.SetConfigVelocityLimit(0.5*robot.GetActiveDOFMaxVel())
+            params.SetRandomGeneratorSeed(10)
+            params.SetMaxIterations(123)
+            params.SetSegmentCheckOrder(1)
+            params.SetDeterministicParallel(True)
+            params.SetPostProcessing('parabolicsmoother','<_nmaxiterations>20</_nmaxiterations>')
+            params.SetExtraParameters('<hastimestamps>1</hastimestamps><pointtolerance>0.05</pointtolerance><maxshortcuttime>2.5</maxshortcuttime><maxlinkspeed>1.5</maxlinkspeed><manipname>%s</manipname><nshortcutcycles>3</nshortcutcycles><nretimingthreads>2</nretimingthreads><unknowntag>1</unknowntag>'%robot.GetActiveManipulator().GetName())
+
+            # base to base, everything is copied directly and the extra parameters are kept as they are
+            paramscopy = Planner.PlannerParameters(params)
+            assert(repr(paramscopy) == repr(params))
+            paramscopy = Planner.PlannerParameters(paramscopy)
+            assert(repr(paramscopy) == repr(params))
+
+            # base to ConstraintTrajectoryTimingParameters parses the extra parameters
+            retimer = RaveCreatePlanner(env,'parabolictrajectoryretimer2')
+            assert(retimer.InitPlan(robot,params))
+            timingparams = retimer.GetParameters()
+            timingxml = repr(timingparams)
+            for tag in ['<maxshortcuttime>2.5</maxshortcuttime>','<maxlinkspeed>1.5</maxlinkspeed>','<nshortcutcycles>3</nshortcutcycles>','<nretimingthreads>2</nretimingthreads>','<unknowntag>1</unknowntag>']:
+                assert(timingxml.find(tag) >= 0)
+
+            # ConstraintTrajectoryTimingParameters to ConstraintTrajectoryTimingParameters is copied directly
+            retimer2 = RaveCreatePlanner(env,'parabolictrajectoryretimer2')
+            assert(retimer2.InitPlan(robot,timingparams))
+            assert(repr(retimer2.GetParameters()) == timingxml)
+
+            # ConstraintTrajectoryTimingParameters to base keeps the fields the base does not know as extra parameters
+            baseparams = Planner.PlannerParameters(timingparams)
+            retimer3 = RaveCreatePlanner(env,'parabolictrajectoryretimer2')
+            assert(retimer3.InitPlan(robot,baseparams))
+            assert(repr(retimer3.GetParameters()) == timingxml)
+
+            # the same parameters parsed from the xml string
+            retimer4 = RaveCreatePlanner(env,'parabolictrajectoryretimer2')
+            assert(retimer4.InitPlan(robot,timingxml[timingxml.find('"""')+3:timingxml.rfind('"""')]))
+            assert(repr(retimer4.GetParameters()) == timingxml)
+
+    def test_asyncplanpath(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetGoalConfig(goal)
+            planner = RaveCreatePlanner(env,'birrt')
+            assert(planner.InitPlan(robot,params))
+            # the worker plans on a clone, so keeping the environment locked does not block it
+            asyncplan = planningutils.AsyncPlanPath(planner,robot)
+            assert(asyncplan.Wait(60000))
+            assert(asyncplan.IsDone())
+            traj = RaveCreateTrajectory(env,'')
+            assert(asyncplan.GetResult(traj).statusCode == PlannerStatusCode.HasSolution)
+            assert(sum(abs(traj.GetWaypoint(-1,robot.GetActiveConfigurationSpecification())-goal)) <= g_epsilon)
+            planningutils.VerifyTrajectory(params,traj,samplingstep=0.002)
+
+    def test_prioritizedplanner(self):
+        env = self.env
+        with env:
+            robot1 = env.ReadRobotURI('robots/barrettwam.robot.xml')
+            env.Add(robot1,True)
+            robot2 = env.ReadRobotURI('robots/barrettwam.robot.xml')
+            env.Add(robot2,True)
+            T = robot2.GetTransform()
+            T[1,3] += 0.5
+            robot2.SetTransform(T)
+            spec = robot1.GetActiveManipulator().GetArmConfigurationSpecification() + robot2.GetActiveManipulator().GetArmConfigurationSpecification()
+            params = Planner.PlannerParameters()
+            params.SetConfigurationSpecification(env,spec)
+            initial = r_[robot1.GetDOFValues(robot1.GetActiveManipulator().GetArmIndices()), robot2.GetDOFValues(robot2.GetActiveManipulator().GetArmIndices())]
+            goal = array(initial)
+            goal[0] += 0.8
+            goal[7] -= 0.8
+            params.SetInitialConfig(initial)
+            params.SetGoalConfig(goal)
+            planner = RaveCreatePlanner(env,'prioritizedplanner')
+            assert(planner.InitPlan(None,params))
+            traj = RaveCreateTrajectory(env,'')
+            assert(planner.PlanPath(traj).statusCode == PlannerStatusCode.HasSolution)
+            assert(traj.GetDuration() > 0)
+            # the robots never collide with each other along the merged trajectory
+            for t in arange(0,traj.GetDuration(),0.01):
+                values = traj.Sample(t,spec)
+                robot1.SetDOFValues(values[0:7],robot1.GetActiveManipulator().GetArmIndices())
+                robot2.SetDOFValues(values[7:14],robot2.GetActiveManipulator().GetArmIndices())
+                assert(not env.CheckCollision(robot1,robot2))
+
+    def test_lazybirrt(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetGoalConfig(goal)
+            traj, status = self._PlanToGoal('lazybirrt',robot,params,goal)
+            # block the middle of the found path, the next query has to reject the unchecked edges through the obstacle
+            waypoints = traj.GetWaypoints(0,traj.GetNumWaypoints(),robot.GetActiveConfigurationSpecification()).reshape((traj.GetNumWaypoints(),robot.GetActiveDOF()))
+            imiddle = (len(waypoints)-1)//2
+            with robot:
+                robot.SetActiveDOFValues(0.5*(waypoints[imiddle]+waypoints[imiddle+1]))
+                Tee = robot.GetActiveManipulator().GetEndEffectorTransform()
+            box = RaveCreateKinBody(env,'')
+            box.SetName('lazyobstacle')
+            box.InitFromBoxes(array([[Tee[0,3],Tee[1,3],Tee[2,3],0.03,0.03,0.03]]),True)
+            env.Add(box)
+            with robot:
+                bEndsFree = True
+                for config in [waypoints[0],goal]:
+                    robot.SetActiveDOFValues(config)
+                    bEndsFree = bEndsFree and not env.CheckCollision(robot,box)
+            if bEndsFree:
+                self._PlanToGoal('lazybirrt',robot,params,goal)
+
+    def test_birrtstatistics(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetGoalConfig(goal)
+            traj, status = self._PlanToGoal('birrt',robot,params,goal)
+            assert(status.statistics['numIterations'] > 0)
+            assert(status.statistics['numNodes'] >= 2)
+            assert(status.statistics['numConstraintChecks'] > 0)
+            assert(status.statistics['totalTime'] >= status.statistics['constraintCheckTime'])
+
+    def test_plannerportfolio(self):
+        env = self.env
+        with env:
+            robot, goal = self._LoadLab1ArmGoal()
+            params = Planner.PlannerParameters()
+            params.SetRobotActiveJoints(robot)
+            params.SetGoalConfig(goal)
+            params.SetExtraParameters('<planners>birrt birrt basicrrt</planners>')
+            traj, status = self._PlanToGoal('plannerportfolio',robot,params,goal)
+            # in deterministic mode the successful worker with the lowest index wins, so the same seed gives the same path
+            params.SetRandomGeneratorSeed(10)
+            params.SetDeterministicParallel(True)
+            vwaypoints = []
+            for itry in range(2):
+                traj, status = self._PlanToGoal('plannerportfolio',robot,params,goal)
+                vwaypoints.append(traj.GetWaypoints(0,traj.GetNumWaypoints(),robot.GetActiveConfigurationSpecification()))
+            assert(len(vwaypoints[0]) == len(vwaypoints[1]) and all(vwaypoints[0] == vwaypoints[1]))
+            # a planner that does not exist fails the initialization instead of a worker
+            params.SetExtraParameters('<planners>birrt notaplanner</planners>')
+            assert(not RaveCreatePlanner(env,'plannerportfolio').InitPlan(robot,params))
+
+    def test_bisectionordertorques(self):
+        env = self.env
+        with env:
+            robot = self.LoadRobot('robots/barrettwam.robot.xml')
+            manip = robot.GetActiveManipulator()
+            robot.SetActiveDOFs(manip.GetArmIndices())
+            q0 = robot.GetActiveDOFValues()
+            # segments starting at rest with small and large accelerations
+            vresults = []
+            for segmentcheckorder in [0,1]:
+                params = Planner.PlannerParameters()
+                params.SetRobotActiveJoints(robot)
+                params.SetSegmentCheckOrder(segmentcheckorder)
+                constraint = planningutils.DynamicsCollisionConstraint(params,[robot])
+                results = []
+                for accel in [0.01,100.0]:
+                    timeelapsed = 0.1
+                    dq1 = accel*timeelapsed*ones(len(q0))
+                    q1 = q0 + 0.5*accel*timeelapsed**2*ones(len(q0))
+                    results.append(constraint.Check(q0,q1,zeros(len(q0)),dq1,timeelapsed,Interval.Closed,4))
+                vresults.append(results)
+            # every deferred state is checked with its own accelerations, so both orders reject the same segments
+            assert(vresults[0] == vresults[1])
+            assert(vresults[0][0] == 0 and vresults[0][1] != 0)
+
     def test_ikplanning(self):
         env = self.env
         self.LoadEnv('data/lab1.env.xml')
@@ -492,6 +492,30 @@ class RunRobot(EnvironmentSetup):
             sols = ikmodel.manip.FindIKSolutions(ikparam,IkFilterOptions.CheckEnvCollisions)
             assert(numrepeats[0]==4)
 
+    def test_solveallbatch(self):
+        env=self.env
+        robot=self.LoadRobot('robots/kuka-kr5-r650.zae')
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot, iktype=IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+
+        with env:
+            iksolver = ikmodel.manip.GetIkSolver()
+            lower,upper = robot.GetDOFLimits(ikmodel.manip.GetArmIndices())
+            ikparams = []
+            for i in range(20):
+                robot.SetDOFValues(lower+random.rand(len(lower))*(upper-lower),ikmodel.manip.GetArmIndices())
+                ikparams.append(ikmodel.manip.GetIkParameterization(IkParameterization.Type.Transform6D,False))
+            for numthreads in [1,4]:
+                assert(iksolver.SendCommand('SetBatchNumThreads %d'%numthreads) is not None)
+                allikreturns = iksolver.SolveAllBatch(ikparams,IkFilterOptions.IgnoreSelfCollisions)
+                assert(len(allikreturns)==len(ikparams))
+                for ikparam, ikreturns in zip(ikparams,allikreturns):
+                    expectedikreturns = iksolver.SolveAll(ikparam,IkFilterOptions.IgnoreSelfCollisions)
+                    assert(len(ikreturns)==len(expectedikreturns))
+                    for ikreturn, expectedikreturn in zip(ikreturns,expectedikreturns):
+                        assert(transdist(ikreturn.GetSolution(),expectedikreturn.GetSolution()) <= g_epsilon)
+
     def test_manipulators(self):
         env=self.env
         robot=self.LoadRobot('robots/pr2-beta-static.zae')
@@ -731,6 +755,28 @@ class RunRobot(EnvironmentSetup):
                 # optional print check
                 #for inworld in [True, False]:
                 #    print manip.GetIkParameterization(ikp, inworld=inworld)
+
+    def test_endeffectorcollisions(self):
+        self.log.info('test checking the end effector collisions of many poses at once')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            manip=robot.SetActiveManipulator('arm')
+            Tmanip = manip.GetTransform()
+            mug = env.GetKinBody('mug2')
+            Tposes = [Tmanip]
+            for i in range(20):
+                T = array(Tmanip)
+                T[0:3,3] = mug.GetTransform()[0:3,3] + 0.1*(random.rand(3)-0.5)
+                Tposes.append(T)
+            incollision = manip.CheckEndEffectorCollisions(Tposes)
+            assert(len(incollision) == len(Tposes))
+            for T, bcollision in zip(Tposes, incollision):
+                assert(bcollision == manip.CheckEndEffectorCollision(T))
+            assert(transdist(manip.GetTransform(), Tmanip) <= g_epsilon)
+            ikparams = [IkParameterization(T, IkParameterizationType.Transform6D) for T in Tposes]
+            assert(manip.CheckEndEffectorCollisions(ikparams) == incollision)
     
 #generate_classes(RunRobot, globals(), [('ode','ode'),('bullet','bullet')])
 
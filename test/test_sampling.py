@@ -58,3 +58,23 @@ class TestSampling(EnvironmentSetup):
         robot.SetActiveDOFs(range(robot.GetDOF()-4),Robot.DOFAffine.X|Robot.DOFAffine.Y|Robot.DOFAffine.RotationAxis,[0,0,1])
         values = sp.SampleSequence(SampleDataType.Real,1)
         assert(len(values) == robot.GetActiveDOF())
+
+    def test_streams(self):
+        sp0=RaveCreateSpaceSampler(self.env,'MT19937')
+        sp1=RaveCreateSpaceSampler(self.env,'MT19937')
+        sp0.SendCommand('SetStream 10 0')
+        values0 = sp0.SampleSequence(SampleDataType.Real,100)
+        sp0.SendCommand('SetStream 10 0')
+        sp1.SendCommand('SetStream 10 1')
+        assert(all(sp0.SampleSequence(SampleDataType.Real,100)==values0))
+        assert(not any(sp1.SampleSequence(SampleDataType.Real,100)==values0))
+
+        streamvalues = []
+        for streamindex in range(3):
+            sp=RaveCreateSpaceSampler(self.env,'Halton')
+            sp.SetSpaceDOF(2)
+            sp.SendCommand('SetStream %d 3'%streamindex)
+            values = sp.SampleSequence(SampleDataType.Real,200)
+            assert(values.shape == (200,2) and all(values>=0) and all(values<=1))
+            streamvalues.append(set([tuple(value) for value in values]))
+        assert(len(streamvalues[0]|streamvalues[1]|streamvalues[2]) == 600)
@@ -297,6 +297,42 @@ class TestTrajectory(EnvironmentSetup):
                 data2 = traj2.Sample(t)
                 assert( transdist(data1,data2) <= g_epsilon)
 
+    def test_smoothingshortcuttime(self):
+        env = self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        with env:
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            basevalues = robot.GetActiveDOFValues()
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(robot.GetActiveConfigurationSpecification('linear'))
+            for i in range(8):
+                values = basevalues + 0.05*((-1)**i)*ones(robot.GetActiveDOF())
+                values[i%robot.GetActiveDOF()] += 0.02*i
+                robot.SetActiveDOFValues(values)
+                if not env.CheckCollision(robot) and not robot.CheckSelfCollision():
+                    traj.Insert(traj.GetNumWaypoints(),values)
+            robot.SetActiveDOFValues(basevalues)
+            assert(traj.GetNumWaypoints() > 2)
+            for plannername in ['parabolicsmoother','parabolicsmoother2','shortcut_linear']:
+                self.log.debug('smoother %s', plannername)
+                # without a shortcut time the smoothers do not change, so the same seed gives the same trajectory
+                durations = []
+                for plannerparameters in ['', '<maxshortcuttime>0</maxshortcuttime>']:
+                    newtraj = RaveClone(traj,0)
+                    ret=planningutils.SmoothActiveDOFTrajectory(newtraj,robot,maxvelmult=1,maxaccelmult=1,plannername=plannername,plannerparameters=plannerparameters)
+                    assert(ret.statusCode==PlannerStatusCode.HasSolution)
+                    durations.append(newtraj.GetDuration())
+                assert(abs(durations[0]-durations[1]) <= g_epsilon)
+
+                # a short shortcut time still returns a valid trajectory
+                newtraj = RaveClone(traj,0)
+                starttime = time.time()
+                ret=planningutils.SmoothActiveDOFTrajectory(newtraj,robot,maxvelmult=1,maxaccelmult=1,plannername=plannername,plannerparameters='<maxshortcuttime>1</maxshortcuttime><_nmaxiterations>100000</_nmaxiterations>')
+                assert(ret.statusCode==PlannerStatusCode.HasSolution)
+                assert(time.time()-starttime < 30)
+                self.RunTrajectory(robot,newtraj)
+
     def test_multipleretiming(self):
         env=self.env
         env.Load('robots/barrettwam.robot.xml')
@@ -398,6 +434,63 @@ class TestTrajectory(EnvironmentSetup):
         self.RunTrajectory(robot, traj)
         assert( abs(traj.GetDuration()-1.01688888888873) < g_epsilon)
         
+    def test_parallelretiming(self):
+        env=self.env
+        robot=self.LoadRobot('robots/pumaarm.zae')
+        lower,upper = robot.GetDOFLimits()
+        randomstate = numpy.random.RandomState(0)
+        traj = RaveCreateTrajectory(env,'')
+        traj.Init(robot.GetActiveConfigurationSpecification())
+        for i in range(30):
+            traj.Insert(i,lower+(upper-lower)*(0.1+0.8*randomstate.rand(robot.GetDOF())))
+        # the minimum times computed on several threads have to give exactly the serial trajectory
+        for plannerparameters in ['', '<_fsteplength>0.008</_fsteplength>']:
+            trajs = []
+            for numthreads in [1,4]:
+                newtraj = RaveClone(traj,0)
+                ret=planningutils.RetimeActiveDOFTrajectory(newtraj,robot,False,1,1,'ParabolicTrajectoryRetimer2',plannerparameters+'<nretimingthreads>%d</nretimingthreads>'%numthreads)
+                assert(ret.statusCode==PlannerStatusCode.HasSolution)
+                trajs.append(newtraj)
+            assert(trajs[0].GetNumWaypoints() == trajs[1].GetNumWaypoints())
+            assert(abs(trajs[0].GetDuration()-trajs[1].GetDuration()) <= g_epsilon)
+            assert(transdist(trajs[0].GetWaypoints(0,trajs[0].GetNumWaypoints()),trajs[1].GetWaypoints(0,trajs[1].GetNumWaypoints())) <= g_epsilon)
+            self.RunTrajectory(robot,trajs[1])
+
+    def test_reachabilityretiming(self):
+        env=self.env
+        robot=self.LoadRobot('robots/pumaarm.zae')
+        with env:
+            waypoints = [zeros(robot.GetDOF()), [0.5, -0.3, 0.8, 0.2, -0.4, 0.6], [1.0, 0.2, 0.4, -0.3, 0.3, 1.2]]
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(robot.GetActiveConfigurationSpecification())
+            for i,waypoint in enumerate(waypoints):
+                traj.Insert(i,waypoint)
+            robot.SetDOFTorqueLimits(zeros(robot.GetDOF()))
+            traj0 = RaveCreateTrajectory(env,'')
+            traj0.Clone(traj,0)
+            ret=planningutils.RetimeActiveDOFTrajectory(traj0,robot,False,maxvelmult=1,maxaccelmult=1,plannername='reachabilitytrajectoryretimer')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            assert(traj0.GetDuration() > 0)
+            spec = robot.GetActiveConfigurationSpecification()
+            assert(transdist(traj0.GetWaypoint(0,spec),waypoints[0]) <= g_epsilon)
+            assert(transdist(traj0.GetWaypoint(traj0.GetNumWaypoints()-1,spec),waypoints[-1]) <= g_epsilon)
+
+            # torque limits a little above the gravity torques along the path slow the motion down
+            maxtorques = zeros(robot.GetDOF())
+            for i in range(len(waypoints)-1):
+                for s in linspace(0,1,20):
+                    robot.SetDOFValues(array(waypoints[i])*(1-s)+array(waypoints[i+1])*s)
+                    maxtorques = maximum(maxtorques, abs(robot.ComputeInverseDynamics([])))
+            robot.SetDOFValues(waypoints[0])
+            robot.SetDOFTorqueLimits(1.5*maxtorques+0.1)
+            traj1 = RaveCreateTrajectory(env,'')
+            traj1.Clone(traj,0)
+            ret=planningutils.RetimeActiveDOFTrajectory(traj1,robot,False,maxvelmult=1,maxaccelmult=1,plannername='reachabilitytrajectoryretimer')
+            assert(ret.statusCode==PlannerStatusCode.HasSolution)
+            assert(traj1.GetDuration() >= traj0.GetDuration()-g_epsilon)
+        self.RunTrajectory(robot, traj0)
+        self.RunTrajectory(robot, traj1)
+
     def test_ikparamretiming(self):
         self.log.info('retime workspace ikparam')
         env=self.env
@@ -844,6 +937,93 @@ class TestTrajectory(EnvironmentSetup):
             planningutils.VerifyTrajectory(parameters, traj,0.01)
             
 
+    def test_streamingtraj(self):
+        env=self.env
+        trajstr = '''<trajectory>
+<configuration>
+<group name="deltatime" offset="12" dof="1" interpolation=""/>
+<group name="joint_velocities muratecpicker0 0 1 2 3 4 5" offset="6" dof="6" interpolation="linear"/>
+<group name="joint_values muratecpicker0 0 1 2 3 4 5" offset="0" dof="6" interpolation="quadratic"/>
+<group name="iswaypoint" offset="13" dof="1" interpolation="next"/>
+</configuration>
+<data count="3">
+0.6117269650558744 0.9266602002674107 0.8438166789174414 0 1.371115774404944 -0.9590693617390226 0 0 0 0 0 0 0 1 1.17529158313744 0.189183598445679 1.49708779104353 -0.001910739864792349 1.446569660068643 0.1559566101894805 2.196724161297836 -2.874617422095069 2.546392001631284 -0.00744789202919198 0.294112455578719 4.346270887885016 0.5130954791780579 0 1.738856201219005 -0.5482930033760525 2.150358903169619 -0.003821479729584697 1.522023545732342 1.270982582117983 0 0 0 0 0 0 0.5130954791780579 1 </data>
+</trajectory>
+        '''
+        traj=RaveCreateTrajectory(env, '')
+        traj.deserialize(trajstr)
+        streamingtraj=RaveCreateTrajectory(env, 'StreamingTrajectory')
+        streamingtraj.Init(traj.GetConfigurationSpecification())
+        # append in two chunks
+        streamingtraj.Insert(0, traj.GetWaypoints(0,2))
+        assert(streamingtraj.SendCommand('IsFinished') == '0')
+        streamingtraj.Insert(2, traj.GetWaypoints(2,3))
+        streamingtraj.SendCommand('SetFinished 1')
+        assert(streamingtraj.SendCommand('IsFinished') == '1')
+        assert(streamingtraj.GetNumWaypoints() == traj.GetNumWaypoints())
+        assert(abs(streamingtraj.GetDuration() - traj.GetDuration()) <= g_epsilon)
+        assert(transdist(streamingtraj.GetWaypoints(0,3), traj.GetWaypoints(0,3)) <= g_epsilon)
+        for t in arange(0,traj.GetDuration()+0.1,0.01):
+            assert(transdist(streamingtraj.Sample(t), traj.Sample(t)) <= g_epsilon)
+            assert(streamingtraj.GetFirstWaypointIndexAfterTime(t) == traj.GetFirstWaypointIndexAfterTime(t))
+
+    def test_compressedtraj(self):
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        traj=RaveCreateTrajectory(env, '')
+        traj.Init(robot.GetActiveConfigurationSpecification('linear'))
+        traj.Insert(0, random.rand(20*robot.GetActiveDOF())*2-1)
+        planningutils.RetimeActiveDOFTrajectory(traj,robot,False)
+        for command, tolerance in [('float32', 1e-5), ('quantized 1e-5', 1e-5), ('quantized 1e-3 joint_velocities 1e-2', 1e-2)]:
+            traj.SendCommand('SetCompression ' + command)
+            trajdata=traj.serialize(0)
+            newtraj=RaveCreateTrajectory(env, '')
+            newtraj.deserialize(trajdata)
+            assert(newtraj.GetNumWaypoints() == traj.GetNumWaypoints())
+            assert(abs(newtraj.GetDuration() - traj.GetDuration()) <= g_epsilon)
+            assert(max(abs(newtraj.GetWaypoints(0,traj.GetNumWaypoints()) - traj.GetWaypoints(0,traj.GetNumWaypoints()))) <= tolerance)
+        traj.SendCommand('SetCompression none')
+        assert(len(traj.serialize(0)) > len(trajdata))
+
+    def test_largexmltraj(self):
+        env=self.env
+        # large enough for the <data> element to be parsed on several threads
+        numwaypoints = 40000
+        waypoints = random.rand(numwaypoints*8)*2-1
+        waypoints[0::8] *= 1e-7
+        trajxml = '''<trajectory>
+<configuration>
+<group name="joint_values robot 0 1 2 3 4 5 6" offset="0" dof="7" interpolation="linear"/>
+<group name="deltatime" offset="7" dof="1" interpolation=""/>
+</configuration>
+<data count="%d">
+%s
+</data>
+</trajectory>'''%(numwaypoints, ' '.join('%.17g'%value for value in waypoints))
+        assert(len(trajxml) > 4*(1<<20))
+        traj=RaveCreateTrajectory(env, '')
+        traj.deserialize(trajxml)
+        assert(traj.GetNumWaypoints() == numwaypoints)
+        assert(max(abs(traj.GetWaypoints(0,numwaypoints) - waypoints)) == 0)
+
+    def test_waypointsview(self):
+        env=self.env
+        traj=RaveCreateTrajectory(env, '')
+        spec=ConfigurationSpecification()
+        spec.AddGroup('joint_values robot 0 1', 2, 'linear')
+        spec.AddDeltaTimeGroup()
+        traj.Init(spec)
+        traj.Insert(0, [0,0,0, 1,2,1, 3,1,1])
+        view=traj.GetWaypointsView()
+        assert(view.shape == (3,3))
+        assert(not view.flags.writeable)
+        assert(transdist(view, traj.GetAllWaypoints2D()) <= g_epsilon)
+        times=arange(0,traj.GetDuration(),0.1)
+        data=zeros((len(times),3))
+        traj.SamplePointsToArray(times, data)
+        assert(transdist(data, traj.SamplePoints2D(times)) <= g_epsilon)
+
     def test_segmenttraj2():
         env=self.env
         trajstr = '''<trajectory>